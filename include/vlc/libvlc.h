@@ -316,6 +316,30 @@ LIBVLC_API void libvlc_event_detach( libvlc_event_manager_t *p_event_manager,
  */
 LIBVLC_API const char * libvlc_event_type_name( libvlc_event_type_t event_type );
 
+/**
+ * Event dispatch statistics of an event manager.
+ */
+typedef struct libvlc_event_stats_t
+{
+    uint64_t i_sent;      /**< Events sent by the object */
+    uint64_t i_queued;    /**< Events queued for asynchronous listeners */
+    uint64_t i_delivered; /**< Queued events delivered */
+    uint64_t i_coalesced; /**< Queued events superseded by a later one */
+    uint64_t i_dropped;   /**< Events not queued as the queue was full */
+    uint64_t i_waits;     /**< Times an emitter waited for room in the queue */
+    unsigned i_max_pending; /**< Peak number of queued events */
+} libvlc_event_stats_t;
+
+/**
+ * Get the dispatch statistics of an event manager.
+ *
+ * \param p_event_manager the event manager
+ * \param p_stats where to store the statistics [OUT]
+ * ersion LibVLC 2.1.0 or later
+ */
+LIBVLC_API void libvlc_event_manager_get_stats( libvlc_event_manager_t *p_event_manager,
+                                                libvlc_event_stats_t *p_stats );
+
 /** @} */
 
 /** \defgroup libvlc_log LibVLC logging
@@ -565,6 +589,49 @@ static inline int64_t libvlc_delay(int64_t pts)
 
 /** @} */
 
+/** \defgroup libvlc_memory LibVLC memory accounting
+ * These functions report the memory allocated for media blocks and pictures.
+ * @{
+ */
+
+/**
+ * Memory usage of an account. Accounts are named after the module (or core
+ * component) whose thread allocated the memory.
+ */
+typedef struct libvlc_memory_stats_t
+{
+    char    *psz_name;  /**< Account name */
+    uint64_t i_live;    /**< Bytes currently allocated */
+    uint64_t i_peak;    /**< Most bytes allocated at once */
+    uint64_t i_allocs;  /**< Number of allocations */
+} libvlc_memory_stats_t;
+
+/**
+ * Get the memory usage of all the accounts of the process.
+ *
+ * \param p_instance libvlc instance
+ * \param pp_stats address to store an allocated array of accounts [OUT]
+ *                 (must be freed with libvlc_memory_stats_release())
+ * \return the number of accounts (zero on error)
+ * \version LibVLC 2.1.0 or later
+ */
+LIBVLC_API
+unsigned libvlc_memory_stats_get( libvlc_instance_t *p_instance,
+                                  libvlc_memory_stats_t **pp_stats );
+
+/**
+ * Release the accounts returned by libvlc_memory_stats_get().
+ *
+ * \param p_stats the accounts to release
+ * \param i_count number of accounts
+ * \version LibVLC 2.1.0 or later
+ */
+LIBVLC_API
+void libvlc_memory_stats_release( libvlc_memory_stats_t *p_stats,
+                                  unsigned i_count );
+
+/** @} */
+
 # ifdef __cplusplus
 }
 # endif
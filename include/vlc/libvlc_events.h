@@ -77,6 +77,8 @@ enum libvlc_event_e {
     libvlc_MediaListWillAddItem,
     libvlc_MediaListItemDeleted,
     libvlc_MediaListWillDeleteItem,
+    libvlc_MediaListItemsAdded,
+    libvlc_MediaListItemsDeleted,
 
     libvlc_MediaListViewItemAdded=0x300,
     libvlc_MediaListViewWillAddItem,
@@ -189,6 +191,16 @@ typedef struct libvlc_event_t
             libvlc_media_t * item;
             int index;
         } media_list_will_delete_item;
+        struct
+        {
+            int index;
+            int count;
+        } media_list_items_added;
+        struct
+        {
+            int index;
+            int count;
+        } media_list_items_deleted;
 
         /* media list player */
         struct
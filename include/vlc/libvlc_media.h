@@ -594,6 +594,33 @@ LIBVLC_API
 void libvlc_media_tracks_release( libvlc_media_track_t **p_tracks,
                                   unsigned i_count );
 
+/**
+ * Get a picture of the media as an image file, without playing it.
+ *
+ * Only the demuxer and the video decoder are used, so this is much faster
+ * than taking a snapshot from a media player. The picture is the first one
+ * decoded after seeking, usually the keyframe preceding i_time.
+ * The method is synchronous.
+ *
+ * \version LibVLC 2.1.0 and later.
+ *
+ * \param p_md media descriptor object
+ * \param i_time time of the picture in milliseconds
+ * \param psz_format image format, e.g. "png" or "jpg"
+ * \param i_width the image width, or 0 to keep the aspect ratio
+ * \param i_height the image height, or 0 to keep the aspect ratio
+ *                 (the original size is used if both are 0)
+ * \param pp_data address to store the image, to be freed with libvlc_free()
+ *                by the caller [OUT]
+ * \param pi_size address to store the size of the image in bytes [OUT]
+ * \return 0 on success, -1 on error
+ */
+LIBVLC_API
+int libvlc_media_get_thumbnail( libvlc_media_t *p_md, libvlc_time_t i_time,
+                                const char *psz_format,
+                                unsigned i_width, unsigned i_height,
+                                unsigned char **pp_data, size_t *pi_size );
+
 /** @}*/
 
 # ifdef __cplusplus
@@ -127,6 +127,57 @@ libvlc_media_list_insert_media( libvlc_media_list_t *p_ml,
 LIBVLC_API int
 libvlc_media_list_remove_index( libvlc_media_list_t *p_ml, int i_pos );
 
+/**
+ * Add media instances at the end of media list
+ * The libvlc_media_list_lock should be held upon entering this function.
+ *
+ * This sends a single libvlc_MediaListItemsAdded event for all the media,
+ * and the per-item events only if they have listeners.
+ *
+ * \param p_ml a media list instance
+ * \param pp_md media instances
+ * \param i_count number of media instances
+ * \return 0 on success, -1 if the media list is read-only
+ * \version LibVLC 2.1.0 or later
+ */
+LIBVLC_API int
+libvlc_media_list_add_medias( libvlc_media_list_t *p_ml,
+                              libvlc_media_t *const *pp_md, int i_count );
+
+/**
+ * Insert media instances in media list on a position
+ * The libvlc_media_list_lock should be held upon entering this function.
+ *
+ * \see libvlc_media_list_add_medias
+ * \param p_ml a media list instance
+ * \param pp_md media instances
+ * \param i_count number of media instances
+ * \param i_pos position in array where to insert the first one
+ * \return 0 on success, -1 if the list is read-only or i_pos is invalid
+ * \version LibVLC 2.1.0 or later
+ */
+LIBVLC_API int
+libvlc_media_list_insert_medias( libvlc_media_list_t *p_ml,
+                                 libvlc_media_t *const *pp_md, int i_count,
+                                 int i_pos );
+
+/**
+ * Remove consecutive media instances from media list
+ * The libvlc_media_list_lock should be held upon entering this function.
+ *
+ * This sends a single libvlc_MediaListItemsDeleted event for all the media,
+ * and the per-item events only if they have listeners.
+ *
+ * \param p_ml a media list instance
+ * \param i_pos position of the first media instance to remove
+ * \param i_count number of media instances to remove
+ * \return 0 on success, -1 if the list is read-only or the range is invalid
+ * \version LibVLC 2.1.0 or later
+ */
+LIBVLC_API int
+libvlc_media_list_remove_range( libvlc_media_list_t *p_ml, int i_pos,
+                                int i_count );
+
 /**
  * Get count on media list items
  * The libvlc_media_list_lock should be held upon entering this function.
@@ -369,6 +369,37 @@ void libvlc_video_set_format_callbacks( libvlc_media_player_t *mp,
                                         libvlc_video_format_cb setup,
                                         libvlc_video_cleanup_cb cleanup );
 
+/**
+ * Callback prototype to negotiate the number of picture buffers.
+ *
+ * The video decoder can write directly into the picture buffers of the
+ * application if the format returned by the @ref libvlc_video_format_cb
+ * callback is the one of the decoder (same chroma and dimensions), and if
+ * there are enough buffers for all the pictures the decoder keeps at once.
+ * Otherwise, a copy into the application buffers is made for each picture.
+ *
+ * \param opaque private pointer as passed to libvlc_video_set_callbacks()
+ *               (and possibly modified by @ref libvlc_video_format_cb) [IN]
+ * \param count the number of picture buffers needed for direct rendering [IN]
+ * \return the number of picture buffers that the lock callback can provide,
+ *         that is count or less (a value above count is ignored)
+ */
+typedef unsigned (*libvlc_video_pool_cb)(void *opaque, unsigned count);
+
+/**
+ * Set the callback negotiating the number of picture buffers. This only works
+ * in combination with libvlc_video_set_format_callbacks(), and replaces the
+ * count returned by its setup callback.
+ *
+ * \param mp the media player
+ * \param pool callback to select the number of buffers (or NULL to use the
+ *             count returned by the setup callback)
+ * \version LibVLC 2.1.0 or later
+ */
+LIBVLC_API
+void libvlc_video_set_pool_callback( libvlc_media_player_t *mp,
+                                     libvlc_video_pool_cb pool );
+
 /**
  * Set the NSView handler where the media player should render its video output.
  *
@@ -775,6 +806,47 @@ LIBVLC_API libvlc_state_t libvlc_media_player_get_state( libvlc_media_player_t *
  */
 LIBVLC_API float libvlc_media_player_get_fps( libvlc_media_player_t *p_mi );
 
+/**
+ * Stages of the pipeline of a track, see libvlc_track_latency_t
+ */
+typedef enum libvlc_latency_stage_t
+{
+    libvlc_latency_demux = 0,   /**< handed by the demuxer to the decoder */
+    libvlc_latency_fifo,        /**< waiting in the decoder queue */
+    libvlc_latency_decode,      /**< decoding, per input packet */
+    libvlc_latency_queue,       /**< decoded, until queued to the output */
+    libvlc_latency_display      /**< queued, until its presentation date */
+} libvlc_latency_stage_t;
+
+#define LIBVLC_LATENCY_STAGES  5
+#define LIBVLC_LATENCY_BUCKETS 16
+
+/**
+ * Latency histograms of a track. All durations are in microseconds.
+ * i_count[stage][i] is the number of durations below (100 << i)
+ * microseconds, the last bucket counts all longer durations.
+ */
+typedef struct libvlc_track_latency_t
+{
+    uint64_t i_count[LIBVLC_LATENCY_STAGES][LIBVLC_LATENCY_BUCKETS];
+    int64_t  i_total[LIBVLC_LATENCY_STAGES];   /**< sum of all durations */
+    int64_t  i_max[LIBVLC_LATENCY_STAGES];     /**< longest duration */
+} libvlc_track_latency_t;
+
+/**
+ * Get the latency histograms of a track being played.
+ * Latencies are only measured if statistics are enabled ("--stats").
+ *
+ * \param p_mi the Media Player
+ * \param i_track the track ID (\see libvlc_media_track_t)
+ * \param p_latency where to store the histograms [OUT]
+ * \return 0 on success, -1 if the track is not being decoded
+ * \version LibVLC 2.1.0 or later
+ */
+LIBVLC_API int libvlc_media_player_get_track_latency( libvlc_media_player_t *p_mi,
+                                                      int i_track,
+                                                      libvlc_track_latency_t *p_latency );
+
 /** end bug */
 
 /**
@@ -1175,6 +1247,11 @@ int libvlc_video_set_track( libvlc_media_player_t *p_mi, int i_track );
  * If i_width AND i_height is 0, original size is used.
  * If i_width XOR i_height is 0, original aspect-ratio is preserved.
  *
+ * If the instance was created with the --snapshot-threads option, the
+ * snapshot is encoded and saved in the background, and this function
+ * returns immediately. The libvlc_MediaPlayerSnapshotTaken event reports
+ * the file once it is written.
+ *
  * \param p_mi media player instance
  * \param num number of video output (typically 0 for the first/only one)
  * \param psz_filepath the path where to save the screenshot to
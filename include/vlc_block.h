@@ -166,6 +166,29 @@ static inline void block_Release( block_t *p_block )
     p_block->pf_release( p_block );
 }
 
+/****************************************************************************
+ * Shared blocks functions:
+ ****************************************************************************
+ * A shared block is a reference to a payload that other blocks may also
+ * reference, so that it can be handed to several consumers without copying.
+ * Each reference has its own metadata (timestamps, flags, p_next) and its
+ * own payload window (p_buffer, i_buffer), that can be shrunk freely.
+ *
+ * The payload itself must not be modified in place as long as it is
+ * shared: block_Realloc() copies it when it has to grow it, and code that
+ * writes into a block it did not allocate must call block_Unshare() first.
+ *
+ * - block_MakeShared : turn a block into a shared one, return the block
+ *      unchanged if it cannot (in which case block_Share copies it).
+ * - block_Share : get a new reference to the payload of a block.
+ * - block_Unshare : get a block whose payload can be modified, that is the
+ *      block itself if it is not shared (anymore), or a copy of it.
+ *      The block is consumed, return NULL for failure.
+ ****************************************************************************/
+VLC_API block_t *block_MakeShared( block_t * ) VLC_USED;
+VLC_API block_t *block_Share( block_t * ) VLC_USED;
+VLC_API block_t *block_Unshare( block_t * ) VLC_USED;
+
 VLC_API block_t *block_heap_Alloc(void *, size_t) VLC_USED VLC_MALLOC;
 VLC_API block_t *block_mmap_Alloc(void *addr, size_t length) VLC_USED VLC_MALLOC;
 VLC_API block_t * block_shm_Alloc(void *addr, size_t length) VLC_USED VLC_MALLOC;
@@ -294,26 +317,33 @@ static inline block_t *block_ChainGather( block_t *p_list )
  * Fifos of blocks.
  ****************************************************************************
  * - block_FifoNew : create and init a new fifo
+ * - block_FifoNewSPSC : create a fifo for one producer and one consumer
+ *      thread, which avoids locking unless either side has to wait
  * - block_FifoRelease : destroy a fifo and free all blocks in it.
  * - block_FifoPace : wait for a fifo to drain to a specified number of packets or total data size
  * - block_FifoEmpty : free all blocks in a fifo
  * - block_FifoPut : put a block
  * - block_FifoGet : get a packet from the fifo (and wait if it is empty)
+ * - block_FifoGetBatch : get a chain of packets from the fifo at once (and
+ *      wait if it is empty, possibly until a deadline)
  * - block_FifoShow : show the first packet of the fifo (and wait if
  *      needed), be carefull, you can use it ONLY if you are sure to be the
  *      only one getting data from the fifo.
  * - block_FifoCount : how many packets are waiting in the fifo
  *
- * block_FifoGet and block_FifoShow are cancellation points.
+ * block_FifoGet, block_FifoGetBatch and block_FifoShow are cancellation
+ * points.
  ****************************************************************************/
 
 VLC_API block_fifo_t *block_FifoNew( void ) VLC_USED VLC_MALLOC;
+VLC_API block_fifo_t *block_FifoNewSPSC( void ) VLC_USED VLC_MALLOC;
 VLC_API void block_FifoRelease( block_fifo_t * );
 VLC_API void block_FifoPace( block_fifo_t *fifo, size_t max_depth, size_t max_size );
 VLC_API void block_FifoEmpty( block_fifo_t * );
 VLC_API size_t block_FifoPut( block_fifo_t *, block_t * );
 void block_FifoWake( block_fifo_t * );
 VLC_API block_t * block_FifoGet( block_fifo_t * ) VLC_USED;
+VLC_API block_t * block_FifoGetBatch( block_fifo_t *, size_t max_size, mtime_t deadline ) VLC_USED;
 VLC_API block_t * block_FifoShow( block_fifo_t * );
 size_t block_FifoSize( const block_fifo_t *p_fifo ) VLC_USED;
 VLC_API size_t block_FifoCount( const block_fifo_t *p_fifo ) VLC_USED;
@@ -478,6 +478,21 @@ static inline int block_FindStartcodeFromOffset(
     {
         for( i_offset = i_size; i_offset < p_block->i_buffer; i_offset++ )
         {
+            if( !i_match )
+            {
+                /* Skip to the next candidate first byte: memchr() is
+                 * vectorized by the C library and start codes are rare */
+                const uint8_t *p = (const uint8_t *)
+                    memchr( &p_block->p_buffer[i_offset], p_startcode[0],
+                            p_block->i_buffer - i_offset );
+                if( p == NULL )
+                {
+                    i_offset = p_block->i_buffer;
+                    break;
+                }
+                i_offset = p - p_block->p_buffer;
+            }
+
             if( p_block->p_buffer[i_offset] == p_startcode[i_match] )
             {
                 if( !i_match )
@@ -108,6 +108,13 @@ struct decoder_t
      */
     int             i_extra_picture_buffers;
 
+    /**
+     * Number of pictures kept by the decoder as references or for
+     * reordering (the DPB), 0 to let the core use a worst case value for
+     * the codec. It is only read when the video output is created.
+     */
+    int             i_dpb_size;
+
     /* Audio output callbacks
      * XXX use decoder_NewAudioBuffer/decoder_DeleteAudioBuffer */
     block_t        *(*pf_aout_buffer_new)( decoder_t *, int );
@@ -129,6 +136,10 @@ struct decoder_t
      * XXX use decoder_GetDisplayRate */
     int             (*pf_get_display_rate)( decoder_t * );
 
+    /* Pictures lost by the display
+     * XXX use decoder_GetDisplayLost */
+    int             (*pf_get_display_lost)( decoder_t * );
+
     /* Private structure for the owner of the decoder */
     decoder_owner_sys_t *p_owner;
 
@@ -171,6 +182,9 @@ struct encoder_t
     int i_bframes;               /* One B frame per i_bframes */
     int i_tolerance;             /* Bitrate tolerance */
 
+    /* Set by the module: delay between an input and the matching output */
+    mtime_t i_delay;
+
     /* Encoder config */
     config_chain_t *p_cfg;
 };
@@ -243,4 +257,11 @@ VLC_API mtime_t decoder_GetDisplayDate( decoder_t *, mtime_t ) VLC_USED;
  */
 VLC_API int decoder_GetDisplayRate( decoder_t * ) VLC_USED;
 
+/**
+ * This function returns the number of pictures the video output dropped
+ * because they were late, since its last call.
+ * It lets a decoder skip some decoding work when the display is overloaded.
+ */
+VLC_API int decoder_GetDisplayLost( decoder_t * ) VLC_USED;
+
 #endif /* _VLC_CODEC_H */
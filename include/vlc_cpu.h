@@ -28,6 +28,27 @@
 
 VLC_API unsigned vlc_CPU(void);
 
+/**
+ * Picks the fastest of several implementations of a routine.
+ *
+ * The candidates are numbered from 0, in the order of preference that
+ * applies without measurement. If the cpu-bench option is set, the first
+ * call for a given name times each candidate with run(opaque, index), and
+ * the choice is remembered by name for the lifetime of the process.
+ * Otherwise, 0 is returned.
+ *
+ * \param name routine name, key of the remembered choice
+ * \param count number of candidates
+ * \param run runs the candidate of the given index once, on the same data
+ * each time; it should take some hundred microseconds
+ * \return index of the chosen candidate
+ */
+VLC_API unsigned vlc_CPU_Fastest(vlc_object_t *, const char *name,
+                                 unsigned count,
+                                 void (*run)(void *, unsigned), void *opaque);
+#define vlc_CPU_Fastest(o, n, c, r, d) \
+        vlc_CPU_Fastest(VLC_OBJECT(o), n, c, r, d)
+
 # if defined (__i386__) || defined (__x86_64__)
 #  define HAVE_FPU 1
 #  define VLC_CPU_MMX    0x00000008
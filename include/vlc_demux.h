@@ -216,6 +216,65 @@ VLC_API void demux_PacketizerDestroy( decoder_t *p_packetizer );
  */
 VLC_API input_thread_t * demux_GetParentInput( demux_t *p_demux ) VLC_USED;
 
+/**
+ * \defgroup seek_index Persistent seek index
+ * It maps stream times to byte positions for demuxers that would otherwise
+ * need to scan the stream to seek. It is stored in the user cache directory
+ * and reused for as long as the local file is not modified.
+ * @{
+ */
+typedef struct seek_index_t seek_index_t;
+
+typedef struct
+{
+    mtime_t i_time;     /* Stream time as computed by the demuxer */
+    int64_t i_pos;      /* Byte position, -1 if the entry is not valid */
+} seek_index_entry_t;
+
+/**
+ * This function creates the index of the stream opened by a demuxer,
+ * and loads it from the cache if it exists.
+ *
+ * \param psz_name identifies the demuxer: each demuxer has its own index.
+ * \return NULL if the stream cannot be indexed (not a local file, or
+ * indexing disabled).
+ */
+VLC_API seek_index_t * demux_SeekIndexNew( demux_t *, const char *psz_name ) VLC_USED;
+
+/**
+ * This function saves the index if needed and destroys it.
+ */
+VLC_API void demux_SeekIndexDelete( seek_index_t * );
+
+/**
+ * This function records that the stream time i_time can be found at i_pos.
+ *
+ * Entries too close to an existing one, or not consistent with the others
+ * (a later time at an earlier position) are ignored.
+ */
+VLC_API void demux_SeekIndexAdd( seek_index_t *, mtime_t i_time, int64_t i_pos );
+
+/**
+ * This function finds the entries surrounding i_time.
+ *
+ * \param p_before is set to the last entry at or before i_time.
+ * \param p_after if not NULL, is set to the first entry after i_time.
+ * \return VLC_SUCCESS if at least one of them is valid.
+ */
+VLC_API int demux_SeekIndexLookup( seek_index_t *, mtime_t i_time, seek_index_entry_t *p_before, seek_index_entry_t *p_after );
+
+/**
+ * This function returns the entry i_entry (in time order), it can be used
+ * to iterate over the whole index.
+ *
+ * \return VLC_EGENERIC when i_entry is out of range.
+ */
+VLC_API int demux_SeekIndexGet( seek_index_t *, int i_entry, seek_index_entry_t *p_entry );
+
+/**
+ * @}
+ */
+
 /* */
 #define DEMUX_INIT_COMMON() do {            \
     p_demux->pf_control = Control;          \
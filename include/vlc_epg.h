@@ -45,6 +45,8 @@ typedef struct
     char            *psz_name;
     vlc_epg_event_t *p_current; /* Can be null or should be the same than one of pp_event entry */
 
+    /* Sorted by start time, with at most one event per start time */
+
     int             i_event;
     vlc_epg_event_t **pp_event;
 } vlc_epg_t;
@@ -62,7 +64,9 @@ VLC_API void vlc_epg_Init(vlc_epg_t *p_epg, const char *psz_name);
 VLC_API void vlc_epg_Clean(vlc_epg_t *p_epg);
 
 /**
- * It creates and appends a new vlc_epg_event_t to a vlc_epg_t.
+ * It creates and inserts a new vlc_epg_event_t into a vlc_epg_t.
+ *
+ * An event starting at the same time is replaced.
  *
  * \see vlc_epg_t for the definitions of the parameters.
  */
@@ -88,9 +92,12 @@ VLC_API void vlc_epg_SetCurrent(vlc_epg_t *p_epg, int64_t i_start);
 /**
  * It merges all the event of \p p_src and \p p_dst into \p p_dst.
  *
- * \p p_src is not modified.
+ * The events of \p p_src replace the events of \p p_dst starting at the
+ * same time. \p p_src is not modified.
+ *
+ * \return true if \p p_dst has been modified
  */
-VLC_API void vlc_epg_Merge(vlc_epg_t *p_dst, const vlc_epg_t *p_src);
+VLC_API bool vlc_epg_Merge(vlc_epg_t *p_dst, const vlc_epg_t *p_src);
 
 #endif
 
@@ -29,6 +29,7 @@
 #include <vlc_picture.h>
 #include <vlc_subpicture.h>
 #include <vlc_mouse.h>
+#include <vlc_block.h>
 
 /**
  * \file
@@ -89,8 +90,10 @@ struct filter_t
         struct
         {
             block_t *   (*pf_filter) ( filter_t *, block_t * );
+            block_t *   (*pf_buffer_new) ( filter_t *, size_t );
         } audio;
 #define pf_audio_filter     u.audio.pf_filter
+#define pf_audio_buffer_new u.audio.pf_buffer_new
 
         struct
         {
@@ -140,8 +143,32 @@ struct filter_t
 
     /* Private structure for the owner of the decoder */
     filter_owner_sys_t *p_owner;
+
+    /* Set by video filters that use filter_RunSlices(), so that the owner
+     * provides the threads to run the slices */
+    bool                b_slices;
 };
 
+/**
+ * This function runs pf_slice on horizontal stripes of the picture currently
+ * processed by a video filter, on the threads shared by all the filter
+ * chains if p_filter->b_slices is set, or on the calling thread otherwise.
+ *
+ * The rows are in any unit chosen by the filter (typically the lines of its
+ * smallest plane): pf_slice is called with disjoint [i_start, i_end) ranges
+ * covering [0, i_rows), possibly concurrently. It returns when all of them
+ * are done.
+ *
+ * \param p_filter filter_t object
+ * \param pf_slice function processing the rows [i_start, i_end)
+ * \param p_data opaque pointer given to pf_slice
+ * \param i_rows number of rows
+ */
+VLC_API void filter_RunSlices( filter_t *p_filter,
+                               void (*pf_slice)( filter_t *, void *p_data,
+                                                 int i_start, int i_end ),
+                               void *p_data, int i_rows );
+
 /**
  * This function will return a new picture usable by p_filter as an output
  * buffer. You have to release it using filter_DeletePicture or by returning
@@ -159,6 +186,25 @@ static inline picture_t *filter_NewPicture( filter_t *p_filter )
     return p_picture;
 }
 
+/**
+ * This function will return a new audio buffer usable by p_filter as an
+ * output buffer. You have to release it using block_Release or by returning
+ * it to the caller as a pf_audio_filter return value.
+ * The owner of the filter may recycle its buffers, otherwise this is
+ * block_Alloc().
+ *
+ * \param p_filter filter_t object
+ * \param i_size payload size in bytes
+ * \return new block on success or NULL on failure
+ */
+static inline block_t *filter_NewAudioBuffer( filter_t *p_filter,
+                                              size_t i_size )
+{
+    if( p_filter->pf_audio_buffer_new != NULL )
+        return p_filter->pf_audio_buffer_new( p_filter, i_size );
+    return block_Alloc( i_size );
+}
+
 /**
  * This function will release a picture create by filter_NewPicture.
  * Provided for convenience.
@@ -228,6 +228,11 @@
 /* 2 planes Y/VU 4:2:2 */
 #define VLC_CODEC_NV61            VLC_FOURCC('N','V','6','1')
 
+/* Opaque chroma: pictures stored in VA API surfaces, see picture_t.context */
+#define VLC_CODEC_VAAPI_OPAQUE    VLC_FOURCC('V','A','O','P')
+/* Opaque chroma: pictures stored in Direct3D9 surfaces, see picture_t.context */
+#define VLC_CODEC_D3D9_OPAQUE     VLC_FOURCC('D','X','A','9')
+
 /* Image codec (video) */
 #define VLC_CODEC_PNG             VLC_FOURCC('p','n','g',' ')
 #define VLC_CODEC_PPM             VLC_FOURCC('p','p','m',' ')
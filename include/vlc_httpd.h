@@ -122,6 +122,12 @@ typedef int (*httpd_file_callback_t)( httpd_file_sys_t *, httpd_file_t *, uint8_
 VLC_API httpd_file_t * httpd_FileNew( httpd_host_t *, const char *psz_url, const char *psz_mime, const char *psz_user, const char *psz_password, httpd_file_callback_t pf_fill, httpd_file_sys_t * ) VLC_USED;
 VLC_API httpd_file_sys_t * httpd_FileDelete( httpd_file_t * );
 
+/* Serves the regular files found under a local directory, with byte ranges
+ * and conditional requests support */
+typedef struct httpd_dir_t      httpd_dir_t;
+VLC_API httpd_dir_t * httpd_DirNew( httpd_host_t *, const char *psz_url, const char *psz_path, const char *psz_user, const char *psz_password ) VLC_USED;
+VLC_API void httpd_DirDelete( httpd_dir_t * );
+
 
 typedef struct httpd_handler_t  httpd_handler_t;
 typedef struct httpd_handler_sys_t httpd_handler_sys_t;
@@ -139,6 +145,9 @@ VLC_API httpd_stream_t * httpd_StreamNew( httpd_host_t *, const char *psz_url, c
 VLC_API void httpd_StreamDelete( httpd_stream_t * );
 VLC_API int httpd_StreamHeader( httpd_stream_t *, uint8_t *p_data, int i_data );
 VLC_API int httpd_StreamSend( httpd_stream_t *, uint8_t *p_data, int i_data );
+/* Same as httpd_StreamSend but without copying the data: the block payload
+ * is shared with the clients, the block is consumed */
+VLC_API int httpd_StreamSendBlock( httpd_stream_t *, block_t * );
 
 
 /* Msg functions facilities */
@@ -404,6 +404,35 @@ typedef enum input_event_type_e
 
 } input_event_type_e;
 
+/**
+ * Stages of the pipeline of an elementary stream, see input_latency_t
+ */
+enum input_latency_stage_e
+{
+    INPUT_LATENCY_DEMUX,    /**< Handed to the decoder until in its fifo */
+    INPUT_LATENCY_FIFO,     /**< In the decoder fifo until decoding starts */
+    INPUT_LATENCY_DECODE,   /**< Decoding (per input block) */
+    INPUT_LATENCY_QUEUE,    /**< Decoded until queued to the output */
+    INPUT_LATENCY_DISPLAY,  /**< Queued until its presentation date */
+
+    INPUT_LATENCY_STAGES
+};
+
+/** Bucket i counts durations below (INPUT_LATENCY_BASE << i) microseconds,
+ * the last bucket counts all longer durations */
+#define INPUT_LATENCY_BASE    100
+#define INPUT_LATENCY_BUCKETS 16
+
+/**
+ * Latency histograms of an elementary stream
+ */
+typedef struct input_latency_t
+{
+    uint64_t pi_count[INPUT_LATENCY_STAGES][INPUT_LATENCY_BUCKETS];
+    mtime_t  pi_total[INPUT_LATENCY_STAGES]; /**< Sum of all durations */
+    mtime_t  pi_max[INPUT_LATENCY_STAGES];
+} input_latency_t;
+
 /**
  * Input queries
  */
@@ -484,6 +513,7 @@ enum input_query_e
     INPUT_GET_AOUT,         /* arg1=audio_output_t **              res=can fail */
     INPUT_GET_VOUTS,        /* arg1=vout_thread_t ***, size_t *        res=can fail */
     INPUT_GET_ES_OBJECTS,   /* arg1=int id, vlc_object_t **dec, vout_thread_t **, audio_output_t ** */
+    INPUT_GET_ES_LATENCY,   /* arg1=int id, input_latency_t *      res=can fail */
 
     /* External clock managments */
     INPUT_GET_PCR_SYSTEM,   /* arg1=mtime_t *, arg2=mtime_t *       res=can fail */
@@ -509,6 +539,17 @@ VLC_API void input_Stop( input_thread_t *, bool b_abort );
 VLC_API int input_Read( vlc_object_t *, input_item_t * );
 #define input_Read(a,b) input_Read(VLC_OBJECT(a),b)
 
+/**
+ * Decodes a picture of an item near i_time, without playing it, and
+ * encodes it like picture_Export() does.
+ *
+ * Only the demuxer and the video decoder are run, and the first picture
+ * decoded after seeking is used (usually the keyframe preceding i_time).
+ * \param i_timeout maximal duration of the whole extraction
+ */
+VLC_API int input_Thumbnail( vlc_object_t *, input_item_t *, mtime_t i_time, mtime_t i_timeout, block_t **pp_image, vlc_fourcc_t i_format, int i_width, int i_height );
+#define input_Thumbnail(a,b,c,d,e,f,g,h) input_Thumbnail(VLC_OBJECT(a),b,c,d,e,f,g,h)
+
 VLC_API int input_vaControl( input_thread_t *, int i_query, va_list  );
 
 VLC_API int input_Control( input_thread_t *, int i_query, ...  );
@@ -314,6 +314,10 @@ struct input_stats_t
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+
+    /* Block pool (process-wide) */
+    int64_t i_block_pool_hits;
+    int64_t i_block_pool_misses;
 };
 
 #endif
@@ -97,12 +97,15 @@ typedef enum
     ML_MEDIA,                  /**< Full media descriptor. @see ml_media_t */
     ML_MEDIA_SPARSE,           /**< Sparse media. @see ml_media_t */
     ML_MEDIA_EXTRA,            /**< Sparse + Extra = Full media */
+    ML_SEARCH,                 /**< Words in the title, original title,
+                                    album or people names of the media */
 
     /* Some special elements */
     ML_LIMIT     = -1,         /**< Limit a query to X results */
     ML_SORT_DESC = -2,         /**< Sort a query descending on argument X */
     ML_SORT_ASC  = -3,         /**< Sort a query ascending on argument X */
     ML_DISTINCT  = -4,         /**< Add DISTINCT to SELECT statements. */
+    ML_OFFSET    = -5,         /**< Skip the X first results of a query */
     ML_END       = -42         /**< End of argument list */
 } ml_select_e;
 
@@ -468,6 +471,7 @@ static inline int ml_AttributeIsString( ml_select_e meta )
     case ML_PEOPLE:
     case ML_PEOPLE_ROLE:
     case ML_ORIGINAL_TITLE:
+    case ML_SEARCH:
     case ML_TITLE:
     case ML_URI:
         return 1;
@@ -486,6 +490,7 @@ static inline int ml_AttributeIsString( ml_select_e meta )
     case ML_IMPORT_TIME:
     case ML_LAST_PLAYED:
     case ML_LIMIT:
+    case ML_OFFSET:
     case ML_PLAYED_COUNT:
     case ML_PEOPLE_ID:
     case ML_SCORE:
@@ -820,8 +825,8 @@ VLC_API ml_ftree_t *ml_OpConnectChilds( ml_op_e op, ml_ftree_t* left,
 /**
  * @brief Attaches a special node to a tree
  * @param tree Tree to attach special node to
- * @param crit Criteria may be SORT_ASC, SORT_DESC, LIMIT or DISTINCT
- * @param limit Limit used if LIMIT criteria used
+ * @param crit Criteria may be SORT_ASC, SORT_DESC, LIMIT, OFFSET or DISTINCT
+ * @param limit Limit (or offset) used if LIMIT (or OFFSET) criteria used
  * @param Sort string used if SORT criteria is used
  * @return Pointer to new tree
  * @note Use the helpers
@@ -855,6 +860,7 @@ static inline ml_ftree_t* ml_FtreeFastAnd( ml_ftree_t* left,
 #define ml_FtreeSpecAsc( tree, str )        ml_FtreeSpec( tree, ML_SORT_ASC, 0, str )
 #define ml_FtreeSpecDesc( tree, str )       ml_FtreeSpec( tree, ML_SORT_DESC, 0, str )
 #define ml_FtreeSpecLimit( tree, limit )    ml_FtreeSpec( tree, ML_LIMIT, limit, NULL )
+#define ml_FtreeSpecOffset( tree, offset )  ml_FtreeSpec( tree, ML_OFFSET, offset, NULL )
 #define ml_FtreeSpecDistinct( tree )        ml_FtreeSpec( tree, ML_DISTINCT, 0, NULL )
 
 
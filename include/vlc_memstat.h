@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * vlc_memstat.h: memory accounting
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_MEMSTAT_H
+# define VLC_MEMSTAT_H
+
+/**
+ * \file
+ * This file defines the accounting of the block and picture allocations.
+ *
+ * Each thread charges its allocations to a named account, usually the
+ * module it runs: the decoder thread charges the decoder module, the input
+ * thread the demuxer, and so on. Memory is credited back to the account
+ * it was charged to, whichever thread releases it.
+ */
+
+#define VLC_MEM_ACCOUNTS     64
+#define VLC_MEM_ACCOUNT_NAME 32
+
+typedef struct vlc_mem_stats_t
+{
+    char     psz_name[VLC_MEM_ACCOUNT_NAME]; /**< Account name */
+    uint64_t i_live;    /**< Bytes currently allocated */
+    uint64_t i_peak;    /**< High-water mark of i_live */
+    uint64_t i_allocs;  /**< Number of allocations ever charged */
+} vlc_mem_stats_t;
+
+/**
+ * Selects the account charged with the allocations of the calling thread.
+ * \param name account name (usually a module name), or NULL for the default
+ * "other" account
+ */
+VLC_API void vlc_mem_SetAccount( const char *name );
+
+/**
+ * Reads the memory accounts.
+ * \param tab table of VLC_MEM_ACCOUNTS entries to fill
+ * \return the number of accounts filled in
+ */
+VLC_API unsigned vlc_mem_GetStats( vlc_mem_stats_t *tab );
+
+#endif
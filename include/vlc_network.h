@@ -105,6 +105,8 @@ static inline int net_ConnectTCP (vlc_object_t *obj, const char *host, int port)
 }
 #define net_ConnectTCP(a, b, c) net_ConnectTCP(VLC_OBJECT(a), b, c)
 
+VLC_API void net_PrefetchTCP (const char *host, int port);
+
 VLC_API int net_AcceptSingle(vlc_object_t *obj, int lfd);
 
 VLC_API int net_Accept( vlc_object_t *, int * );
@@ -268,6 +270,12 @@ VLC_API int  getnameinfo ( const struct sockaddr *, socklen_t,
 VLC_API int vlc_getnameinfo( const struct sockaddr *, int, char *, int, int *, int );
 VLC_API int vlc_getaddrinfo (const char *, unsigned,
                              const struct addrinfo *, struct addrinfo **);
+VLC_API int vlc_getaddrinfo_cached (vlc_object_t *, const char *, unsigned,
+                                    const struct addrinfo *,
+                                    struct addrinfo **);
+VLC_API void vlc_freeaddrinfo_cached (struct addrinfo *);
+VLC_API void vlc_getaddrinfo_prefetch (const char *, unsigned,
+                                       const struct addrinfo *);
 
 
 #ifdef __OS2__
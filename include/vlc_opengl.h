@@ -86,4 +86,23 @@ static inline void *vlc_gl_GetProcAddress(vlc_gl_t *gl, const char *name)
     return (gl->getProcAddress != NULL) ? gl->getProcAddress(gl, name) : NULL;
 }
 
+#include <vlc_picture.h>
+
+/**
+ * Context of the pictures of an opaque chroma that can be drawn into an
+ * OpenGL texture without going through system memory.
+ */
+typedef struct vlc_gl_picture_t vlc_gl_picture_t;
+
+struct vlc_gl_picture_t
+{
+    picture_context_t context;
+
+    /**
+     * Draws the picture into the given texture, which must be allocated
+     * with the size of the picture. The OpenGL context must be current.
+     */
+    int (*render)(vlc_gl_picture_t *, unsigned target, unsigned texture);
+};
+
 #endif /* VLC_GL_H */
@@ -63,6 +63,19 @@ typedef struct plane_t
  */
 typedef struct picture_gc_sys_t picture_gc_sys_t;
 
+/**
+ * Decoder specific data attached to a picture, for instance a reference to
+ * the hardware surface holding the pixels of an opaque chroma.
+ *
+ * It is duplicated by picture_Copy() and destroyed when the last reference
+ * to the picture is released, both can happen from any thread.
+ */
+typedef struct picture_context_t
+{
+    void (*destroy)( struct picture_context_t * );
+    struct picture_context_t *(*copy)( struct picture_context_t * );
+} picture_context_t;
+
 /**
  * Video picture
  */
@@ -97,6 +110,9 @@ struct picture_t
      * keep track of the picture */
     picture_sys_t * p_sys;
 
+    /** Decoder specific data, NULL if none */
+    picture_context_t *context;
+
     /** This way the picture_Release can be overloaded */
     struct
     {
@@ -121,6 +121,16 @@ VLC_API picture_pool_t * picture_pool_Reserve(picture_pool_t *, int picture_coun
  */
 VLC_API int picture_pool_GetSize(picture_pool_t *);
 
+/**
+ * It returns the usage of the given pool.
+ *
+ * used is set to the number of pictures currently not free, including the
+ * ones reserved by another pool (see picture_pool_Reserve), used_max to
+ * the highest number of pictures used at once and free_min to the lowest
+ * number of free pictures, since the pool creation. Any of them can be NULL.
+ */
+VLC_API void picture_pool_GetStats(picture_pool_t *, int *used, int *used_max, int *free_min);
+
 
 #endif /* VLC_PICTURE_POOL_H */
 
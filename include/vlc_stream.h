@@ -111,15 +111,30 @@ enum stream_query_e
 
     /* XXX only data read through stream_Read/Block will be recorded */
     STREAM_SET_RECORD_STATE,     /**< arg1=bool, arg2=const char *psz_ext (if arg1 is true)  res=can fail */
+
+    /* Hint that the next bytes will be read soon, so that the background
+     * read-ahead (if any) can buffer them */
+    STREAM_SET_PREFETCH_HINT,    /**< arg1= uint64_t       res=can fail */
 };
 
+/**
+ * Read-only view over a part of the stream data, see stream_PeekVec()
+ */
+typedef struct
+{
+    const uint8_t *p_base;
+    size_t         i_len;
+} stream_iovec_t;
+
 VLC_API int stream_Read( stream_t *s, void *p_read, int i_read );
 VLC_API int stream_Peek( stream_t *s, const uint8_t **pp_peek, int i_peek );
+VLC_API int stream_PeekVec( stream_t *s, stream_iovec_t *p_vec, int *pi_vec, int i_peek );
 VLC_API int stream_vaControl( stream_t *s, int i_query, va_list args );
 VLC_API void stream_Delete( stream_t *s );
 VLC_API int stream_Control( stream_t *s, int i_query, ... );
 VLC_API block_t * stream_Block( stream_t *s, int i_size );
 VLC_API block_t * stream_BlockRemaining( stream_t *s, int i_max_size );
+VLC_API block_t * stream_ReadBlock( stream_t *s, int i_max_size );
 VLC_API char * stream_ReadLine( stream_t * );
 
 /**
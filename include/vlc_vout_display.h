@@ -126,6 +126,7 @@ typedef struct {
     bool has_pictures_invalid;              /* Will VOUT_DISPLAY_EVENT_PICTURES_INVALID be used */
     bool has_event_thread;                  /* Will events (key at least) be emitted using an independent thread */
     const vlc_fourcc_t *subpicture_chromas; /* List of supported chromas for subpicture rendering. */
+    mtime_t refresh_period;                 /* Duration of a refresh of the display, 0 if unknown */
 } vout_display_info_t;
 
 /**
@@ -31,6 +31,7 @@
 
 #include <vlc_interface.h>
 #include <vlc_vlm.h>
+#include <vlc_memstat.h>
 
 #include <stdarg.h>
 #include <limits.h>
@@ -249,3 +250,44 @@ int64_t libvlc_clock(void)
 {
     return mdate();
 }
+
+unsigned libvlc_memory_stats_get( libvlc_instance_t *p_instance,
+                                  libvlc_memory_stats_t **pp_stats )
+{
+    vlc_mem_stats_t stats[VLC_MEM_ACCOUNTS];
+    unsigned i_count = vlc_mem_GetStats( stats );
+
+    VLC_UNUSED( p_instance );
+    *pp_stats = calloc( i_count, sizeof( **pp_stats ) );
+    if( *pp_stats == NULL )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return 0;
+    }
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        libvlc_memory_stats_t *p_stats = &(*pp_stats)[i];
+
+        p_stats->psz_name = strdup( stats[i].psz_name );
+        if( p_stats->psz_name == NULL )
+        {
+            libvlc_memory_stats_release( *pp_stats, i );
+            *pp_stats = NULL;
+            libvlc_printerr( "Not enough memory" );
+            return 0;
+        }
+        p_stats->i_live = stats[i].i_live;
+        p_stats->i_peak = stats[i].i_peak;
+        p_stats->i_allocs = stats[i].i_allocs;
+    }
+    return i_count;
+}
+
+void libvlc_memory_stats_release( libvlc_memory_stats_t *p_stats,
+                                  unsigned i_count )
+{
+    for( unsigned i = 0; i < i_count; i++ )
+        free( p_stats[i].psz_name );
+    free( p_stats );
+}
@@ -79,9 +79,15 @@ libvlc_event_manager_new( void * p_obj, libvlc_instance_t * p_libvlc_inst )
         return NULL;
     }
 
-    p_em->p_obj = p_obj;
     p_em->p_obj = p_obj;
     p_em->async_event_queue = NULL;
+    atomic_init( &p_em->stats.sent, 0 );
+    atomic_init( &p_em->stats.queued, 0 );
+    atomic_init( &p_em->stats.delivered, 0 );
+    atomic_init( &p_em->stats.coalesced, 0 );
+    atomic_init( &p_em->stats.dropped, 0 );
+    atomic_init( &p_em->stats.waits, 0 );
+    atomic_init( &p_em->stats.max_pending, 0 );
     p_em->p_libvlc_instance = p_libvlc_inst;
 
     libvlc_retain( p_libvlc_inst );
@@ -151,53 +157,61 @@ void libvlc_event_send( libvlc_event_manager_t * p_em,
     libvlc_event_listeners_group_t * listeners_group = NULL;
     libvlc_event_listener_t * listener_cached;
     libvlc_event_listener_t * listener;
+    /* Most events have a handful of listeners: spare the allocation */
+    libvlc_event_listener_t stack_listeners_cached[8];
     libvlc_event_listener_t * array_listeners_cached = NULL;
     int i, i_cached_listeners = 0;
 
     /* Fill event with the sending object now */
     p_event->p_obj = p_em->p_obj;
+    atomic_fetch_add_explicit( &p_em->stats.sent, 1, memory_order_relaxed );
 
     vlc_mutex_lock( &p_em->event_sending_lock );
     vlc_mutex_lock( &p_em->object_lock );
     for( i = 0; i < vlc_array_count(&p_em->listeners_groups); i++)
     {
-        listeners_group = vlc_array_item_at_index(&p_em->listeners_groups, i);
-        if( listeners_group->event_type == p_event->type )
+        libvlc_event_listeners_group_t * group =
+            vlc_array_item_at_index(&p_em->listeners_groups, i);
+        if( group->event_type == p_event->type )
         {
-            if( vlc_array_count( &listeners_group->listeners ) <= 0 )
-                break;
-
-            /* Cache a copy of the listener to avoid locking issues,
-             * and allow that edition of listeners during callbacks will garantee immediate effect. */
-            i_cached_listeners = vlc_array_count(&listeners_group->listeners);
-            array_listeners_cached = malloc(sizeof(libvlc_event_listener_t)*(i_cached_listeners));
-            if( !array_listeners_cached )
-            {
-                vlc_mutex_unlock( &p_em->object_lock );
-                vlc_mutex_unlock( &p_em->event_sending_lock );
-                fprintf(stderr, "Can't alloc memory in libvlc_event_send" );
-                return;
-            }
-
-            listener_cached = array_listeners_cached;
-            for( i = 0; i < vlc_array_count(&listeners_group->listeners); i++)
-            {
-                listener = vlc_array_item_at_index(&listeners_group->listeners, i);
-                memcpy( listener_cached, listener, sizeof(libvlc_event_listener_t) );
-                listener_cached++;
-            }
+            listeners_group = group;
             break;
         }
     }
 
-    if( !listeners_group )
+    if( listeners_group )
+        i_cached_listeners = vlc_array_count(&listeners_group->listeners);
+    if( i_cached_listeners <= 0 )
     {
-        free( array_listeners_cached );
         vlc_mutex_unlock( &p_em->object_lock );
         vlc_mutex_unlock( &p_em->event_sending_lock );
         return;
     }
 
+    /* Cache a copy of the listener to avoid locking issues,
+     * and allow that edition of listeners during callbacks will garantee immediate effect. */
+    if( i_cached_listeners <= (int)ARRAY_SIZE(stack_listeners_cached) )
+        array_listeners_cached = stack_listeners_cached;
+    else
+    {
+        array_listeners_cached = malloc(sizeof(libvlc_event_listener_t)*(i_cached_listeners));
+        if( !array_listeners_cached )
+        {
+            vlc_mutex_unlock( &p_em->object_lock );
+            vlc_mutex_unlock( &p_em->event_sending_lock );
+            fprintf(stderr, "Can't alloc memory in libvlc_event_send" );
+            return;
+        }
+    }
+
+    listener_cached = array_listeners_cached;
+    for( i = 0; i < i_cached_listeners; i++)
+    {
+        listener = vlc_array_item_at_index(&listeners_group->listeners, i);
+        memcpy( listener_cached, listener, sizeof(libvlc_event_listener_t) );
+        listener_cached++;
+    }
+
     /* Track item removed from *this* thread, with a simple flag. Indeed
      * event_sending_lock is a recursive lock. This has the advantage of
      * allowing to remove an event listener from within a callback */
@@ -212,6 +226,7 @@ void libvlc_event_send( libvlc_event_manager_t * p_em,
         {
             /* The listener wants not to block the emitter during event callback */
             libvlc_event_async_dispatch(p_em, listener_cached, p_event);
+            listener_cached++;
         }
         else
         {
@@ -237,7 +252,34 @@ void libvlc_event_send( libvlc_event_manager_t * p_em,
     }
     vlc_mutex_unlock( &p_em->event_sending_lock );
 
-    free( array_listeners_cached );
+    if( array_listeners_cached != stack_listeners_cached )
+        free( array_listeners_cached );
+}
+
+/**************************************************************************
+ *       libvlc_event_has_listeners (internal) :
+ *
+ * Tells whether sending an event type would call anyone, so that the
+ * sender can skip building events nobody listens to.
+ **************************************************************************/
+bool libvlc_event_has_listeners( libvlc_event_manager_t * p_em,
+                                 libvlc_event_type_t event_type )
+{
+    bool has_listeners = false;
+
+    vlc_mutex_lock( &p_em->object_lock );
+    for( int i = 0; i < vlc_array_count(&p_em->listeners_groups); i++)
+    {
+        libvlc_event_listeners_group_t * listeners_group =
+            vlc_array_item_at_index(&p_em->listeners_groups, i);
+        if( listeners_group->event_type == event_type )
+        {
+            has_listeners = vlc_array_count( &listeners_group->listeners ) > 0;
+            break;
+        }
+    }
+    vlc_mutex_unlock( &p_em->object_lock );
+    return has_listeners;
 }
 
 /*
@@ -284,6 +326,8 @@ static const event_name_t event_list[] = {
     DEF(MediaListWillAddItem)
     DEF(MediaListItemDeleted)
     DEF(MediaListWillDeleteItem)
+    DEF(MediaListItemsAdded)
+    DEF(MediaListItemsDeleted)
 
     DEF(MediaListViewItemAdded)
     DEF(MediaListViewWillAddItem)
@@ -328,6 +372,30 @@ const char * libvlc_event_type_name( int event_type )
     return p ? p->name : unknown_event_name;
 }
 
+/**************************************************************************
+ *       libvlc_event_manager_get_stats (public) :
+ *
+ * Get the event dispatch statistics.
+ **************************************************************************/
+void libvlc_event_manager_get_stats( libvlc_event_manager_t * p_em,
+                                     libvlc_event_stats_t * p_stats )
+{
+    p_stats->i_sent = atomic_load_explicit( &p_em->stats.sent,
+                                            memory_order_relaxed );
+    p_stats->i_queued = atomic_load_explicit( &p_em->stats.queued,
+                                              memory_order_relaxed );
+    p_stats->i_delivered = atomic_load_explicit( &p_em->stats.delivered,
+                                                 memory_order_relaxed );
+    p_stats->i_coalesced = atomic_load_explicit( &p_em->stats.coalesced,
+                                                 memory_order_relaxed );
+    p_stats->i_dropped = atomic_load_explicit( &p_em->stats.dropped,
+                                               memory_order_relaxed );
+    p_stats->i_waits = atomic_load_explicit( &p_em->stats.waits,
+                                             memory_order_relaxed );
+    p_stats->i_max_pending = atomic_load_explicit( &p_em->stats.max_pending,
+                                                   memory_order_relaxed );
+}
+
 /**************************************************************************
  *       event_attach (internal) :
  *
@@ -33,19 +33,45 @@
 #include "libvlc_internal.h"
 #include "event_internal.h"
 
-struct queue_elmt {
+/*
+ * The queue is a bounded ring of preallocated slots. The emitting threads
+ * reserve a slot by advancing the write index, fill it, then publish it by
+ * storing its sequence number. No lock is taken on this path. A single
+ * thread per event manager delivers the slots in order.
+ *
+ * An event that only carries the latest value of something, such as a
+ * position, is dropped if a later one for the same listener is already
+ * queued: the listener would skip it anyway.
+ */
+#define EVENT_QUEUE_SIZE      256
+#define EVENT_COALESCE_WINDOW  64 /* Queued events looked ahead at most */
+
+struct queue_slot {
+    atomic_uint seq; /* index + 1 when published, index + SIZE when free */
     libvlc_event_listener_t listener;
     libvlc_event_t event;
-    struct queue_elmt * next;
+};
+
+struct queue_cancel {
+    libvlc_event_listener_t listener;
+    unsigned until; /* Write index when the listener was removed */
 };
 
 struct libvlc_event_async_queue {
-    struct queue_elmt *first_elmt, *last_elmt;
+    struct queue_slot slots[EVENT_QUEUE_SIZE];
+    atomic_uint write; /* Next slot to reserve */
+    atomic_uint done; /* Next slot to deliver */
+    unsigned read; /* Same as done, owned by the thread */
+    vlc_sem_t ready; /* Posted once per published event */
+
+    /* Emitters waiting for room, and listener removals */
     vlc_mutex_t lock;
     vlc_cond_t signal;
+    atomic_uint waiters;
+    atomic_uint cancels_count;
+    struct queue_cancel *cancels;
+
     vlc_thread_t thread;
-    bool is_idle;
-    vlc_cond_t signal_idle;
     vlc_threadvar_t is_asynch_dispatch_thread_var;
 };
 
@@ -71,73 +97,113 @@ static inline bool current_thread_is_asynch_thread(libvlc_event_manager_t * p_em
             != NULL;
 }
 
-/* Lock must be held */
-static void push(libvlc_event_manager_t * p_em,
-                 libvlc_event_listener_t * listener, libvlc_event_t * event)
+/* Events superseded by any later event of the same type */
+static bool is_coalescable(libvlc_event_type_t type)
 {
-    struct queue_elmt * elmt = malloc(sizeof(struct queue_elmt));
-    elmt->listener = *listener;
-    elmt->event = *event;
-    elmt->next = NULL;
-
-    /* Append to the end of the queue */
-    if(!queue(p_em)->first_elmt)
-        queue(p_em)->first_elmt = elmt;
-    else
-        queue(p_em)->last_elmt->next = elmt;
-    queue(p_em)->last_elmt = elmt;
+    switch (type)
+    {
+        case libvlc_MediaDurationChanged:
+        case libvlc_MediaPlayerBuffering:
+        case libvlc_MediaPlayerTimeChanged:
+        case libvlc_MediaPlayerPositionChanged:
+        case libvlc_MediaPlayerSeekableChanged:
+        case libvlc_MediaPlayerPausableChanged:
+        case libvlc_MediaPlayerLengthChanged:
+            return true;
+        default:
+            return false;
+    }
 }
 
-static inline void queue_lock(libvlc_event_manager_t * p_em)
+static void stats_max(atomic_uint * max, unsigned val)
 {
-    vlc_mutex_lock(&queue(p_em)->lock);
+    unsigned cur = atomic_load_explicit(max, memory_order_relaxed);
+
+    while (val > cur && !atomic_compare_exchange_weak(max, &cur, val));
 }
 
-static inline void queue_unlock(libvlc_event_manager_t * p_em)
+/* Lock-free. Returns false if the queue is full */
+static bool push(libvlc_event_manager_t * p_em,
+                 libvlc_event_listener_t * listener, libvlc_event_t * event)
 {
-    vlc_mutex_unlock(&queue(p_em)->lock);
+    struct libvlc_event_async_queue * q = queue(p_em);
+    unsigned pos = atomic_load(&q->write);
+    struct queue_slot * slot;
+
+    for (;;)
+    {
+        slot = &q->slots[pos % EVENT_QUEUE_SIZE];
+
+        int diff = (int)(atomic_load(&slot->seq) - pos);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak(&q->write, &pos, pos + 1))
+                break;
+        }
+        else if (diff < 0)
+            return false; /* Not delivered yet since the last round */
+        else
+            pos = atomic_load(&q->write);
+    }
+
+    slot->listener = *listener;
+    slot->event = *event;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    vlc_sem_post(&q->ready);
+
+    stats_max(&p_em->stats.max_pending,
+              pos + 1 - atomic_load_explicit(&q->done, memory_order_relaxed));
+    return true;
 }
 
-/* Lock must be held */
-static bool pop(libvlc_event_manager_t * p_em,
-                libvlc_event_listener_t * listener, libvlc_event_t * event)
+/* Whether the event in the slot at index is superseded by a queued one */
+static bool is_superseded(struct libvlc_event_async_queue * q, unsigned index)
 {
-    if(!queue(p_em)->first_elmt)
-        return false; /* No first_elmt */
+    struct queue_slot * slot = &q->slots[index % EVENT_QUEUE_SIZE];
 
-    struct queue_elmt * elmt = queue(p_em)->first_elmt;
-    *listener = elmt->listener;
-    *event = elmt->event;
+    if (!is_coalescable(slot->event.type))
+        return false;
 
-    queue(p_em)->first_elmt = elmt->next;
-    if( !elmt->next ) queue(p_em)->last_elmt=NULL;
+    for (unsigned i = index + 1; i != index + 1 + EVENT_COALESCE_WINDOW; i++)
+    {
+        struct queue_slot * next = &q->slots[i % EVENT_QUEUE_SIZE];
 
-    free(elmt);
-    return true;
+        if (atomic_load_explicit(&next->seq, memory_order_acquire) != i + 1)
+            break; /* Not published */
+        if (next->event.type == slot->event.type
+         && listeners_are_equal(&next->listener, &slot->listener))
+            return true;
+    }
+    return false;
 }
 
-/* Lock must be held */
-static void pop_listener(libvlc_event_manager_t * p_em, libvlc_event_listener_t * listener)
+/* Whether the listener of the event at index was removed in the mean time.
+ * Forgets the removals the thread went past. */
+static bool is_cancelled(struct libvlc_event_async_queue * q, unsigned index)
 {
-    struct queue_elmt * iter = queue(p_em)->first_elmt;
-    struct queue_elmt * prev = NULL;
-    while (iter) {
-        if(listeners_are_equal(&iter->listener, listener))
-        {
-            struct queue_elmt * to_delete = iter;
-            if(!prev)
-                queue(p_em)->first_elmt = to_delete->next;
-            else
-                prev->next = to_delete->next;
-            iter = to_delete->next;
-            free(to_delete);
-        }
-        else {
-            prev = iter;
-            iter = iter->next;
+    struct queue_slot * slot = &q->slots[index % EVENT_QUEUE_SIZE];
+    bool cancelled = false;
+
+    if (atomic_load(&q->cancels_count) == 0)
+        return false;
+
+    vlc_mutex_lock(&q->lock);
+    unsigned count = atomic_load(&q->cancels_count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        struct queue_cancel * cancel = &q->cancels[i];
+
+        if ((int)(cancel->until - index) <= 0)
+        {   /* All its events were delivered or skipped */
+            q->cancels[i--] = q->cancels[--count];
+            continue;
         }
+        if (listeners_are_equal(&cancel->listener, &slot->listener))
+            cancelled = true;
     }
-    queue(p_em)->last_elmt=prev;
+    atomic_store(&q->cancels_count, count);
+    vlc_mutex_unlock(&q->lock);
+    return cancelled;
 }
 
 /**************************************************************************
@@ -156,25 +222,15 @@ libvlc_event_async_fini(libvlc_event_manager_t * p_em)
         abort();
     }
 
-    vlc_thread_t thread = queue(p_em)->thread;
-    if(thread)
-    {
-        vlc_cancel(thread);
-        vlc_join(thread, NULL);
-    }
+    vlc_cancel(queue(p_em)->thread);
+    vlc_join(queue(p_em)->thread, NULL);
 
+    vlc_sem_destroy(&queue(p_em)->ready);
     vlc_mutex_destroy(&queue(p_em)->lock);
     vlc_cond_destroy(&queue(p_em)->signal);
-    vlc_cond_destroy(&queue(p_em)->signal_idle);
     vlc_threadvar_delete(&queue(p_em)->is_asynch_dispatch_thread_var);
 
-    struct queue_elmt * iter = queue(p_em)->first_elmt;
-    while (iter) {
-        struct queue_elmt * elemt_to_delete = iter;
-        iter = iter->next;
-        free(elemt_to_delete);
-    }
-
+    free(queue(p_em)->cancels);
     free(queue(p_em));
 }
 
@@ -186,23 +242,36 @@ libvlc_event_async_fini(libvlc_event_manager_t * p_em)
 static void
 libvlc_event_async_init(libvlc_event_manager_t * p_em)
 {
-    p_em->async_event_queue = calloc(1, sizeof(struct libvlc_event_async_queue));
+    struct libvlc_event_async_queue * q = malloc(sizeof(*q));
+    if (unlikely(q == NULL))
+        return;
 
-    int error = vlc_threadvar_create(&queue(p_em)->is_asynch_dispatch_thread_var, NULL);
+    for (unsigned i = 0; i < EVENT_QUEUE_SIZE; i++)
+        atomic_init(&q->slots[i].seq, i);
+    atomic_init(&q->write, 0);
+    atomic_init(&q->done, 0);
+    q->read = 0;
+    vlc_sem_init(&q->ready, 0);
+    vlc_mutex_init(&q->lock);
+    vlc_cond_init(&q->signal);
+    atomic_init(&q->waiters, 0);
+    atomic_init(&q->cancels_count, 0);
+    q->cancels = NULL;
+
+    int error = vlc_threadvar_create(&q->is_asynch_dispatch_thread_var, NULL);
     assert(!error);
 
-    vlc_mutex_init(&queue(p_em)->lock);
-    vlc_cond_init(&queue(p_em)->signal);
-    vlc_cond_init(&queue(p_em)->signal_idle);
-
-    error = vlc_clone (&queue(p_em)->thread, event_async_loop, p_em, VLC_THREAD_PRIORITY_LOW);
+    p_em->async_event_queue = q;
+    error = vlc_clone (&q->thread, event_async_loop, p_em, VLC_THREAD_PRIORITY_LOW);
     if(error)
     {
-        free(p_em->async_event_queue);
+        vlc_threadvar_delete(&q->is_asynch_dispatch_thread_var);
+        vlc_cond_destroy(&q->signal);
+        vlc_mutex_destroy(&q->lock);
+        vlc_sem_destroy(&q->ready);
+        free(q);
         p_em->async_event_queue = NULL;
-        return;
     }
-
 }
 
 /**************************************************************************
@@ -215,16 +284,34 @@ libvlc_event_async_ensure_listener_removal(libvlc_event_manager_t * p_em, libvlc
 {
     if(!is_queue_initialized(p_em)) return;
 
-    queue_lock(p_em);
-    pop_listener(p_em, listener);
+    struct libvlc_event_async_queue * q = queue(p_em);
+    /* The listener is out of its group: nothing more gets queued for it */
+    unsigned until = atomic_load(&q->write);
+
+    vlc_mutex_lock(&q->lock);
+    if ((int)(until - atomic_load(&q->done)) > 0)
+    {
+        unsigned count = atomic_load(&q->cancels_count);
+        struct queue_cancel * tab = realloc(q->cancels,
+                                            (count + 1) * sizeof(*tab));
+        if (likely(tab != NULL))
+        {
+            q->cancels = tab;
+            tab[count].listener = *listener;
+            tab[count].until = until;
+            atomic_store(&q->cancels_count, count + 1);
+        }
+    }
 
     // Wait for the asynch_loop to have processed all events.
     if(!current_thread_is_asynch_thread(p_em))
     {
-        while(!queue(p_em)->is_idle)
-            vlc_cond_wait(&queue(p_em)->signal_idle, &queue(p_em)->lock);
+        atomic_fetch_add(&q->waiters, 1);
+        while ((int)(until - atomic_load(&q->done)) > 0)
+            vlc_cond_wait(&q->signal, &q->lock);
+        atomic_fetch_sub(&q->waiters, 1);
     }
-    queue_unlock(p_em);
+    vlc_mutex_unlock(&q->lock);
 }
 
 /**************************************************************************
@@ -241,10 +328,33 @@ libvlc_event_async_dispatch(libvlc_event_manager_t * p_em, libvlc_event_listener
         libvlc_event_async_init(p_em);
     vlc_mutex_unlock(&p_em->object_lock);
 
-    queue_lock(p_em);
-    push(p_em, listener, event);
-    vlc_cond_signal(&queue(p_em)->signal);
-    queue_unlock(p_em);
+    struct libvlc_event_async_queue * q = queue(p_em);
+    if (unlikely(q == NULL))
+        return;
+
+    atomic_fetch_add_explicit(&p_em->stats.queued, 1, memory_order_relaxed);
+    if (likely(push(p_em, listener, event)))
+        return;
+
+    /* The queue is full. A superseded value is not worth waiting for,
+     * and the thread cannot wait for itself. */
+    if (is_coalescable(event->type) || current_thread_is_asynch_thread(p_em))
+    {
+        if (!is_coalescable(event->type))
+            fprintf(stderr, "libvlc: %s event dropped, queue full\n",
+                    libvlc_event_type_name(event->type));
+        atomic_fetch_add_explicit(&p_em->stats.dropped, 1,
+                                  memory_order_relaxed);
+        return;
+    }
+
+    atomic_fetch_add_explicit(&p_em->stats.waits, 1, memory_order_relaxed);
+    vlc_mutex_lock(&q->lock);
+    atomic_fetch_add(&q->waiters, 1);
+    while (!push(p_em, listener, event))
+        vlc_cond_wait(&q->signal, &q->lock);
+    atomic_fetch_sub(&q->waiters, 1);
+    vlc_mutex_unlock(&q->lock);
 }
 
 /**************************************************************************
@@ -255,33 +365,52 @@ libvlc_event_async_dispatch(libvlc_event_manager_t * p_em, libvlc_event_listener
 static void * event_async_loop(void * arg)
 {
     libvlc_event_manager_t * p_em = arg;
-    libvlc_event_listener_t listener;
-    libvlc_event_t event;
+    struct libvlc_event_async_queue * q = queue(p_em);
+    unsigned posted = 0;
 
-    vlc_threadvar_set(queue(p_em)->is_asynch_dispatch_thread_var, p_em);
+    vlc_threadvar_set(q->is_asynch_dispatch_thread_var, p_em);
 
-    queue_lock(p_em);
-    while (true) {
-        int has_listener = pop(p_em, &listener, &event);
+    for (;;)
+    {
+        vlc_sem_wait(&q->ready);
+        posted++;
 
-        if (has_listener)
+        int canc = vlc_savecancel();
+        while (posted > 0)
         {
-            queue_unlock(p_em);
-            listener.pf_callback(&event, listener.p_user_data); // This might edit the queue
-            queue_lock(p_em);
-        }
-        else
-        {
-            queue(p_em)->is_idle = true;
-
-            mutex_cleanup_push(&queue(p_em)->lock);
-            vlc_cond_broadcast(&queue(p_em)->signal_idle); // We'll be idle
-            vlc_cond_wait(&queue(p_em)->signal, &queue(p_em)->lock);
-            vlc_cleanup_pop();
-
-            queue(p_em)->is_idle = false;
+            unsigned index = q->read;
+            struct queue_slot * slot = &q->slots[index % EVENT_QUEUE_SIZE];
+
+            if (atomic_load_explicit(&slot->seq, memory_order_acquire)
+                    != index + 1)
+                break; /* A later slot was published first: wait for it */
+
+            if (is_superseded(q, index))
+                atomic_fetch_add_explicit(&p_em->stats.coalesced, 1,
+                                          memory_order_relaxed);
+            else if (!is_cancelled(q, index))
+            {
+                slot->listener.pf_callback(&slot->event,
+                                           slot->listener.p_user_data);
+                atomic_fetch_add_explicit(&p_em->stats.delivered, 1,
+                                          memory_order_relaxed);
+            }
+
+            /* Release the slot for the next round, then wake the waiters
+             * (the order matters, see libvlc_event_async_dispatch) */
+            atomic_store(&slot->seq, index + EVENT_QUEUE_SIZE);
+            q->read = index + 1;
+            atomic_store(&q->done, index + 1);
+            posted--;
+
+            if (atomic_load(&q->waiters) > 0)
+            {
+                vlc_mutex_lock(&q->lock);
+                vlc_cond_broadcast(&q->signal);
+                vlc_mutex_unlock(&q->lock);
+            }
         }
+        vlc_restorecancel(canc);
     }
-    queue_unlock(p_em);
     return NULL;
 }
@@ -34,6 +34,7 @@
 #include <vlc/libvlc_events.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 
 
 /*
@@ -92,6 +93,16 @@ typedef struct libvlc_event_manager_t
     vlc_mutex_t object_lock;
     vlc_mutex_t event_sending_lock;
     struct libvlc_event_async_queue * async_event_queue;
+    struct
+    {
+        atomic_uint_least64_t sent;
+        atomic_uint_least64_t queued;
+        atomic_uint_least64_t delivered;
+        atomic_uint_least64_t coalesced;
+        atomic_uint_least64_t dropped;
+        atomic_uint_least64_t waits;
+        atomic_uint max_pending;
+    } stats;
 } libvlc_event_sender_t;
 
 
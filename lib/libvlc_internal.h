@@ -105,6 +105,10 @@ void libvlc_event_send(
         libvlc_event_manager_t * p_em,
         libvlc_event_t * p_event );
 
+bool libvlc_event_has_listeners(
+        libvlc_event_manager_t * p_em,
+        libvlc_event_type_t event_type );
+
 void libvlc_event_attach_async( libvlc_event_manager_t * p_event_manager,
                                libvlc_event_type_t event_type,
                                libvlc_callback_t pf_callback,
@@ -37,6 +37,7 @@
 #include <vlc_meta.h>
 #include <vlc_playlist.h> /* For the preparser */
 #include <vlc_url.h>
+#include <vlc_image.h>
 
 #include "../src/libvlc.h"
 
@@ -639,6 +640,46 @@ libvlc_media_parse_async(libvlc_media_t *media)
         media_parse(media);
 }
 
+/**************************************************************************
+ * Decode a picture without playing the media.
+ **************************************************************************/
+int
+libvlc_media_get_thumbnail(libvlc_media_t *media, libvlc_time_t time,
+                           const char *format, unsigned width, unsigned height,
+                           unsigned char **data, size_t *size)
+{
+    vlc_fourcc_t codec = image_Type2Fourcc(format);
+    if (codec == 0)
+    {
+        libvlc_printerr("Unknown image format: %s", format);
+        return -1;
+    }
+
+    /* Like snapshots, 0 keeps the aspect ratio, and both keep the size */
+    int w = width ? (int)width : (height ? 0 : -1);
+    int h = height ? (int)height : (width ? 0 : -1);
+
+    block_t *image;
+    if (input_Thumbnail(media->p_libvlc_instance->p_libvlc_int,
+                        media->p_input_item, time * 1000,
+                        10 * CLOCK_FREQ, &image, codec, w, h))
+    {
+        libvlc_printerr("Cannot get a picture of the media");
+        return -1;
+    }
+
+    *data = malloc(image->i_buffer);
+    if (*data == NULL)
+    {
+        block_Release(image);
+        return -1;
+    }
+    memcpy(*data, image->p_buffer, image->i_buffer);
+    *size = image->i_buffer;
+    block_Release(image);
+    return 0;
+}
+
 /**************************************************************************
  * Get parsed status for media object.
  **************************************************************************/
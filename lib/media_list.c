@@ -90,6 +90,39 @@ notify_item_addition( libvlc_media_list_t * p_mlist,
     libvlc_event_send( p_mlist->p_event_manager, &event );
 }
 
+/**************************************************************************
+ *       notify_items_addition (private)
+ *
+ * Sends the item events of a batch, then one event for the whole range
+ * once added. Each event costs a lock and a copy of the listeners, so the
+ * item events are not built for a batch nobody listens to.
+ **************************************************************************/
+static void
+notify_items_addition( libvlc_media_list_t * p_mlist,
+                       libvlc_media_t * const * pp_md,
+                       int index, int i_count,
+                       EventPlaceInTime event_status )
+{
+    libvlc_event_type_t type = ( event_status == EventDidHappen ) ?
+        libvlc_MediaListItemAdded : libvlc_MediaListWillAddItem;
+
+    if( i_count == 1
+     || libvlc_event_has_listeners( p_mlist->p_event_manager, type ) )
+        for( int i = 0; i < i_count; i++ )
+            notify_item_addition( p_mlist, pp_md[i], index + i,
+                                  event_status );
+
+    if( event_status == EventDidHappen )
+    {
+        libvlc_event_t event;
+
+        event.type = libvlc_MediaListItemsAdded;
+        event.u.media_list_items_added.index = index;
+        event.u.media_list_items_added.count = i_count;
+        libvlc_event_send( p_mlist->p_event_manager, &event );
+    }
+}
+
 /**************************************************************************
  *       notify_item_deletion (private)
  *
@@ -122,6 +155,142 @@ notify_item_deletion( libvlc_media_list_t * p_mlist,
     libvlc_event_send( p_mlist->p_event_manager, &event );
 }
 
+/**************************************************************************
+ *       notify_items_deletion (private)
+ *
+ * Same as notify_items_addition(). The deleted item events go backward,
+ * so that each index was valid when its item was removed.
+ **************************************************************************/
+static void
+notify_items_deletion( libvlc_media_list_t * p_mlist,
+                       libvlc_media_t * const * pp_md,
+                       int index, int i_count,
+                       EventPlaceInTime event_status )
+{
+    libvlc_event_type_t type = ( event_status == EventDidHappen ) ?
+        libvlc_MediaListItemDeleted : libvlc_MediaListWillDeleteItem;
+
+    if( i_count == 1
+     || libvlc_event_has_listeners( p_mlist->p_event_manager, type ) )
+    {
+        if( event_status == EventDidHappen )
+            for( int i = i_count - 1; i >= 0; i-- )
+                notify_item_deletion( p_mlist, pp_md[i], index + i,
+                                      event_status );
+        else
+            for( int i = 0; i < i_count; i++ )
+                notify_item_deletion( p_mlist, pp_md[i], index + i,
+                                      event_status );
+    }
+
+    if( event_status == EventDidHappen )
+    {
+        libvlc_event_t event;
+
+        event.type = libvlc_MediaListItemsDeleted;
+        event.u.media_list_items_deleted.index = index;
+        event.u.media_list_items_deleted.count = i_count;
+        libvlc_event_send( p_mlist->p_event_manager, &event );
+    }
+}
+
+/**************************************************************************
+ *       index_* (private)
+ *
+ * p_index maps each media to its first position with linear probing.
+ * Appending keeps it up to date. Any other change moves items: it only
+ * marks the index stale, and the next lookup rebuilds it.
+ **************************************************************************/
+static inline unsigned index_hash( const libvlc_media_t * p_md,
+                                   unsigned i_mask )
+{
+    uintptr_t h = (uintptr_t)p_md >> 4;
+
+    h ^= h >> 16;
+    return ( (uint32_t)h * UINT32_C(0x9E3779B1) ) & i_mask;
+}
+
+static void index_add( libvlc_media_list_t * p_mlist,
+                       libvlc_media_t * p_md, int i_pos )
+{
+    unsigned i_mask = p_mlist->i_index_size - 1;
+
+    for( unsigned i = index_hash( p_md, i_mask ); ; i = ( i + 1 ) & i_mask )
+    {
+        media_list_index_t *p_entry = &p_mlist->p_index[i];
+
+        if( p_entry->p_md == p_md )
+            return; /* Keep the first position */
+        if( p_entry->p_md == NULL )
+        {
+            p_entry->p_md = p_md;
+            p_entry->i_pos = i_pos;
+            p_mlist->i_index_count++;
+            return;
+        }
+    }
+}
+
+/* Rebuilds the index from the items, with room for i_room medias */
+static bool index_rebuild( libvlc_media_list_t * p_mlist, int i_room )
+{
+    unsigned i_size = 16;
+    while( i_size < 2 * (unsigned)i_room )
+        i_size *= 2;
+
+    media_list_index_t *p_index = calloc( i_size, sizeof( *p_index ) );
+    if( unlikely(p_index == NULL) )
+    {
+        p_mlist->b_index_stale = true;
+        return false;
+    }
+    free( p_mlist->p_index );
+    p_mlist->p_index = p_index;
+    p_mlist->i_index_size = i_size;
+    p_mlist->i_index_count = 0;
+    p_mlist->b_index_stale = false;
+
+    for( int i = 0; i < vlc_array_count( &p_mlist->items ); i++ )
+        index_add( p_mlist, vlc_array_item_at_index( &p_mlist->items, i ), i );
+    return true;
+}
+
+/* Records an item appended at i_pos (the last position) */
+static void index_append( libvlc_media_list_t * p_mlist,
+                          libvlc_media_t * p_md, int i_pos )
+{
+    if( p_mlist->b_index_stale )
+        return;
+    if( 2 * ( p_mlist->i_index_count + 1 ) > p_mlist->i_index_size )
+        index_rebuild( p_mlist, 2 * vlc_array_count( &p_mlist->items ) );
+    else
+        index_add( p_mlist, p_md, i_pos );
+}
+
+static int index_find( libvlc_media_list_t * p_mlist,
+                       const libvlc_media_t * p_md )
+{
+    if( p_mlist->b_index_stale
+     && !index_rebuild( p_mlist, vlc_array_count( &p_mlist->items ) ) )
+    {
+        for( int i = 0; i < vlc_array_count( &p_mlist->items ); i++ )
+            if( vlc_array_item_at_index( &p_mlist->items, i ) == p_md )
+                return i;
+        return -1;
+    }
+
+    unsigned i_mask = p_mlist->i_index_size - 1;
+    for( unsigned i = index_hash( p_md, i_mask ); ; i = ( i + 1 ) & i_mask )
+    {
+        const media_list_index_t *p_entry = &p_mlist->p_index[i];
+
+        if( p_entry->p_md == p_md )
+            return p_entry->i_pos;
+        if( p_entry->p_md == NULL )
+            return -1;
+    }
+}
+
 /**************************************************************************
  *       static mlist_is_writable (private)
  **************************************************************************/
@@ -176,12 +345,20 @@ libvlc_media_list_new( libvlc_instance_t * p_inst )
             libvlc_MediaListItemDeleted );
     libvlc_event_manager_register_event_type( p_mlist->p_event_manager,
             libvlc_MediaListWillDeleteItem );
+    libvlc_event_manager_register_event_type( p_mlist->p_event_manager,
+            libvlc_MediaListItemsAdded );
+    libvlc_event_manager_register_event_type( p_mlist->p_event_manager,
+            libvlc_MediaListItemsDeleted );
 
     vlc_mutex_init( &p_mlist->object_lock );
     vlc_mutex_init( &p_mlist->refcount_lock ); // FIXME: spinlock?
 
     vlc_array_init( &p_mlist->items );
     assert( p_mlist->items.i_count == 0 );
+    p_mlist->p_index = NULL;
+    p_mlist->i_index_size = 0;
+    p_mlist->i_index_count = 0;
+    p_mlist->b_index_stale = true;
     p_mlist->i_refcount = 1;
     p_mlist->p_md = NULL;
 
@@ -221,6 +398,7 @@ void libvlc_media_list_release( libvlc_media_list_t * p_mlist )
 
     vlc_mutex_destroy( &p_mlist->object_lock );
     vlc_array_clear( &p_mlist->items );
+    free( p_mlist->p_index );
 
     free( p_mlist );
 }
@@ -341,13 +519,23 @@ int libvlc_media_list_add_media( libvlc_media_list_t * p_mlist,
 void _libvlc_media_list_add_media( libvlc_media_list_t * p_mlist,
                                    libvlc_media_t * p_md )
 {
-    libvlc_media_retain( p_md );
+    _libvlc_media_list_insert_medias( p_mlist, &p_md, 1,
+                                      vlc_array_count( &p_mlist->items ) );
+}
 
-    notify_item_addition( p_mlist, p_md, vlc_array_count( &p_mlist->items ),
-                          EventWillHappen );
-    vlc_array_append( &p_mlist->items, p_md );
-    notify_item_addition( p_mlist, p_md, vlc_array_count( &p_mlist->items )-1,
-                          EventDidHappen );
+/**************************************************************************
+ *       libvlc_media_list_add_medias (Public)
+ *
+ * Lock should be held when entering.
+ **************************************************************************/
+int libvlc_media_list_add_medias( libvlc_media_list_t * p_mlist,
+                                  libvlc_media_t * const * pp_md,
+                                  int i_count )
+{
+    if( !mlist_is_writable(p_mlist) )
+        return -1;
+    return libvlc_media_list_insert_medias( p_mlist, pp_md, i_count,
+                                    vlc_array_count( &p_mlist->items ) );
 }
 
 /**************************************************************************
@@ -371,11 +559,63 @@ void _libvlc_media_list_insert_media(
                                    libvlc_media_t * p_md,
                                    int index )
 {
-    libvlc_media_retain( p_md );
+    _libvlc_media_list_insert_medias( p_mlist, &p_md, 1, index );
+}
+
+/**************************************************************************
+ *       libvlc_media_list_insert_medias (Public)
+ *
+ * Lock should be held when entering.
+ **************************************************************************/
+int libvlc_media_list_insert_medias( libvlc_media_list_t * p_mlist,
+                                     libvlc_media_t * const * pp_md,
+                                     int i_count, int index )
+{
+    if( !mlist_is_writable(p_mlist) )
+        return -1;
+    if( index < 0 || index > vlc_array_count( &p_mlist->items ) || i_count < 0 )
+    {
+        libvlc_printerr( "Index out of bounds" );
+        return -1;
+    }
+    _libvlc_media_list_insert_medias( p_mlist, pp_md, i_count, index );
+    return 0;
+}
+
+/* LibVLC internal version */
+void _libvlc_media_list_insert_medias( libvlc_media_list_t * p_mlist,
+                                       libvlc_media_t * const * pp_md,
+                                       int i_count, int index )
+{
+    vlc_array_t *p_items = &p_mlist->items;
+    int i_old = p_items->i_count;
+
+    assert( index >= 0 && index <= i_old );
+    if( i_count <= 0 )
+        return;
+
+    notify_items_addition( p_mlist, pp_md, index, i_count, EventWillHappen );
+
+    /* Grow and shift once, rather than once per media */
+    void **pp_elems = xrealloc( p_items->pp_elems,
+                                ( i_old + i_count ) * sizeof( void * ) );
+    memmove( pp_elems + index + i_count, pp_elems + index,
+             ( i_old - index ) * sizeof( void * ) );
+    for( int i = 0; i < i_count; i++ )
+    {
+        libvlc_media_retain( pp_md[i] );
+        pp_elems[index + i] = pp_md[i];
+    }
+    p_items->pp_elems = pp_elems;
+    p_items->i_count = i_old + i_count;
+
+    if( index == i_old )
+        for( int i = 0; i < i_count; i++ )
+            index_append( p_mlist, pp_md[i], index + i );
+    else
+        p_mlist->b_index_stale = true;
 
-    notify_item_addition( p_mlist, p_md, index, EventWillHappen );
-    vlc_array_insert( &p_mlist->items, p_md, index );
-    notify_item_addition( p_mlist, p_md, index, EventDidHappen );
+    notify_items_addition( p_mlist, pp_md, index, i_count, EventDidHappen );
 }
 
 /**************************************************************************
@@ -395,21 +635,50 @@ int libvlc_media_list_remove_index( libvlc_media_list_t * p_mlist,
 int _libvlc_media_list_remove_index( libvlc_media_list_t * p_mlist,
                                      int index )
 {
-    libvlc_media_t * p_md;
+    return _libvlc_media_list_remove_range( p_mlist, index, 1 );
+}
 
-    if( index < 0 || index >= vlc_array_count( &p_mlist->items ))
+/**************************************************************************
+ *       libvlc_media_list_remove_range (Public)
+ *
+ * Lock should be held when entering.
+ **************************************************************************/
+int libvlc_media_list_remove_range( libvlc_media_list_t * p_mlist,
+                                    int index, int i_count )
+{
+    if( !mlist_is_writable(p_mlist) )
+        return -1;
+    return _libvlc_media_list_remove_range( p_mlist, index, i_count );
+}
+
+/* LibVLC internal version */
+int _libvlc_media_list_remove_range( libvlc_media_list_t * p_mlist,
+                                     int index, int i_count )
+{
+    vlc_array_t *p_items = &p_mlist->items;
+
+    if( index < 0 || i_count < 0 || index > p_items->i_count - i_count )
     {
         libvlc_printerr( "Index out of bounds" );
         return -1;
     }
-
-    p_md = vlc_array_item_at_index( &p_mlist->items, index );
-
-    notify_item_deletion( p_mlist, p_md, index, EventWillHappen );
-    vlc_array_remove( &p_mlist->items, index );
-    notify_item_deletion( p_mlist, p_md, index, EventDidHappen );
-
-    libvlc_media_release( p_md );
+    if( i_count == 0 )
+        return 0;
+
+    /* Keep the medias for the events and release them last */
+    libvlc_media_t **pp_md = xmalloc( i_count * sizeof( *pp_md ) );
+    memcpy( pp_md, p_items->pp_elems + index, i_count * sizeof( *pp_md ) );
+
+    notify_items_deletion( p_mlist, pp_md, index, i_count, EventWillHappen );
+    memmove( p_items->pp_elems + index, p_items->pp_elems + index + i_count,
+             ( p_items->i_count - index - i_count ) * sizeof( void * ) );
+    p_items->i_count -= i_count;
+    p_mlist->b_index_stale = true;
+    notify_items_deletion( p_mlist, pp_md, index, i_count, EventDidHappen );
+
+    for( int i = 0; i < i_count; i++ )
+        libvlc_media_release( pp_md[i] );
+    free( pp_md );
     return 0;
 }
 
@@ -444,16 +713,10 @@ libvlc_media_list_item_at_index( libvlc_media_list_t * p_mlist,
 int libvlc_media_list_index_of_item( libvlc_media_list_t * p_mlist,
                                      libvlc_media_t * p_searched_md )
 {
-    libvlc_media_t * p_md;
-    int i;
-    for ( i = 0; i < vlc_array_count( &p_mlist->items ); i++ )
-    {
-        p_md = vlc_array_item_at_index( &p_mlist->items, i );
-        if( p_searched_md == p_md )
-            return i;
-    }
-    libvlc_printerr( "Media not found" );
-    return -1;
+    int i = index_find( p_mlist, p_searched_md );
+    if( i < 0 )
+        libvlc_printerr( "Media not found" );
+    return i;
 }
 
 /**************************************************************************
@@ -35,6 +35,12 @@
 
 #include <vlc_common.h>
 
+typedef struct
+{
+    libvlc_media_t * p_md;
+    int              i_pos; /* First position of p_md in the list */
+} media_list_index_t;
+
 struct libvlc_media_list_t
 {
     libvlc_event_manager_t *    p_event_manager;
@@ -46,6 +52,13 @@ struct libvlc_media_list_t
                                        * mlist comes, if any. */
     vlc_array_t                items;
 
+    /* Open addressing hash table of the items, rebuilt on demand once
+     * stale, as any change but an append moves items */
+    media_list_index_t *       p_index;
+    unsigned                   i_index_size; /* Power of two */
+    unsigned                   i_index_count;
+    bool                       b_index_stale;
+
     /* This indicates if this media list is read-only
      * from a user point of view */
     bool                  b_read_only;
@@ -60,7 +73,14 @@ void _libvlc_media_list_insert_media(
         libvlc_media_list_t * p_mlist,
         libvlc_media_t * p_md, int index );
 
+void _libvlc_media_list_insert_medias(
+        libvlc_media_list_t * p_mlist,
+        libvlc_media_t * const * pp_md, int i_count, int index );
+
 int _libvlc_media_list_remove_index(
         libvlc_media_list_t * p_mlist, int index );
 
+int _libvlc_media_list_remove_range(
+        libvlc_media_list_t * p_mlist, int index, int i_count );
+
 #endif
@@ -385,6 +385,7 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     var_Create (mp, "vmem-data", VLC_VAR_ADDRESS);
     var_Create (mp, "vmem-setup", VLC_VAR_ADDRESS);
     var_Create (mp, "vmem-cleanup", VLC_VAR_ADDRESS);
+    var_Create (mp, "vmem-pool", VLC_VAR_ADDRESS);
     var_Create (mp, "vmem-chroma", VLC_VAR_STRING | VLC_VAR_DOINHERIT);
     var_Create (mp, "vmem-width", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
     var_Create (mp, "vmem-height", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
@@ -820,6 +821,12 @@ void libvlc_video_set_format_callbacks( libvlc_media_player_t *mp,
     var_SetAddress( mp, "vmem-cleanup", cleanup );
 }
 
+void libvlc_video_set_pool_callback( libvlc_media_player_t *mp,
+                                     libvlc_video_pool_cb pool )
+{
+    var_SetAddress( mp, "vmem-pool", pool );
+}
+
 void libvlc_video_set_format( libvlc_media_player_t *mp, const char *chroma,
                               unsigned width, unsigned height, unsigned pitch )
 {
@@ -1206,6 +1213,35 @@ float libvlc_media_player_get_fps( libvlc_media_player_t *p_mi )
     return f_fps;
 }
 
+int libvlc_media_player_get_track_latency( libvlc_media_player_t *p_mi,
+                                           int i_track,
+                                           libvlc_track_latency_t *p_latency )
+{
+    input_thread_t *p_input_thread = libvlc_get_input_thread ( p_mi );
+    input_latency_t latency;
+    int i_ret;
+
+    if( !p_input_thread )
+        return -1;
+
+    i_ret = input_Control( p_input_thread, INPUT_GET_ES_LATENCY, i_track,
+                           &latency );
+    vlc_object_release( p_input_thread );
+    if( i_ret )
+        return -1;
+
+    assert( LIBVLC_LATENCY_STAGES == INPUT_LATENCY_STAGES &&
+            LIBVLC_LATENCY_BUCKETS == INPUT_LATENCY_BUCKETS );
+    for( unsigned i = 0; i < LIBVLC_LATENCY_STAGES; i++ )
+    {
+        for( unsigned j = 0; j < LIBVLC_LATENCY_BUCKETS; j++ )
+            p_latency->i_count[i][j] = latency.pi_count[i][j];
+        p_latency->i_total[i] = latency.pi_total[i];
+        p_latency->i_max[i] = latency.pi_max[i];
+    }
+    return 0;
+}
+
 int libvlc_media_player_will_play( libvlc_media_player_t *p_mi )
 {
     bool b_will_play;
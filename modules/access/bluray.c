@@ -129,6 +129,15 @@ struct  demux_sys_t
 
     /* Used to store bluray disc path */
     char                *psz_bd_path;
+
+    /* Read-ahead, without menus */
+    struct
+    {
+        vlc_thread_t    thread;
+        vlc_mutex_t     lock;   /* held by the thread while it reads */
+        block_fifo_t    *p_fifo; /* data and events, in reading order */
+        atomic_bool     b_error;
+    } reader;
 };
 
 struct subpicture_updater_sys_t
@@ -154,6 +163,10 @@ static int   onMouseEvent(vlc_object_t *p_vout, const char *psz_var,
 
 static void  blurayResetParser(demux_t *p_demux);
 
+static int   blurayReaderStart(demux_t *p_demux);
+static void  blurayReaderLock(demux_sys_t *p_sys);
+static void  blurayReaderUnlock(demux_sys_t *p_sys, bool b_flush);
+
 #define FROM_TICKS(a) (a*CLOCK_FREQ / INT64_C(90000))
 #define TO_TICKS(a)   (a*INT64_C(90000)/CLOCK_FREQ)
 #define CUR_LENGTH    p_sys->pp_title[p_demux->info.i_title]->i_length
@@ -360,6 +373,10 @@ static int blurayOpen( vlc_object_t *object )
         goto error;
     }
 
+    /* Menus need the reads to follow the user input */
+    if (!p_sys->b_menu && blurayReaderStart(p_demux) != VLC_SUCCESS)
+        msg_Warn(p_demux, "cannot read ahead");
+
     p_demux->pf_control = blurayControl;
     p_demux->pf_demux   = blurayDemux;
 
@@ -381,6 +398,13 @@ static void blurayClose( vlc_object_t *object )
     demux_t *p_demux = (demux_t*)object;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    if (p_sys->reader.p_fifo != NULL) {
+        vlc_cancel(p_sys->reader.thread);
+        vlc_join(p_sys->reader.thread, NULL);
+        block_FifoRelease(p_sys->reader.p_fifo);
+        vlc_mutex_destroy(&p_sys->reader.lock);
+    }
+
     /*
      * Close libbluray first.
      * This will close all the overlays before we release p_vout
@@ -1021,14 +1045,19 @@ static int blurayControl(demux_t *p_demux, int query, va_list args)
         case DEMUX_SET_TITLE:
         {
             int i_title = (int)va_arg( args, int );
-            if (bluraySetTitle(p_demux, i_title) != VLC_SUCCESS)
+            blurayReaderLock(p_sys);
+            int i_ret = bluraySetTitle(p_demux, i_title);
+            blurayReaderUnlock(p_sys, i_ret == VLC_SUCCESS);
+            if (i_ret != VLC_SUCCESS)
                 return VLC_EGENERIC;
             break;
         }
         case DEMUX_SET_SEEKPOINT:
         {
             int i_chapter = (int)va_arg( args, int );
+            blurayReaderLock(p_sys);
             bd_seek_chapter( p_sys->bluray, i_chapter );
+            blurayReaderUnlock(p_sys, true);
             p_demux->info.i_update = INPUT_UPDATE_SEEKPOINT;
             break;
         }
@@ -1062,7 +1091,9 @@ static int blurayControl(demux_t *p_demux, int query, va_list args)
         case DEMUX_SET_TIME:
         {
             int64_t i_time = (int64_t)va_arg(args, int64_t);
+            blurayReaderLock(p_sys);
             bd_seek_time(p_sys->bluray, TO_TICKS(i_time));
+            blurayReaderUnlock(p_sys, true);
             return VLC_SUCCESS;
         }
         case DEMUX_GET_TIME:
@@ -1082,7 +1113,9 @@ static int blurayControl(demux_t *p_demux, int query, va_list args)
         case DEMUX_SET_POSITION:
         {
             double f_position = (double)va_arg(args, double);
+            blurayReaderLock(p_sys);
             bd_seek_time(p_sys->bluray, TO_TICKS(f_position*CUR_LENGTH));
+            blurayReaderUnlock(p_sys, true);
             return VLC_SUCCESS;
         }
 
@@ -1207,12 +1240,156 @@ static void blurayHandleEvents( demux_t *p_demux )
 }
 
 #define BD_TS_PACKET_SIZE (192)
-#define NB_TS_PACKETS (200)
+#define NB_TS_PACKETS (1024) /* 32 aligned units of 6 kB */
+
+/* Maximum amount of data read ahead */
+#define BD_READ_AHEAD (4 << 20)
+
+/*****************************************************************************
+ * Read-ahead thread
+ *****************************************************************************/
+#define BD_BLOCK_FLAG_EVENT (1 << BLOCK_FLAG_PRIVATE_SHIFT)
+
+static void *blurayReaderThread(void *data)
+{
+    demux_t *p_demux = data;
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_read = NB_TS_PACKETS * BD_TS_PACKET_SIZE;
+
+    for (;;) {
+        block_FifoPace(p_sys->reader.p_fifo, SIZE_MAX, BD_READ_AHEAD - i_read);
+
+        block_t *p_block = block_Alloc(i_read);
+        if (unlikely(p_block == NULL)) {
+            msleep(CLOCK_FREQ / 10);
+            continue;
+        }
+
+        int canc = vlc_savecancel();
+        vlc_mutex_lock(&p_sys->reader.lock);
+
+        /* The events come before the data that follows them */
+        BD_EVENT e;
+        while (bd_get_event(p_sys->bluray, &e)) {
+            block_t *p_event = block_Alloc(sizeof(e));
+            if (likely(p_event != NULL)) {
+                memcpy(p_event->p_buffer, &e, sizeof(e));
+                p_event->i_flags |= BD_BLOCK_FLAG_EVENT;
+                block_FifoPut(p_sys->reader.p_fifo, p_event);
+            }
+        }
+
+        int nread = bd_read(p_sys->bluray, p_block->p_buffer, i_read);
+        if (nread > 0) {
+            p_block->i_buffer = nread;
+            block_FifoPut(p_sys->reader.p_fifo, p_block);
+        } else {
+            block_Release(p_block);
+            if (nread < 0)
+                atomic_store(&p_sys->reader.b_error, true);
+        }
+
+        vlc_mutex_unlock(&p_sys->reader.lock);
+        vlc_restorecancel(canc);
+
+        if (nread < 0)
+            break;
+        if (nread == 0) /* End of title, wait for a seek */
+            msleep(CLOCK_FREQ / 50);
+    }
+    return NULL;
+}
+
+static int blurayReaderStart(demux_t *p_demux)
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    p_sys->reader.p_fifo = block_FifoNew();
+    if (unlikely(p_sys->reader.p_fifo == NULL))
+        return VLC_ENOMEM;
+
+    vlc_mutex_init(&p_sys->reader.lock);
+    atomic_init(&p_sys->reader.b_error, false);
+    if (vlc_clone(&p_sys->reader.thread, blurayReaderThread, p_demux,
+                  VLC_THREAD_PRIORITY_INPUT)) {
+        vlc_mutex_destroy(&p_sys->reader.lock);
+        block_FifoRelease(p_sys->reader.p_fifo);
+        p_sys->reader.p_fifo = NULL;
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Stops the read-ahead between two reads, before moving libbluray */
+static void blurayReaderLock(demux_sys_t *p_sys)
+{
+    if (p_sys->reader.p_fifo != NULL)
+        vlc_mutex_lock(&p_sys->reader.lock);
+}
+
+/* Resumes the read-ahead, dropping the data read from the former position
+ * if b_flush. The events are kept, they still apply. */
+static void blurayReaderUnlock(demux_sys_t *p_sys, bool b_flush)
+{
+    if (p_sys->reader.p_fifo == NULL)
+        return;
+
+    if (b_flush) {
+        block_t *p_chain = block_FifoGetBatch(p_sys->reader.p_fifo, SIZE_MAX,
+                                              VLC_TS_0);
+        block_t *p_events = NULL, **pp_last = &p_events;
+
+        while (p_chain != NULL) {
+            block_t *p_next = p_chain->p_next;
+            p_chain->p_next = NULL;
+            if (p_chain->i_flags & BD_BLOCK_FLAG_EVENT) {
+                *pp_last = p_chain;
+                pp_last = &p_chain->p_next;
+            } else
+                block_Release(p_chain);
+            p_chain = p_next;
+        }
+        block_FifoPut(p_sys->reader.p_fifo, p_events);
+    }
+    vlc_mutex_unlock(&p_sys->reader.lock);
+}
+
+static int blurayDemuxReadAhead(demux_t *p_demux)
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    /* Come back regularly for the controls */
+    block_t *p_chain = block_FifoGetBatch(p_sys->reader.p_fifo,
+                                          NB_TS_PACKETS * BD_TS_PACKET_SIZE,
+                                          mdate() + CLOCK_FREQ / 10);
+    if (p_chain == NULL)
+        return atomic_load(&p_sys->reader.b_error)
+            && block_FifoCount(p_sys->reader.p_fifo) == 0 ? -1 : 1;
+
+    while (p_chain != NULL) {
+        block_t *p_next = p_chain->p_next;
+        p_chain->p_next = NULL;
+
+        if (p_chain->i_flags & BD_BLOCK_FLAG_EVENT) {
+            /* Title info is read from libbluray */
+            vlc_mutex_lock(&p_sys->reader.lock);
+            blurayHandleEvent(p_demux, (const BD_EVENT *)p_chain->p_buffer);
+            vlc_mutex_unlock(&p_sys->reader.lock);
+            block_Release(p_chain);
+        } else
+            stream_DemuxSend(p_sys->p_parser, p_chain);
+        p_chain = p_next;
+    }
+    return 1;
+}
 
 static int blurayDemux(demux_t *p_demux)
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    if (p_sys->reader.p_fifo != NULL)
+        return blurayDemuxReadAhead(p_demux);
+
     block_t *p_block = block_Alloc(NB_TS_PACKETS * (int64_t)BD_TS_PACKET_SIZE);
     if (!p_block) {
         return -1;
@@ -35,6 +35,8 @@
 
 #include <arpa/inet.h>
 
+#include "../codec/v210.h"
+
 #include <DeckLinkAPI.h>
 #include <DeckLinkAPIDispatch.cpp>
 
@@ -126,6 +128,15 @@ static int Control(demux_t *, int, va_list);
 
 class DeckLinkCaptureDelegate;
 
+/* Frames the callback can queue ahead of the processing thread */
+#define DECKLINK_QUEUE 8
+
+typedef struct
+{
+    IDeckLinkVideoInputFrame *video;
+    IDeckLinkAudioInputPacket *audio;
+} decklink_frame_t;
+
 struct demux_sys_t
 {
     IDeckLink *card;
@@ -147,6 +158,17 @@ struct demux_sys_t
     int channels;
 
     bool tenbits;
+    v210_unpack_fn v210_unpack;
+
+    /* The callback only queues the frames: they are converted and sent
+     * by the thread, so that the card is never kept waiting. */
+    vlc_thread_t thread;
+    bool thread_started;
+    vlc_mutex_t frame_lock;
+    vlc_cond_t frame_wait;
+    decklink_frame_t frames[DECKLINK_QUEUE]; /* protected by <frame_lock> */
+    unsigned frame_first;
+    unsigned frame_count;
 };
 
 class DeckLinkCaptureDelegate : public IDeckLinkInputCallback
@@ -185,241 +207,297 @@ private:
     demux_t *demux_;
 };
 
-static inline uint32_t av_le2ne32(uint32_t val)
+typedef struct
 {
-    union {
-        uint32_t v;
-        uint8_t b[4];
-    } u;
-    u.v = val;
-    return (u.b[0] << 0) | (u.b[1] << 8) | (u.b[2] << 16) | (u.b[3] << 24);
-}
+    block_t self;
+    IDeckLinkVideoInputFrame *frame;
+} decklink_block_t;
 
-static void v210_convert(uint16_t *dst, const uint32_t *bytes, const int width, const int height)
+static void ReleaseFrameBlock(block_t *block)
 {
-    const int stride = ((width + 47) / 48) * 48 * 8 / 3 / 4;
-    uint16_t *y = &dst[0];
-    uint16_t *u = &dst[width * height * 2 / 2];
-    uint16_t *v = &dst[width * height * 3 / 2];
-
-#define READ_PIXELS(a, b, c)         \
-    do {                             \
-        val  = av_le2ne32(*src++);   \
-        *a++ =  val & 0x3FF;         \
-        *b++ = (val >> 10) & 0x3FF;  \
-        *c++ = (val >> 20) & 0x3FF;  \
-    } while (0)
-
-    for (int h = 0; h < height; h++) {
-        const uint32_t *src = bytes;
-        uint32_t val = 0;
-        int w;
-        for (w = 0; w < width - 5; w += 6) {
-            READ_PIXELS(u, y, v);
-            READ_PIXELS(y, u, y);
-            READ_PIXELS(v, y, u);
-            READ_PIXELS(y, v, y);
-        }
-        if (w < width - 1) {
-            READ_PIXELS(u, y, v);
+    decklink_block_t *b = (decklink_block_t *)block;
 
-            val  = av_le2ne32(*src++);
-            *y++ =  val & 0x3FF;
-        }
-        if (w < width - 3) {
-            *u++ = (val >> 10) & 0x3FF;
-            *y++ = (val >> 20) & 0x3FF;
-
-            val  = av_le2ne32(*src++);
-            *v++ =  val & 0x3FF;
-            *y++ = (val >> 10) & 0x3FF;
-        }
+    b->frame->Release();
+    free(b);
+}
 
-        bytes += stride;
-    }
+/**
+ * Wraps the frame in a block without copying it. The frame is released
+ * with the block.
+ */
+static block_t *LendFrame(IDeckLinkVideoInputFrame *videoFrame, void *buffer,
+                          size_t size)
+{
+    decklink_block_t *b = (decklink_block_t *)malloc(sizeof(*b));
+    if (!b)
+        return NULL;
+
+    block_Init(&b->self, buffer, size);
+    b->self.pf_release = ReleaseFrameBlock;
+    b->frame = videoFrame;
+    videoFrame->AddRef();
+    return &b->self;
 }
 
-HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame* videoFrame, IDeckLinkAudioInputPacket* audioFrame)
+static void SendCC(demux_t *demux, IDeckLinkVideoInputFrame *videoFrame,
+                   mtime_t stream_time)
 {
-    demux_sys_t *sys = demux_->p_sys;
+    demux_sys_t *sys = demux->p_sys;
+    const int width = videoFrame->GetWidth();
+
+    IDeckLinkVideoFrameAncillary *vanc;
+    if (videoFrame->GetAncillaryData(&vanc) == S_OK) {
+        for (int i = 1; i < 21; i++) {
+            uint32_t *buf;
+            if (vanc->GetBufferForVerticalBlankingLine(i, (void**)&buf) != S_OK)
+                break;
+            uint16_t dec[width * 2];
+            sys->v210_unpack(&dec[0], &dec[width], &dec[width * 3 / 2],
+                             buf, width);
+            static const uint16_t vanc_header[3] = { 0, 0x3ff, 0x3ff };
+            if (!memcmp(vanc_header, dec, sizeof(vanc_header))) {
+                int len = (dec[5] & 0xff) + 6 + 1;
+                uint16_t vanc_sum = 0;
+                bool parity_ok = true;
+                for (int i = 3; i < len - 1; i++) {
+                    uint16_t v = dec[i];
+                    int np = v >> 8;
+                    int p = parity(v & 0xff);
+                    if ((!!p ^ !!(v & 0x100)) || (np != 1 && np != 2)) {
+                        parity_ok = false;
+                        break;
+                    }
+                    vanc_sum += v;
+                    vanc_sum &= 0x1ff;
+                    dec[i] &= 0xff;
+                }
 
-    if (videoFrame) {
-        if (videoFrame->GetFlags() & bmdFrameHasNoInputSource) {
-            msg_Warn(demux_, "No input signal detected");
-            return S_OK;
-        }
+                if (!parity_ok)
+                    continue;
 
-        const int width = videoFrame->GetWidth();
-        const int height = videoFrame->GetHeight();
-        const int stride = videoFrame->GetRowBytes();
+                vanc_sum |= ((~vanc_sum & 0x100) << 1);
+                if (dec[len - 1] != vanc_sum)
+                    continue;
 
-        int bpp = sys->tenbits ? 4 : 2;
-        block_t *video_frame = block_Alloc(width * height * bpp);
-        if (!video_frame)
-            return S_OK;
-
-        const uint32_t *frame_bytes;
-        videoFrame->GetBytes((void**)&frame_bytes);
-
-        BMDTimeValue stream_time, frame_duration;
-        videoFrame->GetStreamTime(&stream_time, &frame_duration, CLOCK_FREQ);
-        video_frame->i_flags = BLOCK_FLAG_TYPE_I | sys->dominance_flags;
-        video_frame->i_pts = video_frame->i_dts = VLC_TS_0 + stream_time;
-
-        if (sys->tenbits) {
-            v210_convert((uint16_t*)video_frame->p_buffer, frame_bytes, width, height);
-            IDeckLinkVideoFrameAncillary *vanc;
-            if (videoFrame->GetAncillaryData(&vanc) == S_OK) {
-                for (int i = 1; i < 21; i++) {
-                    uint32_t *buf;
-                    if (vanc->GetBufferForVerticalBlankingLine(i, (void**)&buf) != S_OK)
-                        break;
-                    uint16_t dec[width * 2];
-                    v210_convert(&dec[0], buf, width, 1);
-                    static const uint16_t vanc_header[3] = { 0, 0x3ff, 0x3ff };
-                    if (!memcmp(vanc_header, dec, sizeof(vanc_header))) {
-                        int len = (dec[5] & 0xff) + 6 + 1;
-                        uint16_t vanc_sum = 0;
-                        bool parity_ok = true;
-                        for (int i = 3; i < len - 1; i++) {
-                            uint16_t v = dec[i];
-                            int np = v >> 8;
-                            int p = parity(v & 0xff);
-                            if ((!!p ^ !!(v & 0x100)) || (np != 1 && np != 2)) {
-                                parity_ok = false;
-                                break;
-                            }
-                            vanc_sum += v;
-                            vanc_sum &= 0x1ff;
-                            dec[i] &= 0xff;
-                        }
-
-                        if (!parity_ok)
-                            continue;
-
-                        vanc_sum |= ((~vanc_sum & 0x100) << 1);
-                        if (dec[len - 1] != vanc_sum)
-                            continue;
-
-                        if (dec[3] != 0x61 /* DID */ ||
-                            dec[4] != 0x01 /* SDID = CEA-708 */)
-                            continue;
-
-                        /* CDP follows */
-                        uint16_t *cdp = &dec[6];
-                        if (cdp[0] != 0x96 || cdp[1] != 0x69)
-                            continue;
-
-                        len -= 7; // remove VANC header and checksum
-
-                        if (cdp[2] != len)
-                            continue;
-
-                        uint8_t cdp_sum = 0;
-                        for (int i = 0; i < len - 1; i++)
-                            cdp_sum += cdp[i];
-                        cdp_sum = cdp_sum ? 256 - cdp_sum : 0;
-                        if (cdp[len - 1] != cdp_sum)
-                            continue;
-
-                        uint8_t rate = cdp[3];
-                        if (!(rate & 0x0f))
-                            continue;
-                        rate >>= 4;
-                        if (rate > 8)
-                            continue;
-
-                        if (!(cdp[4] & 0x43)) /* ccdata_present | caption_service_active | reserved */
-                            continue;
-
-                        uint16_t hdr = (cdp[5] << 8) | cdp[6];
-                        if (cdp[7] != 0x72) /* ccdata_id */
-                            continue;
-
-                        int cc_count = cdp[8];
-                        if (!(cc_count & 0xe0))
-                            continue;
-                        cc_count &= 0x1f;
-                        if ((len - 13) != cc_count * 3)
-                            continue;
-
-                        if (cdp[len - 4] != 0x74) /* footer id */
-                            continue;
-
-                        uint16_t ftr = (cdp[len - 3] << 8) | cdp[len - 2];
-                        if (ftr != hdr)
-                            continue;
-
-                        block_t *cc = block_Alloc(cc_count * 3);
-
-                        for (int i = 0; i < cc_count; i++) {
-                            cc->p_buffer[3*i+0] = cdp[9 + 3*i+0] & 3;
-                            cc->p_buffer[3*i+1] = cdp[9 + 3*i+1];
-                            cc->p_buffer[3*i+2] = cdp[9 + 3*i+2];
-                        }
-
-                        cc->i_pts = cc->i_dts = VLC_TS_0 + stream_time;
-
-                        if (!sys->cc_es) {
-                            es_format_t fmt;
-
-                            es_format_Init( &fmt, SPU_ES, VLC_FOURCC('c', 'c', '1' , ' ') );
-                            fmt.psz_description = strdup("Closed captions 1");
-                            if (fmt.psz_description) {
-                                sys->cc_es = es_out_Add(demux_->out, &fmt);
-                                msg_Dbg(demux_, "Adding Closed captions stream");
-                            }
-                        }
-                        if (sys->cc_es)
-                            es_out_Send(demux_->out, sys->cc_es, cc);
-                        else
-                            block_Release(cc);
-                        break; // we found the line with Closed Caption data
+                if (dec[3] != 0x61 /* DID */ ||
+                    dec[4] != 0x01 /* SDID = CEA-708 */)
+                    continue;
+
+                /* CDP follows */
+                uint16_t *cdp = &dec[6];
+                if (cdp[0] != 0x96 || cdp[1] != 0x69)
+                    continue;
+
+                len -= 7; // remove VANC header and checksum
+
+                if (cdp[2] != len)
+                    continue;
+
+                uint8_t cdp_sum = 0;
+                for (int i = 0; i < len - 1; i++)
+                    cdp_sum += cdp[i];
+                cdp_sum = cdp_sum ? 256 - cdp_sum : 0;
+                if (cdp[len - 1] != cdp_sum)
+                    continue;
+
+                uint8_t rate = cdp[3];
+                if (!(rate & 0x0f))
+                    continue;
+                rate >>= 4;
+                if (rate > 8)
+                    continue;
+
+                if (!(cdp[4] & 0x43)) /* ccdata_present | caption_service_active | reserved */
+                    continue;
+
+                uint16_t hdr = (cdp[5] << 8) | cdp[6];
+                if (cdp[7] != 0x72) /* ccdata_id */
+                    continue;
+
+                int cc_count = cdp[8];
+                if (!(cc_count & 0xe0))
+                    continue;
+                cc_count &= 0x1f;
+                if ((len - 13) != cc_count * 3)
+                    continue;
+
+                if (cdp[len - 4] != 0x74) /* footer id */
+                    continue;
+
+                uint16_t ftr = (cdp[len - 3] << 8) | cdp[len - 2];
+                if (ftr != hdr)
+                    continue;
+
+                block_t *cc = block_Alloc(cc_count * 3);
+
+                for (int i = 0; i < cc_count; i++) {
+                    cc->p_buffer[3*i+0] = cdp[9 + 3*i+0] & 3;
+                    cc->p_buffer[3*i+1] = cdp[9 + 3*i+1];
+                    cc->p_buffer[3*i+2] = cdp[9 + 3*i+2];
+                }
+
+                cc->i_pts = cc->i_dts = VLC_TS_0 + stream_time;
+
+                if (!sys->cc_es) {
+                    es_format_t fmt;
+
+                    es_format_Init( &fmt, SPU_ES, VLC_FOURCC('c', 'c', '1' , ' ') );
+                    fmt.psz_description = strdup("Closed captions 1");
+                    if (fmt.psz_description) {
+                        sys->cc_es = es_out_Add(demux->out, &fmt);
+                        msg_Dbg(demux, "Adding Closed captions stream");
                     }
                 }
-                vanc->Release();
-            }
-        } else {
-            for (int y = 0; y < height; ++y) {
-                const uint8_t *src = (const uint8_t *)frame_bytes + stride * y;
-                uint8_t *dst = video_frame->p_buffer + width * 2 * y;
-                memcpy(dst, src, width * 2);
+                if (sys->cc_es)
+                    es_out_Send(demux->out, sys->cc_es, cc);
+                else
+                    block_Release(cc);
+                break; // we found the line with Closed Caption data
             }
         }
+        vanc->Release();
+    }
+}
 
-        vlc_mutex_lock(&sys->pts_lock);
-        if (video_frame->i_pts > sys->last_pts)
-            sys->last_pts = video_frame->i_pts;
-        vlc_mutex_unlock(&sys->pts_lock);
+static void SendVideo(demux_t *demux, IDeckLinkVideoInputFrame *videoFrame)
+{
+    demux_sys_t *sys = demux->p_sys;
+    const int width = videoFrame->GetWidth();
+    const int height = videoFrame->GetHeight();
+    const int stride = videoFrame->GetRowBytes();
+    block_t *video_frame;
 
-        es_out_Control(demux_->out, ES_OUT_SET_PCR, video_frame->i_pts);
-        es_out_Send(demux_->out, sys->video_es, video_frame);
+    uint8_t *frame_bytes;
+    videoFrame->GetBytes((void**)&frame_bytes);
+
+    if (sys->tenbits) {
+        video_frame = block_Alloc(width * height * 4);
+        if (!video_frame)
+            return;
+
+        uint16_t *y = (uint16_t *)video_frame->p_buffer;
+        uint16_t *u = y + width * height;
+        uint16_t *v = u + width * height / 2;
+        V210Unpack(sys->v210_unpack, y, width, u, v, width / 2,
+                   frame_bytes, stride, width, height);
+    } else if (stride == width * 2) {
+        /* UYVY as the card delivers it */
+        video_frame = LendFrame(videoFrame, frame_bytes, width * height * 2);
+        if (!video_frame)
+            return;
+    } else {
+        video_frame = block_Alloc(width * height * 2);
+        if (!video_frame)
+            return;
+
+        for (int y = 0; y < height; ++y) {
+            const uint8_t *src = frame_bytes + stride * y;
+            uint8_t *dst = video_frame->p_buffer + width * 2 * y;
+            memcpy(dst, src, width * 2);
+        }
     }
 
-    if (audioFrame) {
-        const int bytes = audioFrame->GetSampleFrameCount() * sizeof(int16_t) * sys->channels;
+    BMDTimeValue stream_time, frame_duration;
+    videoFrame->GetStreamTime(&stream_time, &frame_duration, CLOCK_FREQ);
+    video_frame->i_flags = BLOCK_FLAG_TYPE_I | sys->dominance_flags;
+    video_frame->i_pts = video_frame->i_dts = VLC_TS_0 + stream_time;
+
+    if (sys->tenbits)
+        SendCC(demux, videoFrame, stream_time);
+
+    vlc_mutex_lock(&sys->pts_lock);
+    if (video_frame->i_pts > sys->last_pts)
+        sys->last_pts = video_frame->i_pts;
+    vlc_mutex_unlock(&sys->pts_lock);
+
+    es_out_Control(demux->out, ES_OUT_SET_PCR, video_frame->i_pts);
+    es_out_Send(demux->out, sys->video_es, video_frame);
+}
+
+static void SendAudio(demux_t *demux, IDeckLinkAudioInputPacket *audioFrame)
+{
+    demux_sys_t *sys = demux->p_sys;
+    const int bytes = audioFrame->GetSampleFrameCount() * sizeof(int16_t) * sys->channels;
+
+    block_t *audio_frame = block_Alloc(bytes);
+    if (!audio_frame)
+        return;
 
-        block_t *audio_frame = block_Alloc(bytes);
-        if (!audio_frame)
-            return S_OK;
+    void *frame_bytes;
+    audioFrame->GetBytes(&frame_bytes);
+    memcpy(audio_frame->p_buffer, frame_bytes, bytes);
 
-        void *frame_bytes;
-        audioFrame->GetBytes(&frame_bytes);
-        memcpy(audio_frame->p_buffer, frame_bytes, bytes);
+    BMDTimeValue packet_time;
+    audioFrame->GetPacketTime(&packet_time, CLOCK_FREQ);
+    audio_frame->i_pts = audio_frame->i_dts = VLC_TS_0 + packet_time;
 
-        BMDTimeValue packet_time;
-        audioFrame->GetPacketTime(&packet_time, CLOCK_FREQ);
-        audio_frame->i_pts = audio_frame->i_dts = VLC_TS_0 + packet_time;
+    vlc_mutex_lock(&sys->pts_lock);
+    if (audio_frame->i_pts > sys->last_pts)
+        sys->last_pts = audio_frame->i_pts;
+    vlc_mutex_unlock(&sys->pts_lock);
+    if (audio_frame->i_pts > sys->last_pts)
 
-        vlc_mutex_lock(&sys->pts_lock);
-        if (audio_frame->i_pts > sys->last_pts)
-            sys->last_pts = audio_frame->i_pts;
-        vlc_mutex_unlock(&sys->pts_lock);
-        if (audio_frame->i_pts > sys->last_pts)
+    es_out_Control(demux->out, ES_OUT_SET_PCR, audio_frame->i_pts);
+    es_out_Send(demux->out, sys->audio_es, audio_frame);
+}
 
-        es_out_Control(demux_->out, ES_OUT_SET_PCR, audio_frame->i_pts);
-        es_out_Send(demux_->out, sys->audio_es, audio_frame);
+static void *Thread(void *data)
+{
+    demux_t *demux = (demux_t *)data;
+    demux_sys_t *sys = demux->p_sys;
+
+    for (;;) {
+        decklink_frame_t frame;
+
+        vlc_mutex_lock(&sys->frame_lock);
+        mutex_cleanup_push(&sys->frame_lock);
+        while (sys->frame_count == 0)
+            vlc_cond_wait(&sys->frame_wait, &sys->frame_lock);
+        vlc_cleanup_pop();
+        frame = sys->frames[sys->frame_first];
+        sys->frame_first = (sys->frame_first + 1) % DECKLINK_QUEUE;
+        sys->frame_count--;
+        vlc_mutex_unlock(&sys->frame_lock);
+
+        int canc = vlc_savecancel();
+        if (frame.video) {
+            SendVideo(demux, frame.video);
+            frame.video->Release();
+        }
+        if (frame.audio) {
+            SendAudio(demux, frame.audio);
+            frame.audio->Release();
+        }
+        vlc_restorecancel(canc);
     }
+}
+
+HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame* videoFrame, IDeckLinkAudioInputPacket* audioFrame)
+{
+    demux_sys_t *sys = demux_->p_sys;
+
+    if (videoFrame && (videoFrame->GetFlags() & bmdFrameHasNoInputSource)) {
+        msg_Warn(demux_, "No input signal detected");
+        return S_OK;
+    }
+
+    vlc_mutex_lock(&sys->frame_lock);
+    if (sys->frame_count == DECKLINK_QUEUE) {
+        vlc_mutex_unlock(&sys->frame_lock);
+        msg_Warn(demux_, "capture overrun, frame dropped");
+        return S_OK;
+    }
+
+    decklink_frame_t *frame = &sys->frames[(sys->frame_first + sys->frame_count) % DECKLINK_QUEUE];
+    frame->video = videoFrame;
+    frame->audio = audioFrame;
+    if (videoFrame)
+        videoFrame->AddRef();
+    if (audioFrame)
+        audioFrame->AddRef();
+    sys->frame_count++;
+    vlc_cond_signal(&sys->frame_wait);
+    vlc_mutex_unlock(&sys->frame_lock);
 
     return S_OK;
 }
@@ -535,8 +613,11 @@ static int Open(vlc_object_t *p_this)
         return VLC_ENOMEM;
 
     vlc_mutex_init(&sys->pts_lock);
+    vlc_mutex_init(&sys->frame_lock);
+    vlc_cond_init(&sys->frame_wait);
 
     sys->tenbits = var_InheritBool(p_this, "decklink-tenbits");
+    sys->v210_unpack = V210UnpackGet();
 
     IDeckLinkIterator *decklink_iterator = CreateDeckLinkIteratorInstance();
     if (!decklink_iterator) {
@@ -700,6 +781,12 @@ static int Open(vlc_object_t *p_this)
              (char*)&audio_fmt.i_codec, audio_fmt.audio.i_rate, audio_fmt.audio.i_bitspersample, audio_fmt.audio.i_channels);
     sys->audio_es = es_out_Add(demux->out, &audio_fmt);
 
+    if (vlc_clone(&sys->thread, Thread, demux, VLC_THREAD_PRIORITY_INPUT)) {
+        msg_Err(demux, "Could not start the capture thread");
+        goto finish;
+    }
+    sys->thread_started = true;
+
     ret = VLC_SUCCESS;
 
 finish:
@@ -717,13 +804,27 @@ static void Close(vlc_object_t *p_this)
     demux_t     *demux = (demux_t *)p_this;
     demux_sys_t *sys   = demux->p_sys;
 
+    if (sys->input)
+        sys->input->StopStreams();
+
+    if (sys->thread_started) {
+        vlc_cancel(sys->thread);
+        vlc_join(sys->thread, NULL);
+    }
+
+    for (unsigned i = 0; i < sys->frame_count; i++) {
+        decklink_frame_t *frame = &sys->frames[(sys->frame_first + i) % DECKLINK_QUEUE];
+        if (frame->video)
+            frame->video->Release();
+        if (frame->audio)
+            frame->audio->Release();
+    }
+
     if (sys->config)
         sys->config->Release();
 
-    if (sys->input) {
-        sys->input->StopStreams();
+    if (sys->input)
         sys->input->Release();
-    }
 
     if (sys->card)
         sys->card->Release();
@@ -731,6 +832,8 @@ static void Close(vlc_object_t *p_this)
     if (sys->delegate)
         sys->delegate->Release();
 
+    vlc_cond_destroy(&sys->frame_wait);
+    vlc_mutex_destroy(&sys->frame_lock);
     vlc_mutex_destroy(&sys->pts_lock);
     free(sys);
 }
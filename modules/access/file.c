@@ -52,6 +52,9 @@
 #   include <unistd.h>
 #endif
 #include <dirent.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "fs.h"
@@ -72,6 +75,10 @@ struct access_sys_t
 
     /* */
     bool b_pace_control;
+
+#ifdef HAVE_MMAP
+    size_t i_page; /* Page size, mmap() offsets must be a multiple of it */
+#endif
 };
 
 #if !defined (WIN32) && !defined (__OS2__)
@@ -129,8 +136,17 @@ static bool IsRemote (const char *path)
 #ifndef HAVE_POSIX_FADVISE
 # define posix_fadvise(fd, off, len, adv)
 #endif
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
+
+/* Size of the file windows mapped at once */
+#define MMAP_WINDOW_SIZE (1 << 20)
 
 static ssize_t FileRead (access_t *, uint8_t *, size_t);
+#ifdef HAVE_MMAP
+static block_t *FileBlockMmap (access_t *);
+#endif
 static int FileSeek (access_t *, uint64_t);
 static ssize_t StreamRead (access_t *, uint8_t *, size_t);
 static int NoSeek (access_t *, uint64_t);
@@ -229,6 +245,20 @@ int FileOpen( vlc_object_t *p_this )
     {
         p_access->pf_read = FileRead;
         p_access->pf_seek = FileSeek;
+#ifdef HAVE_MMAP
+        /* Block devices cannot be mapped and remote files could be
+         * truncated behind our back, which would be fatal (SIGBUS). */
+        if (S_ISREG (st.st_mode) && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote (fd, p_access->psz_filepath))
+        {
+            long page = sysconf (_SC_PAGESIZE);
+
+            p_sys->i_page = (page > 0) ? page : 4096;
+            p_access->pf_read = NULL;
+            p_access->pf_block = FileBlockMmap;
+            msg_Dbg (p_access, "using memory mapped I/O");
+        }
+#endif
         p_access->info.i_size = st.st_size;
         p_sys->b_pace_control = true;
 
@@ -268,7 +298,7 @@ void FileClose (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_control != FileControl)
     {
         DirClose (p_this);
         return;
@@ -328,6 +358,82 @@ static ssize_t FileRead (access_t *p_access, uint8_t *p_buffer, size_t i_len)
 }
 
 
+#ifdef HAVE_MMAP
+/**
+ * Reads from a regular file by mapping windows of it in memory.
+ * Each window is handed out as a block and unmapped when it is released;
+ * if mapping fails (e.g. unsupported file system), falls back to read().
+ */
+static block_t *FileBlockMmap (access_t *p_access)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint64_t i_pos = p_access->info.i_pos;
+
+    if (i_pos >= p_access->info.i_size)
+    {
+        /* The file may have grown since we last looked */
+        struct stat st;
+
+        if (fstat (p_sys->fd, &st) == 0
+         && p_access->info.i_size != (uint64_t)st.st_size)
+        {
+            p_access->info.i_size = st.st_size;
+            p_access->info.i_update |= INPUT_UPDATE_SIZE;
+        }
+        if (i_pos >= p_access->info.i_size)
+        {
+            p_access->info.b_eof = true;
+            return NULL;
+        }
+    }
+
+    /* Map the page aligned window containing the current position */
+    uint64_t i_offset = i_pos - (i_pos % p_sys->i_page);
+    size_t i_length = __MIN (p_access->info.i_size - i_offset,
+                             (uint64_t)MMAP_WINDOW_SIZE);
+    size_t i_skip = i_pos - i_offset;
+
+    /* Private writable mapping: demuxers may modify data in place */
+    void *addr = mmap (NULL, i_length, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+                       p_sys->fd, i_offset);
+    if (addr == MAP_FAILED)
+    {
+        msg_Dbg (p_access, "cannot map file window (%m)");
+
+        size_t i_read = i_length - i_skip;
+        block_t *p_block = block_Alloc (i_read);
+        if (unlikely(p_block == NULL))
+            return NULL;
+
+        ssize_t val = FileRead (p_access, p_block->p_buffer, i_read);
+        if (val <= 0)
+        {
+            block_Release (p_block);
+            return NULL;
+        }
+        p_block->i_buffer = val;
+        return p_block;
+    }
+
+    /* Data are read once, in order; also start reading the next window */
+    posix_madvise (addr, i_length, POSIX_MADV_SEQUENTIAL);
+    posix_madvise (addr, i_length, POSIX_MADV_WILLNEED);
+    posix_fadvise (p_sys->fd, i_offset + i_length, MMAP_WINDOW_SIZE,
+                   POSIX_FADV_WILLNEED);
+
+    block_t *p_block = block_mmap_Alloc (addr, i_length);
+    if (unlikely(p_block == NULL))
+        return NULL;
+
+    p_block->p_buffer += i_skip;
+    p_block->i_buffer -= i_skip;
+
+    p_access->info.i_pos += p_block->i_buffer;
+    p_access->info.b_eof = false;
+    return p_block;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
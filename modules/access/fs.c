@@ -58,6 +58,12 @@ static const char *const psz_sort_list_text[] = {
 #define SORT_LONGTEXT N_( \
     "Define the sort algorithm used when adding items from a directory." )
 
+#define MMAP_TEXT N_("Use memory mapping")
+#define MMAP_LONGTEXT N_( \
+    "Map local files to memory instead of reading them, " \
+    "which avoids copying the data. " \
+    "Files must not be truncated while they are read." )
+
 vlc_module_begin ()
     set_description( N_("File input") )
     set_shortname( N_("File") )
@@ -66,6 +72,9 @@ vlc_module_begin ()
     add_obsolete_string( "file-cat" )
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
+#ifdef HAVE_MMAP
+    add_bool( "file-mmap", false, MMAP_TEXT, MMAP_LONGTEXT, true )
+#endif
     set_callbacks( FileOpen, FileClose )
 
     add_submodule()
@@ -54,6 +54,9 @@
 
 #include <assert.h>
 #include <limits.h>
+#ifdef HAVE_POLL
+#   include <poll.h>
+#endif
 
 #ifdef HAVE_LIBPROXY
 #    include <proxy.h>
@@ -90,6 +93,12 @@ static void Close( vlc_object_t * );
     "You should not globally enable this option as it will break all other " \
     "types of HTTP streams." )
 
+#define CONNECTIONS_TEXT N_("Connections")
+#define CONNECTIONS_LONGTEXT N_("Maximum number of connections used " \
+    "to download a seekable file. With more than one, the file is split " \
+    "in ranges downloaded in parallel, and connections are only added as " \
+    "long as they increase the throughput." )
+
 #define FORWARD_COOKIES_TEXT N_("Forward Cookies")
 #define FORWARD_COOKIES_LONGTEXT N_("Forward Cookies across http redirections.")
 
@@ -124,6 +133,9 @@ vlc_module_begin ()
     add_bool( "http-continuous", false, CONTINUOUS_TEXT,
               CONTINUOUS_LONGTEXT, true )
         change_safe()
+    add_integer( "http-connections", 1, CONNECTIONS_TEXT,
+                 CONNECTIONS_LONGTEXT, true )
+        change_integer_range( 1, 16 )
     add_bool( "http-forward-cookies", true, FORWARD_COOKIES_TEXT,
               FORWARD_COOKIES_LONGTEXT, true )
     /* 'itpc' = iTunes Podcast */
@@ -135,6 +147,8 @@ vlc_module_end ()
  * Local prototypes
  *****************************************************************************/
 
+typedef struct http_parallel_t http_parallel_t;
+
 struct access_sys_t
 {
     int fd;
@@ -193,6 +207,8 @@ struct access_sys_t
     bool b_has_size;
 
     vlc_array_t * cookies;
+
+    http_parallel_t *p_parallel;
 };
 
 /* */
@@ -206,15 +222,25 @@ static int Seek( access_t *, uint64_t );
 static int Control( access_t *, int, va_list );
 
 /* */
+static void Reset( access_t *, uint64_t );
 static int Connect( access_t *, uint64_t );
 static int Request( access_t *p_access, uint64_t i_tell );
 static void Disconnect( access_t * );
 
+/* Idle persistent connections, shared by all the instances */
+static int  ConnectionGet( const vlc_url_t * );
+static void ConnectionPut( const vlc_url_t *, int fd );
+
+/* Parallel download of the ranges */
+static int  ParallelStart( access_t *, unsigned i_connections );
+static void ParallelStop( access_t * );
+
 /* Small Cookie utilities. Cookies support is partial. */
 static char * cookie_get_content( const char * cookie );
 static char * cookie_get_domain( const char * cookie );
 static char * cookie_get_name( const char * cookie );
 static void cookie_append( vlc_array_t * cookies, char * cookie );
+static void SendCookies( access_t *, int fd, const v_socket_t * );
 
 
 static void AuthReply( access_t *p_acces, const char *psz_prefix,
@@ -294,6 +320,7 @@ static int OpenWithCookies( vlc_object_t *p_this, const char *psz_access,
     p_access->info.b_eof  = false;
 
     p_sys->cookies = saved_cookies;
+    p_sys->p_parallel = NULL;
 
     http_auth_Init( &p_sys->auth );
     http_auth_Init( &p_sys->proxy_auth );
@@ -588,6 +615,7 @@ connect:
         p_access->psz_location = strdup( p_sys->psz_location
                                        + strlen( psz_protocol ) + 3 );
         /* Clean up current Open() run */
+        Disconnect( p_access );
         vlc_UrlClean( &p_sys->url );
         http_auth_Reset( &p_sys->auth );
         vlc_UrlClean( &p_sys->proxy );
@@ -599,7 +627,6 @@ connect:
         free( p_sys->psz_user_agent );
         free( p_sys->psz_referrer );
 
-        Disconnect( p_access );
         vlc_tls_Delete( p_sys->p_creds );
         cookies = p_sys->cookies;
 #ifdef HAVE_ZLIB_H
@@ -680,9 +707,14 @@ connect:
 
     if( p_sys->b_reconnect ) msg_Dbg( p_access, "auto re-connect enabled" );
 
+    unsigned i_connections = var_InheritInteger( p_access, "http-connections" );
+    if( i_connections > 1 )
+        ParallelStart( p_access, __MIN( i_connections, 16 ) );
+
     return VLC_SUCCESS;
 
 error:
+    Disconnect( p_access );
     vlc_UrlClean( &p_sys->url );
     vlc_UrlClean( &p_sys->proxy );
     free( p_sys->psz_proxy_passbuf );
@@ -692,7 +724,6 @@ error:
     free( p_sys->psz_user_agent );
     free( p_sys->psz_referrer );
 
-    Disconnect( p_access );
     vlc_tls_Delete( p_sys->p_creds );
 
     if( p_sys->cookies )
@@ -718,6 +749,9 @@ static void Close( vlc_object_t *p_this )
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *p_sys = p_access->p_sys;
 
+    if( p_sys->p_parallel )
+        ParallelStop( p_access );
+    Disconnect( p_access );
     vlc_UrlClean( &p_sys->url );
     http_auth_Reset( &p_sys->auth );
     vlc_UrlClean( &p_sys->proxy );
@@ -734,7 +768,6 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->psz_user_agent );
     free( p_sys->psz_referrer );
 
-    Disconnect( p_access );
     vlc_tls_Delete( p_sys->p_creds );
 
     if( p_sys->cookies )
@@ -1010,15 +1043,70 @@ static ssize_t ReadCompressed( access_t *p_access, uint8_t *p_buffer,
 }
 #endif
 
+/* Reading this much is cheaper than sending a new request */
+#define HTTP_SKIP_MAX (64 * 1024)
+
+/* Skip forward to i_pos within the current response */
+static int Skip( access_t *p_access, uint64_t i_pos )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint8_t p_buffer[4096];
+
+    if( p_sys->fd == -1 || i_pos < p_access->info.i_pos
+     || i_pos - p_access->info.i_pos > HTTP_SKIP_MAX )
+        return VLC_EGENERIC;
+#ifdef HAVE_ZLIB_H
+    if( p_sys->b_compressed )
+        return VLC_EGENERIC;
+#endif
+    if( p_sys->b_has_size
+     && i_pos - p_access->info.i_pos > p_sys->i_remaining )
+        return VLC_EGENERIC;
+
+    while( p_access->info.i_pos < i_pos )
+    {
+        uint64_t i_len = __MIN( i_pos - p_access->info.i_pos,
+                                sizeof( p_buffer ) );
+
+        if( Read( p_access, p_buffer, i_len ) <= 0 )
+        {
+            p_access->info.b_eof = false;
+            return VLC_EGENERIC;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+/* Read the end of the current response so that the connection can carry
+ * the next request */
+static int Drain( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint8_t p_buffer[4096];
+
+    if( p_sys->fd == -1 || !p_sys->b_persist || !p_sys->b_has_size
+     || p_sys->b_chunked || p_sys->i_remaining > HTTP_SKIP_MAX )
+        return VLC_EGENERIC;
+
+    while( p_sys->i_remaining > 0 )
+    {
+        int i_read = net_Read( p_access, p_sys->fd, p_sys->p_vs, p_buffer,
+                               __MIN( p_sys->i_remaining, sizeof( p_buffer ) ),
+                               false );
+        if( i_read <= 0 )
+            return VLC_EGENERIC;
+        p_sys->i_remaining -= i_read;
+    }
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
- * Seek: close and re-open a connection at the right place
+ * Seek: reuse the connection if possible, or re-open one at the right place
  *****************************************************************************/
 static int Seek( access_t *p_access, uint64_t i_pos )
 {
     msg_Dbg( p_access, "trying to seek to %"PRId64, i_pos );
 
-    Disconnect( p_access );
-
     if( p_access->info.i_size
      && i_pos >= p_access->info.i_size ) {
         msg_Err( p_access, "seek to far" );
@@ -1030,6 +1118,19 @@ static int Seek( access_t *p_access, uint64_t i_pos )
         }
         return retval;
     }
+
+    if( Skip( p_access, i_pos ) == VLC_SUCCESS )
+        return VLC_SUCCESS;
+
+    if( Drain( p_access ) == VLC_SUCCESS )
+    {
+        Reset( p_access, i_pos );
+        if( Request( p_access, i_pos ) == VLC_SUCCESS )
+            return VLC_SUCCESS;
+        msg_Dbg( p_access, "persistent connection lost, reconnecting" );
+    }
+
+    Disconnect( p_access );
     if( Connect( p_access, i_pos ) )
     {
         msg_Err( p_access, "seek failed" );
@@ -1113,14 +1214,12 @@ static int Control( access_t *p_access, int i_query, va_list args )
 }
 
 /*****************************************************************************
- * Connect:
+ * Reset: clean the information of the previous response
  *****************************************************************************/
-static int Connect( access_t *p_access, uint64_t i_tell )
+static void Reset( access_t *p_access, uint64_t i_tell )
 {
     access_sys_t   *p_sys = p_access->p_sys;
-    vlc_url_t      srv = p_sys->b_proxy ? p_sys->proxy : p_sys->url;
 
-    /* Clean info */
     free( p_sys->psz_location );
     free( p_sys->psz_mime );
     free( p_sys->psz_pragma );
@@ -1147,9 +1246,35 @@ static int Connect( access_t *p_access, uint64_t i_tell )
     p_access->info.i_size = 0;
     p_access->info.i_pos  = i_tell;
     p_access->info.b_eof  = false;
+}
 
-    /* Open connection */
+/*****************************************************************************
+ * Connect:
+ *****************************************************************************/
+static int Connect( access_t *p_access, uint64_t i_tell )
+{
+    access_sys_t   *p_sys = p_access->p_sys;
+    vlc_url_t      srv = p_sys->b_proxy ? p_sys->proxy : p_sys->url;
+
+    Reset( p_access, i_tell );
+
+    /* Reuse an idle connection from a previous request to the same server */
     assert( p_sys->fd == -1 ); /* No open sockets (leaking fds is BAD) */
+    if( p_sys->p_creds == NULL )
+    {
+        p_sys->fd = ConnectionGet( &srv );
+        if( p_sys->fd != -1 )
+        {
+            msg_Dbg( p_access, "reusing connection to %s:%d",
+                     srv.psz_host, srv.i_port );
+            if( Request( p_access, i_tell ) == VLC_SUCCESS )
+                return 0;
+            /* The server may have closed it in the meantime */
+            Reset( p_access, i_tell );
+        }
+    }
+
+    /* Open connection */
     p_sys->fd = net_ConnectTCP( p_access, srv.psz_host, srv.i_port );
     if( p_sys->fd == -1 )
     {
@@ -1245,6 +1370,7 @@ static int Request( access_t *p_access, uint64_t i_tell )
     v_socket_t     *pvs = p_sys->p_vs;
     p_sys->b_persist = false;
 
+    p_sys->i_code = 0;
     p_sys->i_remaining = 0;
 
     const char *psz_path = p_sys->url.psz_path;
@@ -1273,40 +1399,16 @@ static int Request( access_t *p_access, uint64_t i_tell )
         net_Printf( p_access, p_sys->fd, pvs, "Referer: %s\r\n",
                     p_sys->psz_referrer);
     }
-    /* Offset */
+    /* Offset, the connection is kept open for the next seek */
     if( p_sys->i_version == 1 && ! p_sys->b_continuous )
     {
         p_sys->b_persist = true;
         net_Printf( p_access, p_sys->fd, pvs,
                     "Range: bytes=%"PRIu64"-\r\n", i_tell );
-        net_Printf( p_access, p_sys->fd, pvs, "Connection: close\r\n" );
     }
 
     /* Cookies */
-    if( p_sys->cookies )
-    {
-        int i;
-        for( i = 0; i < vlc_array_count( p_sys->cookies ); i++ )
-        {
-            const char * cookie = vlc_array_item_at_index( p_sys->cookies, i );
-            char * psz_cookie_content = cookie_get_content( cookie );
-            char * psz_cookie_domain = cookie_get_domain( cookie );
-
-            assert( psz_cookie_content );
-
-            /* FIXME: This is clearly not conforming to the rfc */
-            bool is_in_right_domain = (!psz_cookie_domain || strstr( p_sys->url.psz_host, psz_cookie_domain ));
-
-            if( is_in_right_domain )
-            {
-                msg_Dbg( p_access, "Sending Cookie %s", psz_cookie_content );
-                if( net_Printf( p_access, p_sys->fd, pvs, "Cookie: %s\r\n", psz_cookie_content ) < 0 )
-                    msg_Err( p_access, "failed to send Cookie" );
-            }
-            free( psz_cookie_content );
-            free( psz_cookie_domain );
-        }
-    }
+    SendCookies( p_access, p_sys->fd, pvs );
 
     /* Authentication */
     if( p_sys->url.psz_username || p_sys->url.psz_password )
@@ -1337,12 +1439,15 @@ static int Request( access_t *p_access, uint64_t i_tell )
     {
         p_sys->psz_protocol = "HTTP";
         p_sys->i_code = atoi( &psz[9] );
+        if( psz[7] == '0' )
+            p_sys->b_persist = false;
     }
     else if( !strncmp( psz, "ICY", 3 ) )
     {
         p_sys->psz_protocol = "ICY";
         p_sys->i_code = atoi( &psz[4] );
         p_sys->b_reconnect = true;
+        p_sys->b_persist = false;
     }
     else
     {
@@ -1623,15 +1728,10 @@ static int Request( access_t *p_access, uint64_t i_tell )
 
         free( psz );
     }
-    /* We close the stream for zero length data, unless of course the
-     * server has already promised to do this for us.
-     */
-    if( p_sys->b_has_size && p_sys->i_remaining == 0 && p_sys->b_persist ) {
-        Disconnect( p_access );
-    }
     return VLC_SUCCESS;
 
 error:
+    p_sys->b_persist = false;
     Disconnect( p_access );
     return VLC_EGENERIC;
 }
@@ -1643,6 +1743,16 @@ static void Disconnect( access_t *p_access )
 {
     access_sys_t *p_sys = p_access->p_sys;
 
+    /* Keep the connection for the next instance if the response is over.
+     * TLS sessions belong to the credentials of this instance. */
+    if( p_sys->fd != -1 && p_sys->p_tls == NULL && p_sys->b_persist
+     && p_sys->b_has_size && !p_sys->b_chunked && p_sys->i_remaining == 0 )
+    {
+        ConnectionPut( p_sys->b_proxy ? &p_sys->proxy : &p_sys->url,
+                       p_sys->fd );
+        p_sys->fd = -1;
+    }
+
     if( p_sys->p_tls != NULL)
     {
         vlc_tls_SessionDelete( p_sys->p_tls );
@@ -1657,11 +1767,685 @@ static void Disconnect( access_t *p_access )
 
 }
 
+/*****************************************************************************
+ * Idle connections cache
+ *****************************************************************************/
+#define HTTP_IDLE_MAX     4
+#define HTTP_IDLE_TIMEOUT (15 * CLOCK_FREQ)
+
+static struct
+{
+    char     *psz_host;
+    unsigned i_port;
+    int      fd;
+    mtime_t  i_date;
+} idle[HTTP_IDLE_MAX];
+static unsigned i_idle = 0;
+static vlc_mutex_t idle_lock = VLC_STATIC_MUTEX;
+
+static void ConnectionRemove( unsigned i )
+{
+    free( idle[i].psz_host );
+    idle[i] = idle[--i_idle];
+}
+
+/* Returns an idle connection to the server, or -1 */
+static int ConnectionGet( const vlc_url_t *srv )
+{
+    const mtime_t now = mdate();
+    int fd = -1;
+
+    vlc_mutex_lock( &idle_lock );
+    for( unsigned i = 0; i < i_idle; )
+    {
+        if( idle[i].i_date + HTTP_IDLE_TIMEOUT < now )
+        {
+            net_Close( idle[i].fd );
+            ConnectionRemove( i );
+            continue;
+        }
+        if( fd == -1 && idle[i].i_port == srv->i_port
+         && !strcasecmp( idle[i].psz_host, srv->psz_host ) )
+        {
+            fd = idle[i].fd;
+            ConnectionRemove( i );
+            continue;
+        }
+        i++;
+    }
+    vlc_mutex_unlock( &idle_lock );
+
+#ifdef HAVE_POLL
+    /* Nothing is expected until the next request: data here means that
+     * the server closed the connection (or sent garbage) */
+    if( fd != -1 )
+    {
+        struct pollfd ufd = { .fd = fd, .events = POLLIN };
+
+        if( poll( &ufd, 1, 0 ) != 0 )
+        {
+            net_Close( fd );
+            fd = -1;
+        }
+    }
+#endif
+    return fd;
+}
+
+static void ConnectionPut( const vlc_url_t *srv, int fd )
+{
+    char *psz_host = srv->psz_host ? strdup( srv->psz_host ) : NULL;
+
+    if( psz_host == NULL )
+    {
+        net_Close( fd );
+        return;
+    }
+
+    vlc_mutex_lock( &idle_lock );
+    if( i_idle == HTTP_IDLE_MAX )
+    {
+        /* Drop the oldest one */
+        unsigned i_oldest = 0;
+        for( unsigned i = 1; i < i_idle; i++ )
+            if( idle[i].i_date < idle[i_oldest].i_date )
+                i_oldest = i;
+        net_Close( idle[i_oldest].fd );
+        ConnectionRemove( i_oldest );
+    }
+    idle[i_idle].psz_host = psz_host;
+    idle[i_idle].i_port = srv->i_port;
+    idle[i_idle].fd = fd;
+    idle[i_idle].i_date = mdate();
+    i_idle++;
+    vlc_mutex_unlock( &idle_lock );
+}
+
+/*****************************************************************************
+ * Parallel download: the workers download consecutive parts of the file
+ * with their own connection, Read() consumes the parts in order.
+ *****************************************************************************/
+#define HTTP_PART_SIZE  (1 << 20)
+#define HTTP_PART_RETRY 3
+
+typedef struct
+{
+    uint64_t i_start;   /* Offset of the part in the file */
+    size_t   i_size;    /* 0 if the slot is free */
+    size_t   i_done;    /* Bytes downloaded so far */
+    unsigned i_gen;     /* Changed each time the slot is freed */
+    uint8_t  *p_data;
+} http_part_t;
+
+typedef struct
+{
+    access_t     *p_access;
+    vlc_thread_t thread;
+    unsigned     i_index;
+    int          fd;
+    vlc_tls_t    *p_tls;
+    bool         b_persist;
+    bool         b_idle;    /* No response pending on the connection */
+    char         psz_line[1024];
+    uint8_t      p_buffer[32768];
+} http_worker_t;
+
+struct http_parallel_t
+{
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait;
+
+    uint64_t     i_size;    /* Size of the file */
+    uint64_t     i_next;    /* Offset of the next part to download */
+    bool         b_error;
+
+    /* Ring of the parts, in file order from i_first */
+    http_part_t  *p_parts;
+    unsigned     i_parts;
+    unsigned     i_first;
+    unsigned     i_assigned;
+
+    /* Throughput measured while Read() had to wait */
+    unsigned     i_active;
+    bool         b_grown;
+    bool         b_starved;
+    uint64_t     i_rate;
+    uint64_t     i_window_bytes;
+    unsigned     i_window_parts;
+    mtime_t      i_window_start;
+
+    unsigned     i_workers;
+    http_worker_t worker[];
+};
+
+static void PartDisconnect( http_worker_t *w )
+{
+    access_sys_t *p_sys = w->p_access->p_sys;
+
+    if( w->fd == -1 )
+        return;
+    if( w->b_idle && w->b_persist && w->p_tls == NULL )
+        ConnectionPut( p_sys->b_proxy ? &p_sys->proxy : &p_sys->url, w->fd );
+    else
+    {
+        if( w->p_tls != NULL )
+            vlc_tls_SessionDelete( w->p_tls );
+        net_Close( w->fd );
+    }
+    w->p_tls = NULL;
+    w->fd = -1;
+}
+
+static int PartConnect( http_worker_t *w )
+{
+    access_t *p_access = w->p_access;
+    access_sys_t *p_sys = p_access->p_sys;
+    const vlc_url_t *srv = p_sys->b_proxy ? &p_sys->proxy : &p_sys->url;
+
+    w->b_idle = true;
+    w->b_persist = true;
+    if( p_sys->p_creds == NULL )
+    {
+        w->fd = ConnectionGet( srv );
+        if( w->fd != -1 )
+            return VLC_SUCCESS;
+    }
+
+    w->fd = net_ConnectTCP( p_access, srv->psz_host, srv->i_port );
+    if( w->fd == -1 )
+        return VLC_EGENERIC;
+    setsockopt( w->fd, SOL_SOCKET, SO_KEEPALIVE, &(int){ 1 }, sizeof (int) );
+
+    if( p_sys->p_creds != NULL )
+    {
+        w->p_tls = vlc_tls_ClientSessionCreate( p_sys->p_creds, w->fd,
+                                                p_sys->url.psz_host, "https" );
+        if( w->p_tls == NULL )
+        {
+            net_Close( w->fd );
+            w->fd = -1;
+            return VLC_EGENERIC;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+/* Like net_Gets() but without allocation, so that it can be cancelled */
+static char *PartGets( http_worker_t *w )
+{
+    const v_socket_t *pvs = w->p_tls ? &w->p_tls->sock : NULL;
+    size_t i_line = 0;
+
+    for( ;; )
+    {
+        char c;
+
+        if( net_Read( w->p_access, w->fd, pvs, &c, 1, true ) != 1 )
+            return NULL;
+        if( c == '\n' )
+            break;
+        if( i_line < sizeof( w->psz_line ) - 1 )
+            w->psz_line[i_line++] = c;
+    }
+    if( i_line > 0 && w->psz_line[i_line - 1] == '\r' )
+        i_line--;
+    w->psz_line[i_line] = '\0';
+    return w->psz_line;
+}
+
+/* Sends the request for the bytes i_start to i_end and reads the answer */
+static int PartRequest( http_worker_t *w, uint64_t i_start, uint64_t i_end )
+{
+    access_t *p_access = w->p_access;
+    access_sys_t *p_sys = p_access->p_sys;
+    const v_socket_t *pvs = w->p_tls ? &w->p_tls->sock : NULL;
+    char *psz;
+
+    const char *psz_path = p_sys->url.psz_path;
+    if( !psz_path || !*psz_path )
+        psz_path = "/";
+
+    int canc = vlc_savecancel();
+    w->b_idle = false;
+    if( p_sys->b_proxy && pvs == NULL )
+        net_Printf( p_access, w->fd, NULL,
+                    "GET http://%s:%d%s HTTP/1.1\r\n",
+                    p_sys->url.psz_host, p_sys->url.i_port, psz_path );
+    else
+        net_Printf( p_access, w->fd, pvs, "GET %s HTTP/1.1\r\n", psz_path );
+    if( p_sys->url.i_port != (pvs ? 443 : 80) )
+        net_Printf( p_access, w->fd, pvs, "Host: %s:%d\r\n",
+                    p_sys->url.psz_host, p_sys->url.i_port );
+    else
+        net_Printf( p_access, w->fd, pvs, "Host: %s\r\n",
+                    p_sys->url.psz_host );
+    net_Printf( p_access, w->fd, pvs, "User-Agent: %s\r\n",
+                p_sys->psz_user_agent );
+    if( p_sys->psz_referrer )
+        net_Printf( p_access, w->fd, pvs, "Referer: %s\r\n",
+                    p_sys->psz_referrer );
+    net_Printf( p_access, w->fd, pvs,
+                "Range: bytes=%"PRIu64"-%"PRIu64"\r\n", i_start, i_end );
+    SendCookies( p_access, w->fd, pvs );
+    ssize_t i_ret = net_Printf( p_access, w->fd, pvs, "\r\n" );
+    vlc_restorecancel( canc );
+    if( i_ret < 0 )
+        return VLC_EGENERIC;
+
+    if( ( psz = PartGets( w ) ) == NULL || strncmp( psz, "HTTP/1.", 7 )
+     || strlen( psz ) < 12 || atoi( &psz[9] ) != 206 )
+    {
+        msg_Dbg( p_access, "unexpected range answer: %s", psz ? psz : "none" );
+        return VLC_EGENERIC;
+    }
+    w->b_persist = psz[7] != '0';
+
+    uint64_t i_length = UINT64_MAX;
+    while( ( psz = PartGets( w ) ) != NULL && *psz )
+    {
+        char *p = strchr( psz, ':' );
+        if( p == NULL )
+            return VLC_EGENERIC;
+        *p++ = '\0';
+        p += strspn( p, " \t" );
+
+        if( !strcasecmp( psz, "Content-Length" ) )
+            i_length = strtoull( p, NULL, 10 );
+        else if( !strcasecmp( psz, "Connection" ) && !strncasecmp( p, "close", 5 ) )
+            w->b_persist = false;
+        else if( !strcasecmp( psz, "Transfer-Encoding" ) )
+            return VLC_EGENERIC;
+    }
+    if( psz == NULL || i_length != i_end - i_start + 1 )
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+
+/* Called when a part is complete, with the lock held */
+static void PartAdapt( access_t *p_access, http_parallel_t *p )
+{
+    if( ++p->i_window_parts < 2 * p->i_active )
+        return;
+
+    const mtime_t now = mdate();
+    if( p->b_starved )
+    {
+        uint64_t i_rate = p->i_window_bytes * CLOCK_FREQ
+                        / ( now - p->i_window_start + 1 );
+        bool b_grown = false;
+
+        if( i_rate > p->i_rate + p->i_rate / 8 && p->i_active < p->i_workers )
+        {
+            p->i_active++;
+            b_grown = true;
+        }
+        else if( p->b_grown && i_rate + i_rate / 8 < p->i_rate )
+        {
+            /* The last connection made it worse: remove it, and keep the
+             * previous rate as the reference */
+            p->i_active--;
+            i_rate = p->i_rate;
+        }
+        if( b_grown || i_rate != p->i_rate )
+            msg_Dbg( p_access, "%"PRIu64" kB/s, using %u connection(s)",
+                     i_rate / 1000, p->i_active );
+        p->b_grown = b_grown;
+        p->i_rate = i_rate;
+        vlc_cond_broadcast( &p->wait );
+    }
+    p->b_starved = false;
+    p->i_window_bytes = 0;
+    p->i_window_parts = 0;
+    p->i_window_start = now;
+}
+
+/* Downloads the rest of a part, returns false if it must be retried */
+static bool PartDownload( http_worker_t *w, http_part_t *part, unsigned i_gen )
+{
+    access_t *p_access = w->p_access;
+    http_parallel_t *p = p_access->p_sys->p_parallel;
+
+    vlc_mutex_lock( &p->lock );
+    bool b_stale = part->i_gen != i_gen;
+    uint64_t i_start = part->i_start + part->i_done;
+    uint64_t i_end = part->i_start + part->i_size - 1;
+    vlc_mutex_unlock( &p->lock );
+    if( b_stale )
+        return true;
+
+    if( w->fd == -1 )
+    {
+        int canc = vlc_savecancel();
+        int i_ret = PartConnect( w );
+        vlc_restorecancel( canc );
+        if( i_ret )
+            return false;
+    }
+    if( PartRequest( w, i_start, i_end ) )
+    {
+        PartDisconnect( w );
+        return false;
+    }
+
+    const v_socket_t *pvs = w->p_tls ? &w->p_tls->sock : NULL;
+    uint64_t i_remaining = i_end + 1 - i_start;
+    while( i_remaining > 0 )
+    {
+        ssize_t i_read = net_Read( p_access, w->fd, pvs, w->p_buffer,
+                                   __MIN( i_remaining, sizeof( w->p_buffer ) ),
+                                   false );
+        if( i_read <= 0 )
+        {
+            PartDisconnect( w );
+            return false;
+        }
+        i_remaining -= i_read;
+
+        vlc_mutex_lock( &p->lock );
+        if( part->i_gen != i_gen )
+        {
+            /* Seek: the rest of the response is not wanted anymore */
+            vlc_mutex_unlock( &p->lock );
+            PartDisconnect( w );
+            return true;
+        }
+        memcpy( &part->p_data[part->i_done], w->p_buffer, i_read );
+        part->i_done += i_read;
+        p->i_window_bytes += i_read;
+        if( part->i_done == part->i_size )
+            PartAdapt( p_access, p );
+        vlc_cond_broadcast( &p->wait );
+        vlc_mutex_unlock( &p->lock );
+    }
+
+    w->b_idle = true;
+    if( !w->b_persist )
+        PartDisconnect( w );
+    return true;
+}
+
+static void *PartThread( void *data )
+{
+    http_worker_t *w = data;
+    access_t *p_access = w->p_access;
+    http_parallel_t *p = p_access->p_sys->p_parallel;
+
+    for( ;; )
+    {
+        http_part_t *part;
+        unsigned i_gen;
+
+        vlc_mutex_lock( &p->lock );
+        mutex_cleanup_push( &p->lock );
+        while( w->i_index >= p->i_active || p->i_assigned == p->i_parts
+            || p->i_next >= p->i_size )
+            vlc_cond_wait( &p->wait, &p->lock );
+
+        part = &p->p_parts[(p->i_first + p->i_assigned++) % p->i_parts];
+        part->i_start = p->i_next;
+        part->i_size = __MIN( p->i_size - p->i_next, HTTP_PART_SIZE );
+        part->i_done = 0;
+        i_gen = part->i_gen;
+        p->i_next += part->i_size;
+        vlc_cleanup_run();
+
+        unsigned i_retry = 0;
+        while( !PartDownload( w, part, i_gen ) )
+        {
+            if( ++i_retry > HTTP_PART_RETRY || !vlc_object_alive( p_access ) )
+            {
+                msg_Err( p_access, "cannot download range at %"PRIu64,
+                         part->i_start );
+                vlc_mutex_lock( &p->lock );
+                p->b_error = true;
+                vlc_cond_broadcast( &p->wait );
+                vlc_mutex_unlock( &p->lock );
+                return NULL;
+            }
+            msg_Dbg( p_access, "retrying range at %"PRIu64, part->i_start );
+        }
+    }
+    return NULL;
+}
+
+/* Frees the slot of the first part, with the lock held */
+static void PartRelease( http_parallel_t *p )
+{
+    http_part_t *part = &p->p_parts[p->i_first];
+
+    part->i_size = 0;
+    part->i_gen++;
+    p->i_first = (p->i_first + 1) % p->i_parts;
+    p->i_assigned--;
+}
+
+static ssize_t ReadParallel( access_t *p_access, uint8_t *p_buffer,
+                             size_t i_len )
+{
+    http_parallel_t *p = p_access->p_sys->p_parallel;
+    const uint64_t i_pos = p_access->info.i_pos;
+    http_part_t *part;
+
+    if( i_pos >= p->i_size )
+    {
+        p_access->info.b_eof = true;
+        return 0;
+    }
+
+    vlc_mutex_lock( &p->lock );
+    for( ;; )
+    {
+        part = &p->p_parts[p->i_first];
+        if( p->i_assigned > 0 && i_pos < part->i_start + part->i_done )
+            break;
+        if( p->b_error || !vlc_object_alive( p_access ) )
+        {
+            vlc_mutex_unlock( &p->lock );
+            p_access->info.b_eof = true;
+            return 0;
+        }
+        p->b_starved = true;
+        vlc_cond_timedwait( &p->wait, &p->lock, mdate() + CLOCK_FREQ / 10 );
+    }
+    assert( i_pos >= part->i_start );
+    size_t i_avail = part->i_start + part->i_done - i_pos;
+    vlc_mutex_unlock( &p->lock );
+
+    /* The workers only ever append to the part */
+    if( i_len > i_avail )
+        i_len = i_avail;
+    memcpy( p_buffer, &part->p_data[i_pos - part->i_start], i_len );
+    p_access->info.i_pos += i_len;
+
+    if( p_access->info.i_pos == part->i_start + part->i_size )
+    {
+        vlc_mutex_lock( &p->lock );
+        PartRelease( p );
+        vlc_cond_broadcast( &p->wait );
+        vlc_mutex_unlock( &p->lock );
+    }
+    return i_len;
+}
+
+static int SeekParallel( access_t *p_access, uint64_t i_pos )
+{
+    http_parallel_t *p = p_access->p_sys->p_parallel;
+
+    vlc_mutex_lock( &p->lock );
+    /* Keep the parts after the new position */
+    while( p->i_assigned > 0 )
+    {
+        http_part_t *part = &p->p_parts[p->i_first];
+
+        if( i_pos >= part->i_start && i_pos < part->i_start + part->i_size )
+            break;
+        if( i_pos < part->i_start )
+            while( p->i_assigned > 0 )
+                PartRelease( p );
+        else
+            PartRelease( p );
+    }
+    if( p->i_assigned == 0 )
+    {
+        p->i_first = 0;
+        p->i_next = i_pos;
+    }
+    vlc_cond_broadcast( &p->wait );
+    vlc_mutex_unlock( &p->lock );
+
+    p_access->info.i_pos = i_pos;
+    p_access->info.b_eof = false;
+    return VLC_SUCCESS;
+}
+
+static int ParallelStart( access_t *p_access, unsigned i_connections )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    /* Only plain ranges of a file can be split */
+    if( !p_sys->b_seekable || !p_sys->b_has_size || p_sys->i_code != 206
+     || p_sys->b_chunked || p_sys->i_icy_meta > 0 || p_sys->b_continuous
+     || p_access->info.i_size <= HTTP_PART_SIZE )
+        return VLC_EGENERIC;
+#ifdef HAVE_ZLIB_H
+    if( p_sys->b_compressed )
+        return VLC_EGENERIC;
+#endif
+    /* The authentication state and the TLS tunnel belong to the main
+     * connection */
+    if( p_sys->url.psz_username || p_sys->url.psz_password
+     || p_sys->proxy.psz_username || p_sys->proxy.psz_password
+     || ( p_sys->b_proxy && p_sys->p_creds != NULL ) )
+        return VLC_EGENERIC;
+
+    http_parallel_t *p = malloc( sizeof( *p )
+                               + i_connections * sizeof( p->worker[0] ) );
+    if( unlikely(p == NULL) )
+        return VLC_ENOMEM;
+
+    /* Two parts per connection: one being read, one being downloaded */
+    p->i_parts = 2 * i_connections;
+    p->p_parts = calloc( p->i_parts, sizeof( *p->p_parts ) );
+    if( unlikely(p->p_parts == NULL) )
+    {
+        free( p );
+        return VLC_ENOMEM;
+    }
+    for( unsigned i = 0; i < p->i_parts; i++ )
+    {
+        p->p_parts[i].p_data = malloc( HTTP_PART_SIZE );
+        if( unlikely(p->p_parts[i].p_data == NULL) )
+        {
+            while( i > 0 )
+                free( p->p_parts[--i].p_data );
+            free( p->p_parts );
+            free( p );
+            return VLC_ENOMEM;
+        }
+    }
+
+    vlc_mutex_init( &p->lock );
+    vlc_cond_init( &p->wait );
+    p->i_size = p_access->info.i_size;
+    p->i_next = p_access->info.i_pos;
+    p->b_error = false;
+    p->i_first = 0;
+    p->i_assigned = 0;
+    p->i_active = 1;
+    p->b_grown = false;
+    p->b_starved = false;
+    p->i_rate = 0;
+    p->i_window_bytes = 0;
+    p->i_window_parts = 0;
+    p->i_window_start = mdate();
+    p->i_workers = 0;
+    p_sys->p_parallel = p;
+
+    for( unsigned i = 0; i < i_connections; i++ )
+    {
+        http_worker_t *w = &p->worker[i];
+
+        w->p_access = p_access;
+        w->i_index = i;
+        w->fd = -1;
+        w->p_tls = NULL;
+        w->b_persist = false;
+        w->b_idle = true;
+        if( vlc_clone( &w->thread, PartThread, w, VLC_THREAD_PRIORITY_INPUT ) )
+            break;
+        p->i_workers++;
+    }
+    if( p->i_workers == 0 )
+    {
+        ParallelStop( p_access );
+        return VLC_EGENERIC;
+    }
+
+    /* The workers download everything from now on */
+    Disconnect( p_access );
+    p_access->pf_read = ReadParallel;
+    p_access->pf_seek = SeekParallel;
+    msg_Dbg( p_access, "downloading with up to %u connections",
+             p->i_workers );
+    return VLC_SUCCESS;
+}
+
+static void ParallelStop( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    http_parallel_t *p = p_sys->p_parallel;
+
+    for( unsigned i = 0; i < p->i_workers; i++ )
+        vlc_cancel( p->worker[i].thread );
+    for( unsigned i = 0; i < p->i_workers; i++ )
+    {
+        vlc_join( p->worker[i].thread, NULL );
+        PartDisconnect( &p->worker[i] );
+    }
+
+    for( unsigned i = 0; i < p->i_parts; i++ )
+        free( p->p_parts[i].p_data );
+    free( p->p_parts );
+    vlc_cond_destroy( &p->wait );
+    vlc_mutex_destroy( &p->lock );
+    free( p );
+    p_sys->p_parallel = NULL;
+}
+
 /*****************************************************************************
  * Cookies (FIXME: we may want to rewrite that using a nice structure to hold
  * them) (FIXME: only support the "domain=" param)
  *****************************************************************************/
 
+static void SendCookies( access_t *p_access, int fd, const v_socket_t *pvs )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( !p_sys->cookies )
+        return;
+
+    for( int i = 0; i < vlc_array_count( p_sys->cookies ); i++ )
+    {
+        const char * cookie = vlc_array_item_at_index( p_sys->cookies, i );
+        char * psz_cookie_content = cookie_get_content( cookie );
+        char * psz_cookie_domain = cookie_get_domain( cookie );
+
+        assert( psz_cookie_content );
+
+        /* FIXME: This is clearly not conforming to the rfc */
+        bool is_in_right_domain = (!psz_cookie_domain || strstr( p_sys->url.psz_host, psz_cookie_domain ));
+
+        if( is_in_right_domain )
+        {
+            msg_Dbg( p_access, "Sending Cookie %s", psz_cookie_content );
+            if( net_Printf( p_access, fd, pvs, "Cookie: %s\r\n", psz_cookie_content ) < 0 )
+                msg_Err( p_access, "failed to send Cookie" );
+        }
+        free( psz_cookie_content );
+        free( psz_cookie_domain );
+    }
+}
+
 /* Get the NAME=VALUE part of the Cookie */
 static char * cookie_get_content( const char * cookie )
 {
@@ -36,6 +36,7 @@
 #include <vlc_access.h>
 #include <vlc_demux.h>
 #include <vlc_charset.h>
+#include <vlc_atomic.h>
 
 /*****************************************************************************
  * Module descriptior
@@ -110,6 +111,15 @@ static const char *cat_texts[] = {
 #define RELEASE_LONGTEXT N_(\
     "Address of the release callback function")
 
+#define GET_BATCH_TEXT N_("Batched get function")
+#define GET_BATCH_LONGTEXT N_(\
+    "Address of the callback function getting several buffers at once")
+
+#define LEND_TEXT N_("Use the buffers without copying them")
+#define LEND_LONGTEXT N_(\
+    "The buffers are released only when VLC does not need them anymore, " \
+    "instead of being copied")
+
 #define SIZE_TEXT N_("Size")
 #define SIZE_LONGTEXT N_(\
     "Size of stream in bytes")
@@ -124,6 +134,10 @@ vlc_module_begin()
         change_volatile()
     add_string ("imem-release", "0", RELEASE_TEXT, RELEASE_LONGTEXT, true)
         change_volatile()
+    add_string ("imem-get-batch", "0", GET_BATCH_TEXT, GET_BATCH_LONGTEXT, true)
+        change_volatile()
+    add_bool   ("imem-lend", false, LEND_TEXT, LEND_LONGTEXT, true)
+        change_volatile()
     add_string ("imem-cookie", NULL, COOKIE_TEXT, COOKIE_LONGTEXT, true)
         change_volatile()
         change_safe()
@@ -195,6 +209,27 @@ typedef int  (*imem_get_t)(void *data, const char *cookie,
                            size_t *, void **);
 typedef void (*imem_release_t)(void *data, const char *cookie, size_t, void *);
 
+/* The batched get function fills up to max buffers at once, each one as
+ * the get function would, and returns how many it filled. 0 or less means
+ * the end of the stream. It is used instead of get if set.
+ *
+ * With imem-lend, the buffers are released when VLC is done with them, which
+ * can be much later, from any thread, in any order and after the end of
+ * the stream. VLC may also modify their content meanwhile.
+ */
+typedef struct {
+    int64_t  dts;
+    int64_t  pts;
+    unsigned flags;
+    size_t   size;
+    void    *buffer;
+} imem_buffer_t;
+
+typedef int (*imem_get_batch_t)(void *data, const char *cookie,
+                                unsigned max, imem_buffer_t *);
+
+#define IMEM_BATCH_MAX 32
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -210,6 +245,7 @@ static int ControlDemux(demux_t *, int, va_list);
 typedef struct {
     struct {
         imem_get_t      get;
+        imem_get_batch_t get_batch;
         imem_release_t  release;
         void           *data;
         char           *cookie;
@@ -220,8 +256,18 @@ typedef struct {
     mtime_t      dts;
 
     mtime_t      deadline;
+
+    bool         lend;
+    atomic_uint  refs; /* Lent blocks, plus one for the module */
 } imem_sys_t;
 
+typedef struct {
+    block_t      self;
+    imem_sys_t  *sys;
+    void        *buffer;
+    size_t       size;
+} imem_block_t;
+
 static void ParseMRL(vlc_object_t *, const char *);
 
 /**
@@ -229,10 +275,69 @@ static void ParseMRL(vlc_object_t *, const char *);
  */
 static void CloseCommon(imem_sys_t *sys)
 {
+    /* Lent blocks may still need the callbacks */
+    if (atomic_fetch_sub(&sys->refs, 1) != 1)
+        return;
     free(sys->source.cookie);
     free(sys);
 }
 
+static void ReleaseLentBlock(block_t *block)
+{
+    imem_block_t *lent = (imem_block_t *)block;
+    imem_sys_t *sys = lent->sys;
+
+    sys->source.release(sys->source.data, sys->source.cookie,
+                        lent->size, lent->buffer);
+    free(lent);
+    CloseCommon(sys);
+}
+
+/**
+ * It creates a block from a buffer of the application, and releases the
+ * buffer once copied, or once VLC is done with it if it is lent.
+ */
+static block_t *NewBlock(imem_sys_t *sys, size_t size, void *buffer)
+{
+    block_t *block = NULL;
+
+    if (size > 0 && sys->lend) {
+        imem_block_t *lent = malloc(sizeof(*lent));
+        if (lent) {
+            block_Init(&lent->self, buffer, size);
+            lent->self.pf_release = ReleaseLentBlock;
+            lent->sys    = sys;
+            lent->buffer = buffer;
+            lent->size   = size;
+            atomic_fetch_add(&sys->refs, 1);
+            return &lent->self;
+        }
+    } else if (size > 0) {
+        block = block_Alloc(size);
+        if (block)
+            memcpy(block->p_buffer, buffer, size);
+    }
+
+    sys->source.release(sys->source.data, sys->source.cookie, size, buffer);
+    return block;
+}
+
+/**
+ * It gets up to max buffers, with either get function.
+ */
+static int GetBuffers(imem_sys_t *sys, unsigned max, imem_buffer_t *buffers)
+{
+    if (sys->source.get_batch)
+        return sys->source.get_batch(sys->source.data, sys->source.cookie,
+                                     max, buffers);
+
+    if (sys->source.get(sys->source.data, sys->source.cookie,
+                        &buffers[0].dts, &buffers[0].pts, &buffers[0].flags,
+                        &buffers[0].size, &buffers[0].buffer))
+        return 0;
+    return 1;
+}
+
 /**
  * It initializes the common part for imem access/access_demux.
  */
@@ -256,7 +361,12 @@ static int OpenCommon(vlc_object_t *object, imem_sys_t **sys_ptr, const char *ps
         sys->source.release = (imem_release_t)(intptr_t)strtoll(tmp, NULL, 0);
     free(tmp);
 
-    if (!sys->source.get || !sys->source.release) {
+    tmp = var_InheritString(object, "imem-get-batch");
+    if (tmp)
+        sys->source.get_batch = (imem_get_batch_t)(intptr_t)strtoll(tmp, NULL, 0);
+    free(tmp);
+
+    if ((!sys->source.get && !sys->source.get_batch) || !sys->source.release) {
         msg_Err(object, "Invalid get/release function pointers");
         free(sys);
         return VLC_EGENERIC;
@@ -273,6 +383,8 @@ static int OpenCommon(vlc_object_t *object, imem_sys_t **sys_ptr, const char *ps
         ParseMRL(object, psz_path);
 
     sys->source.cookie = var_InheritString(object, "imem-cookie");
+    sys->lend = var_InheritBool(object, "imem-lend");
+    atomic_init(&sys->refs, 1);
 
     msg_Dbg(object, "Using get(%p), release(%p), data(%p), cookie(%s)",
             sys->source.get, sys->source.release, sys->source.data,
@@ -371,27 +483,21 @@ static int ControlAccess(access_t *access, int i_query, va_list args)
 static block_t *Block(access_t *access)
 {
     imem_sys_t *sys = (imem_sys_t*)access->p_sys;
+    imem_buffer_t buffers[IMEM_BATCH_MAX];
 
-    unsigned flags;
-    size_t buffer_size;
-    void   *buffer;
-
-    if (sys->source.get(sys->source.data, sys->source.cookie,
-                        NULL, NULL, &flags, &buffer_size, &buffer)) {
+    int count = GetBuffers(sys, IMEM_BATCH_MAX, buffers);
+    if (count <= 0) {
         access->info.b_eof = true;
         return NULL;
     }
 
-    block_t *block = NULL;
-    if (buffer_size > 0) {
-        block = block_Alloc(buffer_size);
+    block_t *chain = NULL, **pp_last = &chain;
+    for (int i = 0; i < count; i++) {
+        block_t *block = NewBlock(sys, buffers[i].size, buffers[i].buffer);
         if (block)
-            memcpy(block->p_buffer, buffer, buffer_size);
+            block_ChainLastAppend(&pp_last, block);
     }
-
-    sys->source.release(sys->source.data, sys->source.cookie,
-                        buffer_size, buffer);
-    return block;
+    return chain ? block_ChainGather(chain) : NULL;
 }
 
 /**
@@ -566,39 +672,29 @@ static int Demux(demux_t *demux)
     if (sys->deadline == VLC_TS_INVALID)
         sys->deadline = sys->dts + 1;
 
-    for (;;) {
-        if (sys->deadline <= sys->dts)
-            break;
-
-        /* */
-        int64_t dts, pts;
-        unsigned flags;
-        size_t buffer_size;
-        void   *buffer;
+    while (sys->deadline > sys->dts) {
+        imem_buffer_t buffers[IMEM_BATCH_MAX];
 
-        if (sys->source.get(sys->source.data, sys->source.cookie,
-                            &dts, &pts, &flags, &buffer_size, &buffer))
+        int count = GetBuffers(sys, IMEM_BATCH_MAX, buffers);
+        if (count <= 0)
             return 0;
 
-        if (dts < 0)
-            dts = pts;
+        /* All the buffers are sent, even past the deadline */
+        for (int i = 0; i < count; i++) {
+            int64_t dts = buffers[i].dts, pts = buffers[i].pts;
+            if (dts < 0)
+                dts = pts;
 
-        if (buffer_size > 0) {
-            block_t *block = block_Alloc(buffer_size);
+            block_t *block = NewBlock(sys, buffers[i].size, buffers[i].buffer);
             if (block) {
                 block->i_dts = dts >= 0 ? (1 + dts) : VLC_TS_INVALID;
                 block->i_pts = pts >= 0 ? (1 + pts) : VLC_TS_INVALID;
-                memcpy(block->p_buffer, buffer, buffer_size);
 
                 es_out_Control(demux->out, ES_OUT_SET_PCR, block->i_dts);
                 es_out_Send(demux->out, sys->es, block);
             }
+            sys->dts = dts;
         }
-
-        sys->dts = dts;
-
-        sys->source.release(sys->source.data, sys->source.cookie,
-                            buffer_size, buffer);
     }
     sys->deadline = VLC_TS_INVALID;
     return 1;
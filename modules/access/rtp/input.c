@@ -94,6 +94,9 @@ static int rtp_timeout (mtime_t deadline)
     return t;
 }
 
+/* Maximum datagrams received in a row before dequeuing */
+#define RTP_RECV_BATCH 32
+
 /**
  * RTP/RTCP session thread for datagram sockets
  */
@@ -124,20 +127,30 @@ void *rtp_dgram_thread (void *opaque)
             if (unlikely(ufd[0].revents & POLLHUP))
                 break; /* RTP socket dead (DCCP only) */
 
-            block_t *block = block_Alloc (0xffff); /* TODO: p_sys->mru */
-            if (unlikely(block == NULL))
-                break; /* we are totallly screwed */
-
-            ssize_t len = recv (rtp_fd, block->p_buffer, block->i_buffer, 0);
-            if (len != -1)
+            /* Drain a burst of datagrams before dequeuing them at once */
+            int flags = 0;
+            for (unsigned i = 0; i < RTP_RECV_BATCH; i++)
             {
+                block_t *block = block_Alloc (0xffff); /* TODO: p_sys->mru */
+                if (unlikely(block == NULL))
+                    return NULL; /* we are totallly screwed */
+
+                ssize_t len = recv (rtp_fd, block->p_buffer, block->i_buffer,
+                                    flags);
+                if (len == -1)
+                {
+                    if (flags == 0)
+                        msg_Warn (demux, "RTP network error: %m");
+                    block_Release (block);
+                    break;
+                }
                 block->i_buffer = len;
                 rtp_process (demux, block);
-            }
-            else
-            {
-                msg_Warn (demux, "RTP network error: %m");
-                block_Release (block);
+#ifdef MSG_DONTWAIT
+                flags = MSG_DONTWAIT;
+#else
+                break;
+#endif
             }
         }
 
@@ -76,6 +76,16 @@
     "RTP packets will be discarded if they are too far behind (i.e. in the " \
     "past) by this many packets from the last received packet." )
 
+#define RTP_REORDER_MIN_TEXT N_("Minimum RTP reordering delay (ms)")
+#define RTP_REORDER_MIN_LONGTEXT N_( \
+    "Missing RTP packets are waited for at least this long, " \
+    "whatever the measured network jitter." )
+
+#define RTP_REORDER_MAX_TEXT N_("Maximum RTP reordering delay (ms)")
+#define RTP_REORDER_MAX_LONGTEXT N_( \
+    "Missing RTP packets are waited for three times the measured network " \
+    "jitter, but no longer than this. Zero means no limit." )
+
 #define RTP_DYNAMIC_PT_TEXT N_("RTP payload format assumed for dynamic " \
                                "payloads")
 #define RTP_DYNAMIC_PT_LONGTEXT N_( \
@@ -123,6 +133,12 @@ vlc_module_begin ()
     add_integer ("rtp-max-misorder", 100, RTP_MAX_MISORDER_TEXT,
                  RTP_MAX_MISORDER_LONGTEXT, true)
         change_integer_range (0, 32767)
+    add_integer ("rtp-reorder-min", 25, RTP_REORDER_MIN_TEXT,
+                 RTP_REORDER_MIN_LONGTEXT, true)
+        change_integer_range (0, 60000)
+    add_integer ("rtp-reorder-max", 0, RTP_REORDER_MAX_TEXT,
+                 RTP_REORDER_MAX_LONGTEXT, true)
+        change_integer_range (0, 60000)
     add_string ("rtp-dynamic-pt", NULL, RTP_DYNAMIC_PT_TEXT,
                 RTP_DYNAMIC_PT_LONGTEXT, true)
         change_string_list (dynamic_pt_list, dynamic_pt_list_text)
@@ -265,6 +281,10 @@ static int Open (vlc_object_t *obj)
                         * CLOCK_FREQ;
     p_sys->max_dropout  = var_CreateGetInteger (obj, "rtp-max-dropout");
     p_sys->max_misorder = var_CreateGetInteger (obj, "rtp-max-misorder");
+    p_sys->reorder_min  = var_CreateGetInteger (obj, "rtp-reorder-min")
+                        * (CLOCK_FREQ / 1000);
+    p_sys->reorder_max  = var_CreateGetInteger (obj, "rtp-reorder-max")
+                        * (CLOCK_FREQ / 1000);
     p_sys->thread_ready = false;
     p_sys->autodetect   = true;
 
@@ -55,6 +55,15 @@ bool rtp_dequeue (demux_t *, const rtp_session_t *, mtime_t *);
 void rtp_dequeue_force (demux_t *, const rtp_session_t *);
 int rtp_add_type (demux_t *demux, rtp_session_t *ses, const rtp_pt_t *pt);
 
+/** @section Forward error correction (e.g. SMPTE 2022-1) */
+typedef struct rtp_fec_t
+{
+    void     (*receive) (void *, const block_t *); /* media packet queued */
+    block_t *(*recover) (void *, uint32_t ssrc, uint16_t seq);
+    void     *opaque;
+} rtp_fec_t;
+void rtp_set_fec (rtp_session_t *, const rtp_fec_t *);
+
 void *rtp_dgram_thread (void *data);
 void *rtp_stream_thread (void *data);
 
@@ -71,6 +80,8 @@ struct demux_sys_t
     vlc_thread_t  thread;
 
     mtime_t       timeout;
+    mtime_t       reorder_min; /**< Min wait for a missing packet */
+    mtime_t       reorder_max; /**< Max wait for a missing packet (0: none) */
     uint16_t      max_dropout; /**< Max packet forward misordering */
     uint16_t      max_misorder; /**< Max packet backward misordering */
     uint8_t       max_src; /**< Max simultaneous RTP sources */
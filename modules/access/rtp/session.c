@@ -42,6 +42,7 @@ struct rtp_session_t
     unsigned       srcc;
     uint8_t        ptc;
     rtp_pt_t      *ptv;
+    rtp_fec_t      fec;
 };
 
 static rtp_source_t *
@@ -65,6 +66,9 @@ rtp_session_create (demux_t *demux)
     session->srcc = 0;
     session->ptc = 0;
     session->ptv = NULL;
+    session->fec.receive = NULL;
+    session->fec.recover = NULL;
+    session->fec.opaque = NULL;
 
     (void)demux;
     return session;
@@ -133,11 +137,21 @@ int rtp_add_type (demux_t *demux, rtp_session_t *ses, const rtp_pt_t *pt)
     return 0;
 }
 
+/**
+ * Sets the forward error correction hooks of an RTP session.
+ * The receive hook sees every media packet queued in the session,
+ * the recover hook is asked for missing packets before they are given up.
+ */
+void rtp_set_fec (rtp_session_t *ses, const rtp_fec_t *fec)
+{
+    ses->fec = *fec;
+}
+
 /** State for an RTP source */
 struct rtp_source_t
 {
     uint32_t ssrc;
-    uint32_t jitter;  /* interarrival delay jitter estimate */
+    uint32_t jitter;  /* interarrival delay jitter estimate (x16) */
     mtime_t  last_rx; /* last received packet local timestamp */
     uint32_t last_ts; /* last received packet RTP timestamp */
 
@@ -310,13 +324,13 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         {
             /* Recompute jitter estimate.
              * That is computed from the RTP timestamps and the system clock.
-             * It is independent of RTP sequence. */
+             * It is independent of RTP sequence. The estimate is kept
+             * scaled by 16 so as not to lose precision (RFC 3550 §A.8). */
             uint32_t freq = pt->frequency;
-            int64_t ts = rtp_timestamp (block);
             int64_t d = ((now - src->last_rx) * freq) / CLOCK_FREQ;
-            d        -=    ts - src->last_ts;
+            d -= (int32_t)(rtp_timestamp (block) - src->last_ts);
             if (d < 0) d = -d;
-            src->jitter += ((d - src->jitter) + 8) >> 4;
+            src->jitter += d - ((src->jitter + 8) >> 4);
         }
     }
     src->last_rx = now;
@@ -368,6 +382,8 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
     block->p_next = *pp;
     *pp = block;
 
+    if (session->fec.receive != NULL)
+        session->fec.receive (session->fec.opaque, block);
     /*rtp_decode (demux, session, src);*/
     return;
 
@@ -378,6 +394,37 @@ drop:
 
 static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
 
+/**
+ * Asks the FEC hook for the packets missing before the head of the queue.
+ * @return true if at least one packet was recovered.
+ */
+static bool rtp_recover (const rtp_session_t *session, rtp_source_t *src,
+                         mtime_t now)
+{
+    bool recovered = false;
+
+    /* Going backward keeps the queue in sequence order */
+    for (uint16_t seq = rtp_seq (src->blocks) - 1;
+         (int16_t)(seq - src->last_seq) > 0; seq--)
+    {
+        block_t *block = session->fec.recover (session->fec.opaque,
+                                               src->ssrc, seq);
+        if (block == NULL)
+            continue;
+        if (block->i_buffer < 12 || rtp_seq (block) != seq)
+        {
+            block_Release (block);
+            continue;
+        }
+
+        block->i_pts = now;
+        block->p_next = src->blocks;
+        src->blocks = block;
+        recovered = true;
+    }
+    return recovered;
+}
+
 /**
  * Dequeues RTP packets and pass them to decoder. Not cancellation-safe(?).
  * A packet is decoded if it is the next in sequence order, or if we have
@@ -393,6 +440,7 @@ static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
 bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
                   mtime_t *restrict deadlinep)
 {
+    demux_sys_t *p_sys = demux->p_sys;
     mtime_t now = mdate ();
     bool pending = false;
 
@@ -427,19 +475,25 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
                 continue;
             }
 
+            /* Missing packets may be rebuilt from FEC data */
+            if (session->fec.recover != NULL && rtp_recover (session, src, now))
+                continue;
+
             /* Wait for 3 times the inter-arrival delay variance (about 99.7%
              * match for random gaussian jitter).
              */
             mtime_t deadline;
             const rtp_pt_t *pt = rtp_find_ptype (session, src, block, NULL);
             if (pt)
-                deadline = CLOCK_FREQ * 3 * src->jitter / pt->frequency;
+                deadline = CLOCK_FREQ * 3 * src->jitter / (16 * pt->frequency);
             else
                 deadline = 0; /* no jitter estimate with no frequency :( */
 
-            /* Make sure we wait at least for 25 msec */
-            if (deadline < (CLOCK_FREQ / 40))
-                deadline = CLOCK_FREQ / 40;
+            /* Bound the wait within the configured reordering window */
+            if (deadline < p_sys->reorder_min)
+                deadline = p_sys->reorder_min;
+            if (p_sys->reorder_max > 0 && deadline > p_sys->reorder_max)
+                deadline = p_sys->reorder_max;
 
             /* Additionnaly, we implicitly wait for the packetization time
              * multiplied by the number of missing packets. block is the first
@@ -31,6 +31,9 @@
 # include <sys/shm.h>
 # include <xcb/shm.h>
 #endif
+#ifdef HAVE_XCB_DAMAGE
+# include <xcb/damage.h>
+#endif
 #include <vlc_common.h>
 #include <vlc_demux.h>
 #include <vlc_plugin.h>
@@ -100,6 +103,31 @@ static int Control (demux_t *, int, va_list);
 static es_out_id_t *InitES (demux_t *, uint_fast16_t, uint_fast16_t,
                             uint_fast8_t, uint8_t *);
 
+#ifdef HAVE_SYS_SHM_H
+/**
+ * Shared memory segment, attached to the X server once, and reused for the
+ * next frames of the same size when it comes back from downstream.
+ */
+typedef struct shm_buffer
+{
+    block_t            self;
+    struct shm_pool   *pool;
+    struct shm_buffer *next; /**< Next free segment */
+    xcb_shm_seg_t      segment; /**< SHM segment XID */
+    void              *addr;
+    size_t             size;
+    int                id; /**< Segment ID, until the X server attached it */
+} shm_buffer_t;
+
+typedef struct shm_pool
+{
+    vlc_mutex_t        lock;
+    unsigned           refs; /**< Demux, plus one per segment downstream */
+    bool               closed;
+    shm_buffer_t      *free;
+} shm_pool_t;
+#endif
+
 struct demux_sys_t
 {
     /* All owned by timer thread while timer is armed: */
@@ -108,13 +136,19 @@ struct demux_sys_t
     float             rate; /**< Frame rate */
     xcb_window_t      window; /**< Captured window XID  */
     xcb_pixmap_t      pixmap; /**< Pixmap for composited capture */
-    xcb_shm_seg_t     segment; /**< SHM segment XID */
+    struct shm_pool  *pool; /**< MIT-SHM segments, if supported */
     int16_t           x, y; /**< Requested capture top-left coordinates */
     uint16_t          w, h; /**< Requested capture pixel dimensions */
     uint8_t           bpp; /**< Actual bytes per pixel *es */
-    bool              shm; /**< Whether to use MIT-SHM */
     bool              follow_mouse;
     uint16_t          cur_w, cur_h; /**< Actual capture pixel dimensions */
+#ifdef HAVE_XCB_DAMAGE
+    xcb_damage_damage_t damage; /**< Damage XID, or 0 if not supported */
+    uint8_t           damage_event; /**< First Damage event code */
+    bool              damaged; /**< Whether the window changed */
+    block_t          *last; /**< Last captured frame */
+    int16_t           last_x, last_y; /**< Last capture coordinates */
+#endif
     /* Timer does not use this, only input thread: */
     vlc_timer_t       timer;
 };
@@ -135,6 +169,164 @@ static bool CheckSHM (xcb_connection_t *conn)
 #endif
 }
 
+#ifdef HAVE_SYS_SHM_H
+static shm_pool_t *ShmPoolNew (void)
+{
+    shm_pool_t *pool = malloc (sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init (&pool->lock);
+    pool->refs = 1;
+    pool->closed = false;
+    pool->free = NULL;
+    return pool;
+}
+
+/** Unmaps a segment, the X server detaches it on its own when closing. */
+static void ShmBufferDestroy (shm_buffer_t *buf)
+{
+    shmdt (buf->addr);
+    if (buf->id != -1)
+        shmctl (buf->id, IPC_RMID, 0);
+    free (buf);
+}
+
+/** Drops a reference to the pool. Must be called with the lock held. */
+static void ShmPoolRelease (shm_pool_t *pool)
+{
+    bool last = --pool->refs == 0;
+
+    vlc_mutex_unlock (&pool->lock);
+    if (!last)
+        return;
+
+    while (pool->free != NULL)
+    {
+        shm_buffer_t *buf = pool->free;
+
+        pool->free = buf->next;
+        ShmBufferDestroy (buf);
+    }
+    vlc_mutex_destroy (&pool->lock);
+    free (pool);
+}
+
+static void ShmBlockRelease (block_t *block)
+{
+    shm_buffer_t *buf = (shm_buffer_t *)block;
+    shm_pool_t *pool = buf->pool;
+
+    vlc_mutex_lock (&pool->lock);
+    if (pool->closed)
+        ShmBufferDestroy (buf);
+    else
+    {
+        buf->next = pool->free;
+        pool->free = buf;
+    }
+    ShmPoolRelease (pool);
+}
+
+/** Detaches and destroys a segment (timer thread only). */
+static void ShmBufferDrop (xcb_connection_t *conn, shm_buffer_t *buf)
+{
+    xcb_shm_detach (conn, buf->segment);
+    ShmBufferDestroy (buf);
+}
+
+/**
+ * Gets a free segment of the given size, or attaches a new one
+ * (timer thread only).
+ */
+static shm_buffer_t *ShmBufferGet (demux_t *demux, size_t size)
+{
+    demux_sys_t *sys = demux->p_sys;
+    shm_pool_t *pool = sys->pool;
+    shm_buffer_t *buf;
+
+    vlc_mutex_lock (&pool->lock);
+    while ((buf = pool->free) != NULL)
+    {
+        pool->free = buf->next;
+        if (buf->size == size)
+            break;
+        ShmBufferDrop (sys->conn, buf); /* from before a size change */
+    }
+    pool->refs++;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (buf != NULL)
+        return buf;
+
+    buf = malloc (sizeof (*buf));
+    if (unlikely(buf == NULL))
+        goto error;
+
+    buf->id = shmget (IPC_PRIVATE, size, IPC_CREAT | 0777);
+    if (buf->id == -1)
+    {
+        msg_Err (demux, "shared memory allocation error: %m");
+        free (buf);
+        goto error;
+    }
+
+    /* Attach the segment to VLC */
+    buf->addr = shmat (buf->id, NULL, 0 /* read/write */);
+    if (-1 == (intptr_t)buf->addr)
+    {
+        msg_Err (demux, "shared memory attachment error: %m");
+        shmctl (buf->id, IPC_RMID, 0);
+        free (buf);
+        goto error;
+    }
+
+    /* Attach the segment to X */
+    buf->pool = pool;
+    buf->size = size;
+    buf->segment = xcb_generate_id (sys->conn);
+    xcb_shm_attach (sys->conn, buf->segment, buf->id, 0 /* read/write */);
+    return buf;
+
+error:
+    vlc_mutex_lock (&pool->lock);
+    ShmPoolRelease (pool);
+    return NULL;
+}
+#endif
+
+#ifdef HAVE_XCB_DAMAGE
+/** Starts tracking the changes of the captured window */
+static void InitDamage (demux_t *demux)
+{
+    demux_sys_t *sys = demux->p_sys;
+    xcb_connection_t *conn = sys->conn;
+    const xcb_query_extension_reply_t *ext;
+
+    sys->damage = 0;
+    sys->damaged = true;
+    sys->last = NULL;
+
+    ext = xcb_get_extension_data (conn, &xcb_damage_id);
+    if (ext == NULL || !ext->present)
+        return;
+
+    xcb_damage_query_version_reply_t *r =
+        xcb_damage_query_version_reply (conn,
+            xcb_damage_query_version (conn, 1, 1), NULL);
+    if (r == NULL)
+        return;
+    msg_Dbg (demux, "using Damage extension v%"PRIu32".%"PRIu32,
+             r->major_version, r->minor_version);
+    free (r);
+
+    sys->damage_event = ext->first_event;
+    sys->damage = xcb_generate_id (conn);
+    xcb_damage_create (conn, sys->damage, sys->window,
+                       XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+}
+#endif
+
 /**
  * Probes and initializes.
  */
@@ -215,8 +407,14 @@ static int Open (vlc_object_t *obj)
 
     /* Window properties */
     p_sys->pixmap = xcb_generate_id (conn);
-    p_sys->segment = xcb_generate_id (conn);
-    p_sys->shm = CheckSHM (conn);
+    p_sys->pool = NULL;
+#ifdef HAVE_SYS_SHM_H
+    if (CheckSHM (conn))
+        p_sys->pool = ShmPoolNew ();
+#endif
+#ifdef HAVE_XCB_DAMAGE
+    InitDamage (demux);
+#endif
     p_sys->w = var_InheritInteger (obj, "screen-width");
     p_sys->h = var_InheritInteger (obj, "screen-height");
     if (p_sys->w != 0 || p_sys->h != 0)
@@ -252,6 +450,13 @@ static int Open (vlc_object_t *obj)
     return VLC_SUCCESS;
 
 error:
+#ifdef HAVE_SYS_SHM_H
+    if (p_sys->pool != NULL)
+    {
+        vlc_mutex_lock (&p_sys->pool->lock);
+        ShmPoolRelease (p_sys->pool);
+    }
+#endif
     xcb_disconnect (p_sys->conn);
     free (p_sys);
     return VLC_EGENERIC;
@@ -267,6 +472,27 @@ static void Close (vlc_object_t *obj)
     demux_sys_t *p_sys = demux->p_sys;
 
     vlc_timer_destroy (p_sys->timer);
+#ifdef HAVE_XCB_DAMAGE
+    if (p_sys->last != NULL)
+        block_Release (p_sys->last);
+#endif
+#ifdef HAVE_SYS_SHM_H
+    if (p_sys->pool != NULL)
+    {   /* Segments still downstream are unmapped when released */
+        shm_pool_t *pool = p_sys->pool;
+
+        vlc_mutex_lock (&pool->lock);
+        while (pool->free != NULL)
+        {
+            shm_buffer_t *buf = pool->free;
+
+            pool->free = buf->next;
+            ShmBufferDrop (p_sys->conn, buf);
+        }
+        pool->closed = true;
+        ShmPoolRelease (pool);
+    }
+#endif
     xcb_disconnect (p_sys->conn);
     free (p_sys);
 }
@@ -406,6 +632,13 @@ discard:
     {
         if (sys->es != NULL)
             es_out_Del (demux->out, sys->es);
+#ifdef HAVE_XCB_DAMAGE
+        if (sys->last != NULL)
+        {
+            block_Release (sys->last);
+            sys->last = NULL;
+        }
+#endif
 
         /* Update composite pixmap */
         if (sys->window != geo->root)
@@ -431,47 +664,65 @@ discard:
     free (geo);
 
     block_t *block = NULL;
-#if HAVE_SYS_SHM_H
-    if (sys->shm)
+#ifdef HAVE_XCB_DAMAGE
+    if (sys->damage != 0)
+    {   /* Capture only if the window changed, or the region moved */
+        xcb_generic_event_t *ev;
+
+        while ((ev = xcb_poll_for_event (conn)) != NULL)
+        {
+            if ((ev->response_type & 0x7F)
+                 == sys->damage_event + XCB_DAMAGE_NOTIFY)
+                sys->damaged = true;
+            free (ev);
+        }
+
+        if (!sys->damaged && sys->last != NULL
+         && sys->last_x == x && sys->last_y == y)
+        {   /* Send the same frame again, neither captured nor copied */
+            block = block_Share (sys->last);
+            if (block == NULL)
+                return;
+            goto send;
+        }
+
+        /* Changes from now on will be reported again */
+        xcb_damage_subtract (conn, sys->damage, XCB_NONE, XCB_NONE);
+        sys->damaged = false;
+    }
+#endif
+#ifdef HAVE_SYS_SHM_H
+    if (sys->pool != NULL)
     {   /* Capture screen through shared memory */
         size_t size = w * h * sys->bpp;
-        int id = shmget (IPC_PRIVATE, size, IPC_CREAT | 0777);
-        if (id == -1) /* XXX: fallback */
-        {
-            msg_Err (demux, "shared memory allocation error: %m");
+        shm_buffer_t *buf = ShmBufferGet (demux, size);
+        if (buf == NULL) /* XXX: fallback */
             goto noshm;
-        }
 
-        /* Attach the segment to X and capture */
         xcb_shm_get_image_reply_t *img;
         xcb_shm_get_image_cookie_t ck;
 
-        xcb_shm_attach (conn, sys->segment, id, 0 /* read/write */);
         ck = xcb_shm_get_image (conn, drawable, x, y, w, h, ~0,
-                                XCB_IMAGE_FORMAT_Z_PIXMAP, sys->segment, 0);
-        xcb_shm_detach (conn, sys->segment);
+                                XCB_IMAGE_FORMAT_Z_PIXMAP, buf->segment, 0);
         img = xcb_shm_get_image_reply (conn, ck, NULL);
-        xcb_flush (conn); /* ensure eventual detach */
+        if (buf->id != -1)
+        {   /* The X server has attached the segment by now */
+            shmctl (buf->id, IPC_RMID, 0);
+            buf->id = -1;
+        }
 
         if (img == NULL)
         {
-            shmctl (id, IPC_RMID, 0);
+            ShmBufferDrop (conn, buf);
+            vlc_mutex_lock (&sys->pool->lock);
+            ShmPoolRelease (sys->pool);
             goto noshm;
         }
         free (img);
 
-        /* Attach the segment to VLC */
-        void *shm = shmat (id, NULL, 0 /* read/write */);
-        shmctl (id, IPC_RMID, 0);
-        if (-1 == (intptr_t)shm)
-        {
-            msg_Err (demux, "shared memory attachment error: %m");
-            return;
-        }
-
-        block = block_shm_Alloc (shm, size);
-        if (unlikely(block == NULL))
-            shmdt (shm);
+        block = &buf->self;
+        block_Init (block, buf->addr, size);
+        block->pf_release = ShmBlockRelease;
     }
 noshm:
 #endif
@@ -494,6 +745,18 @@ noshm:
         block->i_buffer = datalen;
     }
 
+#ifdef HAVE_XCB_DAMAGE
+    if (sys->damage != 0)
+    {   /* Keep a reference, for the next frames if nothing changes */
+        block = block_MakeShared (block);
+        if (sys->last != NULL)
+            block_Release (sys->last);
+        sys->last = block_Share (block);
+        sys->last_x = x;
+        sys->last_y = y;
+    }
+send:
+#endif
     /* Send block - zero copy */
     if (sys->es != NULL)
     {
@@ -502,6 +765,8 @@ noshm:
         es_out_Control (demux->out, ES_OUT_SET_PCR, block->i_pts);
         es_out_Send (demux->out, sys->es, block);
     }
+    else
+        block_Release (block);
 }
 
 static es_out_id_t *InitES (demux_t *demux, uint_fast16_t width,
@@ -40,15 +40,39 @@
 #include <vlc_plugin.h>
 #include <vlc_access.h>
 #include <vlc_network.h>
+#include <vlc_atomic.h>
+
+#include <errno.h>
+#ifdef HAVE_POLL
+# include <poll.h>
+#endif
+
+/* Wake up that often when idle so that the caller can check if it must stop
+ * (ms) */
+#define UDP_POLL_TIMEOUT 100
 
 #define MTU 65535
 
+#ifdef HAVE_RECVMMSG
+/* Datagrams received with a single system call */
+# define UDP_BATCH 32
+/* Initial size of each datagram buffer, it grows on truncation */
+# define UDP_MTU   1500
+#else
+# define UDP_BATCH 1
+# define UDP_MTU   MTU
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define BUFFER_TEXT N_("Receive buffer")
+#define BUFFER_LONGTEXT N_("Maximum amount of received data (in bytes) " \
+    "waiting to be demultiplexed. Datagrams received beyond it are dropped.")
+
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
     set_description( N_("UDP input") )
@@ -56,6 +80,7 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_ACCESS )
 
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
+    add_integer( "udp-buffer", 0x400000, BUFFER_TEXT, BUFFER_LONGTEXT, true )
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -68,6 +93,38 @@ vlc_module_end ()
  *****************************************************************************/
 static block_t *BlockUDP( access_t * );
 static int Control( access_t *, int, va_list );
+static void *ThreadRead( void * );
+
+/* The datagrams are received by a dedicated thread, so that the socket
+ * buffer keeps being drained while the input thread demultiplexes */
+struct access_sys_t
+{
+    int    fd;
+    size_t i_mtu;
+
+    vlc_thread_t  thread;
+    block_fifo_t *p_fifo;
+    atomic_uint_least64_t i_queued; /* bytes in p_fifo */
+    uint64_t      i_queue_max;
+    unsigned      i_dropped;
+};
+
+/* The datagrams received at once share a single allocation: each block is
+ * a view on one of them */
+typedef struct udp_batch_t udp_batch_t;
+
+typedef struct
+{
+    block_t      self;
+    udp_batch_t *p_batch;
+} udp_packet_t;
+
+struct udp_batch_t
+{
+    atomic_uint  refs;
+    uint8_t     *p_data;
+    udp_packet_t packets[];
+};
 
 /*****************************************************************************
  * Open: open the socket
@@ -136,9 +193,43 @@ static int Open( vlc_object_t *p_this )
         msg_Err( p_access, "cannot open socket" );
         return VLC_EGENERIC;
     }
-    p_access->p_sys = (void *)(intptr_t)fd;
 
+    access_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    if( unlikely(p_sys == NULL) )
+    {
+        net_Close( fd );
+        return VLC_ENOMEM;
+    }
+    p_sys->fd = fd;
+    p_sys->i_mtu = UDP_MTU;
+    atomic_init( &p_sys->i_queued, 0 );
+    p_sys->i_queue_max = var_InheritInteger( p_access, "udp-buffer" );
+    p_sys->i_dropped = 0;
+    p_access->p_sys = p_sys;
+
+#if defined(HAVE_RECVMMSG) && defined(SO_TIMESTAMPNS)
+    /* Date the datagrams when the kernel receives them */
+    int on = 1;
+    if( setsockopt( fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof( on ) ) )
+        msg_Dbg( p_access, "no kernel receive timestamps" );
+#endif
+
+    p_sys->p_fifo = block_FifoNewSPSC();
+    if( unlikely(p_sys->p_fifo == NULL) )
+        goto error;
+
+    if( vlc_clone( &p_sys->thread, ThreadRead, p_access,
+                   VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        block_FifoRelease( p_sys->p_fifo );
+        goto error;
+    }
     return VLC_SUCCESS;
+
+error:
+    net_Close( fd );
+    free( p_sys );
+    return VLC_EGENERIC;
 }
 
 /*****************************************************************************
@@ -147,8 +238,13 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t *p_this )
 {
     access_t     *p_access = (access_t*)p_this;
+    access_sys_t *p_sys = p_access->p_sys;
 
-    net_Close( (intptr_t)p_access->p_sys );
+    vlc_cancel( p_sys->thread );
+    vlc_join( p_sys->thread, NULL );
+    block_FifoRelease( p_sys->p_fifo );
+    net_Close( p_sys->fd );
+    free( p_sys );
 }
 
 /*****************************************************************************
@@ -193,27 +289,222 @@ static int Control( access_t *p_access, int i_query, va_list args )
     return VLC_SUCCESS;
 }
 
+static void BatchPacketRelease( block_t *p_block )
+{
+    udp_batch_t *p_batch = ((udp_packet_t *)p_block)->p_batch;
+
+    if( atomic_fetch_sub( &p_batch->refs, 1 ) == 1 )
+        free( p_batch );
+}
+
+/*****************************************************************************
+ * ReceiveUDP: reads the pending datagrams, up to UDP_BATCH
+ *****************************************************************************
+ * The datagram i is stored at p_data + i * i_mtu. Its date is the time it
+ * was received by the kernel when available.
+ *****************************************************************************/
+#ifdef HAVE_RECVMMSG
+static int ReceiveUDP( access_t *p_access, uint8_t *p_data,
+                       size_t pi_len[], mtime_t pi_date[] )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    const size_t  i_mtu = p_sys->i_mtu;
+
+    struct mmsghdr msg[UDP_BATCH];
+    struct iovec   iov[UDP_BATCH];
+    union
+    {
+        struct cmsghdr hdr;
+        char           buf[CMSG_SPACE(sizeof (struct timespec))];
+    } control[UDP_BATCH];
+
+    for( int i = 0; i < UDP_BATCH; i++ )
+    {
+        iov[i].iov_base = &p_data[i * i_mtu];
+        iov[i].iov_len  = i_mtu;
+        memset( &msg[i].msg_hdr, 0, sizeof( msg[i].msg_hdr ) );
+        msg[i].msg_hdr.msg_iov        = &iov[i];
+        msg[i].msg_hdr.msg_iovlen     = 1;
+        msg[i].msg_hdr.msg_control    = &control[i];
+        msg[i].msg_hdr.msg_controllen = sizeof( control[i] );
+    }
+
+    /* With MSG_TRUNC, msg_len is the real size of truncated datagrams */
+    int i_count = recvmmsg( p_sys->fd, msg, UDP_BATCH,
+                            MSG_DONTWAIT | MSG_TRUNC, NULL );
+    if( i_count < 0 )
+    {
+        if( errno != EAGAIN && errno != EINTR )
+            msg_Err( p_access, "receive error: %m" );
+        return -1;
+    }
+
+    /* The kernel dates the datagrams with the real time clock */
+    struct timespec now;
+    const mtime_t i_now = mdate();
+    clock_gettime( CLOCK_REALTIME, &now );
+    const mtime_t i_real = INT64_C(1000000) * now.tv_sec + now.tv_nsec / 1000;
+
+    for( int i = 0; i < i_count; i++ )
+    {
+        pi_len[i] = msg[i].msg_len;
+        if( pi_len[i] > i_mtu )
+        {
+            msg_Err( p_access, "%zu bytes datagram truncated (MTU was %zu)",
+                     pi_len[i], i_mtu );
+            p_sys->i_mtu = __MIN( __MAX( p_sys->i_mtu, pi_len[i] ), MTU );
+            pi_len[i] = i_mtu;
+        }
+
+        pi_date[i] = i_now;
+#ifdef SO_TIMESTAMPNS
+        for( struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg[i].msg_hdr );
+             cmsg != NULL; cmsg = CMSG_NXTHDR( &msg[i].msg_hdr, cmsg ) )
+        {
+            if( cmsg->cmsg_level != SOL_SOCKET ||
+                cmsg->cmsg_type != SCM_TIMESTAMPNS )
+                continue;
+
+            struct timespec ts;
+            memcpy( &ts, CMSG_DATA( cmsg ), sizeof( ts ) );
+            const mtime_t i_delay = i_real - INT64_C(1000000) * ts.tv_sec
+                                  - ts.tv_nsec / 1000;
+            if( i_delay > 0 )
+                pi_date[i] = i_now - i_delay;
+        }
+#endif
+    }
+    return i_count;
+}
+#else
+static int ReceiveUDP( access_t *p_access, uint8_t *p_data,
+                       size_t pi_len[], mtime_t pi_date[] )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    ssize_t len = recv( p_sys->fd, (void *)p_data, p_sys->i_mtu, 0 );
+    if( len < 0 )
+        return -1;
+
+    pi_len[0] = len;
+    pi_date[0] = mdate();
+    return 1;
+}
+#endif
+
+/*****************************************************************************
+ * ReadUDP:
+ *****************************************************************************
+ * Returns a chain of blocks, one per pending datagram, dated (i_dts) with
+ * their reception time.
+ *****************************************************************************/
+static block_t *ReadUDP( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    const size_t  i_mtu = p_sys->i_mtu;
+
+    udp_batch_t *p_batch = malloc( sizeof( *p_batch ) +
+                                   UDP_BATCH * ( sizeof( udp_packet_t ) + i_mtu ) );
+    if( unlikely(p_batch == NULL) )
+        return NULL;
+    p_batch->p_data = (uint8_t *)&p_batch->packets[UDP_BATCH];
+
+    size_t  pi_len[UDP_BATCH];
+    mtime_t pi_date[UDP_BATCH];
+    int i_count = ReceiveUDP( p_access, p_batch->p_data, pi_len, pi_date );
+    if( i_count <= 0 )
+    {
+        free( p_batch );
+        return NULL;
+    }
+
+    block_t *p_chain = NULL, **pp_last = &p_chain;
+
+    atomic_init( &p_batch->refs, i_count );
+    for( int i = 0; i < i_count; i++ )
+    {
+        udp_packet_t *p_pkt = &p_batch->packets[i];
+
+        block_Init( &p_pkt->self, &p_batch->p_data[i * i_mtu], pi_len[i] );
+        p_pkt->self.pf_release = BatchPacketRelease;
+        p_pkt->self.i_dts = pi_date[i];
+        p_pkt->p_batch = p_batch;
+
+        *pp_last = &p_pkt->self;
+        pp_last = &p_pkt->self.p_next;
+    }
+    return p_chain;
+}
+
+/*****************************************************************************
+ * ThreadRead: receives the datagrams into the FIFO
+ *****************************************************************************/
+static void *ThreadRead( void *data )
+{
+    access_t     *p_access = data;
+    access_sys_t *p_sys = p_access->p_sys;
+
+    for( ;; )
+    {
+        struct pollfd ufd = { .fd = p_sys->fd, .events = POLLIN };
+
+        if( poll( &ufd, 1, -1 ) <= 0 )
+            continue;
+
+        int canc = vlc_savecancel();
+        block_t *p_chain = ReadUDP( p_access );
+        if( p_chain != NULL )
+        {
+            size_t i_size;
+            int i_count;
+            block_ChainProperties( p_chain, &i_count, &i_size, NULL );
+
+            if( atomic_load( &p_sys->i_queued ) + i_size > p_sys->i_queue_max )
+            {
+                /* Report once per overflow */
+                if( p_sys->i_dropped == 0 )
+                    msg_Err( p_access, "receive buffer overflow, "
+                             "dropping datagrams" );
+                p_sys->i_dropped += i_count;
+                block_ChainRelease( p_chain );
+            }
+            else
+            {
+                if( p_sys->i_dropped > 0 )
+                {
+                    msg_Warn( p_access, "%u datagrams dropped",
+                              p_sys->i_dropped );
+                    p_sys->i_dropped = 0;
+                }
+                atomic_fetch_add( &p_sys->i_queued, i_size );
+                block_FifoPut( p_sys->p_fifo, p_chain );
+            }
+        }
+        vlc_restorecancel( canc );
+    }
+    return NULL;
+}
+
 /*****************************************************************************
  * BlockUDP:
+ *****************************************************************************
+ * Returns the chain of datagrams received so far.
  *****************************************************************************/
 static block_t *BlockUDP( access_t *p_access )
 {
     access_sys_t *p_sys = p_access->p_sys;
-    block_t      *p_block;
-    ssize_t len;
 
     if( p_access->info.b_eof )
         return NULL;
 
-    /* Read data */
-    p_block = block_Alloc( MTU );
-    len = net_Read( p_access, (intptr_t)p_sys, NULL,
-                    p_block->p_buffer, MTU, false );
-    if( len < 0 )
-    {
-        block_Release( p_block );
+    /* The caller retries after a timeout */
+    block_t *p_chain = block_FifoGetBatch( p_sys->p_fifo, SIZE_MAX,
+                                           mdate() + UDP_POLL_TIMEOUT * 1000 );
+    if( p_chain == NULL )
         return NULL;
-    }
 
-    return block_Realloc( p_block, 0, len );
+    size_t i_size;
+    block_ChainProperties( p_chain, NULL, &i_size, NULL );
+    atomic_fetch_sub( &p_sys->i_queued, i_size );
+    return p_chain;
 }
@@ -161,7 +161,7 @@ int InitVideo (access_t *access, int fd, uint32_t caps)
     /* Init I/O method */
     if (caps & V4L2_CAP_STREAMING)
     {
-        sys->bufc = 4;
+        sys->bufc = var_InheritInteger (access, CFG_PREFIX"buffers");
         sys->bufv = StartMmap (VLC_OBJECT(access), fd, &sys->bufc);
         if (sys->bufv == NULL)
             return -1;
@@ -42,11 +42,32 @@
 
 #include "v4l2.h"
 
+/* Memory-mapped buffers lent downstream instead of copied */
+typedef struct
+{
+    vlc_mutex_t lock;
+    unsigned refs; /* demux and lent buffers */
+    unsigned lent;
+    bool closed;
+
+    int fd;
+    struct buffer_t *bufv;
+    uint32_t bufc;
+} mmap_pool_t;
+
+typedef struct
+{
+    block_t self;
+    mmap_pool_t *pool;
+    struct v4l2_buffer buf;
+} mmap_block_t;
+
 struct demux_sys_t
 {
     int fd;
     vlc_thread_t thread;
 
+    mmap_pool_t *pool;
     struct buffer_t *bufv;
     union
     {
@@ -69,6 +90,8 @@ static void *MmapThread (void *);
 static void *ReadThread (void *);
 static int DemuxControl( demux_t *, int, va_list );
 static int InitVideo (demux_t *, int fd, uint32_t caps);
+static mmap_pool_t *PoolNew (int fd, struct buffer_t *, uint32_t);
+static void PoolRelease (mmap_pool_t *);
 
 int DemuxOpen( vlc_object_t *obj )
 {
@@ -78,6 +101,7 @@ int DemuxOpen( vlc_object_t *obj )
     if (unlikely(sys == NULL))
         return VLC_ENOMEM;
     demux->p_sys = sys;
+    sys->pool = NULL;
 #ifdef ZVBI_COMPILED
     sys->vbi = NULL;
 #endif
@@ -425,13 +449,22 @@ static int InitVideo (demux_t *demux, int fd, uint32_t caps)
         }
         else /* fall back to memory map */
         {
-            sys->bufc = 4;
+            sys->bufc = var_InheritInteger (demux, CFG_PREFIX"buffers");
             sys->bufv = StartMmap (VLC_OBJECT(demux), fd, &sys->bufc);
             if (sys->bufv == NULL)
                 return -1;
             entry = MmapThread;
             msg_Dbg (demux, "streaming with %"PRIu32" memory-mapped buffers",
                      sys->bufc);
+
+            /* The pool takes the buffers and the device over: lent buffers
+             * can outlive the demux. */
+            if (var_InheritBool (demux, CFG_PREFIX"zero-copy"))
+            {
+                sys->pool = PoolNew (fd, sys->bufv, sys->bufc);
+                if (sys->pool != NULL)
+                    sys->bufv = NULL;
+            }
         }
     }
     else if (caps & V4L2_CAP_READWRITE)
@@ -463,6 +496,13 @@ static int InitVideo (demux_t *demux, int fd, uint32_t caps)
         if (sys->vbi != NULL)
             CloseVBI (sys->vbi);
 #endif
+        if (sys->pool != NULL)
+        {   /* Keep the device, it is closed by DemuxOpen() */
+            StopMmap (fd, sys->pool->bufv, sys->pool->bufc);
+            vlc_mutex_destroy (&sys->pool->lock);
+            free (sys->pool);
+            sys->pool = NULL;
+        }
         if (sys->bufv != NULL)
             StopMmap (sys->fd, sys->bufv, sys->bufc);
         return -1;
@@ -480,7 +520,14 @@ void DemuxClose( vlc_object_t *obj )
     if (sys->bufv != NULL)
         StopMmap (sys->fd, sys->bufv, sys->bufc);
     ControlsDeinit( obj, sys->controls );
-    v4l2_close (sys->fd);
+    if (sys->pool != NULL)
+    {   /* The last lent buffer stops streaming and closes the device */
+        vlc_mutex_lock (&sys->pool->lock);
+        sys->pool->closed = true;
+        PoolRelease (sys->pool);
+    }
+    else
+        v4l2_close (sys->fd);
 
 #ifdef ZVBI_COMPILED
     if (sys->vbi != NULL)
@@ -575,6 +622,116 @@ static void *UserPtrThread (void *data)
     return NULL;
 }
 
+static mmap_pool_t *PoolNew (int fd, struct buffer_t *bufv, uint32_t bufc)
+{
+    mmap_pool_t *pool = malloc (sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init (&pool->lock);
+    pool->refs = 1;
+    pool->lent = 0;
+    pool->closed = false;
+    pool->fd = fd;
+    pool->bufv = bufv;
+    pool->bufc = bufc;
+    return pool;
+}
+
+/** Drops a reference to the pool. Must be called with the lock held. */
+static void PoolRelease (mmap_pool_t *pool)
+{
+    bool last = --pool->refs == 0;
+
+    vlc_mutex_unlock (&pool->lock);
+    if (!last)
+        return;
+
+    StopMmap (pool->fd, pool->bufv, pool->bufc);
+    v4l2_close (pool->fd);
+    vlc_mutex_destroy (&pool->lock);
+    free (pool);
+}
+
+static void MmapBlockRelease (block_t *block)
+{
+    mmap_block_t *mb = (mmap_block_t *)block;
+    mmap_pool_t *pool = mb->pool;
+
+    vlc_mutex_lock (&pool->lock);
+    /* Give the buffer back to the device */
+    if (!pool->closed)
+        v4l2_ioctl (pool->fd, VIDIOC_QBUF, &mb->buf);
+    pool->lent--;
+    PoolRelease (pool);
+    free (mb);
+}
+
+/**
+ * Grabs a video frame, lending the buffer if enough buffers remain queued
+ * for the device to capture the next frames, copying it otherwise.
+ */
+static block_t *PoolGrab (vlc_object_t *demux, mmap_pool_t *pool)
+{
+    struct v4l2_buffer buf = {
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .memory = V4L2_MEMORY_MMAP,
+    };
+
+    if (v4l2_ioctl (pool->fd, VIDIOC_DQBUF, &buf) < 0)
+    {
+        if (errno != EAGAIN)
+            msg_Err (demux, "dequeue error: %m");
+        return NULL;
+    }
+
+    vlc_mutex_lock (&pool->lock);
+    bool lend = pool->lent + 2 < pool->bufc;
+    if (lend)
+    {
+        pool->lent++;
+        pool->refs++;
+    }
+    vlc_mutex_unlock (&pool->lock);
+
+    if (lend)
+    {
+        mmap_block_t *mb = malloc (sizeof (*mb));
+        if (likely(mb != NULL))
+        {
+            block_Init (&mb->self, pool->bufv[buf.index].start, buf.bytesused);
+            mb->self.pf_release = MmapBlockRelease;
+            mb->self.i_pts = mb->self.i_dts = GetBufferPTS (&buf);
+            mb->pool = pool;
+            mb->buf = buf;
+            return &mb->self;
+        }
+
+        vlc_mutex_lock (&pool->lock);
+        pool->lent--;
+        pool->refs--; /* the demux still holds one */
+        vlc_mutex_unlock (&pool->lock);
+    }
+
+    /* Copy frame */
+    block_t *block = block_Alloc (buf.bytesused);
+    if (likely(block != NULL))
+    {
+        block->i_pts = block->i_dts = GetBufferPTS (&buf);
+        memcpy (block->p_buffer, pool->bufv[buf.index].start, buf.bytesused);
+    }
+
+    /* Unlock */
+    if (v4l2_ioctl (pool->fd, VIDIOC_QBUF, &buf) < 0)
+    {
+        msg_Err (demux, "queue error: %m");
+        if (block != NULL)
+            block_Release (block);
+        return NULL;
+    }
+    return block;
+}
+
 static void *MmapThread (void *data)
 {
     demux_t *demux = data;
@@ -608,7 +765,11 @@ static void *MmapThread (void *data)
         if( ufd[0].revents )
         {
             int canc = vlc_savecancel ();
-            block_t *block = GrabVideo (VLC_OBJECT(demux), fd, sys->bufv);
+            block_t *block;
+            if (sys->pool != NULL)
+                block = PoolGrab (VLC_OBJECT(demux), sys->pool);
+            else
+                block = GrabVideo (VLC_OBJECT(demux), fd, sys->bufv);
             if (block != NULL)
             {
                 block->i_flags |= sys->block_flags;
@@ -67,6 +67,16 @@
 #define SIZE_LONGTEXT N_( \
     "The specified pixel resolution is forced " \
     "(if both width and height are strictly positive)." )
+#define BUFFERS_TEXT N_( "Capture buffers" )
+#define BUFFERS_LONGTEXT N_( \
+    "Number of memory-mapped buffers requested from the device. " \
+    "More buffers avoid dropped frames when the frames are processed " \
+    "slowly or without copy." )
+#define ZERO_COPY_TEXT N_( "Zero-copy capture" )
+#define ZERO_COPY_LONGTEXT N_( \
+    "Pass the memory-mapped buffers of the device to the decoders or " \
+    "the stream output, instead of copying them, while enough buffers " \
+    "remain for the device." )
 /*#define FPS_TEXT N_( "Frame rate" )
 #define FPS_LONGTEXT N_( "Maximum frame rate to use (0 = no limits)." )*/
 
@@ -310,6 +320,13 @@ vlc_module_begin ()
     add_string( CFG_PREFIX "aspect-ratio", "4:3", ASPECT_TEXT,
               ASPECT_LONGTEXT, true )
         change_safe()
+    add_integer( CFG_PREFIX "buffers", 4, BUFFERS_TEXT, BUFFERS_LONGTEXT,
+                 true )
+        change_integer_range( 2, 32 )
+        change_safe()
+    add_bool( CFG_PREFIX "zero-copy", true, ZERO_COPY_TEXT,
+              ZERO_COPY_LONGTEXT, true )
+        change_safe()
     /*add_float( CFG_PREFIX "fps", 0, FPS_TEXT, FPS_LONGTEXT, true )*/
     add_obsolete_float( CFG_PREFIX "fps" )
         change_safe() /* since 2.1.0 */
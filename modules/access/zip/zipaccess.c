@@ -34,6 +34,23 @@
 #include "zip.h"
 #include <vlc_access.h>
 
+/** **************************************************************************
+ * Deflated files are read raw through unzip and decompressed here, so that
+ * a copy of the decompressor state can be kept every ZIP_CHECKPOINT_SPACING
+ * bytes. Seeking then restarts from the nearest checkpoint, skipping the
+ * compressed data before it without decompressing it. When the table is
+ * full, every other checkpoint is dropped and the spacing doubles.
+ *****************************************************************************/
+#define ZIP_CHECKPOINT_SPACING (1 << 20)
+#define ZIP_CHECKPOINT_MAX     64
+
+typedef struct
+{
+    uint64_t i_raw;  /* compressed bytes consumed */
+    uint64_t i_pos;  /* uncompressed offset */
+    z_stream zstream;
+} zip_checkpoint_t;
+
 /** **************************************************************************
  * This is our own access_sys_t for zip files
  *****************************************************************************/
@@ -42,11 +59,51 @@ struct access_sys_t
     /* zlib / unzip members */
     unzFile            zipFile;
     zlib_filefunc_def *fileFunctions;
+    char              *psz_pathToZip;
+    uint64_t           i_zipSize;
 
     /* file in zip information */
     char              *psz_fileInzip;
+    uLong              i_entry; /* position in the central directory */
+    bool               b_entry;
+    int                i_method;
+
+    /* decompression of the file in zip */
+    bool               b_zstream;
+    bool               b_eof;
+    z_stream           zstream;
+    uint64_t           i_raw; /* compressed bytes read */
+    unsigned           i_spacing;
+    unsigned           i_checkpoints;
+    zip_checkpoint_t   checkpoints[ZIP_CHECKPOINT_MAX];
+    uint8_t            p_input[ZIP_BUFFER_LEN];
 };
 
+/** **************************************************************************
+ * Index of the central directory of the last archives opened, since each
+ * file in zip is opened by its own access and unzLocateFile() scans the
+ * whole central directory.
+ *****************************************************************************/
+#define ZIP_INDEX_CACHE 4
+
+typedef struct
+{
+    char  *psz_name;
+    uLong  i_entry;
+} zip_index_entry_t;
+
+typedef struct
+{
+    char              *psz_zip;
+    uint64_t           i_size;
+    uLong              i_count;
+    zip_index_entry_t *p_entries; /* sorted by name */
+} zip_index_t;
+
+static zip_index_t *zip_index[ZIP_INDEX_CACHE];
+static unsigned zip_index_next = 0;
+static vlc_mutex_t zip_index_lock = VLC_STATIC_MUTEX;
+
 static int AccessControl( access_t *p_access, int i_query, va_list args );
 static ssize_t AccessRead( access_t *, uint8_t *, size_t );
 static int AccessSeek( access_t *, uint64_t );
@@ -163,6 +220,7 @@ int AccessOpen( vlc_object_t *p_this )
     p_func->opaque       = p_access;
 
     /* Open zip archive */
+    p_sys->i_spacing = ZIP_CHECKPOINT_SPACING;
     file = p_access->p_sys->zipFile = unzOpen2( psz_pathToZip, p_func );
     if( !file )
     {
@@ -170,6 +228,8 @@ int AccessOpen( vlc_object_t *p_this )
         i_ret = VLC_EGENERIC;
         goto exit;
     }
+    p_sys->psz_pathToZip = psz_pathToZip;
+    psz_pathToZip = NULL;
 
     /* Open file in zip */
     if( ( i_ret = OpenFileInZip( p_access ) ) != VLC_SUCCESS )
@@ -197,6 +257,9 @@ exit:
             unzCloseCurrentFile( file );
             unzClose( file );
         }
+        if( p_sys->b_zstream )
+            inflateEnd( &p_sys->zstream );
+        free( p_sys->psz_pathToZip );
         free( p_sys->psz_fileInzip );
         free( p_sys->fileFunctions );
         free( p_sys );
@@ -222,6 +285,11 @@ void AccessClose( vlc_object_t *p_this )
             unzCloseCurrentFile( file );
             unzClose( file );
         }
+        for( unsigned i = 0; i < p_sys->i_checkpoints; i++ )
+            inflateEnd( &p_sys->checkpoints[i].zstream );
+        if( p_sys->b_zstream )
+            inflateEnd( &p_sys->zstream );
+        free( p_sys->psz_pathToZip );
         free( p_sys->psz_fileInzip );
         free( p_sys->fileFunctions );
         free( p_sys );
@@ -278,6 +346,102 @@ static int AccessControl( access_t *p_access, int i_query, va_list args )
     return VLC_SUCCESS;
 }
 
+/** **************************************************************************
+ * \brief Read the raw data of the current file in zip
+ *****************************************************************************/
+static int ReadRaw( access_t *p_access, uint8_t *p_buffer, size_t sz )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    int i_read = unzReadCurrentFile( p_sys->zipFile, p_buffer, sz );
+    if( i_read > 0 )
+        p_sys->i_raw += i_read;
+    return i_read;
+}
+
+static void AddCheckpoint( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->i_checkpoints == ZIP_CHECKPOINT_MAX )
+    {
+        for( unsigned i = 0; i < ZIP_CHECKPOINT_MAX; i++ )
+        {
+            if( i & 1 )
+                inflateEnd( &p_sys->checkpoints[i].zstream );
+            else
+                p_sys->checkpoints[i / 2] = p_sys->checkpoints[i];
+        }
+        p_sys->i_checkpoints = ZIP_CHECKPOINT_MAX / 2;
+        p_sys->i_spacing *= 2;
+    }
+
+    zip_checkpoint_t *p_cp = &p_sys->checkpoints[p_sys->i_checkpoints];
+    if( inflateCopy( &p_cp->zstream, &p_sys->zstream ) != Z_OK )
+        return;
+    p_cp->i_raw = p_sys->i_raw - p_sys->zstream.avail_in;
+    p_cp->i_pos = p_access->info.i_pos;
+    p_sys->i_checkpoints++;
+}
+
+/** **************************************************************************
+ * \brief Decompress data of the current file in zip
+ * Return 0 if no more data, -1 on error, else real data read
+ *****************************************************************************/
+static int Decode( access_t *p_access, uint8_t *p_buffer, size_t sz )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->i_method != Z_DEFLATED )
+    {
+        int i_read = ReadRaw( p_access, p_buffer, sz );
+        if( i_read > 0 )
+            p_access->info.i_pos += i_read;
+        return i_read;
+    }
+
+    size_t i_total = 0;
+    while( i_total < sz && !p_sys->b_eof )
+    {
+        uint64_t i_last = p_sys->i_checkpoints
+            ? p_sys->checkpoints[p_sys->i_checkpoints - 1].i_pos : 0;
+        if( p_access->info.i_pos >= i_last + p_sys->i_spacing )
+            AddCheckpoint( p_access );
+
+        if( p_sys->zstream.avail_in == 0 )
+        {
+            int i_read = ReadRaw( p_access, p_sys->p_input, ZIP_BUFFER_LEN );
+            if( i_read < 0 )
+                return -1;
+            if( i_read == 0 )
+            {
+                p_sys->b_eof = true;
+                break;
+            }
+            p_sys->zstream.next_in = p_sys->p_input;
+            p_sys->zstream.avail_in = i_read;
+        }
+
+        p_sys->zstream.next_out = p_buffer + i_total;
+        p_sys->zstream.avail_out = sz - i_total;
+
+        int i_ret = inflate( &p_sys->zstream, Z_SYNC_FLUSH );
+        size_t i_len = ( sz - i_total ) - p_sys->zstream.avail_out;
+
+        i_total += i_len;
+        p_access->info.i_pos += i_len;
+
+        if( i_ret == Z_STREAM_END )
+            p_sys->b_eof = true;
+        else if( i_ret != Z_OK && ( i_ret != Z_BUF_ERROR || i_len == 0 ) )
+        {
+            msg_Err( p_access, "decompression error in file in zip" );
+            return i_total > 0 ? (int)i_total : -1;
+        }
+    }
+    return i_total;
+}
+
 /** **************************************************************************
  * \brief Read access
  * Reads current opened file in zip. This does not open the file in zip.
@@ -294,13 +458,55 @@ static ssize_t AccessRead( access_t *p_access, uint8_t *p_buffer, size_t sz )
         return VLC_EGENERIC;
     }
 
-    int i_read = 0;
-    i_read = unzReadCurrentFile( file, p_buffer, sz );
-
-    p_access->info.i_pos = unztell( file );
+    int i_read = Decode( p_access, p_buffer, sz );
     return ( i_read >= 0 ? i_read : VLC_EGENERIC );
 }
 
+/** **************************************************************************
+ * \brief Restart the decompression from the last checkpoint before seek_len,
+ * or from the beginning of the file in zip
+ *****************************************************************************/
+static int Restore( access_t *p_access, uint64_t seek_len )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    zip_checkpoint_t *p_cp = NULL;
+
+    for( unsigned i = p_sys->i_checkpoints; i > 0; i-- )
+        if( p_sys->checkpoints[i - 1].i_pos <= seek_len )
+        {
+            p_cp = &p_sys->checkpoints[i - 1];
+            break;
+        }
+
+    if( p_cp == NULL || p_cp->i_raw < p_sys->i_raw )
+    {
+        if( OpenFileInZip( p_access ) )
+            return VLC_EGENERIC;
+        if( p_cp == NULL )
+            return VLC_SUCCESS;
+    }
+
+    /* Skip the compressed data up to the checkpoint */
+    while( p_sys->i_raw < p_cp->i_raw )
+    {
+        uint64_t i_len = p_cp->i_raw - p_sys->i_raw;
+        if( ReadRaw( p_access, p_sys->p_input, __MIN( i_len, ZIP_BUFFER_LEN ) ) <= 0 )
+            return VLC_EGENERIC;
+    }
+
+    inflateEnd( &p_sys->zstream );
+    if( inflateCopy( &p_sys->zstream, &p_cp->zstream ) != Z_OK )
+    {
+        p_sys->b_zstream = false;
+        return VLC_EGENERIC;
+    }
+    p_sys->zstream.next_in = p_sys->p_input;
+    p_sys->zstream.avail_in = 0;
+    p_sys->b_eof = false;
+    p_access->info.i_pos = p_cp->i_pos;
+    return VLC_SUCCESS;
+}
+
 /** **************************************************************************
  * \brief Seek inside zip file
  *****************************************************************************/
@@ -316,40 +522,167 @@ static int AccessSeek( access_t *p_access, uint64_t seek_len )
         return VLC_EGENERIC;
     }
 
-    /* Reopen file in zip if needed */
-    if( p_access->info.i_pos > seek_len )
+    /* Go backward, or forward to a checkpoint past the current position */
+    bool b_restore = p_access->info.i_pos > seek_len;
+    for( unsigned i = 0; !b_restore && i < p_sys->i_checkpoints; i++ )
+        b_restore = p_sys->checkpoints[i].i_pos > p_access->info.i_pos
+                 && p_sys->checkpoints[i].i_pos <= seek_len;
+
+    if( b_restore )
     {
-        OpenFileInZip( p_access );
+        int i_ret = ( p_sys->i_method == Z_DEFLATED ) ? Restore( p_access, seek_len )
+                                                      : OpenFileInZip( p_access );
+        if( i_ret )
+        {
+            msg_Warn( p_access, "could not seek in file" );
+            return VLC_EGENERIC;
+        }
     }
 
-    /* Read seek_len data and drop it */
-    unsigned i_seek = 0;
+    /* Read data up to seek_len and drop it */
     int i_read = 1;
-    char *p_buffer = ( char* ) calloc( 1, ZIP_BUFFER_LEN );
+    uint8_t *p_buffer = malloc( ZIP_BUFFER_LEN );
     if( unlikely( !p_buffer ) )
         return VLC_EGENERIC;
-    while( ( i_seek < seek_len ) && ( i_read > 0 ) )
+    while( ( p_access->info.i_pos < seek_len ) && ( i_read > 0 ) )
     {
-        i_read = ( seek_len - i_seek < ZIP_BUFFER_LEN )
-               ? ( seek_len - i_seek ) : ZIP_BUFFER_LEN;
-        i_read = unzReadCurrentFile( file, p_buffer, i_read );
+        uint64_t i_len = seek_len - p_access->info.i_pos;
+        i_read = Decode( p_access, p_buffer, __MIN( i_len, ZIP_BUFFER_LEN ) );
         if( i_read < 0 )
         {
             msg_Warn( p_access, "could not seek in file" );
             free( p_buffer );
             return VLC_EGENERIC;
         }
-        else
-        {
-            i_seek += i_read;
-        }
     }
     free( p_buffer );
 
-    p_access->info.i_pos = unztell( file );
     return VLC_SUCCESS;
 }
 
+static int CompareEntry( const void *a, const void *b )
+{
+    const zip_index_entry_t *p_a = a, *p_b = b;
+    return strcmp( p_a->psz_name, p_b->psz_name );
+}
+
+static void DeleteIndex( zip_index_t *p_index )
+{
+    for( uLong i = 0; i < p_index->i_count; i++ )
+        free( p_index->p_entries[i].psz_name );
+    free( p_index->p_entries );
+    free( p_index->psz_zip );
+    free( p_index );
+}
+
+/** **************************************************************************
+ * \brief Index the central directory of the archive
+ *****************************************************************************/
+static zip_index_t *CreateIndex( access_t *p_access, uLong i_count )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    unzFile file = p_sys->zipFile;
+
+    zip_index_t *p_index = malloc( sizeof( *p_index ) );
+    if( unlikely( !p_index ) )
+        return NULL;
+    p_index->psz_zip = strdup( p_sys->psz_pathToZip );
+    p_index->i_size = p_sys->i_zipSize;
+    p_index->i_count = 0;
+    p_index->p_entries = calloc( i_count ? i_count : 1,
+                                 sizeof( *p_index->p_entries ) );
+    if( unlikely( !p_index->psz_zip || !p_index->p_entries ) )
+        goto error;
+
+    for( int i_ret = unzGoToFirstFile( file );
+         i_ret == UNZ_OK && p_index->i_count < i_count;
+         i_ret = unzGoToNextFile( file ) )
+    {
+        char psz_name[ZIP_FILENAME_LEN];
+        if( unzGetCurrentFileInfo( file, NULL, psz_name, ZIP_FILENAME_LEN,
+                                   NULL, 0, NULL, 0 ) != UNZ_OK )
+            goto error;
+
+        zip_index_entry_t *p_entry = &p_index->p_entries[p_index->i_count];
+        p_entry->psz_name = strdup( psz_name );
+        if( unlikely( !p_entry->psz_name ) )
+            goto error;
+        p_entry->i_entry = unzGetOffset( file );
+        p_index->i_count++;
+    }
+    if( p_index->i_count != i_count )
+        goto error;
+
+    qsort( p_index->p_entries, p_index->i_count,
+           sizeof( *p_index->p_entries ), CompareEntry );
+    return p_index;
+
+error:
+    DeleteIndex( p_index );
+    return NULL;
+}
+
+/** **************************************************************************
+ * \brief Find the file in zip through the cached index of the archive
+ *****************************************************************************/
+static int LocateFile( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    unzFile file = p_sys->zipFile;
+    unz_global_info info;
+    zip_index_t *p_index = NULL;
+    int i_ret = VLC_EGENERIC;
+
+    if( unzGetGlobalInfo( file, &info ) != UNZ_OK )
+        return VLC_EGENERIC;
+
+    vlc_mutex_lock( &zip_index_lock );
+    for( unsigned i = 0; i < ZIP_INDEX_CACHE; i++ )
+    {
+        zip_index_t *p_tmp = zip_index[i];
+        if( p_tmp && p_tmp->i_size == p_sys->i_zipSize
+         && p_tmp->i_count == info.number_entry
+         && !strcmp( p_tmp->psz_zip, p_sys->psz_pathToZip ) )
+        {
+            p_index = p_tmp;
+            break;
+        }
+    }
+    if( p_index == NULL )
+    {
+        p_index = CreateIndex( p_access, info.number_entry );
+        if( p_index != NULL )
+        {
+            if( zip_index[zip_index_next] )
+                DeleteIndex( zip_index[zip_index_next] );
+            zip_index[zip_index_next] = p_index;
+            zip_index_next = ( zip_index_next + 1 ) % ZIP_INDEX_CACHE;
+        }
+    }
+    if( p_index != NULL )
+    {
+        const zip_index_entry_t key = { .psz_name = p_sys->psz_fileInzip };
+        const zip_index_entry_t *p_entry =
+            bsearch( &key, p_index->p_entries, p_index->i_count,
+                     sizeof( key ), CompareEntry );
+        if( p_entry && unzSetOffset( file, p_entry->i_entry ) == UNZ_OK )
+        {
+            p_sys->i_entry = p_entry->i_entry;
+            i_ret = VLC_SUCCESS;
+        }
+    }
+    vlc_mutex_unlock( &zip_index_lock );
+
+    /* The index is case sensitive, unzLocateFile() may not be */
+    if( i_ret != VLC_SUCCESS
+     && unzLocateFile( file, p_sys->psz_fileInzip, 0 ) == UNZ_OK )
+    {
+        p_sys->i_entry = unzGetOffset( file );
+        i_ret = VLC_SUCCESS;
+    }
+    return i_ret;
+}
+
 /** **************************************************************************
  * \brief Open file in zip
  *****************************************************************************/
@@ -363,21 +696,50 @@ static int OpenFileInZip( access_t *p_access )
     }
 
     p_access->info.i_pos = 0;
+    p_sys->i_raw = 0;
+    p_sys->b_eof = false;
 
     unzCloseCurrentFile( file ); /* returns UNZ_PARAMERROR if file not opened */
-    if( unzLocateFile( file, p_sys->psz_fileInzip, 0 ) != UNZ_OK )
+    if( p_sys->b_entry ? unzSetOffset( file, p_sys->i_entry ) != UNZ_OK
+                       : LocateFile( p_access ) != VLC_SUCCESS )
     {
         msg_Err( p_access, "could not [re]locate file in zip: '%s'",
                  p_sys->psz_fileInzip );
         return VLC_EGENERIC;
     }
-    if( unzOpenCurrentFile( file ) != UNZ_OK )
+    p_sys->b_entry = true;
+
+    int i_level;
+    if( unzOpenCurrentFile2( file, &p_sys->i_method, &i_level, 1 ) != UNZ_OK )
     {
         msg_Err( p_access, "could not [re]open file in zip: '%s'",
                  p_sys->psz_fileInzip );
         return VLC_EGENERIC;
     }
 
+    if( p_sys->i_method == Z_DEFLATED )
+    {
+        int i_ret;
+        if( p_sys->b_zstream )
+            i_ret = inflateReset( &p_sys->zstream );
+        else
+        {
+            memset( &p_sys->zstream, 0, sizeof( p_sys->zstream ) );
+            i_ret = inflateInit2( &p_sys->zstream, -MAX_WBITS );
+            p_sys->b_zstream = ( i_ret == Z_OK );
+        }
+        if( i_ret != Z_OK )
+            return VLC_ENOMEM;
+        p_sys->zstream.next_in = p_sys->p_input;
+        p_sys->zstream.avail_in = 0;
+    }
+    else if( p_sys->i_method != 0 )
+    {
+        msg_Err( p_access, "unsupported compression method %d in zip: '%s'",
+                 p_sys->i_method, p_sys->psz_fileInzip );
+        return VLC_EGENERIC;
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -406,6 +768,8 @@ static void* ZCALLBACK ZipIO_Open( void* opaque, const char* file, int mode )
 
     stream_t *s = stream_UrlNew( p_access, fileUri );
     free( fileUri );
+    if( s != NULL )
+        p_access->p_sys->i_zipSize = stream_Size( s );
     return s;
 }
 
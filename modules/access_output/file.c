@@ -31,6 +31,7 @@
 #endif
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -73,6 +74,21 @@ static void Close( vlc_object_t * );
     "on the file path")
 #define SYNC_TEXT N_("Synchronous writing")
 #define SYNC_LONGTEXT N_( "Open the file with synchronous writing.")
+#define ASYNC_TEXT N_("Asynchronous writing")
+#define ASYNC_LONGTEXT N_( \
+    "Write the file from a separate thread, through a buffer, so that slow " \
+    "storage does not delay the stream output.")
+#define BUFFER_TEXT N_("Write buffer size (kB)")
+#define BUFFER_LONGTEXT N_( \
+    "Size of the writes issued by the asynchronous writer. Up to 32 such " \
+    "buffers can be queued before the stream output has to wait.")
+#define PREALLOC_TEXT N_("Preallocation (MB)")
+#define PREALLOC_LONGTEXT N_( \
+    "Reserve the disk space of the file by chunks of this size, when " \
+    "writing asynchronously (0 = never).")
+#define DIRECT_TEXT N_("Direct I/O")
+#define DIRECT_LONGTEXT N_( \
+    "Bypass the page cache when writing asynchronously to a regular file.")
 
 vlc_module_begin ()
     set_description( N_("File stream output") )
@@ -90,6 +106,18 @@ vlc_module_begin ()
 #ifdef O_SYNC
     add_bool( SOUT_CFG_PREFIX "sync", false, SYNC_TEXT,SYNC_LONGTEXT,
               false )
+#endif
+    add_bool( SOUT_CFG_PREFIX "async", false, ASYNC_TEXT, ASYNC_LONGTEXT,
+              true )
+    add_integer( SOUT_CFG_PREFIX "buffer", 1024, BUFFER_TEXT,
+                 BUFFER_LONGTEXT, true )
+        change_integer_range( 4, 65536 )
+    add_integer( SOUT_CFG_PREFIX "prealloc", 0, PREALLOC_TEXT,
+                 PREALLOC_LONGTEXT, true )
+        change_integer_range( 0, 4096 )
+#ifdef O_DIRECT
+    add_bool( SOUT_CFG_PREFIX "direct", false, DIRECT_TEXT, DIRECT_LONGTEXT,
+              true )
 #endif
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -100,19 +128,68 @@ vlc_module_end ()
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
     "append",
+    "async",
+    "buffer",
+#ifdef O_DIRECT
+    "direct",
+#endif
     "format",
     "overwrite",
+    "prealloc",
 #ifdef O_SYNC
     "sync",
 #endif
     NULL
 };
 
+/* Alignment of the writes with direct I/O */
+#define FILE_ALIGN 4096
+/* Number of write buffers that can be queued */
+#define FILE_QUEUE 32
+
+struct sout_access_out_sys_t
+{
+    int          fd;
+
+    /* Asynchronous writer */
+    bool         b_async;
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait;      /* signaled to the writer */
+    vlc_cond_t   wait_done; /* signaled by the writer */
+    block_t     *p_first;
+    block_t    **pp_last;
+    size_t       i_queued;  /* bytes in the queue */
+    bool         b_busy;    /* the writer is writing a chain */
+    bool         b_flush;   /* write the buffer now */
+    bool         b_exit;
+    bool         b_error;
+
+    /* Owned by the writer, or by the caller while it is idle */
+    uint8_t     *p_buf;
+    size_t       i_buf;
+    size_t       i_buf_size;
+    bool         b_direct;
+    off_t        i_pos;
+    off_t        i_alloc_end;
+    off_t        i_prealloc;
+
+    /* Back-pressure statistics */
+    uint64_t     i_bytes;
+    uint64_t     i_writes;
+    size_t       i_peak;
+    unsigned     i_stalls;
+    mtime_t      i_stall_time;
+};
+
 static ssize_t Write( sout_access_out_t *, block_t * );
 static int Seek ( sout_access_out_t *, off_t  );
 static ssize_t Read ( sout_access_out_t *, block_t * );
 static int Control( sout_access_out_t *, int, va_list );
 
+static int  WriterStart( sout_access_out_t * );
+static void WriterStop( sout_access_out_t * );
+
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -207,16 +284,28 @@ static int Open( vlc_object_t *p_this )
             return VLC_EGENERIC;
     }
 
+    sout_access_out_sys_t *p_sys = calloc (1, sizeof (*p_sys));
+    if (unlikely(p_sys == NULL))
+    {
+        close (fd);
+        return VLC_ENOMEM;
+    }
+    p_sys->fd = fd;
+
     p_access->pf_write = Write;
     p_access->pf_read  = Read;
     p_access->pf_seek  = Seek;
     p_access->pf_control = Control;
-    p_access->p_sys    = (void *)(intptr_t)fd;
+    p_access->p_sys    = p_sys;
 
     msg_Dbg( p_access, "file access output opened (%s)", p_access->psz_path );
     if (append)
         lseek (fd, 0, SEEK_END);
 
+    if (var_GetBool (p_access, SOUT_CFG_PREFIX"async")
+     && WriterStart (p_access))
+        msg_Warn (p_access, "writing synchronously");
+
     return VLC_SUCCESS;
 }
 
@@ -226,8 +315,12 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t * p_this )
 {
     sout_access_out_t *p_access = (sout_access_out_t*)p_this;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
 
-    close( (intptr_t)p_access->p_sys );
+    if (p_sys->b_async)
+        WriterStop (p_access);
+    close (p_sys->fd);
+    free (p_sys);
 
     msg_Dbg( p_access, "file access output closed" );
 }
@@ -249,17 +342,351 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Asynchronous writer
+ *****************************************************************************
+ * The blocks are queued by Write() and copied by the writer thread into an
+ * aligned buffer, which is written whenever it is full, when the writer has
+ * been idle for a second, and before any seek or read of the file.
+ *****************************************************************************/
+static void WriterSetDirect (sout_access_out_t *p_access, bool b_direct)
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+#ifdef O_DIRECT
+    int flags = fcntl (p_sys->fd, F_GETFL);
+
+    if (flags != -1)
+    {
+        flags = b_direct ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+        if (fcntl (p_sys->fd, F_SETFL, flags) == 0)
+        {
+            p_sys->b_direct = b_direct;
+            return;
+        }
+    }
+    if (b_direct)
+        msg_Warn (p_access, "direct I/O not available: %m");
+#else
+    VLC_UNUSED(b_direct);
+#endif
+    p_sys->b_direct = false;
+}
+
+static int WriterWriteRaw (sout_access_out_t *p_access,
+                           const uint8_t *p_data, size_t i_data)
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    while (p_sys->i_prealloc > 0
+        && p_sys->i_pos + (off_t)i_data > p_sys->i_alloc_end)
+    {
+        off_t i_start = __MAX(p_sys->i_alloc_end, p_sys->i_pos);
+
+        if (fallocate (p_sys->fd, FALLOC_FL_KEEP_SIZE, i_start,
+                       p_sys->i_prealloc))
+        {
+            msg_Warn (p_access, "cannot preallocate: %m");
+            p_sys->i_prealloc = 0;
+        }
+        else
+            p_sys->i_alloc_end = i_start + p_sys->i_prealloc;
+    }
+#endif
+
+    while (i_data > 0)
+    {
+        ssize_t val = write (p_sys->fd, p_data, i_data);
+        if (val < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EINVAL && p_sys->b_direct)
+            {
+                /* The file system does not take direct I/O after all */
+                WriterSetDirect (p_access, false);
+                continue;
+            }
+            msg_Err (p_access, "cannot write: %m");
+            return -1;
+        }
+        p_data += val;
+        i_data -= val;
+        p_sys->i_pos += val;
+        p_sys->i_bytes += val;
+        p_sys->i_writes++;
+    }
+    return 0;
+}
+
+/* Writes the buffer, or only its aligned part unless b_all is set */
+static int WriterWriteBuffer (sout_access_out_t *p_access, bool b_all)
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    size_t i_data = p_sys->i_buf;
+
+    if (p_sys->b_direct)
+    {
+        if ((p_sys->i_pos % FILE_ALIGN) != 0
+         || (b_all && (i_data % FILE_ALIGN) != 0))
+        {
+            msg_Dbg (p_access, "unaligned write, leaving direct I/O");
+            WriterSetDirect (p_access, false);
+        }
+        else
+            i_data -= i_data % FILE_ALIGN;
+    }
+    if (i_data == 0)
+        return 0;
+
+    int ret = WriterWriteRaw (p_access, p_sys->p_buf, i_data);
+    p_sys->i_buf -= i_data;
+    memmove (p_sys->p_buf, p_sys->p_buf + i_data, p_sys->i_buf);
+    return ret;
+}
+
+static void *WriterThread (void *data)
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock (&p_sys->lock);
+    for (;;)
+    {
+        while (p_sys->p_first == NULL && !p_sys->b_flush && !p_sys->b_exit)
+        {
+            const size_t i_min = p_sys->b_direct ? FILE_ALIGN : 1;
+
+            if (p_sys->i_buf < i_min)
+            {
+                vlc_cond_wait (&p_sys->wait, &p_sys->lock);
+                continue;
+            }
+            if (vlc_cond_timedwait (&p_sys->wait, &p_sys->lock,
+                                    mdate () + CLOCK_FREQ) == 0
+             || p_sys->p_first != NULL || p_sys->b_flush || p_sys->b_exit)
+                continue;
+
+            /* Nothing came for a while: write what is buffered */
+            p_sys->b_busy = true;
+            vlc_mutex_unlock (&p_sys->lock);
+            int ret = WriterWriteBuffer (p_access, false);
+            vlc_mutex_lock (&p_sys->lock);
+            if (ret)
+                p_sys->b_error = true;
+            p_sys->b_busy = false;
+            vlc_cond_broadcast (&p_sys->wait_done);
+        }
+
+        block_t *p_chain = p_sys->p_first;
+        const bool b_flush = p_sys->b_flush;
+        const bool b_exit = p_sys->b_exit;
+
+        p_sys->p_first = NULL;
+        p_sys->pp_last = &p_sys->p_first;
+        p_sys->i_queued = 0;
+        p_sys->b_busy = true;
+        vlc_cond_broadcast (&p_sys->wait_done);
+        vlc_mutex_unlock (&p_sys->lock);
+
+        int ret = 0;
+        while (p_chain != NULL)
+        {
+            block_t *p_next = p_chain->p_next;
+            const uint8_t *p_data = p_chain->p_buffer;
+            size_t i_data = p_chain->i_buffer;
+
+            while (i_data > 0 && ret == 0)
+            {
+                size_t i_copy = __MIN(i_data,
+                                      p_sys->i_buf_size - p_sys->i_buf);
+
+                memcpy (p_sys->p_buf + p_sys->i_buf, p_data, i_copy);
+                p_sys->i_buf += i_copy;
+                p_data += i_copy;
+                i_data -= i_copy;
+                if (p_sys->i_buf == p_sys->i_buf_size)
+                    ret = WriterWriteBuffer (p_access, false);
+            }
+            block_Release (p_chain);
+            p_chain = p_next;
+        }
+        if (ret == 0 && (b_flush || b_exit))
+            ret = WriterWriteBuffer (p_access, true);
+
+        vlc_mutex_lock (&p_sys->lock);
+        if (ret)
+            p_sys->b_error = true;
+        if (b_flush)
+            p_sys->b_flush = false;
+        p_sys->b_busy = false;
+        vlc_cond_broadcast (&p_sys->wait_done);
+        if (b_exit && p_sys->p_first == NULL)
+            break;
+    }
+    vlc_mutex_unlock (&p_sys->lock);
+    return NULL;
+}
+
+static int WriterStart (sout_access_out_t *p_access)
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    struct stat st;
+    size_t i_size = var_GetInteger (p_access, SOUT_CFG_PREFIX"buffer") << 10;
+
+    i_size = (i_size + FILE_ALIGN - 1) & ~(size_t)(FILE_ALIGN - 1);
+    p_sys->p_buf = vlc_memalign (FILE_ALIGN, i_size);
+    if (unlikely(p_sys->p_buf == NULL))
+        return VLC_ENOMEM;
+    p_sys->i_buf_size = i_size;
+    p_sys->i_buf = 0;
+
+    p_sys->i_pos = lseek (p_sys->fd, 0, SEEK_CUR);
+    if (p_sys->i_pos < 0)
+        p_sys->i_pos = 0;
+    p_sys->i_alloc_end = p_sys->i_pos;
+
+    /* Preallocation and direct I/O only make sense for regular files */
+    if (fstat (p_sys->fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        p_sys->i_prealloc =
+            (off_t)var_GetInteger (p_access, SOUT_CFG_PREFIX"prealloc") << 20;
+#ifdef O_DIRECT
+        if (var_GetBool (p_access, SOUT_CFG_PREFIX"direct"))
+            WriterSetDirect (p_access, true);
+#endif
+    }
+
+    vlc_mutex_init (&p_sys->lock);
+    vlc_cond_init (&p_sys->wait);
+    vlc_cond_init (&p_sys->wait_done);
+    p_sys->p_first = NULL;
+    p_sys->pp_last = &p_sys->p_first;
+
+    if (vlc_clone (&p_sys->thread, WriterThread, p_access,
+                   VLC_THREAD_PRIORITY_LOW))
+    {
+        vlc_cond_destroy (&p_sys->wait_done);
+        vlc_cond_destroy (&p_sys->wait);
+        vlc_mutex_destroy (&p_sys->lock);
+        if (p_sys->b_direct)
+            WriterSetDirect (p_access, false);
+        vlc_free (p_sys->p_buf);
+        return VLC_EGENERIC;
+    }
+    p_sys->b_async = true;
+    msg_Dbg (p_access, "writing asynchronously by %zu bytes%s", i_size,
+             p_sys->b_direct ? ", direct I/O" : "");
+    return VLC_SUCCESS;
+}
+
+static void WriterStop (sout_access_out_t *p_access)
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock (&p_sys->lock);
+    p_sys->b_exit = true;
+    vlc_cond_signal (&p_sys->wait);
+    vlc_mutex_unlock (&p_sys->lock);
+    vlc_join (p_sys->thread, NULL);
+
+    vlc_cond_destroy (&p_sys->wait_done);
+    vlc_cond_destroy (&p_sys->wait);
+    vlc_mutex_destroy (&p_sys->lock);
+    vlc_free (p_sys->p_buf);
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    /* Release the space preallocated past the end of the file */
+    struct stat st;
+    if (p_sys->i_alloc_end > 0 && fstat (p_sys->fd, &st) == 0
+     && ftruncate (p_sys->fd, st.st_size))
+        msg_Warn (p_access, "cannot truncate: %m");
+#endif
+
+    msg_Dbg (p_access, "wrote %"PRIu64" bytes in %"PRIu64" writes, "
+             "queued up to %zu bytes, waited %u times (%"PRId64" ms)",
+             p_sys->i_bytes, p_sys->i_writes, p_sys->i_peak,
+             p_sys->i_stalls, p_sys->i_stall_time / 1000);
+}
+
+static ssize_t WriterQueue (sout_access_out_t *p_access, block_t *p_buffer)
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    size_t i_write = 0;
+
+    for (block_t *p_block = p_buffer; p_block; p_block = p_block->p_next)
+        i_write += p_block->i_buffer;
+
+    vlc_mutex_lock (&p_sys->lock);
+    if (p_sys->i_queued >= FILE_QUEUE * p_sys->i_buf_size && !p_sys->b_error)
+    {
+        /* The storage does not keep up: throttle the stream output */
+        mtime_t i_start = mdate ();
+
+        if (p_sys->i_stalls++ == 0)
+            msg_Warn (p_access, "writing is too slow, waiting");
+        while (p_sys->i_queued >= FILE_QUEUE * p_sys->i_buf_size
+            && !p_sys->b_error)
+            vlc_cond_wait (&p_sys->wait_done, &p_sys->lock);
+        p_sys->i_stall_time += mdate () - i_start;
+    }
+    if (p_sys->b_error)
+    {
+        vlc_mutex_unlock (&p_sys->lock);
+        block_ChainRelease (p_buffer);
+        return -1;
+    }
+
+    block_ChainLastAppend (&p_sys->pp_last, p_buffer);
+    p_sys->i_queued += i_write;
+    if (p_sys->i_queued > p_sys->i_peak)
+        p_sys->i_peak = p_sys->i_queued;
+    vlc_cond_signal (&p_sys->wait);
+    vlc_mutex_unlock (&p_sys->lock);
+    return i_write;
+}
+
+/* Waits until everything is written, and keeps the writer idle until
+ * WriterResume() */
+static void WriterDrain (sout_access_out_t *p_access)
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock (&p_sys->lock);
+    p_sys->b_flush = true;
+    vlc_cond_signal (&p_sys->wait);
+    while (p_sys->b_flush || p_sys->b_busy || p_sys->p_first != NULL)
+        vlc_cond_wait (&p_sys->wait_done, &p_sys->lock);
+}
+
+static void WriterResume (sout_access_out_t *p_access, off_t i_pos)
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if (i_pos >= 0)
+        p_sys->i_pos = i_pos;
+    if (p_sys->b_direct && (p_sys->i_pos % FILE_ALIGN) != 0)
+        WriterSetDirect (p_access, false);
+    vlc_mutex_unlock (&p_sys->lock);
+}
+
 /*****************************************************************************
  * Read: standard read on a file descriptor.
  *****************************************************************************/
 static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
 {
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
     ssize_t val;
 
+    if (p_sys->b_async)
+        WriterDrain (p_access);
+
     do
-        val = read( (intptr_t)p_access->p_sys, p_buffer->p_buffer,
-                    p_buffer->i_buffer );
+        val = read( p_sys->fd, p_buffer->p_buffer, p_buffer->i_buffer );
     while (val == -1 && errno == EINTR);
+
+    if (p_sys->b_async)
+        WriterResume (p_access, lseek (p_sys->fd, 0, SEEK_CUR));
     return val;
 }
 
@@ -268,11 +695,15 @@ static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
  *****************************************************************************/
 static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 {
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
     size_t i_write = 0;
 
+    if (p_sys->b_async)
+        return WriterQueue (p_access, p_buffer);
+
     while( p_buffer )
     {
-        ssize_t val = write ((intptr_t)p_access->p_sys,
+        ssize_t val = write (p_sys->fd,
                              p_buffer->p_buffer, p_buffer->i_buffer);
         if (val <= 0)
         {
@@ -304,5 +735,13 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
  *****************************************************************************/
 static int Seek( sout_access_out_t *p_access, off_t i_pos )
 {
-    return lseek( (intptr_t)p_access->p_sys, i_pos, SEEK_SET );
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if (!p_sys->b_async)
+        return lseek( p_sys->fd, i_pos, SEEK_SET );
+
+    WriterDrain (p_access);
+    i_pos = lseek (p_sys->fd, i_pos, SEEK_SET);
+    WriterResume (p_access, i_pos);
+    return i_pos;
 }
@@ -45,6 +45,7 @@
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_charset.h>
+#include <vlc_httpd.h>
 
 #include <gcrypt.h>
 #include <vlc_gcrypt.h>
@@ -97,6 +98,16 @@ static void Close( vlc_object_t * );
 #define KEYFILE_TEXT N_("AES key file")
 #define KEYFILE_LONGTEXT N_("File containing the 16 bytes encryption key")
 
+#define MEMORY_TEXT N_("Keep the segments in memory")
+#define MEMORY_LONGTEXT N_("Serve the index and the segments from memory " \
+                           "instead of writing them to files. The serve " \
+                           "option gives their URL path.")
+
+#define SERVE_TEXT N_("Serve the segments")
+#define SERVE_LONGTEXT N_("URL path under which the directory of the index " \
+                          "file is served by the VLC HTTP server, for " \
+                          "instance /hls/. Nothing is served if empty.")
+
 #define RANDOMIV_TEXT N_("Use randomized IV for encryption")
 #define RANDOMIV_LONGTEXT N_("Generate IV instead using segment-number as IV")
 
@@ -127,6 +138,10 @@ vlc_module_begin ()
                 KEYURI_TEXT, KEYURI_TEXT, true )
     add_loadfile( SOUT_CFG_PREFIX "key-file", NULL,
                 KEYFILE_TEXT, KEYFILE_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "serve", NULL,
+                SERVE_TEXT, SERVE_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "memory", false,
+              MEMORY_TEXT, MEMORY_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -146,6 +161,8 @@ static const char *const ppsz_sout_options[] = {
     "key-uri",
     "key-file",
     "generate-iv",
+    "serve",
+    "memory",
     NULL
 };
 
@@ -153,6 +170,16 @@ static ssize_t Write( sout_access_out_t *, block_t * );
 static int Seek ( sout_access_out_t *, off_t  );
 static int Control( sout_access_out_t *, int, va_list );
 
+/* Segment kept in memory */
+typedef struct
+{
+    uint32_t i_segment;
+    char     *psz_entry;    /* index lines */
+    block_t  *p_data;       /* gathered once the segment is complete */
+    block_t  **pp_last;
+    httpd_file_t *p_file;
+} livehttp_segment_t;
+
 struct sout_access_out_sys_t
 {
     char *psz_cursegPath;
@@ -175,9 +202,24 @@ struct sout_access_out_sys_t
     uint8_t aes_ivs[16];
     gcry_cipher_hd_t aes_ctx;
     char *key_uri;
+    httpd_host_t *p_httpd_host;
+    httpd_dir_t *p_httpd_dir;
+
+    /* In memory segments: the host thread reads the index and the
+     * published segments, only the index changes afterwards */
+    bool b_memory;
+    char *psz_serve;
+    livehttp_segment_t *p_curseg;
+    int i_memsegs;
+    livehttp_segment_t **pp_memsegs;
+    httpd_file_t *p_index_file;
+    vlc_mutex_t index_lock;
+    char *psz_index;
 };
 
 static int CryptSetup( sout_access_out_t *p_access );
+static int ServeSetup( sout_access_out_t *p_access );
+static void ServeClean( sout_access_out_sys_t *p_sys );
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -246,8 +288,18 @@ static int Open( vlc_object_t *p_this )
 
     p_access->p_sys = p_sys;
 
+    if( ServeSetup( p_access ) < 0 )
+    {
+        free( p_sys->psz_indexUrl );
+        free( p_sys->psz_indexPath );
+        free( p_sys->p_seglens );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
     if( CryptSetup( p_access ) < 0 )
     {
+        ServeClean( p_sys );
         free( p_sys->psz_indexUrl );
         free( p_sys->psz_indexPath );
         free( p_sys->p_seglens );
@@ -267,6 +319,165 @@ static int Open( vlc_object_t *p_this )
     return VLC_SUCCESS;
 }
 
+/************************************************************************
+ * ServeSetup: Serve the index and the segments with the HTTP server
+ ************************************************************************/
+static int FillIndex( httpd_file_sys_t *p_filesys, httpd_file_t *p_file,
+                      uint8_t *psz_request, uint8_t **pp_data, int *pi_data )
+{
+    sout_access_out_sys_t *p_sys = (sout_access_out_sys_t *)p_filesys;
+    (void) p_file; (void) psz_request;
+
+    vlc_mutex_lock( &p_sys->index_lock );
+    *pp_data = (uint8_t *)strdup( p_sys->psz_index ? p_sys->psz_index
+                                                   : "#EXTM3U\n" );
+    vlc_mutex_unlock( &p_sys->index_lock );
+    *pi_data = *pp_data ? strlen( (char *)*pp_data ) : 0;
+    return VLC_SUCCESS;
+}
+
+static int FillSegment( httpd_file_sys_t *p_filesys, httpd_file_t *p_file,
+                        uint8_t *psz_request, uint8_t **pp_data, int *pi_data )
+{
+    const livehttp_segment_t *p_seg = (livehttp_segment_t *)p_filesys;
+    (void) p_file; (void) psz_request;
+
+    *pp_data = malloc( p_seg->p_data->i_buffer );
+    *pi_data = 0;
+    if( likely( *pp_data ) )
+    {
+        memcpy( *pp_data, p_seg->p_data->p_buffer, p_seg->p_data->i_buffer );
+        *pi_data = p_seg->p_data->i_buffer;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Returns the URL path under which a file is served */
+static char *ServeUrl( sout_access_out_sys_t *p_sys, const char *psz_file )
+{
+    const char *psz_name = strrchr( psz_file, DIR_SEP_CHAR );
+    char *psz_url;
+
+    psz_name = psz_name ? psz_name + 1 : psz_file;
+    if( asprintf( &psz_url, "%s%s%s", p_sys->psz_serve,
+                  p_sys->psz_serve[strlen( p_sys->psz_serve ) - 1] == '/'
+                  ? "" : "/", psz_name ) < 0 )
+        return NULL;
+    return psz_url;
+}
+
+static int ServeSetup( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    char *psz_dir, *psz_sep;
+
+    p_sys->p_httpd_host = NULL;
+    p_sys->p_httpd_dir = NULL;
+    p_sys->p_index_file = NULL;
+    p_sys->p_curseg = NULL;
+    p_sys->i_memsegs = 0;
+    p_sys->pp_memsegs = NULL;
+    p_sys->psz_index = NULL;
+
+    p_sys->psz_serve = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "serve" );
+    p_sys->b_memory = var_GetBool( p_access, SOUT_CFG_PREFIX "memory" );
+    if( !p_sys->psz_serve )
+    {
+        if( p_sys->b_memory )
+        {
+            msg_Err( p_access, "in memory segments need the serve option" );
+            return VLC_EGENERIC;
+        }
+        return VLC_SUCCESS;
+    }
+    vlc_mutex_init( &p_sys->index_lock );
+
+    p_sys->p_httpd_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+    if( !p_sys->p_httpd_host )
+        goto error;
+
+    if( p_sys->b_memory )
+    {
+        char *psz_url = ServeUrl( p_sys, p_sys->psz_indexPath
+                                         ? p_sys->psz_indexPath : "index.m3u8" );
+        if( !psz_url )
+            goto error;
+        p_sys->p_index_file = httpd_FileNew( p_sys->p_httpd_host, psz_url,
+                                             NULL, NULL, NULL, FillIndex,
+                                             (httpd_file_sys_t *)p_sys );
+        if( !p_sys->p_index_file )
+        {
+            msg_Err( p_access, "cannot serve the index as %s", psz_url );
+            free( psz_url );
+            goto error;
+        }
+        msg_Dbg( p_access, "serving the index as %s", psz_url );
+        free( psz_url );
+        return VLC_SUCCESS;
+    }
+
+    /* The index and the segments are expected in the same directory */
+    psz_dir = strdup( p_sys->psz_indexPath ? p_sys->psz_indexPath
+                                           : p_access->psz_path );
+    if( unlikely( !psz_dir ) )
+        goto error;
+    psz_sep = strrchr( psz_dir, DIR_SEP_CHAR );
+    if( psz_sep )
+        *psz_sep = '\0';
+    else
+        strcpy( psz_dir, "." );
+
+    p_sys->p_httpd_dir = httpd_DirNew( p_sys->p_httpd_host, p_sys->psz_serve,
+                                       psz_dir, NULL, NULL );
+    if( !p_sys->p_httpd_dir )
+    {
+        msg_Err( p_access, "cannot serve %s as %s", psz_dir, p_sys->psz_serve );
+        free( psz_dir );
+        goto error;
+    }
+    msg_Dbg( p_access, "serving %s as %s", psz_dir, p_sys->psz_serve );
+    free( psz_dir );
+    return VLC_SUCCESS;
+
+error:
+    if( p_sys->p_httpd_host )
+        httpd_HostDelete( p_sys->p_httpd_host );
+    p_sys->p_httpd_host = NULL;
+    free( p_sys->psz_serve );
+    vlc_mutex_destroy( &p_sys->index_lock );
+    return VLC_EGENERIC;
+}
+
+static void deleteMemorySegment( livehttp_segment_t *p_seg )
+{
+    if( p_seg->p_file )
+        httpd_FileDelete( p_seg->p_file );
+    block_ChainRelease( p_seg->p_data );
+    free( p_seg->psz_entry );
+    free( p_seg );
+}
+
+static void ServeClean( sout_access_out_sys_t *p_sys )
+{
+    if( !p_sys->psz_serve )
+        return;
+
+    if( p_sys->p_index_file )
+        httpd_FileDelete( p_sys->p_index_file );
+    for( int i = 0; i < p_sys->i_memsegs; i++ )
+        deleteMemorySegment( p_sys->pp_memsegs[i] );
+    free( p_sys->pp_memsegs );
+    if( p_sys->p_curseg )
+        deleteMemorySegment( p_sys->p_curseg );
+    if( p_sys->p_httpd_dir )
+        httpd_DirDelete( p_sys->p_httpd_dir );
+    if( p_sys->p_httpd_host )
+        httpd_HostDelete( p_sys->p_httpd_host );
+    free( p_sys->psz_index );
+    free( p_sys->psz_serve );
+    vlc_mutex_destroy( &p_sys->index_lock );
+}
+
 /************************************************************************
  * CryptSetup: Initialize encryption
  ************************************************************************/
@@ -393,6 +604,127 @@ static char *formatSegmentPath( char *psz_path, uint32_t i_seg, bool b_sanitize
     return psz_result;
 }
 
+/************************************************************************
+ * formatIndexHeader: create the index lines before the segments
+ ************************************************************************/
+static char *formatIndexHeader( sout_access_out_sys_t *p_sys, uint32_t i_firstseg, bool b_isend )
+{
+    char *psz_header, *psz_key = NULL;
+
+    if( p_sys->key_uri )
+    {
+        int ret = 0;
+        if( p_sys->b_generate_iv )
+        {
+            unsigned long long iv_hi = 0, iv_lo = 0;
+            for( unsigned short i = 0; i < 8; i++ )
+            {
+                iv_hi |= p_sys->aes_ivs[i] & 0xff;
+                iv_hi <<= 8;
+                iv_lo |= p_sys->aes_ivs[8+i] & 0xff;
+                iv_lo <<= 8;
+            }
+            ret = asprintf( &psz_key, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
+                            p_sys->key_uri, iv_hi, iv_lo );
+
+        } else {
+            ret = asprintf( &psz_key, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", p_sys->key_uri );
+        }
+        if( ret < 0 )
+            return NULL;
+    }
+
+    if ( asprintf( &psz_header, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
+                   "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
+                   p_sys->b_caching ? "YES" : "NO",
+                   p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
+                   i_firstseg, psz_key ? psz_key : "" ) < 0 )
+        psz_header = NULL;
+    free( psz_key );
+    return psz_header;
+}
+
+/************************************************************************
+ * formatIndexEntry: create the index lines of a segment
+ ************************************************************************/
+static char *formatIndexEntry( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, uint32_t i_seg )
+{
+    char *psz_name, *psz_entry;
+    char *psz_duration = NULL;
+    char *psz_idxFormat = p_sys->psz_indexUrl ? p_sys->psz_indexUrl : p_access->psz_path;
+
+    if ( ! ( psz_name = formatSegmentPath( psz_idxFormat, i_seg, false ) ) )
+        return NULL;
+    if( us_asprintf( &psz_duration, "%.2f", p_sys->p_seglens[i_seg % p_sys->i_seglens ] ) < 0 )
+    {
+        free( psz_name );
+        return NULL;
+    }
+
+    /* In memory segments are served next to the index */
+    const char *psz_url = psz_name;
+    if( p_sys->b_memory && !p_sys->psz_indexUrl && strrchr( psz_name, DIR_SEP_CHAR ) )
+        psz_url = strrchr( psz_name, DIR_SEP_CHAR ) + 1;
+
+    if( asprintf( &psz_entry, "#EXTINF:%s,\n%s\n", psz_duration, psz_url ) < 0 )
+        psz_entry = NULL;
+    free( psz_duration );
+    free( psz_name );
+    return psz_entry;
+}
+
+/************************************************************************
+ * updateMemoryIndex: publish the index of the in memory segments, and
+ * drop the ones out of it.
+ ************************************************************************/
+static int updateMemoryIndex( sout_access_out_sys_t *p_sys, uint32_t i_firstseg, bool b_isend )
+{
+    if ( p_sys->b_delsegs )
+    {
+        while( p_sys->i_memsegs > 0 && p_sys->pp_memsegs[0]->i_segment < i_firstseg )
+        {
+            livehttp_segment_t *p_seg = p_sys->pp_memsegs[0];
+            TAB_REMOVE( p_sys->i_memsegs, p_sys->pp_memsegs, p_seg );
+            deleteMemorySegment( p_seg );
+        }
+    }
+
+    char *psz_header = formatIndexHeader( p_sys, i_firstseg, b_isend );
+    if( !psz_header )
+        return -1;
+
+    /* The lines of each segment are formatted once */
+    size_t i_index = strlen( psz_header ) + sizeof( STR_ENDLIST );
+    for( int i = 0; i < p_sys->i_memsegs; i++ )
+        if( p_sys->pp_memsegs[i]->i_segment >= i_firstseg )
+            i_index += strlen( p_sys->pp_memsegs[i]->psz_entry );
+
+    char *psz_index = malloc( i_index ), *p = psz_index;
+    if( unlikely( !psz_index ) )
+    {
+        free( psz_header );
+        return -1;
+    }
+    strcpy( p, psz_header );
+    p += strlen( p );
+    for( int i = 0; i < p_sys->i_memsegs; i++ )
+        if( p_sys->pp_memsegs[i]->i_segment >= i_firstseg )
+        {
+            strcpy( p, p_sys->pp_memsegs[i]->psz_entry );
+            p += strlen( p );
+        }
+    if ( b_isend )
+        strcpy( p, STR_ENDLIST );
+    free( psz_header );
+
+    vlc_mutex_lock( &p_sys->index_lock );
+    char *psz_old = p_sys->psz_index;
+    p_sys->psz_index = psz_index;
+    vlc_mutex_unlock( &p_sys->index_lock );
+    free( psz_old );
+    return 0;
+}
+
 /************************************************************************
  * updateIndexAndDel: If necessary, update index file & delete old segments
  ************************************************************************/
@@ -417,6 +749,9 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     else
         i_firstseg = ( p_sys->i_segment - p_sys->i_numsegs ) + 1;
 
+    if ( p_sys->b_memory )
+        return updateMemoryIndex( p_sys, i_firstseg, b_isend );
+
     // First update index
     if ( p_sys->psz_indexPath )
     {
@@ -434,64 +769,27 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
             return -1;
         }
 
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
-                          "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n", p_sys->i_seglen,
-                          p_sys->b_caching ? "YES" : "NO",
-                          p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
-                          i_firstseg ) < 0 )
+        char *psz_header = formatIndexHeader( p_sys, i_firstseg, b_isend );
+        if ( !psz_header || fputs( psz_header, fp ) < 0 )
         {
+            free( psz_header );
             free( psz_idxTmp );
             fclose( fp );
             return -1;
         }
+        free( psz_header );
 
-        if( p_sys->key_uri )
-        {
-            int ret = 0;
-            if( p_sys->b_generate_iv )
-            {
-                unsigned long long iv_hi = 0, iv_lo = 0;
-                for( unsigned short i = 0; i < 8; i++ )
-                {
-                    iv_hi |= p_sys->aes_ivs[i] & 0xff;
-                    iv_hi <<= 8;
-                    iv_lo |= p_sys->aes_ivs[8+i] & 0xff;
-                    iv_lo <<= 8;
-                }
-                ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
-                               p_sys->key_uri, iv_hi, iv_lo );
-
-            } else {
-                ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", p_sys->key_uri );
-            }
-            if( ret < 0 )
-            {
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
-            }
-        }
-
-        char *psz_idxFormat = p_sys->psz_indexUrl ? p_sys->psz_indexUrl : p_access->psz_path;
         for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
         {
-            char *psz_name;
-            char *psz_duration = NULL;
-            if ( ! ( psz_name = formatSegmentPath( psz_idxFormat, i, false ) ) )
-            {
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
-            }
-            if( ! ( us_asprintf( &psz_duration, "%.2f", p_sys->p_seglens[i % p_sys->i_seglens ], psz_name ) ) )
+            char *psz_entry = formatIndexEntry( p_access, p_sys, i );
+            if ( !psz_entry )
             {
                 free( psz_idxTmp );
                 fclose( fp );
                 return -1;
             }
-            val = fprintf( fp, "#EXTINF:%s,\n%s\n", psz_duration, psz_name );
-            free( psz_duration );
-            free( psz_name );
+            val = fputs( psz_entry, fp );
+            free( psz_entry );
             if ( val < 0 )
             {
                 free( psz_idxTmp );
@@ -538,11 +836,48 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     return 0;
 }
 
+static inline bool isSegmentOpen( const sout_access_out_sys_t *p_sys )
+{
+    return p_sys->i_handle >= 0 || p_sys->p_curseg != NULL;
+}
+
 /*****************************************************************************
  * closeCurrentSegment: Close the segment file
  *****************************************************************************/
 static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
 {
+    if ( p_sys->p_curseg )
+    {
+        livehttp_segment_t *p_seg = p_sys->p_curseg;
+        char *psz_url = NULL;
+
+        p_sys->p_curseg = NULL;
+        if( p_seg->p_data )
+            p_seg->p_data = block_ChainGather( p_seg->p_data );
+        if( p_seg->p_data )
+            p_seg->psz_entry = formatIndexEntry( p_access, p_sys, p_seg->i_segment );
+        if( p_seg->psz_entry )
+            psz_url = ServeUrl( p_sys, p_sys->psz_cursegPath );
+        if( psz_url )
+            p_seg->p_file = httpd_FileNew( p_sys->p_httpd_host, psz_url, NULL,
+                                           NULL, NULL, FillSegment,
+                                           (httpd_file_sys_t *)p_seg );
+        if ( !p_seg->p_file )
+        {
+            msg_Err( p_access, "cannot serve segment %"PRIu32, p_seg->i_segment );
+            deleteMemorySegment( p_seg );
+        }
+        else
+        {
+            msg_Info( p_access, "LiveHttpSegmentComplete: %s (%"PRIu32")" , psz_url, p_seg->i_segment );
+            TAB_APPEND( p_sys->i_memsegs, p_sys->pp_memsegs, p_seg );
+        }
+        free( psz_url );
+        free( p_sys->psz_cursegPath );
+        p_sys->psz_cursegPath = NULL;
+        updateIndexAndDel( p_access, p_sys, b_isend );
+    }
+
     if ( p_sys->i_handle >= 0 )
     {
         close( p_sys->i_handle );
@@ -589,6 +924,19 @@ static void Close( vlc_object_t * p_this )
             }
 
         }
+        if ( p_sys->p_curseg )
+        {
+            block_t *p_next = p_sys->block_buffer->p_next;
+
+            if( !p_next )
+                p_sys->p_seglens[p_sys->i_segment % p_sys->i_seglens ] =
+                    (float)( p_sys->block_buffer->i_length / (1000000)) +
+                    (float)(p_sys->block_buffer->i_dts - p_sys->i_opendts) / CLOCK_FREQ;
+            p_sys->block_buffer->p_next = NULL;
+            block_ChainLastAppend( &p_sys->p_curseg->pp_last, p_sys->block_buffer );
+            p_sys->block_buffer = p_next;
+            continue;
+        }
         ssize_t val = write( p_sys->i_handle, p_sys->block_buffer->p_buffer, p_sys->block_buffer->i_buffer );
         if ( val == -1 )
         {
@@ -618,16 +966,18 @@ static void Close( vlc_object_t * p_this )
     }
 
     closeCurrentSegment( p_access, p_sys, true );
-    free( p_sys->psz_indexUrl );
-    free( p_sys->psz_indexPath );
-    free( p_sys->p_seglens );
-    free( p_sys );
+    ServeClean( p_sys );
 
     if( p_sys->key_uri )
     {
         gcry_cipher_close( p_sys->aes_ctx );
         free( p_sys->key_uri );
     }
+    free( p_sys->psz_indexUrl );
+    free( p_sys->psz_indexPath );
+    free( p_sys->p_seglens );
+    free( p_sys );
+
     msg_Dbg( p_access, "livehttp access output closed" );
 }
 
@@ -664,6 +1014,25 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
     if ( !psz_seg )
         return -1;
 
+    if ( p_sys->b_memory )
+    {
+        livehttp_segment_t *p_seg = calloc( 1, sizeof( *p_seg ) );
+        if ( unlikely( !p_seg ) )
+        {
+            free( psz_seg );
+            return -1;
+        }
+        p_seg->i_segment = i_newseg;
+        p_seg->pp_last = &p_seg->p_data;
+
+        if( p_sys->key_uri )
+            CryptKey( p_access, i_newseg );
+        p_sys->psz_cursegPath = psz_seg;
+        p_sys->p_curseg = p_seg;
+        p_sys->i_segment = i_newseg;
+        return 0;
+    }
+
     fd = vlc_open( psz_seg, O_WRONLY | O_CREAT | O_LARGEFILE |
                      O_TRUNC, 0666 );
     if ( fd == -1 )
@@ -701,13 +1070,13 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
             p_sys->block_buffer = NULL;
 
 
-            if( p_sys->i_handle > 0 &&
+            if( isSegmentOpen( p_sys ) &&
                 ( p_buffer->i_dts - p_sys->i_opendts +
                   p_buffer->i_length * CLOCK_FREQ / INT64_C(1000000)
                 ) >= p_sys->i_seglenm )
                 closeCurrentSegment( p_access, p_sys, false );
 
-            if ( p_sys->i_handle < 0 )
+            if ( !isSegmentOpen( p_sys ) )
             {
                 p_sys->i_opendts = output ? output->i_dts : p_buffer->i_dts;
                 if ( openNextFile( p_access, p_sys ) < 0 )
@@ -737,6 +1106,20 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                     }
 
                 }
+                if ( p_sys->p_curseg )
+                {
+                    /* The block is kept as is */
+                    block_t *p_next = output->p_next;
+
+                    p_sys->p_seglens[p_sys->i_segment % p_sys->i_seglens ] =
+                        (float)output->i_length / INT64_C(1000000) +
+                        (float)(output->i_dts - p_sys->i_opendts) / CLOCK_FREQ;
+                    i_write += output->i_buffer;
+                    output->p_next = NULL;
+                    block_ChainLastAppend( &p_sys->p_curseg->pp_last, output );
+                    output = p_next;
+                    continue;
+                }
                 ssize_t val = write( p_sys->i_handle, output->p_buffer, output->i_buffer );
                 if ( val == -1 )
                 {
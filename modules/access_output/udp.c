@@ -53,6 +53,9 @@
 
 #define MAX_EMPTY_BLOCKS 200
 
+/* Packets sent with a single system call at most */
+#define MAX_SEND_PACKETS 64
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -73,6 +76,12 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define WINDOW_TEXT N_("Send window (ms)")
+#define WINDOW_LONGTEXT N_("Packets due within this delay after a packet " \
+                           "are sent along with it, with a single system " \
+                           "call. It reduces the load of servers sending " \
+                           "many streams, at the cost of burstier output." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -81,6 +90,8 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer( SOUT_CFG_PREFIX "window", 0, WINDOW_TEXT, WINDOW_LONGTEXT,
+                                 true )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -94,6 +105,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "window",
     NULL
 };
 
@@ -115,6 +127,7 @@ static block_t *NewUDPPacket( sout_access_out_t *, mtime_t );
 struct sout_access_out_sys_t
 {
     mtime_t       i_caching;
+    mtime_t       i_window;
     int           i_handle;
     bool          b_mtu_warning;
     size_t        i_mtu;
@@ -209,6 +222,8 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->i_caching = UINT64_C(1000)
                      * var_GetInteger( p_access, SOUT_CFG_PREFIX "caching");
+    p_sys->i_window = UINT64_C(1000)
+                    * var_GetInteger( p_access, SOUT_CFG_PREFIX "window");
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
@@ -394,6 +409,75 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/* Packets dequeued at once by the sending thread */
+typedef struct
+{
+    block_t  *pending; /**< Packets to send (the first one is in progress) */
+    block_t  *done; /**< Packets to recycle */
+    block_t **pp_done;
+} udp_batch_t;
+
+/* Sends the packets due at once */
+static void SendPackets( sout_access_out_t *p_access, block_t **pp_send,
+                         const mtime_t *pi_date, unsigned i_send )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( i_send == 0 )
+        return;
+
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msg[MAX_SEND_PACKETS];
+    struct iovec   iov[MAX_SEND_PACKETS];
+
+    for( unsigned i = 0; i < i_send; i++ )
+    {
+        iov[i].iov_base = pp_send[i]->p_buffer;
+        iov[i].iov_len  = pp_send[i]->i_buffer;
+        memset( &msg[i], 0, sizeof( msg[i] ) );
+        msg[i].msg_hdr.msg_iov    = &iov[i];
+        msg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for( unsigned i_done = 0; i_done < i_send; )
+    {
+        int i_ret = sendmmsg( p_sys->i_handle, &msg[i_done],
+                              i_send - i_done, 0 );
+        if( i_ret <= 0 )
+        {
+            /* Skip the packet that cannot be sent */
+            msg_Warn( p_access, "send error: %m" );
+            i_ret = 1;
+        }
+        i_done += i_ret;
+    }
+#else
+    for( unsigned i = 0; i < i_send; i++ )
+        if( send( p_sys->i_handle, pp_send[i]->p_buffer,
+                  pp_send[i]->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %m" );
+#endif
+
+#if 1
+    const mtime_t i_sent = mdate();
+    if ( i_sent > pi_date[0] + 20000 )
+    {
+        msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
+                 i_sent - pi_date[0] );
+    }
+#else
+    VLC_UNUSED(pi_date);
+#endif
+}
+
+static void BatchCleanup( void *data )
+{
+    udp_batch_t *batch = data;
+
+    block_ChainRelease( batch->pending );
+    block_ChainRelease( batch->done );
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -409,61 +493,92 @@ static void* ThreadWrite( void *data )
 
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
-        mtime_t       i_date, i_sent;
-
-        i_date = p_sys->i_caching + p_pk->i_dts;
-        if( i_date_last > 0 )
+        /* Dequeue all pending packets in one go */
+        udp_batch_t batch;
+
+        batch.pending = block_FifoGetBatch( p_sys->p_fifo, SIZE_MAX,
+                                            VLC_TS_INVALID );
+        batch.done = NULL;
+        batch.pp_done = &batch.done;
+
+        /* Packets due within the window of the last wait */
+        block_t *pp_send[MAX_SEND_PACKETS];
+        mtime_t  pi_date[MAX_SEND_PACKETS];
+        unsigned i_send = 0;
+        mtime_t  i_deadline = INT64_MIN;
+
+        vlc_cleanup_push( BatchCleanup, &batch );
+        while( batch.pending != NULL )
         {
-            if( i_date - i_date_last > 2000000 )
+            block_t *p_pk = batch.pending;
+            mtime_t       i_date;
+
+            i_date = p_sys->i_caching + p_pk->i_dts;
+            if( i_date_last > 0 )
             {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
-                             i_date - i_date_last );
+                if( i_date - i_date_last > 2000000 )
+                {
+                    if( !i_dropped_packets )
+                        msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                                 i_date - i_date_last );
 
-                block_FifoPut( p_sys->p_empty_blocks, p_pk );
+                    batch.pending = p_pk->p_next;
+                    p_pk->p_next = NULL;
+                    block_ChainLastAppend( &batch.pp_done, p_pk );
 
-                i_date_last = i_date;
-                i_dropped_packets++;
-                continue;
+                    i_date_last = i_date;
+                    i_dropped_packets++;
+                    continue;
+                }
+                else if( i_date - i_date_last < -1000 )
+                {
+                    if( !i_dropped_packets )
+                        msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
+                                 i_date_last - i_date );
+                }
             }
-            else if( i_date - i_date_last < -1000 )
+
+            i_to_send--;
+            if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
             {
-                if( !i_dropped_packets )
-                    msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
-                             i_date_last - i_date );
+                if( i_date > i_deadline )
+                {
+                    /* The packets gathered so far are due now */
+                    SendPackets( p_access, pp_send, pi_date, i_send );
+                    i_send = 0;
+
+                    mwait( i_date );
+                    i_deadline = i_date + p_sys->i_window;
+                }
+                i_to_send = i_group;
             }
-        }
+            if( i_send == MAX_SEND_PACKETS )
+            {
+                SendPackets( p_access, pp_send, pi_date, i_send );
+                i_send = 0;
+            }
+            pp_send[i_send] = p_pk;
+            pi_date[i_send] = i_date;
+            i_send++;
 
-        block_cleanup_push( p_pk );
-        i_to_send--;
-        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
-        {
-            mwait( i_date );
-            i_to_send = i_group;
-        }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %m" );
-        vlc_cleanup_pop();
+            batch.pending = p_pk->p_next;
+            p_pk->p_next = NULL;
 
-        if( i_dropped_packets )
-        {
-            msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
-            i_dropped_packets = 0;
-        }
+            if( i_dropped_packets )
+            {
+                msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
+                i_dropped_packets = 0;
+            }
 
-#if 1
-        i_sent = mdate();
-        if ( i_sent > i_date + 20000 )
-        {
-            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
-                     i_sent - i_date );
-        }
-#endif
+            /* Recycled once sent, at the end of the batch */
+            block_ChainLastAppend( &batch.pp_done, p_pk );
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
+            i_date_last = i_date;
+        }
+        SendPackets( p_access, pp_send, pi_date, i_send );
+        vlc_cleanup_pop();
 
-        i_date_last = i_date;
+        block_FifoPut( p_sys->p_empty_blocks, batch.done );
     }
     return NULL;
 }
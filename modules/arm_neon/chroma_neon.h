@@ -67,6 +67,13 @@ void uyvy_i422_neon (struct yuv_planes *const out,
                      const struct yuv_pack *const in,
                      int width, int height) asm("uyvy_i422_neon");
 
+/* I422 to I420 chroma plane conversion: each output line is the mean of two
+ * input lines. Pitches are in bytes, the width must be a multiple of 16. */
+void i422_i420_chroma_neon (uint8_t *out, size_t out_pitch,
+                            const uint8_t *in, size_t in_pitch,
+                            int width, int height)
+                            asm("i422_i420_chroma_neon");
+
 /* I420 to RGBA conversion. */
 void i420_rgb_neon (struct yuv_pack *const out,
                     const struct yuv_planes *const in,
@@ -121,6 +121,49 @@ static void I422_VYUY (filter_t *filter, picture_t *src, picture_t *dst)
 VIDEO_FILTER_WRAPPER (I422_VYUY)
 
 
+/* Planar YUV422 to planar YUV420 */
+static void I422_I420_Plane (plane_t *out, const plane_t *in,
+                             unsigned width, unsigned height)
+{
+    const unsigned simd_width = width & ~15;
+
+    if (simd_width > 0)
+        i422_i420_chroma_neon (out->p_pixels, out->i_pitch,
+                               in->p_pixels, in->i_pitch,
+                               simd_width, height);
+    for (unsigned y = 0; y < height; y++)
+    {
+        const uint8_t *src = &in->p_pixels[2 * y * in->i_pitch];
+        uint8_t *dst = &out->p_pixels[y * out->i_pitch];
+
+        for (unsigned x = simd_width; x < width; x++)
+            dst[x] = (src[x] + src[x + in->i_pitch] + 1) >> 1;
+    }
+}
+
+static void I422_I420 (filter_t *filter, picture_t *src, picture_t *dst)
+{
+    const unsigned width = (filter->fmt_in.video.i_width + 1) / 2;
+    const unsigned height = filter->fmt_in.video.i_height / 2;
+
+    plane_CopyPixels (&dst->p[Y_PLANE], &src->p[Y_PLANE]);
+    I422_I420_Plane (&dst->p[U_PLANE], &src->p[U_PLANE], width, height);
+    I422_I420_Plane (&dst->p[V_PLANE], &src->p[V_PLANE], width, height);
+}
+VIDEO_FILTER_WRAPPER (I422_I420)
+
+static void I422_YV12 (filter_t *filter, picture_t *src, picture_t *dst)
+{
+    const unsigned width = (filter->fmt_in.video.i_width + 1) / 2;
+    const unsigned height = filter->fmt_in.video.i_height / 2;
+
+    plane_CopyPixels (&dst->p[Y_PLANE], &src->p[Y_PLANE]);
+    I422_I420_Plane (&dst->p[V_PLANE], &src->p[U_PLANE], width, height);
+    I422_I420_Plane (&dst->p[U_PLANE], &src->p[V_PLANE], width, height);
+}
+VIDEO_FILTER_WRAPPER (I422_YV12)
+
+
 /* Packedr YUV422 to planar YUV422 */
 static void YUYV_I422 (filter_t *filter, picture_t *src, picture_t *dst)
 {
@@ -226,11 +269,23 @@ static int Open (vlc_object_t *obj)
                 case VLC_CODEC_VYUY:
                     filter->pf_video_filter = I422_VYUY_Filter;
                     break;
+                case VLC_CODEC_I420:
+                    filter->pf_video_filter = I422_I420_Filter;
+                    break;
+                case VLC_CODEC_YV12:
+                    filter->pf_video_filter = I422_YV12_Filter;
+                    break;
                 default:
                     return VLC_EGENERIC;
             }
             break;
 
+        case VLC_CODEC_J422:
+            if (filter->fmt_out.video.i_chroma != VLC_CODEC_J420)
+                return VLC_EGENERIC;
+            filter->pf_video_filter = I422_I420_Filter;
+            break;
+
         /* Packed to planar */
         case VLC_CODEC_YUYV:
             switch (filter->fmt_out.video.i_chroma)
@@ -241,6 +296,7 @@ static int Open (vlc_object_t *obj)
                 default:
                     return VLC_EGENERIC;
             }
+            break;
 
         case VLC_CODEC_UYVY:
             switch (filter->fmt_out.video.i_chroma)
@@ -251,6 +307,7 @@ static int Open (vlc_object_t *obj)
                 default:
                     return VLC_EGENERIC;
             }
+            break;
 
         case VLC_CODEC_YVYU:
             switch (filter->fmt_out.video.i_chroma)
@@ -261,7 +318,7 @@ static int Open (vlc_object_t *obj)
                 default:
                     return VLC_EGENERIC;
             }
-
+            break;
 
         case VLC_CODEC_VYUY:
             switch (filter->fmt_out.video.i_chroma)
@@ -272,6 +329,7 @@ static int Open (vlc_object_t *obj)
                 default:
                     return VLC_EGENERIC;
             }
+            break;
 
         default:
             return VLC_EGENERIC;
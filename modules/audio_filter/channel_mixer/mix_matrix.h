@@ -0,0 +1,202 @@
+/*****************************************************************************
+ * mix_matrix.h : float32 channel mixing matrices
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_MIX_MATRIX_H
+#define VLC_MIX_MATRIX_H 1
+
+#include <string.h>
+#include <vlc_cpu.h>
+
+#if defined(CAN_COMPILE_SSE) && (VLC_GCC_VERSION(4, 9) || defined(__clang__))
+# define HAVE_MIX_MATRIX_SSE
+# include <xmmintrin.h>
+#endif
+#if defined(HAVE_MIX_MATRIX_SSE) && defined(CAN_COMPILE_AVX2)
+# define HAVE_MIX_MATRIX_AVX
+# include <immintrin.h>
+# define VLC_AVX __attribute__ ((__target__ ("avx")))
+#endif
+
+/* Outputs are computed four at a time */
+#define MIX_MATRIX_OUT_PAD ((AOUT_CHAN_MAX + 3) & ~3)
+
+/**
+ * Mixing matrix of interleaved float32 frames:
+ * dst[o] = sum of coef[o][i] * src[i] for every frame.
+ */
+typedef struct mix_matrix_t mix_matrix_t;
+
+struct mix_matrix_t
+{
+    unsigned in;  /**< Input channels (input frame size) */
+    unsigned out; /**< Output channels (output frame size) */
+    float coef[AOUT_CHAN_MAX][AOUT_CHAN_MAX]; /**< [out][in] gains */
+
+    /* Set by MixMatrixPrepare() */
+    unsigned nb_used;
+    uint8_t used[AOUT_CHAN_MAX]; /* Inputs with a non-zero gain */
+    float col[AOUT_CHAN_MAX][MIX_MATRIX_OUT_PAD]; /* [in][out] gains */
+};
+
+typedef void (*mix_matrix_fn)(const mix_matrix_t *, float *, const float *,
+                              unsigned);
+
+/**
+ * Clears the matrix: every output will be silent.
+ */
+static inline void MixMatrixInit(mix_matrix_t *m, unsigned in, unsigned out)
+{
+    memset(m, 0, sizeof (*m));
+    m->in = in;
+    m->out = out;
+}
+
+/**
+ * Computes the internal tables, once the gains are set.
+ */
+static inline void MixMatrixPrepare(mix_matrix_t *m)
+{
+    m->nb_used = 0;
+    for (unsigned i = 0; i < m->in; i++)
+    {
+        bool used = false;
+        for (unsigned o = 0; o < MIX_MATRIX_OUT_PAD; o++)
+        {
+            m->col[i][o] = (o < m->out) ? m->coef[o][i] : 0.f;
+            used |= m->col[i][o] != 0.f;
+        }
+        if (used)
+            m->used[m->nb_used++] = i;
+    }
+}
+
+static void MixMatrixC(const mix_matrix_t *m, float *restrict dst,
+                       const float *restrict src, unsigned frames)
+{
+    for (; frames > 0; frames--)
+    {
+        for (unsigned o = 0; o < m->out; o++)
+        {
+            float sum = 0.f;
+            for (unsigned k = 0; k < m->nb_used; k++)
+                sum += src[m->used[k]] * m->coef[o][m->used[k]];
+            dst[o] = sum;
+        }
+        src += m->in;
+        dst += m->out;
+    }
+}
+
+#ifdef HAVE_MIX_MATRIX_SSE
+/* The SIMD versions add the same products in the same order as the C
+ * version, so all of them give the same samples. */
+VLC_SSE
+static inline void MixStoreSSE(float *dst, __m128 v, unsigned count)
+{
+    switch (count)
+    {
+        case 1:
+            _mm_store_ss(dst, v);
+            break;
+        case 2:
+            _mm_storel_pi((__m64 *)dst, v);
+            break;
+        case 3:
+            _mm_storel_pi((__m64 *)dst, v);
+            _mm_store_ss(dst + 2, _mm_movehl_ps(v, v));
+            break;
+        default:
+            _mm_storeu_ps(dst, v);
+            break;
+    }
+}
+
+VLC_SSE
+static void MixMatrixSSE(const mix_matrix_t *m, float *restrict dst,
+                         const float *restrict src, unsigned frames)
+{
+    for (; frames > 0; frames--)
+    {
+        for (unsigned o = 0; o < m->out; o += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (unsigned k = 0; k < m->nb_used; k++)
+            {
+                const unsigned i = m->used[k];
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load1_ps(&src[i]),
+                                                 _mm_loadu_ps(&m->col[i][o])));
+            }
+            MixStoreSSE(&dst[o], sum, m->out - o);
+        }
+        src += m->in;
+        dst += m->out;
+    }
+}
+#endif
+
+#ifdef HAVE_MIX_MATRIX_AVX
+/* Two frames at a time, one in each 128-bits lane */
+VLC_AVX
+static void MixMatrixAVX(const mix_matrix_t *m, float *restrict dst,
+                         const float *restrict src, unsigned frames)
+{
+    for (; frames >= 2; frames -= 2)
+    {
+        for (unsigned o = 0; o < m->out; o += 4)
+        {
+            __m256 sum = _mm256_setzero_ps();
+            for (unsigned k = 0; k < m->nb_used; k++)
+            {
+                const unsigned i = m->used[k];
+                const __m256 in = _mm256_blend_ps(_mm256_broadcast_ss(&src[i]),
+                                    _mm256_broadcast_ss(&src[m->in + i]), 0xF0);
+                const __m256 gain =
+                    _mm256_broadcast_ps((const __m128 *)&m->col[i][o]);
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(in, gain));
+            }
+            MixStoreSSE(&dst[o], _mm256_castps256_ps128(sum), m->out - o);
+            MixStoreSSE(&dst[m->out + o], _mm256_extractf128_ps(sum, 1),
+                        m->out - o);
+        }
+        src += 2 * m->in;
+        dst += 2 * m->out;
+    }
+    MixMatrixSSE(m, dst, src, frames);
+}
+#endif
+
+/**
+ * Returns the fastest mixing function usable on this CPU.
+ * If simd is true, returns NULL when there is no vectorized version.
+ */
+static inline mix_matrix_fn MixMatrixGet(bool simd)
+{
+#ifdef HAVE_MIX_MATRIX_AVX
+    if (vlc_CPU_AVX())
+        return MixMatrixAVX;
+#endif
+#ifdef HAVE_MIX_MATRIX_SSE
+    if (vlc_CPU_SSE())
+        return MixMatrixSSE;
+#endif
+    return simd ? NULL : MixMatrixC;
+}
+
+#endif
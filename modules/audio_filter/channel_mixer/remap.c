@@ -34,6 +34,8 @@
 #include <vlc_block.h>
 #include <assert.h>
 
+#include "mix_matrix.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -110,6 +112,8 @@ struct filter_sys_t
     int nb_in_ch[AOUT_CHAN_MAX];
     uint8_t map_ch[AOUT_CHAN_MAX];
     bool b_normalize;
+    mix_matrix_fn pf_mix; /* vectorized float32 remapping, if any */
+    mix_matrix_t matrix;
 };
 
 static const uint32_t valid_channels[] = {
@@ -346,6 +350,22 @@ static int OpenFilter( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    p_sys->pf_mix = NULL;
+    if( audio_in->i_format == VLC_CODEC_FL32 )
+        p_sys->pf_mix = MixMatrixGet( true );
+    if( p_sys->pf_mix != NULL )
+    {
+        MixMatrixInit( &p_sys->matrix, audio_in->i_channels,
+                       audio_out->i_channels );
+        for( uint8_t i = 0; i < audio_in->i_channels; i++ )
+        {
+            uint8_t out_ch = p_sys->map_ch[i];
+            p_sys->matrix.coef[out_ch][i] = ( b_multiple && p_sys->b_normalize )
+                                          ? 1.f / p_sys->nb_in_ch[out_ch] : 1.f;
+        }
+        MixMatrixPrepare( &p_sys->matrix );
+    }
+
     p_filter->pf_audio_filter = Remap;
     return VLC_SUCCESS;
 }
@@ -376,7 +396,7 @@ static block_t *Remap( filter_t *p_filter, block_t *p_block )
     size_t i_out_size = p_block->i_nb_samples *
         p_filter->fmt_out.audio.i_bytes_per_frame;
 
-    block_t *p_out = block_Alloc( i_out_size );
+    block_t *p_out = filter_NewAudioBuffer( p_filter, i_out_size );
     if( !p_out )
     {
         msg_Warn( p_filter, "can't get output buffer" );
@@ -388,6 +408,15 @@ static block_t *Remap( filter_t *p_filter, block_t *p_block )
     p_out->i_pts = p_block->i_pts;
     p_out->i_length = p_block->i_length;
 
+    if( p_sys->pf_mix != NULL )
+    {
+        p_sys->pf_mix( &p_sys->matrix, (float *)p_out->p_buffer,
+                       (const float *)p_block->p_buffer,
+                       p_block->i_nb_samples );
+        block_Release( p_block );
+        return p_out;
+    }
+
     memset( p_out->p_buffer, 0, i_out_size );
 
     p_sys->pf_remap( p_filter,
@@ -35,17 +35,20 @@
 #include <vlc_block.h>
 #include <assert.h>
 
+#include "mix_matrix.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  OpenFilter( vlc_object_t * );
+static void CloseFilter( vlc_object_t * );
 
 vlc_module_begin ()
     set_description( N_("Audio filter for simple channel mixing") )
     set_category( CAT_AUDIO )
     set_subcategory( SUBCAT_AUDIO_MISC )
     set_capability( "audio converter", 10 )
-    set_callbacks( OpenFilter, NULL )
+    set_callbacks( OpenFilter, CloseFilter )
 vlc_module_end ()
 
 /*****************************************************************************
@@ -55,13 +58,19 @@ static bool IsSupported( const audio_format_t *p_input, const audio_format_t *p_
 
 static block_t *Filter( filter_t *, block_t * );
 
+struct filter_sys_t
+{
+    mix_matrix_fn pf_mix;
+    mix_matrix_t matrix;
+};
+
 /*****************************************************************************
- * DoWork: convert a buffer
+ * SetupMatrix: compute the downmixing gains
  *****************************************************************************/
-static void DoWork( filter_t * p_filter,
-                    block_t * p_in_buf, block_t * p_out_buf )
+static void SetupMatrix( filter_t * p_filter, mix_matrix_t *m )
 {
     const unsigned i_input_physical = p_filter->fmt_in.audio.i_physical_channels;
+    const unsigned i_output_physical = p_filter->fmt_out.audio.i_physical_channels;
 
     const bool b_input_7_0 = (i_input_physical & ~AOUT_CHAN_LFE) == AOUT_CHANS_7_0;
     const bool b_input_5_0 = !b_input_7_0 &&
@@ -72,142 +81,82 @@ static void DoWork( filter_t * p_filter,
     const bool b_input_3_0 = !b_input_7_0 && !b_input_5_0 && !b_input_4_center_rear &&
                              (i_input_physical & ~AOUT_CHAN_LFE) == AOUT_CHANS_3_0;
 
-    int i_input_nb = aout_FormatNbChannels( &p_filter->fmt_in.audio );
-    int i_output_nb = aout_FormatNbChannels( &p_filter->fmt_out.audio );
-    float *p_dest = (float *)p_out_buf->p_buffer;
-    const float *p_src = (const float *)p_in_buf->p_buffer;
-    int i;
-
-    p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
-    p_out_buf->i_buffer = p_in_buf->i_buffer * i_output_nb / i_input_nb;
+    /* The LFE channel, if any, comes last and is dropped */
+    MixMatrixInit( m, aout_FormatNbChannels( &p_filter->fmt_in.audio ),
+                   aout_FormatNbChannels( &p_filter->fmt_out.audio ) );
 
-    if( p_filter->fmt_out.audio.i_physical_channels == AOUT_CHANS_2_0 )
+    if( i_output_physical == AOUT_CHANS_2_0 )
     {
         if( b_input_7_0 )
-        for( i = p_in_buf->i_nb_samples; i--; )
         {
-            *p_dest = p_src[6] + 0.5 * p_src[0] + p_src[2] / 4 + p_src[4] / 4;
-            p_dest++;
-            *p_dest = p_src[6] + 0.5 * p_src[1] + p_src[3] / 4 + p_src[5] / 4;
-            p_dest++;
-
-            p_src += 7;
-
-            if( p_filter->fmt_in.audio.i_physical_channels & AOUT_CHAN_LFE ) p_src++;
+            m->coef[0][6] = 1.f; m->coef[0][0] = .5f;
+            m->coef[0][2] = .25f; m->coef[0][4] = .25f;
+            m->coef[1][6] = 1.f; m->coef[1][1] = .5f;
+            m->coef[1][3] = .25f; m->coef[1][5] = .25f;
         }
         else if( b_input_5_0 )
-        for( i = p_in_buf->i_nb_samples; i--; )
         {
-            *p_dest = p_src[4] + 0.5 * p_src[0] + 0.33 * p_src[2];
-            p_dest++;
-            *p_dest = p_src[4] + 0.5 * p_src[1] + 0.33 * p_src[3];
-            p_dest++;
-
-            p_src += 5;
-
-            if( p_filter->fmt_in.audio.i_physical_channels & AOUT_CHAN_LFE ) p_src++;
+            m->coef[0][4] = 1.f; m->coef[0][0] = .5f; m->coef[0][2] = .33f;
+            m->coef[1][4] = 1.f; m->coef[1][1] = .5f; m->coef[1][3] = .33f;
         }
         else if( b_input_3_0 )
-        for( i = p_in_buf->i_nb_samples; i--; )
         {
-            *p_dest = p_src[2] + 0.5 * p_src[0];
-            p_dest++;
-            *p_dest = p_src[2] + 0.5 * p_src[1];
-            p_dest++;
-
-            p_src += 3;
-
-            if( p_filter->fmt_in.audio.i_physical_channels & AOUT_CHAN_LFE ) p_src++;
+            m->coef[0][2] = 1.f; m->coef[0][0] = .5f;
+            m->coef[1][2] = 1.f; m->coef[1][1] = .5f;
         }
-        else if (b_input_4_center_rear)
-        for( i = p_in_buf->i_nb_samples; i--; )
+        else if( b_input_4_center_rear )
         {
-          *p_dest = p_src[2] + p_src[3] + 0.5 * p_src[0];
-          p_dest++;
-          *p_dest = p_src[2] + p_src[3] + 0.5 * p_src[1];
-          p_dest++;
-          p_src += 4;
+            m->coef[0][2] = 1.f; m->coef[0][3] = 1.f; m->coef[0][0] = .5f;
+            m->coef[1][2] = 1.f; m->coef[1][3] = 1.f; m->coef[1][1] = .5f;
         }
     }
-    else if( p_filter->fmt_out.audio.i_physical_channels == AOUT_CHAN_CENTER )
+    else if( i_output_physical == AOUT_CHAN_CENTER )
     {
         if( b_input_7_0 )
-        for( i = p_in_buf->i_nb_samples; i--; )
         {
-            *p_dest = p_src[6] + p_src[0] / 4 + p_src[1] / 4 + p_src[2] / 8 + p_src[3] / 8 + p_src[4] / 8 + p_src[5] / 8;
-            p_dest++;
-
-            p_src += 7;
-
-            if( p_filter->fmt_in.audio.i_physical_channels & AOUT_CHAN_LFE ) p_src++;
+            m->coef[0][6] = 1.f;
+            m->coef[0][0] = m->coef[0][1] = .25f;
+            m->coef[0][2] = m->coef[0][3] = .125f;
+            m->coef[0][4] = m->coef[0][5] = .125f;
         }
         else if( b_input_5_0 )
-        for( i = p_in_buf->i_nb_samples; i--; )
         {
-            *p_dest = p_src[4] + p_src[0] / 4 + p_src[1] / 4 + p_src[2] / 6 + p_src[3] / 6;
-            p_dest++;
-
-            p_src += 5;
-
-            if( p_filter->fmt_in.audio.i_physical_channels & AOUT_CHAN_LFE ) p_src++;
+            m->coef[0][4] = 1.f;
+            m->coef[0][0] = m->coef[0][1] = .25f;
+            m->coef[0][2] = m->coef[0][3] = 1.f / 6;
         }
         else if( b_input_3_0 )
-        for( i = p_in_buf->i_nb_samples; i--; )
         {
-            *p_dest = p_src[2] + p_src[0] / 4 + p_src[1] / 4;
-            p_dest++;
-
-            p_src += 3;
-
-            if( p_filter->fmt_in.audio.i_physical_channels & AOUT_CHAN_LFE ) p_src++;
+            m->coef[0][2] = 1.f;
+            m->coef[0][0] = m->coef[0][1] = .25f;
         }
         else
-        for( i = p_in_buf->i_nb_samples; i--; )
         {
-            *p_dest = p_src[0] / 2 + p_src[1] / 2;
-            p_dest++;
-
-            p_src += 2;
+            m->coef[0][0] = m->coef[0][1] = .5f;
         }
     }
     else
     {
-        assert( p_filter->fmt_out.audio.i_physical_channels == AOUT_CHANS_4_0 );
+        assert( i_output_physical == AOUT_CHANS_4_0 );
         assert( b_input_7_0 || b_input_5_0 );
 
         if( b_input_7_0 )
-        for( i = p_in_buf->i_nb_samples; i--; )
         {
-            *p_dest = p_src[6] + 0.5 * p_src[0] + p_src[2] / 6;
-            p_dest++;
-            *p_dest = p_src[6] + 0.5 * p_src[1] + p_src[3] / 6;
-            p_dest++;
-            *p_dest = p_src[2] / 6 +  p_src[4];
-            p_dest++;
-            *p_dest = p_src[3] / 6 +  p_src[5];
-            p_dest++;
-
-            p_src += 7;
-
-            if( p_filter->fmt_in.audio.i_physical_channels & AOUT_CHAN_LFE ) p_src++;
+            m->coef[0][6] = 1.f; m->coef[0][0] = .5f; m->coef[0][2] = 1.f / 6;
+            m->coef[1][6] = 1.f; m->coef[1][1] = .5f; m->coef[1][3] = 1.f / 6;
+            m->coef[2][2] = 1.f / 6; m->coef[2][4] = 1.f;
+            m->coef[3][3] = 1.f / 6; m->coef[3][5] = 1.f;
         }
         else
-        for( i = p_in_buf->i_nb_samples; i--; )
         {
-            *p_dest = p_src[4] + 0.5 * p_src[0];
-            p_dest++;
-            *p_dest = p_src[4] + 0.5 * p_src[1];
-            p_dest++;
-            *p_dest = p_src[2];
-            p_dest++;
-            *p_dest = p_src[3];
-            p_dest++;
-
-            p_src += 5;
-
-            if( p_filter->fmt_in.audio.i_physical_channels & AOUT_CHAN_LFE ) p_src++;
+            m->coef[0][4] = 1.f; m->coef[0][0] = .5f;
+            m->coef[1][4] = 1.f; m->coef[1][1] = .5f;
+            m->coef[2][2] = 1.f;
+            m->coef[3][3] = 1.f;
         }
     }
+
+    MixMatrixPrepare( m );
 }
 
 /*****************************************************************************
@@ -226,16 +175,33 @@ static int OpenFilter( vlc_object_t *p_this )
     if( !IsSupported( &fmt_in, &fmt_out ) )
         return -1;
 
+    filter_sys_t *p_sys = malloc( sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+
+    SetupMatrix( p_filter, &p_sys->matrix );
+    p_sys->pf_mix = MixMatrixGet( false );
+
+    p_filter->p_sys = p_sys;
     p_filter->pf_audio_filter = Filter;
 
     return 0;
 }
 
+static void CloseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    free( p_filter->p_sys );
+}
+
 /*****************************************************************************
  * Filter:
  *****************************************************************************/
 static block_t *Filter( filter_t *p_filter, block_t *p_block )
 {
+    filter_sys_t *p_sys = p_filter->p_sys;
+
     if( !p_block || !p_block->i_nb_samples )
     {
         if( p_block )
@@ -247,7 +213,7 @@ static block_t *Filter( filter_t *p_filter, block_t *p_block )
       p_filter->fmt_out.audio.i_bitspersample *
         p_filter->fmt_out.audio.i_channels / 8;
 
-    block_t *p_out = block_Alloc( i_out_size );
+    block_t *p_out = filter_NewAudioBuffer( p_filter, i_out_size );
     if( !p_out )
     {
         msg_Warn( p_filter, "can't get output buffer" );
@@ -256,11 +222,13 @@ static block_t *Filter( filter_t *p_filter, block_t *p_block )
     }
 
     p_out->i_nb_samples = p_block->i_nb_samples;
+    p_out->i_buffer = p_block->i_nb_samples * p_sys->matrix.out * sizeof(float);
     p_out->i_dts = p_block->i_dts;
     p_out->i_pts = p_block->i_pts;
     p_out->i_length = p_block->i_length;
 
-    DoWork( p_filter, p_block, p_out );
+    p_sys->pf_mix( &p_sys->matrix, (float *)p_out->p_buffer,
+                   (const float *)p_block->p_buffer, p_block->i_nb_samples );
 
     block_Release( p_block );
 
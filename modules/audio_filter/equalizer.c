@@ -37,11 +37,16 @@
 
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 
 #include "equalizer_presets.h"
 
+#if defined(CAN_COMPILE_SSE) && (VLC_GCC_VERSION(4, 9) || defined(__clang__))
+# define HAVE_EQZ_SSE
+# include <xmmintrin.h>
+#endif
+
 /* TODO:
- *  - optimize a bit (you can hardly do slower ;)
  *  - add tables for more bands (15 and 32 would be cool), maybe with auto coeffs
  *    computation (not too hard once the Q is found).
  *  - support for external preset
@@ -101,30 +106,38 @@ vlc_module_end ()
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
+/* The bands are independent, they are run side by side, four at a time.
+ * The padding bands have null coefficients and stay silent. */
+#define EQZ_BANDS_PAD ((EQZ_BANDS_MAX + 3) & ~3)
+
+typedef void (*eqz_filter_t)( filter_sys_t *, const float *, float, bool,
+                              float *, const float *, int, int );
+
 struct filter_sys_t
 {
     /* Filter static config */
     int i_band;
-    float *f_alpha;
-    float *f_beta;
-    float *f_gamma;
+    float f_alpha[EQZ_BANDS_PAD];
+    float f_beta[EQZ_BANDS_PAD];
+    float f_gamma[EQZ_BANDS_PAD];
+    eqz_filter_t pf_filter;
 
     float f_newpreamp;
     char *psz_newbands;
     bool b_first;
 
-    /* Filter dyn config */
-    float *f_amp;   /* Per band amp */
+    /* Filter dyn config, copied by the audio thread for every buffer */
+    float f_amp[EQZ_BANDS_PAD];   /* Per band amp */
     float f_gamp;   /* Global preamp */
     bool b_2eqz;
 
-    /* Filter state */
+    /* Filter state: x[n-1], x[n-2] and per band y[n-1], y[n-2] */
     float x[32][2];
-    float y[32][128][2];
+    float y[32][2][EQZ_BANDS_PAD];
 
     /* Second filter state */
     float x2[32][2];
-    float y2[32][128][2];
+    float y2[32][2][EQZ_BANDS_PAD];
 
     vlc_mutex_t lock;
 };
@@ -134,6 +147,12 @@ static block_t *DoWork( filter_t *, block_t * );
 #define EQZ_IN_FACTOR (0.25)
 static int  EqzInit( filter_t *, int );
 static void EqzFilter( filter_t *, float *, float *, int, int );
+static void EqzFilterC( filter_sys_t *, const float *, float, bool,
+                        float *, const float *, int, int );
+#ifdef HAVE_EQZ_SSE
+static void EqzFilterSSE( filter_sys_t *, const float *, float, bool,
+                          float *, const float *, int, int );
+#endif
 static void EqzClean( filter_t * );
 
 static int PresetCallback ( vlc_object_t *, char const *, vlc_value_t,
@@ -303,34 +322,29 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     int i, ch;
     vlc_value_t val1, val2, val3;
     vlc_object_t *p_aout = p_filter->p_parent;
-    int i_ret = VLC_ENOMEM;
 
     bool b_vlcFreqs = var_InheritBool( p_aout, "equalizer-vlcfreqs" );
     EqzCoeffs( i_rate, 1.0, b_vlcFreqs, &cfg );
 
     /* Create the static filter config */
     p_sys->i_band = cfg.i_band;
-    p_sys->f_alpha = malloc( p_sys->i_band * sizeof(float) );
-    p_sys->f_beta  = malloc( p_sys->i_band * sizeof(float) );
-    p_sys->f_gamma = malloc( p_sys->i_band * sizeof(float) );
-    if( !p_sys->f_alpha || !p_sys->f_beta || !p_sys->f_gamma )
-        goto error;
-
-    for( i = 0; i < p_sys->i_band; i++ )
+    for( i = 0; i < EQZ_BANDS_PAD; i++ )
     {
-        p_sys->f_alpha[i] = cfg.band[i].f_alpha;
-        p_sys->f_beta[i]  = cfg.band[i].f_beta;
-        p_sys->f_gamma[i] = cfg.band[i].f_gamma;
+        p_sys->f_alpha[i] = ( i < p_sys->i_band ) ? cfg.band[i].f_alpha : 0.0;
+        p_sys->f_beta[i]  = ( i < p_sys->i_band ) ? cfg.band[i].f_beta : 0.0;
+        p_sys->f_gamma[i] = ( i < p_sys->i_band ) ? cfg.band[i].f_gamma : 0.0;
     }
 
+    p_sys->pf_filter = EqzFilterC;
+#ifdef HAVE_EQZ_SSE
+    if( vlc_CPU_SSE() )
+        p_sys->pf_filter = EqzFilterSSE;
+#endif
+
     /* Filter dyn config */
     p_sys->b_2eqz = false;
     p_sys->f_gamp = 1.0;
-    p_sys->f_amp  = malloc( p_sys->i_band * sizeof(float) );
-    if( !p_sys->f_amp )
-        goto error;
-
-    for( i = 0; i < p_sys->i_band; i++ )
+    for( i = 0; i < EQZ_BANDS_PAD; i++ )
     {
         p_sys->f_amp[i] = 0.0;
     }
@@ -343,12 +357,12 @@ static int EqzInit( filter_t *p_filter, int i_rate )
         p_sys->x2[ch][0] =
         p_sys->x2[ch][1] = 0.0;
 
-        for( i = 0; i < p_sys->i_band; i++ )
+        for( i = 0; i < EQZ_BANDS_PAD; i++ )
         {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0;
+            p_sys->y[ch][0][i]  =
+            p_sys->y[ch][1][i]  =
+            p_sys->y2[ch][0][i] =
+            p_sys->y2[ch][1][i] = 0.0;
         }
     }
 
@@ -379,9 +393,7 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     {
         msg_Err(p_filter, "No preset selected");
         free( val2.psz_string );
-        free( p_sys->f_amp );
-        i_ret = VLC_EGENERIC;
-        goto error;
+        return VLC_EGENERIC;
     }
     if( ( *(val2.psz_string) &&
         strstr( p_sys->psz_newbands, val2.psz_string ) ) || !*val2.psz_string )
@@ -407,76 +419,192 @@ static int EqzInit( filter_t *p_filter, int i_rate )
                  p_sys->f_alpha[i], p_sys->f_beta[i], p_sys->f_gamma[i]);
     }
     return VLC_SUCCESS;
-
-error:
-    free( p_sys->f_alpha );
-    free( p_sys->f_beta );
-    free( p_sys->f_gamma );
-    return i_ret;
 }
 
 static void EqzFilter( filter_t *p_filter, float *out, float *in,
                        int i_samples, int i_channels )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    int i, ch, j;
+    float f_amp[EQZ_BANDS_PAD];
+    float f_gamp;
+    bool b_2eqz;
 
+    /* The callbacks only wait for this copy, never for a whole buffer */
     vlc_mutex_lock( &p_sys->lock );
-    for( i = 0; i < i_samples; i++ )
+    memcpy( f_amp, p_sys->f_amp, sizeof (f_amp) );
+    f_gamp = p_sys->f_gamp;
+    b_2eqz = p_sys->b_2eqz;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    p_sys->pf_filter( p_sys, f_amp, f_gamp, b_2eqz,
+                      out, in, i_samples, i_channels );
+}
+
+typedef struct
+{
+    float alpha[EQZ_BANDS_PAD], beta[EQZ_BANDS_PAD], gamma[EQZ_BANDS_PAD];
+    float amp[EQZ_BANDS_PAD];
+} eqz_coeffs_t;
+
+/* Runs all the bands of one channel over one sample x.
+ * xs[] holds x[n-1] and x[n-2], y0[] and y1[] hold y[n-1] and y[n-2] of each
+ * band. Returns the sum of the amplified bands outputs. */
+static inline float EqzBandsC( const eqz_coeffs_t *c, float x, float xs[2],
+                               float *restrict y0, float *restrict y1 )
+{
+    const float dx = x - xs[1];
+    float o = 0.0;
+
+    for( int j = 0; j < EQZ_BANDS_PAD; j++ )
     {
-        for( ch = 0; ch < i_channels; ch++ )
-        {
-            const float x = in[ch];
-            float o = 0.0;
+        float v = c->alpha[j] * dx + c->gamma[j] * y0[j] - c->beta[j] * y1[j];
 
-            for( j = 0; j < p_sys->i_band; j++ )
-            {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
+        y1[j] = y0[j];
+        y0[j] = v;
+        o += v * c->amp[j];
+    }
+    xs[1] = xs[0];
+    xs[0] = x;
+    return o;
+}
 
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
+/* The coefficients and the state are copied locally so that the compiler
+ * knows that they do not alias the samples, and can vectorize the bands. */
+static void EqzFilterC( filter_sys_t *p_sys, const float *f_amp, float f_gamp,
+                        bool b_2eqz, float *out, const float *in,
+                        int i_samples, int i_channels )
+{
+    eqz_coeffs_t c;
 
-                o += y * p_sys->f_amp[j];
-            }
-            p_sys->x[ch][1] = p_sys->x[ch][0];
-            p_sys->x[ch][0] = x;
+    memcpy( c.alpha, p_sys->f_alpha, sizeof (c.alpha) );
+    memcpy( c.beta, p_sys->f_beta, sizeof (c.beta) );
+    memcpy( c.gamma, p_sys->f_gamma, sizeof (c.gamma) );
+    memcpy( c.amp, f_amp, sizeof (c.amp) );
+
+    for( int ch = 0; ch < i_channels; ch++ )
+    {
+        float xs[2], xs2[2];
+        float y[2][EQZ_BANDS_PAD], y2[2][EQZ_BANDS_PAD];
+
+        memcpy( xs, p_sys->x[ch], sizeof (xs) );
+        memcpy( xs2, p_sys->x2[ch], sizeof (xs2) );
+        memcpy( y, p_sys->y[ch], sizeof (y) );
+        memcpy( y2, p_sys->y2[ch], sizeof (y2) );
+
+        for( int i = 0; i < i_samples; i++ )
+        {
+            const float x = in[i * i_channels + ch];
+            float o = EqzBandsC( &c, x, xs, y[0], y[1] );
 
             /* Second filter */
-            if( p_sys->b_2eqz )
+            if( b_2eqz )
             {
                 const float x2 = EQZ_IN_FACTOR * x + o;
-                o = 0.0;
-                for( j = 0; j < p_sys->i_band; j++ )
-                {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
-
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
-
-                    o += y * p_sys->f_amp[j];
-                }
-                p_sys->x2[ch][1] = p_sys->x2[ch][0];
-                p_sys->x2[ch][0] = x2;
 
+                o = EqzBandsC( &c, x2, xs2, y2[0], y2[1] );
                 /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
+                out[i * i_channels + ch] = f_gamp *( EQZ_IN_FACTOR * x2 + o );
             }
             else
             {
                 /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
+                out[i * i_channels + ch] = f_gamp *( EQZ_IN_FACTOR * x + o );
             }
         }
 
-        in  += i_channels;
-        out += i_channels;
+        memcpy( p_sys->x[ch], xs, sizeof (xs) );
+        memcpy( p_sys->x2[ch], xs2, sizeof (xs2) );
+        memcpy( p_sys->y[ch], y, sizeof (y) );
+        memcpy( p_sys->y2[ch], y2, sizeof (y2) );
+    }
+}
+
+#ifdef HAVE_EQZ_SSE
+#define EQZ_VECS (EQZ_BANDS_PAD / 4)
+
+typedef struct
+{
+    __m128 alpha[EQZ_VECS], beta[EQZ_VECS], gamma[EQZ_VECS], amp[EQZ_VECS];
+} eqz_coeffs_sse_t;
+
+/* Same as EqzBandsC() with the bands state kept in registers */
+VLC_SSE
+static inline float EqzBandsSSE( const eqz_coeffs_sse_t *c, float x, float xs[2],
+                                 __m128 y0[EQZ_VECS], __m128 y1[EQZ_VECS] )
+{
+    const __m128 dx = _mm_set1_ps( x - xs[1] );
+    __m128 o = _mm_setzero_ps();
+
+    for( int j = 0; j < EQZ_VECS; j++ )
+    {
+        __m128 v = _mm_sub_ps( _mm_add_ps( _mm_mul_ps( c->alpha[j], dx ),
+                                           _mm_mul_ps( c->gamma[j], y0[j] ) ),
+                               _mm_mul_ps( c->beta[j], y1[j] ) );
+        y1[j] = y0[j];
+        y0[j] = v;
+        o = _mm_add_ps( o, _mm_mul_ps( v, c->amp[j] ) );
+    }
+    xs[1] = xs[0];
+    xs[0] = x;
+
+    o = _mm_add_ps( o, _mm_movehl_ps( o, o ) );
+    o = _mm_add_ss( o, _mm_shuffle_ps( o, o, _MM_SHUFFLE(1, 1, 1, 1) ) );
+    return _mm_cvtss_f32( o );
+}
+
+VLC_SSE
+static void EqzFilterSSE( filter_sys_t *p_sys, const float *f_amp, float f_gamp,
+                          bool b_2eqz, float *out, const float *in,
+                          int i_samples, int i_channels )
+{
+    eqz_coeffs_sse_t c;
+
+    for( int j = 0; j < EQZ_VECS; j++ )
+    {
+        c.alpha[j] = _mm_loadu_ps( &p_sys->f_alpha[4 * j] );
+        c.beta[j]  = _mm_loadu_ps( &p_sys->f_beta[4 * j] );
+        c.gamma[j] = _mm_loadu_ps( &p_sys->f_gamma[4 * j] );
+        c.amp[j]   = _mm_loadu_ps( &f_amp[4 * j] );
+    }
+
+    for( int ch = 0; ch < i_channels; ch++ )
+    {
+        __m128 y0[EQZ_VECS], y1[EQZ_VECS], z0[EQZ_VECS], z1[EQZ_VECS];
+
+        for( int j = 0; j < EQZ_VECS; j++ )
+        {
+            y0[j] = _mm_loadu_ps( &p_sys->y[ch][0][4 * j] );
+            y1[j] = _mm_loadu_ps( &p_sys->y[ch][1][4 * j] );
+            z0[j] = _mm_loadu_ps( &p_sys->y2[ch][0][4 * j] );
+            z1[j] = _mm_loadu_ps( &p_sys->y2[ch][1][4 * j] );
+        }
+
+        for( int i = 0; i < i_samples; i++ )
+        {
+            const float x = in[i * i_channels + ch];
+            float o = EqzBandsSSE( &c, x, p_sys->x[ch], y0, y1 );
+
+            if( b_2eqz )
+            {
+                const float x2 = EQZ_IN_FACTOR * x + o;
+
+                o = EqzBandsSSE( &c, x2, p_sys->x2[ch], z0, z1 );
+                out[i * i_channels + ch] = f_gamp *( EQZ_IN_FACTOR * x2 + o );
+            }
+            else
+                out[i * i_channels + ch] = f_gamp *( EQZ_IN_FACTOR * x + o );
+        }
+
+        for( int j = 0; j < EQZ_VECS; j++ )
+        {
+            _mm_storeu_ps( &p_sys->y[ch][0][4 * j], y0[j] );
+            _mm_storeu_ps( &p_sys->y[ch][1][4 * j], y1[j] );
+            _mm_storeu_ps( &p_sys->y2[ch][0][4 * j], z0[j] );
+            _mm_storeu_ps( &p_sys->y2[ch][1][4 * j], z1[j] );
+        }
     }
-    vlc_mutex_unlock( &p_sys->lock );
 }
+#endif
 
 static void EqzClean( filter_t *p_filter )
 {
@@ -488,11 +616,6 @@ static void EqzClean( filter_t *p_filter )
     var_DelCallback( p_aout, "equalizer-preamp", PreampCallback, p_sys );
     var_DelCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
-    free( p_sys->f_alpha );
-    free( p_sys->f_beta );
-    free( p_sys->f_gamma );
-
-    free( p_sys->f_amp );
     free( p_sys->psz_newbands );
 }
 
@@ -505,38 +628,40 @@ static int PresetCallback( vlc_object_t *p_aout, char const *psz_cmd,
 
     const char *psz_preset = newval.psz_string;
 
-    vlc_mutex_lock( &p_sys->lock );
+    /* The gains are computed before taking the lock, the audio thread
+     * only has to wait for them to be copied. */
     if( !*psz_preset || p_sys->i_band != 10 )
-    {
-        vlc_mutex_unlock( &p_sys->lock );
         return VLC_SUCCESS;
-    }
 
     for( unsigned i = 0; i < NB_PRESETS; i++ )
     {
         if( !strcasecmp( eqz_preset_10b[i].psz_name, psz_preset ) )
         {
             char *psz_newbands = NULL;
+            float f_amp[EQZ_BANDS_MAX];
+            float f_preamp = pow( 10, eqz_preset_10b[i].f_preamp / 20.0 );
 
-            p_sys->f_gamp *= pow( 10, eqz_preset_10b[i].f_preamp / 20.0 );
             for( int j = 0; j < p_sys->i_band; j++ )
             {
                 lldiv_t d;
                 char *psz;
 
-                p_sys->f_amp[j] = EqzConvertdB( eqz_preset_10b[i].f_amp[j] );
+                f_amp[j] = EqzConvertdB( eqz_preset_10b[i].f_amp[j] );
                 d = lldiv( eqz_preset_10b[i].f_amp[j] * 10000000, 10000000 );
                 if( asprintf( &psz, "%s %lld.%07llu",
                               psz_newbands ? psz_newbands : "",
                               d.quot, d.rem ) == -1 )
                 {
                     free( psz_newbands );
-                    vlc_mutex_unlock( &p_sys->lock );
                     return VLC_ENOMEM;
                 }
                 free( psz_newbands );
                 psz_newbands = psz;
             }
+
+            vlc_mutex_lock( &p_sys->lock );
+            p_sys->f_gamp *= f_preamp;
+            memcpy( p_sys->f_amp, f_amp, sizeof (f_amp) );
             if( !p_sys->b_first )
             {
                 vlc_mutex_unlock( &p_sys->lock );
@@ -554,7 +679,6 @@ static int PresetCallback( vlc_object_t *p_aout, char const *psz_cmd,
             return VLC_SUCCESS;
         }
     }
-    vlc_mutex_unlock( &p_sys->lock );
     msg_Err( p_aout, "equalizer preset '%s' not found", psz_preset );
     msg_Info( p_aout, "full list:" );
     for( unsigned i = 0; i < NB_PRESETS; i++ )
@@ -573,8 +697,10 @@ static int PreampCallback( vlc_object_t *p_this, char const *psz_cmd,
     else if( newval.f_float > 20.0 )
         newval.f_float = 20.0;
 
+    float f_gamp = pow( 10, newval.f_float /20.0);
+
     vlc_mutex_lock( &p_sys->lock );
-    p_sys->f_gamp = pow( 10, newval.f_float /20.0);
+    p_sys->f_gamp = f_gamp;
     vlc_mutex_unlock( &p_sys->lock );
 
     return VLC_SUCCESS;
@@ -589,8 +715,13 @@ static int BandsCallback( vlc_object_t *p_this, char const *psz_cmd,
     const char *p = psz_bands;
     char *psz_next;
 
+    float f_amp[EQZ_BANDS_MAX];
+
     /* Same thing for bands */
     vlc_mutex_lock( &p_sys->lock );
+    memcpy( f_amp, p_sys->f_amp, sizeof (f_amp) );
+    vlc_mutex_unlock( &p_sys->lock );
+
     for( int i = 0; i < p_sys->i_band; i++ )
     {
         float f;
@@ -604,12 +735,15 @@ static int BandsCallback( vlc_object_t *p_this, char const *psz_cmd,
         if( psz_next == p )
             break; /* no conversion */
 
-        p_sys->f_amp[i] = EqzConvertdB( f );
+        f_amp[i] = EqzConvertdB( f );
 
         if( *psz_next == '\0' )
             break; /* end of line */
         p = &psz_next[1];
     }
+
+    vlc_mutex_lock( &p_sys->lock );
+    memcpy( p_sys->f_amp, f_amp, sizeof (f_amp) );
     vlc_mutex_unlock( &p_sys->lock );
     return VLC_SUCCESS;
 }
@@ -0,0 +1,423 @@
+/*****************************************************************************
+ * polyphase.c : polyphase windowed sinc resampler
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Every output sample is the dot product of the input samples around its
+ * position and a windowed sinc filter sampled at that fractional position.
+ * The filter is tabulated for a fixed number of phases and interpolated
+ * linearly in between, so that any ratio works, and changing the ratio only
+ * changes the step between two output samples.
+ *
+ * Two tiers are provided:
+ *  - "polyphase" converts the sample rate with a long filter. Its cutoff
+ *    follows the output Nyquist frequency when downsampling.
+ *  - "polyphase-drift" is meant for clock drift compensation, where the
+ *    ratio stays very close to one: it uses a short filter (three samples
+ *    of latency) and never recomputes its table. While the ratio is exactly
+ *    one, it merely copies the samples.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_plugin.h>
+#include <vlc_cpu.h>
+
+#if defined(CAN_COMPILE_SSE) && (VLC_GCC_VERSION(4, 9) || defined(__clang__))
+# define HAVE_POLYPHASE_SSE
+# include <xmmintrin.h>
+#endif
+
+static int Open (vlc_object_t *);
+static int OpenResampler (vlc_object_t *);
+static int OpenDrift (vlc_object_t *);
+static void Close (vlc_object_t *);
+
+vlc_module_begin ()
+    set_shortname (N_("Polyphase resampler"))
+    set_description (N_("Polyphase windowed sinc resampler"))
+    set_category (CAT_AUDIO)
+    set_subcategory (SUBCAT_AUDIO_MISC)
+    set_capability ("audio converter", 30)
+    set_callbacks (Open, Close)
+
+    add_submodule ()
+    set_capability ("audio resampler", 30)
+    set_callbacks (OpenResampler, Close)
+
+    add_submodule ()
+    set_description (N_("Polyphase drift compensation resampler"))
+    set_capability ("audio resampler", 0)
+    set_callbacks (OpenDrift, Close)
+    add_shortcut ("polyphase-drift")
+vlc_module_end ()
+
+typedef struct
+{
+    unsigned taps;   /**< Filter length, a multiple of 4 */
+    unsigned phases; /**< Tabulated fractional positions */
+    double beta;     /**< Kaiser window parameter */
+    bool adaptive;   /**< Lower the cutoff when downsampling */
+} polyphase_tier_t;
+
+static const polyphase_tier_t tier_quality = { 32, 256, 8.6, true };
+static const polyphase_tier_t tier_drift = { 8, 64, 5., false };
+
+struct filter_sys_t
+{
+    const polyphase_tier_t *tier;
+    float *table;      /* (phases + 1) rows of taps coefficients */
+    float cutoff;      /* Cutoff of the table, relative to the input Nyquist */
+
+    unsigned channels;
+    float *history;    /* Planar input, capacity samples per channel */
+    size_t capacity;
+    size_t length;     /* Valid samples per channel */
+    double pos;        /* Position of the first tap of the next output */
+
+    void (*interpolate)(float *, const float *, const float *, float,
+                        unsigned);
+    float (*dot)(const float *, const float *, unsigned);
+};
+
+static double BesselI0 (double x)
+{
+    double sum = 1., term = 1.;
+
+    for (unsigned k = 1; k < 32; k++)
+    {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+/* Fills the table for the given cutoff. Row p is the filter for an output
+ * located p / phases samples after the center tap. Each row is normalized
+ * to unity gain at DC. */
+static void BuildTable (filter_sys_t *sys, float cutoff)
+{
+    const polyphase_tier_t *tier = sys->tier;
+    const double center = tier->taps / 2 - 1;
+    const double half = tier->taps / 2.;
+    const double i0beta = BesselI0 (tier->beta);
+
+    for (unsigned p = 0; p <= tier->phases; p++)
+    {
+        float *row = sys->table + p * tier->taps;
+        double sum = 0.;
+
+        for (unsigned k = 0; k < tier->taps; k++)
+        {
+            double t = k - center - (double)p / tier->phases;
+            double r = t / half;
+            double w = (fabs (r) < 1.)
+                     ? BesselI0 (tier->beta * sqrt (1. - r * r)) / i0beta : 0.;
+            double x = M_PI * cutoff * t;
+            double s = (fabs (x) > 1e-9) ? sin (x) / x : 1.;
+
+            row[k] = s * w;
+            sum += row[k];
+        }
+        for (unsigned k = 0; k < tier->taps; k++)
+            row[k] /= sum;
+    }
+    sys->cutoff = cutoff;
+}
+
+static float Cutoff (const filter_sys_t *sys, unsigned irate, unsigned orate)
+{
+    if (!sys->tier->adaptive)
+        return 1.f;
+    return (irate > orate) ? .95f * orate / irate : .95f;
+}
+
+static void InterpolateC (float *restrict coefs, const float *restrict a,
+                          const float *restrict b, float frac, unsigned taps)
+{
+    for (unsigned k = 0; k < taps; k++)
+        coefs[k] = a[k] + frac * (b[k] - a[k]);
+}
+
+static float DotC (const float *restrict coefs, const float *restrict x,
+                   unsigned taps)
+{
+    float sum = 0.f;
+
+    for (unsigned k = 0; k < taps; k++)
+        sum += coefs[k] * x[k];
+    return sum;
+}
+
+#ifdef HAVE_POLYPHASE_SSE
+VLC_SSE
+static void InterpolateSSE (float *restrict coefs, const float *restrict a,
+                            const float *restrict b, float frac, unsigned taps)
+{
+    const __m128 f = _mm_set1_ps (frac);
+
+    for (unsigned k = 0; k < taps; k += 4)
+    {
+        __m128 va = _mm_loadu_ps (a + k);
+        __m128 vb = _mm_loadu_ps (b + k);
+        _mm_storeu_ps (coefs + k,
+                       _mm_add_ps (va, _mm_mul_ps (f, _mm_sub_ps (vb, va))));
+    }
+}
+
+VLC_SSE
+static float DotSSE (const float *restrict coefs, const float *restrict x,
+                     unsigned taps)
+{
+    __m128 s0 = _mm_setzero_ps (), s1 = _mm_setzero_ps ();
+    unsigned k = 0;
+
+    for (; k + 8 <= taps; k += 8)
+    {
+        s0 = _mm_add_ps (s0, _mm_mul_ps (_mm_loadu_ps (coefs + k),
+                                         _mm_loadu_ps (x + k)));
+        s1 = _mm_add_ps (s1, _mm_mul_ps (_mm_loadu_ps (coefs + k + 4),
+                                         _mm_loadu_ps (x + k + 4)));
+    }
+    if (k < taps)
+        s0 = _mm_add_ps (s0, _mm_mul_ps (_mm_loadu_ps (coefs + k),
+                                         _mm_loadu_ps (x + k)));
+    s0 = _mm_add_ps (s0, s1);
+    s0 = _mm_add_ps (s0, _mm_movehl_ps (s0, s0));
+    s0 = _mm_add_ss (s0, _mm_shuffle_ps (s0, s0, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32 (s0);
+}
+#endif
+
+static block_t *Resample (filter_t *, block_t *);
+
+static int OpenTier (vlc_object_t *obj, const polyphase_tier_t *tier)
+{
+    filter_t *filter = (filter_t *)obj;
+
+    /* Cannot convert format */
+    if (filter->fmt_in.audio.i_format != VLC_CODEC_FL32
+     || filter->fmt_out.audio.i_format != VLC_CODEC_FL32
+    /* Cannot remix */
+     || filter->fmt_in.audio.i_physical_channels
+                                  != filter->fmt_out.audio.i_physical_channels
+     || filter->fmt_in.audio.i_original_channels
+                                  != filter->fmt_out.audio.i_original_channels)
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = malloc (sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->tier = tier;
+    sys->table = malloc ((tier->phases + 1) * tier->taps * sizeof (float));
+    sys->channels = aout_FormatNbChannels (&filter->fmt_in.audio);
+    /* Start with silence, so that the first input sample is at the center
+     * of the first output. */
+    sys->length = tier->taps / 2 - 1;
+    sys->capacity = sys->length;
+    sys->history = calloc (sys->channels * sys->capacity + 1, sizeof (float));
+    sys->pos = 0.;
+    if (unlikely(sys->table == NULL || sys->history == NULL))
+    {
+        free (sys->history);
+        free (sys->table);
+        free (sys);
+        return VLC_ENOMEM;
+    }
+
+    BuildTable (sys, Cutoff (sys, filter->fmt_in.audio.i_rate,
+                             filter->fmt_out.audio.i_rate));
+
+    sys->interpolate = InterpolateC;
+    sys->dot = DotC;
+#ifdef HAVE_POLYPHASE_SSE
+    if (vlc_CPU_SSE ())
+    {
+        sys->interpolate = InterpolateSSE;
+        sys->dot = DotSSE;
+    }
+#endif
+
+    filter->p_sys = sys;
+    filter->pf_audio_filter = Resample;
+    return VLC_SUCCESS;
+}
+
+static int OpenResampler (vlc_object_t *obj)
+{
+    return OpenTier (obj, &tier_quality);
+}
+
+static int OpenDrift (vlc_object_t *obj)
+{
+    return OpenTier (obj, &tier_drift);
+}
+
+static int Open (vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+
+    /* Will change rate */
+    if (filter->fmt_in.audio.i_rate == filter->fmt_out.audio.i_rate)
+        return VLC_EGENERIC;
+    return OpenResampler (obj);
+}
+
+static void Close (vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    filter_sys_t *sys = filter->p_sys;
+
+    free (sys->history);
+    free (sys->table);
+    free (sys);
+}
+
+/* Appends the interleaved input to the planar history */
+static int Append (filter_sys_t *sys, const float *in, size_t frames)
+{
+    const unsigned channels = sys->channels;
+
+    if (sys->length + frames > sys->capacity)
+    {
+        size_t capacity = sys->length + frames;
+        float *history = malloc (channels * capacity * sizeof (float));
+        if (unlikely(history == NULL))
+            return -1;
+
+        for (unsigned ch = 0; ch < channels; ch++)
+            memcpy (history + ch * capacity, sys->history + ch * sys->capacity,
+                    sys->length * sizeof (float));
+        free (sys->history);
+        sys->history = history;
+        sys->capacity = capacity;
+    }
+
+    for (unsigned ch = 0; ch < channels; ch++)
+    {
+        float *x = sys->history + ch * sys->capacity + sys->length;
+
+        for (size_t i = 0; i < frames; i++)
+            x[i] = in[i * channels + ch];
+    }
+    sys->length += frames;
+    return 0;
+}
+
+static block_t *Resample (filter_t *filter, block_t *in)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const polyphase_tier_t *tier = sys->tier;
+    const unsigned channels = sys->channels;
+    const unsigned taps = tier->taps;
+    const unsigned irate = filter->fmt_in.audio.i_rate;
+    const unsigned orate = filter->fmt_out.audio.i_rate;
+    const double step = (double)irate / orate;
+    block_t *out = NULL;
+
+    /* Only a significant change of the ratio is worth a new table */
+    float cutoff = Cutoff (sys, irate, orate);
+    if (fabsf (cutoff - sys->cutoff) > .01f * sys->cutoff)
+        BuildTable (sys, cutoff);
+
+    if (Append (sys, (const float *)in->p_buffer, in->i_nb_samples))
+        goto error;
+
+    size_t frames = 0;
+    if (sys->pos + taps <= sys->length)
+        frames = (size_t)((sys->length - taps - sys->pos) / step) + 1;
+
+    out = filter_NewAudioBuffer (filter,
+                                 frames * filter->fmt_out.audio.i_bytes_per_frame);
+    if (unlikely(out == NULL))
+        goto error;
+
+    float *dst = (float *)out->p_buffer;
+    double pos = sys->pos;
+
+    if (step == 1. && pos == floor (pos))
+    {   /* No drift: the table row 0 is an impulse on the center tap */
+        const size_t offset = (size_t)pos + taps / 2 - 1;
+
+        for (unsigned ch = 0; ch < channels; ch++)
+        {
+            const float *x = sys->history + ch * sys->capacity + offset;
+
+            for (size_t i = 0; i < frames; i++)
+                dst[i * channels + ch] = x[i];
+        }
+        pos += frames;
+    }
+    else
+    {
+        float coefs[taps];
+
+        for (size_t i = 0; i < frames; i++)
+        {
+            const size_t ipos = (size_t)pos;
+            if (ipos + taps > sys->length)
+            {   /* Rounding of the accumulated position */
+                frames = i;
+                break;
+            }
+
+            const double phase = (pos - ipos) * tier->phases;
+            const unsigned row = (unsigned)phase;
+            const float *a = sys->table + row * taps;
+
+            sys->interpolate (coefs, a, a + taps, phase - row, taps);
+            for (unsigned ch = 0; ch < channels; ch++)
+                *(dst++) = sys->dot (coefs,
+                                     sys->history + ch * sys->capacity + ipos,
+                                     taps);
+            pos += step;
+        }
+    }
+
+    /* Drop the samples that no later output will use */
+    size_t consumed = (size_t)pos;
+    if (consumed > sys->length)
+        consumed = sys->length;
+    for (unsigned ch = 0; ch < channels; ch++)
+    {
+        float *x = sys->history + ch * sys->capacity;
+        memmove (x, x + consumed, (sys->length - consumed) * sizeof (float));
+    }
+    sys->length -= consumed;
+    sys->pos = pos - consumed;
+
+    out->i_buffer = frames * filter->fmt_out.audio.i_bytes_per_frame;
+    out->i_nb_samples = frames;
+    out->i_pts = in->i_pts;
+    out->i_length = frames * CLOCK_FREQ / orate;
+error:
+    block_Release (in);
+    return out;
+}
@@ -32,10 +32,21 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
 
+#if defined(CAN_COMPILE_SSE) && (VLC_GCC_VERSION(4, 9) || defined(__clang__))
+# define HAVE_CORR_SSE
+# include <xmmintrin.h>
+#endif
+#if defined(HAVE_CORR_SSE) && defined(CAN_COMPILE_AVX2)
+# define HAVE_CORR_AVX
+# include <immintrin.h>
+# define VLC_AVX __attribute__ ((__target__ ("avx")))
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -111,8 +122,84 @@ struct filter_sys_t
     void     *buf_pre_corr;
     void     *table_window;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    float   (*correlate)( const float *a, const float *b, unsigned samples );
 };
 
+/*****************************************************************************
+ * correlate: dot product of the pre-correlation and one search position
+ *****************************************************************************/
+static float correlate_c( const float *a, const float *b, unsigned samples )
+{
+    float corr = 0;
+    for( unsigned i = 0; i < samples; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+#ifdef HAVE_CORR_SSE
+/* Four accumulators hide the latency of the additions */
+VLC_SSE
+static float correlate_sse( const float *a, const float *b, unsigned samples )
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    __m128 s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+    unsigned i = 0;
+
+    for( ; i + 16 <= samples; i += 16 )
+    {
+        s0 = _mm_add_ps( s0, _mm_mul_ps( _mm_loadu_ps( a + i ),
+                                         _mm_loadu_ps( b + i ) ) );
+        s1 = _mm_add_ps( s1, _mm_mul_ps( _mm_loadu_ps( a + i + 4 ),
+                                         _mm_loadu_ps( b + i + 4 ) ) );
+        s2 = _mm_add_ps( s2, _mm_mul_ps( _mm_loadu_ps( a + i + 8 ),
+                                         _mm_loadu_ps( b + i + 8 ) ) );
+        s3 = _mm_add_ps( s3, _mm_mul_ps( _mm_loadu_ps( a + i + 12 ),
+                                         _mm_loadu_ps( b + i + 12 ) ) );
+    }
+    s0 = _mm_add_ps( _mm_add_ps( s0, s1 ), _mm_add_ps( s2, s3 ) );
+    s0 = _mm_add_ps( s0, _mm_movehl_ps( s0, s0 ) );
+    s0 = _mm_add_ss( s0, _mm_shuffle_ps( s0, s0, _MM_SHUFFLE(1, 1, 1, 1) ) );
+
+    float corr = _mm_cvtss_f32( s0 );
+    for( ; i < samples; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+#endif
+
+#ifdef HAVE_CORR_AVX
+VLC_AVX
+static float correlate_avx( const float *a, const float *b, unsigned samples )
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    unsigned i = 0;
+
+    for( ; i + 32 <= samples; i += 32 )
+    {
+        s0 = _mm256_add_ps( s0, _mm256_mul_ps( _mm256_loadu_ps( a + i ),
+                                               _mm256_loadu_ps( b + i ) ) );
+        s1 = _mm256_add_ps( s1, _mm256_mul_ps( _mm256_loadu_ps( a + i + 8 ),
+                                               _mm256_loadu_ps( b + i + 8 ) ) );
+        s2 = _mm256_add_ps( s2, _mm256_mul_ps( _mm256_loadu_ps( a + i + 16 ),
+                                               _mm256_loadu_ps( b + i + 16 ) ) );
+        s3 = _mm256_add_ps( s3, _mm256_mul_ps( _mm256_loadu_ps( a + i + 24 ),
+                                               _mm256_loadu_ps( b + i + 24 ) ) );
+    }
+    s0 = _mm256_add_ps( _mm256_add_ps( s0, s1 ), _mm256_add_ps( s2, s3 ) );
+
+    __m128 s = _mm_add_ps( _mm256_castps256_ps128( s0 ),
+                           _mm256_extractf128_ps( s0, 1 ) );
+    s = _mm_add_ps( s, _mm_movehl_ps( s, s ) );
+    s = _mm_add_ss( s, _mm_shuffle_ps( s, s, _MM_SHUFFLE(1, 1, 1, 1) ) );
+
+    float corr = _mm_cvtss_f32( s );
+    for( ; i < samples; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+#endif
+
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
@@ -134,12 +221,8 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
 
     search_start = (float *)p->buf_queue + p->samples_per_frame;
     for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
+      float corr = p->correlate( p->buf_pre_corr, search_start,
+                                 p->samples_overlap - p->samples_per_frame );
       if( corr > best_corr ) {
         best_corr = corr;
         best_off  = off;
@@ -338,6 +421,15 @@ static int reinit_buffers( filter_t *p_filter )
                 *pw++ = v;
         }
         p->best_overlap_offset = best_overlap_offset_float;
+        p->correlate = correlate_c;
+#ifdef HAVE_CORR_SSE
+        if( vlc_CPU_SSE() )
+            p->correlate = correlate_sse;
+#endif
+#ifdef HAVE_CORR_AVX
+        if( vlc_CPU_AVX() )
+            p->correlate = correlate_avx;
+#endif
     }
 
     unsigned new_size = ( p->frames_search + frames_stride + frames_overlap ) * p->bytes_per_frame;
@@ -468,7 +560,7 @@ static block_t *DoWork( filter_t * p_filter, block_t * p_in_buf )
     }
 
     size_t i_outsize = calculate_output_buffer_size ( p_filter, p_in_buf->i_buffer );
-    block_t *p_out_buf = block_Alloc( i_outsize );
+    block_t *p_out_buf = filter_NewAudioBuffer( p_filter, i_outsize );
     if( p_out_buf == NULL )
         return NULL;
 
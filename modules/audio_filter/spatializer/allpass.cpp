@@ -6,6 +6,12 @@
 
 #include "allpass.hpp"
 
+#if defined(__SSE__)
+# include <xmmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
 allpass::allpass()
 {
     bufidx = 0;
@@ -17,6 +23,57 @@ void allpass::setbuffer(float *buf, int size)
     bufsize = size;
 }
 
+/*****************************************************************************
+ * Same as process() on count samples, in place. See comb::processblock().
+ *****************************************************************************/
+void allpass::processblock(float *io, int count)
+{
+    while (count > 0)
+    {
+        float *buf = buffer + bufidx;
+        int n = bufsize - bufidx;
+        if (n > count)
+            n = count;
+
+        int i = 0;
+#if defined(__SSE__)
+        const __m128 f = _mm_set1_ps(feedback);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 input = _mm_loadu_ps(io + i);
+            __m128 bufout = _mm_loadu_ps(buf + i);
+
+            _mm_storeu_ps(buf + i, _mm_add_ps(input, _mm_mul_ps(bufout, f)));
+            _mm_storeu_ps(io + i, _mm_sub_ps(bufout, input));
+        }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+        const float32x4_t f = vdupq_n_f32(feedback);
+        for (; i + 4 <= n; i += 4)
+        {
+            float32x4_t input = vld1q_f32(io + i);
+            float32x4_t bufout = vld1q_f32(buf + i);
+
+            vst1q_f32(buf + i, vaddq_f32(input, vmulq_f32(bufout, f)));
+            vst1q_f32(io + i, vsubq_f32(bufout, input));
+        }
+#endif
+        for (; i < n; i++)
+        {
+            float input = io[i];
+            float bufout = undenormalise(buf[i]);
+
+            buf[i] = input + (bufout*feedback);
+            io[i] = -input + bufout;
+        }
+
+        bufidx += n;
+        if (bufidx >= bufsize)
+            bufidx = 0;
+        io += n;
+        count -= n;
+    }
+}
+
 void allpass::mute()
 {
     for (int i=0; i<bufsize; i++)
@@ -14,6 +14,7 @@ public:
         allpass();
     void    setbuffer(float *buf, int size);
     inline  float    process(float inp);
+    void    processblock(float *buf, int count);
     void    mute();
     void    setfeedback(float val);
     float    getfeedback();
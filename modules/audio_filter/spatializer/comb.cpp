@@ -6,6 +6,12 @@
 
 #include "comb.hpp"
 
+#if defined(__SSE__)
+# include <xmmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
 comb::comb()
 {
     filterstore = 0;
@@ -18,6 +24,65 @@ void comb::setbuffer(float *buf, int size)
     bufsize = size;
 }
 
+/*****************************************************************************
+ * Same as process() on count samples, the outputs being added to acc.
+ * Each sample of the delay line is read then written once per pass, so
+ * the samples between bufidx and the end of the line are independent.
+ * The vector code relies on flushtozero instead of undenormalise().
+ *****************************************************************************/
+void comb::processblock(const float *inp, float *acc, int count)
+{
+    while (count > 0)
+    {
+        float *buf = buffer + bufidx;
+        int n = bufsize - bufidx;
+        if (n > count)
+            n = count;
+
+        int i = 0;
+#if defined(__SSE__)
+        const __m128 d = _mm_set1_ps(damp2);
+        const __m128 f = _mm_set1_ps(feedback);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 output = _mm_loadu_ps(buf + i);
+            __m128 store = _mm_mul_ps(output, d);
+
+            _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), output));
+            _mm_storeu_ps(buf + i, _mm_add_ps(_mm_loadu_ps(inp + i),
+                                              _mm_mul_ps(store, f)));
+        }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+        const float32x4_t d = vdupq_n_f32(damp2);
+        const float32x4_t f = vdupq_n_f32(feedback);
+        for (; i + 4 <= n; i += 4)
+        {
+            float32x4_t output = vld1q_f32(buf + i);
+            float32x4_t store = vmulq_f32(output, d);
+
+            vst1q_f32(acc + i, vaddq_f32(vld1q_f32(acc + i), output));
+            vst1q_f32(buf + i, vaddq_f32(vld1q_f32(inp + i),
+                                         vmulq_f32(store, f)));
+        }
+#endif
+        for (; i < n; i++)
+        {
+            float output = undenormalise(buf[i]);
+
+            filterstore = undenormalise(output*damp2);
+            buf[i] = inp[i] + filterstore*feedback;
+            acc[i] += output;
+        }
+
+        bufidx += n;
+        if (bufidx >= bufsize)
+            bufidx = 0;
+        inp += n;
+        acc += n;
+        count -= n;
+    }
+}
+
 void comb::mute()
 {
     for (int i=0; i<bufsize; i++)
@@ -19,6 +19,7 @@ public:
     comb();
     void    setbuffer(float *buf, int size);
     inline  float    process(float inp);
+    void    processblock(const float *inp, float *acc, int count);
     void    mute();
     void    setdamp(float val);
     float    getdamp();
@@ -8,11 +8,62 @@
 #ifndef _denormals_
 #define _denormals_
 
+#include <stdint.h>
+#include <string.h>
 
-#ifdef __cplusplus
-extern "C"
+#if defined(__SSE__)
+# include <xmmintrin.h>
 #endif
-float undenormalise( float );
+
+// Tests the exponent bits, as fpclassify() is not available in C++90
+static inline float undenormalise( float f )
+{
+    uint32_t bits;
+    memcpy( &bits, &f, sizeof(bits) );
+    if( (bits & 0x7f800000) == 0 )
+        return 0.f;
+    return f;
+}
+
+/**
+* Flushes the denormalled results to zero while in scope, so that the
+* vector code needs no undenormalise(). NEON always flushes to zero.
+*/
+class flushtozero
+{
+public:
+#if defined(__SSE__)
+    flushtozero()  { csr = _mm_getcsr(); _mm_setcsr(csr | 0x8000); }
+    ~flushtozero() { _mm_setcsr(csr); }
+private:
+    unsigned csr;
+#elif defined(__aarch64__)
+    flushtozero()
+    {
+        uint64_t fpcr;
+        __asm__ volatile ("mrs %0, fpcr" : "=r"(csr));
+        fpcr = csr | (1 << 24);
+        __asm__ volatile ("msr fpcr, %0" : : "r"(fpcr));
+    }
+    ~flushtozero() { __asm__ volatile ("msr fpcr, %0" : : "r"(csr)); }
+private:
+    uint64_t csr;
+#elif defined(__arm__) && defined(__VFP_FP__) && !defined(__SOFTFP__)
+    flushtozero()
+    {
+        uint32_t fpscr;
+        __asm__ volatile ("vmrs %0, fpscr" : "=r"(csr));
+        fpscr = csr | (1 << 24);
+        __asm__ volatile ("vmsr fpscr, %0" : : "r"(fpscr));
+    }
+    ~flushtozero() { __asm__ volatile ("vmsr fpscr, %0" : : "r"(csr)); }
+private:
+    uint32_t csr;
+#else
+    flushtozero() {}
+#endif
+};
 
 #endif//_denormals_
 
+//ends
@@ -82,6 +82,43 @@ void revmodel::mute()
     }
 }
 
+/*****************************************************************************
+ *  Runs the filters on up to blockframes frames.
+ *  The combs and allpasses are run one after the other on the whole block,
+ *  each of them on consecutive samples, rather than all of them on every
+ *  sample: that is the same computation, in the same order.
+ *****************************************************************************/
+void revmodel::processblock(const float *inputL, float *outL, float *outR,
+                            int count, int skip)
+{
+    float input[blockframes];
+    int i;
+
+    for(i=0; i<count; i++)
+    {
+        /* TODO this module supports only 2 audio channels, let's improve this */
+        float inputR = (skip > 1) ? inputL[1] : inputL[0];
+
+        input[i] = (inputL[0] + inputR) * gain;
+        outL[i] = outR[i] = 0;
+        inputL += skip;
+    }
+
+    // Accumulate comb filters in parallel
+    for(i=0; i<numcombs; i++)
+    {
+        combL[i].processblock(input, outL, count);
+        combR[i].processblock(input, outR, count);
+    }
+
+    // Feed through allpasses in series
+    for(i=0; i<numallpasses; i++)
+    {
+        allpassL[i].processblock(outL, count);
+        allpassR[i].processblock(outR, count);
+    }
+}
+
 /*****************************************************************************
  *  Transforms the audio stream
  * /param float *inputL     input buffer
@@ -89,70 +126,54 @@ void revmodel::mute()
  * /param long numsamples  number of samples to be processed
  * /param int skip             number of channels in the audio stream
  *****************************************************************************/
-void revmodel::processreplace(float *inputL, float *outputL, long /* numsamples */, int skip)
+void revmodel::processreplace(float *inputL, float *outputL, long numsamples, int skip)
 {
-    float outL,outR,input;
-    float inputR;
-    int i;
+    float outL[blockframes], outR[blockframes];
 
-    outL = outR = 0;
-        /* TODO this module supports only 2 audio channels, let's improve this */
-        if (skip > 1)
-           inputR = inputL[1];
-        else
-           inputR = inputL[0];
-        input = (inputL[0] + inputR) * gain;
-
-        // Accumulate comb filters in parallel
-        for(i=0; i<numcombs; i++)
-        {
-            outL += combL[i].process(input);
-            outR += combR[i].process(input);
-        }
+    while (numsamples > 0)
+    {
+        int count = (numsamples < blockframes) ? numsamples : blockframes;
 
-        // Feed through allpasses in series
-        for(i=0; i<numallpasses; i++)
+        processblock(inputL, outL, outR, count, skip);
+
+        for(int i=0; i<count; i++)
         {
-            outL = allpassL[i].process(outL);
-            outR = allpassR[i].process(outR);
+            float inputR = (skip > 1) ? inputL[1] : inputL[0];
+
+            // Calculate output REPLACING anything already there
+            outputL[0] = (outL[i]*wet1 + outR[i]*wet2 + inputR*dry);
+            if (skip > 1)
+                outputL[1] = (outR[i]*wet1 + outL[i]*wet2 + inputR*dry);
+            inputL += skip;
+            outputL += skip;
         }
-
-        // Calculate output REPLACING anything already there
-        outputL[0] = (outL*wet1 + outR*wet2 + inputR*dry);
-           if (skip > 1)
-        outputL[1] = (outR*wet1 + outL*wet2 + inputR*dry);
+        numsamples -= count;
+    }
 }
 
-void revmodel::processmix(float *inputL, float *outputL, long /* numsamples */, int skip)
+void revmodel::processmix(float *inputL, float *outputL, long numsamples, int skip)
 {
-    float outL,outR,input;
-    float inputR;
-
-    outL = outR = 0;
-        if (skip > 1)
-           inputR = inputL[1];
-        else
-           inputR = inputL[0];
-        input = (inputL[0] + inputR) * gain;
-
-        // Accumulate comb filters in parallel
-        for(int i=0; i<numcombs; i++)
-        {
-            outL += combL[i].process(input);
-            outR += combR[i].process(input);
-        }
+    float outL[blockframes], outR[blockframes];
+
+    while (numsamples > 0)
+    {
+        int count = (numsamples < blockframes) ? numsamples : blockframes;
+
+        processblock(inputL, outL, outR, count, skip);
 
-        // Feed through allpasses in series
-        for(int i=0; i<numallpasses; i++)
+        for(int i=0; i<count; i++)
         {
-            outL = allpassL[i].process(outL);
-            outR = allpassR[i].process(outR);
+            float inputR = (skip > 1) ? inputL[1] : inputL[0];
+
+            // Calculate output MIXING with anything already there
+            outputL[0] += (outL[i]*wet1 + outR[i]*wet2 + inputR*dry);
+            if (skip > 1)
+                outputL[1] += (outR[i]*wet1 + outL[i]*wet2 + inputR*dry);
+            inputL += skip;
+            outputL += skip;
         }
-
-        // Calculate output REPLACING anything already there
-        outputL[0] += (outL*wet1 + outR*wet2 + inputR*dry);
-           if (skip > 1)
-        outputL[1] += (outR*wet1 + outL*wet2 + inputR*dry);
+        numsamples -= count;
+    }
 }
 
 void revmodel::update()
@@ -35,6 +35,8 @@ public:
     void    setmode(float value);
 private:
     void    update();
+    void    processblock(const float *inputL, float *outL, float *outR,
+                         int count, int skip);
 private:
     float    gain;
     float    roomsize,roomsize1;
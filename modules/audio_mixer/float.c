@@ -34,6 +34,18 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
+#include <vlc_cpu.h>
+
+#if defined(CAN_COMPILE_SSE2) && (VLC_GCC_VERSION(4, 9) || defined(__clang__))
+# define HAVE_AMPLIFY_SSE2
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+#if defined(HAVE_AMPLIFY_SSE2) && defined(CAN_COMPILE_AVX2)
+# define HAVE_AMPLIFY_AVX
+# include <immintrin.h>
+# define VLC_AVX __attribute__ ((__target__ ("avx")))
+#endif
 
 /*****************************************************************************
  * Local prototypes
@@ -75,11 +87,107 @@ static void FilterFL64( audio_volume_t *p_volume, block_t *p_buffer,
     if( mult == 1. )
         return; /* nothing to do */
 
-    for( size_t i = p_buffer->i_buffer / sizeof(float); i > 0; i-- )
+    for( size_t i = p_buffer->i_buffer / sizeof(double); i > 0; i-- )
+        *(p++) *= mult;
+
+    (void) p_volume;
+}
+
+#ifdef HAVE_AMPLIFY_SSE2
+VLC_SSE
+static void FilterFL32SSE( audio_volume_t *p_volume, block_t *p_buffer,
+                           float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i = p_buffer->i_buffer / sizeof(float);
+    const __m128 mult = _mm_set1_ps( f_multiplier );
+
+    for( ; i >= 8; i -= 8, p += 8 )
+    {
+        _mm_storeu_ps( p, _mm_mul_ps( _mm_loadu_ps( p ), mult ) );
+        _mm_storeu_ps( p + 4, _mm_mul_ps( _mm_loadu_ps( p + 4 ), mult ) );
+    }
+    for( ; i > 0; i-- )
+        *(p++) *= f_multiplier;
+
+    (void) p_volume;
+}
+
+VLC_SSE2
+static void FilterFL64SSE2( audio_volume_t *p_volume, block_t *p_buffer,
+                            float f_multiplier )
+{
+    double *p = (double *)p_buffer->p_buffer;
+    size_t i = p_buffer->i_buffer / sizeof(double);
+    double mult = f_multiplier;
+    if( mult == 1. )
+        return; /* nothing to do */
+
+    const __m128d multv = _mm_set1_pd( mult );
+
+    for( ; i >= 4; i -= 4, p += 4 )
+    {
+        _mm_storeu_pd( p, _mm_mul_pd( _mm_loadu_pd( p ), multv ) );
+        _mm_storeu_pd( p + 2, _mm_mul_pd( _mm_loadu_pd( p + 2 ), multv ) );
+    }
+    for( ; i > 0; i-- )
+        *(p++) *= mult;
+
+    (void) p_volume;
+}
+#endif
+
+#ifdef HAVE_AMPLIFY_AVX
+VLC_AVX
+static void FilterFL32AVX( audio_volume_t *p_volume, block_t *p_buffer,
+                           float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i = p_buffer->i_buffer / sizeof(float);
+    const __m256 mult = _mm256_set1_ps( f_multiplier );
+
+    for( ; i >= 16; i -= 16, p += 16 )
+    {
+        _mm256_storeu_ps( p, _mm256_mul_ps( _mm256_loadu_ps( p ), mult ) );
+        _mm256_storeu_ps( p + 8,
+                          _mm256_mul_ps( _mm256_loadu_ps( p + 8 ), mult ) );
+    }
+    for( ; i > 0; i-- )
+        *(p++) *= f_multiplier;
+
+    (void) p_volume;
+}
+
+VLC_AVX
+static void FilterFL64AVX( audio_volume_t *p_volume, block_t *p_buffer,
+                           float f_multiplier )
+{
+    double *p = (double *)p_buffer->p_buffer;
+    size_t i = p_buffer->i_buffer / sizeof(double);
+    double mult = f_multiplier;
+    if( mult == 1. )
+        return; /* nothing to do */
+
+    const __m256d multv = _mm256_set1_pd( mult );
+
+    for( ; i >= 8; i -= 8, p += 8 )
+    {
+        _mm256_storeu_pd( p, _mm256_mul_pd( _mm256_loadu_pd( p ), multv ) );
+        _mm256_storeu_pd( p + 4,
+                          _mm256_mul_pd( _mm256_loadu_pd( p + 4 ), multv ) );
+    }
+    for( ; i > 0; i-- )
         *(p++) *= mult;
 
     (void) p_volume;
 }
+#endif
 
 /**
  * Initializes the mixer
@@ -92,9 +200,25 @@ static int Create( vlc_object_t *p_this )
     {
         case VLC_CODEC_FL32:
             p_volume->amplify = FilterFL32;
+#ifdef HAVE_AMPLIFY_SSE2
+            if( vlc_CPU_SSE() )
+                p_volume->amplify = FilterFL32SSE;
+#endif
+#ifdef HAVE_AMPLIFY_AVX
+            if( vlc_CPU_AVX() )
+                p_volume->amplify = FilterFL32AVX;
+#endif
             break;
         case VLC_CODEC_FL64:
             p_volume->amplify = FilterFL64;
+#ifdef HAVE_AMPLIFY_SSE2
+            if( vlc_CPU_SSE2() )
+                p_volume->amplify = FilterFL64SSE2;
+#endif
+#ifdef HAVE_AMPLIFY_AVX
+            if( vlc_CPU_AVX() )
+                p_volume->amplify = FilterFL64AVX;
+#endif
             break;
         default:
             return -1;
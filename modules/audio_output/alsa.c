@@ -47,6 +47,8 @@ struct aout_sys_t
     vlc_fourcc_t format; /**< Sample format */
     uint8_t chans_table[AOUT_CHAN_MAX]; /**< Channels order table */
     uint8_t chans_to_reorder; /**< Number of channels to reorder */
+    bool mmap; /**< Memory-mapped access */
+    mtime_t latency; /**< Target latency (0 for default buffering) */
 
     bool soft_mute;
     float soft_gain;
@@ -68,6 +70,12 @@ static int EnumDevices (vlc_object_t *, char const *, char ***, char ***);
 #define AUDIO_CHAN_LONGTEXT N_("Channels available for audio output. " \
     "If the input has more channels than the output, it will be down-mixed. " \
     "This parameter is ignored when digital pass-through is active.")
+#define LATENCY_TEXT N_("Target latency (ms)")
+#define LATENCY_LONGTEXT N_( \
+    "Negotiate a small hardware buffer with the device, so that the audio " \
+    "is heard this soon after it is output. The target is raised whenever " \
+    "the device runs out of samples. Zero keeps the default buffering.")
+
 static const int channels[] = {
     AOUT_CHAN_CENTER, AOUT_CHANS_STEREO, AOUT_CHANS_4_0, AOUT_CHANS_4_1,
     AOUT_CHANS_5_0, AOUT_CHANS_5_1, AOUT_CHANS_7_1,
@@ -88,6 +96,8 @@ vlc_module_begin ()
     add_integer ("alsa-audio-channels", AOUT_CHANS_FRONT,
                  AUDIO_CHAN_TEXT, AUDIO_CHAN_LONGTEXT, false)
         change_integer_list (channels, channels_text)
+    add_integer ("alsa-latency", 0, LATENCY_TEXT, LATENCY_LONGTEXT, true)
+        change_integer_range (0, AOUT_MAX_ADVANCE_TIME / 1000)
     add_sw_gain ()
     set_capability( "audio output", 150 )
     set_callbacks( Open, Close )
@@ -409,8 +419,15 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
         goto error;
     }
 
-    val = snd_pcm_hw_params_set_access (pcm, hw,
-                                        SND_PCM_ACCESS_RW_INTERLEAVED);
+    /* Memory-mapped access saves one copy through small periods */
+    sys->mmap = sys->latency > 0
+        && snd_pcm_hw_params_set_access (pcm, hw,
+                                         SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0;
+    if (sys->mmap)
+        val = 0;
+    else
+        val = snd_pcm_hw_params_set_access (pcm, hw,
+                                            SND_PCM_ACCESS_RW_INTERLEAVED);
     if (val)
     {
         msg_Err (aout, "cannot set access mode: %s", snd_strerror (val));
@@ -488,7 +505,7 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     sys->rate = fmt->i_rate;
 
     /* Set buffer size */
-    param = AOUT_MAX_ADVANCE_TIME;
+    param = (sys->latency > 0) ? sys->latency : AOUT_MAX_ADVANCE_TIME;
     val = snd_pcm_hw_params_set_buffer_time_near (pcm, hw, &param, NULL);
     if (val)
     {
@@ -507,6 +524,8 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
 #else /* work-around for period-long latency outputs (e.g. PulseAudio): */
     param = AOUT_MIN_PREPARE_TIME;
 #endif
+    if (sys->latency > 0)
+        param = sys->latency / 4;
     val = snd_pcm_hw_params_set_period_time_near (pcm, hw, &param, NULL);
     if (val)
     {
@@ -524,6 +543,11 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
     Dump (aout, "final HW setup:\n", snd_pcm_hw_params_dump, hw);
 
+    if (sys->latency > 0
+     && snd_pcm_hw_params_get_buffer_time (hw, &param, NULL) == 0)
+        msg_Dbg (aout, "latency %u us (target %"PRId64" us, %s access)",
+                 param, sys->latency, sys->mmap ? "mmap" : "read/write");
+
     /* Get Initial software parameters */
     snd_pcm_sw_params_t *sw;
 
@@ -621,7 +645,12 @@ static void Play (audio_output_t *aout, block_t *block)
     {
         snd_pcm_sframes_t frames;
 
-        frames = snd_pcm_writei (pcm, block->p_buffer, block->i_nb_samples);
+        if (sys->mmap)
+            frames = snd_pcm_mmap_writei (pcm, block->p_buffer,
+                                          block->i_nb_samples);
+        else
+            frames = snd_pcm_writei (pcm, block->p_buffer,
+                                     block->i_nb_samples);
         if (frames >= 0)
         {
             size_t bytes = snd_pcm_frames_to_bytes (pcm, frames);
@@ -632,6 +661,17 @@ static void Play (audio_output_t *aout, block_t *block)
         }
         else  
         {
+            if (frames == -EPIPE && sys->latency > 0
+             && sys->latency < AOUT_MAX_ADVANCE_TIME)
+            {   /* Underrun: the buffer is too small for this system */
+                sys->latency *= 2;
+                if (sys->latency > AOUT_MAX_ADVANCE_TIME)
+                    sys->latency = AOUT_MAX_ADVANCE_TIME;
+                msg_Warn (aout, "underrun, raising latency to %"PRId64" us",
+                          sys->latency);
+                aout_RestartRequest (aout, AOUT_RESTART_OUTPUT);
+            }
+
             int val = snd_pcm_recover (pcm, frames, 1);
             if (val)
             {
@@ -770,6 +810,7 @@ static int Open(vlc_object_t *obj)
     sys->device = var_InheritString (aout, "alsa-audio-device");
     if (unlikely(sys->device == NULL))
         goto error;
+    sys->latency = var_InheritInteger (aout, "alsa-latency") * 1000;
 
     aout->sys = sys;
     aout->start = Start;
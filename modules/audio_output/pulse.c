@@ -40,6 +40,15 @@
 static int  Open        ( vlc_object_t * );
 static void Close       ( vlc_object_t * );
 
+#define LATENCY_TEXT N_("Target latency (ms)")
+#define LATENCY_LONGTEXT N_( \
+    "Ask the server to keep the end-to-end latency of the stream this low. " \
+    "The target is raised whenever the server runs out of samples. " \
+    "Zero keeps the default buffering.")
+
+/* Default target length, see Start() */
+#define DEFAULT_LATENCY (3 * AOUT_MIN_PREPARE_TIME)
+
 vlc_module_begin ()
     set_shortname( "PulseAudio" )
     set_description( N_("Pulseaudio audio output") )
@@ -47,6 +56,8 @@ vlc_module_begin ()
     set_category( CAT_AUDIO )
     set_subcategory( SUBCAT_AUDIO_AOUT )
     add_shortcut( "pulseaudio", "pa" )
+    add_integer( "pulse-latency", 0, LATENCY_TEXT, LATENCY_LONGTEXT, true )
+        change_integer_range( 0, DEFAULT_LATENCY / 1000 )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -74,6 +85,7 @@ struct aout_sys_t
     pa_cvolume cvolume; /**< actual sink input volume */
     mtime_t first_pts; /**< Play time of buffer start */
     mtime_t paused; /**< Time when (last) paused */
+    mtime_t latency; /**< Target latency (0 for default buffering) */
 
     pa_stream_flags_t flags_force; /**< Forced flags (stream must be NULL) */
     char *sink_force; /**< Forced sink name (stream must be NULL) */
@@ -381,9 +393,27 @@ static void stream_suspended_cb(pa_stream *s, void *userdata)
 static void stream_underflow_cb(pa_stream *s, void *userdata)
 {
     audio_output_t *aout = userdata;
+    aout_sys_t *sys = aout->sys;
 
     msg_Dbg(aout, "underflow");
-    (void) s;
+    if (sys->latency <= 0 || sys->latency >= DEFAULT_LATENCY)
+        return;
+
+    /* The target latency is too short for this system: raise it. Unlike
+     * the sample format, the buffer metrics can change on the fly. */
+    sys->latency *= 2;
+    if (sys->latency > DEFAULT_LATENCY)
+        sys->latency = DEFAULT_LATENCY;
+    msg_Warn(aout, "raising latency to %"PRId64" us", sys->latency);
+
+    const pa_sample_spec *ss = pa_stream_get_sample_spec(s);
+    pa_buffer_attr attr = *pa_stream_get_buffer_attr(s);
+    attr.tlength = pa_usec_to_bytes(sys->latency, ss);
+    attr.minreq = pa_usec_to_bytes(sys->latency / 4, ss);
+
+    pa_operation *op = pa_stream_set_buffer_attr(s, &attr, NULL, NULL);
+    if (likely(op != NULL))
+        pa_operation_unref(op);
 }
 
 static int stream_wait(pa_stream *stream, pa_threaded_mainloop *mainloop)
@@ -828,23 +858,30 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
 
     /* Stream parameters */
-    const pa_stream_flags_t flags = sys->flags_force
-                                  | PA_STREAM_START_CORKED
-                                  | PA_STREAM_INTERPOLATE_TIMING
-                                  | PA_STREAM_NOT_MONOTONIC
-                                  | PA_STREAM_AUTO_TIMING_UPDATE
-                                  | PA_STREAM_FIX_RATE;
+    pa_stream_flags_t flags = sys->flags_force
+                            | PA_STREAM_START_CORKED
+                            | PA_STREAM_INTERPOLATE_TIMING
+                            | PA_STREAM_NOT_MONOTONIC
+                            | PA_STREAM_AUTO_TIMING_UPDATE
+                            | PA_STREAM_FIX_RATE;
 
     struct pa_buffer_attr attr;
     attr.maxlength = -1;
     /* PulseAudio goes berserk if the target length (tlength) is not
      * significantly longer than 2 periods (minreq), or when the period length
      * is unspecified and the target length is short. */
-    attr.tlength = pa_usec_to_bytes(3 * AOUT_MIN_PREPARE_TIME, &ss);
+    attr.tlength = pa_usec_to_bytes(DEFAULT_LATENCY, &ss);
     attr.prebuf = 0; /* trigger manually */
     attr.minreq = pa_usec_to_bytes(AOUT_MIN_PREPARE_TIME, &ss);
     attr.fragsize = 0; /* not used for output */
 
+    if (sys->latency > 0) {
+        /* Let the server shrink the sink buffer to meet the target */
+        flags |= PA_STREAM_ADJUST_LATENCY;
+        attr.tlength = pa_usec_to_bytes(sys->latency, &ss);
+        attr.minreq = pa_usec_to_bytes(sys->latency / 4, &ss);
+    }
+
     sys->stream = NULL;
     sys->trigger = NULL;
     sys->first_pts = VLC_TS_INVALID;
@@ -922,6 +959,13 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
     free(sys->sink_force);
     sys->sink_force = NULL;
 
+    if (sys->latency > 0) {
+        const pa_buffer_attr *pba = pa_stream_get_buffer_attr(s);
+
+        msg_Dbg(aout, "target length %"PRIu64" us (requested %"PRId64" us)",
+                (uint64_t)pa_bytes_to_usec(pba->tlength, &ss), sys->latency);
+    }
+
     const struct pa_sample_spec *spec = pa_stream_get_sample_spec(s);
 #if PA_CHECK_VERSION(1,0,0)
     if (encoding != PA_ENCODING_INVALID) {
@@ -1006,6 +1050,7 @@ static int Open(vlc_object_t *obj)
     sys->flags_force = PA_STREAM_NOFLAGS;
     sys->sink_force = NULL;
     sys->sinks = NULL;
+    sys->latency = var_InheritInteger(aout, "pulse-latency") * 1000;
 
     aout->sys = sys;
     aout->start = Start;
@@ -0,0 +1,244 @@
+/*****************************************************************************
+ * i420_rgb_avx2.h: AVX2 YUV transformation assembly
+ *****************************************************************************
+ * Copyright (C) 1999-2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#if defined(CAN_COMPILE_AVX2)
+
+/* AVX2 assembly
+ *
+ * This is the SSE2 conversion on 32 pixels at a time. The 256 bits
+ * instructions work on two 128 bits lanes: the low one holds the pixels 0-15
+ * and the high one the pixels 16-31, so the results are put back in order
+ * with vperm2i128 before being stored. */
+
+#define AVX2_CALL(AVX2_INSTRUCTIONS)    \
+    do {                                \
+    __asm__ __volatile__(               \
+        ".p2align 3 \n\t"               \
+        AVX2_INSTRUCTIONS               \
+        :                               \
+        : "r" (p_y), "r" (p_u),         \
+          "r" (p_v), "r" (p_buffer)     \
+        : "eax", "xmm0", "xmm1", "xmm2", "xmm3", \
+                 "xmm4", "xmm5", "xmm6", "xmm7", "memory" ); \
+    } while(0)
+
+#define AVX2_END  __asm__ __volatile__ ( "vzeroupper" )
+
+#define AVX2_INIT "                                                         \n\
+vmovdqu     (%1), %%xmm0    # Load 16 Cb      u15 ... u1 u0                 \n\
+vmovdqu     (%2), %%xmm1    # Load 16 Cr      v15 ... v1 v0                 \n\
+vmovdqu     (%0), %%ymm6    # Load 32 Y       Y31 ... Y1 Y0                 \n\
+"
+
+#define AVX2_YUV_MUL "                                                      \n\
+# convert the chroma part                                                   \n\
+vpmovzxbw %%xmm0, %%ymm0        # scatter 16 Cb   00 u15 ... 00 u0          \n\
+vpmovzxbw %%xmm1, %%ymm1        # scatter 16 Cr   00 v15 ... 00 v0          \n\
+movl      $0x00800080, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # Set ymm5 to     0080 0080 ... 0080 0080   \n\
+vpsubsw   %%ymm5, %%ymm0, %%ymm0 # Cb -= 128                                \n\
+vpsubsw   %%ymm5, %%ymm1, %%ymm1 # Cr -= 128                                \n\
+vpsllw    $3, %%ymm0, %%ymm0    # Promote precision                         \n\
+vpsllw    $3, %%ymm1, %%ymm1    # Promote precision                         \n\
+movl      $0xf37df37d, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # Set ymm5 to     f37d f37d ... f37d f37d   \n\
+vpmulhw   %%ymm5, %%ymm0, %%ymm2 # Mul Cb with green coeff -> Cb green      \n\
+movl      $0xe5fce5fc, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # Set ymm5 to     e5fc e5fc ... e5fc e5fc   \n\
+vpmulhw   %%ymm5, %%ymm1, %%ymm3 # Mul Cr with green coeff -> Cr green      \n\
+movl      $0x40934093, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # Set ymm5 to     4093 4093 ... 4093 4093   \n\
+vpmulhw   %%ymm5, %%ymm0, %%ymm0 # Mul Cb -> Cblue                          \n\
+movl      $0x33123312, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # Set ymm5 to     3312 3312 ... 3312 3312   \n\
+vpmulhw   %%ymm5, %%ymm1, %%ymm1 # Mul Cr -> Cred                           \n\
+vpaddsw   %%ymm3, %%ymm2, %%ymm2 # Cb green + Cr green -> Cgreen            \n\
+                                                                            \n\
+# convert the luma part                                                     \n\
+movl      $0x10101010, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # Set ymm5 to     1010 1010 ... 1010 1010   \n\
+vpsubusb  %%ymm5, %%ymm6, %%ymm6 # Y -= 16                                  \n\
+vpsrlw    $8, %%ymm6, %%ymm7    # get Y odd       00 Y31 ... 00 Y3 00 Y1    \n\
+movl      $0x00ff00ff, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # set ymm5 to     00ff 00ff ... 00ff 00ff   \n\
+vpand     %%ymm5, %%ymm6, %%ymm6 # get Y even     00 Y30 ... 00 Y2 00 Y0    \n\
+vpsllw    $3, %%ymm6, %%ymm6    # Promote precision                         \n\
+vpsllw    $3, %%ymm7, %%ymm7    # Promote precision                         \n\
+movl      $0x253f253f, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # set ymm5 to     253f 253f ... 253f 253f   \n\
+vpmulhw   %%ymm5, %%ymm6, %%ymm6 # Mul 16 Y even                            \n\
+vpmulhw   %%ymm5, %%ymm7, %%ymm7 # Mul 16 Y odd                             \n\
+"
+
+#define AVX2_YUV_ADD "                                                      \n\
+# Do horizontal and vertical scaling                                        \n\
+vpaddsw   %%ymm7, %%ymm0, %%ymm3 # Y odd  + Cblue                           \n\
+vpaddsw   %%ymm6, %%ymm0, %%ymm0 # Y even + Cblue                           \n\
+vpaddsw   %%ymm7, %%ymm1, %%ymm4 # Y odd  + Cred                            \n\
+vpaddsw   %%ymm6, %%ymm1, %%ymm1 # Y even + Cred                            \n\
+vpaddsw   %%ymm7, %%ymm2, %%ymm5 # Y odd  + Cgreen                          \n\
+vpaddsw   %%ymm6, %%ymm2, %%ymm2 # Y even + Cgreen                          \n\
+                                                                            \n\
+# Limit RGB even to 0..255                                                  \n\
+vpackuswb %%ymm0, %%ymm0, %%ymm0 # B14 .. B0 B14 .. B0 / B30 .. B16 ...     \n\
+vpackuswb %%ymm1, %%ymm1, %%ymm1 # R14 .. R0 R14 .. R0 / R30 .. R16 ...     \n\
+vpackuswb %%ymm2, %%ymm2, %%ymm2 # G14 .. G0 G14 .. G0 / G30 .. G16 ...     \n\
+                                                                            \n\
+# Limit RGB odd to 0..255                                                   \n\
+vpackuswb %%ymm3, %%ymm3, %%ymm3 # B15 .. B1 B15 .. B1 / B31 .. B17 ...     \n\
+vpackuswb %%ymm4, %%ymm4, %%ymm4 # R15 .. R1 R15 .. R1 / R31 .. R17 ...     \n\
+vpackuswb %%ymm5, %%ymm5, %%ymm5 # G15 .. G1 G15 .. G1 / G31 .. G17 ...     \n\
+                                                                            \n\
+# Interleave RGB even and odd                                               \n\
+vpunpcklbw %%ymm3, %%ymm0, %%ymm0 #               B15 ... B0 / B31 ... B16  \n\
+vpunpcklbw %%ymm4, %%ymm1, %%ymm1 #               R15 ... R0 / R31 ... R16  \n\
+vpunpcklbw %%ymm5, %%ymm2, %%ymm2 #               G15 ... G0 / G31 ... G16  \n\
+"
+
+/* Stores the 8 pixels of each lane of ymm6 and ymm0 */
+#define AVX2_STORE_16 "                                                     \n\
+vperm2i128 $0x20, %%ymm0, %%ymm6, %%ymm7 #        pixels 0-15               \n\
+vmovdqu   %%ymm7, (%3)          # store pixels 0-15                         \n\
+vperm2i128 $0x31, %%ymm0, %%ymm6, %%ymm7 #        pixels 16-31              \n\
+vmovdqu   %%ymm7, 32(%3)        # store pixels 16-31                        \n\
+"
+
+#define AVX2_UNPACK_15 "                                                    \n\
+# mask unneeded bits off                                                    \n\
+movl      $0xf8f8f8f8, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # set ymm5 to     f8f8 f8f8 ... f8f8 f8f8   \n\
+vpand     %%ymm5, %%ymm0, %%ymm0 # b7b6b5b4 b3______ b7b6b5b4 b3______      \n\
+vpsrlw    $3, %%ymm0, %%ymm0    # ______b7 b6b5b4b3 ______b7 b6b5b4b3       \n\
+vpand     %%ymm5, %%ymm2, %%ymm2 # g7g6g5g4 g3______ g7g6g5g4 g3______      \n\
+vpand     %%ymm5, %%ymm1, %%ymm1 # r7r6r5r4 r3______ r7r6r5r4 r3______      \n\
+vpsrlw    $1, %%ymm1, %%ymm1    # __r7r6r5 r4r3____ __r7r6r5 r4r3____       \n\
+vpxor     %%ymm4, %%ymm4, %%ymm4 # zero ymm4                                \n\
+                                                                            \n\
+# convert rgb24 plane to rgb15 pack for pixels 0-7 and 16-23                \n\
+vpunpcklbw %%ymm4, %%ymm2, %%ymm5 # ________ ________ g7g6g5g4 g3______     \n\
+vpunpcklbw %%ymm1, %%ymm0, %%ymm6 # r7r6r5r4 r3______ ______b7 b6b5b4b3     \n\
+vpsllw    $2, %%ymm5, %%ymm5    # ________ ____g7g6 g5g4g3__ ________       \n\
+vpor      %%ymm5, %%ymm6, %%ymm6 # r7r6r5r4 r3__g7g6 g5g4g3b7 b6b5b4b3      \n\
+                                                                            \n\
+# convert rgb24 plane to rgb15 pack for pixels 8-15 and 24-31               \n\
+vpunpckhbw %%ymm4, %%ymm2, %%ymm2 # ________ ________ g7g6g5g4 g3______     \n\
+vpunpckhbw %%ymm1, %%ymm0, %%ymm0 # r7r6r5r4 r3______ ______b7 b6b5b4b3     \n\
+vpsllw    $2, %%ymm2, %%ymm2    # ________ ____g7g6 g5g4g3__ ________       \n\
+vpor      %%ymm2, %%ymm0, %%ymm0 # r7r6r5r4 r3__g7g6 g5g4g3b7 b6b5b4b3      \n\
+" AVX2_STORE_16
+
+#define AVX2_UNPACK_16 "                                                    \n\
+# mask unneeded bits off                                                    \n\
+movl      $0xf8f8f8f8, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # set ymm5 to     f8f8 f8f8 ... f8f8 f8f8   \n\
+vpand     %%ymm5, %%ymm0, %%ymm0 # b7b6b5b4 b3______ b7b6b5b4 b3______      \n\
+vpand     %%ymm5, %%ymm1, %%ymm1 # r7r6r5r4 r3______ r7r6r5r4 r3______      \n\
+movl      $0xfcfcfcfc, %%eax    #                                           \n\
+vmovd     %%eax, %%xmm5         #                                           \n\
+vpbroadcastd %%xmm5, %%ymm5     # set ymm5 to     fcfc fcfc ... fcfc fcfc   \n\
+vpand     %%ymm5, %%ymm2, %%ymm2 # g7g6g5g4 g3g2____ g7g6g5g4 g3g2____      \n\
+vpsrlw    $3, %%ymm0, %%ymm0    # ______b7 b6b5b4b3 ______b7 b6b5b4b3       \n\
+vpxor     %%ymm4, %%ymm4, %%ymm4 # zero ymm4                                \n\
+                                                                            \n\
+# convert rgb24 plane to rgb16 pack for pixels 0-7 and 16-23                \n\
+vpunpcklbw %%ymm4, %%ymm2, %%ymm5 # ________ ________ g7g6g5g4 g3g2____     \n\
+vpunpcklbw %%ymm1, %%ymm0, %%ymm6 # r7r6r5r4 r3______ ______b7 b6b5b4b3     \n\
+vpsllw    $3, %%ymm5, %%ymm5    # ________ __g7g6g5 g4g3g2__ ________       \n\
+vpor      %%ymm5, %%ymm6, %%ymm6 # r7r6r5r4 r3g7g6g5 g4g3g2b7 b6b5b4b3      \n\
+                                                                            \n\
+# convert rgb24 plane to rgb16 pack for pixels 8-15 and 24-31               \n\
+vpunpckhbw %%ymm4, %%ymm2, %%ymm2 # ________ ________ g7g6g5g4 g3g2____     \n\
+vpunpckhbw %%ymm1, %%ymm0, %%ymm0 # r7r6r5r4 r3______ ______b7 b6b5b4b3     \n\
+vpsllw    $3, %%ymm2, %%ymm2    # ________ __g7g6g5 g4g3g2__ ________       \n\
+vpor      %%ymm2, %%ymm0, %%ymm0 # r7r6r5r4 r3g7g6g5 g4g3g2b7 b6b5b4b3      \n\
+" AVX2_STORE_16
+
+/* Stores the 4 pixels of each lane of ymm0 to ymm3: ymm0 holds the pixels
+ * 0-3 and 16-19, ymm1 4-7 and 20-23, ymm2 8-11 and 24-27, ymm3 12-15 and
+ * 28-31 */
+#define AVX2_STORE_32 "                                                     \n\
+vperm2i128 $0x20, %%ymm1, %%ymm0, %%ymm7 #        pixels 0-7                \n\
+vmovdqu   %%ymm7, (%3)          # store pixels 0-7                          \n\
+vperm2i128 $0x20, %%ymm3, %%ymm2, %%ymm7 #        pixels 8-15               \n\
+vmovdqu   %%ymm7, 32(%3)        # store pixels 8-15                         \n\
+vperm2i128 $0x31, %%ymm1, %%ymm0, %%ymm7 #        pixels 16-23              \n\
+vmovdqu   %%ymm7, 64(%3)        # store pixels 16-23                        \n\
+vperm2i128 $0x31, %%ymm3, %%ymm2, %%ymm7 #        pixels 24-31              \n\
+vmovdqu   %%ymm7, 96(%3)        # store pixels 24-31                        \n\
+"
+
+#define AVX2_UNPACK_32_ARGB "                                               \n\
+vpxor      %%ymm7, %%ymm7, %%ymm7 # zero ymm7                               \n\
+vpunpcklbw %%ymm2, %%ymm0, %%ymm3 #               G7 B7 ... G0 B0           \n\
+vpunpckhbw %%ymm2, %%ymm0, %%ymm4 #               G15 B15 ... G8 B8         \n\
+vpunpcklbw %%ymm7, %%ymm1, %%ymm5 #               00 R7 ... 00 R0           \n\
+vpunpckhbw %%ymm7, %%ymm1, %%ymm6 #               00 R15 ... 00 R8          \n\
+vpunpcklwd %%ymm5, %%ymm3, %%ymm0 #               ARGB3 ... ARGB0           \n\
+vpunpckhwd %%ymm5, %%ymm3, %%ymm1 #               ARGB7 ... ARGB4           \n\
+vpunpcklwd %%ymm6, %%ymm4, %%ymm2 #               ARGB11 ... ARGB8          \n\
+vpunpckhwd %%ymm6, %%ymm4, %%ymm3 #               ARGB15 ... ARGB12         \n\
+" AVX2_STORE_32
+
+#define AVX2_UNPACK_32_RGBA "                                               \n\
+vpxor      %%ymm7, %%ymm7, %%ymm7 # zero ymm7                               \n\
+vpunpcklbw %%ymm0, %%ymm7, %%ymm3 #               B7 00 ... B0 00           \n\
+vpunpckhbw %%ymm0, %%ymm7, %%ymm4 #               B15 00 ... B8 00          \n\
+vpunpcklbw %%ymm1, %%ymm2, %%ymm5 #               R7 G7 ... R0 G0           \n\
+vpunpckhbw %%ymm1, %%ymm2, %%ymm6 #               R15 G15 ... R8 G8         \n\
+vpunpcklwd %%ymm5, %%ymm3, %%ymm0 #               RGBA3 ... RGBA0           \n\
+vpunpckhwd %%ymm5, %%ymm3, %%ymm1 #               RGBA7 ... RGBA4           \n\
+vpunpcklwd %%ymm6, %%ymm4, %%ymm2 #               RGBA11 ... RGBA8          \n\
+vpunpckhwd %%ymm6, %%ymm4, %%ymm3 #               RGBA15 ... RGBA12         \n\
+" AVX2_STORE_32
+
+#define AVX2_UNPACK_32_BGRA "                                               \n\
+vpxor      %%ymm7, %%ymm7, %%ymm7 # zero ymm7                               \n\
+vpunpcklbw %%ymm1, %%ymm7, %%ymm3 #               R7 00 ... R0 00           \n\
+vpunpckhbw %%ymm1, %%ymm7, %%ymm4 #               R15 00 ... R8 00          \n\
+vpunpcklbw %%ymm0, %%ymm2, %%ymm5 #               B7 G7 ... B0 G0           \n\
+vpunpckhbw %%ymm0, %%ymm2, %%ymm6 #               B15 G15 ... B8 G8         \n\
+vpunpcklwd %%ymm5, %%ymm3, %%ymm0 #               BGRA3 ... BGRA0           \n\
+vpunpckhwd %%ymm5, %%ymm3, %%ymm1 #               BGRA7 ... BGRA4           \n\
+vpunpcklwd %%ymm6, %%ymm4, %%ymm2 #               BGRA11 ... BGRA8          \n\
+vpunpckhwd %%ymm6, %%ymm4, %%ymm3 #               BGRA15 ... BGRA12         \n\
+" AVX2_STORE_32
+
+#define AVX2_UNPACK_32_ABGR "                                               \n\
+vpxor      %%ymm7, %%ymm7, %%ymm7 # zero ymm7                               \n\
+vpunpcklbw %%ymm2, %%ymm1, %%ymm3 #               G7 R7 ... G0 R0           \n\
+vpunpckhbw %%ymm2, %%ymm1, %%ymm4 #               G15 R15 ... G8 R8         \n\
+vpunpcklbw %%ymm7, %%ymm0, %%ymm5 #               00 B7 ... 00 B0           \n\
+vpunpckhbw %%ymm7, %%ymm0, %%ymm6 #               00 B15 ... 00 B8          \n\
+vpunpcklwd %%ymm5, %%ymm3, %%ymm0 #               ABGR3 ... ABGR0           \n\
+vpunpckhwd %%ymm5, %%ymm3, %%ymm1 #               ABGR7 ... ABGR4           \n\
+vpunpcklwd %%ymm6, %%ymm4, %%ymm2 #               ABGR11 ... ABGR8          \n\
+vpunpckhwd %%ymm6, %%ymm4, %%ymm3 #               ABGR15 ... ABGR12         \n\
+" AVX2_STORE_32
+
+#endif
@@ -67,6 +67,12 @@ static const int  nloopf_list[] = { 0, 1, 2, 3, 4 };
 static const char *const nloopf_list_text[] =
   { N_("None"), N_("Non-ref"), N_("Bidir"), N_("Non-key"), N_("All") };
 
+#if defined(FF_THREAD_FRAME)
+static const int  thread_type_list[] = { 0, 1, 2 };
+static const char *const thread_type_list_text[] =
+  { N_("Automatic"), N_("Frame"), N_("Slice") };
+#endif
+
 #ifdef ENABLE_SOUT
 static const char *const enc_hq_list[] = { "rd", "bits", "simple" };
 static const char *const enc_hq_list_text[] = {
@@ -140,9 +146,15 @@ vlc_module_begin ()
     add_string( "avcodec-codec", NULL, CODEC_TEXT, CODEC_LONGTEXT, true )
     add_obsolete_bool( "ffmpeg-hw" ) /* removed since 2.1.0 */
     add_module( "avcodec-hw", "hw decoder", "none", HW_TEXT, HW_LONGTEXT, false )
+    add_integer( "avcodec-copy-threads", 0, COPY_THREADS_TEXT,
+                 COPY_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 16 )
 #if defined(FF_THREAD_FRAME)
     add_obsolete_integer( "ffmpeg-threads" ) /* removed since 2.1.0 */
     add_integer( "avcodec-threads", 0, THREADS_TEXT, THREADS_LONGTEXT, true );
+    add_integer( "avcodec-thread-type", 0, THREAD_TYPE_TEXT,
+                 THREAD_TYPE_LONGTEXT, true )
+        change_integer_list( thread_type_list, thread_type_list_text )
 #endif
 
 
@@ -204,6 +216,9 @@ vlc_module_begin ()
               ENC_PRE_ME_LONGTEXT, true )
     add_integer( ENC_CFG_PREFIX "rc-buffer-size", 0,
                  ENC_RC_BUF_TEXT, ENC_RC_BUF_LONGTEXT, true )
+    add_integer( ENC_CFG_PREFIX "latency", 0,
+                 ENC_LATENCY_TEXT, ENC_LATENCY_LONGTEXT, true )
+        change_integer_range( 0, 10000 )
     add_float( ENC_CFG_PREFIX "rc-buffer-aggressivity", 1.0,
                ENC_RC_BUF_AGGR_TEXT, ENC_RC_BUF_AGGR_LONGTEXT, true )
     add_float( ENC_CFG_PREFIX "i-quant-factor", 0,
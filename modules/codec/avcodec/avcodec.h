@@ -144,6 +144,17 @@ int ffmpeg_OpenCodec( decoder_t *p_dec );
 #define THREADS_TEXT N_( "Threads" )
 #define THREADS_LONGTEXT N_( "Number of threads used for decoding, 0 meaning auto" )
 
+#define COPY_THREADS_TEXT N_( "Hardware surface copy threads" )
+#define COPY_THREADS_LONGTEXT N_( "Number of threads a copy of a decoded " \
+    "hardware surface can be split across, 0 meaning auto" )
+
+#define THREAD_TYPE_TEXT N_( "Threading type" )
+#define THREAD_TYPE_LONGTEXT N_( "Frame threading decodes several pictures " \
+    "at once and scales best, but delays the output by one picture per " \
+    "thread. Slice threading decodes the slices of a picture in parallel " \
+    "without delay. Automatic allows both, unless a low latency clock is " \
+    "used." )
+
 /*
  * Encoder options
  */
@@ -177,6 +188,12 @@ int ffmpeg_OpenCodec( decoder_t *p_dec );
   "buffer size (in kbytes). A bigger buffer will allow for better rate " \
   "control, but will cause a delay in the stream." )
 
+#define ENC_LATENCY_TEXT N_( "Latency target" )
+#define ENC_LATENCY_LONGTEXT N_( "Maximum delay (in milliseconds) " \
+  "introduced by the encoder and its rate control buffer. Slice threads " \
+  "are used, and the B-frames and buffer are sized to fit. 0 disables " \
+  "this mode." )
+
 #define ENC_RC_BUF_AGGR_TEXT N_( "Rate control buffer aggressiveness" )
 #define ENC_RC_BUF_AGGR_LONGTEXT N_( "Rate control "\
   "buffer aggressiveness." )
@@ -32,30 +32,6 @@
 
 #include "copy.h"
 
-int CopyInitCache(copy_cache_t *cache, unsigned width)
-{
-#ifdef CAN_COMPILE_SSE2
-    cache->size = __MAX((width + 0x0f) & ~ 0x0f, 4096);
-    cache->buffer = vlc_memalign(16, cache->size);
-    if (!cache->buffer)
-        return VLC_EGENERIC;
-#else
-    (void) cache; (void) width;
-#endif
-    return VLC_SUCCESS;
-}
-
-void CopyCleanCache(copy_cache_t *cache)
-{
-#ifdef CAN_COMPILE_SSE2
-    vlc_free(cache->buffer);
-    cache->buffer = NULL;
-    cache->size   = 0;
-#else
-    (void) cache;
-#endif
-}
-
 #ifdef CAN_COMPILE_SSE2
 /* Copy 64 bytes from srcp to dstp loading data with the SSE>=2 instruction
  * load and storing data with the SSE>=2 instruction store.
@@ -72,6 +48,28 @@ void CopyCleanCache(copy_cache_t *cache)
         store " %%xmm4,   48(%[dst])\n" \
         : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1", "xmm2", "xmm3", "xmm4")
 
+#ifdef CAN_COMPILE_AVX2
+/* Copy 128 bytes from srcp to dstp loading data with the AVX2 instruction
+ * load and storing data with the AVX instruction store.
+ */
+#define COPY128(dstp, srcp, load, store) \
+    asm volatile (                      \
+        load "  0(%[src]), %%ymm1\n"    \
+        load " 32(%[src]), %%ymm2\n"    \
+        load " 64(%[src]), %%ymm3\n"    \
+        load " 96(%[src]), %%ymm4\n"    \
+        store " %%ymm1,    0(%[dst])\n" \
+        store " %%ymm2,   32(%[dst])\n" \
+        store " %%ymm3,   64(%[dst])\n" \
+        store " %%ymm4,   96(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1", "xmm2", "xmm3", "xmm4")
+#endif
+
+#ifndef __AVX2__
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() ((cpu & VLC_CPU_AVX2) != 0)
+#endif
+
 #ifndef __SSE4_1__
 # undef vlc_CPU_SSE4_1
 # define vlc_CPU_SSE4_1() ((cpu & VLC_CPU_SSE4_1) != 0)
@@ -89,7 +87,7 @@ void CopyCleanCache(copy_cache_t *cache)
 
 /* Optimized copy from "Uncacheable Speculative Write Combining" memory
  * as used by some video surface.
- * XXX It is really efficient only when SSE4.1 is available.
+ * XXX It is really efficient only when SSE4.1 (or AVX2) is available.
  */
 VLC_SSE
 static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
@@ -102,12 +100,25 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
     asm volatile ("mfence");
 
     for (unsigned y = 0; y < height; y++) {
-        const unsigned unaligned = (-(uintptr_t)src) & 0x0f;
+        unsigned unaligned = (-(uintptr_t)src) & 0x0f;
         unsigned x = 0;
 
+#ifdef CAN_COMPILE_AVX2
+        /* 256 bits streaming loads need 32 bytes aligned addresses */
+        if (vlc_CPU_AVX2())
+            unaligned = (-(uintptr_t)src) & 0x1f;
+#endif
+        unaligned = __MIN(unaligned, width);
+
         for (; x < unaligned; x++)
             dst[x] = src[x];
 
+#ifdef CAN_COMPILE_AVX2
+        if (vlc_CPU_AVX2()) {
+            for (; x+127 < width; x += 128)
+                COPY128(&dst[x], &src[x], "vmovntdqa", "vmovdqu");
+        }
+#endif
 #ifdef CAN_COMPILE_SSE4_1
         if (vlc_CPU_SSE4_1()) {
             if (!unaligned) {
@@ -135,6 +146,10 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
         src += src_pitch;
         dst += dst_pitch;
     }
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        asm volatile ("vzeroupper");
+#endif
 }
 
 VLC_SSE
@@ -311,37 +326,7 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
     asm volatile ("mfence");
 }
 
-static void SSE_CopyFromNv12(picture_t *dst,
-                             uint8_t *src[2], size_t src_pitch[2],
-                             unsigned width, unsigned height,
-                             copy_cache_t *cache, unsigned cpu)
-{
-    SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
-                  src[0], src_pitch[0],
-                  cache->buffer, cache->size,
-                  width, height, cpu);
-    SSE_SplitPlanes(dst->p[2].p_pixels, dst->p[2].i_pitch,
-                    dst->p[1].p_pixels, dst->p[1].i_pitch,
-                    src[1], src_pitch[1],
-                    cache->buffer, cache->size,
-                    width/2, height/2, cpu);
-    asm volatile ("emms");
-}
-
-static void SSE_CopyFromYv12(picture_t *dst,
-                             uint8_t *src[3], size_t src_pitch[3],
-                             unsigned width, unsigned height,
-                             copy_cache_t *cache, unsigned cpu)
-{
-    for (unsigned n = 0; n < 3; n++) {
-        const unsigned d = n > 0 ? 2 : 1;
-        SSE_CopyPlane(dst->p[n].p_pixels, dst->p[n].i_pitch,
-                      src[n], src_pitch[n],
-                      cache->buffer, cache->size,
-                      width/d, height/d, cpu);
-    }
-    asm volatile ("emms");
-}
+#undef COPY128
 #undef COPY64
 #endif /* CAN_COMPILE_SSE2 */
 
@@ -356,13 +341,29 @@ static void CopyPlane(uint8_t *dst, size_t dst_pitch,
     }
 }
 
+#ifdef CAN_COMPILE_ARM
+/* count is a positive multiple of 16 */
+void split_uv_arm_neon(uint8_t *dstu, uint8_t *dstv, const uint8_t *src,
+                       unsigned count);
+#endif
+
 static void SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
                         uint8_t *dstv, size_t dstv_pitch,
                         const uint8_t *src, size_t src_pitch,
                         unsigned width, unsigned height)
 {
+    unsigned simd_width = 0;
+#ifdef CAN_COMPILE_ARM
+    if (vlc_CPU_ARM_NEON())
+        simd_width = width & ~15;
+#endif
+
     for (unsigned y = 0; y < height; y++) {
-        for (unsigned x = 0; x < width; x++) {
+#ifdef CAN_COMPILE_ARM
+        if (simd_width > 0)
+            split_uv_arm_neon(dstu, dstv, src, simd_width);
+#endif
+        for (unsigned x = simd_width; x < width; x++) {
             dstu[x] = src[2*x+0];
             dstv[x] = src[2*x+1];
         }
@@ -372,45 +373,298 @@ static void SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
     }
 }
 
-void CopyFromNv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
-                  unsigned width, unsigned height,
-                  copy_cache_t *cache)
+/* A copy split by stripes of rows */
+typedef struct {
+    picture_t *dst;
+    uint8_t   **src;
+    size_t    *src_pitch;
+    unsigned  width;
+    unsigned  height;
+    bool      nv12;
+    const copy_method_t *method;
+} copy_job_t;
+
+typedef struct {
+    copy_pool_t  *pool;
+    vlc_thread_t thread;
+    vlc_sem_t    start;
+    unsigned     index;
+    uint8_t      *buffer;
+} copy_worker_t;
+
+struct copy_pool_t {
+    const copy_job_t *job; /* NULL to stop the workers */
+    vlc_sem_t        done;
+    size_t           size;
+    unsigned         count;
+    copy_worker_t    worker[];
+};
+
+/* Number of pictures copied with each method before choosing one */
+#define COPY_PROBE_PICTURES 8
+
+/* Rows [*y, *y + *h) of a plane of height rows belong to the stripe index */
+static void GetStripe(unsigned height, unsigned index, unsigned stripes,
+                      unsigned *y, unsigned *h)
+{
+    *y = height * index / stripes;
+    *h = height * (index + 1) / stripes - *y;
+}
+
+static void CopyStripe(const copy_job_t *job, unsigned index,
+                       uint8_t *buffer, size_t size)
 {
+    picture_t *dst = job->dst;
+    const unsigned stripes = job->method->stripes;
+    unsigned y, h;
 #ifdef CAN_COMPILE_SSE2
-    unsigned cpu = vlc_CPU();
-    if (vlc_CPU_SSE2())
-        return SSE_CopyFromNv12(dst, src, src_pitch, width, height,
-                                cache, cpu);
+    const unsigned cpu = job->method->cpu;
+    const bool sse = vlc_CPU_SSE2();
 #else
-    (void) cache;
+    (void) buffer; (void) size;
+#endif
+
+    if (job->nv12) {
+        GetStripe(job->height, index, stripes, &y, &h);
+        uint8_t *dsty = &dst->p[0].p_pixels[y * dst->p[0].i_pitch];
+        const uint8_t *srcy = &job->src[0][y * job->src_pitch[0]];
+#ifdef CAN_COMPILE_SSE2
+        if (sse)
+            SSE_CopyPlane(dsty, dst->p[0].i_pitch, srcy, job->src_pitch[0],
+                          buffer, size, job->width, h, cpu);
+        else
 #endif
+            CopyPlane(dsty, dst->p[0].i_pitch, srcy, job->src_pitch[0],
+                      job->width, h);
 
-    CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
-              src[0], src_pitch[0],
-              width, height);
-    SplitPlanes(dst->p[2].p_pixels, dst->p[2].i_pitch,
-                dst->p[1].p_pixels, dst->p[1].i_pitch,
-                src[1], src_pitch[1],
-                width/2, height/2);
+        GetStripe(job->height / 2, index, stripes, &y, &h);
+        uint8_t *dstu = &dst->p[2].p_pixels[y * dst->p[2].i_pitch];
+        uint8_t *dstv = &dst->p[1].p_pixels[y * dst->p[1].i_pitch];
+        const uint8_t *srcuv = &job->src[1][y * job->src_pitch[1]];
+#ifdef CAN_COMPILE_SSE2
+        if (sse)
+            SSE_SplitPlanes(dstu, dst->p[2].i_pitch, dstv, dst->p[1].i_pitch,
+                            srcuv, job->src_pitch[1], buffer, size,
+                            job->width / 2, h, cpu);
+        else
+#endif
+            SplitPlanes(dstu, dst->p[2].i_pitch, dstv, dst->p[1].i_pitch,
+                        srcuv, job->src_pitch[1], job->width / 2, h);
+    } else {
+        for (unsigned n = 0; n < 3; n++) {
+            const unsigned d = n > 0 ? 2 : 1;
+
+            GetStripe(job->height / d, index, stripes, &y, &h);
+            uint8_t *dstp = &dst->p[n].p_pixels[y * dst->p[n].i_pitch];
+            const uint8_t *srcp = &job->src[n][y * job->src_pitch[n]];
+#ifdef CAN_COMPILE_SSE2
+            if (sse)
+                SSE_CopyPlane(dstp, dst->p[n].i_pitch, srcp, job->src_pitch[n],
+                              buffer, size, job->width / d, h, cpu);
+            else
+#endif
+                CopyPlane(dstp, dst->p[n].i_pitch, srcp, job->src_pitch[n],
+                          job->width / d, h);
+        }
+    }
+#ifdef CAN_COMPILE_SSE2
+    if (sse)
+        asm volatile ("emms");
+#endif
 }
 
-void CopyFromYv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
-                  unsigned width, unsigned height,
-                  copy_cache_t *cache)
+static void *CopyWorker(void *data)
+{
+    copy_worker_t *worker = data;
+    copy_pool_t *pool = worker->pool;
+
+    for (;;) {
+        vlc_sem_wait(&worker->start);
+
+        const copy_job_t *job = pool->job;
+        if (job == NULL)
+            break;
+        CopyStripe(job, worker->index, worker->buffer, pool->size);
+        vlc_sem_post(&pool->done);
+    }
+    return NULL;
+}
+
+static void CopyPoolDelete(copy_pool_t *pool)
+{
+    pool->job = NULL;
+    for (unsigned i = 0; i < pool->count; i++)
+        vlc_sem_post(&pool->worker[i].start);
+
+    for (unsigned i = 0; i < pool->count; i++) {
+        copy_worker_t *worker = &pool->worker[i];
+
+        vlc_join(worker->thread, NULL);
+        vlc_sem_destroy(&worker->start);
+        vlc_free(worker->buffer);
+    }
+    vlc_sem_destroy(&pool->done);
+    free(pool);
+}
+
+static copy_pool_t *CopyPoolNew(unsigned count, size_t size)
+{
+    copy_pool_t *pool = malloc(sizeof(*pool) + count * sizeof(pool->worker[0]));
+    if (!pool)
+        return NULL;
+
+    pool->job   = NULL;
+    pool->size  = size;
+    pool->count = 0;
+    vlc_sem_init(&pool->done, 0);
+
+    for (unsigned i = 0; i < count; i++) {
+        copy_worker_t *worker = &pool->worker[i];
+
+        worker->pool  = pool;
+        worker->index = i + 1;
+#ifdef CAN_COMPILE_SSE2
+        worker->buffer = vlc_memalign(16, size);
+        if (!worker->buffer)
+            break;
+#else
+        worker->buffer = NULL;
+#endif
+        vlc_sem_init(&worker->start, 0);
+        if (vlc_clone(&worker->thread, CopyWorker, worker,
+                      VLC_THREAD_PRIORITY_VIDEO)) {
+            vlc_sem_destroy(&worker->start);
+            vlc_free(worker->buffer);
+            break;
+        }
+        pool->count++;
+    }
+
+    if (pool->count == 0) {
+        CopyPoolDelete(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+static void AddMethod(copy_cache_t *cache, unsigned cpu, unsigned stripes)
+{
+    assert(cache->method_count < COPY_METHOD_MAX);
+
+    copy_method_t *method = &cache->method[cache->method_count++];
+    method->cpu      = cpu;
+    method->stripes  = stripes;
+    method->duration = 0;
+}
+
+int CopyInitCache(copy_cache_t *cache, unsigned width, unsigned threads)
+{
+    size_t size = 0;
+#ifdef CAN_COMPILE_SSE2
+    cache->size = size = __MAX((width + 0x0f) & ~ 0x0f, 4096);
+    cache->buffer = vlc_memalign(16, cache->size);
+    if (!cache->buffer)
+        return VLC_EGENERIC;
+#endif
+
+    /* Reading from video memory is limited by the latency of each core
+     * more than by the bus, splitting pays off for large pictures */
+    if (threads == 0)
+        threads = width >= 1920 ? __MIN(vlc_GetCPUCount(), 4) : 1;
+    threads = __MIN(threads, 16);
+
+    cache->pool = NULL;
+    if (threads > 1)
+        cache->pool = CopyPoolNew(threads - 1, size);
+    const unsigned stripes = cache->pool ? cache->pool->count + 1 : 1;
+
+    const unsigned cpu = vlc_CPU();
+    cache->method_count = 0;
+    AddMethod(cache, cpu, 1);
+    if (stripes > 1)
+        AddMethod(cache, cpu, stripes);
+#if defined(CAN_COMPILE_AVX2) && !defined(__AVX2__)
+    /* The wider loads are not always faster from video memory */
+    if (cpu & VLC_CPU_AVX2) {
+        AddMethod(cache, cpu & ~VLC_CPU_AVX2, 1);
+        if (stripes > 1)
+            AddMethod(cache, cpu & ~VLC_CPU_AVX2, stripes);
+    }
+#endif
+    cache->method_used = 0;
+    cache->probed      = 0;
+    return VLC_SUCCESS;
+}
+
+void CopyCleanCache(copy_cache_t *cache)
+{
+    if (cache->pool)
+        CopyPoolDelete(cache->pool);
+    cache->pool = NULL;
+#ifdef CAN_COMPILE_SSE2
+    vlc_free(cache->buffer);
+    cache->buffer = NULL;
+    cache->size   = 0;
+#endif
+}
+
+static void Copy(copy_cache_t *cache, copy_job_t *job)
 {
+    const unsigned probes = cache->method_count * COPY_PROBE_PICTURES;
+    const bool probing = cache->method_count > 1 && cache->probed < probes;
+    copy_method_t *method = &cache->method[cache->method_used];
+    mtime_t start = 0;
+
+    if (probing) {
+        method = &cache->method[cache->probed % cache->method_count];
+        start = mdate();
+    }
+    job->method = method;
+
+    /* The calling thread copies the first stripe */
+    copy_pool_t *pool = cache->pool;
+    if (method->stripes > 1) {
+        pool->job = job;
+        for (unsigned i = 1; i < method->stripes; i++)
+            vlc_sem_post(&pool->worker[i - 1].start);
+    }
 #ifdef CAN_COMPILE_SSE2
-    unsigned cpu = vlc_CPU();
-    if (vlc_CPU_SSE2())
-        return SSE_CopyFromYv12(dst, src, src_pitch, width, height,
-                                cache, cpu);
+    CopyStripe(job, 0, cache->buffer, cache->size);
 #else
-    (void) cache;
+    CopyStripe(job, 0, NULL, 0);
 #endif
+    for (unsigned i = 1; i < method->stripes; i++)
+        vlc_sem_wait(&pool->done);
+
+    if (probing) {
+        method->duration += mdate() - start;
+        if (++cache->probed == probes) {
+            for (unsigned i = 1; i < cache->method_count; i++)
+                if (cache->method[i].duration <
+                    cache->method[cache->method_used].duration)
+                    cache->method_used = i;
+        }
+    }
+}
+
+void CopyFromNv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
+                  unsigned width, unsigned height,
+                  copy_cache_t *cache)
+{
+    copy_job_t job = {
+        .dst = dst, .src = src, .src_pitch = src_pitch,
+        .width = width, .height = height, .nv12 = true,
+    };
+    Copy(cache, &job);
+}
 
-     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
-               src[0], src_pitch[0], width, height);
-     CopyPlane(dst->p[1].p_pixels, dst->p[1].i_pitch,
-               src[1], src_pitch[1], width / 2, height / 2);
-     CopyPlane(dst->p[2].p_pixels, dst->p[2].i_pitch,
-               src[1], src_pitch[2], width / 2, height / 2);
+void CopyFromYv12(picture_t *dst, uint8_t *src[3], size_t src_pitch[3],
+                  unsigned width, unsigned height,
+                  copy_cache_t *cache)
+{
+    copy_job_t job = {
+        .dst = dst, .src = src, .src_pitch = src_pitch,
+        .width = width, .height = height, .nv12 = false,
+    };
+    Copy(cache, &job);
 }
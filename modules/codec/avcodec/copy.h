@@ -24,14 +24,35 @@
 #ifndef _VLC_AVCODEC_COPY_H
 #define _VLC_AVCODEC_COPY_H 1
 
+typedef struct copy_pool_t copy_pool_t;
+
+/* A way to copy a picture: instruction set and number of stripes */
+typedef struct {
+    unsigned cpu;
+    unsigned stripes;
+    mtime_t  duration;
+} copy_method_t;
+
+#define COPY_METHOD_MAX 4
+
 typedef struct {
 # ifdef CAN_COMPILE_SSE2
     uint8_t *buffer;
     size_t  size;
 # endif
+    copy_pool_t *pool; /* stripe workers, NULL if copies are not split */
+
+    /* The first pictures are copied in turn with each method and the
+     * fastest one is used for the others */
+    copy_method_t method[COPY_METHOD_MAX];
+    unsigned      method_count;
+    unsigned      method_used;
+    unsigned      probed;
 } copy_cache_t;
 
-int  CopyInitCache(copy_cache_t *cache, unsigned width);
+/* threads is the number of threads (the calling one included) a copy may
+ * be split across, 0 to choose it from the width and the CPU count */
+int  CopyInitCache(copy_cache_t *cache, unsigned width, unsigned threads);
 void CopyCleanCache(copy_cache_t *cache);
 
 void CopyFromNv12(picture_t *dst, uint8_t *src[2], size_t src_pitch[2],
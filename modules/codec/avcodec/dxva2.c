@@ -41,6 +41,8 @@
 #include <vlc_fourcc.h>
 #include <vlc_cpu.h>
 #include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_atomic.h>
 
 #include <libavcodec/avcodec.h>
 #    define DXVA2API_USE_BITFIELDS
@@ -53,6 +55,14 @@
 
 static int Open(vlc_va_t *, int, const es_format_t *);
 static void Close(vlc_va_t *);
+static int  OpenChroma(vlc_object_t *);
+static void CloseChroma(vlc_object_t *);
+
+#define OPAQUE_TEXT N_("Keep decoded pictures in video memory")
+#define OPAQUE_LONGTEXT N_(\
+    "The decoded surfaces are handed to the video output instead of being "\
+    "copied to system memory. The Direct3D video output draws them directly, "\
+    "they are only copied for the outputs and filters that need the pixels.")
 
 vlc_module_begin()
     set_description(N_("DirectX Video Acceleration (DXVA) 2.0"))
@@ -60,6 +70,12 @@ vlc_module_begin()
     set_category(CAT_INPUT)
     set_subcategory(SUBCAT_INPUT_VCODEC)
     set_callbacks(Open, Close)
+    add_bool("dxva2-opaque", false, OPAQUE_TEXT, OPAQUE_LONGTEXT, true)
+
+    add_submodule()
+    set_description(N_("DXVA2 surfaces conversions"))
+    set_capability("video filter2", 10)
+    set_callbacks(OpenChroma, CloseChroma)
 vlc_module_end()
 
 #include <windows.h>
@@ -68,6 +84,8 @@ vlc_module_end()
 #include <commctrl.h>
 #include <shlwapi.h>
 #include <d3d9.h>
+
+#include "../../video_output/msw/d3d9_picture.h"
 #include <dxva2api.h>
 
 #include <initguid.h> /* must be last included to not redefine existing GUIDs */
@@ -240,6 +258,10 @@ typedef struct {
 #define VA_DXVA2_MAX_SURFACE_COUNT (64)
 struct vlc_va_sys_t
 {
+    /* Held by the decoder and by the pictures still using its surfaces */
+    vlc_atomic_t refs;
+    vlc_mutex_t  lock;
+
     vlc_object_t *log;
     int          codec_id;
     int          width;
@@ -272,6 +294,14 @@ struct vlc_va_sys_t
     /* Option conversion */
     D3DFORMAT                    output;
     copy_cache_t                 surface_cache;
+    unsigned                     copy_threads;
+
+    /* Opaque pictures, drawn into shared render targets (Direct3D9Ex) */
+    bool                         opaque;
+    LPDIRECT3DSURFACE9           target[2];
+    HANDLE                       target_shared[2];
+    unsigned                     target_index;
+    IDirect3DQuery9              *target_query;
 
     /* */
     struct dxva_context hw;
@@ -279,6 +309,7 @@ struct vlc_va_sys_t
     /* */
     unsigned     surface_count;
     unsigned     surface_order;
+    unsigned     surface_generation;
     int          surface_width;
     int          surface_height;
     vlc_fourcc_t surface_chroma;
@@ -316,6 +347,36 @@ static int DxResetVideoDecoder(vlc_va_dxva2_t *);
 static void DxCreateVideoConversion(vlc_va_dxva2_t *);
 static void DxDestroyVideoConversion(vlc_va_dxva2_t *);
 
+static int DxCreateVideoTargets(vlc_va_dxva2_t *);
+static void DxDestroyVideoTargets(vlc_va_dxva2_t *);
+
+static void Destroy(vlc_va_dxva2_t *);
+
+static void Unref(vlc_va_dxva2_t *va)
+{
+    if (vlc_atomic_dec(&va->refs) != 0)
+        return;
+
+    Destroy(va);
+    vlc_mutex_destroy(&va->lock);
+    free(va);
+}
+
+/* Must be called with the lock held */
+static void UpdateSurface(vlc_va_dxva2_t *va, LPDIRECT3DSURFACE9 d3d,
+                          unsigned generation, int delta)
+{
+    if (generation != va->surface_generation)
+        return;
+
+    for (unsigned i = 0; i < va->surface_count; i++) {
+        vlc_va_surface_t *surface = &va->surface[i];
+
+        if (surface->d3d == d3d)
+            surface->refcount += delta;
+    }
+}
+
 /* */
 static int Setup(vlc_va_t *external, void **hw, vlc_fourcc_t *chroma,
                  int width, int height)
@@ -326,6 +387,7 @@ static int Setup(vlc_va_t *external, void **hw, vlc_fourcc_t *chroma,
         goto ok;
 
     /* */
+    DxDestroyVideoTargets(va);
     DxDestroyVideoConversion(va);
     DxDestroyVideoDecoder(va);
 
@@ -352,22 +414,29 @@ static int Setup(vlc_va_t *external, void **hw, vlc_fourcc_t *chroma,
 
     /* */
     DxCreateVideoConversion(va);
+    if (va->opaque && DxCreateVideoTargets(va)) {
+        msg_Warn(va->log, "cannot share the surfaces, copying them");
+        DxDestroyVideoTargets(va);
+        va->opaque = false;
+    }
 
     /* */
 ok:
     *hw = &va->hw;
-    const d3d_format_t *output = D3dFindFormat(va->output);
-    *chroma = output->codec;
-
+    if (va->opaque) {
+        *chroma = VLC_CODEC_D3D9_OPAQUE;
+    } else {
+        const d3d_format_t *output = D3dFindFormat(va->output);
+        *chroma = output->codec;
+    }
     return VLC_SUCCESS;
 }
 
-static int Extract(vlc_va_t *external, picture_t *picture, AVFrame *ff)
+static int CopySurface(vlc_object_t *obj, vlc_va_dxva2_t *va,
+                       LPDIRECT3DSURFACE9 d3d, copy_cache_t *cache,
+                       picture_t *picture)
 {
-    vlc_va_dxva2_t *va = vlc_va_dxva2_Get(external);
-    LPDIRECT3DSURFACE9 d3d = (LPDIRECT3DSURFACE9)(uintptr_t)ff->data[3];
-
-    if (!va->surface_cache.buffer)
+    if (!cache->buffer)
         return VLC_EGENERIC;
 
     /* */
@@ -376,7 +445,7 @@ static int Extract(vlc_va_t *external, picture_t *picture, AVFrame *ff)
     /* */
     D3DLOCKED_RECT lock;
     if (FAILED(IDirect3DSurface9_LockRect(d3d, &lock, NULL, D3DLOCK_READONLY))) {
-        msg_Err(va->log, "Failed to lock surface");
+        msg_Err(obj, "Failed to lock surface");
         return VLC_EGENERIC;
     }
 
@@ -404,8 +473,7 @@ static int Extract(vlc_va_t *external, picture_t *picture, AVFrame *ff)
             plane[2] = V;
         }
         CopyFromYv12(picture, plane, pitch,
-                     va->width, va->height,
-                     &va->surface_cache);
+                     va->width, va->height, cache);
     } else {
         assert(va->render == MAKEFOURCC('N','V','1','2'));
         uint8_t *plane[2] = {
@@ -417,14 +485,128 @@ static int Extract(vlc_va_t *external, picture_t *picture, AVFrame *ff)
             lock.Pitch,
         };
         CopyFromNv12(picture, plane, pitch,
-                     va->width, va->height,
-                     &va->surface_cache);
+                     va->width, va->height, cache);
     }
 
     /* */
     IDirect3DSurface9_UnlockRect(d3d);
     return VLC_SUCCESS;
 }
+
+/* Context of the VLC_CODEC_D3D9_OPAQUE pictures */
+typedef struct
+{
+    vlc_d3d9_picture_t d3d;
+
+    vlc_va_dxva2_t     *va;
+    LPDIRECT3DSURFACE9 surface;
+    unsigned           generation;
+} vlc_va_opaque_t;
+
+static vlc_va_opaque_t *OpaqueNew(vlc_va_dxva2_t *, LPDIRECT3DSURFACE9,
+                                  unsigned);
+
+static void OpaqueDestroy(picture_context_t *context)
+{
+    vlc_va_opaque_t *opaque = (vlc_va_opaque_t *)context;
+    vlc_va_dxva2_t *va = opaque->va;
+
+    vlc_mutex_lock(&va->lock);
+    UpdateSurface(va, opaque->surface, opaque->generation, -1);
+    vlc_mutex_unlock(&va->lock);
+
+    Unref(va);
+    free(opaque);
+}
+
+static picture_context_t *OpaqueCopy(picture_context_t *context)
+{
+    vlc_va_opaque_t *opaque = (vlc_va_opaque_t *)context;
+    vlc_va_opaque_t *copy = OpaqueNew(opaque->va, opaque->surface,
+                                      opaque->generation);
+
+    return copy ? &copy->d3d.context : NULL;
+}
+
+static int OpaqueRender(vlc_d3d9_picture_t *picture, HANDLE *shared)
+{
+    vlc_va_opaque_t *opaque = (vlc_va_opaque_t *)picture;
+    vlc_va_dxva2_t *va = opaque->va;
+    int ret = VLC_EGENERIC;
+
+    vlc_mutex_lock(&va->lock);
+    if (opaque->generation != va->surface_generation || !va->target[0])
+        goto out;
+
+    /* Alternate between the targets, the video output may still be reading
+     * the previous one */
+    const unsigned index = va->target_index;
+    va->target_index = (index + 1) % ARRAY_SIZE(va->target);
+
+    /* The colour space conversion happens here */
+    const RECT visible = { 0, 0, va->width, va->height };
+    if (FAILED(IDirect3DDevice9_StretchRect(va->d3ddev, opaque->surface,
+                                            &visible, va->target[index],
+                                            NULL, D3DTEXF_NONE)))
+        goto out;
+
+    /* The other device must not read the target before the copy is done */
+    if (va->target_query) {
+        IDirect3DQuery9_Issue(va->target_query, D3DISSUE_END);
+        for (int i = 0; i < 100; i++) {
+            if (IDirect3DQuery9_GetData(va->target_query, NULL, 0,
+                                        D3DGETDATA_FLUSH) != S_FALSE)
+                break;
+            msleep(CLOCK_FREQ / 1000);
+        }
+    }
+    *shared = va->target_shared[index];
+    ret = VLC_SUCCESS;
+out:
+    vlc_mutex_unlock(&va->lock);
+    return ret;
+}
+
+static vlc_va_opaque_t *OpaqueNew(vlc_va_dxva2_t *va, LPDIRECT3DSURFACE9 d3d,
+                                  unsigned generation)
+{
+    vlc_va_opaque_t *opaque = malloc(sizeof(*opaque));
+    if (unlikely(opaque == NULL))
+        return NULL;
+
+    opaque->d3d.context.destroy = OpaqueDestroy;
+    opaque->d3d.context.copy    = OpaqueCopy;
+    opaque->d3d.width           = va->width;
+    opaque->d3d.height          = va->height;
+    opaque->d3d.render          = OpaqueRender;
+    opaque->va         = va;
+    opaque->surface    = d3d;
+    opaque->generation = generation;
+
+    vlc_atomic_inc(&va->refs);
+    vlc_mutex_lock(&va->lock);
+    UpdateSurface(va, d3d, generation, +1);
+    vlc_mutex_unlock(&va->lock);
+    return opaque;
+}
+
+static int Extract(vlc_va_t *external, picture_t *picture, AVFrame *ff)
+{
+    vlc_va_dxva2_t *va = vlc_va_dxva2_Get(external);
+    LPDIRECT3DSURFACE9 d3d = (LPDIRECT3DSURFACE9)(uintptr_t)ff->data[3];
+
+    if (va->opaque) {
+        vlc_va_opaque_t *opaque = OpaqueNew(va, d3d, va->surface_generation);
+        if (!opaque)
+            return VLC_ENOMEM;
+
+        if (picture->context)
+            picture->context->destroy(picture->context);
+        picture->context = &opaque->d3d.context;
+        return VLC_SUCCESS;
+    }
+    return CopySurface(va->log, va, d3d, &va->surface_cache, picture);
+}
 /* FIXME it is nearly common with VAAPI */
 static int Get(vlc_va_t *external, AVFrame *ff)
 {
@@ -443,6 +625,7 @@ static int Get(vlc_va_t *external, AVFrame *ff)
     /* Grab an unused surface, in case none are, try the oldest
      * XXX using the oldest is a workaround in case a problem happens with libavcodec */
     unsigned i, old;
+    vlc_mutex_lock(&va->lock);
     for (i = 0, old = 0; i < va->surface_count; i++) {
         vlc_va_surface_t *surface = &va->surface[i];
 
@@ -459,6 +642,7 @@ static int Get(vlc_va_t *external, AVFrame *ff)
 
     surface->refcount = 1;
     surface->order = va->surface_order++;
+    vlc_mutex_unlock(&va->lock);
 
     /* */
     for (int i = 0; i < 4; i++) {
@@ -475,17 +659,13 @@ static void Release(vlc_va_t *external, AVFrame *ff)
     vlc_va_dxva2_t *va = vlc_va_dxva2_Get(external);
     LPDIRECT3DSURFACE9 d3d = (LPDIRECT3DSURFACE9)(uintptr_t)ff->data[3];
 
-    for (unsigned i = 0; i < va->surface_count; i++) {
-        vlc_va_surface_t *surface = &va->surface[i];
-
-        if (surface->d3d == d3d)
-            surface->refcount--;
-    }
+    vlc_mutex_lock(&va->lock);
+    UpdateSurface(va, d3d, va->surface_generation, -1);
+    vlc_mutex_unlock(&va->lock);
 }
-static void Close(vlc_va_t *external)
+static void Destroy(vlc_va_dxva2_t *va)
 {
-    vlc_va_dxva2_t *va = vlc_va_dxva2_Get(external);
-
+    DxDestroyVideoTargets(va);
     DxDestroyVideoConversion(va);
     DxDestroyVideoDecoder(va);
     DxDestroyVideoService(va);
@@ -496,9 +676,13 @@ static void Close(vlc_va_t *external)
         FreeLibrary(va->hdxva2_dll);
     if (va->hd3d9_dll)
         FreeLibrary(va->hd3d9_dll);
+}
+static void Close(vlc_va_t *external)
+{
+    vlc_va_dxva2_t *va = vlc_va_dxva2_Get(external);
 
     free(external->description);
-    free(va);
+    Unref(va);
 }
 
 static int Open(vlc_va_t *external, int codec_id, const es_format_t *fmt)
@@ -508,9 +692,13 @@ static int Open(vlc_va_t *external, int codec_id, const es_format_t *fmt)
         return NULL;
 
     external->sys = va;
+    vlc_atomic_set(&va->refs, 1);
+    vlc_mutex_init(&va->lock);
     /* */
     va->log = VLC_OBJECT(external);
     va->codec_id = codec_id;
+    va->copy_threads = var_InheritInteger(external, "avcodec-copy-threads");
+    va->opaque = var_InheritBool(external, "dxva2-opaque");
     (void) fmt;
 
     /* Load dll*/
@@ -559,7 +747,7 @@ static int Open(vlc_va_t *external, int codec_id, const es_format_t *fmt)
     return VLC_SUCCESS;
 
 error:
-    Close(va);
+    Close(external);
     return VLC_EGENERIC;
 }
 /* */
@@ -578,9 +766,22 @@ static int D3dCreateDevice(vlc_va_dxva2_t *va)
         return VLC_EGENERIC;
     }
 
-    /* */
-    LPDIRECT3D9 d3dobj;
-    d3dobj = Create9(D3D_SDK_VERSION);
+    /* Only Direct3D9Ex devices can share render targets */
+    LPDIRECT3D9 d3dobj = NULL;
+    if (va->opaque) {
+        HRESULT (WINAPI *Create9Ex)(UINT SDKVersion, IDirect3D9Ex **);
+        Create9Ex = (void *)GetProcAddress(va->hd3d9_dll,
+                                           "Direct3DCreate9Ex");
+        IDirect3D9Ex *d3dobjex;
+        if (Create9Ex && SUCCEEDED(Create9Ex(D3D_SDK_VERSION, &d3dobjex)))
+            d3dobj = (LPDIRECT3D9)d3dobjex;
+        else {
+            msg_Warn(va->log, "Direct3D9Ex is not available, copying the surfaces");
+            va->opaque = false;
+        }
+    }
+    if (!d3dobj)
+        d3dobj = Create9(D3D_SDK_VERSION);
     if (!d3dobj) {
         msg_Err(va->log, "Direct3DCreate9 failed");
         return VLC_EGENERIC;
@@ -614,7 +815,19 @@ static int D3dCreateDevice(vlc_va_dxva2_t *va)
     this HWND is used to alert Direct3D when there's a change of focus window.
     For now, use GetDesktopWindow, as it looks harmless */
     LPDIRECT3DDEVICE9 d3ddev;
-    if (FAILED(IDirect3D9_CreateDevice(d3dobj, D3DADAPTER_DEFAULT,
+    if (va->opaque) {
+        IDirect3DDevice9Ex *d3ddevex;
+        if (FAILED(IDirect3D9Ex_CreateDeviceEx((IDirect3D9Ex *)d3dobj,
+                                               D3DADAPTER_DEFAULT,
+                                               D3DDEVTYPE_HAL, GetDesktopWindow(),
+                                               D3DCREATE_SOFTWARE_VERTEXPROCESSING |
+                                               D3DCREATE_MULTITHREADED,
+                                               d3dpp, NULL, &d3ddevex))) {
+            msg_Err(va->log, "IDirect3D9Ex_CreateDeviceEx failed");
+            return VLC_EGENERIC;
+        }
+        d3ddev = (LPDIRECT3DDEVICE9)d3ddevex;
+    } else if (FAILED(IDirect3D9_CreateDevice(d3dobj, D3DADAPTER_DEFAULT,
                                        D3DDEVTYPE_HAL, GetDesktopWindow(),
                                        D3DCREATE_SOFTWARE_VERTEXPROCESSING |
                                        D3DCREATE_MULTITHREADED,
@@ -872,6 +1085,9 @@ static int DxCreateVideoDecoder(vlc_va_dxva2_t *va,
         va->surface_count = 2 + 1;
         break;
     }
+    /* The video output keeps a few pictures queued */
+    if (va->opaque)
+        va->surface_count += 8;
     LPDIRECT3DSURFACE9 surface_list[VA_DXVA2_MAX_SURFACE_COUNT];
     if (FAILED(IDirectXVideoDecoderService_CreateSurface(va->vs,
                                                          va->surface_width,
@@ -990,9 +1206,13 @@ static void DxDestroyVideoDecoder(vlc_va_dxva2_t *va)
         IDirectXVideoDecoder_Release(va->decoder);
     va->decoder = NULL;
 
+    /* The pictures still referencing the surfaces will not be drawn */
+    vlc_mutex_lock(&va->lock);
     for (unsigned i = 0; i < va->surface_count; i++)
         IDirect3DSurface9_Release(va->surface[i].d3d);
     va->surface_count = 0;
+    va->surface_generation++;
+    vlc_mutex_unlock(&va->lock);
 }
 static int DxResetVideoDecoder(vlc_va_dxva2_t *va)
 {
@@ -1011,9 +1231,168 @@ static void DxCreateVideoConversion(vlc_va_dxva2_t *va)
         va->output = va->render;
         break;
     }
-    CopyInitCache(&va->surface_cache, va->surface_width);
+    CopyInitCache(&va->surface_cache, va->surface_width, va->copy_threads);
 }
 static void DxDestroyVideoConversion(vlc_va_dxva2_t *va)
 {
     CopyCleanCache(&va->surface_cache);
 }
+
+/**
+ * It creates the render targets shared with the video output
+ */
+static int DxCreateVideoTargets(vlc_va_dxva2_t *va)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(va->target); i++) {
+        HANDLE shared = NULL;
+        if (FAILED(IDirect3DDevice9_CreateRenderTarget(va->d3ddev,
+                                                       va->width,
+                                                       va->height,
+                                                       D3DFMT_X8R8G8B8,
+                                                       D3DMULTISAMPLE_NONE,
+                                                       0, FALSE,
+                                                       &va->target[i],
+                                                       &shared))) {
+            msg_Err(va->log, "Failed to create a shared render target");
+            va->target[i] = NULL;
+            return VLC_EGENERIC;
+        }
+        va->target_shared[i] = shared;
+    }
+    va->target_index = 0;
+
+    if (FAILED(IDirect3DDevice9_CreateQuery(va->d3ddev, D3DQUERYTYPE_EVENT,
+                                            &va->target_query)))
+        va->target_query = NULL;
+    return VLC_SUCCESS;
+}
+static void DxDestroyVideoTargets(vlc_va_dxva2_t *va)
+{
+    vlc_mutex_lock(&va->lock);
+    for (unsigned i = 0; i < ARRAY_SIZE(va->target); i++) {
+        if (va->target[i])
+            IDirect3DSurface9_Release(va->target[i]);
+        va->target[i] = NULL;
+        va->target_shared[i] = NULL;
+    }
+    if (va->target_query)
+        IDirect3DQuery9_Release(va->target_query);
+    va->target_query = NULL;
+    vlc_mutex_unlock(&va->lock);
+}
+
+/*****************************************************************************
+ * Conversion of the opaque pictures for the filters and video outputs that
+ * need the pixels in system memory
+ *****************************************************************************/
+struct filter_sys_t
+{
+    vlc_va_dxva2_t *va;
+    unsigned       generation;
+    copy_cache_t   cache;
+};
+
+static void ChromaClean(filter_sys_t *sys)
+{
+    vlc_va_dxva2_t *va = sys->va;
+
+    if (!va)
+        return;
+    CopyCleanCache(&sys->cache);
+    sys->va = NULL;
+    Unref(va);
+}
+
+/* Must be called with the lock of the decoder held */
+static int ChromaSetup(filter_t *filter, vlc_va_dxva2_t *va,
+                       unsigned generation)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    if (sys->va == va && sys->generation == generation)
+        return VLC_SUCCESS;
+
+    ChromaClean(sys);
+    if (generation != va->surface_generation)
+        return VLC_EGENERIC;
+
+    if (CopyInitCache(&sys->cache, va->surface_width, va->copy_threads))
+        return VLC_EGENERIC;
+
+    vlc_atomic_inc(&va->refs);
+    sys->va = va;
+    sys->generation = generation;
+    return VLC_SUCCESS;
+}
+
+static picture_t *ChromaFilter(filter_t *filter, picture_t *src)
+{
+    vlc_va_opaque_t *opaque = (vlc_va_opaque_t *)src->context;
+    picture_t *dst = NULL;
+
+    if (opaque)
+        dst = filter_NewPicture(filter);
+    if (!dst) {
+        picture_Release(src);
+        return NULL;
+    }
+
+    vlc_va_dxva2_t *va = opaque->va;
+    filter_sys_t *sys = filter->p_sys;
+    int ret;
+
+    vlc_mutex_lock(&va->lock);
+    ret = ChromaSetup(filter, va, opaque->generation);
+    if (!ret)
+        ret = CopySurface(VLC_OBJECT(filter), va, opaque->surface,
+                          &sys->cache, dst);
+    vlc_mutex_unlock(&va->lock);
+
+    if (ret) {
+        picture_Release(dst);
+        picture_Release(src);
+        return NULL;
+    }
+    picture_CopyProperties(dst, src);
+    picture_Release(src);
+    return dst;
+}
+
+static int OpenChroma(vlc_object_t *object)
+{
+    filter_t *filter = (filter_t *)object;
+
+    /* The copy functions output YV12 */
+    if (filter->fmt_in.video.i_chroma != VLC_CODEC_D3D9_OPAQUE ||
+        filter->fmt_out.video.i_chroma != VLC_CODEC_YV12)
+        return VLC_EGENERIC;
+    if (filter->fmt_in.video.i_width != filter->fmt_out.video.i_width ||
+        filter->fmt_in.video.i_height != filter->fmt_out.video.i_height)
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = malloc(sizeof(*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+    sys->va = NULL;
+
+    filter->p_sys = sys;
+    filter->pf_video_filter = ChromaFilter;
+    return VLC_SUCCESS;
+}
+
+static void CloseChroma(vlc_object_t *object)
+{
+    filter_t *filter = (filter_t *)object;
+    filter_sys_t *sys = filter->p_sys;
+
+    if (sys->va) {
+        vlc_va_dxva2_t *va = sys->va;
+
+        vlc_mutex_lock(&va->lock);
+        vlc_atomic_inc(&va->refs);
+        ChromaClean(sys);
+        vlc_mutex_unlock(&va->lock);
+        Unref(va);
+    }
+    free(sys);
+}
@@ -123,6 +123,7 @@ struct encoder_sys_t
     int        i_qmax;
     int        i_hq;
     int        i_rc_buffer_size;
+    mtime_t    i_latency;
     float      f_rc_buffer_aggressivity;
     bool       b_pre_me;
     bool       b_hurry_up;
@@ -150,7 +151,7 @@ static const char *const ppsz_enc_options[] = {
 #if (LIBAVCODEC_VERSION_MAJOR < 55)
     "luma-elim-threshold", "chroma-elim-threshold",
 #endif
-    "aac-profile",
+    "aac-profile", "latency",
     NULL
 };
 
@@ -185,6 +186,62 @@ static const uint16_t mpeg4_default_non_intra_matrix[64] = {
  23, 24, 25, 27, 28, 30, 31, 33,
 };
 
+static mtime_t FrameDuration( AVRational time_base )
+{
+    if( time_base.num <= 0 || time_base.den <= 0 )
+        return CLOCK_FREQ / 25;
+    return CLOCK_FREQ * time_base.num / time_base.den;
+}
+
+/*****************************************************************************
+ * InitThreads: choose the threading of a new encoder
+ *****************************************************************************
+ * Unless the thread count is forced, all CPUs are used for the big pictures,
+ * with frame threads if the codec has them (e.g. prores, dnxhd, huffyuv),
+ * slice threads otherwise (mpeg2, mpeg4). Frame threads keep encoding while
+ * the packets of the previous pictures are returned, at the cost of one
+ * frame of delay each.
+ *****************************************************************************/
+static void InitThreads( encoder_t *p_enc, AVCodecContext *p_context,
+                         const AVCodec *p_codec )
+{
+    int i_thread_count = p_enc->i_threads;
+
+    if( i_thread_count < 1 )
+    {
+        i_thread_count = vlc_GetCPUCount();
+        if( p_enc->fmt_in.i_cat == VIDEO_ES )
+        {
+            const unsigned i_pixels = p_enc->fmt_in.video.i_width *
+                                      p_enc->fmt_in.video.i_height;
+            if( i_pixels <= 720 * 576 )
+                i_thread_count = __MIN( i_thread_count, 4 );
+            else if( i_pixels <= 1920 * 1088 )
+                i_thread_count = __MIN( i_thread_count, 8 );
+        }
+    }
+    p_context->thread_count = __MIN( i_thread_count, 16 );
+
+#ifdef HAVE_AVCODEC_MT
+    if( p_enc->p_sys->i_latency > 0 )
+        p_context->thread_type = FF_THREAD_SLICE;
+    else
+        p_context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+#endif
+#if defined(CODEC_CAP_FRAME_THREADS) && defined(CODEC_CAP_SLICE_THREADS)
+    /* Do not ask for threads the codec cannot use */
+    int i_caps = 0;
+    if( p_codec->capabilities & CODEC_CAP_FRAME_THREADS )
+        i_caps |= FF_THREAD_FRAME;
+    if( p_codec->capabilities & CODEC_CAP_SLICE_THREADS )
+        i_caps |= FF_THREAD_SLICE;
+    if( !( p_context->thread_type & i_caps ) )
+        p_context->thread_count = 1;
+#endif
+    msg_Dbg( p_enc, "allowing %d thread(s) for encoding with %s",
+             p_context->thread_count, p_codec->name );
+}
+
 /*****************************************************************************
  * OpenEncoder: probe the encoder
  *****************************************************************************/
@@ -332,6 +389,7 @@ int OpenEncoder( vlc_object_t *p_this )
     }
 
     p_sys->i_rc_buffer_size = var_GetInteger( p_enc, ENC_CFG_PREFIX "rc-buffer-size" );
+    p_sys->i_latency = var_GetInteger( p_enc, ENC_CFG_PREFIX "latency" ) * 1000;
     p_sys->f_rc_buffer_aggressivity = var_GetFloat( p_enc, ENC_CFG_PREFIX "rc-buffer-aggressivity" );
     p_sys->f_i_quant_factor = var_GetFloat( p_enc, ENC_CFG_PREFIX "i-quant-factor" );
     p_sys->i_noise_reduction = var_GetInteger( p_enc, ENC_CFG_PREFIX "noise-reduction" );
@@ -454,6 +512,14 @@ int OpenEncoder( vlc_object_t *p_this )
             p_context->gop_size = p_sys->i_key_int;
         p_context->max_b_frames =
             VLC_CLIP( p_sys->i_b_frames, 0, FF_MAX_B_FRAMES );
+        if( p_sys->i_latency > 0 )
+        {
+            /* Half of the latency target for the B-frames reordering */
+            int i_frames = p_sys->i_latency / 2
+                         / FrameDuration( p_context->time_base );
+            if( p_context->max_b_frames > i_frames )
+                p_context->max_b_frames = i_frames;
+        }
         p_context->b_frame_strategy = 0;
         if( !p_context->max_b_frames  &&
             (  p_enc->fmt_out.i_codec == VLC_CODEC_MPGV ||
@@ -575,6 +641,17 @@ int OpenEncoder( vlc_object_t *p_this )
         else
         {
             p_context->rc_qsquish = 1.0;
+            if( p_sys->i_latency > 0 && !p_sys->i_rc_buffer_size )
+            {
+                /* The rest of the latency target for the buffer */
+                mtime_t i_frame = FrameDuration( p_context->time_base );
+                mtime_t i_buffer = p_sys->i_latency
+                                 - p_context->max_b_frames * i_frame;
+                if( i_buffer < i_frame )
+                    i_buffer = i_frame;
+                p_sys->i_rc_buffer_size = __MAX( 1,
+                    p_enc->fmt_out.i_bitrate * i_buffer / 1000000 );
+            }
             if( p_sys->i_rc_buffer_size )
             {
                 p_context->rc_max_rate = p_enc->fmt_out.i_bitrate;
@@ -694,10 +771,7 @@ int OpenEncoder( vlc_object_t *p_this )
     p_context->extradata = NULL;
     p_context->flags |= CODEC_FLAG_GLOBAL_HEADER;
 
-    if( p_enc->i_threads >= 1)
-        p_context->thread_count = p_enc->i_threads;
-    else
-        p_context->thread_count = vlc_GetCPUCount();
+    InitThreads( p_enc, p_context, p_codec );
 
     int ret;
     vlc_avcodec_lock();
@@ -816,6 +890,20 @@ int OpenEncoder( vlc_object_t *p_this )
 
     p_context->flags &= ~CODEC_FLAG_GLOBAL_HEADER;
 
+    /* Tell the stream output how late the output comes */
+    if( p_enc->fmt_in.i_cat == VIDEO_ES )
+    {
+        int i_frames = p_context->delay;
+#ifdef FF_THREAD_FRAME
+        if( p_context->active_thread_type & FF_THREAD_FRAME )
+            i_frames += p_context->thread_count - 1;
+#endif
+        p_enc->i_delay = i_frames * FrameDuration( p_context->time_base );
+    }
+    else if( p_enc->fmt_in.i_cat == AUDIO_ES && p_context->sample_rate > 0 )
+        p_enc->i_delay = INT64_C(1000000) * p_context->delay
+                       / p_context->sample_rate;
+
     if( p_enc->fmt_in.i_cat == AUDIO_ES )
     {
         p_enc->fmt_in.i_codec = GetVlcAudioFormat( p_sys->p_context->sample_fmt );
@@ -1039,6 +1127,21 @@ static block_t *EncodeVideo( encoder_t *p_enc, picture_t *p_pict )
         p_block->i_flags |= BLOCK_FLAG_CORRUPTED;
 #endif
 
+#if (LIBAVCODEC_VERSION_MAJOR >= 54)
+    /* The frame threads do not update the coded frame of the main context:
+     * the packet flags are all there is */
+    if( p_sys->p_context->coded_frame == NULL
+#ifdef HAVE_AVCODEC_MT
+     || (p_sys->p_context->active_thread_type & FF_THREAD_FRAME)
+#endif
+      )
+    {
+        p_block->i_flags |= (av_pkt.flags & AV_PKT_FLAG_KEY)
+                          ? BLOCK_FLAG_TYPE_I : BLOCK_FLAG_TYPE_PB;
+        return p_block;
+    }
+#endif
+
     switch ( p_sys->p_context->coded_frame->pict_type )
     {
     case AV_PICTURE_TYPE_I:
@@ -0,0 +1,50 @@
+/*****************************************************************************
+ * va_surface.h: VAAPI surfaces shared by the decoder and the encoder
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _VLC_VA_SURFACE_H
+#define _VLC_VA_SURFACE_H 1
+
+#ifdef HAVE_VA_GLX
+/* Context of the VLC_CODEC_VAAPI_OPAQUE pictures */
+typedef struct
+{
+    vlc_gl_picture_t gl;
+
+    struct vlc_va_sys_t *p_va;
+    VASurfaceID  i_id;
+    unsigned int i_generation;
+} vlc_va_opaque_t;
+
+/* Keeps the display of the decoder alive, and returns it */
+VADisplay VaapiHoldDisplay(struct vlc_va_sys_t *);
+void VaapiReleaseDisplay(struct vlc_va_sys_t *);
+
+/* Prevents the decoder from destroying the surface of the picture until it
+ * is unlocked. It fails, unlocked, if the surface is already destroyed. */
+int  VaapiLockSurface(const vlc_va_opaque_t *);
+void VaapiUnlockSurface(const vlc_va_opaque_t *);
+#endif
+
+#define VAAPI_CFG_PREFIX "sout-vaapi-"
+
+int  OpenVaapiEncoder(vlc_object_t *);
+void CloseVaapiEncoder(vlc_object_t *);
+
+#endif
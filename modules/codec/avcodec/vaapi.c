@@ -31,18 +31,50 @@
 #include <vlc_plugin.h>
 #include <vlc_fourcc.h>
 #include <vlc_xlib.h>
+#include <vlc_atomic.h>
 
 #include <libavcodec/avcodec.h>
 #include <libavcodec/vaapi.h>
 #include <X11/Xlib.h>
 #include <va/va_x11.h>
+#ifdef HAVE_VA_GLX
+# include <vlc_filter.h>
+# include <vlc_opengl.h>
+# include <va/va_glx.h>
+#endif
 
 #include "avcodec.h"
 #include "va.h"
+#include "va_surface.h"
 #include "copy.h"
 
 static int Create( vlc_va_t *, int, const es_format_t * );
 static void Delete( vlc_va_t * );
+#ifdef HAVE_VA_GLX
+static int  OpenChroma( vlc_object_t * );
+static void CloseChroma( vlc_object_t * );
+
+#define OPAQUE_TEXT N_("Keep decoded pictures in video memory")
+#define OPAQUE_LONGTEXT N_( \
+    "The decoded surfaces are handed to the video output instead of being " \
+    "copied to system memory. The OpenGL video output draws them directly, " \
+    "they are only copied for the outputs and filters that need the pixels." )
+#endif
+#if defined(ENABLE_SOUT) && defined(HAVE_VA_VA_ENC_H264_H)
+#define VAAPI_KEYINT_TEXT N_("Maximum GOP size")
+#define VAAPI_KEYINT_LONGTEXT N_( \
+    "Number of frames between two IDR frames." )
+#define VAAPI_QP_TEXT N_("Quantizer")
+#define VAAPI_QP_LONGTEXT N_( \
+    "Quantizer of the frames when no bitrate is requested, initial " \
+    "quantizer of the rate control otherwise." )
+#define VAAPI_PROFILE_TEXT N_("Profile")
+#define VAAPI_PROFILE_LONGTEXT N_( \
+    "H.264 profile of the stream, if the hardware supports it." )
+
+static const char *const vaapi_profile_list[] = { "main", "high" };
+static const char *const vaapi_profile_list_text[] = { N_("Main"), N_("High") };
+#endif
 
 vlc_module_begin ()
     set_description( N_("Video Acceleration (VA) API") )
@@ -50,6 +82,31 @@ vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_VCODEC )
     set_callbacks( Create, Delete )
+#ifdef HAVE_VA_GLX
+    add_bool( "vaapi-opaque", false, OPAQUE_TEXT, OPAQUE_LONGTEXT, true )
+
+    add_submodule ()
+    set_description( N_("VA API surfaces conversions") )
+    set_capability( "video filter2", 10 )
+    set_callbacks( OpenChroma, CloseChroma )
+#endif
+#if defined(ENABLE_SOUT) && defined(HAVE_VA_VA_ENC_H264_H)
+    add_submodule ()
+    add_shortcut( "vaapi" )
+    set_section( N_("Encoding"), NULL )
+    set_description( N_("VA API H.264 encoder") )
+    set_capability( "encoder", 0 )
+    set_callbacks( OpenVaapiEncoder, CloseVaapiEncoder )
+    add_integer( VAAPI_CFG_PREFIX "keyint", 250, VAAPI_KEYINT_TEXT,
+                 VAAPI_KEYINT_LONGTEXT, false )
+        change_integer_range( 1, 65535 )
+    add_integer( VAAPI_CFG_PREFIX "qp", 26, VAAPI_QP_TEXT, VAAPI_QP_LONGTEXT,
+                 false )
+        change_integer_range( 1, 51 )
+    add_string( VAAPI_CFG_PREFIX "profile", "high", VAAPI_PROFILE_TEXT,
+                VAAPI_PROFILE_LONGTEXT, false )
+        change_string_list( vaapi_profile_list, vaapi_profile_list_text )
+#endif
 vlc_module_end ()
 
 typedef struct
@@ -62,6 +119,10 @@ typedef struct
 
 struct vlc_va_sys_t
 {
+    /* Held by the decoder and by the pictures still using its surfaces */
+    vlc_atomic_t  refs;
+    vlc_mutex_t   lock;
+
     Display      *p_display_x11;
     VADisplay     p_display;
 
@@ -82,19 +143,57 @@ struct vlc_va_sys_t
     vlc_fourcc_t i_surface_chroma;
 
     vlc_va_surface_t *p_surface;
+    unsigned int i_surface_generation;
 
+    VAImageFormat image_format;
     VAImage      image;
     copy_cache_t image_cache;
+    unsigned     i_copy_threads;
 
     bool b_supports_derive;
+    bool b_opaque;
 };
 
+static void Close( vlc_va_sys_t * );
+
+static void Unref( vlc_va_sys_t *p_va )
+{
+    if( vlc_atomic_dec( &p_va->refs ) != 0 )
+        return;
+
+    Close( p_va );
+    vlc_mutex_destroy( &p_va->lock );
+    free( p_va );
+}
+
+/* Must be called with the lock held */
+static void UpdateSurface( vlc_va_sys_t *p_va, VASurfaceID i_id,
+                           unsigned int i_generation, int i_delta )
+{
+    if( i_generation != p_va->i_surface_generation )
+        return;
+
+    for( int i = 0; i < p_va->i_surface_count && p_va->p_surface; i++ )
+    {
+        vlc_va_surface_t *p_surface = &p_va->p_surface[i];
+
+        if( p_surface->i_id == i_id )
+            p_surface->i_refcount += i_delta;
+    }
+}
+
 /* */
 static int Open( vlc_va_t *p_external, int i_codec_id )
 {
     vlc_va_sys_t *p_va = calloc( 1, sizeof(*p_va) );
     if ( unlikely(p_va == NULL) )
        return VLC_ENOMEM;
+    vlc_atomic_set( &p_va->refs, 1 );
+    vlc_mutex_init( &p_va->lock );
+    p_va->i_copy_threads = var_InheritInteger( p_external, "avcodec-copy-threads" );
+#ifdef HAVE_VA_GLX
+    p_va->b_opaque = var_InheritBool( p_external, "vaapi-opaque" );
+#endif
 
     VAProfile i_profile, *p_profiles_list;
     bool b_supported_profile = false;
@@ -129,6 +228,10 @@ static int Open( vlc_va_t *p_external, int i_codec_id )
         return VLC_EGENERIC;
     }
 
+    /* The video output keeps a few pictures queued */
+    if( p_va->b_opaque )
+        i_surface_count += 8;
+
     /* */
     p_va->i_config_id  = VA_INVALID_ID;
     p_va->i_context_id = VA_INVALID_ID;
@@ -142,7 +245,12 @@ static int Open( vlc_va_t *p_external, int i_codec_id )
         goto error;
     }
 
-    p_va->p_display = vaGetDisplay( p_va->p_display_x11 );
+#ifdef HAVE_VA_GLX
+    if( p_va->b_opaque )
+        p_va->p_display = vaGetDisplayGLX( p_va->p_display_x11 );
+    else
+#endif
+        p_va->p_display = vaGetDisplay( p_va->p_display_x11 );
     if( !p_va->p_display )
     {
         msg_Err( p_external, "Could not get a VAAPI device" );
@@ -228,6 +336,8 @@ static void DestroySurfaces( vlc_va_sys_t *p_va )
     if( p_va->i_context_id != VA_INVALID_ID )
         vaDestroyContext( p_va->p_display, p_va->i_context_id );
 
+    /* The pictures still referencing the surfaces will not be drawn */
+    vlc_mutex_lock( &p_va->lock );
     for( int i = 0; i < p_va->i_surface_count && p_va->p_surface; i++ )
     {
         vlc_va_surface_t *p_surface = &p_va->p_surface[i];
@@ -241,8 +351,10 @@ static void DestroySurfaces( vlc_va_sys_t *p_va )
     p_va->image.image_id = VA_INVALID_ID;
     p_va->i_context_id = VA_INVALID_ID;
     p_va->p_surface = NULL;
+    p_va->i_surface_generation++;
     p_va->i_surface_width = 0;
     p_va->i_surface_height = 0;
+    vlc_mutex_unlock( &p_va->lock );
 }
 static int CreateSurfaces( vlc_va_sys_t *p_va, void **pp_hw_ctx, vlc_fourcc_t *pi_chroma,
                            int i_width, int i_height )
@@ -304,7 +416,6 @@ static int CreateSurfaces( vlc_va_sys_t *p_va, void **pp_hw_ctx, vlc_fourcc_t *p
     }
 
     vlc_fourcc_t  i_chroma = 0;
-    VAImageFormat fmt;
     for( int i = 0; i < i_fmt_count; i++ )
     {
         if( p_fmt[i].fourcc == VA_FOURCC( 'Y', 'V', '1', '2' ) ||
@@ -327,13 +438,15 @@ static int CreateSurfaces( vlc_va_sys_t *p_va, void **pp_hw_ctx, vlc_fourcc_t *p
             }
 
             i_chroma = VLC_CODEC_YV12;
-            fmt = p_fmt[i];
+            p_va->image_format = p_fmt[i];
             break;
         }
     }
     free( p_fmt );
     if( !i_chroma )
         goto error;
+    if( p_va->b_opaque )
+        i_chroma = VLC_CODEC_VAAPI_OPAQUE;
     *pi_chroma = i_chroma;
 
     if(p_va->b_supports_derive)
@@ -342,7 +455,8 @@ static int CreateSurfaces( vlc_va_sys_t *p_va, void **pp_hw_ctx, vlc_fourcc_t *p
         p_va->image.image_id = VA_INVALID_ID;
     }
 
-    if( unlikely(CopyInitCache( &p_va->image_cache, i_width )) )
+    if( unlikely(CopyInitCache( &p_va->image_cache, i_width,
+                                 p_va->i_copy_threads )) )
         goto error;
 
     /* Setup the ffmpeg hardware context */
@@ -387,12 +501,10 @@ static int Setup( vlc_va_t *p_external, void **pp_hw_ctx, vlc_fourcc_t *pi_chrom
 
     return VLC_EGENERIC;
 }
-static int Extract( vlc_va_t *p_external, picture_t *p_picture, AVFrame *p_ff )
+static int CopySurface( vlc_va_sys_t *p_va, VASurfaceID i_surface_id,
+                        VAImage *p_image, copy_cache_t *p_cache,
+                        picture_t *p_picture )
 {
-    vlc_va_sys_t *p_va = p_external->sys;
-
-    VASurfaceID i_surface_id = (VASurfaceID)(uintptr_t)p_ff->data[3];
-
 #if VA_CHECK_VERSION(0,31,0)
     if( vaSyncSurface( p_va->p_display, i_surface_id ) )
 #else
@@ -402,22 +514,22 @@ static int Extract( vlc_va_t *p_external, picture_t *p_picture, AVFrame *p_ff )
 
     if(p_va->b_supports_derive)
     {
-        if(vaDeriveImage(p_va->p_display, i_surface_id, &(p_va->image)) != VA_STATUS_SUCCESS)
+        if(vaDeriveImage(p_va->p_display, i_surface_id, p_image) != VA_STATUS_SUCCESS)
             return VLC_EGENERIC;
     }
     else
     {
         if( vaGetImage( p_va->p_display, i_surface_id,
                         0, 0, p_va->i_surface_width, p_va->i_surface_height,
-                        p_va->image.image_id) )
+                        p_image->image_id) )
             return VLC_EGENERIC;
     }
 
     void *p_base;
-    if( vaMapBuffer( p_va->p_display, p_va->image.buf, &p_base ) )
+    if( vaMapBuffer( p_va->p_display, p_image->buf, &p_base ) )
         return VLC_EGENERIC;
 
-    const uint32_t i_fourcc = p_va->image.format.fourcc;
+    const uint32_t i_fourcc = p_image->format.fourcc;
     if( i_fourcc == VA_FOURCC('Y','V','1','2') ||
         i_fourcc == VA_FOURCC('I','4','2','0') )
     {
@@ -428,13 +540,13 @@ static int Extract( vlc_va_t *p_external, picture_t *p_picture, AVFrame *p_ff )
         for( int i = 0; i < 3; i++ )
         {
             const int i_src_plane = (b_swap_uv && i != 0) ?  (3 - i) : i;
-            pp_plane[i] = (uint8_t*)p_base + p_va->image.offsets[i_src_plane];
-            pi_pitch[i] = p_va->image.pitches[i_src_plane];
+            pp_plane[i] = (uint8_t*)p_base + p_image->offsets[i_src_plane];
+            pi_pitch[i] = p_image->pitches[i_src_plane];
         }
         CopyFromYv12( p_picture, pp_plane, pi_pitch,
                       p_va->i_surface_width,
                       p_va->i_surface_height,
-                      &p_va->image_cache );
+                      p_cache );
     }
     else
     {
@@ -444,26 +556,152 @@ static int Extract( vlc_va_t *p_external, picture_t *p_picture, AVFrame *p_ff )
 
         for( int i = 0; i < 2; i++ )
         {
-            pp_plane[i] = (uint8_t*)p_base + p_va->image.offsets[i];
-            pi_pitch[i] = p_va->image.pitches[i];
+            pp_plane[i] = (uint8_t*)p_base + p_image->offsets[i];
+            pi_pitch[i] = p_image->pitches[i];
         }
         CopyFromNv12( p_picture, pp_plane, pi_pitch,
                       p_va->i_surface_width,
                       p_va->i_surface_height,
-                      &p_va->image_cache );
+                      p_cache );
     }
 
-    if( vaUnmapBuffer( p_va->p_display, p_va->image.buf ) )
+    if( vaUnmapBuffer( p_va->p_display, p_image->buf ) )
         return VLC_EGENERIC;
 
     if(p_va->b_supports_derive)
     {
-        vaDestroyImage( p_va->p_display, p_va->image.image_id );
-        p_va->image.image_id = VA_INVALID_ID;
+        vaDestroyImage( p_va->p_display, p_image->image_id );
+        p_image->image_id = VA_INVALID_ID;
     }
 
     return VLC_SUCCESS;
 }
+
+#ifdef HAVE_VA_GLX
+/* Access to the surfaces of the opaque pictures by the encoder */
+VADisplay VaapiHoldDisplay( vlc_va_sys_t *p_va )
+{
+    vlc_atomic_inc( &p_va->refs );
+    return p_va->p_display;
+}
+
+void VaapiReleaseDisplay( vlc_va_sys_t *p_va )
+{
+    Unref( p_va );
+}
+
+int VaapiLockSurface( const vlc_va_opaque_t *p_opaque )
+{
+    vlc_va_sys_t *p_va = p_opaque->p_va;
+
+    vlc_mutex_lock( &p_va->lock );
+    if( p_opaque->i_generation == p_va->i_surface_generation )
+        return VLC_SUCCESS;
+    vlc_mutex_unlock( &p_va->lock );
+    return VLC_EGENERIC;
+}
+
+void VaapiUnlockSurface( const vlc_va_opaque_t *p_opaque )
+{
+    vlc_mutex_unlock( &p_opaque->p_va->lock );
+}
+
+static vlc_va_opaque_t *OpaqueNew( vlc_va_sys_t *, VASurfaceID, unsigned int );
+
+static void OpaqueDestroy( picture_context_t *p_context )
+{
+    vlc_va_opaque_t *p_opaque = (vlc_va_opaque_t *)p_context;
+    vlc_va_sys_t *p_va = p_opaque->p_va;
+
+    vlc_mutex_lock( &p_va->lock );
+    UpdateSurface( p_va, p_opaque->i_id, p_opaque->i_generation, -1 );
+    vlc_mutex_unlock( &p_va->lock );
+
+    Unref( p_va );
+    free( p_opaque );
+}
+
+static picture_context_t *OpaqueCopy( picture_context_t *p_context )
+{
+    vlc_va_opaque_t *p_opaque = (vlc_va_opaque_t *)p_context;
+    vlc_va_opaque_t *p_copy = OpaqueNew( p_opaque->p_va, p_opaque->i_id,
+                                         p_opaque->i_generation );
+
+    return p_copy ? &p_copy->gl.context : NULL;
+}
+
+static int OpaqueRender( vlc_gl_picture_t *p_gl, unsigned i_target,
+                         unsigned i_texture )
+{
+    vlc_va_opaque_t *p_opaque = (vlc_va_opaque_t *)p_gl;
+    vlc_va_sys_t *p_va = p_opaque->p_va;
+    void *p_gl_surface;
+    int i_ret = VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_va->lock );
+    if( p_opaque->i_generation != p_va->i_surface_generation )
+        goto out;
+
+    /* The GL surface is created for each picture so that it never outlives
+     * the texture nor the OpenGL context of the video output */
+    if( vaCreateSurfaceGLX( p_va->p_display, i_target, i_texture,
+                            &p_gl_surface ) )
+        goto out;
+    if( !vaCopySurfaceGLX( p_va->p_display, p_gl_surface, p_opaque->i_id,
+                           VA_FRAME_PICTURE ) )
+        i_ret = VLC_SUCCESS;
+    vaDestroySurfaceGLX( p_va->p_display, p_gl_surface );
+out:
+    vlc_mutex_unlock( &p_va->lock );
+    return i_ret;
+}
+
+static vlc_va_opaque_t *OpaqueNew( vlc_va_sys_t *p_va, VASurfaceID i_id,
+                                   unsigned int i_generation )
+{
+    vlc_va_opaque_t *p_opaque = malloc( sizeof(*p_opaque) );
+    if( unlikely(p_opaque == NULL) )
+        return NULL;
+
+    p_opaque->gl.context.destroy = OpaqueDestroy;
+    p_opaque->gl.context.copy    = OpaqueCopy;
+    p_opaque->gl.render          = OpaqueRender;
+    p_opaque->p_va         = p_va;
+    p_opaque->i_id         = i_id;
+    p_opaque->i_generation = i_generation;
+
+    vlc_atomic_inc( &p_va->refs );
+    vlc_mutex_lock( &p_va->lock );
+    UpdateSurface( p_va, i_id, i_generation, +1 );
+    vlc_mutex_unlock( &p_va->lock );
+    return p_opaque;
+}
+#endif
+
+static int Extract( vlc_va_t *p_external, picture_t *p_picture, AVFrame *p_ff )
+{
+    vlc_va_sys_t *p_va = p_external->sys;
+
+    VASurfaceID i_surface_id = (VASurfaceID)(uintptr_t)p_ff->data[3];
+
+#ifdef HAVE_VA_GLX
+    if( p_va->b_opaque )
+    {
+        /* The surface is synchronized by whoever reads it */
+        vlc_va_opaque_t *p_opaque = OpaqueNew( p_va, i_surface_id,
+                                               p_va->i_surface_generation );
+        if( !p_opaque )
+            return VLC_ENOMEM;
+
+        if( p_picture->context )
+            p_picture->context->destroy( p_picture->context );
+        p_picture->context = &p_opaque->gl.context;
+        return VLC_SUCCESS;
+    }
+#endif
+    return CopySurface( p_va, i_surface_id, &p_va->image, &p_va->image_cache,
+                        p_picture );
+}
 static int Get( vlc_va_t *p_external, AVFrame *p_ff )
 {
     vlc_va_sys_t *p_va = p_external->sys;
@@ -472,6 +710,7 @@ static int Get( vlc_va_t *p_external, AVFrame *p_ff )
 
     /* Grab an unused surface, in case none are, try the oldest
      * XXX using the oldest is a workaround in case a problem happens with ffmpeg */
+    vlc_mutex_lock( &p_va->lock );
     for( i = 0, i_old = 0; i < p_va->i_surface_count; i++ )
     {
         vlc_va_surface_t *p_surface = &p_va->p_surface[i];
@@ -489,6 +728,7 @@ static int Get( vlc_va_t *p_external, AVFrame *p_ff )
 
     p_surface->i_refcount = 1;
     p_surface->i_order = p_va->i_surface_order++;
+    vlc_mutex_unlock( &p_va->lock );
 
     /* */
     for( int i = 0; i < 4; i++ )
@@ -507,13 +747,9 @@ static void Release( vlc_va_t *p_external, AVFrame *p_ff )
 
     VASurfaceID i_surface_id = (VASurfaceID)(uintptr_t)p_ff->data[3];
 
-    for( int i = 0; i < p_va->i_surface_count; i++ )
-    {
-        vlc_va_surface_t *p_surface = &p_va->p_surface[i];
-
-        if( p_surface->i_id == i_surface_id )
-            p_surface->i_refcount--;
-    }
+    vlc_mutex_lock( &p_va->lock );
+    UpdateSurface( p_va, i_surface_id, p_va->i_surface_generation, -1 );
+    vlc_mutex_unlock( &p_va->lock );
 }
 
 static void Close( vlc_va_sys_t *p_va )
@@ -532,9 +768,8 @@ static void Close( vlc_va_sys_t *p_va )
 static void Delete( vlc_va_t *p_external )
 {
     vlc_va_sys_t *p_va = p_external->sys;
-    Close( p_va );
     free( p_external->description );
-    free( p_va );
+    Unref( p_va );
 }
 
 static int Create( vlc_va_t *p_va, int i_codec_id, const es_format_t *fmt )
@@ -559,3 +794,144 @@ static int Create( vlc_va_t *p_va, int i_codec_id, const es_format_t *fmt )
     p_va->extract = Extract;
     return VLC_SUCCESS;
 }
+
+#ifdef HAVE_VA_GLX
+/*****************************************************************************
+ * Conversion of the opaque pictures for the filters and video outputs that
+ * need the pixels in system memory
+ *****************************************************************************/
+struct filter_sys_t
+{
+    vlc_va_sys_t *p_va;
+    unsigned int i_generation;
+
+    VAImage      image;
+    copy_cache_t cache;
+};
+
+static void ChromaClean( filter_sys_t *p_sys )
+{
+    vlc_va_sys_t *p_va = p_sys->p_va;
+
+    if( !p_va )
+        return;
+    CopyCleanCache( &p_sys->cache );
+    if( p_sys->image.image_id != VA_INVALID_ID )
+        vaDestroyImage( p_va->p_display, p_sys->image.image_id );
+    p_sys->image.image_id = VA_INVALID_ID;
+    p_sys->p_va = NULL;
+    Unref( p_va );
+}
+
+/* Must be called with the lock of the decoder held */
+static int ChromaSetup( filter_t *p_filter, vlc_va_sys_t *p_va,
+                        unsigned int i_generation )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_va == p_va && p_sys->i_generation == i_generation )
+        return VLC_SUCCESS;
+
+    ChromaClean( p_sys );
+    if( i_generation != p_va->i_surface_generation )
+        return VLC_EGENERIC;
+
+    if( !p_va->b_supports_derive &&
+        vaCreateImage( p_va->p_display, &p_va->image_format,
+                       p_va->i_surface_width, p_va->i_surface_height,
+                       &p_sys->image ) )
+    {
+        msg_Err( p_filter, "Failed to create a VA image" );
+        return VLC_EGENERIC;
+    }
+    if( CopyInitCache( &p_sys->cache, p_va->i_surface_width,
+                       p_va->i_copy_threads ) )
+    {
+        if( p_sys->image.image_id != VA_INVALID_ID )
+            vaDestroyImage( p_va->p_display, p_sys->image.image_id );
+        p_sys->image.image_id = VA_INVALID_ID;
+        return VLC_EGENERIC;
+    }
+
+    vlc_atomic_inc( &p_va->refs );
+    p_sys->p_va = p_va;
+    p_sys->i_generation = i_generation;
+    return VLC_SUCCESS;
+}
+
+static picture_t *ChromaFilter( filter_t *p_filter, picture_t *p_src )
+{
+    vlc_va_opaque_t *p_opaque = (vlc_va_opaque_t *)p_src->context;
+    picture_t *p_dst = NULL;
+
+    if( p_opaque )
+        p_dst = filter_NewPicture( p_filter );
+    if( !p_dst )
+    {
+        picture_Release( p_src );
+        return NULL;
+    }
+
+    vlc_va_sys_t *p_va = p_opaque->p_va;
+    filter_sys_t *p_sys = p_filter->p_sys;
+    int i_ret;
+
+    vlc_mutex_lock( &p_va->lock );
+    i_ret = ChromaSetup( p_filter, p_va, p_opaque->i_generation );
+    if( !i_ret )
+        i_ret = CopySurface( p_va, p_opaque->i_id, &p_sys->image,
+                             &p_sys->cache, p_dst );
+    vlc_mutex_unlock( &p_va->lock );
+
+    if( i_ret )
+    {
+        picture_Release( p_dst );
+        picture_Release( p_src );
+        return NULL;
+    }
+    picture_CopyProperties( p_dst, p_src );
+    picture_Release( p_src );
+    return p_dst;
+}
+
+static int OpenChroma( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    /* The copy functions output YV12 */
+    if( p_filter->fmt_in.video.i_chroma != VLC_CODEC_VAAPI_OPAQUE ||
+        p_filter->fmt_out.video.i_chroma != VLC_CODEC_YV12 )
+        return VLC_EGENERIC;
+    if( p_filter->fmt_in.video.i_width != p_filter->fmt_out.video.i_width ||
+        p_filter->fmt_in.video.i_height != p_filter->fmt_out.video.i_height )
+        return VLC_EGENERIC;
+
+    filter_sys_t *p_sys = malloc( sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+    p_sys->p_va = NULL;
+    p_sys->image.image_id = VA_INVALID_ID;
+
+    p_filter->p_sys = p_sys;
+    p_filter->pf_video_filter = ChromaFilter;
+    return VLC_SUCCESS;
+}
+
+static void CloseChroma( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_va )
+    {
+        vlc_va_sys_t *p_va = p_sys->p_va;
+
+        vlc_mutex_lock( &p_va->lock );
+        vlc_atomic_inc( &p_va->refs );
+        ChromaClean( p_sys );
+        vlc_mutex_unlock( &p_va->lock );
+        Unref( p_va );
+    }
+    free( p_sys );
+}
+#endif
@@ -0,0 +1,1083 @@
+/*****************************************************************************
+ * vaapi_enc.c: VAAPI H.264 encoder
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_codec.h>
+#include <vlc_bits.h>
+#include <vlc_xlib.h>
+
+#include <X11/Xlib.h>
+#include <va/va_x11.h>
+#include <va/va_enc_h264.h>
+#ifdef HAVE_VA_VA_VPP_H
+# include <va/va_vpp.h>
+#endif
+#ifdef HAVE_VA_GLX
+# include <vlc_opengl.h>
+#endif
+
+#include "va_surface.h"
+
+/* The surfaces of the decoder are scaled into the input surface by the
+ * video processing pipeline, they never reach the system memory */
+#if defined(HAVE_VA_GLX) && defined(HAVE_VA_VA_VPP_H)
+# define CAN_ENCODE_OPAQUE 1
+#endif
+
+static const char *const ppsz_enc_options[] = {
+    "keyint", "qp", "profile", NULL
+};
+
+/* Input picture, then the two reconstructed pictures used in turn as the
+ * reference of the next P frame */
+#define SURFACE_INPUT  0
+#define SURFACE_RECON  1
+#define SURFACE_COUNT  3
+
+/* Sequence, rate control, packed SPS and PPS, picture and slice */
+#define BUFFER_MAX     8
+
+#define LOG2_MAX_FRAME_NUM 8
+
+struct encoder_sys_t
+{
+    /* Display of the decoder, or own display for the uploaded pictures */
+    struct vlc_va_sys_t *p_va;
+    Display      *p_display_x11;
+    VADisplay     p_display;
+
+    VAProfile     i_profile;
+    int           i_profile_idc;
+    int           i_level_idc;
+    VAConfigID    i_config_id;
+    VAContextID   i_context_id;
+    VASurfaceID   pi_surface[SURFACE_COUNT];
+    VABufferID    i_coded;
+    bool          b_packed_headers;
+
+    VAConfigID    i_vpp_config_id;
+    VAContextID   i_vpp_context_id;
+
+    /* Upload of the pictures in system memory */
+    bool          b_supports_derive;
+    VAImage       image;
+
+    VABufferID    pi_buffer[BUFFER_MAX];
+    unsigned      i_buffer;
+
+    /* Coding parameters */
+    unsigned      i_width;
+    unsigned      i_height;
+    unsigned      i_width_mbs;
+    unsigned      i_height_mbs;
+    unsigned      i_keyint;
+    int           i_qp;
+    unsigned      i_bitrate;
+
+    /* Frames since the last IDR frame */
+    unsigned      i_gop;
+    unsigned      i_idr_pic_id;
+    bool          b_error;
+
+    /* Annex B parameter sets */
+    uint8_t       p_sps[80];
+    size_t        i_sps;
+    uint8_t       p_pps[16];
+    size_t        i_pps;
+};
+
+static block_t *Encode( encoder_t *, picture_t * );
+
+/*****************************************************************************
+ * Parameter sets
+ *****************************************************************************/
+static void bs_write_ue( bs_t *s, uint32_t i_val )
+{
+    int i_size = 0;
+
+    i_val++;
+    for( uint32_t i_tmp = i_val; i_tmp > 1; i_tmp >>= 1 )
+        i_size++;
+    bs_write( s, i_size, 0 );
+    bs_write( s, i_size + 1, i_val );
+}
+
+static void bs_write_se( bs_t *s, int i_val )
+{
+    bs_write_ue( s, i_val > 0 ? 2 * i_val - 1 : -2 * i_val );
+}
+
+/* Wraps a RBSP into an Annex B NAL unit */
+static size_t WriteNal( uint8_t *p_nal, int i_type,
+                        const uint8_t *p_rbsp, size_t i_rbsp )
+{
+    size_t i_nal = 0;
+    unsigned i_zeros = 0;
+
+    p_nal[i_nal++] = 0x00;
+    p_nal[i_nal++] = 0x00;
+    p_nal[i_nal++] = 0x00;
+    p_nal[i_nal++] = 0x01;
+    p_nal[i_nal++] = (3 << 5) | i_type;
+    for( size_t i = 0; i < i_rbsp; i++ )
+    {
+        if( i_zeros == 2 && p_rbsp[i] <= 0x03 )
+        {
+            p_nal[i_nal++] = 0x03;
+            i_zeros = 0;
+        }
+        i_zeros = p_rbsp[i] ? 0 : i_zeros + 1;
+        p_nal[i_nal++] = p_rbsp[i];
+    }
+    return i_nal;
+}
+
+static void WriteParameterSets( encoder_t *p_enc )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    const video_format_t *p_fmt = &p_enc->fmt_out.video;
+    const bool b_high = p_sys->i_profile_idc >= 100;
+    uint8_t p_rbsp[48];
+    bs_t s;
+
+    /* Sequence parameter set */
+    memset( p_rbsp, 0, sizeof(p_rbsp) );
+    bs_init( &s, p_rbsp, sizeof(p_rbsp) );
+    bs_write( &s, 8, p_sys->i_profile_idc );
+    bs_write( &s, 8, 0 );                           /* constraint flags */
+    bs_write( &s, 8, p_sys->i_level_idc );
+    bs_write_ue( &s, 0 );                           /* sps id */
+    if( b_high )
+    {
+        bs_write_ue( &s, 1 );                       /* 4:2:0 */
+        bs_write_ue( &s, 0 );                       /* 8 bits luma */
+        bs_write_ue( &s, 0 );                       /* 8 bits chroma */
+        bs_write( &s, 1, 0 );
+        bs_write( &s, 1, 0 );                       /* no scaling matrix */
+    }
+    bs_write_ue( &s, LOG2_MAX_FRAME_NUM - 4 );
+    bs_write_ue( &s, 2 );                           /* POC from frame_num */
+    bs_write_ue( &s, 1 );                           /* max_num_ref_frames */
+    bs_write( &s, 1, 0 );
+    bs_write_ue( &s, p_sys->i_width_mbs - 1 );
+    bs_write_ue( &s, p_sys->i_height_mbs - 1 );
+    bs_write( &s, 1, 1 );                           /* frame_mbs_only */
+    bs_write( &s, 1, 1 );                           /* direct_8x8_inference */
+    if( p_sys->i_width % 16 || p_sys->i_height % 16 )
+    {
+        bs_write( &s, 1, 1 );
+        bs_write_ue( &s, 0 );
+        bs_write_ue( &s, (16 * p_sys->i_width_mbs - p_sys->i_width) / 2 );
+        bs_write_ue( &s, 0 );
+        bs_write_ue( &s, (16 * p_sys->i_height_mbs - p_sys->i_height) / 2 );
+    }
+    else
+        bs_write( &s, 1, 0 );
+    bs_write( &s, 1, 1 );                           /* VUI */
+    if( p_fmt->i_sar_num > 0 && p_fmt->i_sar_den > 0 )
+    {
+        bs_write( &s, 1, 1 );
+        bs_write( &s, 8, 255 );                     /* Extended_SAR */
+        bs_write( &s, 16, p_fmt->i_sar_num );
+        bs_write( &s, 16, p_fmt->i_sar_den );
+    }
+    else
+        bs_write( &s, 1, 0 );
+    bs_write( &s, 1, 0 );                           /* overscan */
+    bs_write( &s, 1, 0 );                           /* video signal type */
+    bs_write( &s, 1, 0 );                           /* chroma location */
+    bs_write( &s, 1, 1 );                           /* timing */
+    bs_write( &s, 32, p_fmt->i_frame_rate_base );
+    bs_write( &s, 32, 2 * p_fmt->i_frame_rate );
+    bs_write( &s, 1, 1 );                           /* fixed frame rate */
+    bs_write( &s, 1, 0 );                           /* NAL HRD */
+    bs_write( &s, 1, 0 );                           /* VCL HRD */
+    bs_write( &s, 1, 0 );                           /* pic_struct */
+    bs_write( &s, 1, 0 );                           /* bitstream restriction */
+    bs_write( &s, 1, 1 );
+    bs_align_0( &s );
+    p_sys->i_sps = WriteNal( p_sys->p_sps, 7, p_rbsp, s.p - s.p_start );
+
+    /* Picture parameter set */
+    memset( p_rbsp, 0, sizeof(p_rbsp) );
+    bs_init( &s, p_rbsp, sizeof(p_rbsp) );
+    bs_write_ue( &s, 0 );                           /* pps id */
+    bs_write_ue( &s, 0 );                           /* sps id */
+    bs_write( &s, 1, 1 );                           /* CABAC */
+    bs_write( &s, 1, 0 );
+    bs_write_ue( &s, 0 );                           /* slice groups */
+    bs_write_ue( &s, 0 );                           /* L0 references */
+    bs_write_ue( &s, 0 );                           /* L1 references */
+    bs_write( &s, 1, 0 );                           /* weighted prediction */
+    bs_write( &s, 2, 0 );
+    bs_write_se( &s, p_sys->i_qp - 26 );
+    bs_write_se( &s, 0 );
+    bs_write_se( &s, 0 );                           /* chroma QP offset */
+    bs_write( &s, 1, 1 );                           /* deblocking control */
+    bs_write( &s, 1, 0 );                           /* constrained intra */
+    bs_write( &s, 1, 0 );                           /* redundant_pic_cnt */
+    if( b_high )
+    {
+        bs_write( &s, 1, 1 );                       /* 8x8 transform */
+        bs_write( &s, 1, 0 );                       /* no scaling matrix */
+        bs_write_se( &s, 0 );
+    }
+    bs_write( &s, 1, 1 );
+    bs_align_0( &s );
+    p_sys->i_pps = WriteNal( p_sys->p_pps, 8, p_rbsp, s.p - s.p_start );
+}
+
+/* Lowest level allowing the frame size, the frame rate is not checked */
+static int LevelIdc( unsigned i_mbs )
+{
+    if( i_mbs <= 1620 )
+        return 30;
+    if( i_mbs <= 3600 )
+        return 31;
+    if( i_mbs <= 5120 )
+        return 32;
+    if( i_mbs <= 8192 )
+        return 41;
+    if( i_mbs <= 22080 )
+        return 51;
+    return 52;
+}
+
+/*****************************************************************************
+ * Pipeline
+ *****************************************************************************/
+static int FindProfile( encoder_t *p_enc, const char *psz_profile )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    const VAProfile pi_candidate[] = { VAProfileH264High, VAProfileH264Main };
+    const int pi_idc[] = { 100, 77 };
+    unsigned i_first = psz_profile && !strcmp( psz_profile, "main" ) ? 1 : 0;
+
+    int i_count = vaMaxNumEntrypoints( p_sys->p_display );
+    VAEntrypoint *p_entrypoint = calloc( i_count, sizeof(*p_entrypoint) );
+    if( !p_entrypoint )
+        return VLC_ENOMEM;
+
+    for( unsigned i = i_first; i < ARRAY_SIZE(pi_candidate); i++ )
+    {
+        int i_found = i_count;
+
+        if( vaQueryConfigEntrypoints( p_sys->p_display, pi_candidate[i],
+                                      p_entrypoint, &i_found ) )
+            continue;
+        for( int j = 0; j < i_found; j++ )
+        {
+            if( p_entrypoint[j] != VAEntrypointEncSlice )
+                continue;
+            p_sys->i_profile = pi_candidate[i];
+            p_sys->i_profile_idc = pi_idc[i];
+            free( p_entrypoint );
+            return VLC_SUCCESS;
+        }
+    }
+    free( p_entrypoint );
+    msg_Err( p_enc, "the hardware cannot encode H.264" );
+    return VLC_EGENERIC;
+}
+
+static void DestroyPipeline( encoder_sys_t *p_sys )
+{
+    VADisplay p_display = p_sys->p_display;
+
+    if( p_sys->image.image_id != VA_INVALID_ID )
+        vaDestroyImage( p_display, p_sys->image.image_id );
+    if( p_sys->i_vpp_context_id != VA_INVALID_ID )
+        vaDestroyContext( p_display, p_sys->i_vpp_context_id );
+    if( p_sys->i_vpp_config_id != VA_INVALID_ID )
+        vaDestroyConfig( p_display, p_sys->i_vpp_config_id );
+    if( p_sys->i_coded != VA_INVALID_ID )
+        vaDestroyBuffer( p_display, p_sys->i_coded );
+    if( p_sys->i_context_id != VA_INVALID_ID )
+        vaDestroyContext( p_display, p_sys->i_context_id );
+    if( p_sys->pi_surface[0] != VA_INVALID_SURFACE )
+        vaDestroySurfaces( p_display, p_sys->pi_surface, SURFACE_COUNT );
+    if( p_sys->i_config_id != VA_INVALID_ID )
+        vaDestroyConfig( p_display, p_sys->i_config_id );
+
+    p_sys->image.image_id = VA_INVALID_ID;
+    p_sys->i_vpp_context_id = VA_INVALID_ID;
+    p_sys->i_vpp_config_id = VA_INVALID_ID;
+    p_sys->i_coded = VA_INVALID_ID;
+    p_sys->i_context_id = VA_INVALID_ID;
+    p_sys->pi_surface[0] = VA_INVALID_SURFACE;
+    p_sys->i_config_id = VA_INVALID_ID;
+}
+
+static int CreateUpload( encoder_t *p_enc )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    VADisplay p_display = p_sys->p_display;
+    VAImage test_image;
+
+    if( vaDeriveImage( p_display, p_sys->pi_surface[SURFACE_INPUT],
+                       &test_image ) == VA_STATUS_SUCCESS )
+    {
+        p_sys->b_supports_derive =
+            test_image.format.fourcc == VA_FOURCC( 'N', 'V', '1', '2' );
+        vaDestroyImage( p_display, test_image.image_id );
+        if( p_sys->b_supports_derive )
+            return VLC_SUCCESS;
+    }
+
+    int i_fmt_count = vaMaxNumImageFormats( p_display );
+    VAImageFormat *p_fmt = calloc( i_fmt_count, sizeof(*p_fmt) );
+    if( !p_fmt )
+        return VLC_ENOMEM;
+
+    int i_ret = VLC_EGENERIC;
+    if( !vaQueryImageFormats( p_display, p_fmt, &i_fmt_count ) )
+    {
+        for( int i = 0; i < i_fmt_count; i++ )
+        {
+            if( p_fmt[i].fourcc != VA_FOURCC( 'N', 'V', '1', '2' ) )
+                continue;
+            if( !vaCreateImage( p_display, &p_fmt[i], 16 * p_sys->i_width_mbs,
+                                16 * p_sys->i_height_mbs, &p_sys->image ) )
+                i_ret = VLC_SUCCESS;
+            else
+                p_sys->image.image_id = VA_INVALID_ID;
+            break;
+        }
+    }
+    free( p_fmt );
+    if( i_ret )
+        msg_Err( p_enc, "cannot upload NV12 pictures" );
+    return i_ret;
+}
+
+static int CreatePipeline( encoder_t *p_enc, const char *psz_profile,
+                           bool b_opaque )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    VADisplay p_display = p_sys->p_display;
+    const unsigned i_width = 16 * p_sys->i_width_mbs;
+    const unsigned i_height = 16 * p_sys->i_height_mbs;
+
+    if( FindProfile( p_enc, psz_profile ) )
+        return VLC_EGENERIC;
+
+    VAConfigAttrib p_attrib[3] = {
+        { .type = VAConfigAttribRTFormat },
+        { .type = VAConfigAttribRateControl },
+        { .type = VAConfigAttribEncPackedHeaders },
+    };
+    if( vaGetConfigAttributes( p_display, p_sys->i_profile,
+                               VAEntrypointEncSlice, p_attrib, 3 ) )
+        return VLC_EGENERIC;
+
+    if( !(p_attrib[0].value & VA_RT_FORMAT_YUV420) )
+    {
+        msg_Err( p_enc, "the hardware cannot encode 4:2:0 pictures" );
+        return VLC_EGENERIC;
+    }
+    p_attrib[0].value = VA_RT_FORMAT_YUV420;
+
+    if( p_sys->i_bitrate > 0 && !(p_attrib[1].value & VA_RC_CBR) )
+    {
+        msg_Warn( p_enc, "constant bitrate not supported, using a constant "
+                  "quantizer" );
+        p_sys->i_bitrate = 0;
+    }
+    if( p_sys->i_bitrate == 0 && !(p_attrib[1].value & VA_RC_CQP) )
+    {
+        msg_Err( p_enc, "constant quantizer not supported" );
+        return VLC_EGENERIC;
+    }
+    p_attrib[1].value = p_sys->i_bitrate > 0 ? VA_RC_CBR : VA_RC_CQP;
+
+    /* Without packed headers, the driver writes its own parameter sets */
+    const uint32_t i_packed = VA_ENC_PACKED_HEADER_SEQUENCE |
+                              VA_ENC_PACKED_HEADER_PICTURE;
+    p_sys->b_packed_headers = p_attrib[2].value != VA_ATTRIB_NOT_SUPPORTED &&
+                              (p_attrib[2].value & i_packed) == i_packed;
+    p_attrib[2].value = i_packed;
+    if( p_sys->b_packed_headers )
+        WriteParameterSets( p_enc );
+
+    if( vaCreateConfig( p_display, p_sys->i_profile, VAEntrypointEncSlice,
+                        p_attrib, p_sys->b_packed_headers ? 3 : 2,
+                        &p_sys->i_config_id ) )
+    {
+        p_sys->i_config_id = VA_INVALID_ID;
+        return VLC_EGENERIC;
+    }
+
+#if VA_CHECK_VERSION(0,34,0)
+    if( vaCreateSurfaces( p_display, VA_RT_FORMAT_YUV420, i_width, i_height,
+                          p_sys->pi_surface, SURFACE_COUNT, NULL, 0 ) )
+#else
+    if( vaCreateSurfaces( p_display, i_width, i_height, VA_RT_FORMAT_YUV420,
+                          SURFACE_COUNT, p_sys->pi_surface ) )
+#endif
+    {
+        p_sys->pi_surface[0] = VA_INVALID_SURFACE;
+        goto error;
+    }
+    if( vaCreateContext( p_display, p_sys->i_config_id, i_width, i_height,
+                         VA_PROGRESSIVE, p_sys->pi_surface, SURFACE_COUNT,
+                         &p_sys->i_context_id ) )
+    {
+        p_sys->i_context_id = VA_INVALID_ID;
+        goto error;
+    }
+
+    /* A coded frame hardly ever reaches twice the size of the raw one */
+    if( vaCreateBuffer( p_display, p_sys->i_context_id, VAEncCodedBufferType,
+                        3 * i_width * i_height, 1, NULL, &p_sys->i_coded ) )
+    {
+        p_sys->i_coded = VA_INVALID_ID;
+        goto error;
+    }
+
+#ifdef CAN_ENCODE_OPAQUE
+    if( b_opaque )
+    {
+        if( vaCreateConfig( p_display, VAProfileNone, VAEntrypointVideoProc,
+                            NULL, 0, &p_sys->i_vpp_config_id ) )
+        {
+            p_sys->i_vpp_config_id = VA_INVALID_ID;
+            msg_Err( p_enc, "the hardware cannot scale the decoded surfaces" );
+            goto error;
+        }
+        if( vaCreateContext( p_display, p_sys->i_vpp_config_id,
+                             i_width, i_height, VA_PROGRESSIVE,
+                             &p_sys->pi_surface[SURFACE_INPUT], 1,
+                             &p_sys->i_vpp_context_id ) )
+        {
+            p_sys->i_vpp_context_id = VA_INVALID_ID;
+            goto error;
+        }
+    }
+    else
+#else
+    assert( !b_opaque );
+#endif
+    if( CreateUpload( p_enc ) )
+        goto error;
+
+    msg_Dbg( p_enc, "encoding %ux%u H.264 (profile_idc %d) with %s",
+             p_sys->i_width, p_sys->i_height, p_sys->i_profile_idc,
+             vaQueryVendorString( p_display ) );
+    return VLC_SUCCESS;
+
+error:
+    DestroyPipeline( p_sys );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Input pictures
+ *****************************************************************************/
+static void CopyToNv12( uint8_t *p_base, const VAImage *p_image,
+                        const picture_t *p_pic )
+{
+    const plane_t *p_y = &p_pic->p[0];
+    const int i_lines = __MIN( p_y->i_visible_lines, p_image->height );
+    const int i_pitch = __MIN( p_y->i_visible_pitch, p_image->width );
+    uint8_t *p_dst = p_base + p_image->offsets[0];
+
+    for( int y = 0; y < i_lines; y++ )
+        memcpy( &p_dst[y * p_image->pitches[0]],
+                &p_y->p_pixels[y * p_y->i_pitch], i_pitch );
+
+    p_dst = p_base + p_image->offsets[1];
+    if( p_pic->i_planes == 2 )
+    {
+        const plane_t *p_uv = &p_pic->p[1];
+
+        for( int y = 0; y < i_lines / 2; y++ )
+            memcpy( &p_dst[y * p_image->pitches[1]],
+                    &p_uv->p_pixels[y * p_uv->i_pitch], i_pitch );
+        return;
+    }
+
+    const plane_t *p_u = &p_pic->p[1];
+    const plane_t *p_v = &p_pic->p[2];
+    for( int y = 0; y < i_lines / 2; y++ )
+    {
+        uint8_t *p_line = &p_dst[y * p_image->pitches[1]];
+        const uint8_t *p_ul = &p_u->p_pixels[y * p_u->i_pitch];
+        const uint8_t *p_vl = &p_v->p_pixels[y * p_v->i_pitch];
+
+        for( int x = 0; x < i_pitch / 2; x++ )
+        {
+            p_line[2 * x]     = p_ul[x];
+            p_line[2 * x + 1] = p_vl[x];
+        }
+    }
+}
+
+static int Upload( encoder_t *p_enc, const picture_t *p_pic )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    VADisplay p_display = p_sys->p_display;
+    const VASurfaceID i_surface = p_sys->pi_surface[SURFACE_INPUT];
+    VAImage image;
+    void *p_base;
+
+    if( p_sys->b_supports_derive )
+    {
+        if( vaDeriveImage( p_display, i_surface, &image ) )
+            return VLC_EGENERIC;
+    }
+    else
+        image = p_sys->image;
+
+    int i_ret = VLC_EGENERIC;
+    if( !vaMapBuffer( p_display, image.buf, &p_base ) )
+    {
+        CopyToNv12( p_base, &image, p_pic );
+        if( !vaUnmapBuffer( p_display, image.buf ) )
+            i_ret = VLC_SUCCESS;
+    }
+
+    if( p_sys->b_supports_derive )
+        vaDestroyImage( p_display, image.image_id );
+    else if( !i_ret && vaPutImage( p_display, i_surface, image.image_id,
+                                   0, 0, image.width, image.height,
+                                   0, 0, image.width, image.height ) )
+        i_ret = VLC_EGENERIC;
+    return i_ret;
+}
+
+#ifdef CAN_ENCODE_OPAQUE
+static int Scale( encoder_t *p_enc, const vlc_va_opaque_t *p_opaque,
+                  const picture_t *p_pic )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    VADisplay p_display = p_sys->p_display;
+    const video_format_t *p_fmt = &p_pic->format;
+    VARectangle src = {
+        .x = p_fmt->i_x_offset,
+        .y = p_fmt->i_y_offset,
+        .width = p_fmt->i_visible_width ? p_fmt->i_visible_width
+                                        : p_fmt->i_width,
+        .height = p_fmt->i_visible_height ? p_fmt->i_visible_height
+                                          : p_fmt->i_height,
+    };
+    VARectangle dst = {
+        .x = 0, .y = 0, .width = p_sys->i_width, .height = p_sys->i_height,
+    };
+    VAProcPipelineParameterBuffer param;
+    VABufferID i_param;
+    int i_ret = VLC_EGENERIC;
+
+    memset( &param, 0, sizeof(param) );
+    param.surface = p_opaque->i_id;
+    param.surface_region = &src;
+    param.output_region = &dst;
+    param.output_background_color = 0xff000000;
+    param.filter_flags = VA_FILTER_SCALING_HQ;
+
+    if( vaCreateBuffer( p_display, p_sys->i_vpp_context_id,
+                        VAProcPipelineParameterBufferType, sizeof(param), 1,
+                        &param, &i_param ) )
+        return VLC_EGENERIC;
+
+    /* The decoder must not destroy the surface while it is being read */
+    if( !VaapiLockSurface( p_opaque ) )
+    {
+        if( !vaBeginPicture( p_display, p_sys->i_vpp_context_id,
+                             p_sys->pi_surface[SURFACE_INPUT] ) )
+        {
+            i_ret = vaRenderPicture( p_display, p_sys->i_vpp_context_id,
+                                     &i_param, 1 ) ? VLC_EGENERIC : VLC_SUCCESS;
+            if( vaEndPicture( p_display, p_sys->i_vpp_context_id ) ||
+                vaSyncSurface( p_display, p_sys->pi_surface[SURFACE_INPUT] ) )
+                i_ret = VLC_EGENERIC;
+        }
+        VaapiUnlockSurface( p_opaque );
+    }
+    vaDestroyBuffer( p_display, i_param );
+    return i_ret;
+}
+#endif
+
+/*****************************************************************************
+ * Encoding
+ *****************************************************************************/
+static int AddBuffer( encoder_t *p_enc, VABufferType i_type,
+                      void *p_data, size_t i_size )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+
+    assert( p_sys->i_buffer < BUFFER_MAX );
+    if( vaCreateBuffer( p_sys->p_display, p_sys->i_context_id, i_type,
+                        i_size, 1, p_data, &p_sys->pi_buffer[p_sys->i_buffer] ) )
+        return VLC_EGENERIC;
+    p_sys->i_buffer++;
+    return VLC_SUCCESS;
+}
+
+static int AddPackedHeader( encoder_t *p_enc, unsigned i_type,
+                            uint8_t *p_data, size_t i_size )
+{
+    VAEncPackedHeaderParameterBuffer param = {
+        .type = i_type,
+        .bit_length = 8 * i_size,
+        .has_emulation_bytes = 1,
+    };
+
+    if( AddBuffer( p_enc, VAEncPackedHeaderParameterBufferType,
+                   &param, sizeof(param) ) )
+        return VLC_EGENERIC;
+    return AddBuffer( p_enc, VAEncPackedHeaderDataBufferType, p_data, i_size );
+}
+
+static int AddRateControl( encoder_t *p_enc )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    VAEncMiscParameterBuffer *p_misc;
+
+    if( AddBuffer( p_enc, VAEncMiscParameterBufferType, NULL,
+                   sizeof(*p_misc) + sizeof(VAEncMiscParameterRateControl) ) )
+        return VLC_EGENERIC;
+
+    VABufferID i_id = p_sys->pi_buffer[p_sys->i_buffer - 1];
+    if( vaMapBuffer( p_sys->p_display, i_id, (void **)&p_misc ) )
+        return VLC_EGENERIC;
+
+    VAEncMiscParameterRateControl *p_rc =
+        (VAEncMiscParameterRateControl *)p_misc->data;
+    p_misc->type = VAEncMiscParameterTypeRateControl;
+    memset( p_rc, 0, sizeof(*p_rc) );
+    p_rc->bits_per_second = p_sys->i_bitrate;
+    p_rc->target_percentage = 100;
+    p_rc->window_size = 1000;
+    p_rc->initial_qp = p_sys->i_qp;
+    return vaUnmapBuffer( p_sys->p_display, i_id ) ? VLC_EGENERIC
+                                                   : VLC_SUCCESS;
+}
+
+static void InvalidatePictures( VAPictureH264 *p_list, unsigned i_count )
+{
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        p_list[i].picture_id = VA_INVALID_SURFACE;
+        p_list[i].flags = VA_PICTURE_H264_INVALID;
+    }
+}
+
+static int QueueFrame( encoder_t *p_enc, bool b_idr )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    const video_format_t *p_fmt = &p_enc->fmt_out.video;
+    const unsigned i_frame_num = p_sys->i_gop % (1 << LOG2_MAX_FRAME_NUM);
+    VAPictureH264 curr, ref;
+
+    memset( &curr, 0, sizeof(curr) );
+    curr.picture_id = p_sys->pi_surface[SURFACE_RECON + (p_sys->i_gop & 1)];
+    curr.frame_idx = i_frame_num;
+    curr.TopFieldOrderCnt = curr.BottomFieldOrderCnt = 2 * p_sys->i_gop;
+
+    memset( &ref, 0, sizeof(ref) );
+    if( !b_idr )
+    {
+        ref.picture_id =
+            p_sys->pi_surface[SURFACE_RECON + ((p_sys->i_gop - 1) & 1)];
+        ref.frame_idx = (p_sys->i_gop - 1) % (1 << LOG2_MAX_FRAME_NUM);
+        ref.flags = VA_PICTURE_H264_SHORT_TERM_REFERENCE;
+        ref.TopFieldOrderCnt = ref.BottomFieldOrderCnt = 2 * p_sys->i_gop - 2;
+    }
+
+    if( b_idr )
+    {
+        VAEncSequenceParameterBufferH264 seq;
+
+        memset( &seq, 0, sizeof(seq) );
+        seq.level_idc = p_sys->i_level_idc;
+        seq.intra_period = p_sys->i_keyint;
+        seq.intra_idr_period = p_sys->i_keyint;
+        seq.ip_period = 1;
+        seq.bits_per_second = p_sys->i_bitrate;
+        seq.max_num_ref_frames = 1;
+        seq.picture_width_in_mbs = p_sys->i_width_mbs;
+        seq.picture_height_in_mbs = p_sys->i_height_mbs;
+        seq.seq_fields.bits.chroma_format_idc = 1;
+        seq.seq_fields.bits.frame_mbs_only_flag = 1;
+        seq.seq_fields.bits.direct_8x8_inference_flag = 1;
+        seq.seq_fields.bits.log2_max_frame_num_minus4 = LOG2_MAX_FRAME_NUM - 4;
+        seq.seq_fields.bits.pic_order_cnt_type = 2;
+        if( p_sys->i_width % 16 || p_sys->i_height % 16 )
+        {
+            seq.frame_cropping_flag = 1;
+            seq.frame_crop_right_offset =
+                (16 * p_sys->i_width_mbs - p_sys->i_width) / 2;
+            seq.frame_crop_bottom_offset =
+                (16 * p_sys->i_height_mbs - p_sys->i_height) / 2;
+        }
+        seq.vui_parameters_present_flag = 1;
+        seq.vui_fields.bits.timing_info_present_flag = 1;
+        seq.num_units_in_tick = p_fmt->i_frame_rate_base;
+        seq.time_scale = 2 * p_fmt->i_frame_rate;
+        if( p_fmt->i_sar_num > 0 && p_fmt->i_sar_den > 0 )
+        {
+            seq.vui_fields.bits.aspect_ratio_info_present_flag = 1;
+            seq.aspect_ratio_idc = 255;
+            seq.sar_width = p_fmt->i_sar_num;
+            seq.sar_height = p_fmt->i_sar_den;
+        }
+        if( AddBuffer( p_enc, VAEncSequenceParameterBufferType,
+                       &seq, sizeof(seq) ) )
+            return VLC_EGENERIC;
+        if( p_sys->i_bitrate > 0 && AddRateControl( p_enc ) )
+            return VLC_EGENERIC;
+        if( p_sys->b_packed_headers &&
+            ( AddPackedHeader( p_enc, VAEncPackedHeaderSequence,
+                               p_sys->p_sps, p_sys->i_sps ) ||
+              AddPackedHeader( p_enc, VAEncPackedHeaderPicture,
+                               p_sys->p_pps, p_sys->i_pps ) ) )
+            return VLC_EGENERIC;
+    }
+
+    VAEncPictureParameterBufferH264 pic;
+    memset( &pic, 0, sizeof(pic) );
+    pic.CurrPic = curr;
+    InvalidatePictures( pic.ReferenceFrames, ARRAY_SIZE(pic.ReferenceFrames) );
+    if( !b_idr )
+        pic.ReferenceFrames[0] = ref;
+    pic.coded_buf = p_sys->i_coded;
+    pic.frame_num = i_frame_num;
+    pic.pic_init_qp = p_sys->i_qp;
+    pic.pic_fields.bits.idr_pic_flag = b_idr;
+    pic.pic_fields.bits.reference_pic_flag = 1;
+    pic.pic_fields.bits.entropy_coding_mode_flag = 1;
+    pic.pic_fields.bits.transform_8x8_mode_flag = p_sys->i_profile_idc >= 100;
+    pic.pic_fields.bits.deblocking_filter_control_present_flag = 1;
+    if( AddBuffer( p_enc, VAEncPictureParameterBufferType, &pic, sizeof(pic) ) )
+        return VLC_EGENERIC;
+
+    VAEncSliceParameterBufferH264 slice;
+    memset( &slice, 0, sizeof(slice) );
+    slice.num_macroblocks = p_sys->i_width_mbs * p_sys->i_height_mbs;
+    slice.macroblock_info = VA_INVALID_ID;
+    slice.slice_type = b_idr ? 2 : 0;
+    slice.idr_pic_id = p_sys->i_idr_pic_id;
+    slice.direct_spatial_mv_pred_flag = 1;
+    InvalidatePictures( slice.RefPicList0, ARRAY_SIZE(slice.RefPicList0) );
+    InvalidatePictures( slice.RefPicList1, ARRAY_SIZE(slice.RefPicList1) );
+    if( !b_idr )
+        slice.RefPicList0[0] = ref;
+    if( AddBuffer( p_enc, VAEncSliceParameterBufferType,
+                   &slice, sizeof(slice) ) )
+        return VLC_EGENERIC;
+
+    VADisplay p_display = p_sys->p_display;
+    if( vaBeginPicture( p_display, p_sys->i_context_id,
+                        p_sys->pi_surface[SURFACE_INPUT] ) )
+        return VLC_EGENERIC;
+
+    int i_ret = VLC_SUCCESS;
+    if( vaRenderPicture( p_display, p_sys->i_context_id,
+                         p_sys->pi_buffer, p_sys->i_buffer ) )
+        i_ret = VLC_EGENERIC;
+    if( vaEndPicture( p_display, p_sys->i_context_id ) )
+        i_ret = VLC_EGENERIC;
+    return i_ret;
+}
+
+static block_t *ReadFrame( encoder_t *p_enc )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    VADisplay p_display = p_sys->p_display;
+    VACodedBufferSegment *p_segment;
+
+    if( vaSyncSurface( p_display, p_sys->pi_surface[SURFACE_INPUT] ) ||
+        vaMapBuffer( p_display, p_sys->i_coded, (void **)&p_segment ) )
+        return NULL;
+
+    size_t i_size = 0;
+    for( VACodedBufferSegment *p = p_segment; p; p = p->next )
+        i_size += p->size;
+
+    block_t *p_block = block_Alloc( i_size );
+    if( p_block )
+    {
+        uint8_t *p_dst = p_block->p_buffer;
+
+        for( VACodedBufferSegment *p = p_segment; p; p = p->next )
+        {
+            memcpy( p_dst, p->buf, p->size );
+            p_dst += p->size;
+        }
+    }
+    vaUnmapBuffer( p_display, p_sys->i_coded );
+    return p_block;
+}
+
+static block_t *EncodeFrame( encoder_t *p_enc, const picture_t *p_pic )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+    const video_format_t *p_fmt = &p_enc->fmt_out.video;
+
+    if( p_sys->i_gop >= p_sys->i_keyint )
+        p_sys->i_gop = 0;
+    const bool b_idr = p_sys->i_gop == 0;
+
+    p_sys->i_buffer = 0;
+    int i_ret = QueueFrame( p_enc, b_idr );
+    for( unsigned i = 0; i < p_sys->i_buffer; i++ )
+        vaDestroyBuffer( p_sys->p_display, p_sys->pi_buffer[i] );
+    if( i_ret )
+    {
+        msg_Err( p_enc, "cannot encode the picture" );
+        return NULL;
+    }
+
+    block_t *p_block = ReadFrame( p_enc );
+    if( !p_block )
+        return NULL;
+
+    /* Without B frames, the frames are output in display order */
+    p_block->i_flags |= b_idr ? BLOCK_FLAG_TYPE_I : BLOCK_FLAG_TYPE_P;
+    p_block->i_pts = p_block->i_dts = p_pic->date;
+    if( p_fmt->i_frame_rate > 0 )
+        p_block->i_length = INT64_C(1000000) * p_fmt->i_frame_rate_base /
+                            p_fmt->i_frame_rate;
+
+    if( b_idr )
+        p_sys->i_idr_pic_id = (p_sys->i_idr_pic_id + 1) % 65536;
+    p_sys->i_gop++;
+    return p_block;
+}
+
+static block_t *Encode( encoder_t *p_enc, picture_t *p_pic )
+{
+    encoder_sys_t *p_sys = p_enc->p_sys;
+
+    /* The frames are encoded one at a time, nothing is delayed */
+    if( !p_pic || p_sys->b_error )
+        return NULL;
+
+#ifdef CAN_ENCODE_OPAQUE
+    if( p_enc->fmt_in.i_codec == VLC_CODEC_VAAPI_OPAQUE )
+    {
+        vlc_va_opaque_t *p_opaque = (vlc_va_opaque_t *)p_pic->context;
+
+        if( !p_opaque )
+            return NULL;
+
+        /* The pipeline must live on the display of the decoder surfaces */
+        if( !p_sys->p_va )
+        {
+            char *psz_profile = var_GetString( p_enc, VAAPI_CFG_PREFIX
+                                                      "profile" );
+
+            p_sys->p_va = p_opaque->p_va;
+            p_sys->p_display = VaapiHoldDisplay( p_sys->p_va );
+            int i_ret = CreatePipeline( p_enc, psz_profile, true );
+            free( psz_profile );
+            if( i_ret )
+            {
+                msg_Err( p_enc, "cannot encode the decoded surfaces, "
+                         "disable vaapi-opaque" );
+                p_sys->b_error = true;
+                return NULL;
+            }
+        }
+        else if( p_opaque->p_va != p_sys->p_va )
+        {
+            msg_Err( p_enc, "surfaces of another decoder" );
+            return NULL;
+        }
+
+        if( Scale( p_enc, p_opaque, p_pic ) )
+        {
+            msg_Warn( p_enc, "cannot scale the surface, dropping frame" );
+            return NULL;
+        }
+    }
+    else
+#endif
+    if( Upload( p_enc, p_pic ) )
+    {
+        msg_Warn( p_enc, "cannot upload the picture, dropping frame" );
+        return NULL;
+    }
+
+    return EncodeFrame( p_enc, p_pic );
+}
+
+/*****************************************************************************
+ * Open/Close
+ *****************************************************************************/
+int OpenVaapiEncoder( vlc_object_t *p_this )
+{
+    encoder_t *p_enc = (encoder_t *)p_this;
+    const video_format_t *p_in = &p_enc->fmt_in.video;
+    video_format_t *p_out = &p_enc->fmt_out.video;
+
+    if( p_enc->fmt_out.i_codec != VLC_CODEC_H264 && !p_enc->b_force )
+        return VLC_EGENERIC;
+
+#ifdef CAN_ENCODE_OPAQUE
+    const bool b_opaque = p_enc->fmt_in.i_codec == VLC_CODEC_VAAPI_OPAQUE;
+#else
+    const bool b_opaque = false;
+#endif
+    if( !b_opaque && !vlc_xlib_init( p_this ) )
+    {
+        msg_Warn( p_enc, "Ignoring VA API" );
+        return VLC_EGENERIC;
+    }
+
+    encoder_sys_t *p_sys = calloc( 1, sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+    p_enc->p_sys = p_sys;
+
+    config_ChainParse( p_enc, VAAPI_CFG_PREFIX, ppsz_enc_options,
+                       p_enc->p_cfg );
+
+    /* Opaque pictures are scaled to the output size on the GPU */
+    if( !p_out->i_visible_width || !p_out->i_visible_height )
+    {
+        p_out->i_visible_width = p_in->i_visible_width ? p_in->i_visible_width
+                                                       : p_in->i_width;
+        p_out->i_visible_height = p_in->i_visible_height
+                                ? p_in->i_visible_height : p_in->i_height;
+    }
+    if( !p_out->i_frame_rate || !p_out->i_frame_rate_base )
+    {
+        p_out->i_frame_rate = p_in->i_frame_rate;
+        p_out->i_frame_rate_base = p_in->i_frame_rate_base;
+    }
+    if( !p_out->i_sar_num || !p_out->i_sar_den )
+    {
+        p_out->i_sar_num = p_in->i_sar_num;
+        p_out->i_sar_den = p_in->i_sar_den;
+    }
+    /* The VUI stores the aspect ratio on 16 bits */
+    vlc_ureduce( &p_out->i_sar_num, &p_out->i_sar_den,
+                 p_out->i_sar_num, p_out->i_sar_den, 65535 );
+    p_sys->i_width = p_out->i_visible_width & ~1;
+    p_sys->i_height = p_out->i_visible_height & ~1;
+    p_sys->i_width_mbs = (p_sys->i_width + 15) / 16;
+    p_sys->i_height_mbs = (p_sys->i_height + 15) / 16;
+    p_sys->i_level_idc = LevelIdc( p_sys->i_width_mbs * p_sys->i_height_mbs );
+    if( p_sys->i_width == 0 || p_sys->i_height == 0 ||
+        !p_out->i_frame_rate || !p_out->i_frame_rate_base )
+    {
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    p_sys->i_keyint = var_GetInteger( p_enc, VAAPI_CFG_PREFIX "keyint" );
+    p_sys->i_qp = var_GetInteger( p_enc, VAAPI_CFG_PREFIX "qp" );
+    p_sys->i_bitrate = p_enc->fmt_out.i_bitrate;
+    if( p_sys->i_keyint == 0 )
+        p_sys->i_keyint = 1;
+    if( p_sys->i_qp <= 0 || p_sys->i_qp > 51 )
+        p_sys->i_qp = 26;
+
+    p_sys->i_config_id = VA_INVALID_ID;
+    p_sys->i_context_id = VA_INVALID_ID;
+    p_sys->pi_surface[0] = VA_INVALID_SURFACE;
+    p_sys->i_coded = VA_INVALID_ID;
+    p_sys->i_vpp_config_id = VA_INVALID_ID;
+    p_sys->i_vpp_context_id = VA_INVALID_ID;
+    p_sys->image.image_id = VA_INVALID_ID;
+
+    if( !b_opaque )
+    {
+        int i_major, i_minor;
+        char *psz_profile;
+
+        p_sys->p_display_x11 = XOpenDisplay( NULL );
+        if( !p_sys->p_display_x11 )
+        {
+            msg_Warn( p_enc, "Could not connect to X server" );
+            goto error;
+        }
+        p_sys->p_display = vaGetDisplay( p_sys->p_display_x11 );
+        if( !p_sys->p_display ||
+            vaInitialize( p_sys->p_display, &i_major, &i_minor ) )
+        {
+            msg_Warn( p_enc, "Failed to initialize the VA display" );
+            goto error;
+        }
+
+        psz_profile = var_GetString( p_enc, VAAPI_CFG_PREFIX "profile" );
+        int i_ret = CreatePipeline( p_enc, psz_profile, false );
+        free( psz_profile );
+        if( i_ret )
+            goto error;
+
+        /* The pictures are uploaded as NV12 */
+        if( p_enc->fmt_in.i_codec != VLC_CODEC_NV12 )
+            p_enc->fmt_in.i_codec = VLC_CODEC_I420;
+    }
+
+    p_enc->fmt_out.i_cat = VIDEO_ES;
+    p_enc->fmt_out.i_codec = VLC_CODEC_H264;
+    p_enc->pf_encode_video = Encode;
+
+    /* The parameter sets are only known in advance when they are ours. The
+     * display of the decoder, hence its capabilities, only comes with the
+     * first opaque picture: they are then sent in-band only. */
+    if( p_sys->b_packed_headers )
+    {
+        p_enc->fmt_out.i_extra = p_sys->i_sps + p_sys->i_pps;
+        p_enc->fmt_out.p_extra = malloc( p_enc->fmt_out.i_extra );
+        if( p_enc->fmt_out.p_extra )
+        {
+            memcpy( p_enc->fmt_out.p_extra, p_sys->p_sps, p_sys->i_sps );
+            memcpy( (uint8_t *)p_enc->fmt_out.p_extra + p_sys->i_sps,
+                    p_sys->p_pps, p_sys->i_pps );
+        }
+        else
+            p_enc->fmt_out.i_extra = 0;
+    }
+    return VLC_SUCCESS;
+
+error:
+    CloseVaapiEncoder( p_this );
+    return VLC_EGENERIC;
+}
+
+void CloseVaapiEncoder( vlc_object_t *p_this )
+{
+    encoder_t *p_enc = (encoder_t *)p_this;
+    encoder_sys_t *p_sys = p_enc->p_sys;
+
+    if( p_sys->p_display )
+        DestroyPipeline( p_sys );
+#ifdef CAN_ENCODE_OPAQUE
+    if( p_sys->p_va )
+        VaapiReleaseDisplay( p_sys->p_va );
+    else
+#endif
+    if( p_sys->p_display )
+        vaTerminate( p_sys->p_display );
+    if( p_sys->p_display_x11 )
+        XCloseDisplay( p_sys->p_display_x11 );
+    free( p_sys );
+}
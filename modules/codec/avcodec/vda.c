@@ -175,7 +175,8 @@ static int Setup( vlc_va_t *p_external, void **pp_hw_ctx, vlc_fourcc_t *pi_chrom
         default :
             p_va->hw_ctx.cv_pix_fmt_type = kCVPixelFormatType_420YpCbCr8Planar;
             p_va->i_chroma = VLC_CODEC_I420;
-            CopyInitCache( &p_va->image_cache, i_width );
+            CopyInitCache( &p_va->image_cache, i_width,
+                           var_InheritInteger( p_va->p_log, "avcodec-copy-threads" ) );
     }
 
 ok:
@@ -60,6 +60,13 @@ struct decoder_sys_t
     enum AVDiscard i_skip_frame;
     enum AVDiscard i_skip_idct;
 
+    /* for skipping decoding steps when the display loses pictures */
+    enum AVDiscard i_skip_frame_base;
+    enum AVDiscard i_skip_loop_filter_base;
+    unsigned i_skip_level;
+    mtime_t  i_skip_level_date;
+    mtime_t  i_skip_lost_date;
+
     /* how many decoded frames are late */
     int     i_late_frames;
     mtime_t i_late_frames_start;
@@ -103,6 +110,17 @@ struct decoder_sys_t
  *****************************************************************************/
 static void ffmpeg_InitCodec      ( decoder_t * );
 static void ffmpeg_CopyPicture    ( decoder_t *, picture_t *, AVFrame * );
+static void ffmpeg_UpdateSkipLevel( decoder_t * );
+
+#ifdef HAVE_AVCODEC_MT
+/* Video decoders of the process sharing the CPUs */
+static vlc_mutex_t mt_lock = VLC_STATIC_MUTEX;
+static unsigned    mt_decoders = 0;
+
+static void ffmpeg_InitThreads    ( decoder_t *, AVCodecContext *,
+                                    const AVCodec * );
+static void ffmpeg_ReleaseThreads ( void );
+#endif
 static int  ffmpeg_GetFrameBuf    ( struct AVCodecContext *, AVFrame * );
 static int  ffmpeg_ReGetFrameBuf( struct AVCodecContext *, AVFrame * );
 static void ffmpeg_ReleaseFrameBuf( struct AVCodecContext *, AVFrame * );
@@ -120,6 +138,27 @@ static uint32_t ffmpeg_CodecTag( vlc_fourcc_t fcc )
  * Local Functions
  *****************************************************************************/
 
+/* Returns the number of pictures libavcodec may keep referenced,
+ * 0 if unknown (the core then assumes the worst case for the codec) */
+static int ffmpeg_GetDpbSize( decoder_t *p_dec, AVCodecContext *p_context )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    switch( p_sys->i_codec_id )
+    {
+    case AV_CODEC_ID_H264:
+        /* The reference frames and the frames waiting to be reordered.
+         * The reordering delay is only guessed while decoding when the
+         * stream does not signal it, so leave room for a B-pyramid */
+        if( p_context->refs <= 0 )
+            return 0;
+        return __MIN( p_context->refs + __MAX( p_context->has_b_frames, 2 ),
+                      18 );
+    default:
+        return 0;
+    }
+}
+
 /* Returns a new picture buffer */
 static inline picture_t *ffmpeg_NewPictBuf( decoder_t *p_dec,
                                             AVCodecContext *p_context )
@@ -175,6 +214,9 @@ static inline picture_t *ffmpeg_NewPictBuf( decoder_t *p_dec,
         p_dec->fmt_out.video.i_frame_rate_base = p_context->time_base.num;
     }
 
+    /* Only used when the video output is (re)created */
+    p_dec->i_dpb_size = ffmpeg_GetDpbSize( p_dec, p_context );
+
     return decoder_NewPicture( p_dec );
 }
 
@@ -261,6 +303,12 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     }
     p_sys->i_skip_frame = p_sys->p_context->skip_frame;
 
+    p_sys->i_skip_frame_base       = p_sys->p_context->skip_frame;
+    p_sys->i_skip_loop_filter_base = p_sys->p_context->skip_loop_filter;
+    p_sys->i_skip_level            = 0;
+    p_sys->i_skip_level_date       = VLC_TS_INVALID;
+    p_sys->i_skip_lost_date        = VLC_TS_INVALID;
+
     switch( var_CreateGetInteger( p_dec, "avcodec-skip-idct" ) )
     {
         case -1:
@@ -319,19 +367,7 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     p_sys->p_context->opaque = p_dec;
 
 #ifdef HAVE_AVCODEC_MT
-    int i_thread_count = var_InheritInteger( p_dec, "avcodec-threads" );
-    if( i_thread_count <= 0 )
-    {
-        i_thread_count = vlc_GetCPUCount();
-        if( i_thread_count > 1 )
-            i_thread_count++;
-
-        //FIXME: take in count the decoding time
-        i_thread_count = __MIN( i_thread_count, 4 );
-    }
-    i_thread_count = __MIN( i_thread_count, 16 );
-    msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
-    p_sys->p_context->thread_count = i_thread_count;
+    ffmpeg_InitThreads( p_dec, p_sys->p_context, p_sys->p_codec );
 #endif
 
     char *hw = var_CreateGetString( p_dec, "avcodec-hw" ); /* FIXME */
@@ -420,6 +456,9 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     if( ffmpeg_OpenCodec( p_dec ) < 0 )
     {
         msg_Err( p_dec, "cannot open codec (%s)", p_sys->psz_namecodec );
+#ifdef HAVE_AVCODEC_MT
+        ffmpeg_ReleaseThreads();
+#endif
         av_free( p_sys->p_ff_pic );
         vlc_sem_destroy( &p_sys->sem_mt );
         free( p_sys );
@@ -429,6 +468,65 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * ffmpeg_UpdateSkipLevel: skip decoding steps when the display is late
+ *****************************************************************************
+ * The pictures dropped by the video output were decoded for nothing, so
+ * when it loses some, less is decoded: first the loop filter of the
+ * non-reference pictures, then these pictures, then the bidirectional ones.
+ * It goes up one level at most every SKIP_LEVEL_RAISE_DELAY and back down
+ * one level after SKIP_LEVEL_LOWER_DELAY without any loss.
+ *****************************************************************************/
+#define SKIP_LEVEL_RAISE_DELAY (INT64_C(500000))
+#define SKIP_LEVEL_LOWER_DELAY (INT64_C(2000000))
+
+static const struct
+{
+    enum AVDiscard frame;
+    enum AVDiscard loop_filter;
+} skip_levels[] = {
+    { AVDISCARD_NONE,   AVDISCARD_NONE },
+    { AVDISCARD_NONE,   AVDISCARD_NONREF },
+    { AVDISCARD_NONREF, AVDISCARD_NONREF },
+    { AVDISCARD_NONREF, AVDISCARD_BIDIR },
+    { AVDISCARD_BIDIR,  AVDISCARD_NONKEY },
+};
+
+static void ffmpeg_UpdateSkipLevel( decoder_t *p_dec )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    AVCodecContext *p_context = p_sys->p_context;
+    const mtime_t i_now = mdate();
+    unsigned i_level = p_sys->i_skip_level;
+
+    if( decoder_GetDisplayLost( p_dec ) > 0 )
+    {
+        p_sys->i_skip_lost_date = i_now;
+        if( i_level + 1 < sizeof(skip_levels) / sizeof(*skip_levels) &&
+            i_now - p_sys->i_skip_level_date >= SKIP_LEVEL_RAISE_DELAY )
+            i_level++;
+    }
+    else if( i_level > 0 &&
+             i_now - p_sys->i_skip_lost_date >= SKIP_LEVEL_LOWER_DELAY &&
+             i_now - p_sys->i_skip_level_date >= SKIP_LEVEL_LOWER_DELAY )
+    {
+        i_level--;
+    }
+    if( i_level == p_sys->i_skip_level )
+        return;
+
+    msg_Dbg( p_dec, "display is %s, skip level %u",
+             i_level > p_sys->i_skip_level ? "late" : "on time", i_level );
+    p_sys->i_skip_level      = i_level;
+    p_sys->i_skip_level_date = i_now;
+
+    p_sys->i_skip_frame = __MAX( p_sys->i_skip_frame_base,
+                                 skip_levels[i_level].frame );
+    p_context->skip_frame = p_sys->i_skip_frame;
+    p_context->skip_loop_filter = __MAX( p_sys->i_skip_loop_filter_base,
+                                         skip_levels[i_level].loop_filter );
+}
+
 /*****************************************************************************
  * DecodeVideo: Called to decode one or more frames
  *****************************************************************************/
@@ -495,6 +593,9 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         return NULL;
     }
 
+    if( !p_dec->b_pace_control && p_sys->b_hurry_up )
+        ffmpeg_UpdateSkipLevel( p_dec );
+
     /* A good idea could be to decode all I pictures and see for the other */
     if( !p_dec->b_pace_control &&
         p_sys->b_hurry_up &&
@@ -804,8 +905,100 @@ void EndVideoDec( decoder_t *p_dec )
         p_sys->p_va = NULL;
     }
     vlc_sem_destroy( &p_sys->sem_mt );
+#ifdef HAVE_AVCODEC_MT
+    ffmpeg_ReleaseThreads();
+#endif
 }
 
+#ifdef HAVE_AVCODEC_MT
+/*****************************************************************************
+ * ffmpeg_InitThreads: choose the threading of a new decoder
+ *****************************************************************************
+ * The thread count is chosen when the decoder is created, from the CPUs left
+ * to each of the video decoders of the process, the picture size and the
+ * threading modes the codec supports.
+ *****************************************************************************/
+static void ffmpeg_InitThreads( decoder_t *p_dec, AVCodecContext *p_context,
+                                const AVCodec *p_codec )
+{
+    vlc_mutex_lock( &mt_lock );
+    unsigned i_decoders = ++mt_decoders;
+    vlc_mutex_unlock( &mt_lock );
+
+    int i_thread_count = var_InheritInteger( p_dec, "avcodec-threads" );
+    if( i_thread_count <= 0 )
+    {
+        unsigned i_share = __MAX( vlc_GetCPUCount() / i_decoders, 1 );
+        if( i_share > 1 )
+            i_share++;
+
+        /* Small pictures do not keep more threads busy, they only delay the
+         * output (frame threading) or wait for a slice (slice threading) */
+        const unsigned i_pixels = p_dec->fmt_in.video.i_width *
+                                  p_dec->fmt_in.video.i_height;
+        unsigned i_max;
+        if( i_pixels == 0 )
+            i_max = 4;
+        else if( i_pixels <= 720 * 576 )
+            i_max = 2;
+        else if( i_pixels <= 1920 * 1088 )
+            i_max = 4;
+        else
+            i_max = 8;
+
+        //FIXME: take in count the decoding time
+        i_thread_count = __MIN( i_share, i_max );
+    }
+    i_thread_count = __MIN( i_thread_count, 16 );
+    p_context->thread_count = i_thread_count;
+
+    switch( var_InheritInteger( p_dec, "avcodec-thread-type" ) )
+    {
+        case 1:
+            p_context->thread_type = FF_THREAD_FRAME;
+            break;
+        case 2:
+            p_context->thread_type = FF_THREAD_SLICE;
+            break;
+        default:
+            /* Frame threading adds thread_count frames of delay, which a low
+             * latency clock cannot afford */
+            if( var_InheritInteger( p_dec, "clock-latency" ) > 0 )
+                p_context->thread_type = FF_THREAD_SLICE;
+            else
+                p_context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            break;
+    }
+
+#if defined(CODEC_CAP_FRAME_THREADS) && defined(CODEC_CAP_SLICE_THREADS)
+    /* Do not ask for threads the codec cannot use */
+    int i_caps = 0;
+    if( p_codec->capabilities & CODEC_CAP_FRAME_THREADS )
+        i_caps |= FF_THREAD_FRAME;
+    if( p_codec->capabilities & CODEC_CAP_SLICE_THREADS )
+        i_caps |= FF_THREAD_SLICE;
+    if( !( p_context->thread_type & i_caps ) )
+    {
+        msg_Dbg( p_dec, "codec %s has no thread support for this mode",
+                 p_codec->name );
+        p_context->thread_count = 1;
+    }
+#else
+    (void) p_codec;
+#endif
+    msg_Dbg( p_dec, "allowing %d thread(s) for decoding (%u video decoder(s))",
+             p_context->thread_count, i_decoders );
+}
+
+static void ffmpeg_ReleaseThreads( void )
+{
+    vlc_mutex_lock( &mt_lock );
+    assert( mt_decoders > 0 );
+    mt_decoders--;
+    vlc_mutex_unlock( &mt_lock );
+}
+#endif
+
 /*****************************************************************************
  * ffmpeg_InitCodec: setup codec extra initialization data for ffmpeg
  *****************************************************************************/
@@ -158,6 +158,7 @@ typedef struct dvbsub_objectdef_s
     int i_y;
     int i_fg_pc;
     int i_bg_pc;
+    int i_version;  /* version last drawn in the region, -1 if none */
     char *psz_text; /* for string of characters objects */
 
 } dvbsub_objectdef_t;
@@ -218,6 +219,7 @@ typedef struct dvbsub_region_s
     int i_clut;
 
     uint8_t *p_pixbuf;
+    picture_t *p_picture; /* p_pixbuf as last rendered, NULL if outdated */
 
     int                    i_object_defs;
     dvbsub_objectdef_t     *p_object_defs;
@@ -836,6 +838,14 @@ static void decode_page_composition( decoder_t *p_dec, bs_t *s )
     }
 }
 
+/* Drops the rendered copy of the region, once its pixels are changed */
+static void dvbsub_region_invalidate( dvbsub_region_t *p_region )
+{
+    if( p_region->p_picture )
+        picture_Release( p_region->p_picture );
+    p_region->p_picture = NULL;
+}
+
 static void decode_region_composition( decoder_t *p_dec, bs_t *s )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
@@ -874,8 +884,10 @@ static void decode_region_composition( decoder_t *p_dec, bs_t *s )
             return;
         p_region->p_object_defs = NULL;
         p_region->p_pixbuf = NULL;
+        p_region->p_picture = NULL;
         p_region->p_next = NULL;
     }
+    dvbsub_region_invalidate( p_region );
 
     /* Region attributes */
     p_region->i_id = i_id;
@@ -961,6 +973,7 @@ static void decode_region_composition( decoder_t *p_dec, bs_t *s )
         p_obj->i_x          = bs_read( s, 12 );
         bs_skip( s, 4 ); /* Reserved */
         p_obj->i_y          = bs_read( s, 12 );
+        p_obj->i_version    = -1;
         p_obj->psz_text     = NULL;
 
         i_processed_length += 6;
@@ -1120,6 +1133,12 @@ static void decode_object( decoder_t *p_dec, bs_t *s )
             {
                 if( p_region->p_object_defs[i].i_id != i_id ) continue;
 
+                /* Already drawn since the region was last composed */
+                if( p_region->p_object_defs[i].i_version == i_version )
+                    continue;
+                p_region->p_object_defs[i].i_version = i_version;
+                dvbsub_region_invalidate( p_region );
+
                 dvbsub_render_pdata( p_dec, p_region,
                                      p_region->p_object_defs[i].i_x,
                                      p_region->p_object_defs[i].i_y,
@@ -1456,6 +1475,7 @@ static void free_all( decoder_t *p_dec )
         for( i = 0; i < p_reg->i_object_defs; i++ )
             free( p_reg->p_object_defs[i].psz_text );
         if( p_reg->i_object_defs ) free( p_reg->p_object_defs );
+        dvbsub_region_invalidate( p_reg );
         free( p_reg->p_pixbuf );
         free( p_reg );
     }
@@ -1614,16 +1634,27 @@ static subpicture_t *render( decoder_t *p_dec )
         *pp_spu_region = p_spu_region;
         pp_spu_region = &p_spu_region->p_next;
 
-        p_src = p_region->p_pixbuf;
-        p_dst = p_spu_region->p_picture->Y_PIXELS;
-        i_pitch = p_spu_region->p_picture->Y_PITCH;
-
-        /* Copy pixel buffer */
-        for( j = 0; j < p_region->i_height; j++ )
+        if( p_region->p_picture )
+        {
+            /* Nothing was drawn since the last page: only the palette,
+             * the position or the timeout may have changed */
+            picture_Release( p_spu_region->p_picture );
+            p_spu_region->p_picture = picture_Hold( p_region->p_picture );
+        }
+        else
         {
-            memcpy( p_dst, p_src, p_region->i_width );
-            p_src += p_region->i_width;
-            p_dst += i_pitch;
+            p_src = p_region->p_pixbuf;
+            p_dst = p_spu_region->p_picture->Y_PIXELS;
+            i_pitch = p_spu_region->p_picture->Y_PITCH;
+
+            /* Copy pixel buffer */
+            for( j = 0; j < p_region->i_height; j++ )
+            {
+                memcpy( p_dst, p_src, p_region->i_width );
+                p_src += p_region->i_width;
+                p_dst += i_pitch;
+            }
+            p_region->p_picture = picture_Hold( p_spu_region->p_picture );
         }
 
         /* Check subtitles encoded as strings of characters
@@ -1665,6 +1696,15 @@ typedef struct encoder_region_t
     int i_width;
     int i_height;
 
+    /* Last bitmap encoded in this region, and its pixel data */
+    uint8_t *p_pixels;
+    int      i_pixels_width;
+    int      i_pixels_height;
+    int      i_pixels_entries;
+    uint8_t *p_data;
+    int      i_top;      /* top field data length */
+    int      i_bottom;   /* bottom field data length */
+
 } encoder_region_t;
 
 struct encoder_sys_t
@@ -2054,6 +2094,11 @@ static void CloseEncoder( vlc_object_t *p_this )
     var_Destroy( p_this , ENC_CFG_PREFIX "y" );
     var_Destroy( p_this , ENC_CFG_PREFIX "timeout" );
 
+    for( int i = 0; i < p_sys->i_regions; i++ )
+    {
+        free( p_sys->p_regions[i].p_pixels );
+        free( p_sys->p_regions[i].p_data );
+    }
     if( p_sys->i_regions ) free( p_sys->p_regions );
     free( p_sys );
 }
@@ -2076,7 +2121,7 @@ static void encode_page_composition( encoder_t *p_enc, bs_t *s,
         if( i_regions >= p_sys->i_regions )
         {
             encoder_region_t region;
-            region.i_width = region.i_height = 0;
+            memset( &region, 0, sizeof(region) );
             p_sys->p_regions = xrealloc( p_sys->p_regions,
                           sizeof(encoder_region_t) * (p_sys->i_regions + 1) );
             p_sys->p_regions[p_sys->i_regions++] = region;
@@ -2266,6 +2311,70 @@ static void encode_pixel_data( encoder_t *p_enc, bs_t *s,
                                subpicture_region_t *p_region,
                                bool b_top );
 
+/* Checks whether the bitmap is the one last encoded in this region and
+ * copies the previous pixel data if so */
+static bool encode_object_cached( const encoder_region_t *p_cache, bs_t *s,
+                                  const subpicture_region_t *p_region )
+{
+    const picture_t *p_pic = p_region->p_picture;
+    const int i_width = p_region->fmt.i_visible_width;
+    const int i_height = p_region->fmt.i_visible_height;
+    const int i_data = p_cache->i_top + p_cache->i_bottom;
+
+    if( !p_cache->p_data || p_cache->i_pixels_width != i_width ||
+        p_cache->i_pixels_height != i_height ||
+        p_cache->i_pixels_entries != p_region->fmt.p_palette->i_entries )
+        return false;
+    if( s->i_left != 8 || s->p_end - s->p < i_data )
+        return false;
+
+    for( int i = 0; i < i_height; i++ )
+        if( memcmp( &p_cache->p_pixels[i * i_width],
+                    &p_pic->p->p_pixels[i * p_pic->p->i_pitch], i_width ) )
+            return false;
+
+    memcpy( s->p, p_cache->p_data, i_data );
+    s->p += i_data;
+    return true;
+}
+
+static void encode_object_store( encoder_region_t *p_cache,
+                                 const subpicture_region_t *p_region,
+                                 const uint8_t *p_data, int i_top,
+                                 int i_bottom )
+{
+    const picture_t *p_pic = p_region->p_picture;
+    const int i_width = p_region->fmt.i_visible_width;
+    const int i_height = p_region->fmt.i_visible_height;
+    uint8_t *p_pixels = NULL, *p_copy = NULL;
+
+    if( i_width * i_height > 0 && i_top + i_bottom > 0 )
+    {
+        p_pixels = realloc( p_cache->p_pixels, i_width * i_height );
+        if( p_pixels )
+            p_cache->p_pixels = p_pixels;
+        p_copy = realloc( p_cache->p_data, i_top + i_bottom );
+        if( p_copy )
+            p_cache->p_data = p_copy;
+    }
+    if( !p_pixels || !p_copy )
+    {
+        free( p_cache->p_data );
+        p_cache->p_data = NULL;
+        return;
+    }
+
+    for( int i = 0; i < i_height; i++ )
+        memcpy( &p_pixels[i * i_width],
+                &p_pic->p->p_pixels[i * p_pic->p->i_pitch], i_width );
+    memcpy( p_copy, p_data, i_top + i_bottom );
+    p_cache->i_pixels_width = i_width;
+    p_cache->i_pixels_height = i_height;
+    p_cache->i_pixels_entries = p_region->fmt.p_palette->i_entries;
+    p_cache->i_top = i_top;
+    p_cache->i_bottom = i_bottom;
+}
+
 static void encode_object( encoder_t *p_enc, bs_t *s, subpicture_t *p_subpic )
 {
     encoder_sys_t *p_sys = p_enc->p_sys;
@@ -2328,17 +2437,35 @@ static void encode_object( encoder_t *p_enc, bs_t *s, subpicture_t *p_subpic )
         bs_write( s, 16, 0 ); /* topfield data block length */
         bs_write( s, 16, 0 ); /* bottomfield data block length */
 
-        /* Top field */
-        i_pixel_data_pos = bs_pos( s );
-        encode_pixel_data( p_enc, s, p_region, true );
-        i_pixel_data_pos = ( bs_pos( s ) - i_pixel_data_pos ) / 8;
-        SetWBE( &s->p_start[i_update_pos/8], i_pixel_data_pos );
-
-        /* Bottom field */
-        i_pixel_data_pos = bs_pos( s );
-        encode_pixel_data( p_enc, s, p_region, false );
-        i_pixel_data_pos = ( bs_pos( s ) - i_pixel_data_pos ) / 8;
-        SetWBE( &s->p_start[i_update_pos/8+2], i_pixel_data_pos );
+        if( i_region < p_sys->i_regions &&
+            encode_object_cached( &p_sys->p_regions[i_region], s, p_region ) )
+        {
+            SetWBE( &s->p_start[i_update_pos/8],
+                    p_sys->p_regions[i_region].i_top );
+            SetWBE( &s->p_start[i_update_pos/8+2],
+                    p_sys->p_regions[i_region].i_bottom );
+        }
+        else
+        {
+            int i_top;
+
+            /* Top field */
+            i_pixel_data_pos = bs_pos( s );
+            encode_pixel_data( p_enc, s, p_region, true );
+            i_top = ( bs_pos( s ) - i_pixel_data_pos ) / 8;
+            SetWBE( &s->p_start[i_update_pos/8], i_top );
+
+            /* Bottom field */
+            i_pixel_data_pos = bs_pos( s );
+            encode_pixel_data( p_enc, s, p_region, false );
+            i_pixel_data_pos = ( bs_pos( s ) - i_pixel_data_pos ) / 8;
+            SetWBE( &s->p_start[i_update_pos/8+2], i_pixel_data_pos );
+
+            if( i_region < p_sys->i_regions )
+                encode_object_store( &p_sys->p_regions[i_region], p_region,
+                                     &s->p_start[i_update_pos/8 + 4],
+                                     i_top, i_pixel_data_pos );
+        }
 
         /* Stuffing for word alignment */
         bs_align_0( s );
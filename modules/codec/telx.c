@@ -504,12 +504,9 @@ static subpicture_t *Decode( decoder_t *p_dec, block_t **pp_block )
             p_sys->i_page[magazine] = (0xF0 & bytereverse( hamming_8_4(packet[7]) )) |
                              (0xF & (bytereverse( hamming_8_4(packet[6]) ) >> 4) );
 
-            decode_string( psz_line, sizeof(psz_line), p_sys, magazine,
-                           packet + 14, 40 - 14 );
-
             dbg((p_dec, "mag %d flags %x page %x character set %d subtitles %d", magazine, flag,
                  p_sys->i_page[magazine],
-                 7 & flag>>21, 1 & flag>>15, psz_line));
+                 7 & flag>>21, 1 & flag>>15));
 
             p_sys->pi_active_national_set[magazine] =
                                  ppi_national_subsets[7 & (flag >> 21)];
@@ -533,6 +530,10 @@ static subpicture_t *Decode( decoder_t *p_dec, block_t **pp_block )
                    || !p_sys->b_is_subtitle[magazine] )
                 continue;
 
+            /* Only the header of the wanted page is worth decoding */
+            decode_string( psz_line, sizeof(psz_line), p_sys, magazine,
+                           packet + 14, 40 - 14 );
+
             p_sys->b_erase[magazine] = (1 & (flag >> 7));
 
             dbg((p_dec, "%ld --> %ld\n", (long int) p_block->i_pts, (long int)(p_sys->prev_pts+1500000)));
@@ -0,0 +1,222 @@
+/*****************************************************************************
+ * v210.h : v210 10-bit 4:2:2 unpacking
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_V210_H
+#define VLC_V210_H 1
+
+#include <vlc_cpu.h>
+
+/*
+ * A v210 line packs 6 pixels in 4 little-endian 32-bits words, three 10-bits
+ * samples each: U0 Y0 V0, Y1 U1 Y2, V1 Y3 U2, Y4 V2 Y5. Lines are padded to
+ * a multiple of 48 pixels (128 bytes). The unpackers write planar 4:2:2
+ * 16-bits samples in native byte order (I422_10L on x86).
+ */
+#if defined(CAN_COMPILE_SSSE3) && (VLC_GCC_VERSION(4, 9) || defined(__clang__))
+# define HAVE_V210_SSSE3
+# include <tmmintrin.h>
+# define VLC_SSSE3 __attribute__ ((__target__ ("ssse3")))
+#endif
+#if defined(HAVE_V210_SSSE3) && defined(CAN_COMPILE_AVX2)
+# define HAVE_V210_AVX2
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+
+/**
+ * Returns the pitch in bytes of a v210 line.
+ */
+static inline size_t V210Pitch(unsigned width)
+{
+    return ((width + 47) / 48) * 128;
+}
+
+typedef void (*v210_unpack_fn)(uint16_t *, uint16_t *, uint16_t *,
+                               const uint32_t *, unsigned);
+
+/**
+ * Unpacks one line of width pixels into its Y, U and V planes.
+ */
+static inline void V210UnpackLineC(uint16_t *y, uint16_t *u, uint16_t *v,
+                                   const uint32_t *src, unsigned width)
+{
+    uint32_t val = 0;
+    unsigned w;
+
+#define READ_PIXELS(a, b, c)                         \
+    do {                                             \
+        val  = GetDWLE(src++);                       \
+        *a++ =  val & 0x3FF;                         \
+        *b++ = (val >> 10) & 0x3FF;                  \
+        *c++ = (val >> 20) & 0x3FF;                  \
+    } while (0)
+
+    for (w = 0; w + 6 <= width; w += 6) {
+        READ_PIXELS(u, y, v);
+        READ_PIXELS(y, u, y);
+        READ_PIXELS(v, y, u);
+        READ_PIXELS(y, v, y);
+    }
+    if (w + 2 <= width) {
+        READ_PIXELS(u, y, v);
+
+        val  = GetDWLE(src++);
+        *y++ =  val & 0x3FF;
+    }
+    if (w + 4 <= width) {
+        *u++ = (val >> 10) & 0x3FF;
+        *y++ = (val >> 20) & 0x3FF;
+
+        val  = GetDWLE(src++);
+        *v++ =  val & 0x3FF;
+        *y++ = (val >> 10) & 0x3FF;
+    }
+#undef READ_PIXELS
+}
+
+#ifdef HAVE_V210_SSSE3
+/*
+ * Per 4 words: w01 holds the first and second samples of each word as 16-bits
+ * values, w2 the third ones. Shuffles then pick the pixels in order:
+ * Y from w01 words 1, 2, 5, 6 and w2 words 2, 6; U from w01 words 0, 3 and
+ * w2 word 4; V from w2 word 0 and w01 words 4, 7.
+ */
+#define V210_SHUF_Y01 1*2, 1*2+1, 2*2, 2*2+1, -1, -1, 5*2, 5*2+1, \
+                      6*2, 6*2+1, -1, -1, -1, -1, -1, -1
+#define V210_SHUF_Y2  -1, -1, -1, -1, 2*2, 2*2+1, -1, -1, \
+                      -1, -1, 6*2, 6*2+1, -1, -1, -1, -1
+#define V210_SHUF_UV01 0*2, 0*2+1, 3*2, 3*2+1, -1, -1, -1, -1, \
+                       -1, -1, 4*2, 4*2+1, 7*2, 7*2+1, -1, -1
+#define V210_SHUF_UV2 -1, -1, -1, -1, 4*2, 4*2+1, -1, -1, \
+                      0*2, 0*2+1, -1, -1, -1, -1, -1, -1
+
+VLC_SSSE3
+static inline void V210UnpackLineSSSE3(uint16_t *y, uint16_t *u, uint16_t *v,
+                                       const uint32_t *src, unsigned width)
+{
+    const __m128i lo = _mm_set1_epi32(0x3FF);
+    const __m128i hi = _mm_set1_epi32(0x3FF0000);
+    const __m128i shuf_y01 = _mm_setr_epi8(V210_SHUF_Y01);
+    const __m128i shuf_y2 = _mm_setr_epi8(V210_SHUF_Y2);
+    const __m128i shuf_uv01 = _mm_setr_epi8(V210_SHUF_UV01);
+    const __m128i shuf_uv2 = _mm_setr_epi8(V210_SHUF_UV2);
+
+    /* Each group stores 8 Y, 4 U and 4 V: stop while they fit the line */
+    for (; width >= 8; width -= 6) {
+        __m128i in = _mm_loadu_si128((const __m128i *)src);
+        __m128i w01 = _mm_or_si128(_mm_and_si128(in, lo),
+                                   _mm_and_si128(_mm_slli_epi32(in, 6), hi));
+        __m128i w2 = _mm_and_si128(_mm_srli_epi32(in, 20), lo);
+
+        __m128i ys = _mm_or_si128(_mm_shuffle_epi8(w01, shuf_y01),
+                                  _mm_shuffle_epi8(w2, shuf_y2));
+        __m128i uv = _mm_or_si128(_mm_shuffle_epi8(w01, shuf_uv01),
+                                  _mm_shuffle_epi8(w2, shuf_uv2));
+
+        _mm_storeu_si128((__m128i *)y, ys);
+        _mm_storel_epi64((__m128i *)u, uv);
+        _mm_storel_epi64((__m128i *)v, _mm_srli_si128(uv, 8));
+        src += 4;
+        y += 6;
+        u += 3;
+        v += 3;
+    }
+    V210UnpackLineC(y, u, v, src, width);
+}
+#endif
+
+#ifdef HAVE_V210_AVX2
+VLC_AVX2
+static inline void V210UnpackLineAVX2(uint16_t *y, uint16_t *u, uint16_t *v,
+                                      const uint32_t *src, unsigned width)
+{
+    const __m256i lo = _mm256_set1_epi32(0x3FF);
+    const __m256i hi = _mm256_set1_epi32(0x3FF0000);
+    const __m256i shuf_y01 = _mm256_setr_epi8(V210_SHUF_Y01, V210_SHUF_Y01);
+    const __m256i shuf_y2 = _mm256_setr_epi8(V210_SHUF_Y2, V210_SHUF_Y2);
+    const __m256i shuf_uv01 = _mm256_setr_epi8(V210_SHUF_UV01, V210_SHUF_UV01);
+    const __m256i shuf_uv2 = _mm256_setr_epi8(V210_SHUF_UV2, V210_SHUF_UV2);
+
+    /* Two groups at a time, one per lane. The second one stores up to the
+     * 14th pixel. */
+    for (; width >= 14; width -= 12) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)src);
+        __m256i w01 = _mm256_or_si256(_mm256_and_si256(in, lo),
+                              _mm256_and_si256(_mm256_slli_epi32(in, 6), hi));
+        __m256i w2 = _mm256_and_si256(_mm256_srli_epi32(in, 20), lo);
+
+        __m256i ys = _mm256_or_si256(_mm256_shuffle_epi8(w01, shuf_y01),
+                                     _mm256_shuffle_epi8(w2, shuf_y2));
+        __m256i uv = _mm256_or_si256(_mm256_shuffle_epi8(w01, shuf_uv01),
+                                     _mm256_shuffle_epi8(w2, shuf_uv2));
+        __m128i uv0 = _mm256_castsi256_si128(uv);
+        __m128i uv1 = _mm256_extracti128_si256(uv, 1);
+
+        _mm_storeu_si128((__m128i *)y, _mm256_castsi256_si128(ys));
+        _mm_storeu_si128((__m128i *)(y + 6), _mm256_extracti128_si256(ys, 1));
+        _mm_storel_epi64((__m128i *)u, uv0);
+        _mm_storel_epi64((__m128i *)(u + 3), uv1);
+        _mm_storel_epi64((__m128i *)v, _mm_srli_si128(uv0, 8));
+        _mm_storel_epi64((__m128i *)(v + 3), _mm_srli_si128(uv1, 8));
+        src += 8;
+        y += 12;
+        u += 6;
+        v += 6;
+    }
+    V210UnpackLineSSSE3(y, u, v, src, width);
+}
+#endif
+
+/**
+ * Returns the fastest line unpacker usable on this CPU.
+ */
+static inline v210_unpack_fn V210UnpackGet(void)
+{
+#ifdef HAVE_V210_AVX2
+    if (vlc_CPU_AVX2())
+        return V210UnpackLineAVX2;
+#endif
+#ifdef HAVE_V210_SSSE3
+    if (vlc_CPU_SSSE3())
+        return V210UnpackLineSSSE3;
+#endif
+    return V210UnpackLineC;
+}
+
+/**
+ * Unpacks a v210 picture into Y, U and V planes of the given pitches
+ * (in samples).
+ */
+static inline void V210Unpack(v210_unpack_fn unpack,
+                              uint16_t *y, size_t y_pitch,
+                              uint16_t *u, uint16_t *v, size_t uv_pitch,
+                              const uint8_t *src, size_t src_pitch,
+                              unsigned width, unsigned height)
+{
+    for (unsigned h = 0; h < height; h++) {
+        unpack(y, u, v, (const uint32_t *)src, width);
+        y += y_pitch;
+        u += uv_pitch;
+        v += uv_pitch;
+        src += src_pitch;
+    }
+}
+
+#endif
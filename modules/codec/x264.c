@@ -407,6 +407,11 @@ static void x264_log( void *, int i_level, const char *psz, va_list );
 #define LOOKAHEAD_LONGTEXT N_("Framecount to use on frametype lookahead. " \
     "Currently default can cause sync-issues on unmuxable output, like rtsp-output without ts-mux" )
 
+#define LATENCY_TEXT N_("Latency target")
+#define LATENCY_LONGTEXT N_( "Maximum delay (in milliseconds) introduced " \
+    "by the encoder and its VBV buffer. Sliced threads are used, and the " \
+    "lookahead, B-frames and VBV are sized to fit. 0 disables this mode.")
+
 #define HRD_TEXT N_("HRD-timing information")
 #define TUNE_TEXT N_("Default tune setting used" )
 #define PRESET_TEXT N_("Default preset setting used" )
@@ -677,6 +682,10 @@ vlc_module_begin ()
                  LOOKAHEAD_LONGTEXT, true )
         change_integer_range( 0, 60 )
 
+    add_integer( SOUT_CFG_PREFIX "latency", 0, LATENCY_TEXT,
+                 LATENCY_LONGTEXT, true )
+        change_integer_range( 0, 10000 )
+
     add_bool( SOUT_CFG_PREFIX "intra-refresh", false, INTRAREFRESH_TEXT,
               INTRAREFRESH_LONGTEXT, true )
 
@@ -763,7 +772,7 @@ static const char *const ppsz_sout_options[] = {
     "aq-mode", "aq-strength", "psy-rd", "psy", "profile", "lookahead", "slices",
     "slice-max-size", "slice-max-mbs", "intra-refresh", "mbtree", "hrd",
     "tune","preset", "opengop", "bluray-compat", "frame-packing", "options",
-    "fullrange",
+    "fullrange", "latency",
     NULL
 };
 
@@ -787,6 +796,53 @@ static vlc_mutex_t pthread_win32_mutex = VLC_STATIC_MUTEX;
 static int pthread_win32_count = 0;
 #endif
 
+/*****************************************************************************
+ * SetupLatency: fit the encoder delay within a target
+ *****************************************************************************
+ * Half of the target is given to the frame reordering and lookahead, the
+ * rest to the VBV buffer, which delays the bigger frames while they are sent.
+ * Slices are used for threading, as frame threads delay one frame each.
+ *****************************************************************************/
+static void SetupLatency( encoder_t *p_enc, x264_param_t *p_param,
+                          mtime_t i_latency )
+{
+    const int i_fps_num = p_param->i_fps_num > 0 ? p_param->i_fps_num : 25;
+    const int i_fps_den = p_param->i_fps_den > 0 ? p_param->i_fps_den : 1;
+    const mtime_t i_frame = INT64_C(1000000) * i_fps_den / i_fps_num;
+    const int i_frames = i_latency / 2 / i_frame;
+
+    p_param->b_sliced_threads = 1;
+    p_param->i_sync_lookahead = 0;
+    if( p_param->rc.i_lookahead > i_frames )
+        p_param->rc.i_lookahead = i_frames;
+    if( p_param->i_bframe > i_frames )
+        p_param->i_bframe = i_frames;
+    if( i_frames == 0 )
+    {
+        /* Without lookahead, keyframes would overflow a small VBV:
+         * refresh the picture over several frames instead. */
+        p_param->rc.b_mb_tree = 0;
+        p_param->b_intra_refresh = 1;
+    }
+
+    int i_rate = p_param->rc.i_vbv_max_bitrate;
+    if( i_rate <= 0 && p_param->rc.i_rc_method == X264_RC_ABR )
+        i_rate = p_param->rc.i_bitrate;
+    if( i_rate > 0 )
+    {
+        mtime_t i_vbv = i_latency - i_frames * i_frame;
+        if( i_vbv < i_frame )
+            i_vbv = i_frame;
+        p_param->rc.i_vbv_max_bitrate = i_rate;
+        p_param->rc.i_vbv_buffer_size = __MAX( i_rate * i_vbv / 1000000, 1 );
+    }
+
+    msg_Dbg( p_enc, "latency target %"PRId64" ms: %d lookahead frames, "
+             "%d B-frames, VBV %d kbit at %d kbit/s", i_latency / 1000,
+             p_param->rc.i_lookahead, p_param->i_bframe,
+             p_param->rc.i_vbv_buffer_size, p_param->rc.i_vbv_max_bitrate );
+}
+
 /*****************************************************************************
  * Open: probe the encoder
  *****************************************************************************/
@@ -1342,6 +1398,10 @@ static int  Open ( vlc_object_t *p_this )
        p_sys->param.rc.i_lookahead = var_GetInteger( p_enc, SOUT_CFG_PREFIX "lookahead" );
     }
 
+    i_val = var_GetInteger( p_enc, SOUT_CFG_PREFIX "latency" );
+    if( i_val > 0 )
+        SetupLatency( p_enc, &p_sys->param, i_val * INT64_C(1000) );
+
     /* We don't want repeated headers, we repeat p_extra ourself if needed */
     p_sys->param.b_repeat_headers = 0;
 
@@ -1377,6 +1437,14 @@ static int  Open ( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+#if X264_BUILD >= 102
+    /* Tell the stream output how late the pictures come out */
+    if( p_sys->param.i_fps_num > 0 )
+        p_enc->i_delay = INT64_C(1000000) * p_sys->param.i_fps_den
+                       * x264_encoder_maximum_delayed_frames( p_sys->h )
+                       / p_sys->param.i_fps_num;
+#endif
+
     /* get the globals headers */
     size_t i_extra = x264_encoder_headers( p_sys->h, &nal, &i_nal );
     uint8_t *p_extra = p_enc->fmt_out.p_extra = malloc( i_extra );
@@ -369,16 +369,18 @@ static subpicture_t *Decode( decoder_t *p_dec, block_t **pp_block )
     const bool b_opaque = p_sys->b_opaque;
     vlc_mutex_unlock( &p_sys->lock );
 
-    /* Try to see if the page we want is in the cache yet */
+    /* Only format the page when it was selected or received again:
+     * the other pages are merely kept in the zvbi cache */
     memset( &p_page, 0, sizeof(vbi_page) );
+    if( i_wanted_page == p_sys->i_last_page && !p_sys->b_update )
+        goto error;
+
+    /* Try to see if the page we want is in the cache yet */
     b_cached = vbi_fetch_vt_page( p_sys->p_vbi_dec, &p_page,
                                   vbi_dec2bcd( i_wanted_page ),
                                   i_wanted_subpage, VBI_WST_LEVEL_3p5,
                                   25, true );
 
-    if( i_wanted_page == p_sys->i_last_page && !p_sys->b_update )
-        goto error;
-
     if( !b_cached )
     {
         if( p_sys->i_last_page != i_wanted_page )
@@ -43,6 +43,7 @@
 #include <vlc_vout.h>
 #include <vlc_playlist.h>
 #include <vlc_keys.h>
+#include <vlc_memstat.h>
 
 #ifdef HAVE_UNISTD_H
 #    include <unistd.h>
@@ -109,6 +110,8 @@ static int  AudioChannel ( vlc_object_t *, char const *,
                            vlc_value_t, vlc_value_t, void * );
 static int  Statistics   ( vlc_object_t *, char const *,
                            vlc_value_t, vlc_value_t, void * );
+static int  Memory       ( vlc_object_t *, char const *,
+                           vlc_value_t, vlc_value_t, void * );
 
 static int updateStatistics( intf_thread_t *, input_item_t *);
 
@@ -432,6 +435,7 @@ static void RegisterCallbacks( intf_thread_t *p_intf )
 
     /* misc menu commands */
     ADD( "stats", BOOL, Statistics )
+    ADD( "memory", VOID, Memory )
 
 #undef ADD
 }
@@ -837,6 +841,7 @@ static void Help( intf_thread_t *p_intf, bool b_longhelp)
     msg_rc("%s", _("| f [on|off] . . . . . . . . . . . . toggle fullscreen"));
     msg_rc("%s", _("| info . . . . .  information about the current stream"));
     msg_rc("%s", _("| stats  . . . . . . . .  show statistical information"));
+    msg_rc("%s", _("| memory . . . . . . . . .  memory use of each module"));
     msg_rc("%s", _("| get_time . . seconds elapsed since stream's beginning"));
     msg_rc("%s", _("| is_playing . . . .  1 if a stream plays, 0 otherwise"));
     msg_rc("%s", _("| get_title . . . . .  the title of the current stream"));
@@ -1794,6 +1799,23 @@ static int Statistics ( vlc_object_t *p_this, char const *psz_cmd,
     return VLC_SUCCESS;
 }
 
+static int Memory( vlc_object_t *p_this, char const *psz_cmd,
+                   vlc_value_t oldval, vlc_value_t newval, void *p_data )
+{
+    VLC_UNUSED(oldval); VLC_UNUSED(newval); VLC_UNUSED(p_data);
+    intf_thread_t *p_intf = (intf_thread_t*)p_this;
+    vlc_mem_stats_t stats[VLC_MEM_ACCOUNTS];
+    unsigned i_count = vlc_mem_GetStats( stats );
+
+    msg_rc( "+----[ %s ]", psz_cmd );
+    msg_rc( "| %-20s %12s %12s", _("account"), _("live KiB"), _("peak KiB") );
+    for( unsigned i = 0; i < i_count; i++ )
+        msg_rc( "| %-20s %12"PRIu64" %12"PRIu64, stats[i].psz_name,
+                stats[i].i_live >> 10, stats[i].i_peak >> 10 );
+    msg_rc( "+----[ end of %s ]", psz_cmd );
+    return VLC_SUCCESS;
+}
+
 static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
 {
     if( !p_item ) return VLC_EGENERIC;
@@ -1835,6 +1857,13 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
     msg_rc(_("| buffers lost     :    %5"PRIi64),
             p_item->p_stats->i_lost_abuffers );
     msg_rc("|");
+    /* Memory */
+    msg_rc("%s", _("+-[Block pool]"));
+    msg_rc(_("| pool hits        :    %5"PRIi64),
+            p_item->p_stats->i_block_pool_hits );
+    msg_rc(_("| pool misses      :    %5"PRIi64),
+            p_item->p_stats->i_block_pool_misses );
+    msg_rc("|");
     /* Sout */
     msg_rc("%s", _("+-[Streaming]"));
     msg_rc(_("| packets sent     :    %5"PRIi64),
@@ -77,6 +77,9 @@ typedef struct
     mtime_t i_time;
 
     block_t         *p_frame; /* use to gather complete frame */
+    int             i_frame_size; /* media object size if p_frame holds it
+                                     whole, -1 if p_frame is a chain */
+    int             i_frame_filled;
 
 } asf_track_t;
 
@@ -96,6 +99,7 @@ struct demux_sys_t
     int64_t             i_data_end;
 
     bool                b_index;
+    seek_index_t        *p_index; /* simple index and keyframes seen */
     unsigned int        i_seek_track;
     unsigned int        i_wait_keyframe;
 
@@ -248,6 +252,34 @@ static int SeekIndex( demux_t *p_demux, mtime_t i_date, float f_pos )
     if( i_date < 0 )
         i_date = p_sys->i_length * f_pos;
 
+    /* The index is built while playing for files without a simple index:
+     * use the keyframe known before the target if it is close enough,
+     * otherwise interpolate a packet between the surrounding entries */
+    seek_index_entry_t before, after;
+    if( p_sys->p_index &&
+        !demux_SeekIndexLookup( p_sys->p_index, i_date, &before, &after ) &&
+        before.i_pos >= 0 )
+    {
+        int64_t i_pos = -1;
+        if( i_date - before.i_time <= 2 * CLOCK_FREQ )
+            i_pos = before.i_pos;
+        else if( after.i_pos > before.i_pos && after.i_time > before.i_time )
+        {
+            const int64_t i_packet = p_sys->p_fp->i_min_data_packet_size;
+            i_pos = before.i_pos + ( after.i_pos - before.i_pos ) *
+                    ( i_date - before.i_time ) / ( after.i_time - before.i_time );
+            i_pos -= ( i_pos - p_sys->i_data_begin ) % i_packet;
+        }
+        if( i_pos >= 0 )
+        {
+            p_sys->i_wait_keyframe = p_sys->i_seek_track ? 50 : 0;
+            return stream_Seek( p_demux->s, i_pos );
+        }
+    }
+
+    if( !p_sys->b_index )
+        return VLC_EGENERIC;
+
     p_index = ASF_FindObject( p_sys->p_root, &asf_object_simple_index_guid, 0 );
 
     uint64_t i_entry = i_date * 10 / p_index->i_index_entry_time_interval;
@@ -279,6 +311,7 @@ static void SeekPrepare( demux_t *p_demux )
         if( tk->p_frame )
             block_ChainRelease( tk->p_frame );
         tk->p_frame = NULL;
+        tk->i_frame_size = -1;
     }
 }
 
@@ -308,7 +341,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     case DEMUX_SET_TIME:
         SeekPrepare( p_demux );
 
-        if( p_sys->b_index && p_sys->i_length > 0 )
+        if( ( p_sys->b_index || p_sys->p_index ) && p_sys->i_length > 0 )
         {
             va_list acpy;
             va_copy( acpy, args );
@@ -336,7 +369,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     case DEMUX_SET_POSITION:
         SeekPrepare( p_demux );
 
-        if( p_sys->b_index && p_sys->i_length > 0 )
+        if( ( p_sys->b_index || p_sys->p_index ) && p_sys->i_length > 0 )
         {
             va_list acpy;
             va_copy( acpy, args );
@@ -417,6 +450,8 @@ struct asf_packet_t
     bool multiple;
     int length_type;
 
+    int64_t i_pos; /* stream position of the packet */
+
     /* buffer handling for this ASF packet */
     int i_skip;
     const uint8_t *p_peek;
@@ -427,7 +462,15 @@ static void SendPacket(demux_t *p_demux, asf_track_t *tk)
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
-    block_t *p_gather = block_ChainGather( tk->p_frame );
+    block_t *p_gather;
+    if( tk->i_frame_size >= 0 )
+    {
+        /* Missing fragments are cut off */
+        p_gather = tk->p_frame;
+        p_gather->i_buffer = tk->i_frame_filled;
+    }
+    else
+        p_gather = block_ChainGather( tk->p_frame );
 
     if( p_gather->i_dts > VLC_TS_INVALID )
         tk->i_time = p_gather->i_dts - VLC_TS_0;
@@ -438,15 +481,58 @@ static void SendPacket(demux_t *p_demux, asf_track_t *tk)
     es_out_Send( p_demux->out, tk->p_es, p_gather );
 
     tk->p_frame = NULL;
+    tk->i_frame_size = -1;
 }
 
 static int DemuxSubPayload(demux_t *p_demux, asf_track_t *tk,
-        int i_sub_payload_data_length, mtime_t i_pts, int i_media_object_offset)
+        int i_sub_payload_data_length, mtime_t i_pts, int i_media_object_offset,
+        int i_media_object_size)
 {
     /* FIXME I don't use i_media_object_number, sould I ? */
     if( tk->p_frame && i_media_object_offset == 0 )
         SendPacket(p_demux, tk);
 
+    /* The fragments of a media object of known size are read in place into
+     * a single block, instead of being gathered from a chain */
+    if( tk->p_frame == NULL && i_media_object_offset == 0 &&
+        i_media_object_size >= i_sub_payload_data_length )
+    {
+        tk->p_frame = block_Alloc( i_media_object_size );
+        if( tk->p_frame )
+        {
+            tk->i_frame_size = i_media_object_size;
+            tk->i_frame_filled = 0;
+
+            tk->p_frame->i_pts = VLC_TS_0 + i_pts;
+            tk->p_frame->i_dts = VLC_TS_0 + tk->p_frame->i_pts; //FIXME: VLC_TS_0 * 2 ?
+            if( tk->i_cat == VIDEO_ES )
+                tk->p_frame->i_pts = VLC_TS_INVALID;
+        }
+    }
+
+    if( tk->p_frame && tk->i_frame_size >= 0 )
+    {
+        if( i_media_object_offset == tk->i_frame_filled &&
+            i_sub_payload_data_length <= tk->i_frame_size - tk->i_frame_filled )
+        {
+            if( stream_Read( p_demux->s,
+                             &tk->p_frame->p_buffer[tk->i_frame_filled],
+                             i_sub_payload_data_length ) < i_sub_payload_data_length )
+            {
+                msg_Warn( p_demux, "cannot read data" );
+                return -1;
+            }
+            tk->i_frame_filled += i_sub_payload_data_length;
+            if( tk->i_frame_filled == tk->i_frame_size )
+                SendPacket(p_demux, tk);
+            return 0;
+        }
+
+        /* Not the expected fragment: chain it after what was read */
+        tk->p_frame->i_buffer = tk->i_frame_filled;
+        tk->i_frame_size = -1;
+    }
+
     block_t *p_frag = stream_Block( p_demux->s, i_sub_payload_data_length );
     if( p_frag == NULL ) {
         msg_Warn( p_demux, "cannot read data" );
@@ -486,8 +572,11 @@ static int DemuxPayload(demux_t *p_demux, struct asf_packet_t *pkt, int i_payloa
         return -1;
 
     mtime_t i_pts;
+    int i_media_object_size = -1;
     if( i_replicated_data_length > 1 ) // should be at least 8 bytes
     {
+        if( i_replicated_data_length >= 8 )
+            i_media_object_size = GetDWLE( pkt->p_peek + pkt->i_skip );
         i_pts = (mtime_t)GetDWLE( pkt->p_peek + pkt->i_skip + 4 );
         pkt->i_skip += i_replicated_data_length;
 
@@ -544,6 +633,13 @@ static int DemuxPayload(demux_t *p_demux, struct asf_packet_t *pkt, int i_payloa
     if( !tk->p_es )
         goto skip;
 
+    /* Index the packets starting a keyframe of the seek track (any packet
+     * if there is no video) */
+    if( p_sys->p_index && i_media_object_offset == 0 &&
+        ( p_sys->i_seek_track ? i_stream_number == p_sys->i_seek_track &&
+                                i_packet_keyframe : true ) )
+        demux_SeekIndexAdd( p_sys->p_index, i_pts, pkt->i_pos );
+
     while (i_payload_data_length)
     {
         int i_sub_payload_data_length = i_payload_data_length;
@@ -553,7 +649,7 @@ static int DemuxPayload(demux_t *p_demux, struct asf_packet_t *pkt, int i_payloa
         stream_Read(p_demux->s, NULL, pkt->i_skip);
 
         if (DemuxSubPayload(p_demux, tk, i_sub_payload_data_length, i_pts,
-                            i_media_object_offset) < 0)
+                            i_media_object_offset, i_media_object_size) < 0)
             return -1;
 
         pkt->left -= pkt->i_skip + i_sub_payload_data_length;
@@ -578,6 +674,7 @@ static int DemuxPacket( demux_t *p_demux )
     demux_sys_t *p_sys = p_demux->p_sys;
 
     int i_data_packet_min = p_sys->p_fp->i_min_data_packet_size;
+    const int64_t i_pos = stream_Tell( p_demux->s );
 
     const uint8_t *p_peek;
     if( stream_Peek( p_demux->s, &p_peek,i_data_packet_min)<i_data_packet_min )
@@ -662,6 +759,7 @@ static int DemuxPacket( demux_t *p_demux )
     msg_Dbg(p_demux, "%d payloads", i_payload_count);
 #endif
 
+    pkt.i_pos = i_pos;
     pkt.i_skip = i_skip;
     pkt.p_peek = p_peek;
     pkt.left = pkt.length;
@@ -719,6 +817,7 @@ static int DemuxInit( demux_t *p_demux )
     p_sys->p_root   = NULL;
     p_sys->p_fp     = NULL;
     p_sys->b_index  = 0;
+    p_sys->p_index  = NULL;
     p_sys->i_track  = 0;
     p_sys->i_seek_track = 0;
     p_sys->i_wait_keyframe = 0;
@@ -787,6 +886,7 @@ static int DemuxInit( demux_t *p_demux )
         tk->p_sp = p_sp;
         tk->p_es = NULL;
         tk->p_frame = NULL;
+        tk->i_frame_size = -1;
 
         /* Check (in case of mms) if this track is selected (ie will receive data) */
         if( !stream_Control( p_demux->s, STREAM_CONTROL_ACCESS, ACCESS_GET_PRIVATE_ID_STATE,
@@ -1016,6 +1116,20 @@ static int DemuxInit( demux_t *p_demux )
     /* go to first packet */
     stream_Seek( p_demux->s, p_sys->i_data_begin );
 
+    /* The simple index goes to the seek index, which the keyframes found
+     * while playing complete (or make up, without simple index) */
+    if( b_seekable && p_sys->i_data_end > 0 )
+        p_sys->p_index = demux_SeekIndexNew( p_demux, "asf" );
+    if( p_sys->p_index && p_sys->b_index )
+    {
+        for( uint32_t i = 0; i < p_index->i_index_entry_count; i++ )
+            demux_SeekIndexAdd( p_sys->p_index,
+                                i * p_index->i_index_entry_time_interval / 10,
+                                p_sys->i_data_begin +
+                                (int64_t)p_index->index_entry[i].i_packet_number *
+                                p_sys->p_fp->i_min_data_packet_size );
+    }
+
     /* try to calculate movie time */
     if( p_sys->p_fp->i_data_packets_count > 0 )
     {
@@ -1116,6 +1230,12 @@ static void DemuxEnd( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    if( p_sys->p_index )
+    {
+        demux_SeekIndexDelete( p_sys->p_index );
+        p_sys->p_index = NULL;
+    }
+
     if( p_sys->p_root )
     {
         ASF_FreeObjectRoot( p_demux->s, p_sys->p_root );
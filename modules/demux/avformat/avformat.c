@@ -44,6 +44,8 @@ vlc_module_begin ()
     set_callbacks( OpenDemux, CloseDemux )
     add_string( "avformat-format", NULL, FORMAT_TEXT, FORMAT_LONGTEXT, true )
     add_obsolete_string("ffmpeg-format") /* removed since 2.1.0 */
+    add_integer( "avformat-buffer", 32, BUFFER_TEXT, BUFFER_LONGTEXT, true )
+        change_integer_range( 4, 4096 )
 #if LIBAVFORMAT_VERSION_INT >= ((53<<16)+(26<<8)+0)
     add_string( "avformat-options", NULL, AV_OPTIONS_TEXT, AV_OPTIONS_LONGTEXT, true )
 #endif
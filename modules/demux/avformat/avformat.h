@@ -36,3 +36,6 @@ void CloseMux( vlc_object_t * );
 #define MUX_LONGTEXT N_("Force use of a specific avformat muxer.")
 #define FORMAT_TEXT N_( "Format name" )
 #define FORMAT_LONGTEXT N_( "Internal libavcodec format name" )
+#define BUFFER_TEXT N_( "Input buffer size (kB)" )
+#define BUFFER_LONGTEXT N_( "Size of the reads libavformat issues to " \
+    "the input stream. Larger reads mean fewer calls for high bitrates." )
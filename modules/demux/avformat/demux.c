@@ -66,8 +66,7 @@
  *****************************************************************************/
 struct demux_sys_t
 {
-    int             io_buffer_size;
-    uint8_t        *io_buffer;
+    AVIOContext    *io;
 
     AVInputFormat  *fmt;
     AVFormatContext *ic;
@@ -96,6 +95,7 @@ static int IORead( void *opaque, uint8_t *buf, int buf_size );
 static int64_t IOSeek( void *opaque, int64_t offset, int whence );
 
 static block_t *BuildSsaFrame( const AVPacket *p_pkt, unsigned i_order );
+static block_t *BuildPacketFrame( AVPacket *p_pkt );
 static void UpdateSeekPoint( demux_t *p_demux, int64_t i_time );
 static void ResetTime( demux_t *p_demux, int64_t i_time );
 
@@ -215,12 +215,21 @@ int OpenDemux( vlc_object_t *p_this )
     p_sys->p_title = NULL;
 
     /* Create I/O wrapper */
-    p_sys->io_buffer_size = 32768;  /* FIXME */
-    p_sys->io_buffer = malloc( p_sys->io_buffer_size );
+    int i_io_size = var_InheritInteger( p_demux, "avformat-buffer" ) << 10;
+    uint8_t *p_io_buffer = av_malloc( i_io_size );
+
+    p_sys->io = p_io_buffer ? avio_alloc_context( p_io_buffer, i_io_size, 0,
+                                    p_demux, IORead, NULL, IOSeek ) : NULL;
+    if( unlikely(p_sys->io == NULL) )
+    {
+        av_free( p_io_buffer );
+        free( psz_url );
+        CloseDemux( p_this );
+        return VLC_ENOMEM;
+    }
 
     p_sys->ic = avformat_alloc_context();
-    p_sys->ic->pb = avio_alloc_context( p_sys->io_buffer,
-        p_sys->io_buffer_size, 0, p_demux, IORead, NULL, IOSeek );
+    p_sys->ic->pb = p_sys->io;
     p_sys->ic->pb->seekable = b_can_seek ? AVIO_SEEKABLE_NORMAL : 0;
     error = avformat_open_input(&p_sys->ic, psz_url, p_sys->fmt, NULL);
 
@@ -554,7 +563,6 @@ void CloseDemux( vlc_object_t *p_this )
 
     if( p_sys->ic )
     {
-        av_free( p_sys->ic->pb );
 #if LIBAVFORMAT_VERSION_INT >= ((53<<16)+(26<<8)+0)
         avformat_close_input( &p_sys->ic );
 #else
@@ -569,7 +577,12 @@ void CloseDemux( vlc_object_t *p_this )
     if( p_sys->p_title )
         vlc_input_title_Delete( p_sys->p_title );
 
-    free( p_sys->io_buffer );
+    /* libavformat may have replaced the buffer while probing */
+    if( p_sys->io )
+    {
+        av_free( p_sys->io->buffer );
+        av_free( p_sys->io );
+    }
     free( p_sys );
 }
 
@@ -608,20 +621,18 @@ static int Demux( demux_t *p_demux )
     if( p_stream->codec->codec_id == AV_CODEC_ID_SSA )
     {
         p_frame = BuildSsaFrame( &pkt, p_sys->i_ssa_order++ );
+        av_free_packet( &pkt );
         if( !p_frame )
-        {
-            av_free_packet( &pkt );
             return 1;
-        }
     }
     else
     {
-        if( ( p_frame = block_Alloc( pkt.size ) ) == NULL )
+        /* The frame takes over the packet data */
+        if( ( p_frame = BuildPacketFrame( &pkt ) ) == NULL )
         {
             av_free_packet( &pkt );
             return 0;
         }
-        memcpy( p_frame->p_buffer, pkt.data, pkt.size );
     }
 
     if( pkt.flags & AV_PKT_FLAG_KEY )
@@ -695,8 +706,6 @@ static int Demux( demux_t *p_demux )
     }
 
     es_out_Send( p_demux->out, p_sys->tk[pkt.stream_index], p_frame );
-
-    av_free_packet( &pkt );
     return 1;
 }
 
@@ -742,6 +751,40 @@ static void ResetTime( demux_t *p_demux, int64_t i_time )
     }
 }
 
+typedef struct
+{
+    block_t  self;
+    AVPacket packet;
+} packet_block_t;
+
+static void PacketRelease( block_t *p_block )
+{
+    packet_block_t *p_pkt = (packet_block_t *)p_block;
+
+    av_free_packet( &p_pkt->packet );
+    free( p_pkt );
+}
+
+/* Wraps the packet data in a block, without copying it when libavformat
+ * allocated it for the packet. The padding libavformat puts after the data
+ * spares the avcodec decoder a reallocation. */
+static block_t *BuildPacketFrame( AVPacket *p_pkt )
+{
+    if( av_dup_packet( p_pkt ) )
+        return NULL;
+
+    packet_block_t *p_block = malloc( sizeof( *p_block ) );
+    if( unlikely(p_block == NULL) )
+        return NULL;
+
+    p_block->packet = *p_pkt;
+    block_Init( &p_block->self, p_pkt->data,
+                p_pkt->size + FF_INPUT_BUFFER_PADDING_SIZE );
+    p_block->self.i_buffer = p_pkt->size;
+    p_block->self.pf_release = PacketRelease;
+    return &p_block->self;
+}
+
 static block_t *BuildSsaFrame( const AVPacket *p_pkt, unsigned i_order )
 {
     if( p_pkt->size <= 0 )
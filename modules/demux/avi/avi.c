@@ -98,6 +98,10 @@ static char *FromACP( const char *str )
 
 #define IGNORE_ES NAV_ES
 
+/* Number of chunks indexed by each Demux_Seekable() call while the index is
+ * created */
+#define AVI_INDEX_STEP 256
+
 typedef struct
 {
     vlc_fourcc_t i_fourcc;
@@ -175,6 +179,10 @@ struct demux_sys_t
     off_t   i_movi_begin;
     off_t   i_movi_lastchunk_pos;   /* XXX position of last valid chunk */
 
+    /* Index being created from LIST-movi */
+    bool    b_indexing;
+    off_t   i_index_end;
+
     /* number of streams and information */
     unsigned int i_track;
     avi_track_t  **track;
@@ -213,6 +221,7 @@ static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static void AVI_IndexProgress( demux_t *, unsigned );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -335,6 +344,7 @@ static int Open( vlc_object_t * p_this )
         msg_Err( p_demux, "invalid file: cannot find hdrl or movi chunks" );
         goto error;
     }
+    p_sys->i_movi_begin = p_movi->i_chunk_pos;
 
     if( !( p_avih = AVI_ChunkFind( p_hdrl, AVIFOURCC_avih, 0 ) ) )
     {
@@ -642,6 +652,14 @@ aviindex:
 
     /* *** movie length in sec *** */
     p_sys->i_length = AVI_MovieGetLength( p_demux );
+    if( p_sys->b_indexing )
+    {
+        /* Trust the header until the index is complete */
+        p_sys->i_length = __MAX( p_sys->i_length,
+                                 (mtime_t)p_avih->i_totalframes *
+                                 (mtime_t)p_avih->i_microsecperframe /
+                                 (mtime_t)1000000 );
+    }
 
     /* Check the index completeness */
     unsigned int i_idx_totalframes = 0;
@@ -674,10 +692,9 @@ aviindex:
                    _( "Because this AVI file index is broken or missing, "
                       "seeking will not work correctly.\n"
                       "VLC won't repair your file but can temporary fix this "
-                      "problem by building an index in memory.\n"
-                      "This step might take a long time on a large file.\n"
+                      "problem by building an index in memory while playing.\n"
                       "What do you want to do?" ),
-                      _( "Build index then play" ), _( "Play as is" ), _( "Do not play") ) )
+                      _( "Build index while playing" ), _( "Play as is" ), _( "Do not play") ) )
                 {
                     case 1:
                         b_index = true;
@@ -745,7 +762,6 @@ aviindex:
     /* Skip movi header */
     stream_Read( p_demux->s, NULL, 12 );
 
-    p_sys->i_movi_begin = p_movi->i_chunk_pos;
     return VLC_SUCCESS;
 
 error:
@@ -816,6 +832,9 @@ static int Demux_Seekable( demux_t *p_demux )
     /* cannot be more than 100 stream (dcXX or wbXX) */
     avi_track_toread_t toread[100];
 
+    /* Go on with the index creation */
+    if( p_sys->b_indexing )
+        AVI_IndexProgress( p_demux, AVI_INDEX_STEP );
 
     /* detect new selected/unselected streams */
     for( i_track = 0; i_track < p_sys->i_track; i_track++ )
@@ -2355,12 +2374,6 @@ static void AVI_IndexCreate( demux_t *p_demux )
     avi_chunk_list_t *p_riff;
     avi_chunk_list_t *p_movi;
 
-    unsigned int i_stream;
-    off_t i_movi_end;
-
-    mtime_t i_dialog_update;
-    dialog_progress_bar_t *p_dialog = NULL;
-
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
 
@@ -2370,45 +2383,54 @@ static void AVI_IndexCreate( demux_t *p_demux )
         return;
     }
 
-    for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+    {
+        avi_index_Clean( &p_sys->track[i_stream]->idx );
         avi_index_Init( &p_sys->track[i_stream]->idx );
+    }
+
+    p_sys->i_movi_lastchunk_pos = 0;
+    p_sys->i_index_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
+                                stream_Size( p_demux->s ) );
+    p_sys->b_indexing = true;
 
-    i_movi_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
-                        stream_Size( p_demux->s ) );
+    /* The chunks are indexed a few at a time by Demux_Seekable(), so the
+     * playback starts at once and the indexed part can be seeked in.
+     * Demux_UnSeekable() reads the file sequentially: index it now. */
+    if( p_demux->pf_demux == Demux_Seekable )
+    {
+        msg_Warn( p_demux, "creating index from LIST-movi while playing" );
+        return;
+    }
 
-    stream_Seek( p_demux->s, p_movi->i_chunk_pos + 12 );
     msg_Warn( p_demux, "creating index from LIST-movi, will take time !" );
+    while( p_sys->b_indexing && vlc_object_alive( p_demux ) )
+        AVI_IndexProgress( p_demux, AVI_INDEX_STEP );
+}
 
+/* Indexes the next i_count chunks of LIST-movi, starting after the last
+ * chunk already in the index */
+static void AVI_IndexProgress( demux_t *p_demux, unsigned i_count )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
 
-    /* Only show dialog if AVI is > 10MB */
-    i_dialog_update = mdate();
-    if( stream_Size( p_demux->s ) > 10000000 )
-        p_dialog = dialog_ProgressCreate( p_demux, _("Fixing AVI Index..."),
-                                       NULL, _("Cancel") );
+    if( p_sys->i_movi_lastchunk_pos >= p_sys->i_movi_begin + 12 )
+    {
+        stream_Seek( p_demux->s, p_sys->i_movi_lastchunk_pos );
+        if( AVI_PacketNext( p_demux ) )
+            goto done;
+    }
+    else
+    {
+        stream_Seek( p_demux->s, p_sys->i_movi_begin + 12 );
+    }
 
-    for( ;; )
+    for( ; i_count > 0; i_count-- )
     {
         avi_packet_t pk;
 
-        if( !vlc_object_alive (p_demux) )
-            break;
-
-        /* Don't update/check dialog too often */
-        if( p_dialog && mdate() - i_dialog_update > 100000 )
-        {
-            if( dialog_ProgressCancelled( p_dialog ) )
-                break;
-
-            double f_current = stream_Tell( p_demux->s );
-            double f_size    = stream_Size( p_demux->s );
-            double f_pos     = f_current / f_size;
-            dialog_ProgressSet( p_dialog, NULL, f_pos );
-
-            i_dialog_update = mdate();
-        }
-
         if( AVI_PacketGetHeader( p_demux, &pk ) )
-            break;
+            goto done;
 
         if( pk.i_stream < p_sys->i_track &&
             pk.i_cat == p_sys->track[pk.i_stream]->i_cat )
@@ -2435,10 +2457,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
                     msg_Dbg( p_demux, "looking for new RIFF chunk" );
                     if( stream_Seek( p_demux->s, p_sysx->i_chunk_pos + 24 ) )
-                        goto print_stat;
+                        goto done;
                     break;
                 }
-                goto print_stat;
+                goto done;
 
             case AVIFOURCC_RIFF:
                     msg_Dbg( p_demux, "new RIFF chunk found" );
@@ -2453,23 +2475,24 @@ static void AVI_IndexCreate( demux_t *p_demux )
                 if( AVI_PacketSearch( p_demux ) )
                 {
                     msg_Warn( p_demux, "lost sync, abord index creation" );
-                    goto print_stat;
+                    goto done;
                 }
             }
         }
 
-        if( ( !p_sys->b_odml && pk.i_pos + pk.i_size >= i_movi_end ) ||
+        if( ( !p_sys->b_odml && pk.i_pos + pk.i_size >= p_sys->i_index_end ) ||
             AVI_PacketNext( p_demux ) )
         {
-            break;
+            goto done;
         }
     }
+    return;
 
-print_stat:
-    if( p_dialog != NULL )
-        dialog_ProgressDestroy( p_dialog );
+done:
+    p_sys->b_indexing = false;
+    p_sys->i_length = AVI_MovieGetLength( p_demux );
 
-    for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
     {
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
@@ -764,7 +764,8 @@ bool demux_sys_t::PreparePlayback( virtual_segment_c *p_new_segment )
     }
     if( !p_current_segment->CurrentSegment() )
         return false;
-    if( !p_current_segment->CurrentSegment()->b_cues )
+    if( !p_current_segment->CurrentSegment()->b_cues &&
+        p_current_segment->CurrentSegment()->i_deferred_cues < 0 )
         msg_Warn( &p_current_segment->CurrentSegment()->sys.demuxer, "no cues/empty cues found->seek won't be precise" );
 
     f_duration = p_current_segment->Duration();
@@ -27,6 +27,7 @@
 #include "demux.hpp"
 #include "util.hpp"
 #include "Ebml_parser.hpp"
+#include "stream_io_callback.hpp"
 
 matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estream )
     :segment(NULL)
@@ -42,6 +43,8 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,i_chapters_position(-1)
     ,i_tags_position(-1)
     ,i_attachments_position(-1)
+    ,i_deferred_cues(-1)
+    ,i_deferred_attachments(-1)
     ,cluster(NULL)
     ,i_block_pos(0)
     ,i_cluster_pos(0)
@@ -52,6 +55,7 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,b_cues(false)
     ,i_index(0)
     ,i_index_max(1024)
+    ,p_index_cache(NULL)
     ,psz_muxing_application(NULL)
     ,psz_writing_application(NULL)
     ,psz_segment_filename(NULL)
@@ -64,6 +68,7 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,b_ref_external_segments(false)
 {
     p_indexes = (mkv_index_t*)malloc( sizeof( mkv_index_t ) * i_index_max );
+    b_lazy_load = var_InheritBool( &sys.demuxer, "mkv-lazy-load" );
 }
 
 matroska_segment_c::~matroska_segment_c()
@@ -83,6 +88,14 @@ matroska_segment_c::~matroska_segment_c()
     free( psz_segment_filename );
     free( psz_title );
     free( psz_date_utc );
+
+    if( p_index_cache )
+    {
+        for( int i = 0; i < i_index; i++ )
+            if( p_indexes[i].i_time >= 0 )
+                demux_SeekIndexAdd( p_index_cache, p_indexes[i].i_time, p_indexes[i].i_position );
+        demux_SeekIndexDelete( p_index_cache );
+    }
     free( p_indexes );
 
     delete ep;
@@ -114,6 +127,13 @@ void matroska_segment_c::LoadCues( KaxCues *cues )
         msg_Err( &sys.demuxer, "There can be only 1 Cues per section." );
         return;
     }
+    if( p_index_cache )
+    {
+        /* The cues are better than the clusters found before */
+        demux_SeekIndexDelete( p_index_cache );
+        p_index_cache = NULL;
+        i_index = 0;
+    }
 
     ep = new EbmlParser( &es, cues, &sys.demuxer );
     while( ( el = ep->Get() ) != NULL )
@@ -510,12 +530,18 @@ void matroska_segment_c::InformationCreate( )
  *****************************************************************************/
 
 void matroska_segment_c::IndexAppendCluster( KaxCluster *cluster )
+{
+    IndexAppend( cluster->GetElementPosition(),
+                 cluster->GlobalTimecode()/ (mtime_t) 1000 );
+}
+
+void matroska_segment_c::IndexAppend( int64_t i_position, mtime_t i_time )
 {
 #define idx p_indexes[i_index]
     idx.i_track       = -1;
     idx.i_block_number= -1;
-    idx.i_position    = cluster->GetElementPosition();
-    idx.i_time        = cluster->GlobalTimecode()/ (mtime_t) 1000;
+    idx.i_position    = i_position;
+    idx.i_time        = i_time;
     idx.b_key         = true;
 
     i_index++;
@@ -528,6 +554,22 @@ void matroska_segment_c::IndexAppendCluster( KaxCluster *cluster )
 #undef idx
 }
 
+/* Restores the clusters found the previous times the file was played.
+ * Like the ones found while playing, they are the first clusters of the
+ * segment, so the scanning can go on from the last one */
+void matroska_segment_c::IndexCacheLoad( seek_index_t *p_index )
+{
+    seek_index_entry_t entry;
+
+    for( int i = 0; !demux_SeekIndexGet( p_index, i, &entry ); i++ )
+    {
+        if( i_index > 0 && p_indexes[i_index - 1].i_position >= entry.i_pos )
+            continue;
+        IndexAppend( entry.i_pos, entry.i_time );
+    }
+    p_index_cache = p_index;
+}
+
 bool matroska_segment_c::PreloadFamily( const matroska_segment_c & of_segment )
 {
     if ( b_preloaded )
@@ -618,9 +660,14 @@ bool matroska_segment_c::Preload( )
         else if( MKV_IS_ID( el, KaxCues ) )
         {
             msg_Dbg(  &sys.demuxer, "|   + Cues" );
-            if( i_cues_position < 0 )
-                LoadCues( static_cast<KaxCues*>( el ) );
-            i_cues_position = (int64_t) es.I_O().getFilePointer();
+            if( b_lazy_load && i_cues_position < 0 )
+                i_deferred_cues = el->GetElementPosition();
+            else
+            {
+                if( i_cues_position < 0 )
+                    LoadCues( static_cast<KaxCues*>( el ) );
+                i_cues_position = (int64_t) es.I_O().getFilePointer();
+            }
         }
         else if( MKV_IS_ID( el, KaxCluster ) )
         {
@@ -638,9 +685,14 @@ bool matroska_segment_c::Preload( )
         else if( MKV_IS_ID( el, KaxAttachments ) )
         {
             msg_Dbg( &sys.demuxer, "|   + Attachments" );
-            if( i_attachments_position < 0 )
-                ParseAttachments( static_cast<KaxAttachments*>( el ) );
-            i_attachments_position = (int64_t) es.I_O().getFilePointer();
+            if( b_lazy_load && i_attachments_position < 0 )
+                i_deferred_attachments = el->GetElementPosition();
+            else
+            {
+                if( i_attachments_position < 0 )
+                    ParseAttachments( static_cast<KaxAttachments*>( el ) );
+                i_attachments_position = (int64_t) es.I_O().getFilePointer();
+            }
         }
         else if( MKV_IS_ID( el, KaxChapters ) )
         {
@@ -756,6 +808,30 @@ bool matroska_segment_c::LoadSeekHeadItem( const EbmlCallbacks & ClassInfos, int
     return true;
 }
 
+/* Cues are only needed to seek */
+void matroska_segment_c::LoadDeferredCues()
+{
+    if( i_deferred_cues < 0 )
+        return;
+
+    int64_t i_position = i_deferred_cues;
+    i_deferred_cues = -1;
+    msg_Dbg( &sys.demuxer, "loading deferred cues at %"PRId64, i_position );
+    LoadSeekHeadItem( EBML_INFO(KaxCues), i_position );
+}
+
+/* Attachments are only needed for playback (fonts) or on request */
+void matroska_segment_c::LoadDeferredAttachments()
+{
+    if( i_deferred_attachments < 0 )
+        return;
+
+    int64_t i_position = i_deferred_attachments;
+    i_deferred_attachments = -1;
+    msg_Dbg( &sys.demuxer, "loading deferred attachments at %"PRId64, i_position );
+    LoadSeekHeadItem( EBML_INFO(KaxAttachments), i_position );
+}
+
 struct spoint
 {
     spoint(unsigned int tk, mtime_t date, int64_t pos, int64_t cpos):
@@ -782,6 +858,8 @@ void matroska_segment_c::Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_
     int i_cat;
     bool b_has_key = false;
 
+    LoadDeferredCues();
+
     for( size_t i = 0; i < tracks.size(); i++)
         tracks[i]->i_last_dts = VLC_TS_INVALID;
 
@@ -1235,6 +1313,12 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
                 cluster = (KaxCluster*)el;
                 i_cluster_pos = cluster->GetElementPosition();
 
+                /* Read this cluster and the next one (assumed to be
+                 * about the same size) in the background */
+                if( cluster->IsFiniteSize() )
+                    static_cast<vlc_stream_io_callback&>( es.I_O() )
+                        .prefetch( 2 * cluster->GetSize() );
+
                 // reset silent tracks
                 for (size_t i=0; i<tracks.size(); i++)
                 {
@@ -98,6 +98,11 @@ public:
     int64_t                 i_tags_position;
     int64_t                 i_attachments_position;
 
+    /* found but only parsed when needed (mkv-lazy-load) */
+    bool                    b_lazy_load;
+    int64_t                 i_deferred_cues;
+    int64_t                 i_deferred_attachments;
+
     KaxCluster              *cluster;
     uint64                  i_block_pos;
     uint64                  i_cluster_pos;
@@ -110,6 +115,7 @@ public:
     int                     i_index;
     int                     i_index_max;
     mkv_index_t             *p_indexes;
+    seek_index_t           *p_index_cache; /* clusters found by the previous runs */
 
     /* info */
     char                    *psz_muxing_application;
@@ -145,6 +151,11 @@ public:
     bool Select( mtime_t i_start_time );
     void UnSelect();
 
+    void IndexCacheLoad( seek_index_t *p_index );
+
+    void LoadDeferredCues();
+    void LoadDeferredAttachments();
+
     static bool CompareSegmentUIDs( const matroska_segment_c * item_a, const matroska_segment_c * item_b );
 
 private:
@@ -160,6 +171,7 @@ private:
     void ParseTrackEntry( KaxTrackEntry *m );
     void ParseCluster( bool b_update_start_time = true );
     SimpleTag * ParseSimpleTags( KaxTagSimple *tag, int level = 50 );
+    void IndexAppend( int64_t i_position, mtime_t i_time );
     void IndexAppendCluster( KaxCluster *cluster );
     int32_t TrackInit( mkv_track_t * p_tk );
     void ComputeTrackPriority();
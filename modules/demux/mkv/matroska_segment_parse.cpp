@@ -113,7 +113,10 @@ void matroska_segment_c::ParseSeekHead( KaxSeekHead *seekhead )
                 if( id == EBML_ID(KaxCues) )
                 {
                     msg_Dbg( &sys.demuxer, "|   - cues at %"PRId64, i_pos );
-                    LoadSeekHeadItem( EBML_INFO(KaxCues), i_pos );
+                    if( b_lazy_load && i_cues_position < 0 )
+                        i_deferred_cues = i_pos;
+                    else
+                        LoadSeekHeadItem( EBML_INFO(KaxCues), i_pos );
                 }
                 else if( id == EBML_ID(KaxInfo) )
                 {
@@ -143,7 +146,10 @@ void matroska_segment_c::ParseSeekHead( KaxSeekHead *seekhead )
                 else if( id == EBML_ID(KaxAttachments) )
                 {
                     msg_Dbg( &sys.demuxer, "|   - attachments at %"PRId64, i_pos );
-                    LoadSeekHeadItem( EBML_INFO(KaxAttachments), i_pos );
+                    if( b_lazy_load && i_attachments_position < 0 )
+                        i_deferred_attachments = i_pos;
+                    else
+                        LoadSeekHeadItem( EBML_INFO(KaxAttachments), i_pos );
                 }
 #ifdef MKV_DEBUG
                 else
@@ -70,6 +70,11 @@ vlc_module_begin ()
             N_("Dummy Elements"),
             N_("Read and discard unknown EBML elements (not good for broken files)."), true );
 
+    add_bool( "mkv-lazy-load", true,
+            N_("Load cues and attachments when needed"),
+            N_("Only parse the cues on the first seek and the attachments when they are "
+               "requested, so that opening and preparsing files is faster."), true );
+
     add_shortcut( "mka", "mkv" )
 vlc_module_end ()
 
@@ -141,6 +146,16 @@ static int Open( vlc_object_t * p_this )
         goto error;
     }
 
+    /* Without cues, the clusters found are indexed while playing: keep them
+     * for the next times */
+    if( !p_segment->b_cues && p_segment->i_deferred_cues < 0 &&
+        p_stream->segments.size() == 1 )
+    {
+        seek_index_t *p_index = demux_SeekIndexNew( p_demux, "mkv" );
+        if( p_index )
+            p_segment->IndexCacheLoad( p_index );
+    }
+
     if (b_need_preload && var_InheritBool( p_demux, "mkv-preload-local-dir" ))
     {
         msg_Dbg( p_demux, "Preloading local dir" );
@@ -297,6 +312,10 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             ppp_attach = (input_attachment_t***)va_arg( args, input_attachment_t*** );
             pi_int = (int*)va_arg( args, int * );
 
+            for( size_t i = 0; i < p_sys->streams.size(); i++ )
+                for( size_t j = 0; j < p_sys->streams[i]->segments.size(); j++ )
+                    p_sys->streams[i]->segments[j]->LoadDeferredAttachments();
+
             if( p_sys->stored_attachments.size() <= 0 )
                 return VLC_EGENERIC;
 
@@ -432,6 +451,7 @@ static void Seek( demux_t *p_demux, mtime_t i_date, double f_percent, virtual_ch
     int         i_index;
 
     msg_Dbg( p_demux, "seek request to %"PRId64" (%f%%)", i_date, f_percent );
+    p_segment->LoadDeferredCues();
     if( i_date < 0 && f_percent < 0 )
     {
         msg_Warn( p_demux, "cannot seek nowhere!" );
@@ -34,6 +34,7 @@ vlc_stream_io_callback::vlc_stream_io_callback( stream_t *s_, bool b_owner_ )
                        : s( s_), b_owner( b_owner_ )
 {
     mb_eof = false;
+    b_prefetch = true;
 }
 
 uint32 vlc_stream_io_callback::read( void *p_buffer, size_t i_size )
@@ -102,3 +103,14 @@ uint64 vlc_stream_io_callback::toRead( void )
     return (uint64) i_size - stream_Tell( s );
 }
 
+/* Lets the stream read the next i_size bytes in the background, if it
+ * can. It is not retried once the stream has refused. */
+void vlc_stream_io_callback::prefetch( uint64_t i_size )
+{
+    if( s == NULL || !b_prefetch )
+        return;
+
+    if( stream_Control( s, STREAM_SET_PREFETCH_HINT, i_size ) )
+        b_prefetch = false;
+}
+
@@ -32,6 +32,7 @@ class vlc_stream_io_callback: public IOCallback
     stream_t       *s;
     bool           mb_eof;
     bool           b_owner;
+    bool           b_prefetch;
 
   public:
     vlc_stream_io_callback( stream_t *, bool );
@@ -48,5 +49,6 @@ class vlc_stream_io_callback: public IOCallback
     virtual uint64   getFilePointer  ( void );
     virtual void     close           ( void ) { return; }
     uint64           toRead          ( void );
+    void             prefetch        ( uint64_t i_size );
 };
 
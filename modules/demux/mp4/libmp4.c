@@ -3533,6 +3533,37 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t *s )
     return p_chunk;
 }
 
+/* Largest initialization segment MP4_PeekInitSegment will look at */
+#define MP4_INIT_SEGMENT_MAX (1 << 20)
+
+size_t MP4_PeekInitSegment( stream_t *s, const uint8_t **pp_peek )
+{
+    const uint8_t *p_peek;
+
+    /* large (64 bits) and open ended (null) sizes are not handled */
+    if( stream_Peek( s, &p_peek, 8 ) < 8 ||
+        VLC_FOURCC( p_peek[4], p_peek[5], p_peek[6], p_peek[7] ) != ATOM_ftyp )
+        return 0;
+    size_t i_ftyp = GetDWBE( p_peek );
+    if( i_ftyp < 8 || i_ftyp > MP4_INIT_SEGMENT_MAX - 8 )
+        return 0;
+
+    if( stream_Peek( s, &p_peek, i_ftyp + 8 ) < (int)i_ftyp + 8 ||
+        VLC_FOURCC( p_peek[i_ftyp + 4], p_peek[i_ftyp + 5],
+                    p_peek[i_ftyp + 6], p_peek[i_ftyp + 7] ) != ATOM_moov )
+        return 0;
+    size_t i_moov = GetDWBE( &p_peek[i_ftyp] );
+    if( i_moov < 8 || i_moov > MP4_INIT_SEGMENT_MAX - i_ftyp )
+        return 0;
+
+    size_t i_size = i_ftyp + i_moov;
+    if( stream_Peek( s, &p_peek, i_size ) < (int)i_size )
+        return 0;
+
+    *pp_peek = p_peek;
+    return i_size;
+}
+
 /*****************************************************************************
  * MP4_BoxGetRoot : Parse the entire file, and create all boxes in memory
  *****************************************************************************
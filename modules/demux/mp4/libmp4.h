@@ -1278,6 +1278,14 @@ typedef struct
     /* with this we can calculate dts/pts without waste memory */
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_last_dts;    /* DTS of the last sample */
+
+    /* position of the first sample in the stts/ctts tables, the dts/pts
+       tables of a chunk are only expanded from there when it is used */
+    uint32_t     i_stts_index;
+    uint32_t     i_stts_used;
+    uint32_t     i_ctts_index;
+    uint32_t     i_ctts_used;
+
     uint32_t     *p_sample_count_dts;
     uint32_t     *p_sample_delta_dts;   /* dts delta */
 
@@ -1330,6 +1338,7 @@ typedef struct
 
     mp4_chunk_t    *chunk; /* always defined  for each chunk */
     mp4_chunk_t    *cchunk; /* current chunk if b_fragmented is true */
+    uint32_t         i_chunk_expanded; /* chunk whose dts/pts tables are set */
 
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
@@ -1488,6 +1497,14 @@ MP4_Box_t *MP4_BoxGetSmooBox( stream_t * );
  *****************************************************************************/
 MP4_Box_t *MP4_BoxGetNextChunk( stream_t * );
 
+/*****************************************************************************
+ * MP4_PeekInitSegment : Peek the ftyp and moov boxes of an init segment.
+ *****************************************************************************
+ *  It returns the size of the initialization segment starting at the current
+ *  stream position, or 0 if there is none or if it is too large to be peeked.
+ *****************************************************************************/
+size_t MP4_PeekInitSegment( stream_t *, const uint8_t ** );
+
 /*****************************************************************************
  * MP4_BoxGetRoot : Parse the entire file, and create all boxes in memory
  *****************************************************************************
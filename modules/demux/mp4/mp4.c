@@ -80,6 +80,10 @@ struct demux_sys_t
 
     bool         b_fragmented;   /* fMP4 */
 
+    /* raw ftyp+moov of the last initialization segment (fMP4) */
+    uint8_t      *p_init;
+    size_t       i_init;
+
     /* */
     MP4_Box_t    *p_tref_chap;
 
@@ -107,32 +111,38 @@ static void     MP4_TrackSetELST( demux_t *, mp4_track_t *, int64_t );
 static void     MP4_UpdateSeekpoint( demux_t * );
 static const char *MP4_ConvertMacCode( uint16_t );
 
+static int      TrackExpandChunk( mp4_track_t *, uint32_t i_chunk );
+static void     StoreInitSegment( demux_t * );
+
 /* Return time in microsecond of a track */
 static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    mp4_chunk_t chunk;
+    const mp4_chunk_t *ck;
     if( p_sys->b_fragmented )
-        chunk = *p_track->cchunk;
+        ck = p_track->cchunk;
     else
-        chunk = p_track->chunk[p_track->i_chunk];
+    {
+        TrackExpandChunk( p_track, p_track->i_chunk );
+        ck = &p_track->chunk[p_track->i_chunk];
+    }
 
     unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - chunk.i_sample_first;
-    int64_t i_dts = chunk.i_first_dts;
+    unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
+    int64_t i_dts = ck->i_first_dts;
 
-    while( i_sample > 0 )
+    while( i_sample > 0 && ck->p_sample_count_dts )
     {
-        if( i_sample > chunk.p_sample_count_dts[i_index] )
+        if( i_sample > ck->p_sample_count_dts[i_index] )
         {
-            i_dts += chunk.p_sample_count_dts[i_index] *
-                chunk.p_sample_delta_dts[i_index];
-            i_sample -= chunk.p_sample_count_dts[i_index];
+            i_dts += ck->p_sample_count_dts[i_index] *
+                ck->p_sample_delta_dts[i_index];
+            i_sample -= ck->p_sample_count_dts[i_index];
             i_index++;
         }
         else
         {
-            i_dts += i_sample * chunk.p_sample_delta_dts[i_index];
+            i_dts += i_sample * ck->p_sample_delta_dts[i_index];
             break;
         }
     }
@@ -168,7 +178,10 @@ static inline int64_t MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_tra
     if( p_sys->b_fragmented )
         ck = p_track->cchunk;
     else
+    {
+        TrackExpandChunk( p_track, p_track->i_chunk );
         ck = &p_track->chunk[p_track->i_chunk];
+    }
 
     unsigned int i_index = 0;
     unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
@@ -358,6 +371,9 @@ static int Open( vlc_object_t * p_this )
         p_sys->b_fragmented = true;
     }
 
+    if( !b_smooth )
+        StoreInitSegment( p_demux );
+
     if( LoadInitFrag( p_demux, b_smooth ) != VLC_SUCCESS )
         goto error;
 
@@ -369,6 +385,11 @@ static int Open( vlc_object_t * p_this )
     {
         p_demux->pf_demux = DemuxFrg;
     }
+    else
+    {
+        FREENULL( p_sys->p_init );
+        p_sys->i_init = 0;
+    }
 
     stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &b_seekable );
     if( b_smooth )
@@ -638,6 +659,7 @@ error:
     {
         MP4_BoxFree( p_demux->s, p_sys->p_root );
     }
+    free( p_sys->p_init );
     free( p_sys );
     return VLC_EGENERIC;
 }
@@ -1174,6 +1196,7 @@ static void Close ( vlc_object_t * p_this )
     if( p_sys->p_title )
         vlc_input_title_Delete( p_sys->p_title );
 
+    free( p_sys->p_init );
     free( p_sys );
 }
 
@@ -1435,8 +1458,9 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
     /* Use stts table to create a sample number -> dts table.
      * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
+     *  the box! so each chunk only records where its samples start in this
+     *  table, and an "extract" of it is built by TrackExpandChunk when the
+     *  chunk is used (problem with raw stream where a sample is sometime
      *  just channels*bits_per_sample/8 */
 
     i_next_dts = 0;
@@ -1444,37 +1468,15 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
     {
         mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-        int64_t i_entry, i_sample_count, i;
+        int64_t i_sample_count = ck->i_sample_count;
 
         /* save first dts */
         ck->i_first_dts = i_next_dts;
         ck->i_last_dts  = i_next_dts;
+        ck->i_stts_index = i_index;
+        ck->i_stts_used  = i_index_sample_used;
 
-        /* count how many entries are needed for this chunk
-         * for p_sample_delta_dts and p_sample_count_dts */
-        i_sample_count = ck->i_sample_count;
-
-        i_entry = 0;
-        while( i_sample_count > 0 )
-        {
-            i_sample_count -= stts->i_sample_count[i_index+i_entry];
-            /* don't count already used sample in this entry */
-            if( i_entry == 0 )
-                i_sample_count += i_index_sample_used;
-
-            i_entry++;
-        }
-
-        /* allocate them */
-        ck->p_sample_count_dts = calloc( i_entry, sizeof( uint32_t ) );
-        ck->p_sample_delta_dts = calloc( i_entry, sizeof( uint32_t ) );
-
-        if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            return VLC_ENOMEM;
-
-        /* now copy */
-        i_sample_count = ck->i_sample_count;
-        for( i = 0; i < i_entry; i++ )
+        while( i_sample_count > 0 && i_index < stts->i_entry_count )
         {
             int64_t i_used;
             int64_t i_rest;
@@ -1487,10 +1489,8 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
             i_sample_count -= i_used;
             i_next_dts += i_used * stts->i_sample_delta[i_index];
 
-            ck->p_sample_count_dts[i] = i_used;
-            ck->p_sample_delta_dts[i] = stts->i_sample_delta[i_index];
             if( i_used > 0 )
-                ck->i_last_dts = i_next_dts - ck->p_sample_delta_dts[i];
+                ck->i_last_dts = i_next_dts - stts->i_sample_delta[i_index];
 
             if( i_index_sample_used >= stts->i_sample_count[i_index] )
             {
@@ -1510,38 +1510,17 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "CTTS table" );
 
-        /* Create pts-dts table per chunk */
+        /* Record where each chunk starts in the pts-dts table */
         i_index = 0; i_index_sample_used = 0;
         for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            int64_t i_entry, i_sample_count, i;
+            int64_t i_sample_count = ck->i_sample_count;
 
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            i_sample_count = ck->i_sample_count;
+            ck->i_ctts_index = i_index;
+            ck->i_ctts_used  = i_index_sample_used;
 
-            i_entry = 0;
-            while( i_sample_count > 0 )
-            {
-                i_sample_count -= ctts->i_sample_count[i_index+i_entry];
-
-                /* don't count already used sample in this entry */
-                if( i_entry == 0 )
-                    i_sample_count += i_index_sample_used;
-
-                i_entry++;
-            }
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( i_entry, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( i_entry, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-                return VLC_ENOMEM;
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-            for( i = 0; i < i_entry; i++ )
+            while( i_sample_count > 0 && i_index < ctts->i_entry_count )
             {
                 int64_t i_used;
                 int64_t i_rest;
@@ -1554,9 +1533,6 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
                 i_index_sample_used += i_used;
                 i_sample_count -= i_used;
 
-                ck->p_sample_count_pts[i] = i_used;
-                ck->p_sample_offset_pts[i] = ctts->i_sample_offset[i_index];
-
                 if( i_index_sample_used >= ctts->i_sample_count[i_index] )
                 {
                     i_index++;
@@ -1566,6 +1542,9 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         }
     }
 
+    /* no chunk has its tables expanded yet */
+    p_demux_track->i_chunk_expanded = p_demux_track->i_chunk_count;
+
     msg_Dbg( p_demux, "track[Id 0x%x] read %d samples length:%"PRId64"s",
              p_demux_track->i_track_ID, p_demux_track->i_sample_count,
              i_next_dts / p_demux_track->i_timescale );
@@ -1573,6 +1552,121 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
+/* Count the entries of a stts/ctts table used by i_sample_count samples
+ * starting at the i_used-th sample of the entry i_index */
+static uint32_t TrackCountEntries( const uint32_t *p_entry_sample_count,
+                                   uint32_t i_entry_count,
+                                   uint32_t i_index, uint32_t i_used,
+                                   uint32_t i_sample_count )
+{
+    uint32_t i_entry = 0;
+
+    while( i_sample_count > 0 && i_index < i_entry_count )
+    {
+        i_sample_count -= __MIN( p_entry_sample_count[i_index] - i_used,
+                                 i_sample_count );
+        i_used = 0;
+        i_index++;
+        i_entry++;
+    }
+    return i_entry;
+}
+
+/*
+ * TrackExpandChunk:
+ * Build the dts/pts tables of i_chunk from the stts/ctts boxes. Only the
+ * tables of the last expanded chunk are kept, so the memory used does not
+ * grow with the file duration.
+ */
+static int TrackExpandChunk( mp4_track_t *p_track, uint32_t i_chunk )
+{
+    if( i_chunk >= p_track->i_chunk_count )
+        return VLC_EGENERIC;
+
+    mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    if( ck->p_sample_count_dts )
+        return VLC_SUCCESS;
+
+    if( p_track->i_chunk_expanded < p_track->i_chunk_count )
+    {
+        mp4_chunk_t *old = &p_track->chunk[p_track->i_chunk_expanded];
+
+        FREENULL( old->p_sample_count_dts );
+        FREENULL( old->p_sample_delta_dts );
+        FREENULL( old->p_sample_count_pts );
+        FREENULL( old->p_sample_offset_pts );
+    }
+    p_track->i_chunk_expanded = p_track->i_chunk_count;
+
+    MP4_Box_t *p_box = MP4_BoxGet( p_track->p_stbl, "stts" );
+    if( !p_box )
+        return VLC_EGENERIC;
+    const MP4_Box_data_stts_t *stts = p_box->data.p_stts;
+
+    uint32_t i_entry = TrackCountEntries( stts->i_sample_count,
+                                          stts->i_entry_count,
+                                          ck->i_stts_index, ck->i_stts_used,
+                                          ck->i_sample_count );
+
+    /* allocate at least one entry, a NULL table means not expanded */
+    ck->p_sample_count_dts = calloc( __MAX( i_entry, 1 ), sizeof( uint32_t ) );
+    ck->p_sample_delta_dts = calloc( __MAX( i_entry, 1 ), sizeof( uint32_t ) );
+    if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
+        goto error;
+
+    uint32_t i_index = ck->i_stts_index;
+    uint32_t i_used = ck->i_stts_used;
+    uint32_t i_sample_count = ck->i_sample_count;
+    for( uint32_t i = 0; i < i_entry; i++, i_index++, i_used = 0 )
+    {
+        uint32_t i_count = __MIN( stts->i_sample_count[i_index] - i_used,
+                                  i_sample_count );
+
+        ck->p_sample_count_dts[i] = i_count;
+        ck->p_sample_delta_dts[i] = stts->i_sample_delta[i_index];
+        i_sample_count -= i_count;
+    }
+
+    p_box = MP4_BoxGet( p_track->p_stbl, "ctts" );
+    if( p_box )
+    {
+        const MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
+
+        i_entry = TrackCountEntries( ctts->i_sample_count,
+                                     ctts->i_entry_count,
+                                     ck->i_ctts_index, ck->i_ctts_used,
+                                     ck->i_sample_count );
+
+        ck->p_sample_count_pts = calloc( __MAX( i_entry, 1 ), sizeof( uint32_t ) );
+        ck->p_sample_offset_pts = calloc( __MAX( i_entry, 1 ), sizeof( int32_t ) );
+        if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
+            goto error;
+
+        i_index = ck->i_ctts_index;
+        i_used = ck->i_ctts_used;
+        i_sample_count = ck->i_sample_count;
+        for( uint32_t i = 0; i < i_entry; i++, i_index++, i_used = 0 )
+        {
+            uint32_t i_count = __MIN( ctts->i_sample_count[i_index] - i_used,
+                                      i_sample_count );
+
+            ck->p_sample_count_pts[i] = i_count;
+            ck->p_sample_offset_pts[i] = ctts->i_sample_offset[i_index];
+            i_sample_count -= i_count;
+        }
+    }
+
+    p_track->i_chunk_expanded = i_chunk;
+    return VLC_SUCCESS;
+
+error:
+    FREENULL( ck->p_sample_count_dts );
+    FREENULL( ck->p_sample_delta_dts );
+    FREENULL( ck->p_sample_count_pts );
+    FREENULL( ck->p_sample_offset_pts );
+    return VLC_ENOMEM;
+}
+
 /**
  * It computes the sample rate for a video track using the given sample
  * description index
@@ -2286,24 +2380,24 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / (int64_t)1000000;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
     /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
+    /* the last chunk starting at or before i_start, if i_start is after the
+       end of the track it will be check while searching i_sample */
+    uint32_t i_low = 0;
+    uint32_t i_high = p_track->i_chunk_count - 1;
+    while( i_low < i_high )
     {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
+        uint32_t i_mid = i_low + ( i_high - i_low + 1 ) / 2;
 
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
+        if( p_track->chunk[i_mid].i_first_dts <= (uint64_t)i_start )
+            i_low = i_mid;
+        else
+            i_high = i_mid - 1;
     }
+    i_chunk = i_low;
+
+    if( TrackExpandChunk( p_track, i_chunk ) )
+        return VLC_EGENERIC;
 
     /* *** find sample in the chunk *** */
     i_sample = p_track->chunk[i_chunk].i_sample_first;
@@ -2348,31 +2442,39 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         MP4_Box_data_stss_t *p_stss = p_box_stss->data.p_stss;
         msg_Dbg( p_demux, "track[Id 0x%x] using Sync Sample Box (stss)",
                  p_track->i_track_ID );
-        for( unsigned i_index = 0; i_index < p_stss->i_entry_count; i_index++ )
+        if( p_stss->i_entry_count > 0 )
         {
-            if( i_index >= p_stss->i_entry_count - 1 ||
-                i_sample < p_stss->i_sample_number[i_index+1] )
+            /* the last sync sample at or before i_sample (or the first one) */
+            unsigned i_low = 0;
+            unsigned i_high = p_stss->i_entry_count - 1;
+            while( i_low < i_high )
             {
-                unsigned i_sync_sample = p_stss->i_sample_number[i_index];
-                msg_Dbg( p_demux, "stts gives %d --> %d (sample number)",
-                         i_sample, i_sync_sample );
+                unsigned i_mid = i_low + ( i_high - i_low + 1 ) / 2;
 
-                if( i_sync_sample <= i_sample )
-                {
-                    while( i_chunk > 0 &&
-                           i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
-                        i_chunk--;
-                }
+                if( p_stss->i_sample_number[i_mid] <= i_sample )
+                    i_low = i_mid;
                 else
-                {
-                    while( i_chunk < p_track->i_chunk_count - 1 &&
-                           i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
-                                            p_track->chunk[i_chunk].i_sample_count )
-                        i_chunk++;
-                }
-                i_sample = i_sync_sample;
-                break;
+                    i_high = i_mid - 1;
             }
+
+            unsigned i_sync_sample = p_stss->i_sample_number[i_low];
+            msg_Dbg( p_demux, "stts gives %d --> %d (sample number)",
+                     i_sample, i_sync_sample );
+
+            if( i_sync_sample <= i_sample )
+            {
+                while( i_chunk > 0 &&
+                       i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
+                    i_chunk--;
+            }
+            else
+            {
+                while( i_chunk < p_track->i_chunk_count - 1 &&
+                       i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
+                                        p_track->chunk[i_chunk].i_sample_count )
+                    i_chunk++;
+            }
+            i_sample = i_sync_sample;
         }
     }
     else
@@ -3480,6 +3582,8 @@ static int MP4_frg_GetChunk( demux_t *p_demux, MP4_Box_t *p_chunk, unsigned *i_t
 
     uint32_t dur = 0, len;
     uint32_t chunk_duration = 0, chunk_size = 0;
+    /* the dts and pts-dts tables are run-length encoded like stts/ctts */
+    uint32_t i_dts_entry = 0, i_pts_entry = 0;
 
     /* Skip header of mdat */
     stream_Read( p_demux->s, NULL, 8 );
@@ -3490,16 +3594,32 @@ static int MP4_frg_GetChunk( demux_t *p_demux, MP4_Box_t *p_chunk, unsigned *i_t
             dur = p_trun_data->p_samples[i].i_duration;
         else
             dur = default_duration;
-        ret->p_sample_delta_dts[i] = dur;
         chunk_duration += dur;
 
-        ret->p_sample_count_dts[i] = ret->p_sample_count_pts[i] = 1;
+        if( i_dts_entry > 0 && ret->p_sample_delta_dts[i_dts_entry - 1] == dur )
+            ret->p_sample_count_dts[i_dts_entry - 1]++;
+        else
+        {
+            ret->p_sample_delta_dts[i_dts_entry] = dur;
+            ret->p_sample_count_dts[i_dts_entry++] = 1;
+        }
 
         if( ret->p_sample_offset_pts )
         {
-            ret->p_sample_offset_pts[i] =
+            int32_t i_offset =
                         p_trun_data->p_samples[i].i_composition_time_offset;
+
+            if( i_pts_entry > 0 &&
+                ret->p_sample_offset_pts[i_pts_entry - 1] == i_offset )
+                ret->p_sample_count_pts[i_pts_entry - 1]++;
+            else
+            {
+                ret->p_sample_offset_pts[i_pts_entry] = i_offset;
+                ret->p_sample_count_pts[i_pts_entry++] = 1;
+            }
         }
+        else
+            ret->p_sample_count_pts[0]++;
 
         if( p_trun_data->i_flags & MP4_TRUN_SAMPLE_SIZE )
             len = ret->p_sample_size[i] = p_trun_data->p_samples[i].i_size;
@@ -3525,6 +3645,29 @@ static int MP4_frg_GetChunk( demux_t *p_demux, MP4_Box_t *p_chunk, unsigned *i_t
     return VLC_SUCCESS;
 }
 
+/**
+ * Keep a copy of the initialization segment at the current position, to
+ * recognize it when it is repeated.
+ */
+static void StoreInitSegment( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint8_t *p_peek;
+    size_t i_init = MP4_PeekInitSegment( p_demux->s, &p_peek );
+
+    FREENULL( p_sys->p_init );
+    p_sys->i_init = 0;
+    if( i_init == 0 )
+        return;
+
+    p_sys->p_init = malloc( i_init );
+    if( p_sys->p_init )
+    {
+        memcpy( p_sys->p_init, p_peek, i_init );
+        p_sys->i_init = i_init;
+    }
+}
+
 /**
  * Get the next chunk of the track identified by i_tk_id.
  * \Note We don't want to seek all the time, so if the first chunk given by the
@@ -3540,6 +3683,20 @@ static int MP4_frg_GetChunks( demux_t *p_demux, const unsigned i_tk_id )
 
     for( unsigned i = 0; i < p_sys->i_tracks; i++ )
     {
+        /* DASH may repeat the same initialization segment: the moov is
+         * only parsed again (and the decoder restarted) if it changed */
+        const uint8_t *p_peek;
+        size_t i_init = MP4_PeekInitSegment( p_demux->s, &p_peek );
+        if( i_init > 0 && i_init == p_sys->i_init &&
+            !memcmp( p_peek, p_sys->p_init, i_init ) )
+        {
+            msg_Dbg( p_demux, "skipping repeated initialization segment" );
+            if( stream_Read( p_demux->s, NULL, i_init ) < (int)i_init )
+                return VLC_EGENERIC;
+        }
+        else if( i_init > 0 )
+            StoreInitSegment( p_demux );
+
         MP4_Box_t *p_chunk = MP4_BoxGetNextChunk( p_demux->s );
         if( !p_chunk )
             return VLC_EGENERIC;
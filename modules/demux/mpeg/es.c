@@ -82,6 +82,10 @@ vlc_module_end ()
 static int Demux  ( demux_t * );
 static int Control( demux_t *, int, va_list );
 
+/* A position found in the index is used to seek up to this long after it,
+ * even when the index does not cover the target */
+#define ES_INDEX_REACH (INT64_C(10) * CLOCK_FREQ)
+
 typedef struct
 {
     vlc_fourcc_t i_codec;
@@ -115,6 +119,12 @@ struct demux_sys_t
 
     int64_t i_stream_offset;
 
+    /* Position of the next frame output by the packetizer, -1 when it is
+     * not known exactly (nothing is indexed then) */
+    int64_t i_frame_pos;
+    seek_index_t *p_index;
+    int     i_rate;
+
     float   f_fps;
 
     /* Mpga specific */
@@ -124,6 +134,12 @@ struct demux_sys_t
         int i_bytes;
         int i_bitrate_avg;
         int i_frame_samples;
+
+        /* Xing or VBRI seek table: i_toc + 1 positions relative to the
+         * stream start, evenly spaced over the first i_toc_frames frames */
+        int64_t *p_toc;
+        int i_toc;
+        int i_toc_frames;
     } xing;
 };
 
@@ -178,6 +194,8 @@ static int OpenCommon( demux_t *p_demux,
     p_sys->p_es = NULL;
     p_sys->b_start = true;
     p_sys->i_stream_offset = i_bs_offset;
+    p_sys->i_frame_pos = -1;
+    p_sys->p_index = NULL;
     p_sys->b_estimate_bitrate = true;
     p_sys->i_bitrate_avg = 0;
     p_sys->b_big_endian = false;
@@ -203,10 +221,16 @@ static int OpenCommon( demux_t *p_demux,
     p_sys->p_packetizer = demux_PacketizerNew( p_demux, &fmt, p_sys->codec.psz_name );
     if( !p_sys->p_packetizer )
     {
+        free( p_sys->xing.p_toc );
         free( p_sys );
         return VLC_EGENERIC;
     }
 
+    /* Only the codecs whose frames are output unchanged by the packetizer
+     * can record their positions */
+    if( p_sys->i_frame_pos >= 0 )
+        p_sys->p_index = demux_SeekIndexNew( p_demux, "es" );
+
     while( vlc_object_alive( p_demux ) )
     {
         if( Parse( p_demux, &p_sys->p_packetized_data ) )
@@ -298,6 +322,15 @@ static int Demux( demux_t *p_demux )
             p_sys->i_bitrate_avg = 8*INT64_C(1000000)*p_sys->i_bytes/(p_sys->i_pts-1);
         p_sys->i_bytes += p_block_out->i_buffer;
 
+        if( p_sys->i_frame_pos >= 0 )
+        {
+            if( p_sys->p_index && p_block_out->i_pts > VLC_TS_INVALID )
+                demux_SeekIndexAdd( p_sys->p_index,
+                                    p_block_out->i_pts - VLC_TS_0,
+                                    p_sys->i_frame_pos );
+            p_sys->i_frame_pos += p_block_out->i_buffer;
+        }
+
 
         p_block_out->p_next = NULL;
         es_out_Send( p_demux->out, p_sys->p_es, p_block_out );
@@ -318,9 +351,121 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->p_packetized_data )
         block_ChainRelease( p_sys->p_packetized_data );
     demux_PacketizerDestroy( p_sys->p_packetizer );
+    if( p_sys->p_index )
+        demux_SeekIndexDelete( p_sys->p_index );
+    free( p_sys->xing.p_toc );
     free( p_sys );
 }
 
+/*****************************************************************************
+ * Seeking:
+ *****************************************************************************/
+static mtime_t GetDuration( demux_sys_t *p_sys )
+{
+    if( p_sys->i_rate <= 0 || p_sys->xing.i_frames <= 0 ||
+        p_sys->xing.i_frame_samples <= 0 )
+        return 0;
+    return CLOCK_FREQ * p_sys->xing.i_frames * p_sys->xing.i_frame_samples /
+           p_sys->i_rate;
+}
+
+/* Interpolates the position of i_time in the Xing or VBRI table */
+static int TocLookup( demux_sys_t *p_sys, mtime_t i_time, int64_t *pi_pos )
+{
+    if( !p_sys->xing.p_toc || p_sys->i_rate <= 0 ||
+        p_sys->xing.i_frame_samples <= 0 )
+        return VLC_EGENERIC;
+
+    const double f_entry = (double)i_time * p_sys->i_rate /
+                           p_sys->xing.i_frame_samples / CLOCK_FREQ *
+                           p_sys->xing.i_toc / p_sys->xing.i_toc_frames;
+    if( f_entry >= p_sys->xing.i_toc )
+        return VLC_EGENERIC;
+
+    const int i = f_entry;
+    const int64_t *p_toc = p_sys->xing.p_toc;
+    *pi_pos = p_sys->i_stream_offset + p_toc[i] +
+              ( p_toc[i+1] - p_toc[i] ) * ( f_entry - i );
+    return VLC_SUCCESS;
+}
+
+/* Restarts the packetizer at i_pos, where the stream time is i_time */
+static int SeekPacketizer( demux_t *p_demux, int64_t i_pos, mtime_t i_time,
+                           bool b_exact )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    es_format_t fmt;
+
+    /* A new packetizer does not keep any data from before the seek, and
+     * starts again with the timestamp of its first frame */
+    es_format_Init( &fmt, AUDIO_ES, p_sys->codec.i_codec );
+    decoder_t *p_packetizer = demux_PacketizerNew( p_demux, &fmt,
+                                                   p_sys->codec.psz_name );
+    if( !p_packetizer )
+        return VLC_EGENERIC;
+
+    if( stream_Seek( p_demux->s, i_pos ) )
+    {
+        demux_PacketizerDestroy( p_packetizer );
+        return VLC_EGENERIC;
+    }
+    demux_PacketizerDestroy( p_sys->p_packetizer );
+    p_sys->p_packetizer = p_packetizer;
+
+    if( p_sys->p_packetized_data )
+        block_ChainRelease( p_sys->p_packetized_data );
+    p_sys->p_packetized_data = NULL;
+
+    p_sys->b_start = true;
+    p_sys->i_pts = 0;
+    p_sys->i_time_offset = i_time;
+    p_sys->i_bytes = 0;
+    p_sys->i_frame_pos = b_exact && p_sys->p_index ? i_pos : -1;
+    return VLC_SUCCESS;
+}
+
+static int SeekTime( demux_t *p_demux, mtime_t i_time, bool b_precise )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    seek_index_entry_t before, after;
+    int64_t i_pos;
+
+    if( p_sys->p_packetizer->fmt_in.i_cat != AUDIO_ES || i_time < 0 )
+        return VLC_EGENERIC;
+
+    if( p_sys->p_index &&
+        !demux_SeekIndexLookup( p_sys->p_index, i_time, &before, &after ) &&
+        before.i_pos >= 0 )
+    {
+        const bool b_near = after.i_pos >= 0 ||
+                            i_time - before.i_time <= ES_INDEX_REACH;
+
+        if( !b_near && !TocLookup( p_sys, i_time, &i_pos ) )
+            ;
+        else if( !b_near && p_sys->i_bitrate_avg > 0 )
+        {
+            /* Beyond the index, extrapolate from its last position */
+            i_pos = before.i_pos + ( i_time - before.i_time ) *
+                                   p_sys->i_bitrate_avg / INT64_C(8000000);
+        }
+        else
+        {
+            /* Indexed positions are frame starts: seek there, and let the
+             * decoder skip what is before the target */
+            if( SeekPacketizer( p_demux, before.i_pos, before.i_time, true ) )
+                return VLC_EGENERIC;
+            if( b_precise )
+                es_out_Control( p_demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME,
+                                VLC_TS_0 + i_time );
+            return VLC_SUCCESS;
+        }
+    }
+    else if( TocLookup( p_sys, i_time, &i_pos ) )
+        return VLC_EGENERIC;
+
+    return SeekPacketizer( p_demux, i_pos, i_time, false );
+}
+
 /*****************************************************************************
  * Control:
  *****************************************************************************/
@@ -369,10 +514,38 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             va_end( args_save );
             return i_ret;
 
+        case DEMUX_GET_POSITION:
+        {
+            /* Stay consistent with DEMUX_SET_POSITION */
+            const mtime_t i_duration = GetDuration( p_sys );
+            if( i_duration <= 0 || !p_sys->xing.p_toc )
+                goto helper;
+            double *pf = (double *)va_arg( args, double * );
+            *pf = (double)( p_sys->i_pts + p_sys->i_time_offset ) / i_duration;
+            return VLC_SUCCESS;
+        }
+
+        case DEMUX_SET_POSITION:
+        {
+            const mtime_t i_duration = GetDuration( p_sys );
+            if( i_duration <= 0 || !p_sys->xing.p_toc )
+                goto helper;
+            const double f = va_arg( args_save, double );
+            if( SeekTime( p_demux, f * i_duration, false ) )
+                goto helper;
+            return VLC_SUCCESS;
+        }
+
         case DEMUX_SET_TIME:
-            /* FIXME TODO: implement a high precision seek (with mp3 parsing)
-             * needed for multi-input */
+        {
+            const int64_t i_time = va_arg( args_save, int64_t );
+            const bool b_precise = va_arg( args_save, int );
+            if( !SeekTime( p_demux, i_time, b_precise ) )
+                return VLC_SUCCESS;
+        }
+        /* fall through */
         default:
+        helper:
             i_ret = demux_vaControlHelper( p_demux->s, p_sys->i_stream_offset, -1,
                                             p_sys->i_bitrate_avg, 1, i_query,
                                             args );
@@ -413,7 +586,11 @@ static bool Parse( demux_t *p_demux, block_t **pp_output )
             stream_Read( p_demux->s, NULL, 1 );
     }
 
-    p_block_in = stream_Block( p_demux->s, p_sys->i_packet_size );
+    /* Byte swapping needs word aligned blocks */
+    if( p_sys->codec.b_use_word )
+        p_block_in = stream_Block( p_demux->s, p_sys->i_packet_size );
+    else
+        p_block_in = stream_ReadBlock( p_demux->s, p_sys->i_packet_size );
     bool b_eof = p_block_in == NULL;
 
     if( p_block_in )
@@ -438,6 +615,7 @@ static bool Parse( demux_t *p_demux, block_t **pp_output )
                 p_sys->p_packetizer->fmt_out.b_packetized = true;
                 p_sys->p_es = es_out_Add( p_demux->out,
                                           &p_sys->p_packetizer->fmt_out);
+                p_sys->i_rate = p_sys->p_packetizer->fmt_out.audio.i_rate;
 
 
                 /* Try the xing header */
@@ -737,6 +915,50 @@ static uint32_t MpgaXingGetDWBE( const uint8_t **pp_xing, int *pi_xing, uint32_t
     return v;
 }
 
+/* Loads a potential VBRI header (Fraunhofer encoder), which always follows
+ * the 32 bytes of side information of the first frame */
+static int MpgaVbriInit( demux_t *p_demux, const uint8_t *p_peek, int i_peek )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( i_peek < 4 + 32 + 26 || memcmp( &p_peek[4 + 32], "VBRI", 4 ) )
+        return VLC_EGENERIC;
+
+    const uint8_t *p_vbri = &p_peek[4 + 32];
+    const int i_bytes   = GetDWBE( &p_vbri[10] );
+    const int i_frames  = GetDWBE( &p_vbri[14] );
+    const int i_entries = GetWBE( &p_vbri[18] );
+    const int i_scale   = GetWBE( &p_vbri[20] );
+    const int i_size    = GetWBE( &p_vbri[22] );
+    const int i_span    = GetWBE( &p_vbri[24] );
+
+    p_sys->xing.i_bytes = i_bytes;
+    p_sys->xing.i_frames = i_frames;
+    msg_Dbg( p_demux, "vbri header present (%d bytes, %d frames)",
+             i_bytes, i_frames );
+
+    if( i_entries <= 0 || i_span <= 0 || i_size < 1 || i_size > 4 ||
+        26 + i_entries * i_size > i_peek - 4 - 32 ||
+        !( p_sys->xing.p_toc = malloc( ( i_entries + 1 ) * sizeof(int64_t) ) ) )
+        return VLC_SUCCESS;
+
+    /* Each entry is the size of the next i_span frames */
+    const uint8_t *p_entry = &p_vbri[26];
+    int64_t i_pos = 0;
+    for( int i = 0; i < i_entries; i++ )
+    {
+        uint32_t i_delta = 0;
+        for( int j = 0; j < i_size; j++ )
+            i_delta = ( i_delta << 8 ) | *p_entry++;
+        p_sys->xing.p_toc[i] = i_pos;
+        i_pos += (int64_t)i_delta * i_scale;
+    }
+    p_sys->xing.p_toc[i_entries] = i_pos;
+    p_sys->xing.i_toc = i_entries;
+    p_sys->xing.i_toc_frames = i_entries * i_span;
+    return VLC_SUCCESS;
+}
+
 static int MpgaInit( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -747,8 +969,8 @@ static int MpgaInit( demux_t *p_demux )
     /* */
     p_sys->i_packet_size = 1024;
 
-    /* Load a potential xing header */
-    i_peek = stream_Peek( p_demux->s, &p_peek, 4 + 1024 );
+    /* Load a potential xing or vbri header */
+    i_peek = stream_Peek( p_demux->s, &p_peek, 4 + 4096 );
     if( i_peek < 4 + 21 )
         return VLC_SUCCESS;
 
@@ -756,6 +978,14 @@ static int MpgaInit( demux_t *p_demux )
     if( !MpgaCheckSync( p_peek ) )
         return VLC_SUCCESS;
 
+    /* The packetizer outputs the frames as they are in the stream, their
+     * positions can be tracked from the first one */
+    p_sys->i_frame_pos = p_sys->i_stream_offset;
+    p_sys->xing.i_frame_samples = MpgaGetFrameSamples( header );
+
+    if( !MpgaVbriInit( p_demux, p_peek, i_peek ) )
+        return VLC_SUCCESS;
+
     /* Xing header */
     const uint8_t *p_xing = p_peek;
     int i_xing = i_peek;
@@ -777,8 +1007,24 @@ static int MpgaInit( demux_t *p_demux )
         p_sys->xing.i_frames = MpgaXingGetDWBE( &p_xing, &i_xing, 0 );
     if( i_flags&0x02 )
         p_sys->xing.i_bytes = MpgaXingGetDWBE( &p_xing, &i_xing, 0 );
-    if( i_flags&0x04 ) /* TODO Support XING TOC to improve seeking accuracy */
+    if( i_flags&0x04 )
+    {
+        if( i_xing >= 100 && p_sys->xing.i_frames > 0 &&
+            p_sys->xing.i_bytes > 0 &&
+            ( p_sys->xing.p_toc = malloc( 101 * sizeof(int64_t) ) ) )
+        {
+            /* Entry i is the position of i% of the duration, as a fraction
+             * of the stream size scaled to 256 */
+            for( int i = 0; i < 100; i++ )
+                p_sys->xing.p_toc[i] = (int64_t)p_xing[i] *
+                                       p_sys->xing.i_bytes / 256;
+            p_sys->xing.p_toc[100] = p_sys->xing.i_bytes;
+            p_sys->xing.i_toc = 100;
+            p_sys->xing.i_toc_frames = p_sys->xing.i_frames;
+            msg_Dbg( p_demux, "xing toc present" );
+        }
         MpgaXingSkip( &p_xing, &i_xing, 100 );
+    }
     if( i_flags&0x08 )
     {
         /* FIXME: doesn't return the right bitrage average, at least
@@ -790,7 +1036,6 @@ static int MpgaInit( demux_t *p_demux )
 
     if( p_sys->xing.i_frames > 0 && p_sys->xing.i_bytes > 0 )
     {
-        p_sys->xing.i_frame_samples = MpgaGetFrameSamples( header );
         msg_Dbg( p_demux, "xing frames&bytes value present "
                  "(%d bytes, %d frames, %d samples/frame)",
                  p_sys->xing.i_bytes, p_sys->xing.i_frames,
@@ -180,6 +180,8 @@ static int Open( vlc_object_t * p_this )
     /* */
     TAB_INIT( p_sys->i_seekpoints, p_sys->pp_seekpoints );
 
+    p_sys->p_index = demux_SeekIndexNew( p_demux, "ogg" );
+
     return VLC_SUCCESS;
 }
 
@@ -201,6 +203,8 @@ static void Close( vlc_object_t *p_this )
 
     TAB_CLEAN( p_sys->i_seekpoints, p_sys->pp_seekpoints );
 
+    if( p_sys->p_index )
+        demux_SeekIndexDelete( p_sys->p_index );
     free( p_sys );
 }
 
@@ -416,11 +420,63 @@ static int Demux( demux_t * p_demux )
     }
 
     if( p_sys->i_pcr >= 0 && ! b_skipping )
+    {
         es_out_Control( p_demux->out, ES_OUT_SET_PCR, VLC_TS_0 + p_sys->i_pcr );
+        if( p_sys->p_index && p_sys->i_bos == 0 )
+            demux_SeekIndexAdd( p_sys->p_index, p_sys->i_pcr, p_sys->i_page_pos );
+    }
 
     return 1;
 }
 
+static void Ogg_ResetStreamHelper( demux_sys_t *p_sys );
+
+/*****************************************************************************
+ * Ogg_SeekTime: seeks to the page containing i_time.
+ *****************************************************************************
+ * The positions of the times already played are used first; otherwise the
+ * position is interpolated between the closest known times around i_time
+ * instead of the full file.
+ *****************************************************************************/
+static int Ogg_SeekTime( demux_t *p_demux, mtime_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    seek_index_entry_t before, after;
+
+    if( !p_sys->p_index )
+        return VLC_EGENERIC;
+
+    if( demux_SeekIndexLookup( p_sys->p_index, i_time, &before, &after ) )
+        before.i_pos = after.i_pos = -1;
+    if( before.i_pos < 0 )
+    {
+        before.i_time = 0;
+        before.i_pos = 0;
+    }
+    if( after.i_pos < 0 )
+    {
+        /* Without the length, only the start can be bracketed */
+        if( p_sys->i_length <= 0 || p_sys->i_total_length <= 0 )
+            return VLC_EGENERIC;
+        after.i_time = p_sys->i_length * CLOCK_FREQ;
+        after.i_pos = p_sys->i_total_length;
+    }
+
+    int64_t i_pos = before.i_pos;
+    if( i_time - before.i_time > CLOCK_FREQ / 2 && after.i_time > before.i_time )
+    {
+        i_pos += ( after.i_pos - before.i_pos ) *
+                 (double)( i_time - before.i_time ) /
+                 ( after.i_time - before.i_time );
+        if( i_pos > after.i_pos )
+            i_pos = after.i_pos;
+    }
+    msg_Dbg( p_demux, "seeking to %"PRId64" for time %"PRId64, i_pos, i_time );
+
+    Ogg_ResetStreamHelper( p_sys );
+    return stream_Seek( p_demux->s, i_pos );
+}
+
 static void Ogg_ResetStreamHelper( demux_sys_t *p_sys )
 {
     for( int i = 0; i < p_sys->i_streams; i++ )
@@ -466,7 +522,9 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             return VLC_SUCCESS;
 
         case DEMUX_SET_TIME:
-            return VLC_EGENERIC;
+            if( p_sys->i_bos > 0 )
+                return VLC_EGENERIC;
+            return Ogg_SeekTime( p_demux, (int64_t)va_arg( args, int64_t ) );
 
         case DEMUX_GET_ATTACHMENTS:
         {
@@ -578,6 +636,10 @@ static int Ogg_ReadPage( demux_t *p_demux, ogg_page *p_oggpage )
         ogg_sync_wrote( &p_ogg->oy, i_read );
     }
 
+    /* The page ends at the first byte not yet returned by the sync layer */
+    p_ogg->i_page_pos = stream_Tell( p_demux->s ) -
+                        ( p_ogg->oy.fill - p_ogg->oy.returned ) -
+                        ( p_oggpage->header_len + p_oggpage->body_len );
     return VLC_SUCCESS;
 }
 
@@ -115,8 +115,12 @@ struct demux_sys_t
     /* offset position in file (for reading) */
     int64_t i_input_position;
 
-    /* current page being parsed */
+    /* current page being parsed, and its offset in the file */
     ogg_page current_page;
+    int64_t i_page_pos;
+
+    /* positions of the times already demuxed, NULL if not indexable */
+    seek_index_t *p_index;
 
     /* */
     vlc_meta_t          *p_meta;
@@ -93,6 +93,8 @@ struct demux_sys_t
     bool  b_lost_sync;
     bool  b_have_pack;
     bool  b_seekable;
+
+    seek_index_t *p_index;
 };
 
 static int Demux  ( demux_t *p_demux );
@@ -147,6 +149,10 @@ static int OpenCommon( vlc_object_t *p_this, bool b_force )
 
     stream_Control( p_demux->s, STREAM_CAN_SEEK, &p_sys->b_seekable );
 
+    bool b_fastseek = false;
+    stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &b_fastseek );
+    p_sys->p_index = b_fastseek ? demux_SeekIndexNew( p_demux, "ps" ) : NULL;
+
     ps_psm_init( &p_sys->psm );
     ps_track_init( p_sys->tk );
 
@@ -186,6 +192,8 @@ static void Close( vlc_object_t *p_this )
 
     ps_psm_destroy( &p_sys->psm );
 
+    if( p_sys->p_index )
+        demux_SeekIndexDelete( p_sys->p_index );
     free( p_sys );
 }
 
@@ -195,6 +203,7 @@ static int Demux2( demux_t *p_demux, bool b_end )
     int i_ret, i_id;
     uint32_t i_code;
     block_t *p_pkt;
+    int64_t i_pos;
 
     i_ret = ps_pkt_resynch( p_demux->s, &i_code );
     if( i_ret < 0 )
@@ -213,6 +222,7 @@ static int Demux2( demux_t *p_demux, bool b_end )
     if( p_sys->b_lost_sync ) msg_Warn( p_demux, "found sync code" );
     p_sys->b_lost_sync = false;
 
+    i_pos = stream_Tell( p_demux->s );
     if( ( p_pkt = ps_pkt_read( p_demux->s, i_code ) ) == NULL )
     {
         return 0;
@@ -225,6 +235,7 @@ static int Demux2( demux_t *p_demux, bool b_end )
             if( b_end && p_pkt->i_pts > tk->i_last_pts )
             {
                 tk->i_last_pts = p_pkt->i_pts;
+                tk->i_last_pos = i_pos;
             }
             else if ( tk->i_first_pts == -1 )
             {
@@ -236,31 +247,15 @@ static int Demux2( demux_t *p_demux, bool b_end )
     return 1;
 }
 
-static void FindLength( demux_t *p_demux )
+/* The end of the stream is probed for the last timestamps with a window
+ * that grows until a track has one, so that a few packs are read in the
+ * usual case */
+#define PS_TAIL_MIN (32 * 1024)
+#define PS_TAIL_MAX (4 * 1024 * 1024)
+
+static bool FindLengthTrack( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    int64_t i_current_pos = -1, i_size = 0, i_end = 0;
-
-    if( !var_CreateGetBool( p_demux, "ps-trust-timestamps" ) )
-        return;
-
-    if( p_sys->i_length == -1 ) /* First time */
-    {
-        p_sys->i_length = 0;
-        /* Check beginning */
-        int i = 0;
-        i_current_pos = stream_Tell( p_demux->s );
-        while( vlc_object_alive (p_demux) && i < 40 && Demux2( p_demux, false ) > 0 ) i++;
-
-        /* Check end */
-        i_size = stream_Size( p_demux->s );
-        i_end = VLC_CLIP( i_size, 0, 200000 );
-        stream_Seek( p_demux->s, i_size - i_end );
-
-        i = 0;
-        while( vlc_object_alive (p_demux) && i < 40 && Demux2( p_demux, true ) > 0 ) i++;
-        if( i_current_pos >= 0 ) stream_Seek( p_demux->s, i_current_pos );
-    }
 
     /* Find the longest track */
     for( int i = 0; i < PS_TK_COUNT; i++ )
@@ -278,6 +273,84 @@ static void FindLength( demux_t *p_demux )
             }
         }
     }
+    return p_sys->i_time_track >= 0;
+}
+
+/* Uses the end of the stream recorded in the index by a previous open */
+static bool FindLengthFromIndex( demux_t *p_demux, int64_t i_size )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    seek_index_entry_t last;
+
+    if( !p_sys->p_index ||
+        demux_SeekIndexLookup( p_sys->p_index, INT64_MAX, &last, NULL ) ||
+        last.i_pos < i_size - PS_TAIL_MIN || last.i_time <= 0 )
+        return false;
+
+    /* Index times are relative to the track starting first */
+    for( int i = 0; i < PS_TK_COUNT; i++ )
+    {
+        ps_track_t *tk = &p_sys->tk[i];
+        if( tk->i_first_pts >= 0 && ( p_sys->i_time_track < 0 ||
+            tk->i_first_pts < p_sys->tk[p_sys->i_time_track].i_first_pts ) )
+            p_sys->i_time_track = i;
+    }
+    if( p_sys->i_time_track < 0 )
+        return false;
+
+    p_sys->i_length = last.i_time;
+    msg_Dbg( p_demux, "we found a length of: %"PRId64" in the index",
+             p_sys->i_length );
+    return true;
+}
+
+static void FindLength( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    int64_t i_current_pos = -1, i_size = 0, i_end = 0;
+
+    if( !var_CreateGetBool( p_demux, "ps-trust-timestamps" ) )
+        return;
+
+    if( p_sys->i_length != -1 )
+    {
+        FindLengthTrack( p_demux );
+        return;
+    }
+
+    /* First time */
+    p_sys->i_length = 0;
+    /* Check beginning */
+    int i = 0;
+    i_current_pos = stream_Tell( p_demux->s );
+    while( vlc_object_alive (p_demux) && i < 40 && Demux2( p_demux, false ) > 0 ) i++;
+
+    /* Check end */
+    i_size = stream_Size( p_demux->s );
+    if( !FindLengthFromIndex( p_demux, i_size ) )
+    {
+        for( i_end = PS_TAIL_MIN; vlc_object_alive (p_demux); i_end *= 4 )
+        {
+            i_end = VLC_CLIP( i_end, 0, i_size );
+            if( stream_Seek( p_demux->s, i_size - i_end ) )
+                break;
+
+            while( vlc_object_alive (p_demux) && Demux2( p_demux, true ) > 0 );
+
+            if( FindLengthTrack( p_demux ) ||
+                i_end >= __MIN( i_size, PS_TAIL_MAX ) )
+                break;
+        }
+
+        /* Remember the end for the next times */
+        if( p_sys->p_index && p_sys->i_time_track >= 0 )
+        {
+            const ps_track_t *tk = &p_sys->tk[p_sys->i_time_track];
+            demux_SeekIndexAdd( p_sys->p_index, p_sys->i_length,
+                                tk->i_last_pos );
+        }
+    }
+    if( i_current_pos >= 0 ) stream_Seek( p_demux->s, i_current_pos );
 }
 
 /*****************************************************************************
@@ -289,6 +362,7 @@ static int Demux( demux_t *p_demux )
     int i_ret, i_id, i_mux_rate;
     uint32_t i_code;
     block_t *p_pkt;
+    int64_t i_pos;
 
     i_ret = ps_pkt_resynch( p_demux->s, &i_code );
     if( i_ret < 0 )
@@ -310,6 +384,7 @@ static int Demux( demux_t *p_demux )
     if( p_sys->i_length < 0 && p_sys->b_seekable )
         FindLength( p_demux );
 
+    i_pos = stream_Tell( p_demux->s );
     if( ( p_pkt = ps_pkt_read( p_demux->s, i_code ) ) == NULL )
     {
         return 0;
@@ -430,6 +505,12 @@ static int Demux( demux_t *p_demux )
                     p_sys->i_current_pts = (int64_t)p_pkt->i_pts;
                 }
 
+                if( p_sys->p_index && p_pkt->i_pts > VLC_TS_INVALID &&
+                    PS_ID_TO_TK(i_id) == p_sys->i_time_track &&
+                    tk->i_first_pts >= 0 && p_pkt->i_pts >= tk->i_first_pts )
+                    demux_SeekIndexAdd( p_sys->p_index,
+                                        p_pkt->i_pts - tk->i_first_pts, i_pos );
+
                 es_out_Send( p_demux->out, tk->es, p_pkt );
             }
             else
@@ -450,11 +531,30 @@ static int Demux( demux_t *p_demux )
 /*****************************************************************************
  * Control:
  *****************************************************************************/
+
+/* Returns the position of i_time from the index entries around it, or -1 */
+static int64_t SeekIndexPosition( demux_sys_t *p_sys, mtime_t i_time )
+{
+    seek_index_entry_t before, after;
+
+    if( !p_sys->p_index || p_sys->i_time_track < 0 ||
+        demux_SeekIndexLookup( p_sys->p_index, i_time, &before, &after ) )
+        return -1;
+
+    if( before.i_pos >= 0 && after.i_pos > before.i_pos &&
+        after.i_time > before.i_time )
+        return before.i_pos + ( after.i_pos - before.i_pos ) *
+               ( i_time - before.i_time ) / ( after.i_time - before.i_time );
+    if( before.i_pos >= 0 && i_time - before.i_time <= CLOCK_FREQ )
+        return before.i_pos;
+    return -1;
+}
+
 static int Control( demux_t *p_demux, int i_query, va_list args )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
     double f, *pf;
-    int64_t i64, *pi64;
+    int64_t i64, *pi64, i_index_pos;
 
     switch( i_query )
     {
@@ -514,6 +614,13 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
             i64 = (int64_t)va_arg( args, int64_t );
+            i_index_pos = SeekIndexPosition( p_sys, i64 );
+            if( i_index_pos >= 0 )
+            {
+                p_sys->i_current_pts = 0;
+                p_sys->i_last_scr = -1;
+                return stream_Seek( p_demux->s, i_index_pos );
+            }
             if( p_sys->i_time_track >= 0 && p_sys->i_current_pts > 0 )
             {
                 int64_t i_now = p_sys->i_current_pts - p_sys->tk[p_sys->i_time_track].i_first_pts;
@@ -541,9 +648,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
  *****************************************************************************/
 
 /* PSResynch: resynch on a system startcode
- *  It doesn't skip more than 512 bytes
+ *  It doesn't skip more than PS_RESYNCH_PEEK bytes
  *  -1 -> error, 0 -> not synch, 1 -> ok
  */
+#define PS_RESYNCH_PEEK 8192
+
 static int ps_pkt_resynch( stream_t *s, uint32_t *pi_code )
 {
     const uint8_t *p_peek;
@@ -561,29 +670,20 @@ static int ps_pkt_resynch( stream_t *s, uint32_t *pi_code )
         return 1;
     }
 
-    if( ( i_peek = stream_Peek( s, &p_peek, 512 ) ) < 4 )
+    if( ( i_peek = stream_Peek( s, &p_peek, PS_RESYNCH_PEEK ) ) < 4 )
     {
         return -1;
     }
-    i_skip = 0;
 
-    for( ;; )
+    i_skip = ps_pkt_find_startcode( p_peek, i_peek );
+    if( i_skip >= 0 )
     {
-        if( i_peek < 4 )
-        {
-            break;
-        }
-        if( p_peek[0] == 0 && p_peek[1] == 0 && p_peek[2] == 1 &&
-            p_peek[3] >= 0xb9 )
-        {
-            *pi_code = 0x100 | p_peek[3];
-            return stream_Read( s, NULL, i_skip ) == i_skip ? 1 : -1;
-        }
-
-        p_peek++;
-        i_peek--;
-        i_skip++;
+        *pi_code = 0x100 | p_peek[i_skip + 3];
+        return stream_Read( s, NULL, i_skip ) == i_skip ? 1 : -1;
     }
+
+    /* Keep the last bytes, they may start a code */
+    i_skip = i_peek - 3;
     return stream_Read( s, NULL, i_skip ) == i_skip ? 0 : -1;
 }
 
@@ -606,15 +706,11 @@ static block_t *ps_pkt_read( stream_t *s, uint32_t i_code )
             {
                 return NULL;
             }
-            while( i_size <= i_peek - 4 )
-            {
-                if( p_peek[i_size] == 0x00 && p_peek[i_size+1] == 0x00 &&
-                    p_peek[i_size+2] == 0x01 && p_peek[i_size+3] >= 0xb9 )
-                {
-                    return stream_Block( s, i_size );
-                }
-                i_size++;
-            }
+            int i_next = ps_pkt_find_startcode( &p_peek[i_size],
+                                                i_peek - i_size );
+            if( i_next >= 0 )
+                return stream_Block( s, i_size + i_next );
+            i_size = i_peek - 3;
         }
     }
     else
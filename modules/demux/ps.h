@@ -58,6 +58,7 @@ typedef struct
     es_format_t fmt;
     mtime_t     i_first_pts;
     mtime_t     i_last_pts;
+    int64_t     i_last_pos; /* Position of the packet with i_last_pts */
 
 } ps_track_t;
 
@@ -73,6 +74,7 @@ static inline void ps_track_init( ps_track_t tk[PS_TK_COUNT] )
         tk[i].es     = NULL;
         tk[i].i_first_pts = -1;
         tk[i].i_last_pts = -1;
+        tk[i].i_last_pos = -1;
         es_format_Init( &tk[i].fmt, UNKNOWN_ES, 0 );
     }
 }
@@ -299,6 +301,24 @@ static inline int ps_pkt_id( block_t *p_pkt )
     return p_pkt->p_buffer[3];
 }
 
+/* return the offset of the first system start code (00 00 01 >= b9) in
+ * p[0..i_peek), or -1. memchr() finds the 01 bytes, which are rarer than
+ * the 00 ones in stuffing, and is vectorized by the C library. */
+static inline int ps_pkt_find_startcode( const uint8_t *p, int i_peek )
+{
+    const uint8_t *p_end = p + i_peek - 1; /* stream id included */
+
+    for( const uint8_t *p_one = p + 2; p_one < p_end; p_one++ )
+    {
+        p_one = (const uint8_t *)memchr( p_one, 0x01, p_end - p_one );
+        if( p_one == NULL )
+            break;
+        if( p_one[-1] == 0x00 && p_one[-2] == 0x00 && p_one[1] >= 0xb9 )
+            return p_one - 2 - p;
+    }
+    return -1;
+}
+
 /* return the size of the next packet */
 static inline int ps_pkt_size( const uint8_t *p, int i_peek )
 {
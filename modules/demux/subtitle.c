@@ -133,6 +133,15 @@ typedef struct
     char    *psz_text;
 } subtitle_t;
 
+/* Seek index: the latest start and stop times of the subtitles up to each
+ * one. Both grow monotonically, even if the subtitles are not in order, so
+ * they can be bisected. */
+typedef struct
+{
+    int64_t i_start_max;
+    int64_t i_stop_max;
+} subtitle_index_t;
+
 
 struct demux_sys_t
 {
@@ -147,6 +156,7 @@ struct demux_sys_t
     int         i_subtitle;
     int         i_subtitles;
     subtitle_t  *subtitle;
+    subtitle_index_t *p_index; /* built on the first seek */
 
     int64_t     i_length;
 
@@ -253,6 +263,7 @@ static int Open ( vlc_object_t *p_this )
     p_sys->i_subtitle         = 0;
     p_sys->i_subtitles        = 0;
     p_sys->subtitle           = NULL;
+    p_sys->p_index            = NULL;
     p_sys->i_microsecperframe = 40000;
 
     p_sys->jss.b_inited       = false;
@@ -487,7 +498,7 @@ static int Open ( vlc_object_t *p_this )
     {
         if( p_sys->i_subtitles >= i_max )
         {
-            i_max += 500;
+            i_max = __MAX( 2 * i_max, 500 );
             if( !( p_sys->subtitle = realloc_or_free( p_sys->subtitle,
                                               sizeof(subtitle_t) * i_max ) ) )
             {
@@ -559,10 +570,67 @@ static void Close( vlc_object_t *p_this )
     for( i = 0; i < p_sys->i_subtitles; i++ )
         free( p_sys->subtitle[i].psz_text );
     free( p_sys->subtitle );
+    free( p_sys->p_index );
 
     free( p_sys );
 }
 
+/*****************************************************************************
+ * Seek index
+ *****************************************************************************/
+static int IndexBuild( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->p_index )
+        return VLC_SUCCESS;
+    if( p_sys->i_subtitles <= 0 )
+        return VLC_EGENERIC;
+
+    p_sys->p_index = malloc( p_sys->i_subtitles * sizeof(*p_sys->p_index) );
+    if( !p_sys->p_index )
+        return VLC_ENOMEM;
+
+    int64_t i_start_max = INT64_MIN;
+    int64_t i_stop_max = INT64_MIN;
+    for( int i = 0; i < p_sys->i_subtitles; i++ )
+    {
+        const subtitle_t *p_subtitle = &p_sys->subtitle[i];
+
+        i_start_max = __MAX( i_start_max, p_subtitle->i_start );
+        /* Only the subtitles with a valid duration can still be shown */
+        if( p_subtitle->i_stop > p_subtitle->i_start )
+            i_stop_max = __MAX( i_stop_max, p_subtitle->i_stop );
+        p_sys->p_index[i].i_start_max = i_start_max;
+        p_sys->p_index[i].i_stop_max = i_stop_max;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Returns the first subtitle starting after i_time (or at i_time if
+ * b_included), or still shown at i_time (if b_shown) */
+static int IndexFind( demux_t *p_demux, int64_t i_time, bool b_included,
+                      bool b_shown )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    int i_min = 0;
+    int i_max = p_sys->i_subtitles;
+
+    while( i_min < i_max )
+    {
+        const int i_mid = i_min + ( i_max - i_min ) / 2;
+        const subtitle_index_t *p_entry = &p_sys->p_index[i_mid];
+
+        if( p_entry->i_start_max > i_time ||
+            ( b_included && p_entry->i_start_max == i_time ) ||
+            ( b_shown && p_entry->i_stop_max > i_time ) )
+            i_max = i_mid;
+        else
+            i_min = i_mid + 1;
+    }
+    return i_min;
+}
+
 /*****************************************************************************
  * Control:
  *****************************************************************************/
@@ -590,18 +658,9 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
             i64 = (int64_t)va_arg( args, int64_t );
-            p_sys->i_subtitle = 0;
-            while( p_sys->i_subtitle < p_sys->i_subtitles )
-            {
-                const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
-
-                if( p_subtitle->i_start > i64 )
-                    break;
-                if( p_subtitle->i_stop > p_subtitle->i_start && p_subtitle->i_stop > i64 )
-                    break;
-
-                p_sys->i_subtitle++;
-            }
+            if( IndexBuild( p_demux ) )
+                return VLC_EGENERIC;
+            p_sys->i_subtitle = IndexFind( p_demux, i64, false, true );
 
             if( p_sys->i_subtitle >= p_sys->i_subtitles )
                 return VLC_EGENERIC;
@@ -628,12 +687,9 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             f = (double)va_arg( args, double );
             i64 = f * p_sys->i_length;
 
-            p_sys->i_subtitle = 0;
-            while( p_sys->i_subtitle < p_sys->i_subtitles &&
-                   p_sys->subtitle[p_sys->i_subtitle].i_start < i64 )
-            {
-                p_sys->i_subtitle++;
-            }
+            if( IndexBuild( p_demux ) )
+                return VLC_EGENERIC;
+            p_sys->i_subtitle = IndexFind( p_demux, i64, true, false );
             if( p_sys->i_subtitle >= p_sys->i_subtitles )
                 return VLC_EGENERIC;
             return VLC_SUCCESS;
@@ -719,34 +775,25 @@ static int Demux( demux_t *p_demux )
 static void Fix( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    bool b_done;
 
     /* *** fix order (to be sure...) *** */
-    /* We suppose that there are near in order and this durty bubble sort
-     * would not take too much time
+    /* We suppose that there are near in order: this (stable) insertion sort
+     * only costs a comparison per subtitle already in place
      */
-    do
+    for( int i_index = 1; i_index < p_sys->i_subtitles; i_index++ )
     {
-        b_done = true;
-        for( int i_index = 1; i_index < p_sys->i_subtitles; i_index++ )
-        {
-            if( p_sys->subtitle[i_index].i_start <
-                p_sys->subtitle[i_index - 1].i_start )
-            {
-                subtitle_t sub_xch;
-                memcpy( &sub_xch,
-                        p_sys->subtitle + i_index - 1,
-                        sizeof( subtitle_t ) );
-                memcpy( p_sys->subtitle + i_index - 1,
-                        p_sys->subtitle + i_index,
-                        sizeof( subtitle_t ) );
-                memcpy( p_sys->subtitle + i_index,
-                        &sub_xch,
-                        sizeof( subtitle_t ) );
-                b_done = false;
-            }
-        }
-    } while( !b_done );
+        const subtitle_t sub = p_sys->subtitle[i_index];
+        int i_dst = i_index;
+
+        while( i_dst > 0 && sub.i_start < p_sys->subtitle[i_dst - 1].i_start )
+            i_dst--;
+        if( i_dst == i_index )
+            continue;
+
+        memmove( p_sys->subtitle + i_dst + 1, p_sys->subtitle + i_dst,
+                 ( i_index - i_dst ) * sizeof( subtitle_t ) );
+        p_sys->subtitle[i_dst] = sub;
+    }
 }
 
 static int TextLoad( text_t *txt, stream_t *s )
@@ -772,7 +819,7 @@ static int TextLoad( text_t *txt, stream_t *s )
         txt->line[txt->i_line_count++] = psz;
         if( txt->i_line_count >= i_line_max )
         {
-            i_line_max += 100;
+            i_line_max *= 2;
             txt->line = realloc_or_free( txt->line, i_line_max * sizeof( char * ) );
             if( !txt->line )
                 return VLC_ENOMEM;
@@ -42,6 +42,7 @@
 #include <vlc_charset.h>   /* FromCharset, for EIT */
 
 #include <vlc_network.h>   /* net_ for ts-out mode */
+#include <vlc_atomic.h>
 
 #include "../mux/mpeg/csa.h"
 
@@ -135,6 +136,13 @@ static void Close ( vlc_object_t * );
     "Seek and position based on a percent byte position, not a PCR generated " \
     "time position. If seeking doesn't work property, turn on this option." )
 
+#define THREADS_TEXT N_("Program threads")
+#define THREADS_LONGTEXT N_( \
+    "Number of threads reassembling and sending the elementary streams, " \
+    "each handling a share of the programs. This helps when all the " \
+    "programs of a multiplex are demuxed at once. 0 demuxes everything " \
+    "from the input thread." )
+
 
 vlc_module_begin ()
     set_description( N_("MPEG Transport Stream demuxer") )
@@ -160,6 +168,8 @@ vlc_module_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_integer_with_range( "ts-threads", 0, 0, 16, THREADS_TEXT,
+                            THREADS_LONGTEXT, true )
 
     set_capability( "demux", 10 )
     set_callbacks( Open, Close )
@@ -217,6 +227,9 @@ typedef struct
     int             i_pid_pcr;
     int             i_pid_pmt;
     mtime_t         i_pcr_value;
+    /* last PCR sent to the ES output, and its arrival date */
+    mtime_t         i_pcr_sent;
+    mtime_t         i_pcr_sent_date;
     /* IOD stuff (mpeg4) */
     iod_descriptor_t *iod;
 
@@ -278,6 +291,48 @@ typedef struct
 
 } ts_pid_t;
 
+typedef struct ts_batch_t ts_batch_t;
+
+typedef struct
+{
+    block_t     self;
+    ts_batch_t *p_batch;
+} ts_packet_t;
+
+struct ts_batch_t
+{
+    atomic_uint  refs;
+    uint8_t     *p_data;
+    ts_packet_t  packets[];
+};
+
+/* The PES of a program and its PCR are queued to the same worker, so that
+ * they reach the ES output in stream order. PSI stays on the demux thread,
+ * which drains the workers before touching the PIDs. */
+#define TS_WORKER_JOBS 256
+
+typedef struct
+{
+    ts_pid_t     *pid;      /* NULL for a PCR update */
+    block_t      *p_data;
+    ts_prg_psi_t *prg;
+    mtime_t       i_pcr;
+} ts_job_t;
+
+typedef struct
+{
+    demux_t      *p_demux;
+    vlc_thread_t  thread;
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;     /* signaled to the worker */
+    vlc_cond_t    done;     /* signaled to the demux thread */
+    ts_job_t      jobs[TS_WORKER_JOBS];
+    unsigned      i_first;
+    unsigned      i_count;
+    bool          b_busy;
+    bool          b_exit;
+} ts_worker_t;
+
 struct demux_sys_t
 {
     vlc_mutex_t     csa_lock;
@@ -287,6 +342,8 @@ struct demux_sys_t
 
     /* how many TS packet we read at once */
     int         i_ts_read;
+    /* how many of them have not been parsed yet */
+    int         i_ts_ahead;
 
     /* to determine length and time */
     int         i_pid_ref_pcr;
@@ -297,6 +354,7 @@ struct demux_sys_t
     int         i_pcrs_num;
     mtime_t     *p_pcrs;
     int64_t     *p_pos;
+    seek_index_t *p_index; /* PCR positions already found */
 
     /* All pid */
     ts_pid_t    pid[8192];
@@ -316,10 +374,10 @@ struct demux_sys_t
 
     bool        b_udp_out;
     int         fd; /* udp socket */
-    uint8_t     *buffer;
 
     /* */
     bool        b_access_control;
+    bool        pid_filter[8192]; /* PIDs selected at the access level */
 
     /* */
     bool        b_dvb_meta;
@@ -334,6 +392,10 @@ struct demux_sys_t
 
     /* */
     bool        b_start_record;
+
+    /* PES workers (none when parsing from the demux thread) */
+    int         i_workers;
+    ts_worker_t *workers;
 };
 
 static int Demux    ( demux_t *p_demux );
@@ -357,6 +419,11 @@ static inline int PIDGet( block_t *p )
 static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static ts_batch_t *ReadTSBatch( demux_t *p_demux, int i_max, int *pi_count );
+static block_t *BatchPacket( ts_batch_t *p_batch, int i_pkt, int i_size );
+static void BatchRelease( ts_batch_t * );
+static bool PacketIsFiltered( demux_t *p_demux, const uint8_t *p );
+static void DescrambleBatch( demux_t *, ts_batch_t *, int i_count );
 static mtime_t GetPCR( block_t *p_pkt );
 static int SeekToPCR( demux_t *p_demux, int64_t i_pos );
 static int Seek( demux_t *p_demux, double f_percent );
@@ -364,6 +431,8 @@ static void GetFirstPCR( demux_t *p_demux );
 static void GetLastPCR( demux_t *p_demux );
 static void CheckPCR( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, block_t * );
+static void PCRResetSent( demux_t *p_demux );
+static void IndexPCR( demux_t *p_demux, mtime_t i_pcr );
 
 static void              IODFree( iod_descriptor_t * );
 
@@ -371,7 +440,15 @@ static void              IODFree( iod_descriptor_t * );
 static int UserPmt( demux_t *p_demux, const char * );
 
 static int  SetPIDFilter( demux_t *, int i_pid, bool b_selected );
-static void SetPrgFilter( demux_t *, int i_prg, bool b_selected );
+static void UpdatePIDFilters( demux_t * );
+static bool ProgramIsSelected( demux_t *, uint16_t i_pgrm );
+
+static void WorkersStart( demux_t *, int i_count );
+static void WorkerQueue( demux_t *, int i_number, const ts_job_t * );
+static void ParseContent( demux_t *, ts_pid_t *, block_t * );
+static void SetGroupPCR( demux_t *, ts_prg_psi_t *, mtime_t i_pcr );
+static void WorkersStop( demux_t * );
+static void WorkersDrain( demux_t *, bool b_flush );
 
 #define TS_PACKET_SIZE_188 188
 #define TS_PACKET_SIZE_192 192
@@ -520,7 +597,6 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     vlc_mutex_init( &p_sys->csa_lock );
 
-    p_sys->buffer = NULL;
     p_demux->pf_demux = Demux;
     p_demux->pf_control = Control;
 
@@ -550,6 +626,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_udp_out = false;
     p_sys->fd = -1;
     p_sys->i_ts_read = 50;
+    p_sys->i_ts_ahead = 0;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -622,7 +699,6 @@ static int Open( vlc_object_t *p_this )
             {
                 p_sys->i_ts_read = 1500 / p_sys->i_packet_size;
             }
-            p_sys->buffer = xmalloc( p_sys->i_packet_size * p_sys->i_ts_read );
         }
     }
     free( psz_string );
@@ -692,11 +768,13 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_pcrs_num = 10;
     p_sys->p_pcrs = (mtime_t *)calloc( p_sys->i_pcrs_num, sizeof( mtime_t ) );
     p_sys->p_pos = (int64_t *)calloc( p_sys->i_pcrs_num, sizeof( int64_t ) );
+    p_sys->p_index = NULL;
 
     bool can_seek = false;
     stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &can_seek );
     if( can_seek  )
     {
+        p_sys->p_index = demux_SeekIndexNew( p_demux, "ts" );
         GetFirstPCR( p_demux );
         CheckPCR( p_demux );
         GetLastPCR( p_demux );
@@ -706,6 +784,9 @@ static int Open( vlc_object_t *p_this )
         p_sys->b_force_seek_per_percent = true;
     }
 
+    if( !p_sys->b_udp_out )
+        WorkersStart( p_demux, var_InheritInteger( p_demux, "ts-threads" ) );
+
     while( p_sys->i_pmt_es <= 0 && vlc_object_alive( p_demux ) )
     {
         if( p_demux->pf_demux( p_demux ) != 1 )
@@ -723,6 +804,8 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    WorkersStop( p_demux );
+
     msg_Dbg( p_demux, "pid list:" );
     for( int i = 0; i < 8192; i++ )
     {
@@ -787,10 +870,11 @@ static void Close( vlc_object_t *p_this )
         net_Close( p_sys->fd );
     }
 
-    free( p_sys->buffer );
 
     free( p_sys->p_pcrs );
     free( p_sys->p_pos );
+    if( p_sys->p_index )
+        demux_SeekIndexDelete( p_sys->p_index );
 
     vlc_mutex_destroy( &p_sys->csa_lock );
     free( p_sys );
@@ -821,88 +905,107 @@ static int ChangeKeyCallback( vlc_object_t *p_this, char const *psz_cmd,
 /*****************************************************************************
  * Demux:
  *****************************************************************************/
-static int Demux( demux_t *p_demux )
+static void DemuxPacket( demux_t *p_demux, block_t *p_pkt )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    bool b_wait_es = p_sys->i_pmt_es <= 0;
-
-    /* We read at most 100 TS packet or until a frame is completed */
-    for( int i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
-    {
-        bool         b_frame = false;
-        block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
-        {
-            return 0;
-        }
-
-        if( p_sys->b_start_record )
-        {
-            /* Enable recording once synchronized */
-            stream_Control( p_demux->s, STREAM_SET_RECORD_STATE, true, "ts" );
-            p_sys->b_start_record = false;
-        }
-
-        if( p_sys->b_udp_out )
-        {
-            memcpy( &p_sys->buffer[i_pkt * p_sys->i_packet_size],
-                    p_pkt->p_buffer, p_sys->i_packet_size );
-        }
 
-        /* Parse the TS packet */
-        ts_pid_t *p_pid = &p_sys->pid[PIDGet( p_pkt )];
+    /* Parse the TS packet */
+    ts_pid_t *p_pid = &p_sys->pid[PIDGet( p_pkt )];
 
-        if( p_pid->b_valid )
+    if( p_pid->b_valid )
+    {
+        if( p_pid->psi )
         {
-            if( p_pid->psi )
-            {
-                if( p_pid->i_pid == 0 || ( p_sys->b_dvb_meta && ( p_pid->i_pid == 0x11 || p_pid->i_pid == 0x12 || p_pid->i_pid == 0x14 ) ) )
-                {
-                    dvbpsi_PushPacket( p_pid->psi->handle, p_pkt->p_buffer );
-                }
-                else
-                {
-                    for( int i_prg = 0; i_prg < p_pid->psi->i_prg; i_prg++ )
-                    {
-                        dvbpsi_PushPacket( p_pid->psi->prg[i_prg]->handle,
-                                           p_pkt->p_buffer );
-                    }
-                }
-                block_Release( p_pkt );
-            }
-            else if( !p_sys->b_udp_out )
+            if( p_pid->i_pid == 0 || ( p_sys->b_dvb_meta && ( p_pid->i_pid == 0x11 || p_pid->i_pid == 0x12 || p_pid->i_pid == 0x14 ) ) )
             {
-                b_frame = GatherData( p_demux, p_pid, p_pkt );
+                dvbpsi_PushPacket( p_pid->psi->handle, p_pkt->p_buffer );
             }
             else
             {
-                PCRHandle( p_demux, p_pid, p_pkt );
-                block_Release( p_pkt );
+                for( int i_prg = 0; i_prg < p_pid->psi->i_prg; i_prg++ )
+                {
+                    dvbpsi_PushPacket( p_pid->psi->prg[i_prg]->handle,
+                                       p_pkt->p_buffer );
+                }
             }
+            block_Release( p_pkt );
+        }
+        else if( !p_sys->b_udp_out )
+        {
+            GatherData( p_demux, p_pid, p_pkt );
         }
         else
         {
-            if( !p_pid->b_seen )
-            {
-                msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
-            }
-            /* We have to handle PCR if present */
             PCRHandle( p_demux, p_pid, p_pkt );
             block_Release( p_pkt );
         }
-        p_pid->b_seen = true;
+    }
+    else
+    {
+        if( !p_pid->b_seen )
+        {
+            msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
+        }
+        /* We have to handle PCR if present */
+        PCRHandle( p_demux, p_pid, p_pkt );
+        block_Release( p_pkt );
+    }
+    p_pid->b_seen = true;
+}
 
-        if( b_frame || ( b_wait_es && p_sys->i_pmt_es > 0 ) )
-            break;
+static int Demux( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int    i_size = p_sys->i_packet_size;
+    int          i_count;
+
+    /* We read at most i_ts_read TS packets at once */
+    ts_batch_t *p_batch = ReadTSBatch( p_demux, p_sys->i_ts_read, &i_count );
+    block_t    *p_pkt = NULL;
+
+    if( !p_batch && !(p_pkt = ReadTSPacket( p_demux )) )
+    {
+        return 0;
+    }
+
+    if( p_sys->b_start_record )
+    {
+        /* Enable recording once synchronized */
+        stream_Control( p_demux->s, STREAM_SET_RECORD_STATE, true, "ts" );
+        p_sys->b_start_record = false;
+    }
+
+    if( !p_batch )
+    {
+        if( p_sys->b_udp_out )
+            net_Write( p_demux, p_sys->fd, NULL, p_pkt->p_buffer, i_size );
+        DemuxPacket( p_demux, p_pkt );
+        return 1;
     }
 
     if( p_sys->b_udp_out )
     {
-        /* Send the complete block */
-        net_Write( p_demux, p_sys->fd, NULL, p_sys->buffer,
-                   p_sys->i_ts_read * p_sys->i_packet_size );
+        /* Send the complete batch */
+        net_Write( p_demux, p_sys->fd, NULL, p_batch->p_data, i_count * i_size );
     }
 
+    if( p_sys->csa )
+        DescrambleBatch( p_demux, p_batch, i_count );
+
+    for( int i_pkt = 0; i_pkt < i_count; i_pkt++ )
+    {
+        p_sys->i_ts_ahead = i_count - i_pkt - 1;
+
+        /* Drop the packets of unselected programs without parsing them */
+        if( !p_sys->b_udp_out &&
+            PacketIsFiltered( p_demux, &p_batch->p_data[i_pkt * i_size] ) )
+            continue;
+
+        DemuxPacket( p_demux, BatchPacket( p_batch, i_pkt, i_size ) );
+    }
+    p_sys->i_ts_ahead = 0;
+    BatchRelease( p_batch );
+
     return 1;
 }
 
@@ -969,6 +1072,10 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     case DEMUX_SET_POSITION:
         f = (double) va_arg( args, double );
 
+        /* The queued PES predate the seek */
+        WorkersDrain( p_demux, true );
+        PCRResetSent( p_demux );
+
         if( p_sys->b_force_seek_per_percent ||
             (p_sys->b_dvb_meta && p_sys->b_access_control) ||
             p_sys->i_last_pcr - p_sys->i_first_pcr <= 0 )
@@ -1032,21 +1139,9 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         if( i_int == 0 && p_sys->i_current_program > 0 )
             i_int = p_sys->i_current_program;
 
-        if( p_sys->i_current_program > 0 )
-        {
-            if( p_sys->i_current_program != i_int )
-                SetPrgFilter( p_demux, p_sys->i_current_program, false );
-        }
-        else if( p_sys->i_current_program < 0 )
-        {
-            for( int i = 0; i < p_sys->programs_list.i_count; i++ )
-                SetPrgFilter( p_demux, p_sys->programs_list.p_values[i].i_int, false );
-        }
-
         if( i_int > 0 )
         {
             p_sys->i_current_program = i_int;
-            SetPrgFilter( p_demux, p_sys->i_current_program, true );
         }
         else if( i_int < 0 )
         {
@@ -1063,13 +1158,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                 {
                     p_dst->i_count = p_list->i_count;
                     for( int i = 0; i < p_list->i_count; i++ )
-                    {
                         p_dst->p_values[i] = p_list->p_values[i];
-                        SetPrgFilter( p_demux, p_dst->p_values[i].i_int, true );
-                    }
                 }
             }
         }
+        UpdatePIDFilters( p_demux );
         return VLC_SUCCESS;
     }
 
@@ -1133,6 +1226,7 @@ static int UserPmt( demux_t *p_demux, const char *psz_fmt )
     prg->i_pid_pcr  = -1;
     prg->i_pid_pmt  = -1;
     prg->i_version  = -1;
+    prg->i_pcr_sent = -1;
     prg->i_number   = i_number != 0 ? i_number : TS_USER_PMT_NUMBER;
     prg->handle     = dvbpsi_AttachPMT(
         i_number != TS_USER_PMT_NUMBER ? i_number : 1,
@@ -1227,60 +1321,84 @@ static int SetPIDFilter( demux_t *p_demux, int i_pid, bool b_selected )
 
     if( !p_sys->b_access_control )
         return VLC_EGENERIC;
+    if( p_sys->pid_filter[i_pid] == b_selected )
+        return VLC_SUCCESS;
 
-    return stream_Control( p_demux->s, STREAM_CONTROL_ACCESS,
-                           ACCESS_SET_PRIVATE_ID_STATE, i_pid, b_selected );
+    if( stream_Control( p_demux->s, STREAM_CONTROL_ACCESS,
+                        ACCESS_SET_PRIVATE_ID_STATE, i_pid, b_selected ) )
+        return VLC_EGENERIC;
+    p_sys->pid_filter[i_pid] = b_selected;
+    return VLC_SUCCESS;
 }
 
-static void SetPrgFilter( demux_t *p_demux, int i_prg_id, bool b_selected )
+/* Selects at the access level the PIDs needed by the selected programs
+ * only (PAT, SI, PMT, PCR and ES), a PID shared by several programs is
+ * kept as long as one of them is selected. It must be called whenever
+ * the program selection, the PAT or a PMT changes. */
+static void UpdatePIDFilters( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    ts_prg_psi_t *p_prg = NULL;
-    int i_pmt_pid = -1;
+    bool wanted[8192];
+
+    if( !p_sys->b_access_control )
+        return;
+
+    memset( wanted, 0, sizeof( wanted ) );
+    wanted[0] = true;
+    if( p_sys->b_dvb_meta )
+        wanted[0x11] = wanted[0x12] = wanted[0x14] = true;
 
-    /* Search pmt to be unselected */
     for( int i = 0; i < p_sys->i_pmt; i++ )
     {
-        ts_pid_t *pmt = p_sys->pmt[i];
+        const ts_pid_t *pmt = p_sys->pmt[i];
 
         for( int i_prg = 0; i_prg < pmt->psi->i_prg; i_prg++ )
         {
-            if( pmt->psi->prg[i_prg]->i_number == i_prg_id )
-            {
-                i_pmt_pid = p_sys->pmt[i]->i_pid;
-                p_prg = p_sys->pmt[i]->psi->prg[i_prg];
-                break;
-            }
+            const ts_prg_psi_t *prg = pmt->psi->prg[i_prg];
+
+            if( !ProgramIsSelected( p_demux, prg->i_number ) )
+                continue;
+            wanted[pmt->i_pid] = true;
+            if( prg->i_pid_pcr > 0 && prg->i_pid_pcr < 8192 )
+                wanted[prg->i_pid_pcr] = true;
         }
-        if( i_pmt_pid > 0 )
-            break;
     }
-    if( i_pmt_pid <= 0 )
-        return;
-    assert( p_prg );
 
-    SetPIDFilter( p_demux, i_pmt_pid, b_selected );
-    if( p_prg->i_pid_pcr > 0 )
-        SetPIDFilter( p_demux, p_prg->i_pid_pcr, b_selected );
-
-    /* All ES */
     for( int i = 2; i < 8192; i++ )
     {
-        ts_pid_t *pid = &p_sys->pid[i];
+        const ts_pid_t *pid = &p_sys->pid[i];
 
-        if( !pid->b_valid || pid->psi )
+        if( !pid->b_valid || pid->psi || wanted[i] )
+            continue;
+        if( !pid->es->id && !p_sys->b_udp_out )
             continue;
 
         for( int i_prg = 0; i_prg < pid->p_owner->i_prg; i_prg++ )
         {
-            if( pid->p_owner->prg[i_prg]->i_pid_pmt == i_pmt_pid && pid->es->id )
+            if( ProgramIsSelected( p_demux, pid->p_owner->prg[i_prg]->i_number ) )
             {
-                /* We only remove/select es that aren't defined by extra pmt */
-                SetPIDFilter( p_demux, i, b_selected );
+                wanted[i] = true;
                 break;
             }
         }
     }
+
+    /* Remove first, as devices have a limited number of filters */
+    for( int i = 0; i < 8192; i++ )
+    {
+        if( p_sys->pid_filter[i] && !wanted[i] )
+            SetPIDFilter( p_demux, i, false );
+    }
+    for( int i = 0; i < 8192; i++ )
+    {
+        if( wanted[i] && !p_sys->pid_filter[i] &&
+            SetPIDFilter( p_demux, i, true ) )
+        {
+            msg_Warn( p_demux, "cannot select pid %d at access level", i );
+            p_sys->b_access_control = false;
+            break;
+        }
+    }
 }
 
 static void PIDInit( ts_pid_t *pid, bool b_psi, ts_psi_t *p_owner )
@@ -1320,6 +1438,7 @@ static void PIDInit( ts_pid_t *pid, bool b_psi, ts_psi_t *p_owner )
             prg->i_pid_pcr  = -1;
             prg->i_pid_pmt  = -1;
             prg->i_pcr_value= -1;
+            prg->i_pcr_sent = -1;
             prg->iod        = NULL;
             prg->handle     = NULL;
 
@@ -1676,6 +1795,16 @@ static void ParseData( demux_t *p_demux, ts_pid_t *pid )
     pid->es->i_data_gathered = 0;
     pid->es->pp_last = &pid->es->p_data;
 
+    demux_sys_t *p_sys = p_demux->p_sys;
+    if( p_sys->i_workers > 0 )
+        WorkerQueue( p_demux, pid->i_owner_number,
+                     &(ts_job_t){ .pid = pid, .p_data = p_data } );
+    else
+        ParseContent( p_demux, pid, p_data );
+}
+
+static void ParseContent( demux_t *p_demux, ts_pid_t *pid, block_t *p_data )
+{
     if( pid->es->data_type == TS_ES_DATA_PES )
     {
         ParsePES( p_demux, pid, p_data );
@@ -1747,6 +1876,128 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
+/* Returns true if the packet can be dropped without being parsed: it
+ * belongs to an ES of unselected programs only and carries no PCR */
+static bool PacketIsFiltered( demux_t *p_demux, const uint8_t *p )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_pid_t    *pid = &p_sys->pid[( (p[1]&0x1f)<<8 )|p[2]];
+
+    if( p_sys->i_pmt_es <= 0 )
+        return false;
+
+    if( !pid->b_valid || pid->psi || pid->i_pid == p_sys->i_pid_ref_pcr )
+        return false;
+
+    if( ( p[3]&0x20 ) && p[4] >= 7 && ( p[5]&0x10 ) )
+        return false;
+
+    for( int i_prg = 0; i_prg < pid->p_owner->i_prg; i_prg++ )
+    {
+        if( ProgramIsSelected( p_demux, pid->p_owner->prg[i_prg]->i_number ) )
+            return false;
+    }
+
+    /* The pending PES will never be completed */
+    if( pid->es->p_data )
+    {
+        block_ChainRelease( pid->es->p_data );
+        pid->es->p_data = NULL;
+        pid->es->i_data_size = 0;
+        pid->es->i_data_gathered = 0;
+        pid->es->pp_last = &pid->es->p_data;
+    }
+    return true;
+}
+
+/* The packets read at once share a single allocation: the blocks given
+ * to GatherData are views on the data read by one stream call */
+static void BatchRelease( ts_batch_t *p_batch )
+{
+    if( atomic_fetch_sub( &p_batch->refs, 1 ) == 1 )
+        free( p_batch );
+}
+
+static void BatchPacketRelease( block_t *p_block )
+{
+    BatchRelease( ((ts_packet_t *)p_block)->p_batch );
+}
+
+static ts_batch_t *ReadTSBatch( demux_t *p_demux, int i_max, int *pi_count )
+{
+    demux_sys_t   *p_sys = p_demux->p_sys;
+    const int      i_size = p_sys->i_packet_size;
+    const uint8_t *p_peek;
+
+    /* Only the packets in sync are read at once, ReadTSPacket takes care
+     * of the resynchronisation */
+    int i_peek = stream_Peek( p_demux->s, &p_peek, i_max * i_size );
+    int i_count = 0;
+    while( i_count < i_peek / i_size && p_peek[i_count * i_size] == 0x47 )
+        i_count++;
+    if( i_count <= 0 )
+        return NULL;
+
+    ts_batch_t *p_batch = malloc( sizeof( *p_batch ) +
+                                  i_count * ( sizeof( ts_packet_t ) + i_size ) );
+    if( unlikely(p_batch == NULL) )
+        return NULL;
+    p_batch->p_data = (uint8_t *)&p_batch->packets[i_count];
+
+    if( stream_Read( p_demux->s, p_batch->p_data, i_count * i_size ) < i_count * i_size )
+    {
+        free( p_batch );
+        return NULL;
+    }
+    atomic_init( &p_batch->refs, 1 );
+    *pi_count = i_count;
+    return p_batch;
+}
+
+static block_t *BatchPacket( ts_batch_t *p_batch, int i_pkt, int i_size )
+{
+    ts_packet_t *p_pkt = &p_batch->packets[i_pkt];
+
+    block_Init( &p_pkt->self, &p_batch->p_data[i_pkt * i_size], i_size );
+    p_pkt->self.pf_release = BatchPacketRelease;
+    p_pkt->p_batch = p_batch;
+    atomic_fetch_add( &p_batch->refs, 1 );
+    return &p_pkt->self;
+}
+
+/* Descrambles the scrambled packets of a batch at once, much faster than
+ * one by one in GatherData */
+static void DescrambleBatch( demux_t *p_demux, ts_batch_t *p_batch, int i_count )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int    i_size = p_sys->i_packet_size;
+    uint8_t     *pp_scrambled[i_count];
+    int          i_scrambled = 0;
+
+    for( int i_pkt = 0; i_pkt < i_count; i_pkt++ )
+    {
+        uint8_t *p = &p_batch->p_data[i_pkt * i_size];
+        if( p[3]&0x80 )
+            pp_scrambled[i_scrambled++] = p;
+    }
+    if( i_scrambled <= 0 )
+        return;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    if( p_sys->csa )
+        csa_DecryptBatch( p_sys->csa, pp_scrambled, i_scrambled,
+                          p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
+/* Returns the stream position following the packet being parsed */
+static int64_t TellPacket( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    return stream_Tell( p_demux->s ) - p_sys->i_ts_ahead * p_sys->i_packet_size;
+}
+
 static mtime_t AdjustPCRWrapAround( demux_t *p_demux, mtime_t i_pcr )
 {
     demux_sys_t   *p_sys = p_demux->p_sys;
@@ -1755,7 +2006,7 @@ static mtime_t AdjustPCRWrapAround( demux_t *p_demux, mtime_t i_pcr )
      * So, need to add 0x1FFFFFFFF, for calculating duration or current position.
      */
     mtime_t i_adjust = 0;
-    int64_t i_pos = stream_Tell( p_demux->s );
+    int64_t i_pos = TellPacket( p_demux );
     int i;
     for( i = 1; i < p_sys->i_pcrs_num && p_sys->p_pos[i] <= i_pos; ++i )
     {
@@ -1863,6 +2114,25 @@ static int Seek( demux_t *p_demux, double f_percent )
         i_head_pos = p_sys->p_pos[i-1];
         i_tail_pos = ( i < p_sys->i_pcrs_num ) ?  p_sys->p_pos[i] : stream_Size( p_demux->s );
     }
+
+    /* Use the positions already found, if any */
+    const mtime_t i_target_time = ( i_target_pcr - p_sys->i_first_pcr ) * 100 / 9;
+    seek_index_entry_t before, after;
+    if( p_sys->p_index &&
+        !demux_SeekIndexLookup( p_sys->p_index, i_target_time, &before, &after ) )
+    {
+        if( before.i_pos >= 0 && i_target_time - before.i_time <= 500000 &&
+            !SeekToPCR( p_demux, before.i_pos ) )
+        {
+            p_sys->i_current_pcr = AdjustPCRWrapAround( p_demux, p_sys->i_current_pcr );
+            msg_Dbg( p_demux, "Seek():found position %"PRId64" in the index", before.i_pos );
+            return VLC_SUCCESS;
+        }
+        if( before.i_pos > i_head_pos )
+            i_head_pos = before.i_pos;
+        if( after.i_pos >= 0 && after.i_pos < i_tail_pos )
+            i_tail_pos = after.i_pos;
+    }
     msg_Dbg( p_demux, "Seek():i_head_pos:%"PRId64", i_tail_pos:%"PRId64, i_head_pos, i_tail_pos);
 
     bool b_found = false;
@@ -1873,6 +2143,7 @@ static int Seek( demux_t *p_demux, double f_percent )
         if( SeekToPCR( p_demux, i_pos ) )
             break;
         p_sys->i_current_pcr = AdjustPCRWrapAround( p_demux, p_sys->i_current_pcr );
+        IndexPCR( p_demux, p_sys->i_current_pcr );
         int64_t i_diff_msec = (p_sys->i_current_pcr - i_target_pcr) * 100 / 9 / 1000;
         if( i_diff_msec > 500 )
         {
@@ -2008,6 +2279,54 @@ static void CheckPCR( demux_t *p_demux )
     p_sys->i_current_pcr = i_initial_pcr;
 }
 
+/* Records the position of the PCR packet just read (i_pcr must be adjusted
+ * for wrap around) */
+static void IndexPCR( demux_t *p_demux, mtime_t i_pcr )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->p_index || p_sys->i_first_pcr < 0 || i_pcr < p_sys->i_first_pcr )
+        return;
+
+    demux_SeekIndexAdd( p_sys->p_index, ( i_pcr - p_sys->i_first_pcr ) * 100 / 9,
+                        TellPacket( p_demux ) - p_sys->i_packet_size );
+}
+
+/* Some streams carry a PCR in every packet of their video PID: only one
+ * PCR per TS_PCR_INTERVAL is sent to the ES output. A PCR arriving later
+ * than the last one sent predicts is always sent, so that the input clock
+ * still sees the jitter. */
+#define TS_PCR_INTERVAL (CLOCK_FREQ/50)
+#define TS_PCR_JITTER   (CLOCK_FREQ/100)
+
+static bool PCRIsDue( ts_prg_psi_t *prg, mtime_t i_pcr )
+{
+    const mtime_t i_now = mdate();
+
+    if( prg->i_pcr_sent >= 0 )
+    {
+        const mtime_t i_stream = ( i_pcr - prg->i_pcr_sent ) * 100 / 9;
+        const mtime_t i_system = i_now - prg->i_pcr_sent_date;
+
+        /* A PCR going backward or jumping is a discontinuity: always send */
+        if( i_stream >= 0 && i_stream < TS_PCR_INTERVAL &&
+            i_system - i_stream < TS_PCR_JITTER )
+            return false;
+    }
+    prg->i_pcr_sent = i_pcr;
+    prg->i_pcr_sent_date = i_now;
+    return true;
+}
+
+static void PCRResetSent( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( int i = 0; i < p_sys->i_pmt; i++ )
+        for( int i_prg = 0; i_prg < p_sys->pmt[i]->psi->i_prg; i_prg++ )
+            p_sys->pmt[i]->psi->prg[i_prg]->i_pcr_sent = -1;
+}
+
 static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
 {
     demux_sys_t   *p_sys = p_demux->p_sys;
@@ -2020,18 +2339,32 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
         return;
 
     if( p_sys->i_pid_ref_pcr == pid->i_pid )
+    {
         p_sys->i_current_pcr = AdjustPCRWrapAround( p_demux, i_pcr );
+        IndexPCR( p_demux, p_sys->i_current_pcr );
+    }
 
     /* Search program and set the PCR */
     for( int i = 0; i < p_sys->i_pmt; i++ )
         for( int i_prg = 0; i_prg < p_sys->pmt[i]->psi->i_prg; i_prg++ )
-            if( pid->i_pid == p_sys->pmt[i]->psi->prg[i_prg]->i_pid_pcr )
-            {
-                p_sys->pmt[i]->psi->prg[i_prg]->i_pcr_value = i_pcr;
-                es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR,
-                                (int)p_sys->pmt[i]->psi->prg[i_prg]->i_number,
-                                (int64_t)(VLC_TS_0 + i_pcr * 100 / 9) );
-            }
+        {
+            ts_prg_psi_t *prg = p_sys->pmt[i]->psi->prg[i_prg];
+            if( pid->i_pid != prg->i_pid_pcr || !PCRIsDue( prg, i_pcr ) )
+                continue;
+
+            if( p_sys->i_workers > 0 )
+                WorkerQueue( p_demux, prg->i_number,
+                             &(ts_job_t){ .prg = prg, .i_pcr = i_pcr } );
+            else
+                SetGroupPCR( p_demux, prg, i_pcr );
+        }
+}
+
+static void SetGroupPCR( demux_t *p_demux, ts_prg_psi_t *prg, mtime_t i_pcr )
+{
+    prg->i_pcr_value = i_pcr;
+    es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR,
+                    (int)prg->i_number, (int64_t)(VLC_TS_0 + i_pcr * 100 / 9) );
 }
 
 static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
@@ -2066,7 +2399,8 @@ static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
             pid->es->p_data->i_flags |= BLOCK_FLAG_CORRUPTED;
     }
 
-    if( p_demux->p_sys->csa )
+    /* Packets read in a batch are already descrambled */
+    if( p_demux->p_sys->csa && b_scrambled )
     {
         vlc_mutex_lock( &p_demux->p_sys->csa_lock );
         csa_Decrypt( p_demux->p_sys->csa, p_bk->p_buffer, p_demux->p_sys->i_csa_pkt_size );
@@ -2236,6 +2570,154 @@ static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
     return i_ret;
 }
 
+/****************************************************************************
+ * PES workers
+ ****************************************************************************/
+static void *WorkerThread( void *data )
+{
+    ts_worker_t *w = data;
+    demux_t     *p_demux = w->p_demux;
+
+    vlc_mutex_lock( &w->lock );
+    for( ;; )
+    {
+        while( w->i_count == 0 && !w->b_exit )
+            vlc_cond_wait( &w->wait, &w->lock );
+        if( w->b_exit )
+            break;
+
+        ts_job_t job = w->jobs[w->i_first];
+        w->i_first = ( w->i_first + 1 ) % TS_WORKER_JOBS;
+        w->i_count--;
+        w->b_busy = true;
+        vlc_cond_signal( &w->done );
+        vlc_mutex_unlock( &w->lock );
+
+        if( job.pid )
+            ParseContent( p_demux, job.pid, job.p_data );
+        else
+            SetGroupPCR( p_demux, job.prg, job.i_pcr );
+
+        vlc_mutex_lock( &w->lock );
+        w->b_busy = false;
+        if( w->i_count == 0 )
+            vlc_cond_signal( &w->done );
+    }
+    vlc_mutex_unlock( &w->lock );
+    return NULL;
+}
+
+static void WorkersStart( demux_t *p_demux, int i_count )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( i_count <= 0 )
+        return;
+
+    p_sys->workers = calloc( i_count, sizeof( *p_sys->workers ) );
+    if( !p_sys->workers )
+        return;
+
+    for( int i = 0; i < i_count; i++ )
+    {
+        ts_worker_t *w = &p_sys->workers[i];
+
+        w->p_demux = p_demux;
+        vlc_mutex_init( &w->lock );
+        vlc_cond_init( &w->wait );
+        vlc_cond_init( &w->done );
+        if( vlc_clone( &w->thread, WorkerThread, w,
+                       VLC_THREAD_PRIORITY_INPUT ) )
+        {
+            vlc_cond_destroy( &w->done );
+            vlc_cond_destroy( &w->wait );
+            vlc_mutex_destroy( &w->lock );
+            break;
+        }
+        p_sys->i_workers++;
+    }
+
+    if( p_sys->i_workers == 0 )
+    {
+        free( p_sys->workers );
+        p_sys->workers = NULL;
+        return;
+    }
+    msg_Dbg( p_demux, "parsing PES from %d threads", p_sys->i_workers );
+}
+
+static void WorkersStop( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( int i = 0; i < p_sys->i_workers; i++ )
+    {
+        ts_worker_t *w = &p_sys->workers[i];
+
+        vlc_mutex_lock( &w->lock );
+        w->b_exit = true;
+        vlc_cond_signal( &w->wait );
+        vlc_mutex_unlock( &w->lock );
+        vlc_join( w->thread, NULL );
+
+        for( unsigned j = 0; j < w->i_count; j++ )
+        {
+            ts_job_t *job = &w->jobs[( w->i_first + j ) % TS_WORKER_JOBS];
+            if( job->p_data )
+                block_ChainRelease( job->p_data );
+        }
+        vlc_cond_destroy( &w->done );
+        vlc_cond_destroy( &w->wait );
+        vlc_mutex_destroy( &w->lock );
+    }
+    free( p_sys->workers );
+    p_sys->workers = NULL;
+    p_sys->i_workers = 0;
+}
+
+/* Waits until the workers are idle. With b_flush, the queued PES and PCR
+ * are dropped instead of being sent. */
+static void WorkersDrain( demux_t *p_demux, bool b_flush )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( int i = 0; i < p_sys->i_workers; i++ )
+    {
+        ts_worker_t *w = &p_sys->workers[i];
+
+        vlc_mutex_lock( &w->lock );
+        if( b_flush )
+        {
+            for( ; w->i_count > 0; w->i_count-- )
+            {
+                ts_job_t *job = &w->jobs[w->i_first];
+                if( job->p_data )
+                    block_ChainRelease( job->p_data );
+                w->i_first = ( w->i_first + 1 ) % TS_WORKER_JOBS;
+            }
+        }
+        while( w->i_count > 0 || w->b_busy )
+            vlc_cond_wait( &w->done, &w->lock );
+        vlc_mutex_unlock( &w->lock );
+    }
+}
+
+/* Queues a job to the worker of program i_number, waiting for room if
+ * that worker is behind */
+static void WorkerQueue( demux_t *p_demux, int i_number, const ts_job_t *p_job )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_worker_t *w = &p_sys->workers[(unsigned)i_number % p_sys->i_workers];
+
+    vlc_mutex_lock( &w->lock );
+    while( w->i_count >= TS_WORKER_JOBS )
+        vlc_cond_wait( &w->done, &w->lock );
+    w->jobs[( w->i_first + w->i_count ) % TS_WORKER_JOBS] = *p_job;
+    w->i_count++;
+    vlc_cond_signal( &w->wait );
+    vlc_mutex_unlock( &w->lock );
+}
+
 static void PIDFillFormat( ts_es_t *es, int i_stream_type )
 {
     es_format_t *fmt = &es->fmt;
@@ -3748,6 +4230,9 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_pmt )
         return;
     }
 
+    /* The ES of this program may be changed or deleted below */
+    WorkersDrain( p_demux, false );
+
     ts_pid_t **pp_clean = NULL;
     int      i_clean = 0;
     /* Clean this program (remove all es) */
@@ -3773,8 +4258,6 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_pmt )
     prg->i_version = p_pmt->i_version;
 
     ValidateDVBMeta( p_demux, prg->i_pid_pcr );
-    if( ProgramIsSelected( p_demux, prg->i_number ) )
-        SetPIDFilter( p_demux, prg->i_pid_pcr, true ); /* Set demux filter */
 
     /* Parse descriptor */
     bool b_hdmv = false;
@@ -3954,9 +4437,6 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_pmt )
                      (p_dr->p_data[0] << 8) | p_dr->p_data[1] );
         }
 
-        if( ProgramIsSelected( p_demux, prg->i_number ) &&
-            ( pid->es->id != NULL || p_sys->b_udp_out ) )
-            SetPIDFilter( p_demux, p_es->i_pid, true ); /* Set demux filter */
     }
 
     /* Set CAM descrambling */
@@ -3966,14 +4446,12 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_pmt )
         dvbpsi_DeletePMT( p_pmt );
 
     for( int i = 0; i < i_clean; i++ )
-    {
-        if( ProgramIsSelected( p_demux, prg->i_number ) )
-            SetPIDFilter( p_demux, pp_clean[i]->i_pid, false );
-
         PIDClean( p_demux, pp_clean[i] );
-    }
     if( i_clean )
         free( pp_clean );
+
+    /* Set demux filters */
+    UpdatePIDFilters( p_demux );
 }
 
 static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
@@ -3994,6 +4472,9 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
         return;
     }
 
+    /* The programs may be changed or deleted below */
+    WorkersDrain( p_demux, false );
+
     msg_Dbg( p_demux, "new PAT ts_id=%d version=%d current_next=%d",
              p_pat->i_ts_id, p_pat->i_version, p_pat->b_current_next );
 
@@ -4042,9 +4523,6 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
                     if( pid->p_owner->prg[i_prg]->i_pid_pmt != pmt_rm[j]->i_pid )
                         continue;
 
-                    if( pid->es->id )
-                        SetPIDFilter( p_demux, i, false );
-
                     PIDClean( p_demux, pid );
                     break;
                 }
@@ -4055,7 +4533,6 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
         for( int i = 0; i < i_pmt_rm; i++ )
         {
             ts_pid_t *pid = pmt_rm[i];
-            SetPIDFilter( p_demux, pid->i_pid, false );
 
             for( int i_prg = 0; i_prg < pid->psi->i_prg; i_prg++ )
             {
@@ -4104,17 +4581,14 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
         prg->i_number = p_program->i_number;
         prg->i_pid_pmt = p_program->i_pid;
 
-        /* Now select PID at access level */
-        if( ProgramIsSelected( p_demux, p_program->i_number ) )
-        {
-            if( p_sys->i_current_program == 0 )
-                p_sys->i_current_program = p_program->i_number;
-
-            if( SetPIDFilter( p_demux, p_program->i_pid, true ) )
-                p_sys->b_access_control = false;
-        }
+        if( ProgramIsSelected( p_demux, p_program->i_number ) &&
+            p_sys->i_current_program == 0 )
+            p_sys->i_current_program = p_program->i_number;
     }
     pat->psi->i_pat_version = p_pat->i_version;
 
+    /* Now select PID at access level */
+    UpdatePIDFilters( p_demux );
+
     dvbpsi_DeletePAT( p_pat );
 }
@@ -142,7 +142,7 @@ static int Demux( demux_t *p_demux)
     demux_sys_t *p_sys = p_demux->p_sys;
     block_t *p_block_in, *p_block_out;
 
-    if( ( p_block_in = stream_Block( p_demux->s, VC1_PACKET_SIZE ) ) == NULL )
+    if( ( p_block_in = stream_ReadBlock( p_demux->s, VC1_PACKET_SIZE ) ) == NULL )
         return 0;
 
     /*  */
@@ -54,6 +54,8 @@ void PLItem::init( playlist_item_t *_playlist_item, PLItem *parent )
     i_id       = _playlist_item->i_id;           /* Playlist item specific id */
     p_input    = _playlist_item->p_input;
     vlc_gc_incref( p_input );
+    b_node     = _playlist_item->i_children != -1;
+    b_fetched  = false;        /* Children are mirrored by PLModel::fetchMore */
 }
 
 /*
@@ -78,6 +78,8 @@ private:
     void init( playlist_item_t *, PLItem * );
     int i_id;
     input_item_t *p_input;
+    bool b_node;    /* Can have children in the playlist */
+    bool b_fetched; /* All the children are mirrored */
 };
 
 #endif
@@ -45,6 +45,10 @@
 
 QIcon PLModel::icons[ITEM_TYPE_NUMBER];
 
+/* Number of playlist items mirrored at once, the rest of the tree is
+   mirrored when the views need it */
+#define PLMODEL_FETCH_COUNT 1000
+
 /*************************************************************************
  * Playlist model implementation
  *************************************************************************/
@@ -283,7 +287,14 @@ void PLModel::dropMove( const PlMimeData * plMimeData, PLItem *target, int row )
     foreach( PLItem *item, model_items )
         takeItem( item );
 
-    insertChildren( target, model_items, model_pos );
+    /* Moved past the mirrored children: they will be fetched again */
+    if( model_pos > target->childCount() )
+    {
+        target->b_fetched = false;
+        qDeleteAll( model_items );
+    }
+    else
+        insertChildren( target, model_items, model_pos );
     free( pp_items );
 }
 
@@ -587,6 +598,25 @@ int PLModel::rowCount( const QModelIndex &parent ) const
     return parentItem->childCount();
 }
 
+bool PLModel::hasChildren( const QModelIndex &parent ) const
+{
+    PLItem *parentItem = getItem( parent );
+    return parentItem && ( parentItem->childCount() > 0
+                           || canFetchMore( parent ) );
+}
+
+bool PLModel::canFetchMore( const QModelIndex &parent ) const
+{
+    PLItem *parentItem = getItem( parent );
+    return parentItem && parentItem->b_node && !parentItem->b_fetched;
+}
+
+void PLModel::fetchMore( const QModelIndex &parent )
+{
+    if( canFetchMore( parent ) )
+        fetchChildren( getItem( parent ) );
+}
+
 /************************* Lookups *****************************/
 PLItem *PLModel::findById( PLItem *root, int i_id ) const
 {
@@ -780,6 +810,15 @@ void PLModel::processItemAppend( int i_item, int i_parent )
     for( pos = p_item->p_parent->i_children - 1; pos >= 0; pos-- )
         if( p_item->p_parent->pp_children[pos] == p_item ) break;
 
+    /* Past the mirrored children, the item will be fetched with them when
+       the views need it. Large nodes stop being mirrored as they grow. */
+    if( pos >= nodeParentItem->childCount() && ( !nodeParentItem->b_fetched
+          || nodeParentItem->childCount() >= PLMODEL_FETCH_COUNT ) )
+    {
+        nodeParentItem->b_fetched = false;
+        PL_UNLOCK; return;
+    }
+
     newItem = new PLItem( p_item, nodeParentItem );
     PL_UNLOCK;
 
@@ -805,8 +844,17 @@ void PLModel::rebuild( playlist_item_t *p_root )
         rootItem = new PLItem( p_root );
     }
     assert( rootItem );
-    /* Recreate from root */
-    updateChildren( rootItem );
+    /* Recreate from root, the first items only */
+    rootItem->b_fetched = false;
+    playlist_item_t *p_node = playlist_ItemGetById( p_playlist,
+                                                    rootItem->id() );
+    if( p_node )
+    {
+        QList<PLItem*> items;
+        updateChildren( p_node, rootItem, items, PLMODEL_FETCH_COUNT );
+        foreach( PLItem *item, items )
+            rootItem->appendChild( item );
+    }
     PL_UNLOCK;
 
     /* And signal the view */
@@ -866,24 +914,66 @@ void PLModel::removeItem( PLItem *item )
     }
 }
 
-/* This function must be entered WITH the playlist lock */
-void PLModel::updateChildren( PLItem *root )
+/* Mirrors the next children of a node, and signals the views */
+void PLModel::fetchChildren( PLItem *node )
 {
-    playlist_item_t *p_node = playlist_ItemGetById( p_playlist, root->id() );
-    updateChildren( p_node, root );
+    QList<PLItem*> items;
+
+    commitBufferedRowInserts();
+
+    PL_LOCK;
+    playlist_item_t *p_node = playlist_ItemGetById( p_playlist, node->id() );
+    if( p_node && p_node->i_children != -1 )
+        updateChildren( p_node, node, items, PLMODEL_FETCH_COUNT );
+    else
+        node->b_fetched = true;
+    PL_UNLOCK;
+
+    insertChildren( node, items, node->childCount() );
 }
 
-/* This function must be entered WITH the playlist lock */
-void PLModel::updateChildren( playlist_item_t *p_node, PLItem *root )
+/* This function must be entered WITH the playlist lock.
+   Mirrors, depth first, at most i_budget children of p_node following
+   the ones of root. The new children of root are returned in items, the
+   caller inserts them. Returns what is left of the budget. */
+int PLModel::updateChildren( playlist_item_t *p_node, PLItem *root,
+                             QList<PLItem*>& items, int i_budget )
 {
-    for( int i = 0; i < p_node->i_children ; i++ )
+    int i = 0;
+
+    /* Resume after the last mirrored child, which is more or less at the
+       same position in the playlist */
+    if( !root->children.isEmpty() )
     {
-        if( p_node->pp_children[i]->i_flags & PLAYLIST_DBL_FLAG ) continue;
-        PLItem *newItem =  new PLItem( p_node->pp_children[i], root );
-        root->appendChild( newItem );
-        if( p_node->pp_children[i]->i_children != -1 )
-            updateChildren( p_node->pp_children[i], newItem );
+        const int i_last = root->children.last()->id();
+        i = root->childCount() - 1;
+        while( i < p_node->i_children && p_node->pp_children[i]->i_id != i_last )
+            i++;
+        if( i >= p_node->i_children )
+            for( i = 0; i < p_node->i_children; i++ )
+                if( p_node->pp_children[i]->i_id == i_last )
+                    break;
+        i = ( i < p_node->i_children ) ? i + 1 : root->childCount();
     }
+
+    for( ; i < p_node->i_children && i_budget > 0; i++ )
+    {
+        playlist_item_t *p_child = p_node->pp_children[i];
+        if( p_child->i_flags & PLAYLIST_DBL_FLAG ) continue;
+        PLItem *newItem = new PLItem( p_child, root );
+        items.append( newItem );
+        i_budget--;
+        if( newItem->b_node )
+        {
+            QList<PLItem*> children;
+            i_budget = updateChildren( p_child, newItem, children, i_budget );
+            foreach( PLItem *child, children )
+                newItem->appendChild( child );
+        }
+    }
+    if( i >= p_node->i_children )
+        root->b_fetched = true;
+    return i_budget;
 }
 
 /* Function doesn't need playlist-lock, as we don't touch playlist_item_t stuff here*/
@@ -975,16 +1065,13 @@ void PLModel::sort( QModelIndex caller, QModelIndex rootIndex, const int column,
                                             ORDER_NORMAL : ORDER_REVERSE );
         }
     }
+    PL_UNLOCK;
 
     i_cached_id = i_cached_input_id = -1;
 
+    item->b_fetched = false;
     if( count )
-    {
-        beginInsertRows( qIndex, 0, count - 1 );
-        updateChildren( item );
-        endInsertRows( );
-    }
-    PL_UNLOCK;
+        fetchChildren( item );
     /* if we have popup item, try to make sure that you keep that item visible */
     if( caller.isValid() ) emit currentIndexChanged( caller );
 
@@ -1005,23 +1092,24 @@ void PLModel::search( const QString& search_text, const QModelIndex & idx, bool
         assert( p_root );
         playlist_LiveSearchUpdate( p_playlist, p_root, qtu( search_text ),
                                    b_recursive );
-        if( idx.isValid() )
-        {
-            PLItem *searchRoot = getItem( idx );
+    }
+    PL_UNLOCK;
+
+    if( idx.isValid() )
+    {
+        PLItem *searchRoot = getItem( idx );
 
+        if( searchRoot->childCount() )
+        {
             beginRemoveRows( idx, 0, searchRoot->childCount() - 1 );
             searchRoot->clearChildren();
             endRemoveRows();
-
-            beginInsertRows( idx, 0, searchRoot->childCount() - 1 );
-            updateChildren( searchRoot ); // The PL_LOCK is needed here
-            endInsertRows();
-
-            PL_UNLOCK;
-            return;
         }
+
+        searchRoot->b_fetched = false;
+        fetchChildren( searchRoot );
+        return;
     }
-    PL_UNLOCK;
     rebuild();
 }
 
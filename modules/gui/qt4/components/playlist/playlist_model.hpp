@@ -81,6 +81,9 @@ public:
     virtual Qt::ItemFlags flags( const QModelIndex &index ) const;
     virtual QModelIndex index( const int r, const int c, const QModelIndex &parent ) const;
     virtual QModelIndex parent( const QModelIndex &index ) const;
+    virtual bool hasChildren( const QModelIndex &parent = QModelIndex() ) const;
+    virtual bool canFetchMore( const QModelIndex &parent ) const;
+    virtual void fetchMore( const QModelIndex &parent );
 
     /* Drag and Drop */
     virtual Qt::DropActions supportedDropActions() const;
@@ -160,9 +163,9 @@ private:
     void recurseDelete( QList<AbstractPLItem*> children, QModelIndexList *fullList );
     void takeItem( PLItem * ); //will not delete item
     void insertChildren( PLItem *node, QList<PLItem*>& items, int i_pos );
+    void fetchChildren( PLItem * );
     /* ...of which  the following will not update the views */
-    void updateChildren( PLItem * );
-    void updateChildren( playlist_item_t *, PLItem * );
+    int updateChildren( playlist_item_t *, PLItem *, QList<PLItem*>&, int );
 
     /* Deep actions (affect core playlist) */
     void dropAppendCopy( const PlMimeData * data, PLItem *target, int pos );
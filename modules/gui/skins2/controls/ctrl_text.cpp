@@ -50,6 +50,7 @@ CtrlText::CtrlText( intf_thread_t *pIntf, VarText &rVariable,
     m_cmdMove( this ), m_pEvt( NULL ), m_rFont( rFont ),
     m_color( color ), m_scrollMode( scrollMode ), m_alignment( alignment ),
     m_pFocus( pFocus), m_pImg( NULL ), m_pImgDouble( NULL ),
+    m_renderedText( pIntf, "" ), m_renderedColor( 0 ),
     m_pCurrImg( NULL ), m_xPos( 0 ), m_xOffset( 0 ),
     m_cmdUpdateText( this )
 {
@@ -216,9 +217,10 @@ void CtrlText::setText( const UString &rText, uint32_t color )
 void CtrlText::onUpdate( Subject<VarText> &rVariable, void* arg )
 {
     (void)rVariable; (void)arg;
-    if( isVisible() )
+    // Time variables are updated several times per second, but their text
+    // seldom changes: only redraw the control when it does
+    if( isVisible() && displayText( m_rVariable.get() ) )
     {
-        displayText( m_rVariable.get() );
         notifyLayout( getPosition()->getWidth(), getPosition()->getHeight() );
     }
 }
@@ -243,16 +245,25 @@ void CtrlText::onUpdate( Subject<VarBool> &rVariable, void *arg  )
 }
 
 
-void CtrlText::displayText( const UString &rText )
+bool CtrlText::displayText( const UString &rText )
 {
+    // Keep the images (and the scrolling position) if nothing changed
+    if( m_pImg && m_color == m_renderedColor && rText == m_renderedText )
+    {
+        return false;
+    }
+
     // Create the images ('normal' and 'double') from the text
     // 'Normal' image
     delete m_pImg;
     m_pImg = m_rFont.drawString( rText, m_color );
     if( !m_pImg )
     {
-        return;
+        m_pCurrImg = NULL;
+        return true;
     }
+    m_renderedText = rText;
+    m_renderedColor = m_color;
     // 'Double' image
     const UString doubleStringWithSep = rText + SEPARATOR_STRING + rText;
     delete m_pImgDouble;
@@ -294,6 +305,7 @@ void CtrlText::displayText( const UString &rText )
             }
         }
     }
+    return true;
 }
 
 
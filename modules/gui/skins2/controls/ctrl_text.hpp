@@ -28,12 +28,12 @@
 #include "ctrl_generic.hpp"
 #include "../utils/fsm.hpp"
 #include "../utils/observer.hpp"
+#include "../utils/ustring.hpp"
 #include <string>
 
 class GenericFont;
 class GenericBitmap;
 class OSTimer;
-class UString;
 class VarText;
 
 
@@ -110,6 +110,9 @@ private:
     /// Image of the text, repeated twice and with some blank between;
     /// useful to display a 'circular' moving text...
     GenericBitmap *m_pImgDouble;
+    /// Text and color m_pImg and m_pImgDouble were rendered with
+    UString m_renderedText;
+    uint32_t m_renderedColor;
     /// Current image (should always be equal to m_pImg or m_pImgDouble)
     GenericBitmap *m_pCurrImg;
     /// Position of the left side of the moving text (always <= 0)
@@ -130,7 +133,8 @@ private:
     virtual void onUpdate( Subject<VarBool> &rVariable , void* );
 
     /// Display the text on the control
-    void displayText( const UString &rText );
+    /// Return false if the control already displayed this text
+    bool displayText( const UString &rText );
 
     /// Helper function to set the position in the correct interval
     void adjust( int &position );
@@ -26,7 +26,6 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
-#include <X11/extensions/shape.h>
 
 #include "x11_display.hpp"
 #include "x11_graphics.hpp"
@@ -134,11 +133,8 @@ void X11Graphics::drawGraphics( const OSGraphics &rGraphics, int xSrc,
                xDest, yDest );
 
     // Add the source mask to the mask of the graphics
-    Region newMask = XCreateRegion();
-    XUnionRegion( m_mask, mask, newMask );
+    XUnionRegion( m_mask, mask, m_mask );
     XDestroyRegion( mask );
-    XDestroyRegion( m_mask );
-    m_mask = newMask;
 }
 
 
@@ -274,10 +270,7 @@ void X11Graphics::drawBitmap( const GenericBitmap &rBitmap, int xSrc,
     XDestroyImage( pImage );
 
     // Add the bitmap mask to the global graphics mask
-    Region newMask = XCreateRegion();
-    XUnionRegion( mask, m_mask, newMask );
-    XDestroyRegion( m_mask );
-    m_mask = newMask;
+    XUnionRegion( mask, m_mask, m_mask );
 
     XDestroyRegion( mask );
 }
@@ -287,15 +280,12 @@ void X11Graphics::fillRect( int left, int top, int width, int height,
                             uint32_t color )
 {
     // Update the mask with the rectangle area
-    Region newMask = XCreateRegion();
     XRectangle rect;
     rect.x = left;
     rect.y = top;
     rect.width = width;
     rect.height = height;
-    XUnionRectWithRegion( &rect, m_mask, newMask );
-    XDestroyRegion( m_mask );
-    m_mask = newMask;
+    XUnionRectWithRegion( &rect, m_mask, m_mask );
 
     // Draw the rectangle
     XGCValues gcVal;
@@ -326,12 +316,8 @@ void X11Graphics::drawRect( int left, int top, int width, int height,
 
 void X11Graphics::applyMaskToWindow( OSWindow &rWindow )
 {
-    // Get the target window
-    Window win = ((X11Window&)rWindow).getDrawable();
-
     // Change the shape of the window
-    XShapeCombineRegion( XDISPLAY, win, ShapeBounding, 0, 0, m_mask,
-                         ShapeSet );
+    ((X11Window&)rWindow).setShape( m_mask );
 }
 
 
@@ -360,10 +346,7 @@ inline void X11Graphics::addHSegmentInRegion( Region &rMask, int xStart,
     rect.y = y;
     rect.width = xEnd - xStart;
     rect.height = 1;
-    Region newMask = XCreateRegion();
-    XUnionRectWithRegion( &rect, rMask, newMask );
-    XDestroyRegion( rMask );
-    rMask = newMask;
+    XUnionRectWithRegion( &rect, rMask, rMask );
 }
 
 
@@ -375,10 +358,7 @@ inline void X11Graphics::addVSegmentInRegion( Region &rMask, int yStart,
     rect.y = yStart;
     rect.width = 1;
     rect.height = yEnd - yStart;
-    Region newMask = XCreateRegion();
-    XUnionRectWithRegion( &rect, rMask, newMask );
-    XDestroyRegion( rMask );
-    rMask = newMask;
+    XUnionRectWithRegion( &rect, rMask, rMask );
 }
 
 #endif
@@ -25,6 +25,7 @@
 #ifdef X11_SKINS
 
 #include <X11/Xatom.h>
+#include <X11/extensions/shape.h>
 
 #include "../src/generic_window.hpp"
 #include "../src/vlcproc.hpp"
@@ -42,7 +43,8 @@ X11Window::X11Window( intf_thread_t *pIntf, GenericWindow &rWindow,
                       X11Display &rDisplay, bool dragDrop, bool playOnDrop,
                       X11Window *pParentWindow, GenericWindow::WindowType_t type ):
     OSWindow( pIntf ), m_rDisplay( rDisplay ), m_pParent( pParentWindow ),
-    m_dragDrop( dragDrop ), m_pDropTarget( NULL ), m_type ( type )
+    m_dragDrop( dragDrop ), m_pDropTarget( NULL ), m_type ( type ),
+    m_shape( XCreateRegion() ), m_shaped( false )
 {
     XSetWindowAttributes attr;
     unsigned long valuemask;
@@ -234,6 +236,21 @@ X11Window::~X11Window()
 
     XDestroyWindow( XDISPLAY, m_wnd );
     XSync( XDISPLAY, False );
+    XDestroyRegion( m_shape );
+}
+
+
+void X11Window::setShape( Region mask )
+{
+    // Refreshing a part of a layout usually gives back the same mask: don't
+    // make the server recompute the shape of the window for nothing
+    if( m_shaped && XEqualRegion( mask, m_shape ) )
+        return;
+
+    XShapeCombineRegion( XDISPLAY, m_wnd, ShapeBounding, 0, 0, mask,
+                         ShapeSet );
+    XUnionRegion( mask, mask, m_shape );
+    m_shaped = true;
 }
 
 void X11Window::reparent( uint32_t OSHandle, int x, int y, int w, int h )
@@ -27,6 +27,7 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
+#include <X11/Xutil.h>
 
 #include "../src/generic_window.hpp"
 #include "../src/os_window.hpp"
@@ -81,6 +82,9 @@ public:
 
     void setFullscreen() const;
 
+    /// Set the shape of the window, unless it already has this one
+    void setShape( Region mask );
+
 private:
     /// X11 display
     X11Display &m_rDisplay;
@@ -96,6 +100,9 @@ private:
     X11DragDrop *m_pDropTarget;
     /// window type
     GenericWindow::WindowType_t m_type;
+    /// Shape last applied to the window (only valid if m_shaped is true)
+    Region m_shape;
+    bool m_shaped;
 };
 
 
@@ -55,6 +55,134 @@ static inline void luaL_register_submodule( lua_State *L, const char *psz_name,
     lua_setfield( L, -2, psz_name );
 }
 
+/*****************************************************************************
+ * Status events
+ *****************************************************************************
+ * Scripts serving the status (the HTTP interface) keep a snapshot of it, and
+ * only rebuild it once one of these events bumped the status serial. The
+ * playback position is kept aside, as it changes all the time.
+ *****************************************************************************/
+static const char *const ppsz_status_vars[] = {
+    "item-current", "random", "loop", "repeat", "volume", "mute",
+};
+
+static void StatusChanged( intf_sys_t *p_sys )
+{
+    vlc_mutex_lock( &p_sys->status_lock );
+    p_sys->i_status_serial++;
+    vlc_mutex_unlock( &p_sys->status_lock );
+}
+
+static int InputEvent( vlc_object_t *p_this, char const *psz_var,
+                       vlc_value_t oldval, vlc_value_t newval, void *p_data )
+{
+    VLC_UNUSED(psz_var); VLC_UNUSED(oldval);
+    input_thread_t *p_input = (input_thread_t *)p_this;
+    intf_sys_t *p_sys = p_data;
+
+    switch( newval.i_int )
+    {
+        case INPUT_EVENT_POSITION:
+        {
+            mtime_t i_time = var_GetTime( p_input, "time" );
+            float f_position = var_GetFloat( p_input, "position" );
+
+            vlc_mutex_lock( &p_sys->status_lock );
+            if( p_sys->p_input == p_input )
+            {
+                p_sys->i_status_time = i_time;
+                p_sys->f_status_position = f_position;
+            }
+            vlc_mutex_unlock( &p_sys->status_lock );
+            break;
+        }
+        case INPUT_EVENT_STATISTICS:
+        case INPUT_EVENT_SIGNAL:
+        case INPUT_EVENT_CACHE:
+            break;
+        default:
+            StatusChanged( p_sys );
+    }
+    return VLC_SUCCESS;
+}
+
+static void SetInput( intf_sys_t *p_sys, input_thread_t *p_input )
+{
+    if( p_input != NULL )
+    {
+        vlc_object_hold( p_input );
+        var_AddCallback( p_input, "intf-event", InputEvent, p_sys );
+    }
+
+    vlc_mutex_lock( &p_sys->status_lock );
+    input_thread_t *p_old = p_sys->p_input;
+    p_sys->p_input = p_input;
+    p_sys->i_status_time = 0;
+    p_sys->f_status_position = 0.f;
+    p_sys->i_status_serial++;
+    vlc_mutex_unlock( &p_sys->status_lock );
+
+    /* Not under status_lock, as InputEvent() may be waiting for it */
+    if( p_old != NULL )
+    {
+        var_DelCallback( p_old, "intf-event", InputEvent, p_sys );
+        vlc_object_release( p_old );
+    }
+}
+
+static int InputCurrent( vlc_object_t *p_this, char const *psz_var,
+                         vlc_value_t oldval, vlc_value_t newval, void *p_data )
+{
+    VLC_UNUSED(p_this); VLC_UNUSED(psz_var); VLC_UNUSED(oldval);
+    SetInput( p_data, newval.p_address );
+    return VLC_SUCCESS;
+}
+
+static int PlaylistEvent( vlc_object_t *p_this, char const *psz_var,
+                          vlc_value_t oldval, vlc_value_t newval, void *p_data )
+{
+    VLC_UNUSED(p_this); VLC_UNUSED(psz_var);
+    VLC_UNUSED(oldval); VLC_UNUSED(newval);
+    StatusChanged( p_data );
+    return VLC_SUCCESS;
+}
+
+static void StatusStart( intf_thread_t *p_intf )
+{
+    intf_sys_t *p_sys = p_intf->p_sys;
+    playlist_t *p_playlist = pl_Get( p_intf );
+
+    vlc_mutex_init( &p_sys->status_lock );
+    p_sys->p_playlist = p_playlist;
+    p_sys->p_input = NULL;
+    p_sys->i_status_serial = 0;
+    p_sys->i_status_time = 0;
+    p_sys->f_status_position = 0.f;
+
+    for( size_t i = 0; i < sizeof( ppsz_status_vars ) / sizeof( *ppsz_status_vars ); i++ )
+        var_AddCallback( p_playlist, ppsz_status_vars[i], PlaylistEvent, p_sys );
+    var_AddCallback( p_playlist, "input-current", InputCurrent, p_sys );
+
+    input_thread_t *p_input = playlist_CurrentInput( p_playlist );
+    if( p_input != NULL )
+    {
+        SetInput( p_sys, p_input );
+        vlc_object_release( p_input );
+    }
+}
+
+static void StatusStop( intf_thread_t *p_intf )
+{
+    intf_sys_t *p_sys = p_intf->p_sys;
+    playlist_t *p_playlist = p_sys->p_playlist;
+
+    var_DelCallback( p_playlist, "input-current", InputCurrent, p_sys );
+    for( size_t i = 0; i < sizeof( ppsz_status_vars ) / sizeof( *ppsz_status_vars ); i++ )
+        var_DelCallback( p_playlist, ppsz_status_vars[i], PlaylistEvent, p_sys );
+    SetInput( p_sys, NULL );
+    vlc_mutex_destroy( &p_sys->status_lock );
+}
+
 static char *MakeConfig( intf_thread_t *p_intf, const char *name )
 {
     char *psz_config = NULL;
@@ -361,8 +489,10 @@ static int Start_LuaIntf( vlc_object_t *p_this, const char *name )
 
     p_sys->L = L;
 
+    StatusStart( p_intf );
     if( vlc_clone( &p_sys->thread, Run, p_intf, VLC_THREAD_PRIORITY_LOW ) )
     {
+        StatusStop( p_intf );
         lua_close( p_sys->L );
         goto error;
     }
@@ -384,6 +514,7 @@ void Close_LuaIntf( vlc_object_t *p_this )
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
     lua_close( p_sys->L );
+    StatusStop( p_intf );
 
     free( p_sys->psz_filename );
     free( p_sys );
@@ -395,7 +526,7 @@ static void *Run( void *data )
     intf_sys_t *p_sys = p_intf->p_sys;
     lua_State *L = p_sys->L;
 
-    if( luaL_dofile( L, p_sys->psz_filename ) )
+    if( vlclua_dofile( VLC_OBJECT(p_intf), L, p_sys->psz_filename ) )
     {
         msg_Err( p_intf, "Error loading script %s: %s", p_sys->psz_filename,
                  lua_tostring( L, lua_gettop( L ) ) );
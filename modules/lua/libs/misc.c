@@ -39,6 +39,7 @@
 #include <vlc_meta.h>
 #include <vlc_interface.h>
 #include <vlc_keys.h>
+#include <vlc_memstat.h>
 
 #include "../vlc.h"
 #include "../libs.h"
@@ -152,6 +153,49 @@ static int vlclua_intf_should_die( lua_State *L )
     return 1;
 }
 
+/*****************************************************************************
+ * Get the status serial, bumped by each status event, and the playback
+ * time and position, which do not bump it
+ *****************************************************************************/
+static int vlclua_intf_status( lua_State *L )
+{
+    intf_sys_t *p_sys = vlclua_get_intf( L );
+    if( p_sys == NULL )
+        return 0;
+
+    vlc_mutex_lock( &p_sys->status_lock );
+    lua_pushnumber( L, p_sys->i_status_serial );
+    lua_pushnumber( L, ((double)p_sys->i_status_time)/1000000. );
+    lua_pushnumber( L, p_sys->f_status_position );
+    vlc_mutex_unlock( &p_sys->status_lock );
+    return 3;
+}
+
+/*****************************************************************************
+ * Get the memory usage of each accounted module
+ *****************************************************************************/
+static int vlclua_memory( lua_State *L )
+{
+    vlc_mem_stats_t stats[VLC_MEM_ACCOUNTS];
+    unsigned i_count = vlc_mem_GetStats( stats );
+
+    lua_createtable( L, i_count, 0 );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        lua_createtable( L, 0, 4 );
+        lua_pushstring( L, stats[i].psz_name );
+        lua_setfield( L, -2, "name" );
+        lua_pushnumber( L, stats[i].i_live );
+        lua_setfield( L, -2, "live" );
+        lua_pushnumber( L, stats[i].i_peak );
+        lua_setfield( L, -2, "peak" );
+        lua_pushnumber( L, stats[i].i_allocs );
+        lua_setfield( L, -2, "allocs" );
+        lua_rawseti( L, -2, i + 1 );
+    }
+    return 1;
+}
+
 static int vlclua_action_id( lua_State *L )
 {
     vlc_action_t i_key = vlc_GetActionId( luaL_checkstring( L, 1 ) );
@@ -174,7 +218,10 @@ static const luaL_Reg vlclua_misc_reg[] = {
     { "mdate", vlclua_mdate },
     { "mwait", vlclua_mwait },
 
+    { "memory", vlclua_memory },
+
     { "should_die", vlclua_intf_should_die },
+    { "status", vlclua_intf_status },
     { "quit", vlclua_quit },
 
     { NULL, NULL }
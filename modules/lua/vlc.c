@@ -644,7 +644,7 @@ static int vlc_sd_probe_Open( vlc_object_t *obj )
                 free( psz_filename );
                 goto error;
             }
-            if( luaL_dofile( L, psz_filename ) )
+            if( vlclua_dofile( VLC_OBJECT(probe), L, psz_filename ) )
             {
 
                 msg_Err( probe, "Error loading script %s: %s", psz_filename,
@@ -810,13 +810,113 @@ int vlclua_add_modules_path( vlc_object_t *obj, lua_State *L, const char *psz_fi
     return 0;
 }
 
+/*****************************************************************************
+ * Cache of the compiled scripts
+ *****************************************************************************
+ * Scripts are probed over and over (playlist scripts for each URL opened,
+ * meta scripts for each item), so the bytecode of each local script is kept
+ * for the lifetime of the plugin, and compiled again only once the file
+ * changes.
+ *****************************************************************************/
+typedef struct vlclua_chunk_t vlclua_chunk_t;
+struct vlclua_chunk_t
+{
+    vlclua_chunk_t *p_next;
+    char           *psz_path;
+    time_t          i_mtime;
+    off_t           i_size;
+    size_t          i_len;
+    char           *p_data;
+};
+
+static vlclua_chunk_t *vlclua_chunks = NULL;
+static vlc_mutex_t vlclua_chunks_lock = VLC_STATIC_MUTEX;
+
+static int vlclua_chunk_writer( lua_State *L, const void *p, size_t sz,
+                                void *ud )
+{
+    VLC_UNUSED( L );
+    vlclua_chunk_t *p_chunk = ud;
+    char *p_data = realloc( p_chunk->p_data, p_chunk->i_len + sz );
+    if( unlikely( !p_data ) )
+        return 1;
+    memcpy( p_data + p_chunk->i_len, p, sz );
+    p_chunk->p_data = p_data;
+    p_chunk->i_len += sz;
+    return 0;
+}
+
+/* Caller must hold vlclua_chunks_lock */
+static vlclua_chunk_t **vlclua_chunk_find( const char *psz_path )
+{
+    vlclua_chunk_t **pp_chunk = &vlclua_chunks;
+    while( *pp_chunk && strcmp( (*pp_chunk)->psz_path, psz_path ) )
+        pp_chunk = &(*pp_chunk)->p_next;
+    return pp_chunk;
+}
+
+/** Replacement for luaL_loadfile, using the cache of compiled scripts */
+static int vlclua_loadfile( lua_State *L, const char *psz_path )
+{
+    struct stat st;
+    if( vlc_stat( psz_path, &st ) )
+        return luaL_loadfile( L, psz_path ); /* let Lua report the error */
+
+    vlc_mutex_lock( &vlclua_chunks_lock );
+    vlclua_chunk_t *p_chunk = *vlclua_chunk_find( psz_path );
+    if( p_chunk && p_chunk->i_mtime == st.st_mtime
+     && p_chunk->i_size == st.st_size )
+    {
+        int i_ret = luaL_loadbuffer( L, p_chunk->p_data, p_chunk->i_len,
+                                     psz_path );
+        vlc_mutex_unlock( &vlclua_chunks_lock );
+        return i_ret;
+    }
+    vlc_mutex_unlock( &vlclua_chunks_lock );
+
+    int i_ret = luaL_loadfile( L, psz_path );
+    if( i_ret )
+        return i_ret;
+
+    vlclua_chunk_t chunk = { .i_mtime = st.st_mtime, .i_size = st.st_size };
+    if( lua_dump( L, vlclua_chunk_writer, &chunk ) || chunk.i_len == 0 )
+    {
+        free( chunk.p_data );
+        return 0; /* not cached, but loaded all the same */
+    }
+
+    vlc_mutex_lock( &vlclua_chunks_lock );
+    vlclua_chunk_t **pp_chunk = vlclua_chunk_find( psz_path );
+    if( *pp_chunk )
+    {
+        free( (*pp_chunk)->p_data );
+        (*pp_chunk)->p_data = chunk.p_data;
+        (*pp_chunk)->i_len = chunk.i_len;
+        (*pp_chunk)->i_mtime = chunk.i_mtime;
+        (*pp_chunk)->i_size = chunk.i_size;
+    }
+    else if( ( p_chunk = malloc( sizeof( *p_chunk ) ) ) != NULL
+          && ( chunk.psz_path = strdup( psz_path ) ) != NULL )
+    {
+        *p_chunk = chunk;
+        *pp_chunk = p_chunk;
+    }
+    else
+    {
+        free( p_chunk );
+        free( chunk.p_data );
+    }
+    vlc_mutex_unlock( &vlclua_chunks_lock );
+    return 0;
+}
+
 /** Replacement for luaL_dofile, using VLC's input capabilities */
 int vlclua_dofile( vlc_object_t *p_this, lua_State *L, const char *uri )
 {
-    if( !strstr( uri, "://" ) )
-        return luaL_dofile( L, uri );
     if( !strncasecmp( uri, "file://", 7 ) )
-        return luaL_dofile( L, uri + 7 );
+        uri += 7;
+    if( !strstr( uri, "://" ) )
+        return vlclua_loadfile( L, uri ) || lua_pcall( L, 0, LUA_MULTRET, 0 );
     stream_t *s = stream_UrlNew( p_this, uri );
     if( !s )
     {
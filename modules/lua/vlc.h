@@ -164,6 +164,14 @@ struct intf_sys_t
     lua_State *L;
 
     vlc_thread_t thread;
+
+    /* status events, see vlc.misc.status() */
+    playlist_t *p_playlist;
+    input_thread_t *p_input;
+    vlc_mutex_t status_lock;
+    unsigned i_status_serial;
+    mtime_t i_status_time;
+    float f_status_position;
 };
 
 #endif /* VLC_LUA_H */
@@ -31,70 +31,154 @@
  * ADD FUNCTIONS
  *****************************************************************************/
 
-/**
- * @brief Add element to ML based on a ml_media_t (media ID ignored)
- * @param p_ml This media_library_t object
- * @param p_media media item to add in the DB. The media_id is ignored
- * @return VLC_SUCCESS or VLC_EGENERIC
- * @note This function is threadsafe
- */
-int AddMedia( media_library_t *p_ml, ml_media_t *p_media )
+/* Albums and people found or created during a batch, and the statements
+ * used to insert each media. The caches only live as long as the
+ * transaction: the database triggers may delete albums and people. */
+typedef struct
 {
-    int i_ret = VLC_SUCCESS;
-    int i_album_artist = 0;
+    sql_stmt_t *p_media_stmt;
+    sql_stmt_t *p_people_stmt;
+    sql_stmt_t *p_extra_stmt;
+    sql_stmt_t *p_search_stmt; /* NULL without full-text index */
+    vlc_dictionary_t albums; /* title -> album id */
+    vlc_dictionary_t people; /* role/name -> people id */
+} add_batch_t;
 
-    Begin( p_ml );
-    ml_LockMedia( p_media );
-    assert( p_media->i_id == 0 );
-    /* Add any people */
-    ml_person_t* person = p_media->p_people;
-    while( person )
+#define ADD_BATCH_CACHE_SIZE 61
+
+static int BatchInit( media_library_t *p_ml, add_batch_t *p_batch )
+{
+    sql_t *p_sql = p_ml->p_sys->p_sql;
+
+    p_batch->p_media_stmt = sql_Prepare( p_sql,
+            "INSERT INTO media ( uri, title, original_title, genre, type, "
+            "comment, cover, preview, year, track, disc, album_id, vote, score, "
+            "duration, first_played, played_count, last_played, "
+            "skipped_count, last_skipped, import_time, filesize ) "
+            "VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, "
+            "?, ?, ?, ? )", -1 );
+    p_batch->p_people_stmt = sql_Prepare( p_sql,
+            "INSERT into media_to_people ( media_id, people_id ) "
+            "VALUES ( ?, ? )", -1 );
+    p_batch->p_extra_stmt = sql_Prepare( p_sql,
+            "INSERT into extra ( id, extra, language, bitrate, "
+            "samplerate, bpm ) VALUES ( ?, ?, ?, ?, ?, ? )", -1 );
+    p_batch->p_search_stmt = !p_ml->p_sys->b_search_index ? NULL :
+        sql_Prepare( p_sql, ML_SEARCH_INDEX_INSERT "WHERE media.id = ?", -1 );
+    vlc_dictionary_init( &p_batch->albums, ADD_BATCH_CACHE_SIZE );
+    vlc_dictionary_init( &p_batch->people, ADD_BATCH_CACHE_SIZE );
+
+    if( !p_batch->p_media_stmt || !p_batch->p_people_stmt
+     || !p_batch->p_extra_stmt
+     || ( p_ml->p_sys->b_search_index && !p_batch->p_search_stmt ) )
     {
-        if( person->i_id <= 0 )
-        {
-            if( person->psz_name )
-            {
-                person->i_id = ml_GetInt( p_ml, ML_PEOPLE_ID, person->psz_role,
-                                            ML_PEOPLE, person->psz_role,
-                                            person->psz_name );
-                if( person->i_id <= 0 )
-                {
-                    /* Create person */
-                    AddPeople( p_ml, person->psz_name, person->psz_role );
-                    person->i_id = ml_GetInt( p_ml, ML_PEOPLE_ID, person->psz_role,
-                                            ML_PEOPLE, person->psz_role,
-                                            person->psz_name );
-                }
-
-            }
-        }
-        if( strcmp( person->psz_role, ML_PERSON_ALBUM_ARTIST ) == 0 )
-            i_album_artist = person->i_id;
-        person = person->p_next;
+        msg_Err( p_ml, "cannot prepare the insert statements" );
+        return VLC_EGENERIC;
     }
+    return VLC_SUCCESS;
+}
 
-    /* Album id */
-    if( p_media->i_album_id <= 0 )
+static void BatchClean( media_library_t *p_ml, add_batch_t *p_batch )
+{
+    sql_t *p_sql = p_ml->p_sys->p_sql;
+
+    if( p_batch->p_media_stmt )
+        sql_Finalize( p_sql, p_batch->p_media_stmt );
+    if( p_batch->p_people_stmt )
+        sql_Finalize( p_sql, p_batch->p_people_stmt );
+    if( p_batch->p_extra_stmt )
+        sql_Finalize( p_sql, p_batch->p_extra_stmt );
+    if( p_batch->p_search_stmt )
+        sql_Finalize( p_sql, p_batch->p_search_stmt );
+    vlc_dictionary_clear( &p_batch->albums, NULL, NULL );
+    vlc_dictionary_clear( &p_batch->people, NULL, NULL );
+}
+
+/* Albums and people created by a media that got rolled back are gone */
+static void BatchForget( add_batch_t *p_batch )
+{
+    vlc_dictionary_clear( &p_batch->albums, NULL, NULL );
+    vlc_dictionary_clear( &p_batch->people, NULL, NULL );
+    vlc_dictionary_init( &p_batch->albums, ADD_BATCH_CACHE_SIZE );
+    vlc_dictionary_init( &p_batch->people, ADD_BATCH_CACHE_SIZE );
+}
+
+static int BindTextOrNull( sql_t *p_sql, sql_stmt_t *p_stmt, int i_pos,
+                           char *psz )
+{
+    if( !psz )
+        return sql_BindNull( p_sql, p_stmt, i_pos );
+    return sql_BindText( p_sql, p_stmt, i_pos, psz, -1 );
+}
+
+/* Runs a bound insert statement and resets it for the next media */
+static int RunInsert( sql_t *p_sql, sql_stmt_t *p_stmt, int i_ret )
+{
+    if( i_ret == VLC_SUCCESS && sql_Run( p_sql, p_stmt ) != VLC_SQL_DONE )
+        i_ret = VLC_EGENERIC;
+    sql_Reset( p_sql, p_stmt );
+    return i_ret;
+}
+
+static int GetPeopleId( media_library_t *p_ml, add_batch_t *p_batch,
+                        const char *psz_role, const char *psz_name )
+{
+    char *psz_key;
+    if( asprintf( &psz_key, "%s/%s", psz_role, psz_name ) == -1 )
+        return -1;
+
+    int i_id = (intptr_t)vlc_dictionary_value_for_key( &p_batch->people,
+                                                        psz_key );
+    if( i_id <= 0 )
     {
-        if( p_media->psz_album )
+        i_id = ml_GetInt( p_ml, ML_PEOPLE_ID, psz_role, ML_PEOPLE, psz_role,
+                          psz_name );
+        if( i_id <= 0 )
         {
-            /* TODO:Solidly incorporate Album artist */
-            int i_album_id = ml_GetAlbumId( p_ml, p_media->psz_album );
-            if( i_album_id <= 0 )
-            {
-                /* Create album */
-                i_ret = AddAlbum( p_ml, p_media->psz_album, p_media->psz_cover,
-                                    i_album_artist );
-                if( i_ret != VLC_SUCCESS )
-                    return i_ret;
-                i_album_id = ml_GetAlbumId( p_ml, p_media->psz_album );
-                if( i_album_id <= 0 )
-                    return i_ret;
-            }
-            p_media->i_album_id = i_album_id;
+            /* Create person */
+            AddPeople( p_ml, psz_name, psz_role );
+            i_id = ml_GetInt( p_ml, ML_PEOPLE_ID, psz_role, ML_PEOPLE,
+                              psz_role, psz_name );
         }
+        if( i_id > 0 )
+            vlc_dictionary_insert( &p_batch->people, psz_key,
+                                   (void *)(intptr_t)i_id );
     }
+    free( psz_key );
+    return i_id;
+}
 
+static int GetAlbumId( media_library_t *p_ml, add_batch_t *p_batch,
+                       ml_media_t *p_media, int i_album_artist )
+{
+    int i_id = (intptr_t)vlc_dictionary_value_for_key( &p_batch->albums,
+                                                        p_media->psz_album );
+    if( i_id > 0 )
+        return i_id;
+
+    /* TODO:Solidly incorporate Album artist */
+    i_id = ml_GetAlbumId( p_ml, p_media->psz_album );
+    if( i_id <= 0 )
+    {
+        /* Create album */
+        if( AddAlbum( p_ml, p_media->psz_album, p_media->psz_cover,
+                      i_album_artist ) != VLC_SUCCESS )
+            return -1;
+        i_id = ml_GetAlbumId( p_ml, p_media->psz_album );
+    }
+    if( i_id > 0 )
+        vlc_dictionary_insert( &p_batch->albums, p_media->psz_album,
+                               (void *)(intptr_t)i_id );
+    return i_id;
+}
+
+/* Inserts one media, inside the transaction of the batch */
+static int BatchInsert( media_library_t *p_ml, add_batch_t *p_batch,
+                        ml_media_t *p_media )
+{
+    sql_t *p_sql = p_ml->p_sys->p_sql;
+    int i_album_artist = 0;
+    int i_ret;
 
     if( !p_media->psz_uri || !*p_media->psz_uri )
     {
@@ -102,88 +186,164 @@ int AddMedia( media_library_t *p_ml, ml_media_t *p_media )
         return VLC_EGENERIC;
     }
 
-    i_ret = QuerySimple( p_ml,
-            "INSERT INTO media ( uri, title, original_title, genre, type, "
-            "comment, cover, preview, year, track, disc, album_id, vote, score, "
-            "duration, first_played, played_count, last_played, "
-            "skipped_count, last_skipped, import_time, filesize ) "
-            "VALUES ( %Q, %Q, %Q, %Q, '%d',%Q, %Q, %Q, '%d', '%d', '%d', '%d',"
-            "'%d', '%d', '%d', '%d', '%d', '%d', '%d', '%d', '%d', '%d' )",
-                p_media->psz_uri,
-                p_media->psz_title,
-                p_media->psz_orig_title,
-                p_media->psz_genre,
-                (int)p_media->i_type,
-                p_media->psz_comment,
-                p_media->psz_cover,
-                p_media->psz_preview,
-                (int)p_media->i_year,
-                (int)p_media->i_track_number,
-                (int)p_media->i_disc_number,
-                (int)p_media->i_album_id,
-                (int)p_media->i_vote,
-                (int)p_media->i_score,
-                (int)p_media->i_duration,
-                (int)p_media->i_first_played,
-                (int)p_media->i_played_count,
-                (int)p_media->i_last_played,
-                (int)p_media->i_skipped_count,
-                (int)p_media->i_last_skipped,
-                (int)p_media->i_import_time,
-                (int)p_media->i_filesize );
-    if( i_ret != VLC_SUCCESS )
-        goto quit_addmedia;
+    /* Add any people */
+    for( ml_person_t *person = p_media->p_people; person;
+         person = person->p_next )
+    {
+        if( person->i_id <= 0 && person->psz_name )
+            person->i_id = GetPeopleId( p_ml, p_batch, person->psz_role,
+                                        person->psz_name );
+        if( strcmp( person->psz_role, ML_PERSON_ALBUM_ARTIST ) == 0 )
+            i_album_artist = person->i_id;
+    }
+
+    /* Album id */
+    if( p_media->i_album_id <= 0 && p_media->psz_album )
+    {
+        int i_album_id = GetAlbumId( p_ml, p_batch, p_media, i_album_artist );
+        if( i_album_id <= 0 )
+            return VLC_EGENERIC;
+        p_media->i_album_id = i_album_id;
+    }
+
+    sql_stmt_t *p_stmt = p_batch->p_media_stmt;
+    i_ret = BindTextOrNull( p_sql, p_stmt, 1, p_media->psz_uri );
+    i_ret |= BindTextOrNull( p_sql, p_stmt, 2, p_media->psz_title );
+    i_ret |= BindTextOrNull( p_sql, p_stmt, 3, p_media->psz_orig_title );
+    i_ret |= BindTextOrNull( p_sql, p_stmt, 4, p_media->psz_genre );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 5, p_media->i_type );
+    i_ret |= BindTextOrNull( p_sql, p_stmt, 6, p_media->psz_comment );
+    i_ret |= BindTextOrNull( p_sql, p_stmt, 7, p_media->psz_cover );
+    i_ret |= BindTextOrNull( p_sql, p_stmt, 8, p_media->psz_preview );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 9, p_media->i_year );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 10, p_media->i_track_number );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 11, p_media->i_disc_number );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 12, p_media->i_album_id );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 13, p_media->i_vote );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 14, p_media->i_score );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 15, p_media->i_duration );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 16, p_media->i_first_played );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 17, p_media->i_played_count );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 18, p_media->i_last_played );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 19, p_media->i_skipped_count );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 20, p_media->i_last_skipped );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 21, p_media->i_import_time );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 22, p_media->i_filesize );
+    if( RunInsert( p_sql, p_stmt, i_ret ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
 
     int id = GetMediaIdOfURI( p_ml, p_media->psz_uri );
     if( id <= 0 )
+        return VLC_EGENERIC;
+
+    /* If there is no person, set it to "Unknown", ie. people_id=0 */
+    p_stmt = p_batch->p_people_stmt;
+    ml_person_t *person = p_media->p_people;
+    do
     {
-        i_ret = VLC_EGENERIC;
-        goto quit_addmedia;
+        i_ret = sql_BindInteger( p_sql, p_stmt, 1, id );
+        i_ret |= sql_BindInteger( p_sql, p_stmt, 2, person ? person->i_id : 0 );
+        if( RunInsert( p_sql, p_stmt, i_ret ) != VLC_SUCCESS )
+            return VLC_EGENERIC;
+        if( person )
+            person = person->p_next;
     }
+    while( person );
+
+    p_stmt = p_batch->p_extra_stmt;
+    i_ret = sql_BindInteger( p_sql, p_stmt, 1, id );
+    i_ret |= BindTextOrNull( p_sql, p_stmt, 2, p_media->psz_extra );
+    i_ret |= BindTextOrNull( p_sql, p_stmt, 3, p_media->psz_language );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 4, p_media->i_bitrate );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 5, p_media->i_samplerate );
+    i_ret |= sql_BindInteger( p_sql, p_stmt, 6, p_media->i_bpm );
+    if( RunInsert( p_sql, p_stmt, i_ret ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
 
-    p_media->i_id = id;
-    person = p_media->p_people;
-    if( !person )
+    /* Index the media as stored, with its album title and people names */
+    p_stmt = p_batch->p_search_stmt;
+    if( p_stmt )
     {
-        /* If there is no person, set it to "Unknown", ie. people_id=0 */
-        i_ret = QuerySimple( p_ml, "INSERT into media_to_people ( media_id, "
-                                     "people_id ) VALUES ( %d, %d )",
-                                     id, 0 );
-        if( i_ret != VLC_SUCCESS )
-            goto quit_addmedia;
-    } else {
-        while( person )
-        {
-            i_ret = QuerySimple( p_ml, "INSERT into media_to_people ( media_id, "
-                                         "people_id ) VALUES ( %d, %d )",
-                                         id, person->i_id );
-            if( i_ret != VLC_SUCCESS )
-                goto quit_addmedia;
-            person = person->p_next;
-        }
+        i_ret = sql_BindInteger( p_sql, p_stmt, 1, id );
+        if( RunInsert( p_sql, p_stmt, i_ret ) != VLC_SUCCESS )
+            return VLC_EGENERIC;
     }
 
-    i_ret = QuerySimple( p_ml, "INSERT into extra ( id, extra, language, bitrate, "
-            "samplerate, bpm ) VALUES ( '%d', %Q, %Q, '%d', '%d', '%d' )",
-            id, p_media->psz_extra, p_media->psz_language,
-            p_media->i_bitrate, p_media->i_samplerate, p_media->i_bpm );
-    if( i_ret != VLC_SUCCESS )
-        goto quit_addmedia;
+    p_media->i_id = id;
     i_ret = pool_InsertMedia( p_ml, p_media, true );
+    if( i_ret != VLC_SUCCESS )
+        p_media->i_id = 0;
+    return i_ret;
+}
+
+/**
+ * @brief Add elements to ML based on ml_media_t (media IDs ignored)
+ * @param p_ml This media_library_t object
+ * @param pp_medias media items to add in the DB. The media_id is ignored
+ * @param i_count number of media items
+ * @return VLC_SUCCESS if all the medias were added, VLC_EGENERIC otherwise
+ * @note This function is threadsafe. All the medias are added in one
+ * transaction. A media that fails is rolled back alone and keeps a null
+ * i_id, the others are still added.
+ */
+int AddMedias( media_library_t *p_ml, ml_media_t **pp_medias, int i_count )
+{
+    add_batch_t batch;
+    int i_ret = VLC_SUCCESS;
+    int i_added = 0;
 
-quit_addmedia:
-    if( i_ret == VLC_SUCCESS )
+    if( Begin( p_ml ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
+    if( BatchInit( p_ml, &batch ) != VLC_SUCCESS )
     {
-        Commit( p_ml );
+        BatchClean( p_ml, &batch );
+        Rollback( p_ml );
+        return VLC_EGENERIC;
     }
+
+    for( int i = 0; i < i_count; i++ )
+    {
+        ml_media_t *p_media = pp_medias[i];
+
+        ml_LockMedia( p_media );
+        assert( p_media->i_id == 0 );
+        if( QuerySimple( p_ml, "SAVEPOINT add_media" ) != VLC_SUCCESS
+         || BatchInsert( p_ml, &batch, p_media ) != VLC_SUCCESS )
+        {
+            QuerySimple( p_ml, "ROLLBACK TO add_media" );
+            BatchForget( &batch );
+            i_ret = VLC_EGENERIC;
+        }
+        else
+            i_added++;
+        QuerySimple( p_ml, "RELEASE add_media" );
+        ml_UnlockMedia( p_media );
+    }
+
+    BatchClean( p_ml, &batch );
+    if( i_added > 0 )
+        Commit( p_ml );
     else
         Rollback( p_ml );
-    ml_UnlockMedia( p_media );
-    if( i_ret == VLC_SUCCESS )
-        var_SetInteger( p_ml, "media-added", id );
+
+    for( int i = 0; i < i_count; i++ )
+        if( pp_medias[i]->i_id > 0 )
+            var_SetInteger( p_ml, "media-added", pp_medias[i]->i_id );
     return i_ret;
 }
 
+/**
+ * @brief Add element to ML based on a ml_media_t (media ID ignored)
+ * @param p_ml This media_library_t object
+ * @param p_media media item to add in the DB. The media_id is ignored
+ * @return VLC_SUCCESS or VLC_EGENERIC
+ * @note This function is threadsafe
+ */
+int AddMedia( media_library_t *p_ml, ml_media_t *p_media )
+{
+    return AddMedias( p_ml, &p_media, 1 );
+}
+
 
 /**
  * @brief Add generic album to ML
@@ -250,41 +410,91 @@ int AddPeople( media_library_t *p_ml, const char *psz_name,
 }
 
 /**
- * @brief Add element to ML based on an Input Item
+ * @brief Add elements to ML based on Input Items
  * @param p_ml This media_library_t object
- * @param p_input input item to add
+ * @param pp_inputs input items to add
+ * @param i_count number of input items
  * @return VLC_SUCCESS or VLC_EGENERIC
+ * @note The items that are not in the ML yet are added in one transaction
  */
-int AddInputItem( media_library_t *p_ml, input_item_t *p_input )
+int AddInputItems( media_library_t *p_ml, input_item_t **pp_inputs,
+                   int i_count )
 {
     assert( p_ml );
-    if( !p_input || !p_input->psz_uri )
-        return VLC_EGENERIC;
     int i_ret = VLC_SUCCESS;
 
-    vlc_gc_incref( p_input );
+    input_item_t **pp_new = malloc( i_count * sizeof( *pp_new ) );
+    ml_media_t **pp_medias = malloc( i_count * sizeof( *pp_medias ) );
+    if( !pp_new || !pp_medias )
+    {
+        free( pp_new );
+        free( pp_medias );
+        return VLC_ENOMEM;
+    }
 
-    /* Check input item is not already in the ML */
-    i_ret = GetMediaIdOfInputItem( p_ml, p_input );
-    if( i_ret > 0 )
+    int i_new = 0;
+    for( int i = 0; i < i_count; i++ )
     {
-        msg_Dbg( p_ml, "Item already in Media Library (id: %d)", i_ret );
-        vlc_gc_decref( p_input );
-        return VLC_SUCCESS;
+        input_item_t *p_input = pp_inputs[i];
+        if( !p_input || !p_input->psz_uri )
+        {
+            i_ret = VLC_EGENERIC;
+            continue;
+        }
+
+        /* Check input item is not already in the ML, nor in this batch */
+        int i_id = GetMediaIdOfInputItem( p_ml, p_input );
+        if( i_id > 0 )
+        {
+            msg_Dbg( p_ml, "Item already in Media Library (id: %d)", i_id );
+            continue;
+        }
+        int j;
+        for( j = 0; j < i_new; j++ )
+            if( !strcmp( pp_new[j]->psz_uri, p_input->psz_uri ) )
+                break;
+        if( j < i_new )
+            continue;
+
+        ml_media_t *p_media = media_New( p_ml, 0, ML_MEDIA, false );
+        if( !p_media )
+        {
+            i_ret = VLC_ENOMEM;
+            continue;
+        }
+        CopyInputItemToMedia( p_media, p_input );
+        vlc_gc_incref( p_input );
+        pp_new[i_new] = p_input;
+        pp_medias[i_new] = p_media;
+        i_new++;
     }
 
-    ml_media_t* p_media = media_New( p_ml, 0, ML_MEDIA, false );
+    if( i_new > 0 && AddMedias( p_ml, pp_medias, i_new ) != VLC_SUCCESS )
+        i_ret = VLC_EGENERIC;
 
-    /* Add media to the database */
-    CopyInputItemToMedia( p_media, p_input );
-    i_ret = AddMedia( p_ml, p_media );
-    if( i_ret == VLC_SUCCESS )
-        watch_add_Item( p_ml, p_input, p_media );
-    ml_gc_decref( p_media );
-    vlc_gc_decref( p_input );
+    for( int i = 0; i < i_new; i++ )
+    {
+        if( pp_medias[i]->i_id > 0 )
+            watch_add_Item( p_ml, pp_new[i], pp_medias[i] );
+        ml_gc_decref( pp_medias[i] );
+        vlc_gc_decref( pp_new[i] );
+    }
+    free( pp_medias );
+    free( pp_new );
     return i_ret;
 }
 
+/**
+ * @brief Add element to ML based on an Input Item
+ * @param p_ml This media_library_t object
+ * @param p_input input item to add
+ * @return VLC_SUCCESS or VLC_EGENERIC
+ */
+int AddInputItem( media_library_t *p_ml, input_item_t *p_input )
+{
+    return AddInputItems( p_ml, &p_input, 1 );
+}
+
 
 /**
  * @brief Add element to ML based on a Playlist Item
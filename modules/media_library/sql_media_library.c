@@ -188,11 +188,13 @@ static int load( vlc_object_t *obj )
     p_ml->p_sys->p_mon = p_mon;
 
     p_mon->p_ml = p_ml;
+    MonitorInit( p_mon );
 
     if( vlc_clone( &p_mon->thread, RunMonitoringThread, p_mon,
                 VLC_THREAD_PRIORITY_LOW ) )
     {
         msg_Err( p_ml, "cannot spawn the media library monitoring thread" );
+        MonitorClean( p_mon );
         vlc_mutex_destroy( &p_ml->p_sys->lock );
         sql_Destroy( p_ml->p_sys->p_sql );
         free( p_ml->p_sys );
@@ -218,12 +220,16 @@ static void unload( vlc_object_t *obj )
 {
     media_library_t *p_ml = ( media_library_t* ) obj;
 
+    /* Add the medias scanned so far */
+    MonitorFlush( p_ml->p_sys->p_mon );
+
     /* Stopping the watching system */
     watch_Close( p_ml );
 
     /* Stop the monitoring thread */
     vlc_cancel( p_ml->p_sys->p_mon->thread );
     vlc_join( p_ml->p_sys->p_mon->thread, NULL );
+    MonitorClean( p_ml->p_sys->p_mon );
     vlc_object_release( p_ml->p_sys->p_mon );
 
     /* Destroy the variable */
@@ -1123,6 +1129,9 @@ int InitDatabase( media_library_t *p_ml )
 
     SetSynchronous( p_ml, b_sync );
 
+    /* Searches fall back to LIKE without the full-text index */
+    InitSearchIndex( p_ml );
+
     msg_Dbg( p_ml, "ML initialized" );
     return VLC_SUCCESS;
 }
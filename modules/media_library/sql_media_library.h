@@ -55,11 +55,15 @@
 #define ITEM_LOOP_MAX_AGE   10  /* An item is deleted after 10 loops */
 #define ML_DBVERSION         1  /* The current version of the database */
 #define ML_MEDIAPOOL_HASH_LENGTH 100 /* The length of the media pool hash */
+#define ML_ADD_BATCH_SIZE   64  /* Scanned medias added per transaction */
+#define ML_ADD_BATCH_DELAY   1  /* Seconds before adding an incomplete batch */
+#define ML_NOTIFY_DELAY      1  /* Seconds between two directory events reads */
 
 /*****************************************************************************
  * Structures and types definitions
  *****************************************************************************/
 typedef struct monitoring_thread_t monitoring_thread_t;
+typedef struct preparsed_item_t    preparsed_item_t;
 typedef struct ml_poolobject_t     ml_poolobject_t;
 
 struct ml_poolobject_t
@@ -90,6 +94,9 @@ struct media_library_sys_t
     /* Info on update/collection rebuilding */
     bool b_updating;
     bool b_rebuilding;
+
+    /* The media_search full-text table is available */
+    bool b_search_index;
 };
 
 /* Directory Monitoring thread */
@@ -101,6 +108,15 @@ struct monitoring_thread_t
     vlc_mutex_t lock;
     vlc_thread_t thread;
     media_library_t *p_ml;
+
+    /* Scanned items waiting to be added to the database */
+    DECL_ARRAY( preparsed_item_t* ) added;
+    int i_preparsing;
+    vlc_mutex_t added_lock;
+
+    /* Directory change notifications, -1 if unavailable */
+    int i_notify_fd;
+    void *p_watches; /* Watch descriptor to directory id tree */
 };
 
 /* Media status Watching thread */
@@ -138,6 +154,8 @@ int Control( media_library_t *p_ml,
 /* Add functions */
 int AddMedia( media_library_t *p_ml,
               ml_media_t *p_media );
+int AddMedias( media_library_t *p_ml,
+               ml_media_t **pp_medias, int i_count );
 int AddAlbum( media_library_t *p_ml, const char *psz_title,
               const char *psz_cover, const int i_album_artist );
 int AddPeople( media_library_t *p_ml,
@@ -147,6 +165,8 @@ int AddPlaylistItem( media_library_t *p_ml,
                      playlist_item_t *p_playlist_item );
 int AddInputItem( media_library_t *p_ml,
                   input_item_t *p_input );
+int AddInputItems( media_library_t *p_ml,
+                   input_item_t **pp_inputs, int i_count );
 
 /* Create and Copy functions */
 ml_media_t* GetMedia( media_library_t* p_ml, int id,
@@ -188,6 +208,20 @@ int FindAdv( media_library_t *p_ml,
              const char* psz_lvalue,
              ml_ftree_t *tree );
 
+/* Full-text search index */
+int InitSearchIndex( media_library_t *p_ml );
+int UpdateSearchIndex( media_library_t *p_ml, const char *psz_where );
+
+/* Fills media_search from the tables, complete with a WHERE on media.id */
+#define ML_SEARCH_INDEX_INSERT                                              \
+    "INSERT INTO media_search ( docid, title, original_title, album, "      \
+    "people ) SELECT media.id, media.title, media.original_title, "         \
+    "album.title, ( SELECT group_concat( people.name, ' ' ) "               \
+    "FROM media_to_people JOIN people ON people.id = "                      \
+    "media_to_people.people_id WHERE media_to_people.media_id = media.id "  \
+    "AND people.id != 0 ) FROM media LEFT JOIN album ON "                   \
+    "album.id = media.album_id AND album.id != 0 "
+
 /* Update the database */
 int Update( media_library_t *p_ml,
             ml_select_e selected_type,
@@ -282,6 +316,9 @@ static inline void Rollback( media_library_t* p_ml )
  * Scanning/monitoring functions
  *****************************************************************************/
 void *RunMonitoringThread( void *p_mon );
+void MonitorInit( monitoring_thread_t *p_mon );
+void MonitorFlush( monitoring_thread_t *p_mon );
+void MonitorClean( monitoring_thread_t *p_mon );
 int AddDirToMonitor( media_library_t *p_ml,
                      const char *psz_dir );
 int ListMonitoredDirs( media_library_t *p_ml,
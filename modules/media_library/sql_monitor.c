@@ -37,14 +37,24 @@
 #include "vlc_url.h"
 #include "vlc_fs.h"
 
+#ifdef HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+# include <unistd.h>
+# ifdef HAVE_SEARCH_H
+#  include <search.h>
+# endif
+#endif
+
 static const char* ppsz_MediaExtensions[] =
                         { EXTENSIONS_AUDIO_CSV, EXTENSIONS_VIDEO_CSV, NULL };
 
 
 /* Monitoring and directory scanning private functions */
 typedef struct stat_list_t stat_list_t;
-typedef struct preparsed_item_t preparsed_item_t;
 static void UpdateLibrary( monitoring_thread_t *p_mon );
+static bool UpdateNotified( monitoring_thread_t *p_mon );
+static void Watch( monitoring_thread_t *p_mon, int i_dir_id,
+                   const char *psz_dir );
 static void ScanFiles( monitoring_thread_t *, int, bool, stat_list_t *stparent );
 static int Sort( const char **, const char ** );
 
@@ -55,9 +65,31 @@ struct stat_list_t
     struct stat st;
 };
 
+#ifdef HAVE_SYS_INOTIFY_H
+/* Changes that make a directory worth scanning again */
+#define NOTIFY_EVENTS ( IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO \
+                        | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF \
+                        | IN_ONLYDIR )
+
+/* Struct mapping an inotify watch to its directory, the watch descriptor
+ * must remain the first field */
+typedef struct
+{
+    int i_wd;
+    int i_dir_id;
+} notify_watch_t;
+
+static int WatchCmp( const void *a, const void *b )
+{
+    const notify_watch_t *wa = a, *wb = b;
+    return ( wa->i_wd > wb->i_wd ) - ( wa->i_wd < wb->i_wd );
+}
+#endif
+
 struct preparsed_item_t
 {
     monitoring_thread_t *p_mon;
+    input_item_t *p_input;
     char* psz_uri;
     int i_dir_id;
     int i_mtime;
@@ -211,17 +243,39 @@ void *RunMonitoringThread( void *p_this )
 
     var_Create( p_mon, "ml-recursive-scan", VLC_VAR_BOOL | VLC_VAR_DOINHERIT );
 
+    mtime_t i_next_update = 0;
     while( vlc_object_alive( p_mon ) )
     {
         vlc_mutex_lock( &p_mon->lock );
 
-        /* Update */
-        UpdateLibrary( p_mon );
+        /* Update. Once the directories are watched, only the directories
+           that changed are scanned again */
+        if( mdate() >= i_next_update )
+        {
+            UpdateLibrary( p_mon );
+            i_next_update = INT64_MAX;
+        }
+        else if( p_mon->i_notify_fd != -1 && UpdateNotified( p_mon ) )
+            i_next_update = 0; /* Events were lost */
+        if( p_mon->i_notify_fd == -1 && i_next_update == INT64_MAX )
+            i_next_update = mdate() + 1000000*MONITORING_DELAY;
+
+        /* Add the medias preparsed since the last loop */
+        MonitorFlush( p_mon );
 
         /* We wait MONITORING_DELAY seconds or wait that the media library
-           signals us to do something */
-        vlc_cond_timedwait( &p_mon->wait, &p_mon->lock,
-                            mdate() + 1000000*MONITORING_DELAY );
+           signals us to do something. Medias still being preparsed are
+           added by the next loop if they do not fill a batch. */
+        mtime_t i_deadline = i_next_update;
+        if( p_mon->i_notify_fd != -1 )
+            i_deadline = mdate() + 1000000*ML_NOTIFY_DELAY;
+        vlc_mutex_lock( &p_mon->added_lock );
+        if( p_mon->added.i_size > 0 || p_mon->i_preparsing > 0 )
+            i_deadline = __MIN( i_deadline,
+                                mdate() + 1000000*ML_ADD_BATCH_DELAY );
+        vlc_mutex_unlock( &p_mon->added_lock );
+        if( vlc_cond_timedwait( &p_mon->wait, &p_mon->lock, i_deadline ) == 0 )
+            i_next_update = 0;
 
         vlc_mutex_unlock( &p_mon->lock );
     }
@@ -278,6 +332,8 @@ static void UpdateLibrary( monitoring_thread_t *p_mon )
             msg_Dbg( p_mon, "Removing `%s'", psz_dir );
             RemoveDirToMonitor( p_ml, psz_dir );
         }
+        else
+            Watch( p_mon, id, psz_dir );
 
         if( timestamp < s_stat.st_mtime )
         {
@@ -288,6 +344,230 @@ static void UpdateLibrary( monitoring_thread_t *p_mon )
     FreeSQLResult( p_ml, pp_results );
 }
 
+/**
+ * @brief Watch a directory for changes, if notifications are available
+ */
+static void Watch( monitoring_thread_t *p_mon, int i_dir_id,
+                   const char *psz_dir )
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if( p_mon->i_notify_fd == -1 )
+        return;
+
+    int i_wd = inotify_add_watch( p_mon->i_notify_fd, psz_dir,
+                                  NOTIFY_EVENTS );
+    if( i_wd == -1 )
+    {
+        /* Most likely out of watches: fall back to periodic updates */
+        msg_Warn( p_mon, "cannot watch `%s': %m", psz_dir );
+        close( p_mon->i_notify_fd );
+        p_mon->i_notify_fd = -1;
+        tdestroy( p_mon->p_watches, free );
+        p_mon->p_watches = NULL;
+        return;
+    }
+
+    notify_watch_t *p_watch = malloc( sizeof( *p_watch ) );
+    if( !p_watch )
+        return;
+    p_watch->i_wd = i_wd;
+    p_watch->i_dir_id = i_dir_id;
+
+    notify_watch_t **pp_watch = tsearch( p_watch, &p_mon->p_watches,
+                                         WatchCmp );
+    if( !pp_watch || *pp_watch != p_watch )
+    {
+        /* Already watched: the same directory got the same descriptor */
+        if( pp_watch )
+            (*pp_watch)->i_dir_id = i_dir_id;
+        free( p_watch );
+    }
+#else
+    VLC_UNUSED( p_mon ); VLC_UNUSED( i_dir_id ); VLC_UNUSED( psz_dir );
+#endif
+}
+
+/**
+ * @brief Scan again the directories that were notified as changed
+ * @return true if notifications were lost and everything must be checked
+ */
+static bool UpdateNotified( monitoring_thread_t *p_mon )
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    media_library_t *p_ml = p_mon->p_ml;
+    char buf[4096]
+        __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    DECL_ARRAY( int ) changed;
+    bool b_overflow = false;
+    ssize_t i_len;
+
+    ARRAY_INIT( changed );
+    while( ( i_len = read( p_mon->i_notify_fd, buf, sizeof( buf ) ) ) > 0 )
+    {
+        const struct inotify_event *p_ev;
+        for( char *p = buf; p < buf + i_len; p += sizeof( *p_ev ) + p_ev->len )
+        {
+            p_ev = (const struct inotify_event *)p;
+            if( p_ev->mask & IN_Q_OVERFLOW )
+            {
+                b_overflow = true;
+                continue;
+            }
+
+            notify_watch_t key = { .i_wd = p_ev->wd };
+            notify_watch_t **pp_watch = tfind( &key, &p_mon->p_watches,
+                                               WatchCmp );
+            if( !pp_watch )
+                continue;
+            notify_watch_t *p_watch = *pp_watch;
+            int i_dir_id = p_watch->i_dir_id;
+
+            if( p_ev->mask & IN_IGNORED )
+            {
+                /* The directory is gone, or not watched anymore */
+                tdelete( p_watch, &p_mon->p_watches, WatchCmp );
+                free( p_watch );
+            }
+
+            int i;
+            for( i = 0; i < changed.i_size; i++ )
+                if( changed.p_elems[i] == i_dir_id )
+                    break;
+            if( i == changed.i_size )
+                ARRAY_APPEND( changed, i_dir_id );
+        }
+    }
+
+    if( !b_overflow && changed.i_size > 0 )
+    {
+        bool b_recursive = var_GetBool( p_mon, "ml-recursive-scan" );
+        int i_dir_id;
+        FOREACH_ARRAY( i_dir_id, changed )
+            char **pp_results;
+            int i_rows, i_cols;
+            struct stat s_stat;
+
+            Query( p_ml, &pp_results, &i_rows, &i_cols,
+                   "SELECT uri AS directory_uri FROM directories "
+                   "WHERE id = '%d'", i_dir_id );
+            if( i_rows < 1 )
+            {
+                /* Removed from the media library meanwhile */
+                FreeSQLResult( p_ml, pp_results );
+                continue;
+            }
+            const char *psz_dir = pp_results[1];
+            if( vlc_stat( psz_dir, &s_stat ) == -1
+             || !S_ISDIR( s_stat.st_mode ) )
+            {
+                msg_Dbg( p_mon, "Removing `%s'", psz_dir );
+                RemoveDirToMonitor( p_ml, psz_dir );
+            }
+            else
+            {
+                msg_Dbg( p_mon, "Updating `%s'", psz_dir );
+                ScanFiles( p_mon, i_dir_id, b_recursive, NULL );
+            }
+            FreeSQLResult( p_ml, pp_results );
+        FOREACH_END();
+    }
+    ARRAY_RESET( changed );
+    return b_overflow;
+#else
+    VLC_UNUSED( p_mon );
+    return false;
+#endif
+}
+
+/**
+ * @brief Initialize the monitoring thread data
+ */
+void MonitorInit( monitoring_thread_t *p_mon )
+{
+    ARRAY_INIT( p_mon->added );
+    p_mon->i_preparsing = 0;
+    vlc_mutex_init( &p_mon->added_lock );
+
+    p_mon->p_watches = NULL;
+#ifdef HAVE_SYS_INOTIFY_H
+    p_mon->i_notify_fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if( p_mon->i_notify_fd == -1 )
+        msg_Warn( p_mon, "cannot watch directories: %m" );
+#else
+    p_mon->i_notify_fd = -1;
+#endif
+}
+
+/**
+ * @brief Add the scanned medias waiting for a batch to the database
+ */
+void MonitorFlush( monitoring_thread_t *p_mon )
+{
+    media_library_t *p_ml = p_mon->p_ml;
+
+    vlc_mutex_lock( &p_mon->added_lock );
+    preparsed_item_t **pp_items = p_mon->added.p_elems;
+    int i_count = p_mon->added.i_size;
+    ARRAY_INIT( p_mon->added );
+    vlc_mutex_unlock( &p_mon->added_lock );
+
+    if( i_count == 0 )
+        return;
+
+    input_item_t **pp_inputs = malloc( i_count * sizeof( *pp_inputs ) );
+    if( pp_inputs )
+    {
+        for( int i = 0; i < i_count; i++ )
+            pp_inputs[i] = pp_items[i]->p_input;
+        if( AddInputItems( p_ml, pp_inputs, i_count ) != VLC_SUCCESS )
+            msg_Dbg( p_mon, "Some items could not be correctly added "
+                     "during scan" );
+        free( pp_inputs );
+    }
+
+    bool b_trans = Begin( p_ml ) == VLC_SUCCESS;
+    for( int i = 0; i < i_count; i++ )
+    {
+        preparsed_item_t *p_itemobject = pp_items[i];
+        QuerySimple( p_ml, "UPDATE media SET directory_id=%d, timestamp=%d "
+                              "WHERE id=%d",
+                        p_itemobject->i_dir_id, p_itemobject->i_mtime,
+                        GetMediaIdOfURI( p_ml,
+                                         p_itemobject->p_input->psz_uri ) );
+    }
+    if( b_trans )
+        Commit( p_ml );
+
+    for( int i = 0; i < i_count; i++ )
+    {
+        vlc_gc_decref( pp_items[i]->p_input );
+        free( pp_items[i]->psz_uri );
+        free( pp_items[i] );
+    }
+    free( pp_items );
+}
+
+/**
+ * @brief Drop the scanned medias that were not added to the database
+ */
+void MonitorClean( monitoring_thread_t *p_mon )
+{
+    preparsed_item_t *p_itemobject;
+    FOREACH_ARRAY( p_itemobject, p_mon->added )
+        vlc_gc_decref( p_itemobject->p_input );
+        free( p_itemobject->psz_uri );
+        free( p_itemobject );
+    FOREACH_END();
+    ARRAY_RESET( p_mon->added );
+    vlc_mutex_destroy( &p_mon->added_lock );
+
+#ifdef HAVE_SYS_INOTIFY_H
+    if( p_mon->i_notify_fd != -1 )
+        close( p_mon->i_notify_fd );
+    tdestroy( p_mon->p_watches, free );
+#endif
+}
+
 /**
  * @brief Callback for input item preparser to directory monitor
  */
@@ -299,19 +579,35 @@ static void PreparseComplete( const vlc_event_t * p_event, void *p_data )
     media_library_t *p_ml = (media_library_t *)p_mon->p_ml;
     input_item_t *p_input = (input_item_t*) p_event->p_obj;
 
+    vlc_event_detach( &p_input->event_manager, vlc_InputItemPreparsedChanged,
+                  PreparseComplete, p_itemobject );
+
+    if( input_item_IsPreparsed( p_input ) && !p_itemobject->b_update )
+    {
+        /* New medias are added by batches of ML_ADD_BATCH_SIZE */
+        p_itemobject->p_input = p_input;
+        vlc_mutex_lock( &p_mon->added_lock );
+        ARRAY_APPEND( p_mon->added, p_itemobject );
+        p_mon->i_preparsing--;
+        bool b_flush = p_mon->added.i_size >= ML_ADD_BATCH_SIZE;
+        vlc_mutex_unlock( &p_mon->added_lock );
+        if( b_flush )
+            MonitorFlush( p_mon );
+        return;
+    }
+
+    vlc_mutex_lock( &p_mon->added_lock );
+    p_mon->i_preparsing--;
+    vlc_mutex_unlock( &p_mon->added_lock );
+
     if( input_item_IsPreparsed( p_input ) )
     {
-        if( p_itemobject->b_update )
-        {
-            //TODO: Perhaps we don't have to load everything?
-            ml_media_t* p_media = GetMedia( p_ml, p_itemobject->i_update_id,
-                    ML_MEDIA_SPARSE, true );
-            CopyInputItemToMedia( p_media, p_input );
-            i_ret = UpdateMedia( p_ml, p_media );
-            ml_gc_decref( p_media );
-        }
-        else
-            i_ret = AddInputItem( p_ml, p_input );
+        //TODO: Perhaps we don't have to load everything?
+        ml_media_t* p_media = GetMedia( p_ml, p_itemobject->i_update_id,
+                ML_MEDIA_SPARSE, true );
+        CopyInputItemToMedia( p_media, p_input );
+        i_ret = UpdateMedia( p_ml, p_media );
+        ml_gc_decref( p_media );
     }
 
     if( i_ret != VLC_SUCCESS )
@@ -321,8 +617,6 @@ static void PreparseComplete( const vlc_event_t * p_event, void *p_data )
                           "WHERE id=%d",
                     p_itemobject->i_dir_id, p_itemobject->i_mtime,
                     GetMediaIdOfURI( p_ml, p_input->psz_uri ) );
-    vlc_event_detach( &p_input->event_manager, vlc_InputItemPreparsedChanged,
-                  PreparseComplete, p_itemobject );
     vlc_gc_decref( p_input );
     free( p_itemobject->psz_uri );
 }
@@ -381,6 +675,7 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
 #endif
     stself.parent = stparent;
 
+    Watch( p_mon, i_dir_id, psz_dir );
     QuerySimple( p_ml, "UPDATE directories SET timestamp=%d WHERE id = %d",
                     stself.st.st_mtime, i_dir_id );
     Query( p_ml, &ppsz_monitored_files, &i_mon_rows, &i_mon_cols,
@@ -493,6 +788,12 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
                 p_itemobject->i_update_id = b_update ?
                     atoi( ppsz_monitored_files[ j * i_mon_cols + 0 ] ) : 0 ;
 
+                p_itemobject->p_input = NULL;
+
+                vlc_mutex_lock( &p_mon->added_lock );
+                p_mon->i_preparsing++;
+                vlc_mutex_unlock( &p_mon->added_lock );
+
                 vlc_event_manager_t *p_em = &p_input->event_manager;
                 vlc_event_attach( p_em, vlc_InputItemPreparsedChanged,
                       PreparseComplete, p_itemobject );
@@ -172,6 +172,9 @@ int BuildSelectVa( media_library_t *p_ml, char **ppsz_query,
             case ML_LIMIT:
                 p_ftree = ml_FtreeSpecLimit( p_ftree, va_arg( criterias, int ) );
                 break;
+            case ML_OFFSET:
+                p_ftree = ml_FtreeSpecOffset( p_ftree, va_arg( criterias, int ) );
+                break;
             case ML_ARTIST:
                 /* This is OK because of a shallow free find */
                 p_find->lvalue.str = (char *)ML_PERSON_ARTIST;
@@ -263,8 +266,8 @@ static int AppendStringFmt( media_library_t *p_ml,
 
 /* Early Declaration of Where String Generator */
 static int BuildWhere( media_library_t* p_ml, char **ppsz_where, ml_ftree_t* tree,
-       char** sort, int* limit, const char** distinct, char*** pppsz_frompersons,
-       int* i_frompersons, int* join );
+       char** sort, int* limit, int* offset, const char** distinct,
+       char*** pppsz_frompersons, int* i_frompersons, int* join );
 
 #   define table_media             (1 << 0)
 #   define table_album             (1 << 1)
@@ -313,7 +316,12 @@ int BuildSelect( media_library_t *p_ml,
                  FROM psz_from [JOIN psz_join ON psz_on]
                  [JOIN psz_join2 ON psz_on2]
                  [WHERE psz_where[i] [AND psz_where[j] ...]]
-                 [LIMIT psz_limit] [ORDER BY psz_select psz_sort] ;"
+                 [ORDER BY psz_select psz_sort] [LIMIT i_limit OFFSET i_offset] ;"
+    Medias span one row per person, so they are paged on their ids:
+    psz_query = "SELECT ... FROM ... [JOIN ...]
+                 WHERE media.id IN ( SELECT DISTINCT media.id FROM ...
+                 [JOIN ...] [WHERE ...] LIMIT i_limit OFFSET i_offset )
+                 [ORDER BY psz_select psz_sort] ;"
     */
     char *psz_select             = NULL;
     const char *psz_distinct     = ""; /* "DISTINCT" or "" */
@@ -331,6 +339,7 @@ int BuildSelect( media_library_t *p_ml,
     char *psz_join2              = NULL;
     char *psz_on                 = NULL;
     char *psz_on2                = NULL;
+    char *psz_joins              = NULL; /* Complete JOIN clauses */
     int i_join                   = 0;    /* Tables that need to be joined */
 
     /* String buffers */
@@ -339,9 +348,10 @@ int BuildSelect( media_library_t *p_ml,
     char *psz_tmp                = NULL;
 
     int i_limit                  = 0;
+    int i_offset                 = 0;
 
     /* Build the WHERE condition */
-    BuildWhere( p_ml, &psz_where, tree, &psz_sort, &i_limit,
+    BuildWhere( p_ml, &psz_where, tree, &psz_sort, &i_limit, &i_offset,
             &psz_distinct, &ppsz_frompersons, &i_num_frompersons, &i_join );
 
     PackFromPersons( &ppsz_frompersons, i_num_frompersons );
@@ -719,13 +729,6 @@ int BuildSelect( media_library_t *p_ml,
     }
     if( i_ret < 0 ) goto exit;
 
-    i_ret = AppendStringFmt( p_ml, &psz_query,
-                             "SELECT %s %s ", psz_distinct, psz_select );
-    if( i_ret < 0 ) goto exit;
-
-    i_ret = AppendStringFmt( p_ml, &psz_query, "FROM %s ", psz_from );
-    if( i_ret < 0 ) goto exit;
-
     /* Create join conditions */
     if( i_join & table_people )
     {
@@ -815,30 +818,48 @@ int BuildSelect( media_library_t *p_ml,
     /* Complete the join clauses */
     if( psz_join )
     {
-        AppendStringFmt( p_ml, &psz_query,
+        AppendStringFmt( p_ml, &psz_joins,
                          "JOIN %s ON %s ", psz_join, psz_on );
     }
     if( psz_join2 )
     {
-        AppendStringFmt( p_ml, &psz_query,
+        AppendStringFmt( p_ml, &psz_joins,
                          "JOIN %s ON %s ", psz_join2, psz_on2 );
     }
-    if( psz_where && *psz_where )
+
+    i_ret = AppendStringFmt( p_ml, &psz_query, "SELECT %s %s FROM %s %s",
+                             psz_distinct, psz_select, psz_from,
+                             psz_joins ? psz_joins : "" );
+    if( i_ret < 0 ) goto exit;
+
+    if( res_type == ML_TYPE_MEDIA && ( i_limit || i_offset ) )
     {
         AppendStringFmt( p_ml, &psz_query,
-                         "WHERE %s ", psz_where );
+                         "WHERE media.id IN ( SELECT DISTINCT media.id "
+                         "FROM %s %s%s%s LIMIT %d OFFSET %d ) ",
+                         psz_from, psz_joins ? psz_joins : "",
+                         psz_where && *psz_where ? "WHERE " : "",
+                         psz_where ? psz_where : "",
+                         i_limit ? i_limit : -1, i_offset );
+        i_limit = i_offset = 0;
     }
-    /* TODO: FIXME: Limit on media objects doesn't work! */
-    if( i_limit )
+    else if( psz_where && *psz_where )
     {
         AppendStringFmt( p_ml, &psz_query,
-                         "LIMIT %d ", i_limit );
+                         "WHERE %s ", psz_where );
     }
 
     if( psz_sort )
     {
         AppendStringFmt( p_ml, &psz_query,
-                         "ORDER BY %s %s", psz_select, psz_sort );
+                         "ORDER BY %s %s ", psz_select, psz_sort );
+    }
+
+    if( i_limit || i_offset )
+    {
+        AppendStringFmt( p_ml, &psz_query,
+                         "LIMIT %d OFFSET %d", i_limit ? i_limit : -1,
+                         i_offset );
     }
 
     if( i_ret > 0 ) i_ret = VLC_SUCCESS;
@@ -853,6 +874,7 @@ exit:
     free( psz_tmp   );
     free( psz_from  );
     free( psz_join  );
+    free( psz_joins );
     free( psz_select );
     free( psz_join2 );
     free( psz_on    );
@@ -866,6 +888,64 @@ exit:
     return i_ret;
 }
 
+/**
+ * @brief Builds the condition of a ML_SEARCH criteria
+ *
+ * @param p_ml This media_library_t object
+ * @param psz_search Words to look for, a media must match all of them
+ * @param b_prefix The words may only start the words of the media
+ * @return Allocated condition on media.id, or NULL
+ */
+static char *BuildSearch( media_library_t *p_ml, const char *psz_search,
+                          bool b_prefix )
+{
+    if( !p_ml->p_sys->b_search_index )
+        return sql_Printf( p_ml->p_sys->p_sql,
+                "( media.title LIKE '%%%q%%' OR "
+                "media.original_title LIKE '%%%q%%' )",
+                psz_search, psz_search );
+
+    /* Keep the words only, as the tokenizer would split them, so that
+     * the user input cannot form a query syntax error. Each word gains at
+     * most a star and a space. */
+    char *psz_match = malloc( 2 * strlen( psz_search ) + 1 );
+    if( !psz_match )
+        return NULL;
+
+    char *psz_out = psz_match;
+    bool b_word = false;
+    for( const char *psz = psz_search; ; psz++ )
+    {
+        unsigned char c = *psz;
+        if( c >= 0x80 || ( c >= '0' && c <= '9' )
+         || ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) )
+        {
+            if( !b_word && psz_out != psz_match )
+                *psz_out++ = ' ';
+            /* Lower case cannot be mistaken for the AND, OR, NOT operators */
+            *psz_out++ = ( c >= 'A' && c <= 'Z' ) ? c - 'A' + 'a' : c;
+            b_word = true;
+            continue;
+        }
+        if( b_word && b_prefix )
+            *psz_out++ = '*';
+        b_word = false;
+        if( c == '\0' )
+            break;
+    }
+    *psz_out = '\0';
+
+    char *psz_where;
+    if( *psz_match )
+        psz_where = sql_Printf( p_ml->p_sys->p_sql,
+                "media.id IN ( SELECT docid FROM media_search "
+                "WHERE media_search MATCH '%q' )", psz_match );
+    else
+        psz_where = sql_Printf( p_ml->p_sys->p_sql, "1" );
+    free( psz_match );
+    return psz_where;
+}
+
 #undef CASE_INT
 #define CASE_INT( casestr, fmt, table )                                     \
 case casestr:                                                               \
@@ -899,9 +979,9 @@ case casestr:                                                                 \
     *join |= table;                                                           \
     break
 
-#define SLDPJ sort, limit, distinct, pppsz_frompersons, i_frompersons, join
+#define SLDPJ sort, limit, offset, distinct, pppsz_frompersons, i_frompersons, join
 static int BuildWhere( media_library_t* p_ml, char **ppsz_where, ml_ftree_t* tree,
-       char** sort, int* limit, const char** distinct,
+       char** sort, int* limit, int* offset, const char** distinct,
        char*** pppsz_frompersons, int* i_frompersons, int* join )
 {
     assert( ppsz_where && sort && distinct );
@@ -1056,6 +1136,13 @@ static int BuildWhere( media_library_t* p_ml, char **ppsz_where, ml_ftree_t* tre
                    msg_Warn( p_ml, "Deprecated Played Count tags" );
                 CASE_INT( ML_PLAYED_COUNT, "media.played_count", table_media );
                 CASE_INT( ML_SCORE, "media.score", table_media );
+                case ML_SEARCH:
+                    *ppsz_where = BuildSearch( p_ml, tree->value.str,
+                                               tree->comp != ML_COMP_EQUAL );
+                    if( *ppsz_where == NULL )
+                        goto parsefail;
+                    *join |= table_media;
+                    break;
                 CASE_PSZ( ML_TITLE, "media.title", table_media );
                 CASE_INT( ML_TRACK_NUMBER, "media.track", table_media);
                 CASE_INT( ML_TYPE, "media.type", table_media );
@@ -1068,6 +1155,12 @@ static int BuildWhere( media_library_t* p_ml, char **ppsz_where, ml_ftree_t* tre
                     else
                         msg_Warn( p_ml, "Double LIMIT found" );
                     break;
+                case ML_OFFSET:
+                    if( !*offset )
+                        *offset = tree->value.i;
+                    else
+                        msg_Warn( p_ml, "Double OFFSET found" );
+                    break;
                 case ML_SORT_DESC:
                     *sort = sql_Printf( p_ml->p_sys->p_sql, "%s%s%s DESC ",
                                         sort ? *sort : "", sort ? ", " : "",
@@ -1113,3 +1206,87 @@ parsefail:
 #   undef table_album
 #   undef table_people
 #   undef table_extra
+
+
+/**
+ * @brief Creates the full-text search index if it does not exist yet
+ *
+ * @param p_ml This media_library_t object
+ * @return VLC_SUCCESS if ML_SEARCH can use the index, an error otherwise
+ * @note media_search is an FTS4 table whose docid is the media id. It is
+ * filled from the existing medias when created, then kept up to date by
+ * the add, update and delete functions.
+ */
+int InitSearchIndex( media_library_t *p_ml )
+{
+    static const char *const ppsz_tokenizers[] = { "unicode61", "simple" };
+    char **pp_results = NULL;
+    int i_rows = 0, i_cols = 0;
+    int i_ret;
+
+    p_ml->p_sys->b_search_index = false;
+
+    i_ret = Query( p_ml, &pp_results, &i_rows, &i_cols,
+                   "SELECT name FROM sqlite_master WHERE type = 'table' "
+                   "AND name = 'media_search'" );
+    FreeSQLResult( p_ml, pp_results );
+    if( i_ret != VLC_SUCCESS )
+        return i_ret;
+    if( i_rows > 0 )
+    {
+        p_ml->p_sys->b_search_index = true;
+        return VLC_SUCCESS;
+    }
+
+    Begin( p_ml );
+    i_ret = VLC_EGENERIC;
+    /* unicode61 folds the case of non-ASCII letters, if SQLite has it */
+    for( size_t i = 0; i < sizeof( ppsz_tokenizers ) / sizeof( *ppsz_tokenizers )
+                       && i_ret != VLC_SUCCESS; i++ )
+        i_ret = QuerySimple( p_ml, "CREATE VIRTUAL TABLE media_search "
+                             "USING fts4( title, original_title, album, "
+                             "people, tokenize=%s )", ppsz_tokenizers[i] );
+    if( i_ret == VLC_SUCCESS )
+    {
+        msg_Dbg( p_ml, "building the full-text search index" );
+        p_ml->p_sys->b_search_index = true;
+        i_ret = UpdateSearchIndex( p_ml, NULL );
+    }
+
+    if( i_ret == VLC_SUCCESS )
+        Commit( p_ml );
+    else
+    {
+        Rollback( p_ml );
+        p_ml->p_sys->b_search_index = false;
+        msg_Warn( p_ml, "no full-text search index, searches will be slow" );
+    }
+    return i_ret;
+}
+
+/**
+ * @brief Indexes medias again for the full-text search
+ *
+ * @param p_ml This media_library_t object
+ * @param psz_where Condition on the media table, or NULL for all medias
+ * @return VLC_SUCCESS or VLC_EGENERIC
+ * @note Call it inside the transaction that changes the medias
+ */
+int UpdateSearchIndex( media_library_t *p_ml, const char *psz_where )
+{
+    if( !p_ml->p_sys->b_search_index )
+        return VLC_SUCCESS;
+
+    if( !psz_where )
+    {
+        if( QuerySimple( p_ml, "DELETE FROM media_search" ) != VLC_SUCCESS )
+            return VLC_EGENERIC;
+        return QuerySimple( p_ml, ML_SEARCH_INDEX_INSERT );
+    }
+
+    if( QuerySimple( p_ml, "DELETE FROM media_search WHERE docid IN "
+                     "( SELECT media.id FROM media WHERE %s )",
+                     psz_where ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
+    return QuerySimple( p_ml, ML_SEARCH_INDEX_INSERT "WHERE %s", psz_where );
+}
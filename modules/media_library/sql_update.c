@@ -73,6 +73,22 @@ int Update( media_library_t *p_ml, ml_select_e selected_type,
             != VLC_SUCCESS )
         goto quitdelete;
 
+    /* Index again the medias whose titles, album or people changed */
+    if( p_ml->p_sys->b_search_index )
+    {
+        char *psz_media;
+        if( asprintf( &psz_media,
+                selected_type == ML_ALBUM ? "media.album_id IN ( %s )" :
+                selected_type == ML_PEOPLE ? "media.id IN ( SELECT media_id "
+                    "FROM media_to_people WHERE people_id IN ( %s ) )" :
+                "media.id IN ( %s )", psz_id_query ) == -1 )
+            goto quitdelete;
+        int i_index = UpdateSearchIndex( p_ml, psz_media );
+        free( psz_media );
+        if( i_index != VLC_SUCCESS )
+            goto quitdelete;
+    }
+
     i_ret = VLC_SUCCESS;
 quitdelete:
     if( i_ret != VLC_SUCCESS )
@@ -56,6 +56,11 @@
                                    TAGLIB_MINOR_VERSION, \
                                    TAGLIB_PATCH_VERSION)
 
+#if TAGLIB_VERSION >= VERSION_INT(1,11,0)
+# define TAGLIB_HAVE_FILEREF_IOSTREAM
+# include <tiostream.h>
+#endif
+
 #include <fileref.h>
 #include <tag.h>
 #include <tbytevector.h>
@@ -100,9 +105,15 @@ static vlc_mutex_t taglib_lock = VLC_STATIC_MUTEX;
 static int ReadMeta    ( vlc_object_t * );
 static int WriteMeta   ( vlc_object_t * );
 
+#define FAST_TEXT N_("Read the tags only while preparsing")
+#define FAST_LONGTEXT N_("Do not extract the embedded art while preparsing, " \
+    "the art is extracted when the file is played. This speeds up the " \
+    "scan of large media libraries.")
+
 vlc_module_begin ()
     set_capability( "meta reader", 1000 )
     set_callbacks( ReadMeta, NULL )
+    add_bool( "taglib-fast", false, FAST_TEXT, FAST_LONGTEXT, true )
     add_submodule ()
         set_capability( "meta writer", 50 )
         set_callbacks( WriteMeta, NULL )
@@ -110,6 +121,103 @@ vlc_module_end ()
 
 using namespace TagLib;
 
+#ifdef TAGLIB_HAVE_FILEREF_IOSTREAM
+/**
+ * Read-only TagLib stream on top of the stream of the demuxer, so that the
+ * file is not opened twice
+ */
+class VlcIostream : public IOStream
+{
+public:
+    VlcIostream( stream_t *p_stream, const char *psz_name )
+        : m_stream( p_stream ), m_name( psz_name ),
+          m_start( stream_Tell( p_stream ) ), m_pos( 0 )
+    {
+    }
+
+    ~VlcIostream()
+    {
+        /* Give the demuxer its position back */
+        stream_Seek( m_stream, m_start );
+    }
+
+    FileName name() const
+    {
+        return m_name;
+    }
+
+    ByteVector readBlock( unsigned long length )
+    {
+        ByteVector res( length, 0 );
+        int i_read = stream_Read( m_stream, res.data(), length );
+        if( i_read < 0 )
+            return ByteVector::null;
+        if( (unsigned long)i_read != length )
+            res.resize( i_read );
+        m_pos += i_read;
+        return res;
+    }
+
+    void writeBlock( const ByteVector & )
+    {
+    }
+
+    void insert( const ByteVector &, unsigned long, unsigned long )
+    {
+    }
+
+    void removeBlock( unsigned long, unsigned long )
+    {
+    }
+
+    bool readOnly() const
+    {
+        return true;
+    }
+
+    bool isOpen() const
+    {
+        return true;
+    }
+
+    void seek( long offset, Position p )
+    {
+        int64_t pos = offset;
+        if( p == Current )
+            pos += m_pos;
+        else if( p == End )
+            pos += length();
+
+        if( pos >= 0 && !stream_Seek( m_stream, pos ) )
+            m_pos = pos;
+    }
+
+    void clear()
+    {
+    }
+
+    long tell() const
+    {
+        return m_pos;
+    }
+
+    long length()
+    {
+        return stream_Size( m_stream );
+    }
+
+    void truncate( long )
+    {
+    }
+
+private:
+    stream_t   *m_stream;
+    const char *m_name;
+    int64_t     m_start;
+    int64_t     m_pos;
+};
+#endif
+
 static void ExtractTrackNumberValues( vlc_meta_t* p_meta, const char *psz_value )
 {
     unsigned int i_trknum, i_trktot;
@@ -128,13 +236,15 @@ static void ExtractTrackNumberValues( vlc_meta_t* p_meta, const char *psz_value
  * @param tag: the APE tag
  * @param p_demux_meta: the demuxer meta
  * @param p_meta: the meta
+ * @param b_art: whether to extract the embedded art
  */
-static void ReadMetaFromAPE( APE::Tag* tag, demux_meta_t* p_demux_meta, vlc_meta_t* p_meta )
+static void ReadMetaFromAPE( APE::Tag* tag, demux_meta_t* p_demux_meta, vlc_meta_t* p_meta,
+                             bool b_art )
 {
     APE::Item item;
 
     item = tag->itemListMap()["COVER ART (FRONT)"];
-    if( !item.isEmpty() )
+    if( b_art && !item.isEmpty() )
     {
         input_attachment_t *p_attachment;
 
@@ -242,8 +352,10 @@ static void ReadMetaFromASF( ASF::Tag* tag, demux_meta_t* p_demux_meta, vlc_meta
  * @param tag: the id3v2 tag
  * @param p_demux_meta: the demuxer meta
  * @param p_meta: the meta
+ * @param b_art: whether to extract the embedded art
  */
-static void ReadMetaFromId3v2( ID3v2::Tag* tag, demux_meta_t* p_demux_meta, vlc_meta_t* p_meta )
+static void ReadMetaFromId3v2( ID3v2::Tag* tag, demux_meta_t* p_demux_meta, vlc_meta_t* p_meta,
+                               bool b_art )
 {
     // Get the unique file identifier
     ID3v2::FrameList list = tag->frameListMap()["UFID"];
@@ -335,6 +447,9 @@ static void ReadMetaFromId3v2( ID3v2::Tag* tag, demux_meta_t* p_demux_meta, vlc_
     #define PI_COVER_SCORE_SIZE (sizeof (pi_cover_score) / sizeof (pi_cover_score[0]))
     int i_score = -1;
 
+    if( !b_art )
+        return;
+
     // Try now to get embedded art
     list = tag->frameListMap()[ "APIC" ];
     if( list.isEmpty() )
@@ -421,8 +536,10 @@ static void ReadMetaFromId3v2( ID3v2::Tag* tag, demux_meta_t* p_demux_meta, vlc_
  * @param tag: the Xiph Comment
  * @param p_demux_meta: the demuxer meta
  * @param p_meta: the meta
+ * @param b_art: whether to extract the embedded art
  */
-static void ReadMetaFromXiph( Ogg::XiphComment* tag, demux_meta_t* p_demux_meta, vlc_meta_t* p_meta )
+static void ReadMetaFromXiph( Ogg::XiphComment* tag, demux_meta_t* p_demux_meta, vlc_meta_t* p_meta,
+                              bool b_art )
 {
     StringList list;
 #define SET( keyName, metaName )                                               \
@@ -433,6 +550,9 @@ static void ReadMetaFromXiph( Ogg::XiphComment* tag, demux_meta_t* p_demux_meta,
     SET( "COPYRIGHT", Copyright );
 #undef SET
 
+    if( !b_art )
+        return;
+
     // Try now to get embedded art
     StringList mime_list = tag->fieldListMap()[ "COVERARTMIME" ];
     StringList art_list = tag->fieldListMap()[ "COVERART" ];
@@ -528,12 +648,32 @@ static int ReadMeta( vlc_object_t* p_this)
     demux_meta_t*   p_demux_meta = (demux_meta_t *)p_this;
     demux_t*        p_demux = p_demux_meta->p_demux;
     vlc_meta_t*     p_meta;
-    FileRef f;
 
     p_demux_meta->p_meta = NULL;
     if( strcmp( p_demux->psz_access, "file" ) )
         return VLC_EGENERIC;
 
+    /* The embedded art can wait until the file is played */
+    bool b_art = true;
+    if( var_InheritBool( p_demux, "taglib-fast" ) )
+    {
+        input_thread_t *p_input = demux_GetParentInput( p_demux );
+        if( p_input )
+        {
+            b_art = !p_input->b_preparsing;
+            vlc_object_release( p_input );
+        }
+    }
+
+    /* The audio properties are not used, do not parse the audio data */
+#ifdef TAGLIB_HAVE_FILEREF_IOSTREAM
+    if( !p_demux->s )
+        return VLC_EGENERIC;
+
+    VlcIostream s( p_demux->s, p_demux->psz_file );
+    FileRef f( &s, false );
+#else
+    FileRef f;
     char *psz_path = strdup( p_demux->psz_file );
     if( !psz_path )
         return VLC_ENOMEM;
@@ -545,12 +685,13 @@ static int ReadMeta( vlc_object_t* p_this)
         free( psz_path );
         return VLC_EGENERIC;
     }
-    f = FileRef( wpath );
+    f = FileRef( wpath, false );
     free( wpath );
 #else
-    f = FileRef( psz_path );
+    f = FileRef( psz_path, false );
 #endif
     free( psz_path );
+#endif
 
     if( f.isNull() )
         return VLC_EGENERIC;
@@ -593,14 +734,14 @@ static int ReadMeta( vlc_object_t* p_this)
     if( APE::File* ape = dynamic_cast<APE::File*>(f.file()) )
     {
         if( ape->APETag() )
-            ReadMetaFromAPE( ape->APETag(), p_demux_meta, p_meta );
+            ReadMetaFromAPE( ape->APETag(), p_demux_meta, p_meta, b_art );
     }
     else
 #endif
 #ifdef TAGLIB_HAVE_ASFPICTURE_H
     if( ASF::File* asf = dynamic_cast<ASF::File*>(f.file()) )
     {
-        if( asf->tag() )
+        if( b_art && asf->tag() )
             ReadMetaFromASF( asf->tag(), p_demux_meta, p_meta );
     }
     else
@@ -608,54 +749,54 @@ static int ReadMeta( vlc_object_t* p_this)
     if( FLAC::File* flac = dynamic_cast<FLAC::File*>(f.file()) )
     {
         if( flac->ID3v2Tag() )
-            ReadMetaFromId3v2( flac->ID3v2Tag(), p_demux_meta, p_meta );
+            ReadMetaFromId3v2( flac->ID3v2Tag(), p_demux_meta, p_meta, b_art );
         else if( flac->xiphComment() )
-            ReadMetaFromXiph( flac->xiphComment(), p_demux_meta, p_meta );
+            ReadMetaFromXiph( flac->xiphComment(), p_demux_meta, p_meta, b_art );
     }
 #if defined(TAGLIB_WITH_MP4)
     else if( MP4::File *mp4 = dynamic_cast<MP4::File*>(f.file()) )
     {
-        if( mp4->tag() )
+        if( b_art && mp4->tag() )
             ReadMetaFromMP4( mp4->tag(), p_demux_meta, p_meta );
     }
 #endif
     else if( MPC::File* mpc = dynamic_cast<MPC::File*>(f.file()) )
     {
         if( mpc->APETag() )
-            ReadMetaFromAPE( mpc->APETag(), p_demux_meta, p_meta );
+            ReadMetaFromAPE( mpc->APETag(), p_demux_meta, p_meta, b_art );
     }
     else if( MPEG::File* mpeg = dynamic_cast<MPEG::File*>(f.file()) )
     {
         if( mpeg->ID3v2Tag() )
-            ReadMetaFromId3v2( mpeg->ID3v2Tag(), p_demux_meta, p_meta );
+            ReadMetaFromId3v2( mpeg->ID3v2Tag(), p_demux_meta, p_meta, b_art );
         else if( mpeg->APETag() )
-            ReadMetaFromAPE( mpeg->APETag(), p_demux_meta, p_meta );
+            ReadMetaFromAPE( mpeg->APETag(), p_demux_meta, p_meta, b_art );
     }
     else if( dynamic_cast<Ogg::File*>(f.file()) )
     {
         if( Ogg::FLAC::File* ogg_flac = dynamic_cast<Ogg::FLAC::File*>(f.file()))
-            ReadMetaFromXiph( ogg_flac->tag(), p_demux_meta, p_meta );
+            ReadMetaFromXiph( ogg_flac->tag(), p_demux_meta, p_meta, b_art );
         else if( Ogg::Speex::File* ogg_speex = dynamic_cast<Ogg::Speex::File*>(f.file()) )
-            ReadMetaFromXiph( ogg_speex->tag(), p_demux_meta, p_meta );
+            ReadMetaFromXiph( ogg_speex->tag(), p_demux_meta, p_meta, b_art );
         else if( Ogg::Vorbis::File* ogg_vorbis = dynamic_cast<Ogg::Vorbis::File*>(f.file()) )
-            ReadMetaFromXiph( ogg_vorbis->tag(), p_demux_meta, p_meta );
+            ReadMetaFromXiph( ogg_vorbis->tag(), p_demux_meta, p_meta, b_art );
     }
     else if( dynamic_cast<RIFF::File*>(f.file()) )
     {
         if( RIFF::AIFF::File* riff_aiff = dynamic_cast<RIFF::AIFF::File*>(f.file()) )
-            ReadMetaFromId3v2( riff_aiff->tag(), p_demux_meta, p_meta );
+            ReadMetaFromId3v2( riff_aiff->tag(), p_demux_meta, p_meta, b_art );
         else if( RIFF::WAV::File* riff_wav = dynamic_cast<RIFF::WAV::File*>(f.file()) )
-            ReadMetaFromId3v2( riff_wav->tag(), p_demux_meta, p_meta );
+            ReadMetaFromId3v2( riff_wav->tag(), p_demux_meta, p_meta, b_art );
     }
     else if( TrueAudio::File* trueaudio = dynamic_cast<TrueAudio::File*>(f.file()) )
     {
         if( trueaudio->ID3v2Tag() )
-            ReadMetaFromId3v2( trueaudio->ID3v2Tag(), p_demux_meta, p_meta );
+            ReadMetaFromId3v2( trueaudio->ID3v2Tag(), p_demux_meta, p_meta, b_art );
     }
     else if( WavPack::File* wavpack = dynamic_cast<WavPack::File*>(f.file()) )
     {
         if( wavpack->APETag() )
-            ReadMetaFromAPE( wavpack->APETag(), p_demux_meta, p_meta );
+            ReadMetaFromAPE( wavpack->APETag(), p_demux_meta, p_meta, b_art );
     }
 
     return VLC_SUCCESS;
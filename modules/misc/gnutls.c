@@ -183,10 +183,119 @@ static int gnutls_Error (vlc_object_t *obj, int val)
 struct vlc_tls_sys
 {
     gnutls_session_t session;
+    char *host; /* client only, for session resumption */
     bool handshaked;
+    bool resumable;
 };
 
 
+/*
+ * Client session cache.
+ * Credentials are often created for a single connection (e.g. one HTTP
+ * request per HLS segment), so the cache is process-wide rather than per
+ * credentials. It lives for as long as the plugin is loaded.
+ */
+#define SESSION_CACHE_MAX 16
+#define SESSION_CACHE_TTL (CLOCK_FREQ * 300)
+
+static struct
+{
+    char *host;
+    gnutls_datum_t data;
+    mtime_t date;
+} session_cache[SESSION_CACHE_MAX];
+static vlc_mutex_t session_lock = VLC_STATIC_MUTEX;
+
+static void gnutls_SessionCacheClear (unsigned i)
+{
+    free (session_cache[i].host);
+    gnutls_free (session_cache[i].data.data);
+    session_cache[i].host = NULL;
+    session_cache[i].data.data = NULL;
+    session_cache[i].data.size = 0;
+}
+
+/**
+ * Looks up the session cache, and sets up resumption if the server was
+ * connected to recently.
+ */
+static void gnutls_SessionLoad (vlc_tls_t *session)
+{
+    vlc_tls_sys_t *sys = session->sys;
+    const mtime_t now = mdate ();
+    bool found = false;
+
+    vlc_mutex_lock (&session_lock);
+    for (unsigned i = 0; i < SESSION_CACHE_MAX; i++)
+    {
+        if (session_cache[i].host == NULL)
+            continue;
+        if (session_cache[i].date + SESSION_CACHE_TTL < now)
+            gnutls_SessionCacheClear (i);
+        else
+        if (!found && !strcasecmp (session_cache[i].host, sys->host))
+            found = !gnutls_session_set_data (sys->session,
+                                              session_cache[i].data.data,
+                                              session_cache[i].data.size);
+    }
+    vlc_mutex_unlock (&session_lock);
+}
+
+/**
+ * Stores the session parameters in the cache, replacing any older session
+ * with the same server, or else the oldest session.
+ */
+static void gnutls_SessionSave (vlc_tls_t *session)
+{
+    vlc_tls_sys_t *sys = session->sys;
+    gnutls_datum_t data;
+
+    if (gnutls_session_get_data2 (sys->session, &data))
+        return;
+
+    char *host = strdup (sys->host);
+    if (unlikely(host == NULL))
+    {
+        gnutls_free (data.data);
+        return;
+    }
+
+    vlc_mutex_lock (&session_lock);
+    unsigned slot = 0;
+    for (unsigned i = 0; i < SESSION_CACHE_MAX; i++)
+    {
+        if (session_cache[i].host != NULL
+         && !strcasecmp (session_cache[i].host, host))
+        {
+            slot = i;
+            break;
+        }
+        if (session_cache[i].date < session_cache[slot].date)
+            slot = i;
+    }
+    gnutls_SessionCacheClear (slot);
+    session_cache[slot].host = host;
+    session_cache[slot].data = data;
+    session_cache[slot].date = mdate ();
+    vlc_mutex_unlock (&session_lock);
+}
+
+/**
+ * Tells whether the session was carried over from a TLS 1.3 handshake.
+ * Such sessions can only be saved once the server has sent a ticket, that
+ * is after some application data was received.
+ */
+static bool gnutls_SessionIsTLS13 (gnutls_session_t session)
+{
+#if (GNUTLS_VERSION_NUMBER >= 0x030603)
+    return gnutls_protocol_get_version (session) == GNUTLS_TLS1_3;
+#else
+    (void) session;
+    return false;
+#endif
+}
+
+
 /**
  * Sends data through a TLS session.
  */
@@ -431,6 +540,24 @@ error:
     return val;
 }
 
+static int gnutls_ClientHandshake (vlc_tls_t *session, const char *host,
+                                   const char *service)
+{
+    vlc_tls_sys_t *sys = session->sys;
+
+    int val = gnutls_HandshakeAndValidate (session, host, service);
+    if (val || sys->host == NULL)
+        return val;
+
+    if (gnutls_session_is_resumed (sys->session))
+        msg_Dbg (session, "TLS session resumed");
+    /* Only validated sessions can be resumed */
+    sys->resumable = true;
+    if (!gnutls_SessionIsTLS13 (sys->session))
+        gnutls_SessionSave (session);
+    return 0;
+}
+
 static int
 gnutls_SessionPrioritize (vlc_object_t *obj, gnutls_session_t session)
 {
@@ -460,6 +587,7 @@ struct vlc_tls_creds_sys
 {
     gnutls_certificate_credentials_t x509_cred;
     gnutls_dh_params_t dh_params; /* XXX: used for server only */
+    gnutls_datum_t ticket_key; /* XXX: used for server only */
     int (*handshake) (vlc_tls_t *, const char *, const char *);
         /* ^^ XXX: useful for server only */
 };
@@ -473,10 +601,20 @@ static void gnutls_SessionClose (vlc_tls_creds_t *crd, vlc_tls_t *session)
 {
     vlc_tls_sys_t *sys = session->sys;
 
+    if (sys->resumable && gnutls_SessionIsTLS13 (sys->session))
+    {
+#if (GNUTLS_VERSION_NUMBER >= 0x030603)
+        if (gnutls_session_get_flags (sys->session)
+                                             & GNUTLS_SFLAGS_SESSION_TICKET)
+#endif
+            gnutls_SessionSave (session);
+    }
+
     if (sys->handshaked)
         gnutls_bye (sys->session, GNUTLS_SHUT_WR);
     gnutls_deinit (sys->session);
 
+    free (sys->host);
     free (sys);
     (void) crd;
 }
@@ -497,7 +635,9 @@ static int gnutls_SessionOpen (vlc_tls_creds_t *crd, vlc_tls_t *session,
     session->sock.pf_send = gnutls_Send;
     session->sock.pf_recv = gnutls_Recv;
     session->handshake = crd->sys->handshake;
+    sys->host = NULL;
     sys->handshaked = false;
+    sys->resumable = false;
 
     int val = gnutls_init (&sys->session, type);
     if (val != 0)
@@ -539,6 +679,10 @@ static int gnutls_ServerSessionOpen (vlc_tls_creds_t *crd, vlc_tls_t *session,
     if (session->handshake == gnutls_HandshakeAndValidate)
         gnutls_certificate_server_set_request (session->sys->session,
                                                GNUTLS_CERT_REQUIRE);
+    /* let returning clients skip the full handshake */
+    if (crd->sys->ticket_key.data != NULL)
+        gnutls_session_ticket_enable_server (session->sys->session,
+                                             &crd->sys->ticket_key);
     assert (hostname == NULL);
     return VLC_SUCCESS;
 }
@@ -546,7 +690,13 @@ static int gnutls_ServerSessionOpen (vlc_tls_creds_t *crd, vlc_tls_t *session,
 static int gnutls_ClientSessionOpen (vlc_tls_creds_t *crd, vlc_tls_t *session,
                                      int fd, const char *hostname)
 {
-    int val = gnutls_SessionOpen (crd, session, GNUTLS_CLIENT, fd);
+    int type = GNUTLS_CLIENT;
+#ifdef GNUTLS_ENABLE_FALSE_START
+    /* Send the request before the server Finished message is received,
+     * saving one round-trip on full handshakes. */
+    type |= GNUTLS_ENABLE_FALSE_START;
+#endif
+    int val = gnutls_SessionOpen (crd, session, type, fd);
     if (val != VLC_SUCCESS)
         return val;
 
@@ -556,10 +706,16 @@ static int gnutls_ClientSessionOpen (vlc_tls_creds_t *crd, vlc_tls_t *session,
     gnutls_dh_set_prime_bits (sys->session, 1024);
 
     if (likely(hostname != NULL))
+    {
         /* fill Server Name Indication */
         gnutls_server_name_set (sys->session, GNUTLS_NAME_DNS,
                                 hostname, strlen (hostname));
 
+        sys->host = strdup (hostname);
+        if (likely(sys->host != NULL))
+            gnutls_SessionLoad (session);
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -725,6 +881,14 @@ static int OpenServer (vlc_tls_creds_t *crd, const char *cert, const char *key)
                  gnutls_strerror (val));
     }
 
+    val = gnutls_session_ticket_key_generate (&sys->ticket_key);
+    if (val < 0)
+    {
+        msg_Warn (crd, "cannot generate session ticket key: %s",
+                  gnutls_strerror (val));
+        sys->ticket_key.data = NULL;
+    }
+
     return VLC_SUCCESS;
 
 error:
@@ -743,6 +907,7 @@ static void CloseServer (vlc_tls_creds_t *crd)
     /* all sessions depending on the server are now deinitialized */
     gnutls_certificate_free_credentials (sys->x509_cred);
     gnutls_dh_params_deinit (sys->dh_params);
+    gnutls_free (sys->ticket_key.data);
     free (sys);
 
     gnutls_Deinit (VLC_OBJECT(crd));
@@ -765,7 +930,7 @@ static int OpenClient (vlc_tls_creds_t *crd)
     //crd->add_CRL = gnutls_AddCRL;
     crd->open = gnutls_ClientSessionOpen;
     crd->close = gnutls_SessionClose;
-    sys->handshake = gnutls_HandshakeAndValidate;
+    sys->handshake = gnutls_ClientHandshake;
 
     int val = gnutls_certificate_allocate_credentials (&sys->x509_cred);
     if (val != 0)
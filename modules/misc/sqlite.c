@@ -584,7 +584,7 @@ static int StatementStep( sql_t* p_sql, sql_stmt_t* p_stmt )
     int i_ret = VLC_EGENERIC;
     if( i_sqlret == SQLITE_ROW )
         i_ret = VLC_SQL_ROW;
-    else if( i_ret == SQLITE_DONE )
+    else if( i_sqlret == SQLITE_DONE )
         i_ret = VLC_SQL_DONE;
     else
     {
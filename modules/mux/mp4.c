@@ -48,6 +48,24 @@
     "Create \"Fast Start\" files. " \
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
+#define RESERVE_TEXT N_("Reserved index duration (s)")
+#define RESERVE_LONGTEXT N_( \
+    "Reserve room for the index of a recording of up to this duration " \
+    "before the data. If the index fits when the file is closed, " \
+    "\"Fast Start\" files are created without moving any data.")
+#define FRAGMENTED_TEXT N_("Create fragmented files")
+#define FRAGMENTED_LONGTEXT N_( \
+    "Write the samples in movie fragments, each with its own index, " \
+    "instead of indexing the whole file when it is closed. " \
+    "The file stays playable if the recording is interrupted.")
+#define FRAGDURATION_TEXT N_("Fragment duration (ms)")
+#define FRAGDURATION_LONGTEXT N_( \
+    "Minimum duration of a movie fragment. Fragments start on a video " \
+    "keyframe when there is a video track.")
+#define MFRA_TEXT N_("Write a fragment random access index")
+#define MFRA_LONGTEXT N_( \
+    "Append a random access index of the fragments to the end of " \
+    "fragmented files, for faster seeking.")
 
 static int  Open   ( vlc_object_t * );
 static void Close  ( vlc_object_t * );
@@ -63,6 +81,18 @@ vlc_module_begin ()
     add_bool( SOUT_CFG_PREFIX "faststart", true,
               FASTSTART_TEXT, FASTSTART_LONGTEXT,
               true )
+    add_integer( SOUT_CFG_PREFIX "faststart-reserve", 0,
+                 RESERVE_TEXT, RESERVE_LONGTEXT,
+                 true )
+    add_bool( SOUT_CFG_PREFIX "fragmented", false,
+              FRAGMENTED_TEXT, FRAGMENTED_LONGTEXT,
+              true )
+    add_integer( SOUT_CFG_PREFIX "frag-duration", 2000,
+                 FRAGDURATION_TEXT, FRAGDURATION_LONGTEXT,
+                 true )
+    add_bool( SOUT_CFG_PREFIX "mfra", true,
+              MFRA_TEXT, MFRA_LONGTEXT,
+              true )
     set_capability( "sout mux", 5 )
     add_shortcut( "mp4", "mov", "3gp" )
     set_callbacks( Open, Close )
@@ -72,7 +102,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "faststart", NULL
+    "faststart", "faststart-reserve", "fragmented", "frag-duration", "mfra", NULL
 };
 
 static int Control( sout_mux_t *, int, va_list );
@@ -94,10 +124,20 @@ typedef struct
 
 } mp4_entry_t;
 
+/* Random access point of a fragmented file */
+typedef struct
+{
+    uint64_t i_time;     /* decoding time, in the track timescale */
+    uint64_t i_moof_pos;
+    uint8_t  i_traf;     /* traf number of the track in the moof */
+
+} mp4_tfra_entry_t;
+
 typedef struct
 {
     es_format_t   fmt;
     int           i_track_id;
+    uint32_t      i_timescale;
 
     /* index */
     unsigned int i_entry_count;
@@ -116,6 +156,18 @@ typedef struct
     /* for spu */
     int64_t i_last_dts;
 
+    /* for fragmented files: the index only covers the current fragment */
+    bool     b_frag_started;
+    block_t  *p_frag_data;  /* samples of the current fragment */
+    block_t  **pp_frag_last;
+    int64_t  i_frag_dts;    /* decoding time of the fragment */
+    int64_t  i_frag_dts_q;  /* the same, in the track timescale */
+    int      i_trun_pos;    /* data offset position in the moof */
+    uint32_t i_trun_data;   /* data offset in the mdat */
+
+    unsigned int     i_tfra_count;
+    mp4_tfra_entry_t *tfra;
+
 } mp4_stream_t;
 
 struct sout_mux_sys_t
@@ -124,6 +176,20 @@ struct sout_mux_sys_t
     bool b_3gp;
     bool b_64_ext;
     bool b_fast_start;
+    bool b_header_sent;     /* mdat header, or moov if fragmented */
+
+    /* space reserved for the moov before the mdat */
+    int64_t  i_reserve_duration;
+    uint64_t i_reserve_pos;
+    uint64_t i_reserve_size;
+
+    /* fragmented files */
+    bool b_fragmented;
+    bool b_mfra;
+    mtime_t  i_frag_duration;
+    mtime_t  i_frag_start;
+    uint32_t i_frag_seq;
+    mp4_stream_t *p_sync_stream; /* fragments start with its sync samples */
 
     uint64_t i_mdat_pos;
     uint64_t i_pos;
@@ -172,6 +238,12 @@ static bo_t *GetMoovBox( sout_mux_t *p_mux );
 static block_t *ConvertSUBT( block_t *);
 static block_t *ConvertAVC1( block_t * );
 
+static void MdatHeader( sout_mux_t * );
+static void FragmentHeader( sout_mux_t * );
+static void FragmentAdd( sout_mux_t *, mp4_stream_t *, block_t * );
+static void FragmentFlush( sout_mux_t * );
+static void FragmentClose( sout_mux_t * );
+
 /*****************************************************************************
  * Open:
  *****************************************************************************/
@@ -199,30 +271,130 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_3gp        = p_mux->psz_mux && !strcmp( p_mux->psz_mux, "3gp" );
     p_sys->i_dts_start  = 0;
 
+    p_sys->b_fragmented = var_GetBool( p_mux, SOUT_CFG_PREFIX "fragmented" );
+    p_sys->b_mfra = var_GetBool( p_mux, SOUT_CFG_PREFIX "mfra" );
+    p_sys->b_header_sent = false;
+    p_sys->i_reserve_duration =
+        var_GetInteger( p_mux, SOUT_CFG_PREFIX "faststart-reserve" );
+    p_sys->i_reserve_pos = 0;
+    p_sys->i_reserve_size = 0;
+    p_sys->i_frag_duration =
+        __MAX( var_GetInteger( p_mux, SOUT_CFG_PREFIX "frag-duration" ), 1 )
+        * 1000;
+    p_sys->i_frag_start = VLC_TS_INVALID;
+    p_sys->i_frag_seq   = 0;
+    p_sys->p_sync_stream = NULL;
 
     if( !p_sys->b_mov )
     {
         /* Now add ftyp header */
         box = box_new( "ftyp" );
         if( p_sys->b_3gp ) bo_add_fourcc( box, "3gp6" );
+        else if( p_sys->b_fragmented ) bo_add_fourcc( box, "iso6" );
         else bo_add_fourcc( box, "isom" );
         bo_add_32be  ( box, 0 );
         if( p_sys->b_3gp ) bo_add_fourcc( box, "3gp4" );
         else bo_add_fourcc( box, "mp41" );
         bo_add_fourcc( box, "avc1" );
-        bo_add_fourcc( box, "qt  " );
+        if( p_sys->b_fragmented )
+        {
+            bo_add_fourcc( box, "iso6" );
+            bo_add_fourcc( box, "dash" );
+        }
+        else
+            bo_add_fourcc( box, "qt  " );
         box_fix( box );
 
         p_sys->i_pos += box->i_buffer;
         p_sys->i_mdat_pos = p_sys->i_pos;
 
-        box_send( p_mux, box );
+        if( p_sys->b_fragmented )
+        {
+            /* Part of the initialization segment, with the moov */
+            block_t *p_hdr = bo_to_sout( box );
+            box_free( box );
+            p_hdr->i_flags |= BLOCK_FLAG_HEADER;
+            sout_AccessOutWrite( p_mux->p_access, p_hdr );
+        }
+        else
+            box_send( p_mux, box );
     }
 
     /* FIXME FIXME
      * Quicktime actually doesn't like the 64 bits extensions !!! */
     p_sys->b_64_ext = false;
 
+    /* The samples are written in movie fragments, with their own mdat */
+    if( p_sys->b_fragmented )
+        return VLC_SUCCESS;
+
+    /* The reserved space depends on the streams, wait for them */
+    if( p_sys->i_reserve_duration <= 0 )
+        MdatHeader( p_mux );
+
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * MdatHeader: reserves the moov space if requested, then opens the mdat
+ *****************************************************************************/
+static uint64_t EstimateMoovSize( sout_mux_t *p_mux, int64_t i_duration )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    uint64_t i_size = 1024; /* mvhd, udta */
+
+    for( int i = 0; i < p_sys->i_nb_streams; i++ )
+    {
+        const es_format_t *p_fmt = &p_sys->pp_streams[i]->fmt;
+        uint64_t i_rate; /* samples per second */
+
+        if( p_fmt->i_cat == VIDEO_ES )
+            i_rate = p_fmt->video.i_frame_rate_base > 0 ?
+                     p_fmt->video.i_frame_rate / p_fmt->video.i_frame_rate_base
+                     + 1 : 60;
+        else if( p_fmt->i_codec == VLC_CODEC_AMR_NB ||
+                 p_fmt->i_codec == VLC_CODEC_AMR_WB )
+            i_rate = 50;
+        else if( p_fmt->i_cat == AUDIO_ES )
+            i_rate = p_fmt->audio.i_rate / 1024 + 1;
+        else
+            i_rate = 2; /* subtitles and the empty ones after them */
+
+        /* Worst case of one chunk per sample: stsz, stts, co64, stsc and
+         * stss entries, plus the sample description */
+        i_size += 1024 + p_fmt->i_extra + i_rate * i_duration * 36;
+    }
+    return i_size;
+}
+
+static void MdatHeader( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    bo_t *box;
+
+    if( p_sys->i_reserve_duration > 0 )
+    {
+        p_sys->i_reserve_pos  = p_sys->i_pos;
+        p_sys->i_reserve_size = EstimateMoovSize( p_mux,
+                                                  p_sys->i_reserve_duration );
+        msg_Dbg( p_mux, "reserving %"PRIu64" bytes for the moov",
+                 p_sys->i_reserve_size );
+
+        /* Covered by the moov and a free box when closing */
+        block_t *p_free = block_Alloc( p_sys->i_reserve_size );
+        if( p_free != NULL )
+        {
+            memset( p_free->p_buffer, 0, p_free->i_buffer );
+            SetDWBE( p_free->p_buffer, p_free->i_buffer );
+            memcpy( &p_free->p_buffer[4], "free", 4 );
+            p_sys->i_pos += p_free->i_buffer;
+            p_sys->i_mdat_pos = p_sys->i_pos;
+            sout_AccessOutWrite( p_mux->p_access, p_free );
+        }
+        else
+            p_sys->i_reserve_size = 0;
+    }
+
     /* Now add mdat header */
     box = box_new( "mdat" );
     bo_add_64be  ( box, 0 ); // enough to store an extended size
@@ -230,8 +402,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_pos += box->i_buffer;
 
     box_send( p_mux, box );
-
-    return VLC_SUCCESS;
+    p_sys->b_header_sent = true;
 }
 
 /*****************************************************************************
@@ -250,6 +421,14 @@ static void Close( vlc_object_t * p_this )
 
     msg_Dbg( p_mux, "Close" );
 
+    if( p_sys->b_fragmented )
+    {
+        FragmentClose( p_mux );
+        goto clean;
+    }
+    if( !p_sys->b_header_sent )
+        MdatHeader( p_mux );
+
     /* Update mdat size */
     bo_init( &bo, 0, NULL, true );
     if( p_sys->i_pos - p_sys->i_mdat_pos >= (((uint64_t)1)<<32) )
@@ -279,6 +458,22 @@ static void Close( vlc_object_t * p_this )
     /* Check we need to create "fast start" files */
     var_Get( p_this, SOUT_CFG_PREFIX "faststart", &val );
     p_sys->b_fast_start = val.b_bool;
+
+    /* The moov can go to the reserved space, with a free box after it */
+    uint64_t i_free_size = 0;
+    if( p_sys->i_reserve_size > 0 )
+    {
+        if( (uint64_t)moov->i_buffer == p_sys->i_reserve_size ||
+            (uint64_t)moov->i_buffer + 8 <= p_sys->i_reserve_size )
+        {
+            i_free_size = p_sys->i_reserve_size - moov->i_buffer;
+            i_moov_pos = p_sys->i_reserve_pos;
+            p_sys->b_fast_start = false;
+        }
+        else
+            msg_Warn( p_this, "reserved space too small for the moov "
+                      "(%d bytes needed)", moov->i_buffer );
+    }
     while( p_sys->b_fast_start )
     {
         /* Move data to the end of the file so we can fit the moov header
@@ -348,12 +543,26 @@ static void Close( vlc_object_t * p_this )
     sout_AccessOutSeek( p_mux->p_access, i_moov_pos );
     box_send( p_mux, moov );
 
+    /* Mark the rest of the reserved space as free */
+    if( i_free_size > 0 )
+    {
+        bo_init( &bo, 0, NULL, true );
+        bo_add_32be  ( &bo, i_free_size );
+        bo_add_fourcc( &bo, "free" );
+        p_hdr = bo_to_sout( &bo );
+        free( bo.p_buffer );
+        sout_AccessOutWrite( p_mux->p_access, p_hdr );
+    }
+
+clean:
     /* Clean-up */
     for( i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
     {
         mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
 
         es_format_Clean( &p_stream->fmt );
+        block_ChainRelease( p_stream->p_frag_data );
+        free( p_stream->tfra );
         free( p_stream->entry );
         free( p_stream );
     }
@@ -366,8 +575,8 @@ static void Close( vlc_object_t * p_this )
  *****************************************************************************/
 static int Control( sout_mux_t *p_mux, int i_query, va_list args )
 {
-    VLC_UNUSED(p_mux);
     bool *pb_bool;
+    char **ppsz;
 
     switch( i_query )
     {
@@ -381,7 +590,13 @@ static int Control( sout_mux_t *p_mux, int i_query, va_list args )
             *pb_bool = true;
             return VLC_SUCCESS;
 
-        case MUX_GET_MIME:   /* Not needed, as not streamable */
+        case MUX_GET_MIME:   /* Only fragmented files are streamable */
+            if( !p_mux->p_sys->b_fragmented )
+                return VLC_EGENERIC;
+            ppsz = (char**)va_arg( args, char ** );
+            *ppsz = strdup( "video/mp4" );
+            return VLC_SUCCESS;
+
         default:
             return VLC_EGENERIC;
     }
@@ -413,6 +628,12 @@ static int AddStream( sout_mux_t *p_mux, sout_input_t *p_input )
         case VLC_CODEC_YUYV:
             break;
         case VLC_CODEC_SUBT:
+            if( p_sys->b_fragmented )
+            {
+                msg_Err( p_mux, "subtitles are not supported in fragmented "
+                         "files" );
+                return VLC_EGENERIC;
+            }
             msg_Warn( p_mux, "subtitle track added like in .mov (even when creating .mp4)" );
             break;
         default:
@@ -426,6 +647,10 @@ static int AddStream( sout_mux_t *p_mux, sout_input_t *p_input )
         return VLC_ENOMEM;
     es_format_Copy( &p_stream->fmt, p_input->p_fmt );
     p_stream->i_track_id    = p_sys->i_nb_streams + 1;
+    if( p_stream->fmt.i_cat == AUDIO_ES )
+        p_stream->i_timescale = p_stream->fmt.audio.i_rate;
+    else
+        p_stream->i_timescale = 1001;
     p_stream->i_length_neg  = 0;
     p_stream->i_entry_count = 0;
     p_stream->i_entry_max   = 1000;
@@ -433,6 +658,13 @@ static int AddStream( sout_mux_t *p_mux, sout_input_t *p_input )
         calloc( p_stream->i_entry_max, sizeof( mp4_entry_t ) );
     p_stream->i_dts_start   = 0;
     p_stream->i_duration    = 0;
+    p_stream->b_frag_started = false;
+    p_stream->p_frag_data   = NULL;
+    p_stream->pp_frag_last  = &p_stream->p_frag_data;
+    p_stream->i_frag_dts    = 0;
+    p_stream->i_frag_dts_q  = 0;
+    p_stream->i_tfra_count  = 0;
+    p_stream->tfra          = NULL;
 
     p_input->p_sys          = p_stream;
 
@@ -475,6 +707,14 @@ static int Mux( sout_mux_t *p_mux )
         p_input  = p_mux->pp_inputs[i_stream];
         p_stream = (mp4_stream_t*)p_input->p_sys;
 
+        if( !p_sys->b_header_sent )
+        {
+            if( p_sys->b_fragmented )
+                FragmentHeader( p_mux );
+            else
+                MdatHeader( p_mux );
+        }
+
 again:
         p_data  = block_FifoGet( p_input->p_fifo );
         if( p_stream->fmt.i_codec == VLC_CODEC_H264 )
@@ -515,6 +755,12 @@ again:
             }
         }
 
+        if( p_sys->b_fragmented )
+        {
+            FragmentAdd( p_mux, p_stream, p_data );
+            continue;
+        }
+
         /* Save starting time */
         if( p_stream->i_entry_count == 0 )
         {
@@ -614,6 +860,283 @@ again:
     return( VLC_SUCCESS );
 }
 
+/*****************************************************************************
+ * Fragmented files: moov without samples, then moof/mdat pairs
+ *****************************************************************************/
+static bool IsSyncSample( const mp4_stream_t *p_stream, unsigned int i_flags )
+{
+    return p_stream->fmt.i_cat != VIDEO_ES ||
+           !(i_flags & (BLOCK_FLAG_TYPE_P|BLOCK_FLAG_TYPE_B|BLOCK_FLAG_TYPE_PB));
+}
+
+static void FragmentHeader( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    for( int i = 0; i < p_sys->i_nb_streams; i++ )
+    {
+        if( p_sys->pp_streams[i]->fmt.i_cat == VIDEO_ES )
+        {
+            p_sys->p_sync_stream = p_sys->pp_streams[i];
+            break;
+        }
+    }
+
+    bo_t *moov = GetMoovBox( p_mux );
+    block_t *p_hdr = bo_to_sout( moov );
+    box_free( moov );
+
+    p_hdr->i_flags |= BLOCK_FLAG_HEADER;
+    p_sys->i_pos += p_hdr->i_buffer;
+    sout_AccessOutWrite( p_mux->p_access, p_hdr );
+    p_sys->b_header_sent = true;
+}
+
+static void FragmentAdd( sout_mux_t *p_mux, mp4_stream_t *p_stream,
+                         block_t *p_data )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    /* Save starting time: the first sample muxed is the earliest one */
+    if( !p_stream->b_frag_started )
+    {
+        if( p_sys->i_dts_start <= 0 )
+            p_sys->i_dts_start = p_data->i_dts;
+        p_stream->i_dts_start = p_data->i_dts;
+        p_stream->i_frag_dts =
+            __MAX( p_data->i_dts - p_sys->i_dts_start, 0 );
+        p_stream->i_frag_dts_q = p_stream->i_frag_dts *
+            (int64_t)p_stream->i_timescale / INT64_C(1000000);
+        p_stream->b_frag_started = true;
+    }
+
+    /* Start a new fragment on a sync sample, unless there is none */
+    if( p_sys->i_frag_start > VLC_TS_INVALID )
+    {
+        const mtime_t i_elapsed = p_data->i_dts - p_sys->i_frag_start;
+
+        if( ( i_elapsed >= p_sys->i_frag_duration &&
+              ( p_sys->p_sync_stream == NULL ||
+                ( p_sys->p_sync_stream == p_stream &&
+                  IsSyncSample( p_stream, p_data->i_flags ) ) ) ) ||
+            i_elapsed >= 4 * p_sys->i_frag_duration )
+            FragmentFlush( p_mux );
+    }
+    if( p_sys->i_frag_start <= VLC_TS_INVALID )
+        p_sys->i_frag_start = p_data->i_dts;
+
+    /* add index entry */
+    mp4_entry_t *p_entry = &p_stream->entry[p_stream->i_entry_count];
+    p_entry->i_pos     = 0;
+    p_entry->i_size    = p_data->i_buffer;
+    p_entry->i_pts_dts = __MAX( p_data->i_pts - p_data->i_dts, 0 );
+    p_entry->i_length  = p_data->i_length;
+    p_entry->i_flags   = p_data->i_flags;
+
+    p_stream->i_entry_count++;
+    if( p_stream->i_entry_count >= p_stream->i_entry_max - 1 )
+    {
+        p_stream->i_entry_max += 1000;
+        p_stream->entry = xrealloc( p_stream->entry,
+                     p_stream->i_entry_max * sizeof( mp4_entry_t ) );
+    }
+
+    p_stream->i_duration = p_data->i_dts - p_stream->i_dts_start +
+                           p_data->i_length;
+    p_stream->i_last_dts = p_data->i_dts;
+
+    /* The data is written after the moof indexing it */
+    block_ChainLastAppend( &p_stream->pp_frag_last, p_data );
+}
+
+static void FragmentFlush( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    uint64_t i_data_size = 0;
+    uint8_t  i_traf = 0;
+
+    bo_t *moof = box_new( "moof" );
+
+    bo_t *mfhd = box_full_new( "mfhd", 0, 0 );
+    bo_add_32be( mfhd, ++p_sys->i_frag_seq );   // sequence-number
+    box_fix( mfhd );
+    box_gather( moof, mfhd );
+
+    for( int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
+    {
+        mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
+        const int64_t i_timescale = p_stream->i_timescale;
+        bool b_ctts = false;
+
+        if( p_stream->i_entry_count == 0 )
+            continue;
+        i_traf++;
+
+        if( p_sys->b_mfra &&
+            IsSyncSample( p_stream, p_stream->entry[0].i_flags ) )
+        {
+            p_stream->tfra = xrealloc( p_stream->tfra,
+                ( p_stream->i_tfra_count + 1 ) * sizeof( mp4_tfra_entry_t ) );
+            p_stream->tfra[p_stream->i_tfra_count].i_time =
+                p_stream->i_frag_dts_q;
+            p_stream->tfra[p_stream->i_tfra_count].i_moof_pos = p_sys->i_pos;
+            p_stream->tfra[p_stream->i_tfra_count].i_traf = i_traf;
+            p_stream->i_tfra_count++;
+        }
+
+        bo_t *traf = box_new( "traf" );
+
+        /* default-base-is-moof */
+        bo_t *tfhd = box_full_new( "tfhd", 0, 0x020000 );
+        bo_add_32be( tfhd, p_stream->i_track_id );
+        box_fix( tfhd );
+        box_gather( traf, tfhd );
+
+        bo_t *tfdt = box_full_new( "tfdt", 1, 0 );
+        bo_add_64be( tfdt, p_stream->i_frag_dts_q ); // base-media-decode-time
+        box_fix( tfdt );
+        box_gather( traf, tfdt );
+
+        for( unsigned int i = 0; i < p_stream->i_entry_count; i++ )
+            b_ctts |= p_stream->entry[i].i_pts_dts > 0;
+
+        /* data-offset, sample duration, size, flags and maybe cts offset */
+        bo_t *trun = box_full_new( "trun", 0,
+                                   0x000701 | (b_ctts ? 0x000800 : 0) );
+        bo_add_32be( trun, p_stream->i_entry_count );
+        p_stream->i_trun_pos = moof->i_buffer + traf->i_buffer + 16;
+        p_stream->i_trun_data = i_data_size;
+        bo_add_32be( trun, 0 );     // data-offset (fixed later)
+
+        for( unsigned int i = 0; i < p_stream->i_entry_count; i++ )
+        {
+            const mp4_entry_t *p_entry = &p_stream->entry[i];
+
+            /* quantify the length without drifting */
+            int64_t i_dts_deq = p_stream->i_frag_dts_q * INT64_C(1000000) /
+                                i_timescale;
+            int64_t i_delta = p_entry->i_length + p_stream->i_frag_dts -
+                              i_dts_deq;
+            int64_t i_length_q = i_delta * i_timescale / INT64_C(1000000);
+
+            p_stream->i_frag_dts += p_entry->i_length;
+            p_stream->i_frag_dts_q += i_length_q;
+
+            bo_add_32be( trun, i_length_q );        // sample-duration
+            bo_add_32be( trun, p_entry->i_size );   // sample-size
+            if( IsSyncSample( p_stream, p_entry->i_flags ) )
+                bo_add_32be( trun, 0x02000000 );    // depends on no other
+            else
+                bo_add_32be( trun, 0x01010000 );    // non sync sample
+            if( b_ctts )
+                bo_add_32be( trun, p_entry->i_pts_dts * i_timescale /
+                                   INT64_C(1000000) );
+            i_data_size += p_entry->i_size;
+        }
+        box_fix( trun );
+        box_gather( traf, trun );
+
+        box_fix( traf );
+        box_gather( moof, traf );
+    }
+    box_fix( moof );
+
+    /* Point each trun to its samples, the moof is the base */
+    const bool b_large = i_data_size + 8 >= (((uint64_t)1)<<32);
+    const int i_mdat_header = b_large ? 16 : 8;
+
+    for( int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
+    {
+        mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
+
+        if( p_stream->i_entry_count > 0 )
+            bo_fix_32be( moof, p_stream->i_trun_pos, moof->i_buffer +
+                         i_mdat_header + p_stream->i_trun_data );
+    }
+
+    block_t *p_moof = bo_to_sout( moof );
+    p_moof->i_dts = p_sys->i_frag_start;
+    p_sys->i_pos += p_moof->i_buffer;
+    box_free( moof );
+    sout_AccessOutWrite( p_mux->p_access, p_moof );
+
+    bo_t bo;
+    bo_init( &bo, 0, NULL, true );
+    if( b_large )
+    {
+        bo_add_32be  ( &bo, 1 );
+        bo_add_fourcc( &bo, "mdat" );
+        bo_add_64be  ( &bo, i_data_size + 16 );
+    }
+    else
+    {
+        bo_add_32be  ( &bo, i_data_size + 8 );
+        bo_add_fourcc( &bo, "mdat" );
+    }
+    block_t *p_mdat = bo_to_sout( &bo );
+    free( bo.p_buffer );
+    p_sys->i_pos += p_mdat->i_buffer;
+    sout_AccessOutWrite( p_mux->p_access, p_mdat );
+
+    /* write data */
+    for( int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
+    {
+        mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
+
+        if( p_stream->p_frag_data != NULL )
+            sout_AccessOutWrite( p_mux->p_access, p_stream->p_frag_data );
+        p_stream->p_frag_data = NULL;
+        p_stream->pp_frag_last = &p_stream->p_frag_data;
+        p_stream->i_entry_count = 0;
+    }
+    p_sys->i_pos += i_data_size;
+    p_sys->i_frag_start = VLC_TS_INVALID;
+}
+
+static void FragmentClose( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    if( !p_sys->b_header_sent )
+        FragmentHeader( p_mux );
+    if( p_sys->i_frag_start > VLC_TS_INVALID )
+        FragmentFlush( p_mux );
+    if( !p_sys->b_mfra )
+        return;
+
+    /* Random access index, found from the end of the file with mfro */
+    bo_t *mfra = box_new( "mfra" );
+
+    for( int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
+    {
+        mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
+
+        bo_t *tfra = box_full_new( "tfra", 1, 0 );
+        bo_add_32be( tfra, p_stream->i_track_id );
+        bo_add_32be( tfra, 0 );     // 8 bits traf, trun and sample numbers
+        bo_add_32be( tfra, p_stream->i_tfra_count );
+        for( unsigned int i = 0; i < p_stream->i_tfra_count; i++ )
+        {
+            bo_add_64be( tfra, p_stream->tfra[i].i_time );
+            bo_add_64be( tfra, p_stream->tfra[i].i_moof_pos );
+            bo_add_8   ( tfra, p_stream->tfra[i].i_traf );
+            bo_add_8   ( tfra, 1 );     // trun-number
+            bo_add_8   ( tfra, 1 );     // sample-number
+        }
+        box_fix( tfra );
+        box_gather( mfra, tfra );
+    }
+
+    bo_t *mfro = box_full_new( "mfro", 0, 0 );
+    bo_add_32be( mfro, mfra->i_buffer + 16 );   // size of mfra
+    box_fix( mfro );
+    box_gather( mfra, mfro );
+    box_fix( mfra );
+
+    p_sys->i_pos += mfra->i_buffer;
+    box_send( p_mux, mfra );
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -633,6 +1156,11 @@ static block_t *ConvertSUBT( block_t *p_block )
 
 static block_t *ConvertAVC1( block_t *p_block )
 {
+    /* The start codes are replaced in place */
+    p_block = block_Unshare( p_block );
+    if( p_block == NULL )
+        return NULL;
+
     uint8_t *last = p_block->p_buffer;  /* Assume it starts with 0x00000001 */
     uint8_t *dat  = &p_block->p_buffer[4];
     uint8_t *end = &p_block->p_buffer[p_block->i_buffer];
@@ -1389,10 +1917,7 @@ static bo_t *GetStblBox( sout_mux_t *p_mux, mp4_stream_t *p_stream )
     stts = box_full_new( "stts", 0, 0 );
     bo_add_32be( stts, 0 );     // entry-count (fixed latter)
 
-    if( p_stream->fmt.i_cat == AUDIO_ES )
-        i_timescale = p_stream->fmt.audio.i_rate;
-    else
-        i_timescale = 1001;
+    i_timescale = p_stream->i_timescale;
 
     /* first, create quantified length */
     for( i = 0, i_dts = 0, i_dts_q = 0; i < p_stream->i_entry_count; i++ )
@@ -1556,11 +2081,7 @@ static bo_t *GetMoovBox( sout_mux_t *p_mux )
         bo_t *minf, *dinf, *dref, *url, *stbl;
 
         p_stream = p_sys->pp_streams[i_trak];
-
-        if( p_stream->fmt.i_cat == AUDIO_ES )
-            i_timescale = p_stream->fmt.audio.i_rate;
-        else
-            i_timescale = 1001;
+        i_timescale = p_stream->i_timescale;
 
         /* *** add /moov/trak *** */
         trak = box_new( "trak" );
@@ -1702,7 +2223,11 @@ static bo_t *GetMoovBox( sout_mux_t *p_mux )
         box_fix( elst );
         box_gather( edts, elst );
         box_fix( edts );
-        box_gather( trak, edts );
+        /* Fragments carry their decoding time instead (tfdt) */
+        if( p_sys->b_fragmented )
+            box_free( edts );
+        else
+            box_gather( trak, edts );
 
         /* *** add /moov/trak/mdia *** */
         mdia = box_new( "mdia" );
@@ -1882,6 +2407,26 @@ static bo_t *GetMoovBox( sout_mux_t *p_mux )
         box_gather( moov, trak );
     }
 
+    /* Announce the movie fragments */
+    if( p_sys->b_fragmented )
+    {
+        bo_t *mvex = box_new( "mvex" );
+
+        for( i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
+        {
+            bo_t *trex = box_full_new( "trex", 0, 0 );
+            bo_add_32be( trex, p_sys->pp_streams[i_trak]->i_track_id );
+            bo_add_32be( trex, 1 );     // sample-description-index
+            bo_add_32be( trex, 0 );     // default sample duration
+            bo_add_32be( trex, 0 );     // default sample size
+            bo_add_32be( trex, 0 );     // default sample flags
+            box_fix( trex );
+            box_gather( mvex, trex );
+        }
+        box_fix( mvex );
+        box_gather( moov, mvex );
+    }
+
     /* Add user data tags */
     box_gather( moov, GetUdtaTag( p_mux ) );
 
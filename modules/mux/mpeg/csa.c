@@ -27,9 +27,18 @@
 #endif
 
 #include <vlc_common.h>
+#include <assert.h>
 
 #include "csa.h"
 
+/* Packets going through the bitsliced stream cypher at once (one per bit) */
+typedef uint64_t csa_word_t;
+#define CSA_BATCH 64
+/* Below that, the packets are (de)scrambled one by one faster */
+#define CSA_BATCH_MIN 12
+/* Largest stream cypher output needed by a packet */
+#define CSA_STREAM_MAX 184
+
 struct csa_t
 {
     /* odd and even keys */
@@ -56,6 +65,10 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 static void csa_BlockDecypher( uint8_t kk[57], uint8_t ib[8], uint8_t bd[8] );
 static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] );
 
+typedef struct csa_job_t csa_job_t;
+static void csa_StreamBitslice( const csa_job_t *jobs, int i_count,
+                                uint8_t stream[][CSA_STREAM_MAX] );
+
 /*****************************************************************************
  * csa_New:
  *****************************************************************************/
@@ -135,174 +148,267 @@ int csa_UseKey( vlc_object_t *p_caller, csa_t *c, bool use_odd )
     return VLC_SUCCESS;
 }
 
-/*****************************************************************************
- * csa_Decrypt:
- *****************************************************************************/
-void csa_Decrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
+/* A packet being (de)scrambled */
+struct csa_job_t
 {
+    uint8_t *pkt;
+    int     i_pkt_size;
+    int     i_hdr;
+    int     n;              /* number of 8 bytes blocks */
+    int     i_residue;
+    int     i_stream;       /* bytes of stream cypher output needed */
     uint8_t *ck;
     uint8_t *kk;
+};
 
-    uint8_t  ib[8], stream[8], block[8];
-
-    int     i_hdr, i_residue;
-    int     i, j, n;
-
+/* Returns false if there is nothing to decrypt */
+static bool csa_PrepareDecrypt( csa_t *c, uint8_t *pkt, int i_pkt_size,
+                                csa_job_t *job )
+{
     /* transport scrambling control */
     if( (pkt[3]&0x80) == 0 )
     {
         /* not scrambled */
-        return;
+        return false;
     }
     if( pkt[3]&0x40 )
     {
-        ck = c->o_ck;
-        kk = c->o_kk;
+        job->ck = c->o_ck;
+        job->kk = c->o_kk;
     }
     else
     {
-        ck = c->e_ck;
-        kk = c->e_kk;
+        job->ck = c->e_ck;
+        job->kk = c->e_kk;
     }
 
     /* clear transport scrambling control */
     pkt[3] &= 0x3f;
 
-    i_hdr = 4;
+    job->i_hdr = 4;
     if( pkt[3]&0x20 )
     {
         /* skip adaption field */
-        i_hdr += pkt[4] + 1;
+        job->i_hdr += pkt[4] + 1;
     }
 
-    if( 188 - i_hdr < 8 )
-        return;
+    if( 188 - job->i_hdr < 8 )
+        return false;
 
-    /* init csa state */
-    csa_StreamCypher( c, 1, ck, &pkt[i_hdr], ib );
+    job->n = (i_pkt_size - job->i_hdr) / 8;
+    job->i_residue = (i_pkt_size - job->i_hdr) % 8;
+    if( job->n < 0 || ( job->n == 0 && job->i_residue <= 0 ) )
+        return false;
 
-    /* */
-    n = (i_pkt_size - i_hdr) / 8;
-    if( n < 0 )
-        return;
- 
-    i_residue = (i_pkt_size - i_hdr) % 8;
-    for( i = 1; i < n + 1; i++ )
+    job->pkt = pkt;
+    job->i_pkt_size = i_pkt_size;
+    job->i_stream = 8 * ( __MAX( job->n - 1, 0 ) + ( job->i_residue > 0 ) );
+    return true;
+}
+
+static void csa_FinishDecrypt( const csa_job_t *job, const uint8_t *stream )
+{
+    uint8_t *pkt = job->pkt;
+    const int i_hdr = job->i_hdr;
+    const int n = job->n;
+    uint8_t  ib[8], block[8];
+
+    memcpy( ib, &pkt[i_hdr], 8 );
+    for( int i = 1; i < n + 1; i++ )
     {
-        csa_BlockDecypher( kk, ib, block );
+        csa_BlockDecypher( job->kk, ib, block );
         if( i != n )
         {
-            csa_StreamCypher( c, 0, ck, NULL, stream );
-            for( j = 0; j < 8; j++ )
+            for( int j = 0; j < 8; j++ )
             {
                 /* xor ib with stream */
                 ib[j] = pkt[i_hdr+8*i+j] ^ stream[j];
             }
+            stream += 8;
         }
         else
         {
             /* last block */
-            for( j = 0; j < 8; j++ )
-            {
-                ib[j] = 0;
-            }
+            memset( ib, 0, 8 );
         }
         /* xor ib with block */
-        for( j = 0; j < 8; j++ )
+        for( int j = 0; j < 8; j++ )
         {
             pkt[i_hdr+8*(i-1)+j] = ib[j] ^ block[j];
         }
     }
 
-    if( i_residue > 0 )
+    for( int j = 0; j < job->i_residue; j++ )
     {
-        csa_StreamCypher( c, 0, ck, NULL, stream );
-        for( j = 0; j < i_residue; j++ )
-        {
-            pkt[i_pkt_size - i_residue + j] ^= stream[j];
-        }
+        pkt[job->i_pkt_size - job->i_residue + j] ^= stream[j];
     }
 }
 
-/*****************************************************************************
- * csa_Encrypt:
- *****************************************************************************/
-void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
+/* Returns false if there is nothing to encrypt, otherwise runs the block
+ * cypher: the packet then holds the intermediate blocks ib[1..n] */
+static bool csa_PrepareEncrypt( csa_t *c, uint8_t *pkt, int i_pkt_size,
+                                csa_job_t *job )
 {
-    uint8_t *ck;
-    uint8_t *kk;
-
-    int i, j;
-    int i_hdr = 4; /* hdr len */
-    uint8_t  ib[184/8+2][8], stream[8], block[8];
-    int n, i_residue;
-
     /* set transport scrambling control */
     pkt[3] |= 0x80;
 
     if( c->use_odd )
     {
         pkt[3] |= 0x40;
-        ck = c->o_ck;
-        kk = c->o_kk;
+        job->ck = c->o_ck;
+        job->kk = c->o_kk;
     }
     else
     {
-        ck = c->e_ck;
-        kk = c->e_kk;
+        job->ck = c->e_ck;
+        job->kk = c->e_kk;
     }
 
     /* hdr len */
-    i_hdr = 4;
+    job->i_hdr = 4;
     if( pkt[3]&0x20 )
     {
         /* skip adaption field */
-        i_hdr += pkt[4] + 1;
+        job->i_hdr += pkt[4] + 1;
     }
-    n = (i_pkt_size - i_hdr) / 8;
-    i_residue = (i_pkt_size - i_hdr) % 8;
+    job->n = (i_pkt_size - job->i_hdr) / 8;
+    job->i_residue = (i_pkt_size - job->i_hdr) % 8;
 
-    if( n <= 0 )
+    if( job->n <= 0 )
     {
         pkt[3] &= 0x3f;
-        return;
+        return false;
     }
 
-    /* */
-    for( i = 0; i < 8; i++ )
+    job->pkt = pkt;
+    job->i_pkt_size = i_pkt_size;
+    job->i_stream = 8 * ( job->n - 1 + ( job->i_residue > 0 ) );
+
+    /* ib[i] is stored in place of the block i-1, ib[n+1] is 0 */
+    uint8_t *p_block = &pkt[job->i_hdr];
+    uint8_t block[8];
+    for( int i = job->n; i > 0; i-- )
     {
-        ib[n+1][i] = 0;
+        for( int j = 0; j < 8; j++ )
+        {
+            block[j] = p_block[8*(i-1)+j] ^ ( i < job->n ? p_block[8*i+j] : 0 );
+        }
+        csa_BlockCypher( job->kk, block, &p_block[8*(i-1)] );
     }
-    for( i = n; i  > 0; i-- )
+    return true;
+}
+
+static void csa_FinishEncrypt( const csa_job_t *job, const uint8_t *stream )
+{
+    uint8_t *pkt = job->pkt;
+
+    for( int i = 2; i < job->n + 1; i++ )
     {
-        for( j = 0; j < 8; j++ )
+        for( int j = 0; j < 8; j++ )
         {
-            block[j] = pkt[i_hdr+8*(i-1)+j] ^ib[i+1][j];
+            pkt[job->i_hdr+8*(i-1)+j] ^= stream[j];
         }
-        csa_BlockCypher( kk, block, ib[i] );
+        stream += 8;
+    }
+    for( int j = 0; j < job->i_residue; j++ )
+    {
+        pkt[job->i_pkt_size - job->i_residue + j] ^= stream[j];
     }
+}
 
-    /* init csa state */
-    csa_StreamCypher( c, 1, ck, ib[1], stream );
+/* The stream cypher is initialised with the first (scrambled) block */
+static void csa_Stream( csa_t *c, const csa_job_t *job, uint8_t *stream )
+{
+    uint8_t ib[8];
 
-    for( i = 0; i < 8; i++ )
+    csa_StreamCypher( c, 1, job->ck, &job->pkt[job->i_hdr], ib );
+    for( int i = 0; i < job->i_stream; i += 8 )
+        csa_StreamCypher( c, 0, job->ck, NULL, &stream[i] );
+}
+
+/*****************************************************************************
+ * csa_Decrypt:
+ *****************************************************************************/
+void csa_Decrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
+{
+    csa_job_t job;
+    uint8_t   stream[CSA_STREAM_MAX];
+
+    if( !csa_PrepareDecrypt( c, pkt, i_pkt_size, &job ) )
+        return;
+
+    csa_Stream( c, &job, stream );
+    csa_FinishDecrypt( &job, stream );
+}
+
+/*****************************************************************************
+ * csa_Encrypt:
+ *****************************************************************************/
+void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
+{
+    csa_job_t job;
+    uint8_t   stream[CSA_STREAM_MAX];
+
+    if( !csa_PrepareEncrypt( c, pkt, i_pkt_size, &job ) )
+        return;
+
+    csa_Stream( c, &job, stream );
+    csa_FinishEncrypt( &job, stream );
+}
+
+/*****************************************************************************
+ * csa_DecryptBatch/csa_EncryptBatch:
+ *****************************************************************************/
+static void csa_RunBatch( csa_t *c, const csa_job_t *jobs, int i_jobs,
+                          bool b_encrypt )
+{
+    uint8_t stream[CSA_BATCH][CSA_STREAM_MAX];
+
+    if( i_jobs >= CSA_BATCH_MIN )
+        csa_StreamBitslice( jobs, i_jobs, stream );
+    else
+        for( int i = 0; i < i_jobs; i++ )
+            csa_Stream( c, &jobs[i], stream[i] );
+
+    for( int i = 0; i < i_jobs; i++ )
     {
-        pkt[i_hdr+i] = ib[1][i];
+        if( b_encrypt )
+            csa_FinishEncrypt( &jobs[i], stream[i] );
+        else
+            csa_FinishDecrypt( &jobs[i], stream[i] );
     }
-    for( i = 2; i < n+1; i++ )
+}
+
+void csa_DecryptBatch( csa_t *c, uint8_t **pp_pkt, int i_count, int i_pkt_size )
+{
+    csa_job_t jobs[CSA_BATCH];
+    int i_jobs = 0;
+
+    for( int i = 0; i < i_count; i++ )
     {
-        csa_StreamCypher( c, 0, ck, NULL, stream );
-        for( j = 0; j < 8; j++ )
+        if( csa_PrepareDecrypt( c, pp_pkt[i], i_pkt_size, &jobs[i_jobs] ) )
+            i_jobs++;
+        if( i_jobs == CSA_BATCH || i == i_count - 1 )
         {
-            pkt[i_hdr+8*(i-1)+j] = ib[i][j] ^ stream[j];
+            csa_RunBatch( c, jobs, i_jobs, false );
+            i_jobs = 0;
         }
     }
-    if( i_residue > 0 )
+}
+
+void csa_EncryptBatch( csa_t *c, uint8_t **pp_pkt, int i_count, int i_pkt_size )
+{
+    csa_job_t jobs[CSA_BATCH];
+    int i_jobs = 0;
+
+    for( int i = 0; i < i_count; i++ )
     {
-        csa_StreamCypher( c, 0, ck, NULL, stream );
-        for( j = 0; j < i_residue; j++ )
+        if( csa_PrepareEncrypt( c, pp_pkt[i], i_pkt_size, &jobs[i_jobs] ) )
+            i_jobs++;
+        if( i_jobs == CSA_BATCH || i == i_count - 1 )
         {
-            pkt[i_pkt_size - i_residue + j] ^= stream[j];
+            csa_RunBatch( c, jobs, i_jobs, true );
+            i_jobs = 0;
         }
     }
 }
@@ -494,6 +600,226 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 }
 
 
+/*****************************************************************************
+ * Bitsliced stream cypher
+ *****************************************************************************
+ * The stream cypher only works on nibbles and bits: each bit of its state is
+ * stored in a word holding that bit for up to CSA_BATCH packets, which then
+ * all go through the cypher with the same logical operations. This is the
+ * same algorithm as csa_StreamCypher, the S-box lookups become selections
+ * among the table entries by each input bit.
+ *****************************************************************************/
+typedef struct
+{
+    csa_word_t A[11][4];
+    csa_word_t B[11][4];
+    csa_word_t X[4], Y[4], Z[4];
+    csa_word_t D[4], E[4], F[4];
+    csa_word_t p, q, r;
+} csa_bitslice_t;
+
+static const int *const sboxes[7] =
+{
+    sbox1, sbox2, sbox3, sbox4, sbox5, sbox6, sbox7
+};
+
+/* A[] register and bit of each S-box input, least significant first */
+static const uint8_t sbox_in[7][5][2] =
+{
+    { {9,0}, {7,3}, {6,1}, {1,2}, {4,0} },
+    { {9,1}, {7,0}, {6,3}, {3,2}, {2,1} },
+    { {6,2}, {5,3}, {5,1}, {2,0}, {1,3} },
+    { {8,0}, {4,2}, {2,3}, {1,1}, {3,3} },
+    { {9,2}, {8,1}, {6,0}, {4,3}, {5,2} },
+    { {9,3}, {7,2}, {5,0}, {4,1}, {3,1} },
+    { {8,3}, {8,2}, {7,1}, {3,0}, {2,2} },
+};
+
+static void csa_BitsliceSbox( const int sbox[0x20], const csa_word_t in[5],
+                              csa_word_t out[2] )
+{
+    csa_word_t v0[0x10], v1[0x10];
+
+    /* select by the first input bit between the constant entries */
+    for( int k = 0; k < 0x10; k++ )
+    {
+        const int lo = sbox[2*k], hi = sbox[2*k+1];
+
+        v0[k] = -(csa_word_t)( lo&1 ) ^ ( in[0] & -(csa_word_t)( (lo^hi)&1 ) );
+        v1[k] = -(csa_word_t)( (lo>>1)&1 ) ^ ( in[0] & -(csa_word_t)( ((lo^hi)>>1)&1 ) );
+    }
+    /* then halve the table with each other input bit */
+    for( int b = 1, n = 0x10; b < 5; b++ )
+    {
+        n /= 2;
+        for( int k = 0; k < n; k++ )
+        {
+            v0[k] = v0[2*k] ^ ( in[b] & ( v0[2*k] ^ v0[2*k+1] ) );
+            v1[k] = v1[2*k] ^ ( in[b] & ( v1[2*k] ^ v1[2*k+1] ) );
+        }
+    }
+    out[0] = v0[0];
+    out[1] = v1[0];
+}
+
+/* Produces one byte (as 8 bit planes) or consumes one during initialisation */
+static void csa_BitsliceByte( csa_bitslice_t *c, const csa_word_t *sb,
+                              csa_word_t op[8] )
+{
+    for( int j = 0; j < 4; j++ )
+    {
+        csa_word_t s[7][2];
+        for( int i = 0; i < 7; i++ )
+        {
+            csa_word_t in[5];
+            for( int k = 0; k < 5; k++ )
+                in[k] = c->A[sbox_in[i][k][0]][sbox_in[i][k][1]];
+            csa_BitsliceSbox( sboxes[i], in, s[i] );
+        }
+
+        /* use 4x4 xor to produce extra nibble for T3 */
+        csa_word_t extra_B[4];
+        extra_B[3] = c->B[3][0] ^ c->B[6][1] ^ c->B[7][2] ^ c->B[9][3];
+        extra_B[2] = c->B[6][0] ^ c->B[8][1] ^ c->B[3][3] ^ c->B[4][2];
+        extra_B[1] = c->B[5][3] ^ c->B[8][2] ^ c->B[4][0] ^ c->B[5][1];
+        extra_B[0] = c->B[9][2] ^ c->B[6][3] ^ c->B[3][1] ^ c->B[8][0];
+
+        /* T1 and T2, the input byte is only used during initialisation:
+         * in1 is its high nibble, in2 its low one */
+        csa_word_t next_A1[4], next_B1[4], t2[4];
+        for( int b = 0; b < 4; b++ )
+        {
+            next_A1[b] = c->A[10][b] ^ c->X[b];
+            t2[b] = c->B[7][b] ^ c->B[10][b] ^ c->Y[b];
+            if( sb )
+            {
+                next_A1[b] ^= c->D[b] ^ ( (j % 2) ? sb[b] : sb[4+b] );
+                t2[b] ^= (j % 2) ? sb[4+b] : sb[b];
+            }
+        }
+        /* if p=1, rotate left */
+        for( int b = 0; b < 4; b++ )
+            next_B1[b] = t2[b] ^ ( c->p & ( t2[b] ^ t2[(b+3)%4] ) );
+
+        /* T3 = xor all inputs, T4 = sum, carry of Z + E + r */
+        csa_word_t carry = c->r;
+        for( int b = 0; b < 4; b++ )
+        {
+            const csa_word_t z = c->Z[b], e = c->E[b];
+            const csa_word_t sum = z ^ e ^ carry;
+
+            carry = ( z & e ) | ( carry & ( z ^ e ) );
+            c->D[b] = e ^ z ^ extra_B[b];
+            c->E[b] = c->F[b];
+            c->F[b] = e ^ ( c->q & ( sum ^ e ) );
+        }
+        c->r ^= c->q & ( carry ^ c->r );
+
+        memmove( c->A[2], c->A[1], 9 * sizeof( c->A[1] ) );
+        memmove( c->B[2], c->B[1], 9 * sizeof( c->B[1] ) );
+        memcpy( c->A[1], next_A1, sizeof( next_A1 ) );
+        memcpy( c->B[1], next_B1, sizeof( next_B1 ) );
+
+        c->X[3] = s[3][0]; c->X[2] = s[2][0]; c->X[1] = s[1][1]; c->X[0] = s[0][1];
+        c->Y[3] = s[5][0]; c->Y[2] = s[4][0]; c->Y[1] = s[3][1]; c->Y[0] = s[2][1];
+        c->Z[3] = s[1][0]; c->Z[2] = s[0][0]; c->Z[1] = s[5][1]; c->Z[0] = s[4][1];
+        c->p = s[6][1];
+        c->q = s[6][0];
+
+        /* 2 output bits are a function of the 4 bits of D */
+        op[7-2*j] = c->D[3] ^ c->D[2];
+        op[6-2*j] = c->D[1] ^ c->D[0];
+    }
+}
+
+/* Transposes the byte i of each packet into 8 bit planes */
+static void csa_BitsliceLoad( csa_word_t plane[8], uint8_t *const *pp_src,
+                              int i_count, int i )
+{
+    for( int b = 0; b < 8; b++ )
+        plane[b] = 0;
+    for( int l = 0; l < i_count; l++ )
+    {
+        const unsigned v = pp_src[l][i];
+        for( int b = 0; b < 8; b++ )
+            plane[b] |= (csa_word_t)( ( v >> b )&1 ) << l;
+    }
+}
+
+/* Transposes 8 bit planes back into the byte i of each packet, 8 packets at
+ * a time as a 8x8 bits matrix transposition */
+static void csa_BitsliceStore( const csa_word_t plane[8],
+                               uint8_t stream[][CSA_STREAM_MAX],
+                               int i_count, int i )
+{
+    for( int l = 0; l < i_count; l += 8 )
+    {
+        uint64_t x = 0, t;
+
+        /* row b holds the bit b of the 8 packets */
+        for( int b = 0; b < 8; b++ )
+            x |= (uint64_t)( ( plane[b] >> l )&0xff ) << ( 8 * b );
+
+        t = ( x ^ ( x >>  7 ) ) & UINT64_C(0x00AA00AA00AA00AA);
+        x ^= t ^ ( t <<  7 );
+        t = ( x ^ ( x >> 14 ) ) & UINT64_C(0x0000CCCC0000CCCC);
+        x ^= t ^ ( t << 14 );
+        t = ( x ^ ( x >> 28 ) ) & UINT64_C(0x00000000F0F0F0F0);
+        x ^= t ^ ( t << 28 );
+
+        /* row k now holds the 8 bits of the packet l + k */
+        for( int k = 0; k < 8 && l + k < i_count; k++ )
+            stream[l+k][i] = x >> ( 8 * k );
+    }
+}
+
+static void csa_StreamBitslice( const csa_job_t *jobs, int i_count,
+                                uint8_t stream[][CSA_STREAM_MAX] )
+{
+    csa_bitslice_t c;
+    uint8_t *pp_ck[CSA_BATCH], *pp_sb[CSA_BATCH];
+    csa_word_t ck[8][8], sb[8];
+    int i_stream = 0;
+
+    assert( i_count <= CSA_BATCH );
+    for( int l = 0; l < i_count; l++ )
+    {
+        pp_ck[l] = jobs[l].ck;
+        pp_sb[l] = &jobs[l].pkt[jobs[l].i_hdr];
+        i_stream = __MAX( i_stream, jobs[l].i_stream );
+    }
+
+    /* load first 32 bits of CK into A[1]..A[8]
+     * load last  32 bits of CK into B[1]..B[8]
+     * all other regs = 0 */
+    memset( &c, 0, sizeof( c ) );
+    for( int i = 0; i < 8; i++ )
+        csa_BitsliceLoad( ck[i], pp_ck, i_count, i );
+    for( int i = 0; i < 4; i++ )
+    {
+        for( int b = 0; b < 4; b++ )
+        {
+            c.A[1+2*i+0][b] = ck[i][4+b];
+            c.A[1+2*i+1][b] = ck[i][b];
+            c.B[1+2*i+0][b] = ck[4+i][4+b];
+            c.B[1+2*i+1][b] = ck[4+i][b];
+        }
+    }
+
+    csa_word_t op[8];
+    for( int i = 0; i < 8; i++ )
+    {
+        csa_BitsliceLoad( sb, pp_sb, i_count, i );
+        csa_BitsliceByte( &c, sb, op );
+    }
+
+    for( int i = 0; i < i_stream; i++ )
+    {
+        csa_BitsliceByte( &c, NULL, op );
+        csa_BitsliceStore( op, stream, i_count, i );
+    }
+}
+
 // block - sbox
 static const uint8_t block_sbox[256] =
 {
@@ -137,6 +137,11 @@ static void    Close  ( vlc_object_t * );
   "PCRs (Program Clock Reference) will be sent (in milliseconds). " \
   "This value should be below 100ms. (default is 70ms).")
 
+#define MUXRATE_TEXT N_("Mux rate (kb/s)")
+#define MUXRATE_LONGTEXT N_("Output a constant bitrate stream at this rate, " \
+  "by stuffing it with null packets. The default (0) outputs a variable " \
+  "bitrate stream.")
+
 #define BMIN_TEXT N_( "Minimum B (deprecated)")
 #define BMIN_LONGTEXT N_( "This setting is deprecated and not used anymore" )
 
@@ -199,6 +204,7 @@ vlc_module_begin ()
     add_bool(SOUT_CFG_PREFIX "use-key-frames", false, KEYF_TEXT, KEYF_LONGTEXT, true)
 
     add_integer( SOUT_CFG_PREFIX "pcr", 70, PCR_TEXT, PCR_LONGTEXT, true)
+    add_integer( SOUT_CFG_PREFIX "muxrate", 0, MUXRATE_TEXT, MUXRATE_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmin", 0, BMIN_TEXT, BMIN_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmax", 0, BMAX_TEXT, BMAX_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "dts-delay", 400, DTS_TEXT, DTS_LONGTEXT, true)
@@ -221,7 +227,7 @@ static const char *const ppsz_sout_options[] = {
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
-    "muxpmt", "program-pmt", "alignment",
+    "muxpmt", "program-pmt", "alignment", "muxrate",
     NULL
 };
 
@@ -379,6 +385,27 @@ struct sout_mux_sys_t
 
     mtime_t         i_pcr;  /* last PCR emited */
 
+    /* for CBR output */
+    int64_t         i_muxrate;      /* bits/s, 0 for VBR */
+    int64_t         i_muxrate_frac; /* remainder of the last slot count */
+
+    /* Statistics */
+    struct
+    {
+        uint64_t    i_packets;      /* TS packets output */
+        uint64_t    i_stuffing;     /* null packets among them */
+        uint64_t    i_payload;      /* bytes of PES payload */
+        unsigned    i_overruns;     /* slices above the mux rate */
+        int64_t     i_bitrate_min, i_bitrate_max;   /* of the slices */
+        mtime_t     i_pcr_last;
+        mtime_t     i_pcr_interval_max;
+        /* CBR only: largest distance to the constant rate schedule */
+        mtime_t     i_cbr_origin;
+        uint64_t    i_cbr_packets;
+        mtime_t     i_jitter_max;
+        mtime_t     i_last_report;
+    } stats;
+
     csa_t           *csa;
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
@@ -443,6 +470,7 @@ static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
 static block_t *TSNew( sout_mux_t *p_mux, ts_stream_t *p_stream, bool b_pcr );
 static void TSSetPCR( block_t *p_ts, mtime_t i_dts );
+static void TSStatsReport( sout_mux_t *p_mux );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -707,8 +735,17 @@ static int Open( vlc_object_t *p_this )
     var_Get( p_mux, SOUT_CFG_PREFIX "dts-delay", &val );
     p_sys->i_dts_delay = val.i_int * 1000;
 
-    msg_Dbg( p_mux, "shaping=%"PRId64" pcr=%"PRId64" dts_delay=%"PRId64,
-             p_sys->i_shaping_delay, p_sys->i_pcr_delay, p_sys->i_dts_delay );
+    p_sys->i_muxrate = var_GetInteger( p_mux, SOUT_CFG_PREFIX "muxrate" );
+    if( p_sys->i_muxrate < 0 )
+        p_sys->i_muxrate = 0;
+    p_sys->i_muxrate *= 1000;
+    if( p_sys->i_muxrate > 0 && p_sys->i_pcr_delay > 40000 )
+        msg_Warn( p_mux, "PCR interval above 40ms (%"PRId64"ms) is not DVB "
+                  "compliant", p_sys->i_pcr_delay / 1000 );
+
+    msg_Dbg( p_mux, "shaping=%"PRId64" pcr=%"PRId64" dts_delay=%"PRId64
+             " muxrate=%"PRId64, p_sys->i_shaping_delay, p_sys->i_pcr_delay,
+             p_sys->i_dts_delay, p_sys->i_muxrate );
 
     p_sys->b_use_key_frames = var_GetBool( p_mux, SOUT_CFG_PREFIX "use-key-frames" );
 
@@ -725,6 +762,8 @@ static void Close( vlc_object_t * p_this )
     sout_mux_t          *p_mux = (sout_mux_t*)p_this;
     sout_mux_sys_t      *p_sys = p_mux->p_sys;
 
+    TSStatsReport( p_mux );
+
     if( p_sys->csa )
     {
         var_DelCallback( p_mux, SOUT_CFG_PREFIX "csa-ck", ChangeKeyCallback, NULL );
@@ -1185,6 +1224,43 @@ static void SetHeader( sout_buffer_chain_t *c,
     p_ts->i_flags |= BLOCK_FLAG_HEADER;
 }
 
+/* Streams with PES data left to mux, as a binary heap ordered by dts, then
+ * by input index so that the order is the same as a linear scan */
+typedef struct
+{
+    ts_stream_t *p_stream;
+    int          i_input;
+} ts_heap_entry_t;
+
+static bool TSHeapLess( const ts_heap_entry_t *a, const ts_heap_entry_t *b )
+{
+    if( a->p_stream->i_pes_dts != b->p_stream->i_pes_dts )
+        return a->p_stream->i_pes_dts < b->p_stream->i_pes_dts;
+    return a->i_input < b->i_input;
+}
+
+static void TSHeapDown( ts_heap_entry_t *p_heap, int i_count, int i )
+{
+    for( ;; )
+    {
+        int i_min = i;
+        int i_left = 2 * i + 1;
+        int i_right = i_left + 1;
+
+        if( i_left < i_count && TSHeapLess( &p_heap[i_left], &p_heap[i_min] ) )
+            i_min = i_left;
+        if( i_right < i_count && TSHeapLess( &p_heap[i_right], &p_heap[i_min] ) )
+            i_min = i_right;
+        if( i_min == i )
+            return;
+
+        ts_heap_entry_t tmp = p_heap[i];
+        p_heap[i] = p_heap[i_min];
+        p_heap[i_min] = tmp;
+        i = i_min;
+    }
+}
+
 /* returns true if needs more data */
 static bool MuxStreams(sout_mux_t *p_mux )
 {
@@ -1450,34 +1526,32 @@ static bool MuxStreams(sout_mux_t *p_mux )
     /* msg_Dbg( p_mux, "estimated pck=%d", i_packet_count ); */
 
     const mtime_t i_pcr_dts = p_pcr_stream->i_pes_dts;
-    for (;;)
-    {
-        int          i_stream = -1;
-        mtime_t      i_dts = 0;
-        ts_stream_t  *p_stream;
 
-        /* Select stream (lowest dts) */
-        for (int i = 0; i < p_mux->i_nb_inputs; i++ )
+    ts_heap_entry_t p_heap[p_mux->i_nb_inputs];
+    int i_heap = 0;
+    for (int i = 0; i < p_mux->i_nb_inputs; i++ )
+    {
+        ts_stream_t *p_stream = (ts_stream_t*)p_mux->pp_inputs[i]->p_sys;
+        if( p_stream->i_pes_dts != 0 )
         {
-            p_stream = (ts_stream_t*)p_mux->pp_inputs[i]->p_sys;
-
-            if( p_stream->i_pes_dts == 0 )
-            {
-                continue;
-            }
-
-            if( i_stream == -1 || p_stream->i_pes_dts < i_dts )
-            {
-                i_stream = i;
-                i_dts = p_stream->i_pes_dts;
-            }
+            p_heap[i_heap].p_stream = p_stream;
+            p_heap[i_heap].i_input = i;
+            i_heap++;
         }
-        if( i_stream == -1 || i_dts > i_pcr_dts + i_pcr_length )
+    }
+    for (int i = i_heap / 2 - 1; i >= 0; i-- )
+        TSHeapDown( p_heap, i_heap, i );
+
+    for (;;)
+    {
+        /* Select stream (lowest dts) */
+        if( i_heap == 0 ||
+            p_heap[0].p_stream->i_pes_dts > i_pcr_dts + i_pcr_length )
         {
             break;
         }
-        p_stream = (ts_stream_t*)p_mux->pp_inputs[i_stream]->p_sys;
-        sout_input_t *p_input = p_mux->pp_inputs[i_stream];
+        ts_stream_t *p_stream = p_heap[0].p_stream;
+        sout_input_t *p_input = p_mux->pp_inputs[p_heap[0].i_input];
 
         /* do we need to issue pcr */
         bool b_pcr = false;
@@ -1492,6 +1566,11 @@ static bool MuxStreams(sout_mux_t *p_mux )
 
         /* Build the TS packet */
         block_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
+
+        /* Restore the heap order now that the dts of the stream moved */
+        if( p_stream->i_pes_dts == 0 )
+            p_heap[0] = p_heap[--i_heap];
+        TSHeapDown( p_heap, i_heap, 0 );
         if( p_sys->csa != NULL &&
              (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
              (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
@@ -1722,11 +1801,48 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
 }
 
+static block_t *TSNull( void )
+{
+    block_t *p_ts = block_Alloc( 188 );
+    if( p_ts == NULL )
+        return NULL;
+
+    p_ts->p_buffer[0] = 0x47;
+    p_ts->p_buffer[1] = 0x1f;   /* pid 0x1fff */
+    p_ts->p_buffer[2] = 0xff;
+    p_ts->p_buffer[3] = 0x10;   /* payload only */
+    memset( &p_ts->p_buffer[4], 0xff, 184 );
+    return p_ts;
+}
+
+static void TSStatsReport( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    uint64_t i_bytes = p_sys->stats.i_packets * 188;
+
+    if( i_bytes == 0 )
+        return;
+
+    msg_Dbg( p_mux, "%"PRIu64" packets (%"PRIu64" null), overhead %.1f%%, "
+             "slices at %"PRId64"-%"PRId64"kb/s, PCR interval up to "
+             "%"PRId64"ms", p_sys->stats.i_packets, p_sys->stats.i_stuffing,
+             100. * (i_bytes - p_sys->stats.i_payload) / i_bytes,
+             p_sys->stats.i_bitrate_min / 1000,
+             p_sys->stats.i_bitrate_max / 1000,
+             p_sys->stats.i_pcr_interval_max / 1000 );
+    if( p_sys->i_muxrate > 0 )
+        msg_Dbg( p_mux, "jitter up to %"PRId64"us from the %"PRId64"kb/s "
+                 "schedule, %u slices above the mux rate",
+                 p_sys->stats.i_jitter_max, p_sys->i_muxrate / 1000,
+                 p_sys->stats.i_overruns );
+}
+
 static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                     mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
     int i_packet_count = p_chain_ts->i_depth;
+    int i_slot_count = i_packet_count;
 
     if ( i_pcr_length / 1000 > 0 )
     {
@@ -1739,6 +1855,11 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                       i_pcr_dts + p_sys->i_shaping_delay * 3 / 2 - mdate(),
                       i_bitrate, i_packet_count, i_pcr_length);
         }
+        if( p_sys->stats.i_bitrate_min == 0 ||
+            p_sys->stats.i_bitrate_min > i_bitrate )
+            p_sys->stats.i_bitrate_min = i_bitrate;
+        if( p_sys->stats.i_bitrate_max < i_bitrate )
+            p_sys->stats.i_bitrate_max = i_bitrate;
     }
     else
     {
@@ -1747,38 +1868,118 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    if( p_sys->i_muxrate > 0 )
+    {
+        /* Number of packets the slice lasts at the mux rate, the remainder
+         * is carried over so that the long term rate is exact */
+        const int64_t i_packet_bits = 188 * 8 * INT64_C(1000000);
+        int64_t i_bits = p_sys->i_muxrate * i_pcr_length
+                       + p_sys->i_muxrate_frac;
+
+        p_sys->i_muxrate_frac = i_bits % i_packet_bits;
+        if( i_bits / i_packet_bits >= i_packet_count )
+            i_slot_count = i_bits / i_packet_bits;
+        else
+        {
+            msg_Warn( p_mux, "mux rate exceeded (%d packets for %"PRId64
+                      " slots in %"PRId64" us)", i_packet_count,
+                      i_bits / i_packet_bits, i_pcr_length );
+            p_sys->stats.i_overruns++;
+            p_sys->i_muxrate_frac = 0;
+        }
+    }
+
+    if( p_sys->csa != NULL && i_packet_count > 0 )
+    {
+        /* Scramble the whole slice at once, it is much faster */
+        uint8_t *pp_scrambled[i_packet_count];
+        int i_scrambled = 0;
+
+        for( block_t *p_ts = p_chain_ts->p_first; p_ts; p_ts = p_ts->p_next )
+            if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
+                pp_scrambled[i_scrambled++] = p_ts->p_buffer;
+
+        vlc_mutex_lock( &p_sys->csa_lock );
+        csa_EncryptBatch( p_sys->csa, pp_scrambled, i_scrambled,
+                          p_sys->i_csa_pkt_size );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+    }
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
-    for (int i = 0; i < i_packet_count; i++ )
+    int i_sent = 0;
+    for (int i = 0; i < i_slot_count; i++ )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
-        mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
+        block_t *p_ts;
+        mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_slot_count;
+
+        /* Spread the packets evenly among the null ones */
+        if( i_sent < i_packet_count &&
+            (int64_t)i_sent * i_slot_count / i_packet_count == i )
+        {
+            p_ts = BufferChainGet( p_chain_ts );
+            i_sent++;
+        }
+        else
+        {
+            p_ts = TSNull();
+            if( p_ts == NULL )
+                continue;
+            p_sys->stats.i_stuffing++;
+        }
 
         p_ts->i_dts    = i_new_dts;
-        p_ts->i_length = i_pcr_length / i_packet_count;
+        p_ts->i_length = i_pcr_length / i_slot_count;
 
         if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
         {
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->i_dts_delay );
+
+            mtime_t i_interval = p_ts->i_dts - p_sys->stats.i_pcr_last;
+            if( p_sys->stats.i_pcr_last > 0 && i_interval < CLOCK_FREQ &&
+                i_interval > p_sys->stats.i_pcr_interval_max )
+                p_sys->stats.i_pcr_interval_max = i_interval;
+            p_sys->stats.i_pcr_last = p_ts->i_dts;
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
+
+        if( p_sys->i_muxrate > 0 )
         {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
+            mtime_t i_cbr_dts = p_sys->stats.i_cbr_origin +
+                (mtime_t)( p_sys->stats.i_cbr_packets * 1504000000.
+                           / p_sys->i_muxrate );
+            mtime_t i_jitter = p_ts->i_dts > i_cbr_dts
+                             ? p_ts->i_dts - i_cbr_dts : i_cbr_dts - p_ts->i_dts;
+
+            /* Start over after a discontinuity */
+            if( p_sys->stats.i_cbr_packets == 0 || i_jitter > CLOCK_FREQ )
+            {
+                p_sys->stats.i_cbr_origin = p_ts->i_dts;
+                p_sys->stats.i_cbr_packets = 0;
+            }
+            else if( i_jitter > p_sys->stats.i_jitter_max )
+                p_sys->stats.i_jitter_max = i_jitter;
+            p_sys->stats.i_cbr_packets++;
         }
+        p_sys->stats.i_packets++;
 
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
 
         sout_AccessOutWrite( p_mux->p_access, p_ts );
     }
+
+    if( p_sys->stats.i_last_report == 0 )
+        p_sys->stats.i_last_report = i_pcr_dts;
+    else if( i_pcr_dts - p_sys->stats.i_last_report > 10 * CLOCK_FREQ )
+    {
+        TSStatsReport( p_mux );
+        p_sys->stats.i_last_report = i_pcr_dts;
+    }
 }
 
 static block_t *TSNew( sout_mux_t *p_mux, ts_stream_t *p_stream,
                        bool b_pcr )
 {
-    VLC_UNUSED(p_mux);
     block_t *p_pes = p_stream->chain_pes.p_first;
 
     bool b_new_pes = false;
@@ -1862,6 +2063,7 @@ static block_t *TSNew( sout_mux_t *p_mux, ts_stream_t *p_stream,
             &p_pes->p_buffer[p_stream->i_pes_used], i_payload );
 
     p_stream->i_pes_used += i_payload;
+    p_mux->p_sys->stats.i_payload += i_payload;
     p_stream->i_pes_dts = p_pes->i_dts + p_pes->i_length *
         p_stream->i_pes_used / p_pes->i_buffer;
     p_stream->i_pes_length -= p_pes->i_length * i_payload / p_pes->i_buffer;
@@ -1893,13 +2095,19 @@ static block_t *TSNew( sout_mux_t *p_mux, ts_stream_t *p_stream,
 
 static void TSSetPCR( block_t *p_ts, mtime_t i_dts )
 {
-    mtime_t i_pcr = 9 * i_dts / 100;
-
-    p_ts->p_buffer[6]  = ( i_pcr >> 25 )&0xff;
-    p_ts->p_buffer[7]  = ( i_pcr >> 17 )&0xff;
-    p_ts->p_buffer[8]  = ( i_pcr >> 9  )&0xff;
-    p_ts->p_buffer[9]  = ( i_pcr >> 1  )&0xff;
-    p_ts->p_buffer[10]|= ( i_pcr << 7  )&0x80;
+    /* 27 MHz clock: a 90 kHz base and a 300 ticks extension, so that the
+     * rounding of the dts is the only error left (ISO/IEC 13818-1 2.4.2.2
+     * allows 500 ns) */
+    mtime_t i_pcr = 27 * i_dts;
+    mtime_t i_base = i_pcr / 300;
+    int i_ext = i_pcr % 300;
+
+    p_ts->p_buffer[6]  = ( i_base >> 25 )&0xff;
+    p_ts->p_buffer[7]  = ( i_base >> 17 )&0xff;
+    p_ts->p_buffer[8]  = ( i_base >> 9  )&0xff;
+    p_ts->p_buffer[9]  = ( i_base >> 1  )&0xff;
+    p_ts->p_buffer[10]|= ( ( i_base << 7 )&0x80 ) | ( ( i_ext >> 8 )&0x01 );
+    p_ts->p_buffer[11] = i_ext & 0xff;
 }
 
 static void PEStoTS( sout_buffer_chain_t *c, block_t *p_pes,
@@ -93,6 +93,7 @@ struct decoder_sys_t
     /* */
     bool    b_slice;
     block_t *p_frame;
+    block_t **pp_last;
     bool    b_frame_sps;
     bool    b_frame_pps;
 
@@ -130,6 +131,9 @@ struct decoder_sys_t
     cc_data_t cc;
 
     cc_data_t cc_next;
+    /* Closed captions are only extracted once they have been asked for:
+     * when remuxing, SEI only needs to be parsed for recovery points */
+    bool b_need_cc;
 };
 
 enum nal_unit_type_e
@@ -208,6 +212,7 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_slice = false;
     p_sys->p_frame = NULL;
+    p_sys->pp_last = &p_sys->p_frame;
     p_sys->b_frame_sps = false;
     p_sys->b_frame_pps = false;
 
@@ -219,6 +224,7 @@ static int Open( vlc_object_t *p_this )
     for( i = 0; i < PPS_MAX; i++ )
         p_sys->pp_pps[i] = NULL;
     p_sys->i_recovery_frames = -1;
+    p_sys->b_need_cc = false;
 
     p_sys->slice.i_nal_type = -1;
     p_sys->slice.i_nal_ref_idc = -1;
@@ -478,6 +484,8 @@ static block_t *GetCc( decoder_t *p_dec, bool pb_present[4] )
     decoder_sys_t *p_sys = p_dec->p_sys;
     block_t *p_cc;
 
+    p_sys->b_need_cc = true;
+
     for( int i = 0; i < 4; i++ )
         pb_present[i] = p_sys->cc.pb_present[i];
 
@@ -509,6 +517,7 @@ static void PacketizeReset( void *p_private, bool b_broken )
         if( p_sys->p_frame )
             block_ChainRelease( p_sys->p_frame );
         p_sys->p_frame = NULL;
+        p_sys->pp_last = &p_sys->p_frame;
         p_sys->b_frame_sps = false;
         p_sys->b_frame_pps = false;
         p_sys->slice.i_frame_type = 0;
@@ -621,6 +630,7 @@ static block_t *ParseNALBlock( decoder_t *p_dec, bool *pb_used_ts, block_t *p_fr
         /* Reset context */
         p_sys->slice.i_frame_type = 0;
         p_sys->p_frame = NULL;
+        p_sys->pp_last = &p_sys->p_frame;
         p_sys->b_frame_sps = false;
         p_sys->b_frame_pps = false;
         p_sys->b_slice = false;
@@ -677,8 +687,8 @@ static block_t *ParseNALBlock( decoder_t *p_dec, bool *pb_used_ts, block_t *p_fr
         if( p_sys->b_slice )
             p_pic = OutputPicture( p_dec );
 
-        /* Parse SEI for CC support */
-        if( i_nal_type == NAL_SEI )
+        /* Parse SEI for CC support and recovery points */
+        if( i_nal_type == NAL_SEI && ( p_sys->b_need_cc || !p_sys->b_header ) )
         {
             ParseSei( p_dec, p_frag );
         }
@@ -698,7 +708,7 @@ static block_t *ParseNALBlock( decoder_t *p_dec, bool *pb_used_ts, block_t *p_fr
 
     /* Append the block */
     if( p_frag )
-        block_ChainAppend( &p_sys->p_frame, p_frag );
+        block_ChainLastAppend( &p_sys->pp_last, p_frag );
 
     *pb_used_ts = false;
     if( p_sys->i_frame_dts <= VLC_TS_INVALID &&
@@ -778,6 +788,7 @@ static block_t *OutputPicture( decoder_t *p_dec )
 
     p_sys->slice.i_frame_type = 0;
     p_sys->p_frame = NULL;
+    p_sys->pp_last = &p_sys->p_frame;
     p_sys->i_frame_dts = VLC_TS_INVALID;
     p_sys->i_frame_pts = VLC_TS_INVALID;
     p_sys->b_frame_sps = false;
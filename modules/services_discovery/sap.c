@@ -75,6 +75,8 @@
 /* Link-local SAP address */
 #define SAP_V4_LINK_ADDRESS     "224.0.0.255"
 #define ADD_SESSION 1
+/* Buckets of the announces table, indexed by origin and message id hash */
+#define SAP_HASH_SIZE 1024
 
 /*****************************************************************************
  * Module descriptor
@@ -207,8 +209,15 @@ struct sap_announce_t
 
     /* SAP annnounces must only contain one SDP */
     sdp_t       *p_sdp;
+    /* Copy of the SDP text of SAPv0 announces (without message id hash),
+     * to recognize the unchanged announces without parsing them */
+    char        *psz_sdp;
 
     input_item_t * p_item;
+
+    /* Next announce in the same bucket, and index in pp_announces */
+    struct sap_announce_t *p_next;
+    int         i_index;
 };
 
 struct services_discovery_sys_t
@@ -222,6 +231,10 @@ struct services_discovery_sys_t
     /* Table of announces */
     int i_announces;
     struct sap_announce_t **pp_announces;
+    struct sap_announce_t *pp_hash[SAP_HASH_SIZE];
+
+    /* Date of the next check for expired announces */
+    mtime_t i_next_check;
 
     /* Modes */
     bool  b_strict;
@@ -251,6 +264,9 @@ struct demux_sys_t
     static sdp_t *ParseSDP (vlc_object_t *p_sd, const char *psz_sdp);
     static sap_announce_t *CreateAnnounce( services_discovery_t *, uint32_t *, uint16_t, sdp_t * );
     static int RemoveAnnounce( services_discovery_t *p_sd, sap_announce_t *p_announce );
+    static sap_announce_t *FindAnnounce( services_discovery_t *, const uint32_t *,
+                                         uint16_t, const char * );
+    static void RefreshAnnounce( services_discovery_t *, sap_announce_t * );
 
 /* Helper functions */
     static inline attribute_t *MakeAttribute (const char *str);
@@ -310,6 +326,8 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->i_announces = 0;
     p_sys->pp_announces = NULL;
+    memset( p_sys->pp_hash, 0, sizeof(p_sys->pp_hash) );
+    p_sys->i_next_check = 0;
     /* TODO: create sockets here, and fix racy sockets table */
     if (vlc_clone (&p_sys->thread, Run, p_sd, VLC_THREAD_PRIORITY_LOW))
     {
@@ -570,12 +588,20 @@ static void *Run( void *data )
 
         mtime_t now = mdate();
 
+        /* Refreshed announces only expire later, so the table is only
+         * checked again when the earliest expiry computed last time comes */
+        if( now < p_sd->p_sys->i_next_check )
+        {
+            timeout = __MAX( (p_sd->p_sys->i_next_check - now) / 1000, 200 );
+            continue;
+        }
+
         /* A 1 hour timeout correspond to the RFC Implicit timeout.
          * This timeout is tuned in the following loop. */
         timeout = 1000 * 60 * 60;
 
         /* Check for items that need deletion */
-        for( i = 0; i < p_sd->p_sys->i_announces; i++ )
+        for( i = 0; i < p_sd->p_sys->i_announces; )
         {
             mtime_t i_timeout = ( mtime_t ) 1000000 * p_sd->p_sys->i_timeout;
             sap_announce_t * p_announce = p_sd->p_sys->pp_announces[i];
@@ -587,6 +613,7 @@ static void *Run( void *data )
             if( ( p_announce->i_period_trust > 5 && i_last_period > 3 * p_announce->i_period ) ||
                 i_last_period > i_timeout )
             {
+                /* The last announce takes its place in the table */
                 RemoveAnnounce( p_sd, p_announce );
             }
             else
@@ -595,6 +622,7 @@ static void *Run( void *data )
                 if( p_announce->i_period_trust > 5 )
                     timeout = min_int((3 * p_announce->i_period - i_last_period) / 1000, timeout);
                 timeout = min_int((i_timeout - i_last_period)/1000, timeout);
+                i++;
             }
         }
 
@@ -602,6 +630,8 @@ static void *Run( void *data )
             timeout = -1; /* We can safely poll indefinitely. */
         else if( timeout < 200 )
             timeout = 200; /* Don't wakeup too fast. */
+        p_sd->p_sys->i_next_check = timeout >= 0 ? now + (mtime_t)1000 * timeout
+                                                 : INT64_MAX;
     }
     assert (0);
 }
@@ -712,6 +742,20 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
         i_source[3] = U32_AT(buf);
         buf+=4;
     }
+
+    /* The message id hash changes with the SDP (RFC 2974 section 5): the
+     * repetitions of a known announce need not be decompressed nor parsed */
+    if( i_hash != 0 )
+    {
+        sap_announce_t *p_announce = FindAnnounce( p_sd, i_source, i_hash, NULL );
+        if( p_announce != NULL )
+        {
+            if( !b_need_delete )
+                RefreshAnnounce( p_sd, p_announce );
+            return VLC_SUCCESS;
+        }
+    }
+
     // Skips auth data
     buf += auth_len;
     if (buf > end)
@@ -750,22 +794,42 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
         if (strcmp (psz_sdp, "application/sdp"))
         {
             msg_Dbg (p_sd, "unsupported content type: %s", psz_sdp);
+            free (decomp);
             return VLC_EGENERIC;
         }
 
         // skips content type
         if (len <= clen)
+        {
+            free (decomp);
             return VLC_EGENERIC;
+        }
 
         len -= clen;
         psz_sdp += clen;
     }
 
+    /* Without message id hash, an unchanged SDP text is a repetition */
+    if( i_hash == 0 )
+    {
+        sap_announce_t *p_announce = FindAnnounce( p_sd, i_source, 0, psz_sdp );
+        if( p_announce != NULL )
+        {
+            if( !b_need_delete )
+                RefreshAnnounce( p_sd, p_announce );
+            free( decomp );
+            return VLC_SUCCESS;
+        }
+    }
+
     /* Parse SDP info */
     p_sdp = ParseSDP( VLC_OBJECT(p_sd), psz_sdp );
 
     if( p_sdp == NULL )
+    {
+        free( decomp );
         return VLC_EGENERIC;
+    }
 
     p_sdp->psz_sdp = psz_sdp;
 
@@ -785,39 +849,21 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
     if( p_sdp->psz_uri == NULL )
     {
         FreeSDP( p_sdp );
+        free( decomp );
         return VLC_EGENERIC;
     }
 
-    for( i = 0 ; i< p_sd->p_sys->i_announces ; i++ )
+    /* A SAPv0 session keeps its identity when its SDP text changes */
+    for( i = 0 ; !i_hash && i < p_sd->p_sys->i_announces ; i++ )
     {
         sap_announce_t * p_announce = p_sd->p_sys->pp_announces[i];
-        /* FIXME: slow */
-        if( ( !i_hash && IsSameSession( p_announce->p_sdp, p_sdp ) )
-            || ( i_hash && p_announce->i_hash == i_hash
-                 && !memcmp(p_announce->i_source, i_source, sizeof(i_source)) ) )
-        {
-            /* We don't support delete announcement as they can easily
-             * Be used to highjack an announcement by a third party.
-             * Instead we cleverly implement Implicit Announcement removal.
-             *
-             * if( b_need_delete )
-             *    RemoveAnnounce( p_sd, p_sd->p_sys->pp_announces[i]);
-             * else
-             */
 
+        if( !p_announce->i_hash && IsSameSession( p_announce->p_sdp, p_sdp ) )
+        {
             if( !b_need_delete )
-            {
-                /* No need to go after six, as we start to trust the
-                 * average period at six */
-                if( p_announce->i_period_trust <= 5 )
-                    p_announce->i_period_trust++;
-
-                /* Compute the average period */
-                mtime_t now = mdate();
-                p_announce->i_period = ( p_announce->i_period * (p_announce->i_period_trust-1) + (now - p_announce->i_last) ) / p_announce->i_period_trust;
-                p_announce->i_last = now;
-            }
+                RefreshAnnounce( p_sd, p_announce );
             FreeSDP( p_sdp ); p_sdp = NULL;
+            free( decomp );
             return VLC_SUCCESS;
         }
     }
@@ -828,6 +874,60 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
     return VLC_SUCCESS;
 }
 
+static unsigned HashAnnounce( const uint32_t *i_source, uint16_t i_hash )
+{
+    uint32_t h = i_hash;
+
+    for( int i = 0; i < 4; i++ )
+        h = h * 31 + i_source[i];
+    h ^= h >> 16;
+    return h & (SAP_HASH_SIZE - 1);
+}
+
+/* Finds the announce from the same origin with the same message id hash,
+ * or with the same SDP text if there is no hash */
+static sap_announce_t *FindAnnounce( services_discovery_t *p_sd,
+                                     const uint32_t *i_source, uint16_t i_hash,
+                                     const char *psz_sdp )
+{
+    sap_announce_t *p_announce;
+
+    for( p_announce = p_sd->p_sys->pp_hash[HashAnnounce( i_source, i_hash )];
+         p_announce != NULL; p_announce = p_announce->p_next )
+    {
+        if( p_announce->i_hash != i_hash
+         || memcmp( p_announce->i_source, i_source, sizeof(p_announce->i_source) ) )
+            continue;
+        if( i_hash || ( p_announce->psz_sdp && !strcmp( p_announce->psz_sdp, psz_sdp ) ) )
+            break;
+    }
+    return p_announce;
+}
+
+static void RefreshAnnounce( services_discovery_t *p_sd,
+                             sap_announce_t *p_announce )
+{
+    /* We don't support delete announcement as they can easily
+     * Be used to highjack an announcement by a third party.
+     * Instead we cleverly implement Implicit Announcement removal.
+     */
+
+    /* No need to go after six, as we start to trust the
+     * average period at six */
+    if( p_announce->i_period_trust <= 5 )
+        p_announce->i_period_trust++;
+
+    /* Compute the average period */
+    mtime_t now = mdate();
+    p_announce->i_period = ( p_announce->i_period * (p_announce->i_period_trust-1) + (now - p_announce->i_last) ) / p_announce->i_period_trust;
+    p_announce->i_last = now;
+
+    /* A shorter period makes the announce expire sooner */
+    if( p_announce->i_period_trust > 5 )
+        p_sd->p_sys->i_next_check = __MIN( p_sd->p_sys->i_next_check,
+                                           now + 3 * p_announce->i_period );
+}
+
 sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint32_t *i_source, uint16_t i_hash,
                                 sdp_t *p_sdp )
 {
@@ -847,6 +947,7 @@ sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint32_t *i_source,
     p_sap->i_hash = i_hash;
     memcpy (p_sap->i_source, i_source, sizeof(p_sap->i_source));
     p_sap->p_sdp = p_sdp;
+    p_sap->psz_sdp = i_hash ? NULL : strdup( p_sdp->psz_sdp );
 
     /* Released in RemoveAnnounce */
     p_input = input_item_NewWithType( p_sap->p_sdp->psz_uri,
@@ -858,6 +959,7 @@ sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint32_t *i_source,
     p_sap->p_item = p_input;
     if( !p_input )
     {
+        free( p_sap->psz_sdp );
         free( p_sap );
         return NULL;
     }
@@ -905,8 +1007,16 @@ sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint32_t *i_source,
         services_discovery_AddItem(p_sd, p_input, psz_value);
     }
 
+    unsigned i_bucket = HashAnnounce( i_source, i_hash );
+    p_sap->p_next = p_sys->pp_hash[i_bucket];
+    p_sys->pp_hash[i_bucket] = p_sap;
+    p_sap->i_index = p_sys->i_announces;
     TAB_APPEND( p_sys->i_announces, p_sys->pp_announces, p_sap );
 
+    /* The new announce expires at the latest after the implicit timeout */
+    p_sys->i_next_check = __MIN( p_sys->i_next_check,
+                                 p_sap->i_last + (mtime_t)1000000 * p_sys->i_timeout );
+
     return p_sap;
 }
 
@@ -1548,7 +1658,7 @@ static void FreeSDP( sdp_t *p_sdp )
 static int RemoveAnnounce( services_discovery_t *p_sd,
                            sap_announce_t *p_announce )
 {
-    int i;
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
 
     if( p_announce->p_sdp )
     {
@@ -1563,16 +1673,18 @@ static int RemoveAnnounce( services_discovery_t *p_sd,
         p_announce->p_item = NULL;
     }
 
-    for( i = 0; i< p_sd->p_sys->i_announces; i++)
-    {
-        if( p_sd->p_sys->pp_announces[i] == p_announce )
-        {
-            REMOVE_ELEM( p_sd->p_sys->pp_announces, p_sd->p_sys->i_announces,
-                         i);
-            break;
-        }
-    }
+    sap_announce_t **pp = &p_sys->pp_hash[HashAnnounce( p_announce->i_source,
+                                                          p_announce->i_hash )];
+    while( *pp != p_announce )
+        pp = &(*pp)->p_next;
+    *pp = p_announce->p_next;
+
+    /* The last announce takes the place of the removed one */
+    sap_announce_t *p_last = p_sys->pp_announces[--p_sys->i_announces];
+    p_sys->pp_announces[p_announce->i_index] = p_last;
+    p_last->i_index = p_announce->i_index;
 
+    free( p_announce->psz_sdp );
     free( p_announce );
 
     return VLC_SUCCESS;
@@ -39,6 +39,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <algorithm>
 
 /*
  * Constants
@@ -46,6 +47,11 @@
 const char* MEDIA_SERVER_DEVICE_TYPE = "urn:schemas-upnp-org:device:MediaServer:1";
 const char* CONTENT_DIRECTORY_SERVICE_TYPE = "urn:schemas-upnp-org:service:ContentDirectory:1";
 
+/* Containers are browsed by this many threads at once, each one paging
+ * through the children of a container BROWSE_PAGE_SIZE at a time */
+#define BROWSE_WORKERS   4
+#define BROWSE_PAGE_SIZE 500
+
 /*
  * VLC handle
  */
@@ -338,6 +344,11 @@ static int Callback( Upnp_EventType event_type, void* p_event, void* p_user_data
     {
         struct Upnp_Discovery* p_discovery = ( struct Upnp_Discovery* )p_event;
 
+        /* Servers announce themselves periodically: do not download the
+         * description of a known server again */
+        if ( p_sys->p_server_list->getServer( p_discovery->DeviceId ) )
+            break;
+
         IXML_Document *p_description_doc = 0;
 
         int i_res;
@@ -371,7 +382,7 @@ static int Callback( Upnp_EventType event_type, void* p_event, void* p_user_data
         Upnp_Event* p_e = ( Upnp_Event* )p_event;
 
         MediaServer* p_server = p_sys->p_server_list->getServerBySID( p_e->Sid );
-        if ( p_server ) p_server->fetchContents();
+        if ( p_server ) p_server->handleEvent( p_e->ChangedVariables );
     }
     break;
 
@@ -604,11 +615,17 @@ MediaServer::MediaServer( const char* psz_udn,
     _p_contents = NULL;
     _p_input_item = NULL;
     _i_content_directory_service_version = 1;
+
+    _i_browse_busy = 0;
+    vlc_mutex_init( &_browse_lock );
+    vlc_cond_init( &_browse_wait );
 }
 
 MediaServer::~MediaServer()
 {
     delete _p_contents;
+    vlc_cond_destroy( &_browse_wait );
+    vlc_mutex_destroy( &_browse_lock );
 }
 
 const char* MediaServer::getUDN() const
@@ -793,7 +810,7 @@ void MediaServer::fetchContents()
 
     Container* root = new Container( 0, "0", getFriendlyName() );
 
-    _fetchContents( root, 0 );
+    _browse( std::vector<Container*>( 1, root ) );
 
     _p_contents = root;
     _p_contents->setInputItem( _p_input_item );
@@ -802,154 +819,308 @@ void MediaServer::fetchContents()
 }
 
 /*
- * Fetches and parses the UPNP response
+ * Handles a ContentDirectory event. Only the containers whose update ID
+ * changed are browsed again; everything is if only the system update ID
+ * changed.
  */
-bool MediaServer::_fetchContents( Container* p_parent, int i_offset )
+void MediaServer::handleEvent( IXML_Document* p_doc )
 {
-    if (!p_parent)
+    const char* psz_system_update_id = NULL;
+    const char* psz_container_update_ids = NULL;
+    if ( p_doc )
     {
-        msg_Err( _p_sd, "No parent" );
-        return false;
+        psz_system_update_id = xml_getChildElementValue( p_doc,
+                                                         "SystemUpdateID" );
+        psz_container_update_ids = xml_getChildElementValue( p_doc,
+                                                      "ContainerUpdateIDs" );
     }
 
-    char* psz_starting_index;
-    if( asprintf( &psz_starting_index, "%d", i_offset ) < 0 )
+    /* The first event is sent on subscription, before our first browse
+     * completes: it only tells the current update IDs */
+    bool b_initial = _system_update_id.empty();
+    bool b_full = false;
+    std::vector<Container*> changed;
+
+    if ( psz_container_update_ids && _p_contents )
     {
-        msg_Err( _p_sd, "asprintf error:%d", i_offset );
-        return false;
+        /* Comma separated list of (object ID, update ID) pairs,
+         * where commas in IDs are escaped by a backslash */
+        std::vector<std::string> fields( 1 );
+        for ( const char* p = psz_container_update_ids; *p; p++ )
+        {
+            if ( *p == '\\' && p[1] )
+                fields.back() += *++p;
+            else if ( *p == ',' )
+                fields.push_back( std::string() );
+            else
+                fields.back() += *p;
+        }
+
+        for ( unsigned int i = 0; i + 1 < fields.size(); i += 2 )
+        {
+            Container* p_container =
+                _p_contents->findContainer( fields[i].c_str() );
+            if ( !p_container ||
+                 fields[i + 1] == p_container->getUpdateID() )
+                continue;
+
+            p_container->setUpdateID( fields[i + 1].c_str() );
+            if ( !b_initial &&
+                 std::find( changed.begin(), changed.end(), p_container )
+                    == changed.end() )
+                changed.push_back( p_container );
+        }
     }
+    else if ( psz_system_update_id && !b_initial )
+        b_full = ( _system_update_id != psz_system_update_id );
 
-    IXML_Document* p_response = _browseAction( p_parent->getObjectID(),
-                                      "BrowseDirectChildren",
-                                      "id,dc:title,res," /* Filter */
-                                      "sec:CaptionInfo,sec:CaptionInfoEx",
-                                      psz_starting_index, /* StartingIndex */
-                                      "0", /* RequestedCount */
-                                      "" /* SortCriteria */
-                                      );
-    free( psz_starting_index );
-    if ( !p_response )
+    if ( psz_system_update_id )
+        _system_update_id = psz_system_update_id;
+
+    if ( b_full || !_p_contents )
+        fetchContents();
+    else if ( !changed.empty() )
+        _refreshContainers( changed );
+}
+
+/*
+ * Browses the given containers again, keeping the subtrees of their child
+ * containers that are still there.
+ */
+void MediaServer::_refreshContainers( const std::vector<Container*>& containers )
+{
+    for ( unsigned int i = 0; i < containers.size(); i++ )
+        containers[i]->beginUpdate();
+
+    _browse( containers );
+
+    /* Gather everything before deleting anything, as a stale container may
+     * be one of the refreshed ones */
+    std::vector<Container*> stale;
+    for ( unsigned int i = 0; i < containers.size(); i++ )
+        containers[i]->endUpdate( stale );
+    for ( unsigned int i = 0; i < stale.size(); i++ )
+        delete stale[i];
+
+    services_discovery_RemoveItem( _p_sd, _p_input_item );
+    services_discovery_AddItem( _p_sd, _p_input_item, NULL );
+    _buildPlaylist( _p_contents, NULL );
+}
+
+/*
+ * Browses the given containers and the containers found in them, with up to
+ * BROWSE_WORKERS threads.
+ */
+void MediaServer::_browse( const std::vector<Container*>& containers )
+{
+    vlc_mutex_lock( &_browse_lock );
+    _browse_queue = containers;
+    _i_browse_busy = 0;
+    vlc_mutex_unlock( &_browse_lock );
+
+    vlc_thread_t threads[BROWSE_WORKERS];
+    unsigned int i_threads = 0;
+    for ( unsigned int i = 0; i < BROWSE_WORKERS; i++ )
+        if ( !vlc_clone( &threads[i_threads], _browseThread, this,
+                         VLC_THREAD_PRIORITY_LOW ) )
+            i_threads++;
+
+    if ( i_threads == 0 )
+        _browseThread( this );
+    for ( unsigned int i = 0; i < i_threads; i++ )
+        vlc_join( threads[i], NULL );
+}
+
+void* MediaServer::_browseThread( void* p_data )
+{
+    MediaServer* p_server = ( MediaServer* )p_data;
+
+    vlc_mutex_lock( &p_server->_browse_lock );
+    for ( ;; )
+    {
+        while ( p_server->_browse_queue.empty() && p_server->_i_browse_busy > 0 )
+            vlc_cond_wait( &p_server->_browse_wait, &p_server->_browse_lock );
+
+        /* Nothing left to browse, and nobody to find more */
+        if ( p_server->_browse_queue.empty() )
+            break;
+
+        Container* p_container = p_server->_browse_queue.back();
+        p_server->_browse_queue.pop_back();
+        p_server->_i_browse_busy++;
+        vlc_mutex_unlock( &p_server->_browse_lock );
+
+        p_server->_fetchContents( p_container );
+
+        vlc_mutex_lock( &p_server->_browse_lock );
+        p_server->_i_browse_busy--;
+        vlc_cond_broadcast( &p_server->_browse_wait );
+    }
+    vlc_mutex_unlock( &p_server->_browse_lock );
+    return NULL;
+}
+
+/*
+ * Fetches and parses the UPNP responses for the children of a container.
+ * Child containers are queued for browsing.
+ */
+bool MediaServer::_fetchContents( Container* p_parent )
+{
+    if (!p_parent)
     {
-        msg_Err( _p_sd, "No response from browse() action" );
+        msg_Err( _p_sd, "No parent" );
         return false;
     }
 
-    IXML_Document* p_result = parseBrowseResult( p_response );
-    int i_number_returned = xml_getNumber( p_response, "NumberReturned" );
-    int i_total_matches   = xml_getNumber( p_response , "TotalMatches" );
+    int i_offset = 0;
+    for ( ;; )
+    {
+        char psz_starting_index[16], psz_requested_count[16];
+        snprintf( psz_starting_index, sizeof( psz_starting_index ),
+                  "%d", i_offset );
+        snprintf( psz_requested_count, sizeof( psz_requested_count ),
+                  "%d", BROWSE_PAGE_SIZE );
+
+        IXML_Document* p_response = _browseAction( p_parent->getObjectID(),
+                                          "BrowseDirectChildren",
+                                          "id,dc:title,res," /* Filter */
+                                          "sec:CaptionInfo,sec:CaptionInfoEx",
+                                          psz_starting_index, /* StartingIndex */
+                                          psz_requested_count, /* RequestedCount */
+                                          "" /* SortCriteria */
+                                          );
+        if ( !p_response )
+        {
+            msg_Err( _p_sd, "No response from browse() action" );
+            return false;
+        }
+
+        IXML_Document* p_result = parseBrowseResult( p_response );
+        int i_number_returned = xml_getNumber( p_response, "NumberReturned" );
+        int i_total_matches   = xml_getNumber( p_response , "TotalMatches" );
 
 #ifndef NDEBUG
-    msg_Dbg( _p_sd, "i_offset[%d]i_number_returned[%d]_total_matches[%d]\n",
-             i_offset, i_number_returned, i_total_matches );
+        msg_Dbg( _p_sd, "i_offset[%d]i_number_returned[%d]_total_matches[%d]\n",
+                 i_offset, i_number_returned, i_total_matches );
 #endif
 
-    ixmlDocument_free( p_response );
+        ixmlDocument_free( p_response );
 
-    if ( !p_result )
-    {
-        msg_Err( _p_sd, "browse() response parsing failed" );
-        return false;
-    }
+        if ( !p_result )
+        {
+            msg_Err( _p_sd, "browse() response parsing failed" );
+            return false;
+        }
 
 #ifndef NDEBUG
-    msg_Dbg( _p_sd, "Got DIDL document: %s", ixmlPrintDocument( p_result ) );
+        msg_Dbg( _p_sd, "Got DIDL document: %s", ixmlPrintDocument( p_result ) );
 #endif
 
-    IXML_NodeList* containerNodeList =
-                ixmlDocument_getElementsByTagName( p_result, "container" );
+        IXML_NodeList* containerNodeList =
+                    ixmlDocument_getElementsByTagName( p_result, "container" );
 
-    if ( containerNodeList )
-    {
-        for ( unsigned int i = 0;
-                i < ixmlNodeList_length( containerNodeList ); i++ )
+        if ( containerNodeList )
         {
-            IXML_Element* containerElement =
-                  ( IXML_Element* )ixmlNodeList_item( containerNodeList, i );
+            for ( unsigned int i = 0;
+                    i < ixmlNodeList_length( containerNodeList ); i++ )
+            {
+                IXML_Element* containerElement =
+                      ( IXML_Element* )ixmlNodeList_item( containerNodeList, i );
 
-            const char* objectID = ixmlElement_getAttribute( containerElement,
-                                                             "id" );
-            if ( !objectID )
-                continue;
+                const char* objectID = ixmlElement_getAttribute( containerElement,
+                                                                 "id" );
+                if ( !objectID )
+                    continue;
 
-            const char* title = xml_getChildElementValue( containerElement,
-                                                          "dc:title" );
+                const char* title = xml_getChildElementValue( containerElement,
+                                                              "dc:title" );
 
-            if ( !title )
-                continue;
+                if ( !title )
+                    continue;
+
+                Container* container = p_parent->reuseContainer( objectID, title );
+                if ( !container )
+                {
+                    container = new Container( p_parent, objectID, title );
 
-            Container* container = new Container( p_parent, objectID, title );
-            p_parent->addContainer( container );
-            _fetchContents( container, 0 );
+                    vlc_mutex_lock( &_browse_lock );
+                    _browse_queue.push_back( container );
+                    vlc_cond_signal( &_browse_wait );
+                    vlc_mutex_unlock( &_browse_lock );
+                }
+                p_parent->addContainer( container );
+            }
+            ixmlNodeList_free( containerNodeList );
         }
-        ixmlNodeList_free( containerNodeList );
-    }
 
-    IXML_NodeList* itemNodeList = ixmlDocument_getElementsByTagName( p_result,
-                                                                     "item" );
-    if ( itemNodeList )
-    {
-        for ( unsigned int i = 0; i < ixmlNodeList_length( itemNodeList ); i++ )
+        IXML_NodeList* itemNodeList = ixmlDocument_getElementsByTagName( p_result,
+                                                                         "item" );
+        if ( itemNodeList )
         {
-            IXML_Element* itemElement =
-                        ( IXML_Element* )ixmlNodeList_item( itemNodeList, i );
+            for ( unsigned int i = 0; i < ixmlNodeList_length( itemNodeList ); i++ )
+            {
+                IXML_Element* itemElement =
+                            ( IXML_Element* )ixmlNodeList_item( itemNodeList, i );
 
-            const char* objectID =
-                        ixmlElement_getAttribute( itemElement, "id" );
+                const char* objectID =
+                            ixmlElement_getAttribute( itemElement, "id" );
 
-            if ( !objectID )
-                continue;
+                if ( !objectID )
+                    continue;
 
-            const char* title =
-                        xml_getChildElementValue( itemElement, "dc:title" );
+                const char* title =
+                            xml_getChildElementValue( itemElement, "dc:title" );
 
-            if ( !title )
-                continue;
+                if ( !title )
+                    continue;
 
-            const char* psz_subtitles = xml_getChildElementValue( itemElement,
-                    "sec:CaptionInfo" );
+                const char* psz_subtitles = xml_getChildElementValue( itemElement,
+                        "sec:CaptionInfo" );
 
-            if ( !psz_subtitles )
-                psz_subtitles = xml_getChildElementValue( itemElement,
-                        "sec:CaptionInfoEx" );
+                if ( !psz_subtitles )
+                    psz_subtitles = xml_getChildElementValue( itemElement,
+                            "sec:CaptionInfoEx" );
 
-            /* Try to extract all resources in DIDL */
-            IXML_NodeList* p_resource_list = ixmlDocument_getElementsByTagName( (IXML_Document*) itemElement, "res" );
-            if ( p_resource_list )
-            {
-                int i_length = ixmlNodeList_length( p_resource_list );
-                for ( int i = 0; i < i_length; i++ )
+                /* Try to extract all resources in DIDL */
+                IXML_NodeList* p_resource_list = ixmlDocument_getElementsByTagName( (IXML_Document*) itemElement, "res" );
+                if ( p_resource_list )
                 {
-                    mtime_t i_duration = -1;
-                    int i_hours, i_minutes, i_seconds;
-                    IXML_Element* p_resource = ( IXML_Element* ) ixmlNodeList_item( p_resource_list, i );
-                    const char* psz_resource_url = xml_getChildElementValue( p_resource, "res" );
-                    if( !psz_resource_url )
-                        continue;
-                    const char* psz_duration = ixmlElement_getAttribute( p_resource, "duration" );
-
-                    if ( psz_duration )
+                    int i_length = ixmlNodeList_length( p_resource_list );
+                    for ( int i = 0; i < i_length; i++ )
                     {
-                        if( sscanf( psz_duration, "%d:%02d:%02d",
-                            &i_hours, &i_minutes, &i_seconds ) )
-                            i_duration = INT64_C(1000000) * ( i_hours*3600 +
-                                                              i_minutes*60 +
-                                                              i_seconds );
-                    }
+                        mtime_t i_duration = -1;
+                        int i_hours, i_minutes, i_seconds;
+                        IXML_Element* p_resource = ( IXML_Element* ) ixmlNodeList_item( p_resource_list, i );
+                        const char* psz_resource_url = xml_getChildElementValue( p_resource, "res" );
+                        if( !psz_resource_url )
+                            continue;
+                        const char* psz_duration = ixmlElement_getAttribute( p_resource, "duration" );
+
+                        if ( psz_duration )
+                        {
+                            if( sscanf( psz_duration, "%d:%02d:%02d",
+                                &i_hours, &i_minutes, &i_seconds ) )
+                                i_duration = INT64_C(1000000) * ( i_hours*3600 +
+                                                                  i_minutes*60 +
+                                                                  i_seconds );
+                        }
 
-                    Item* item = new Item( p_parent, objectID, title, psz_resource_url, psz_subtitles, i_duration );
-                    p_parent->addItem( item );
+                        Item* item = new Item( p_parent, objectID, title, psz_resource_url, psz_subtitles, i_duration );
+                        p_parent->addItem( item );
+                    }
+                    ixmlNodeList_free( p_resource_list );
                 }
-                ixmlNodeList_free( p_resource_list );
+                else continue;
             }
-            else continue;
+            ixmlNodeList_free( itemNodeList );
         }
-        ixmlNodeList_free( itemNodeList );
-    }
 
-    ixmlDocument_free( p_result );
+        ixmlDocument_free( p_result );
 
-    if( i_offset + i_number_returned < i_total_matches )
-        return _fetchContents( p_parent, i_offset + i_number_returned );
+        i_offset += i_number_returned;
+        if( i_number_returned <= 0 || i_offset >= i_total_matches )
+            break;
+    }
 
     return true;
 }
@@ -1304,6 +1475,11 @@ Container::~Container()
         delete _containers[i];
     }
 
+    for ( unsigned int i = 0; i < _stale.size(); i++ )
+    {
+        delete _stale[i];
+    }
+
     for ( unsigned int i = 0; i < _items.size(); i++ )
     {
         delete _items[i];
@@ -1323,6 +1499,65 @@ void Container::addContainer( Container* p_container )
     _containers.push_back( p_container );
 }
 
+/*
+ * Prepares the container to be browsed again: the items are dropped, and
+ * the child containers are put aside to be reused.
+ */
+void Container::beginUpdate()
+{
+    for ( unsigned int i = 0; i < _items.size(); i++ )
+    {
+        delete _items[i];
+    }
+    _items.clear();
+
+    _stale.insert( _stale.end(), _containers.begin(), _containers.end() );
+    _containers.clear();
+}
+
+/*
+ * Returns the child container put aside by beginUpdate() with that object
+ * ID and title, if any.
+ */
+Container* Container::reuseContainer( const char* psz_object_id,
+                                      const char* psz_title )
+{
+    std::vector<Container*>::iterator it;
+    for ( it = _stale.begin(); it != _stale.end(); ++it )
+    {
+        if ( (*it)->_objectID == psz_object_id && (*it)->_title == psz_title )
+        {
+            Container* p_container = *it;
+            _stale.erase( it );
+            return p_container;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Hands the child containers that were not found again to the caller.
+ */
+void Container::endUpdate( std::vector<Container*>& stale )
+{
+    stale.insert( stale.end(), _stale.begin(), _stale.end() );
+    _stale.clear();
+}
+
+Container* Container::findContainer( const char* psz_object_id )
+{
+    if ( _objectID == psz_object_id )
+        return this;
+
+    for ( unsigned int i = 0; i < _containers.size(); i++ )
+    {
+        Container* p_container = _containers[i]->findContainer( psz_object_id );
+        if ( p_container )
+            return p_container;
+    }
+    return NULL;
+}
+
 const char* Container::getObjectID() const
 {
     return _objectID.c_str();
@@ -1333,6 +1568,16 @@ const char* Container::getTitle() const
     return _title.c_str();
 }
 
+void Container::setUpdateID( const char* psz_update_id )
+{
+    _updateID = psz_update_id;
+}
+
+const char* Container::getUpdateID() const
+{
+    return _updateID.c_str();
+}
+
 unsigned int Container::getNumItems() const
 {
     return _items.size();
@@ -61,6 +61,7 @@ public:
 
     void subscribeToContentDirectory();
     void fetchContents();
+    void handleEvent( IXML_Document* p_changed_variables );
 
     void setInputItem( input_item_t* p_input_item );
     input_item_t* getInputItem() const;
@@ -69,7 +70,10 @@ public:
 
 private:
 
-    bool _fetchContents( Container* p_parent, int i_starting_index );
+    bool _fetchContents( Container* p_parent );
+    void _browse( const std::vector<Container*>& containers );
+    static void* _browseThread( void* p_data );
+    void _refreshContainers( const std::vector<Container*>& containers );
     void _buildPlaylist( Container* p_container, input_item_node_t *p_item_node );
 
     IXML_Document* _browseAction( const char*, const char*,
@@ -89,6 +93,13 @@ private:
     int _i_subscription_timeout;
     int _i_content_directory_service_version;
     Upnp_SID _subscription_id;
+    std::string _system_update_id;
+
+    /* containers waiting to be browsed, and browsing workers */
+    std::vector<Container*> _browse_queue;
+    unsigned int _i_browse_busy;
+    vlc_mutex_t _browse_lock;
+    vlc_cond_t _browse_wait;
 };
 
 
@@ -158,9 +169,17 @@ public:
     void addItem( Item* item );
     void addContainer( Container* container );
 
+    void beginUpdate();
+    Container* reuseContainer( const char* objectID, const char* title );
+    void endUpdate( std::vector<Container*>& stale );
+    Container* findContainer( const char* objectID );
+
     const char* getObjectID() const;
     const char* getTitle() const;
 
+    void setUpdateID( const char* updateID );
+    const char* getUpdateID() const;
+
     unsigned int getNumItems() const;
     unsigned int getNumContainers() const;
 
@@ -179,7 +198,9 @@ private:
 
     std::string _objectID;
     std::string _title;
+    std::string _updateID;
     std::vector<Item*> _items;
     std::vector<Container*> _containers;
+    std::vector<Container*> _stale; /* children from before the update */
 };
 
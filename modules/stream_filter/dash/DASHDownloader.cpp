@@ -58,24 +58,17 @@ void*       DASHDownloader::download    (void *thread_sys)
     thread_sys_t            *t_sys              = (thread_sys_t *) thread_sys;
     HTTPConnectionManager   *conManager         = t_sys->conManager;
     BlockBuffer             *buffer             = t_sys->buffer;
-    block_t                 *block              = block_Alloc(BLOCKSIZE);
-    int                     ret                 = 0;
+    block_t                 *block              = NULL;
 
     do
     {
-        ret = conManager->read(block);
-        if(ret > 0)
-        {
-            block_t *bufBlock = block_Alloc(ret);
-            memcpy(bufBlock->p_buffer, block->p_buffer, ret);
-
-            bufBlock->i_length = block->i_length;
-            buffer->put(bufBlock);
-        }
-    }while(ret && !buffer->getEOF());
+        /* The blocks are moved to the buffer without copying them */
+        block = conManager->read();
+        if(block != NULL)
+            buffer->put(block);
+    }while(block != NULL && !buffer->getEOF());
 
     buffer->setEOF(true);
-    block_Release(block);
 
     return NULL;
 }
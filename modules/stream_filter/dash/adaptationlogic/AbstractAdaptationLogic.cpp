@@ -26,6 +26,7 @@
 #endif
 
 #include "AbstractAdaptationLogic.h"
+#include "AdaptationLogicFactory.h"
 
 using namespace dash::logic;
 using namespace dash::xml;
@@ -37,12 +38,15 @@ AbstractAdaptationLogic::AbstractAdaptationLogic    (IMPDManager *mpdManager, st
                          mpdManager                 (mpdManager),
                          stream                     (stream),
                          bufferedMicroSec           (0),
-                         bufferedPercent            (0)
+                         bufferedPercent            (0),
+                         bpsEstimate                (0)
 
 {
+    this->estimator = AdaptationLogicFactory::createEstimator(stream);
 }
 AbstractAdaptationLogic::~AbstractAdaptationLogic   ()
 {
+    delete this->estimator;
 }
 
 void AbstractAdaptationLogic::bufferLevelChanged     (mtime_t bufferedMicroSec, int bufferedPercent)
@@ -55,6 +59,11 @@ void AbstractAdaptationLogic::downloadRateChanged    (uint64_t bpsAvg, uint64_t
     this->bpsAvg        = bpsAvg;
     this->bpsLastChunk  = bpsLastChunk;
 }
+void AbstractAdaptationLogic::chunkDownloaded        (uint64_t bytes, mtime_t time)
+{
+    this->estimator->addSample(bytes, time);
+    this->bpsEstimate = this->estimator->getEstimate();
+}
 uint64_t AbstractAdaptationLogic::getBpsAvg          () const
 {
     return this->bpsAvg;
@@ -67,3 +76,14 @@ int AbstractAdaptationLogic::getBufferPercent        () const
 {
     return this->bufferedPercent;
 }
+mtime_t AbstractAdaptationLogic::getBufferedMicroSec  () const
+{
+    return this->bufferedMicroSec;
+}
+uint64_t AbstractAdaptationLogic::getBpsEstimate     () const
+{
+    if(this->bpsEstimate == 0)
+        return this->getBpsAvg();
+
+    return this->bpsEstimate;
+}
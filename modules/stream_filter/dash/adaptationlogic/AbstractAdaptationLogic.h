@@ -26,6 +26,7 @@
 #define ABSTRACTADAPTATIONLOGIC_H_
 
 #include "adaptationlogic/IAdaptationLogic.h"
+#include "adaptationlogic/IThroughputEstimator.h"
 #include "xml/Node.h"
 #include "http/Chunk.h"
 #include "mpd/MPD.h"
@@ -47,11 +48,18 @@ namespace dash
                 virtual ~AbstractAdaptationLogic    ();
 
                 virtual void                downloadRateChanged     (uint64_t bpsAvg, uint64_t bpsLastChunk);
+                virtual void                chunkDownloaded         (uint64_t bytes, mtime_t time);
                 virtual void                bufferLevelChanged      (mtime_t bufferedMicroSec, int bufferedPercent);
 
                 uint64_t                    getBpsAvg               () const;
                 uint64_t                    getBpsLastChunk         () const;
                 int                         getBufferPercent        () const;
+                mtime_t                     getBufferedMicroSec     () const;
+                /**
+                 *  \return     The estimated bitrate in bits per second,
+                 *              the average one until a chunk was downloaded.
+                 */
+                uint64_t                    getBpsEstimate          () const;
 
             private:
                 int                     bpsAvg;
@@ -60,6 +68,8 @@ namespace dash
                 stream_t                *stream;
                 mtime_t                 bufferedMicroSec;
                 int                     bufferedPercent;
+                IThroughputEstimator    *estimator;
+                uint64_t                bpsEstimate;
         };
     }
 }
@@ -26,6 +26,10 @@
 #endif
 
 #include "AdaptationLogicFactory.h"
+#include "EWMAThroughputEstimator.h"
+#include "HarmonicThroughputEstimator.h"
+
+#include <vlc_stream.h>
 
 using namespace dash::logic;
 using namespace dash::xml;
@@ -38,9 +42,23 @@ IAdaptationLogic* AdaptationLogicFactory::create ( IAdaptationLogic::LogicType l
     {
         case IAdaptationLogic::AlwaysBest:      return new AlwaysBestAdaptationLogic    (mpdManager, stream);
         case IAdaptationLogic::RateBased:       return new RateBasedAdaptationLogic     (mpdManager, stream);
+        case IAdaptationLogic::BufferBased:     return new BufferBasedAdaptationLogic   (mpdManager, stream);
         case IAdaptationLogic::Default:
         case IAdaptationLogic::AlwaysLowest:
         default:
             return NULL;
     }
 }
+IThroughputEstimator* AdaptationLogicFactory::createEstimator (stream_t *stream)
+{
+    char *name = var_InheritString(stream, "dash-estimator");
+    IThroughputEstimator *estimator;
+
+    if(name != NULL && !strcmp(name, "harmonic"))
+        estimator = new HarmonicThroughputEstimator();
+    else
+        estimator = new EWMAThroughputEstimator();
+
+    free(name);
+    return estimator;
+}
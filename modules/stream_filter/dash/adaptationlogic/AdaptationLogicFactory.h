@@ -30,6 +30,8 @@
 #include "mpd/IMPDManager.h"
 #include "adaptationlogic/AlwaysBestAdaptationLogic.h"
 #include "adaptationlogic/RateBasedAdaptationLogic.h"
+#include "adaptationlogic/BufferBasedAdaptationLogic.h"
+#include "adaptationlogic/IThroughputEstimator.h"
 
 struct stream_t;
 
@@ -40,7 +42,8 @@ namespace dash
         class AdaptationLogicFactory
         {
             public:
-                static IAdaptationLogic* create (IAdaptationLogic::LogicType logic, dash::mpd::IMPDManager *mpdManager, stream_t *stream);
+                static IAdaptationLogic*        create          (IAdaptationLogic::LogicType logic, dash::mpd::IMPDManager *mpdManager, stream_t *stream);
+                static IThroughputEstimator*    createEstimator (stream_t *stream);
         };
     }
 }
@@ -0,0 +1,141 @@
+/*
+ * BufferBasedAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "BufferBasedAdaptationLogic.h"
+#include "buffer/BlockBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace dash::logic;
+using namespace dash::http;
+using namespace dash::mpd;
+
+/* Weight of the rebuffering penalty against the quality, in segments */
+const double    BufferBasedAdaptationLogic::GAMMAP                  = 5.;
+const mtime_t   BufferBasedAdaptationLogic::DEFAULTSEGMENTDURATION  = 2 * CLOCK_FREQ;
+
+static bool compareBandwidth (const Representation *a, const Representation *b)
+{
+    return a->getBandwidth() < b->getBandwidth();
+}
+
+BufferBasedAdaptationLogic::BufferBasedAdaptationLogic  (IMPDManager *mpdManager, stream_t *stream) :
+                            RateBasedAdaptationLogic    (mpdManager, stream),
+                            segmentDuration             (DEFAULTSEGMENTDURATION),
+                            lastBitrate                 (0)
+{
+    this->bufferCapacity = var_InheritInteger(stream, "dash-buffersize") * CLOCK_FREQ;
+    if(this->bufferCapacity <= 0)
+        this->bufferCapacity = DEFAULTBUFFERLENGTH;
+}
+
+Chunk*  BufferBasedAdaptationLogic::getNextChunk()
+{
+    Chunk *chunk = RateBasedAdaptationLogic::getNextChunk();
+
+    if(chunk != NULL && chunk->getDuration() > 0)
+        this->segmentDuration = chunk->getDuration();
+
+    return chunk;
+}
+
+std::vector<Representation *> BufferBasedAdaptationLogic::getCandidates() const
+{
+    /* Same candidates as IMPDManager::getRepresentation() */
+    std::vector<AdaptationSet *> adaptationSets = this->currentPeriod->getAdaptationSets();
+    std::vector<Representation *> all, matching;
+
+    for(size_t i = 0; i < adaptationSets.size(); i++)
+    {
+        std::vector<Representation *> reps = adaptationSets.at(i)->getRepresentations();
+        for(size_t j = 0; j < reps.size(); j++)
+        {
+            all.push_back(reps.at(j));
+            if(reps.at(j)->getWidth() == this->width && reps.at(j)->getHeight() == this->height)
+                matching.push_back(reps.at(j));
+        }
+    }
+
+    std::vector<Representation *> &candidates = matching.size() > 0 ? matching : all;
+    std::sort(candidates.begin(), candidates.end(), compareBandwidth);
+    return candidates;
+}
+
+Representation *BufferBasedAdaptationLogic::selectRepresentation()
+{
+    std::vector<Representation *> reps = this->getCandidates();
+
+    if(reps.size() == 0)
+        return NULL;
+
+    double  minBitrate  = reps.front()->getBandwidth();
+    double  maxBitrate  = reps.back()->getBandwidth();
+    if(minBitrate <= 0 || reps.size() == 1)
+        return reps.front();
+
+    /* Buffer level and capacity in segments */
+    double  level       = (double)this->getBufferedMicroSec() / this->segmentDuration;
+    double  capacity    = (double)this->bufferCapacity / this->segmentDuration;
+    if(capacity < 2.)
+        capacity = 2.;
+
+    /* Maximizes (V * (utility + gp) - level) / bitrate,
+     * with the utility ln(bitrate / min) */
+    double  V           = (capacity - 1.) / (log(maxBitrate / minBitrate) + GAMMAP);
+    size_t  best        = 0;
+    double  bestScore   = 0.;
+
+    for(size_t i = 0; i < reps.size(); i++)
+    {
+        double bitrate  = reps.at(i)->getBandwidth();
+        double score    = (V * (log(bitrate / minBitrate) + GAMMAP) - level) / bitrate;
+
+        if(i == 0 || score > bestScore)
+        {
+            best      = i;
+            bestScore = score;
+        }
+    }
+
+    /* Do not switch up past what the network sustains, unless the buffer
+     * alone justifies it compared to the current choice */
+    size_t last = 0;
+    while(last + 1 < reps.size() && reps.at(last + 1)->getBandwidth() <= this->lastBitrate)
+        last++;
+
+    if(this->lastBitrate > 0 && best > last)
+    {
+        uint64_t sustained  = this->getBpsEstimate();
+        size_t   limit      = 0;
+
+        while(limit + 1 < reps.size() && reps.at(limit + 1)->getBandwidth() <= sustained)
+            limit++;
+
+        if(limit < best)
+            best = limit > last ? limit : last;
+    }
+
+    this->lastBitrate = reps.at(best)->getBandwidth();
+    return reps.at(best);
+}
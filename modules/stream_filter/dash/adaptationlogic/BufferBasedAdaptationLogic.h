@@ -0,0 +1,59 @@
+/*
+ * BufferBasedAdaptationLogic.h
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef BUFFERBASEDADAPTATIONLOGIC_H_
+#define BUFFERBASEDADAPTATIONLOGIC_H_
+
+#include "adaptationlogic/RateBasedAdaptationLogic.h"
+
+#include <vector>
+
+namespace dash
+{
+    namespace logic
+    {
+        /* Chooses the representation from the buffer level, following BOLA
+         * (Spiteri et al., "BOLA: Near-Optimal Bitrate Adaptation for Online
+         * Videos"). Switching up is limited by the throughput estimate, so
+         * that the choice does not oscillate. */
+        class BufferBasedAdaptationLogic : public RateBasedAdaptationLogic
+        {
+            public:
+                BufferBasedAdaptationLogic          (dash::mpd::IMPDManager *mpdManager, stream_t *stream);
+
+                dash::http::Chunk*      getNextChunk();
+
+            protected:
+                virtual dash::mpd::Representation*  selectRepresentation    ();
+
+            private:
+                mtime_t                 bufferCapacity;
+                mtime_t                 segmentDuration;
+                uint64_t                lastBitrate;
+
+                static const double     GAMMAP;
+                static const mtime_t    DEFAULTSEGMENTDURATION;
+
+                std::vector<dash::mpd::Representation *>   getCandidates   () const;
+        };
+    }
+}
+
+#endif /* BUFFERBASEDADAPTATIONLOGIC_H_ */
@@ -0,0 +1,81 @@
+/*
+ * EWMAThroughputEstimator.cpp
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "EWMAThroughputEstimator.h"
+
+#include <cmath>
+
+using namespace dash::logic;
+
+/* Half-lives in seconds of download */
+const double EWMAThroughputEstimator::FASTHALFLIFE = 2.;
+const double EWMAThroughputEstimator::SLOWHALFLIFE = 5.;
+
+EWMAThroughputEstimator::EWMAThroughputEstimator    ()
+{
+    init(&this->fast, FASTHALFLIFE);
+    init(&this->slow, SLOWHALFLIFE);
+}
+EWMAThroughputEstimator::~EWMAThroughputEstimator   ()
+{
+}
+
+void        EWMAThroughputEstimator::addSample      (uint64_t bytes, mtime_t time)
+{
+    if(time <= 0)
+        return;
+
+    double weight = (double)time / CLOCK_FREQ;
+    double bps    = bytes * 8. / weight;
+
+    sample(&this->fast, weight, bps);
+    sample(&this->slow, weight, bps);
+}
+uint64_t    EWMAThroughputEstimator::getEstimate    () const
+{
+    double fast = get(&this->fast);
+    double slow = get(&this->slow);
+
+    return (uint64_t)(fast < slow ? fast : slow);
+}
+void        EWMAThroughputEstimator::init           (Average *avg, double halfLife)
+{
+    avg->alpha       = exp(log(.5) / halfLife);
+    avg->estimate    = 0.;
+    avg->totalWeight = 0.;
+}
+void        EWMAThroughputEstimator::sample         (Average *avg, double weight, double value)
+{
+    double alpha = pow(avg->alpha, weight);
+
+    avg->estimate     = value * (1. - alpha) + alpha * avg->estimate;
+    avg->totalWeight += weight;
+}
+double      EWMAThroughputEstimator::get            (const Average *avg)
+{
+    if(avg->totalWeight <= 0.)
+        return 0.;
+
+    /* Corrects the bias toward the initial zero estimate */
+    return avg->estimate / (1. - pow(avg->alpha, avg->totalWeight));
+}
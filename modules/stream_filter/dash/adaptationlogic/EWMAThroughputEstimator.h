@@ -0,0 +1,63 @@
+/*
+ * EWMAThroughputEstimator.h
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef EWMATHROUGHPUTESTIMATOR_H_
+#define EWMATHROUGHPUTESTIMATOR_H_
+
+#include "adaptationlogic/IThroughputEstimator.h"
+
+namespace dash
+{
+    namespace logic
+    {
+        /* Two exponentially weighted moving averages, weighted by download
+         * time: the fast one reacts to drops, the slow one holds back
+         * increases. The lower of both is the estimate. */
+        class EWMAThroughputEstimator : public IThroughputEstimator
+        {
+            public:
+                EWMAThroughputEstimator             ();
+                virtual ~EWMAThroughputEstimator    ();
+
+                virtual void        addSample   (uint64_t bytes, mtime_t time);
+                virtual uint64_t    getEstimate () const;
+
+            private:
+                struct Average
+                {
+                    double  alpha;
+                    double  estimate;
+                    double  totalWeight;
+                };
+
+                Average     fast;
+                Average     slow;
+
+                static const double FASTHALFLIFE;
+                static const double SLOWHALFLIFE;
+
+                static void     init    (Average *avg, double halfLife);
+                static void     sample  (Average *avg, double weight, double value);
+                static double   get     (const Average *avg);
+        };
+    }
+}
+
+#endif /* EWMATHROUGHPUTESTIMATOR_H_ */
@@ -0,0 +1,56 @@
+/*
+ * HarmonicThroughputEstimator.cpp
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "HarmonicThroughputEstimator.h"
+
+using namespace dash::logic;
+
+const size_t HarmonicThroughputEstimator::SAMPLES = 5;
+
+HarmonicThroughputEstimator::HarmonicThroughputEstimator    ()
+{
+}
+HarmonicThroughputEstimator::~HarmonicThroughputEstimator   ()
+{
+}
+
+void        HarmonicThroughputEstimator::addSample          (uint64_t bytes, mtime_t time)
+{
+    if(time <= 0 || bytes == 0)
+        return;
+
+    this->samples.push_back(bytes * 8. * CLOCK_FREQ / time);
+    if(this->samples.size() > SAMPLES)
+        this->samples.pop_front();
+}
+uint64_t    HarmonicThroughputEstimator::getEstimate        () const
+{
+    if(this->samples.size() == 0)
+        return 0;
+
+    double sum = 0.;
+    for(size_t i = 0; i < this->samples.size(); i++)
+        sum += 1. / this->samples.at(i);
+
+    return (uint64_t)(this->samples.size() / sum);
+}
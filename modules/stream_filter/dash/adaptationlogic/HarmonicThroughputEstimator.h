@@ -0,0 +1,51 @@
+/*
+ * HarmonicThroughputEstimator.h
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef HARMONICTHROUGHPUTESTIMATOR_H_
+#define HARMONICTHROUGHPUTESTIMATOR_H_
+
+#include "adaptationlogic/IThroughputEstimator.h"
+
+#include <deque>
+
+namespace dash
+{
+    namespace logic
+    {
+        /* Harmonic mean of the last chunks: a single fast chunk cannot
+         * raise the estimate much, a slow one lowers it at once. */
+        class HarmonicThroughputEstimator : public IThroughputEstimator
+        {
+            public:
+                HarmonicThroughputEstimator             ();
+                virtual ~HarmonicThroughputEstimator    ();
+
+                virtual void        addSample   (uint64_t bytes, mtime_t time);
+                virtual uint64_t    getEstimate () const;
+
+            private:
+                std::deque<double>  samples;
+
+                static const size_t SAMPLES;
+        };
+    }
+}
+
+#endif /* HARMONICTHROUGHPUTESTIMATOR_H_ */
@@ -25,7 +25,7 @@
 #ifndef IDOWNLOADRATEOBSERVER_H_
 #define IDOWNLOADRATEOBSERVER_H_
 
-#include <stdint.h>
+#include <vlc_common.h>
 
 namespace dash
 {
@@ -35,6 +35,8 @@ namespace dash
         {
             public:
                 virtual void downloadRateChanged(uint64_t bpsAvg, uint64_t bpsLastChunk) = 0;
+                /* time is the time spent downloading the chunk, in microseconds */
+                virtual void chunkDownloaded(uint64_t bytes, mtime_t time) = 0;
                 virtual ~IDownloadRateObserver(){}
         };
     }
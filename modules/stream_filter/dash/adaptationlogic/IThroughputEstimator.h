@@ -0,0 +1,49 @@
+/*
+ * IThroughputEstimator.h
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef ITHROUGHPUTESTIMATOR_H_
+#define ITHROUGHPUTESTIMATOR_H_
+
+#include <vlc_common.h>
+
+namespace dash
+{
+    namespace logic
+    {
+        class IThroughputEstimator
+        {
+            public:
+                virtual ~IThroughputEstimator(){}
+
+                /**
+                 *  Accounts for a downloaded chunk.
+                 *  \param  time    The time spent downloading, in microseconds.
+                 */
+                virtual void        addSample   (uint64_t bytes, mtime_t time)  = 0;
+                /**
+                 *  \return     The estimated bitrate in bits per second,
+                 *              0 until a chunk was downloaded.
+                 */
+                virtual uint64_t    getEstimate () const                        = 0;
+        };
+    }
+}
+
+#endif /* ITHROUGHPUTESTIMATOR_H_ */
@@ -35,10 +35,11 @@ using namespace dash::mpd;
 RateBasedAdaptationLogic::RateBasedAdaptationLogic  (IMPDManager *mpdManager, stream_t *stream) :
                           AbstractAdaptationLogic   (mpdManager, stream),
                           mpdManager                (mpdManager),
-                          count                     (0),
                           currentPeriod             (mpdManager->getFirstPeriod()),
                           width                     (0),
-                          height                    (0)
+                          height                    (0),
+                          count                     (0),
+                          currentRepresentation     (NULL)
 {
     this->width  = var_InheritInteger(stream, "dash-prefwidth");
     this->height = var_InheritInteger(stream, "dash-prefheight");
@@ -52,12 +53,7 @@ Chunk*  RateBasedAdaptationLogic::getNextChunk()
     if(this->currentPeriod == NULL)
         return NULL;
 
-    uint64_t bitrate = this->getBpsAvg();
-
-    if(this->getBufferPercent() < MINBUFFER)
-        bitrate = 0;
-
-    Representation *rep = this->mpdManager->getRepresentation(this->currentPeriod, bitrate, this->width, this->height);
+    Representation *rep = this->selectRepresentation();
 
     if ( rep == NULL )
         return NULL;
@@ -73,6 +69,8 @@ Chunk*  RateBasedAdaptationLogic::getNextChunk()
 
     if ( segments.size() > this->count )
     {
+        this->currentRepresentation = rep;
+
         Segment *seg = segments.at( this->count );
         Chunk *chunk = seg->toChunk();
         //In case of UrlTemplate, we must stay on the same segment.
@@ -84,7 +82,22 @@ Chunk*  RateBasedAdaptationLogic::getNextChunk()
     return NULL;
 }
 
+Representation *RateBasedAdaptationLogic::selectRepresentation()
+{
+    uint64_t bitrate = this->getBpsEstimate();
+
+    if(this->getBufferPercent() < MINBUFFER)
+        bitrate = 0;
+
+    return this->mpdManager->getRepresentation(this->currentPeriod, bitrate, this->width, this->height);
+}
+
 const Representation *RateBasedAdaptationLogic::getCurrentRepresentation() const
 {
-    return this->mpdManager->getRepresentation( this->currentPeriod, this->getBpsAvg() );
+    /* The last segment may have been requested before it is played */
+    if ( this->currentPeriod == NULL )
+        return NULL;
+    if ( this->currentRepresentation == NULL )
+        return this->mpdManager->getRepresentation( this->currentPeriod, this->getBpsEstimate() );
+    return this->currentRepresentation;
 }
@@ -48,12 +48,17 @@ namespace dash
                 dash::http::Chunk*      getNextChunk();
                 const dash::mpd::Representation *getCurrentRepresentation() const;
 
-            private:
+            protected:
                 dash::mpd::IMPDManager  *mpdManager;
-                size_t                  count;
                 dash::mpd::Period       *currentPeriod;
                 int                     width;
                 int                     height;
+
+                virtual dash::mpd::Representation*  selectRepresentation    ();
+
+            private:
+                size_t                          count;
+                const dash::mpd::Representation *currentRepresentation;
         };
     }
 }
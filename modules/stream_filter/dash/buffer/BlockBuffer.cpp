@@ -41,6 +41,11 @@ BlockBuffer::BlockBuffer    (stream_t *stream) :
     if(this->capacityMicroSec <= 0)
         this->capacityMicroSec = DEFAULTBUFFERLENGTH;
 
+    this->capacityBytes = (size_t)var_InheritInteger(stream, "dash-buffermem") << 20;
+
+    if(this->capacityBytes == 0)
+        this->capacityBytes = DEFAULTBUFFERBYTES;
+
     this->peekBlock = block_Alloc(INTIALPEEKSIZE);
 
     block_BytestreamInit(&this->buffer);
@@ -72,7 +77,16 @@ int     BlockBuffer::peek                 (const uint8_t **pp_peek, unsigned int
         return 0;
     }
 
-    size_t ret = len > this->sizeBytes ? this->sizeBytes : len;
+    size_t  ret     = len > this->sizeBytes ? this->sizeBytes : len;
+    block_t *block  = this->buffer.p_block;
+
+    /* Only copy when the peeked bytes span several blocks */
+    if(block->i_buffer - this->buffer.i_offset >= ret)
+    {
+        *pp_peek = block->p_buffer + this->buffer.i_offset;
+        vlc_mutex_unlock(&this->monitorMutex);
+        return ret;
+    }
 
     if(ret > this->peekBlock->i_buffer)
         this->peekBlock = block_Realloc(this->peekBlock, 0, ret);
@@ -120,8 +134,8 @@ int     BlockBuffer::get                  (void *p_data, unsigned int len)
     else
         block_GetBytes(&this->buffer, (uint8_t *)p_data, ret);
 
-    block_BytestreamFlush(&this->buffer);
     this->updateBufferSize(ret);
+    block_BytestreamFlush(&this->buffer);
 
     this->notify();
 
@@ -133,13 +147,15 @@ void    BlockBuffer::put                  (block_t *block)
 {
     vlc_mutex_lock(&this->monitorMutex);
 
-    while(this->sizeMicroSec >= this->capacityMicroSec && !this->isEOF)
+    while((this->sizeMicroSec >= this->capacityMicroSec ||
+           this->sizeBytes >= this->capacityBytes) && !this->isEOF)
         vlc_cond_wait(&this->empty, &this->monitorMutex);
 
     if(this->isEOF)
     {
         vlc_cond_signal(&this->full);
         vlc_mutex_unlock(&this->monitorMutex);
+        block_Release(block);
         return;
     }
 
@@ -177,15 +193,15 @@ void    BlockBuffer::notify               ()
 }
 void    BlockBuffer::updateBufferSize     (size_t bytes)
 {
-    block_t *block = this->buffer.p_block;
+    /* Called before the flush: only the blocks it is about to release leave
+     * the buffer, without walking the whole chain on every read */
+    block_t *block = this->buffer.p_chain;
 
-    this->sizeMicroSec = 0;
+    for(; block != this->buffer.p_block; block = block->p_next)
+        this->sizeMicroSec -= block->i_length;
 
-    while(block)
-    {
-        this->sizeMicroSec += block->i_length;
-        block = block->p_next;
-    }
+    if(block != NULL && block->i_buffer == this->buffer.i_offset)
+        this->sizeMicroSec -= block->i_length;
 
     this->sizeBytes -= bytes;
 }
@@ -34,6 +34,7 @@
 #include <iostream>
 
 #define DEFAULTBUFFERLENGTH 30000000
+#define DEFAULTBUFFERBYTES  (128 << 20)
 #define INTIALPEEKSIZE      32768
 
 namespace dash
@@ -59,6 +60,7 @@ namespace dash
             private:
                 mtime_t             capacityMicroSec;
                 mtime_t             sizeMicroSec;
+                size_t              capacityBytes;
                 size_t              sizeBytes;
                 vlc_mutex_t         monitorMutex;
                 vlc_cond_t          empty;
@@ -48,6 +48,14 @@
 static int  Open    (vlc_object_t *);
 static void Close   (vlc_object_t *);
 
+static const char *const logic_values[] = { "rate", "buffer" };
+static const char *const logic_names[] = { N_("Throughput based"),
+                                           N_("Buffer based") };
+
+static const char *const estimator_values[] = { "ewma", "harmonic" };
+static const char *const estimator_names[] = {
+    N_("Moving average"), N_("Harmonic mean") };
+
 #define DASH_WIDTH_TEXT N_("Preferred Width")
 #define DASH_WIDTH_LONGTEXT N_("Preferred Width")
 
@@ -57,6 +65,26 @@ static void Close   (vlc_object_t *);
 #define DASH_BUFFER_TEXT N_("Buffer Size (Seconds)")
 #define DASH_BUFFER_LONGTEXT N_("Buffer size in seconds")
 
+#define DASH_BUFFERMEM_TEXT N_("Buffer Memory (MiB)")
+#define DASH_BUFFERMEM_LONGTEXT N_("Maximum amount of downloaded data kept " \
+    "in the buffer, whatever its duration.")
+
+#define DASH_PREFETCH_TEXT N_("Prefetch Depth (Seconds)")
+#define DASH_PREFETCH_LONGTEXT N_("Media duration of the segments requested " \
+    "ahead of the one being played.")
+
+#define DASH_LOGIC_TEXT N_("Adaptation Logic")
+#define DASH_LOGIC_LONGTEXT N_("How the representation is chosen: from the " \
+    "estimated throughput, or from the buffer level (BOLA).")
+
+#define DASH_ESTIMATOR_TEXT N_("Throughput Estimator")
+#define DASH_ESTIMATOR_LONGTEXT N_("How the throughput is estimated from the " \
+    "recent segments.")
+
+#define DASH_CONNECTIONS_TEXT N_("Connections per Server")
+#define DASH_CONNECTIONS_LONGTEXT N_("Maximum number of persistent " \
+    "connections used to download segments in parallel from one server.")
+
 vlc_module_begin ()
         set_shortname( N_("DASH"))
         set_description( N_("Dynamic Adaptive Streaming over HTTP") )
@@ -66,6 +94,15 @@ vlc_module_begin ()
         add_integer( "dash-prefwidth",  480, DASH_WIDTH_TEXT,  DASH_WIDTH_LONGTEXT,  true )
         add_integer( "dash-prefheight", 360, DASH_HEIGHT_TEXT, DASH_HEIGHT_LONGTEXT, true )
         add_integer( "dash-buffersize", 30, DASH_BUFFER_TEXT, DASH_BUFFER_LONGTEXT, true )
+        add_integer( "dash-buffermem", 128, DASH_BUFFERMEM_TEXT, DASH_BUFFERMEM_LONGTEXT, true )
+        add_integer( "dash-prefetch",   10, DASH_PREFETCH_TEXT, DASH_PREFETCH_LONGTEXT, true )
+        add_integer_with_range( "dash-connections", 2, 1, 8, DASH_CONNECTIONS_TEXT,
+                                DASH_CONNECTIONS_LONGTEXT, true )
+        add_string( "dash-logic", "rate", DASH_LOGIC_TEXT, DASH_LOGIC_LONGTEXT, true )
+            change_string_list( logic_values, logic_names )
+        add_string( "dash-estimator", "ewma", DASH_ESTIMATOR_TEXT,
+                    DASH_ESTIMATOR_LONGTEXT, true )
+            change_string_list( estimator_values, estimator_names )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -112,10 +149,15 @@ static int Open(vlc_object_t *p_obj)
     if (unlikely(p_sys == NULL))
         return VLC_ENOMEM;
 
+    dash::logic::IAdaptationLogic::LogicType type = dash::logic::IAdaptationLogic::RateBased;
+    char *psz_logic = var_InheritString(p_obj, "dash-logic");
+    if(psz_logic != NULL && !strcmp(psz_logic, "buffer"))
+        type = dash::logic::IAdaptationLogic::BufferBased;
+    free(psz_logic);
+
     p_sys->p_mpd = mpd;
     dash::DASHManager*p_dashManager = new dash::DASHManager(p_sys->p_mpd,
-                                          dash::logic::IAdaptationLogic::RateBased,
-                                          p_stream);
+                                          type, p_stream);
 
     if(!p_dashManager->start())
     {
@@ -201,7 +243,7 @@ static int  Read            (stream_t *p_stream, void *p_ptr, unsigned int i_len
     while( i_len > 0 )
     {
         i_read = p_dashManager->read( p_buffer, i_len );
-        if( i_read < 0 )
+        if( i_read <= 0 )
             break;
         p_buffer += i_read;
         i_ret += i_read;
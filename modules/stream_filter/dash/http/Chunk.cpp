@@ -37,8 +37,16 @@ Chunk::Chunk        () :
        isHostname   (false),
        length       (0),
        bytesRead    (0),
-       connection   (NULL)
+       connection   (NULL),
+       duration     (0),
+       downloaded   (false),
+       prefetched   (NULL)
 {
+    this->prefetchedLast = &this->prefetched;
+}
+Chunk::~Chunk       ()
+{
+    block_ChainRelease(this->prefetched);
 }
 
 int                 Chunk::getEndByte           () const
@@ -149,3 +157,43 @@ void                Chunk::setConnection   (IHTTPConnection *connection)
 {
     this->connection = connection;
 }
+mtime_t             Chunk::getDuration          () const
+{
+    if(this->duration > 0)
+        return this->duration;
+
+    /* Estimate from the size, once the server told it */
+    if(this->length > 0 && this->bitrate > 1)
+        return (mtime_t)this->length * 8 * CLOCK_FREQ / this->bitrate;
+
+    return 0;
+}
+void                Chunk::setDuration          (mtime_t duration)
+{
+    this->duration = duration;
+}
+bool                Chunk::isDownloaded         () const
+{
+    return this->downloaded;
+}
+void                Chunk::setDownloaded        (bool value)
+{
+    this->downloaded = value;
+}
+void                Chunk::addPrefetched        (block_t *block)
+{
+    block_ChainLastAppend(&this->prefetchedLast, block);
+}
+block_t*            Chunk::getPrefetched        ()
+{
+    block_t *block = this->prefetched;
+
+    if(block != NULL)
+    {
+        this->prefetched = block->p_next;
+        if(this->prefetched == NULL)
+            this->prefetchedLast = &this->prefetched;
+        block->p_next = NULL;
+    }
+    return block;
+}
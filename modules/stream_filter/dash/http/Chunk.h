@@ -27,6 +27,7 @@
 
 #include <vlc_common.h>
 #include <vlc_url.h>
+#include <vlc_block.h>
 
 #include "IHTTPConnection.h"
 
@@ -42,6 +43,7 @@ namespace dash
         {
             public:
                 Chunk           ();
+                virtual ~Chunk  ();
 
                 int                 getEndByte              () const;
                 int                 getStartByte            () const;
@@ -55,6 +57,8 @@ namespace dash
                 uint64_t            getBytesToRead          () const;
                 size_t              getPercentDownloaded    () const;
                 IHTTPConnection*    getConnection           () const;
+                mtime_t             getDuration             () const;
+                bool                isDownloaded            () const;
 
                 void                setConnection   (IHTTPConnection *connection);
                 void                setBytesRead    (uint64_t bytes);
@@ -67,6 +71,10 @@ namespace dash
                 void                setUseByteRange (bool value);
                 void                setBitrate      (uint64_t bitrate);
                 int                 getBitrate      ();
+                void                setDuration     (mtime_t duration);
+                void                setDownloaded   (bool value);
+                void                addPrefetched   (block_t *block);
+                block_t*            getPrefetched   ();
 
             private:
                 std::string                 url;
@@ -82,6 +90,10 @@ namespace dash
                 size_t                      length;
                 uint64_t                    bytesRead;
                 IHTTPConnection             *connection;
+                mtime_t                     duration;
+                bool                        downloaded;
+                block_t                     *prefetched;
+                block_t                     **prefetchedLast;
         };
     }
 }
@@ -71,6 +71,17 @@ int             HTTPConnection::peek            (const uint8_t **pp_peek, size_t
     *pp_peek = peek;
     return size;
 }
+bool            HTTPConnection::isReadable      () const
+{
+    if(this->peekBufferLen > 0)
+        return true;
+
+    struct pollfd ufd;
+    ufd.fd      = this->httpSocket;
+    ufd.events  = POLLIN;
+
+    return poll(&ufd, 1, 0) > 0;
+}
 std::string     HTTPConnection::prepareRequest  (Chunk *chunk)
 {
     std::string request;
@@ -29,6 +29,9 @@
 #include <vlc_plugin.h>
 #include <vlc_stream.h>
 #include <vlc_network.h>
+#ifdef HAVE_POLL
+#   include <poll.h>
+#endif
 
 #include <string>
 #include <stdint.h>
@@ -55,6 +58,7 @@ namespace dash
                 void            closeSocket ();
                 virtual int     read        (void *p_buffer, size_t len);
                 virtual int     peek        (const uint8_t **pp_peek, size_t i_peek);
+                bool            isReadable  () const;
 
             protected:
                 int         httpSocket;
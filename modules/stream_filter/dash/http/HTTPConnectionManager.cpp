@@ -31,14 +31,13 @@
 using namespace dash::http;
 using namespace dash::logic;
 
-const size_t    HTTPConnectionManager::PIPELINE               = 80;
-const size_t    HTTPConnectionManager::PIPELINELENGTH         = 2;
+const size_t    HTTPConnectionManager::PIPELINELENGTH         = 16;
+const size_t    HTTPConnectionManager::READBLOCK              = 32768;
 const uint64_t  HTTPConnectionManager::CHUNKDEFAULTBITRATE    = 1;
 
 HTTPConnectionManager::HTTPConnectionManager    (logic::IAdaptationLogic *adaptationLogic, stream_t *stream) :
                        adaptationLogic          (adaptationLogic),
                        stream                   (stream),
-                       chunkCount               (0),
                        bpsAvg                   (0),
                        bpsLastChunk             (0),
                        bpsCurrentChunk          (0),
@@ -47,6 +46,10 @@ HTTPConnectionManager::HTTPConnectionManager    (logic::IAdaptationLogic *adapta
                        timeSession              (0),
                        timeChunk                (0)
 {
+    this->prefetchTime   = var_InheritInteger(stream, "dash-prefetch") * CLOCK_FREQ;
+    this->maxConnections = var_InheritInteger(stream, "dash-connections");
+    if(this->maxConnections < 1)
+        this->maxConnections = 1;
 }
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
@@ -58,28 +61,43 @@ void                                HTTPConnectionManager::closeAllConnections
     vlc_delete_all(this->connectionPool);
     vlc_delete_all(this->downloadQueue);
 }
-int                                 HTTPConnectionManager::read                     (block_t *block)
+block_t*                            HTTPConnectionManager::read                     ()
 {
     if(this->downloadQueue.size() == 0)
         if(!this->addChunk(this->adaptationLogic->getNextChunk()))
-            return 0;
+            return NULL;
 
-    if(this->downloadQueue.front()->getPercentDownloaded() > HTTPConnectionManager::PIPELINE &&
-       this->downloadQueue.size() < HTTPConnectionManager::PIPELINELENGTH)
-        this->addChunk(this->adaptationLogic->getNextChunk());
+    while(this->downloadQueue.size() < HTTPConnectionManager::PIPELINELENGTH &&
+          this->getPrefetchedTime() < this->prefetchTime)
+        if(!this->addChunk(this->adaptationLogic->getNextChunk()))
+            break;
 
-    int ret = 0;
+    Chunk   *chunk      = this->downloadQueue.front();
+    int     received    = 0;
 
     mtime_t start = mdate();
-    ret = this->downloadQueue.front()->getConnection()->read(block->p_buffer, block->i_buffer);
+    block_t *block = chunk->getPrefetched();
+    if(block == NULL && !chunk->isDownloaded())
+    {
+        block = this->readBlock(chunk->getConnection());
+        if(block != NULL)
+            received = block->i_buffer;
+    }
+    received += this->prefetch(chunk);
     mtime_t end = mdate();
 
-    block->i_length = (mtime_t)((ret * 8) / ((float)this->downloadQueue.front()->getBitrate() / 1000000));
-
     double time = ((double)(end - start)) / 1000000;
 
-    if(ret <= 0)
+    /* The rate covers all the connections, not only the one being played */
+    if(received > 0)
+        this->updateStatistics(received, time);
+
+    if(block == NULL)
     {
+        if(this->bytesReadChunk > 0)
+            for(size_t i = 0; i < this->rateObservers.size(); i++)
+                this->rateObservers.at(i)->chunkDownloaded(this->bytesReadChunk, this->timeChunk * CLOCK_FREQ);
+
         this->bpsLastChunk   = this->bpsCurrentChunk;
         this->bytesReadChunk = 0;
         this->timeChunk      = 0;
@@ -87,14 +105,12 @@ int                                 HTTPConnectionManager::read
         delete(this->downloadQueue.front());
         this->downloadQueue.pop_front();
 
-        return this->read(block);
-    }
-    else
-    {
-        this->updateStatistics(ret, time);
+        return this->read();
     }
 
-    return ret;
+    block->i_length = (mtime_t)((block->i_buffer * 8) / ((float)chunk->getBitrate() / 1000000));
+
+    return block;
 }
 void                                HTTPConnectionManager::attach                   (IDownloadRateObserver *observer)
 {
@@ -124,6 +140,10 @@ void                                HTTPConnectionManager::updateStatistics
     this->timeSession       += time;
     this->timeChunk         += time;
 
+    /* Prefetched data can come in without waiting at all */
+    if(this->timeSession <= 0 || this->timeChunk <= 0)
+        return;
+
     this->bpsAvg            = (int64_t) ((this->bytesReadSession * 8) / this->timeSession);
     this->bpsCurrentChunk   = (int64_t) ((this->bytesReadChunk * 8) / this->timeChunk);
 
@@ -142,25 +162,119 @@ bool                                HTTPConnectionManager::addChunk
 
     this->downloadQueue.push_back(chunk);
 
+    /* The host is needed to pick a connection */
+    if(!chunk->hasHostname())
+    {
+        std::stringstream ss;
+        ss << this->stream->psz_access << "://" << Helper::combinePaths(Helper::getDirectoryPath(this->stream->psz_path), chunk->getUrl());
+        chunk->setUrl(ss.str());
+    }
+
     std::vector<PersistentConnection *> cons = this->getConnectionsForHost(chunk->getHostname());
 
-    if(cons.size() == 0)
+    /* Prefer the least busy connection, open another one rather than
+     * pipelining behind a pending chunk as long as the limit allows. */
+    PersistentConnection *con = NULL;
+    for(size_t i = 0; i < cons.size(); i++)
+        if(con == NULL || cons.at(i)->getChunkCount() < con->getChunkCount())
+            con = cons.at(i);
+
+    if(con == NULL || (con->getChunkCount() > 0 && cons.size() < this->maxConnections))
     {
-        PersistentConnection *con = new PersistentConnection(this->stream);
+        con = new PersistentConnection(this->stream);
         this->connectionPool.push_back(con);
-        cons.push_back(con);
     }
 
-    size_t pos = this->chunkCount % cons.size();
+    con->addChunk(chunk);
 
-    cons.at(pos)->addChunk(chunk);
-
-    chunk->setConnection(cons.at(pos));
-
-    this->chunkCount++;
+    chunk->setConnection(con);
 
     if(chunk->getBitrate() <= 0)
         chunk->setBitrate(HTTPConnectionManager::CHUNKDEFAULTBITRATE);
 
     return true;
 }
+mtime_t                             HTTPConnectionManager::getPrefetchedTime        () const
+{
+    mtime_t time = 0;
+
+    for(size_t i = 1; i < this->downloadQueue.size(); i++)
+    {
+        mtime_t duration = this->downloadQueue.at(i)->getDuration();
+
+        /* Unknown duration, do not queue more than that chunk */
+        if(duration <= 0)
+            return this->prefetchTime;
+
+        time += duration;
+    }
+
+    return time;
+}
+int                                 HTTPConnectionManager::prefetch                 (const Chunk *current)
+{
+    int received = 0;
+
+    /* Only read what has already arrived, so that the chunk being played,
+     * read with a blocking call, always comes first. */
+    for(size_t i = 0; i < this->connectionPool.size(); i++)
+    {
+        PersistentConnection *con = this->connectionPool.at(i);
+
+        if(con == current->getConnection())
+            continue;
+
+        Chunk *chunk = con->getCurrentChunk();
+        if(chunk == NULL || !con->isReadable())
+            continue;
+
+        block_t *block = this->readBlock(con);
+        int     ret     = 0;
+        if(block != NULL)
+        {
+            ret = block->i_buffer;
+            chunk->addPrefetched(block);
+            received += ret;
+
+            if(chunk->getBytesToRead() > 0)
+                continue;
+
+            /* Complete: releases the connection for its next chunk */
+            ret = con->read(NULL, 0);
+        }
+
+        if(ret <= 0)
+            chunk->setDownloaded(true);
+    }
+
+    return received;
+}
+block_t*                            HTTPConnectionManager::readBlock                (IHTTPConnection *con)
+{
+    block_t *block = block_Alloc(HTTPConnectionManager::READBLOCK);
+    if(unlikely(block == NULL))
+        return NULL;
+
+    int ret = con->read(block->p_buffer, block->i_buffer);
+    if(ret <= 0)
+    {
+        block_Release(block);
+        return NULL;
+    }
+
+    /* The blocks are handed as is to the buffer: do not keep a mostly empty
+     * one for a short read */
+    if((size_t)ret < HTTPConnectionManager::READBLOCK / 2)
+    {
+        block_t *fit = block_Alloc(ret);
+        if(likely(fit != NULL))
+        {
+            memcpy(fit->p_buffer, block->p_buffer, ret);
+            block_Release(block);
+            return fit;
+        }
+    }
+
+    block->i_buffer = ret;
+    return block;
+}
@@ -47,11 +47,11 @@ namespace dash
                 HTTPConnectionManager           (logic::IAdaptationLogic *adaptationLogic, stream_t *stream);
                 virtual ~HTTPConnectionManager  ();
 
-                void    closeAllConnections ();
-                bool    addChunk            (Chunk *chunk);
-                int     read                (block_t *block);
-                void    attach              (dash::logic::IDownloadRateObserver *observer);
-                void    notify              ();
+                void        closeAllConnections ();
+                bool        addChunk            (Chunk *chunk);
+                block_t*    read                ();
+                void        attach              (dash::logic::IDownloadRateObserver *observer);
+                void        notify              ();
 
             private:
                 std::vector<dash::logic::IDownloadRateObserver *>   rateObservers;
@@ -59,7 +59,8 @@ namespace dash
                 std::vector<PersistentConnection *>                 connectionPool;
                 logic::IAdaptationLogic                             *adaptationLogic;
                 stream_t                                            *stream;
-                int                                                 chunkCount;
+                mtime_t                                             prefetchTime;
+                size_t                                              maxConnections;
                 int64_t                                             bpsAvg;
                 int64_t                                             bpsLastChunk;
                 int64_t                                             bpsCurrentChunk;
@@ -68,12 +69,15 @@ namespace dash
                 double                                              timeSession;
                 double                                              timeChunk;
 
-                static const size_t     PIPELINE;
                 static const size_t     PIPELINELENGTH;
+                static const size_t     READBLOCK;
                 static const uint64_t   CHUNKDEFAULTBITRATE;
 
                 std::vector<PersistentConnection *>     getConnectionsForHost   (const std::string &hostname);
                 void                                    updateStatistics        (int bytes, double time);
+                mtime_t                                 getPrefetchedTime       () const;
+                int                                     prefetch                (const Chunk *current);
+                block_t*                                readBlock               (IHTTPConnection *con);
 
         };
     }
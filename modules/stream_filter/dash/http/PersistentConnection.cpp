@@ -196,6 +196,17 @@ bool                PersistentConnection::isConnected       () const
 {
     return this->isInit;
 }
+size_t              PersistentConnection::getChunkCount     () const
+{
+    return this->chunkQueue.size();
+}
+Chunk*              PersistentConnection::getCurrentChunk   () const
+{
+    if(this->chunkQueue.size() == 0)
+        return NULL;
+
+    return this->chunkQueue.front();
+}
 bool                PersistentConnection::resendAllRequests ()
 {
     for(size_t i = 0; i < this->chunkQueue.size(); i++)
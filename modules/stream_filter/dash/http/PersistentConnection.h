@@ -43,6 +43,8 @@ namespace dash
                 bool                addChunk    (Chunk *chunk);
                 const std::string&  getHostname () const;
                 bool                isConnected () const;
+                size_t              getChunkCount   () const;
+                Chunk*              getCurrentChunk () const;
 
             private:
                 std::deque<Chunk *>  chunkQueue;
@@ -70,7 +70,7 @@ bool    BasicCMParser::parse                ()
 }
 bool    BasicCMParser::setMPD()
 {
-    const std::map<std::string, std::string>    attr = this->root->getAttributes();
+    const std::map<std::string, std::string>   &attr = this->root->getAttributes();
     this->mpd = new MPD;
 
     std::map<std::string, std::string>::const_iterator  it;
@@ -172,7 +172,7 @@ void BasicCMParser::parseSegmentTimeline(Node *node, SegmentInfoCommon *segmentI
         while ( it != end )
         {
             SegmentTimeline::Element*    s = new SegmentTimeline::Element;
-            const std::map<std::string, std::string>    sAttr = (*it)->getAttributes();
+            const std::map<std::string, std::string>   &sAttr = (*it)->getAttributes();
             std::map<std::string, std::string>::const_iterator  sIt;
 
             sIt = sAttr.find( "t" );
@@ -205,7 +205,7 @@ void BasicCMParser::parseSegmentTimeline(Node *node, SegmentInfoCommon *segmentI
 
 void BasicCMParser::parseSegmentInfoCommon(Node *node, SegmentInfoCommon *segmentInfo)
 {
-    const std::map<std::string, std::string>            attr = node->getAttributes();
+    const std::map<std::string, std::string>           &attr = node->getAttributes();
 
     const std::vector<Node*>            baseUrls = DOMHelper::getChildElementByTagName( node, "BaseURL" );
     if ( baseUrls.size() > 0 )
@@ -251,7 +251,7 @@ void    BasicCMParser::setAdaptationSet            (Node *root, Period *period)
 
     for(size_t i = 0; i < adaptSets.size(); i++)
     {
-        const std::map<std::string, std::string>    attr = adaptSets.at(i)->getAttributes();
+        const std::map<std::string, std::string>   &attr = adaptSets.at(i)->getAttributes();
         AdaptationSet *adaptSet = new AdaptationSet;
         if ( this->parseCommonAttributesElements( adaptSets.at( i ), adaptSet, NULL ) == false )
         {
@@ -278,7 +278,7 @@ void BasicCMParser::parseTrickMode(Node *node, Representation *repr)
 
     Node*                                       trickModeNode = trickModes[0];
     TrickModeType                               *trickMode = new TrickModeType;
-    const std::map<std::string, std::string>    attr = trickModeNode->getAttributes();
+    const std::map<std::string, std::string>   &attr = trickModeNode->getAttributes();
     std::map<std::string, std::string>::const_iterator    it = attr.find( "alternatePlayoutRate" );
 
     if ( it != attr.end() )
@@ -292,7 +292,7 @@ void    BasicCMParser::setRepresentations   (Node *root, AdaptationSet *group)
 
     for(size_t i = 0; i < representations.size(); i++)
     {
-        const std::map<std::string, std::string>    attributes = representations.at(i)->getAttributes();
+        const std::map<std::string, std::string>   &attributes = representations.at(i)->getAttributes();
 
         Representation *rep = new Representation;
         rep->setParentGroup( group );
@@ -374,7 +374,7 @@ bool    BasicCMParser::setSegmentInfo       (Node *root, Representation *rep)
 
 Segment*    BasicCMParser::parseSegment( Node* node )
 {
-    const std::map<std::string, std::string>    attr = node->getAttributes();
+    const std::map<std::string, std::string>   &attr = node->getAttributes();
     std::map<std::string, std::string>::const_iterator  it;
 
     bool        isTemplate = false;
@@ -413,7 +413,7 @@ ProgramInformation* BasicCMParser::parseProgramInformation()
     if ( pInfoNode == NULL )
         return NULL;
     ProgramInformation  *pInfo = new ProgramInformation;
-    const std::map<std::string, std::string>    attr = pInfoNode->getAttributes();
+    const std::map<std::string, std::string>   &attr = pInfoNode->getAttributes();
     std::map<std::string, std::string>::const_iterator  it;
     it = attr.find( "moreInformationURL" );
     if ( it != attr.end() )
@@ -534,7 +534,7 @@ void BasicCMParser::parseContentDescriptor(Node *node, const std::string &name,
 
     while ( it != end )
     {
-        const std::map<std::string, std::string>    attr = (*it)->getAttributes();
+        const std::map<std::string, std::string>   &attr = (*it)->getAttributes();
         std::map<std::string, std::string>::const_iterator  itAttr = attr.find( "schemeIdUri" );
         if  ( itAttr == attr.end() )
         {
@@ -58,7 +58,7 @@ MPD*    IsoffMainParser::getMPD             ()
 }
 void    IsoffMainParser::setMPDAttributes   ()
 {
-    const std::map<std::string, std::string> attr = this->root->getAttributes();
+    const std::map<std::string, std::string> &attr = this->root->getAttributes();
 
     std::map<std::string, std::string>::const_iterator it;
 
@@ -168,15 +168,17 @@ void    IsoffMainParser::setInitSegment     (dash::xml::Node *segBaseNode, Segme
             seg->setByteRange(atoi(range.substr(0, pos).c_str()), atoi(range.substr(pos + 1, range.size()).c_str()));
         }
 
-        for(size_t i = 0; i < this->mpd->getBaseUrls().size(); i++)
-            seg->addBaseUrl(this->mpd->getBaseUrls().at(i));
+        const std::vector<BaseUrl *> &baseUrls = this->mpd->getBaseUrls();
+        for(size_t i = 0; i < baseUrls.size(); i++)
+            seg->addBaseUrl(baseUrls.at(i));
 
         base->addInitSegment(seg);
     }
 }
 void    IsoffMainParser::setSegments        (dash::xml::Node *segListNode, SegmentList *list)
 {
-    std::vector<Node *> segments = DOMHelper::getElementByTagName(segListNode, "SegmentURL", false);
+    std::vector<Node *>             segments = DOMHelper::getElementByTagName(segListNode, "SegmentURL", false);
+    const std::vector<BaseUrl *>    &baseUrls = this->mpd->getBaseUrls();
 
     for(size_t i = 0; i < segments.size(); i++)
     {
@@ -190,8 +192,8 @@ void    IsoffMainParser::setSegments        (dash::xml::Node *segListNode, Segme
             seg->setByteRange(atoi(range.substr(0, pos).c_str()), atoi(range.substr(pos + 1, range.size()).c_str()));
         }
 
-        for(size_t j = 0; j < this->mpd->getBaseUrls().size(); j++)
-            seg->addBaseUrl(this->mpd->getBaseUrls().at(j));
+        for(size_t j = 0; j < baseUrls.size(); j++)
+            seg->addBaseUrl(baseUrls.at(j));
 
         list->addSegment(seg);
     }
@@ -116,6 +116,10 @@ dash::http::Chunk*      Segment::toChunk        ()
 
     chunk->setBitrate(this->parentRepresentation->getBandwidth());
 
+    const SegmentInfo *info = this->parentRepresentation->getSegmentInfo();
+    if(info != NULL && info->getDuration() > 0)
+        chunk->setDuration((mtime_t)info->getDuration() * CLOCK_FREQ);
+
     return chunk;
 }
 
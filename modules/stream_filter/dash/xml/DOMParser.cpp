@@ -73,34 +73,58 @@ bool    DOMParser::parse                    ()
 }
 Node*   DOMParser::processNode              ()
 {
-    const char *data;
-    int type = xml_ReaderNextNode(this->vlc_reader, &data);
-    if(type != -1 && type != XML_READER_NONE && type != XML_READER_ENDELEM)
+    /* Build the tree straight from the reader events: the open elements are
+     * kept on a stack instead of recursing once per element, which matters
+     * for manifests listing tens of thousands of segments. */
+    std::vector<Node *> openNodes;
+    const char          *data;
+    int                 type;
+
+    while((type = xml_ReaderNextNode(this->vlc_reader, &data)) > 0)
     {
-        Node *node = new Node();
-        node->setType( type );
+        Node *node;
 
-        if ( type != XML_READER_TEXT )
+        switch(type)
         {
-            std::string name    = data;
-            bool        isEmpty = xml_ReaderIsEmptyElement(this->vlc_reader);
-            node->setName(name);
-
-            this->addAttributesToNode(node);
-
-            if(isEmpty)
-                return node;
-
-            Node *subnode = NULL;
-
-            while((subnode = this->processNode()) != NULL)
-                node->addSubNode(subnode);
+            case XML_READER_STARTELEM:
+            {
+                bool isEmpty = xml_ReaderIsEmptyElement(this->vlc_reader);
+
+                node = new Node();
+                node->setType(type);
+                node->setName(data);
+                this->addAttributesToNode(node);
+
+                if(!openNodes.empty())
+                    openNodes.back()->addSubNode(node);
+                if(!isEmpty)
+                    openNodes.push_back(node);
+                else if(openNodes.empty())
+                    return node;
+                break;
+            }
+            case XML_READER_ENDELEM:
+                if(openNodes.empty())
+                    return NULL;
+                node = openNodes.back();
+                openNodes.pop_back();
+                if(openNodes.empty())
+                    return node;
+                break;
+
+            case XML_READER_TEXT:
+                if(openNodes.empty())
+                    break;
+                node = new Node();
+                node->setType(type);
+                node->setText(data);
+                openNodes.back()->addSubNode(node);
+                break;
         }
-        else
-            node->setText( data );
-        return node;
     }
-    return NULL;
+
+    /* Truncated document: keep what could be read */
+    return openNodes.empty() ? NULL : openNodes.front();
 }
 void    DOMParser::addAttributesToNode      (Node *node)
 {
@@ -108,11 +132,7 @@ void    DOMParser::addAttributesToNode      (Node *node)
     const char *attrName;
 
     while((attrName = xml_ReaderNextAttr(this->vlc_reader, &attrValue)) != NULL)
-    {
-        std::string key     = attrName;
-        std::string value   = attrValue;
-        node->addAttribute(key, value);
-    }
+        node->addAttribute(attrName, attrValue);
 }
 void    DOMParser::print                    (Node *node, int offset)
 {
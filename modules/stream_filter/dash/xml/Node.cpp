@@ -80,7 +80,7 @@ const std::string&                  Node::getAttributeValue     (const std::stri
 
 void                                Node::addAttribute          ( const std::string& key, const std::string& value)
 {
-    this->attributes[key] = value;
+    this->attributes.insert(std::make_pair(key, value));
 }
 std::vector<std::string>            Node::getAttributeKeys      () const
 {
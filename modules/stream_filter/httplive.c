@@ -42,18 +42,28 @@
 #include <vlc_stream.h>
 #include <vlc_memory.h>
 #include <vlc_gcrypt.h>
+#include <vlc_url.h>
+#include <vlc_network.h>
 
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
+#define HLS_PARALLEL_MAX 8
+
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
+#define PARALLEL_TEXT N_("Parallel downloads")
+#define PARALLEL_LONGTEXT N_("Number of segments downloaded at the same time. " \
+    "The HTTP connections are kept open from one segment to the next.")
+
 vlc_module_begin()
     set_category(CAT_INPUT)
     set_subcategory(SUBCAT_INPUT_STREAM_FILTER)
     set_description(N_("Http Live Streaming stream filter"))
     set_capability("stream_filter", 20)
+    add_integer_with_range("hls-parallel", 2, 1, HLS_PARALLEL_MAX,
+                           PARALLEL_TEXT, PARALLEL_LONGTEXT, true)
     set_callbacks(Open, Close)
 vlc_module_end()
 
@@ -72,6 +82,8 @@ typedef struct segment_s
     char       *psz_key_path;         /* url key path */
     uint8_t     aes_key[16];      /* AES-128 */
     bool        b_key_loaded;
+    uint8_t     psz_AES_IV[AES_BLOCK_SIZE];    /* IV of the playlist key */
+    bool        b_iv_loaded;
 
     vlc_mutex_t lock;
     block_t     *data;      /* data */
@@ -97,24 +109,40 @@ typedef struct hls_stream_s
     bool         b_iv_loaded;
 } hls_stream_t;
 
+/* AES-128 context of a download thread, kept from one segment to the next */
+typedef struct
+{
+    gcry_cipher_hd_t handle;
+    bool             b_open;
+    bool             b_keyed;
+    uint8_t          key[AES_BLOCK_SIZE]; /* key of the schedule in handle */
+} hls_cipher_t;
+
 struct stream_sys_t
 {
     char         *m3u8;         /* M3U8 url */
     vlc_thread_t  reload;       /* HLS m3u8 reload thread */
-    vlc_thread_t  thread;       /* HLS segment download thread */
+    vlc_thread_t  thread[HLS_PARALLEL_MAX]; /* HLS segment download threads */
+    unsigned      threads;      /* number of download threads running */
 
     block_t      *peeked;
 
     /* */
     vlc_array_t  *hls_stream;   /* bandwidth adaptation */
-    uint64_t      bandwidth;    /* measured bandwidth (bits per second) */
+    uint64_t      bandwidth;    /* estimated bandwidth (bits per second) */
+    uint64_t      bw_fast;      /* quickly moving average of the samples */
+    uint64_t      bw_slow;      /* slowly moving average of the samples */
 
     /* Download */
     struct hls_download_s
     {
         int         stream;     /* current hls_stream  */
-        int         segment;    /* current segment for downloading */
+        int         segment;    /* next segment to start downloading */
+        int         ready;      /* segments before were all downloaded */
+        uint32_t    done;       /* segments downloaded after ready (bitmap) */
+        int         active;     /* segments being downloaded */
         int         seek;       /* segment requested by seek (default -1) */
+        bool        b_close;    /* the download threads must exit */
         vlc_mutex_t lock_wait;  /* protect segment download counter */
         vlc_cond_t  wait;       /* some condition to wait on */
     } download;
@@ -141,6 +169,8 @@ struct stream_sys_t
     bool        b_live;     /* live stream? or vod? */
     bool        b_error;    /* parsing error */
     bool        b_aesmsg;   /* only print one time that the media is encrypted */
+
+    vlc_mutex_t lock_key;   /* serializes the AES key downloads */
 };
 
 /****************************************************************************
@@ -154,7 +184,7 @@ static ssize_t read_M3U8_from_stream(stream_t *s, uint8_t **buffer);
 static ssize_t read_M3U8_from_url(stream_t *s, const char *psz_url, uint8_t **buffer);
 static char *ReadLine(uint8_t *buffer, uint8_t **pos, size_t len);
 
-static int hls_Download(stream_t *s, segment_t *segment);
+static int hls_Download(stream_t *s, segment_t *segment, hls_cipher_t *cipher);
 
 static void* hls_Thread(void *);
 static void* hls_Reload(void *);
@@ -383,6 +413,9 @@ static segment_t *segment_New(hls_stream_t* hls, const int duration, const char
     segment->psz_key_path = NULL;
     if (hls->psz_current_key_path)
         segment->psz_key_path = strdup(hls->psz_current_key_path);
+    /* The IV applies to the segments following its key tag only */
+    segment->b_iv_loaded = hls->b_iv_loaded;
+    memcpy(segment->psz_AES_IV, hls->psz_AES_IV, AES_BLOCK_SIZE);
     return segment;
 }
 
@@ -607,6 +640,22 @@ static int parse_SegmentInformation(hls_stream_t *hls, char *p_read, int *durati
     return VLC_SUCCESS;
 }
 
+/* Starts resolving the host of an URL that will be downloaded soon */
+static void PrefetchHost(const char *psz_url)
+{
+    vlc_url_t url;
+
+    vlc_UrlParse(&url, psz_url, 0);
+    if (url.psz_protocol != NULL && url.psz_host != NULL)
+    {
+        int port = url.i_port;
+        if (port <= 0)
+            port = strcasecmp(url.psz_protocol, "https") ? 80 : 443;
+        net_PrefetchTCP(url.psz_host, port);
+    }
+    vlc_UrlClean(&url);
+}
+
 static int parse_AddSegment(hls_stream_t *hls, const int duration, const char *uri)
 {
     assert(hls);
@@ -622,6 +671,11 @@ static int parse_AddSegment(hls_stream_t *hls, const int duration, const char *u
         segment->sequence = hls->sequence + vlc_array_count(hls->segments) - 1;
     free(psz_uri);
 
+    /* The segments are usually on the same host: resolve it while the rest
+     * of the playlists is parsed */
+    if (segment && vlc_array_count(hls->segments) == 1)
+        PrefetchHost(segment->url);
+
     vlc_mutex_unlock(&hls->lock);
 
     return segment ? VLC_SUCCESS : VLC_ENOMEM;
@@ -1184,74 +1238,105 @@ static int hls_ManageSegmentKeys(stream_t *s, hls_stream_t *hls)
     return VLC_SUCCESS;
 }
 
-static int hls_DecodeSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segment)
+static int hls_CipherSetup(stream_t *s, hls_stream_t *hls, segment_t *segment,
+                           hls_cipher_t *cipher)
 {
-    /* Did the segment need to be decoded ? */
-    if (segment->psz_key_path == NULL)
-        return VLC_SUCCESS;
+    stream_sys_t *p_sys = s->p_sys;
 
     /* Do we have loaded the key ? */
+    vlc_mutex_lock(&p_sys->lock_key);
     if (!segment->b_key_loaded)
     {
         /* No ? try to download it now */
         if (hls_ManageSegmentKeys(s, hls) != VLC_SUCCESS)
+        {
+            vlc_mutex_unlock(&p_sys->lock_key);
             return VLC_EGENERIC;
+        }
     }
+    vlc_mutex_unlock(&p_sys->lock_key);
 
     /* For now, we only decode AES-128 data */
     gcry_error_t i_gcrypt_err;
-    gcry_cipher_hd_t aes_ctx;
-    /* Setup AES */
-    i_gcrypt_err = gcry_cipher_open(&aes_ctx, GCRY_CIPHER_AES,
-                                     GCRY_CIPHER_MODE_CBC, 0);
-    if (i_gcrypt_err)
+    if (!cipher->b_open)
     {
-        msg_Err(s, "gcry_cipher_open failed: %s", gpg_strerror(i_gcrypt_err));
-        gcry_cipher_close(aes_ctx);
-        return VLC_EGENERIC;
+        i_gcrypt_err = gcry_cipher_open(&cipher->handle, GCRY_CIPHER_AES,
+                                        GCRY_CIPHER_MODE_CBC, 0);
+        if (i_gcrypt_err)
+        {
+            msg_Err(s, "gcry_cipher_open failed: %s", gpg_strerror(i_gcrypt_err));
+            return VLC_EGENERIC;
+        }
+        cipher->b_open = true;
+        cipher->b_keyed = false;
     }
 
-    /* Set key */
-    i_gcrypt_err = gcry_cipher_setkey(aes_ctx, segment->aes_key,
-                                       sizeof(segment->aes_key));
-    if (i_gcrypt_err)
+    /* The key schedule is only computed again when the key changes */
+    if (!cipher->b_keyed ||
+        memcmp(cipher->key, segment->aes_key, sizeof(cipher->key)))
     {
-        msg_Err(s, "gcry_cipher_setkey failed: %s", gpg_strerror(i_gcrypt_err));
-        gcry_cipher_close(aes_ctx);
-        return VLC_EGENERIC;
+        i_gcrypt_err = gcry_cipher_setkey(cipher->handle, segment->aes_key,
+                                           sizeof(segment->aes_key));
+        if (i_gcrypt_err)
+        {
+            msg_Err(s, "gcry_cipher_setkey failed: %s", gpg_strerror(i_gcrypt_err));
+            cipher->b_keyed = false;
+            return VLC_EGENERIC;
+        }
+        memcpy(cipher->key, segment->aes_key, sizeof(cipher->key));
+        cipher->b_keyed = true;
     }
 
-    if (hls->b_iv_loaded == false)
+    uint8_t iv[AES_BLOCK_SIZE];
+    if (segment->b_iv_loaded == false)
     {
-        memset(hls->psz_AES_IV, 0, AES_BLOCK_SIZE);
-        hls->psz_AES_IV[15] = segment->sequence & 0xff;
-        hls->psz_AES_IV[14] = (segment->sequence >> 8)& 0xff;
-        hls->psz_AES_IV[13] = (segment->sequence >> 16)& 0xff;
-        hls->psz_AES_IV[12] = (segment->sequence >> 24)& 0xff;
+        memset(iv, 0, AES_BLOCK_SIZE);
+        iv[15] = segment->sequence & 0xff;
+        iv[14] = (segment->sequence >> 8)& 0xff;
+        iv[13] = (segment->sequence >> 16)& 0xff;
+        iv[12] = (segment->sequence >> 24)& 0xff;
     }
+    else
+        memcpy(iv, segment->psz_AES_IV, AES_BLOCK_SIZE);
 
-    i_gcrypt_err = gcry_cipher_setiv(aes_ctx, hls->psz_AES_IV,
-                                      sizeof(hls->psz_AES_IV));
-
+    i_gcrypt_err = gcry_cipher_setiv(cipher->handle, iv, sizeof(iv));
     if (i_gcrypt_err)
     {
         msg_Err(s, "gcry_cipher_setiv failed: %s", gpg_strerror(i_gcrypt_err));
-        gcry_cipher_close(aes_ctx);
         return VLC_EGENERIC;
     }
+    return VLC_SUCCESS;
+}
 
-    i_gcrypt_err = gcry_cipher_decrypt(aes_ctx,
-                                       segment->data->p_buffer, /* out */
-                                       segment->data->i_buffer,
-                                       NULL, /* in */
-                                       0);
+static void hls_CipherClose(hls_cipher_t *cipher)
+{
+    if (cipher->b_open)
+        gcry_cipher_close(cipher->handle);
+    cipher->b_open = false;
+}
+
+/* Decrypts in place, the chaining state is kept from one call to the next */
+static int hls_CipherDecrypt(stream_t *s, hls_cipher_t *cipher,
+                             uint8_t *p_buffer, size_t i_buffer)
+{
+    if (i_buffer == 0)
+        return VLC_SUCCESS;
+
+    gcry_error_t i_gcrypt_err = gcry_cipher_decrypt(cipher->handle,
+                                                    p_buffer, /* out */
+                                                    i_buffer,
+                                                    NULL, /* in */
+                                                    0);
     if (i_gcrypt_err)
     {
         msg_Err(s, "gcry_cipher_decrypt failed:  %s/%s\n", gcry_strsource(i_gcrypt_err), gcry_strerror(i_gcrypt_err));
-        gcry_cipher_close(aes_ctx);
         return VLC_EGENERIC;
     }
-    gcry_cipher_close(aes_ctx);
+    return VLC_SUCCESS;
+}
+
+static int hls_RemovePadding(stream_t *s, segment_t *segment)
+{
     /* remove the PKCS#7 padding from the buffer */
     int pad = segment->data->p_buffer[segment->data->i_buffer-1];
     if (pad <= 0 || pad > AES_BLOCK_SIZE)
@@ -1364,6 +1449,8 @@ static int hls_UpdatePlaylist(stream_t *s, hls_stream_t *hls_new, hls_stream_t *
                 }
                 free(segment->psz_key_path);
                 segment->psz_key_path = p->psz_key_path ? strdup(p->psz_key_path) : NULL;
+                segment->b_iv_loaded = p->b_iv_loaded;
+                memcpy(segment->psz_AES_IV, p->psz_AES_IV, AES_BLOCK_SIZE);
                 segment_Free(p);
             }
             vlc_mutex_unlock(&segment->lock);
@@ -1447,12 +1534,13 @@ static int hls_ReloadPlaylist(stream_t *s)
 /****************************************************************************
  * hls_Thread
  ****************************************************************************/
-static int BandwidthAdaptation(stream_t *s, int progid, uint64_t *bandwidth)
+static int BandwidthAdaptation(stream_t *s, int progid, uint64_t current,
+                               uint64_t *bandwidth)
 {
     stream_sys_t *p_sys = s->p_sys;
-    int candidate = -1;
+    int candidate = -1, lowest = -1;
     uint64_t bw = *bandwidth;
-    uint64_t bw_candidate = 0;
+    uint64_t bw_candidate = 0, bw_lowest = 0;
 
     int count = vlc_array_count(p_sys->hls_stream);
     for (int n = 0; n < count; n++)
@@ -1462,22 +1550,54 @@ static int BandwidthAdaptation(stream_t *s, int progid, uint64_t *bandwidth)
         if (hls == NULL) break;
 
         /* only consider streams with the same PROGRAM-ID */
-        if (hls->id == progid)
+        if (hls->id != progid)
+            continue;
+
+        if (lowest < 0 || hls->bandwidth < bw_lowest)
         {
-            if ((bw >= hls->bandwidth) && (bw_candidate < hls->bandwidth))
-            {
-                msg_Dbg(s, "candidate %d bandwidth (bits/s) %"PRIu64" >= %"PRIu64,
-                         n, bw, hls->bandwidth); /* bits / s */
-                bw_candidate = hls->bandwidth;
-                candidate = n; /* possible candidate */
-            }
+            bw_lowest = hls->bandwidth;
+            lowest = n;
+        }
+
+        /* Hysteresis: going up needs a margin over the estimate, so that
+         * the stream does not switch back and forth between two variants */
+        uint64_t limit = (hls->bandwidth > current) ? bw / 5 * 4 : bw;
+        if ((limit >= hls->bandwidth) && (bw_candidate < hls->bandwidth))
+        {
+            msg_Dbg(s, "candidate %d bandwidth (bits/s) %"PRIu64" >= %"PRIu64,
+                     n, bw, hls->bandwidth); /* bits / s */
+            bw_candidate = hls->bandwidth;
+            candidate = n; /* possible candidate */
         }
     }
+
+    /* Nothing fits: the lowest one will stall the least */
+    if (candidate < 0)
+    {
+        candidate = lowest;
+        bw_candidate = bw_lowest;
+    }
     *bandwidth = bw_candidate;
     return candidate;
 }
 
-static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segment, int *cur_stream)
+/* Returns the estimated bandwidth after a segment download */
+static uint64_t BandwidthEstimate(stream_sys_t *p_sys, uint64_t bw)
+{
+    /* The quick average follows the drops, the slow one ignores the peaks:
+     * the lowest of both is used */
+    if (p_sys->bw_slow == 0)
+        p_sys->bw_fast = p_sys->bw_slow = bw;
+    else
+    {
+        p_sys->bw_fast = (p_sys->bw_fast + bw) / 2;
+        p_sys->bw_slow = (p_sys->bw_slow * 7 + bw) / 8;
+    }
+    return __MIN(p_sys->bw_fast, p_sys->bw_slow);
+}
+
+static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segment,
+                                   hls_cipher_t *cipher, int *cur_stream)
 {
     stream_sys_t *p_sys = s->p_sys;
 
@@ -1504,8 +1624,21 @@ static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *se
         }
     }
 
+    /* If the segment is encrypted, decode it while it is downloaded */
+    if (segment->psz_key_path == NULL)
+        cipher = NULL;
+    else if (hls_CipherSetup(s, hls, segment, cipher) != VLC_SUCCESS)
+    {
+        vlc_mutex_unlock(&segment->lock);
+        return VLC_EGENERIC;
+    }
+
+    vlc_mutex_lock(&p_sys->download.lock_wait);
+    int active = p_sys->download.active;
+    vlc_mutex_unlock(&p_sys->download.lock_wait);
+
     mtime_t start = mdate();
-    if (hls_Download(s, segment) != VLC_SUCCESS)
+    if (hls_Download(s, segment, cipher) != VLC_SUCCESS)
     {
         msg_Err(s, "downloading segment %d from stream %d failed",
                     segment->sequence, *cur_stream);
@@ -1519,8 +1652,7 @@ static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *se
         hls->bandwidth = (uint64_t)(((double)segment->size * 8) / ((double)segment->duration));
     }
 
-    /* If the segment is encrypted, decode it */
-    if (hls_DecodeSegmentData(s, hls, segment) != VLC_SUCCESS)
+    if ((cipher != NULL) && (hls_RemovePadding(s, segment) != VLC_SUCCESS))
     {
         vlc_mutex_unlock(&segment->lock);
         return VLC_EGENERIC;
@@ -1531,13 +1663,16 @@ static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *se
     msg_Info(s, "downloaded segment %d from stream %d",
                 segment->sequence, *cur_stream);
 
+    /* The segments downloaded at the same time share the link */
+    vlc_mutex_lock(&p_sys->download.lock_wait);
+    active = __MAX(__MAX(active, p_sys->download.active), 1);
+
     uint64_t bw = segment->size * 8 * 1000000 / __MAX(1, duration); /* bits / s */
-    p_sys->bandwidth = bw;
+    bw = p_sys->bandwidth = BandwidthEstimate(p_sys, bw * active);
     if (p_sys->b_meta && (hls->bandwidth != bw))
     {
-        int newstream = BandwidthAdaptation(s, hls->id, &bw);
+        int newstream = BandwidthAdaptation(s, hls->id, hls->bandwidth, &bw);
 
-        /* FIXME: we need an average here */
         if ((newstream >= 0) && (newstream != *cur_stream))
         {
             msg_Info(s, "detected %s bandwidth (%"PRIu64") stream",
@@ -1545,83 +1680,113 @@ static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *se
             *cur_stream = newstream;
         }
     }
+    vlc_mutex_unlock(&p_sys->download.lock_wait);
     return VLC_SUCCESS;
 }
 
+/* Must be called with download.lock_wait held */
+static void hls_SegmentDownloaded(stream_sys_t *p_sys, int index)
+{
+    int offset = index - p_sys->download.ready;
+
+    /* Stale download of before a seek */
+    if ((offset < 0) || (offset >= 32))
+        return;
+
+    p_sys->download.done |= UINT32_C(1) << offset;
+    while (p_sys->download.done & 1)
+    {
+        p_sys->download.done >>= 1;
+        p_sys->download.ready++;
+    }
+}
+
 static void* hls_Thread(void *p_this)
 {
     stream_t *s = (stream_t *)p_this;
     stream_sys_t *p_sys = s->p_sys;
+    hls_cipher_t cipher = { .b_open = false };
 
     int canc = vlc_savecancel();
 
     while (vlc_object_alive(s))
     {
-        hls_stream_t *hls = hls_Get(p_sys->hls_stream, p_sys->download.stream);
+        vlc_mutex_lock(&p_sys->download.lock_wait);
+        int stream = p_sys->download.stream;
+        vlc_mutex_unlock(&p_sys->download.lock_wait);
+
+        hls_stream_t *hls = hls_Get(p_sys->hls_stream, stream);
         assert(hls);
 
-        /* Sliding window (~60 seconds worth of movie) */
         vlc_mutex_lock(&hls->lock);
         int count = vlc_array_count(hls->segments);
         vlc_mutex_unlock(&hls->lock);
 
-        /* Is there a new segment to process? */
-        if ((!p_sys->b_live && (p_sys->playback.segment < (count - 6))) ||
-            (p_sys->download.segment >= count))
+        /* Sliding window (~60 seconds worth of movie), shared by the
+         * download threads: each one takes the next segment in order */
+        vlc_mutex_lock(&p_sys->download.lock_wait);
+        while (((p_sys->download.segment - p_sys->playback.segment > 6) ||
+                (p_sys->download.segment >= count)) &&
+               (p_sys->download.seek == -1) && !p_sys->download.b_close)
         {
-            /* wait */
-            vlc_mutex_lock(&p_sys->download.lock_wait);
-            while (((p_sys->download.segment - p_sys->playback.segment > 6) ||
-                    (p_sys->download.segment >= count)) &&
-                   (p_sys->download.seek == -1))
-            {
-                vlc_cond_wait(&p_sys->download.wait, &p_sys->download.lock_wait);
-                if (p_sys->b_live /*&& (mdate() >= p_sys->playlist.wakeup)*/)
-                    break;
-                if (!vlc_object_alive(s))
-                    break;
-            }
-            /* */
-            if (p_sys->download.seek >= 0)
-            {
-                p_sys->download.segment = p_sys->download.seek;
-                p_sys->download.seek = -1;
-            }
-            vlc_mutex_unlock(&p_sys->download.lock_wait);
+            vlc_cond_wait(&p_sys->download.wait, &p_sys->download.lock_wait);
+            /* The live playlist may have been reloaded meanwhile */
+            if (p_sys->b_live && (p_sys->download.segment >= count))
+                break;
+            if (!vlc_object_alive(s))
+                break;
         }
 
-        if (!vlc_object_alive(s)) break;
-
-        vlc_mutex_lock(&hls->lock);
-        segment_t *segment = segment_GetSegment(hls, p_sys->download.segment);
-        vlc_mutex_unlock(&hls->lock);
-
-        if ((segment != NULL) &&
-            (hls_DownloadSegmentData(s, hls, segment, &p_sys->download.stream) != VLC_SUCCESS))
+        if (p_sys->download.b_close)
         {
-            if (!vlc_object_alive(s)) break;
-
-            if (!p_sys->b_live)
-            {
-                p_sys->b_error = true;
-                break;
-            }
+            vlc_mutex_unlock(&p_sys->download.lock_wait);
+            break;
         }
 
-        /* download succeeded */
-        /* determine next segment to download */
-        vlc_mutex_lock(&p_sys->download.lock_wait);
         if (p_sys->download.seek >= 0)
         {
             p_sys->download.segment = p_sys->download.seek;
+            p_sys->download.ready = p_sys->download.seek;
+            p_sys->download.done = 0;
             p_sys->download.seek = -1;
         }
-        else if (p_sys->download.segment < count)
-            p_sys->download.segment++;
-        vlc_cond_signal(&p_sys->download.wait);
+
+        int index = p_sys->download.segment;
+        if ((index >= count) || (p_sys->download.stream != stream))
+        {
+            /* Playlist not updated yet, or switched to another stream */
+            vlc_mutex_unlock(&p_sys->download.lock_wait);
+            continue;
+        }
+        p_sys->download.segment++;
+        p_sys->download.active++;
         vlc_mutex_unlock(&p_sys->download.lock_wait);
+
+        if (!vlc_object_alive(s)) break;
+
+        vlc_mutex_lock(&hls->lock);
+        segment_t *segment = segment_GetSegment(hls, index);
+        vlc_mutex_unlock(&hls->lock);
+
+        int newstream = stream;
+        bool b_failed = (segment != NULL) &&
+            (hls_DownloadSegmentData(s, hls, segment, &cipher, &newstream) != VLC_SUCCESS);
+
+        vlc_mutex_lock(&p_sys->download.lock_wait);
+        p_sys->download.active--;
+        hls_SegmentDownloaded(p_sys, index);
+        if ((newstream != stream) && (p_sys->download.stream == stream))
+            p_sys->download.stream = newstream;
+        if (b_failed && !p_sys->b_live)
+            p_sys->b_error = true;
+        vlc_cond_broadcast(&p_sys->download.wait);
+        vlc_mutex_unlock(&p_sys->download.lock_wait);
+
+        if (b_failed && !p_sys->b_live)
+            break;
     }
 
+    hls_CipherClose(&cipher);
     vlc_restorecancel(canc);
     return NULL;
 }
@@ -1661,6 +1826,11 @@ static void* hls_Reload(void *p_this)
             {
                 p_sys->playlist.tries = 0;
                 wait = 0.5;
+
+                /* Wake up the download threads waiting for new segments */
+                vlc_mutex_lock(&p_sys->download.lock_wait);
+                vlc_cond_broadcast(&p_sys->download.wait);
+                vlc_mutex_unlock(&p_sys->download.lock_wait);
             }
 
             hls_stream_t *hls = hls_Get(p_sys->hls_stream, p_sys->download.stream);
@@ -1693,12 +1863,18 @@ static int Prefetch(stream_t *s, int *current)
     else if (vlc_array_count(hls->segments) == 1 && p_sys->b_live)
         msg_Warn(s, "Only 1 segment available to prefetch in live stream; may stall");
 
+    hls_cipher_t cipher = { .b_open = false };
+    int ret = VLC_SUCCESS;
+
     /* Download first 2 segments of this HLS stream if they exist */
     for (int i = 0; i < __MIN(vlc_array_count(hls->segments), 2); i++)
     {
         segment_t *segment = segment_GetSegment(hls, p_sys->download.segment);
         if (segment == NULL )
-            return VLC_EGENERIC;
+        {
+            ret = VLC_EGENERIC;
+            break;
+        }
 
         /* It is useless to lock the segment here, as Prefetch is called before
            download and playlit thread are started. */
@@ -1708,29 +1884,36 @@ static int Prefetch(stream_t *s, int *current)
             continue;
         }
 
-        if (hls_DownloadSegmentData(s, hls, segment, current) != VLC_SUCCESS)
-            return VLC_EGENERIC;
+        if (hls_DownloadSegmentData(s, hls, segment, &cipher, current) != VLC_SUCCESS)
+        {
+            ret = VLC_EGENERIC;
+            break;
+        }
 
         p_sys->download.segment++;
 
         /* adapt bandwidth? */
         if (*current != stream)
         {
-            hls_stream_t *hls = hls_Get(p_sys->hls_stream, *current);
+            hls = hls_Get(p_sys->hls_stream, *current);
             if (hls == NULL)
-                return VLC_EGENERIC;
+            {
+                ret = VLC_EGENERIC;
+                break;
+            }
 
              stream = *current;
         }
     }
 
-    return VLC_SUCCESS;
+    hls_CipherClose(&cipher);
+    return ret;
 }
 
 /****************************************************************************
  *
  ****************************************************************************/
-static int hls_Download(stream_t *s, segment_t *segment)
+static int hls_Download(stream_t *s, segment_t *segment, hls_cipher_t *cipher)
 {
     assert(segment);
 
@@ -1751,7 +1934,9 @@ static int hls_Download(stream_t *s, segment_t *segment)
     assert(segment->data->i_buffer == segment->size);
 
     ssize_t length = 0, curlen = 0;
+    size_t decrypted = 0;
     uint64_t size;
+    int ret = VLC_SUCCESS;
     do
     {
         /* NOTE: Beware the size reported for a segment by the HLS server may not
@@ -1779,10 +1964,26 @@ static int hls_Download(stream_t *s, segment_t *segment)
         if (length <= 0)
             break;
         curlen += length;
+
+        /* Decrypt the complete AES blocks received so far, rather than the
+         * whole segment once it is downloaded */
+        if (cipher != NULL)
+        {
+            size_t end = curlen & ~(AES_BLOCK_SIZE - 1);
+            ret = hls_CipherDecrypt(s, cipher, segment->data->p_buffer + decrypted,
+                                    end - decrypted);
+            if (ret != VLC_SUCCESS)
+                break;
+            decrypted = end;
+        }
     } while (vlc_object_alive(s));
 
+    if (cipher != NULL && ret == VLC_SUCCESS)
+        ret = hls_CipherDecrypt(s, cipher, segment->data->p_buffer + decrypted,
+                                segment->data->i_buffer - decrypted);
+
     stream_Delete(p_ts);
-    return VLC_SUCCESS;
+    return ret;
 }
 
 /* Read M3U8 file */
@@ -1931,6 +2132,7 @@ static int Open(vlc_object_t *p_this)
         free(p_sys);
         return VLC_ENOMEM;
     }
+    vlc_mutex_init(&p_sys->lock_key);
 
     /* */
     s->pf_read = Read;
@@ -1960,19 +2162,20 @@ static int Open(vlc_object_t *p_this)
     /* manage encryption key if needed */
     hls_ManageSegmentKeys(s, hls_Get(p_sys->hls_stream, current));
 
+    vlc_mutex_init(&p_sys->download.lock_wait);
+    vlc_cond_init(&p_sys->download.wait);
+
     if (Prefetch(s, &current) != VLC_SUCCESS)
     {
         msg_Err(s, "fetching first segment failed.");
-        goto fail;
+        goto fail_thread;
     }
 
     p_sys->download.stream = current;
+    p_sys->download.ready = p_sys->download.segment;
     p_sys->playback.stream = current;
     p_sys->download.seek = -1;
 
-    vlc_mutex_init(&p_sys->download.lock_wait);
-    vlc_cond_init(&p_sys->download.wait);
-
     /* Initialize HLS live stream */
     if (p_sys->b_live)
     {
@@ -1987,7 +2190,15 @@ static int Open(vlc_object_t *p_this)
         }
     }
 
-    if (vlc_clone(&p_sys->thread, hls_Thread, s, VLC_THREAD_PRIORITY_INPUT))
+    unsigned parallel = var_InheritInteger(s, "hls-parallel");
+    parallel = __MAX(__MIN(parallel, HLS_PARALLEL_MAX), 1);
+
+    for (p_sys->threads = 0; p_sys->threads < parallel; p_sys->threads++)
+        if (vlc_clone(&p_sys->thread[p_sys->threads], hls_Thread, s,
+                      VLC_THREAD_PRIORITY_INPUT))
+            break;
+
+    if (p_sys->threads == 0)
     {
         if (p_sys->b_live)
             vlc_join(p_sys->reload, NULL);
@@ -2008,6 +2219,7 @@ fail:
         if (hls) hls_Free(hls);
     }
     vlc_array_destroy(p_sys->hls_stream);
+    vlc_mutex_destroy(&p_sys->lock_key);
 
     /* */
     free(p_sys->m3u8);
@@ -2030,13 +2242,15 @@ static void Close(vlc_object_t *p_this)
     /* negate the condition variable's predicate */
     p_sys->download.segment = p_sys->playback.segment = 0;
     p_sys->download.seek = 0; /* better safe than sorry */
-    vlc_cond_signal(&p_sys->download.wait);
+    p_sys->download.b_close = true;
+    vlc_cond_broadcast(&p_sys->download.wait);
     vlc_mutex_unlock(&p_sys->download.lock_wait);
 
     /* */
     if (p_sys->b_live)
         vlc_join(p_sys->reload, NULL);
-    vlc_join(p_sys->thread, NULL);
+    for (unsigned i = 0; i < p_sys->threads; i++)
+        vlc_join(p_sys->thread[i], NULL);
     vlc_mutex_destroy(&p_sys->download.lock_wait);
     vlc_cond_destroy(&p_sys->download.wait);
 
@@ -2047,6 +2261,7 @@ static void Close(vlc_object_t *p_this)
         if (hls) hls_Free(hls);
     }
     vlc_array_destroy(p_sys->hls_stream);
+    vlc_mutex_destroy(&p_sys->lock_key);
 
     /* */
     free(p_sys->m3u8);
@@ -2067,6 +2282,20 @@ static segment_t *GetSegment(stream_t *s)
     hls_stream_t *hls = hls_Get(p_sys->hls_stream, p_sys->playback.stream);
     if (hls != NULL)
     {
+        vlc_mutex_lock(&hls->lock);
+        int count = vlc_array_count(hls->segments);
+        vlc_mutex_unlock(&hls->lock);
+
+        /* Wait for it rather than reporting the end of the stream, unless
+         * the end of the playlist is reached */
+        vlc_mutex_lock(&p_sys->download.lock_wait);
+        while ((p_sys->download.ready <= p_sys->playback.segment) &&
+               (p_sys->b_live || (p_sys->playback.segment < count)) &&
+               !p_sys->b_error && vlc_object_alive(s))
+            vlc_cond_timedwait(&p_sys->download.wait, &p_sys->download.lock_wait,
+                               mdate() + CLOCK_FREQ / 10);
+        vlc_mutex_unlock(&p_sys->download.lock_wait);
+
         vlc_mutex_lock(&hls->lock);
         segment = segment_GetSegment(hls, p_sys->playback.segment);
         if (segment != NULL)
@@ -2103,7 +2332,7 @@ static segment_t *GetSegment(stream_t *s)
         }
 
         vlc_mutex_lock(&p_sys->download.lock_wait);
-        int i_segment = p_sys->download.segment;
+        int i_segment = p_sys->download.ready;
         vlc_mutex_unlock(&p_sys->download.lock_wait);
 
         vlc_mutex_lock(&segment->lock);
@@ -2135,11 +2364,11 @@ check:
         int count = vlc_array_count(hls->segments);
         vlc_mutex_unlock(&hls->lock);
 
-        if ((p_sys->download.segment - p_sys->playback.segment == 0) &&
-            ((count != p_sys->download.segment) || p_sys->b_live))
+        if ((p_sys->download.ready - p_sys->playback.segment == 0) &&
+            ((count != p_sys->download.ready) || p_sys->b_live))
             msg_Err(s, "playback will stall");
-        else if ((p_sys->download.segment - p_sys->playback.segment < 3) &&
-                 ((count != p_sys->download.segment) || p_sys->b_live))
+        else if ((p_sys->download.ready - p_sys->playback.segment < 3) &&
+                 ((count != p_sys->download.ready) || p_sys->b_live))
             msg_Warn(s, "playback in danger of stalling");
     }
     return segment;
@@ -2187,10 +2416,10 @@ static ssize_t hls_Read(stream_t *s, uint8_t *p_read, unsigned int i_read)
 
             vlc_mutex_unlock(&segment->lock);
 
-            /* signal download thread */
+            /* signal download threads */
             vlc_mutex_lock(&p_sys->download.lock_wait);
             p_sys->playback.segment++;
-            vlc_cond_signal(&p_sys->download.wait);
+            vlc_cond_broadcast(&p_sys->download.wait);
             vlc_mutex_unlock(&p_sys->download.lock_wait);
             continue;
         }
@@ -2456,13 +2685,13 @@ static int segment_Seek(stream_t *s, const uint64_t pos)
         /* Wake up download thread */
         vlc_mutex_lock(&p_sys->download.lock_wait);
         p_sys->download.seek = p_sys->playback.segment;
-        vlc_cond_signal(&p_sys->download.wait);
+        vlc_cond_broadcast(&p_sys->download.wait);
 
         /* Wait for download to be finished */
         msg_Info(s, "seek to segment %d", p_sys->playback.segment);
         while ((p_sys->download.seek != -1) ||
-           ((p_sys->download.segment - p_sys->playback.segment < 3) &&
-                (p_sys->download.segment < count)))
+           ((p_sys->download.ready - p_sys->playback.segment < 3) &&
+                (p_sys->download.ready < count)))
         {
             vlc_cond_wait(&p_sys->download.wait, &p_sys->download.lock_wait);
             if (!vlc_object_alive(s) || s->b_error) break;
@@ -0,0 +1,410 @@
+/*****************************************************************************
+ * inflate.c: zlib decompression stream filter
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <zlib.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_stream.h>
+
+static int  Open (vlc_object_t *);
+static void Close (vlc_object_t *);
+
+vlc_module_begin ()
+    set_category (CAT_INPUT)
+    set_subcategory (SUBCAT_INPUT_STREAM_FILTER)
+    set_capability ("stream_filter", 30)
+    set_description (N_("gzip decompression"))
+    set_callbacks (Open, Close)
+vlc_module_end ()
+
+/*
+ * The gzip stream is decompressed in-process. So that seeking does not
+ * always restart from the beginning, a copy of the decompressor state is
+ * kept every CHECKPOINT_SPACING bytes of output (when the source can seek).
+ * When the table is full, every other checkpoint is dropped and the spacing
+ * doubles, which bounds the memory whatever the stream length.
+ */
+#define CHECKPOINT_SPACING (1 << 22)
+#define CHECKPOINT_MAX     64
+#define INPUT_SIZE         (1 << 15)
+#define SKIP_SIZE          (1 << 16)
+
+typedef struct
+{
+    uint64_t in_offset;  /* source offset of the next compressed byte */
+    uint64_t out_offset; /* decompressed offset */
+    z_stream zstream;
+} checkpoint_t;
+
+struct stream_sys_t
+{
+    z_stream     zstream;
+    bool         eof;
+    uint64_t     in_offset; /* source offset after the buffered input */
+    uint64_t     out_offset; /* decompressed offset of the decoder */
+    uint64_t     offset; /* read offset (out_offset minus the peeked data) */
+    block_t     *peeked;
+
+    bool         can_seek;
+    uint64_t     start; /* source offset of the gzip stream */
+    unsigned     spacing;
+    unsigned     count;
+    checkpoint_t checkpoints[CHECKPOINT_MAX];
+
+    uint8_t      input[INPUT_SIZE];
+};
+
+static void AddCheckpoint (stream_t *stream)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    if (sys->count == CHECKPOINT_MAX)
+    {
+        for (unsigned i = 0; i < CHECKPOINT_MAX; i++)
+            if (i & 1)
+                inflateEnd (&sys->checkpoints[i].zstream);
+            else
+                sys->checkpoints[i / 2] = sys->checkpoints[i];
+        sys->count = CHECKPOINT_MAX / 2;
+        sys->spacing *= 2;
+    }
+
+    checkpoint_t *cp = &sys->checkpoints[sys->count];
+    if (inflateCopy (&cp->zstream, &sys->zstream) != Z_OK)
+        return;
+    cp->in_offset = sys->in_offset - sys->zstream.avail_in;
+    cp->out_offset = sys->out_offset;
+    sys->count++;
+}
+
+/**
+ * Decompresses up to len bytes.
+ * @return the byte count, 0 at the end of the stream.
+ */
+static size_t Inflate (stream_t *stream, uint8_t *buf, size_t len)
+{
+    stream_sys_t *sys = stream->p_sys;
+    size_t total = 0;
+
+    while (total < len && !sys->eof)
+    {
+        if (sys->can_seek)
+        {
+            uint64_t last = sys->count ? sys->checkpoints[sys->count - 1].out_offset
+                                       : 0;
+            if (sys->out_offset >= last + sys->spacing)
+                AddCheckpoint (stream);
+        }
+
+        if (sys->zstream.avail_in == 0)
+        {
+            int val = stream_Read (stream->p_source, sys->input, INPUT_SIZE);
+            if (val <= 0)
+            {
+                sys->eof = true;
+                break;
+            }
+            sys->zstream.next_in = sys->input;
+            sys->zstream.avail_in = val;
+            sys->in_offset += val;
+        }
+
+        sys->zstream.next_out = buf + total;
+        sys->zstream.avail_out = len - total;
+
+        int val = inflate (&sys->zstream, Z_NO_FLUSH);
+        size_t length = (len - total) - sys->zstream.avail_out;
+
+        total += length;
+        sys->out_offset += length;
+
+        switch (val)
+        {
+            case Z_OK:
+                break;
+            case Z_STREAM_END:
+                /* Concatenated gzip members form a single stream */
+                inflateReset (&sys->zstream);
+                break;
+            case Z_BUF_ERROR:
+                if (length > 0 || sys->zstream.avail_in == 0)
+                    break;
+                /* fall through */
+            default:
+                /* Trailing garbage after a member is not an error */
+                if (sys->out_offset == 0 || sys->zstream.total_out > 0)
+                    msg_Err (stream, "decompression error: %s",
+                             sys->zstream.msg ? sys->zstream.msg : "?");
+                sys->eof = true;
+                break;
+        }
+    }
+    return total;
+}
+
+/**
+ * Restarts the decompression from the last checkpoint before pos, or from
+ * the beginning of the stream.
+ */
+static int Restore (stream_t *stream, uint64_t pos)
+{
+    stream_sys_t *sys = stream->p_sys;
+    checkpoint_t *cp = NULL;
+
+    for (unsigned i = sys->count; i > 0; i--)
+        if (sys->checkpoints[i - 1].out_offset <= pos)
+        {
+            cp = &sys->checkpoints[i - 1];
+            break;
+        }
+
+    uint64_t in_offset = cp ? cp->in_offset : sys->start;
+    if (stream_Seek (stream->p_source, in_offset))
+        return VLC_EGENERIC;
+
+    inflateEnd (&sys->zstream);
+    if (cp != NULL)
+    {
+        if (inflateCopy (&sys->zstream, &cp->zstream) != Z_OK)
+            goto error;
+        sys->out_offset = cp->out_offset;
+    }
+    else
+    {
+        memset (&sys->zstream, 0, sizeof (sys->zstream));
+        if (inflateInit2 (&sys->zstream, 15 + 32) != Z_OK)
+            goto error;
+        sys->out_offset = 0;
+    }
+    sys->zstream.next_in = sys->input;
+    sys->zstream.avail_in = 0;
+    sys->in_offset = in_offset;
+    sys->offset = sys->out_offset;
+    sys->eof = false;
+    return VLC_SUCCESS;
+
+error:
+    /* The decoder is unusable */
+    memset (&sys->zstream, 0, sizeof (sys->zstream));
+    inflateInit2 (&sys->zstream, 15 + 32);
+    sys->eof = true;
+    return VLC_EGENERIC;
+}
+
+/**
+ * Discards decompressed data up to pos.
+ */
+static void Skip (stream_t *stream, uint64_t pos)
+{
+    stream_sys_t *sys = stream->p_sys;
+    uint8_t buf[SKIP_SIZE];
+
+    while (sys->offset < pos)
+    {
+        uint64_t len = pos - sys->offset;
+        size_t val = Inflate (stream, buf, (len < SKIP_SIZE) ? len : SKIP_SIZE);
+        if (val == 0)
+            break;
+        sys->offset += val;
+    }
+}
+
+static int Seek (stream_t *stream, uint64_t pos)
+{
+    stream_sys_t *sys = stream->p_sys;
+    block_t *peeked = sys->peeked;
+
+    if (peeked != NULL)
+    {
+        if (pos >= sys->offset && pos - sys->offset < peeked->i_buffer)
+        {
+            peeked->p_buffer += pos - sys->offset;
+            peeked->i_buffer -= pos - sys->offset;
+            sys->offset = pos;
+            return VLC_SUCCESS;
+        }
+        sys->offset += peeked->i_buffer;
+        block_Release (peeked);
+        sys->peeked = NULL;
+    }
+    assert (sys->offset == sys->out_offset);
+
+    /* Go backward, or forward to a checkpoint past the current position */
+    bool restore = pos < sys->offset;
+    for (unsigned i = 0; !restore && i < sys->count; i++)
+    {
+        uint64_t cp = sys->checkpoints[i].out_offset;
+        restore = cp > sys->offset && cp <= pos;
+    }
+    if (restore && (!sys->can_seek || Restore (stream, pos)))
+        return VLC_EGENERIC;
+
+    Skip (stream, pos);
+    return (sys->offset == pos) ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+static int Peek (stream_t *, const uint8_t **, unsigned int);
+
+/**
+ * Reads decompressed data.
+ * @return 0 for EOF, byte count otherwise.
+ */
+static int Read (stream_t *stream, void *buf, unsigned int buflen)
+{
+    stream_sys_t *sys = stream->p_sys;
+    block_t *peeked = sys->peeked;
+    size_t length = 0;
+
+    if (buf == NULL)
+    {   /* caller skips data */
+        uint64_t pos = sys->offset;
+        Seek (stream, pos + buflen);
+        return sys->offset - pos;
+    }
+
+    if (peeked != NULL)
+    {   /* dequeue peeked data */
+        length = (buflen > peeked->i_buffer) ? peeked->i_buffer : buflen;
+        memcpy (buf, peeked->p_buffer, length);
+        peeked->p_buffer += length;
+        peeked->i_buffer -= length;
+        if (peeked->i_buffer == 0)
+        {
+            block_Release (peeked);
+            sys->peeked = NULL;
+        }
+        sys->offset += length;
+    }
+
+    if (length < buflen)
+    {
+        size_t val = Inflate (stream, (uint8_t *)buf + length, buflen - length);
+        sys->offset += val;
+        length += val;
+    }
+    return length;
+}
+
+static int Peek (stream_t *stream, const uint8_t **pbuf, unsigned int len)
+{
+    stream_sys_t *sys = stream->p_sys;
+    block_t *peeked = sys->peeked;
+    size_t curlen = 0;
+
+    if (peeked == NULL)
+        peeked = block_Alloc (len);
+    else if ((curlen = peeked->i_buffer) < len)
+        peeked = block_Realloc (peeked, 0, len);
+
+    if ((sys->peeked = peeked) == NULL)
+        return 0;
+
+    if (curlen < len)
+    {
+        curlen += Inflate (stream, peeked->p_buffer + curlen, len - curlen);
+        peeked->i_buffer = curlen;
+    }
+    *pbuf = peeked->p_buffer;
+    return curlen;
+}
+
+static int Control (stream_t *stream, int query, va_list args)
+{
+    stream_sys_t *sys = stream->p_sys;
+
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+            *(va_arg (args, bool *)) = sys->can_seek;
+            break;
+        case STREAM_CAN_FASTSEEK:
+            *(va_arg (args, bool *)) = false;
+            break;
+        case STREAM_GET_POSITION:
+            *(va_arg (args, uint64_t *)) = sys->offset;
+            break;
+        case STREAM_GET_SIZE:
+            *(va_arg (args, uint64_t *)) = 0;
+            break;
+        case STREAM_SET_POSITION:
+            return Seek (stream, va_arg (args, uint64_t));
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int Open (vlc_object_t *obj)
+{
+    stream_t      *stream = (stream_t *)obj;
+    const uint8_t *peek;
+
+    if (stream_Peek (stream->p_source, &peek, 3) < 3)
+        return VLC_EGENERIC;
+
+    if (memcmp (peek, "\x1f\x8b\x08", 3))
+        return VLC_EGENERIC;
+
+    stream_sys_t *sys = malloc (sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    memset (&sys->zstream, 0, sizeof (sys->zstream));
+    if (inflateInit2 (&sys->zstream, 15 + 32) != Z_OK)
+    {
+        free (sys);
+        return VLC_ENOMEM;
+    }
+    sys->eof = false;
+    sys->start = stream_Tell (stream->p_source);
+    sys->in_offset = sys->start;
+    sys->out_offset = 0;
+    sys->offset = 0;
+    sys->peeked = NULL;
+    stream_Control (stream->p_source, STREAM_CAN_SEEK, &sys->can_seek);
+    sys->spacing = CHECKPOINT_SPACING;
+    sys->count = 0;
+
+    stream->p_sys = sys;
+    stream->pf_read = Read;
+    stream->pf_peek = Peek;
+    stream->pf_control = Control;
+    msg_Dbg (obj, "detected gzip compressed stream");
+    return VLC_SUCCESS;
+}
+
+static void Close (vlc_object_t *obj)
+{
+    stream_t *stream = (stream_t *)obj;
+    stream_sys_t *sys = stream->p_sys;
+
+    for (unsigned i = 0; i < sys->count; i++)
+        inflateEnd (&sys->checkpoints[i].zstream);
+    inflateEnd (&sys->zstream);
+    if (sys->peeked != NULL)
+        block_Release (sys->peeked);
+    free (sys);
+}
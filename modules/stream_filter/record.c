@@ -33,6 +33,7 @@
 
 #include <assert.h>
 #include <vlc_stream.h>
+#include <vlc_block.h>
 #include <vlc_input.h>
 #include <vlc_fs.h>
 
@@ -58,6 +59,24 @@ struct stream_sys_t
 {
     FILE *f;        /* TODO it could be replaced by access_output_t one day */
     bool b_error;
+
+    /* Asynchronous writer */
+    bool         b_async;
+    bool         b_drop;      /* drop rather than wait when the queue is full */
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait;        /* signaled to the writer */
+    vlc_cond_t   wait_space;  /* signaled by the writer */
+    block_t      *p_first;
+    block_t      **pp_last;
+    size_t       i_queued;    /* bytes queued or being written */
+    size_t       i_max;
+    bool         b_exit;
+    bool         b_dropping;
+
+    /* Statistics */
+    uint64_t     i_dropped;
+    unsigned     i_stalls;
 };
 
 
@@ -72,6 +91,10 @@ static int  Start  ( stream_t *, const char *psz_extension );
 static int  Stop   ( stream_t * );
 static void Write  ( stream_t *, const uint8_t *p_buffer, size_t i_buffer );
 
+static int  WriterStart( stream_t * );
+static void WriterStop ( stream_t * );
+static void WriterQueue( stream_t *, block_t * );
+
 /****************************************************************************
  * Open
  ****************************************************************************/
@@ -86,6 +109,7 @@ static int Open ( vlc_object_t *p_this )
         return VLC_ENOMEM;
 
     p_sys->f = NULL;
+    p_sys->b_async = false;
 
     /* */
     s->pf_read = Read;
@@ -112,11 +136,37 @@ static void Close( vlc_object_t *p_this )
 /****************************************************************************
  * Stream filters functions
  ****************************************************************************/
+static int ReadAsync( stream_t *s, void *p_read, unsigned int i_read )
+{
+    /* Read directly into the queued block when the data is skipped */
+    block_t *p_block = block_Alloc( i_read );
+    if( !p_block )
+        return stream_Read( s->p_source, p_read, i_read );
+
+    const int i_record = stream_Read( s->p_source,
+                                      p_read ? p_read : p_block->p_buffer,
+                                      i_read );
+    if( i_record <= 0 )
+    {
+        block_Release( p_block );
+        return i_record;
+    }
+
+    if( p_read )
+        memcpy( p_block->p_buffer, p_read, i_record );
+    p_block->i_buffer = i_record;
+    WriterQueue( s, p_block );
+    return i_record;
+}
+
 static int Read( stream_t *s, void *p_read, unsigned int i_read )
 {
     stream_sys_t *p_sys = s->p_sys;
     void *p_record = p_read;
 
+    if( p_sys->f && p_sys->b_async )
+        return ReadAsync( s, p_read, i_read );
+
     /* Allocate a temporary buffer for record when no p_read */
     if( p_sys->f && !p_record )
         p_record = malloc( i_read );
@@ -207,6 +257,9 @@ static int Start( stream_t *s, const char *psz_extension )
     /* */
     p_sys->f = f;
     p_sys->b_error = false;
+
+    if( var_InheritBool( s, "input-record-async" ) && WriterStart( s ) )
+        msg_Warn( s, "recording synchronously" );
     return VLC_SUCCESS;
 }
 static int Stop( stream_t *s )
@@ -215,6 +268,9 @@ static int Stop( stream_t *s )
 
     assert( p_sys->f );
 
+    if( p_sys->b_async )
+        WriterStop( s );
+
     msg_Dbg( s, "Recording completed" );
     fclose( p_sys->f );
     p_sys->f = NULL;
@@ -241,3 +297,137 @@ static void Write( stream_t *s, const uint8_t *p_buffer, size_t i_buffer )
             msg_Err( s, "Failed to record data (end)" );
     }
 }
+
+/****************************************************************************
+ * Asynchronous writer
+ ****************************************************************************/
+static void *WriterThread( void *p_data )
+{
+    stream_t *s = p_data;
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    for( ;; )
+    {
+        while( !p_sys->p_first && !p_sys->b_exit )
+            vlc_cond_wait( &p_sys->wait, &p_sys->lock );
+
+        block_t *p_chain = p_sys->p_first;
+        if( !p_chain )
+            break;
+        p_sys->p_first = NULL;
+        p_sys->pp_last = &p_sys->p_first;
+        vlc_mutex_unlock( &p_sys->lock );
+
+        size_t i_written = 0;
+        while( p_chain )
+        {
+            block_t *p_next = p_chain->p_next;
+
+            Write( s, p_chain->p_buffer, p_chain->i_buffer );
+            i_written += p_chain->i_buffer;
+            block_Release( p_chain );
+            p_chain = p_next;
+        }
+
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->i_queued -= i_written;
+        vlc_cond_signal( &p_sys->wait_space );
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+    return NULL;
+}
+
+static int WriterStart( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    p_sys->b_drop = var_InheritBool( s, "input-record-drop" );
+    p_sys->i_max = var_InheritInteger( s, "input-record-queue" ) << 10;
+    p_sys->p_first = NULL;
+    p_sys->pp_last = &p_sys->p_first;
+    p_sys->i_queued = 0;
+    p_sys->b_exit = false;
+    p_sys->b_dropping = false;
+    p_sys->i_dropped = 0;
+    p_sys->i_stalls = 0;
+
+    vlc_mutex_init( &p_sys->lock );
+    vlc_cond_init( &p_sys->wait );
+    vlc_cond_init( &p_sys->wait_space );
+
+    if( vlc_clone( &p_sys->thread, WriterThread, s, VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_cond_destroy( &p_sys->wait_space );
+        vlc_cond_destroy( &p_sys->wait );
+        vlc_mutex_destroy( &p_sys->lock );
+        return VLC_EGENERIC;
+    }
+    p_sys->b_async = true;
+    msg_Dbg( s, "recording asynchronously, up to %zu bytes queued%s",
+             p_sys->i_max, p_sys->b_drop ? ", dropping on overflow" : "" );
+    return VLC_SUCCESS;
+}
+
+static void WriterStop( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_exit = true;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+    vlc_join( p_sys->thread, NULL );
+
+    vlc_cond_destroy( &p_sys->wait_space );
+    vlc_cond_destroy( &p_sys->wait );
+    vlc_mutex_destroy( &p_sys->lock );
+    p_sys->b_async = false;
+
+    if( p_sys->i_dropped > 0 )
+        msg_Warn( s, "%"PRIu64" bytes were not recorded", p_sys->i_dropped );
+    if( p_sys->i_stalls > 0 )
+        msg_Dbg( s, "the input waited for the recording %u times",
+                 p_sys->i_stalls );
+}
+
+static void WriterQueue( stream_t *s, block_t *p_block )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    const size_t i_size = p_block->i_buffer;
+
+    vlc_mutex_lock( &p_sys->lock );
+    /* A block larger than the queue is accepted once the queue is empty */
+    if( p_sys->i_queued > 0 && p_sys->i_queued + i_size > p_sys->i_max )
+    {
+        if( p_sys->b_drop )
+        {
+            /* TODO maybe a intf_UserError or something like that ? */
+            if( !p_sys->b_dropping )
+                msg_Err( s, "Recording is too slow, dropping data (begin)" );
+            p_sys->b_dropping = true;
+            p_sys->i_dropped += i_size;
+            vlc_mutex_unlock( &p_sys->lock );
+            block_Release( p_block );
+            return;
+        }
+
+        p_sys->i_stalls++;
+        do
+            vlc_cond_wait( &p_sys->wait_space, &p_sys->lock );
+        while( p_sys->i_queued > 0 && p_sys->i_queued + i_size > p_sys->i_max );
+    }
+
+    if( p_sys->b_dropping )
+    {
+        msg_Err( s, "Recording is too slow, dropping data (end)" );
+        p_sys->b_dropping = false;
+    }
+
+    p_block->p_next = NULL;
+    *p_sys->pp_last = p_block;
+    p_sys->pp_last = &p_block->p_next;
+    p_sys->i_queued += i_size;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+}
@@ -142,6 +142,85 @@ static int sms_Download( stream_t *s, chunk_t *chunk, char *url )
     vlc_mutex_lock( &p_sys->download.lock_wait );
     int index = es_cat_to_index( chunk->type );
     p_sys->download.lead[index] += chunk->duration;
+    p_sys->download.buffered += chunk->size;
+    vlc_mutex_unlock( &p_sys->download.lock_wait );
+
+    return VLC_SUCCESS;
+}
+
+/* The fragment cache is a ring in a temporary file. A fragment overwritten
+ * by a newer one is forgotten, so only the recently watched part of a VOD
+ * is kept */
+static void cache_Invalidate( stream_sys_t *p_sys, uint64_t start, uint64_t end )
+{
+    for( int i = 0; i < vlc_array_count( p_sys->sms_streams ); i++ )
+    {
+        sms_stream_t *sms = vlc_array_item_at_index( p_sys->sms_streams, i );
+        for( int j = 0; j < vlc_array_count( sms->chunks ); j++ )
+        {
+            chunk_t *chunk = vlc_array_item_at_index( sms->chunks, j );
+            if( chunk->cache_size > 0 && chunk->cache_offset < end &&
+                chunk->cache_offset + chunk->cache_size > start )
+                chunk->cache_size = 0;
+        }
+    }
+}
+
+static void cache_Put( stream_t *s, chunk_t *chunk, unsigned qlvl )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( p_sys->cache.file == NULL || (uint64_t)chunk->size > p_sys->cache.size )
+        return;
+
+    if( p_sys->cache.pos + chunk->size > p_sys->cache.size )
+        p_sys->cache.pos = 0;
+    cache_Invalidate( p_sys, p_sys->cache.pos, p_sys->cache.pos + chunk->size );
+
+    if( fseeko( p_sys->cache.file, p_sys->cache.pos, SEEK_SET ) ||
+        fwrite( chunk->data, chunk->size, 1, p_sys->cache.file ) != 1 )
+    {
+        msg_Warn( s, "cannot write to the fragment cache, disabling it" );
+        fclose( p_sys->cache.file );
+        p_sys->cache.file = NULL;
+        cache_Invalidate( p_sys, 0, UINT64_MAX );
+        return;
+    }
+
+    chunk->cache_offset = p_sys->cache.pos;
+    chunk->cache_size = chunk->size;
+    chunk->cache_qlvl = qlvl;
+    p_sys->cache.pos += chunk->size;
+}
+
+static int cache_Get( stream_t *s, chunk_t *chunk, unsigned qlvl )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( p_sys->cache.file == NULL || chunk->cache_size == 0 ||
+        chunk->cache_qlvl != qlvl )
+        return VLC_EGENERIC;
+
+    chunk->data = malloc( chunk->cache_size );
+    if( chunk->data == NULL )
+        return VLC_ENOMEM;
+
+    if( fseeko( p_sys->cache.file, chunk->cache_offset, SEEK_SET ) ||
+        fread( chunk->data, chunk->cache_size, 1, p_sys->cache.file ) != 1 )
+    {
+        FREENULL( chunk->data );
+        chunk->cache_size = 0;
+        return VLC_EGENERIC;
+    }
+
+    chunk->size = chunk->cache_size;
+    chunk->offset = p_sys->download.next_chunk_offset;
+    p_sys->download.next_chunk_offset += chunk->size;
+
+    vlc_mutex_lock( &p_sys->download.lock_wait );
+    int index = es_cat_to_index( chunk->type );
+    p_sys->download.lead[index] += chunk->duration;
+    p_sys->download.buffered += chunk->size;
     vlc_mutex_unlock( &p_sys->download.lock_wait );
 
     return VLC_SUCCESS;
@@ -404,6 +483,14 @@ static int Download( stream_t *s, sms_stream_t *sms )
 
     chunk->type = sms->type;
 
+    /* Seeking back in a VOD does not download the fragments again */
+    if( cache_Get( s, chunk, qlevel->id ) == VLC_SUCCESS )
+    {
+        msg_Dbg( s, "chunk %u of stream %s read from the cache",
+                 chunk->sequence, sms->name );
+        goto downloaded;
+    }
+
     char *url = ConstructUrl( sms->url_template, p_sys->base_url,
                                   qlevel->Bitrate, chunk->start_time );
     if( !url )
@@ -448,15 +535,24 @@ static int Download( stream_t *s, sms_stream_t *sms )
 
     if( p_sys->b_live )
         get_new_chunks( s, chunk );
+    else
+        cache_Put( s, chunk, qlevel->id );
+
+    msg_Info( s, "downloaded chunk %d from stream %s at quality %u",
+                chunk->sequence, sms->name, qlevel->Bitrate );
+
+    unsigned dur_ms = __MAX( 1, duration / 1000 );
+    uint64_t bw = chunk->size * 8 * 1000 / dur_ms; /* bits / s */
+    if( sms_queue_put( p_sys->bws, bw ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
+
+downloaded:
 
     vlc_mutex_lock( &p_sys->download.lock_wait );
     vlc_array_append( p_sys->download.chunks, chunk );
     vlc_cond_signal( &p_sys->download.wait );
     vlc_mutex_unlock( &p_sys->download.lock_wait );
 
-    msg_Info( s, "downloaded chunk %d from stream %s at quality %u",
-                chunk->sequence, sms->name, qlevel->Bitrate );
-
     uint64_t actual_lead = chunk->start_time + chunk->duration;
     int ind = es_cat_to_index( sms->type );
     p_sys->download.ck_index[ind] = chunk->sequence;
@@ -469,10 +565,6 @@ static int Download( stream_t *s, sms_stream_t *sms )
                                             (uint64_t)chunk->start_time );
     }
 
-    unsigned dur_ms = __MAX( 1, duration / 1000 );
-    uint64_t bw = chunk->size * 8 * 1000 / dur_ms; /* bits / s */
-    if( sms_queue_put( p_sys->bws, bw ) != VLC_SUCCESS )
-        return VLC_EGENERIC;
     avg_bw = sms_queue_avg( p_sys->bws );
 
     if( sms->type != VIDEO_ES )
@@ -619,7 +711,11 @@ void* sms_Thread( void *p_this )
 
         lead = get_lead( s );
 
-        while( lead > 10 * p_sys->timescale + start_time || NO_MORE_CHUNKS )
+        /* The tracks are downloaded until enough time is prefetched, or
+         * until the chunks not read yet fill the memory budget */
+        while( ( lead > 10 * p_sys->timescale + start_time || NO_MORE_CHUNKS ||
+                 p_sys->download.buffered >= p_sys->download.buffer_max ) &&
+               !p_sys->b_tseek )
         {
             vlc_cond_wait( &p_sys->download.wait, &p_sys->download.lock_wait );
             lead = get_lead( s );
@@ -653,6 +749,7 @@ void* sms_Thread( void *p_this )
                 p_sys->download.ck_index[i] = 0;
             }
             p_sys->download.next_chunk_offset = 0;
+            p_sys->download.buffered = 0;
 
             p_sys->playback.boffset = 0;
             p_sys->playback.index = 0;
@@ -28,6 +28,9 @@
 #endif
 
 #include <limits.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -40,6 +43,8 @@
 #include <vlc_stream.h>
 #include <vlc_es.h>
 #include <vlc_codecs.h>
+#include <vlc_fs.h>
+#include <vlc_configuration.h>
 
 #include "smooth.h"
 #include "../../demux/mp4/libmp4.h"
@@ -55,6 +60,16 @@
 static int  Open( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define BUFFER_TEXT N_("Prefetch memory (MiB)")
+#define BUFFER_LONGTEXT N_( \
+    "Maximum amount of memory used by the chunks downloaded in advance, " \
+    "shared by the audio, video and text tracks.")
+#define CACHE_TEXT N_("Fragment cache size (MiB)")
+#define CACHE_LONGTEXT N_( \
+    "Size of the temporary file keeping the recently played fragments " \
+    "of a VOD, so that seeking back does not download them again. " \
+    "0 disables the cache.")
+
 vlc_module_begin()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_STREAM_FILTER )
@@ -62,6 +77,8 @@ vlc_module_begin()
     set_shortname( "Smooth Streaming")
     add_shortcut( "smooth" )
     set_capability( "stream_filter", 30 )
+    add_integer( "smooth-buffer-size", 32, BUFFER_TEXT, BUFFER_LONGTEXT, true )
+    add_integer( "smooth-cache-size", 64, CACHE_TEXT, CACHE_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end()
 
@@ -120,6 +137,58 @@ static void print_chunk( stream_t *s, chunk_t *ck )
 }
 #endif
 
+static void cache_Open( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    int64_t size = var_InheritInteger( s, "smooth-cache-size" );
+    if( size <= 0 )
+        return;
+
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( !psz_cachedir )
+        return;
+    vlc_mkdir( psz_cachedir, 0700 );
+
+    char *psz_file;
+    if( asprintf( &psz_file, "%s"DIR_SEP"vlc-smooth.XXXXXX", psz_cachedir ) < 0 )
+    {
+        free( psz_cachedir );
+        return;
+    }
+    free( psz_cachedir );
+
+    int fd = vlc_mkstemp( psz_file );
+    if( fd < 0 )
+    {
+        msg_Warn( s, "cannot create the fragment cache %s", psz_file );
+        free( psz_file );
+        return;
+    }
+
+    p_sys->cache.file = fdopen( fd, "w+b" );
+    if( !p_sys->cache.file )
+    {
+        close( fd );
+        vlc_unlink( psz_file );
+        free( psz_file );
+        return;
+    }
+    p_sys->cache.path = psz_file;
+    p_sys->cache.size = (uint64_t)size << 20;
+    p_sys->cache.pos = 0;
+}
+
+static void cache_Close( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( p_sys->cache.file )
+        fclose( p_sys->cache.file );
+    if( p_sys->cache.path )
+        vlc_unlink( p_sys->cache.path );
+    free( p_sys->cache.path );
+}
+
 static int parse_Manifest( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -421,6 +490,11 @@ static int Open( vlc_object_t *p_this )
     if( !p_sys->vod_duration )
        p_sys->b_live = true;
 
+    p_sys->download.buffer_max =
+        (uint64_t)__MAX( var_InheritInteger( s, "smooth-buffer-size" ), 1 ) << 20;
+    if( !p_sys->b_live )
+        cache_Open( s );
+
     p_sys->i_tracks = vlc_array_count( p_sys->sms_streams );
 
     /* Choose first video / audio / subtitle stream available */
@@ -461,6 +535,7 @@ static int Open( vlc_object_t *p_this )
 
     if( vlc_clone( &p_sys->thread, sms_Thread, s, VLC_THREAD_PRIORITY_INPUT ) )
     {
+        cache_Close( s );
         free( p_sys );
         vlc_mutex_destroy( &p_sys->download.lock_wait );
         vlc_cond_destroy( &p_sys->download.wait );
@@ -504,6 +579,7 @@ static void Close( vlc_object_t *p_this )
         chunk_Free( chunk );
     }
 
+    cache_Close( s );
     sms_queue_free( p_sys->bws );
     vlc_array_destroy( p_sys->sms_streams );
     vlc_array_destroy( p_sys->selected_st );
@@ -579,6 +655,14 @@ static int sms_Read( stream_t *s, uint8_t *p_read, int i_read )
             }
             if( !p_sys->b_cache || p_sys->b_live )
             {
+                /* The init chunks are not accounted in the memory budget */
+                if( chunk->type != UNKNOWN_ES )
+                {
+                    vlc_mutex_lock( &p_sys->download.lock_wait );
+                    p_sys->download.buffered -= chunk->size;
+                    vlc_mutex_unlock( &p_sys->download.lock_wait );
+                    vlc_cond_signal( &p_sys->download.wait);
+                }
                 FREENULL( chunk->data );
                 chunk->read_pos = 0;
             }
@@ -50,6 +50,10 @@ typedef struct chunk_s
     int         type;       /* video, audio, or subtitles */
 
     uint8_t     *data;
+
+    uint64_t    cache_offset; /* position in the fragment cache */
+    int         cache_size;   /* size in the fragment cache, 0 if not cached */
+    unsigned    cache_qlvl;   /* quality level ID of the cached fragment */
 } chunk_t;
 
 typedef struct quality_level_s
@@ -108,11 +112,22 @@ struct stream_sys_t
         unsigned     ck_index[3]; /* current chunk for download */
 
         uint64_t     next_chunk_offset;
+        uint64_t     buffered;    /* bytes downloaded and not read yet */
+        uint64_t     buffer_max;  /* memory budget shared by the tracks */
         vlc_array_t  *chunks;     /* chunks that have been downloaded */
         vlc_mutex_t  lock_wait;   /* protect chunk download counter. */
         vlc_cond_t   wait;        /* some condition to wait on */
     } download;
 
+    /* Fragment cache, only used by the download thread */
+    struct sms_cache_s
+    {
+        FILE        *file;        /* NULL if there is no cache */
+        char        *path;
+        uint64_t    size;         /* capacity of the ring, in bytes */
+        uint64_t    pos;          /* next write position */
+    } cache;
+
     /* Playback */
     struct sms_playback_s
     {
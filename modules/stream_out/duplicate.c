@@ -267,6 +267,11 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
     sout_stream_sys_t *p_sys = p_stream->p_sys;
     sout_stream_t     *p_dup_stream;
     int               i_stream;
+    int               i_selected = 0;
+
+    for( i_stream = 0; i_stream < p_sys->i_nb_streams; i_stream++ )
+        if( id->pp_ids[i_stream] )
+            i_selected++;
 
     /* Loop through the linked list of buffers */
     while( p_buffer )
@@ -275,13 +280,18 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
 
         p_buffer->p_next = NULL;
 
+        /* All the outputs get the same payload, the ones that need to
+         * modify it get their own copy then */
+        if( i_selected > 1 )
+            p_buffer = block_MakeShared( p_buffer );
+
         for( i_stream = 0; i_stream < p_sys->i_nb_streams - 1; i_stream++ )
         {
             p_dup_stream = p_sys->pp_streams[i_stream];
 
             if( id->pp_ids[i_stream] )
             {
-                block_t *p_dup = block_Duplicate( p_buffer );
+                block_t *p_dup = block_Share( p_buffer );
 
                 if( p_dup )
                     sout_StreamIdSend( p_dup_stream, id->pp_ids[i_stream], p_dup );
@@ -330,8 +330,12 @@ static int OutputNew( sout_stream_t *p_stream,
     }
     free( psz_tmp );
 
-    if( asprintf( &psz_output, "std{access=file,mux='%s',dst='%s',no-append,"
-                  "no-format}", psz_muxer, psz_file ) < 0 )
+    /* The file access output has its own writer thread. It waits rather
+     * than drops, but only the record decoder threads are waiting then. */
+    const bool b_async = var_InheritBool( p_stream, "input-record-async" );
+    if( asprintf( &psz_output, "std{access=%s,mux='%s',dst='%s',no-append,"
+                  "no-format}", b_async ? "file{async}" : "file",
+                  psz_muxer, psz_file ) < 0 )
     {
         psz_output = NULL;
         goto error;
@@ -200,7 +200,10 @@ void CloseRTCP (rtcp_sender_t *rtcp)
 }
 
 
-void SendRTCP (rtcp_sender_t *restrict rtcp, const block_t *rtp)
+/**
+ * Accounts for an RTP packet of len bytes, whose RTP header is in rtp.
+ */
+void SendRTCP (rtcp_sender_t *restrict rtcp, const block_t *rtp, size_t len)
 {
     if ((rtcp == NULL) /* RTCP sender off */
      || (rtp->i_buffer < 12)) /* too short RTP packet */
@@ -208,8 +211,8 @@ void SendRTCP (rtcp_sender_t *restrict rtcp, const block_t *rtp)
 
     /* Updates statistics */
     rtcp->packets++;
-    rtcp->bytes += rtp->i_buffer;
-    rtcp->counter += rtp->i_buffer;
+    rtcp->bytes += len;
+    rtcp->counter += len;
 
     /* 1.25% rate limit */
     if ((rtcp->counter / 80) < rtcp->length)
@@ -40,6 +40,7 @@
 #include <vlc_network.h>
 #include <vlc_fs.h>
 #include <vlc_rand.h>
+#include <vlc_atomic.h>
 #ifdef HAVE_SRTP
 # include <srtp.h>
 # include <gcrypt.h>
@@ -353,6 +354,25 @@ typedef struct rtp_sink_t
     rtcp_sender_t *rtcp;
 } rtp_sink_t;
 
+/* Input block shared by the RTP packets carrying slices of its payload */
+typedef struct rtp_source_t
+{
+    atomic_uint  refs;
+    block_t     *p_block;
+} rtp_source_t;
+
+/* RTP packet made of its own headers and a slice of an input block */
+typedef struct rtp_slice_t
+{
+    block_t        self; /* RTP and payload headers */
+    rtp_source_t  *p_source;
+    const uint8_t *p_payload;
+    size_t         i_payload;
+    uint8_t        header[RTP_SLICE_HEADER_MAX];
+} rtp_slice_t;
+
+static void SourceRelease( rtp_source_t * );
+
 struct sout_stream_id_t
 {
     sout_stream_t *p_stream;
@@ -389,6 +409,9 @@ struct sout_stream_id_t
 
     block_fifo_t     *p_fifo;
     int64_t           i_caching;
+
+    /* Input block being packetized, once sliced */
+    rtp_source_t     *p_source;
 };
 
 /*****************************************************************************
@@ -982,6 +1005,7 @@ static sout_stream_id_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
     id->rtsp_id = NULL;
     id->p_fifo = NULL;
     id->listen.fd = NULL;
+    id->p_source = NULL;
 
     id->b_first_packet = true;
     id->i_caching =
@@ -1285,10 +1309,22 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
                                           p_buffer->i_pts);
         }
 
-        if( id->rtp_fmt.pf_packetize( id, p_buffer ) )
-            break;
+        int i_ret = id->rtp_fmt.pf_packetize( id, p_buffer );
 
-        block_Release( p_buffer );
+        /* The slices of the block, if any, keep it alive until sent */
+        if( id->p_source != NULL )
+        {
+            SourceRelease( id->p_source );
+            id->p_source = NULL;
+        }
+        else
+            block_Release( p_buffer );
+
+        if( i_ret )
+        {
+            block_ChainRelease( p_next );
+            break;
+        }
         p_buffer = p_next;
     }
     return VLC_SUCCESS;
@@ -1394,90 +1430,249 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
-static void* ThreadSend( void *data )
+static void ChainCleanup( void *data )
 {
+    block_ChainRelease( *(block_t **)data );
+}
+
+static void SourceRelease( rtp_source_t *p_source )
+{
+    if( atomic_fetch_sub( &p_source->refs, 1 ) == 1 )
+    {
+        block_Release( p_source->p_block );
+        free( p_source );
+    }
+}
+
+static void SliceRelease( block_t *p_block )
+{
+    rtp_slice_t *p_slice = (rtp_slice_t *)p_block;
+
+    SourceRelease( p_slice->p_source );
+    free( p_slice );
+}
+
+static inline bool IsSlice( const block_t *p_block )
+{
+    return p_block->pf_release == SliceRelease;
+}
+
+#if defined (HAVE_SRTP) || defined (WIN32)
+/** Copies a sliced packet into a single buffer */
+static block_t *SliceFlatten( block_t *out )
+{
+    rtp_slice_t *p_slice = (rtp_slice_t *)out;
+    block_t *p_flat = block_Alloc( out->i_buffer + p_slice->i_payload );
+
+    if( p_flat != NULL )
+    {
+        block_CopyProperties( p_flat, out );
+        memcpy( p_flat->p_buffer, out->p_buffer, out->i_buffer );
+        memcpy( p_flat->p_buffer + out->i_buffer, p_slice->p_payload,
+                p_slice->i_payload );
+    }
+    block_Release( out );
+    return p_flat;
+}
+#endif
+
+#ifdef HAVE_SRTP
+/**
+ * Protects a whole chain of RTP packets ahead of their sending time,
+ * dropping those that fail.
+ */
+static block_t *SrtpSendChain( sout_stream_id_t *id, block_t *chain )
+{
+    block_t *head = NULL, **pp = &head;
+    int canc = vlc_savecancel ();
+
+    while( chain != NULL )
+    {
+        block_t *out = chain;
+        chain = out->p_next;
+        out->p_next = NULL;
+
+        /* SRTP protects the whole packet in place */
+        if( IsSlice( out ) && ( out = SliceFlatten( out ) ) == NULL )
+            continue;
+
+        /* Blocks have enough padding for the tag: this does not copy */
+        size_t len = out->i_buffer;
+        out = block_Realloc( out, 0, len + 10 );
+        if( out == NULL )
+            continue;
+        out->i_buffer = len;
+
+        int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
+        if( val )
+        {
+            errno = val;
+            msg_Dbg( id->p_stream, "SRTP sending error: %m" );
+            block_Release( out );
+            continue;
+        }
+        out->i_buffer = len;
+        *pp = out;
+        pp = &out->p_next;
+    }
+    vlc_restorecancel (canc);
+    return head;
+}
+#endif
+
 #ifdef WIN32
 # define ENOBUFS      WSAENOBUFS
 # define EAGAIN       WSAEWOULDBLOCK
 # define EWOULDBLOCK  WSAEWOULDBLOCK
 #endif
+
+/* Packets sent to all the sinks at once, if they are due */
+#define RTP_SEND_BATCH 64
+
+#ifdef HAVE_SENDMMSG
+typedef struct mmsghdr rtp_msg_t;
+#else
+typedef struct { struct msghdr msg_hdr; } rtp_msg_t;
+#endif
+
+static ssize_t SendPacket( int fd, const struct msghdr *msg )
+{
+#ifndef WIN32
+    return sendmsg( fd, msg, 0 );
+#else
+    return send( fd, msg->msg_iov[0].iov_base, msg->msg_iov[0].iov_len, 0 );
+#endif
+}
+
+/**
+ * Sends a batch of packets to one sink.
+ * @return false if the connection is broken
+ */
+static bool SendPackets( int fd, rtp_msg_t *msgv, unsigned n )
+{
+    for( unsigned i = 0; i < n; )
+    {
+#ifdef HAVE_SENDMMSG
+        int val = sendmmsg( fd, msgv + i, n - i, 0 );
+#else
+        int val = ( SendPacket( fd, &msgv[i].msg_hdr ) == -1 ) ? -1 : 1;
+#endif
+        if( val > 0 )
+        {
+            i += val;
+            continue;
+        }
+
+        if( net_errno != EAGAIN && net_errno != EWOULDBLOCK
+         && net_errno != ENOBUFS && net_errno != ENOMEM )
+        {
+            int type;
+            getsockopt( fd, SOL_SOCKET, SO_TYPE,
+                        &type, &(socklen_t){ sizeof(type) });
+            if( type != SOCK_DGRAM )
+                return false; /* Broken connection */
+
+            /* ICMP soft error: ignore and retry */
+            SendPacket( fd, &msgv[i].msg_hdr );
+        }
+        /* Otherwise drop the packet */
+        i++;
+    }
+    return true;
+}
+
+static void* ThreadSend( void *data )
+{
     sout_stream_id_t *id = data;
     unsigned i_caching = id->i_caching;
 
     for (;;)
     {
-        block_t *out = block_FifoGet( id->p_fifo );
-        block_cleanup_push (out);
-
+        /* Dequeue all pending packets in one go */
+        block_t *chain = block_FifoGetBatch( id->p_fifo, SIZE_MAX,
+                                             VLC_TS_INVALID );
+        vlc_cleanup_push( ChainCleanup, &chain );
 #ifdef HAVE_SRTP
         if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
+            chain = SrtpSendChain( id, chain );
+#endif
 
-            int canc = vlc_savecancel ();
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            vlc_restorecancel (canc);
-            if( val )
+        while( chain != NULL )
+        {
+            mwait (chain->i_dts + i_caching);
+
+            /* Take the first packet, and those already due behind it */
+            block_t *outv[RTP_SEND_BATCH];
+            rtp_msg_t msgv[RTP_SEND_BATCH];
+            struct iovec iov[RTP_SEND_BATCH][2];
+            size_t lenv[RTP_SEND_BATCH];
+            unsigned n = 0;
+            const mtime_t now = mdate();
+
+            do
             {
-                errno = val;
-                msg_Dbg( id->p_stream, "SRTP sending error: %m" );
-                block_Release( out );
-                out = NULL;
-            }
-            else
-                out->i_buffer = len;
-        }
-        if (out)
-            mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
-        if (out == NULL)
-            continue;
-#else
-        mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
+                block_t *out = chain;
+                chain = out->p_next;
+                out->p_next = NULL;
+#ifdef WIN32
+                /* No scatter/gather output */
+                if( IsSlice( out ) && ( out = SliceFlatten( out ) ) == NULL )
+                    continue;
 #endif
+                iov[n][0].iov_base = out->p_buffer;
+                iov[n][0].iov_len = out->i_buffer;
+                iov[n][1].iov_len = 0;
+                if( IsSlice( out ) )
+                {
+                    const rtp_slice_t *p_slice = (const rtp_slice_t *)out;
 
-        ssize_t len = out->i_buffer;
-        int canc = vlc_savecancel ();
+                    iov[n][1].iov_base = (void *)p_slice->p_payload;
+                    iov[n][1].iov_len = p_slice->i_payload;
+                }
+                memset( &msgv[n], 0, sizeof( msgv[n] ) );
+                msgv[n].msg_hdr.msg_iov = iov[n];
+                msgv[n].msg_hdr.msg_iovlen = iov[n][1].iov_len ? 2 : 1;
+                lenv[n] = iov[n][0].iov_len + iov[n][1].iov_len;
+                outv[n++] = out;
+            }
+            while( chain != NULL && n < RTP_SEND_BATCH
+                && chain->i_dts + i_caching <= now );
 
-        vlc_mutex_lock( &id->lock_sink );
-        unsigned deadc = 0; /* How many dead sockets? */
-        int deadv[id->sinkc]; /* Dead sockets list */
+            if( n == 0 )
+                continue;
 
-        for( int i = 0; i < id->sinkc; i++ )
-        {
+            int canc = vlc_savecancel ();
+
+            vlc_mutex_lock( &id->lock_sink );
+            unsigned deadc = 0; /* How many dead sockets? */
+            int deadv[id->sinkc]; /* Dead sockets list */
+
+            for( int i = 0; i < id->sinkc; i++ )
+            {
 #ifdef HAVE_SRTP
-            if( !id->srtp ) /* FIXME: SRTCP support */
+                if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+                    for( unsigned j = 0; j < n; j++ )
+                        SendRTCP( id->sinkv[i].rtcp, outv[j], lenv[j] );
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
-             && net_errno != EAGAIN && net_errno != EWOULDBLOCK
-             && net_errno != ENOBUFS && net_errno != ENOMEM )
-            {
-                int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
-                            &type, &(socklen_t){ sizeof(type) });
-                if( type == SOCK_DGRAM )
-                    /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
-                else
-                    /* Broken connection */
+                if( !SendPackets( id->sinkv[i].rtp_fd, msgv, n ) )
                     deadv[deadc++] = id->sinkv[i].rtp_fd;
             }
-        }
-        id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
-        vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
+            id->i_seq_sent_next =
+                ntohs(((uint16_t *) outv[n - 1]->p_buffer)[1]) + 1;
+            vlc_mutex_unlock( &id->lock_sink );
 
-        for( unsigned i = 0; i < deadc; i++ )
-        {
-            msg_Dbg( id->p_stream, "removing socket %d", deadv[i] );
-            rtp_del_sink( id, deadv[i] );
+            for( unsigned j = 0; j < n; j++ )
+                block_Release( outv[j] );
+
+            for( unsigned i = 0; i < deadc; i++ )
+            {
+                msg_Dbg( id->p_stream, "removing socket %d", deadv[i] );
+                rtp_del_sink( id, deadv[i] );
+            }
+            vlc_restorecancel (canc);
         }
-        vlc_restorecancel (canc);
+        vlc_cleanup_pop ();
     }
     return NULL;
 }
@@ -1660,6 +1855,44 @@ void rtp_packetize_send( sout_stream_id_t *id, block_t *out )
     block_FifoPut( id->p_fifo, out );
 }
 
+/**
+ * Creates an RTP packet carrying a slice of the payload of the input block
+ * being packetized. The slice is sent after the packet buffer, which has
+ * room for RTP_SLICE_HEADER_MAX bytes of RTP and payload headers: the
+ * payload is not copied.
+ */
+block_t *rtp_packetize_slice( sout_stream_id_t *id, block_t *in,
+                              const uint8_t *p_payload, size_t i_payload )
+{
+    rtp_slice_t *p_slice = malloc( sizeof( *p_slice ) );
+    if( unlikely(p_slice == NULL) )
+        return NULL;
+
+    rtp_source_t *p_source = id->p_source;
+    if( p_source == NULL )
+    {
+        p_source = malloc( sizeof( *p_source ) );
+        if( unlikely(p_source == NULL) )
+        {
+            free( p_slice );
+            return NULL;
+        }
+        /* This reference is dropped once the block is packetized */
+        atomic_init( &p_source->refs, 1 );
+        p_source->p_block = in;
+        id->p_source = p_source;
+    }
+    assert( p_source->p_block == in );
+    atomic_fetch_add( &p_source->refs, 1 );
+
+    block_Init( &p_slice->self, p_slice->header, sizeof( p_slice->header ) );
+    p_slice->self.pf_release = SliceRelease;
+    p_slice->p_source = p_source;
+    p_slice->p_payload = p_payload;
+    p_slice->i_payload = i_payload;
+    return &p_slice->self;
+}
+
 /**
  * @return configured max RTP payload size (including payload type-specific
  * headers, excluding RTP and transport headers)
@@ -59,6 +59,10 @@ void rtp_packetize_common (sout_stream_id_t *id, block_t *out,
 void rtp_packetize_send (sout_stream_id_t *id, block_t *out);
 size_t rtp_mtu (const sout_stream_id_t *id);
 
+#define RTP_SLICE_HEADER_MAX 32
+block_t *rtp_packetize_slice (sout_stream_id_t *id, block_t *in,
+                              const uint8_t *p_payload, size_t i_payload);
+
 int rtp_packetize_xiph_config( sout_stream_id_t *id, const char *fmtp,
                                int64_t i_pts );
 
@@ -67,7 +71,7 @@ typedef struct rtcp_sender_t rtcp_sender_t;
 rtcp_sender_t *OpenRTCP (vlc_object_t *obj, int rtp_fd, int proto,
                          bool mux);
 void CloseRTCP (rtcp_sender_t *rtcp);
-void SendRTCP (rtcp_sender_t *restrict rtcp, const block_t *rtp);
+void SendRTCP (rtcp_sender_t *restrict rtcp, const block_t *rtp, size_t len);
 
 typedef int (*pf_rtp_packetizer_t)( sout_stream_id_t *, block_t * );
 
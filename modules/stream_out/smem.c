@@ -85,6 +85,21 @@
                         "If true, stream will render as usual, else " \
                         "it will be rendered as fast as possible.")
 
+#define T_QUEUE N_( "Queue size" )
+#define LT_QUEUE N_( "Maximum number of blocks waiting to be delivered " \
+                     "for each stream. If not zero, the callbacks are " \
+                     "called from a separate thread, so that a slow " \
+                     "application does not stall the stream output." )
+
+#define T_QUEUE_DROP N_( "Drop blocks when the queue is full" )
+#define LT_QUEUE_DROP N_( "If true, blocks arriving while the queue is full " \
+                          "are dropped, else the stream output waits." )
+
+#define T_BATCH N_( "Deliver queued audio at once" )
+#define LT_BATCH N_( "If true, all the audio blocks queued when the " \
+                     "application is ready are delivered in a single " \
+                     "buffer, with the timestamp of the first one." )
+
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
@@ -113,6 +128,9 @@ vlc_module_begin ()
         change_volatile()
     add_bool( SOUT_CFG_PREFIX "time-sync", true, T_TIME_SYNC, LT_TIME_SYNC, true )
         change_private()
+    add_integer( SOUT_CFG_PREFIX "queue", 0, T_QUEUE, LT_QUEUE, true )
+    add_bool( SOUT_CFG_PREFIX "queue-drop", false, T_QUEUE_DROP, LT_QUEUE_DROP, true )
+    add_bool( SOUT_CFG_PREFIX "batch", false, T_BATCH, LT_BATCH, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -122,7 +140,8 @@ vlc_module_end ()
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
     "video-prerender-callback", "audio-prerender-callback",
-    "video-postrender-callback", "audio-postrender-callback", "video-data", "audio-data", "time-sync", NULL
+    "video-postrender-callback", "audio-postrender-callback", "video-data", "audio-data", "time-sync",
+    "queue", "queue-drop", "batch", NULL
 };
 
 static sout_stream_id_t *Add ( sout_stream_t *, es_format_t * );
@@ -136,11 +155,19 @@ static int SendVideo( sout_stream_t *p_stream, sout_stream_id_t *id,
                       block_t *p_buffer );
 static int SendAudio( sout_stream_t *p_stream, sout_stream_id_t *id,
                       block_t *p_buffer );
+static int Deliver( sout_stream_t *p_stream, sout_stream_id_t *id,
+                    block_t *p_buffer );
 
 struct sout_stream_id_t
 {
     es_format_t* format;
     void *p_data;
+
+    /* Queued mode */
+    sout_stream_t *p_stream;
+    block_fifo_t *p_fifo;
+    vlc_thread_t thread;
+    unsigned i_dropped;
 };
 
 struct sout_stream_sys_t
@@ -151,6 +178,9 @@ struct sout_stream_sys_t
     void ( *pf_video_postrender_callback ) ( void* p_video_data, uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch, int size, mtime_t pts );
     void ( *pf_audio_postrender_callback ) ( void* p_audio_data, uint8_t* p_pcm_buffer, unsigned int channels, unsigned int rate, unsigned int nb_samples, unsigned int bits_per_sample, unsigned int size, mtime_t pts );
     bool time_sync;
+    unsigned i_queue;
+    bool b_queue_drop;
+    bool b_batch;
 };
 
 /*****************************************************************************
@@ -171,6 +201,9 @@ static int Open( vlc_object_t *p_this )
                        p_stream->p_cfg );
 
     p_sys->time_sync = var_GetBool( p_stream, SOUT_CFG_PREFIX "time-sync" );
+    p_sys->i_queue = __MAX( var_GetInteger( p_stream, SOUT_CFG_PREFIX "queue" ), 0 );
+    p_sys->b_queue_drop = var_GetBool( p_stream, SOUT_CFG_PREFIX "queue-drop" );
+    p_sys->b_batch = var_GetBool( p_stream, SOUT_CFG_PREFIX "batch" );
 
     psz_tmp = var_GetString( p_stream, SOUT_PREFIX_VIDEO "prerender-callback" );
     p_sys->pf_video_prerender_callback = (void (*) (void *, uint8_t**, int))(intptr_t)atoll( psz_tmp );
@@ -206,14 +239,57 @@ static void Close( vlc_object_t * p_this )
     free( p_stream->p_sys );
 }
 
+/* Delivers the queued blocks, so that the callbacks do not block Send() */
+static void *Thread( void *data )
+{
+    sout_stream_id_t *id = data;
+    sout_stream_t *p_stream = id->p_stream;
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    for( ;; )
+    {
+        block_t *p_buffer;
+
+        if( p_sys->b_batch && id->format->i_cat == AUDIO_ES )
+            p_buffer = block_FifoGetBatch( id->p_fifo, SIZE_MAX, VLC_TS_INVALID );
+        else
+            p_buffer = block_FifoGet( id->p_fifo );
+        if( p_buffer == NULL )
+            continue;
+
+        int canc = vlc_savecancel();
+        Deliver( p_stream, id, p_buffer );
+        vlc_restorecancel( canc );
+    }
+    return NULL;
+}
+
 static sout_stream_id_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
 {
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
     sout_stream_id_t *id = NULL;
 
     if ( p_fmt->i_cat == VIDEO_ES )
         id = AddVideo( p_stream, p_fmt );
     else if ( p_fmt->i_cat == AUDIO_ES )
         id = AddAudio( p_stream, p_fmt );
+
+    if( id != NULL && p_sys->i_queue > 0 )
+    {
+        id->p_stream = p_stream;
+        id->p_fifo = block_FifoNew();
+        if( id->p_fifo == NULL )
+        {
+            free( id );
+            return NULL;
+        }
+        if( vlc_clone( &id->thread, Thread, id, VLC_THREAD_PRIORITY_OUTPUT ) )
+        {
+            block_FifoRelease( id->p_fifo );
+            free( id );
+            return NULL;
+        }
+    }
     return id;
 }
 
@@ -292,7 +368,15 @@ static sout_stream_id_t *AddAudio( sout_stream_t *p_stream, es_format_t *p_fmt )
 
 static int Del( sout_stream_t *p_stream, sout_stream_id_t *id )
 {
-    VLC_UNUSED( p_stream );
+    if( id->p_fifo != NULL )
+    {
+        vlc_cancel( id->thread );
+        vlc_join( id->thread, NULL );
+        block_FifoRelease( id->p_fifo );
+        if( id->i_dropped > 0 )
+            msg_Warn( p_stream, "%u blocks dropped (queue full)",
+                      id->i_dropped );
+    }
     free( id );
     return VLC_SUCCESS;
 }
@@ -300,13 +384,54 @@ static int Del( sout_stream_t *p_stream, sout_stream_id_t *id )
 static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
                  block_t *p_buffer )
 {
-    if ( id->format->i_cat == VIDEO_ES )
-        return SendVideo( p_stream, id, p_buffer );
-    else if ( id->format->i_cat == AUDIO_ES )
-        return SendAudio( p_stream, id, p_buffer );
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( id->p_fifo == NULL )
+        return Deliver( p_stream, id, p_buffer );
+
+    /* Only this thread adds blocks, so the queue cannot grow meanwhile */
+    if( p_sys->b_queue_drop )
+    {
+        if( block_FifoCount( id->p_fifo ) >= p_sys->i_queue )
+        {
+            id->i_dropped++;
+            block_ChainRelease( p_buffer );
+            return VLC_SUCCESS;
+        }
+    }
+    else
+        block_FifoPace( id->p_fifo, p_sys->i_queue - 1, SIZE_MAX );
+    block_FifoPut( id->p_fifo, p_buffer );
     return VLC_SUCCESS;
 }
 
+/* Calls the callbacks of the application once per block of the chain, or
+ * once for the whole chain of audio blocks in batch mode */
+static int Deliver( sout_stream_t *p_stream, sout_stream_id_t *id,
+                    block_t *p_buffer )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    int i_ret = VLC_SUCCESS;
+
+    if( id->format->i_cat == AUDIO_ES && p_sys->b_batch )
+        return SendAudio( p_stream, id, block_ChainGather( p_buffer ) );
+
+    while( p_buffer != NULL )
+    {
+        block_t *p_next = p_buffer->p_next;
+
+        p_buffer->p_next = NULL;
+        if ( id->format->i_cat == VIDEO_ES )
+            i_ret = SendVideo( p_stream, id, p_buffer );
+        else if ( id->format->i_cat == AUDIO_ES )
+            i_ret = SendAudio( p_stream, id, p_buffer );
+        else
+            block_Release( p_buffer );
+        p_buffer = p_next;
+    }
+    return i_ret;
+}
+
 static int SendVideo( sout_stream_t *p_stream, sout_stream_id_t *id,
                       block_t *p_buffer )
 {
@@ -179,6 +179,46 @@ static int transcode_audio_filter_chain_build( sout_stream_t *p_stream, filter_c
 }
 
 
+static void* EncoderThread( void *obj )
+{
+    sout_stream_id_t *id = (sout_stream_id_t*)obj;
+    int canc = vlc_savecancel ();
+
+    vlc_mem_SetAccount( "transcode" );
+
+    vlc_mutex_lock( &id->lock_out );
+    for( ;; )
+    {
+        block_t *p_audio_buf, *p_block;
+
+        while( !id->b_abort && id->p_in == NULL )
+            vlc_cond_wait( &id->cond, &id->lock_out );
+        if( id->b_abort )
+            break;
+
+        p_audio_buf = id->p_in;
+        id->p_in = p_audio_buf->p_next;
+        if( id->p_in == NULL )
+            id->pp_in_last = &id->p_in;
+        p_audio_buf->p_next = NULL;
+        id->i_in--;
+        id->b_encoding = true;
+        vlc_mutex_unlock( &id->lock_out );
+
+        p_block = id->p_encoder->pf_encode_audio( id->p_encoder, p_audio_buf );
+        block_Release( p_audio_buf );
+
+        vlc_mutex_lock( &id->lock_out );
+        block_ChainAppend( &id->p_buffers, p_block );
+        id->b_encoding = false;
+        vlc_cond_signal( &id->cond_space );
+    }
+    vlc_mutex_unlock( &id->lock_out );
+
+    vlc_restorecancel (canc);
+    return NULL;
+}
+
 int transcode_audio_new( sout_stream_t *p_stream,
                                 sout_stream_id_t *id )
 {
@@ -246,6 +286,7 @@ int transcode_audio_new( sout_stream_t *p_stream,
         id->p_decoder->p_module = NULL;
         return VLC_EGENERIC;
     }
+    transcode_encoder_delay( p_stream, id->p_encoder );
     id->p_encoder->fmt_in.audio.i_format = id->p_encoder->fmt_in.i_codec;
     id->p_encoder->fmt_in.audio.i_bitspersample =
         aout_BitsPerSample( id->p_encoder->fmt_in.i_codec );
@@ -289,11 +330,53 @@ int transcode_audio_new( sout_stream_t *p_stream,
     }
     fmt_last = id->p_encoder->fmt_in;
 
+    if( p_sys->b_audio_thread )
+    {
+        int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
+                           VLC_THREAD_PRIORITY_AUDIO;
+        vlc_mutex_init( &id->lock_out );
+        vlc_cond_init( &id->cond );
+        vlc_cond_init( &id->cond_space );
+        id->p_in = NULL;
+        id->pp_in_last = &id->p_in;
+        id->i_in = 0;
+        id->p_buffers = NULL;
+        id->b_abort = false;
+        id->b_encoding = false;
+        if( vlc_clone( &id->thread, EncoderThread, id, i_priority ) )
+        {
+            msg_Err( p_stream, "cannot spawn audio encoder thread" );
+            vlc_mutex_destroy( &id->lock_out );
+            vlc_cond_destroy( &id->cond );
+            vlc_cond_destroy( &id->cond_space );
+            transcode_audio_close( id );
+            return VLC_EGENERIC;
+        }
+        id->b_threaded = true;
+    }
+
     return VLC_SUCCESS;
 }
 
 void transcode_audio_close( sout_stream_id_t *id )
 {
+    if( id->b_threaded )
+    {
+        vlc_mutex_lock( &id->lock_out );
+        id->b_abort = true;
+        vlc_cond_signal( &id->cond );
+        vlc_mutex_unlock( &id->lock_out );
+
+        vlc_join( id->thread, NULL );
+        vlc_mutex_destroy( &id->lock_out );
+        vlc_cond_destroy( &id->cond );
+        vlc_cond_destroy( &id->cond_space );
+
+        block_ChainRelease( id->p_in );
+        block_ChainRelease( id->p_buffers );
+        id->b_threaded = false;
+    }
+
     /* Close decoder */
     if( id->p_decoder->p_module )
         module_unneed( id->p_decoder, id->p_decoder->p_module );
@@ -326,6 +409,19 @@ int transcode_audio_process( sout_stream_t *p_stream,
     if( unlikely( in == NULL ) )
     {
         block_t *p_block;
+
+        if( id->b_threaded )
+        {
+            /* Let EncoderThread() go through the queued buffers, it then
+             * leaves the encoder alone so that we can flush it here */
+            vlc_mutex_lock( &id->lock_out );
+            while( id->p_in != NULL || id->b_encoding )
+                vlc_cond_wait( &id->cond_space, &id->lock_out );
+            *out = id->p_buffers;
+            id->p_buffers = NULL;
+            vlc_mutex_unlock( &id->lock_out );
+        }
+
         do {
            p_block = id->p_encoder->pf_encode_audio(id->p_encoder, NULL );
            block_ChainAppend( out, p_block );
@@ -370,12 +466,32 @@ int transcode_audio_process( sout_stream_t *p_stream,
 
         p_audio_buf->i_dts = p_audio_buf->i_pts;
 
+        if( id->b_threaded )
+        {
+            vlc_mutex_lock( &id->lock_out );
+            while( id->i_in >= ENCODER_MAX_AUDIO_BUFFERS )
+                vlc_cond_wait( &id->cond_space, &id->lock_out );
+            block_ChainLastAppend( &id->pp_in_last, p_audio_buf );
+            id->i_in++;
+            vlc_cond_signal( &id->cond );
+            vlc_mutex_unlock( &id->lock_out );
+            continue;
+        }
+
         p_block = id->p_encoder->pf_encode_audio( id->p_encoder, p_audio_buf );
 
         block_ChainAppend( out, p_block );
         block_Release( p_audio_buf );
     }
 
+    if( id->b_threaded )
+    {
+        vlc_mutex_lock( &id->lock_out );
+        block_ChainAppend( out, id->p_buffers );
+        id->p_buffers = NULL;
+        vlc_mutex_unlock( &id->lock_out );
+    }
+
     return VLC_SUCCESS;
 }
 
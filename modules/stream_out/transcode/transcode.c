@@ -79,6 +79,13 @@
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
     "are applied). You can enter a colon-separated list of filters." )
+#define VRENDITIONS_TEXT N_("Additional video renditions")
+#define VRENDITIONS_LONGTEXT N_( \
+    "Encodes the decoded video again for each entry of this colon-separated " \
+    "list of <width>x<height>@<kb/s> renditions (e.g. 1280x720@2500:x360@800" \
+    "), with the same video encoder. A missing dimension keeps the aspect " \
+    "ratio and a missing bitrate uses the main one. The n-th rendition of " \
+    "an ES is output as an ES whose id is (n << 16) | id of the source ES.")
 
 #define AENC_TEXT N_("Audio encoder")
 #define AENC_LONGTEXT N_( \
@@ -128,8 +135,12 @@
     "Number of threads used for the transcoding." )
 #define HP_TEXT N_("High priority")
 #define HP_LONGTEXT N_( \
-    "Runs the optional encoder thread at the OUTPUT priority instead of " \
-    "VIDEO." )
+    "Runs the optional encoder threads at the OUTPUT priority instead of " \
+    "VIDEO or AUDIO." )
+#define ATHREAD_TEXT N_("Audio encoder thread")
+#define ATHREAD_LONGTEXT N_( \
+    "Encodes each audio track in its own thread, concurrently with its " \
+    "decoding and with the other tracks." )
 
 #define ASYNC_TEXT N_("Synchronise on audio track")
 #define ASYNC_LONGTEXT N_( \
@@ -187,6 +198,8 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list( SOUT_CFG_PREFIX "vfilter", "video filter2",
                      NULL, VFILTER_TEXT, VFILTER_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "vrenditions", NULL, VRENDITIONS_TEXT,
+                VRENDITIONS_LONGTEXT, true )
 
     set_section( N_("Audio"), NULL )
     add_module( SOUT_CFG_PREFIX "aenc", "encoder", NULL, AENC_TEXT,
@@ -205,6 +218,8 @@ vlc_module_begin ()
               ASYNC_LONGTEXT, false )
     add_module_list( SOUT_CFG_PREFIX "afilter",  "audio filter",
                      NULL, AFILTER_TEXT, AFILTER_LONGTEXT, false )
+    add_bool( SOUT_CFG_PREFIX "audio-thread", false, ATHREAD_TEXT,
+              ATHREAD_LONGTEXT, true )
 
     set_section( N_("Overlays/Subtitles"), NULL )
     add_module( SOUT_CFG_PREFIX "senc", "encoder", NULL, SENC_TEXT,
@@ -234,7 +249,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "hurry-up", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "osd", "audio-sync", "high-priority", "maxwidth", "maxheight",
-    NULL
+    "audio-thread", "vrenditions", NULL
 };
 
 /*****************************************************************************
@@ -244,6 +259,57 @@ static sout_stream_id_t *Add ( sout_stream_t *, es_format_t * );
 static int               Del ( sout_stream_t *, sout_stream_id_t * );
 static int               Send( sout_stream_t *, sout_stream_id_t *, block_t* );
 
+/*****************************************************************************
+ * ParseRenditions: parse the list of additional video renditions
+ *****************************************************************************/
+static void ParseRenditions( sout_stream_t *p_stream, const char *psz_list )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    char *psz_dup, *psz_save;
+
+    p_sys->p_renditions = NULL;
+    p_sys->i_renditions = 0;
+    if( psz_list == NULL || *psz_list == '\0' )
+        return;
+
+    psz_dup = strdup( psz_list );
+    if( psz_dup == NULL )
+        return;
+
+    for( char *psz = strtok_r( psz_dup, ":", &psz_save ); psz != NULL;
+         psz = strtok_r( NULL, ":", &psz_save ) )
+    {
+        transcode_rendition_cfg_t cfg = { 0, 0, 0 };
+        transcode_rendition_cfg_t *p_new;
+        char *psz_end;
+
+        cfg.i_width = strtoul( psz, &psz_end, 10 );
+        if( *psz_end == 'x' )
+            cfg.i_height = strtoul( psz_end + 1, &psz_end, 10 );
+        if( *psz_end == '@' )
+            cfg.i_bitrate = strtol( psz_end + 1, &psz_end, 10 );
+        if( *psz_end != '\0' || cfg.i_bitrate < 0 )
+        {
+            msg_Warn( p_stream, "invalid video rendition `%s' ignored", psz );
+            continue;
+        }
+        cfg.i_width &= ~1;
+        cfg.i_height &= ~1;
+        if( cfg.i_bitrate < 16000 ) cfg.i_bitrate *= 1000;
+
+        p_new = realloc( p_sys->p_renditions,
+                         (p_sys->i_renditions + 1) * sizeof( *p_new ) );
+        if( p_new == NULL )
+            break;
+        p_sys->p_renditions = p_new;
+        p_sys->p_renditions[p_sys->i_renditions++] = cfg;
+
+        msg_Dbg( p_stream, "video rendition %dx%d %dkb/s", cfg.i_width,
+                 cfg.i_height, cfg.i_bitrate / 1000 );
+    }
+    free( psz_dup );
+}
+
 /*****************************************************************************
  * Open:
  *****************************************************************************/
@@ -318,6 +384,8 @@ static int Open( vlc_object_t *p_this )
         p_sys->psz_af = NULL;
     free( psz_string );
 
+    p_sys->b_audio_thread = var_GetBool( p_stream, SOUT_CFG_PREFIX "audio-thread" );
+
     /* Video transcoding parameters */
     psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "venc" );
     p_sys->psz_venc = NULL;
@@ -380,6 +448,10 @@ static int Open( vlc_object_t *p_this )
     }
     free( psz_string );
 
+    psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "vrenditions" );
+    ParseRenditions( p_stream, psz_string );
+    free( psz_string );
+
     p_sys->i_threads = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_sys->b_high_priority = var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" );
 
@@ -489,6 +561,7 @@ static void Close( vlc_object_t * p_this )
     free( p_sys->psz_alang );
 
     free( p_sys->psz_vf2 );
+    free( p_sys->p_renditions );
 
     config_ChainDestroy( p_sys->p_video_cfg );
     free( p_sys->psz_venc );
@@ -651,6 +724,14 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
         return VLC_EGENERIC;
     }
 
+    /* The decoders may modify the data in place */
+    if( p_buffer != NULL )
+    {
+        p_buffer = block_Unshare( p_buffer );
+        if( p_buffer == NULL )
+            return VLC_ENOMEM;
+    }
+
     switch( id->p_decoder->fmt_in.i_cat )
     {
     case AUDIO_ES:
@@ -692,3 +773,20 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
         return sout_StreamIdSend( p_stream->p_next, id->id, p_out );
     return VLC_SUCCESS;
 }
+
+/**
+ * Reports the delay of an opened encoder, so that the muxers wait for the
+ * streams it outputs late.
+ */
+void transcode_encoder_delay( sout_stream_t *p_stream,
+                              const encoder_t *p_enc )
+{
+    if( p_enc->i_delay <= 0 )
+        return;
+
+    msg_Dbg( p_stream, "encoder delay: %"PRId64" ms", p_enc->i_delay / 1000 );
+    if( p_enc->i_delay > var_GetInteger( p_stream->p_sout,
+                                         "sout-encoder-delay" ) )
+        var_SetInteger( p_stream->p_sout, "sout-encoder-delay",
+                        p_enc->i_delay );
+}
@@ -10,17 +10,47 @@
 #include <vlc_codec.h>
 
 #include <vlc_picture_fifo.h>
+#include <vlc_memstat.h>
 
 #define MASTER_SYNC_MAX_DRIFT 100000
 
+/* Maximum number of pictures and audio buffers waiting for an encoder
+ * thread: the decoding side waits beyond that, so that a slow encoder
+ * throttles the input instead of queuing raw data without bound */
+#define ENCODER_MAX_PICTURES 8
+#define ENCODER_MAX_AUDIO_BUFFERS 32
+
+/* Additional encoding of the decoded video, see transcode_video_process() */
+typedef struct
+{
+    unsigned int    i_width, i_height;  /* 0 to keep the aspect ratio */
+    int             i_bitrate;          /* 0 to use the main bitrate */
+} transcode_rendition_cfg_t;
+
+typedef struct
+{
+    encoder_t       *p_encoder;
+    /* Scaling and chroma conversion from the decoder output */
+    filter_chain_t  *p_f_chain;
+    /* Index of an earlier rendition with the same encoder input, whose
+     * filtered pictures are reused, or -1 */
+    int             i_same_as;
+    picture_t       *p_pic;
+    /* id of the out stream */
+    void            *id;
+} transcode_rendition_t;
+
 struct sout_stream_sys_t
 {
     sout_stream_id_t *id_video;
     block_t         *p_buffers;
     vlc_mutex_t     lock_out;
     vlc_cond_t      cond;
+    vlc_cond_t      cond_space; /* a picture has been encoded */
     bool            b_abort;
+    bool            b_encoding;
     picture_fifo_t *pp_pics;
+    unsigned        i_pics;
     vlc_thread_t    thread;
 
     /* Audio */
@@ -31,6 +61,7 @@ struct sout_stream_sys_t
     uint32_t        i_sample_rate;
     uint32_t        i_channels;
     int             i_abitrate;
+    bool            b_audio_thread;
 
     char            *psz_af;
 
@@ -53,6 +84,9 @@ struct sout_stream_sys_t
 
     char            *psz_vf2;
 
+    transcode_rendition_cfg_t *p_renditions;
+    int             i_renditions;
+
     /* SPU */
     vlc_fourcc_t    i_scodec;   /* codec spu (0 if not transcode) */
     char            *psz_senc;
@@ -89,11 +123,29 @@ struct sout_stream_id_t
 
     /* Encoder */
     encoder_t       *p_encoder;
+    /* Additional video encoders */
+    transcode_rendition_t *p_renditions;
+    int             i_renditions;
+
+    /* Encoder thread (audio only, the video one is in sout_stream_sys_t) */
+    bool            b_threaded;
+    vlc_thread_t    thread;
+    vlc_mutex_t     lock_out;
+    vlc_cond_t      cond;
+    vlc_cond_t      cond_space; /* a buffer has been encoded */
+    bool            b_abort;
+    bool            b_encoding;
+    block_t         *p_in;
+    block_t         **pp_in_last;
+    unsigned        i_in;
+    block_t         *p_buffers;
 
     /* Sync */
     date_t          interpolated_pts;
 };
 
+void transcode_encoder_delay( sout_stream_t *, const encoder_t * );
+
 /* OSD */
 
 int transcode_osd_new( sout_stream_t *p_stream, sout_stream_id_t *id );
@@ -104,6 +104,8 @@ static void* EncoderThread( void *obj )
     picture_t *p_pic;
     int canc = vlc_savecancel ();
 
+    vlc_mem_SetAccount( "transcode" );
+
     for( ;; )
     {
         block_t *p_block;
@@ -118,13 +120,16 @@ static void* EncoderThread( void *obj )
             vlc_mutex_unlock( &p_sys->lock_out );
             break;
         }
+        p_sys->i_pics--;
+        p_sys->b_encoding = true;
         vlc_mutex_unlock( &p_sys->lock_out );
 
         p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
 
         vlc_mutex_lock( &p_sys->lock_out );
         block_ChainAppend( &p_sys->p_buffers, p_block );
-
+        p_sys->b_encoding = false;
+        vlc_cond_signal( &p_sys->cond_space );
         vlc_mutex_unlock( &p_sys->lock_out );
         picture_Release( p_pic );
     }
@@ -230,6 +235,7 @@ int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_t *id )
         p_sys->id_video = id;
         vlc_mutex_init( &p_sys->lock_out );
         vlc_cond_init( &p_sys->cond );
+        vlc_cond_init( &p_sys->cond_space );
         p_sys->pp_pics = picture_fifo_New();
         if( p_sys->pp_pics == NULL )
         {
@@ -240,7 +246,9 @@ int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_t *id )
             return VLC_ENOMEM;
         }
         p_sys->p_buffers = NULL;
+        p_sys->i_pics = 0;
         p_sys->b_abort = false;
+        p_sys->b_encoding = false;
         if( vlc_clone( &p_sys->thread, EncoderThread, p_sys, i_priority ) )
         {
             msg_Err( p_stream, "cannot spawn encoder thread" );
@@ -253,6 +261,16 @@ int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_t *id )
     return VLC_SUCCESS;
 }
 
+/* The pictures of an opaque chroma are in video memory, where the filters
+ * cannot convert them: an encoder accepting them also scales them itself */
+static bool transcode_video_is_opaque( vlc_fourcc_t i_chroma )
+{
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( i_chroma );
+
+    return p_dsc && p_dsc->plane_count == 0;
+}
+
 static void transcode_video_filter_init( sout_stream_t *p_stream,
                                          sout_stream_id_t *id )
 {
@@ -275,10 +293,11 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
     /* Take care of the scaling and chroma conversions */
     if( ( id->p_decoder->fmt_out.video.i_chroma !=
           id->p_encoder->fmt_in.video.i_chroma ) ||
-        ( id->p_decoder->fmt_out.video.i_width !=
-          id->p_encoder->fmt_in.video.i_width ) ||
-        ( id->p_decoder->fmt_out.video.i_height !=
-          id->p_encoder->fmt_in.video.i_height ) )
+        ( !transcode_video_is_opaque( id->p_encoder->fmt_in.video.i_chroma ) &&
+          ( ( id->p_decoder->fmt_out.video.i_width !=
+              id->p_encoder->fmt_in.video.i_width ) ||
+            ( id->p_decoder->fmt_out.video.i_height !=
+              id->p_encoder->fmt_in.video.i_height ) ) ) )
     {
        filter_chain_AppendFilter( id->p_f_chain,
                                   NULL, NULL,
@@ -485,6 +504,12 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
              id->p_encoder->fmt_out.video.i_sar_num * id->p_encoder->fmt_out.video.i_width,
              id->p_encoder->fmt_out.video.i_sar_den * id->p_encoder->fmt_out.video.i_height );
 
+    /* Offer the decoded surfaces as they are, the encoder asks for another
+     * chroma if it cannot read them */
+    if( !id->p_encoder->p_module &&
+        transcode_video_is_opaque( id->p_decoder->fmt_out.video.i_chroma ) )
+        id->p_encoder->fmt_in.i_codec = id->p_decoder->fmt_out.video.i_chroma;
+
     id->p_encoder->fmt_in.video.i_chroma = id->p_encoder->fmt_in.i_codec;
 }
 
@@ -507,8 +532,20 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
                  (char *)&p_sys->i_vcodec );
         return VLC_EGENERIC;
     }
+    transcode_encoder_delay( p_stream, id->p_encoder );
 
-    id->p_encoder->fmt_in.video.i_chroma = id->p_encoder->fmt_in.i_codec;
+    /* The filters convert to the chroma the encoder was offered */
+    if( id->p_encoder->fmt_in.video.i_chroma != id->p_encoder->fmt_in.i_codec )
+    {
+        id->p_encoder->fmt_in.video.i_chroma = id->p_encoder->fmt_in.i_codec;
+        if( id->p_f_chain )
+            filter_chain_Delete( id->p_f_chain );
+        id->p_f_chain = NULL;
+        if( id->p_uf_chain )
+            filter_chain_Delete( id->p_uf_chain );
+        id->p_uf_chain = NULL;
+        transcode_video_filter_init( p_stream, id );
+    }
 
     /*  */
     id->p_encoder->fmt_out.i_codec =
@@ -524,6 +561,258 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
     return VLC_SUCCESS;
 }
 
+/*
+ * Additional renditions: they share the decoder, and each distinct encoder
+ * input format is only scaled once for all the renditions that use it.
+ */
+static void transcode_rendition_filter_init( sout_stream_t *p_stream,
+                                             sout_stream_id_t *id,
+                                             transcode_rendition_t *p_rend )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const es_format_t *p_fmt_dec = &id->p_decoder->fmt_out;
+    const es_format_t *p_fmt_enc = &p_rend->p_encoder->fmt_in;
+
+    p_rend->p_f_chain = filter_chain_New( p_stream, "video filter2",
+                                          false,
+                                          transcode_video_filter_allocation_init,
+                                          transcode_video_filter_allocation_clear,
+                                          p_sys );
+    if( !p_rend->p_f_chain )
+        return;
+
+    if( p_sys->b_deinterlace )
+    {
+        filter_chain_AppendFilter( p_rend->p_f_chain,
+                                   p_sys->psz_deinterlace,
+                                   p_sys->p_deinterlace_cfg,
+                                   p_fmt_dec, p_fmt_dec );
+    }
+
+    if( ( p_fmt_dec->video.i_chroma != p_fmt_enc->video.i_chroma ) ||
+        ( !transcode_video_is_opaque( p_fmt_enc->video.i_chroma ) &&
+          ( ( p_fmt_dec->video.i_width != p_fmt_enc->video.i_width ) ||
+            ( p_fmt_dec->video.i_height != p_fmt_enc->video.i_height ) ) ) )
+    {
+        filter_chain_AppendFilter( p_rend->p_f_chain, NULL, NULL,
+                                   p_fmt_dec, p_fmt_enc );
+    }
+}
+
+static int transcode_rendition_open( sout_stream_t *p_stream,
+                                     sout_stream_id_t *id, int i_index,
+                                     transcode_rendition_t *p_rend )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const transcode_rendition_cfg_t *p_cfg = &p_sys->p_renditions[i_index];
+    const video_format_t *p_src = &id->p_decoder->fmt_out.video;
+    const es_format_t *p_main = &id->p_encoder->fmt_out;
+    unsigned i_width = p_cfg->i_width;
+    unsigned i_height = p_cfg->i_height;
+    encoder_t *p_enc;
+
+    /* Scale both dimensions by the same factor when only one is given */
+    if( i_width == 0 && i_height == 0 )
+    {
+        i_width = p_src->i_width;
+        i_height = p_src->i_height;
+    }
+    else if( i_width == 0 )
+        i_width = ((uint64_t)p_src->i_width * i_height / p_src->i_height
+                   + 1) & ~1;
+    else if( i_height == 0 )
+        i_height = ((uint64_t)p_src->i_height * i_width / p_src->i_width
+                    + 1) & ~1;
+
+    p_enc = sout_EncoderCreate( p_stream );
+    if( !p_enc )
+        return VLC_ENOMEM;
+    p_enc->p_module = NULL;
+
+    es_format_Init( &p_enc->fmt_out, VIDEO_ES, p_sys->i_vcodec );
+    p_enc->fmt_out.i_id = ((i_index + 1) << 16) | p_main->i_id;
+    p_enc->fmt_out.i_group = p_main->i_group;
+    if( p_main->psz_language )
+        p_enc->fmt_out.psz_language = strdup( p_main->psz_language );
+    p_enc->fmt_out.i_bitrate = p_cfg->i_bitrate ? p_cfg->i_bitrate
+                                                : p_sys->i_vbitrate;
+    p_enc->fmt_out.video.i_width =
+    p_enc->fmt_out.video.i_visible_width = i_width;
+    p_enc->fmt_out.video.i_height =
+    p_enc->fmt_out.video.i_visible_height = i_height;
+    p_enc->fmt_out.video.i_frame_rate = p_main->video.i_frame_rate;
+    p_enc->fmt_out.video.i_frame_rate_base = p_main->video.i_frame_rate_base;
+    vlc_ureduce( &p_enc->fmt_out.video.i_sar_num,
+                 &p_enc->fmt_out.video.i_sar_den,
+                 (uint64_t)p_src->i_sar_num * p_src->i_width  * i_height,
+                 (uint64_t)p_src->i_sar_den * p_src->i_height * i_width, 0 );
+
+    es_format_Init( &p_enc->fmt_in, VIDEO_ES, id->p_decoder->fmt_out.i_codec );
+    p_enc->fmt_in.video = p_enc->fmt_out.video;
+    p_enc->fmt_in.video.i_chroma = id->p_decoder->fmt_out.i_codec;
+
+    p_enc->i_threads = p_sys->i_threads;
+    p_enc->p_cfg = p_sys->p_video_cfg;
+
+    p_enc->p_module = module_need( p_enc, "encoder", p_sys->psz_venc, true );
+    if( !p_enc->p_module )
+    {
+        msg_Err( p_stream, "cannot find video encoder for the %ux%u rendition",
+                 i_width, i_height );
+        es_format_Clean( &p_enc->fmt_out );
+        vlc_object_release( p_enc );
+        return VLC_EGENERIC;
+    }
+
+    p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+    p_enc->fmt_out.i_codec =
+        vlc_fourcc_GetCodec( VIDEO_ES, p_enc->fmt_out.i_codec );
+    if( asprintf( &p_enc->fmt_out.psz_description, "%ux%u %dkb/s", i_width,
+                  i_height, p_enc->fmt_out.i_bitrate / 1000 ) == -1 )
+        p_enc->fmt_out.psz_description = NULL;
+
+    p_rend->id = sout_StreamIdAdd( p_stream->p_next, &p_enc->fmt_out );
+    if( !p_rend->id )
+    {
+        msg_Err( p_stream, "cannot add the %ux%u rendition", i_width,
+                 i_height );
+        module_unneed( p_enc, p_enc->p_module );
+        es_format_Clean( &p_enc->fmt_out );
+        vlc_object_release( p_enc );
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( p_stream, "rendition %d: destination %ux%u, es id %d",
+             i_index + 1, i_width, i_height, p_enc->fmt_out.i_id );
+    p_rend->p_encoder = p_enc;
+    p_rend->p_f_chain = NULL;
+    p_rend->p_pic = NULL;
+    p_rend->i_same_as = -1;
+    return VLC_SUCCESS;
+}
+
+static void transcode_video_renditions_open( sout_stream_t *p_stream,
+                                             sout_stream_id_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    id->p_renditions = calloc( p_sys->i_renditions,
+                               sizeof( *id->p_renditions ) );
+    if( !id->p_renditions )
+        return;
+
+    for( int i = 0; i < p_sys->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rend = &id->p_renditions[id->i_renditions];
+
+        if( transcode_rendition_open( p_stream, id, i, p_rend ) )
+            continue;
+
+        for( int j = 0; j < id->i_renditions; j++ )
+        {
+            const transcode_rendition_t *p_prev = &id->p_renditions[j];
+            if( p_prev->i_same_as < 0 &&
+                video_format_IsSimilar( &p_prev->p_encoder->fmt_in.video,
+                                        &p_rend->p_encoder->fmt_in.video ) )
+            {
+                p_rend->i_same_as = j;
+                break;
+            }
+        }
+        if( p_rend->i_same_as < 0 )
+            transcode_rendition_filter_init( p_stream, id, p_rend );
+        id->i_renditions++;
+    }
+}
+
+/* Rebuilds the filters after a change of the decoder output */
+static void transcode_video_renditions_filter_init( sout_stream_t *p_stream,
+                                                    sout_stream_id_t *id )
+{
+    for( int i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rend = &id->p_renditions[i];
+
+        if( p_rend->i_same_as >= 0 )
+            continue;
+        if( p_rend->p_f_chain )
+            filter_chain_Delete( p_rend->p_f_chain );
+        transcode_rendition_filter_init( p_stream, id, p_rend );
+    }
+}
+
+static void transcode_video_renditions_encode( sout_stream_t *p_stream,
+                                               sout_stream_id_t *id,
+                                               picture_t *p_pic )
+{
+    for( int i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rend = &id->p_renditions[i];
+        picture_t *p_out;
+        block_t *p_block;
+
+        if( p_rend->i_same_as >= 0 )
+        {
+            p_out = id->p_renditions[p_rend->i_same_as].p_pic;
+            if( p_out )
+                picture_Hold( p_out );
+        }
+        else
+        {
+            p_out = picture_Hold( p_pic );
+            if( p_rend->p_f_chain )
+                p_out = filter_chain_VideoFilter( p_rend->p_f_chain, p_out );
+        }
+        p_rend->p_pic = p_out;
+        if( !p_out )
+            continue;
+
+        p_block = p_rend->p_encoder->pf_encode_video( p_rend->p_encoder, p_out );
+        if( p_block )
+            sout_StreamIdSend( p_stream->p_next, p_rend->id, p_block );
+    }
+
+    for( int i = 0; i < id->i_renditions; i++ )
+    {
+        if( id->p_renditions[i].p_pic )
+            picture_Release( id->p_renditions[i].p_pic );
+        id->p_renditions[i].p_pic = NULL;
+    }
+}
+
+static void transcode_video_renditions_flush( sout_stream_t *p_stream,
+                                              sout_stream_id_t *id )
+{
+    for( int i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rend = &id->p_renditions[i];
+        block_t *p_block;
+
+        while( (p_block = p_rend->p_encoder->pf_encode_video( p_rend->p_encoder,
+                                                              NULL )) )
+            sout_StreamIdSend( p_stream->p_next, p_rend->id, p_block );
+    }
+}
+
+static void transcode_video_renditions_close( sout_stream_t *p_stream,
+                                              sout_stream_id_t *id )
+{
+    for( int i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rend = &id->p_renditions[i];
+
+        if( p_rend->p_f_chain )
+            filter_chain_Delete( p_rend->p_f_chain );
+        module_unneed( p_rend->p_encoder, p_rend->p_encoder->p_module );
+        sout_StreamIdDel( p_stream->p_next, p_rend->id );
+        es_format_Clean( &p_rend->p_encoder->fmt_out );
+        vlc_object_release( p_rend->p_encoder );
+    }
+    free( id->p_renditions );
+    id->p_renditions = NULL;
+    id->i_renditions = 0;
+}
+
 void transcode_video_close( sout_stream_t *p_stream,
                                    sout_stream_id_t *id )
 {
@@ -537,11 +826,14 @@ void transcode_video_close( sout_stream_t *p_stream,
         vlc_join( p_stream->p_sys->thread, NULL );
         vlc_mutex_destroy( &p_stream->p_sys->lock_out );
         vlc_cond_destroy( &p_stream->p_sys->cond );
+        vlc_cond_destroy( &p_stream->p_sys->cond_space );
 
         picture_fifo_Delete( p_stream->p_sys->pp_pics );
         p_stream->p_sys->pp_pics = NULL;
     }
 
+    transcode_video_renditions_close( p_stream, id );
+
     /* Close decoder */
     if( id->p_decoder->p_module )
         module_unneed( id->p_decoder, id->p_decoder->p_module );
@@ -571,21 +863,27 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
 
     if( unlikely( in == NULL ) )
     {
-        if( p_sys->i_threads == 0 )
-        {
-            block_t *p_block;
-            do {
-                p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
-                block_ChainAppend( out, p_block );
-            } while( p_block );
-        }
-        else
+        block_t *p_block;
+
+        if( p_sys->i_threads >= 1 )
         {
-            /*
-             * FIXME: we need EncoderThread() to flush buffers and signal us
-             * when it's done so we can send the last frames to the chain
-             */
+            /* Let EncoderThread() go through the queued pictures, it then
+             * leaves the encoder alone so that we can flush it here */
+            vlc_mutex_lock( &p_sys->lock_out );
+            while( p_sys->i_pics > 0 || p_sys->b_encoding )
+                vlc_cond_wait( &p_sys->cond_space, &p_sys->lock_out );
+            *out = p_sys->p_buffers;
+            p_sys->p_buffers = NULL;
+            vlc_mutex_unlock( &p_sys->lock_out );
         }
+
+        if( id->p_encoder->p_module == NULL )
+            return VLC_SUCCESS;
+        transcode_video_renditions_flush( p_stream, id );
+        do {
+            p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
+            block_ChainAppend( out, p_block );
+        } while( p_block );
         return VLC_SUCCESS;
     }
 
@@ -669,6 +967,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
 
             transcode_video_encoder_init( p_stream, id );
             transcode_video_filter_init( p_stream, id );
+            transcode_video_renditions_filter_init( p_stream, id );
             memcpy( &p_sys->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
         }
 
@@ -687,8 +986,15 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
                 id->b_transcode = false;
                 return VLC_EGENERIC;
             }
+            if( p_sys->i_renditions > 0 )
+                transcode_video_renditions_open( p_stream, id );
         }
 
+        /* The renditions are encoded from the decoded picture, before
+         * filters that may work in place. Unlike the main encoding, they
+         * are not duplicated by the audio synchronisation. */
+        transcode_video_renditions_encode( p_stream, id, p_pic );
+
         /* Run filter chain */
         if( id->p_f_chain )
             p_pic = filter_chain_VideoFilter( id->p_f_chain, p_pic );
@@ -705,8 +1011,9 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
          * Encoding
          */
 
-        /* Check if we have a subpicture to overlay */
-        if( p_sys->p_spu )
+        /* Check if we have a subpicture to overlay, the pictures in video
+         * memory are not blended */
+        if( p_sys->p_spu && p_pic->i_planes > 0 )
         {
             video_format_t fmt = id->p_encoder->fmt_in.video;
             if( fmt.i_visible_width <= 0 || fmt.i_visible_height <= 0 )
@@ -796,12 +1103,17 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
         else
         {
             vlc_mutex_lock( &p_sys->lock_out );
+            while( p_sys->i_pics >= ENCODER_MAX_PICTURES )
+                vlc_cond_wait( &p_sys->cond_space, &p_sys->lock_out );
             picture_fifo_Push( p_sys->pp_pics, p_pic );
-            *out = p_sys->p_buffers;
+            p_sys->i_pics++;
+            block_ChainAppend( out, p_sys->p_buffers );
             p_sys->p_buffers = NULL;
             if( p_pic2 != NULL )
             {
                 picture_fifo_Push( p_sys->pp_pics, p_pic2 );
+                p_sys->i_pics++;
+                p_pic2 = NULL;
             }
             vlc_cond_signal( &p_sys->cond );
             vlc_mutex_unlock( &p_sys->lock_out );
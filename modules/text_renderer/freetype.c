@@ -177,6 +177,10 @@ static const char *const ppsz_sizes_text[] = {
 #define YUVP_TEXT N_("Use YUVP renderer")
 #define YUVP_LONGTEXT N_("This renders the font using \"paletized YUV\". " \
   "This option is only needed if you want to encode into DVB subtitles" )
+#define CACHE_SIZE_TEXT N_("Glyph cache size (kB)")
+#define CACHE_SIZE_LONGTEXT N_("Maximum amount of memory used to keep " \
+  "rendered glyphs and laid out lines between two subtitles. " \
+  "0 disables the cache." )
 
 static const int pi_color_values[] = {
   0x00000000, 0x00808080, 0x00C0C0C0, 0x00FFFFFF, 0x00800000,
@@ -271,6 +275,8 @@ vlc_module_begin ()
 
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
+    add_integer_with_range( "freetype-cache-size", 2048, 0, 262144,
+                            CACHE_SIZE_TEXT, CACHE_SIZE_LONGTEXT, true )
     set_capability( "text renderer", 100 )
     add_shortcut( "text" )
     set_callbacks( Create, Destroy )
@@ -314,6 +320,51 @@ struct font_stack_t
     font_stack_t  *p_next;
 };
 
+/* Rendered glyph, cached at a fractional origin and keyed by everything
+ * that can change its bitmaps. Lookups hand out copies so that the lines
+ * own their glyphs exactly as when they are rendered from scratch. */
+typedef struct glyph_cache_entry_t glyph_cache_entry_t;
+struct glyph_cache_entry_t
+{
+    glyph_cache_entry_t *p_hash_next;
+    glyph_cache_entry_t *p_lru_prev;    /* towards the most recently used */
+    glyph_cache_entry_t *p_lru_next;
+
+    /* Key */
+    uint32_t       i_hash;
+    char          *psz_fontname;
+    int            i_style_flags;
+    int            i_font_size;
+    int            i_glyph_index;
+    FT_Vector      pen;                 /* sub pixel part of the pens */
+    FT_Vector      pen_shadow;
+
+    FT_Glyph       p_glyph;
+    FT_Glyph       p_outline;
+    FT_Glyph       p_shadow;
+    FT_Vector      advance;
+    size_t         i_size;              /* accounted memory */
+};
+
+#define GLYPH_CACHE_HASH_SIZE 256
+
+/* Laid out text, reused while the same text is displayed again */
+typedef struct
+{
+    uni_char_t    *psz_text;
+    text_style_t **pp_styles;
+    int            i_len;
+    unsigned       i_visible_width;
+    unsigned       i_visible_height;
+
+    line_desc_t   *p_lines;
+    FT_BBox        bbox;
+    int            i_max_face_height;
+    size_t         i_size;
+} layout_cache_entry_t;
+
+#define LAYOUT_CACHE_SIZE 4
+
 /*****************************************************************************
  * filter_sys_t: freetype local data
  *****************************************************************************
@@ -353,6 +404,18 @@ struct filter_sys_t
 
     input_attachment_t **pp_font_attachments;
     int                  i_font_attachments;
+#ifdef HAVE_FONTCONFIG
+    bool                 b_fontconfig_ready;
+#endif
+
+    /* Glyph and layout caches, sharing one memory budget */
+    glyph_cache_entry_t *pp_glyph_hash[GLYPH_CACHE_HASH_SIZE];
+    glyph_cache_entry_t *p_glyph_lru_first;
+    glyph_cache_entry_t *p_glyph_lru_last;
+    layout_cache_entry_t p_layout[LAYOUT_CACHE_SIZE];  /* most recent first */
+    int                  i_layout;
+    size_t               i_cache_size;
+    size_t               i_cache_max;
 };
 
 /* */
@@ -465,22 +528,18 @@ static int SetFontSize( filter_t *p_filter, int i_size )
 
 #ifdef HAVE_STYLES
 #ifdef HAVE_FONTCONFIG
-static void FontConfig_BuildCache( filter_t *p_filter )
+static void FontConfig_BuildCache( vlc_object_t *p_obj )
 {
     /* */
-    msg_Dbg( p_filter, "Building font databases.");
+    msg_Dbg( p_obj, "Building font databases.");
     mtime_t t1, t2;
     t1 = mdate();
 
-#ifdef __OS2__
-    FcInit();
-#endif
-
 #if defined( WIN32 ) || defined( __APPLE__ )
     dialog_progress_bar_t *p_dialog = NULL;
     FcConfig *fcConfig = FcInitLoadConfig();
 
-    p_dialog = dialog_ProgressCreate( p_filter,
+    p_dialog = dialog_ProgressCreate( p_obj,
             _("Building font cache"),
             _("Please wait while your font cache is rebuilt.\n"
                 "This should take less than a few minutes."), NULL );
@@ -504,9 +563,87 @@ static void FontConfig_BuildCache( filter_t *p_filter )
         dialog_ProgressDestroy( p_dialog );
         p_dialog = NULL;
     }
+#else
+    /* Load the configuration and scan the font directories now rather
+     * than on the first match */
+    FcInit();
 #endif
     t2 = mdate();
-    msg_Dbg( p_filter, "Took %ld microseconds", (long)((t2 - t1)) );
+    msg_Dbg( p_obj, "Took %ld microseconds", (long)((t2 - t1)) );
+}
+
+/* The font database is built once per process by a background thread,
+ * started by the first text renderer and shared by all of them. FontConfig
+ * must not be used until it is ready, the renderers use their default
+ * face in the meantime. */
+static vlc_mutex_t fc_lock = VLC_STATIC_MUTEX;  /* thread life cycle */
+static vlc_thread_t fc_thread;
+static unsigned fc_refs = 0;
+static bool fc_joinable = false;
+
+static vlc_mutex_t fc_ready_lock = VLC_STATIC_MUTEX;
+static vlc_cond_t fc_ready_wait = VLC_STATIC_COND;
+static bool fc_ready = false;
+
+static void FontConfig_SetReady( void )
+{
+    vlc_mutex_lock( &fc_ready_lock );
+    fc_ready = true;
+    vlc_cond_broadcast( &fc_ready_wait );
+    vlc_mutex_unlock( &fc_ready_lock );
+}
+
+static bool FontConfig_IsReady( void )
+{
+    vlc_mutex_lock( &fc_ready_lock );
+    bool b_ready = fc_ready;
+    vlc_mutex_unlock( &fc_ready_lock );
+    return b_ready;
+}
+
+static void FontConfig_WaitReady( void )
+{
+    vlc_mutex_lock( &fc_ready_lock );
+    while( !fc_ready )
+        vlc_cond_wait( &fc_ready_wait, &fc_ready_lock );
+    vlc_mutex_unlock( &fc_ready_lock );
+}
+
+static void *FontConfig_BuildThread( void *data )
+{
+    FontConfig_BuildCache( data );
+    FontConfig_SetReady();
+    return NULL;
+}
+
+static void FontConfig_Hold( filter_t *p_filter )
+{
+    vlc_mutex_lock( &fc_lock );
+    fc_refs++;
+    if( !fc_joinable && !FontConfig_IsReady() )
+    {
+        if( !vlc_clone( &fc_thread, FontConfig_BuildThread,
+                        VLC_OBJECT(p_filter->p_libvlc), VLC_THREAD_PRIORITY_LOW ) )
+            fc_joinable = true;
+        else
+        {
+            FontConfig_BuildCache( VLC_OBJECT(p_filter) );
+            FontConfig_SetReady();
+        }
+    }
+    vlc_mutex_unlock( &fc_lock );
+}
+
+static void FontConfig_Release( void )
+{
+    /* The thread never takes fc_lock, so it can be joined with it held */
+    vlc_mutex_lock( &fc_lock );
+    if( --fc_refs == 0 && fc_joinable )
+    {
+        vlc_join( fc_thread, NULL );
+        fc_joinable = false;
+    }
+    vlc_mutex_unlock( &fc_lock );
 }
 
 /***
@@ -1954,12 +2091,13 @@ static FT_Face LoadFace( filter_t *p_filter,
         int  i_idx = 0;
         char *psz_fontfile = NULL;
 #ifdef HAVE_FONTCONFIG
-        psz_fontfile = FontConfig_Select( NULL,
-                                          p_style->psz_fontname,
-                                          (p_style->i_style_flags & STYLE_BOLD) != 0,
-                                          (p_style->i_style_flags & STYLE_ITALIC) != 0,
-                                          -1,
-                                          &i_idx );
+        if( p_sys->b_fontconfig_ready )
+            psz_fontfile = FontConfig_Select( NULL,
+                                              p_style->psz_fontname,
+                                              (p_style->i_style_flags & STYLE_BOLD) != 0,
+                                              (p_style->i_style_flags & STYLE_ITALIC) != 0,
+                                              -1,
+                                              &i_idx );
 #elif defined( __APPLE__ )
         psz_fontfile = MacLegacy_Select( p_filter, p_style->psz_fontname, false, false, -1, &i_idx );
 #elif defined( WIN32 )
@@ -2019,16 +2157,143 @@ static bool FaceStyleEquals( const text_style_t *p_style1,
            !strcmp( p_style1->psz_fontname, p_style2->psz_fontname );
 }
 
-static int GetGlyph( filter_t *p_filter,
-                     FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
-                     FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
-                     FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
+static uint32_t GlyphCacheHash( const char *psz_fontname, int i_font_size,
+                                int i_style_flags, int i_glyph_index,
+                                const FT_Vector *p_pen,
+                                const FT_Vector *p_pen_shadow )
+{
+    /* FNV-1a */
+    uint32_t i_hash = 2166136261u;
+    for( const char *p = psz_fontname; *p; p++ )
+        i_hash = ( i_hash ^ (uint8_t)*p ) * 16777619u;
+
+    const long pi_key[] = {
+        i_font_size, i_style_flags, i_glyph_index,
+        p_pen->x, p_pen->y, p_pen_shadow->x, p_pen_shadow->y,
+    };
+    for( unsigned i = 0; i < sizeof(pi_key) / sizeof(*pi_key); i++ )
+        i_hash = ( i_hash ^ (uint32_t)pi_key[i] ) * 16777619u;
+    return i_hash;
+}
 
-                     FT_Face  p_face,
-                     int i_glyph_index,
-                     int i_style_flags,
-                     FT_Vector *p_pen,
-                     FT_Vector *p_pen_shadow )
+static size_t GlyphSize( FT_Glyph glyph )
+{
+    if( !glyph || glyph->format != FT_GLYPH_FORMAT_BITMAP )
+        return 0;
+    const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph)glyph)->bitmap;
+    return sizeof(FT_BitmapGlyphRec) + abs( p_bitmap->pitch ) * p_bitmap->rows;
+}
+
+static void GlyphCacheUnlink( filter_sys_t *p_sys, glyph_cache_entry_t *p_entry )
+{
+    if( p_entry->p_lru_prev )
+        p_entry->p_lru_prev->p_lru_next = p_entry->p_lru_next;
+    else
+        p_sys->p_glyph_lru_first = p_entry->p_lru_next;
+    if( p_entry->p_lru_next )
+        p_entry->p_lru_next->p_lru_prev = p_entry->p_lru_prev;
+    else
+        p_sys->p_glyph_lru_last = p_entry->p_lru_prev;
+}
+
+static void GlyphCachePushFront( filter_sys_t *p_sys, glyph_cache_entry_t *p_entry )
+{
+    p_entry->p_lru_prev = NULL;
+    p_entry->p_lru_next = p_sys->p_glyph_lru_first;
+    if( p_sys->p_glyph_lru_first )
+        p_sys->p_glyph_lru_first->p_lru_prev = p_entry;
+    else
+        p_sys->p_glyph_lru_last = p_entry;
+    p_sys->p_glyph_lru_first = p_entry;
+}
+
+static void GlyphCacheRemove( filter_sys_t *p_sys, glyph_cache_entry_t *p_entry )
+{
+    glyph_cache_entry_t **pp = &p_sys->pp_glyph_hash[p_entry->i_hash % GLYPH_CACHE_HASH_SIZE];
+    while( *pp != p_entry )
+        pp = &(*pp)->p_hash_next;
+    *pp = p_entry->p_hash_next;
+    GlyphCacheUnlink( p_sys, p_entry );
+
+    p_sys->i_cache_size -= p_entry->i_size;
+    FT_Done_Glyph( p_entry->p_glyph );
+    if( p_entry->p_outline )
+        FT_Done_Glyph( p_entry->p_outline );
+    if( p_entry->p_shadow )
+        FT_Done_Glyph( p_entry->p_shadow );
+    free( p_entry->psz_fontname );
+    free( p_entry );
+}
+
+/* Evict the least recently used glyphs until we fit in the budget */
+static void GlyphCacheTrim( filter_sys_t *p_sys )
+{
+    while( p_sys->i_cache_size > p_sys->i_cache_max && p_sys->p_glyph_lru_last )
+        GlyphCacheRemove( p_sys, p_sys->p_glyph_lru_last );
+}
+
+static void GlyphCacheClear( filter_sys_t *p_sys )
+{
+    while( p_sys->p_glyph_lru_last )
+        GlyphCacheRemove( p_sys, p_sys->p_glyph_lru_last );
+}
+
+static glyph_cache_entry_t *GlyphCacheFind( filter_sys_t *p_sys, uint32_t i_hash,
+                                            const char *psz_fontname, int i_font_size,
+                                            int i_style_flags, int i_glyph_index,
+                                            const FT_Vector *p_pen,
+                                            const FT_Vector *p_pen_shadow )
+{
+    for( glyph_cache_entry_t *p_entry = p_sys->pp_glyph_hash[i_hash % GLYPH_CACHE_HASH_SIZE];
+         p_entry != NULL; p_entry = p_entry->p_hash_next )
+    {
+        if( p_entry->i_hash == i_hash &&
+            p_entry->i_glyph_index == i_glyph_index &&
+            p_entry->i_font_size == i_font_size &&
+            p_entry->i_style_flags == i_style_flags &&
+            p_entry->pen.x == p_pen->x && p_entry->pen.y == p_pen->y &&
+            p_entry->pen_shadow.x == p_pen_shadow->x &&
+            p_entry->pen_shadow.y == p_pen_shadow->y &&
+            !strcmp( p_entry->psz_fontname, psz_fontname ) )
+        {
+            GlyphCacheUnlink( p_sys, p_entry );
+            GlyphCachePushFront( p_sys, p_entry );
+            return p_entry;
+        }
+    }
+    return NULL;
+}
+
+/* Copy a cached glyph to the whole pixel part of its origin */
+static int GlyphCopy( FT_Glyph source, FT_Glyph *p_target, const FT_Vector *p_origin )
+{
+    if( FT_Glyph_Copy( source, p_target ) )
+        return VLC_EGENERIC;
+
+    if( (*p_target)->format == FT_GLYPH_FORMAT_BITMAP )
+    {
+        FT_BitmapGlyph glyph_bmp = (FT_BitmapGlyph)*p_target;
+        glyph_bmp->left += p_origin->x >> 6;
+        glyph_bmp->top  += p_origin->y >> 6;
+    }
+    else
+    {
+        FT_Glyph_Transform( *p_target, NULL, (FT_Vector *)p_origin );
+    }
+    return VLC_SUCCESS;
+}
+
+static int RenderGlyph( filter_t *p_filter,
+                        FT_Glyph *pp_glyph,
+                        FT_Glyph *pp_outline,
+                        FT_Glyph *pp_shadow,
+                        FT_Vector *p_advance,
+
+                        FT_Face  p_face,
+                        int i_glyph_index,
+                        int i_style_flags,
+                        FT_Vector *p_pen,
+                        FT_Vector *p_pen_shadow )
 {
     if( FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT ) &&
         FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
@@ -2052,6 +2317,7 @@ static int GetGlyph( filter_t *p_filter,
         msg_Err( p_filter, "unable to render text FT_Get_Glyph failed" );
         return VLC_EGENERIC;
     }
+    *p_advance = p_face->glyph->advance;
 
     FT_Glyph outline = NULL;
     if( p_filter->p_sys->p_stroker )
@@ -2066,13 +2332,7 @@ static int GetGlyph( filter_t *p_filter,
     {
         shadow = outline ? outline : glyph;
         if( FT_Glyph_To_Bitmap( &shadow, FT_RENDER_MODE_NORMAL, p_pen_shadow, 0  ) )
-        {
             shadow = NULL;
-        }
-        else
-        {
-            FT_Glyph_Get_CBox( shadow, ft_glyph_bbox_pixels, p_shadow_bbox );
-        }
     }
     *pp_shadow = shadow;
 
@@ -2085,32 +2345,142 @@ static int GetGlyph( filter_t *p_filter,
             FT_Done_Glyph( shadow );
         return VLC_EGENERIC;
     }
-    FT_Glyph_Get_CBox( glyph, ft_glyph_bbox_pixels, p_glyph_bbox );
     *pp_glyph = glyph;
 
     if( outline )
-    {
         FT_Glyph_To_Bitmap( &outline, FT_RENDER_MODE_NORMAL, p_pen, 1 );
-        FT_Glyph_Get_CBox( outline, ft_glyph_bbox_pixels, p_outline_bbox );
-    }
     *pp_outline = outline;
 
     return VLC_SUCCESS;
 }
 
-static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox, FT_Face face, const FT_Vector *p_pen )
+static int GetGlyph( filter_t *p_filter,
+                     FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
+                     FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
+                     FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
+                     FT_Vector *p_advance,
+
+                     FT_Face  p_face,
+                     const char *psz_fontname,
+                     int i_font_size,
+                     int i_glyph_index,
+                     int i_style_flags,
+                     FT_Vector *p_pen,
+                     FT_Vector *p_pen_shadow )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->i_cache_max == 0 )
+    {
+        if( RenderGlyph( p_filter, pp_glyph, pp_outline, pp_shadow, p_advance,
+                         p_face, i_glyph_index, i_style_flags, p_pen, p_pen_shadow ) )
+            return VLC_EGENERIC;
+    }
+    else
+    {
+        /* The bitmaps only depend on the sub pixel part of the pens, the
+         * whole pixel part is applied to the copies we return */
+        FT_Vector origin = {
+            .x = p_pen->x & -64,
+            .y = p_pen->y & -64,
+        };
+        FT_Vector origin_shadow = {
+            .x = p_pen_shadow->x & -64,
+            .y = p_pen_shadow->y & -64,
+        };
+        FT_Vector pen = {
+            .x = p_pen->x - origin.x,
+            .y = p_pen->y - origin.y,
+        };
+        FT_Vector pen_shadow = { .x = 0, .y = 0 };
+        if( p_sys->i_shadow_opacity > 0 )
+        {
+            pen_shadow.x = p_pen_shadow->x - origin_shadow.x;
+            pen_shadow.y = p_pen_shadow->y - origin_shadow.y;
+        }
+        i_style_flags &= STYLE_BOLD | STYLE_ITALIC;
+
+        const uint32_t i_hash = GlyphCacheHash( psz_fontname, i_font_size,
+                                                i_style_flags, i_glyph_index,
+                                                &pen, &pen_shadow );
+        glyph_cache_entry_t *p_entry = GlyphCacheFind( p_sys, i_hash,
+                                                       psz_fontname, i_font_size,
+                                                       i_style_flags, i_glyph_index,
+                                                       &pen, &pen_shadow );
+        if( !p_entry )
+        {
+            p_entry = malloc( sizeof(*p_entry) );
+            if( !p_entry )
+                return VLC_ENOMEM;
+            p_entry->psz_fontname = strdup( psz_fontname );
+            if( !p_entry->psz_fontname ||
+                RenderGlyph( p_filter, &p_entry->p_glyph, &p_entry->p_outline,
+                             &p_entry->p_shadow, &p_entry->advance,
+                             p_face, i_glyph_index, i_style_flags,
+                             &pen, &pen_shadow ) )
+            {
+                free( p_entry->psz_fontname );
+                free( p_entry );
+                return VLC_EGENERIC;
+            }
+            p_entry->i_hash = i_hash;
+            p_entry->i_font_size = i_font_size;
+            p_entry->i_style_flags = i_style_flags;
+            p_entry->i_glyph_index = i_glyph_index;
+            p_entry->pen = pen;
+            p_entry->pen_shadow = pen_shadow;
+            p_entry->i_size = sizeof(*p_entry) + GlyphSize( p_entry->p_glyph ) +
+                              GlyphSize( p_entry->p_outline ) +
+                              GlyphSize( p_entry->p_shadow );
+
+            glyph_cache_entry_t **pp_bucket = &p_sys->pp_glyph_hash[i_hash % GLYPH_CACHE_HASH_SIZE];
+            p_entry->p_hash_next = *pp_bucket;
+            *pp_bucket = p_entry;
+            GlyphCachePushFront( p_sys, p_entry );
+            p_sys->i_cache_size += p_entry->i_size;
+        }
+
+        *pp_outline = NULL;
+        *pp_shadow = NULL;
+        if( GlyphCopy( p_entry->p_glyph, pp_glyph, &origin ) )
+            return VLC_EGENERIC;
+        if( ( p_entry->p_outline &&
+              GlyphCopy( p_entry->p_outline, pp_outline, &origin ) ) ||
+            ( p_entry->p_shadow &&
+              GlyphCopy( p_entry->p_shadow, pp_shadow, &origin_shadow ) ) )
+        {
+            FT_Done_Glyph( *pp_glyph );
+            if( *pp_outline )
+                FT_Done_Glyph( *pp_outline );
+            return VLC_EGENERIC;
+        }
+        *p_advance = p_entry->advance;
+
+        GlyphCacheTrim( p_sys );
+    }
+
+    FT_Glyph_Get_CBox( *pp_glyph, ft_glyph_bbox_pixels, p_glyph_bbox );
+    if( *pp_outline )
+        FT_Glyph_Get_CBox( *pp_outline, ft_glyph_bbox_pixels, p_outline_bbox );
+    if( *pp_shadow )
+        FT_Glyph_Get_CBox( *pp_shadow, ft_glyph_bbox_pixels, p_shadow_bbox );
+    return VLC_SUCCESS;
+}
+
+static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox, const FT_Vector *p_advance,
+                      const FT_Vector *p_pen )
 {
     FT_BitmapGlyph glyph_bmp = (FT_BitmapGlyph)glyph;
     if( p_bbox->xMin >= p_bbox->xMax )
     {
         p_bbox->xMin = FT_CEIL(p_pen->x);
-        p_bbox->xMax = FT_CEIL(p_pen->x + face->glyph->advance.x);
+        p_bbox->xMax = FT_CEIL(p_pen->x + p_advance->x);
         glyph_bmp->left = p_bbox->xMin;
     }
     if( p_bbox->yMin >= p_bbox->yMax )
     {
         p_bbox->yMax = FT_CEIL(p_pen->y);
-        p_bbox->yMin = FT_CEIL(p_pen->y + face->glyph->advance.y);
+        p_bbox->yMin = FT_CEIL(p_pen->y + p_advance->y);
         glyph_bmp->top  = p_bbox->yMax;
     }
 }
@@ -2353,20 +2723,25 @@ static int ProcessLines( filter_t *p_filter,
                 FT_BBox  outline_bbox;
                 FT_Glyph shadow;
                 FT_BBox  shadow_bbox;
+                FT_Vector advance;
 
                 if( GetGlyph( p_filter,
                               &glyph, &glyph_bbox,
                               &outline, &outline_bbox,
                               &shadow, &shadow_bbox,
-                              p_current_face, i_glyph_index, p_glyph_style->i_style_flags,
+                              &advance,
+                              p_current_face,
+                              p_current_style->psz_fontname,
+                              p_current_style->i_font_size,
+                              i_glyph_index, p_glyph_style->i_style_flags,
                               &pen_new, &pen_shadow_new ) )
                     goto next;
 
-                FixGlyph( glyph, &glyph_bbox, p_current_face, &pen_new );
+                FixGlyph( glyph, &glyph_bbox, &advance, &pen_new );
                 if( outline )
-                    FixGlyph( outline, &outline_bbox, p_current_face, &pen_new );
+                    FixGlyph( outline, &outline_bbox, &advance, &pen_new );
                 if( shadow )
-                    FixGlyph( shadow, &shadow_bbox, p_current_face, &pen_shadow_new );
+                    FixGlyph( shadow, &shadow_bbox, &advance, &pen_shadow_new );
 
                 /* FIXME and what about outline */
 
@@ -2465,8 +2840,8 @@ static int ProcessLines( filter_t *p_filter,
                     .i_line_thickness = i_line_thickness,
                 };
 
-                pen.x = pen_new.x + p_current_face->glyph->advance.x;
-                pen.y = pen_new.y + p_current_face->glyph->advance.y;
+                pen.x = pen_new.x + advance.x;
+                pen.y = pen_new.y + advance.y;
                 line_bbox = line_bbox_new;
             next:
                 i_glyph_last = i_glyph_index;
@@ -2542,6 +2917,164 @@ static int ProcessLines( filter_t *p_filter,
     return VLC_SUCCESS;
 }
 
+static bool StyleEquals( const text_style_t *p_style1,
+                         const text_style_t *p_style2 )
+{
+    if( p_style1 == p_style2 )
+        return true;
+
+    return !strcmp( p_style1->psz_fontname, p_style2->psz_fontname ) &&
+           p_style1->i_font_size == p_style2->i_font_size &&
+           p_style1->i_font_color == p_style2->i_font_color &&
+           p_style1->i_font_alpha == p_style2->i_font_alpha &&
+           p_style1->i_style_flags == p_style2->i_style_flags &&
+           p_style1->i_outline_color == p_style2->i_outline_color &&
+           p_style1->i_outline_alpha == p_style2->i_outline_alpha &&
+           p_style1->i_shadow_color == p_style2->i_shadow_color &&
+           p_style1->i_shadow_alpha == p_style2->i_shadow_alpha &&
+           p_style1->i_background_color == p_style2->i_background_color &&
+           p_style1->i_background_alpha == p_style2->i_background_alpha &&
+           p_style1->i_karaoke_background_color == p_style2->i_karaoke_background_color &&
+           p_style1->i_karaoke_background_alpha == p_style2->i_karaoke_background_alpha &&
+           p_style1->i_outline_width == p_style2->i_outline_width &&
+           p_style1->i_shadow_width == p_style2->i_shadow_width &&
+           p_style1->i_spacing == p_style2->i_spacing;
+}
+
+static void FreeStyles( text_style_t **pp_styles, int i_len )
+{
+    for( int i = 0; i < i_len; i++ )
+    {
+        if( pp_styles[i] && ( i + 1 == i_len || pp_styles[i] != pp_styles[i + 1] ) )
+            text_style_Delete( pp_styles[i] );
+    }
+    free( pp_styles );
+}
+
+static void LayoutCacheRelease( filter_sys_t *p_sys, layout_cache_entry_t *p_layout )
+{
+    p_sys->i_cache_size -= p_layout->i_size;
+    FreeLines( p_layout->p_lines );
+    FreeStyles( p_layout->pp_styles, p_layout->i_len );
+    free( p_layout->psz_text );
+}
+
+static void LayoutCacheClear( filter_sys_t *p_sys )
+{
+    for( int i = 0; i < p_sys->i_layout; i++ )
+        LayoutCacheRelease( p_sys, &p_sys->p_layout[i] );
+    p_sys->i_layout = 0;
+}
+
+/* Look for the lines of an identical text laid out for the same area,
+ * and move them to the front of the cache */
+static layout_cache_entry_t *LayoutCacheGet( filter_t *p_filter,
+                                             const uni_char_t *psz_text,
+                                             text_style_t *const *pp_styles,
+                                             int i_len )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( int i_entry = 0; i_entry < p_sys->i_layout; i_entry++ )
+    {
+        layout_cache_entry_t *p_layout = &p_sys->p_layout[i_entry];
+
+        if( p_layout->i_len != i_len ||
+            p_layout->i_visible_width != p_filter->fmt_out.video.i_visible_width ||
+            p_layout->i_visible_height != p_filter->fmt_out.video.i_visible_height ||
+            memcmp( p_layout->psz_text, psz_text, i_len * sizeof(*psz_text) ) )
+            continue;
+
+        int i;
+        for( i = 0; i < i_len; i++ )
+        {
+            /* Styles are shared by runs of characters */
+            if( i > 0 && pp_styles[i] == pp_styles[i - 1] &&
+                p_layout->pp_styles[i] == p_layout->pp_styles[i - 1] )
+                continue;
+            if( !StyleEquals( p_layout->pp_styles[i], pp_styles[i] ) )
+                break;
+        }
+        if( i < i_len )
+            continue;
+
+        layout_cache_entry_t layout = *p_layout;
+        memmove( &p_sys->p_layout[1], &p_sys->p_layout[0],
+                 i_entry * sizeof(*p_sys->p_layout) );
+        p_sys->p_layout[0] = layout;
+        return &p_sys->p_layout[0];
+    }
+    return NULL;
+}
+
+/* Keep laid out lines for later reuse. The cache takes ownership of the
+ * lines when it returns an entry. */
+static layout_cache_entry_t *LayoutCacheAdd( filter_t *p_filter,
+                                             const uni_char_t *psz_text,
+                                             text_style_t *const *pp_styles,
+                                             int i_len,
+                                             line_desc_t *p_lines,
+                                             const FT_BBox *p_bbox,
+                                             int i_max_face_height )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    size_t i_size = i_len * ( sizeof(*psz_text) + sizeof(*pp_styles) );
+    for( const line_desc_t *p_line = p_lines; p_line != NULL; p_line = p_line->p_next )
+    {
+        i_size += sizeof(*p_line) + p_line->i_character_count * sizeof(*p_line->p_character);
+        for( int i = 0; i < p_line->i_character_count; i++ )
+        {
+            const line_character_t *ch = &p_line->p_character[i];
+            i_size += GlyphSize( (FT_Glyph)ch->p_glyph ) +
+                      GlyphSize( (FT_Glyph)ch->p_outline ) +
+                      GlyphSize( (FT_Glyph)ch->p_shadow );
+        }
+    }
+    /* Leave most of the budget to the glyphs */
+    if( i_size > p_sys->i_cache_max / 4 )
+        return NULL;
+
+    layout_cache_entry_t layout = {
+        .psz_text = malloc( i_len * sizeof(*psz_text) ),
+        .pp_styles = calloc( i_len, sizeof(*pp_styles) ),
+        .i_len = i_len,
+        .i_visible_width = p_filter->fmt_out.video.i_visible_width,
+        .i_visible_height = p_filter->fmt_out.video.i_visible_height,
+        .p_lines = p_lines,
+        .bbox = *p_bbox,
+        .i_max_face_height = i_max_face_height,
+        .i_size = i_size,
+    };
+    if( !layout.psz_text || !layout.pp_styles )
+        goto error;
+    memcpy( layout.psz_text, psz_text, i_len * sizeof(*psz_text) );
+    for( int i = 0; i < i_len; i++ )
+    {
+        if( i > 0 && pp_styles[i] == pp_styles[i - 1] )
+            layout.pp_styles[i] = layout.pp_styles[i - 1];
+        else if( !( layout.pp_styles[i] = text_style_Duplicate( pp_styles[i] ) ) )
+            goto error;
+    }
+
+    if( p_sys->i_layout >= LAYOUT_CACHE_SIZE )
+        LayoutCacheRelease( p_sys, &p_sys->p_layout[--p_sys->i_layout] );
+    memmove( &p_sys->p_layout[1], &p_sys->p_layout[0],
+             p_sys->i_layout * sizeof(*p_sys->p_layout) );
+    p_sys->p_layout[0] = layout;
+    p_sys->i_layout++;
+    p_sys->i_cache_size += i_size;
+
+    GlyphCacheTrim( p_sys );
+    return &p_sys->p_layout[0];
+
+error:
+    free( layout.psz_text );
+    if( layout.pp_styles )
+        FreeStyles( layout.pp_styles, i_len );
+    return NULL;
+}
+
 /**
  * This function renders a text subpicture region into another one.
  * It also calculates the size needed for this string, and renders the
@@ -2573,6 +3106,16 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
         return VLC_EGENERIC;
     }
 
+#ifdef HAVE_FONTCONFIG
+    if( !p_sys->b_fontconfig_ready && FontConfig_IsReady() )
+    {
+        /* What was rendered with the default face is stale now */
+        LayoutCacheClear( p_sys );
+        GlyphCacheClear( p_sys );
+        p_sys->b_fontconfig_ready = true;
+    }
+#endif
+
     /* Reset the default fontsize in case screen metrics have changed */
     p_filter->p_sys->i_font_size = GetFontSize( p_filter );
 
@@ -2671,11 +3214,28 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
                                    p_region_in->psz_text, p_style, 0 );
     }
 
+    /* Karaoke changes the colors at every rendering, so it is never
+     * reused as a whole */
+    layout_cache_entry_t *p_layout = NULL;
     if( !rv && i_text_length > 0 )
     {
-        rv = ProcessLines( p_filter,
-                           &p_lines, &bbox, &i_max_face_height,
-                           psz_text, pp_styles, pi_k_durations, i_text_length );
+        if( !pi_k_durations )
+            p_layout = LayoutCacheGet( p_filter, psz_text, pp_styles, i_text_length );
+        if( p_layout )
+        {
+            p_lines = p_layout->p_lines;
+            bbox = p_layout->bbox;
+            i_max_face_height = p_layout->i_max_face_height;
+        }
+        else
+        {
+            rv = ProcessLines( p_filter,
+                               &p_lines, &bbox, &i_max_face_height,
+                               psz_text, pp_styles, pi_k_durations, i_text_length );
+            if( !rv && !pi_k_durations && p_sys->i_cache_max > 0 )
+                p_layout = LayoutCacheAdd( p_filter, psz_text, pp_styles, i_text_length,
+                                           p_lines, &bbox, i_max_face_height );
+        }
     }
 
     p_region_out->i_x = p_region_in->i_x;
@@ -2722,15 +3282,11 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
             var_SetBool( p_filter, "text-rerender", true );
     }
 
-    FreeLines( p_lines );
+    if( !p_layout )
+        FreeLines( p_lines );
 
     free( psz_text );
-    for( int i = 0; i < i_text_length; i++ )
-    {
-        if( pp_styles[i] && ( i + 1 == i_text_length || pp_styles[i] != pp_styles[i + 1] ) )
-            text_style_Delete( pp_styles[i] );
-    }
-    free( pp_styles );
+    FreeStyles( pp_styles, i_text_length );
     free( pi_k_durations );
 
     return rv;
@@ -2843,14 +3399,24 @@ static int Create( vlc_object_t *p_this )
     p_sys->psz_fontfamily = psz_fontfamily;
 #ifdef HAVE_STYLES
 #ifdef HAVE_FONTCONFIG
-    FontConfig_BuildCache( p_filter );
+    FontConfig_Hold( p_filter );
+    p_sys->b_fontconfig_ready = FontConfig_IsReady();
 
     /* */
-    psz_fontfile = FontConfig_Select( NULL, psz_fontfamily, false, false,
-                                      p_sys->i_default_font_size, &fontindex );
-    psz_monofontfile = FontConfig_Select( NULL, psz_monofontfamily, false,
-                                          false, p_sys->i_default_font_size,
-                                          &monofontindex );
+    if( p_sys->b_fontconfig_ready )
+    {
+        psz_fontfile = FontConfig_Select( NULL, psz_fontfamily, false, false,
+                                          p_sys->i_default_font_size, &fontindex );
+        psz_monofontfile = FontConfig_Select( NULL, psz_monofontfamily, false,
+                                              false, p_sys->i_default_font_size,
+                                              &monofontindex );
+    }
+    else
+    {
+        /* Do not wait for the font database */
+        msg_Dbg( p_filter, "Font database not ready, using %s", DEFAULT_FONT_FILE );
+        psz_fontfile = strdup( DEFAULT_FONT_FILE );
+    }
 #elif defined(__APPLE__)
     psz_fontfile = MacLegacy_Select( p_filter, psz_fontfamily, false, false, 0, &fontindex );
 #elif defined(WIN32)
@@ -2883,6 +3449,22 @@ static int Create( vlc_object_t *p_this )
 
     i_error = FT_New_Face( p_sys->p_library, psz_fontfile ? psz_fontfile : "",
                            fontindex, &p_sys->p_face );
+#ifdef HAVE_FONTCONFIG
+    if( i_error && !p_sys->b_fontconfig_ready )
+    {
+        /* No usable default file, we have to wait for the database */
+        FontConfig_WaitReady();
+        p_sys->b_fontconfig_ready = true;
+
+        free( psz_fontfile );
+        psz_fontfile = FontConfig_Select( NULL, psz_fontfamily, false, false,
+                                          p_sys->i_default_font_size, &fontindex );
+        if( !psz_fontfile )
+            psz_fontfile = strdup( psz_fontfamily );
+        i_error = FT_New_Face( p_sys->p_library, psz_fontfile ? psz_fontfile : "",
+                               fontindex, &p_sys->p_face );
+    }
+#endif
 
     if( i_error == FT_Err_Unknown_File_Format )
     {
@@ -2917,6 +3499,14 @@ static int Create( vlc_object_t *p_this )
     p_sys->pp_font_attachments = NULL;
     p_sys->i_font_attachments = 0;
 
+    for( int i = 0; i < GLYPH_CACHE_HASH_SIZE; i++ )
+        p_sys->pp_glyph_hash[i] = NULL;
+    p_sys->p_glyph_lru_first = NULL;
+    p_sys->p_glyph_lru_last = NULL;
+    p_sys->i_layout = 0;
+    p_sys->i_cache_size = 0;
+    p_sys->i_cache_max = 1024 * var_InheritInteger( p_filter, "freetype-cache-size" );
+
     p_filter->pf_render_text = RenderText;
     p_filter->pf_render_html = RenderHtml;
 
@@ -2933,6 +3523,9 @@ error:
     if( p_sys->p_face ) FT_Done_Face( p_sys->p_face );
     if( p_sys->p_library ) FT_Done_FreeType( p_sys->p_library );
 #ifdef HAVE_STYLES
+#ifdef HAVE_FONTCONFIG
+    FontConfig_Release();
+#endif
     free( psz_fontfile );
     free( psz_monofontfile );
 #endif
@@ -2960,6 +3553,9 @@ static void Destroy( vlc_object_t *p_this )
         free( p_sys->pp_font_attachments );
     }
 
+    LayoutCacheClear( p_sys );
+    GlyphCacheClear( p_sys );
+
     if( p_sys->p_xml ) xml_ReaderDelete( p_sys->p_xml );
     free( p_sys->psz_fontfamily );
 
@@ -2967,6 +3563,10 @@ static void Destroy( vlc_object_t *p_this )
     free( p_sys->psz_win_fonts_path );
 #endif
 
+#ifdef HAVE_FONTCONFIG
+    FontConfig_Release();
+#endif
+
     /* FcFini asserts calling the subfunction FcCacheFini()
      * even if no other library functions have been made since FcInit(),
      * so don't call it. */
@@ -95,6 +95,11 @@ vlc_module_begin ()
                         "RV15,RV16,RV24,RV32 conversions") )
     set_capability( "video filter2", 120 )
 # define vlc_CPU_capable() vlc_CPU_SSE2()
+#elif defined (MODULE_NAME_IS_i420_rgb_avx2)
+    set_description( N_( "AVX2 I420,IYUV,YV12 to "
+                        "RV15,RV16,RV32 conversions") )
+    set_capability( "video filter2", 140 )
+# define vlc_CPU_capable() vlc_CPU_AVX2()
 #endif
     set_callbacks( Activate, Deactivate )
 vlc_module_end ()
@@ -118,6 +123,11 @@ static int Activate( vlc_object_t *p_this )
     {
         return VLC_EGENERIC;
     }
+#if defined (MODULE_NAME_IS_i420_rgb_avx2)
+    /* Lines are converted by blocks of 32 pixels */
+    if( p_filter->fmt_in.video.i_width < 32 )
+        return VLC_EGENERIC;
+#endif
 
     switch( p_filter->fmt_in.video.i_chroma )
     {
@@ -287,6 +297,11 @@ static int Activate( vlc_object_t *p_this )
 
     SetYUV( p_filter );
 #endif
+#if defined (MODULE_NAME_IS_i420_rgb_avx2)
+    /* Large pictures are converted by stripes on several threads */
+    p_filter->b_slices = p_filter->fmt_in.video.i_width
+                       * p_filter->fmt_in.video.i_height >= 1280 * 720;
+#endif
 
     return 0;
 }
@@ -44,6 +44,9 @@
 #elif defined (MODULE_NAME_IS_i420_rgb_sse2)
 #   include "../sse2/i420_rgb_sse2.h"
 #   define VLC_TARGET VLC_SSE
+#elif defined (MODULE_NAME_IS_i420_rgb_avx2)
+#   include "../avx2/i420_rgb_avx2.h"
+#   define VLC_TARGET VLC_SSE
 #endif
 
 static void SetOffset( int, int, int, int, bool *,
@@ -298,7 +301,7 @@ void I420_RGB16( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     }
 }
 
-#else // ! defined (MODULE_NAME_IS_i420_rgb)
+#elif ! defined (MODULE_NAME_IS_i420_rgb_avx2)
 
 VLC_TARGET
 void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
@@ -866,7 +869,7 @@ void I420_RGB32( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     }
 }
 
-#else // defined (MODULE_NAME_IS_i420_rgb_mmx) || defined (MODULE_NAME_IS_i420_rgb_sse2)
+#elif ! defined (MODULE_NAME_IS_i420_rgb_avx2)
 
 VLC_TARGET
 void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
@@ -967,8 +970,8 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
                     SSE2_UNPACK_32_ARGB_UNALIGNED
                 );
                 p_y += 16;
-                p_u += 4;
-                p_v += 4;
+                p_u += 8;
+                p_v += 8;
             }
             SCALE_WIDTH;
             SCALE_HEIGHT( 420, 4 );
@@ -1195,8 +1198,8 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     SSE2_UNPACK_32_RGBA_UNALIGNED
                 );
                 p_y += 16;
-                p_u += 4;
-                p_v += 4;
+                p_u += 8;
+                p_v += 8;
             }
             SCALE_WIDTH;
             SCALE_HEIGHT( 420, 4 );
@@ -1423,8 +1426,8 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     SSE2_UNPACK_32_BGRA_UNALIGNED
                 );
                 p_y += 16;
-                p_u += 4;
-                p_v += 4;
+                p_u += 8;
+                p_v += 8;
             }
             SCALE_WIDTH;
             SCALE_HEIGHT( 420, 4 );
@@ -1648,8 +1651,8 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     SSE2_UNPACK_32_ABGR_UNALIGNED
                 );
                 p_y += 16;
-                p_u += 4;
-                p_v += 4;
+                p_u += 8;
+                p_v += 8;
             }
             SCALE_WIDTH;
             SCALE_HEIGHT( 420, 4 );
@@ -1777,6 +1780,197 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
 #endif
 
+#if defined (MODULE_NAME_IS_i420_rgb_avx2)
+/*****************************************************************************
+ * AVX2 conversions
+ *****************************************************************************
+ * Each line is converted 32 pixels at a time; the end of the line is done by
+ * converting again the last 32 pixels, so any width of at least 32 pixels
+ * is handled without the C code. Lines are independent when the picture is
+ * not scaled, so they are then converted by stripes on several threads.
+ *****************************************************************************/
+typedef void (*avx2_line_t)( uint8_t *, const uint8_t *, const uint8_t *,
+                             const uint8_t *, unsigned );
+
+#define AVX2_LINE( name, UNPACK, BPP )                                        \
+VLC_TARGET                                                                    \
+static void name( uint8_t *p_buffer, const uint8_t *p_y,                      \
+                  const uint8_t *p_u, const uint8_t *p_v, unsigned i_width )  \
+{                                                                             \
+    const unsigned i_rewind = (-i_width) & 31;                                \
+                                                                              \
+    for( unsigned i_x = i_width / 32; i_x--; )                                \
+    {                                                                         \
+        AVX2_CALL( AVX2_INIT AVX2_YUV_MUL AVX2_YUV_ADD UNPACK );              \
+        p_y += 32;                                                            \
+        p_u += 16;                                                            \
+        p_v += 16;                                                            \
+        p_buffer += 32 * BPP;                                                 \
+    }                                                                         \
+    if( i_rewind )                                                            \
+    {                                                                         \
+        p_y -= i_rewind;                                                      \
+        p_u -= i_rewind >> 1;                                                 \
+        p_v -= i_rewind >> 1;                                                 \
+        p_buffer -= i_rewind * BPP;                                           \
+        AVX2_CALL( AVX2_INIT AVX2_YUV_MUL AVX2_YUV_ADD UNPACK );              \
+    }                                                                         \
+    AVX2_END;                                                                 \
+}
+
+AVX2_LINE( R5G5B5_Line,   AVX2_UNPACK_15,      2 )
+AVX2_LINE( R5G6B5_Line,   AVX2_UNPACK_16,      2 )
+AVX2_LINE( A8R8G8B8_Line, AVX2_UNPACK_32_ARGB, 4 )
+AVX2_LINE( R8G8B8A8_Line, AVX2_UNPACK_32_RGBA, 4 )
+AVX2_LINE( B8G8R8A8_Line, AVX2_UNPACK_32_BGRA, 4 )
+AVX2_LINE( A8B8G8R8_Line, AVX2_UNPACK_32_ABGR, 4 )
+
+typedef struct
+{
+    picture_t   *p_src;
+    picture_t   *p_dest;
+    avx2_line_t pf_line;
+} avx2_job_t;
+
+/* Converts the lines 2 * i_start to 2 * i_end, without scaling */
+static void SliceAVX2( filter_t *p_filter, void *p_data, int i_start,
+                       int i_end )
+{
+    const avx2_job_t *p_job = p_data;
+    const picture_t *p_src = p_job->p_src;
+    const plane_t *p_out = &p_job->p_dest->p[0];
+
+    for( int i_y = 2 * i_start; i_y < 2 * i_end; i_y++ )
+        p_job->pf_line( &p_out->p_pixels[i_y * p_out->i_pitch],
+                    &p_src->Y_PIXELS[i_y * p_src->p[Y_PLANE].i_pitch],
+                    &p_src->U_PIXELS[i_y / 2 * p_src->p[U_PLANE].i_pitch],
+                    &p_src->V_PIXELS[i_y / 2 * p_src->p[V_PLANE].i_pitch],
+                    p_filter->fmt_in.video.i_width );
+}
+
+/* Copies the pixels of the converted line selected by the offset array */
+static void ScaleLineAVX2( uint8_t *p_pic, const uint8_t *p_buffer,
+                           const int *p_offset, unsigned i_width,
+                           unsigned i_bpp )
+{
+    if( i_bpp == 4 )
+    {
+        uint32_t *p_dst = (uint32_t *)p_pic;
+        const uint32_t *p_src = (const uint32_t *)p_buffer;
+
+        for( unsigned i_x = i_width; i_x--; )
+        {
+            *p_dst++ = *p_src;
+            p_src += *p_offset++;
+        }
+    }
+    else
+    {
+        uint16_t *p_dst = (uint16_t *)p_pic;
+        const uint16_t *p_src = (const uint16_t *)p_buffer;
+
+        for( unsigned i_x = i_width; i_x--; )
+        {
+            *p_dst++ = *p_src;
+            p_src += *p_offset++;
+        }
+    }
+}
+
+static void I420_RGB_AVX2( filter_t *p_filter, picture_t *p_src,
+                           picture_t *p_dest, unsigned i_bpp,
+                           avx2_line_t pf_line )
+{
+    const unsigned i_width = p_filter->fmt_in.video.i_width;
+    const unsigned i_height = p_filter->fmt_in.video.i_height;
+    const unsigned i_pic_width = p_filter->fmt_out.video.i_width;
+    const unsigned i_pic_height = p_filter->fmt_out.video.i_height;
+    int *p_offset = p_filter->p_sys->p_offset;
+    bool b_hscale;
+    unsigned int i_vscale;
+
+    SetOffset( i_width, i_height, i_pic_width, i_pic_height,
+               &b_hscale, &i_vscale, p_offset );
+
+    if( !b_hscale && i_vscale == 0 )
+    {
+        avx2_job_t job = { p_src, p_dest, pf_line };
+
+        filter_RunSlices( p_filter, SliceAVX2, &job, i_height / 2 );
+        return;
+    }
+
+    /* Scaling: same line selection as SCALE_WIDTH and SCALE_HEIGHT */
+    uint8_t *p_buffer = p_filter->p_sys->p_buffer;
+    uint8_t *p_pic = p_dest->p->p_pixels;
+    int i_scale_count = ( i_vscale == 1 ) ? i_pic_height : i_height;
+
+    for( unsigned i_y = 0; i_y < i_height; i_y++ )
+    {
+        uint8_t *p_pic_start = p_pic;
+
+        pf_line( b_hscale ? p_buffer : p_pic,
+                 &p_src->Y_PIXELS[i_y * p_src->p[Y_PLANE].i_pitch],
+                 &p_src->U_PIXELS[i_y / 2 * p_src->p[U_PLANE].i_pitch],
+                 &p_src->V_PIXELS[i_y / 2 * p_src->p[V_PLANE].i_pitch],
+                 i_width );
+        if( b_hscale )
+            ScaleLineAVX2( p_pic, p_buffer, p_offset, i_pic_width, i_bpp );
+        p_pic += p_dest->p->i_pitch;
+
+        switch( i_vscale )
+        {
+        case -1:                         /* vertical scaling factor is < 1 */
+            /* Height reduction: skip the next source lines */
+            while( (i_scale_count -= i_pic_height) > 0 )
+                i_y++;
+            i_scale_count += i_height;
+            break;
+        case 1:                          /* vertical scaling factor is > 1 */
+            /* Height increment: copy the previous picture line */
+            while( (i_scale_count -= i_height) > 0 )
+            {
+                memcpy( p_pic, p_pic_start, i_pic_width * i_bpp );
+                p_pic += p_dest->p->i_pitch;
+            }
+            i_scale_count += i_pic_height;
+            break;
+        }
+    }
+}
+
+void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+{
+    I420_RGB_AVX2( p_filter, p_src, p_dest, 2, R5G5B5_Line );
+}
+
+void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+{
+    I420_RGB_AVX2( p_filter, p_src, p_dest, 2, R5G6B5_Line );
+}
+
+void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+{
+    I420_RGB_AVX2( p_filter, p_src, p_dest, 4, A8R8G8B8_Line );
+}
+
+void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+{
+    I420_RGB_AVX2( p_filter, p_src, p_dest, 4, R8G8B8A8_Line );
+}
+
+void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+{
+    I420_RGB_AVX2( p_filter, p_src, p_dest, 4, B8G8R8A8_Line );
+}
+
+void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+{
+    I420_RGB_AVX2( p_filter, p_src, p_dest, 4, A8B8G8R8_Line );
+}
+
+#endif
+
 /* Following functions are local */
 
 /*****************************************************************************
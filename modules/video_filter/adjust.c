@@ -131,6 +131,17 @@ struct filter_sys_t
                                             int, int, int );
 };
 
+/* Parameters of a picture, shared by its slices */
+typedef struct
+{
+    picture_t *p_pic;
+    picture_t *p_outpic;
+    int       i_rows;
+    int       i_y_offset; /* Packed YUV only */
+    int       pi_luma[256];
+    int       i_sat, i_sin, i_cos, i_x, i_y;
+} adjust_job_t;
+
 /*****************************************************************************
  * Create: allocates adjust video filter
  *****************************************************************************/
@@ -188,6 +199,8 @@ static int Create( vlc_object_t *p_this )
             return VLC_EGENERIC;
     }
 
+    p_filter->b_slices = true;
+
     vlc_mutex_init( &p_sys->lock );
     var_AddCallback( p_filter, "contrast",   AdjustCallback, p_sys );
     var_AddCallback( p_filter, "brightness", AdjustCallback, p_sys );
@@ -221,35 +234,21 @@ static void Destroy( vlc_object_t *p_this )
 }
 
 /*****************************************************************************
- * Run the filter on a Planar YUV picture
+ * Compute the lookup tables and the chroma factors of a picture
  *****************************************************************************/
-static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
+static void PrepareJob( filter_t *p_filter, adjust_job_t *p_job )
 {
-    int pi_luma[256];
     int pi_gamma[256];
 
-    picture_t *p_outpic;
-    uint8_t *p_in, *p_in_end, *p_line_end;
-    uint8_t *p_out;
-
     bool b_thres;
     double  f_hue;
     double  f_gamma;
     int32_t i_cont, i_lum;
-    int i_sat, i_sin, i_cos, i_x, i_y;
+    int i_sat;
     int i;
 
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    if( !p_pic ) return NULL;
-
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-
     /* Get variables */
     vlc_mutex_lock( &p_sys->lock );
     i_cont = (int)( p_sys->f_contrast * 255 );
@@ -279,7 +278,7 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
         /* Fill the luma lookup table */
         for( i = 0 ; i < 256 ; i++ )
         {
-            pi_luma[ i ] = pi_gamma[clip_uint8_vlc( i_lum + i_cont * i / 256)];
+            p_job->pi_luma[ i ] = pi_gamma[clip_uint8_vlc( i_lum + i_cont * i / 256)];
         }
     }
     else
@@ -290,7 +289,7 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
          */
         for( i = 0 ; i < 256 ; i++ )
         {
-            pi_luma[ i ] = (i < i_lum) ? 0 : 255;
+            p_job->pi_luma[ i ] = (i < i_lum) ? 0 : 255;
         }
 
         /*
@@ -299,6 +298,32 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
         i_sat = 0;
     }
 
+    p_job->i_sat = i_sat;
+    p_job->i_sin = sin(f_hue) * 256;
+    p_job->i_cos = cos(f_hue) * 256;
+
+    p_job->i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
+    p_job->i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
+}
+
+/*****************************************************************************
+ * Run the filter on stripes of a Planar YUV picture
+ *****************************************************************************/
+static void PlanarSlice( filter_t *p_filter, void *p_data,
+                         int i_start, int i_end )
+{
+    const adjust_job_t *p_job = p_data;
+    const int *pi_luma = p_job->pi_luma;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    picture_t pic, outpic;
+    picture_t *p_pic = &pic, *p_outpic = &outpic;
+    uint8_t *p_in, *p_in_end, *p_line_end;
+    uint8_t *p_out;
+
+    picture_GetSlice( p_pic, p_job->p_pic, i_start, i_end, p_job->i_rows );
+    picture_GetSlice( p_outpic, p_job->p_outpic, i_start, i_end, p_job->i_rows );
+
     /*
      * Do the Y plane
      */
@@ -339,127 +364,72 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
      * Do the U and V planes
      */
 
-    i_sin = sin(f_hue) * 256;
-    i_cos = cos(f_hue) * 256;
-
-    i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
-    i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
-
-    if ( i_sat > 256 )
+    if ( p_job->i_sat > 256 )
     {
         /* Currently no errors are implemented in the function, if any are added
          * check them here */
-        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
+        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, p_job->i_sin,
+                                        p_job->i_cos, p_job->i_sat,
+                                        p_job->i_x, p_job->i_y );
     }
     else
     {
         /* Currently no errors are implemented in the function, if any are added
          * check them here */
-        p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
+        p_sys->pf_process_sat_hue( p_pic, p_outpic, p_job->i_sin,
+                                   p_job->i_cos, p_job->i_sat,
+                                   p_job->i_x, p_job->i_y );
     }
-
-    return CopyInfoAndRelease( p_outpic, p_pic );
 }
 
 /*****************************************************************************
- * Run the filter on a Packed YUV picture
+ * Run the filter on a Planar YUV picture
  *****************************************************************************/
-static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
+static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
 {
-    int pi_luma[256];
-    int pi_gamma[256];
-
-    picture_t *p_outpic;
-    uint8_t *p_in, *p_in_v, *p_in_end, *p_line_end;
-    uint8_t *p_out, *p_out_v;
-    int i_y_offset, i_u_offset, i_v_offset;
-
-    int i_visible_lines, i_pitch, i_visible_pitch;
-
-    bool b_thres;
-    double  f_hue;
-    double  f_gamma;
-    int32_t i_cont, i_lum;
-    int i_sat, i_sin, i_cos, i_x, i_y;
-    int i;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
+    adjust_job_t job;
 
     if( !p_pic ) return NULL;
 
-    i_visible_lines = p_pic->p->i_visible_lines;
-    i_pitch = p_pic->p->i_pitch;
-    i_visible_pitch = p_pic->p->i_visible_pitch;
-
-    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
-                             &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
-    {
-        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                  (char*)&(p_pic->format.i_chroma) );
-
-        picture_Release( p_pic );
-        return NULL;
-    }
-
-    p_outpic = filter_NewPicture( p_filter );
+    picture_t *p_outpic = filter_NewPicture( p_filter );
     if( !p_outpic )
     {
-        msg_Warn( p_filter, "can't get output picture" );
-
         picture_Release( p_pic );
         return NULL;
     }
 
-    /* Get variables */
-    vlc_mutex_lock( &p_sys->lock );
-    i_cont = (int)( p_sys->f_contrast * 255 );
-    i_lum = (int)( (p_sys->f_brightness - 1.0)*255 );
-    f_hue = (float)( p_sys->i_hue * M_PI / 180 );
-    i_sat = (int)( p_sys->f_saturation * 256 );
-    f_gamma = 1.0 / p_sys->f_gamma;
-    b_thres = p_sys->b_brightness_threshold;
-    vlc_mutex_unlock( &p_sys->lock );
+    PrepareJob( p_filter, &job );
+    job.p_pic = p_pic;
+    job.p_outpic = p_outpic;
+    /* The chroma planes have the fewest lines */
+    job.i_rows = p_pic->p[U_PLANE].i_visible_lines;
 
-    /*
-     * Threshold mode drops out everything about luma, contrast and gamma.
-     */
-    if( !b_thres )
-    {
+    filter_RunSlices( p_filter, PlanarSlice, &job, job.i_rows );
 
-        /* Contrast is a fast but kludged function, so I put this gap to be
-         * cleaner :) */
-        i_lum += 128 - i_cont / 2;
+    return CopyInfoAndRelease( p_outpic, p_pic );
+}
 
-        /* Fill the gamma lookup table */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-          pi_gamma[ i ] = clip_uint8_vlc( pow(i / 255.0, f_gamma) * 255.0);
-        }
+/*****************************************************************************
+ * Run the filter on stripes of a Packed YUV picture
+ *****************************************************************************/
+static void PackedSlice( filter_t *p_filter, void *p_data,
+                         int i_start, int i_end )
+{
+    const adjust_job_t *p_job = p_data;
+    const int *pi_luma = p_job->pi_luma;
+    filter_sys_t *p_sys = p_filter->p_sys;
 
-        /* Fill the luma lookup table */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-            pi_luma[ i ] = pi_gamma[clip_uint8_vlc( i_lum + i_cont * i / 256)];
-        }
-    }
-    else
-    {
-        /*
-         * We get luma as threshold value: the higher it is, the darker is
-         * the image. Should I reverse this?
-         */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-            pi_luma[ i ] = (i < i_lum) ? 0 : 255;
-        }
+    picture_t pic, outpic;
+    picture_t *p_pic = &pic, *p_outpic = &outpic;
+    uint8_t *p_in, *p_in_end, *p_line_end;
+    uint8_t *p_out;
+    const int i_y_offset = p_job->i_y_offset;
 
-        /*
-         * Desaturates image to avoid that strange yellow halo...
-         */
-        i_sat = 0;
-    }
+    picture_GetSlice( p_pic, p_job->p_pic, i_start, i_end, p_job->i_rows );
+    picture_GetSlice( p_outpic, p_job->p_outpic, i_start, i_end, p_job->i_rows );
+
+    const int i_pitch = p_pic->p->i_pitch;
+    const int i_visible_pitch = p_pic->p->i_visible_pitch;
 
     /*
      * Do the Y plane
@@ -500,48 +470,57 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
 
     /*
      * Do the U and V planes
+     *
+     * They cannot fail, as FilterPacked() checked the chroma.
      */
 
-    p_in = p_pic->p->p_pixels + i_u_offset;
-    p_in_v = p_pic->p->p_pixels + i_v_offset;
-    p_in_end = p_in + i_visible_lines * i_pitch - 8 * 4;
-
-    p_out = p_outpic->p->p_pixels + i_u_offset;
-    p_out_v = p_outpic->p->p_pixels + i_v_offset;
+    if ( p_job->i_sat > 256 )
+        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, p_job->i_sin,
+                                        p_job->i_cos, p_job->i_sat,
+                                        p_job->i_x, p_job->i_y );
+    else
+        p_sys->pf_process_sat_hue( p_pic, p_outpic, p_job->i_sin,
+                                   p_job->i_cos, p_job->i_sat,
+                                   p_job->i_x, p_job->i_y );
+}
 
-    i_sin = sin(f_hue) * 256;
-    i_cos = cos(f_hue) * 256;
+/*****************************************************************************
+ * Run the filter on a Packed YUV picture
+ *****************************************************************************/
+static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
+{
+    adjust_job_t job;
+    int i_y_offset, i_u_offset, i_v_offset;
 
-    i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
-    i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
+    if( !p_pic ) return NULL;
 
-    if ( i_sat > 256 )
+    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
+                             &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
     {
-        if ( p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                             i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
+        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
+                  (char*)&(p_pic->format.i_chroma) );
+
+        picture_Release( p_pic );
+        return NULL;
     }
-    else
+
+    picture_t *p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
     {
-        if ( p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
+        msg_Warn( p_filter, "can't get output picture" );
+
+        picture_Release( p_pic );
+        return NULL;
     }
 
+    PrepareJob( p_filter, &job );
+    job.p_pic = p_pic;
+    job.p_outpic = p_outpic;
+    job.i_rows = p_pic->p->i_visible_lines;
+    job.i_y_offset = i_y_offset;
+
+    filter_RunSlices( p_filter, PackedSlice, &job, job.i_rows );
+
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
 
@@ -32,6 +32,7 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
 /*****************************************************************************
@@ -83,6 +84,19 @@ public:
     {
         return true;
     }
+    /* Raw access for the SIMD blenders */
+    const picture_t *getPicture() const
+    {
+        return picture;
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
 
 protected:
     template <unsigned ry>
@@ -523,6 +537,554 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
+/*****************************************************************************
+ * SIMD blending
+ *****************************************************************************
+ * They compute exactly what the generic code does, 8 or 16 pixels at a time,
+ * for the most common overlays: YUVA/YUVP subtitles on 4:2:0 and packed
+ * 4:2:2 pictures, and RGBA on 32 bits RGB. Everything fits in 16 bits lanes
+ * as the largest intermediate value is 255 * 255. On ARM, the NEON routines
+ * of blend_arm.S cover the 4:2:0 cases.
+ *****************************************************************************/
+#if defined(CAN_COMPILE_SSE2) && (VLC_GCC_VERSION(4, 9) || defined(__clang__))
+# define HAVE_BLEND_SSE2
+# include <emmintrin.h>
+# define VLC_SSE2 __attribute__ ((__target__ ("sse2")))
+#endif
+#if defined(HAVE_BLEND_SSE2) && defined(CAN_COMPILE_AVX2)
+# define HAVE_BLEND_AVX2
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+#if defined(CAN_COMPILE_ARM)
+# define HAVE_BLEND_NEON
+#endif
+#if defined(HAVE_BLEND_SSE2) || defined(HAVE_BLEND_NEON)
+# define HAVE_BLEND_SIMD
+#endif
+
+#ifdef HAVE_BLEND_SIMD
+typedef void (*blend_line_planar_t)(uint8_t *dst_y, uint8_t *dst_u, uint8_t *dst_v,
+                                    unsigned x,
+                                    const uint8_t *src_y, const uint8_t *src_u,
+                                    const uint8_t *src_v, const uint8_t *src_a,
+                                    unsigned width, unsigned alpha);
+
+/* Scalar tail of the 4:2:0 line blenders.
+ * dst_y points to the first pixel of the line, dst_u and dst_v to the start
+ * of the chroma lines or NULL when the line has no chroma. */
+static void BlendLinePlanarC(uint8_t *dst_y, uint8_t *dst_u, uint8_t *dst_v,
+                             unsigned x,
+                             const uint8_t *src_y, const uint8_t *src_u,
+                             const uint8_t *src_v, const uint8_t *src_a,
+                             unsigned start_y, unsigned start_uv,
+                             unsigned width, unsigned alpha)
+{
+    for (unsigned dx = start_y; dx < width; dx++)
+        merge(&dst_y[dx], src_y[dx], div255(alpha * src_a[dx]));
+    if (!dst_u)
+        return;
+    for (unsigned dx = start_uv; dx < width; dx += 2) {
+        const unsigned a = div255(alpha * src_a[dx]);
+        merge(&dst_u[(x + dx) / 2], src_u[dx], a);
+        merge(&dst_v[(x + dx) / 2], src_v[dx], a);
+    }
+}
+
+#ifdef HAVE_BLEND_NEON
+extern "C" {
+/* count is a positive multiple of 8 */
+void blend_y_arm_neon(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned count, unsigned alpha);
+/* Blends count chroma samples from the even source pixels */
+void blend_uv_arm_neon(uint8_t *dst_u, uint8_t *dst_v,
+                       const uint8_t *src_u, const uint8_t *src_v,
+                       const uint8_t *src_a, unsigned count, unsigned alpha);
+}
+
+static void BlendLinePlanarNEON(uint8_t *dst_y, uint8_t *dst_u, uint8_t *dst_v,
+                                unsigned x,
+                                const uint8_t *src_y, const uint8_t *src_u,
+                                const uint8_t *src_v, const uint8_t *src_a,
+                                unsigned width, unsigned alpha)
+{
+    const unsigned start_y = width & ~7u;
+    if (start_y > 0)
+        blend_y_arm_neon(dst_y, src_y, src_a, start_y, alpha);
+
+    unsigned dx = x & 1;
+    if (dst_u && width > dx) {
+        const unsigned count = (width - dx) / 16 * 8;
+        if (count > 0)
+            blend_uv_arm_neon(&dst_u[(x + dx) / 2], &dst_v[(x + dx) / 2],
+                              &src_u[dx], &src_v[dx], &src_a[dx],
+                              count, alpha);
+        dx += 2 * count;
+    }
+    BlendLinePlanarC(dst_y, dst_u, dst_v, x, src_y, src_u, src_v, src_a,
+                     start_y, dx, width, alpha);
+}
+#endif
+
+#ifdef HAVE_BLEND_SSE2
+VLC_SSE2
+static inline __m128i div255_sse2(__m128i v)
+{
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)),
+                                        _mm_set1_epi16(1)), 8);
+}
+
+/* div255((255 - a) * dst + src * a) */
+VLC_SSE2
+static inline __m128i merge_sse2(__m128i dst, __m128i src, __m128i a)
+{
+    const __m128i dst_a = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    return div255_sse2(_mm_add_epi16(_mm_mullo_epi16(dst, dst_a),
+                                     _mm_mullo_epi16(src, a)));
+}
+
+/* 8 bytes to 8 words and back */
+VLC_SSE2
+static inline __m128i load8_sse2(const uint8_t *p)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p),
+                             _mm_setzero_si128());
+}
+
+VLC_SSE2
+static inline void store8_sse2(uint8_t *p, __m128i v)
+{
+    _mm_storel_epi64((__m128i *)p, _mm_packus_epi16(v, v));
+}
+
+/* Even bytes of 16 bytes as 8 words */
+VLC_SSE2
+static inline __m128i load8even_sse2(const uint8_t *p)
+{
+    return _mm_and_si128(_mm_loadu_si128((const __m128i *)p),
+                         _mm_set1_epi16(0xff));
+}
+
+VLC_SSE2
+static void BlendLinePlanarSSE2(uint8_t *dst_y, uint8_t *dst_u, uint8_t *dst_v,
+                                unsigned x,
+                                const uint8_t *src_y, const uint8_t *src_u,
+                                const uint8_t *src_v, const uint8_t *src_a,
+                                unsigned width, unsigned alpha)
+{
+    const __m128i valpha = _mm_set1_epi16(alpha);
+
+    unsigned dx = 0;
+    for (; dx + 8 <= width; dx += 8) {
+        const __m128i a = div255_sse2(_mm_mullo_epi16(load8_sse2(&src_a[dx]), valpha));
+        store8_sse2(&dst_y[dx], merge_sse2(load8_sse2(&dst_y[dx]),
+                                           load8_sse2(&src_y[dx]), a));
+    }
+    const unsigned start_y = dx;
+
+    /* The chroma is blended with the pixels at even positions */
+    dx = x & 1;
+    if (dst_u) {
+        for (; dx + 16 <= width; dx += 16) {
+            const __m128i a = div255_sse2(_mm_mullo_epi16(load8even_sse2(&src_a[dx]), valpha));
+            uint8_t *u = &dst_u[(x + dx) / 2];
+            uint8_t *v = &dst_v[(x + dx) / 2];
+            store8_sse2(u, merge_sse2(load8_sse2(u), load8even_sse2(&src_u[dx]), a));
+            store8_sse2(v, merge_sse2(load8_sse2(v), load8even_sse2(&src_v[dx]), a));
+        }
+    }
+    BlendLinePlanarC(dst_y, dst_u, dst_v, x, src_y, src_u, src_v, src_a,
+                     start_y, dx, width, alpha);
+}
+
+template <unsigned offset_y, unsigned offset_u, unsigned offset_v>
+VLC_SSE2
+void BlendLinePackedSSE2(uint8_t *dst, unsigned x,
+                         const uint8_t *src_y, const uint8_t *src_u,
+                         const uint8_t *src_v, const uint8_t *src_a,
+                         unsigned width, unsigned alpha)
+{
+    const __m128i zero   = _mm_setzero_si128();
+    const __m128i even   = _mm_set1_epi16(0xff);
+    const __m128i valpha = _mm_set1_epi16(alpha);
+
+    unsigned dx = 0;
+    /* A first pixel at an odd position only has its luma */
+    if (x & 1) {
+        merge(&dst[2 * x + offset_y], src_y[0], div255(alpha * src_a[0]));
+        dx = 1;
+    }
+    for (; dx + 8 <= width; dx += 8) {
+        /* The source laid out as the destination, 4 pairs of pixels */
+        const __m128i y  = _mm_loadl_epi64((const __m128i *)&src_y[dx]);
+        const __m128i ya = _mm_loadl_epi64((const __m128i *)&src_a[dx]);
+        const __m128i u  = _mm_packus_epi16(_mm_and_si128(_mm_loadl_epi64((const __m128i *)&src_u[dx]), even), zero);
+        const __m128i v  = _mm_packus_epi16(_mm_and_si128(_mm_loadl_epi64((const __m128i *)&src_v[dx]), even), zero);
+        const __m128i ca = _mm_packus_epi16(_mm_and_si128(ya, even), zero);
+        const __m128i c  = offset_u < offset_v ? _mm_unpacklo_epi8(u, v)
+                                               : _mm_unpacklo_epi8(v, u);
+        const __m128i s  = offset_y == 0 ? _mm_unpacklo_epi8(y, c)
+                                         : _mm_unpacklo_epi8(c, y);
+        const __m128i sa = offset_y == 0 ? _mm_unpacklo_epi8(ya, _mm_unpacklo_epi8(ca, ca))
+                                         : _mm_unpacklo_epi8(_mm_unpacklo_epi8(ca, ca), ya);
+
+        uint8_t *p = &dst[2 * (x + dx)];
+        const __m128i d = _mm_loadu_si128((const __m128i *)p);
+        const __m128i a_lo = div255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(sa, zero), valpha));
+        const __m128i a_hi = div255_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(sa, zero), valpha));
+        const __m128i lo = merge_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), a_lo);
+        const __m128i hi = merge_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), a_hi);
+        _mm_storeu_si128((__m128i *)p, _mm_packus_epi16(lo, hi));
+    }
+    for (; dx < width; dx++) {
+        const unsigned a = div255(alpha * src_a[dx]);
+        uint8_t *p = &dst[2 * (x + dx)];
+        merge(&p[offset_y], src_y[dx], a);
+        if (((x + dx) % 2) == 0) {
+            merge(&p[offset_u], src_u[dx], a);
+            merge(&p[offset_v], src_v[dx], a);
+        }
+    }
+}
+
+/* Scalar tail of the RGBA to 32 bits RGB line blenders */
+static void BlendLineRGB32C(uint8_t *dst, const uint8_t *src,
+                            unsigned start, unsigned width, unsigned alpha,
+                            const unsigned offset[3])
+{
+    for (unsigned dx = start; dx < width; dx++) {
+        const uint8_t *s = &src[4 * dx];
+        uint8_t       *d = &dst[4 * dx];
+        const unsigned a = div255(alpha * s[3]);
+        merge(&d[offset[0]], s[0], a);
+        merge(&d[offset[1]], s[1], a);
+        merge(&d[offset[2]], s[2], a);
+    }
+}
+
+VLC_SSE2
+static void BlendLineRGB32SSE2(uint8_t *dst, const uint8_t *src,
+                               unsigned width, unsigned alpha,
+                               const unsigned offset[3])
+{
+    const __m128i zero   = _mm_setzero_si128();
+    const __m128i valpha = _mm_set1_epi16(alpha);
+
+    /* Moves of the R, G and B bytes to their destination offsets, and the
+     * alpha applied only to them */
+    __m128i mask[3], shift_left[3], shift_right[3];
+    int16_t lanes[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    for (unsigned c = 0; c < 3; c++) {
+        mask[c]        = _mm_set1_epi32(0xff << (8 * c));
+        shift_left[c]  = _mm_cvtsi32_si128(offset[c] > c ? 8 * (offset[c] - c) : 0);
+        shift_right[c] = _mm_cvtsi32_si128(offset[c] < c ? 8 * (c - offset[c]) : 0);
+        lanes[offset[c]] = lanes[offset[c] + 4] = -1;
+    }
+    const __m128i alpha_mask = _mm_loadu_si128((const __m128i *)lanes);
+
+    unsigned dx = 0;
+    for (; dx + 4 <= width; dx += 4) {
+        const __m128i sp = _mm_loadu_si128((const __m128i *)&src[4 * dx]);
+        const __m128i dp = _mm_loadu_si128((const __m128i *)&dst[4 * dx]);
+
+        __m128i s = zero;
+        for (unsigned c = 0; c < 3; c++)
+            s = _mm_or_si128(s, _mm_srl_epi32(_mm_sll_epi32(_mm_and_si128(sp, mask[c]),
+                                                            shift_left[c]),
+                                              shift_right[c]));
+
+        __m128i a = div255_sse2(_mm_mullo_epi16(_mm_srli_epi32(sp, 24), valpha));
+        __m128i a_lo = _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 1, 0, 0));
+        __m128i a_hi = _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 3, 2, 2));
+        a_lo = _mm_and_si128(_mm_or_si128(a_lo, _mm_slli_epi32(a_lo, 16)), alpha_mask);
+        a_hi = _mm_and_si128(_mm_or_si128(a_hi, _mm_slli_epi32(a_hi, 16)), alpha_mask);
+
+        const __m128i lo = merge_sse2(_mm_unpacklo_epi8(dp, zero), _mm_unpacklo_epi8(s, zero), a_lo);
+        const __m128i hi = merge_sse2(_mm_unpackhi_epi8(dp, zero), _mm_unpackhi_epi8(s, zero), a_hi);
+        _mm_storeu_si128((__m128i *)&dst[4 * dx], _mm_packus_epi16(lo, hi));
+    }
+    BlendLineRGB32C(dst, src, dx, width, alpha, offset);
+}
+
+#ifdef HAVE_BLEND_AVX2
+VLC_AVX2
+static inline __m256i div255_avx2(__m256i v)
+{
+    return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)),
+                                              _mm256_set1_epi16(1)), 8);
+}
+
+VLC_AVX2
+static inline __m256i merge_avx2(__m256i dst, __m256i src, __m256i a)
+{
+    const __m256i dst_a = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    return div255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(dst, dst_a),
+                                        _mm256_mullo_epi16(src, a)));
+}
+
+VLC_AVX2
+static inline __m256i load16_avx2(const uint8_t *p)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p));
+}
+
+VLC_AVX2
+static inline void store16_avx2(uint8_t *p, __m256i v)
+{
+    /* packus works on each 128 bits lane */
+    v = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+    _mm_storeu_si128((__m128i *)p, _mm256_castsi256_si128(v));
+}
+
+VLC_AVX2
+static inline __m256i load16even_avx2(const uint8_t *p)
+{
+    return _mm256_and_si256(_mm256_loadu_si256((const __m256i *)p),
+                            _mm256_set1_epi16(0xff));
+}
+
+VLC_AVX2
+static void BlendLinePlanarAVX2(uint8_t *dst_y, uint8_t *dst_u, uint8_t *dst_v,
+                                unsigned x,
+                                const uint8_t *src_y, const uint8_t *src_u,
+                                const uint8_t *src_v, const uint8_t *src_a,
+                                unsigned width, unsigned alpha)
+{
+    const __m256i valpha = _mm256_set1_epi16(alpha);
+
+    unsigned dx = 0;
+    for (; dx + 16 <= width; dx += 16) {
+        const __m256i a = div255_avx2(_mm256_mullo_epi16(load16_avx2(&src_a[dx]), valpha));
+        store16_avx2(&dst_y[dx], merge_avx2(load16_avx2(&dst_y[dx]),
+                                            load16_avx2(&src_y[dx]), a));
+    }
+    const unsigned start_y = dx;
+
+    dx = x & 1;
+    if (dst_u) {
+        for (; dx + 32 <= width; dx += 32) {
+            const __m256i a = div255_avx2(_mm256_mullo_epi16(load16even_avx2(&src_a[dx]), valpha));
+            uint8_t *u = &dst_u[(x + dx) / 2];
+            uint8_t *v = &dst_v[(x + dx) / 2];
+            store16_avx2(u, merge_avx2(load16_avx2(u), load16even_avx2(&src_u[dx]), a));
+            store16_avx2(v, merge_avx2(load16_avx2(v), load16even_avx2(&src_v[dx]), a));
+        }
+    }
+    BlendLinePlanarC(dst_y, dst_u, dst_v, x, src_y, src_u, src_v, src_a,
+                     start_y, dx, width, alpha);
+}
+
+VLC_AVX2
+static void BlendLineRGB32AVX2(uint8_t *dst, const uint8_t *src,
+                               unsigned width, unsigned alpha,
+                               const unsigned offset[3])
+{
+    const __m256i zero   = _mm256_setzero_si256();
+    const __m256i valpha = _mm256_set1_epi16(alpha);
+
+    __m256i mask[3];
+    __m128i shift_left[3], shift_right[3];
+    int16_t lanes[16];
+    for (unsigned i = 0; i < 16; i++)
+        lanes[i] = 0;
+    for (unsigned c = 0; c < 3; c++) {
+        mask[c]        = _mm256_set1_epi32(0xff << (8 * c));
+        shift_left[c]  = _mm_cvtsi32_si128(offset[c] > c ? 8 * (offset[c] - c) : 0);
+        shift_right[c] = _mm_cvtsi32_si128(offset[c] < c ? 8 * (c - offset[c]) : 0);
+        for (unsigned i = 0; i < 16; i += 4)
+            lanes[i + offset[c]] = -1;
+    }
+    const __m256i alpha_mask = _mm256_loadu_si256((const __m256i *)lanes);
+
+    unsigned dx = 0;
+    for (; dx + 8 <= width; dx += 8) {
+        const __m256i sp = _mm256_loadu_si256((const __m256i *)&src[4 * dx]);
+        const __m256i dp = _mm256_loadu_si256((const __m256i *)&dst[4 * dx]);
+
+        __m256i s = zero;
+        for (unsigned c = 0; c < 3; c++)
+            s = _mm256_or_si256(s, _mm256_srl_epi32(_mm256_sll_epi32(_mm256_and_si256(sp, mask[c]),
+                                                                     shift_left[c]),
+                                                    shift_right[c]));
+
+        /* The unpacks and shuffles stay within each 128 bits lane */
+        __m256i a = div255_avx2(_mm256_mullo_epi16(_mm256_srli_epi32(sp, 24), valpha));
+        __m256i a_lo = _mm256_shuffle_epi32(a, _MM_SHUFFLE(1, 1, 0, 0));
+        __m256i a_hi = _mm256_shuffle_epi32(a, _MM_SHUFFLE(3, 3, 2, 2));
+        a_lo = _mm256_and_si256(_mm256_or_si256(a_lo, _mm256_slli_epi32(a_lo, 16)), alpha_mask);
+        a_hi = _mm256_and_si256(_mm256_or_si256(a_hi, _mm256_slli_epi32(a_hi, 16)), alpha_mask);
+
+        const __m256i lo = merge_avx2(_mm256_unpacklo_epi8(dp, zero), _mm256_unpacklo_epi8(s, zero), a_lo);
+        const __m256i hi = merge_avx2(_mm256_unpackhi_epi8(dp, zero), _mm256_unpackhi_epi8(s, zero), a_hi);
+        _mm256_storeu_si256((__m256i *)&dst[4 * dx], _mm256_packus_epi16(lo, hi));
+    }
+    BlendLineRGB32C(dst, src, dx, width, alpha, offset);
+}
+#endif
+#endif
+
+static inline uint8_t *GetPixels(const CPicture &data, unsigned plane,
+                                 unsigned line, unsigned rx, unsigned ry)
+{
+    const plane_t *p = &data.getPicture()->p[plane];
+    return &p->p_pixels[line / ry * p->i_pitch + data.getX() / rx];
+}
+
+template <bool swap_uv, blend_line_planar_t blend_line>
+void BlendYUVAToI420(const CPicture &dst_data, const CPicture &src_data,
+                     unsigned width, unsigned height, int alpha)
+{
+    const unsigned x = dst_data.getX();
+
+    for (unsigned y = 0; y < height; y++) {
+        const unsigned dst_line = dst_data.getY() + y;
+        const unsigned src_line = src_data.getY() + y;
+        uint8_t *dst_u = NULL;
+        uint8_t *dst_v = NULL;
+        if ((dst_line % 2) == 0) {
+            const plane_t *u = &dst_data.getPicture()->p[swap_uv ? 2 : 1];
+            const plane_t *v = &dst_data.getPicture()->p[swap_uv ? 1 : 2];
+            dst_u = &u->p_pixels[dst_line / 2 * u->i_pitch];
+            dst_v = &v->p_pixels[dst_line / 2 * v->i_pitch];
+        }
+        blend_line(GetPixels(dst_data, 0, dst_line, 1, 1), dst_u, dst_v, x,
+                   GetPixels(src_data, 0, src_line, 1, 1),
+                   GetPixels(src_data, 1, src_line, 1, 1),
+                   GetPixels(src_data, 2, src_line, 1, 1),
+                   GetPixels(src_data, 3, src_line, 1, 1),
+                   width, alpha);
+    }
+}
+
+/* The palette is expanded to YUVA by chunks of lines */
+template <bool swap_uv, blend_line_planar_t blend_line>
+void BlendYUVPToI420(const CPicture &dst_data, const CPicture &src_data,
+                     unsigned width, unsigned height, int alpha)
+{
+    const video_palette_t *palette = src_data.getFormat()->p_palette;
+    const unsigned x = dst_data.getX();
+    uint8_t yuva[4][256];
+
+    for (unsigned y = 0; y < height; y++) {
+        const unsigned dst_line = dst_data.getY() + y;
+        const uint8_t *index = GetPixels(src_data, 0, src_data.getY() + y, 1, 1);
+        uint8_t *dst_y = GetPixels(dst_data, 0, dst_line, 1, 1);
+        uint8_t *dst_u = NULL;
+        uint8_t *dst_v = NULL;
+        if ((dst_line % 2) == 0) {
+            const plane_t *u = &dst_data.getPicture()->p[swap_uv ? 2 : 1];
+            const plane_t *v = &dst_data.getPicture()->p[swap_uv ? 1 : 2];
+            dst_u = &u->p_pixels[dst_line / 2 * u->i_pitch];
+            dst_v = &v->p_pixels[dst_line / 2 * v->i_pitch];
+        }
+        for (unsigned dx = 0; dx < width; dx += 256) {
+            const unsigned count = __MIN(width - dx, 256);
+            for (unsigned i = 0; i < count; i++) {
+                const uint8_t *entry = palette->palette[index[dx + i]];
+                yuva[0][i] = entry[0];
+                yuva[1][i] = entry[1];
+                yuva[2][i] = entry[2];
+                yuva[3][i] = entry[3];
+            }
+            blend_line(&dst_y[dx], dst_u, dst_v, x + dx,
+                       yuva[0], yuva[1], yuva[2], yuva[3], count, alpha);
+        }
+    }
+}
+
+#ifdef HAVE_BLEND_SSE2
+template <unsigned offset_y, unsigned offset_u, unsigned offset_v>
+void BlendYUVAToPackedSSE2(const CPicture &dst_data, const CPicture &src_data,
+                           unsigned width, unsigned height, int alpha)
+{
+    for (unsigned y = 0; y < height; y++) {
+        const unsigned dst_line = dst_data.getY() + y;
+        const unsigned src_line = src_data.getY() + y;
+        const plane_t *p = &dst_data.getPicture()->p[0];
+        BlendLinePackedSSE2<offset_y, offset_u, offset_v>(
+                   &p->p_pixels[dst_line * p->i_pitch], dst_data.getX(),
+                   GetPixels(src_data, 0, src_line, 1, 1),
+                   GetPixels(src_data, 1, src_line, 1, 1),
+                   GetPixels(src_data, 2, src_line, 1, 1),
+                   GetPixels(src_data, 3, src_line, 1, 1),
+                   width, alpha);
+    }
+}
+
+typedef void (*blend_line_rgb32_t)(uint8_t *dst, const uint8_t *src,
+                                   unsigned width, unsigned alpha,
+                                   const unsigned offset[3]);
+
+template <blend_line_rgb32_t blend_line>
+void BlendRGBAToRGB32(const CPicture &dst_data, const CPicture &src_data,
+                      unsigned width, unsigned height, int alpha)
+{
+    /* Same offsets as CPictureRGBX */
+    const video_format_t *fmt = dst_data.getFormat();
+#ifdef WORDS_BIGENDIAN
+    const unsigned offset[3] = {
+        (32u - fmt->i_lrshift) / 8,
+        (32u - fmt->i_lgshift) / 8,
+        (32u - fmt->i_lbshift) / 8,
+    };
+#else
+    const unsigned offset[3] = {
+        fmt->i_lrshift / 8u,
+        fmt->i_lgshift / 8u,
+        fmt->i_lbshift / 8u,
+    };
+#endif
+    if (offset[0] > 3 || offset[1] > 3 || offset[2] > 3 ||
+        offset[0] == offset[1] || offset[0] == offset[2] || offset[1] == offset[2]) {
+        Blend<CPictureRGB32, CPictureRGBA, compose<convertNone, convertNone> >(
+                dst_data, src_data, width, height, alpha);
+        return;
+    }
+
+    for (unsigned y = 0; y < height; y++) {
+        const plane_t *d = &dst_data.getPicture()->p[0];
+        const plane_t *s = &src_data.getPicture()->p[0];
+        blend_line(&d->p_pixels[(dst_data.getY() + y) * d->i_pitch + 4 * dst_data.getX()],
+                   &s->p_pixels[(src_data.getY() + y) * s->i_pitch + 4 * src_data.getX()],
+                   width, alpha, offset);
+    }
+}
+#endif
+
+static const struct {
+    vlc_fourcc_t     dst;
+    vlc_fourcc_t     src;
+    unsigned         cpu;
+    blend_function_t blend;
+} simd_blends[] = {
+#define PLANAR(cpu, line) \
+    { VLC_CODEC_I420, VLC_CODEC_YUVA, cpu, BlendYUVAToI420<false, line> }, \
+    { VLC_CODEC_J420, VLC_CODEC_YUVA, cpu, BlendYUVAToI420<false, line> }, \
+    { VLC_CODEC_YV12, VLC_CODEC_YUVA, cpu, BlendYUVAToI420<true,  line> }, \
+    { VLC_CODEC_I420, VLC_CODEC_YUVP, cpu, BlendYUVPToI420<false, line> }, \
+    { VLC_CODEC_J420, VLC_CODEC_YUVP, cpu, BlendYUVPToI420<false, line> }, \
+    { VLC_CODEC_YV12, VLC_CODEC_YUVP, cpu, BlendYUVPToI420<true,  line> }
+
+#ifdef HAVE_BLEND_NEON
+    PLANAR(VLC_CPU_ARM_NEON, BlendLinePlanarNEON),
+#endif
+#ifdef HAVE_BLEND_AVX2
+    PLANAR(VLC_CPU_AVX2, BlendLinePlanarAVX2),
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, VLC_CPU_AVX2, BlendRGBAToRGB32<BlendLineRGB32AVX2> },
+#endif
+#ifdef HAVE_BLEND_SSE2
+    PLANAR(VLC_CPU_SSE2, BlendLinePlanarSSE2),
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, VLC_CPU_SSE2, BlendRGBAToRGB32<BlendLineRGB32SSE2> },
+
+    { VLC_CODEC_YUYV, VLC_CODEC_YUVA, VLC_CPU_SSE2, BlendYUVAToPackedSSE2<0, 1, 3> },
+    { VLC_CODEC_UYVY, VLC_CODEC_YUVA, VLC_CPU_SSE2, BlendYUVAToPackedSSE2<1, 0, 2> },
+    { VLC_CODEC_YVYU, VLC_CODEC_YUVA, VLC_CPU_SSE2, BlendYUVAToPackedSSE2<0, 3, 1> },
+    { VLC_CODEC_VYUY, VLC_CODEC_YUVA, VLC_CPU_SSE2, BlendYUVAToPackedSSE2<1, 2, 0> },
+#endif
+#undef PLANAR
+};
+#endif
+
 static const struct {
     vlc_fourcc_t     dst;
     vlc_fourcc_t     src;
@@ -639,7 +1201,17 @@ static int Open(vlc_object_t *object)
     const vlc_fourcc_t dst = filter->fmt_out.video.i_chroma;
 
     filter_sys_t *sys = new filter_sys_t();
-    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++) {
+#ifdef HAVE_BLEND_SIMD
+    const unsigned cpu = vlc_CPU();
+    for (size_t i = 0; i < sizeof(simd_blends) / sizeof(*simd_blends); i++) {
+        if (simd_blends[i].src == src && simd_blends[i].dst == dst &&
+            (cpu & simd_blends[i].cpu)) {
+            sys->blend = simd_blends[i].blend;
+            break;
+        }
+    }
+#endif
+    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends) && !sys->blend; i++) {
         if (blends[i].src == src && blends[i].dst == dst)
             sys->blend = blends[i].blend;
     }
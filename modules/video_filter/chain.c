@@ -32,6 +32,7 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
+#include <vlc_modules.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -51,10 +52,28 @@ vlc_module_end ()
 static picture_t *Chain         ( filter_t *, picture_t * );
 static int BufferAllocationInit ( filter_t *, void * );
 
-static int BuildChromaResize( filter_t * );
-static int BuildChromaChain( filter_t *p_filter );
+/* A conversion that worked, and the modules that did it */
+typedef struct
+{
+    /* Key */
+    video_format_t fmt_in;
+    video_format_t fmt_out;
+    bool           b_resize;
+
+    vlc_fourcc_t   i_chroma_mid; /* Middle chroma, for a chroma chain */
+    bool           b_chroma_first; /* Order, for a chroma and resize chain */
+    char           psz_first[32];
+    char           psz_second[32];
+} chain_path_t;
+
+static bool PathGet( const filter_t *, chain_path_t * );
+static void PathPut( const chain_path_t * );
+
+static int BuildChromaResize( filter_t *, chain_path_t *, bool b_cached );
+static int BuildChromaChain( filter_t *p_filter, chain_path_t *, bool b_cached );
 
-static int CreateChain( filter_chain_t *p_chain, es_format_t *p_fmt_mid, config_chain_t * );
+static int CreateChain( filter_chain_t *p_chain, es_format_t *p_fmt_mid, config_chain_t *,
+                        chain_path_t * );
 static void EsFormatMergeSize( es_format_t *p_dst,
                                const es_format_t *p_base,
                                const es_format_t *p_size );
@@ -74,6 +93,81 @@ struct filter_sys_t
 
 #define CHAIN_LEVEL_MAX 1
 
+/*****************************************************************************
+ * Path cache
+ *****************************************************************************
+ * Finding a chain opens and closes filter modules for each tried middle
+ * format, every time a video output or a transcoder sets up the same
+ * conversion. The last working paths are remembered for the whole process,
+ * and tried first with the very modules that built them.
+ *****************************************************************************/
+#define PATH_CACHE_SIZE 16
+
+static struct
+{
+    vlc_mutex_t  lock;
+    unsigned     i_count;
+    unsigned     i_next;
+    chain_path_t paths[PATH_CACHE_SIZE];
+} path_cache = { .lock = VLC_STATIC_MUTEX };
+
+static bool PathMatch( const chain_path_t *p_path, const chain_path_t *p_key )
+{
+    const video_format_t *a = &p_path->fmt_in, *b = &p_key->fmt_in;
+    const video_format_t *c = &p_path->fmt_out, *d = &p_key->fmt_out;
+
+    return p_path->b_resize == p_key->b_resize &&
+           a->i_chroma == b->i_chroma && a->i_rmask == b->i_rmask &&
+           a->i_gmask == b->i_gmask && a->i_bmask == b->i_bmask &&
+           c->i_chroma == d->i_chroma && c->i_rmask == d->i_rmask &&
+           c->i_gmask == d->i_gmask && c->i_bmask == d->i_bmask;
+}
+
+/* Initializes the key of p_path, and returns true if a path is known for it */
+static bool PathGet( const filter_t *p_filter, chain_path_t *p_path )
+{
+    memset( p_path, 0, sizeof(*p_path) );
+    p_path->fmt_in = p_filter->fmt_in.video;
+    p_path->fmt_out = p_filter->fmt_out.video;
+    p_path->b_resize = p_filter->fmt_in.video.i_width  != p_filter->fmt_out.video.i_width ||
+                       p_filter->fmt_in.video.i_height != p_filter->fmt_out.video.i_height;
+
+    bool b_found = false;
+    vlc_mutex_lock( &path_cache.lock );
+    for( unsigned i = 0; i < path_cache.i_count; i++ )
+    {
+        if( PathMatch( &path_cache.paths[i], p_path ) )
+        {
+            *p_path = path_cache.paths[i];
+            b_found = true;
+            break;
+        }
+    }
+    vlc_mutex_unlock( &path_cache.lock );
+    /* The key only holds the chromas: the palette must not be kept */
+    p_path->fmt_in.p_palette = p_path->fmt_out.p_palette = NULL;
+    return b_found;
+}
+
+static void PathPut( const chain_path_t *p_path )
+{
+    vlc_mutex_lock( &path_cache.lock );
+    unsigned i;
+    for( i = 0; i < path_cache.i_count; i++ )
+        if( PathMatch( &path_cache.paths[i], p_path ) )
+            break;
+    if( i == path_cache.i_count )
+    {
+        /* Replace the oldest entry once full */
+        if( path_cache.i_count < PATH_CACHE_SIZE )
+            path_cache.i_count++;
+        i = path_cache.i_next;
+        path_cache.i_next = (path_cache.i_next + 1) % PATH_CACHE_SIZE;
+    }
+    path_cache.paths[i] = *p_path;
+    vlc_mutex_unlock( &path_cache.lock );
+}
+
 /*****************************************************************************
  * Activate: allocate a chroma function
  *****************************************************************************
@@ -102,12 +196,17 @@ static int Activate( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    chain_path_t path;
+    const bool b_cached = PathGet( p_filter, &path );
+
     if( b_chroma && b_resize )
-        i_ret = BuildChromaResize( p_filter );
+        i_ret = BuildChromaResize( p_filter, &path, b_cached );
     else if( b_chroma )
-        i_ret = BuildChromaChain( p_filter );
+        i_ret = BuildChromaChain( p_filter, &path, b_cached );
     else
         i_ret = VLC_EGENERIC;
+    if( i_ret == VLC_SUCCESS )
+        PathPut( &path );
 
     if( i_ret )
     {
@@ -139,40 +238,74 @@ static picture_t *Chain( filter_t *p_filter, picture_t *p_pic )
 /*****************************************************************************
  * Builders
  *****************************************************************************/
-static int BuildChromaResize( filter_t *p_filter )
+static int TryChromaResize( filter_t *p_filter, bool b_chroma_first,
+                            chain_path_t *p_path )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     es_format_t fmt_mid;
-    int i_ret;
 
-    /* Lets try resizing and then doing the chroma conversion */
     filter_chain_Reset( p_sys->p_chain, &p_filter->fmt_in, &p_filter->fmt_out );
 
-    msg_Dbg( p_filter, "Trying to build resize+chroma" );
-    EsFormatMergeSize( &fmt_mid, &p_filter->fmt_in, &p_filter->fmt_out );
-    i_ret = CreateChain( p_sys->p_chain, &fmt_mid, NULL );
+    msg_Dbg( p_filter, "Trying to build %s", b_chroma_first ? "chroma+resize"
+                                                            : "resize+chroma" );
+    if( b_chroma_first )
+        EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
+    else
+        EsFormatMergeSize( &fmt_mid, &p_filter->fmt_in, &p_filter->fmt_out );
+    int i_ret = CreateChain( p_sys->p_chain, &fmt_mid, NULL, p_path );
     es_format_Clean( &fmt_mid );
     if( i_ret == VLC_SUCCESS )
-        return VLC_SUCCESS;
-
-    /* Lets try it the other way arround (chroma and then resize) */
-    filter_chain_Reset( p_sys->p_chain, &p_filter->fmt_in, &p_filter->fmt_out );
+        p_path->b_chroma_first = b_chroma_first;
+    return i_ret;
+}
 
-    msg_Dbg( p_filter, "Trying to build chroma+resize" );
-    EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
-    i_ret = CreateChain( p_sys->p_chain, &fmt_mid, NULL );
-    es_format_Clean( &fmt_mid );
-    if( i_ret == VLC_SUCCESS )
+static int BuildChromaResize( filter_t *p_filter, chain_path_t *p_path,
+                              bool b_cached )
+{
+    if( b_cached &&
+        TryChromaResize( p_filter, p_path->b_chroma_first, p_path ) == VLC_SUCCESS )
         return VLC_SUCCESS;
 
+    /* Lets try resizing and then doing the chroma conversion,
+     * and then the other way arround (chroma and then resize) */
+    for( int i = 0; i < 2; i++ )
+    {
+        p_path->psz_first[0] = p_path->psz_second[0] = '\0';
+        if( TryChromaResize( p_filter, i != 0, p_path ) == VLC_SUCCESS )
+            return VLC_SUCCESS;
+    }
     return VLC_EGENERIC;
 }
 
-static int BuildChromaChain( filter_t *p_filter )
+static int TryChromaChain( filter_t *p_filter, vlc_fourcc_t i_chroma,
+                           config_chain_t *p_cfg, chain_path_t *p_path )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     es_format_t fmt_mid;
 
+    msg_Dbg( p_filter, "Trying to use chroma %4.4s as middle man",
+             (char*)&i_chroma );
+
+    es_format_Copy( &fmt_mid, &p_filter->fmt_in );
+    fmt_mid.i_codec        =
+    fmt_mid.video.i_chroma = i_chroma;
+    fmt_mid.video.i_rmask  = 0;
+    fmt_mid.video.i_gmask  = 0;
+    fmt_mid.video.i_bmask  = 0;
+    video_format_FixRgb(&fmt_mid.video);
+
+    filter_chain_Reset( p_sys->p_chain, &p_filter->fmt_in, &p_filter->fmt_out );
+
+    int i_ret = CreateChain( p_sys->p_chain, &fmt_mid, p_cfg, p_path );
+    es_format_Clean( &fmt_mid );
+    if( i_ret == VLC_SUCCESS )
+        p_path->i_chroma_mid = i_chroma;
+    return i_ret;
+}
+
+static int BuildChromaChain( filter_t *p_filter, chain_path_t *p_path,
+                             bool b_cached )
+{
     /* We have to protect ourself against a too high recursion */
     const char *psz_option = MODULE_STRING"-level";
     int i_level = 0;
@@ -202,6 +335,15 @@ static int BuildChromaChain( filter_t *p_filter )
     if( !cfg_level.psz_name || !cfg_level.psz_value )
         goto exit;
 
+    /* The known path first */
+    if( b_cached )
+    {
+        i_ret = TryChromaChain( p_filter, p_path->i_chroma_mid, &cfg_level,
+                                p_path );
+        if( i_ret == VLC_SUCCESS )
+            goto exit;
+    }
+
     /* Now try chroma format list */
     for( int i = 0; pi_allowed_chromas[i]; i++ )
     {
@@ -210,22 +352,8 @@ static int BuildChromaChain( filter_t *p_filter )
             i_chroma == p_filter->fmt_out.i_codec )
             continue;
 
-        msg_Dbg( p_filter, "Trying to use chroma %4.4s as middle man",
-                 (char*)&i_chroma );
-
-        es_format_Copy( &fmt_mid, &p_filter->fmt_in );
-        fmt_mid.i_codec        =
-        fmt_mid.video.i_chroma = i_chroma;
-        fmt_mid.video.i_rmask  = 0;
-        fmt_mid.video.i_gmask  = 0;
-        fmt_mid.video.i_bmask  = 0;
-        video_format_FixRgb(&fmt_mid.video);
-
-        filter_chain_Reset( p_sys->p_chain, &p_filter->fmt_in, &p_filter->fmt_out );
-
-        i_ret = CreateChain( p_sys->p_chain, &fmt_mid, &cfg_level );
-        es_format_Clean( &fmt_mid );
-
+        p_path->psz_first[0] = p_path->psz_second[0] = '\0';
+        i_ret = TryChromaChain( p_filter, i_chroma, &cfg_level, p_path );
         if( i_ret == VLC_SUCCESS )
             break;
     }
@@ -262,17 +390,28 @@ static int BufferAllocationInit ( filter_t *p_filter, void *p_data )
 /*****************************************************************************
  *
  *****************************************************************************/
-static int CreateChain( filter_chain_t *p_chain, es_format_t *p_fmt_mid, config_chain_t *p_cfg )
+/* Appends the two filters, with the modules named in p_path if any, and
+ * writes the names of the modules used back to p_path */
+static int CreateChain( filter_chain_t *p_chain, es_format_t *p_fmt_mid, config_chain_t *p_cfg,
+                        chain_path_t *p_path )
 {
-    filter_t *p_filter1;
+    const char *psz_first = p_path->psz_first[0] ? p_path->psz_first : NULL;
+    const char *psz_second = p_path->psz_second[0] ? p_path->psz_second : NULL;
+    filter_t *p_filter1, *p_filter2;
+
     if( !( p_filter1 =
-           filter_chain_AppendFilter( p_chain, NULL, p_cfg, NULL, p_fmt_mid )) )
+           filter_chain_AppendFilter( p_chain, psz_first, p_cfg, NULL, p_fmt_mid )) )
         return VLC_EGENERIC;
-    if( !filter_chain_AppendFilter( p_chain, NULL, p_cfg, p_fmt_mid, NULL ) )
+    if( !( p_filter2 =
+           filter_chain_AppendFilter( p_chain, psz_second, p_cfg, p_fmt_mid, NULL )) )
     {
         filter_chain_DeleteFilter( p_chain, p_filter1 );
         return VLC_EGENERIC;
     }
+    strlcpy( p_path->psz_first, module_get_object( p_filter1->p_module ),
+             sizeof(p_path->psz_first) );
+    strlcpy( p_path->psz_second, module_get_object( p_filter2->p_module ),
+             sizeof(p_path->psz_second) );
     return VLC_SUCCESS;
 }
 
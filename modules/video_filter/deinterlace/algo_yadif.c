@@ -47,6 +47,148 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+typedef struct
+{
+    const picture_t *p_prev;
+    const picture_t *p_cur;
+    const picture_t *p_next;
+    picture_t       *p_dst;
+    int             i_field;
+    int             i_parity;
+    int             i_rows;
+    yadif_line_t    filter;
+} yadif_job_t;
+
+/* A line of 1920 pixels, within 5 lines of each of the 3 pictures */
+#define YADIF_BENCH_WIDTH 1920
+#define YADIF_BENCH_PITCH (YADIF_BENCH_WIDTH + 128)
+#define YADIF_BENCH_SIZE  (5 * YADIF_BENCH_PITCH)
+
+typedef struct
+{
+    const yadif_line_t *lines;
+    uint8_t *p_buffer;
+} yadif_bench_t;
+
+static void YadifBench( void *opaque, unsigned i )
+{
+    const yadif_bench_t *bench = opaque;
+    /* Start on the middle line, past the left margin */
+    uint8_t *p_prev = &bench->p_buffer[2 * YADIF_BENCH_PITCH + 64];
+    uint8_t *p_cur  = p_prev + YADIF_BENCH_SIZE;
+    uint8_t *p_next = p_cur + YADIF_BENCH_SIZE;
+    uint8_t *p_dst  = p_next + YADIF_BENCH_SIZE;
+
+    for( int n = 0; n < 32; n++ )
+        bench->lines[i]( p_dst, p_prev, p_cur, p_next, YADIF_BENCH_WIDTH,
+                         YADIF_BENCH_PITCH, -YADIF_BENCH_PITCH, n & 1, 0 );
+}
+
+static yadif_line_t YadifGetLine( filter_t *p_filter )
+{
+    yadif_line_t lines[6];
+    unsigned i_lines = 0;
+
+    /* In order of preference */
+#if defined(HAVE_YADIF_AVX2)
+    if( vlc_CPU_AVX2() )
+        lines[i_lines++] = yadif_filter_line_avx2;
+#endif
+#if defined(HAVE_YADIF_SSSE3)
+    if( vlc_CPU_SSSE3() )
+        lines[i_lines++] = yadif_filter_line_ssse3;
+#endif
+#if defined(HAVE_YADIF_SSE2)
+    if( vlc_CPU_SSE2() )
+        lines[i_lines++] = yadif_filter_line_sse2;
+#endif
+#if defined(HAVE_YADIF_MMX)
+    if( vlc_CPU_MMX() )
+        lines[i_lines++] = yadif_filter_line_mmx;
+#endif
+#if defined(HAVE_YADIF_ARM_NEON)
+    if( vlc_CPU_ARM_NEON() )
+        lines[i_lines++] = yadif_filter_line_neon;
+#endif
+    lines[i_lines++] = yadif_filter_line_c;
+
+    unsigned i = 0;
+    yadif_bench_t bench = {
+        .lines = lines,
+        .p_buffer = i_lines > 1 ? vlc_memalign( 16, 3 * YADIF_BENCH_SIZE
+                                                + YADIF_BENCH_PITCH ) : NULL,
+    };
+    if( bench.p_buffer != NULL )
+    {
+        for( int n = 0; n < 3 * YADIF_BENCH_SIZE + YADIF_BENCH_PITCH; n++ )
+            bench.p_buffer[n] = (n * 7) ^ (n / YADIF_BENCH_PITCH * 13);
+        i = vlc_CPU_Fastest( p_filter, "yadif line", i_lines, YadifBench,
+                             &bench );
+        vlc_free( bench.p_buffer );
+    }
+    return lines[i];
+}
+
+/* Filters the lines of each plane proportional to [i_start, i_end) */
+static void YadifSlice( filter_t *p_filter, void *p_data,
+                        int i_start, int i_end )
+{
+    VLC_UNUSED(p_filter);
+
+    const yadif_job_t *p_job = p_data;
+    const int yadif_parity = p_job->i_parity;
+    const int i_field = p_job->i_field;
+    picture_t *p_dst = p_job->p_dst;
+
+    for( int n = 0; n < p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &p_job->p_prev->p[n];
+        const plane_t *curp  = &p_job->p_cur->p[n];
+        const plane_t *nextp = &p_job->p_next->p[n];
+        plane_t *dstp        = &p_dst->p[n];
+
+        const int i_lines = dstp->i_visible_lines;
+        const int i_first = __MAX( i_lines * i_start / p_job->i_rows, 1 );
+        const int i_last  = __MIN( i_lines * i_end / p_job->i_rows, i_lines - 1 );
+
+        for( int y = i_first; y < i_last; y++ )
+        {
+            if( (y % 2) == i_field  ||  yadif_parity == 2 )
+            {
+                memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                int mode;
+                /* Spatial checks only when enough data */
+                mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                p_job->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                               &prevp->p_pixels[y * prevp->i_pitch],
+                               &curp->p_pixels[y * curp->i_pitch],
+                               &nextp->p_pixels[y * nextp->i_pitch],
+                               dstp->i_visible_pitch,
+                               y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                               y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                               yadif_parity,
+                               mode );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+        }
+    }
+}
+
 int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
                  int i_order, int i_field )
 {
@@ -104,74 +246,28 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     /* Filter if we have all the pictures we need */
     if( p_prev && p_cur && p_next )
     {
-        /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
-
-#if defined(HAVE_YADIF_SSSE3)
-        if( vlc_CPU_SSSE3() )
-            filter = yadif_filter_line_ssse3;
-        else
-#endif
-#if defined(HAVE_YADIF_SSE2)
-        if( vlc_CPU_SSE2() )
-            filter = yadif_filter_line_sse2;
-        else
-#endif
-#if defined(HAVE_YADIF_MMX)
-        if( vlc_CPU_MMX() )
-            filter = yadif_filter_line_mmx;
-        else
-#endif
-            filter = yadif_filter_line_c;
+        yadif_line_t filter;
 
         if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
-
-        for( int n = 0; n < p_dst->i_planes; n++ )
+            filter = (yadif_line_t)yadif_filter_line_c_16bit;
+        else
         {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
+            if( p_sys->pf_yadif_line == NULL )
+                p_sys->pf_yadif_line = YadifGetLine( p_filter );
+            filter = p_sys->pf_yadif_line;
         }
 
+        yadif_job_t job = {
+            .p_prev = p_prev, .p_cur = p_cur, .p_next = p_next,
+            .p_dst = p_dst, .i_field = i_field, .i_parity = yadif_parity,
+            .i_rows = p_dst->p[0].i_visible_lines, .filter = filter,
+        };
+        /* Cut the stripes in units of the smallest plane */
+        for( int n = 1; n < p_dst->i_planes; n++ )
+            job.i_rows = __MIN( job.i_rows, p_dst->p[n].i_visible_lines );
+
+        filter_RunSlices( p_filter, YadifSlice, &job, job.i_rows );
+
         p_sys->i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
         return VLC_SUCCESS;
@@ -35,6 +35,11 @@
 struct filter_t;
 struct picture_t;
 
+/** Yadif routine filtering one line (see yadif.h) */
+typedef void (*yadif_line_t)( uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                              uint8_t *next, int w, int prefs, int mrefs,
+                              int parity, int mode );
+
 /*****************************************************************************
  * Functions
  *****************************************************************************/
@@ -586,6 +586,97 @@ int Mouse( filter_t *p_filter,
 }
 
 
+/*****************************************************************************
+ * Merge routine selection
+ *****************************************************************************/
+
+typedef struct
+{
+    void (*merge) ( void *, const void *, const void *, size_t );
+    void (*end) ( void );
+} merge_routine_t;
+
+#define MERGE_BENCH_SIZE 16384
+
+typedef struct
+{
+    const merge_routine_t *routines;
+    uint8_t *p_buffer;
+} merge_bench_t;
+
+static void MergeBench( void *opaque, unsigned i )
+{
+    const merge_bench_t *bench = opaque;
+    const merge_routine_t *routine = &bench->routines[i];
+    uint8_t *p_dst = bench->p_buffer;
+    const uint8_t *p_s1 = p_dst + MERGE_BENCH_SIZE;
+    const uint8_t *p_s2 = p_s1 + MERGE_BENCH_SIZE;
+
+    for( int n = 0; n < 256; n++ )
+        routine->merge( p_dst, p_s1, p_s2, MERGE_BENCH_SIZE );
+    if( routine->end != NULL )
+        routine->end();
+}
+
+static void SetMergeRoutine( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_chroma_description_t *chroma = p_sys->chroma;
+    merge_routine_t routines[7];
+    unsigned i_routines = 0;
+
+    /* In order of preference */
+#if defined(CAN_COMPILE_C_ALTIVEC)
+    if( chroma->pixel_size == 1 && vlc_CPU_ALTIVEC() )
+        routines[i_routines++] = (merge_routine_t){ MergeAltivec, NULL };
+#endif
+#if defined(CAN_COMPILE_SSE2)
+    if( vlc_CPU_SSE2() )
+        routines[i_routines++] = (merge_routine_t){
+            chroma->pixel_size == 1 ? Merge8BitSSE2 : Merge16BitSSE2, EndMMX };
+#endif
+#if defined(CAN_COMPILE_MMXEXT)
+    if( chroma->pixel_size == 1 && vlc_CPU_MMXEXT() )
+        routines[i_routines++] = (merge_routine_t){ MergeMMXEXT, EndMMX };
+#endif
+#if defined(CAN_COMPILE_3DNOW)
+    if( chroma->pixel_size == 1 && vlc_CPU_3dNOW() )
+        routines[i_routines++] = (merge_routine_t){ Merge3DNow, End3DNow };
+#endif
+#if defined(CAN_COMPILE_ARM)
+    if( vlc_CPU_ARM_NEON() )
+        routines[i_routines++] = (merge_routine_t){
+            chroma->pixel_size == 1 ? merge8_arm_neon : merge16_arm_neon,
+            NULL };
+    if( vlc_CPU_ARMv6() )
+        routines[i_routines++] = (merge_routine_t){
+            chroma->pixel_size == 1 ? merge8_armv6 : merge16_armv6, NULL };
+#endif
+    routines[i_routines++] = (merge_routine_t){
+        chroma->pixel_size == 1 ? Merge8BitGeneric : Merge16BitGeneric, NULL };
+
+    unsigned i = 0;
+    merge_bench_t bench = {
+        .routines = routines,
+        .p_buffer = i_routines > 1 ? vlc_memalign( 16, 3 * MERGE_BENCH_SIZE )
+                                   : NULL,
+    };
+    if( bench.p_buffer != NULL )
+    {
+        memset( bench.p_buffer, 0x55, 3 * MERGE_BENCH_SIZE );
+        i = vlc_CPU_Fastest( p_filter, chroma->pixel_size == 1
+                             ? "deinterlace merge 8-bit"
+                             : "deinterlace merge 16-bit",
+                             i_routines, MergeBench, &bench );
+        vlc_free( bench.p_buffer );
+    }
+
+    p_sys->pf_merge = routines[i].merge;
+#if defined(__i386__) || defined(__x86_64__)
+    p_sys->pf_end_merge = routines[i].end;
+#endif
+}
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -627,51 +718,8 @@ int Open( vlc_object_t *p_this )
 
     IVTCClearState( p_filter );
 
-#if defined(CAN_COMPILE_C_ALTIVEC)
-    if( chroma->pixel_size == 1 && vlc_CPU_ALTIVEC() )
-        p_sys->pf_merge = MergeAltivec;
-    else
-#endif
-#if defined(CAN_COMPILE_SSE2)
-    if( vlc_CPU_SSE2() )
-    {
-        p_sys->pf_merge = chroma->pixel_size == 1 ? Merge8BitSSE2 : Merge16BitSSE2;
-        p_sys->pf_end_merge = EndMMX;
-    }
-    else
-#endif
-#if defined(CAN_COMPILE_MMXEXT)
-    if( chroma->pixel_size == 1 && vlc_CPU_MMXEXT() )
-    {
-        p_sys->pf_merge = MergeMMXEXT;
-        p_sys->pf_end_merge = EndMMX;
-    }
-    else
-#endif
-#if defined(CAN_COMPILE_3DNOW)
-    if( chroma->pixel_size == 1 && vlc_CPU_3dNOW() )
-    {
-        p_sys->pf_merge = Merge3DNow;
-        p_sys->pf_end_merge = End3DNow;
-    }
-    else
-#endif
-#if defined(CAN_COMPILE_ARM)
-    if( vlc_CPU_ARM_NEON() )
-        p_sys->pf_merge =
-            (chroma->pixel_size == 1) ? merge8_arm_neon : merge16_arm_neon;
-    else
-    if( vlc_CPU_ARMv6() )
-        p_sys->pf_merge =
-            (chroma->pixel_size == 1) ? merge8_armv6 : merge16_armv6;
-    else
-#endif
-    {
-        p_sys->pf_merge = chroma->pixel_size == 1 ? Merge8BitGeneric : Merge16BitGeneric;
-#if defined(__i386__) || defined(__x86_64__)
-        p_sys->pf_end_merge = NULL;
-#endif
-    }
+    SetMergeRoutine( p_filter );
+    p_sys->pf_yadif_line = NULL;
 
     /* */
     config_ChainParse( p_filter, FILTER_CFG_PREFIX, ppsz_filter_options,
@@ -732,6 +780,9 @@ int Open( vlc_object_t *p_this )
     p_filter->pf_video_filter = Deinterlace;
     p_filter->pf_video_flush  = Flush;
     p_filter->pf_video_mouse  = Mouse;
+    /* Yadif filters the lines independently */
+    p_filter->b_slices = p_sys->i_mode == DEINTERLACE_YADIF
+                      || p_sys->i_mode == DEINTERLACE_YADIF2X;
 
     msg_Dbg( p_filter, "deinterlacing" );
 
@@ -104,6 +104,8 @@ struct filter_sys_t
     /** Merge finalization routine for SSE */
     void (*pf_end_merge) ( void );
 #endif
+    /** Yadif line routine, chosen at the first Yadif frame */
+    yadif_line_t pf_yadif_line;
 
     /**
      * Metadata history (PTS, nb_fields, TFF). Used for framerate doublers.
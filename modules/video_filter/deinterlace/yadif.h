@@ -145,3 +145,225 @@ static void yadif_filter_line_c_16bit(uint16_t *dst, uint16_t *prev, uint16_t *c
     prefs /= 2;
     FILTER
 }
+
+#ifdef CAN_COMPILE_AVX2
+#if defined(__SSE__) || VLC_GCC_VERSION(4, 4) || defined(__clang__)
+// ================ AVX2 =================
+/* Same arithmetic as FILTER, 16 pixels at a time. The pixels are widened to
+ * words when loaded, so the neighbours are loaded rather than shifted (256
+ * bits shifts do not cross the 128 bits lanes). */
+#define HAVE_YADIF_AVX2
+
+#define ZX(mem,dst) "vpmovzxbw "mem", "dst" \n\t"
+
+#undef CHECK
+
+/* ymm5 = (cur[mrefs+j] + cur[prefs-j])>>1, ymm4 = score */
+#define CHECK(j,mj,m1,p1,mj1,pj1) \
+            ZX(#m1"(%[cur],%[mrefs])", "%%ymm2")\
+            ZX(#p1"(%[cur],%[prefs])", "%%ymm3")\
+            "vpsubw    %%ymm3, %%ymm2, %%ymm4 \n\t"\
+            "vpabsw    %%ymm4, %%ymm4 \n\t"\
+            ZX(#j"(%[cur],%[mrefs])", "%%ymm2")\
+            ZX(#mj"(%[cur],%[prefs])", "%%ymm3")\
+            "vpaddw    %%ymm3, %%ymm2, %%ymm5 \n\t"\
+            "vpsrlw    $1,     %%ymm5, %%ymm5 \n\t"\
+            "vpsubw    %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            "vpabsw    %%ymm2, %%ymm2 \n\t"\
+            "vpaddw    %%ymm2, %%ymm4, %%ymm4 \n\t"\
+            ZX(#mj1"(%[cur],%[mrefs])", "%%ymm2")\
+            ZX(#pj1"(%[cur],%[prefs])", "%%ymm3")\
+            "vpsubw    %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            "vpabsw    %%ymm2, %%ymm2 \n\t"\
+            "vpaddw    %%ymm2, %%ymm4, %%ymm4 \n\t"
+
+/* if (score < spatial_score) { spatial_score = score; spatial_pred = ... } */
+#define CHECK1 \
+            "vpcmpgtw  %%ymm4, %%ymm0, %%ymm6 \n\t"\
+            "vpminsw   %%ymm4, %%ymm0, %%ymm0 \n\t"\
+            "vpblendvb %%ymm6, %%ymm5, %%ymm1, %%ymm1 \n\t"
+
+/* Same as CHECK1, only where the previous CHECK1 succeeded */
+#define CHECK2 \
+            "vpcmpgtw  %%ymm4, %%ymm0, %%ymm7 \n\t"\
+            "vpand     %%ymm6, %%ymm7, %%ymm7 \n\t"\
+            "vpblendvb %%ymm7, %%ymm4, %%ymm0, %%ymm0 \n\t"\
+            "vpblendvb %%ymm7, %%ymm5, %%ymm1, %%ymm1 \n\t"
+
+#define FILTER_AVX2 \
+    for (; x + 16 <= w; x += 16) {\
+        __asm__ volatile(\
+            ZX("(%[cur],%[mrefs])", "%%ymm0") /* c */\
+            ZX("(%[cur],%[prefs])", "%%ymm1") /* e */\
+            ZX("(%["prev2"])", "%%ymm2")\
+            ZX("(%["next2"])", "%%ymm3")\
+            "vpaddw    %%ymm3, %%ymm2, %%ymm4 \n\t"\
+            "vpsrlw    $1,     %%ymm4, %%ymm4 \n\t" /* d */\
+            "vmovdqa   %%ymm0,   (%[tmp]) \n\t"\
+            "vmovdqa   %%ymm4, 32(%[tmp]) \n\t"\
+            "vmovdqa   %%ymm1, 64(%[tmp]) \n\t"\
+            "vpsubw    %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            "vpabsw    %%ymm2, %%ymm2 \n\t"\
+            "vpsrlw    $1,     %%ymm2, %%ymm2 \n\t" /* temporal_diff0>>1 */\
+            ZX("(%[prev],%[mrefs])", "%%ymm3")\
+            ZX("(%[prev],%[prefs])", "%%ymm5")\
+            "vpsubw    %%ymm0, %%ymm3, %%ymm3 \n\t"\
+            "vpsubw    %%ymm1, %%ymm5, %%ymm5 \n\t"\
+            "vpabsw    %%ymm3, %%ymm3 \n\t"\
+            "vpabsw    %%ymm5, %%ymm5 \n\t"\
+            "vpaddw    %%ymm5, %%ymm3, %%ymm3 \n\t"\
+            "vpsrlw    $1,     %%ymm3, %%ymm3 \n\t" /* temporal_diff1 */\
+            "vpmaxsw   %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            ZX("(%[next],%[mrefs])", "%%ymm3")\
+            ZX("(%[next],%[prefs])", "%%ymm5")\
+            "vpsubw    %%ymm0, %%ymm3, %%ymm3 \n\t"\
+            "vpsubw    %%ymm1, %%ymm5, %%ymm5 \n\t"\
+            "vpabsw    %%ymm3, %%ymm3 \n\t"\
+            "vpabsw    %%ymm5, %%ymm5 \n\t"\
+            "vpaddw    %%ymm5, %%ymm3, %%ymm3 \n\t"\
+            "vpsrlw    $1,     %%ymm3, %%ymm3 \n\t" /* temporal_diff2 */\
+            "vpmaxsw   %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            "vmovdqa   %%ymm2, 96(%[tmp]) \n\t" /* diff */\
+\
+            "vpsubw    %%ymm1, %%ymm0, %%ymm5 \n\t"\
+            "vpabsw    %%ymm5, %%ymm5 \n\t" /* ABS(c-e) */\
+            "vpaddw    %%ymm1, %%ymm0, %%ymm1 \n\t"\
+            "vpsrlw    $1,     %%ymm1, %%ymm1 \n\t" /* spatial_pred */\
+            ZX("-1(%[cur],%[mrefs])", "%%ymm2")\
+            ZX("-1(%[cur],%[prefs])", "%%ymm3")\
+            "vpsubw    %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            "vpabsw    %%ymm2, %%ymm2 \n\t"\
+            "vpaddw    %%ymm2, %%ymm5, %%ymm5 \n\t"\
+            ZX("1(%[cur],%[mrefs])", "%%ymm2")\
+            ZX("1(%[cur],%[prefs])", "%%ymm3")\
+            "vpsubw    %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            "vpabsw    %%ymm2, %%ymm2 \n\t"\
+            "vpaddw    %%ymm2, %%ymm5, %%ymm5 \n\t"\
+            "vpcmpeqw  %%ymm2, %%ymm2, %%ymm2 \n\t"\
+            "vpaddw    %%ymm2, %%ymm5, %%ymm0 \n\t" /* spatial_score */\
+\
+            CHECK(-1, 1, -2, 0, 0, 2)\
+            CHECK1\
+            CHECK(-2, 2, -3, 1, -1, 3)\
+            CHECK2\
+            CHECK(1, -1, 0, -2, 2, 0)\
+            CHECK1\
+            CHECK(2, -2, 1, -3, 3, -1)\
+            CHECK2\
+\
+            /* if(p->mode<2) ... */\
+            "vmovdqa   96(%[tmp]), %%ymm6 \n\t" /* diff */\
+            "cmpl      $2, %[mode] \n\t"\
+            "jge       1f \n\t"\
+            ZX("(%["prev2"],%[mrefs],2)", "%%ymm2")\
+            ZX("(%["next2"],%[mrefs],2)", "%%ymm4")\
+            ZX("(%["prev2"],%[prefs],2)", "%%ymm3")\
+            ZX("(%["next2"],%[prefs],2)", "%%ymm5")\
+            "vpaddw    %%ymm4, %%ymm2, %%ymm2 \n\t"\
+            "vpaddw    %%ymm5, %%ymm3, %%ymm3 \n\t"\
+            "vpsrlw    $1,     %%ymm2, %%ymm2 \n\t" /* b */\
+            "vpsrlw    $1,     %%ymm3, %%ymm3 \n\t" /* f */\
+            "vmovdqa     (%[tmp]), %%ymm4 \n\t" /* c */\
+            "vmovdqa   32(%[tmp]), %%ymm5 \n\t" /* d */\
+            "vmovdqa   64(%[tmp]), %%ymm7 \n\t" /* e */\
+            "vpsubw    %%ymm4, %%ymm2, %%ymm2 \n\t" /* b-c */\
+            "vpsubw    %%ymm7, %%ymm3, %%ymm3 \n\t" /* f-e */\
+            "vpsubw    %%ymm7, %%ymm5, %%ymm0 \n\t" /* d-e */\
+            "vpsubw    %%ymm4, %%ymm5, %%ymm5 \n\t" /* d-c */\
+            "vpminsw   %%ymm3, %%ymm2, %%ymm4 \n\t"\
+            "vpmaxsw   %%ymm3, %%ymm2, %%ymm7 \n\t"\
+            "vpmaxsw   %%ymm5, %%ymm4, %%ymm4 \n\t"\
+            "vpmaxsw   %%ymm0, %%ymm4, %%ymm4 \n\t" /* max */\
+            "vpminsw   %%ymm5, %%ymm7, %%ymm7 \n\t"\
+            "vpminsw   %%ymm0, %%ymm7, %%ymm7 \n\t" /* min */\
+            "vpmaxsw   %%ymm7, %%ymm6, %%ymm6 \n\t"\
+            "vpxor     %%ymm3, %%ymm3, %%ymm3 \n\t"\
+            "vpsubw    %%ymm4, %%ymm3, %%ymm3 \n\t" /* -max */\
+            "vpmaxsw   %%ymm3, %%ymm6, %%ymm6 \n\t" /* diff= MAX3(diff, min, -max); */\
+            "1: \n\t"\
+\
+            "vmovdqa   32(%[tmp]), %%ymm2 \n\t" /* d */\
+            "vpsubw    %%ymm6, %%ymm2, %%ymm3 \n\t" /* d-diff */\
+            "vpaddw    %%ymm6, %%ymm2, %%ymm2 \n\t" /* d+diff */\
+            "vpmaxsw   %%ymm3, %%ymm1, %%ymm1 \n\t"\
+            "vpminsw   %%ymm2, %%ymm1, %%ymm1 \n\t" /* d = clip(spatial_pred, d-diff, d+diff); */\
+            "vpackuswb %%ymm1, %%ymm1, %%ymm1 \n\t"\
+            "vpermq    $0x08,  %%ymm1, %%ymm1 \n\t"\
+            "vmovdqu   %%xmm1, (%[dst]) \n\t"\
+\
+            ::[prev] "r"(prev),\
+             [cur]  "r"(cur),\
+             [next] "r"(next),\
+             [dst]  "r"(dst),\
+             [prefs]"r"((x86_reg)prefs),\
+             [mrefs]"r"((x86_reg)mrefs),\
+             [mode] "g"(mode),\
+             [tmp]  "r"(tmp)\
+            : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3",\
+              "xmm4", "xmm5", "xmm6", "xmm7"\
+        );\
+        dst += 16;\
+        prev+= 16;\
+        cur += 16;\
+        next+= 16;\
+    }
+
+VLC_SSE static void yadif_filter_line_avx2(uint8_t *dst,
+                              uint8_t *prev, uint8_t *cur, uint8_t *next,
+                              int w, int prefs, int mrefs, int parity, int mode)
+{
+    uint8_t tmpU[5*32];
+    uint8_t *tmp= (uint8_t*)(((uintptr_t)(tmpU+31)) & ~31);
+    int x = 0;
+
+    if (parity) {
+#define prev2 "prev"
+#define next2 "cur"
+        FILTER_AVX2
+#undef prev2
+#undef next2
+    } else {
+#define prev2 "cur"
+#define next2 "next"
+        FILTER_AVX2
+#undef prev2
+#undef next2
+    }
+    __asm__ volatile ("vzeroupper");
+
+    /* The remaining pixels */
+    if (x < w)
+        yadif_filter_line_c(dst, prev, cur, next, w - x, prefs, mrefs,
+                            parity, mode);
+}
+#undef ZX
+#undef CHECK
+#undef CHECK1
+#undef CHECK2
+#undef FILTER_AVX2
+#endif
+#endif
+
+#if defined(CAN_COMPILE_ARM)
+// ================= NEON =================
+#define HAVE_YADIF_ARM_NEON
+/* Filters a multiple of 8 pixels */
+void yadif_filter_line_arm_neon(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                                uint8_t *next, int w, int prefs, int mrefs,
+                                int parity, int mode);
+
+static void yadif_filter_line_neon(uint8_t *dst,
+                              uint8_t *prev, uint8_t *cur, uint8_t *next,
+                              int w, int prefs, int mrefs, int parity, int mode)
+{
+    const int x = w & ~7;
+
+    if (x > 0)
+        yadif_filter_line_arm_neon(dst, prev, cur, next, x, prefs, mrefs,
+                                   parity, mode);
+    /* The remaining pixels */
+    if (x < w)
+        yadif_filter_line_c(dst + x, prev + x, cur + x, next + x, w - x,
+                            prefs, mrefs, parity, mode);
+}
+#endif
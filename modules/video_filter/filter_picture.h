@@ -153,3 +153,25 @@ static inline picture_t *CopyInfoAndRelease( picture_t *p_outpic, picture_t *p_i
 
     return p_outpic;
 }
+
+/**
+ * Sets p_slice to the view of the rows [i_start, i_end) out of i_rows of
+ * p_pic, as given by filter_RunSlices(). Each plane is cut in proportion
+ * to its number of lines. The view shares the pixels of p_pic and must not
+ * be held or released.
+ */
+static inline void picture_GetSlice( picture_t *p_slice, const picture_t *p_pic,
+                                     int i_start, int i_end, int i_rows )
+{
+    *p_slice = *p_pic;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p = &p_pic->p[i];
+        const int i_first = p->i_visible_lines * i_start / i_rows;
+        const int i_last  = p->i_visible_lines * i_end / i_rows;
+
+        p_slice->p[i].p_pixels        = &p->p_pixels[i_first * p->i_pitch];
+        p_slice->p[i].i_lines         = i_last - i_first;
+        p_slice->p[i].i_visible_lines = i_last - i_first;
+    }
+}
@@ -90,7 +90,33 @@ static void deNoiseSpacial(
         FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
     }
 
-    for (Y = 1; Y < H; Y++){
+    /* Two lines at a time: their horizontal passes do not depend on each
+     * other, so that they can run in parallel */
+    for (Y = 1; Y + 1 < H; Y += 2){
+        const unsigned char *Src0 = &Frame[sLineOffs + sStride];
+        const unsigned char *Src1 = Src0 + sStride;
+        unsigned char *Dst0 = &FrameDest[dLineOffs + dStride];
+        unsigned char *Dst1 = Dst0 + dStride;
+        unsigned int PixelAnt0 = Src0[0]<<16;
+        unsigned int PixelAnt1 = Src1[0]<<16;
+
+        sLineOffs += 2 * sStride, dLineOffs += 2 * dStride;
+        PixelDst = LowPassMul(LineAnt[0], PixelAnt0, Vertical);
+        Dst0[0] = ((PixelDst+0x10007FFF)>>16);
+        PixelDst = LineAnt[0] = LowPassMul(PixelDst, PixelAnt1, Vertical);
+        Dst1[0] = ((PixelDst+0x10007FFF)>>16);
+
+        for (X = 1; X < W; X++){
+            PixelAnt0 = LowPassMul(PixelAnt0, Src0[X]<<16, Horizontal);
+            PixelAnt1 = LowPassMul(PixelAnt1, Src1[X]<<16, Horizontal);
+            PixelDst = LowPassMul(LineAnt[X], PixelAnt0, Vertical);
+            Dst0[X] = ((PixelDst+0x10007FFF)>>16);
+            PixelDst = LineAnt[X] = LowPassMul(PixelDst, PixelAnt1, Vertical);
+            Dst1[X] = ((PixelDst+0x10007FFF)>>16);
+        }
+    }
+
+    for (; Y < H; Y++){
         unsigned int PixelAnt;
         sLineOffs += sStride, dLineOffs += dStride;
         /* First pixel on each line doesn't have previous pixel */
@@ -156,7 +182,43 @@ static void deNoise(unsigned char *Frame,        // mpi->planes[x]
         FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
     }
 
-    for (Y = 1; Y < H; Y++){
+    /* Two lines at a time, as in deNoiseSpacial() */
+    for (Y = 1; Y + 1 < H; Y += 2){
+        const unsigned char *Src0 = &Frame[sLineOffs + sStride];
+        const unsigned char *Src1 = Src0 + sStride;
+        unsigned char *Dst0 = &FrameDest[dLineOffs + dStride];
+        unsigned char *Dst1 = Dst0 + dStride;
+        unsigned short *Prev0 = &FrameAnt[Y*W];
+        unsigned short *Prev1 = Prev0 + W;
+        unsigned int PixelAnt0 = Src0[0]<<16;
+        unsigned int PixelAnt1 = Src1[0]<<16;
+        unsigned int LineDst;
+
+        sLineOffs += 2 * sStride, dLineOffs += 2 * dStride;
+        LineDst = LowPassMul(LineAnt[0], PixelAnt0, Vertical);
+        PixelDst = LowPassMul(Prev0[0]<<8, LineDst, Temporal);
+        Prev0[0] = ((PixelDst+0x1000007F)>>8);
+        Dst0[0] = ((PixelDst+0x10007FFF)>>16);
+        LineDst = LineAnt[0] = LowPassMul(LineDst, PixelAnt1, Vertical);
+        PixelDst = LowPassMul(Prev1[0]<<8, LineDst, Temporal);
+        Prev1[0] = ((PixelDst+0x1000007F)>>8);
+        Dst1[0] = ((PixelDst+0x10007FFF)>>16);
+
+        for (X = 1; X < W; X++){
+            PixelAnt0 = LowPassMul(PixelAnt0, Src0[X]<<16, Horizontal);
+            PixelAnt1 = LowPassMul(PixelAnt1, Src1[X]<<16, Horizontal);
+            LineDst = LowPassMul(LineAnt[X], PixelAnt0, Vertical);
+            PixelDst = LowPassMul(Prev0[X]<<8, LineDst, Temporal);
+            Prev0[X] = ((PixelDst+0x1000007F)>>8);
+            Dst0[X] = ((PixelDst+0x10007FFF)>>16);
+            LineDst = LineAnt[X] = LowPassMul(LineDst, PixelAnt1, Vertical);
+            PixelDst = LowPassMul(Prev1[X]<<8, LineDst, Temporal);
+            Prev1[X] = ((PixelDst+0x1000007F)>>8);
+            Dst1[X] = ((PixelDst+0x10007FFF)>>16);
+        }
+    }
+
+    for (; Y < H; Y++){
         unsigned int PixelAnt;
         unsigned short* LinePrev=&FrameAnt[Y*W];
         sLineOffs += sStride, dLineOffs += dStride;
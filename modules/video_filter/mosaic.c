@@ -52,6 +52,19 @@ static subpicture_t *Filter ( filter_t *, mtime_t );
 static int MosaicCallback   ( vlc_object_t *, char const *, vlc_value_t,
                               vlc_value_t, void * );
 
+/* Per bridged ES state of the filter */
+typedef struct
+{
+    picture_t *p_src;         /* Last picture converted */
+    picture_t *p_scaled;      /* and its conversion */
+
+    mtime_t i_latency_sum, i_latency_max;
+    unsigned i_latency_count;
+} mosaic_tile_t;
+
+/* Tile latencies are reported every that many pictures */
+#define TILE_STATS_PERIOD 256
+
 /*****************************************************************************
  * filter_sys_t : filter descriptor
  *****************************************************************************/
@@ -79,6 +92,9 @@ struct filter_sys_t
     int i_offsets_length;
 
     mtime_t i_delay;
+
+    mosaic_tile_t *p_tiles;   /* Indexed as the bridge ES */
+    int i_tiles;
 };
 
 /*****************************************************************************
@@ -290,6 +306,8 @@ static int CreateFilter( vlc_object_t *p_this )
         return VLC_ENOMEM;
 
     p_filter->pf_sub_source = Filter;
+    p_sys->p_tiles = NULL;
+    p_sys->i_tiles = 0;
 
     vlc_mutex_init( &p_sys->lock );
     vlc_mutex_lock( &p_sys->lock );
@@ -372,6 +390,38 @@ static int CreateFilter( vlc_object_t *p_this )
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Tiles
+ *****************************************************************************/
+static void TileSetScaled( mosaic_tile_t *p_tile, picture_t *p_src,
+                           picture_t *p_scaled )
+{
+    if( p_tile->p_src )
+        picture_Release( p_tile->p_src );
+    if( p_tile->p_scaled )
+        picture_Release( p_tile->p_scaled );
+    p_tile->p_src = p_src ? picture_Hold( p_src ) : NULL;
+    p_tile->p_scaled = p_scaled ? picture_Hold( p_scaled ) : NULL;
+}
+
+static void TileLatency( filter_t *p_filter, mosaic_tile_t *p_tile,
+                         const bridged_es_t *p_es, mtime_t i_latency )
+{
+    p_tile->i_latency_sum += i_latency;
+    if( p_tile->i_latency_max < i_latency )
+        p_tile->i_latency_max = i_latency;
+    if( ++p_tile->i_latency_count < TILE_STATS_PERIOD )
+        return;
+
+    msg_Dbg( p_filter, "%s latency: %u samples, mean %"PRId64" us, "
+             "max %"PRId64" us", p_es->psz_id ? p_es->psz_id : "tile",
+             p_tile->i_latency_count,
+             p_tile->i_latency_sum / p_tile->i_latency_count,
+             p_tile->i_latency_max );
+    p_tile->i_latency_sum = p_tile->i_latency_max = 0;
+    p_tile->i_latency_count = 0;
+}
+
 /*****************************************************************************
  * DestroyFilter: destroy mosaic video filter
  *****************************************************************************/
@@ -421,6 +471,10 @@ static void DestroyFilter( vlc_object_t *p_this )
         p_sys->i_offsets_length = 0;
     }
 
+    for( int i = 0; i < p_sys->i_tiles; i++ )
+        TileSetScaled( &p_sys->p_tiles[i], NULL, NULL );
+    free( p_sys->p_tiles );
+
     vlc_mutex_destroy( &p_sys->lock );
     free( p_sys );
 }
@@ -467,6 +521,22 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
         return p_spu;
     }
 
+    if( p_sys->i_tiles < p_bridge->i_es_num )
+    {
+        mosaic_tile_t *p_tiles = realloc( p_sys->p_tiles,
+                                p_bridge->i_es_num * sizeof( *p_tiles ) );
+        if( p_tiles == NULL )
+        {
+            vlc_global_unlock( VLC_MOSAIC_MUTEX );
+            vlc_mutex_unlock( &p_sys->lock );
+            return p_spu;
+        }
+        memset( p_tiles + p_sys->i_tiles, 0,
+                (p_bridge->i_es_num - p_sys->i_tiles) * sizeof( *p_tiles ) );
+        p_sys->p_tiles = p_tiles;
+        p_sys->i_tiles = p_bridge->i_es_num;
+    }
+
     if ( p_sys->i_position == position_offsets )
     {
         /* If we have either too much or not enough offsets, fall-back
@@ -524,6 +594,7 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
     for ( i_index = 0; i_index < p_bridge->i_es_num; i_index++ )
     {
         bridged_es_t *p_es = p_bridge->pp_es[i_index];
+        mosaic_tile_t *p_tile = &p_sys->p_tiles[i_index];
         video_format_t fmt_in, fmt_out;
         picture_t *p_converted;
 
@@ -562,6 +633,7 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
 
         if ( p_es->p_picture == NULL )
             continue;
+        TileLatency( p_filter, p_tile, p_es, date - p_es->p_picture->date );
 
         if ( p_sys->i_order_length == 0 )
         {
@@ -618,13 +690,33 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             fmt_out.i_visible_width = fmt_out.i_width;
             fmt_out.i_visible_height = fmt_out.i_height;
 
-            p_converted = image_Convert( p_sys->p_image, p_es->p_picture,
-                                         &fmt_in, &fmt_out );
-            if( !p_converted )
+            picture_t *p_scaled = p_tile->p_scaled;
+            if( p_tile->p_src == p_es->p_picture && p_scaled != NULL
+             && p_scaled->format.i_chroma == fmt_out.i_chroma
+             && p_scaled->format.i_width == fmt_out.i_width
+             && p_scaled->format.i_height == fmt_out.i_height )
+            {
+                /* Same picture as the last time, e.g. slower input */
+                p_converted = picture_Hold( p_scaled );
+            }
+            else if( fmt_in.i_chroma == fmt_out.i_chroma
+                  && fmt_in.i_width == fmt_out.i_width
+                  && fmt_in.i_height == fmt_out.i_height )
             {
-                msg_Warn( p_filter,
-                           "image resizing and chroma conversion failed" );
-                continue;
+                /* Already scaled by the mosaic bridge on the input thread */
+                p_converted = picture_Hold( p_es->p_picture );
+            }
+            else
+            {
+                p_converted = image_Convert( p_sys->p_image, p_es->p_picture,
+                                             &fmt_in, &fmt_out );
+                if( !p_converted )
+                {
+                    msg_Warn( p_filter,
+                               "image resizing and chroma conversion failed" );
+                    continue;
+                }
+                TileSetScaled( p_tile, p_es->p_picture, p_converted );
             }
         }
         else
@@ -638,9 +730,13 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
         }
 
         p_region = subpicture_region_New( &fmt_out );
-        /* FIXME the copy is probably not needed anymore */
+        /* Pictures are not written to once pushed to the bridge:
+         * the region can share the picture rather than copying it. */
         if( p_region )
-            picture_Copy( p_region->p_picture, p_converted );
+        {
+            picture_Release( p_region->p_picture );
+            p_region->p_picture = picture_Hold( p_converted );
+        }
         if( !p_sys->b_keep )
             picture_Release( p_converted );
 
@@ -80,6 +80,16 @@ vlc_module_end ()
  * Local prototypes
  ****************************************************************************/
 
+/**
+ * Parameters of a scaling context.
+ */
+typedef struct
+{
+    int i_src_width, i_src_height, i_src_fmt;
+    int i_dst_width, i_dst_height, i_dst_fmt;
+    int i_flags;
+} ScalerKey;
+
 /**
  * Internal swscale filter structure.
  */
@@ -94,6 +104,11 @@ struct filter_sys_t
 
     struct SwsContext *ctx;
     struct SwsContext *ctxA;
+    ScalerKey key;
+    ScalerKey keyA;
+    bool b_stripes;
+    const vlc_chroma_description_t *p_dsc_in;
+    const vlc_chroma_description_t *p_dsc_out;
     picture_t *p_src_a;
     picture_t *p_dst_a;
     int i_extend_factor;
@@ -137,6 +152,98 @@ static int GetSwsCpuMask(void);
 /* XXX is it always 3 even for BIG_ENDIAN (blend.c seems to think so) ? */
 #define OFFSET_A (3)
 
+/* Idle scaling contexts kept for all the scalers of the process */
+#define CACHE_SIZE (32)
+/* Stripes start on multiples of this many lines, so that they do not cut
+ * the subsampled chroma planes or the dithering patterns */
+#define STRIPE_LINES (8)
+
+/*****************************************************************************
+ * Context cache
+ *****************************************************************************
+ * Creating a context computes all its filter coefficients, which is slow for
+ * the big pictures. The contexts released by the scalers are kept, the least
+ * recently used first, for the scalers that need the same parameters: the
+ * scalers of a mosaic or of the renditions of a stream, the stripes of a
+ * picture, or a scaler going back to a previous format. A context is only
+ * used by one scaler at a time.
+ *****************************************************************************/
+static struct
+{
+    vlc_mutex_t lock;
+    unsigned    i_users;
+    unsigned    i_count;
+    struct
+    {
+        ScalerKey key;
+        struct SwsContext *ctx;
+    } entries[CACHE_SIZE];
+} cache = { .lock = VLC_STATIC_MUTEX };
+
+static void CacheHold( void )
+{
+    vlc_mutex_lock( &cache.lock );
+    cache.i_users++;
+    vlc_mutex_unlock( &cache.lock );
+}
+
+static void CacheRelease( void )
+{
+    vlc_mutex_lock( &cache.lock );
+    assert( cache.i_users > 0 );
+    if( --cache.i_users == 0 )
+    {
+        for( unsigned i = 0; i < cache.i_count; i++ )
+            sws_freeContext( cache.entries[i].ctx );
+        cache.i_count = 0;
+    }
+    vlc_mutex_unlock( &cache.lock );
+}
+
+static struct SwsContext *GetContext( const ScalerKey *p_key )
+{
+    vlc_mutex_lock( &cache.lock );
+    for( unsigned i = cache.i_count; i-- > 0; )
+    {
+        if( memcmp( &cache.entries[i].key, p_key, sizeof(*p_key) ) )
+            continue;
+
+        struct SwsContext *ctx = cache.entries[i].ctx;
+        cache.i_count--;
+        memmove( &cache.entries[i], &cache.entries[i + 1],
+                 (cache.i_count - i) * sizeof(cache.entries[0]) );
+        vlc_mutex_unlock( &cache.lock );
+        return ctx;
+    }
+    vlc_mutex_unlock( &cache.lock );
+
+    return sws_getContext( p_key->i_src_width, p_key->i_src_height,
+                           p_key->i_src_fmt,
+                           p_key->i_dst_width, p_key->i_dst_height,
+                           p_key->i_dst_fmt, p_key->i_flags, NULL, NULL, 0 );
+}
+
+static void ReleaseContext( const ScalerKey *p_key, struct SwsContext *ctx )
+{
+    struct SwsContext *p_old = NULL;
+
+    vlc_mutex_lock( &cache.lock );
+    if( cache.i_count == CACHE_SIZE )
+    {
+        p_old = cache.entries[0].ctx;
+        cache.i_count--;
+        memmove( &cache.entries[0], &cache.entries[1],
+                 cache.i_count * sizeof(cache.entries[0]) );
+    }
+    cache.entries[cache.i_count].key = *p_key;
+    cache.entries[cache.i_count].ctx = ctx;
+    cache.i_count++;
+    vlc_mutex_unlock( &cache.lock );
+
+    if( p_old )
+        sws_freeContext( p_old );
+}
+
 /*****************************************************************************
  * OpenScaler: probe the filter and return score
  *****************************************************************************/
@@ -157,6 +264,7 @@ static int OpenScaler( vlc_object_t *p_this )
     /* Allocate the memory needed to store the decoder's structure */
     if( ( p_filter->p_sys = p_sys = malloc(sizeof(filter_sys_t)) ) == NULL )
         return VLC_ENOMEM;
+    CacheHold();
 
     /* Set CPU capabilities */
     p_sys->i_cpu_mask = GetSwsCpuMask();
@@ -196,9 +304,12 @@ static int OpenScaler( vlc_object_t *p_this )
     {
         if( p_sys->p_src_filter )
             sws_freeFilter( p_sys->p_src_filter );
+        CacheRelease();
         free( p_sys );
         return VLC_EGENERIC;
     }
+    /* Big pictures are converted on the threads of the filter chains */
+    p_filter->b_slices = p_sys->b_stripes;
 
     msg_Dbg( p_filter, "%ix%i chroma: %4.4s -> %ix%i chroma: %4.4s with scaling using %s",
              p_filter->fmt_in.video.i_width, p_filter->fmt_in.video.i_height,
@@ -221,6 +332,7 @@ static void CloseScaler( vlc_object_t *p_this )
     Clean( p_filter );
     if( p_sys->p_src_filter )
         sws_freeFilter( p_sys->p_src_filter );
+    CacheRelease();
     free( p_sys );
 }
 
@@ -341,6 +453,15 @@ static int GetParameters( ScalerConfiguration *p_cfg,
     return VLC_SUCCESS;
 }
 
+/* Largest vertical subsampling of the planes */
+static int GetStripeDivider( const vlc_chroma_description_t *p_dsc )
+{
+    int i_div = 1;
+    for( unsigned i = 0; i < p_dsc->plane_count; i++ )
+        i_div = __MAX( i_div, (int)(p_dsc->p[i].h.den / p_dsc->p[i].h.num) );
+    return i_div;
+}
+
 static int Init( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -377,14 +498,17 @@ static int Init( filter_t *p_filter )
     const unsigned i_fmto_width = p_fmto->i_width * p_sys->i_extend_factor;
     for( int n = 0; n < (cfg.b_has_a ? 2 : 1); n++ )
     {
-        const int i_fmti = n == 0 ? cfg.i_fmti : PIX_FMT_GRAY8;
-        const int i_fmto = n == 0 ? cfg.i_fmto : PIX_FMT_GRAY8;
-        struct SwsContext *ctx;
+        ScalerKey *p_key = n == 0 ? &p_sys->key : &p_sys->keyA;
+
+        p_key->i_src_width  = i_fmti_width;
+        p_key->i_src_height = p_fmti->i_height;
+        p_key->i_src_fmt    = n == 0 ? cfg.i_fmti : PIX_FMT_GRAY8;
+        p_key->i_dst_width  = i_fmto_width;
+        p_key->i_dst_height = p_fmto->i_height;
+        p_key->i_dst_fmt    = n == 0 ? cfg.i_fmto : PIX_FMT_GRAY8;
+        p_key->i_flags      = cfg.i_sws_flags | p_sys->i_cpu_mask;
 
-        ctx = sws_getContext( i_fmti_width, p_fmti->i_height, i_fmti,
-                              i_fmto_width, p_fmto->i_height, i_fmto,
-                              cfg.i_sws_flags | p_sys->i_cpu_mask,
-                              p_sys->p_src_filter, p_sys->p_dst_filter, 0 );
+        struct SwsContext *ctx = GetContext( p_key );
         if( n == 0 )
             p_sys->ctx = ctx;
         else
@@ -422,6 +546,18 @@ static int Init( filter_t *p_filter )
     p_sys->b_swap_uvi = cfg.b_swap_uvi;
     p_sys->b_swap_uvo = cfg.b_swap_uvo;
 
+    /* Without vertical scaling, each line of the output only depends on the
+     * same line of the input, and stripes give the same pixels as the whole
+     * picture. The chroma planes must not need a vertical filter either. */
+    p_sys->p_dsc_in  = vlc_fourcc_GetChromaDescription( p_fmti->i_chroma );
+    p_sys->p_dsc_out = vlc_fourcc_GetChromaDescription( p_fmto->i_chroma );
+    p_sys->b_stripes = !cfg.b_copy && p_sys->i_extend_factor == 1 &&
+                       p_fmti->i_height == p_fmto->i_height &&
+                       p_sys->p_dsc_in && p_sys->p_dsc_out &&
+                       GetStripeDivider( p_sys->p_dsc_in ) ==
+                       GetStripeDivider( p_sys->p_dsc_out ) &&
+                       STRIPE_LINES % GetStripeDivider( p_sys->p_dsc_in ) == 0;
+
     video_format_ScaleCropAr( p_fmto, p_fmti );
 #if 0
     msg_Dbg( p_filter, "%ix%i chroma: %4.4s -> %ix%i chroma: %4.4s extend by %d",
@@ -446,10 +582,10 @@ static void Clean( filter_t *p_filter )
         picture_Release( p_sys->p_dst_a );
 
     if( p_sys->ctxA )
-        sws_freeContext( p_sys->ctxA );
+        ReleaseContext( &p_sys->keyA, p_sys->ctxA );
 
     if( p_sys->ctx )
-        sws_freeContext( p_sys->ctx );
+        ReleaseContext( &p_sys->key, p_sys->ctx );
 
     /* We have to set it to null has we call be called again :( */
     p_sys->ctx = NULL;
@@ -560,6 +696,63 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
 #endif
 }
 
+typedef struct
+{
+    picture_t *p_dst;
+    picture_t *p_src;
+    int       i_rows;
+} ScalerStripes;
+
+static void GetStripe( picture_t *p_stripe, const picture_t *p_pic,
+                       const vlc_chroma_description_t *p_dsc,
+                       int i_line, int i_lines )
+{
+    *p_stripe = *p_pic;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const unsigned i_num = p_dsc->p[i].h.num, i_den = p_dsc->p[i].h.den;
+        const int i_first = i_line * i_num / i_den;
+        const int i_count = (i_lines * i_num + i_den - 1) / i_den;
+
+        p_stripe->p[i].p_pixels        = &p_pic->p[i].p_pixels[i_first * p_pic->p[i].i_pitch];
+        p_stripe->p[i].i_lines         = i_count;
+        p_stripe->p[i].i_visible_lines = i_count;
+    }
+}
+
+/* Converts the lines [i_start, i_end) * STRIPE_LINES, with a context of the
+ * height of the stripe */
+static void ConvertStripe( filter_t *p_filter, void *p_data,
+                           int i_start, int i_end )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    ScalerStripes *p_job = p_data;
+    const int i_height = p_filter->fmt_in.video.i_height;
+    const int i_line = i_start * STRIPE_LINES;
+    const int i_lines = (i_end == p_job->i_rows ? i_height
+                                                : i_end * STRIPE_LINES) - i_line;
+
+    if( i_lines == i_height )
+    {
+        Convert( p_filter, p_sys->ctx, p_job->p_dst, p_job->p_src, i_height,
+                 0, 3, p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+        return;
+    }
+
+    ScalerKey key = p_sys->key;
+    key.i_src_height = key.i_dst_height = i_lines;
+    struct SwsContext *ctx = GetContext( &key );
+    if( ctx == NULL )
+        return;
+
+    picture_t src, dst;
+    GetStripe( &src, p_job->p_src, p_sys->p_dsc_in, i_line, i_lines );
+    GetStripe( &dst, p_job->p_dst, p_sys->p_dsc_out, i_line, i_lines );
+    Convert( p_filter, ctx, &dst, &src, i_lines, 0, 3,
+             p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+    ReleaseContext( &key, ctx );
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************
@@ -602,6 +795,14 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         picture_CopyPixels( p_dst, p_src );
     else if( p_sys->b_copy )
         SwapUV( p_dst, p_src );
+    else if( p_sys->b_stripes )
+    {
+        ScalerStripes job = {
+            .p_dst = p_dst, .p_src = p_src,
+            .i_rows = p_fmti->i_height / STRIPE_LINES,
+        };
+        filter_RunSlices( p_filter, ConvertStripe, &job, job.i_rows );
+    }
     else
         Convert( p_filter, p_sys->ctx, p_dst, p_src, p_fmti->i_height, 0, 3,
                  p_sys->b_swap_uvi, p_sys->b_swap_uvo );
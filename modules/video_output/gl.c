@@ -43,6 +43,9 @@ static void Close (vlc_object_t *);
 #define PROVIDER_LONGTEXT N_( \
     "Extension through which to use the Open Graphics Library (OpenGL).")
 
+static const char *const deinterlace_values[] = GL_DEINTERLACE_VALUES;
+static const char *const deinterlace_texts[] = GL_DEINTERLACE_TEXTS;
+
 vlc_module_begin ()
 #if USE_OPENGL_ES == 2
 # define API VLC_OPENGL_ES2
@@ -78,6 +81,9 @@ vlc_module_begin ()
     add_module ("gl", "opengl", NULL,
                 GL_TEXT, PROVIDER_LONGTEXT, true)
 #endif
+    add_string ("gl-deinterlace", "off",
+                GL_DEINTERLACE_TEXT, GL_DEINTERLACE_LONGTEXT, true)
+        change_string_list (deinterlace_values, deinterlace_texts)
 vlc_module_end ()
 
 struct vout_display_sys_t
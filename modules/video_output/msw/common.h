@@ -139,6 +139,16 @@ struct vout_display_sys_t
     D3DCAPS9                d3dcaps;
     LPDIRECT3DDEVICE9       d3ddev;
     D3DPRESENT_PARAMETERS   d3dpp;
+    bool                    use_d3d9ex;      /* d3dobj/d3ddev are Ex */
+    // render targets shared by the decoder of the opaque pictures
+    bool                    use_opaque;
+    struct {
+        HANDLE             handle;
+        unsigned           width;
+        unsigned           height;
+        LPDIRECT3DSURFACE9 surface;
+    } shared[2];
+    unsigned                shared_index;
     // scene objects
     LPDIRECT3DTEXTURE9      d3dtex;
     LPDIRECT3DVERTEXBUFFER9 d3dvtc;
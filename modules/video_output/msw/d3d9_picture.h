@@ -0,0 +1,51 @@
+/*****************************************************************************
+ * d3d9_picture.h: Direct3D9 opaque pictures
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_D3D9_PICTURE_H
+#define VLC_D3D9_PICTURE_H 1
+
+#include <vlc_picture.h>
+#include <d3d9.h>
+
+/**
+ * Context of the VLC_CODEC_D3D9_OPAQUE pictures.
+ *
+ * The pixels stay in a surface of the device of the decoder. They are handed
+ * to other Direct3D9Ex devices through a shared X8R8G8B8 render target.
+ */
+typedef struct vlc_d3d9_picture_t vlc_d3d9_picture_t;
+
+struct vlc_d3d9_picture_t
+{
+    picture_context_t context;
+
+    /* Size of the shared render target */
+    unsigned width;
+    unsigned height;
+
+    /**
+     * Draws the picture into a shared render target and returns its handle.
+     * The same target may be returned again two calls later, the caller
+     * must have copied it by then.
+     */
+    int (*render)(vlc_d3d9_picture_t *, HANDLE *shared);
+};
+
+#endif
@@ -45,6 +45,7 @@
 #include <d3d9.h>
 
 #include "common.h"
+#include "d3d9_picture.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -255,6 +256,8 @@ static picture_pool_t *Pool(vout_display_t *vd, unsigned count)
 static int  Direct3DLockSurface(picture_t *);
 static void Direct3DUnlockSurface(picture_t *);
 
+static LPDIRECT3DSURFACE9 Direct3DGetSharedSurface(vout_display_t *, picture_t *);
+
 static void Prepare(vout_display_t *vd, picture_t *picture, subpicture_t *subpicture)
 {
     vout_display_sys_t *sys = vd->sys;
@@ -269,7 +272,8 @@ static void Prepare(vout_display_t *vd, picture_t *picture, subpicture_t *subpic
      * the vout doesn't keep a reference). But because of the vout
      * wrapper, we can't */
 
-    Direct3DUnlockSurface(picture);
+    if (!sys->use_opaque)
+        Direct3DUnlockSurface(picture);
     VLC_UNUSED(subpicture);
 #endif
 
@@ -283,6 +287,10 @@ static void Prepare(vout_display_t *vd, picture_t *picture, subpicture_t *subpic
         return;
     }
 
+    /* The decoder draws the opaque pictures into a surface we can read */
+    if (sys->use_opaque)
+        surface = Direct3DGetSharedSurface(vd, picture);
+
     d3d_region_t picture_region;
     if (!Direct3DImportPicture(vd, &picture_region, surface)) {
         int subpicture_region_count     = 0;
@@ -319,7 +327,8 @@ static void Display(vout_display_t *vd, picture_t *picture, subpicture_t *subpic
     VLC_UNUSED(subpicture);
 #else
     /* XXX See Prepare() */
-    Direct3DLockSurface(picture);
+    if (!sys->use_opaque)
+        Direct3DLockSurface(picture);
     picture_Release(picture);
 #endif
     if (subpicture)
@@ -490,8 +499,25 @@ static int Direct3DCreate(vout_display_t *vd)
         return VLC_EGENERIC;
     }
 
+    /* Opaque pictures are shared with the decoder: it needs Direct3D9Ex */
+    LPDIRECT3D9 d3dobj = NULL;
+    sys->use_d3d9ex = false;
+    if (vd->fmt.i_chroma == VLC_CODEC_D3D9_OPAQUE) {
+        HRESULT (WINAPI *OurDirect3DCreate9Ex)(UINT SDKVersion, IDirect3D9Ex **);
+        OurDirect3DCreate9Ex =
+            (void *)GetProcAddress(sys->hd3d9_dll, "Direct3DCreate9Ex");
+
+        IDirect3D9Ex *d3dobjex;
+        if (OurDirect3DCreate9Ex &&
+            SUCCEEDED(OurDirect3DCreate9Ex(D3D_SDK_VERSION, &d3dobjex))) {
+            d3dobj = (LPDIRECT3D9)d3dobjex;
+            sys->use_d3d9ex = true;
+        }
+    }
+
     /* Create the D3D object. */
-    LPDIRECT3D9 d3dobj = OurDirect3DCreate9(D3D_SDK_VERSION);
+    if (!d3dobj)
+        d3dobj = OurDirect3DCreate9(D3D_SDK_VERSION);
     if (!d3dobj) {
        msg_Err(vd, "Could not create Direct3D9 instance.");
        return VLC_EGENERIC;
@@ -627,11 +653,21 @@ static int Direct3DOpen(vout_display_t *vd, video_format_t *fmt)
                 d3dai.VendorId, d3dai.DeviceId, d3dai.Revision );
     }
 
-    HRESULT hr = IDirect3D9_CreateDevice(d3dobj, AdapterToUse,
+    HRESULT hr;
+    if (sys->use_d3d9ex) {
+        IDirect3DDevice9Ex *d3ddevex;
+        hr = IDirect3D9Ex_CreateDeviceEx((IDirect3D9Ex *)d3dobj, AdapterToUse,
                                          DeviceType, sys->hvideownd,
                                          D3DCREATE_SOFTWARE_VERTEXPROCESSING|
                                          D3DCREATE_MULTITHREADED,
-                                         &sys->d3dpp, &d3ddev);
+                                         &sys->d3dpp, NULL, &d3ddevex);
+        d3ddev = (LPDIRECT3DDEVICE9)d3ddevex;
+    } else
+        hr = IDirect3D9_CreateDevice(d3dobj, AdapterToUse,
+                                     DeviceType, sys->hvideownd,
+                                     D3DCREATE_SOFTWARE_VERTEXPROCESSING|
+                                     D3DCREATE_MULTITHREADED,
+                                     &sys->d3dpp, &d3ddev);
     if (FAILED(hr)) {
        msg_Err(vd, "Could not create the D3D device! (hr=0x%lX)", hr);
        return VLC_EGENERIC;
@@ -868,6 +904,38 @@ static void Direct3DUnlockSurface(picture_t *picture)
     }
 }
 
+/**
+ * It creates the pool of opaque picture (only 1).
+ */
+static int Direct3DCreateOpaquePool(vout_display_t *vd, video_format_t *fmt)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    picture_resource_t *rsc = &sys->resource;
+    memset(rsc, 0, sizeof(*rsc));
+    rsc->p_sys = malloc(sizeof(*rsc->p_sys));
+    if (!rsc->p_sys)
+        return VLC_ENOMEM;
+    rsc->p_sys->surface = NULL;
+    rsc->p_sys->fallback = NULL;
+
+    picture_t *picture = picture_NewFromResource(fmt, rsc);
+    if (!picture) {
+        free(rsc->p_sys);
+        return VLC_ENOMEM;
+    }
+    sys->pool = picture_pool_New(1, &picture);
+    if (!sys->pool) {
+        picture_Release(picture);
+        return VLC_ENOMEM;
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(sys->shared); i++)
+        sys->shared[i].surface = NULL;
+    sys->shared_index = 0;
+    sys->use_opaque = true;
+    return VLC_SUCCESS;
+}
+
 /**
  * It creates the pool of picture (only 1).
  *
@@ -884,6 +952,16 @@ static int Direct3DCreatePool(vout_display_t *vd, video_format_t *fmt)
     /* */
     *fmt = vd->source;
 
+    /* Opaque pictures have no surface of their own, they are drawn by their
+     * decoder into a shared render target */
+    sys->use_opaque = false;
+    if (fmt->i_chroma == VLC_CODEC_D3D9_OPAQUE) {
+        if (sys->use_d3d9ex)
+            return Direct3DCreateOpaquePool(vd, fmt);
+        /* The decoder converts them for us */
+        fmt->i_chroma = VLC_CODEC_YV12;
+    }
+
     /* Find the appropriate D3DFORMAT for the render chroma, the format will be the closest to
      * the requested chroma which is usable by the hardware in an offscreen surface, as they
      * typically support more formats than textures */
@@ -960,9 +1038,17 @@ static void Direct3DDestroyPool(vout_display_t *vd)
 {
     vout_display_sys_t *sys = vd->sys;
 
+    if (sys->use_opaque) {
+        for (unsigned i = 0; i < ARRAY_SIZE(sys->shared); i++) {
+            if (sys->shared[i].surface)
+                IDirect3DSurface9_Release(sys->shared[i].surface);
+            sys->shared[i].surface = NULL;
+        }
+    }
     if (sys->pool) {
         picture_resource_t *rsc = &sys->resource;
-        IDirect3DSurface9_Release(rsc->p_sys->surface);
+        if (rsc->p_sys->surface)
+            IDirect3DSurface9_Release(rsc->p_sys->surface);
         if (rsc->p_sys->fallback)
             picture_Release(rsc->p_sys->fallback);
         picture_pool_Delete(sys->pool);
@@ -970,6 +1056,55 @@ static void Direct3DDestroyPool(vout_display_t *vd)
     sys->pool = NULL;
 }
 
+/**
+ * It opens the render target into which the decoder of an opaque picture
+ * has drawn it.
+ */
+static LPDIRECT3DSURFACE9 Direct3DGetSharedSurface(vout_display_t *vd,
+                                                   picture_t *picture)
+{
+    vout_display_sys_t *sys = vd->sys;
+    vlc_d3d9_picture_t *d3dpic = (vlc_d3d9_picture_t *)picture->context;
+    HANDLE handle;
+
+    if (!d3dpic || d3dpic->render(d3dpic, &handle))
+        return NULL;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(sys->shared); i++) {
+        if (sys->shared[i].surface &&
+            sys->shared[i].handle == handle &&
+            sys->shared[i].width  == d3dpic->width &&
+            sys->shared[i].height == d3dpic->height)
+            return sys->shared[i].surface;
+    }
+
+    /* Replace the oldest one */
+    const unsigned index = sys->shared_index;
+    sys->shared_index = (index + 1) % ARRAY_SIZE(sys->shared);
+    if (sys->shared[index].surface)
+        IDirect3DSurface9_Release(sys->shared[index].surface);
+    sys->shared[index].surface = NULL;
+
+    LPDIRECT3DSURFACE9 surface;
+    HANDLE shared = handle;
+    HRESULT hr = IDirect3DDevice9_CreateRenderTarget(sys->d3ddev,
+                                                     d3dpic->width,
+                                                     d3dpic->height,
+                                                     D3DFMT_X8R8G8B8,
+                                                     D3DMULTISAMPLE_NONE,
+                                                     0, FALSE,
+                                                     &surface, &shared);
+    if (FAILED(hr)) {
+        msg_Err(vd, "Failed to open the shared surface. (hr=0x%lX)", hr);
+        return NULL;
+    }
+    sys->shared[index].handle  = handle;
+    sys->shared[index].width   = d3dpic->width;
+    sys->shared[index].height  = d3dpic->height;
+    sys->shared[index].surface = surface;
+    return surface;
+}
+
 /**
  * It allocates and initializes the resources needed to render the scene.
  */
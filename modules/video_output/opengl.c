@@ -87,6 +87,17 @@
 #   define SUPPORTS_FIXED_PIPELINE
 #endif
 
+/* Pictures allocated in persistently mapped pixel buffers, so that the
+ * decoders write in GPU visible memory and the texture uploads are
+ * asynchronous */
+#if !USE_OPENGL_ES && !defined(__APPLE__) && defined(GL_MAP_PERSISTENT_BIT)
+#   define SUPPORTS_PBO
+struct picture_sys_t {
+    GLuint  buffer;
+    uint8_t *base;
+};
+#endif
+
 static const vlc_fourcc_t gl_subpicture_chromas[] = {
     VLC_CODEC_RGBA,
     0
@@ -94,6 +105,10 @@ static const vlc_fourcc_t gl_subpicture_chromas[] = {
 
 typedef struct {
     GLuint   texture;
+    /* Held picture and offset of the texture content, to skip unchanged
+     * uploads as the SPU core keeps the same picture for unchanged regions */
+    picture_t *picture;
+    int      pixels_offset;
     unsigned format;
     unsigned type;
     unsigned width;
@@ -115,12 +130,24 @@ struct vout_display_opengl_t {
     const vlc_chroma_description_t *chroma;
 
     int        tex_target;
-    int        tex_format;
-    int        tex_internal;
+    int        tex_format[PICTURE_PLANE_MAX];
+    int        tex_internal[PICTURE_PLANE_MAX];
     int        tex_type;
+    /* Number of pixels of the plane stored in one texel (2 for the
+     * interleaved chroma of NV12 and for packed 4:2:2) */
+    unsigned   tex_pixels[PICTURE_PLANE_MAX];
+    /* Packed 4:2:2: the two luma samples of a texel must not be blended */
+    bool       tex_packed;
 
     int        tex_width[PICTURE_PLANE_MAX];
     int        tex_height[PICTURE_PLANE_MAX];
+    /* Texture sizes and their inverses, for the fragment shader */
+    GLfloat    tex_size[4 * 3];
+
+    /* GPU deinterlacing mode, and parity of the lines to rebuild in the
+     * last prepared picture (-1 if it is progressive) */
+    int        deinterlace;
+    int        field;
 
     GLuint     texture[VLCGL_TEXTURE_COUNT][PICTURE_PLANE_MAX];
 
@@ -173,6 +200,27 @@ struct vout_display_opengl_t {
 
     /* Non-power-of-2 texture size support */
     bool supports_npot;
+
+    /* Pictures drawn into the texture by their decoder (vlc_gl_picture_t) */
+    bool use_opaque;
+
+#ifdef SUPPORTS_PBO
+    /* Pixel buffer objects */
+    bool use_pbo;
+    PFNGLGENBUFFERSPROC       GenBuffers;
+    PFNGLBINDBUFFERPROC       BindBuffer;
+    PFNGLBUFFERSTORAGEPROC    BufferStorage;
+    PFNGLMAPBUFFERRANGEPROC   MapBufferRange;
+    PFNGLDELETEBUFFERSPROC    DeleteBuffers;
+    PFNGLFENCESYNCPROC        FenceSync;
+    PFNGLCLIENTWAITSYNCPROC   ClientWaitSync;
+    PFNGLDELETESYNCPROC       DeleteSync;
+
+    unsigned      pbo_count;
+    picture_sys_t *pbo[VLCGL_PICTURE_MAX];
+    /* Completion of the uploads of the last prepared picture */
+    GLsync        pbo_fence;
+#endif
 };
 
 static inline int GetAlignedSize(unsigned size)
@@ -248,7 +296,10 @@ static void BuildYUVFragmentShader(vout_display_opengl_t *vgl,
     const float (*matrix) = fmt->i_height > 576 ? matrix_bt709_tv2full
                                                 : matrix_bt601_tv2full;
 
-    /* Basic linear YUV -> RGB conversion using bilinear interpolation */
+    /* Basic linear YUV -> RGB conversion using bilinear interpolation.
+     * Fetch() rebuilds the lines of the missing field of interlaced
+     * pictures, Field.x enables it and Field.y is the parity of the lines
+     * to rebuild. TexSize[] holds the texture sizes and their inverses. */
     const char *template_glsl_yuv =
         "#version " GLSL_VERSION "\n"
         PRECISION
@@ -256,27 +307,105 @@ static void BuildYUVFragmentShader(vout_display_opengl_t *vgl,
         "uniform sampler2D Texture1;"
         "uniform sampler2D Texture2;"
         "uniform vec4      Coefficient[4];"
+        "uniform vec4      TexSize[3];"
+        "uniform vec4      Field;"
         "varying vec4      TexCoord0,TexCoord1,TexCoord2;"
 
+        "vec4 Fetch(sampler2D t, vec2 c, vec4 size) {"
+        " float line = floor(c.t * size.y);"
+        " if (Field.x == 0.0 || mod(line, 2.0) != Field.y)"
+        "  return texture2D(t, c);"
+        " vec2 up   = vec2(c.s, (line - 0.5) * size.w);"
+        " vec2 down = vec2(c.s, (line + 1.5) * size.w);"
+        " %s"
+        "}"
+
         "void main(void) {"
         " vec4 x,y,z,result;"
-        " x  = texture2D(Texture0, TexCoord0.st);"
-        " %c = texture2D(Texture1, TexCoord1.st);"
-        " %c = texture2D(Texture2, TexCoord2.st);"
+        " %s"
 
         " result = x * Coefficient[0] + Coefficient[3];"
         " result = (y * Coefficient[1]) + result;"
         " result = (z * Coefficient[2]) + result;"
         " gl_FragColor = result;"
         "}";
-    bool swap_uv = fmt->i_chroma == VLC_CODEC_YV12 ||
-                   fmt->i_chroma == VLC_CODEC_YV9;
+
+    /* Rebuilding of a missing line from its neighbours */
+    static const char *const deinterlace_glsl[] = {
+        /* off */
+        "return texture2D(t, c);",
+        /* bob: the line of the kept field above (below for the first one) */
+        "if (line == 0.0) return texture2D(t, down);"
+        "return texture2D(t, up);",
+        /* linear: the average of the lines above and below */
+        "return mix(texture2D(t, up), texture2D(t, down), 0.5);",
+        /* edge: the average along the direction of least difference, this
+         * is the spatial interpolation of yadif */
+        "vec2 dx = vec2(size.z, 0.0);"
+        "vec4 a0 = texture2D(t, up - dx), a1 = texture2D(t, up),"
+        "     a2 = texture2D(t, up + dx);"
+        "vec4 b0 = texture2D(t, down - dx), b1 = texture2D(t, down),"
+        "     b2 = texture2D(t, down + dx);"
+        "float d0 = abs(a0.r - b2.r), d1 = abs(a1.r - b1.r),"
+        "      d2 = abs(a2.r - b0.r);"
+        "if (d0 < d1 && d0 <= d2) return mix(a0, b2, 0.5);"
+        "if (d2 < d1) return mix(a2, b0, 0.5);"
+        "return mix(a1, b1, 0.5);",
+    };
+
+    /* Sampling of the Y, U and V components */
+    char *fetch;
+    int ret;
+    switch (fmt->i_chroma) {
+    case VLC_CODEC_NV12:
+    case VLC_CODEC_NV21: {
+        /* The chroma plane is a luminance-alpha texture */
+        bool swap_uv = fmt->i_chroma == VLC_CODEC_NV21;
+        ret = asprintf(&fetch,
+            "x = Fetch(Texture0, TexCoord0.st, TexSize[0]);"
+            "vec4 uv = Fetch(Texture1, TexCoord1.st, TexSize[1]);"
+            "y = vec4(uv.%c); z = vec4(uv.%c);",
+            swap_uv ? 'a' : 'r', swap_uv ? 'r' : 'a');
+        break;
+    }
+    case VLC_CODEC_YUYV:
+    case VLC_CODEC_YVYU:
+    case VLC_CODEC_UYVY:
+    case VLC_CODEC_VYUY: {
+        /* Each RGBA texel holds two pixels: the left one uses the first
+         * luma sample, the right one the second */
+        const char *order;
+        switch (fmt->i_chroma) {
+            case VLC_CODEC_YUYV: order = "rbga"; break;
+            case VLC_CODEC_YVYU: order = "rbag"; break;
+            case VLC_CODEC_UYVY: order = "garb"; break;
+            default:             order = "gabr"; break;
+        }
+        ret = asprintf(&fetch,
+            "vec4 p = Fetch(Texture0, TexCoord0.st, TexSize[0]);"
+            "x = vec4(fract(TexCoord0.s * TexSize[0].x) < 0.5 ? p.%c : p.%c);"
+            "y = vec4(p.%c); z = vec4(p.%c);",
+            order[0], order[1], order[2], order[3]);
+        break;
+    }
+    default: {
+        bool swap_uv = fmt->i_chroma == VLC_CODEC_YV12 ||
+                       fmt->i_chroma == VLC_CODEC_YV9;
+        ret = asprintf(&fetch,
+            "x  = Fetch(Texture0, TexCoord0.st, TexSize[0]);"
+            "%c = Fetch(Texture1, TexCoord1.st, TexSize[1]);"
+            "%c = Fetch(Texture2, TexCoord2.st, TexSize[2]);",
+            swap_uv ? 'z' : 'y', swap_uv ? 'y' : 'z');
+        break;
+    }
+    }
 
     char *code;
-    if (asprintf(&code, template_glsl_yuv,
-                 swap_uv ? 'z' : 'y',
-                 swap_uv ? 'y' : 'z') < 0)
+    if (ret < 0 || asprintf(&code, template_glsl_yuv,
+                            deinterlace_glsl[vgl->deinterlace], fetch) < 0)
         code = NULL;
+    if (ret >= 0)
+        free(fetch);
 
     for (int i = 0; i < 4; i++) {
         float correction = i < 3 ? yuv_range_correction : 1.0;
@@ -420,6 +549,23 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
         supports_shaders = false;
 #endif
 
+#ifdef SUPPORTS_PBO
+    vgl->GenBuffers     = (PFNGLGENBUFFERSPROC)vlc_gl_GetProcAddress(vgl->gl, "glGenBuffers");
+    vgl->BindBuffer     = (PFNGLBINDBUFFERPROC)vlc_gl_GetProcAddress(vgl->gl, "glBindBuffer");
+    vgl->BufferStorage  = (PFNGLBUFFERSTORAGEPROC)vlc_gl_GetProcAddress(vgl->gl, "glBufferStorage");
+    vgl->MapBufferRange = (PFNGLMAPBUFFERRANGEPROC)vlc_gl_GetProcAddress(vgl->gl, "glMapBufferRange");
+    vgl->DeleteBuffers  = (PFNGLDELETEBUFFERSPROC)vlc_gl_GetProcAddress(vgl->gl, "glDeleteBuffers");
+    vgl->FenceSync      = (PFNGLFENCESYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glFenceSync");
+    vgl->ClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glClientWaitSync");
+    vgl->DeleteSync     = (PFNGLDELETESYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glDeleteSync");
+
+    vgl->use_pbo = HasExtension(extensions, "GL_ARB_buffer_storage") &&
+                   HasExtension(extensions, "GL_ARB_sync") &&
+                   vgl->GenBuffers && vgl->BindBuffer && vgl->BufferStorage &&
+                   vgl->MapBufferRange && vgl->DeleteBuffers &&
+                   vgl->FenceSync && vgl->ClientWaitSync && vgl->DeleteSync;
+#endif
+
     vgl->supports_npot = HasExtension(extensions, "GL_ARB_texture_non_power_of_two") ||
                          HasExtension(extensions, "GL_APPLE_texture_2D_limited_npot");
 
@@ -454,9 +600,26 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
     vgl->fmt.i_bmask  = 0x00ff0000;
 #   endif
     vgl->tex_target   = GL_TEXTURE_2D;
-    vgl->tex_format   = GL_RGBA;
-    vgl->tex_internal = GL_RGBA;
+    for (unsigned j = 0; j < PICTURE_PLANE_MAX; j++) {
+        vgl->tex_format[j]   = GL_RGBA;
+        vgl->tex_internal[j] = GL_RGBA;
+        vgl->tex_pixels[j]   = 1;
+    }
     vgl->tex_type     = GL_UNSIGNED_BYTE;
+    vgl->tex_packed   = false;
+    vgl->use_opaque   = false;
+#if !USE_OPENGL_ES
+    /* Keep the hardware surfaces of the decoder, they are drawn into an
+     * RGBA texture of the picture size */
+    if (fmt->i_chroma == VLC_CODEC_VAAPI_OPAQUE && vgl->supports_npot) {
+        vgl->use_opaque = true;
+        vgl->fmt        = *fmt;
+#ifdef SUPPORTS_PBO
+        vgl->use_pbo    = false;
+#endif
+    }
+#endif
+
     /* Use YUV if possible and needed */
     bool need_fs_yuv = false;
     float yuv_range_correction = 1.0;
@@ -469,8 +632,10 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
                 need_fs_yuv       = true;
                 vgl->fmt          = *fmt;
                 vgl->fmt.i_chroma = *list;
-                vgl->tex_format   = GL_LUMINANCE;
-                vgl->tex_internal = GL_LUMINANCE;
+                for (unsigned j = 0; j < 3; j++) {
+                    vgl->tex_format[j]   = GL_LUMINANCE;
+                    vgl->tex_internal[j] = GL_LUMINANCE;
+                }
                 vgl->tex_type     = GL_UNSIGNED_BYTE;
                 yuv_range_correction = 1.0;
                 break;
@@ -480,23 +645,54 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
                 need_fs_yuv       = true;
                 vgl->fmt          = *fmt;
                 vgl->fmt.i_chroma = *list;
-                vgl->tex_format   = GL_LUMINANCE;
-                vgl->tex_internal = GL_LUMINANCE16;
+                for (unsigned j = 0; j < 3; j++) {
+                    vgl->tex_format[j]   = GL_LUMINANCE;
+                    vgl->tex_internal[j] = GL_LUMINANCE16;
+                }
                 vgl->tex_type     = GL_UNSIGNED_SHORT;
                 yuv_range_correction = (float)((1 << 16) - 1) / ((1 << dsc->pixel_bits) - 1);
                 break;
 #endif
+            } else if (*list == VLC_CODEC_NV12 || *list == VLC_CODEC_NV21) {
+                /* The interleaved chroma is uploaded as is, U in the
+                 * luminance and V in the alpha of the texels */
+                need_fs_yuv       = true;
+                vgl->fmt          = *fmt;
+                vgl->fmt.i_chroma = *list;
+                vgl->tex_format[0]   = GL_LUMINANCE;
+                vgl->tex_internal[0] = GL_LUMINANCE;
+                vgl->tex_format[1]   = GL_LUMINANCE_ALPHA;
+                vgl->tex_internal[1] = GL_LUMINANCE_ALPHA;
+                vgl->tex_pixels[1]   = 2;
+                vgl->tex_type     = GL_UNSIGNED_BYTE;
+                yuv_range_correction = 1.0;
+                break;
+            } else if (*list == VLC_CODEC_YUYV || *list == VLC_CODEC_YVYU ||
+                       *list == VLC_CODEC_UYVY || *list == VLC_CODEC_VYUY) {
+                /* One RGBA texel per pair of pixels */
+                need_fs_yuv       = true;
+                vgl->fmt          = *fmt;
+                vgl->fmt.i_chroma = *list;
+                vgl->tex_format[0]   = GL_RGBA;
+                vgl->tex_internal[0] = GL_RGBA;
+                vgl->tex_pixels[0]   = 2;
+                vgl->tex_packed   = true;
+                vgl->tex_type     = GL_UNSIGNED_BYTE;
+                yuv_range_correction = 1.0;
+                break;
             }
             list++;
         }
     }
 
-    vgl->chroma = vlc_fourcc_GetChromaDescription(vgl->fmt.i_chroma);
+    vgl->chroma = vlc_fourcc_GetChromaDescription(vgl->use_opaque ? VLC_CODEC_RGBA
+                                                                  : vgl->fmt.i_chroma);
     vgl->use_multitexture = vgl->chroma->plane_count > 1;
 
     /* Texture size */
     for (unsigned j = 0; j < vgl->chroma->plane_count; j++) {
-        int w = vgl->fmt.i_width  * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den;
+        int w = vgl->fmt.i_width  * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den
+              / vgl->tex_pixels[j];
         int h = vgl->fmt.i_height * vgl->chroma->p[j].h.num / vgl->chroma->p[j].h.den;
         if (vgl->supports_npot) {
             vgl->tex_width[j]  = w;
@@ -505,6 +701,25 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
             vgl->tex_width[j]  = GetAlignedSize(w);
             vgl->tex_height[j] = GetAlignedSize(h);
         }
+        if (j < 3) {
+            vgl->tex_size[4 * j + 0] = vgl->tex_width[j];
+            vgl->tex_size[4 * j + 1] = vgl->tex_height[j];
+            vgl->tex_size[4 * j + 2] = 1.f / vgl->tex_width[j];
+            vgl->tex_size[4 * j + 3] = 1.f / vgl->tex_height[j];
+        }
+    }
+
+    /* GPU deinterlacing of the pictures still interlaced at this point */
+    vgl->deinterlace = 0;
+    vgl->field = -1;
+    if (need_fs_yuv) {
+        static const char *const modes[] = GL_DEINTERLACE_VALUES;
+        char *mode = var_InheritString(gl, "gl-deinterlace");
+
+        for (unsigned i = 0; mode != NULL && i < sizeof(modes) / sizeof(*modes); i++)
+            if (!strcmp(mode, modes[i]))
+                vgl->deinterlace = i;
+        free(mode);
     }
 
     /* Build program if needed */
@@ -517,7 +732,7 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
     if (supports_shaders && need_fs_yuv) {
 #ifdef SUPPORTS_SHADERS
         BuildYUVFragmentShader(vgl, &vgl->shader[0], &vgl->local_count,
-                               vgl->local_value, fmt, yuv_range_correction);
+                               vgl->local_value, &vgl->fmt, yuv_range_correction);
         BuildRGBAFragmentShader(vgl, &vgl->shader[1]);
         BuildVertexShader(vgl, &vgl->shader[2]);
 
@@ -606,8 +821,17 @@ void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
         for (int i = 0; i < vgl->region_count; i++) {
             if (vgl->region[i].texture)
                 glDeleteTextures(1, &vgl->region[i].texture);
+            if (vgl->region[i].picture)
+                picture_Release(vgl->region[i].picture);
         }
         free(vgl->region);
+#ifdef SUPPORTS_PBO
+        if (vgl->pbo_fence)
+            vgl->DeleteSync(vgl->pbo_fence);
+        /* It also unmaps them */
+        for (unsigned i = 0; i < vgl->pbo_count; i++)
+            vgl->DeleteBuffers(1, &vgl->pbo[i]->buffer);
+#endif
 
 #ifdef SUPPORTS_SHADERS
         if (vgl->program[0]) {
@@ -625,6 +849,71 @@ void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
     free(vgl);
 }
 
+#ifdef SUPPORTS_PBO
+/* It must be called with the OpenGL context locked */
+static picture_t *NewPicturePBO(vout_display_opengl_t *vgl)
+{
+    picture_t layout;
+    memset(&layout, 0, sizeof(layout));
+    if (picture_Setup(&layout, vgl->fmt.i_chroma,
+                      vgl->fmt.i_width, vgl->fmt.i_height,
+                      vgl->fmt.i_sar_num, vgl->fmt.i_sar_den))
+        return NULL;
+
+    size_t offset[PICTURE_PLANE_MAX];
+    size_t size = 0;
+    for (int i = 0; i < layout.i_planes; i++) {
+        offset[i] = size;
+        size += layout.p[i].i_pitch * layout.p[i].i_lines;
+        size  = (size + 63) & ~63;
+    }
+
+    picture_sys_t *sys = malloc(sizeof(*sys));
+    if (!sys)
+        return NULL;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    vgl->GenBuffers(1, &sys->buffer);
+    vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, sys->buffer);
+    vgl->BufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+    sys->base = vgl->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+    vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!sys->base) {
+        vgl->DeleteBuffers(1, &sys->buffer);
+        free(sys);
+        return NULL;
+    }
+
+    picture_resource_t rsc;
+    memset(&rsc, 0, sizeof(rsc));
+    rsc.p_sys = sys;
+    for (int i = 0; i < layout.i_planes; i++) {
+        rsc.p[i].p_pixels = &sys->base[offset[i]];
+        rsc.p[i].i_lines  = layout.p[i].i_lines;
+        rsc.p[i].i_pitch  = layout.p[i].i_pitch;
+    }
+    picture_t *picture = picture_NewFromResource(&vgl->fmt, &rsc);
+    if (!picture) {
+        vgl->DeleteBuffers(1, &sys->buffer);
+        free(sys);
+        return NULL;
+    }
+    vgl->pbo[vgl->pbo_count++] = sys;
+    return picture;
+}
+
+static picture_sys_t *GetPicturePBO(vout_display_opengl_t *vgl,
+                                    const picture_t *picture)
+{
+    /* The picture may not come from our pool */
+    for (unsigned i = 0; i < vgl->pbo_count; i++) {
+        if (vgl->pbo[i] == picture->p_sys)
+            return vgl->pbo[i];
+    }
+    return NULL;
+}
+#endif
+
 picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned requested_count)
 {
     if (vgl->pool)
@@ -632,9 +921,19 @@ picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned
 
     /* Allocate our pictures */
     picture_t *picture[VLCGL_PICTURE_MAX] = {NULL, };
-    unsigned count;
+    unsigned count = 0;
 
-    for (count = 0; count < __MIN(VLCGL_PICTURE_MAX, requested_count); count++) {
+#ifdef SUPPORTS_PBO
+    if (vgl->use_pbo && !vlc_gl_Lock(vgl->gl)) {
+        for (; count < __MIN(VLCGL_PICTURE_MAX, requested_count); count++) {
+            picture[count] = NewPicturePBO(vgl);
+            if (!picture[count])
+                break;
+        }
+        vlc_gl_Unlock(vgl->gl);
+    }
+#endif
+    for (; count < __MIN(VLCGL_PICTURE_MAX, requested_count); count++) {
         picture[count] = picture_NewFromFormat(&vgl->fmt);
         if (!picture[count])
             break;
@@ -670,15 +969,16 @@ picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned
             glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 #endif
 
-            glTexParameteri(vgl->tex_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(vgl->tex_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            const GLint filter = vgl->tex_packed ? GL_NEAREST : GL_LINEAR;
+            glTexParameteri(vgl->tex_target, GL_TEXTURE_MAG_FILTER, filter);
+            glTexParameteri(vgl->tex_target, GL_TEXTURE_MIN_FILTER, filter);
             glTexParameteri(vgl->tex_target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
             glTexParameteri(vgl->tex_target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
             /* Call glTexImage2D only once, and use glTexSubImage2D later */
             glTexImage2D(vgl->tex_target, 0,
-                         vgl->tex_internal, vgl->tex_width[j], vgl->tex_height[j],
-                         0, vgl->tex_format, vgl->tex_type, NULL);
+                         vgl->tex_internal[j], vgl->tex_width[j], vgl->tex_height[j],
+                         0, vgl->tex_format[j], vgl->tex_type, NULL);
         }
     }
 
@@ -698,47 +998,86 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
     if (vlc_gl_Lock(vgl->gl))
         return VLC_EGENERIC;
 
+    /* Keep the first field, and rebuild the lines of the second one */
+    vgl->field = picture->b_progressive ? -1 : picture->b_top_field_first;
+
     /* Update the texture */
-    for (unsigned j = 0; j < vgl->chroma->plane_count; j++) {
+    if (vgl->use_opaque) {
+        vlc_gl_picture_t *surface = (vlc_gl_picture_t *)picture->context;
+
+        /* Keep the previous picture if the decoder cannot draw this one */
+        glBindTexture(vgl->tex_target, vgl->texture[0][0]);
+        if (surface != NULL)
+            surface->render(surface, vgl->tex_target, vgl->texture[0][0]);
+    }
+#ifdef SUPPORTS_PBO
+    picture_sys_t *pbo = vgl->use_opaque ? NULL : GetPicturePBO(vgl, picture);
+    if (pbo)
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo->buffer);
+#endif
+    for (unsigned j = 0; !vgl->use_opaque && j < vgl->chroma->plane_count; j++) {
         if (vgl->use_multitexture) {
             glActiveTexture(GL_TEXTURE0 + j);
             glClientActiveTexture(GL_TEXTURE0 + j);
         }
         glBindTexture(vgl->tex_target, vgl->texture[0][j]);
 
+        const void *pixels = picture->p[j].p_pixels;
+#ifdef SUPPORTS_PBO
+        /* Offset in the bound buffer */
+        if (pbo)
+            pixels = (const void *)(uintptr_t)(picture->p[j].p_pixels - pbo->base);
+#endif
+
+        /* Size of a texel in bytes */
+        const unsigned texel = picture->p[j].i_pixel_pitch * vgl->tex_pixels[j];
 #ifndef GL_UNPACK_ROW_LENGTH
-        if ( (picture->p[j].i_pitch / picture->p[j].i_pixel_pitch) != (unsigned int)
-             ( picture->format.i_visible_width * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den ) )
+        const unsigned visible_width = picture->format.i_visible_width
+            * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den / vgl->tex_pixels[j];
+        if ( (picture->p[j].i_pitch / texel) != visible_width )
         {
-            uint8_t *new_plane = malloc( picture->format.i_visible_width * vgl->fmt.i_visible_height * vgl->chroma->p[j].w.num * vgl->chroma->p[j].h.num / (vgl->chroma->p[j].h.den * vgl->chroma->p[j].w.den ) );
+            const unsigned visible_height = vgl->fmt.i_visible_height
+                * vgl->chroma->p[j].h.num / vgl->chroma->p[j].h.den;
+            uint8_t *new_plane = malloc( visible_width * texel * visible_height );
             uint8_t *destination = new_plane;
             const uint8_t *source = picture->p[j].p_pixels;
 
-            for( unsigned height = 0; height < (vgl->fmt.i_visible_height * vgl->chroma->p[j].h.num / vgl->chroma->p[j].h.den) ; height++ )
+            for( unsigned height = 0; height < visible_height; height++ )
             {
-                memcpy( destination, source, picture->format.i_visible_width * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den );
-                source += picture->p[j].i_pitch / picture->p[j].i_pixel_pitch;
-                destination += picture->format.i_visible_width * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den;
+                memcpy( destination, source, visible_width * texel );
+                source += picture->p[j].i_pitch;
+                destination += visible_width * texel;
             }
             glTexSubImage2D( vgl->tex_target, 0,
                              0, 0,
-                             picture->format.i_visible_width * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den,
-                             vgl->fmt.i_height * vgl->chroma->p[j].h.num / vgl->chroma->p[j].h.den,
-                             vgl->tex_format, vgl->tex_type, new_plane );
+                             visible_width, visible_height,
+                             vgl->tex_format[j], vgl->tex_type, new_plane );
             free( new_plane );
         } else {
 #else
-            glPixelStorei(GL_UNPACK_ROW_LENGTH, picture->p[j].i_pitch / picture->p[j].i_pixel_pitch);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, picture->p[j].i_pitch / texel);
 #endif
             glTexSubImage2D(vgl->tex_target, 0,
                             0, 0,
-                            vgl->fmt.i_width  * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den,
+                            vgl->fmt.i_width  * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den
+                                              / vgl->tex_pixels[j],
                             vgl->fmt.i_height * vgl->chroma->p[j].h.num / vgl->chroma->p[j].h.den,
-                            vgl->tex_format, vgl->tex_type, picture->p[j].p_pixels);
+                            vgl->tex_format[j], vgl->tex_type, pixels);
 #ifndef GL_UNPACK_ROW_LENGTH
         }
 #endif
     }
+#ifdef SUPPORTS_PBO
+    if (pbo) {
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        /* The picture must not be written again before the end of the
+         * uploads, which is waited for in vout_display_opengl_Display() */
+        if (vgl->pbo_fence)
+            vgl->DeleteSync(vgl->pbo_fence);
+        vgl->pbo_fence = vgl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+#endif
 
     int         last_count = vgl->region_count;
     gl_region_t *last = vgl->region;
@@ -777,7 +1116,29 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
             glr->right  =  2.0 * (r->i_x + r->fmt.i_visible_width ) / subpicture->i_original_picture_width  - 1.0;
             glr->bottom = -2.0 * (r->i_y + r->fmt.i_visible_height) / subpicture->i_original_picture_height + 1.0;
 
+            const int pixels_offset = r->fmt.i_y_offset * r->p_picture->p->i_pitch +
+                                      r->fmt.i_x_offset * r->p_picture->p->i_pixel_pitch;
+
+            /* Reuse the texture of an unchanged region as is */
             glr->texture = 0;
+            for (int j = 0; j < last_count; j++) {
+                if (last[j].texture &&
+                    last[j].picture == r->p_picture &&
+                    last[j].pixels_offset == pixels_offset &&
+                    last[j].width  == glr->width &&
+                    last[j].height == glr->height) {
+                    glr->texture = last[j].texture;
+                    glr->picture = last[j].picture;
+                    glr->pixels_offset = pixels_offset;
+                    memset(&last[j], 0, sizeof(last[j]));
+                    break;
+                }
+            }
+            if (glr->texture)
+                continue;
+
+            glr->picture       = picture_Hold(r->p_picture);
+            glr->pixels_offset = pixels_offset;
             for (int j = 0; j < last_count; j++) {
                 if (last[j].texture &&
                     last[j].width  == glr->width &&
@@ -785,13 +1146,13 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
                     last[j].format == glr->format &&
                     last[j].type   == glr->type) {
                     glr->texture = last[j].texture;
+                    if (last[j].picture)
+                        picture_Release(last[j].picture);
                     memset(&last[j], 0, sizeof(last[j]));
                     break;
                 }
             }
 
-            const int pixels_offset = r->fmt.i_y_offset * r->p_picture->p->i_pitch +
-                                      r->fmt.i_x_offset * r->p_picture->p->i_pixel_pitch;
             if (glr->texture) {
                 glBindTexture(GL_TEXTURE_2D, glr->texture);
                 /* TODO set GL_UNPACK_ALIGNMENT */
@@ -825,6 +1186,8 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
     for (int i = 0; i < last_count; i++) {
         if (last[i].texture)
             glDeleteTextures(1, &last[i].texture);
+        if (last[i].picture)
+            picture_Release(last[i].picture);
     }
     free(last);
 
@@ -881,6 +1244,9 @@ static void DrawWithShaders(vout_display_opengl_t *vgl,
     vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture0"), 0);
     vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture1"), 1);
     vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture2"), 2);
+    vgl->Uniform4fv(vgl->GetUniformLocation(vgl->program[0], "TexSize"), 3, vgl->tex_size);
+    vgl->Uniform4f(vgl->GetUniformLocation(vgl->program[0], "Field"),
+                   vgl->deinterlace && vgl->field >= 0, vgl->field, 0.0, 0.0);
 
     static const GLfloat vertexCoord[] = {
         -1.0,  1.0,
@@ -937,7 +1303,7 @@ int vout_display_opengl_Display(vout_display_opengl_t *vgl,
         float scale_w, scale_h;
 
         if (vgl->tex_target == GL_TEXTURE_2D) {
-            scale_w = (float)vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den / vgl->tex_width[j];
+            scale_w = (float)vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den / vgl->tex_pixels[j] / vgl->tex_width[j];
             scale_h = (float)vgl->chroma->p[j].h.num / vgl->chroma->p[j].h.den / vgl->tex_height[j];
 
         } else {
@@ -1025,6 +1391,17 @@ int vout_display_opengl_Display(vout_display_opengl_t *vgl,
     /* Display */
     vlc_gl_Swap(vgl->gl);
 
+#ifdef SUPPORTS_PBO
+    /* The caller releases the picture after this call. The uploads were
+     * queued in vout_display_opengl_Prepare(), so they are usually done. */
+    if (vgl->pbo_fence) {
+        vgl->ClientWaitSync(vgl->pbo_fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                            INT64_C(1000000000));
+        vgl->DeleteSync(vgl->pbo_fence);
+        vgl->pbo_fence = NULL;
+    }
+#endif
+
     vlc_gl_Unlock(vgl->gl);
     return VLC_SUCCESS;
 }
@@ -77,6 +77,15 @@ static inline bool HasExtension(const char *apis, const char *api)
     return false;
 }
 
+#define GL_DEINTERLACE_TEXT N_("GPU deinterlacing")
+#define GL_DEINTERLACE_LONGTEXT N_( \
+    "Deinterlacing of the interlaced pictures by the fragment shader. " \
+    "It only applies to the pictures that were not deinterlaced before, " \
+    "disable the deinterlace video filter (--deinterlace=0) to use it.")
+#define GL_DEINTERLACE_VALUES { "off", "bob", "linear", "edge" }
+#define GL_DEINTERLACE_TEXTS { N_("Off"), N_("Bob"), N_("Linear"), \
+                               N_("Edge-directed") }
+
 typedef struct vout_display_opengl_t vout_display_opengl_t;
 
 vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
@@ -96,6 +96,7 @@ struct vout_display_sys_t {
     void (*unlock)(void *sys, void *id, void *const *plane);
     void (*display)(void *sys, void *id);
     void (*cleanup)(void *sys);
+    unsigned (*pool_cb)(void *sys, unsigned count);
 
     unsigned pitches[PICTURE_PLANE_MAX];
     unsigned lines[PICTURE_PLANE_MAX];
@@ -136,6 +137,7 @@ static int Open(vlc_object_t *object)
     sys->display = var_InheritAddress(vd, "vmem-display");
     sys->cleanup = var_InheritAddress(vd, "vmem-cleanup");
     sys->opaque = var_InheritAddress(vd, "vmem-data");
+    sys->pool_cb = var_InheritAddress(vd, "vmem-pool");
     sys->pool = NULL;
 
     /* Define the video format */
@@ -174,6 +176,7 @@ static int Open(vlc_object_t *object)
         }
         sys->count = 1;
         sys->cleanup = NULL;
+        sys->pool_cb = NULL;
     }
 
     if (!fmt.i_chroma) {
@@ -247,7 +250,16 @@ static picture_pool_t *Pool(vout_display_t *vd, unsigned count)
     if (sys->pool)
         return sys->pool;
 
-    if (count > sys->count)
+    /* With enough pictures, the decoder renders directly into the buffers
+     * of the application (the core asks for all the pictures it needs). */
+    if (sys->pool_cb != NULL) {
+        unsigned avail = sys->pool_cb(sys->opaque, count);
+        msg_Dbg(vd, "%u picture buffers requested, %u provided", count, avail);
+        if (avail == 0)
+            avail = sys->count;
+        if (avail < count)
+            count = avail;
+    } else if (count > sys->count)
         count = sys->count;
 
     picture_t *pictures[count];
@@ -317,13 +317,23 @@ FindFormat (vlc_object_t *obj, xcb_connection_t *conn, video_format_t *fmt,
         if (!BetterFormat (chroma, chromav, &rank))
             continue;
 
-        /* VLC pads scanline to 16 pixels internally */
-        unsigned width = fmt->i_width;
-        unsigned height = fmt->i_height;
+        /* Pad the image like the decoders pad their own buffers, so that
+         * they can decode straight into the shared memory segment. */
+        unsigned width = (fmt->i_width + 31) & ~31;
+        unsigned height = (fmt->i_height + 31) & ~31;
         xcb_xv_query_image_attributes_reply_t *i;
         i = xcb_xv_query_image_attributes_reply (conn,
             xcb_xv_query_image_attributes (conn, a->base_id, f->id,
                                            width, height), NULL);
+        if (i != NULL && (i->width != width || i->height != height))
+        {   /* Some adaptors reject the padded size, use the exact one */
+            free (i);
+            width = fmt->i_width;
+            height = fmt->i_height;
+            i = xcb_xv_query_image_attributes_reply (conn,
+                xcb_xv_query_image_attributes (conn, a->base_id, f->id,
+                                               width, height), NULL);
+        }
         if (i == NULL)
             continue;
 
@@ -695,6 +705,9 @@ static void PoolAlloc (vout_display_t *vd, unsigned requested_count)
 
     if (count == 0)
         return;
+    if (count < requested_count)
+        msg_Warn (vd, "only %u of %u pictures allocated", count,
+                  requested_count);
 
     p_sys->pool = picture_pool_New (count, pic_array);
     /* TODO release picture resources if NULL */
@@ -733,8 +746,7 @@ static void Display (vout_display_t *vd, picture_t *pic, subpicture_t *subpictur
                               vd->source.i_visible_width,
                               vd->source.i_visible_height,
                    /* Dst: */ 0, 0, p_sys->width, p_sys->height,
-                /* Memory: */ pic->p->i_pitch / pic->p->i_pixel_pitch,
-                              pic->p->i_lines, false);
+                /* Memory: */ p_sys->att->width, p_sys->att->height, false);
     else
         ck = xcb_xv_put_image_checked (p_sys->conn, p_sys->port, p_sys->window,
                           p_sys->gc, p_sys->id,
@@ -743,8 +755,7 @@ static void Display (vout_display_t *vd, picture_t *pic, subpicture_t *subpictur
                           vd->source.i_visible_width,
                           vd->source.i_visible_height,
                           0, 0, p_sys->width, p_sys->height,
-                          pic->p->i_pitch / pic->p->i_pixel_pitch,
-                          pic->p->i_lines,
+                          p_sys->att->width, p_sys->att->height,
                           p_sys->data_size, pic->p->p_pixels);
 
     /* Wait for reply. See x11.c for rationale. */
@@ -112,10 +112,21 @@ int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
 
         p_data->i_prev_nb_samples = 0;
         p_data->p_prev_s16_buff = NULL;
+        p_data->p_state = NULL;
     }
     peaks = (int *)p_data->peaks;
     prev_heights = (int *)p_data->prev_heights;
 
+    /* The FFT tables only depend on the buffer size */
+    if( !p_data->p_state )
+        p_data->p_state = visual_fft_init();
+    p_state = p_data->p_state;
+    if( !p_state )
+    {
+        msg_Err(p_aout,"unable to initialize FFT transform");
+        return -1;
+    }
+
     /* Allocate the buffer only if the number of samples change */
     if( p_buffer->i_nb_samples != p_data->i_prev_nb_samples )
     {
@@ -160,13 +171,6 @@ int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
 
         p_buffl++ ; p_buffs++ ;
     }
-    p_state  = visual_fft_init();
-    if( !p_state)
-    {
-        free( height );
-        msg_Err(p_aout,"unable to initialize FFT transform");
-        return -1;
-    }
     p_buffs = p_s16_buff;
     for ( i = 0 ; i < FFT_BUFFER_SIZE ; i++)
     {
@@ -325,8 +329,6 @@ int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         }
     }
 
-    fft_close( p_state );
-
     free( height );
 
     return 0;
@@ -411,10 +413,21 @@ int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         }
         p_data->i_prev_nb_samples = 0;
         p_data->p_prev_s16_buff = NULL;
+        p_data->p_state = NULL;
         p_effect->p_data = (void*)p_data;
     }
     peaks = p_data->peaks;
 
+    /* The FFT tables only depend on the buffer size */
+    if( !p_data->p_state )
+        p_data->p_state = visual_fft_init();
+    p_state = p_data->p_state;
+    if( !p_state )
+    {
+        msg_Err(p_aout,"unable to initialize FFT transform");
+        return -1;
+    }
+
     /* Allocate the buffer only if the number of samples change */
     if( p_buffer->i_nb_samples != p_data->i_prev_nb_samples )
     {
@@ -468,13 +481,6 @@ int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
 
         p_buffl++ ; p_buffs++ ;
     }
-    p_state  = visual_fft_init();
-    if( !p_state)
-    {
-        msg_Err(p_aout,"unable to initialize FFT transform");
-        free( height );
-        return -1;
-    }
     p_buffs = p_s16_buff;
     for ( i = 0 ; i < FFT_BUFFER_SIZE; i++)
     {
@@ -782,8 +788,6 @@ int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         }
     }
 
-    fft_close( p_state );
-
     free( height );
 
     return 0;
@@ -42,7 +42,8 @@ static void fft_prepare(const sound_sample *input, float * re, float * im,
                         const unsigned int *bitReverse);
 static void fft_calculate(float * re, float * im,
                           const float *costable, const float *sintable );
-static void fft_output(const float *re, const float *im, float *output);
+static void fft_output(const float *re, const float *im, float *output,
+                       const float *costable, const float *sintable);
 static int reverseBits(unsigned int initial);
 
 /*****************************************************************************
@@ -64,7 +65,7 @@ fft_state *visual_fft_init(void)
     if(! p_state )
         return NULL;
 
-    for(i = 0; i < FFT_BUFFER_SIZE; i++)
+    for(i = 0; i < FFT_BUFFER_SIZE / 2; i++)
     {
         p_state->bitReverse[i] = reverseBits(i);
     }
@@ -95,7 +96,8 @@ void fft_perform(const sound_sample *input, float *output, fft_state *state) {
     fft_calculate(state->real, state->imag, state->costable, state->sintable);
 
     /* Convert the FFT output into intensities */
-    fft_output(state->real, state->imag, output);
+    fft_output(state->real, state->imag, output,
+               state->costable, state->sintable);
 }
 
 /*
@@ -111,6 +113,8 @@ void fft_close(fft_state *state) {
 
 /*
  * Prepare data to perform an FFT on
+ * As the input is real, the even samples go into the real part and the odd
+ * ones into the imaginary part of an FFT of half the size.
  */
 static void fft_prepare( const sound_sample *input, float * re, float * im,
                          const unsigned int *bitReverse ) {
@@ -119,10 +123,10 @@ static void fft_prepare( const sound_sample *input, float * re, float * im,
     float *p_imag = im;
 
     /* Get input, in reverse bit order */
-    for(i = 0; i < FFT_BUFFER_SIZE; i++)
+    for(i = 0; i < FFT_BUFFER_SIZE / 2; i++)
     {
-        *p_real++ = input[bitReverse[i]];
-        *p_imag++ = 0;
+        *p_real++ = input[2 * bitReverse[i]];
+        *p_imag++ = input[2 * bitReverse[i] + 1];
     }
 }
 
@@ -130,22 +134,34 @@ static void fft_prepare( const sound_sample *input, float * re, float * im,
  * Take result of an FFT and calculate the intensities of each frequency
  * Note: only produces half as many data points as the input had.
  */
-static void fft_output(const float * re, const float * im, float *output)
+static void fft_output(const float * re, const float * im, float *output,
+                       const float *costable, const float *sintable)
 {
-    float *p_output = output;
-    const float *p_real   = re;
-    const float *p_imag   = im;
-    float *p_end    = output + FFT_BUFFER_SIZE / 2;
+    const unsigned int half = FFT_BUFFER_SIZE / 2;
+    unsigned int k;
 
-    while(p_output <= p_end)
+    /* Split the spectra of the even and odd samples, and combine them:
+     * E = (Z[k] + Z*[N/2-k]) / 2, O = (Z[k] - Z*[N/2-k]) / 2i and
+     * X[k] = E + W^k O */
+    for(k = 1; k < half; k++)
     {
-        *p_output = (*p_real * *p_real) + (*p_imag * *p_imag);
-        p_output++; p_real++; p_imag++;
+        float sum_real  = re[k] + re[half - k];
+        float sum_imag  = im[k] - im[half - k];
+        float diff_real = re[k] - re[half - k];
+        float diff_imag = im[k] + im[half - k];
+        /* W^k O, times 2 */
+        float odd_real  = costable[k] * diff_imag + sintable[k] * diff_real;
+        float odd_imag  = sintable[k] * diff_imag - costable[k] * diff_real;
+        float x_real = (sum_real + odd_real) / 2;
+        float x_imag = (sum_imag + odd_imag) / 2;
+
+        output[k] = x_real * x_real + x_imag * x_imag;
     }
+
     /* Do divisions to keep the constant and highest frequency terms in scale
      * with the other terms. */
-    *output /= 4;
-    *p_end /= 4;
+    output[0]    = (re[0] + im[0]) * (re[0] + im[0]) / 4;
+    output[half] = (re[0] - im[0]) * (re[0] - im[0]) / 4;
 }
 
 
@@ -165,7 +181,7 @@ static void fft_calculate(float * re, float * im, const float *costable, const f
     factfact = FFT_BUFFER_SIZE / 2;
 
     /* Loop through the divide and conquer steps */
-    for(i = FFT_BUFFER_SIZE_LOG; i != 0; i--) {
+    for(i = FFT_BUFFER_SIZE_LOG - 1; i != 0; i--) {
         /* In this step, we have 2 ^ (i - 1) exchange groups, each with
          * 2 ^ (FFT_BUFFER_SIZE_LOG - i) exchanges
          */
@@ -180,7 +196,7 @@ static void fft_calculate(float * re, float * im, const float *costable, const f
             fact_imag = sintable[j * factfact];
 
             /* Loop through all the exchange groups */
-            for(k = j; k < FFT_BUFFER_SIZE; k += exchanges << 1) {
+            for(k = j; k < FFT_BUFFER_SIZE / 2; k += exchanges << 1) {
                 int k1 = k + exchanges;
                 tmp_real = fact_real * re[k1] - fact_imag * im[k1];
                 tmp_imag = fact_real * im[k1] + fact_imag * re[k1];
@@ -198,7 +214,7 @@ static void fft_calculate(float * re, float * im, const float *costable, const f
 static int reverseBits(unsigned int initial)
 {
     unsigned int reversed = 0, loop;
-    for(loop = 0; loop < FFT_BUFFER_SIZE_LOG; loop++) {
+    for(loop = 0; loop < FFT_BUFFER_SIZE_LOG - 1; loop++) {
         reversed <<= 1;
         reversed += (initial & 1);
         initial >>= 1;
@@ -389,12 +389,16 @@ static void Close( vlc_object_t *p_this )
                 free( p_data->peaks );
                 free( p_data->prev_heights );
                 free( p_data->p_prev_s16_buff );
+                if( p_data->p_state )
+                    fft_close( p_data->p_state );
             }
             if( !strncmp( p_effect->psz_name, "spectrometer", strlen( "spectrometer" ) ) )
             {
                 spectrometer_data* p_data = p_effect->p_data;
                 free( p_data->peaks );
                 free( p_data->p_prev_s16_buff );
+                if( p_data->p_state )
+                    fft_close( p_data->p_state );
             }
             free( p_effect->p_data );
         }
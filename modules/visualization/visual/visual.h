@@ -21,6 +21,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 
+#include "fft.h"
+
 typedef struct visual_effect_t
 {
     const char *psz_name;    /* Filter name*/
@@ -45,6 +47,8 @@ typedef struct spectrum_data
 
     unsigned i_prev_nb_samples;
     int16_t *p_prev_s16_buff;
+
+    fft_state *p_state;
 } spectrum_data;
 
 typedef struct
@@ -53,6 +57,8 @@ typedef struct
 
     unsigned i_prev_nb_samples;
     int16_t *p_prev_s16_buff;
+
+    fft_state *p_state;
 } spectrometer_data;
 
 /*****************************************************************************
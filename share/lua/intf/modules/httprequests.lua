@@ -65,6 +65,10 @@ function strsplit(text, delimiter)
     return list
 end
 
+--status snapshots, rebuilt only after a status event (see vlc.misc.status)
+--or a command, and at least every second for the values without events
+local statuscache = {}
+
 --main function to process commands sent with the request
 
 processcommands = function ()
@@ -197,6 +201,10 @@ processcommands = function ()
   	  vlc.var.set(vlc.object.input(), "spu-es", val)
     end
 
+    if command then
+      statuscache = {}
+    end
+
     local input = nil
     local command = nil
     local id = nil
@@ -437,6 +445,14 @@ end
 
 getstatus = function (includecategories)
 
+local serial, time, position = vlc.misc.status()
+local cached = statuscache[includecategories and "full" or "short"]
+if serial and cached and cached.serial == serial
+   and vlc.misc.mdate() < cached.date + 1000000 then
+    cached.s.time = math.floor(time)
+    cached.s.position = position
+    return cached.s
+end
 
 local input = vlc.object.input()
 local item = vlc.input.item()
@@ -537,6 +553,10 @@ local aout = vlc.object.aout()
       	s.information.titles=vlc.var.get_list(input, "title")
 
     end
+
+    if serial then
+        statuscache[includecategories and "full" or "short"] = { serial=serial, date=vlc.misc.mdate(), s=s }
+    end
     return s
 end
 
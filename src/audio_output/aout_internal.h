@@ -68,6 +68,12 @@ typedef struct
         bool discontinuity;
     } sync;
 
+    struct
+    {
+        mtime_t preroll; /**< Pre-roll of the next input (0 if disabled) */
+        bool kept; /**< Output left running by aout_DecDelete() */
+    } gapless;
+
     audio_sample_format_t input_format;
     audio_sample_format_t mixer_format;
 
@@ -78,6 +84,7 @@ typedef struct
     unsigned nb_filters;
     filter_t *filters[AOUT_MAX_FILTERS]; /**< Configured user filters
         (e.g. equalization) and their conversions */
+    struct filter_owner_sys_t *buffers; /**< Recycled filter outputs */
 
     aout_request_vout_t request_vout;
     bool recycle_vout;
@@ -151,7 +158,7 @@ int aout_DecPlay(audio_output_t *, block_t *, int i_input_rate);
 int aout_DecGetResetLost(audio_output_t *);
 void aout_DecChangePause(audio_output_t *, bool b_paused, mtime_t i_date);
 void aout_DecFlush(audio_output_t *);
-bool aout_DecIsEmpty(audio_output_t *);
+bool aout_DecIsEmpty(audio_output_t *, bool gapless);
 void aout_RequestRestart (audio_output_t *, unsigned);
 
 static inline void aout_InputRequestRestart(audio_output_t *aout)
@@ -70,17 +70,40 @@ int aout_DecNew( audio_output_t *p_aout,
     /* TODO: reduce lock scope depending on decoder's real need */
     aout_OutputLock (p_aout);
 
-    var_Destroy( p_aout, "stereo-mode" );
+    owner->gapless.preroll = var_InheritInteger (p_aout, "audio-preroll")
+                           * (CLOCK_FREQ / 1000);
+    bool splice = false;
 
     /* Create the audio output stream */
     owner->volume = aout_volume_New (p_aout, p_replay_gain);
 
-    atomic_store (&owner->restart, 0);
-    owner->input_format = *p_format;
-    owner->mixer_format = owner->input_format;
+    if (owner->gapless.kept)
+    {   /* The previous stream may still be playing: append to it if the
+         * format is the same, so that there is no gap between the two. */
+        owner->gapless.kept = false;
+        splice = !atomic_exchange (&owner->restart, 0)
+              && AOUT_FMTS_IDENTICAL (&owner->input_format, p_format)
+              && owner->input_format.i_bytes_per_frame
+                                               == p_format->i_bytes_per_frame
+              && owner->input_format.i_frame_length
+                                               == p_format->i_frame_length;
+        if (!splice)
+            aout_OutputDelete (p_aout);
+    }
+
+    if (splice)
+        msg_Dbg (p_aout, "reusing the audio output stream");
+    else
+    {
+        var_Destroy (p_aout, "stereo-mode");
 
-    if (aout_OutputNew (p_aout, &owner->mixer_format))
-        goto error;
+        atomic_store (&owner->restart, 0);
+        owner->input_format = *p_format;
+        owner->mixer_format = owner->input_format;
+
+        if (aout_OutputNew (p_aout, &owner->mixer_format))
+            goto error;
+    }
     aout_volume_SetFormat (owner->volume, owner->mixer_format.i_format);
 
     /* Create the audio filtering "input" pipeline */
@@ -96,7 +119,8 @@ error:
 
     owner->sync.end = VLC_TS_INVALID;
     owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
-    owner->sync.discontinuity = true;
+    /* A spliced stream must not flush the end of the previous one */
+    owner->sync.discontinuity = !splice;
     aout_OutputUnlock (p_aout);
 
     atomic_init (&owner->buffers_lost, 0);
@@ -109,16 +133,24 @@ error:
 void aout_DecDelete (audio_output_t *aout)
 {
     aout_owner_t *owner = aout_owner (aout);
+    bool kept = false;
 
     aout_OutputLock (aout);
     if (owner->mixer_format.i_format)
     {
         aout_FiltersDelete (aout);
-        aout_OutputDelete (aout);
+        /* With gapless playback, the output keeps playing the queued audio
+         * until the next stream starts, see aout_DecNew(). */
+        kept = owner->gapless.preroll > 0
+            && !atomic_load (&owner->restart);
+        if (!kept)
+            aout_OutputDelete (aout);
+        owner->gapless.kept = kept;
     }
     aout_volume_Delete (owner->volume);
     aout_OutputUnlock (aout);
-    var_Destroy (aout, "stereo-mode");
+    if (!kept)
+        var_Destroy (aout, "stereo-mode");
 }
 
 static int aout_CheckReady (audio_output_t *aout)
@@ -443,7 +475,13 @@ void aout_DecFlush (audio_output_t *aout)
     aout_OutputUnlock (aout);
 }
 
-bool aout_DecIsEmpty (audio_output_t *aout)
+/**
+ * Checks if all the queued audio has been played.
+ * If gapless is true (at the end of the stream), the output is considered
+ * empty as soon as the queued audio is shorter than the pre-roll, so that
+ * the next input can start while the end of this one is playing.
+ */
+bool aout_DecIsEmpty (audio_output_t *aout, bool gapless)
 {
     aout_owner_t *owner = aout_owner (aout);
     mtime_t now = mdate ();
@@ -451,7 +489,14 @@ bool aout_DecIsEmpty (audio_output_t *aout)
 
     aout_OutputLock (aout);
     if (owner->sync.end != VLC_TS_INVALID)
+    {
         empty = owner->sync.end <= now;
+        if (!empty && gapless && owner->gapless.preroll > 0)
+        {
+            aout_OutputUnlock (aout);
+            return owner->sync.end <= now + owner->gapless.preroll;
+        }
+    }
     if (empty && owner->mixer_format.i_format)
         /* The last PTS has elapsed already. So the underlying audio output
          * buffer should be empty or almost. Thus draining should be fast
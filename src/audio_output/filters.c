@@ -42,6 +42,140 @@
 #include <libvlc.h>
 #include "aout_internal.h"
 
+/**
+ * @section Audio buffers
+ *
+ * The filters of an audio output take their output buffers from a small
+ * pool. A buffer goes back to the pool when it is released, usually by the
+ * next filter once it has consumed it, so that the pipeline ping-pongs
+ * between two or three buffers. They only grow, to the biggest frame seen.
+ */
+#define AOUT_BUFFER_POOL_SIZE 4
+
+/** Payload offset, preserving the alignment of block_Alloc() */
+#define AOUT_BUFFER_HEADER ((sizeof (aout_buffer_t) + 31) & ~(size_t)31)
+
+typedef struct aout_buffer aout_buffer_t;
+
+struct aout_buffer
+{
+    block_t             self;
+    filter_owner_sys_t *pool;
+    size_t              size; /**< Allocated payload size */
+};
+
+struct filter_owner_sys_t
+{
+    vlc_mutex_t    lock;
+    unsigned       refs; /**< The output and the buffers in use */
+    size_t         max_size; /**< Biggest buffer requested */
+    unsigned       count;
+    aout_buffer_t *free[AOUT_BUFFER_POOL_SIZE];
+};
+
+static filter_owner_sys_t *aout_BufferPoolNew (void)
+{
+    filter_owner_sys_t *pool = malloc (sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init (&pool->lock);
+    pool->refs = 1;
+    pool->max_size = 0;
+    pool->count = 0;
+    return pool;
+}
+
+static void aout_BufferPoolRelease (filter_owner_sys_t *pool)
+{
+    vlc_mutex_lock (&pool->lock);
+    bool last = --pool->refs == 0;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (!last)
+        return;
+
+    while (pool->count > 0)
+        vlc_free (pool->free[--pool->count]);
+    vlc_mutex_destroy (&pool->lock);
+    free (pool);
+}
+
+static void aout_BufferRelease (block_t *block)
+{
+    aout_buffer_t *buf = (aout_buffer_t *)block;
+    filter_owner_sys_t *pool = buf->pool;
+
+    vlc_mutex_lock (&pool->lock);
+    if (pool->count < AOUT_BUFFER_POOL_SIZE)
+        pool->free[pool->count++] = buf;
+    else
+        buf = NULL;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (buf == NULL)
+        vlc_free (block);
+    aout_BufferPoolRelease (pool);
+}
+
+static block_t *aout_BufferNew (filter_t *filter, size_t size)
+{
+    filter_owner_sys_t *pool = filter->p_owner;
+    aout_buffer_t *buf = NULL;
+
+    /* Take the last released buffer, it is the most likely to be cached */
+    vlc_mutex_lock (&pool->lock);
+    if (pool->count > 0)
+        buf = pool->free[--pool->count];
+    if (size > pool->max_size)
+        pool->max_size = size;
+    size_t alloc = pool->max_size;
+    pool->refs++;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (buf != NULL && buf->size < size)
+    {
+        vlc_free (buf);
+        buf = NULL;
+    }
+    if (buf == NULL)
+    {
+        buf = vlc_memalign (32, AOUT_BUFFER_HEADER + alloc);
+        if (unlikely(buf == NULL))
+        {
+            aout_BufferPoolRelease (pool);
+            return NULL;
+        }
+        buf->pool = pool;
+        buf->size = alloc;
+    }
+
+    block_Init (&buf->self, (uint8_t *)buf + AOUT_BUFFER_HEADER, size);
+    buf->self.pf_release = aout_BufferRelease;
+    return &buf->self;
+}
+
+/**
+ * Lets the filters of the output take their buffers from its pool.
+ */
+static void aout_FiltersUsePool (aout_owner_t *owner)
+{
+    filter_owner_sys_t *pool = owner->buffers;
+
+    if (pool == NULL)
+        return;
+    for (unsigned i = 0; i < owner->nb_filters; i++)
+    {
+        owner->filters[i]->p_owner = pool;
+        owner->filters[i]->pf_audio_buffer_new = aout_BufferNew;
+    }
+    if (owner->resampler != NULL)
+    {
+        owner->resampler->p_owner = pool;
+        owner->resampler->pf_audio_buffer_new = aout_BufferNew;
+    }
+}
+
 static filter_t *FindFilter (vlc_object_t *obj, const char *type,
                              const char *name,
                              const audio_sample_format_t *infmt,
@@ -77,8 +211,12 @@ static filter_t *FindResampler (vlc_object_t *obj,
                                 const audio_sample_format_t *infmt,
                                 const audio_sample_format_t *outfmt)
 {
-    return FindFilter (obj, "audio resampler", "$audio-resampler",
-                       infmt, outfmt);
+    /* Without rate conversion, the resampler only follows the clock drift
+     * and the playback rate: a short filter is good enough there. */
+    const char *name = (infmt->i_rate == outfmt->i_rate)
+                     ? "$audio-drift-resampler" : "$audio-resampler";
+
+    return FindFilter (obj, "audio resampler", name, infmt, outfmt);
 }
 
 /**
@@ -433,6 +571,7 @@ int aout_FiltersNew (audio_output_t *aout,
     owner->nb_filters = 0;
     owner->rate_filter = NULL;
     owner->resampler = NULL;
+    owner->buffers = aout_BufferPoolNew ();
 
     var_AddCallback (aout, "visual", VisualizationCallback, NULL);
     var_AddCallback (aout, "equalizer", EqualizerCallback, NULL);
@@ -450,6 +589,7 @@ int aout_FiltersNew (audio_output_t *aout,
             }
             owner->nb_filters++;
         }
+        aout_FiltersUsePool (owner);
         return 0;
     }
 
@@ -548,11 +688,13 @@ int aout_FiltersNew (audio_output_t *aout,
     if (owner->rate_filter == NULL)
         owner->rate_filter = owner->resampler;
     owner->resampling = 0;
-
+    aout_FiltersUsePool (owner);
     return 0;
 
 error:
     aout_FiltersPipelineDestroy (owner->filters, owner->nb_filters);
+    if (owner->buffers != NULL)
+        aout_BufferPoolRelease (owner->buffers);
     var_DelCallback (aout, "equalizer", EqualizerCallback, NULL);
     var_DelCallback (aout, "visual", VisualizationCallback, NULL);
     return -1;
@@ -568,6 +710,9 @@ void aout_FiltersDelete (audio_output_t *aout)
     if (owner->resampler != NULL)
         aout_FiltersPipelineDestroy (&owner->resampler, 1);
     aout_FiltersPipelineDestroy (owner->filters, owner->nb_filters);
+    /* The buffers still in use keep the pool alive */
+    if (owner->buffers != NULL)
+        aout_BufferPoolRelease (owner->buffers);
     var_DelCallback (aout, "equalizer", EqualizerCallback, NULL);
     var_DelCallback (aout, "visual", VisualizationCallback, NULL);
 
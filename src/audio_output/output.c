@@ -257,6 +257,11 @@ void aout_Destroy (audio_output_t *aout)
     aout_owner_t *owner = aout_owner (aout);
 
     aout_OutputLock (aout);
+    if (owner->gapless.kept)
+    {
+        aout_OutputDelete (aout);
+        var_Destroy (aout, "stereo-mode");
+    }
     module_unneed (aout, owner->module);
     /* Protect against late call from intf.c */
     aout->volume_set = NULL;
@@ -244,7 +244,10 @@ void config_PutPsz( vlc_object_t *p_this,
     vlc_rwlock_wrlock (&config_lock);
     oldstr = (char *)p_config->value.psz;
     p_config->value.psz = str;
-    config_dirty = true;
+    /* Only a new value needs saving */
+    if ((str != NULL) != (oldstr != NULL)
+     || (str != NULL && strcmp (str, oldstr)))
+        config_dirty = true;
     vlc_rwlock_unlock (&config_lock);
 
     free (oldstr);
@@ -284,8 +287,11 @@ void config_PutInt( vlc_object_t *p_this, const char *psz_name,
         i_value = p_config->max.i;
 
     vlc_rwlock_wrlock (&config_lock);
-    p_config->value.i = i_value;
-    config_dirty = true;
+    if (p_config->value.i != i_value)
+    {
+        p_config->value.i = i_value;
+        config_dirty = true;
+    }
     vlc_rwlock_unlock (&config_lock);
 }
 
@@ -325,8 +331,11 @@ void config_PutFloat( vlc_object_t *p_this,
         f_value = p_config->max.f;
 
     vlc_rwlock_wrlock (&config_lock);
-    p_config->value.f = f_value;
-    config_dirty = true;
+    if (p_config->value.f != f_value)
+    {
+        p_config->value.f = f_value;
+        config_dirty = true;
+    }
     vlc_rwlock_unlock (&config_lock);
 }
 
@@ -469,24 +478,22 @@ ssize_t config_GetPszChoices (vlc_object_t *obj, const char *name,
     return count;
 }
 
-static int confcmp (const void *a, const void *b)
-{
-    const module_config_t *const *ca = a, *const *cb = b;
-
-    return strcmp ((*ca)->psz_name, (*cb)->psz_name);
-}
-
-static int confnamecmp (const void *key, const void *elem)
+/* FNV-1a */
+static uint32_t confhash (const char *name)
 {
-    const module_config_t *const *conf = elem;
+    uint32_t h = 2166136261u;
 
-    return strcmp (key, (*conf)->psz_name);
+    while (*name)
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    return h;
 }
 
+/* Open addressing hash table of the configuration items, with linear
+ * probing. The table is never more than half full. */
 static struct
 {
-    module_config_t **list;
-    size_t count;
+    module_config_t **table;
+    size_t mask;
 } config = { NULL, 0 };
 
 /**
@@ -500,14 +507,17 @@ int config_SortConfig (void)
     for (size_t i = 0; i < nmod; i++)
          nconf  += mlist[i]->confsize;
 
-    module_config_t **clist = malloc (sizeof (*clist) * nconf);
-    if (unlikely(clist == NULL))
+    size_t size = 16;
+    while (size < 2 * nconf)
+        size *= 2;
+
+    module_config_t **table = calloc (size, sizeof (*table));
+    if (unlikely(table == NULL))
     {
         module_list_free (mlist);
         return VLC_ENOMEM;
     }
 
-    nconf = 0;
     for (size_t i = 0; i < nmod; i++)
     {
         module_t *parser = mlist[i];
@@ -519,27 +529,32 @@ int config_SortConfig (void)
         {
             if (!CONFIG_ITEM(item->i_type))
                 continue; /* ignore hints */
-            clist[nconf++] = item;
+
+            size_t h = confhash (item->psz_name) & (size - 1);
+            while (table[h] != NULL
+                && strcmp (table[h]->psz_name, item->psz_name))
+                h = (h + 1) & (size - 1);
+            /* The first module (the core) wins a duplicate name */
+            if (table[h] == NULL)
+                table[h] = item;
         }
     }
     module_list_free (mlist);
 
-    qsort (clist, nconf, sizeof (*clist), confcmp);
-
-    config.list = clist;
-    config.count = nconf;
+    config.table = table;
+    config.mask = size - 1;
     return VLC_SUCCESS;
 }
 
 void config_UnsortConfig (void)
 {
-    module_config_t **clist;
+    module_config_t **table;
 
-    clist = config.list;
-    config.list = NULL;
-    config.count = 0;
+    table = config.table;
+    config.table = NULL;
+    config.mask = 0;
 
-    free (clist);
+    free (table);
 }
 
 /*****************************************************************************
@@ -551,12 +566,15 @@ module_config_t *config_FindConfig (vlc_object_t *p_this, const char *name)
 {
     VLC_UNUSED(p_this);
 
-    if (unlikely(name == NULL))
+    if (unlikely(name == NULL || config.table == NULL))
         return NULL;
 
-    module_config_t *const *p;
-    p = bsearch (name, config.list, config.count, sizeof (*p), confnamecmp);
-    return p ? *p : NULL;
+    for (size_t h = confhash (name) & config.mask;
+         config.table[h] != NULL;
+         h = (h + 1) & config.mask)
+        if (!strcmp (config.table[h]->psz_name, name))
+            return config.table[h];
+    return NULL;
 }
 
 /**
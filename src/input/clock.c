@@ -99,6 +99,20 @@
 /* Due to some problems in es_out, we cannot use a large value yet */
 #define CR_BUFFERING_TARGET (100000)
 
+/* Low latency mode: duration (in CLOCK_FREQ) and number of the windows over
+ * which the delay envelope of the clock references is computed */
+#define CR_LOW_LATENCY_WINDOW (CLOCK_FREQ/2)
+#define CR_LOW_LATENCY_WINDOWS (8)
+
+/* Low latency mode: safety margin added to the observed jitter */
+#define CR_LOW_LATENCY_MARGIN (CLOCK_FREQ/50)
+
+/* Low latency mode: maximal speed (as a fraction of the elapsed time) at
+ * which the delay is changed. It is kept well below AOUT_MAX_RESAMPLING so
+ * that the audio output can follow by resampling instead of dropping. */
+#define CR_LOW_LATENCY_SLEW_UP (16)
+#define CR_LOW_LATENCY_SLEW_DOWN (64)
+
 /*****************************************************************************
  * Structures
  *****************************************************************************/
@@ -165,6 +179,21 @@ struct input_clock_t
         unsigned i_index;
     } late;
 
+    /* Low latency mode */
+    struct
+    {
+        mtime_t  i_target;  /* 0 if disabled */
+        bool     b_active;  /* Used instead of the drift average */
+        mtime_t  i_drift;
+        mtime_t  i_last;    /* Date of the last update (in system unit) */
+
+        /* Delay envelope of the clock references */
+        mtime_t  pi_min[CR_LOW_LATENCY_WINDOWS];
+        mtime_t  pi_max[CR_LOW_LATENCY_WINDOWS];
+        unsigned i_window;
+        mtime_t  i_window_end;
+    } low_latency;
+
     /* Reference point */
     clock_point_t ref;
     bool          b_has_reference;
@@ -184,6 +213,9 @@ static mtime_t ClockStreamToSystem( input_clock_t *, mtime_t i_stream );
 static mtime_t ClockSystemToStream( input_clock_t *, mtime_t i_system );
 
 static mtime_t ClockGetTsOffset( input_clock_t * );
+static mtime_t ClockGetDrift( input_clock_t * );
+static void    ClockLowLatencyUpdate( input_clock_t *,
+                                      mtime_t i_ck_stream, mtime_t i_ck_system );
 
 /*****************************************************************************
  * input_clock_New: create a new clock
@@ -212,6 +244,9 @@ input_clock_t *input_clock_New( int i_rate )
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
         cl->late.pi_value[i] = 0;
 
+    cl->low_latency.i_target = 0;
+    cl->low_latency.b_active = false;
+
     cl->i_rate = i_rate;
     cl->i_pts_delay = 0;
     cl->b_paused = false;
@@ -272,6 +307,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     {
         cl->i_next_drift_update = VLC_TS_INVALID;
         AvgReset( &cl->drift );
+        cl->low_latency.b_active = false;
 
         /* Feed synchro with a new reference point. */
         cl->b_has_reference = true;
@@ -282,7 +318,11 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
     /* Compute the drift between the stream clock and the system clock
      * when we don't control the source pace */
-    if( !b_can_pace_control && cl->i_next_drift_update < i_ck_system )
+    if( !b_can_pace_control && cl->low_latency.i_target > 0 )
+    {
+        ClockLowLatencyUpdate( cl, i_ck_stream, i_ck_system );
+    }
+    else if( !b_can_pace_control && cl->i_next_drift_update < i_ck_system )
     {
         const mtime_t i_converted = ClockSystemToStream( cl, i_ck_system );
 
@@ -314,9 +354,13 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
     /* It does not take the decoder latency into account but it is not really
      * the goal of the clock here */
-    const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + AvgGet( &cl->drift ) );
+    const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + ClockGetDrift( cl ) );
     const mtime_t i_late = ( i_ck_system - cl->i_pts_delay ) - i_system_expected;
-    *pb_late = i_late > 0;
+    /* In low latency mode, small lateness is absorbed by the adaptive delay */
+    if( cl->low_latency.b_active )
+        *pb_late = i_late > cl->i_pts_delay;
+    else
+        *pb_late = i_late > 0;
     if( i_late > 0 )
     {
         cl->late.pi_value[cl->late.i_index] = i_late;
@@ -394,7 +438,7 @@ mtime_t input_clock_GetWakeup( input_clock_t *cl )
 
     /* Synchronized, we can wait */
     if( cl->b_has_reference )
-        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + AvgGet( &cl->drift ) - cl->i_buffering_duration );
+        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + ClockGetDrift( cl ) - cl->i_buffering_duration );
 
     vlc_mutex_unlock( &cl->lock );
 
@@ -430,7 +474,7 @@ int input_clock_ConvertTS( input_clock_t *cl,
     /* */
     if( *pi_ts0 > VLC_TS_INVALID )
     {
-        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + AvgGet( &cl->drift ) );
+        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + ClockGetDrift( cl ) );
         if( *pi_ts0 > cl->i_ts_max )
             cl->i_ts_max = *pi_ts0;
         *pi_ts0 += i_ts_delay;
@@ -439,7 +483,7 @@ int input_clock_ConvertTS( input_clock_t *cl,
     /* XXX we do not ipdate i_ts_max on purpose */
     if( pi_ts1 && *pi_ts1 > VLC_TS_INVALID )
     {
-        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + AvgGet( &cl->drift ) ) +
+        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + ClockGetDrift( cl ) ) +
                   i_ts_delay;
     }
 
@@ -590,6 +634,22 @@ mtime_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+void input_clock_SetLowLatency( input_clock_t *cl, mtime_t i_target )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    cl->low_latency.i_target = __MAX( i_target, 0 );
+    if( cl->low_latency.i_target <= 0 && cl->low_latency.b_active )
+    {
+        /* Keep the current conversion until the next drift update */
+        AvgReset( &cl->drift );
+        AvgUpdate( &cl->drift, cl->low_latency.i_drift );
+        cl->low_latency.b_active = false;
+    }
+
+    vlc_mutex_unlock( &cl->lock );
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
@@ -623,6 +683,87 @@ static mtime_t ClockGetTsOffset( input_clock_t *cl )
     return cl->i_pts_delay * ( cl->i_rate - INPUT_RATE_DEFAULT ) / INPUT_RATE_DEFAULT;
 }
 
+/**
+ * It returns the drift to apply to the stream clock before conversion.
+ */
+static mtime_t ClockGetDrift( input_clock_t *cl )
+{
+    if( cl->low_latency.b_active )
+        return cl->low_latency.i_drift;
+    return AvgGet( &cl->drift );
+}
+
+/**
+ * It moves i_value toward i_target by at most a fraction of i_elapsed.
+ */
+static mtime_t ClockSlew( mtime_t i_value, mtime_t i_target, mtime_t i_elapsed )
+{
+    if( i_target > i_value )
+        return __MIN( i_target, i_value + i_elapsed / CR_LOW_LATENCY_SLEW_UP );
+    return __MAX( i_target, i_value - i_elapsed / CR_LOW_LATENCY_SLEW_DOWN );
+}
+
+/**
+ * It updates the low latency state with a new clock reference.
+ *
+ * The drift follows the minimum of the delays of the clock references over
+ * the last few seconds (ie the least delayed ones) instead of their average,
+ * and the pts_delay follows the spread of those delays (the jitter) but not
+ * below the requested target. Both are changed slowly.
+ */
+static void ClockLowLatencyUpdate( input_clock_t *cl,
+                                   mtime_t i_ck_stream, mtime_t i_ck_system )
+{
+    const mtime_t i_delay = ClockSystemToStream( cl, i_ck_system ) - i_ck_stream;
+
+    if( !cl->low_latency.b_active )
+    {
+        cl->low_latency.b_active = true;
+        cl->low_latency.i_drift = AvgGet( &cl->drift );
+        cl->low_latency.i_last = i_ck_system;
+        for( unsigned i = 0; i < CR_LOW_LATENCY_WINDOWS; i++ )
+        {
+            cl->low_latency.pi_min[i] = i_delay;
+            cl->low_latency.pi_max[i] = i_delay;
+        }
+        cl->low_latency.i_window = 0;
+        cl->low_latency.i_window_end = i_ck_system + CR_LOW_LATENCY_WINDOW;
+    }
+
+    /* Update the envelope */
+    unsigned i_window = cl->low_latency.i_window;
+    if( i_ck_system >= cl->low_latency.i_window_end )
+    {
+        i_window = ( i_window + 1 ) % CR_LOW_LATENCY_WINDOWS;
+        cl->low_latency.pi_min[i_window] = i_delay;
+        cl->low_latency.pi_max[i_window] = i_delay;
+        cl->low_latency.i_window = i_window;
+        cl->low_latency.i_window_end = i_ck_system + CR_LOW_LATENCY_WINDOW;
+    }
+    else
+    {
+        cl->low_latency.pi_min[i_window] = __MIN( cl->low_latency.pi_min[i_window], i_delay );
+        cl->low_latency.pi_max[i_window] = __MAX( cl->low_latency.pi_max[i_window], i_delay );
+    }
+
+    mtime_t i_min = cl->low_latency.pi_min[0];
+    mtime_t i_max = cl->low_latency.pi_max[0];
+    for( unsigned i = 1; i < CR_LOW_LATENCY_WINDOWS; i++ )
+    {
+        i_min = __MIN( i_min, cl->low_latency.pi_min[i] );
+        i_max = __MAX( i_max, cl->low_latency.pi_max[i] );
+    }
+
+    /* Move toward the envelope and the needed delay */
+    const mtime_t i_pts_delay = __MAX( cl->low_latency.i_target,
+                                       i_max - i_min + CR_LOW_LATENCY_MARGIN );
+    const mtime_t i_elapsed = __MAX( i_ck_system - cl->low_latency.i_last, 0 );
+
+    cl->low_latency.i_drift = ClockSlew( cl->low_latency.i_drift, i_min, i_elapsed );
+    cl->i_pts_delay = ClockSlew( cl->i_pts_delay, i_pts_delay, i_elapsed );
+    cl->low_latency.i_last = i_ck_system;
+}
+
 /*****************************************************************************
  * Long term average helpers
  *****************************************************************************/
@@ -135,4 +135,15 @@ void input_clock_SetJitter( input_clock_t *,
  */
 mtime_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function enables the low latency mode when i_target is not 0.
+ *
+ * When the source pace cannot be controlled, the clock then follows the
+ * least delayed clock references instead of their average, and slowly moves
+ * the pts_delay toward i_target (or the observed jitter if it is larger).
+ * In this mode, input_clock_Update only reports a late clock reference when
+ * it is more than pts_delay late.
+ */
+void input_clock_SetLowLatency( input_clock_t *, mtime_t i_target );
+
 #endif
@@ -480,6 +480,15 @@ int input_vaControl( input_thread_t *p_input, int i_query, va_list args )
                                    pp_decoder, pp_vout, pp_aout );
         }
 
+        case INPUT_GET_ES_LATENCY:
+        {
+            const int i_id = va_arg( args, int );
+            input_latency_t *p_latency = va_arg( args, input_latency_t * );
+
+            return es_out_Control( p_input->p->p_es_out_display, ES_OUT_GET_ES_LATENCY_BY_ID, i_id,
+                                   p_latency );
+        }
+
         case INPUT_GET_PCR_SYSTEM:
         {
             mtime_t *pi_system = va_arg( args, mtime_t * );
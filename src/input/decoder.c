@@ -42,6 +42,7 @@
 #include <vlc_meta.h>
 #include <vlc_dialog.h>
 #include <vlc_modules.h>
+#include <vlc_memstat.h>
 
 #include "audio_output/aout_internal.h"
 #include "stream_output/stream_output.h"
@@ -59,12 +60,19 @@ static decoder_t *CreateDecoder( vlc_object_t *, input_thread_t *,
 static void       DeleteDecoder( decoder_t * );
 
 static void      *DecoderThread( void * );
+static void       DecoderPoolAdd( decoder_t *, unsigned i_threads );
+static void       DecoderPoolRemove( decoder_t * );
+static void       DecoderPoolSchedule( decoder_t * );
+static void       DecoderPoolBlocked( decoder_t *, bool );
+static bool       DecoderIsExitRequested( decoder_t * );
 static void       DecoderProcess( decoder_t *, block_t * );
 static void       DecoderError( decoder_t *p_dec, block_t *p_block );
 static void       DecoderOutputChangePause( decoder_t *, bool b_paused, mtime_t i_date );
 static void       DecoderFlush( decoder_t * );
 static void       DecoderSignalBuffering( decoder_t *, bool );
 static void       DecoderFlushBuffering( decoder_t * );
+static void       DecoderResetState( decoder_t * );
+static block_t   *DecoderBlockFlushNew( void );
 
 static void       DecoderUnsupportedCodec( decoder_t *, vlc_fourcc_t );
 
@@ -79,6 +87,9 @@ static void vout_unlink_picture( decoder_t *, picture_t * );
 static subpicture_t *spu_new_buffer( decoder_t *, const subpicture_updater_t * );
 static void spu_del_buffer( decoder_t *, subpicture_t * );
 
+/* Number of fifo blocks whose queuing date is remembered */
+#define DECODER_TRACE_SLOTS (256)
+
 struct decoder_owner_sys_t
 {
     int64_t         i_preroll_end;
@@ -97,6 +108,20 @@ struct decoder_owner_sys_t
 
     vlc_thread_t     thread;
 
+    /* Shared worker threads, used instead of the thread above */
+    struct
+    {
+        bool b_enabled;
+        /* -- These variables need the pool lock -- */
+        bool b_queued;  /* Waiting in the run queue */
+        bool b_running; /* Being run by a worker */
+        bool b_again;   /* Got work while running */
+        bool b_removed;
+        decoder_t *p_next;
+        /* -- This one needs p_owner->lock -- */
+        bool b_wake;    /* See input_DecoderWaitBuffering() */
+    } pool;
+
     /* Some decoders require already packetized data (ie. not truncated) */
     decoder_t *p_packetizer;
     bool b_packetizer;
@@ -169,6 +194,28 @@ struct decoder_owner_sys_t
 
     /* Delay */
     mtime_t i_ts_delay;
+
+    /* Pictures lost by the video output since the last
+     * decoder_GetDisplayLost() (only used by the decoder) */
+    int i_display_lost;
+
+    /* Latency tracing (only when statistics are enabled) */
+    struct
+    {
+        bool b_enabled;
+        /* -- These variables are only used by the decoder -- */
+        mtime_t i_decode;   /* Time spent in the decoder for the block */
+        bool    b_decode;
+        mtime_t i_decoded;  /* Date of the last decoded output */
+        /* -- These variables need trace.lock -- */
+        vlc_mutex_t lock;
+        struct
+        {
+            const block_t *p_block;
+            mtime_t       i_date;
+        } queued[DECODER_TRACE_SLOTS];
+        input_latency_t stats;
+    } trace;
 };
 
 #define DECODER_MAX_BUFFERING_COUNT (4)
@@ -182,6 +229,190 @@ struct decoder_owner_sys_t
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 
+/*****************************************************************************
+ * Latency tracing
+ *****************************************************************************/
+static void DecoderTraceAddLocked( decoder_t *p_dec,
+                                   enum input_latency_stage_e i_stage,
+                                   mtime_t i_duration )
+{
+    input_latency_t *p_stats = &p_dec->p_owner->trace.stats;
+    unsigned i_bucket = 0;
+
+    if( i_duration < 0 )
+        i_duration = 0;
+    while( i_bucket < INPUT_LATENCY_BUCKETS - 1 &&
+           i_duration >= ((mtime_t)INPUT_LATENCY_BASE << i_bucket) )
+        i_bucket++;
+
+    p_stats->pi_count[i_stage][i_bucket]++;
+    p_stats->pi_total[i_stage] += i_duration;
+    if( i_duration > p_stats->pi_max[i_stage] )
+        p_stats->pi_max[i_stage] = i_duration;
+}
+
+static void DecoderTraceAdd( decoder_t *p_dec,
+                             enum input_latency_stage_e i_stage,
+                             mtime_t i_duration )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->trace.lock );
+    DecoderTraceAddLocked( p_dec, i_stage, i_duration );
+    vlc_mutex_unlock( &p_owner->trace.lock );
+}
+
+static unsigned DecoderTraceSlot( const block_t *p_block )
+{
+    return ((uintptr_t)p_block / sizeof(void *)) % DECODER_TRACE_SLOTS;
+}
+
+/* Remembers when a block entered the fifo */
+static void DecoderTraceQueued( decoder_t *p_dec, const block_t *p_block,
+                                mtime_t i_entry )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const mtime_t i_now = mdate();
+
+    vlc_mutex_lock( &p_owner->trace.lock );
+    DecoderTraceAddLocked( p_dec, INPUT_LATENCY_DEMUX, i_now - i_entry );
+
+    /* When the table is full, the block is simply not traced */
+    unsigned i_slot = DecoderTraceSlot( p_block );
+    for( unsigned i = 0; i < DECODER_TRACE_SLOTS; i++ )
+    {
+        if( p_owner->trace.queued[i_slot].p_block == NULL )
+        {
+            p_owner->trace.queued[i_slot].p_block = p_block;
+            p_owner->trace.queued[i_slot].i_date = i_now;
+            break;
+        }
+        i_slot = (i_slot + 1) % DECODER_TRACE_SLOTS;
+    }
+    vlc_mutex_unlock( &p_owner->trace.lock );
+}
+
+/* Accounts the time a block spent in the fifo */
+static void DecoderTraceDequeued( decoder_t *p_dec, const block_t *p_block )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const mtime_t i_now = mdate();
+
+    vlc_mutex_lock( &p_owner->trace.lock );
+    unsigned i_slot = DecoderTraceSlot( p_block );
+    for( unsigned i = 0; i < DECODER_TRACE_SLOTS; i++ )
+    {
+        if( p_owner->trace.queued[i_slot].p_block == p_block )
+        {
+            p_owner->trace.queued[i_slot].p_block = NULL;
+            DecoderTraceAddLocked( p_dec, INPUT_LATENCY_FIFO,
+                               i_now - p_owner->trace.queued[i_slot].i_date );
+            break;
+        }
+        if( p_owner->trace.queued[i_slot].p_block == NULL )
+            break;
+        i_slot = (i_slot + 1) % DECODER_TRACE_SLOTS;
+    }
+    vlc_mutex_unlock( &p_owner->trace.lock );
+}
+
+/* Forgets about the blocks in the fifo (it must be emptied afterward) */
+static void DecoderTraceFlush( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( !p_owner->trace.b_enabled )
+        return;
+
+    vlc_mutex_lock( &p_owner->trace.lock );
+    for( unsigned i = 0; i < DECODER_TRACE_SLOTS; i++ )
+        p_owner->trace.queued[i].p_block = NULL;
+    vlc_mutex_unlock( &p_owner->trace.lock );
+}
+
+static mtime_t DecoderTraceBegin( decoder_t *p_dec )
+{
+    return p_dec->p_owner->trace.b_enabled ? mdate() : vlc_trace_Begin();
+}
+
+/* Records a pipeline span of the ES of p_dec (see vlc_trace_End()) */
+static void DecoderTraceSpan( decoder_t *p_dec, mtime_t i_begin,
+                              const char *psz_name )
+{
+    char psz_fourcc[5];
+
+    memcpy( psz_fourcc, &p_dec->fmt_in.i_codec, 4 );
+    psz_fourcc[4] = '\0';
+    vlc_trace_End( i_begin, "codec", psz_name, psz_fourcc );
+}
+
+/* Accounts one call to the decoder started at i_begin */
+static void DecoderTraceDecoded( decoder_t *p_dec, mtime_t i_begin )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    DecoderTraceSpan( p_dec, i_begin, "decode" );
+    if( !p_owner->trace.b_enabled )
+        return;
+
+    const mtime_t i_now = mdate();
+    p_owner->trace.i_decode += i_now - i_begin;
+    p_owner->trace.b_decode = true;
+    p_owner->trace.i_decoded = i_now;
+}
+
+static block_t *DecoderPacketize( decoder_t *p_packetizer, block_t **pp_block )
+{
+    const mtime_t i_begin = vlc_trace_Begin();
+    block_t *p_out = p_packetizer->pf_packetize( p_packetizer, pp_block );
+
+    DecoderTraceSpan( p_packetizer, i_begin, "packetize" );
+    return p_out;
+}
+
+/* Accounts an output buffer handed to the output at date i_date */
+static void DecoderTraceOutput( decoder_t *p_dec, mtime_t i_date )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( !p_owner->trace.b_enabled )
+        return;
+
+    const mtime_t i_now = mdate();
+    vlc_mutex_lock( &p_owner->trace.lock );
+    if( p_owner->trace.i_decoded > VLC_TS_INVALID )
+        DecoderTraceAddLocked( p_dec, INPUT_LATENCY_QUEUE,
+                               i_now - p_owner->trace.i_decoded );
+    if( i_date > VLC_TS_INVALID )
+        DecoderTraceAddLocked( p_dec, INPUT_LATENCY_DISPLAY, i_date - i_now );
+    vlc_mutex_unlock( &p_owner->trace.lock );
+}
+
+static void DecoderTraceDump( decoder_t *p_dec )
+{
+    static const char *const ppsz_stage[INPUT_LATENCY_STAGES] = {
+        "demux", "fifo", "decode", "queue", "display",
+    };
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const input_latency_t *p_stats = &p_owner->trace.stats;
+
+    if( !p_owner->trace.b_enabled )
+        return;
+
+    for( unsigned i = 0; i < INPUT_LATENCY_STAGES; i++ )
+    {
+        uint64_t i_count = 0;
+        for( unsigned j = 0; j < INPUT_LATENCY_BUCKETS; j++ )
+            i_count += p_stats->pi_count[i][j];
+        if( i_count == 0 )
+            continue;
+
+        msg_Dbg( p_dec, "%s latency: %"PRIu64" samples, mean %"PRId64
+                 " us, max %"PRId64" us", ppsz_stage[i], i_count,
+                 p_stats->pi_total[i] / (mtime_t)i_count, p_stats->pi_max[i] );
+    }
+}
+
 
 /*****************************************************************************
  * Public functions
@@ -256,8 +487,117 @@ int decoder_GetDisplayRate( decoder_t *p_dec )
 
     return p_dec->pf_get_display_rate( p_dec );
 }
+/* decoder_GetDisplayLost:
+ */
+int decoder_GetDisplayLost( decoder_t *p_dec )
+{
+    if( !p_dec->pf_get_display_lost )
+        return 0;
+
+    return p_dec->pf_get_display_lost( p_dec );
+}
 
 /* TODO: pass p_sout through p_resource? -- Courmisch */
+/* Video decoders (hardware ones in particular) are slow to open: the decoder
+ * of an input which ends is kept in the input resource, and the next input
+ * takes it over if its video format is the same (see "decoder-reuse"). */
+static bool DecoderCanReuse( const decoder_t *p_dec, const es_format_t *fmt )
+{
+    const es_format_t *p_fmt = &p_dec->fmt_in;
+
+    return p_fmt->i_cat == fmt->i_cat && p_fmt->i_codec == fmt->i_codec
+        && p_fmt->i_original_fourcc == fmt->i_original_fourcc
+        && p_fmt->b_packetized == fmt->b_packetized
+        && p_fmt->video.i_width == fmt->video.i_width
+        && p_fmt->video.i_height == fmt->video.i_height
+        && p_fmt->i_extra == fmt->i_extra
+        && ( fmt->i_extra == 0
+          || !memcmp( p_fmt->p_extra, fmt->p_extra, fmt->i_extra ) );
+}
+
+/* Drops the pictures and references left in the modules */
+static void DecoderModuleFlush( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    decoder_t *p_packetizer = p_owner->p_packetizer;
+    block_t *p_null;
+
+    if( p_packetizer != NULL && (p_null = DecoderBlockFlushNew()) != NULL )
+    {
+        block_t *p_out;
+        while( (p_out = p_packetizer->pf_packetize( p_packetizer, &p_null )) )
+            block_ChainRelease( p_out );
+    }
+
+    if( (p_null = DecoderBlockFlushNew()) != NULL )
+    {
+        picture_t *p_pic;
+        while( (p_pic = p_dec->pf_decode_video( p_dec, &p_null )) )
+            vout_ReleasePicture( p_owner->p_vout, p_pic );
+    }
+}
+
+/**
+ * Hands a stopped decoder over to the input resource instead of deleting it.
+ * \return true if the decoder was kept
+ */
+static bool DecoderPark( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->p_input == NULL || p_owner->b_packetizer
+     || p_owner->p_sout != NULL || p_dec->fmt_in.i_cat != VIDEO_ES
+     || p_dec->b_error || p_dec->pf_decode_video == NULL
+     || !var_InheritBool( p_dec, "decoder-reuse" ) )
+        return false;
+
+    DecoderModuleFlush( p_dec );
+    block_FifoEmpty( p_owner->p_fifo );
+
+    vlc_mutex_lock( &p_owner->lock );
+    DecoderFlushBuffering( p_dec );
+    vout_thread_t *p_vout = p_owner->p_vout;
+    p_owner->p_vout = NULL;
+    vlc_mutex_unlock( &p_owner->lock );
+
+    /* The video output is recycled as if the decoder was deleted */
+    if( p_vout != NULL )
+    {
+        vout_Reset( p_vout );
+        input_resource_RequestVout( p_owner->p_resource, p_vout, NULL, 0,
+                                    true );
+        input_SendEventVout( p_owner->p_input );
+    }
+
+    msg_Dbg( p_dec, "keeping decoder fourcc `%4.4s' for the next input",
+             (char *)&p_dec->fmt_in.i_codec );
+    p_owner->p_input = NULL;
+    input_resource_PutDecoder( p_owner->p_resource, p_dec );
+    return true;
+}
+
+static decoder_t *DecoderUnpark( input_thread_t *p_input,
+                                 const es_format_t *fmt,
+                                 input_resource_t *p_resource )
+{
+    decoder_t *p_dec = input_resource_TakeDecoder( p_resource );
+    if( p_dec == NULL )
+        return NULL;
+
+    if( !DecoderCanReuse( p_dec, fmt ) )
+    {
+        input_DecoderDiscard( p_dec );
+        return NULL;
+    }
+
+    p_dec->p_owner->p_input = p_input;
+    p_dec->b_error = false;
+    DecoderResetState( p_dec );
+    msg_Dbg( p_dec, "reusing decoder fourcc `%4.4s'",
+             (char *)&p_dec->fmt_in.i_codec );
+    return p_dec;
+}
+
 static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
                                es_format_t *fmt, input_clock_t *p_clock,
                                input_resource_t *p_resource,
@@ -267,9 +607,15 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     const char *psz_type = p_sout ? N_("packetizer") : N_("decoder");
     int i_priority;
 
+    /* Reuse the decoder of the previous input if possible */
+    if( p_input != NULL && p_sout == NULL && fmt->i_cat == VIDEO_ES
+     && var_InheritBool( p_parent, "decoder-reuse" ) )
+        p_dec = DecoderUnpark( p_input, fmt, p_resource );
+
     /* Create the decoder configuration structure */
-    p_dec = CreateDecoder( p_parent, p_input, fmt,
-                           p_sout != NULL, p_resource, p_sout );
+    if( p_dec == NULL )
+        p_dec = CreateDecoder( p_parent, p_input, fmt,
+                               p_sout != NULL, p_resource, p_sout );
     if( p_dec == NULL )
     {
         msg_Err( p_parent, "could not create %s", psz_type );
@@ -295,6 +641,15 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     else
         i_priority = VLC_THREAD_PRIORITY_VIDEO;
 
+    /* Lightweight decoders can share threads, video keeps its own */
+    const int i_pool = var_InheritInteger( p_parent, "decoder-pool" );
+    if( i_pool > 0 && p_sout == NULL
+     && ( p_dec->fmt_out.i_cat == AUDIO_ES || p_dec->fmt_out.i_cat == SPU_ES ) )
+    {
+        DecoderPoolAdd( p_dec, i_pool );
+        return p_dec;
+    }
+
     /* Spawn the decoder thread */
     if( vlc_clone( &p_dec->p_owner->thread, DecoderThread, p_dec, i_priority ) )
     {
@@ -344,7 +699,8 @@ void input_DecoderDelete( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-    vlc_cancel( p_owner->thread );
+    if( !p_owner->pool.b_enabled )
+        vlc_cancel( p_owner->thread );
 
     /* Make sure we aren't paused/buffering/waiting/decoding anymore */
     vlc_mutex_lock( &p_owner->lock );
@@ -356,10 +712,13 @@ void input_DecoderDelete( decoder_t *p_dec )
     vlc_cond_signal( &p_owner->wait_request );
     vlc_mutex_unlock( &p_owner->lock );
 
-    vlc_join( p_owner->thread, NULL );
+    if( p_owner->pool.b_enabled )
+        DecoderPoolRemove( p_dec );
+    else
+        vlc_join( p_owner->thread, NULL );
     p_owner->b_paused = b_was_paused;
 
-    module_unneed( p_dec, p_dec->p_module );
+    DecoderTraceDump( p_dec );
 
     /* */
     if( p_dec->p_owner->cc.b_supported )
@@ -369,10 +728,24 @@ void input_DecoderDelete( decoder_t *p_dec )
             input_DecoderSetCcState( p_dec, false, i );
     }
 
+    if( DecoderPark( p_dec ) )
+        return;
+
+    module_unneed( p_dec, p_dec->p_module );
+
     /* Delete decoder */
     DeleteDecoder( p_dec );
 }
 
+/**
+ * Destroys a decoder kept for reuse by the input resource
+ */
+void input_DecoderDiscard( decoder_t *p_dec )
+{
+    module_unneed( p_dec, p_dec->p_module );
+    DeleteDecoder( p_dec );
+}
+
 /**
  * Put a block_t in the decoder's fifo.
  * Thread-safe w.r.t. the decoder. May be a cancellation point.
@@ -383,6 +756,7 @@ void input_DecoderDelete( decoder_t *p_dec )
 void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const mtime_t i_entry = DecoderTraceBegin( p_dec );
 
     if( b_do_pace )
     {
@@ -403,10 +777,24 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
          * in the FIFO instead of its size. */
         msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
                   "consumed quickly enough), resetting fifo!" );
+        DecoderTraceFlush( p_dec );
         block_FifoEmpty( p_owner->p_fifo );
     }
 
+    if( p_owner->trace.b_enabled )
+        DecoderTraceQueued( p_dec, p_block, i_entry );
     block_FifoPut( p_owner->p_fifo, p_block );
+    if( p_owner->pool.b_enabled )
+        DecoderPoolSchedule( p_dec );
+}
+
+/* The demuxer reached the end of the stream: the remaining audio may be
+ * spliced with the next input (see "audio-preroll") */
+static bool DecoderIsEndOfStream( decoder_t *p_dec )
+{
+    input_thread_t *p_input = p_dec->p_owner->p_input;
+
+    return p_input != NULL && p_input->p->input.b_eof;
 }
 
 bool input_DecoderIsEmpty( decoder_t * p_dec )
@@ -422,7 +810,8 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
         if( p_dec->fmt_out.i_cat == VIDEO_ES && p_owner->p_vout )
             b_empty = vout_IsEmpty( p_owner->p_vout );
         else if( p_dec->fmt_out.i_cat == AUDIO_ES && p_owner->p_aout )
-            b_empty = aout_DecIsEmpty( p_owner->p_aout );
+            b_empty = aout_DecIsEmpty( p_owner->p_aout,
+                                       DecoderIsEndOfStream( p_dec ) );
         vlc_mutex_unlock( &p_owner->lock );
     }
     return b_empty;
@@ -595,7 +984,13 @@ void input_DecoderWaitBuffering( decoder_t *p_dec )
 
     while( p_owner->b_buffering && !p_owner->buffer.b_full )
     {
-        block_FifoWake( p_owner->p_fifo );
+        if( p_owner->pool.b_enabled )
+        {
+            p_owner->pool.b_wake = true;
+            DecoderPoolSchedule( p_dec );
+        }
+        else
+            block_FifoWake( p_owner->p_fifo );
         vlc_cond_wait( &p_owner->wait_acknowledge, &p_owner->lock );
     }
 
@@ -635,8 +1030,13 @@ bool input_DecoderHasFormatChanged( decoder_t *p_dec, es_format_t *p_fmt, vlc_me
     b_changed = p_owner->b_fmt_description;
     if( b_changed )
     {
+        /* The description is rebuilt on the next format update, so hand it
+         * over instead of duplicating it */
         if( p_fmt )
-            es_format_Copy( p_fmt, &p_owner->fmt_description );
+        {
+            *p_fmt = p_owner->fmt_description;
+            es_format_Init( &p_owner->fmt_description, UNKNOWN_ES, 0 );
+        }
 
         if( pp_meta )
         {
@@ -661,6 +1061,15 @@ size_t input_DecoderGetFifoSize( decoder_t *p_dec )
     return block_FifoSize( p_owner->p_fifo );
 }
 
+void input_DecoderGetLatency( decoder_t *p_dec, input_latency_t *p_latency )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->trace.lock );
+    *p_latency = p_owner->trace.stats;
+    vlc_mutex_unlock( &p_owner->trace.lock );
+}
+
 void input_DecoderGetObjects( decoder_t *p_dec,
                               vout_thread_t **pp_vout, audio_output_t **pp_aout )
 {
@@ -713,6 +1122,14 @@ static int DecoderGetDisplayRate( decoder_t *p_dec )
         return INPUT_RATE_DEFAULT;
     return input_clock_GetRate( p_owner->p_clock );
 }
+static int DecoderGetDisplayLost( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const int i_lost = p_owner->i_display_lost;
+
+    p_owner->i_display_lost = 0;
+    return i_lost;
+}
 
 /* */
 static void DecoderUnsupportedCodec( decoder_t *p_dec, vlc_fourcc_t codec )
@@ -735,6 +1152,59 @@ static void DecoderUnsupportedCodec( decoder_t *p_dec, vlc_fourcc_t codec )
  * \param b_packetizer instead of a decoder
  * \return the decoder object
  */
+/**
+ * (Re)initializes the state of a decoder which is not running
+ */
+static void DecoderResetState( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    input_thread_t *p_input = p_owner->p_input;
+
+    p_owner->i_preroll_end = VLC_TS_INVALID;
+    p_owner->i_last_rate = INPUT_RATE_DEFAULT;
+
+    p_owner->b_exit = false;
+
+    p_owner->b_paused = false;
+    p_owner->pause.i_date = VLC_TS_INVALID;
+    p_owner->pause.i_ignore = 0;
+
+    p_owner->b_buffering = false;
+    p_owner->buffer.b_first = true;
+    p_owner->buffer.b_full = false;
+    p_owner->buffer.i_count = 0;
+    p_owner->buffer.p_picture = NULL;
+    p_owner->buffer.p_subpic = NULL;
+    p_owner->buffer.p_audio = NULL;
+    p_owner->buffer.p_block = NULL;
+
+    p_owner->b_flushing = false;
+
+    p_owner->pool.b_enabled = false;
+    p_owner->pool.b_queued = false;
+    p_owner->pool.b_running = false;
+    p_owner->pool.b_again = false;
+    p_owner->pool.b_removed = false;
+    p_owner->pool.p_next = NULL;
+    p_owner->pool.b_wake = false;
+
+    p_owner->trace.b_enabled = p_input != NULL && libvlc_stats( p_input );
+    p_owner->trace.i_decode = 0;
+    p_owner->trace.b_decode = false;
+    p_owner->trace.i_decoded = VLC_TS_INVALID;
+    for( unsigned i = 0; i < DECODER_TRACE_SLOTS; i++ )
+        p_owner->trace.queued[i].p_block = NULL;
+    memset( &p_owner->trace.stats, 0, sizeof(p_owner->trace.stats) );
+
+    for( unsigned i = 0; i < 4; i++ )
+    {
+        p_owner->cc.pb_present[i] = false;
+        p_owner->cc.pp_decoder[i] = NULL;
+    }
+    p_owner->i_ts_delay = 0;
+    p_owner->i_display_lost = 0;
+}
+
 static decoder_t * CreateDecoder( vlc_object_t *p_parent,
                                   input_thread_t *p_input,
                                   es_format_t *fmt, bool b_packetizer,
@@ -771,8 +1241,6 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         vlc_object_release( p_dec );
         return NULL;
     }
-    p_owner->i_preroll_end = VLC_TS_INVALID;
-    p_owner->i_last_rate = INPUT_RATE_DEFAULT;
     p_owner->p_input = p_input;
     p_owner->p_resource = p_resource;
     p_owner->p_aout = NULL;
@@ -786,7 +1254,9 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->b_packetizer = b_packetizer;
 
     /* decoder fifo */
-    p_owner->p_fifo = block_FifoNew();
+    /* Only the input (under the ES out lock) queues, and only the decoder
+     * thread dequeues: use the lock-free queue. */
+    p_owner->p_fifo = block_FifoNewSPSC();
     if( unlikely(p_owner->p_fifo == NULL) )
     {
         free( p_owner );
@@ -806,6 +1276,7 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_dec->pf_get_attachments  = DecoderGetInputAttachments;
     p_dec->pf_get_display_date = DecoderGetDisplayDate;
     p_dec->pf_get_display_rate = DecoderGetDisplayRate;
+    p_dec->pf_get_display_lost = DecoderGetDisplayLost;
 
     /* Find a suitable decoder/packetizer module */
     if( !b_packetizer )
@@ -866,22 +1337,8 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     es_format_Init( &p_owner->fmt_description, UNKNOWN_ES, 0 );
     p_owner->p_description = NULL;
 
-    p_owner->b_exit = false;
-
-    p_owner->b_paused = false;
-    p_owner->pause.i_date = VLC_TS_INVALID;
-    p_owner->pause.i_ignore = 0;
-
-    p_owner->b_buffering = false;
-    p_owner->buffer.b_first = true;
-    p_owner->buffer.b_full = false;
-    p_owner->buffer.i_count = 0;
-    p_owner->buffer.p_picture = NULL;
-    p_owner->buffer.p_subpic = NULL;
-    p_owner->buffer.p_audio = NULL;
-    p_owner->buffer.p_block = NULL;
-
-    p_owner->b_flushing = false;
+    vlc_mutex_init( &p_owner->trace.lock );
+    DecoderResetState( p_dec );
 
     /* */
     p_owner->cc.b_supported = false;
@@ -893,13 +1350,38 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
             p_owner->cc.b_supported = true;
     }
 
-    for( unsigned i = 0; i < 4; i++ )
+    return p_dec;
+}
+
+/**
+ * Decodes one block taken from the fifo
+ */
+static void DecoderRunBlock( decoder_t *p_dec, block_t *p_block )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->trace.b_enabled )
+        DecoderTraceDequeued( p_dec, p_block );
+
+    if( p_block->i_flags & BLOCK_FLAG_CORE_EOS )
     {
-        p_owner->cc.pb_present[i] = false;
-        p_owner->cc.pp_decoder[i] = NULL;
+        /* calling DecoderProcess() with NULL block will make
+         * decoders/packetizers flush their buffers */
+        block_Release( p_block );
+        p_block = NULL;
+    }
+
+    if( p_dec->b_error )
+        DecoderError( p_dec, p_block );
+    else
+        DecoderProcess( p_dec, p_block );
+
+    if( p_owner->trace.b_decode )
+    {
+        DecoderTraceAdd( p_dec, INPUT_LATENCY_DECODE, p_owner->trace.i_decode );
+        p_owner->trace.i_decode = 0;
+        p_owner->trace.b_decode = false;
     }
-    p_owner->i_ts_delay = 0;
-    return p_dec;
 }
 
 /**
@@ -912,6 +1394,8 @@ static void *DecoderThread( void *p_data )
     decoder_t *p_dec = (decoder_t *)p_data;
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    vlc_mem_SetAccount( module_get_object( p_dec->p_module ) );
+
     /* The decoder's main loop */
     for( ;; )
     {
@@ -924,26 +1408,227 @@ static void *DecoderThread( void *p_data )
         if( p_block )
         {
             int canc = vlc_savecancel();
+            DecoderRunBlock( p_dec, p_block );
+            vlc_restorecancel( canc );
+        }
+    }
+    return NULL;
+}
 
-            if( p_block->i_flags & BLOCK_FLAG_CORE_EOS )
-            {
-                /* calling DecoderProcess() with NULL block will make
-                 * decoders/packetizers flush their buffers */
-                block_Release( p_block );
-                p_block = NULL;
-            }
+/*****************************************************************************
+ * Shared decoder threads
+ *****************************************************************************
+ * Decoders with a light load (audio, subtitles) can be run by a process-wide
+ * set of worker threads instead of one thread each. A decoder is in the run
+ * queue when its fifo may have data, and is run by at most one worker at a
+ * time, so its blocks are still decoded in order.
+ *
+ * Decoders may block (pause, buffering, waiting for a date). A blocked
+ * worker does not count against the configured number of threads: another
+ * one is started if there is work to do, and extra workers exit when idle.
+ *****************************************************************************/
+#define DECODER_POOL_BATCH (16) /* Blocks decoded before yielding */
 
-            if( p_dec->b_error )
-                DecoderError( p_dec, p_block );
-            else
-                DecoderProcess( p_dec, p_block );
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;      /* Run queue not empty, or no more decoders */
+    vlc_cond_t  wait_done; /* A decoder was run */
+    decoder_t   *p_first;  /* Run queue */
+    decoder_t   **pp_last;
+    unsigned    i_max;     /* Configured number of workers */
+    unsigned    i_threads; /* Live workers */
+    unsigned    i_idle;    /* Workers waiting for work */
+    unsigned    i_blocked; /* Workers blocked in a decoder */
+    unsigned    i_users;   /* Decoders using the pool */
+} decoder_pool = {
+    VLC_STATIC_MUTEX, VLC_STATIC_COND, VLC_STATIC_COND,
+    NULL, &decoder_pool.p_first, 0, 0, 0, 0, 0,
+};
 
-            vlc_restorecancel( canc );
+static void *DecoderPoolThread( void * );
+
+static void DecoderPoolSpawnLocked( void )
+{
+    vlc_assert_locked( &decoder_pool.lock );
+
+    if( decoder_pool.i_idle > 0 )
+    {
+        vlc_cond_signal( &decoder_pool.wait );
+        return;
+    }
+    if( decoder_pool.i_threads - decoder_pool.i_blocked >= decoder_pool.i_max )
+        return;
+    if( vlc_clone_detach( NULL, DecoderPoolThread, NULL,
+                          VLC_THREAD_PRIORITY_AUDIO ) == 0 )
+        decoder_pool.i_threads++;
+}
+
+static void DecoderPoolEnqueueLocked( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_assert_locked( &decoder_pool.lock );
+
+    p_owner->pool.b_queued = true;
+    p_owner->pool.p_next = NULL;
+    *decoder_pool.pp_last = p_dec;
+    decoder_pool.pp_last = &p_owner->pool.p_next;
+
+    DecoderPoolSpawnLocked();
+}
+
+/* Decodes a bounded number of blocks, returns true if some may be left */
+static bool DecoderPoolRun( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mem_SetAccount( module_get_object( p_dec->p_module ) );
+    for( unsigned i = 0; i < DECODER_POOL_BATCH; i++ )
+    {
+        if( DecoderIsExitRequested( p_dec ) )
+            return false;
+
+        /* Never wait for data: there are other decoders to run */
+        block_t *p_block = block_FifoGetBatch( p_owner->p_fifo, 0, VLC_TS_0 );
+        if( p_block == NULL )
+        {
+            /* Same as a wake up of the fifo in DecoderThread() */
+            vlc_mutex_lock( &p_owner->lock );
+            const bool b_wake = p_owner->pool.b_wake;
+            p_owner->pool.b_wake = false;
+            vlc_mutex_unlock( &p_owner->lock );
+
+            if( b_wake )
+                DecoderSignalBuffering( p_dec, true );
+            return false;
         }
+
+        DecoderSignalBuffering( p_dec, false );
+        DecoderRunBlock( p_dec, p_block );
     }
+    return true;
+}
+
+static void *DecoderPoolThread( void *p_data )
+{
+    (void)p_data;
+
+    vlc_mutex_lock( &decoder_pool.lock );
+    for( ;; )
+    {
+        decoder_t *p_dec = decoder_pool.p_first;
+
+        if( p_dec == NULL )
+        {
+            if( decoder_pool.i_users == 0
+             || decoder_pool.i_threads - decoder_pool.i_blocked
+                > decoder_pool.i_max )
+                break;
+
+            decoder_pool.i_idle++;
+            vlc_cond_wait( &decoder_pool.wait, &decoder_pool.lock );
+            decoder_pool.i_idle--;
+            continue;
+        }
+
+        decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+        decoder_pool.p_first = p_owner->pool.p_next;
+        if( decoder_pool.p_first == NULL )
+            decoder_pool.pp_last = &decoder_pool.p_first;
+        p_owner->pool.b_queued = false;
+        p_owner->pool.b_running = true;
+        p_owner->pool.b_again = false;
+        vlc_mutex_unlock( &decoder_pool.lock );
+
+        const bool b_more = DecoderPoolRun( p_dec );
+
+        vlc_mutex_lock( &decoder_pool.lock );
+        p_owner->pool.b_running = false;
+        if( ( b_more || p_owner->pool.b_again ) && !p_owner->pool.b_removed )
+            DecoderPoolEnqueueLocked( p_dec );
+        vlc_cond_broadcast( &decoder_pool.wait_done );
+    }
+    decoder_pool.i_threads--;
+    vlc_cond_broadcast( &decoder_pool.wait_done );
+    vlc_mutex_unlock( &decoder_pool.lock );
     return NULL;
 }
 
+static void DecoderPoolAdd( decoder_t *p_dec, unsigned i_threads )
+{
+    vlc_mutex_lock( &decoder_pool.lock );
+    p_dec->p_owner->pool.b_enabled = true;
+    decoder_pool.i_users++;
+    if( decoder_pool.i_max < i_threads )
+        decoder_pool.i_max = i_threads;
+    vlc_mutex_unlock( &decoder_pool.lock );
+    msg_Dbg( p_dec, "using shared decoder threads" );
+}
+
+static void DecoderPoolRemove( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &decoder_pool.lock );
+    p_owner->pool.b_removed = true;
+    if( p_owner->pool.b_queued )
+    {
+        decoder_t **pp = &decoder_pool.p_first;
+
+        while( *pp != p_dec )
+            pp = &(*pp)->p_owner->pool.p_next;
+        *pp = p_owner->pool.p_next;
+        if( decoder_pool.pp_last == &p_owner->pool.p_next )
+            decoder_pool.pp_last = pp;
+        p_owner->pool.b_queued = false;
+    }
+    while( p_owner->pool.b_running )
+        vlc_cond_wait( &decoder_pool.wait_done, &decoder_pool.lock );
+
+    /* Workers exit with the last decoder */
+    if( --decoder_pool.i_users == 0 )
+    {
+        decoder_pool.i_max = 0;
+        vlc_cond_broadcast( &decoder_pool.wait );
+    }
+    while( decoder_pool.i_users == 0 && decoder_pool.i_threads > 0 )
+        vlc_cond_wait( &decoder_pool.wait_done, &decoder_pool.lock );
+    vlc_mutex_unlock( &decoder_pool.lock );
+}
+
+/* Gets a worker to look at the decoder fifo */
+static void DecoderPoolSchedule( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &decoder_pool.lock );
+    if( p_owner->pool.b_running )
+        p_owner->pool.b_again = true;
+    else if( !p_owner->pool.b_queued && !p_owner->pool.b_removed )
+        DecoderPoolEnqueueLocked( p_dec );
+    vlc_mutex_unlock( &decoder_pool.lock );
+}
+
+/* Tells the pool that the calling worker is about to block, or is done */
+static void DecoderPoolBlocked( decoder_t *p_dec, bool b_blocked )
+{
+    if( !p_dec->p_owner->pool.b_enabled )
+        return;
+
+    vlc_mutex_lock( &decoder_pool.lock );
+    if( b_blocked )
+    {
+        decoder_pool.i_blocked++;
+        if( decoder_pool.p_first != NULL )
+            DecoderPoolSpawnLocked();
+    }
+    else
+        decoder_pool.i_blocked--;
+    vlc_mutex_unlock( &decoder_pool.lock );
+}
+
 static block_t *DecoderBlockFlushNew()
 {
     block_t *p_null = block_Alloc( 128 );
@@ -965,6 +1650,7 @@ static void DecoderFlush( decoder_t *p_dec )
     vlc_assert_locked( &p_owner->lock );
 
     /* Empty the fifo */
+    DecoderTraceFlush( p_dec );
     block_FifoEmpty( p_owner->p_fifo );
 
     /* Monitor for flush end */
@@ -1037,7 +1723,9 @@ static void DecoderWaitUnblock( decoder_t *p_dec, bool *pb_reject )
             if( !p_owner->b_buffering || !p_owner->buffer.b_full )
                 break;
         }
+        DecoderPoolBlocked( p_dec, true );
         vlc_cond_wait( &p_owner->wait_request, &p_owner->lock );
+        DecoderPoolBlocked( p_dec, false );
     }
 
     if( pb_reject )
@@ -1141,6 +1829,7 @@ static void DecoderWaitDate( decoder_t *p_dec,
     if( *pb_reject || i_deadline < 0 )
         return;
 
+    DecoderPoolBlocked( p_dec, true );
     do
     {
         if( p_owner->b_flushing || p_owner->b_exit )
@@ -1151,6 +1840,7 @@ static void DecoderWaitDate( decoder_t *p_dec,
     }
     while( vlc_cond_timedwait( &p_owner->wait_request, &p_owner->lock,
                                i_deadline ) == 0 );
+    DecoderPoolBlocked( p_dec, false );
 }
 
 static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
@@ -1232,6 +1922,7 @@ static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
         if( !b_reject )
         {
             assert( !p_owner->b_paused );
+            DecoderTraceOutput( p_dec, p_audio->i_pts );
             if( !aout_DecPlay( p_aout, p_audio, i_rate ) )
                 *pi_played_sum += 1;
             *pi_lost_sum += aout_DecGetResetLost( p_aout );
@@ -1259,8 +1950,14 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
     int i_lost = 0;
     int i_played = 0;
 
-    while( (p_aout_buf = p_dec->pf_decode_audio( p_dec, &p_block )) )
+    for( ;; )
     {
+        const mtime_t i_begin = DecoderTraceBegin( p_dec );
+        p_aout_buf = p_dec->pf_decode_audio( p_dec, &p_block );
+        DecoderTraceDecoded( p_dec, i_begin );
+        if( p_aout_buf == NULL )
+            break;
+
         audio_output_t *p_aout = p_owner->p_aout;
 
         if( DecoderIsExitRequested( p_dec ) )
@@ -1297,11 +1994,9 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
 
     if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_played > 0) )
     {
-        vlc_mutex_lock( &p_input->p->counters.counters_lock);
         stats_Update( p_input->p->counters.p_lost_abuffers, i_lost, NULL );
         stats_Update( p_input->p->counters.p_played_abuffers, i_played, NULL );
         stats_Update( p_input->p->counters.p_decoded_audio, i_decoded, NULL );
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock);
     }
 }
 static void DecoderGetCc( decoder_t *p_dec, decoder_t *p_dec_cc )
@@ -1441,6 +2136,7 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
                 vout_Flush( p_vout, p_picture->date );
                 p_owner->i_last_rate = i_rate;
             }
+            DecoderTraceOutput( p_dec, p_picture->date );
             vout_PutPicture( p_vout, p_picture );
         }
         else
@@ -1459,6 +2155,7 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
 
         *pi_played_sum += i_tmp_display;
         *pi_lost_sum += i_tmp_lost;
+        p_owner->i_display_lost += i_tmp_lost;
 
         if( !b_has_more || b_buffering_first )
             break;
@@ -1480,8 +2177,14 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
     int i_decoded = 0;
     int i_displayed = 0;
 
-    while( (p_pic = p_dec->pf_decode_video( p_dec, &p_block )) )
+    for( ;; )
     {
+        const mtime_t i_begin = DecoderTraceBegin( p_dec );
+        p_pic = p_dec->pf_decode_video( p_dec, &p_block );
+        DecoderTraceDecoded( p_dec, i_begin );
+        if( p_pic == NULL )
+            break;
+
         vout_thread_t  *p_vout = p_owner->p_vout;
         if( DecoderIsExitRequested( p_dec ) )
         {
@@ -1521,12 +2224,10 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
 
     if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_displayed > 0) )
     {
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
         stats_Update( p_input->p->counters.p_decoded_video, i_decoded, NULL );
         stats_Update( p_input->p->counters.p_lost_pictures, i_lost , NULL);
         stats_Update( p_input->p->counters.p_displayed_pictures,
                       i_displayed, NULL);
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
     }
 }
 
@@ -1599,7 +2300,10 @@ static void DecoderPlaySpu( decoder_t *p_dec, subpicture_t *p_subpic )
         vlc_mutex_unlock( &p_owner->lock );
 
         if( !b_reject )
+        {
+            DecoderTraceOutput( p_dec, p_subpic->i_start );
             vout_PutSubpicture( p_vout, p_subpic );
+        }
         else
             subpicture_Delete( p_subpic );
 
@@ -1750,7 +2454,7 @@ static void DecoderProcessSout( decoder_t *p_dec, block_t *p_block )
     block_t *p_sout_block;
 
     while( ( p_sout_block =
-                 p_dec->pf_packetize( p_dec, p_block ? &p_block : NULL ) ) )
+                 DecoderPacketize( p_dec, p_block ? &p_block : NULL ) ) )
     {
         if( !p_owner->p_sout_input )
         {
@@ -1811,7 +2515,7 @@ static void DecoderProcessVideo( decoder_t *p_dec, block_t *p_block, bool b_flus
         decoder_t *p_packetizer = p_owner->p_packetizer;
 
         while( (p_packetized_block =
-                p_packetizer->pf_packetize( p_packetizer, p_block ? &p_block : NULL )) )
+                DecoderPacketize( p_packetizer, p_block ? &p_block : NULL )) )
         {
             if( p_packetizer->fmt_out.i_extra && !p_dec->fmt_in.i_extra )
             {
@@ -1861,7 +2565,7 @@ static void DecoderProcessAudio( decoder_t *p_dec, block_t *p_block, bool b_flus
         decoder_t *p_packetizer = p_owner->p_packetizer;
 
         while( (p_packetized_block =
-                p_packetizer->pf_packetize( p_packetizer, p_block ? &p_block : NULL )) )
+                DecoderPacketize( p_packetizer, p_block ? &p_block : NULL )) )
         {
             if( p_packetizer->fmt_out.i_extra && !p_dec->fmt_in.i_extra )
             {
@@ -1907,13 +2611,17 @@ static void DecoderProcessSpu( decoder_t *p_dec, block_t *p_block, bool b_flush
     vout_thread_t *p_vout;
     subpicture_t *p_spu;
 
-    while( (p_spu = p_dec->pf_decode_sub( p_dec, p_block ? &p_block : NULL ) ) )
+    for( ;; )
     {
+        const mtime_t i_begin = DecoderTraceBegin( p_dec );
+        p_spu = p_dec->pf_decode_sub( p_dec, p_block ? &p_block : NULL );
+        DecoderTraceDecoded( p_dec, i_begin );
+        if( p_spu == NULL )
+            break;
+
         if( p_input != NULL )
         {
-            vlc_mutex_lock( &p_input->p->counters.counters_lock );
             stats_Update( p_input->p->counters.p_decoded_sub, 1, NULL );
-            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
         }
 
         p_vout = input_resource_HoldVout( p_owner->p_resource );
@@ -2072,8 +2780,10 @@ static void DeleteDecoder( decoder_t * p_dec )
     /* Cleanup */
     if( p_owner->p_aout )
     {
-        /* TODO: REVISIT gap-less audio */
-        aout_DecFlush( p_owner->p_aout );
+        /* At the end of the stream, the audio output may keep playing
+         * until the next input starts */
+        if( !DecoderIsEndOfStream( p_dec ) )
+            aout_DecFlush( p_owner->p_aout );
         aout_DecDelete( p_owner->p_aout );
         input_resource_PutAout( p_owner->p_resource, p_owner->p_aout );
         if( p_owner->p_input != NULL )
@@ -2135,6 +2845,7 @@ static void DeleteDecoder( decoder_t * p_dec )
     vlc_cond_destroy( &p_owner->wait_acknowledge );
     vlc_cond_destroy( &p_owner->wait_request );
     vlc_mutex_destroy( &p_owner->lock );
+    vlc_mutex_destroy( &p_owner->trace.lock );
 
     vlc_object_release( p_dec );
 
@@ -2270,6 +2981,24 @@ static block_t *aout_new_buffer( decoder_t *p_dec, int i_samples )
     return p_buffer;
 }
 
+/* Worst case number of reference and reordered pictures for a codec */
+static unsigned DecoderGetDefaultDpbSize( vlc_fourcc_t i_codec )
+{
+    switch( i_codec )
+    {
+    case VLC_CODEC_H264:
+    case VLC_CODEC_DIRAC: /* FIXME valid ? */
+        return 18;
+    case VLC_CODEC_VP5:
+    case VLC_CODEC_VP6:
+    case VLC_CODEC_VP6F:
+    case VLC_CODEC_VP8:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
 static picture_t *vout_new_buffer( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -2358,23 +3087,15 @@ static picture_t *vout_new_buffer( decoder_t *p_dec )
         p_owner->p_vout = NULL;
         vlc_mutex_unlock( &p_owner->lock );
 
-        unsigned dpb_size;
-        switch( p_dec->fmt_in.i_codec )
-        {
-        case VLC_CODEC_H264:
-        case VLC_CODEC_DIRAC: /* FIXME valid ? */
-            dpb_size = 18;
-            break;
-        case VLC_CODEC_VP5:
-        case VLC_CODEC_VP6:
-        case VLC_CODEC_VP6F:
-        case VLC_CODEC_VP8:
-            dpb_size = 3;
-            break;
-        default:
-            dpb_size = 2;
-            break;
-        }
+        /* Use the DPB size of the stream when the decoder knows it, it is
+         * usually much smaller than the worst case and leaves more chances
+         * for the display to provide all the pictures (direct rendering) */
+        unsigned dpb_size = p_dec->i_dpb_size;
+        if( dpb_size == 0 )
+            dpb_size = DecoderGetDefaultDpbSize( p_dec->fmt_in.i_codec );
+        msg_Dbg( p_dec, "requesting %u pictures for a DPB of %u",
+                 dpb_size + p_dec->i_extra_picture_buffers +
+                 1 + DECODER_MAX_BUFFERING_COUNT, dpb_size );
         p_vout = input_resource_RequestVout( p_owner->p_resource,
                                              p_vout, &fmt,
                                              dpb_size +
@@ -2418,8 +3139,12 @@ static picture_t *vout_new_buffer( decoder_t *p_dec )
         /* Check the decoder doesn't leak pictures */
         vout_FixLeaks( p_owner->p_vout );
 
-        /* FIXME add a vout_WaitPictureAvailable (timedwait) */
-        msleep( VOUT_OUTMEM_SLEEP );
+        /* Wake up as soon as the vout gives a picture back, but come back
+         * regularly to check for exit and flush requests */
+        p_picture = vout_WaitPicture( p_owner->p_vout,
+                                      mdate() + VOUT_OUTMEM_SLEEP );
+        if( p_picture )
+            return p_picture;
     }
 }
 
@@ -2455,7 +3180,9 @@ static subpicture_t *spu_new_buffer( decoder_t *p_dec,
         if( p_vout )
             break;
 
+        DecoderPoolBlocked( p_dec, true );
         msleep( DECODER_SPU_VOUT_WAIT_DURATION );
+        DecoderPoolBlocked( p_dec, false );
     }
 
     if( !p_vout )
@@ -34,6 +34,11 @@
 decoder_t *input_DecoderNew( input_thread_t *, es_format_t *, input_clock_t *,
                              sout_instance_t * ) VLC_USED;
 
+/**
+ * This function destroys a decoder kept by an input resource for reuse.
+ */
+void input_DecoderDiscard( decoder_t * );
+
 /**
  * This function changes the pause state.
  * The date parameter MUST hold the exact date at wich the change has been
@@ -111,4 +116,9 @@ size_t input_DecoderGetFifoSize( decoder_t *p_dec );
  */
 void input_DecoderGetObjects( decoder_t *, vout_thread_t **, audio_output_t ** );
 
+/**
+ * This function returns the latency histograms of a decoder
+ */
+void input_DecoderGetLatency( decoder_t *, input_latency_t * );
+
 #endif
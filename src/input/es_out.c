@@ -152,6 +152,7 @@ struct es_out_sys_t
     mtime_t     i_pts_jitter;
     int         i_cr_average;
     int         i_rate;
+    mtime_t     i_clock_latency; /* Low latency clock target, 0 if disabled */
 
     /* */
     bool        b_paused;
@@ -291,6 +292,7 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, int i_rate )
     p_sys->i_pause_date = -1;
 
     p_sys->i_rate = i_rate;
+    p_sys->i_clock_latency = INT64_C(1000) * var_InheritInteger( p_input, "clock-latency" );
 
     p_sys->b_buffering = true;
     p_sys->i_preroll_end = -1;
@@ -1047,6 +1049,8 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
     if( p_sys->b_paused )
         input_clock_ChangePause( p_pgrm->p_clock, p_sys->b_paused, p_sys->i_pause_date );
     input_clock_SetJitter( p_pgrm->p_clock, p_sys->i_pts_delay, p_sys->i_cr_average );
+    if( p_sys->i_clock_latency > 0 )
+        input_clock_SetLowLatency( p_pgrm->p_clock, p_sys->i_clock_latency );
 
     /* Append it */
     TAB_APPEND( p_sys->i_pgrm, p_sys->pgrm, p_pgrm );
@@ -1262,7 +1266,6 @@ static void EsOutProgramEpg( es_out_t *out, int i_group, const vlc_epg_t *p_epg
 
     /* Update info */
     psz_cat = EsOutProgramGetMetaName( p_pgrm );
-    msg_Dbg( p_input, "EsOutProgramEpg: number=%d name=%s", i_group, psz_cat );
 
     /* Merge EPG */
     vlc_epg_t epg;
@@ -1270,7 +1273,13 @@ static void EsOutProgramEpg( es_out_t *out, int i_group, const vlc_epg_t *p_epg
     epg = *p_epg;
     epg.psz_name = psz_cat;
 
-    input_item_SetEpg( p_item, &epg );
+    if( !input_item_SetEpg( p_item, &epg ) )
+    {
+        /* The EIT repeats the same events most of the time */
+        free( psz_cat );
+        return;
+    }
+    msg_Dbg( p_input, "EsOutProgramEpg: number=%d name=%s", i_group, psz_cat );
     input_SendEventMetaEpg( p_sys->p_input );
 
     /* Update now playing */
@@ -1893,7 +1902,6 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     {
         uint64_t i_total;
 
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
         stats_Update( p_input->p->counters.p_demux_read,
                       p_block->i_buffer, &i_total );
         stats_Update( p_input->p->counters.p_demux_bitrate, i_total, NULL );
@@ -1908,7 +1916,6 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
         {
             stats_Update( p_input->p->counters.p_demux_discontinuity, 1, NULL );
         }
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
     }
 
     vlc_mutex_lock( &p_sys->lock );
@@ -2287,10 +2294,13 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
 
         /* TODO do not use mdate() but proper stream acquisition date */
         bool b_late;
+        const bool b_pace = p_sys->p_input->p->b_can_pace_control ||
+                            p_sys->b_buffering;
+        /* The extra buffering only applies to paced clocks: do not scan the
+         * decoder FIFOs on every PCR of a live stream */
         input_clock_Update( p_pgrm->p_clock, VLC_OBJECT(p_sys->p_input),
-                            &b_late,
-                            p_sys->p_input->p->b_can_pace_control || p_sys->b_buffering,
-                            EsOutIsExtraBufferingAllowed( out ),
+                            &b_late, b_pace,
+                            b_pace && EsOutIsExtraBufferingAllowed( out ),
                             i_pcr, mdate() );
 
         if( p_pgrm == p_sys->p_pgrm )
@@ -2300,6 +2310,14 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
                 /* Check buffering state on master clock update */
                 EsOutDecodersStopBuffering( out, false );
             }
+            else if( b_late && p_sys->i_clock_latency > 0 )
+            {
+                /* The low latency clock adapts its delay on its own, do not
+                 * raise the minimal pts_delay */
+                msg_Warn( p_sys->p_input,
+                          "ES_OUT_SET_(GROUP_)PCR  is called too late (rebuffering)" );
+                es_out_Control( out, ES_OUT_RESET_PCR );
+            }
             else if( b_late && ( !p_sys->p_input->p->p_sout ||
                                  !p_sys->p_input->p->b_out_pace_control ) )
             {
@@ -2504,6 +2522,18 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_GET_ES_LATENCY_BY_ID:
+    {
+        const int i_id = va_arg( args, int );
+        es_out_id_t *p_es = EsOutGetFromID( out, i_id );
+        if( !p_es || !p_es->p_dec )
+            return VLC_EGENERIC;
+
+        input_latency_t *p_latency = va_arg( args, input_latency_t * );
+        input_DecoderGetLatency( p_es->p_dec, p_latency );
+        return VLC_SUCCESS;
+    }
+
     case ES_OUT_GET_BUFFERING:
     {
         bool *pb = va_arg( args, bool* );
@@ -38,6 +38,12 @@
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
+#ifdef HAVE_POSIX_FALLOCATE
+# include <fcntl.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
@@ -85,7 +91,7 @@ typedef struct attribute_packed
 {
     es_out_id_t *p_es;
     block_t *p_block;
-    int     i_offset;  /* We do not use file > INT_MAX */
+    int64_t i_offset;
 } ts_cmd_send_t;
 
 typedef struct attribute_packed
@@ -171,6 +177,68 @@ struct ts_storage_t
     ts_cmd_t *p_cmd;
 };
 
+/* Header of a block stored in a ts_ring_t */
+typedef struct attribute_packed
+{
+    mtime_t  i_dts;
+    mtime_t  i_pts;
+    mtime_t  i_length;
+    uint32_t i_flags;
+    uint32_t i_nb_samples;
+    uint32_t i_buffer;
+} ts_ring_block_t;
+
+typedef struct
+{
+    uint64_t i_cmd;     /* Position of the indexed command */
+    mtime_t  i_time;    /* Estimated stream time of the command */
+} ts_ring_index_t;
+
+/* Circular storage kept in a single preallocated memory-mapped file.
+ *
+ * Commands (and block data) are kept after their execution until their
+ * space is needed, so that it is possible to go back in time.
+ * All positions are absolute, and must be taken modulo the size to
+ * get an index. */
+typedef struct
+{
+    uint8_t  *p_map;
+    size_t   i_map;
+
+    /* Commands */
+    ts_cmd_t *p_cmd;
+    uint64_t i_cmd_max;
+    uint64_t i_cmd_begin;   /* Oldest command kept */
+    uint64_t i_cmd_r;       /* Next command to execute */
+    uint64_t i_cmd_w;
+    uint64_t i_cmd_barrier; /* Commands before cannot be executed again */
+
+    /* Blocks data */
+    uint8_t  *p_data;
+    uint64_t i_data_max;
+    uint64_t i_data_begin;
+    uint64_t i_data_w;
+
+    /* Key frames index, sorted by command position */
+    ts_ring_index_t *p_index;
+    uint64_t i_index_max;
+    uint64_t i_index_begin;
+    uint64_t i_index_w;
+    mtime_t  i_index_date;
+
+    /* Last known stream time */
+    mtime_t  i_time;
+
+    /* Pending seek */
+    bool     b_seek;
+    uint64_t i_seek;
+
+    /* Commands skipped but that still need to be executed */
+    int      i_skipped;
+    ts_cmd_t **pp_skipped;
+    bool     b_discontinuity;
+} ts_ring_t;
+
 typedef struct
 {
     vlc_thread_t   thread;
@@ -178,6 +246,7 @@ typedef struct
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
     const char     *psz_tmp_path;
+    int64_t        i_ring_size;
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
@@ -199,6 +268,8 @@ typedef struct
     /* */
     ts_storage_t   *p_storage_r;
     ts_storage_t   *p_storage_w;
+    ts_ring_t      *p_ring;     /* Used instead of the storages if set */
+    bool           b_rebase;    /* The next command date has jumped */
 
     mtime_t        i_cmd_delay;
 
@@ -217,6 +288,7 @@ struct es_out_sys_t
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
+    int64_t        i_ring_size;       /* Circular storage size in byte or 0 */
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
@@ -263,6 +335,13 @@ static bool         TsStorageIsEmpty( ts_storage_t * );
 static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
 
+static ts_ring_t    *TsRingNew( input_thread_t *, const char *psz_path, int64_t i_size );
+static void         TsRingDelete( ts_ring_t * );
+static void         TsRingPushCmd( ts_ring_t *, ts_cmd_t *p_cmd );
+static int          TsRingPopCmd( ts_ring_t *, ts_cmd_t *p_cmd, bool *pb_rebase );
+static bool         TsRingIsEmpty( ts_ring_t * );
+static int          TsRingSeek( ts_ring_t *, mtime_t i_time );
+
 static void CmdClean( ts_cmd_t * );
 static void cmd_cleanup_routine( void *p ) { CmdClean( p ); }
 
@@ -270,6 +349,9 @@ static int  CmdInitAdd    ( ts_cmd_t *, es_out_id_t *, const es_format_t *, bool
 static void CmdInitSend   ( ts_cmd_t *, es_out_id_t *, block_t * );
 static int  CmdInitDel    ( ts_cmd_t *, es_out_id_t * );
 static int  CmdInitControl( ts_cmd_t *, int i_query, va_list, bool b_copy );
+static void CmdDup( ts_cmd_t *, const ts_cmd_t * );
+static bool CmdIsSkippable( const ts_cmd_t * );
+static bool CmdIsBarrier( const ts_cmd_t * );
 
 /* */
 static void CmdCleanAdd    ( ts_cmd_t * );
@@ -335,8 +417,15 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     char *psz_tmp_path = var_CreateGetNonEmptyString( p_input, "input-timeshift-path" );
     p_sys->psz_tmp_path = GetTmpPath( psz_tmp_path );
 
-    msg_Dbg( p_input, "using timeshift granularity of %d MiB, in path '%s'",
-             (int)p_sys->i_tmp_size_max/(1024*1024), p_sys->psz_tmp_path );
+    const int i_ring_size = var_CreateGetInteger( p_input, "input-timeshift-size" );
+    p_sys->i_ring_size = INT64_C(1024)*1024 * __MAX( i_ring_size, 0 );
+
+    if( p_sys->i_ring_size > 0 )
+        msg_Dbg( p_input, "using circular timeshift of %d MiB, in path '%s'",
+                 i_ring_size, p_sys->psz_tmp_path );
+    else
+        msg_Dbg( p_input, "using timeshift granularity of %d MiB, in path '%s'",
+                 (int)p_sys->i_tmp_size_max/(1024*1024), p_sys->psz_tmp_path );
 
 #if 0
 #define S(t) msg_Err( p_input, "SIZEOF("#t")=%d", sizeof(t) )
@@ -415,6 +504,11 @@ static int Send( es_out_t *p_out, es_out_id_t *p_es, block_t *p_block )
 
     TsAutoStop( p_out );
 
+    /* With a circular storage, the stream is always recorded */
+    if( !p_sys->b_delayed && p_sys->i_ring_size > 0 &&
+        !p_sys->p_input->p->b_can_pace_control )
+        TsStart( p_out );
+
     CmdInitSend( &cmd, p_es, p_block );
     if( p_sys->b_delayed )
         TsPushCmd( p_sys->p_ts, &cmd );
@@ -476,8 +570,9 @@ static int ControlLockedGetBuffering( es_out_t *p_out, bool *pb_buffering )
 {
     es_out_sys_t *p_sys = p_out->p_sys;
 
+    /* Seeks must not be postponed, the circular storage handles them */
     if( p_sys->b_delayed )
-        *pb_buffering = true;
+        *pb_buffering = !p_sys->p_ts->p_ring;
     else
         *pb_buffering = es_out_GetBuffering( p_sys->p_out );
 
@@ -557,9 +652,31 @@ static int ControlLockedSetRate( es_out_t *p_out, int i_src_rate, int i_rate )
 static int ControlLockedSetTime( es_out_t *p_out, mtime_t i_date )
 {
     es_out_sys_t *p_sys = p_out->p_sys;
-
     if( !p_sys->b_delayed )
+    {
+        /* Nothing is recorded */
+        if( i_date >= 0 )
+            return VLC_EGENERIC;
         return es_out_SetTime( p_sys->p_out, i_date );
+    }
+
+    ts_thread_t *p_ts = p_sys->p_ts;
+    if( p_ts->p_ring )
+    {
+        /* The reset is done when seeking in the circular storage */
+        if( i_date < 0 )
+            return VLC_SUCCESS;
+
+        vlc_mutex_lock( &p_ts->lock );
+        const int i_ret = TsRingSeek( p_ts->p_ring, i_date );
+        vlc_cond_signal( &p_ts->wait );
+        vlc_mutex_unlock( &p_ts->lock );
+
+        if( i_ret )
+            msg_Warn( p_sys->p_input, "time %"PRId64" is not in the timeshift buffer",
+                      i_date );
+        return i_ret;
+    }
 
     /* TODO */
     msg_Err( p_sys->p_input, "EsOutTimeshift does not yet support time change" );
@@ -583,6 +700,7 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     case ES_OUT_RESTART_ES_BY_ID:
     case ES_OUT_SET_ES_DEFAULT_BY_ID:
     case ES_OUT_GET_ES_OBJECTS_BY_ID:
+    case ES_OUT_GET_ES_LATENCY_BY_ID:
     case ES_OUT_SET_DELAY:
     case ES_OUT_SET_RECORD_STATE:
         assert(0);
@@ -744,6 +862,7 @@ static int TsStart( es_out_t *p_out )
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
+    p_ts->i_ring_size = p_sys->i_ring_size;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
     vlc_mutex_init( &p_ts->lock );
@@ -758,12 +877,23 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_cmd_delay = 0;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->p_ring = NULL;
+    p_ts->b_rebase = false;
+
+    if( p_ts->i_ring_size > 0 )
+    {
+        p_ts->p_ring = TsRingNew( p_ts->p_input, p_ts->psz_tmp_path, p_ts->i_ring_size );
+        if( !p_ts->p_ring )
+            msg_Err( p_sys->p_input, "cannot create the circular timeshift storage" );
+    }
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
     {
         msg_Err( p_sys->p_input, "cannot create timeshift thread" );
 
+        if( p_ts->p_ring )
+            TsRingDelete( p_ts->p_ring );
         TsDestroy( p_ts );
 
         p_sys->b_delayed = false;
@@ -790,6 +920,11 @@ static void TsStop( ts_thread_t *p_ts )
     vlc_join( p_ts->thread, NULL );
 
     vlc_mutex_lock( &p_ts->lock );
+    if( p_ts->p_ring )
+    {
+        TsRingDelete( p_ts->p_ring );
+        p_ts->p_ring = NULL;
+    }
     for( ;; )
     {
         ts_cmd_t cmd;
@@ -810,6 +945,15 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_mutex_lock( &p_ts->lock );
 
+    if( p_ts->p_ring )
+    {
+        TsRingPushCmd( p_ts->p_ring, p_cmd );
+
+        vlc_cond_signal( &p_ts->wait );
+        vlc_mutex_unlock( &p_ts->lock );
+        return;
+    }
+
     if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
     {
         ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
@@ -845,6 +989,16 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 {
     vlc_assert_locked( &p_ts->lock );
 
+    if( p_ts->p_ring )
+    {
+        bool b_rebase = false;
+        if( TsRingPopCmd( p_ts->p_ring, p_cmd, &b_rebase ) )
+            return VLC_EGENERIC;
+        if( b_rebase )
+            p_ts->b_rebase = true;
+        return VLC_SUCCESS;
+    }
+
     if( TsStorageIsEmpty( p_ts->p_storage_r ) )
         return VLC_EGENERIC;
 
@@ -867,7 +1021,10 @@ static bool TsHasCmd( ts_thread_t *p_ts )
     bool b_cmd;
 
     vlc_mutex_lock( &p_ts->lock );
-    b_cmd =  TsStorageIsEmpty( p_ts->p_storage_r );
+    if( p_ts->p_ring )
+        b_cmd = !TsRingIsEmpty( p_ts->p_ring );
+    else
+        b_cmd =  TsStorageIsEmpty( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_cmd;
@@ -877,7 +1034,9 @@ static bool TsIsUnused( ts_thread_t *p_ts )
     bool b_unused;
 
     vlc_mutex_lock( &p_ts->lock );
-    b_unused = !p_ts->b_paused &&
+    /* The circular storage keeps the past, even when not needed anymore */
+    b_unused = !p_ts->p_ring &&
+               !p_ts->b_paused &&
                p_ts->i_rate == p_ts->i_rate_source &&
                TsStorageIsEmpty( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
@@ -934,6 +1093,21 @@ static int TsChangeRate( ts_thread_t *p_ts, int i_src_rate, int i_rate )
     return i_ret;
 }
 
+/* Waits up to i_deadline, unless a seek is requested in the circular storage */
+static bool TsWaitSeek( ts_thread_t *p_ts, mtime_t i_deadline )
+{
+    bool b_seek;
+
+    vlc_mutex_lock( &p_ts->lock );
+    mutex_cleanup_push( &p_ts->lock );
+    while( !(b_seek = p_ts->p_ring->b_seek) &&
+           !vlc_cond_timedwait( &p_ts->wait, &p_ts->lock, i_deadline ) )
+        ;
+    vlc_cleanup_run();
+
+    return b_seek;
+}
+
 static void *TsRun( void *p_data )
 {
     ts_thread_t *p_ts = p_data;
@@ -964,6 +1138,17 @@ static void *TsRun( void *p_data )
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
         }
 
+        if( p_ts->b_rebase )
+        {
+            /* The stream was forwarded or rewound: restart from this command */
+            p_ts->b_rebase = false;
+            p_ts->i_rate_date = -1;
+            p_ts->i_rate_delay = 0;
+            p_ts->i_buffering_delay = 0;
+            p_ts->i_cmd_delay = mdate() - cmd.i_date;
+            i_buffering_date = -1;
+        }
+
         if( b_buffering && i_buffering_date < 0 )
         {
             i_buffering_date = cmd.i_date;
@@ -1019,7 +1204,19 @@ static void *TsRun( void *p_data )
          * reading  */
         vlc_cleanup_push( cmd_cleanup_routine, &cmd );
 
-        mwait( i_deadline );
+        if( p_ts->p_ring )
+        {
+            /* A block read before a seek is not wanted anymore */
+            if( TsWaitSeek( p_ts, i_deadline ) && cmd.i_type == C_SEND )
+            {
+                CmdCleanSend( &cmd );
+                cmd.u.send.p_block = NULL;
+            }
+        }
+        else
+        {
+            mwait( i_deadline );
+        }
 
         vlc_cleanup_pop();
 
@@ -1205,6 +1402,398 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     }
 }
 
+/*****************************************************************************
+ * Circular storage
+ *****************************************************************************/
+
+/* Number of bytes of the storage per command slot */
+#define TS_RING_CMD_RATIO (1024)
+
+/* An index entry is added for each key frame, but not more often than
+ * TS_RING_INDEX_MIN, and at least every TS_RING_INDEX_MAX */
+#define TS_RING_INDEX_MIN (CLOCK_FREQ/10)
+#define TS_RING_INDEX_MAX (CLOCK_FREQ)
+
+static ts_ring_t *TsRingNew( input_thread_t *p_input, const char *psz_tmp_path, int64_t i_size )
+{
+#ifdef HAVE_MMAP
+    if( (uint64_t)i_size > SIZE_MAX / 2 )
+    {
+        msg_Err( p_input, "timeshift size too large for this system" );
+        return NULL;
+    }
+
+    ts_ring_t *p_ring = calloc( 1, sizeof(*p_ring) );
+    if( !p_ring )
+        return NULL;
+
+    long i_page = sysconf( _SC_PAGESIZE );
+    if( i_page <= 0 )
+        i_page = 4096;
+
+    /* The commands are stored first, then the blocks data */
+    const size_t i_cmd_size = ( ( __MAX( i_size / TS_RING_CMD_RATIO, 1024 ) *
+                                  sizeof(ts_cmd_t) + i_page - 1 ) / i_page ) * i_page;
+    p_ring->i_map = i_cmd_size + i_size;
+
+    char *psz_file;
+    FILE *f = GetTmpFile( &psz_file, psz_tmp_path );
+    if( psz_file )
+    {
+        /* It is only reached through the mapping */
+        vlc_unlink( psz_file );
+        free( psz_file );
+    }
+    if( !f )
+        goto error;
+
+    void *p_map = MAP_FAILED;
+#ifdef HAVE_POSIX_FALLOCATE
+    if( !posix_fallocate( fileno( f ), 0, p_ring->i_map ) )
+#else
+    if( !ftruncate( fileno( f ), p_ring->i_map ) )
+#endif
+        p_map = mmap( NULL, p_ring->i_map, PROT_READ|PROT_WRITE, MAP_SHARED,
+                      fileno( f ), 0 );
+    fclose( f );
+    if( p_map == MAP_FAILED )
+    {
+        msg_Err( p_input, "cannot map the timeshift storage: %m" );
+        goto error;
+    }
+
+    p_ring->p_map = p_map;
+    p_ring->p_cmd = p_map;
+    p_ring->i_cmd_max = i_cmd_size / sizeof(ts_cmd_t);
+    p_ring->p_data = &p_ring->p_map[i_cmd_size];
+    p_ring->i_data_max = i_size;
+
+    p_ring->i_index_max = __MAX( p_ring->i_cmd_max / 8, 256 );
+    p_ring->p_index = malloc( p_ring->i_index_max * sizeof(*p_ring->p_index) );
+    if( !p_ring->p_index )
+    {
+        munmap( p_ring->p_map, p_ring->i_map );
+        goto error;
+    }
+    p_ring->i_index_date = VLC_TS_INVALID;
+    p_ring->i_time = -1;
+    TAB_INIT( p_ring->i_skipped, p_ring->pp_skipped );
+
+    msg_Dbg( p_input, "timeshift storage of %"PRId64" MiB, %"PRIu64" commands",
+             i_size / (1024*1024), p_ring->i_cmd_max );
+    return p_ring;
+
+error:
+    free( p_ring );
+    return NULL;
+#else
+    VLC_UNUSED(psz_tmp_path); VLC_UNUSED(i_size);
+    msg_Err( p_input, "memory mapping is not supported" );
+    return NULL;
+#endif
+}
+
+static ts_cmd_t *TsRingCmd( ts_ring_t *p_ring, uint64_t i_pos )
+{
+    return &p_ring->p_cmd[i_pos % p_ring->i_cmd_max];
+}
+static ts_ring_block_t *TsRingBlock( ts_ring_t *p_ring, uint64_t i_offset )
+{
+    return (ts_ring_block_t *)&p_ring->p_data[i_offset % p_ring->i_data_max];
+}
+static uint64_t TsRingBlockSize( uint64_t i_buffer )
+{
+    return ( sizeof(ts_ring_block_t) + i_buffer + 7 ) & ~UINT64_C(7);
+}
+static ts_ring_index_t *TsRingIndex( ts_ring_t *p_ring, uint64_t i_pos )
+{
+    return &p_ring->p_index[i_pos % p_ring->i_index_max];
+}
+
+static void TsRingDelete( ts_ring_t *p_ring )
+{
+    for( uint64_t i = p_ring->i_cmd_begin; i < p_ring->i_cmd_w; i++ )
+        CmdClean( TsRingCmd( p_ring, i ) );
+
+    for( int i = 0; i < p_ring->i_skipped; i++ )
+    {
+        CmdClean( p_ring->pp_skipped[i] );
+        free( p_ring->pp_skipped[i] );
+    }
+    TAB_CLEAN( p_ring->i_skipped, p_ring->pp_skipped );
+
+    free( p_ring->p_index );
+#ifdef HAVE_MMAP
+    munmap( p_ring->p_map, p_ring->i_map );
+#endif
+    free( p_ring );
+}
+
+/* Moves the reader forward up to i_target, the commands that cannot be
+ * ignored are kept aside to be executed first */
+static void TsRingForward( ts_ring_t *p_ring, uint64_t i_target )
+{
+    for( ; p_ring->i_cmd_r < i_target; p_ring->i_cmd_r++ )
+    {
+        const ts_cmd_t *p_cmd = TsRingCmd( p_ring, p_ring->i_cmd_r );
+
+        if( CmdIsBarrier( p_cmd ) )
+            p_ring->i_cmd_barrier = p_ring->i_cmd_r + 1;
+        if( CmdIsSkippable( p_cmd ) )
+            continue;
+
+        ts_cmd_t *p_skipped = malloc( sizeof(*p_skipped) );
+        if( !p_skipped )
+            continue;
+        CmdDup( p_skipped, p_cmd );
+        TAB_APPEND( p_ring->i_skipped, p_ring->pp_skipped, p_skipped );
+    }
+    p_ring->b_discontinuity = true;
+}
+
+/* Drops the oldest command */
+static void TsRingEvict( ts_ring_t *p_ring )
+{
+    assert( p_ring->i_cmd_begin < p_ring->i_cmd_w );
+    ts_cmd_t *p_cmd = TsRingCmd( p_ring, p_ring->i_cmd_begin );
+
+    if( p_cmd->i_type == C_SEND )
+    {
+        const ts_ring_block_t *p_hdr = TsRingBlock( p_ring, p_cmd->u.send.i_offset );
+
+        p_ring->i_data_begin = p_cmd->u.send.i_offset +
+                               TsRingBlockSize( p_hdr->i_buffer );
+    }
+
+    if( p_ring->i_cmd_begin >= p_ring->i_cmd_r )
+    {
+        /* The reader is too late, jump far enough to not be caught again
+         * at once */
+        TsRingForward( p_ring, __MIN( p_ring->i_cmd_w,
+                                      p_ring->i_cmd_begin + __MAX( p_ring->i_cmd_max / 8, 1 ) ) );
+    }
+    CmdClean( p_cmd );
+    p_ring->i_cmd_begin++;
+
+    if( p_ring->i_cmd_barrier < p_ring->i_cmd_begin )
+        p_ring->i_cmd_barrier = p_ring->i_cmd_begin;
+    while( p_ring->i_index_begin < p_ring->i_index_w &&
+           TsRingIndex( p_ring, p_ring->i_index_begin )->i_cmd < p_ring->i_cmd_begin )
+        p_ring->i_index_begin++;
+}
+
+static void TsRingAddIndex( ts_ring_t *p_ring, mtime_t i_date, uint32_t i_flags )
+{
+    if( p_ring->i_time <= 0 )
+        return;
+
+    const mtime_t i_elapsed = i_date - p_ring->i_index_date;
+    if( p_ring->i_index_date > VLC_TS_INVALID &&
+        i_elapsed < TS_RING_INDEX_MAX &&
+        ( !(i_flags & BLOCK_FLAG_TYPE_I) || i_elapsed < TS_RING_INDEX_MIN ) )
+        return;
+
+    /* Keep the index sorted by time too */
+    mtime_t i_time = p_ring->i_time;
+    if( p_ring->i_index_begin < p_ring->i_index_w )
+        i_time = __MAX( i_time, TsRingIndex( p_ring, p_ring->i_index_w - 1 )->i_time );
+
+    if( p_ring->i_index_w - p_ring->i_index_begin >= p_ring->i_index_max )
+        p_ring->i_index_begin++;
+
+    ts_ring_index_t *p_index = TsRingIndex( p_ring, p_ring->i_index_w++ );
+    p_index->i_cmd = p_ring->i_cmd_w;
+    p_index->i_time = i_time;
+    p_ring->i_index_date = i_date;
+}
+
+static void TsRingPushCmd( ts_ring_t *p_ring, ts_cmd_t *p_cmd )
+{
+    ts_cmd_t cmd = *p_cmd;
+
+    if( cmd.i_type == C_SEND )
+    {
+        block_t *p_block = cmd.u.send.p_block;
+        const uint64_t i_size = TsRingBlockSize( p_block->i_buffer );
+
+        cmd.u.send.p_block = NULL;
+        if( i_size > p_ring->i_data_max )
+        {
+            block_Release( p_block );
+            return;
+        }
+
+        /* Blocks are never split at the end of the storage */
+        uint64_t i_offset = p_ring->i_data_w;
+        if( i_offset % p_ring->i_data_max + i_size > p_ring->i_data_max )
+            i_offset += p_ring->i_data_max - i_offset % p_ring->i_data_max;
+
+        while( p_ring->i_cmd_begin < p_ring->i_cmd_w &&
+               ( i_offset + i_size - p_ring->i_data_begin > p_ring->i_data_max ||
+                 p_ring->i_cmd_w - p_ring->i_cmd_begin >= p_ring->i_cmd_max ) )
+            TsRingEvict( p_ring );
+        if( p_ring->i_cmd_begin >= p_ring->i_cmd_w )
+            p_ring->i_data_begin = i_offset;
+
+        ts_ring_block_t *p_hdr = TsRingBlock( p_ring, i_offset );
+        p_hdr->i_dts        = p_block->i_dts;
+        p_hdr->i_pts        = p_block->i_pts;
+        p_hdr->i_length     = p_block->i_length;
+        p_hdr->i_flags      = p_block->i_flags;
+        p_hdr->i_nb_samples = p_block->i_nb_samples;
+        p_hdr->i_buffer     = p_block->i_buffer;
+        memcpy( &p_hdr[1], p_block->p_buffer, p_block->i_buffer );
+
+        cmd.u.send.i_offset = i_offset;
+        p_ring->i_data_w = i_offset + i_size;
+
+        TsRingAddIndex( p_ring, cmd.i_date, p_block->i_flags );
+        block_Release( p_block );
+    }
+    else
+    {
+        while( p_ring->i_cmd_w - p_ring->i_cmd_begin >= p_ring->i_cmd_max )
+            TsRingEvict( p_ring );
+
+        if( cmd.i_type == C_CONTROL && cmd.u.control.i_query == ES_OUT_SET_TIMES )
+            p_ring->i_time = cmd.u.control.u.times.i_time;
+    }
+    *TsRingCmd( p_ring, p_ring->i_cmd_w++ ) = cmd;
+}
+
+static block_t *TsRingReadBlock( ts_ring_t *p_ring, uint64_t i_offset )
+{
+    const ts_ring_block_t *p_hdr = TsRingBlock( p_ring, i_offset );
+
+    block_t *p_block = block_Alloc( p_hdr->i_buffer );
+    if( !p_block )
+        return NULL;
+
+    p_block->i_dts        = p_hdr->i_dts;
+    p_block->i_pts        = p_hdr->i_pts;
+    p_block->i_length     = p_hdr->i_length;
+    p_block->i_flags      = p_hdr->i_flags;
+    p_block->i_nb_samples = p_hdr->i_nb_samples;
+    memcpy( p_block->p_buffer, &p_hdr[1], p_hdr->i_buffer );
+    return p_block;
+}
+
+static int TsRingPopCmd( ts_ring_t *p_ring, ts_cmd_t *p_cmd, bool *pb_rebase )
+{
+    if( p_ring->b_seek )
+    {
+        uint64_t i_seek = __MAX( p_ring->i_seek, p_ring->i_cmd_barrier );
+        i_seek = __MIN( i_seek, p_ring->i_cmd_w );
+
+        if( i_seek < p_ring->i_cmd_r )
+        {
+            /* The commands from there were already executed */
+            p_ring->i_cmd_r = i_seek;
+        }
+        else
+        {
+            TsRingForward( p_ring, i_seek );
+        }
+        p_ring->b_seek = false;
+        p_ring->b_discontinuity = true;
+    }
+
+    /* Skipped commands and the reset are executed at once, as if they were
+     * just before the next command */
+    const mtime_t i_date = p_ring->i_cmd_r < p_ring->i_cmd_w ?
+                           TsRingCmd( p_ring, p_ring->i_cmd_r )->i_date : mdate();
+
+    if( p_ring->i_skipped > 0 )
+    {
+        ts_cmd_t *p_skipped = p_ring->pp_skipped[0];
+
+        TAB_REMOVE( p_ring->i_skipped, p_ring->pp_skipped, p_skipped );
+        *p_cmd = *p_skipped;
+        free( p_skipped );
+
+        p_cmd->i_date = i_date;
+        *pb_rebase = true;
+        return VLC_SUCCESS;
+    }
+    if( p_ring->b_discontinuity )
+    {
+        p_ring->b_discontinuity = false;
+
+        p_cmd->i_type = C_CONTROL;
+        p_cmd->i_date = i_date;
+        p_cmd->u.control.i_query = ES_OUT_RESET_PCR;
+        *pb_rebase = true;
+        return VLC_SUCCESS;
+    }
+
+    if( p_ring->i_cmd_r >= p_ring->i_cmd_w )
+        return VLC_EGENERIC;
+
+    const ts_cmd_t *p_src = TsRingCmd( p_ring, p_ring->i_cmd_r );
+    if( CmdIsBarrier( p_src ) )
+        p_ring->i_cmd_barrier = p_ring->i_cmd_r + 1;
+    p_ring->i_cmd_r++;
+
+    /* The storage keeps its own copy to be able to execute it again */
+    if( p_src->i_type == C_SEND )
+    {
+        *p_cmd = *p_src;
+        p_cmd->u.send.p_block = TsRingReadBlock( p_ring, p_src->u.send.i_offset );
+    }
+    else
+    {
+        CmdDup( p_cmd, p_src );
+    }
+    return VLC_SUCCESS;
+}
+
+static bool TsRingIsEmpty( ts_ring_t *p_ring )
+{
+    return p_ring->i_cmd_r >= p_ring->i_cmd_w && p_ring->i_skipped <= 0 &&
+           !p_ring->b_discontinuity && !p_ring->b_seek;
+}
+
+static int TsRingSeek( ts_ring_t *p_ring, mtime_t i_time )
+{
+    const uint64_t i_first = __MAX( p_ring->i_cmd_begin, p_ring->i_cmd_barrier );
+
+    /* Find the first usable entry */
+    uint64_t i_lo = p_ring->i_index_begin;
+    uint64_t i_hi = p_ring->i_index_w;
+    while( i_lo < i_hi )
+    {
+        const uint64_t i_mid = i_lo + ( i_hi - i_lo ) / 2;
+        if( TsRingIndex( p_ring, i_mid )->i_cmd < i_first )
+            i_lo = i_mid + 1;
+        else
+            i_hi = i_mid;
+    }
+    if( i_lo >= p_ring->i_index_w )
+        return VLC_EGENERIC;
+    const uint64_t i_start = i_lo;
+
+    /* Find the first entry after i_time */
+    i_hi = p_ring->i_index_w;
+    while( i_lo < i_hi )
+    {
+        const uint64_t i_mid = i_lo + ( i_hi - i_lo ) / 2;
+        if( TsRingIndex( p_ring, i_mid )->i_time <= i_time )
+            i_lo = i_mid + 1;
+        else
+            i_hi = i_mid;
+    }
+
+    if( i_lo >= p_ring->i_index_w && i_time >= p_ring->i_time )
+        p_ring->i_seek = p_ring->i_cmd_w; /* Back to live */
+    else if( i_lo <= i_start )
+        p_ring->i_seek = TsRingIndex( p_ring, i_start )->i_cmd;
+    else
+        p_ring->i_seek = TsRingIndex( p_ring, i_lo - 1 )->i_cmd;
+    p_ring->b_seek = true;
+
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -1229,6 +1818,113 @@ static void CmdClean( ts_cmd_t *p_cmd )
     }
 }
 
+static es_format_t *CmdDupFormat( const es_format_t *p_fmt )
+{
+    if( !p_fmt )
+        return NULL;
+
+    es_format_t *p_dup = malloc( sizeof(*p_dup) );
+    if( p_dup )
+        es_format_Copy( p_dup, p_fmt );
+    return p_dup;
+}
+static vlc_meta_t *CmdDupMeta( const vlc_meta_t *p_meta )
+{
+    if( !p_meta )
+        return NULL;
+
+    vlc_meta_t *p_dup = vlc_meta_New();
+    if( p_dup )
+        vlc_meta_Merge( p_dup, p_meta );
+    return p_dup;
+}
+static vlc_epg_t *CmdDupEpg( const vlc_epg_t *p_epg )
+{
+    if( !p_epg )
+        return NULL;
+
+    vlc_epg_t *p_dup = vlc_epg_New( p_epg->psz_name );
+    if( !p_dup )
+        return NULL;
+    for( int i = 0; i < p_epg->i_event; i++ )
+    {
+        vlc_epg_event_t *p_evt = p_epg->pp_event[i];
+
+        vlc_epg_AddEvent( p_dup, p_evt->i_start, p_evt->i_duration,
+                          p_evt->psz_name,
+                          p_evt->psz_short_description, p_evt->psz_description );
+    }
+    vlc_epg_SetCurrent( p_dup, p_epg->p_current ? p_epg->p_current->i_start : -1 );
+    return p_dup;
+}
+
+/* Deep copy of a command, the block of a C_SEND is not copied */
+static void CmdDup( ts_cmd_t *p_dst, const ts_cmd_t *p_src )
+{
+    *p_dst = *p_src;
+
+    switch( p_src->i_type )
+    {
+    case C_ADD:
+        p_dst->u.add.p_fmt = CmdDupFormat( p_src->u.add.p_fmt );
+        break;
+    case C_SEND:
+        p_dst->u.send.p_block = NULL;
+        break;
+    case C_CONTROL:
+        switch( p_src->u.control.i_query )
+        {
+        case ES_OUT_SET_META:
+        case ES_OUT_SET_GROUP_META:
+            p_dst->u.control.u.int_meta.p_meta =
+                CmdDupMeta( p_src->u.control.u.int_meta.p_meta );
+            break;
+        case ES_OUT_SET_GROUP_EPG:
+            p_dst->u.control.u.int_epg.p_epg =
+                CmdDupEpg( p_src->u.control.u.int_epg.p_epg );
+            break;
+        case ES_OUT_SET_ES_FMT:
+            p_dst->u.control.u.es_fmt.p_fmt =
+                CmdDupFormat( p_src->u.control.u.es_fmt.p_fmt );
+            break;
+        default:
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Commands that can be ignored when seeking */
+static bool CmdIsSkippable( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type == C_SEND )
+        return true;
+    if( p_cmd->i_type != C_CONTROL )
+        return false;
+
+    switch( p_cmd->u.control.i_query )
+    {
+    case ES_OUT_SET_PCR:
+    case ES_OUT_SET_GROUP_PCR:
+    case ES_OUT_RESET_PCR:
+    case ES_OUT_SET_NEXT_DISPLAY_TIME:
+    case ES_OUT_SET_TIMES:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Commands that cannot be executed a second time */
+static bool CmdIsBarrier( const ts_cmd_t *p_cmd )
+{
+    return p_cmd->i_type == C_ADD || p_cmd->i_type == C_DEL ||
+           ( p_cmd->i_type == C_CONTROL &&
+             p_cmd->u.control.i_query == ES_OUT_DEL_GROUP );
+}
+
 static int CmdInitAdd( ts_cmd_t *p_cmd, es_out_id_t *p_es, const es_format_t *p_fmt, bool b_copy )
 {
     p_cmd->i_type = C_ADD;
@@ -1236,10 +1932,9 @@ static int CmdInitAdd( ts_cmd_t *p_cmd, es_out_id_t *p_es, const es_format_t *p_
     p_cmd->u.add.p_es = p_es;
     if( b_copy )
     {
-        p_cmd->u.add.p_fmt = malloc( sizeof(*p_fmt) );
+        p_cmd->u.add.p_fmt = CmdDupFormat( p_fmt );
         if( !p_cmd->u.add.p_fmt )
             return VLC_EGENERIC;
-        es_format_Copy( p_cmd->u.add.p_fmt, p_fmt );
     }
     else
     {
@@ -1249,10 +1944,15 @@ static int CmdInitAdd( ts_cmd_t *p_cmd, es_out_id_t *p_es, const es_format_t *p_
 }
 static void CmdExecuteAdd( es_out_t *p_out, ts_cmd_t *p_cmd )
 {
-    p_cmd->u.add.p_es->p_es = es_out_Add( p_out, p_cmd->u.add.p_fmt );
+    if( p_cmd->u.add.p_fmt )
+        p_cmd->u.add.p_es->p_es = es_out_Add( p_out, p_cmd->u.add.p_fmt );
+    else
+        p_cmd->u.add.p_es->p_es = NULL;
 }
 static void CmdCleanAdd( ts_cmd_t *p_cmd )
 {
+    if( !p_cmd->u.add.p_fmt )
+        return;
     es_format_Clean( p_cmd->u.add.p_fmt );
     free( p_cmd->u.add.p_fmt );
 }
@@ -1341,10 +2041,9 @@ static int CmdInitControl( ts_cmd_t *p_cmd, int i_query, va_list args, bool b_co
 
         if( b_copy )
         {
-            p_cmd->u.control.u.int_meta.p_meta = vlc_meta_New();
+            p_cmd->u.control.u.int_meta.p_meta = CmdDupMeta( p_meta );
             if( !p_cmd->u.control.u.int_meta.p_meta )
                 return VLC_EGENERIC;
-            vlc_meta_Merge( p_cmd->u.control.u.int_meta.p_meta, p_meta );
         }
         else
         {
@@ -1361,20 +2060,9 @@ static int CmdInitControl( ts_cmd_t *p_cmd, int i_query, va_list args, bool b_co
 
         if( b_copy )
         {
-            p_cmd->u.control.u.int_epg.p_epg = vlc_epg_New( p_epg->psz_name );
+            p_cmd->u.control.u.int_epg.p_epg = CmdDupEpg( p_epg );
             if( !p_cmd->u.control.u.int_epg.p_epg )
                 return VLC_EGENERIC;
-            for( int i = 0; i < p_epg->i_event; i++ )
-            {
-                vlc_epg_event_t *p_evt = p_epg->pp_event[i];
-
-                vlc_epg_AddEvent( p_cmd->u.control.u.int_epg.p_epg,
-                                  p_evt->i_start, p_evt->i_duration,
-                                  p_evt->psz_name,
-                                  p_evt->psz_short_description, p_evt->psz_description );
-            }
-            vlc_epg_SetCurrent( p_cmd->u.control.u.int_epg.p_epg,
-                                p_epg->p_current ? p_epg->p_current->i_start : -1 );
         }
         else
         {
@@ -1403,10 +2091,9 @@ static int CmdInitControl( ts_cmd_t *p_cmd, int i_query, va_list args, bool b_co
 
         if( b_copy )
         {
-            p_cmd->u.control.u.es_fmt.p_fmt = malloc( sizeof(*p_fmt) );
+            p_cmd->u.control.u.es_fmt.p_fmt = CmdDupFormat( p_fmt );
             if( !p_cmd->u.control.u.es_fmt.p_fmt )
                 return VLC_EGENERIC;
-            es_format_Copy( p_cmd->u.control.u.es_fmt.p_fmt, p_fmt );
         }
         else
         {
@@ -1469,10 +2156,14 @@ static int CmdExecuteControl( es_out_t *p_out, ts_cmd_t *p_cmd )
         return es_out_Control( p_out, i_query );
 
     case ES_OUT_SET_GROUP_META:  /* arg1=int i_group arg2=const vlc_meta_t* */
+        if( !p_cmd->u.control.u.int_meta.p_meta )
+            return VLC_EGENERIC;
         return es_out_Control( p_out, i_query, p_cmd->u.control.u.int_meta.i_int,
                                                p_cmd->u.control.u.int_meta.p_meta );
 
     case ES_OUT_SET_GROUP_EPG:   /* arg1=int i_group arg2=const vlc_epg_t* */
+        if( !p_cmd->u.control.u.int_epg.p_epg )
+            return VLC_EGENERIC;
         return es_out_Control( p_out, i_query, p_cmd->u.control.u.int_epg.i_int,
                                                p_cmd->u.control.u.int_epg.p_epg );
 
@@ -1481,6 +2172,8 @@ static int CmdExecuteControl( es_out_t *p_out, ts_cmd_t *p_cmd )
                                                p_cmd->u.control.u.es_bool.b_bool );
 
     case ES_OUT_SET_META:  /* arg1=const vlc_meta_t* */
+        if( !p_cmd->u.control.u.int_meta.p_meta )
+            return VLC_EGENERIC;
         return es_out_Control( p_out, i_query, p_cmd->u.control.u.int_meta.p_meta );
 
     /* Modified control */
@@ -1494,6 +2187,8 @@ static int CmdExecuteControl( es_out_t *p_out, ts_cmd_t *p_cmd )
                                                p_cmd->u.control.u.es_bool.b_bool );
 
     case ES_OUT_SET_ES_FMT:     /* arg1= es_out_id_t* arg2=es_format_t* */
+        if( !p_cmd->u.control.u.es_fmt.p_fmt )
+            return VLC_EGENERIC;
         return es_out_Control( p_out, i_query, p_cmd->u.control.u.es_fmt.p_es->p_es,
                                                p_cmd->u.control.u.es_fmt.p_fmt );
 
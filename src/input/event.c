@@ -64,6 +64,11 @@ void input_SendEventPosition( input_thread_t *p_input, double f_position, mtime_
 {
     vlc_value_t val;
 
+    /* The interface loop polls the position even while paused */
+    if( var_GetFloat( p_input, "position" ) == f_position &&
+        var_GetTime( p_input, "time" ) == i_time )
+        return;
+
     /* */
     val.f_float = f_position;
     var_Change( p_input, "position", VLC_VAR_SETVALUE, &val, NULL );
@@ -189,6 +194,10 @@ void input_SendEventCache( input_thread_t *p_input, double f_level )
 {
     vlc_value_t val;
 
+    /* The level is updated for every buffered block, only signal percents */
+    if( (int)(100 * var_GetFloat( p_input, "cache" )) == (int)(100 * f_level) )
+        return;
+
     val.f_float = f_level;
     var_Change( p_input, "cache", VLC_VAR_SETVALUE, &val, NULL );
 
@@ -212,6 +221,15 @@ void input_SendEventMeta( input_thread_t *p_input )
 
 void input_SendEventMetaInfo( input_thread_t *p_input )
 {
+    /* Infos are mostly added by bunches, from any thread: the event is sent
+     * once by input_SendEventMetaInfoPending() from the input thread */
+    atomic_store( &p_input->p->b_info_changed, true );
+}
+void input_SendEventMetaInfoPending( input_thread_t *p_input )
+{
+    if( !atomic_exchange( &p_input->p->b_info_changed, false ) )
+        return;
+
     Trigger( p_input, INPUT_EVENT_ITEM_INFO );
 
     /* FIXME remove this ugliness */
@@ -55,6 +55,7 @@
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_modules.h>
+#include <vlc_memstat.h>
 #include <vlc_playlist.h> // FIXME
 
 /*****************************************************************************
@@ -360,6 +361,7 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
     p_input->p->i_state = INIT_S;
     p_input->p->i_rate = INPUT_RATE_DEFAULT;
     p_input->p->b_recording = false;
+    atomic_init( &p_input->p->b_info_changed, false );
     memset( &p_input->p->bookmark, 0, sizeof(p_input->p->bookmark) );
     TAB_INIT( p_input->p->i_bookmark, p_input->p->pp_bookmark );
     TAB_INIT( p_input->p->i_attachment, p_input->p->attachment );
@@ -538,9 +540,12 @@ static void *Run( void *obj )
     input_thread_t *p_input = (input_thread_t *)obj;
     const int canc = vlc_savecancel();
 
+    vlc_mem_SetAccount( "input" );
     if( Init( p_input ) )
         goto exit;
 
+    /* The demuxer allocates most of the blocks of this thread */
+    vlc_mem_SetAccount( module_get_object( p_input->p->input.p_demux->p_module ) );
     MainLoop( p_input, true ); /* FIXME it can be wrong (like with VLM) */
 
     /* Clean up */
@@ -579,7 +584,14 @@ static void MainLoopDemux( input_thread_t *p_input, bool *pb_changed, bool *pb_d
         ( p_input->p->i_run > 0 && i_start_mdate+p_input->p->i_run < mdate() ) )
         i_ret = 0; /* EOF */
     else
-        i_ret = demux_Demux( p_input->p->input.p_demux );
+    {
+        demux_t *p_demux = p_input->p->input.p_demux;
+        mtime_t i_trace = vlc_trace_Begin();
+
+        i_ret = demux_Demux( p_demux );
+        vlc_trace_End( i_trace, "demux", "demux",
+                       module_get_object( p_demux->p_module ) );
+    }
 
     if( i_ret > 0 )
     {
@@ -701,6 +713,9 @@ static void MainLoopInterface( input_thread_t *p_input )
 
     es_out_SetTimes( p_input->p->p_es_out, f_position, i_time, i_length );
 
+    /* Infos may have been added many at once */
+    input_SendEventMetaInfoPending( p_input );
+
     /* update current bookmark */
     vlc_mutex_lock( &p_input->p->p_item->lock );
     p_input->p->bookmark.i_time_offset = i_time;
@@ -785,7 +800,11 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
         /* */
         do {
             mtime_t i_deadline = i_wakeup;
-            if( b_paused || !b_demux_polled )
+            /* Position and statistics do not change while paused: sleep
+             * until the next control (the state change updated them) */
+            if( b_paused )
+                i_deadline = INT64_MAX;
+            else if( !b_demux_polled )
                 i_deadline = __MIN( i_intf_update, i_statistic_update );
 
             /* Handle control */
@@ -824,6 +843,10 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
                         i_last_seek_mdate = mdate();
                     b_force_update = true;
                 }
+
+                /* The control may have resumed playback */
+                if( b_paused )
+                    break;
             }
 
             /* Update interface and statistics */
@@ -1380,6 +1403,7 @@ static void End( input_thread_t * p_input )
     int i;
 
     /* We are at the end */
+    input_SendEventMetaInfoPending( p_input );
     input_ChangeState( p_input, END_S );
 
     /* Clean control variables */
@@ -1411,6 +1435,8 @@ static void End( input_thread_t * p_input )
         {
             /* make sure we are up to date */
             stats_ComputeInputStats( p_input, p_input->p->p_item->p_stats );
+            stats_HistogramDump( VLC_OBJECT(p_input), "access read",
+                                 &p_input->p->counters.read_latency );
             CL_CO( read_bytes );
             CL_CO( read_packets );
             CL_CO( demux_read );
@@ -1545,8 +1571,10 @@ static inline int ControlPop( input_thread_t *p_input,
             return VLC_EGENERIC;
         }
 
-        if( vlc_cond_timedwait( &p_sys->wait_control, &p_sys->lock_control,
-                                i_deadline ) )
+        if( i_deadline == INT64_MAX )
+            vlc_cond_wait( &p_sys->wait_control, &p_sys->lock_control );
+        else if( vlc_cond_timedwait( &p_sys->wait_control,
+                                     &p_sys->lock_control, i_deadline ) )
         {
             vlc_mutex_unlock( &p_sys->lock_control );
             return VLC_EGENERIC;
@@ -1742,12 +1770,19 @@ static bool Control( input_thread_t *p_input,
             if( i_time < 0 )
                 i_time = 0;
 
-            /* Reset the decoders states and clock sync (before calling the demuxer */
-            es_out_SetTime( p_input->p->p_es_out, -1 );
+            /* A live stream can only be moved within the timeshift buffer */
+            i_ret = VLC_EGENERIC;
+            if( !p_input->p->b_can_pace_control )
+                i_ret = es_out_SetTime( p_input->p->p_es_out, i_time );
+            if( i_ret )
+            {
+                /* Reset the decoders states and clock sync (before calling the demuxer */
+                es_out_SetTime( p_input->p->p_es_out, -1 );
 
-            i_ret = demux_Control( p_input->p->input.p_demux,
-                                   DEMUX_SET_TIME, i_time,
-                                   !p_input->p->b_fast_seek );
+                i_ret = demux_Control( p_input->p->input.p_demux,
+                                       DEMUX_SET_TIME, i_time,
+                                       !p_input->p->b_fast_seek );
+            }
             if( i_ret )
             {
                 int64_t i_length;
@@ -3243,7 +3278,6 @@ void input_UpdateStatistic( input_thread_t *p_input,
 {
     assert( p_input->p->i_state != INIT_S );
 
-    vlc_mutex_lock( &p_input->p->counters.counters_lock);
     switch( i_type )
     {
 #define I(c) stats_Update( p_input->p->counters.c, i_delta, NULL )
@@ -3272,7 +3306,6 @@ void input_UpdateStatistic( input_thread_t *p_input,
         msg_Err( p_input, "Invalid statistic type %d (internal error)", i_type );
         break;
     }
-    vlc_mutex_unlock( &p_input->p->counters.counters_lock);
 }
 
 /**/
@@ -27,6 +27,7 @@
 #include <vlc_access.h>
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_atomic.h>
 #include <libvlc.h>
 #include "input_interface.h"
 
@@ -90,6 +91,7 @@ struct input_thread_private_t
     /* Current state */
     bool        b_recording;
     int         i_rate;
+    atomic_bool b_info_changed; /* Infos changed since the last event */
 
     /* Playtime configuration and state */
     int64_t     i_start;    /* :start-time,0 by default */
@@ -154,6 +156,7 @@ struct input_thread_private_t
         counter_t *p_lost_abuffers;
         counter_t *p_displayed_pictures;
         counter_t *p_lost_pictures;
+        stats_histogram_t read_latency; /* Time blocked in the access */
         vlc_mutex_t counters_lock;
     } counters;
 
@@ -685,8 +685,10 @@ void input_item_MergeInfos( input_item_t *p_item, info_category_t *p_cat )
 }
 
 #define EPG_DEBUG
-void input_item_SetEpg( input_item_t *p_item, const vlc_epg_t *p_update )
+bool input_item_SetEpg( input_item_t *p_item, const vlc_epg_t *p_update )
 {
+    bool b_changed = false;
+
     vlc_mutex_lock( &p_item->lock );
 
     /* */
@@ -712,12 +714,13 @@ void input_item_SetEpg( input_item_t *p_item, const vlc_epg_t *p_update )
             TAB_APPEND( p_item->i_epg, p_item->pp_epg, p_epg );
     }
     if( p_epg )
-        vlc_epg_Merge( p_epg, p_update );
+        b_changed = vlc_epg_Merge( p_epg, p_update );
 
     vlc_mutex_unlock( &p_item->lock );
 
-    if( !p_epg )
-        return;
+    /* Nothing to publish if the update only repeated known events */
+    if( !b_changed )
+        return false;
 
 #ifdef EPG_DEBUG
     char *psz_epg;
@@ -760,6 +763,7 @@ signal:
         vlc_event_t event = { .type = vlc_InputItemInfoChanged, };
         vlc_event_send( &p_item->event_manager, &event );
     }
+    return true;
 }
 
 void input_item_SetEpgOffline( input_item_t *p_item )
@@ -1051,6 +1055,17 @@ void input_item_node_PostAndDelete( input_item_node_t *p_root )
     input_item_node_Delete( p_root );
 }
 
+static void TrackCopyExtra(es_format_t *dst, const es_format_t *src)
+{
+    if (src->i_extra <= 0 || src->p_extra == NULL)
+        return;
+    dst->p_extra = malloc(src->i_extra);
+    if (dst->p_extra == NULL)
+        return;
+    memcpy(dst->p_extra, src->p_extra, src->i_extra);
+    dst->i_extra = src->i_extra;
+}
+
 /* Called by es_out when a new Elementary Stream is added or updated. */
 void input_item_UpdateTracksInfo(input_item_t *item, const es_format_t *fmt)
 {
@@ -1059,7 +1074,12 @@ void input_item_UpdateTracksInfo(input_item_t *item, const es_format_t *fmt)
     if (!fmt_copy)
         return;
 
-    es_format_Copy(fmt_copy, fmt);
+    /* The decoder specific data is copied separately below: updates of an
+     * existing track usually carry the very same bytes, which are kept. */
+    es_format_t fmt_noextra = *fmt;
+    fmt_noextra.i_extra = 0;
+    fmt_noextra.p_extra = NULL;
+    es_format_Copy(fmt_copy, &fmt_noextra);
     /* XXX: we could free p_extra to save memory, we will likely not need
      * the decoder specific data */
 
@@ -1070,15 +1090,28 @@ void input_item_UpdateTracksInfo(input_item_t *item, const es_format_t *fmt)
         if (item->es[i]->i_id != fmt->i_id)
             continue;
 
+        es_format_t *fmt_old = item->es[i];
+        if (fmt->i_extra > 0 && fmt_old->i_extra == fmt->i_extra
+         && !memcmp(fmt_old->p_extra, fmt->p_extra, fmt->i_extra))
+        {
+            fmt_copy->i_extra = fmt_old->i_extra;
+            fmt_copy->p_extra = fmt_old->p_extra;
+            fmt_old->i_extra = 0;
+            fmt_old->p_extra = NULL;
+        }
+        else
+            TrackCopyExtra(fmt_copy, fmt);
+
         /* We've found the right ES, replace it */
-        es_format_Clean(item->es[i]);
-        free(item->es[i]);
+        es_format_Clean(fmt_old);
+        free(fmt_old);
         item->es[i] = fmt_copy;
         vlc_mutex_unlock( &item->lock );
         return;
     }
 
     /* ES not found, insert it */
+    TrackCopyExtra(fmt_copy, fmt);
     TAB_APPEND(item->i_es, item->es, fmt_copy);
     vlc_mutex_unlock( &item->lock );
 }
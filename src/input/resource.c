@@ -41,6 +41,8 @@
 #include "../audio_output/aout_internal.h"
 #include "../video_output/vout_control.h"
 #include "input_interface.h"
+#include "clock.h"
+#include "decoder.h"
 #include "resource.h"
 
 struct input_resource_t
@@ -73,6 +75,8 @@ struct input_resource_t
 
     bool            b_aout_busy;
     audio_output_t *p_aout;
+
+    decoder_t      *p_decoder; /* Kept for the next input */
 };
 
 /* */
@@ -429,6 +433,8 @@ void input_resource_Release( input_resource_t *p_resource )
     if( atomic_fetch_sub( &p_resource->refs, 1 ) != 1 )
         return;
 
+    if( p_resource->p_decoder != NULL )
+        input_DecoderDiscard( p_resource->p_decoder );
     DestroySout( p_resource );
     DestroyVout( p_resource );
     if( p_resource->p_aout != NULL )
@@ -508,8 +514,35 @@ void input_resource_TerminateSout( input_resource_t *p_resource )
     input_resource_RequestSout( p_resource, NULL, NULL );
 }
 
+/* */
+void input_resource_PutDecoder( input_resource_t *p_resource,
+                                decoder_t *p_dec )
+{
+    vlc_mutex_lock( &p_resource->lock );
+    decoder_t *p_old = p_resource->p_decoder;
+    p_resource->p_decoder = p_dec;
+    vlc_mutex_unlock( &p_resource->lock );
+
+    if( p_old != NULL )
+        input_DecoderDiscard( p_old );
+}
+
+decoder_t *input_resource_TakeDecoder( input_resource_t *p_resource )
+{
+    vlc_mutex_lock( &p_resource->lock );
+    decoder_t *p_dec = p_resource->p_decoder;
+    p_resource->p_decoder = NULL;
+    vlc_mutex_unlock( &p_resource->lock );
+
+    return p_dec;
+}
+
 void input_resource_Terminate( input_resource_t *p_resource )
 {
+    decoder_t *p_dec = input_resource_TakeDecoder( p_resource );
+    if( p_dec != NULL )
+        input_DecoderDiscard( p_dec );
+
     input_resource_TerminateSout( p_resource );
     input_resource_TerminateAout( p_resource );
     input_resource_TerminateVout( p_resource );
@@ -65,6 +65,19 @@ vout_thread_t *input_resource_HoldVout( input_resource_t * );
  */
 void input_resource_HoldVouts( input_resource_t *, vout_thread_t ***, size_t * );
 
+/**
+ * This function keeps a stopped decoder for the next input, destroying
+ * the decoder kept before if any.
+ */
+void input_resource_PutDecoder( input_resource_t *, decoder_t * );
+
+/**
+ * This function returns the decoder kept for reuse if any.
+ *
+ * The caller owns the decoder, and must reuse or discard it.
+ */
+decoder_t *input_resource_TakeDecoder( input_resource_t * );
+
 /**
  * This function releases all resources (object).
  */
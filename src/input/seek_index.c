@@ -0,0 +1,314 @@
+/*****************************************************************************
+ * seek_index.c: persistent seek index for demuxers
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+/* Minimal time between two entries */
+#define DEMUX_INDEX_SPACING (CLOCK_FREQ/2)
+/* Maximal number of entries (12 days with the minimal spacing) */
+#define DEMUX_INDEX_MAX     (1 << 21)
+
+#define DEMUX_INDEX_MAGIC   "VLCIDX01"
+#define DEMUX_INDEX_HEADER  (8 + 8 + 8 + 4)
+#define DEMUX_INDEX_ENTRY   (8 + 8)
+
+struct seek_index_t
+{
+    vlc_object_t *p_obj;
+    char         *psz_path;
+
+    /* Identifies the indexed file version */
+    uint64_t     i_size;
+    int64_t      i_mtime;
+
+    /* Sorted by time and position */
+    seek_index_entry_t *p_entry;
+    int          i_entry;
+    int          i_entry_max;
+
+    bool         b_modified;
+};
+
+static char *IndexGetPath( const char *psz_name, const char *psz_file )
+{
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( !psz_cachedir )
+        return NULL;
+
+    char *psz_dir;
+    if( asprintf( &psz_dir, "%s" DIR_SEP "index", psz_cachedir ) == -1 )
+        psz_dir = NULL;
+    else
+    {
+        vlc_mkdir( psz_cachedir, 0700 );
+        vlc_mkdir( psz_dir, 0700 );
+    }
+    free( psz_cachedir );
+    if( !psz_dir )
+        return NULL;
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_name, strlen( psz_name ) + 1 );
+    AddMD5( &md5, psz_file, strlen( psz_file ) );
+    EndMD5( &md5 );
+    char *psz_hash = psz_md5_hash( &md5 );
+
+    char *psz_path;
+    if( !psz_hash ||
+        asprintf( &psz_path, "%s" DIR_SEP "%s", psz_dir, psz_hash ) == -1 )
+        psz_path = NULL;
+    free( psz_hash );
+    free( psz_dir );
+    return psz_path;
+}
+
+static void IndexLoad( seek_index_t *p_index )
+{
+    FILE *f = vlc_fopen( p_index->psz_path, "rb" );
+    if( !f )
+        return;
+
+    uint8_t p_header[DEMUX_INDEX_HEADER];
+    if( fread( p_header, sizeof(p_header), 1, f ) != 1 ||
+        memcmp( p_header, DEMUX_INDEX_MAGIC, 8 ) ||
+        GetQWLE( &p_header[8] ) != p_index->i_size ||
+        (int64_t)GetQWLE( &p_header[16] ) != p_index->i_mtime )
+        goto end;
+
+    const uint32_t i_count = GetDWLE( &p_header[24] );
+    if( i_count > DEMUX_INDEX_MAX )
+        goto end;
+
+    p_index->p_entry = malloc( i_count * sizeof(*p_index->p_entry) );
+    if( !p_index->p_entry )
+        goto end;
+    p_index->i_entry_max = i_count;
+
+    for( uint32_t i = 0; i < i_count; i++ )
+    {
+        uint8_t p_data[DEMUX_INDEX_ENTRY];
+        if( fread( p_data, sizeof(p_data), 1, f ) != 1 )
+            break;
+
+        seek_index_entry_t entry = {
+            .i_time = GetQWLE( &p_data[0] ),
+            .i_pos  = GetQWLE( &p_data[8] ),
+        };
+        if( entry.i_pos < 0 || (uint64_t)entry.i_pos >= p_index->i_size ||
+            ( i > 0 && ( entry.i_time <= p_index->p_entry[i-1].i_time ||
+                         entry.i_pos <= p_index->p_entry[i-1].i_pos ) ) )
+            break;
+        p_index->p_entry[p_index->i_entry++] = entry;
+    }
+    if( p_index->i_entry < (int)i_count )
+    {
+        msg_Warn( p_index->p_obj, "invalid index %s", p_index->psz_path );
+        p_index->i_entry = 0;
+    }
+    else
+    {
+        msg_Dbg( p_index->p_obj, "loaded %d index entries", p_index->i_entry );
+    }
+end:
+    fclose( f );
+}
+
+static void IndexSave( seek_index_t *p_index )
+{
+    char *psz_tmp;
+    if( asprintf( &psz_tmp, "%s.tmp", p_index->psz_path ) == -1 )
+        return;
+
+    FILE *f = vlc_fopen( psz_tmp, "wb" );
+    if( !f )
+        goto error;
+
+    uint8_t p_header[DEMUX_INDEX_HEADER];
+    memcpy( p_header, DEMUX_INDEX_MAGIC, 8 );
+    SetQWLE( &p_header[8], p_index->i_size );
+    SetQWLE( &p_header[16], p_index->i_mtime );
+    SetDWLE( &p_header[24], p_index->i_entry );
+
+    bool b_error = fwrite( p_header, sizeof(p_header), 1, f ) != 1;
+    for( int i = 0; i < p_index->i_entry && !b_error; i++ )
+    {
+        uint8_t p_data[DEMUX_INDEX_ENTRY];
+        SetQWLE( &p_data[0], p_index->p_entry[i].i_time );
+        SetQWLE( &p_data[8], p_index->p_entry[i].i_pos );
+        b_error = fwrite( p_data, sizeof(p_data), 1, f ) != 1;
+    }
+    if( fclose( f ) )
+        b_error = true;
+
+    if( b_error || vlc_rename( psz_tmp, p_index->psz_path ) )
+    {
+        vlc_unlink( psz_tmp );
+        goto error;
+    }
+    msg_Dbg( p_index->p_obj, "saved %d index entries", p_index->i_entry );
+    free( psz_tmp );
+    return;
+
+error:
+    msg_Warn( p_index->p_obj, "cannot save index %s", p_index->psz_path );
+    free( psz_tmp );
+}
+
+seek_index_t *demux_SeekIndexNew( demux_t *p_demux, const char *psz_name )
+{
+    if( !var_InheritBool( p_demux, "demux-index" ) )
+        return NULL;
+
+    /* Only a local file can be identified reliably */
+    if( !p_demux->psz_file || !p_demux->psz_access ||
+        strcmp( p_demux->psz_access, "file" ) )
+        return NULL;
+
+    struct stat st;
+    if( vlc_stat( p_demux->psz_file, &st ) || !S_ISREG( st.st_mode ) )
+        return NULL;
+
+    seek_index_t *p_index = malloc( sizeof(*p_index) );
+    if( !p_index )
+        return NULL;
+
+    p_index->p_obj = VLC_OBJECT(p_demux);
+    p_index->psz_path = IndexGetPath( psz_name, p_demux->psz_file );
+    p_index->i_size = st.st_size;
+    p_index->i_mtime = st.st_mtime;
+    p_index->p_entry = NULL;
+    p_index->i_entry = 0;
+    p_index->i_entry_max = 0;
+    p_index->b_modified = false;
+    if( !p_index->psz_path )
+    {
+        free( p_index );
+        return NULL;
+    }
+
+    IndexLoad( p_index );
+    return p_index;
+}
+
+void demux_SeekIndexDelete( seek_index_t *p_index )
+{
+    if( p_index->b_modified && p_index->i_entry > 0 )
+        IndexSave( p_index );
+
+    free( p_index->p_entry );
+    free( p_index->psz_path );
+    free( p_index );
+}
+
+/* Returns the number of entries at or before i_time */
+static int IndexFind( const seek_index_t *p_index, mtime_t i_time )
+{
+    int i_lo = 0;
+    int i_hi = p_index->i_entry;
+
+    while( i_lo < i_hi )
+    {
+        const int i_mid = i_lo + ( i_hi - i_lo ) / 2;
+        if( p_index->p_entry[i_mid].i_time <= i_time )
+            i_lo = i_mid + 1;
+        else
+            i_hi = i_mid;
+    }
+    return i_lo;
+}
+
+void demux_SeekIndexAdd( seek_index_t *p_index, mtime_t i_time, int64_t i_pos )
+{
+    if( i_pos < 0 )
+        return;
+
+    const int i = IndexFind( p_index, i_time );
+    const seek_index_entry_t *p_prev = i > 0 ? &p_index->p_entry[i-1] : NULL;
+    const seek_index_entry_t *p_next = i < p_index->i_entry ? &p_index->p_entry[i] : NULL;
+
+    if( ( p_prev && ( i_time - p_prev->i_time < DEMUX_INDEX_SPACING ||
+                      i_pos <= p_prev->i_pos ) ) ||
+        ( p_next && ( p_next->i_time - i_time < DEMUX_INDEX_SPACING ||
+                      i_pos >= p_next->i_pos ) ) )
+        return;
+
+    if( p_index->i_entry >= p_index->i_entry_max )
+    {
+        if( p_index->i_entry >= DEMUX_INDEX_MAX )
+            return;
+
+        const int i_max = __MAX( 2 * p_index->i_entry_max, 1024 );
+        seek_index_entry_t *p_entry = realloc( p_index->p_entry,
+                                                i_max * sizeof(*p_entry) );
+        if( !p_entry )
+            return;
+        p_index->p_entry = p_entry;
+        p_index->i_entry_max = i_max;
+    }
+
+    memmove( &p_index->p_entry[i+1], &p_index->p_entry[i],
+             ( p_index->i_entry - i ) * sizeof(*p_index->p_entry) );
+    p_index->p_entry[i].i_time = i_time;
+    p_index->p_entry[i].i_pos = i_pos;
+    p_index->i_entry++;
+    p_index->b_modified = true;
+}
+
+int demux_SeekIndexLookup( seek_index_t *p_index, mtime_t i_time,
+                       seek_index_entry_t *p_before, seek_index_entry_t *p_after )
+{
+    const int i = IndexFind( p_index, i_time );
+
+    p_before->i_time = VLC_TS_INVALID;
+    p_before->i_pos = -1;
+    if( i > 0 )
+        *p_before = p_index->p_entry[i-1];
+
+    if( p_after )
+    {
+        p_after->i_time = VLC_TS_INVALID;
+        p_after->i_pos = -1;
+        if( i < p_index->i_entry )
+            *p_after = p_index->p_entry[i];
+    }
+
+    return i > 0 || i < p_index->i_entry ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+int demux_SeekIndexGet( seek_index_t *p_index, int i_entry, seek_index_entry_t *p_entry )
+{
+    if( i_entry < 0 || i_entry >= p_index->i_entry )
+        return VLC_EGENERIC;
+
+    *p_entry = p_index->p_entry[i_entry];
+    return VLC_SUCCESS;
+}
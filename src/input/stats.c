@@ -41,19 +41,31 @@ counter_t * stats_CounterCreate( int i_compute_type )
 
     if( !p_counter ) return NULL;
     p_counter->i_compute_type = i_compute_type;
+    atomic_init( &p_counter->value, 0 );
     p_counter->i_samples = 0;
-    p_counter->pp_samples = NULL;
-
-    p_counter->last_update = 0;
 
     return p_counter;
 }
 
 static inline int64_t stats_GetTotal(const counter_t *counter)
 {
-    if (counter == NULL || counter->i_samples == 0)
+    if (counter == NULL)
         return 0;
-    return counter->pp_samples[0]->value;
+    return atomic_load_explicit(&counter->value, memory_order_relaxed);
+}
+
+/* Samples a derivative, at most once per second */
+static void stats_Sample(counter_t *counter, mtime_t now)
+{
+    if (counter == NULL || (counter->i_samples > 0
+                       && now - counter->samples[0].date < CLOCK_FREQ))
+        return;
+
+    counter->samples[1] = counter->samples[0];
+    counter->samples[0].value = stats_GetTotal(counter);
+    counter->samples[0].date = now;
+    if (counter->i_samples < 2)
+        counter->i_samples++;
 }
 
 static inline float stats_GetRate(const counter_t *counter)
@@ -61,8 +73,8 @@ static inline float stats_GetRate(const counter_t *counter)
     if (counter == NULL || counter->i_samples < 2)
         return 0.;
 
-    return (counter->pp_samples[0]->value - counter->pp_samples[1]->value)
-        / (float)(counter->pp_samples[0]->date - counter->pp_samples[1]->date);
+    return (counter->samples[0].value - counter->samples[1].value)
+        / (float)(counter->samples[0].date - counter->samples[1].date);
 }
 
 input_stats_t *stats_NewInputStats( input_thread_t *p_input )
@@ -83,9 +95,15 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     if (!libvlc_stats(input))
         return;
 
+    /* Serializes the samples of the derivatives */
     vlc_mutex_lock(&input->p->counters.counters_lock);
     vlc_mutex_lock(&st->lock);
 
+    const mtime_t now = mdate();
+    stats_Sample(input->p->counters.p_input_bitrate, now);
+    stats_Sample(input->p->counters.p_demux_bitrate, now);
+    stats_Sample(input->p->counters.p_sout_send_bitrate, now);
+
     /* Input */
     st->i_read_packets = stats_GetTotal(input->p->counters.p_read_packets);
     st->i_read_bytes = stats_GetTotal(input->p->counters.p_read_bytes);
@@ -115,6 +133,17 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     st->i_displayed_pictures = stats_GetTotal(input->p->counters.p_displayed_pictures);
     st->i_lost_pictures = stats_GetTotal(input->p->counters.p_lost_pictures);
 
+    /* Block pool */
+    block_pool_stats_t pool[BLOCK_POOL_CLASSES];
+
+    block_PoolStats(pool);
+    st->i_block_pool_hits = st->i_block_pool_misses = 0;
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+    {
+        st->i_block_pool_hits += pool[i].hits;
+        st->i_block_pool_misses += pool[i].misses;
+    }
+
     vlc_mutex_unlock(&st->lock);
     vlc_mutex_unlock(&input->p->counters.counters_lock);
 }
@@ -130,25 +159,14 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
-    p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate
-     = 0;
+    p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate =
+    p_stats->i_block_pool_hits = p_stats->i_block_pool_misses = 0;
     vlc_mutex_unlock( &p_stats->lock );
 }
 
 void stats_CounterClean( counter_t *p_c )
 {
-    if( p_c )
-    {
-        int i = p_c->i_samples - 1 ;
-        while( i >= 0 )
-        {
-            counter_sample_t *p_s = p_c->pp_samples[i];
-            REMOVE_ELEM( p_c->pp_samples, p_c->i_samples, i );
-            free( p_s );
-            i--;
-        }
-        free( p_c );
-    }
+    free( p_c );
 }
 
 
@@ -157,6 +175,8 @@ void stats_CounterClean( counter_t *p_c )
  * \param val the vlc_value union containing the new value to aggregate. For
  * more information on how data is aggregated, \see stats_Create
  * \param val_new a pointer that will be filled with new data
+ *
+ * This function does not lock: it can be called from any thread.
  */
 void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
 {
@@ -166,43 +186,66 @@ void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
     switch( p_counter->i_compute_type )
     {
     case STATS_DERIVATIVE:
-    {
-        counter_sample_t *p_new, *p_old;
-        mtime_t now = mdate();
-        if( now - p_counter->last_update < CLOCK_FREQ )
-            return;
-        p_counter->last_update = now;
-        /* Insert the new one at the beginning */
-        p_new = (counter_sample_t*)malloc( sizeof( counter_sample_t ) );
-        p_new->value = val;
-        p_new->date = p_counter->last_update;
-        INSERT_ELEM( p_counter->pp_samples, p_counter->i_samples,
-                     0, p_new );
-
-        if( p_counter->i_samples == 3 )
-        {
-            p_old = p_counter->pp_samples[2];
-            REMOVE_ELEM( p_counter->pp_samples, p_counter->i_samples, 2 );
-            free( p_old );
-        }
+        atomic_store_explicit( &p_counter->value, val, memory_order_relaxed );
         break;
-    }
     case STATS_COUNTER:
-        if( p_counter->i_samples == 0 )
-        {
-            counter_sample_t *p_new = (counter_sample_t*)malloc(
-                                               sizeof( counter_sample_t ) );
-            p_new->value = 0;
-
-            INSERT_ELEM( p_counter->pp_samples, p_counter->i_samples,
-                         p_counter->i_samples, p_new );
-        }
-        if( p_counter->i_samples == 1 )
-        {
-            p_counter->pp_samples[0]->value += val;
-            if( new_val )
-                *new_val = p_counter->pp_samples[0]->value;
-        }
+        val += atomic_fetch_add_explicit( &p_counter->value, val,
+                                          memory_order_relaxed );
+        if( new_val )
+            *new_val = val;
         break;
     }
 }
+
+/**
+ * Adds a duration to a latency histogram. This function does not lock.
+ */
+void stats_HistogramAdd( stats_histogram_t *p_histo, mtime_t i_duration )
+{
+    unsigned i_bucket = 0;
+
+    if( i_duration < 0 )
+        i_duration = 0;
+    while( i_bucket < STATS_HISTOGRAM_BUCKETS - 1 &&
+           i_duration >= (INT64_C(100) << i_bucket) )
+        i_bucket++;
+
+    atomic_fetch_add_explicit( &p_histo->count[i_bucket], 1,
+                               memory_order_relaxed );
+    atomic_fetch_add_explicit( &p_histo->total, i_duration,
+                               memory_order_relaxed );
+
+    uint_least64_t i_max = atomic_load_explicit( &p_histo->max,
+                                                 memory_order_relaxed );
+    while( (uint64_t)i_duration > i_max &&
+           !atomic_compare_exchange_weak_explicit( &p_histo->max, &i_max,
+                     i_duration, memory_order_relaxed, memory_order_relaxed ) );
+}
+
+/**
+ * Prints a latency histogram to the debug log.
+ */
+void stats_HistogramDump( vlc_object_t *p_obj, const char *psz_name,
+                          const stats_histogram_t *p_histo )
+{
+    uint64_t i_count = 0;
+    char psz_buckets[STATS_HISTOGRAM_BUCKETS * 21 + 1], *psz = psz_buckets;
+
+    for( unsigned i = 0; i < STATS_HISTOGRAM_BUCKETS; i++ )
+    {
+        uint64_t i_bucket = atomic_load_explicit( &p_histo->count[i],
+                                                  memory_order_relaxed );
+        i_count += i_bucket;
+        psz += sprintf( psz, " %"PRIu64, i_bucket );
+    }
+    if( i_count == 0 )
+        return;
+
+    msg_Dbg( p_obj, "%s latency: %"PRIu64" samples, mean %"PRIu64
+             " us, max %"PRIu64" us, histogram:%s", psz_name, i_count,
+             (uint64_t)atomic_load_explicit( &p_histo->total,
+                                             memory_order_relaxed ) / i_count,
+             (uint64_t)atomic_load_explicit( &p_histo->max,
+                                             memory_order_relaxed ),
+             psz_buckets );
+}
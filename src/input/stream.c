@@ -58,21 +58,12 @@
  *      It should probably defaulted (instead of the stream method (2)).
  */
 
-/* How many tracks we have, currently only used for stream mode */
-#ifdef OPTIMIZE_MEMORY
-#   define STREAM_CACHE_TRACK 1
-    /* Max size of our cache 128Ko per track */
-#   define STREAM_CACHE_SIZE  (STREAM_CACHE_TRACK*1024*128)
-#else
-#   define STREAM_CACHE_TRACK 3
-    /* Max size of our cache 4Mo per track */
-#   define STREAM_CACHE_SIZE  (4*STREAM_CACHE_TRACK*1024*1024)
-#endif
-
-/* How many data we try to prebuffer
- * XXX it should be small to avoid useless latency but big enough for
+/* The number of tracks (only used for stream mode), the size of each track
+ * and how many data we try to prebuffer are set with the stream-cache-tracks,
+ * stream-cache-size and stream-prebuffer variables. They are inherited from
+ * the access, so that it can override them.
+ * XXX prebuffer should be small to avoid useless latency but big enough for
  * efficient demux probing */
-#define STREAM_CACHE_PREBUFFER_SIZE (128)
 
 /* Method1: Simple, for pf_block.
  *  We get blocks and put them in the linked list.
@@ -93,7 +84,20 @@
  *        - ?
  */
 #define STREAM_READ_ATONCE 1024
-#define STREAM_CACHE_TRACK_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
+
+/* Adaptive read-ahead window (stream mode):
+ *  - it starts at STREAM_WINDOW_MIN,
+ *  - it doubles after STREAM_WINDOW_SEQUENTIAL refills without seeking,
+ *    up to a quarter of a track, or the data read in STREAM_WINDOW_DURATION
+ *    at the measured throughput, whichever is smaller,
+ *  - it halves upon each seek outside the current track. */
+#define STREAM_WINDOW_MIN (10 * STREAM_READ_ATONCE)
+#define STREAM_WINDOW_SEQUENTIAL 4
+#define STREAM_WINDOW_DURATION (CLOCK_FREQ / 4)
+
+/* Largest background read-ahead ring that STREAM_SET_PREFETCH_HINT can
+ * request */
+#define STREAM_PREFETCH_MAX (64 << 20)
 
 typedef struct
 {
@@ -127,6 +131,9 @@ struct stream_sys_t
 
     uint64_t     i_pos;      /* Current reading offset */
 
+    uint64_t     i_cache_size; /* Max size of our cache */
+    unsigned     i_prebuffer;  /* Size to prebuffer */
+
     /* Method 1: pf_block */
     struct
     {
@@ -145,7 +152,9 @@ struct stream_sys_t
     {
         unsigned i_offset;   /* Buffer offset in the current track */
         int      i_tk;       /* Current track */
-        stream_track_t tk[STREAM_CACHE_TRACK];
+        int      i_tk_count;
+        unsigned i_tk_size;  /* Size of each track */
+        stream_track_t *tk;
 
         /* Global buffer */
         uint8_t *p_buffer;
@@ -154,8 +163,33 @@ struct stream_sys_t
         unsigned i_used; /* Used since last read */
         unsigned i_read_size;
 
+        /* Adaptive read-ahead */
+        bool     b_adaptive;
+        unsigned i_window;     /* Max size of a refill */
+        unsigned i_sequential; /* Refills since last seek */
+
     } stream;
 
+    /* Background read-ahead for pf_read (no concatenation list) */
+    struct
+    {
+        bool         b_enabled;
+        vlc_thread_t thread;
+        vlc_mutex_t  lock;
+        vlc_cond_t   wait;
+
+        uint8_t *p_buffer;   /* Ring buffer */
+        size_t   i_size;
+        size_t   i_begin;    /* Offset of the first buffered byte */
+        size_t   i_used;     /* Amount of buffered data */
+
+        bool     b_eof;
+        bool     b_busy;      /* Thread is inside pf_read */
+        bool     b_suspended; /* Thread must not touch the access */
+        bool     b_stop;
+
+    } prefetch;
+
     /* Peek temporary buffer */
     unsigned int i_peek;
     uint8_t *p_peek;
@@ -174,6 +208,12 @@ struct stream_sys_t
         unsigned i_seek_count;
         uint64_t i_seek_time;
 
+        /* Stat about the cache */
+        unsigned i_request_count; /* Read and peek requests */
+        unsigned i_hit_count;     /* Requests served without refill */
+        unsigned i_refill_count;
+        uint64_t i_refill_time;
+
     } stat;
 
     /* Streams list */
@@ -189,6 +229,8 @@ static int  AStreamPeekBlock( stream_t *s, const uint8_t **p_peek, unsigned int
 static int  AStreamSeekBlock( stream_t *s, uint64_t i_pos );
 static void AStreamPrebufferBlock( stream_t *s );
 static block_t *AReadBlock( stream_t *s, bool *pb_eof );
+static int  AStreamPeekVecBlock( stream_t *s, stream_iovec_t *p_vec, int *pi_vec, unsigned int i_read );
+static block_t *AStreamTakeBlock( stream_t *s, unsigned int i_max );
 
 /* Method 2 */
 static int  AStreamReadStream( stream_t *s, void *p_read, unsigned int i_read );
@@ -198,11 +240,20 @@ static void AStreamPrebufferStream( stream_t *s );
 static int  AReadStream( stream_t *s, void *p_read, unsigned int i_read );
 
 /* Common */
+static int AStreamRead( stream_t *s, void *p_read, unsigned int i_read );
+static int AStreamPeek( stream_t *s, const uint8_t **pp_peek, unsigned int i_read );
 static int AStreamControl( stream_t *s, int i_query, va_list );
 static void AStreamDestroy( stream_t *s );
 static void UStreamDestroy( stream_t *s );
 static int  ASeek( stream_t *s, uint64_t i_pos );
 
+static int  APrefetchStart( stream_t *s, size_t i_size );
+static int  APrefetchResize( stream_t *s, size_t i_size );
+static void APrefetchStop( stream_t *s );
+static void APrefetchSuspend( stream_t *s, bool b_flush );
+static void APrefetchResume( stream_t *s );
+static int  APrefetchRead( stream_t *s, void *p_read, unsigned int i_read );
+
 /****************************************************************************
  * stream_CommonNew: create an empty stream structure
  ****************************************************************************/
@@ -315,6 +366,24 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
     p_sys->stat.i_read_count = 0;
     p_sys->stat.i_seek_count = 0;
     p_sys->stat.i_seek_time = 0;
+    p_sys->stat.i_request_count = 0;
+    p_sys->stat.i_hit_count = 0;
+    p_sys->stat.i_refill_count = 0;
+    p_sys->stat.i_refill_time = 0;
+
+    /* Cache settings */
+    int i_tk_count = var_InheritInteger( p_access, "stream-cache-tracks" );
+    int64_t i_tk_size = var_InheritInteger( p_access, "stream-cache-size" );
+    int64_t i_prebuffer = var_InheritInteger( p_access, "stream-prebuffer" );
+
+    p_sys->stream.i_tk_count = VLC_CLIP( i_tk_count, 1, 16 );
+    p_sys->stream.i_tk_size = VLC_CLIP( i_tk_size, 16, 1024 * 1024 ) * 1024;
+    p_sys->i_cache_size = (uint64_t)p_sys->stream.i_tk_count
+                        * p_sys->stream.i_tk_size;
+    p_sys->i_prebuffer = VLC_CLIP( i_prebuffer, 1, 1024 * 1024 );
+    p_sys->stream.tk = NULL;
+    p_sys->stream.p_buffer = NULL;
+    p_sys->prefetch.b_enabled = false;
 
     TAB_INIT( p_sys->i_list, p_sys->list );
     p_sys->i_list_index = 0;
@@ -371,9 +440,10 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
 
     if( p_sys->method == STREAM_METHOD_BLOCK )
     {
-        msg_Dbg( s, "Using block method for AStream*" );
-        s->pf_read = AStreamReadBlock;
-        s->pf_peek = AStreamPeekBlock;
+        msg_Dbg( s, "Using block method for AStream* (cache %"PRIu64" KiB)",
+                 p_sys->i_cache_size / 1024 );
+        s->pf_read = AStreamRead;
+        s->pf_peek = AStreamPeek;
 
         /* Init all fields of p_sys->block */
         p_sys->block.i_start = p_sys->i_pos;
@@ -398,30 +468,37 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
 
         assert( p_sys->method == STREAM_METHOD_STREAM );
 
-        msg_Dbg( s, "Using stream method for AStream*" );
+        msg_Dbg( s, "Using stream method for AStream* (%d tracks of %u KiB)",
+                 p_sys->stream.i_tk_count, p_sys->stream.i_tk_size / 1024 );
 
-        s->pf_read = AStreamReadStream;
-        s->pf_peek = AStreamPeekStream;
+        s->pf_read = AStreamRead;
+        s->pf_peek = AStreamPeek;
 
         /* Allocate/Setup our tracks */
         p_sys->stream.i_offset = 0;
         p_sys->stream.i_tk     = 0;
-        p_sys->stream.p_buffer = malloc( STREAM_CACHE_SIZE );
-        if( p_sys->stream.p_buffer == NULL )
+        p_sys->stream.tk = calloc( p_sys->stream.i_tk_count,
+                                   sizeof( *p_sys->stream.tk ) );
+        p_sys->stream.p_buffer = malloc( p_sys->i_cache_size );
+        if( p_sys->stream.tk == NULL || p_sys->stream.p_buffer == NULL )
             goto error;
         p_sys->stream.i_used   = 0;
         p_sys->stream.i_read_size = STREAM_READ_ATONCE;
 #if STREAM_READ_ATONCE < 256
 #   error "Invalid STREAM_READ_ATONCE value"
 #endif
+        p_sys->stream.b_adaptive = var_InheritBool( p_access,
+                                                    "stream-adaptive" );
+        p_sys->stream.i_window = STREAM_WINDOW_MIN;
+        p_sys->stream.i_sequential = 0;
 
-        for( i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             p_sys->stream.tk[i].i_date  = 0;
             p_sys->stream.tk[i].i_start = p_sys->i_pos;
             p_sys->stream.tk[i].i_end   = p_sys->i_pos;
             p_sys->stream.tk[i].p_buffer=
-                &p_sys->stream.p_buffer[i * STREAM_CACHE_TRACK_SIZE];
+                &p_sys->stream.p_buffer[i * p_sys->stream.i_tk_size];
         }
 
         /* Do the prebuffering */
@@ -432,6 +509,11 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
             msg_Err( s, "cannot pre fill buffer" );
             goto error;
         }
+
+        /* Start reading ahead in the background if requested */
+        int64_t i_prefetch = var_InheritInteger( p_access, "stream-prefetch" );
+        if( i_prefetch > 0 && !p_sys->i_list )
+            APrefetchStart( s, VLC_CLIP( i_prefetch, 16, 1024 * 1024 ) * 1024 );
     }
 
     return s;
@@ -444,6 +526,7 @@ error:
     else
     {
         free( p_sys->stream.p_buffer );
+        free( p_sys->stream.tk );
     }
     while( p_sys->i_list > 0 )
         free( p_sys->list[--(p_sys->i_list)] );
@@ -460,10 +543,26 @@ static void AStreamDestroy( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
+    if( p_sys->stat.i_request_count > 0 )
+        msg_Dbg( s, "cache hits %u/%u (%u%%), %u refills, "
+                 "average refill latency %"PRIu64" us",
+                 p_sys->stat.i_hit_count, p_sys->stat.i_request_count,
+                 p_sys->stat.i_hit_count * 100 / p_sys->stat.i_request_count,
+                 p_sys->stat.i_refill_count,
+                 p_sys->stat.i_refill_count ? p_sys->stat.i_refill_time
+                                              / p_sys->stat.i_refill_count
+                                            : 0 );
+
+    if( p_sys->prefetch.b_enabled )
+        APrefetchStop( s );
+
     if( p_sys->method == STREAM_METHOD_BLOCK )
         block_ChainRelease( p_sys->block.p_first );
     else
+    {
         free( p_sys->stream.p_buffer );
+        free( p_sys->stream.tk );
+    }
 
     free( p_sys->p_peek );
 
@@ -523,8 +622,9 @@ static void AStreamControlReset( stream_t *s )
         p_sys->stream.i_offset = 0;
         p_sys->stream.i_tk     = 0;
         p_sys->stream.i_used   = 0;
+        p_sys->stream.i_sequential = 0;
 
-        for( i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             p_sys->stream.tk[i].i_date  = 0;
             p_sys->stream.tk[i].i_start = p_sys->i_pos;
@@ -543,7 +643,15 @@ static void AStreamControlUpdate( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    p_sys->i_pos = p_sys->p_access->info.i_pos;
+    if( p_sys->prefetch.b_enabled )
+    {
+        /* The access is ahead of us by what has been read in advance */
+        APrefetchSuspend( s, false );
+        p_sys->i_pos = p_sys->p_access->info.i_pos - p_sys->prefetch.i_used;
+        APrefetchResume( s );
+    }
+    else
+        p_sys->i_pos = p_sys->p_access->info.i_pos;
 
     if( p_sys->i_list )
     {
@@ -623,9 +731,15 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
                             "DON'T USE STREAM_CONTROL_ACCESS !!!" );
                 return VLC_EGENERIC;
             }
+            const bool b_reset = i_int == ACCESS_SET_TITLE
+                              || i_int == ACCESS_SET_SEEKPOINT;
+            if( p_sys->prefetch.b_enabled )
+                APrefetchSuspend( s, b_reset );
             int i_ret = access_vaControl( p_access, i_int, args );
-            if( i_int == ACCESS_SET_TITLE || i_int == ACCESS_SET_SEEKPOINT )
+            if( b_reset )
                 AStreamControlReset( s );
+            if( p_sys->prefetch.b_enabled )
+                APrefetchResume( s );
             return i_ret;
         }
 
@@ -636,6 +750,14 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
         case STREAM_GET_CONTENT_TYPE:
             return access_Control( p_access, ACCESS_GET_CONTENT_TYPE,
                                     va_arg( args, char ** ) );
+        case STREAM_SET_PREFETCH_HINT:
+            i_64 = va_arg( args, uint64_t );
+            if( !p_sys->prefetch.b_enabled )
+                return VLC_EGENERIC;
+            if( i_64 > p_sys->prefetch.i_size )
+                return APrefetchResize( s, __MIN( i_64, STREAM_PREFETCH_MAX ) );
+            return VLC_SUCCESS;
+
         case STREAM_SET_RECORD_STATE:
         default:
             msg_Err( s, "invalid stream_vaControl query=0x%x", i_query );
@@ -644,6 +766,43 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
     return VLC_SUCCESS;
 }
 
+/****************************************************************************
+ * AStreamRead/AStreamPeek: dispatch to the method and account cache hits
+ ****************************************************************************/
+static int AStreamRead( stream_t *s, void *p_read, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    const unsigned i_refill = p_sys->stat.i_refill_count;
+    int i_ret;
+
+    if( p_sys->method == STREAM_METHOD_BLOCK )
+        i_ret = AStreamReadBlock( s, p_read, i_read );
+    else
+        i_ret = AStreamReadStream( s, p_read, i_read );
+
+    p_sys->stat.i_request_count++;
+    if( p_sys->stat.i_refill_count == i_refill )
+        p_sys->stat.i_hit_count++;
+    return i_ret;
+}
+
+static int AStreamPeek( stream_t *s, const uint8_t **pp_peek, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    const unsigned i_refill = p_sys->stat.i_refill_count;
+    int i_ret;
+
+    if( p_sys->method == STREAM_METHOD_BLOCK )
+        i_ret = AStreamPeekBlock( s, pp_peek, i_read );
+    else
+        i_ret = AStreamPeekStream( s, pp_peek, i_read );
+
+    p_sys->stat.i_request_count++;
+    if( p_sys->stat.i_refill_count == i_refill )
+        p_sys->stat.i_hit_count++;
+    return i_ret;
+}
+
 /****************************************************************************
  * Method 1:
  ****************************************************************************/
@@ -662,7 +821,7 @@ static void AStreamPrebufferBlock( stream_t *s )
         bool b_eof;
         block_t *b;
 
-        if( !vlc_object_alive(s) || p_sys->block.i_size > STREAM_CACHE_PREBUFFER_SIZE )
+        if( !vlc_object_alive(s) || p_sys->block.i_size > p_sys->i_prebuffer )
         {
             int64_t i_byterate;
 
@@ -771,6 +930,23 @@ static int AStreamReadBlock( stream_t *s, void *p_read, unsigned int i_read )
     return i_data;
 }
 
+/* Buffers at least i_read bytes after the current position if possible */
+static void AStreamFillBlock( stream_t *s, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    while( p_sys->block.i_size - (p_sys->i_pos - p_sys->block.i_start)
+           < i_read )
+    {
+        block_t **pp_last = p_sys->block.pp_last;
+
+        if( AStreamRefillBlock( s ) ) break;
+
+        /* Our buffer are probably filled enough, don't try anymore */
+        if( pp_last == p_sys->block.pp_last ) break;
+    }
+}
+
 static int AStreamPeekBlock( stream_t *s, const uint8_t **pp_peek, unsigned int i_read )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -800,17 +976,7 @@ static int AStreamPeekBlock( stream_t *s, const uint8_t **pp_peek, unsigned int
         p_sys->i_peek = i_read;
     }
 
-    /* Fill enough data */
-    while( p_sys->block.i_size - (p_sys->i_pos - p_sys->block.i_start)
-           < i_read )
-    {
-        block_t **pp_last = p_sys->block.pp_last;
-
-        if( AStreamRefillBlock( s ) ) break;
-
-        /* Our buffer are probably filled enough, don't try anymore */
-        if( pp_last == p_sys->block.pp_last ) break;
-    }
+    AStreamFillBlock( s, i_read );
 
     /* Copy what we have */
     b = p_sys->block.p_current;
@@ -838,6 +1004,95 @@ static int AStreamPeekBlock( stream_t *s, const uint8_t **pp_peek, unsigned int
     return i_data;
 }
 
+static int AStreamPeekVecBlock( stream_t *s, stream_iovec_t *p_vec,
+                                int *pi_vec, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    unsigned int i_data = 0;
+    int i_vec = 0;
+
+    if( p_sys->block.p_current != NULL )
+        AStreamFillBlock( s, i_read );
+
+    /* Point into the blocks, without copying anything */
+    block_t *b = p_sys->block.p_current;
+    size_t i_offset = p_sys->block.i_offset;
+
+    while( b && i_data < i_read && i_vec < *pi_vec )
+    {
+        size_t i_len = __MIN( b->i_buffer - i_offset, i_read - i_data );
+
+        if( i_len > 0 )
+        {
+            p_vec[i_vec].p_base = &b->p_buffer[i_offset];
+            p_vec[i_vec].i_len = i_len;
+            i_vec++;
+            i_data += i_len;
+        }
+        i_offset = 0;
+        b = b->p_next;
+    }
+
+    *pi_vec = i_vec;
+    return i_data;
+}
+
+/* Hands the data of the current block over to the caller. The block itself
+ * is detached from the cache if the current position is at its start and it
+ * is not larger than i_max, otherwise what is left of it is copied. */
+static block_t *AStreamTakeBlock( stream_t *s, unsigned int i_max )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    block_t *b = p_sys->block.p_current;
+
+    if( b == NULL )
+        return NULL; /* EOF */
+
+    if( p_sys->block.i_offset > 0 || b->i_buffer > i_max )
+    {
+        size_t i_copy = __MIN( b->i_buffer - p_sys->block.i_offset, i_max );
+        block_t *p_copy = block_Alloc( i_copy );
+
+        if( p_copy == NULL )
+            return NULL;
+        AStreamReadBlock( s, p_copy->p_buffer, i_copy );
+        return p_copy;
+    }
+
+    /* Drop what precedes the current block: it cannot stay linked
+     * to the cache without the block we are handing out */
+    while( p_sys->block.p_first != b )
+    {
+        block_t *p_prev = p_sys->block.p_first;
+
+        p_sys->block.i_start += p_prev->i_buffer;
+        p_sys->block.i_size  -= p_prev->i_buffer;
+        p_sys->block.p_first  = p_prev->p_next;
+        block_Release( p_prev );
+    }
+
+    /* Detach it */
+    p_sys->block.p_first = b->p_next;
+    if( p_sys->block.pp_last == &b->p_next )
+        p_sys->block.pp_last = &p_sys->block.p_first;
+    p_sys->block.i_start += b->i_buffer;
+    p_sys->block.i_size  -= b->i_buffer;
+    p_sys->block.p_current = p_sys->block.p_first;
+    p_sys->i_pos += b->i_buffer;
+    b->p_next = NULL;
+
+    /* Get a new block if needed */
+    if( p_sys->block.p_current == NULL )
+        AStreamRefillBlock( s );
+
+    if( b->i_buffer == 0 )
+    {
+        block_Release( b );
+        return AStreamTakeBlock( s, i_max );
+    }
+    return b;
+}
+
 static int AStreamSeekBlock( stream_t *s, uint64_t i_pos )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -903,7 +1158,7 @@ static int AStreamSeekBlock( stream_t *s, uint64_t i_pos )
             int i_th = b_aseekfast ? 1 : 5;
 
             if( i_skip <= i_th * i_avg &&
-                i_skip < STREAM_CACHE_SIZE )
+                (uint64_t)i_skip < p_sys->i_cache_size )
                 b_seek = false;
             else
                 b_seek = true;
@@ -975,7 +1230,7 @@ static int AStreamRefillBlock( stream_t *s )
     block_t      *b;
 
     /* Release data */
-    while( p_sys->block.i_size >= STREAM_CACHE_SIZE &&
+    while( p_sys->block.i_size >= p_sys->i_cache_size &&
            p_sys->block.p_first != p_sys->block.p_current )
     {
         block_t *b = p_sys->block.p_first;
@@ -986,7 +1241,7 @@ static int AStreamRefillBlock( stream_t *s )
 
         block_Release( b );
     }
-    if( p_sys->block.i_size >= STREAM_CACHE_SIZE &&
+    if( p_sys->block.i_size >= p_sys->i_cache_size &&
         p_sys->block.p_current == p_sys->block.p_first &&
         p_sys->block.p_current->p_next )    /* At least 2 packets */
     {
@@ -1010,7 +1265,10 @@ static int AStreamRefillBlock( stream_t *s )
             return VLC_EGENERIC;
     }
 
-    p_sys->stat.i_read_time += mdate() - i_start;
+    const int64_t i_time = mdate() - i_start;
+    p_sys->stat.i_read_time += i_time;
+    p_sys->stat.i_refill_time += i_time;
+    p_sys->stat.i_refill_count++;
     while( b )
     {
         /* Append the block */
@@ -1038,6 +1296,47 @@ static int AStreamRefillBlock( stream_t *s )
 static int AStreamRefillStream( stream_t *s );
 static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_read );
 
+/* Grow the read-ahead window while reading sequentially */
+static void AStreamWindowGrow( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( !p_sys->stream.b_adaptive ||
+        ++p_sys->stream.i_sequential < STREAM_WINDOW_SEQUENTIAL )
+        return;
+    p_sys->stream.i_sequential = 0;
+
+    /* Do not read ahead more than a fraction of a second worth of data */
+    uint64_t i_max = p_sys->stream.i_tk_size / 4;
+    if( p_sys->stat.i_read_time > 0 )
+    {
+        uint64_t i_rate = p_sys->stat.i_bytes * STREAM_WINDOW_DURATION
+                        / p_sys->stat.i_read_time;
+        if( i_rate < i_max )
+            i_max = i_rate;
+    }
+
+    if( p_sys->stream.i_window < i_max )
+    {
+        p_sys->stream.i_window = __MIN( 2 * p_sys->stream.i_window, i_max );
+#ifdef STREAM_DEBUG
+        msg_Dbg( s, "read-ahead window grown to %u bytes",
+                 p_sys->stream.i_window );
+#endif
+    }
+}
+
+/* Shrink the read-ahead window when seeking */
+static void AStreamWindowShrink( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    p_sys->stream.i_sequential = 0;
+    if( p_sys->stream.b_adaptive )
+        p_sys->stream.i_window = __MAX( p_sys->stream.i_window / 2,
+                                        STREAM_WINDOW_MIN );
+}
+
 static int AStreamReadStream( stream_t *s, void *p_read, unsigned int i_read )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -1072,8 +1371,8 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
 #endif
 
     /* Avoid problem, but that should *never* happen */
-    if( i_read > STREAM_CACHE_TRACK_SIZE / 2 )
-        i_read = STREAM_CACHE_TRACK_SIZE / 2;
+    if( i_read > p_sys->stream.i_tk_size / 2 )
+        i_read = p_sys->stream.i_tk_size / 2;
 
     while( tk->i_end < tk->i_start + p_sys->stream.i_offset + i_read )
     {
@@ -1092,8 +1391,8 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
 
 
     /* Now, direct pointer or a copy ? */
-    i_off = (tk->i_start + p_sys->stream.i_offset) % STREAM_CACHE_TRACK_SIZE;
-    if( i_off + i_read <= STREAM_CACHE_TRACK_SIZE )
+    i_off = (tk->i_start + p_sys->stream.i_offset) % p_sys->stream.i_tk_size;
+    if( i_off + i_read <= p_sys->stream.i_tk_size )
     {
         *pp_peek = &tk->p_buffer[i_off];
         return i_read;
@@ -1111,9 +1410,9 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
     }
 
     memcpy( p_sys->p_peek, &tk->p_buffer[i_off],
-            STREAM_CACHE_TRACK_SIZE - i_off );
-    memcpy( &p_sys->p_peek[STREAM_CACHE_TRACK_SIZE - i_off],
-            &tk->p_buffer[0], i_read - (STREAM_CACHE_TRACK_SIZE - i_off) );
+            p_sys->stream.i_tk_size - i_off );
+    memcpy( &p_sys->p_peek[p_sys->stream.i_tk_size - i_off],
+            &tk->p_buffer[0], i_read - (p_sys->stream.i_tk_size - i_off) );
 
     *pp_peek = p_sys->p_peek;
     return i_read;
@@ -1172,7 +1471,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     if( !tk )
     {
         /* Try to maximize already read data */
-        for( int i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             stream_track_t *t = &p_sys->stream.tk[i];
 
@@ -1189,7 +1488,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     if( !tk )
     {
         /* Use the oldest unused */
-        for( int i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             stream_track_t *t = &p_sys->stream.tk[i];
 
@@ -1200,7 +1499,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
             }
         }
     }
-    assert( i_tk_idx >= 0 && i_tk_idx < STREAM_CACHE_TRACK );
+    assert( i_tk_idx >= 0 && i_tk_idx < p_sys->stream.i_tk_count );
 
     if( tk != p_current )
         i_skip_threshold = 0;
@@ -1215,6 +1514,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
         if( tk != p_current )
         {
             assert( b_aseek );
+            AStreamWindowShrink( s );
 
             /* Seek at the end of the buffer
              * TODO it is stupid to seek now, it would be better to delay it
@@ -1240,6 +1540,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
         msg_Err( s, "AStreamSeekStream: hard seek" );
 #endif
         /* Nothing good, seek and choose oldest segment */
+        AStreamWindowShrink( s );
         if( ASeek( s, i_pos ) )
             return VLC_EGENERIC;
 
@@ -1286,10 +1587,10 @@ static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_re
 
     while( i_data < i_read )
     {
-        unsigned i_off = (tk->i_start + p_sys->stream.i_offset) % STREAM_CACHE_TRACK_SIZE;
+        unsigned i_off = (tk->i_start + p_sys->stream.i_offset) % p_sys->stream.i_tk_size;
         unsigned int i_current =
             __MIN( tk->i_end - tk->i_start - p_sys->stream.i_offset,
-                   STREAM_CACHE_TRACK_SIZE - i_off );
+                   p_sys->stream.i_tk_size - i_off );
         int i_copy = __MIN( i_current, i_read - i_data );
 
         if( i_copy <= 0 ) break; /* EOF */
@@ -1314,7 +1615,7 @@ static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_re
         {
             const unsigned i_read_requested = VLC_CLIP( i_read - i_data,
                                                     STREAM_READ_ATONCE / 2,
-                                                    STREAM_READ_ATONCE * 10 );
+                                                    p_sys->stream.i_window );
 
             if( p_sys->stream.i_used < i_read_requested )
                 p_sys->stream.i_used = i_read_requested;
@@ -1338,7 +1639,7 @@ static int AStreamRefillStream( stream_t *s )
 
     /* We read but won't increase i_start after initial start + offset */
     int i_toread =
-        __MIN( p_sys->stream.i_used, STREAM_CACHE_TRACK_SIZE -
+        __MIN( p_sys->stream.i_used, p_sys->stream.i_tk_size -
                (tk->i_end - tk->i_start - p_sys->stream.i_offset) );
     bool b_read = false;
     int64_t i_start, i_stop;
@@ -1353,13 +1654,13 @@ static int AStreamRefillStream( stream_t *s )
     i_start = mdate();
     while( i_toread > 0 )
     {
-        int i_off = tk->i_end % STREAM_CACHE_TRACK_SIZE;
+        int i_off = tk->i_end % p_sys->stream.i_tk_size;
         int i_read;
 
         if( !vlc_object_alive(s) )
             return VLC_EGENERIC;
 
-        i_read = __MIN( i_toread, STREAM_CACHE_TRACK_SIZE - i_off );
+        i_read = __MIN( i_toread, p_sys->stream.i_tk_size - i_off );
         i_read = AReadStream( s, &tk->p_buffer[i_off], i_read );
 
         /* msg_Dbg( s, "AStreamRefillStream: read=%d", i_read ); */
@@ -1378,10 +1679,10 @@ static int AStreamRefillStream( stream_t *s )
         /* Update end */
         tk->i_end += i_read;
 
-        /* Windows of STREAM_CACHE_TRACK_SIZE */
-        if( tk->i_start + STREAM_CACHE_TRACK_SIZE < tk->i_end )
+        /* Windows of p_sys->stream.i_tk_size */
+        if( tk->i_start + p_sys->stream.i_tk_size < tk->i_end )
         {
-            unsigned i_invalid = tk->i_end - tk->i_start - STREAM_CACHE_TRACK_SIZE;
+            unsigned i_invalid = tk->i_end - tk->i_start - p_sys->stream.i_tk_size;
 
             tk->i_start += i_invalid;
             p_sys->stream.i_offset -= i_invalid;
@@ -1396,7 +1697,10 @@ static int AStreamRefillStream( stream_t *s )
     i_stop = mdate();
 
     p_sys->stat.i_read_time += i_stop - i_start;
+    p_sys->stat.i_refill_time += i_stop - i_start;
+    p_sys->stat.i_refill_count++;
 
+    AStreamWindowGrow( s );
     return VLC_SUCCESS;
 }
 
@@ -1417,7 +1721,7 @@ static void AStreamPrebufferStream( stream_t *s )
         int i_read;
         int i_buffered = tk->i_end - tk->i_start;
 
-        if( !vlc_object_alive(s) || i_buffered >= STREAM_CACHE_PREBUFFER_SIZE )
+        if( !vlc_object_alive(s) || i_buffered >= (int)p_sys->i_prebuffer )
         {
             int64_t i_byterate;
 
@@ -1436,7 +1740,7 @@ static void AStreamPrebufferStream( stream_t *s )
         }
 
         /* */
-        i_read = STREAM_CACHE_TRACK_SIZE - i_buffered;
+        i_read = p_sys->stream.i_tk_size - i_buffered;
         i_read = __MIN( (int)p_sys->stream.i_read_size, i_read );
         i_read = AReadStream( s, &tk->p_buffer[i_buffered], i_read );
         if( i_read <  0 )
@@ -1648,26 +1952,42 @@ error:
 /****************************************************************************
  * Access reading/seeking wrappers to handle concatenated streams.
  ****************************************************************************/
+/* Accounts for a read from the access, which started at i_start */
+static void AReadStats( stream_t *s, uint64_t i_read, mtime_t i_start,
+                        mtime_t i_trace )
+{
+    input_thread_t *p_input = s->p_input;
+
+    vlc_trace_End( i_trace, "io", "read", s->p_sys->p_access->psz_access );
+    if( !p_input )
+        return;
+
+    uint64_t total;
+
+    stats_Update( p_input->p->counters.p_read_bytes, i_read, &total );
+    stats_Update( p_input->p->counters.p_input_bitrate, total, NULL );
+    stats_Update( p_input->p->counters.p_read_packets, 1, NULL );
+    if( i_start != 0 )
+        stats_HistogramAdd( &p_input->p->counters.read_latency,
+                            mdate() - i_start );
+}
+
 static int AReadStream( stream_t *s, void *p_read, unsigned int i_read )
 {
     stream_sys_t *p_sys = s->p_sys;
     access_t *p_access = p_sys->p_access;
     input_thread_t *p_input = s->p_input;
+    const mtime_t i_start = p_input && libvlc_stats( p_input ) ? mdate() : 0;
+    const mtime_t i_trace = vlc_trace_Begin();
     int i_read_orig = i_read;
 
     if( !p_sys->i_list )
     {
-        i_read = p_access->pf_read( p_access, p_read, i_read );
-        if( p_input )
-        {
-            uint64_t total;
-
-            vlc_mutex_lock( &p_input->p->counters.counters_lock );
-            stats_Update( p_input->p->counters.p_read_bytes, i_read, &total );
-            stats_Update( p_input->p->counters.p_input_bitrate, total, NULL );
-            stats_Update( p_input->p->counters.p_read_packets, 1, NULL );
-            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
-        }
+        if( p_sys->prefetch.b_enabled && !p_sys->prefetch.b_suspended )
+            i_read = APrefetchRead( s, p_read, i_read );
+        else
+            i_read = p_access->pf_read( p_access, p_read, i_read );
+        AReadStats( s, i_read, i_start, i_trace );
         return i_read;
     }
 
@@ -1696,16 +2016,7 @@ static int AReadStream( stream_t *s, void *p_read, unsigned int i_read )
     }
 
     /* Update read bytes in input */
-    if( p_input )
-    {
-        uint64_t total;
-
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
-        stats_Update( p_input->p->counters.p_read_bytes, i_read, &total );
-        stats_Update( p_input->p->counters.p_input_bitrate, total, NULL );
-        stats_Update( p_input->p->counters.p_read_packets, 1, NULL );
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
-    }
+    AReadStats( s, i_read, i_start, i_trace );
     return i_read;
 }
 
@@ -1714,6 +2025,8 @@ static block_t *AReadBlock( stream_t *s, bool *pb_eof )
     stream_sys_t *p_sys = s->p_sys;
     access_t *p_access = p_sys->p_access;
     input_thread_t *p_input = s->p_input;
+    const mtime_t i_start = p_input && libvlc_stats( p_input ) ? mdate() : 0;
+    const mtime_t i_trace = vlc_trace_Begin();
     block_t *p_block;
     bool b_eof;
 
@@ -1721,18 +2034,8 @@ static block_t *AReadBlock( stream_t *s, bool *pb_eof )
     {
         p_block = p_access->pf_block( p_access );
         if( pb_eof ) *pb_eof = p_access->info.b_eof;
-        if( p_input && p_block && libvlc_stats (p_access) )
-        {
-            uint64_t total;
-
-            vlc_mutex_lock( &p_input->p->counters.counters_lock );
-            stats_Update( p_input->p->counters.p_read_bytes,
-                          p_block->i_buffer, &total );
-            stats_Update( p_input->p->counters.p_input_bitrate,
-                          total, NULL );
-            stats_Update( p_input->p->counters.p_read_packets, 1, NULL );
-            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
-        }
+        if( p_block )
+            AReadStats( s, p_block->i_buffer, i_start, i_trace );
         return p_block;
     }
 
@@ -1761,19 +2064,7 @@ static block_t *AReadBlock( stream_t *s, bool *pb_eof )
         return AReadBlock( s, pb_eof );
     }
     if( p_block )
-    {
-        if( p_input )
-        {
-            uint64_t total;
-
-            vlc_mutex_lock( &p_input->p->counters.counters_lock );
-            stats_Update( p_input->p->counters.p_read_bytes,
-                          p_block->i_buffer, &total );
-            stats_Update( p_input->p->counters.p_input_bitrate, total, NULL );
-            stats_Update( p_input->p->counters.p_read_packets, 1 , NULL);
-            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
-        }
-    }
+        AReadStats( s, p_block->i_buffer, i_start, i_trace );
     return p_block;
 }
 
@@ -1823,9 +2114,214 @@ static int ASeek( stream_t *s, uint64_t i_pos )
                                               i_pos - i_size );
     }
 
+    if( p_sys->prefetch.b_enabled )
+    {
+        APrefetchSuspend( s, true );
+        int i_ret = p_access->pf_seek( p_access, i_pos );
+        APrefetchResume( s );
+        return i_ret;
+    }
     return p_access->pf_seek( p_access, i_pos );
 }
 
+/****************************************************************************
+ * Background read-ahead
+ *
+ * A thread calls pf_read into a ring buffer ahead of the reader, so that
+ * refilling the cache only waits for the access when the ring runs dry.
+ * Whoever needs the access itself (seek, controls) suspends the thread
+ * first; suspending waits for any pending pf_read to complete.
+ ****************************************************************************/
+static void *APrefetchThread( void *data )
+{
+    stream_t *s = data;
+    stream_sys_t *p_sys = s->p_sys;
+    access_t *p_access = p_sys->p_access;
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    for( ;; )
+    {
+        while( !p_sys->prefetch.b_stop
+            && ( p_sys->prefetch.b_suspended || p_sys->prefetch.b_eof
+              || p_sys->prefetch.i_used >= p_sys->prefetch.i_size ) )
+            vlc_cond_wait( &p_sys->prefetch.wait, &p_sys->prefetch.lock );
+        if( p_sys->prefetch.b_stop )
+            break;
+
+        /* Read into the contiguous free space, a bit at a time so that
+         * the reader does not wait for a whole ring worth of data */
+        size_t i_off = ( p_sys->prefetch.i_begin + p_sys->prefetch.i_used )
+                       % p_sys->prefetch.i_size;
+        size_t i_len = __MIN( p_sys->prefetch.i_size - p_sys->prefetch.i_used,
+                              p_sys->prefetch.i_size - i_off );
+        i_len = __MIN( i_len, __MAX( p_sys->prefetch.i_size / 4,
+                                     STREAM_READ_ATONCE ) );
+
+        p_sys->prefetch.b_busy = true;
+        vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+        ssize_t i_read = p_access->pf_read( p_access,
+                                            &p_sys->prefetch.p_buffer[i_off],
+                                            i_len );
+
+        vlc_mutex_lock( &p_sys->prefetch.lock );
+        p_sys->prefetch.b_busy = false;
+        if( i_read > 0 )
+            p_sys->prefetch.i_used += i_read;
+        else if( i_read == 0 )
+            p_sys->prefetch.b_eof = true;
+        /* i_read < 0: nothing available yet, try again */
+        vlc_cond_broadcast( &p_sys->prefetch.wait );
+    }
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+static int APrefetchStart( stream_t *s, size_t i_size )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    p_sys->prefetch.p_buffer = malloc( i_size );
+    if( p_sys->prefetch.p_buffer == NULL )
+        return VLC_ENOMEM;
+    p_sys->prefetch.i_size = i_size;
+    p_sys->prefetch.i_begin = 0;
+    p_sys->prefetch.i_used = 0;
+    p_sys->prefetch.b_eof = false;
+    p_sys->prefetch.b_busy = false;
+    p_sys->prefetch.b_suspended = false;
+    p_sys->prefetch.b_stop = false;
+    vlc_mutex_init( &p_sys->prefetch.lock );
+    vlc_cond_init( &p_sys->prefetch.wait );
+
+    if( vlc_clone( &p_sys->prefetch.thread, APrefetchThread, s,
+                   VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        msg_Warn( s, "cannot start read-ahead thread" );
+        vlc_cond_destroy( &p_sys->prefetch.wait );
+        vlc_mutex_destroy( &p_sys->prefetch.lock );
+        free( p_sys->prefetch.p_buffer );
+        return VLC_EGENERIC;
+    }
+    p_sys->prefetch.b_enabled = true;
+    msg_Dbg( s, "reading ahead up to %zu KiB in the background",
+             i_size / 1024 );
+    return VLC_SUCCESS;
+}
+
+static void APrefetchStop( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.b_stop = true;
+    vlc_cond_broadcast( &p_sys->prefetch.wait );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    vlc_join( p_sys->prefetch.thread, NULL );
+    vlc_cond_destroy( &p_sys->prefetch.wait );
+    vlc_mutex_destroy( &p_sys->prefetch.lock );
+    free( p_sys->prefetch.p_buffer );
+    p_sys->prefetch.b_enabled = false;
+}
+
+/* Grows the ring buffer, keeping the data already read in advance */
+static int APrefetchResize( stream_t *s, size_t i_size )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( i_size <= p_sys->prefetch.i_size )
+        return VLC_SUCCESS;
+
+    uint8_t *p_buffer = malloc( i_size );
+    if( p_buffer == NULL )
+        return VLC_ENOMEM;
+
+    APrefetchSuspend( s, false );
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    size_t i_first = __MIN( p_sys->prefetch.i_used,
+                            p_sys->prefetch.i_size - p_sys->prefetch.i_begin );
+    memcpy( p_buffer, &p_sys->prefetch.p_buffer[p_sys->prefetch.i_begin],
+            i_first );
+    memcpy( &p_buffer[i_first], p_sys->prefetch.p_buffer,
+            p_sys->prefetch.i_used - i_first );
+    free( p_sys->prefetch.p_buffer );
+    p_sys->prefetch.p_buffer = p_buffer;
+    p_sys->prefetch.i_size = i_size;
+    p_sys->prefetch.i_begin = 0;
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+    APrefetchResume( s );
+
+    msg_Dbg( s, "reading ahead up to %zu KiB in the background",
+             i_size / 1024 );
+    return VLC_SUCCESS;
+}
+
+/* Gives the access back to the calling thread until APrefetchResume().
+ * If b_flush is set, the data read in advance is dropped, as it does not
+ * match the access position any longer. */
+static void APrefetchSuspend( stream_t *s, bool b_flush )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.b_suspended = true;
+    while( p_sys->prefetch.b_busy )
+        vlc_cond_wait( &p_sys->prefetch.wait, &p_sys->prefetch.lock );
+    if( b_flush )
+    {
+        p_sys->prefetch.i_begin = 0;
+        p_sys->prefetch.i_used = 0;
+        p_sys->prefetch.b_eof = false;
+    }
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+}
+
+static void APrefetchResume( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.b_suspended = false;
+    vlc_cond_broadcast( &p_sys->prefetch.wait );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+}
+
+/* Serves pf_read from the ring buffer, waiting for the thread if empty */
+static int APrefetchRead( stream_t *s, void *p_read, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    uint8_t *p_data = p_read;
+    size_t i_data = 0;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    mutex_cleanup_push( &p_sys->prefetch.lock );
+    while( p_sys->prefetch.i_used == 0 && !p_sys->prefetch.b_eof )
+        vlc_cond_wait( &p_sys->prefetch.wait, &p_sys->prefetch.lock );
+    vlc_cleanup_pop();
+
+    while( i_data < i_read && p_sys->prefetch.i_used > 0 )
+    {
+        size_t i_copy = __MIN( p_sys->prefetch.i_used,
+                               p_sys->prefetch.i_size - p_sys->prefetch.i_begin );
+        i_copy = __MIN( i_copy, i_read - i_data );
+
+        memcpy( &p_data[i_data],
+                &p_sys->prefetch.p_buffer[p_sys->prefetch.i_begin], i_copy );
+        i_data += i_copy;
+        p_sys->prefetch.i_begin = ( p_sys->prefetch.i_begin + i_copy )
+                                  % p_sys->prefetch.i_size;
+        p_sys->prefetch.i_used -= i_copy;
+    }
+    vlc_cond_broadcast( &p_sys->prefetch.wait );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    return i_data;
+}
+
 
 /**
  * Try to read "i_read" bytes into a buffer pointed by "p_read".  If
@@ -1858,6 +2354,39 @@ int stream_Peek( stream_t *s, const uint8_t **pp_peek, int i_peek )
     return s->pf_peek( s, pp_peek, i_peek );
 }
 
+/**
+ * Describe in p_vec the next "i_peek" bytes in the stream, without copying.
+ * *pi_vec is the number of entries in p_vec on input, and the number of
+ * entries actually used on output.
+ * \return The real number of valid bytes, as for stream_Peek().
+ * \note The pointers are invalid as soon as other stream_* functions are
+ * called. Data are only contiguous if a single entry is used.
+ */
+int stream_PeekVec( stream_t *s, stream_iovec_t *p_vec, int *pi_vec, int i_peek )
+{
+    if( i_peek <= 0 || *pi_vec <= 0 )
+    {
+        *pi_vec = 0;
+        return 0;
+    }
+
+    if( s->pf_peek == AStreamPeek && s->p_sys->method == STREAM_METHOD_BLOCK )
+        return AStreamPeekVecBlock( s, p_vec, pi_vec, i_peek );
+
+    /* Fall back to a contiguous peek */
+    const uint8_t *p_peek;
+    int i_data = stream_Peek( s, &p_peek, i_peek );
+    if( i_data <= 0 )
+    {
+        *pi_vec = 0;
+        return i_data;
+    }
+    p_vec[0].p_base = p_peek;
+    p_vec[0].i_len = i_data;
+    *pi_vec = 1;
+    return i_data;
+}
+
 /**
  * Use to control the "stream_t *". Look at #stream_query_e for
  * possible "i_query" value and format arguments.  Return VLC_SUCCESS
@@ -1914,6 +2443,23 @@ block_t *stream_Block( stream_t *s, int i_size )
     return NULL;
 }
 
+/**
+ * Read at most "i_max_size" bytes and return them in a block_t.
+ * Contrary to stream_Block(), it may return less data without being at the
+ * end of the stream, so that blocks from the access are handed over as-is
+ * (without copying) whenever they are read from their start and fit.
+ * \return NULL at the end of the stream.
+ */
+block_t *stream_ReadBlock( stream_t *s, int i_max_size )
+{
+    if( i_max_size <= 0 ) return NULL;
+
+    if( s->pf_read == AStreamRead && s->p_sys->method == STREAM_METHOD_BLOCK )
+        return AStreamTakeBlock( s, i_max_size );
+
+    return stream_Block( s, i_max_size );
+}
+
 /**
  * Read the remaining of the data if there is less than i_max_size bytes, otherwise
  * return NULL.
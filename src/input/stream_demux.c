@@ -300,6 +300,7 @@ static int DStreamControl( stream_t *s, int i_query, va_list args )
         case STREAM_CONTROL_ACCESS:
         case STREAM_GET_CONTENT_TYPE:
         case STREAM_SET_RECORD_STATE:
+        case STREAM_SET_PREFETCH_HINT:
             return VLC_EGENERIC;
 
         default:
@@ -0,0 +1,340 @@
+/*****************************************************************************
+ * thumbnail.c: picture extraction without playback
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_input.h>
+#include <vlc_es_out.h>
+#include <vlc_codec.h>
+#include <vlc_picture.h>
+#include <vlc_modules.h>
+
+#include "../libvlc.h"
+#include "input_internal.h"
+#include "demux.h"
+#include "stream.h"
+
+/*****************************************************************************
+ * The demuxer is driven directly, with an es_out that decodes the first
+ * video elementary stream only, until it outputs a picture. There is no
+ * input thread, clock or video output.
+ *****************************************************************************/
+struct es_out_id_t
+{
+    decoder_t *p_packetizer;
+    decoder_t *p_dec;
+};
+
+struct es_out_sys_t
+{
+    vlc_object_t *p_obj;
+    bool         b_video;   /* A video ES is being decoded */
+    picture_t    *p_picture; /* First decoded picture */
+
+    /* Not all demuxers delete their elementary streams */
+    int          i_es;
+    es_out_id_t  **pp_es;
+};
+
+static picture_t *VideoNewBuffer( decoder_t *p_dec )
+{
+    p_dec->fmt_out.video.i_chroma = p_dec->fmt_out.i_codec;
+    return picture_NewFromFormat( &p_dec->fmt_out.video );
+}
+
+static void VideoDelBuffer( decoder_t *p_dec, picture_t *p_pic )
+{
+    VLC_UNUSED(p_dec);
+    picture_Release( p_pic );
+}
+
+static void VideoLinkPicture( decoder_t *p_dec, picture_t *p_pic )
+{
+    VLC_UNUSED(p_dec);
+    picture_Hold( p_pic );
+}
+
+static void VideoUnlinkPicture( decoder_t *p_dec, picture_t *p_pic )
+{
+    VLC_UNUSED(p_dec);
+    picture_Release( p_pic );
+}
+
+static void DeleteCodec( decoder_t *p_dec )
+{
+    if( p_dec->p_module )
+        module_unneed( p_dec, p_dec->p_module );
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+    vlc_object_release( p_dec );
+}
+
+static decoder_t *CreateCodec( vlc_object_t *p_obj, const es_format_t *p_fmt,
+                               bool b_packetizer )
+{
+    decoder_t *p_dec = vlc_custom_create( p_obj, sizeof( *p_dec ),
+                                          b_packetizer ? "packetizer"
+                                                       : "decoder" );
+    if( p_dec == NULL )
+        return NULL;
+
+    p_dec->p_module = NULL;
+    es_format_Copy( &p_dec->fmt_in, p_fmt );
+    es_format_Init( &p_dec->fmt_out, UNKNOWN_ES, 0 );
+    p_dec->b_pace_control = true;
+
+    p_dec->pf_vout_buffer_new = VideoNewBuffer;
+    p_dec->pf_vout_buffer_del = VideoDelBuffer;
+    p_dec->pf_picture_link    = VideoLinkPicture;
+    p_dec->pf_picture_unlink  = VideoUnlinkPicture;
+
+    if( b_packetizer )
+        p_dec->p_module = module_need( p_dec, "packetizer", "$packetizer",
+                                       false );
+    else
+        p_dec->p_module = module_need( p_dec, "decoder", "$codec", false );
+    if( p_dec->p_module == NULL )
+    {
+        msg_Err( p_obj, "no suitable %s module for `%4.4s'",
+                 b_packetizer ? "packetizer" : "decoder",
+                 (const char *)&p_fmt->i_codec );
+        DeleteCodec( p_dec );
+        return NULL;
+    }
+    return p_dec;
+}
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *p_fmt )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    es_out_id_t *id = calloc( 1, sizeof( *id ) );
+    if( id == NULL )
+        return NULL;
+    TAB_APPEND( p_sys->i_es, p_sys->pp_es, id );
+    if( p_fmt->i_cat != VIDEO_ES || p_sys->b_video )
+        return id;
+
+    const es_format_t *p_dec_fmt = p_fmt;
+    if( !p_fmt->b_packetized )
+    {
+        id->p_packetizer = CreateCodec( p_sys->p_obj, p_fmt, true );
+        if( id->p_packetizer == NULL )
+            return id;
+        p_dec_fmt = &id->p_packetizer->fmt_out;
+    }
+    id->p_dec = CreateCodec( p_sys->p_obj, p_dec_fmt, false );
+    if( id->p_dec == NULL && id->p_packetizer != NULL )
+    {
+        DeleteCodec( id->p_packetizer );
+        id->p_packetizer = NULL;
+    }
+    p_sys->b_video = id->p_dec != NULL;
+    return id;
+}
+
+static void EsOutDecode( es_out_sys_t *p_sys, es_out_id_t *id, block_t *p_block )
+{
+    picture_t *p_pic;
+
+    while( (p_pic = id->p_dec->pf_decode_video( id->p_dec, &p_block )) )
+    {
+        if( p_sys->p_picture == NULL )
+            p_sys->p_picture = p_pic;
+        else
+            picture_Release( p_pic );
+    }
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *p_block )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( id->p_dec == NULL || p_sys->p_picture != NULL )
+    {
+        block_ChainRelease( p_block );
+        return VLC_SUCCESS;
+    }
+
+    if( id->p_packetizer == NULL )
+    {
+        EsOutDecode( p_sys, id, p_block );
+        return VLC_SUCCESS;
+    }
+
+    block_t *p_packets;
+    while( (p_packets = id->p_packetizer->pf_packetize( id->p_packetizer,
+                                                        &p_block )) )
+    {
+        while( p_packets )
+        {
+            block_t *p_next = p_packets->p_next;
+            p_packets->p_next = NULL;
+            EsOutDecode( p_sys, id, p_packets );
+            p_packets = p_next;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    TAB_REMOVE( p_sys->i_es, p_sys->pp_es, id );
+    if( id->p_dec )
+        DeleteCodec( id->p_dec );
+    if( id->p_packetizer )
+        DeleteCodec( id->p_packetizer );
+    free( id );
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    switch( i_query )
+    {
+    case ES_OUT_GET_ES_STATE:
+    {
+        es_out_id_t *id = va_arg( args, es_out_id_t * );
+        bool *pb = va_arg( args, bool * );
+        *pb = id->p_dec != NULL;
+        return VLC_SUCCESS;
+    }
+    case ES_OUT_SET_PCR:
+    case ES_OUT_SET_GROUP_PCR:
+    case ES_OUT_RESET_PCR:
+        return VLC_SUCCESS;
+    default:
+        VLC_UNUSED(out);
+        return VLC_EGENERIC;
+    }
+}
+
+static void EsOutDestroy( es_out_t *out )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    while( p_sys->i_es > 0 )
+        EsOutDel( out, p_sys->pp_es[0] );
+    TAB_CLEAN( p_sys->i_es, p_sys->pp_es );
+}
+
+static demux_t *DemuxOpen( vlc_object_t *p_obj, const char *psz_mrl,
+                           es_out_t *out, stream_t **ps )
+{
+    const char *psz_access, *psz_demux, *psz_path, *psz_anchor;
+    char psz_dup[strlen( psz_mrl ) + 1];
+
+    strcpy( psz_dup, psz_mrl );
+    input_SplitMRL( &psz_access, &psz_demux, &psz_path, &psz_anchor, psz_dup );
+
+    /* Try an access_demux first, like the input does */
+    *ps = NULL;
+    demux_t *p_demux = demux_New( p_obj, NULL, psz_access, psz_demux,
+                                  psz_path, NULL, out, false );
+    if( p_demux != NULL )
+        return p_demux;
+
+    *ps = stream_UrlNew( p_obj, psz_mrl );
+    if( *ps == NULL )
+        return NULL;
+    p_demux = demux_New( p_obj, NULL, psz_access, psz_demux, psz_path,
+                         *ps, out, false );
+    if( p_demux == NULL )
+    {
+        stream_Delete( *ps );
+        *ps = NULL;
+    }
+    return p_demux;
+}
+
+#undef input_Thumbnail
+/**
+ * Decodes the first picture at or after the keyframe preceding i_time
+ * and encodes it.
+ */
+int input_Thumbnail( vlc_object_t *p_parent, input_item_t *p_item,
+                     mtime_t i_time, mtime_t i_timeout, block_t **pp_image,
+                     vlc_fourcc_t i_format, int i_width, int i_height )
+{
+    vlc_object_t *p_obj = vlc_object_create( p_parent, sizeof( *p_obj ) );
+    if( p_obj == NULL )
+        return VLC_ENOMEM;
+
+    /* Item options, such as the demux or the decoder to use */
+    vlc_mutex_lock( &p_item->lock );
+    for( int i = 0; i < p_item->i_options; i++ )
+        var_OptionParse( p_obj, p_item->ppsz_options[i],
+                         !!(p_item->optflagv[i] & VLC_INPUT_OPTION_TRUSTED) );
+    char *psz_mrl = strdup( p_item->psz_uri );
+    vlc_mutex_unlock( &p_item->lock );
+
+    es_out_sys_t sys = { .p_obj = p_obj, .b_video = false, .p_picture = NULL };
+    TAB_INIT( sys.i_es, sys.pp_es );
+    es_out_t out = {
+        .pf_add = EsOutAdd, .pf_send = EsOutSend, .pf_del = EsOutDel,
+        .pf_control = EsOutControl, .pf_destroy = EsOutDestroy, .p_sys = &sys,
+    };
+    stream_t *s = NULL;
+    demux_t *p_demux = psz_mrl ? DemuxOpen( p_obj, psz_mrl, &out, &s ) : NULL;
+    free( psz_mrl );
+    if( p_demux == NULL )
+    {
+        vlc_object_release( p_obj );
+        return VLC_EGENERIC;
+    }
+
+    /* Seeking lands on a keyframe, the first picture is good enough */
+    if( i_time > 0 &&
+        demux_Control( p_demux, DEMUX_SET_TIME, i_time, false ) )
+    {
+        int64_t i_length;
+        if( !demux_Control( p_demux, DEMUX_GET_LENGTH, &i_length ) &&
+            i_length > 0 )
+            demux_Control( p_demux, DEMUX_SET_POSITION,
+                           (double)i_time / i_length, false );
+    }
+
+    const mtime_t i_deadline = mdate() + i_timeout;
+    while( sys.p_picture == NULL && mdate() < i_deadline )
+    {
+        if( demux_Demux( p_demux ) <= 0 )
+            break;
+    }
+
+    demux_Delete( p_demux );
+    if( s != NULL )
+        stream_Delete( s );
+    es_out_Delete( &out );
+
+    int i_ret = VLC_EGENERIC;
+    if( sys.p_picture != NULL )
+    {
+        i_ret = picture_Export( p_obj, pp_image, NULL, sys.p_picture,
+                                i_format, i_width, i_height );
+        picture_Release( sys.p_picture );
+    }
+    else
+        msg_Warn( p_obj, "no picture decoded" );
+    vlc_object_release( p_obj );
+    return i_ret;
+}
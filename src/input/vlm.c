@@ -38,6 +38,9 @@
 #include <limits.h>
 #include <assert.h>
 #include <sys/time.h>                                      /* gettimeofday() */
+#ifdef HAVE_SEARCH_H
+# include <search.h>
+#endif
 
 #include <vlc_vlm.h>
 #include <vlc_modules.h>
@@ -152,6 +155,7 @@ vlm_t *vlm_New ( vlc_object_t *p_this )
     p_vlm->input_state_changed = false;
     p_vlm->i_id = 1;
     TAB_INIT( p_vlm->i_media, p_vlm->media );
+    p_vlm->media_by_name = NULL;
     TAB_INIT( p_vlm->i_schedule, p_vlm->schedule );
     p_vlm->p_vod = NULL;
     var_Create( p_vlm, "intf-event", VLC_VAR_ADDRESS );
@@ -545,45 +549,78 @@ typedef struct
 } vlm_media_status_t;
 */
 
-/* */
+/* Medias are appended with increasing ids, and removed without reordering:
+ * the media table is always sorted by id. */
 static vlm_media_sys_t *vlm_ControlMediaGetById( vlm_t *p_vlm, int64_t id )
 {
-    int i;
+    int i_low = 0, i_high = p_vlm->i_media;
 
-    for( i = 0; i < p_vlm->i_media; i++ )
+    while( i_low < i_high )
     {
-        if( p_vlm->media[i]->cfg.id == id )
-            return p_vlm->media[i];
+        int i_mid = (i_low + i_high) / 2;
+        vlm_media_sys_t *p_media = p_vlm->media[i_mid];
+
+        if( p_media->cfg.id == id )
+            return p_media;
+        if( p_media->cfg.id < id )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
     }
     return NULL;
 }
-static vlm_media_sys_t *vlm_ControlMediaGetByName( vlm_t *p_vlm, const char *psz_name )
+
+static int vlm_MediaNameCmp( const void *a, const void *b )
 {
-    int i;
+    const vlm_media_sys_t *p_a = a, *p_b = b;
 
-    for( i = 0; i < p_vlm->i_media; i++ )
-    {
-        if( !strcmp( p_vlm->media[i]->cfg.psz_name, psz_name ) )
-            return p_vlm->media[i];
-    }
-    return NULL;
+    return strcmp( p_a->cfg.psz_name, p_b->cfg.psz_name );
 }
-static int vlm_MediaDescriptionCheck( vlm_t *p_vlm, vlm_media_t *p_cfg )
+
+/* The name index must be updated whenever cfg.psz_name changes */
+static void vlm_MediaIndexAdd( vlm_t *p_vlm, vlm_media_sys_t *p_media )
 {
-    int i;
+    if( tsearch( p_media, &p_vlm->media_by_name, vlm_MediaNameCmp ) == NULL )
+        msg_Warn( p_vlm, "cannot index media %s", p_media->cfg.psz_name );
+}
 
+static void vlm_MediaIndexRemove( vlm_t *p_vlm, vlm_media_sys_t *p_media )
+{
+    tdelete( p_media, &p_vlm->media_by_name, vlm_MediaNameCmp );
+}
+
+vlm_media_sys_t *vlm_MediaSearch( vlm_t *p_vlm, const char *psz_name )
+{
+    vlm_media_sys_t key;
+    key.cfg.psz_name = (char *)psz_name;
+
+    vlm_media_sys_t **pp_media = tfind( &key, &p_vlm->media_by_name,
+                                        vlm_MediaNameCmp );
+    return (pp_media != NULL) ? *pp_media : NULL;
+}
+
+static int vlm_MediaDescriptionCheck( vlm_t *p_vlm, vlm_media_t *p_cfg )
+{
     if( !p_cfg || !p_cfg->psz_name ||
         !strcmp( p_cfg->psz_name, "all" ) || !strcmp( p_cfg->psz_name, "media" ) || !strcmp( p_cfg->psz_name, "schedule" ) )
         return VLC_EGENERIC;
 
-    for( i = 0; i < p_vlm->i_media; i++ )
+    vlm_media_sys_t *p_media = vlm_MediaSearch( p_vlm, p_cfg->psz_name );
+    if( p_media != NULL && p_media->cfg.id != p_cfg->id )
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+
+/* Asks all the inputs of a media to stop, without waiting for them:
+ * they then terminate in parallel, rather than one after the other. */
+static void vlm_MediaInstancesAbort( vlm_media_sys_t *p_media )
+{
+    for( int i = 0; i < p_media->i_instance; i++ )
     {
-        if( p_vlm->media[i]->cfg.id == p_cfg->id )
-            continue;
-        if( !strcmp( p_vlm->media[i]->cfg.psz_name, p_cfg->psz_name ) )
-            return VLC_EGENERIC;
+        input_thread_t *p_input = p_media->instance[i]->p_input;
+        if( p_input )
+            input_Stop( p_input, true );
     }
-    return VLC_SUCCESS;
 }
 
 
@@ -738,8 +775,10 @@ static int vlm_ControlMediaChange( vlm_t *p_vlm, vlm_media_t *p_cfg )
         /* TODO check what are the changes being done (stop instance if needed) */
     }
 
+    vlm_MediaIndexRemove( p_vlm, p_media );
     vlm_media_Clean( &p_media->cfg );
     vlm_media_Copy( &p_media->cfg, p_cfg );
+    vlm_MediaIndexAdd( p_vlm, p_media );
 
     return vlm_OnMediaUpdate( p_vlm, p_media );
 }
@@ -748,7 +787,7 @@ static int vlm_ControlMediaAdd( vlm_t *p_vlm, vlm_media_t *p_cfg, int64_t *p_id
 {
     vlm_media_sys_t *p_media;
 
-    if( vlm_MediaDescriptionCheck( p_vlm, p_cfg ) || vlm_ControlMediaGetByName( p_vlm, p_cfg->psz_name ) )
+    if( vlm_MediaDescriptionCheck( p_vlm, p_cfg ) || vlm_MediaSearch( p_vlm, p_cfg->psz_name ) )
     {
         msg_Err( p_vlm, "invalid media description" );
         return VLC_EGENERIC;
@@ -786,6 +825,7 @@ static int vlm_ControlMediaAdd( vlm_t *p_vlm, vlm_media_t *p_cfg, int64_t *p_id
 
     /* */
     TAB_APPEND( p_vlm->i_media, p_vlm->media, p_media );
+    vlm_MediaIndexAdd( p_vlm, p_media );
 
     if( p_id )
         *p_id = p_media->cfg.id;
@@ -802,6 +842,7 @@ static int vlm_ControlMediaDel( vlm_t *p_vlm, int64_t id )
     if( !p_media )
         return VLC_EGENERIC;
 
+    vlm_MediaInstancesAbort( p_media );
     while( p_media->i_instance > 0 )
         vlm_ControlInternal( p_vlm, VLM_STOP_MEDIA_INSTANCE, id, p_media->instance[0]->psz_name );
 
@@ -814,6 +855,7 @@ static int vlm_ControlMediaDel( vlm_t *p_vlm, int64_t id )
     /* */
     vlm_SendEventMediaRemoved( p_vlm, id, p_media->cfg.psz_name );
 
+    vlm_MediaIndexRemove( p_vlm, p_media );
     vlm_media_Clean( &p_media->cfg );
 
     vlc_gc_decref( p_media->vod.p_item );
@@ -847,6 +889,9 @@ static int vlm_ControlMediaGets( vlm_t *p_vlm, vlm_media_t ***ppp_dsc, int *pi_d
 }
 static int vlm_ControlMediaClear( vlm_t *p_vlm )
 {
+    for( int i = 0; i < p_vlm->i_media; i++ )
+        vlm_MediaInstancesAbort( p_vlm->media[i] );
+
     while( p_vlm->i_media > 0 )
         vlm_ControlMediaDel( p_vlm, p_vlm->media[0]->cfg.id );
 
@@ -863,7 +908,7 @@ static int vlm_ControlMediaGet( vlm_t *p_vlm, int64_t id, vlm_media_t **pp_dsc )
 }
 static int vlm_ControlMediaGetId( vlm_t *p_vlm, const char *psz_name, int64_t *p_id )
 {
-    vlm_media_sys_t *p_media = vlm_ControlMediaGetByName( p_vlm, psz_name );
+    vlm_media_sys_t *p_media = vlm_MediaSearch( p_vlm, psz_name );
     if( !p_media )
         return VLC_EGENERIC;
 
@@ -1173,6 +1218,7 @@ static int vlm_ControlMediaInstanceClear( vlm_t *p_vlm, int64_t id )
     if( !p_media )
         return VLC_EGENERIC;
 
+    vlm_MediaInstancesAbort( p_media );
     while( p_media->i_instance > 0 )
         vlm_ControlMediaInstanceStop( p_vlm, id, p_media->instance[0]->psz_name );
 
@@ -102,6 +102,7 @@ struct vlm_t
     /* Media list */
     int                i_media;
     vlm_media_sys_t    **media;
+    void               *media_by_name; /* tsearch() tree of media */
 
     /* Schedule list */
     int            i_schedule;
@@ -111,6 +112,7 @@ struct vlm_t
 int64_t vlm_Date(void);
 int vlm_ControlInternal( vlm_t *p_vlm, int i_query, ... );
 int ExecuteCommand( vlm_t *, const char *, vlm_message_t ** );
+vlm_media_sys_t *vlm_MediaSearch( vlm_t *, const char * );
 void vlm_ScheduleDelete( vlm_t *vlm, vlm_schedule_sys_t *sched );
 
 #endif
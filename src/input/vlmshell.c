@@ -69,9 +69,6 @@ static vlm_schedule_sys_t *vlm_ScheduleNew( vlm_t *vlm, const char *psz_name );
 static int vlm_ScheduleSetup( vlm_schedule_sys_t *schedule, const char *psz_cmd,
                               const char *psz_value );
 
-/* */
-static vlm_media_sys_t *vlm_MediaSearch( vlm_t *, const char *);
-
 static const char quotes[] = "\"'";
 /**
  * FindCommandEnd: look for the end of a possibly quoted string
@@ -946,22 +943,6 @@ error:
     return VLC_EGENERIC;
 }
 
-/*****************************************************************************
- * Media handling
- *****************************************************************************/
-vlm_media_sys_t *vlm_MediaSearch( vlm_t *vlm, const char *psz_name )
-{
-    int i;
-
-    for( i = 0; i < vlm->i_media; i++ )
-    {
-        if( strcmp( psz_name, vlm->media[i]->cfg.psz_name ) == 0 )
-            return vlm->media[i];
-    }
-
-    return NULL;
-}
-
 /*****************************************************************************
  * Schedule handling
  *****************************************************************************/
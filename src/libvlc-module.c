@@ -100,6 +100,16 @@ static const char *const ppsz_snap_formats[] =
     "This enables colorization of the messages sent to the console " \
     "Your terminal needs Linux color support for this to work.")
 
+#define LOG_ASYNC_TEXT N_("Asynchronous messages")
+#define LOG_ASYNC_LONGTEXT N_( \
+    "Queue the messages and deliver them from a separate thread, so that " \
+    "verbose logging does not slow down the emitting threads.")
+
+#define LOG_DROP_TEXT N_("Drop messages on overflow")
+#define LOG_DROP_LONGTEXT N_( \
+    "When the asynchronous message queue is full, discard the new messages " \
+    "instead of waiting for room in the queue.")
+
 #define ADVANCED_TEXT N_("Show advanced options")
 #define ADVANCED_LONGTEXT N_( \
     "When this is enabled, the preferences and/or interfaces will " \
@@ -159,10 +169,22 @@ static const char *const ppsz_snap_formats[] =
     "This delays the audio output. The delay must be given in milliseconds. " \
     "This can be handy if you notice a lag between the video and the audio.")
 
+#define AUDIO_PREROLL_TEXT N_("Gapless pre-roll (ms)")
+#define AUDIO_PREROLL_LONGTEXT N_( \
+    "Start the next input this long before the end of the audio of the " \
+    "current one, and append its audio to the same output stream if the " \
+    "format is the same. 0 disables gapless playback.")
+
 #define AUDIO_RESAMPLER_TEXT N_("Audio resampler")
 #define AUDIO_RESAMPLER_LONGTEXT N_( \
     "This selects which plugin to use for audio resampling." )
 
+#define AUDIO_DRIFT_RESAMPLER_TEXT N_("Audio drift resampler")
+#define AUDIO_DRIFT_RESAMPLER_LONGTEXT N_( \
+    "This selects which plugin to use for audio resampling when the " \
+    "sample rate is not converted, but only corrected for clock drift " \
+    "and playback speed. A fast, low latency resampler is preferable." )
+
 #define MULTICHA_TEXT N_("Audio output channels mode")
 #define MULTICHA_LONGTEXT N_( \
     "This sets the audio output channels mode that will " \
@@ -386,12 +408,23 @@ static const char *const ppsz_pos_descriptions[] =
 #define VIDEO_SPLITTER_LONGTEXT N_( \
     "This adds video splitters like clone or wall" )
 
+#define VIDEO_SPLITTER_THREADS_TEXT N_("Parallel video splitter outputs")
+#define VIDEO_SPLITTER_THREADS_LONGTEXT N_( \
+    "Prepare and display each output of a video splitter on its own " \
+    "thread, so that all the screens of a wall are updated together." )
+
 #define VIDEO_FILTER_TEXT N_("Video filter module")
 #define VIDEO_FILTER_LONGTEXT N_( \
     "This adds post-processing filters to enhance the " \
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define FILTER_THREADS_TEXT N_("Video filter threads")
+#define FILTER_THREADS_LONGTEXT N_( \
+    "Number of threads shared by the video filters that can process " \
+    "stripes of the picture in parallel. 0 uses one thread per CPU, " \
+    "1 runs them on the video thread only." )
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -424,6 +457,13 @@ static const char *const ppsz_pos_descriptions[] =
     "it will keep the original height (-1). Using 0 will scale the height " \
     "to keep the aspect ratio." )
 
+#define SNAP_THREADS_TEXT N_("Video snapshot threads")
+#define SNAP_THREADS_LONGTEXT N_( \
+    "Maximum number of video snapshots encoded at the same time in the " \
+    "background. Taking a snapshot then returns immediately, and the " \
+    "snapshot file is signaled once written. With 0, snapshots are " \
+    "encoded and written before taking them returns." )
+
 #define CROP_TEXT N_("Video cropping")
 #define CROP_LONGTEXT N_( \
     "This forces the cropping of the source video. " \
@@ -481,6 +521,12 @@ static const char *const ppsz_pos_descriptions[] =
     "This drops frames that are late (arrive to the video output after " \
     "their intended display date)." )
 
+#define REFRESH_RATE_TEXT N_("Display refresh rate")
+#define REFRESH_RATE_LONGTEXT N_( \
+    "Refresh rate of the display in Hz, used to align the pictures on the " \
+    "display refreshes when the video output cannot report it. " \
+    "0 means unknown." )
+
 #define QUIET_SYNCHRO_TEXT N_("Quiet synchro")
 #define QUIET_SYNCHRO_LONGTEXT N_( \
     "This avoids flooding the message log with debug output from the " \
@@ -520,6 +566,33 @@ static const char *const ppsz_pos_descriptions[] =
 #define NETWORK_CACHING_LONGTEXT N_( \
     "Caching value for network resources, in milliseconds." )
 
+#define STREAM_CACHE_TRACKS_TEXT N_("Stream cache tracks")
+#define STREAM_CACHE_TRACKS_LONGTEXT N_( \
+    "Number of distinct regions of a seekable input that are kept in " \
+    "memory at once, to avoid seeking back and forth." )
+
+#define STREAM_CACHE_SIZE_TEXT N_("Stream cache size per track (KiB)")
+#define STREAM_CACHE_SIZE_LONGTEXT N_( \
+    "Amount of memory used to cache each region of an input, " \
+    "in kibibytes." )
+
+#define STREAM_PREBUFFER_TEXT N_("Stream prebuffering size (bytes)")
+#define STREAM_PREBUFFER_LONGTEXT N_( \
+    "Amount of data read from an input before probing starts, in bytes. " \
+    "Larger values add latency." )
+
+#define STREAM_ADAPTIVE_TEXT N_("Adaptive stream read-ahead")
+#define STREAM_ADAPTIVE_LONGTEXT N_( \
+    "Grow the amount of data read from the input at once while reading " \
+    "sequentially, depending on the measured throughput, and shrink it " \
+    "when seeking." )
+
+#define STREAM_PREFETCH_TEXT N_("Stream read-ahead buffer (kB)")
+#define STREAM_PREFETCH_LONGTEXT N_( \
+    "Size of the buffer filled by a background thread ahead of the " \
+    "current reading position, for inputs read as a byte stream. " \
+    "0 disables background read-ahead." )
+
 #define CR_AVERAGE_TEXT N_("Clock reference average counter")
 #define CR_AVERAGE_LONGTEXT N_( \
     "When using the PVR input (or a very irregular source), you should " \
@@ -536,6 +609,13 @@ static const char *const ppsz_pos_descriptions[] =
     "This defines the maximum input delay jitter that the synchronization " \
     "algorithms should try to compensate (in milliseconds)." )
 
+#define CLOCK_LATENCY_TEXT N_("Low latency clock target")
+#define CLOCK_LATENCY_LONGTEXT N_( \
+    "When not 0, the synchronization algorithms of live streams follow the " \
+    "least delayed clock references and slowly adapt the buffering toward " \
+    "this latency (in milliseconds), or the observed jitter if larger. " \
+    "Audio is resampled to follow the changes." )
+
 #define NETSYNC_TEXT N_("Network synchronisation" )
 #define NETSYNC_LONGTEXT N_( "This allows you to remotely " \
         "synchronise clocks for server and client. The detailed settings " \
@@ -644,6 +724,11 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
 
+#define DEMUX_INDEX_TEXT N_("Seek index cache")
+#define DEMUX_INDEX_LONGTEXT N_( \
+    "Keep the seek positions found in local files in the cache directory, " \
+    "so that seeking in the same files is faster the next times." )
+
 #define INPUT_RATE_TEXT N_("Playback speed")
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
@@ -674,6 +759,21 @@ static const char *const ppsz_prefres[] = {
     "When possible, the input stream will be recorded instead of using " \
     "the stream output module" )
 
+#define INPUT_RECORD_ASYNC_TEXT N_("Record asynchronously")
+#define INPUT_RECORD_ASYNC_LONGTEXT N_( \
+    "Write the records from a separate thread, so that slow storage does " \
+    "not stall the playback." )
+
+#define INPUT_RECORD_QUEUE_TEXT N_("Record queue size (kB)")
+#define INPUT_RECORD_QUEUE_LONGTEXT N_( \
+    "Amount of data waiting to be written to the record when recording " \
+    "asynchronously." )
+
+#define INPUT_RECORD_DROP_TEXT N_("Drop data when the record falls behind")
+#define INPUT_RECORD_DROP_LONGTEXT N_( \
+    "When the record queue is full, drop data and report it rather than " \
+    "waiting for the storage. The record will have gaps." )
+
 #define INPUT_TIMESHIFT_PATH_TEXT N_("Timeshift directory")
 #define INPUT_TIMESHIFT_PATH_LONGTEXT N_( \
     "Directory used to store the timeshift temporary files." )
@@ -683,6 +783,12 @@ static const char *const ppsz_prefres[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_SIZE_TEXT N_("Timeshift buffer size (MiB)")
+#define INPUT_TIMESHIFT_SIZE_LONGTEXT N_( \
+    "When not 0, live streams are always recorded into a circular buffer " \
+    "of this size, so that it is possible to pause, rewind and forward " \
+    "within the most recent part of the stream." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -906,6 +1012,18 @@ static const char *const ppsz_prefres[] = {
     "before trying the other ones. Only advanced users should " \
     "alter this option as it can break playback of all your streams." )
 
+#define DECODER_POOL_TEXT N_("Shared decoder threads")
+#define DECODER_POOL_LONGTEXT N_( \
+    "Number of threads shared by all audio and subtitle decoders, instead " \
+    "of one thread per elementary stream. Video decoders always keep their " \
+    "own thread. 0 disables sharing." )
+
+#define DECODER_REUSE_TEXT N_("Reuse video decoders")
+#define DECODER_REUSE_LONGTEXT N_( \
+    "Keep the video decoder when an input ends, and reuse it for the next " \
+    "input if its video has the same codec and dimensions. This avoids " \
+    "reopening the decoder (and the hardware acceleration) between items." )
+
 #define ENCODER_TEXT N_("Preferred encoders list")
 #define ENCODER_LONGTEXT N_( \
     "This allows you to select a list of encoders that VLC will use in " \
@@ -1034,6 +1152,12 @@ static const char *const ppsz_prefres[] = {
      "This option is useful if you want to lower the latency when " \
      "reading a stream")
 
+#define CPU_BENCH_TEXT N_("Benchmark the optimized routines")
+#define CPU_BENCH_LONGTEXT N_( \
+    "Time the implementations of some video routines the first time they " \
+    "are needed, and use the fastest one on this CPU rather than the one " \
+    "with the most recent instruction set.")
+
 #define PLUGIN_PATH_TEXT N_("Modules search path")
 #define PLUGIN_PATH_LONGTEXT N_( \
     "Additional path for VLC to look for its modules. You can add " \
@@ -1051,6 +1175,11 @@ static const char *const ppsz_prefres[] = {
 #define STATS_LONGTEXT N_( \
      "Collect miscellaneous local statistics about the playing media.")
 
+#define TRACE_FILE_TEXT N_("Pipeline trace file")
+#define TRACE_FILE_LONGTEXT N_( \
+     "Record the demux, decode, filter, display, mux and I/O operations " \
+     "in this file, in the Chrome trace event format.")
+
 #define DAEMON_TEXT N_("Run as daemon process")
 #define DAEMON_LONGTEXT N_( \
      "Runs VLC as a background daemon process.")
@@ -1124,10 +1253,20 @@ static const char *const ppsz_prefres[] = {
     "Automatically preparse files added to the playlist " \
     "(to retrieve some metadata)." )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparser threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of files preparsed at the same time " \
+    "(0 for one per CPU)." )
+
 #define ALBUM_ART_TEXT N_( "Album art policy" )
 #define ALBUM_ART_LONGTEXT N_( \
     "Choose how album art will be downloaded." )
 
+#define ALBUM_ART_RETRY_TEXT N_( "Album art retry delay" )
+#define ALBUM_ART_RETRY_LONGTEXT N_( \
+    "Number of days before searching again the art of an item, " \
+    "when none was found (0 to always search)." )
+
 static const int pi_albumart_values[] = { ALBUM_ART_WHEN_ASKED,
                                           ALBUM_ART_WHEN_PLAYED,
                                           ALBUM_ART_ALL };
@@ -1478,9 +1617,15 @@ vlc_module_begin ()
     add_integer( "audio-desync", 0, DESYNC_TEXT,
                  DESYNC_LONGTEXT, true )
         change_safe ()
+    add_integer( "audio-preroll", 0, AUDIO_PREROLL_TEXT,
+                 AUDIO_PREROLL_LONGTEXT, true )
+        change_integer_range( 0, 10000 )
 
     add_module( "audio-resampler", "audio resampler", NULL,
                 AUDIO_RESAMPLER_TEXT, AUDIO_RESAMPLER_LONGTEXT, true )
+    add_module( "audio-drift-resampler", "audio resampler", "polyphase-drift",
+                AUDIO_DRIFT_RESAMPLER_TEXT, AUDIO_DRIFT_RESAMPLER_LONGTEXT,
+                true )
 
     /* FIXME TODO create a subcat replay gain ? */
     add_string( "audio-replay-gain-mode", ppsz_replay_gain_mode[0], AUDIO_REPLAY_GAIN_MODE_TEXT,
@@ -1525,6 +1670,8 @@ vlc_module_begin ()
         change_private ()
     add_bool( "drop-late-frames", 1, DROP_LATE_FRAMES_TEXT,
               DROP_LATE_FRAMES_LONGTEXT, true )
+    add_float( "display-refresh-rate", 0., REFRESH_RATE_TEXT,
+               REFRESH_RATE_LONGTEXT, true )
     /* Used in vout_synchro */
     add_bool( "skip-frames", 1, SKIP_FRAMES_TEXT,
               SKIP_FRAMES_LONGTEXT, true )
@@ -1576,6 +1723,9 @@ vlc_module_begin ()
                  SNAP_WIDTH_LONGTEXT, true )
     add_integer( "snapshot-height", -1, SNAP_HEIGHT_TEXT,
                  SNAP_HEIGHT_LONGTEXT, true )
+    add_integer( "snapshot-threads", 0, SNAP_THREADS_TEXT,
+                 SNAP_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 64 )
 
     set_section( N_("Window properties" ), NULL )
     add_integer( "width", -1, WIDTH_TEXT, WIDTH_LONGTEXT, true )
@@ -1627,6 +1777,11 @@ vlc_module_begin ()
                 VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT, false )
     add_module_list( "video-splitter", "video splitter", NULL,
                      VIDEO_SPLITTER_TEXT, VIDEO_SPLITTER_LONGTEXT, false )
+    add_bool( "video-splitter-threads", true, VIDEO_SPLITTER_THREADS_TEXT,
+              VIDEO_SPLITTER_THREADS_LONGTEXT, true )
+    add_integer( "filter-threads", 0, FILTER_THREADS_TEXT,
+                 FILTER_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 32 )
     add_obsolete_string( "vout-filter" ) /* since 2.0.0 */
 #if 0
     add_string( "pixel-ratio", "1", PIXEL_RATIO_TEXT, PIXEL_RATIO_TEXT )
@@ -1718,6 +1873,8 @@ vlc_module_begin ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT, false )
         change_safe ()
+    add_bool( "demux-index", true,
+              DEMUX_INDEX_TEXT, DEMUX_INDEX_LONGTEXT, true )
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT, false )
 
@@ -1847,6 +2004,36 @@ vlc_module_begin ()
     add_obsolete_integer( "tcp-caching" ) /* 2.0.0 */
     add_obsolete_integer( "udp-caching" ) /* 2.0.0 */
 
+#ifdef OPTIMIZE_MEMORY
+    add_integer( "stream-cache-tracks", 1, STREAM_CACHE_TRACKS_TEXT,
+                 STREAM_CACHE_TRACKS_LONGTEXT, true )
+#else
+    add_integer( "stream-cache-tracks", 3, STREAM_CACHE_TRACKS_TEXT,
+                 STREAM_CACHE_TRACKS_LONGTEXT, true )
+#endif
+        change_integer_range( 1, 16 )
+        change_safe()
+#ifdef OPTIMIZE_MEMORY
+    add_integer( "stream-cache-size", 128, STREAM_CACHE_SIZE_TEXT,
+                 STREAM_CACHE_SIZE_LONGTEXT, true )
+#else
+    add_integer( "stream-cache-size", 4096, STREAM_CACHE_SIZE_TEXT,
+                 STREAM_CACHE_SIZE_LONGTEXT, true )
+#endif
+        change_integer_range( 16, 1024 * 1024 )
+        change_safe()
+    add_integer( "stream-prebuffer", 128, STREAM_PREBUFFER_TEXT,
+                 STREAM_PREBUFFER_LONGTEXT, true )
+        change_integer_range( 1, 1024 * 1024 )
+        change_safe()
+    add_bool( "stream-adaptive", true, STREAM_ADAPTIVE_TEXT,
+              STREAM_ADAPTIVE_LONGTEXT, true )
+        change_safe()
+    add_integer( "stream-prefetch", 0, STREAM_PREFETCH_TEXT,
+                 STREAM_PREFETCH_LONGTEXT, true )
+        change_integer_range( 0, 1024 * 1024 )
+        change_safe()
+
     add_integer( "cr-average", 40, CR_AVERAGE_TEXT,
                  CR_AVERAGE_LONGTEXT, true )
     add_integer( "clock-synchro", -1, CLOCK_SYNCHRO_TEXT,
@@ -1855,6 +2042,10 @@ vlc_module_begin ()
     add_integer( "clock-jitter", 5 * CLOCK_FREQ/1000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
+    add_integer( "clock-latency", 0, CLOCK_LATENCY_TEXT,
+                 CLOCK_LATENCY_LONGTEXT, true )
+        change_integer_range( 0, 60000 )
+        change_safe()
 
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
@@ -1863,11 +2054,21 @@ vlc_module_begin ()
                 INPUT_RECORD_PATH_LONGTEXT, true )
     add_bool( "input-record-native", true, INPUT_RECORD_NATIVE_TEXT,
               INPUT_RECORD_NATIVE_LONGTEXT, true )
+    add_bool( "input-record-async", false, INPUT_RECORD_ASYNC_TEXT,
+              INPUT_RECORD_ASYNC_LONGTEXT, true )
+    add_integer( "input-record-queue", 8192, INPUT_RECORD_QUEUE_TEXT,
+                 INPUT_RECORD_QUEUE_LONGTEXT, true )
+        change_integer_range( 64, 1048576 )
+    add_bool( "input-record-drop", false, INPUT_RECORD_DROP_TEXT,
+              INPUT_RECORD_DROP_LONGTEXT, true )
 
     add_string( "input-timeshift-path", NULL, INPUT_TIMESHIFT_PATH_TEXT,
                 INPUT_TIMESHIFT_PATH_LONGTEXT, true )
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-size", 0, INPUT_TIMESHIFT_SIZE_TEXT,
+                 INPUT_TIMESHIFT_SIZE_LONGTEXT, true )
+        change_integer_range( 0, 1 << 20 )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -1877,6 +2078,11 @@ vlc_module_begin ()
                 CODEC_LONGTEXT, true )
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
+    add_integer( "decoder-pool", 0, DECODER_POOL_TEXT,
+                 DECODER_POOL_LONGTEXT, true )
+        change_integer_range( 0, 64 )
+    add_bool( "decoder-reuse", false, DECODER_REUSE_TEXT,
+              DECODER_REUSE_LONGTEXT, true )
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint( N_("Input"), INPUT_CAT_LONGTEXT , false )
@@ -1944,6 +2150,7 @@ vlc_module_begin ()
 /* CPU options */
     set_category( CAT_ADVANCED )
     add_obsolete_bool( "fpu" )
+    add_bool( "cpu-bench", false, CPU_BENCH_TEXT, CPU_BENCH_LONGTEXT, true )
 #if defined( __i386__ ) || defined( __x86_64__ )
     add_obsolete_bool( "mmx" ) /* since 2.0.0 */
     add_obsolete_bool( "3dn" ) /* since 2.0.0 */
@@ -2043,11 +2250,17 @@ vlc_module_begin ()
 
     add_bool( "auto-preparse", true, PREPARSE_TEXT,
               PREPARSE_LONGTEXT, false )
+    add_integer( "preparse-threads", 0, PREPARSE_THREADS_TEXT,
+                 PREPARSE_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 16 )
 
     add_integer( "album-art", ALBUM_ART_WHEN_ASKED, ALBUM_ART_TEXT,
                  ALBUM_ART_LONGTEXT, false )
         change_integer_list( pi_albumart_values,
                              ppsz_albumart_descriptions )
+    add_integer( "album-art-retry", 7, ALBUM_ART_RETRY_TEXT,
+                 ALBUM_ART_RETRY_LONGTEXT, true )
+        change_integer_range( 0, 3650 )
 
     set_subcategory( SUBCAT_PLAYLIST_SD )
     add_string( "services-discovery", "", SD_TEXT, SD_LONGTEXT, true )
@@ -2086,12 +2299,17 @@ vlc_module_begin ()
 
     add_bool( "color", true, COLOR_TEXT, COLOR_LONGTEXT, true )
         change_volatile ()
+    add_bool( "log-async", false, LOG_ASYNC_TEXT, LOG_ASYNC_LONGTEXT, true )
+    add_bool( "log-drop", false, LOG_DROP_TEXT, LOG_DROP_LONGTEXT, true )
     add_bool( "advanced", false, ADVANCED_TEXT, ADVANCED_LONGTEXT,
                     false )
     add_bool( "interact", true, INTERACTION_TEXT,
               INTERACTION_LONGTEXT, false )
 
     add_bool ( "stats", true, STATS_TEXT, STATS_LONGTEXT, true )
+    add_savefile( "trace-file", NULL, TRACE_FILE_TEXT, TRACE_FILE_LONGTEXT,
+                  true )
+        change_volatile ()
 
     set_subcategory( SUBCAT_INTERFACE_MAIN )
     add_module_cat( "intf", SUBCAT_INTERFACE_MAIN, NULL, INTF_TEXT,
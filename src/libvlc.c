@@ -396,6 +396,7 @@ dbus_out:
     vlc_CPU_dump( VLC_OBJECT(p_libvlc) );
 
     priv->b_stats = var_InheritBool( p_libvlc, "stats" );
+    vlc_trace_Init( p_libvlc );
 
     /*
      * Initialize hotkey handling
@@ -620,6 +621,7 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
 #endif
 
     vlc_DeinitActions( p_libvlc, priv->actions );
+    vlc_trace_Deinit( p_libvlc );
 
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
@@ -25,6 +25,8 @@
 #ifndef LIBVLC_LIBVLC_H
 # define LIBVLC_LIBVLC_H 1
 
+#include <vlc_atomic.h>
+
 extern const char psz_vlc_changeset[];
 
 typedef struct variable_t variable_t;
@@ -48,6 +50,7 @@ size_t EnumClockSource( vlc_object_t *, const char *, char ***, char *** );
 #endif
 #endif
 void vlc_CPU_init(void);
+uint32_t vlc_CPU_mask(uint32_t);
 void vlc_CPU_dump(vlc_object_t *);
 
 /*
@@ -153,6 +156,7 @@ typedef struct libvlc_priv_t
         void (*cb) (void *, int, const vlc_log_t *, const char *, va_list);
         void *opaque;
         vlc_rwlock_t lock;
+        struct vlc_log_queue *queue; /**< Asynchronous delivery (or NULL) */
     } log;
     signed char        i_verbose;   ///< info messages
     bool               b_color;     ///< color messages?
@@ -209,15 +213,26 @@ typedef struct counter_sample_t
     mtime_t  date;
 } counter_sample_t;
 
+/* Counters are updated without locking from any thread. The samples of
+ * the derivatives are only taken by stats_ComputeInputStats(). */
 typedef struct counter_t
 {
     int                 i_compute_type;
+    atomic_uint_least64_t value; /**< Total, or last value of a derivative */
     int                 i_samples;
-    counter_sample_t ** pp_samples;
-
-    mtime_t             last_update;
+    counter_sample_t    samples[2]; /**< Newest first */
 } counter_t;
 
+/** Bucket i counts durations below (100 << i) microseconds */
+#define STATS_HISTOGRAM_BUCKETS 16
+
+typedef struct stats_histogram_t
+{
+    atomic_uint_least64_t count[STATS_HISTOGRAM_BUCKETS];
+    atomic_uint_least64_t total; /**< Sum of all durations */
+    atomic_uint_least64_t max;
+} stats_histogram_t;
+
 enum
 {
     STATS_INPUT_BITRATE,
@@ -244,8 +259,45 @@ enum
 counter_t * stats_CounterCreate (int);
 void stats_Update (counter_t *, uint64_t, uint64_t *);
 void stats_CounterClean (counter_t * );
+void stats_HistogramAdd (stats_histogram_t *, mtime_t);
+void stats_HistogramDump (vlc_object_t *, const char *,
+                          const stats_histogram_t *);
 
 void stats_ComputeInputStats(input_thread_t*, input_stats_t*);
 void stats_ReinitInputStats(input_stats_t *);
 
+/*
+ * Block pool
+ */
+#define BLOCK_POOL_CLASSES 4
+
+typedef struct
+{
+    size_t   size; /**< Allocation size of the class */
+    uint64_t hits; /**< Allocations served from the pool */
+    uint64_t misses; /**< Allocations served from the heap */
+} block_pool_stats_t;
+
+void block_PoolStats (block_pool_stats_t *);
+
+/*
+ * Video filter slices
+ */
+void filter_SlicesHold (vlc_object_t *);
+void filter_SlicesRelease (void);
+
+/*
+ * Pipeline tracing (see misc/trace.c)
+ */
+void vlc_trace_Init (libvlc_int_t *);
+void vlc_trace_Deinit (libvlc_int_t *);
+mtime_t vlc_trace_Begin (void);
+void vlc_trace_End (mtime_t, const char *, const char *, const char *);
+
+/*
+ * Memory accounting (see misc/memstat.c)
+ */
+unsigned vlc_mem_Charge (size_t);
+void vlc_mem_Credit (unsigned, size_t);
+
 #endif
@@ -39,6 +39,8 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
+#include "libvlc.h"
 
 /**
  * @section Block handling functions.
@@ -99,10 +101,24 @@ void block_Init( block_t *restrict b, void *buf, size_t size )
 #endif
 }
 
-static void block_generic_Release (block_t *block)
+/** Header of the blocks allocated with block_Alloc() */
+typedef struct
+{
+    block_t  self;
+    unsigned account; /**< Memory account charged with the allocation */
+} block_alloc_t;
+
+static void block_alloc_Credit (block_t *block)
 {
     /* That is always true for blocks allocated with block_Alloc(). */
-    assert (block->p_start == (unsigned char *)(block + 1));
+    assert (block->p_start == (unsigned char *)((block_alloc_t *)block + 1));
+    vlc_mem_Credit (((block_alloc_t *)block)->account,
+                    sizeof (block_alloc_t) + block->i_size);
+}
+
+static void block_generic_Release (block_t *block)
+{
+    block_alloc_Credit (block);
     block_Invalidate (block);
     free (block);
 }
@@ -128,34 +144,357 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /* Maximum size of reserved footer before shrinking with realloc(). */
 #define BLOCK_WASTE_SIZE   2048
 
+/**
+ * @section Block pool
+ *
+ * Small and medium blocks are recycled through size classes instead of going
+ * back to the heap. Each thread keeps a small magazine per class, so that
+ * allocation and release are usually lock-free. Magazines overflow to (and
+ * refill from) a global depot in batches, which is the only locked path.
+ * Blocks bigger than the largest class are plain heap allocations.
+ */
+
+/** Total allocation sizes (including the block_t header) of each class */
+static const size_t block_pool_sizes[BLOCK_POOL_CLASSES] = {
+    1024, 4096, 16384, 65536,
+};
+
+/** Per-thread cached blocks per class */
+#define BLOCK_MAGAZINE_SIZE 16
+/** Blocks moved between a magazine and the depot at once */
+#define BLOCK_MAGAZINE_BATCH (BLOCK_MAGAZINE_SIZE / 2)
+/** Maximum (global) cached bytes per class */
+#define BLOCK_DEPOT_BYTES  (4 << 20)
+
+typedef struct
+{
+    unsigned count[BLOCK_POOL_CLASSES];
+    block_t *stack[BLOCK_POOL_CLASSES][BLOCK_MAGAZINE_SIZE];
+} block_magazine_t;
+
+static struct
+{
+    vlc_mutex_t lock;
+    block_t    *first[BLOCK_POOL_CLASSES]; /**< Linked through p_next */
+    size_t      count[BLOCK_POOL_CLASSES];
+} block_depot = { VLC_STATIC_MUTEX, { NULL }, { 0 } };
+
+static atomic_uintptr_t block_pool_hits[BLOCK_POOL_CLASSES];
+static atomic_uintptr_t block_pool_misses[BLOCK_POOL_CLASSES];
+
+static vlc_threadvar_t block_magazine_key;
+static atomic_bool block_pool_ready = ATOMIC_VAR_INIT(false);
+
+static unsigned block_pool_Class (size_t alloc)
+{
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+        if (alloc <= block_pool_sizes[i])
+            return i;
+    return BLOCK_POOL_CLASSES;
+}
+
+/** Returns blocks to the depot, or to the heap if the depot is full. */
+static void block_depot_Put (unsigned cl, block_t **tab, unsigned n)
+{
+    const size_t max = BLOCK_DEPOT_BYTES / block_pool_sizes[cl];
+
+    vlc_mutex_lock (&block_depot.lock);
+    while (n > 0 && block_depot.count[cl] < max)
+    {
+        block_t *b = tab[--n];
+
+        b->p_next = block_depot.first[cl];
+        block_depot.first[cl] = b;
+        block_depot.count[cl]++;
+    }
+    vlc_mutex_unlock (&block_depot.lock);
+
+    while (n > 0)
+        free (tab[--n]);
+}
+
+/** Takes up to n blocks from the depot. */
+static unsigned block_depot_Get (unsigned cl, block_t **tab, unsigned n)
+{
+    unsigned i = 0;
+
+    vlc_mutex_lock (&block_depot.lock);
+    while (i < n && block_depot.first[cl] != NULL)
+    {
+        block_t *b = block_depot.first[cl];
+
+        block_depot.first[cl] = b->p_next;
+        block_depot.count[cl]--;
+        tab[i++] = b;
+    }
+    vlc_mutex_unlock (&block_depot.lock);
+    return i;
+}
+
+static void block_magazine_Destroy (void *data)
+{
+    block_magazine_t *mag = data;
+
+    for (unsigned cl = 0; cl < BLOCK_POOL_CLASSES; cl++)
+        block_depot_Put (cl, mag->stack[cl], mag->count[cl]);
+    free (mag);
+}
+
+static block_magazine_t *block_magazine_Get (void)
+{
+    if (unlikely(!atomic_load_explicit (&block_pool_ready,
+                                        memory_order_acquire)))
+    {
+        vlc_mutex_lock (&block_depot.lock);
+        if (!atomic_load_explicit (&block_pool_ready, memory_order_relaxed))
+        {
+            if (vlc_threadvar_create (&block_magazine_key,
+                                      block_magazine_Destroy))
+            {
+                vlc_mutex_unlock (&block_depot.lock);
+                return NULL;
+            }
+            atomic_store_explicit (&block_pool_ready, true,
+                                   memory_order_release);
+        }
+        vlc_mutex_unlock (&block_depot.lock);
+    }
+
+    block_magazine_t *mag = vlc_threadvar_get (block_magazine_key);
+    if (unlikely(mag == NULL))
+    {
+        mag = calloc (1, sizeof (*mag));
+        if (mag != NULL && vlc_threadvar_set (block_magazine_key, mag))
+        {
+            free (mag);
+            mag = NULL;
+        }
+    }
+    return mag;
+}
+
+static block_t *block_pool_Get (unsigned cl)
+{
+    block_magazine_t *mag = block_magazine_Get ();
+    block_t *b = NULL;
+
+    if (likely(mag != NULL))
+    {
+        if (mag->count[cl] == 0)
+            mag->count[cl] = block_depot_Get (cl, mag->stack[cl],
+                                              BLOCK_MAGAZINE_BATCH);
+        if (mag->count[cl] > 0)
+            b = mag->stack[cl][--mag->count[cl]];
+    }
+    else
+        block_depot_Get (cl, &b, 1);
+
+    if (b != NULL)
+        atomic_fetch_add_explicit (&block_pool_hits[cl], 1,
+                                   memory_order_relaxed);
+    else
+    {
+        atomic_fetch_add_explicit (&block_pool_misses[cl], 1,
+                                   memory_order_relaxed);
+        b = malloc (block_pool_sizes[cl]);
+    }
+    return b;
+}
+
+static void block_pool_Release (block_t *block)
+{
+    unsigned cl = block_pool_Class (sizeof (block_alloc_t) + block->i_size);
+    assert (cl < BLOCK_POOL_CLASSES);
+    assert (block_pool_sizes[cl] == sizeof (block_alloc_t) + block->i_size);
+    block_alloc_Credit (block);
+    block_Invalidate (block);
+
+    block_magazine_t *mag = block_magazine_Get ();
+    if (unlikely(mag == NULL))
+    {
+        block_depot_Put (cl, &block, 1);
+        return;
+    }
+
+    if (mag->count[cl] == BLOCK_MAGAZINE_SIZE)
+    {
+        mag->count[cl] -= BLOCK_MAGAZINE_BATCH;
+        block_depot_Put (cl, mag->stack[cl] + mag->count[cl],
+                         BLOCK_MAGAZINE_BATCH);
+    }
+    mag->stack[cl][mag->count[cl]++] = block;
+}
+
+/**
+ * Reads the block pool counters.
+ * @param stats table of BLOCK_POOL_CLASSES entries to fill
+ */
+void block_PoolStats (block_pool_stats_t *stats)
+{
+    for (unsigned cl = 0; cl < BLOCK_POOL_CLASSES; cl++)
+    {
+        stats[cl].size = block_pool_sizes[cl];
+        stats[cl].hits = atomic_load_explicit (&block_pool_hits[cl],
+                                               memory_order_relaxed);
+        stats[cl].misses = atomic_load_explicit (&block_pool_misses[cl],
+                                                 memory_order_relaxed);
+    }
+}
+
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    size_t alloc = sizeof (block_alloc_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                 + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
+    block_alloc_t *ba;
+    block_t *b;
+    block_free_t release;
+    unsigned cl = block_pool_Class (alloc);
+
+    if (cl < BLOCK_POOL_CLASSES)
+    {
+        alloc = block_pool_sizes[cl];
+        b = block_pool_Get (cl);
+        release = block_pool_Release;
+    }
+    else
+    {
+        b = malloc (alloc);
+        release = block_generic_Release;
+    }
     if (unlikely(b == NULL))
         return NULL;
 
-    block_Init (b, b + 1, alloc - sizeof (*b));
+    ba = (block_alloc_t *)b;
+    ba->account = vlc_mem_Charge (alloc);
+    block_Init (b, ba + 1, alloc - sizeof (*ba));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
     b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
     b->i_buffer = size;
-    b->pf_release = block_generic_Release;
+    b->pf_release = release;
     return b;
 }
 
+/**
+ * @section Shared blocks
+ *
+ * block_MakeShared() puts a block behind a reference count, and each
+ * reference to its payload is a small block_t of its own, with its own
+ * metadata and payload window. The payload is read-only as long as it is
+ * shared: block_Realloc() and block_Unshare() copy it instead.
+ */
+typedef struct
+{
+    atomic_uint refs;
+    block_t    *block; /**< Original block that holds the payload */
+} block_payload_t;
+
+typedef struct
+{
+    block_t          self;
+    block_payload_t *payload;
+} block_ref_t;
+
+static void block_ref_Release (block_t *block)
+{
+    block_payload_t *payload = ((block_ref_t *)block)->payload;
+
+    block_Invalidate (block);
+    free (block);
+
+    if (atomic_fetch_sub (&payload->refs, 1) == 1)
+    {
+        block_Release (payload->block);
+        free (payload);
+    }
+}
+
+static block_t *block_ref_New (block_payload_t *payload, block_t *from)
+{
+    block_ref_t *ref = malloc (sizeof (*ref));
+    if (unlikely(ref == NULL))
+        return NULL;
+
+    /* No headroom nor tailroom: growing the payload always copies it */
+    block_Init (&ref->self, from->p_buffer, from->i_buffer);
+    block_CopyProperties (&ref->self, from);
+    ref->self.pf_release = block_ref_Release;
+    ref->payload = payload;
+    atomic_fetch_add (&payload->refs, 1);
+    return &ref->self;
+}
+
+block_t *block_MakeShared (block_t *block)
+{
+    block_Check (block);
+    if (block->pf_release == block_ref_Release)
+        return block;
+
+    block_payload_t *payload = malloc (sizeof (*payload));
+    if (unlikely(payload == NULL))
+        return block;
+    atomic_init (&payload->refs, 0);
+    payload->block = block;
+
+    block_t *ref = block_ref_New (payload, block);
+    if (unlikely(ref == NULL))
+    {
+        free (payload);
+        return block;
+    }
+    ref->p_next = block->p_next;
+    block->p_next = NULL;
+    return ref;
+}
+
+block_t *block_Share (block_t *block)
+{
+    if (block->pf_release != block_ref_Release)
+        return block_Duplicate (block);
+
+    return block_ref_New (((block_ref_t *)block)->payload, block);
+}
+
+block_t *block_Unshare (block_t *block)
+{
+    if (block->pf_release != block_ref_Release)
+        return block;
+
+    /* The last reference owns the payload, and cannot be shared again
+     * behind our back */
+    block_payload_t *payload = ((block_ref_t *)block)->payload;
+    if (atomic_load (&payload->refs) == 1)
+        return block;
+
+    block_t *copy = block_Alloc (block->i_buffer);
+    if (likely(copy != NULL))
+    {
+        BlockMetaCopy (copy, block);
+        memcpy (copy->p_buffer, block->p_buffer, block->i_buffer);
+    }
+    block_Release (block);
+    return copy;
+}
+
 block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
 {
     size_t requested = i_prebody + i_body;
 
     block_Check( p_block );
 
+    /* Do not write to a payload that other references can see */
+    if( i_prebody > 0 || i_body > p_block->i_buffer )
+    {
+        p_block = block_Unshare( p_block );
+        if( p_block == NULL )
+            return NULL;
+    }
+
     /* Corner case: empty block requested */
     if( i_prebody <= 0 && i_body <= (size_t)(-i_prebody) )
     {
@@ -228,8 +567,10 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
     }
     else
     /* We have a very large reserved footer now? Release some of it.
+     * Pooled blocks are not shrunk: their size is fixed by their class.
      * XXX it might not preserve the alignment of p_buffer */
-    if( p_end - (p_block->p_buffer + i_body) > BLOCK_WASTE_SIZE )
+    if( p_block->pf_release != block_pool_Release
+     && p_end - (p_block->p_buffer + i_body) > BLOCK_WASTE_SIZE )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea )
@@ -508,6 +849,30 @@ block_t *block_FilePath (const char *path)
  * @section Thread-safe block queue functions
  */
 
+/**
+ * Lock-free ring used by single-producer/single-consumer block queues.
+ *
+ * The producer owns tail, the consumer advances head. block_FifoEmpty() may
+ * also advance head (from the producer side), hence head is advanced with
+ * compare-and-swap. When the ring is full, blocks overflow to the locked list
+ * of the queue, and stay there until the consumer drains it, so that ordering
+ * is preserved. The queue lock and condition variables are only used when
+ * either side needs to sleep.
+ */
+#define BLOCK_FIFO_SPSC_SLOTS 1024
+
+typedef struct
+{
+    atomic_size_t    head; /**< Next slot to dequeue */
+    atomic_size_t    tail; /**< Next slot to enqueue (producer only) */
+    atomic_size_t    depth;
+    atomic_size_t    size;
+    atomic_size_t    overflow; /**< Blocks in the locked overflow list */
+    atomic_bool      waiting; /**< Consumer sleeps on wait */
+    atomic_bool      room_waiting; /**< Producer sleeps on wait_room */
+    atomic_uintptr_t slots[BLOCK_FIFO_SPSC_SLOTS];
+} block_spsc_t;
+
 /**
  * Internal state for block queues
  */
@@ -522,6 +887,8 @@ struct block_fifo_t
     size_t              i_depth;
     size_t              i_size;
     bool          b_force_wake;
+
+    block_spsc_t        *spsc; /**< Lock-free ring (or NULL if locked) */
 };
 
 block_fifo_t *block_FifoNew( void )
@@ -537,23 +904,355 @@ block_fifo_t *block_FifoNew( void )
     p_fifo->pp_last = &p_fifo->p_first;
     p_fifo->i_depth = p_fifo->i_size = 0;
     p_fifo->b_force_wake = false;
+    p_fifo->spsc = NULL;
+
+    return p_fifo;
+}
+
+/**
+ * Creates a block queue optimized for exactly one producer and one consumer.
+ *
+ * The queue has the same semantics as one created with block_FifoNew().
+ * However it does not take any lock, unless one side needs to wait.
+ * block_FifoPut(), block_FifoPace(), block_FifoEmpty() and block_FifoWake()
+ * must be serialized by the caller (producer side); block_FifoGet() and
+ * block_FifoShow() must be called from a single consumer thread.
+ */
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    block_fifo_t *p_fifo = block_FifoNew();
+    if( unlikely(p_fifo == NULL) )
+        return NULL;
+
+    block_spsc_t *spsc = malloc( sizeof( *spsc ) );
+    if( unlikely(spsc == NULL) )
+    {
+        block_FifoRelease( p_fifo );
+        return NULL;
+    }
 
+    atomic_init( &spsc->head, 0 );
+    atomic_init( &spsc->tail, 0 );
+    atomic_init( &spsc->depth, 0 );
+    atomic_init( &spsc->size, 0 );
+    atomic_init( &spsc->overflow, 0 );
+    atomic_init( &spsc->waiting, false );
+    atomic_init( &spsc->room_waiting, false );
+    for( unsigned i = 0; i < BLOCK_FIFO_SPSC_SLOTS; i++ )
+        atomic_init( &spsc->slots[i], 0 );
+    p_fifo->spsc = spsc;
     return p_fifo;
 }
 
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
     block_FifoEmpty( p_fifo );
+    free( p_fifo->spsc );
     vlc_cond_destroy( &p_fifo->wait_room );
     vlc_cond_destroy( &p_fifo->wait );
     vlc_mutex_destroy( &p_fifo->lock );
     free( p_fifo );
 }
 
+/** Claims the oldest block of the ring, if any. */
+static block_t *block_spsc_Pop( block_spsc_t *spsc )
+{
+    size_t head = atomic_load_explicit( &spsc->head, memory_order_relaxed );
+
+    for( ;; )
+    {
+        if( head == atomic_load( &spsc->tail ) )
+            return NULL;
+
+        uintptr_t b = atomic_load_explicit(
+            &spsc->slots[head % BLOCK_FIFO_SPSC_SLOTS], memory_order_relaxed );
+        if( atomic_compare_exchange_weak( &spsc->head, &head, head + 1 ) )
+            return (block_t *)b;
+    }
+}
+
+/** Accounts for a block leaving the queue and wakes the producer up. */
+static void block_spsc_Dequeued( block_fifo_t *p_fifo, size_t n, size_t size )
+{
+    block_spsc_t *spsc = p_fifo->spsc;
+
+    atomic_fetch_sub( &spsc->depth, n );
+    atomic_fetch_sub( &spsc->size, size );
+
+    if( atomic_load( &spsc->room_waiting ) )
+    {
+        vlc_mutex_lock( &p_fifo->lock );
+        vlc_cond_broadcast( &p_fifo->wait_room );
+        vlc_mutex_unlock( &p_fifo->lock );
+    }
+}
+
+/** Takes an overflown block. Ring must be empty. */
+static block_t *block_spsc_PopOverflow( block_fifo_t *p_fifo )
+{
+    block_t *b = p_fifo->p_first;
+
+    vlc_assert_locked( &p_fifo->lock );
+    if( b != NULL )
+    {
+        p_fifo->p_first = b->p_next;
+        if( p_fifo->p_first == NULL )
+            p_fifo->pp_last = &p_fifo->p_first;
+        atomic_fetch_sub( &p_fifo->spsc->overflow, 1 );
+        b->p_next = NULL;
+    }
+    return b;
+}
+
+static void block_spsc_Put( block_fifo_t *p_fifo, block_t *p_block,
+                            size_t i_depth, size_t i_size )
+{
+    block_spsc_t *spsc = p_fifo->spsc;
+
+    /* Account first, so that the consumer never underflows the counters */
+    atomic_fetch_add( &spsc->depth, i_depth );
+    atomic_fetch_add( &spsc->size, i_size );
+
+    size_t tail = atomic_load_explicit( &spsc->tail, memory_order_relaxed );
+
+    while( p_block != NULL )
+    {
+        /* Once blocks overflow, keep queuing there until the consumer has
+         * drained them. Only the producer increments the counter. */
+        if( atomic_load( &spsc->overflow ) > 0
+         || tail - atomic_load( &spsc->head ) >= BLOCK_FIFO_SPSC_SLOTS )
+            break;
+
+        block_t *p_next = p_block->p_next;
+
+        p_block->p_next = NULL;
+        atomic_store_explicit( &spsc->slots[tail % BLOCK_FIFO_SPSC_SLOTS],
+                               (uintptr_t)p_block, memory_order_relaxed );
+        atomic_store( &spsc->tail, ++tail );
+        p_block = p_next;
+    }
+
+    if( p_block != NULL )
+    {
+        size_t n = 0;
+        block_t *p_last = p_block;
+
+        for( ;; )
+        {
+            n++;
+            if( p_last->p_next == NULL )
+                break;
+            p_last = p_last->p_next;
+        }
+
+        vlc_mutex_lock( &p_fifo->lock );
+        *p_fifo->pp_last = p_block;
+        p_fifo->pp_last = &p_last->p_next;
+        atomic_fetch_add( &spsc->overflow, n );
+        vlc_cond_signal( &p_fifo->wait );
+        vlc_mutex_unlock( &p_fifo->lock );
+    }
+    else
+    if( atomic_load( &spsc->waiting ) )
+    {
+        vlc_mutex_lock( &p_fifo->lock );
+        vlc_cond_signal( &p_fifo->wait );
+        vlc_mutex_unlock( &p_fifo->lock );
+    }
+}
+
+static void block_spsc_Cleanup( void *data )
+{
+    block_fifo_t *p_fifo = data;
+
+    atomic_store( &p_fifo->spsc->waiting, false );
+    vlc_mutex_unlock( &p_fifo->lock );
+}
+
+/** Dequeues the oldest block on the consumer side, without waiting. */
+static block_t *block_spsc_TryPop( block_fifo_t *p_fifo )
+{
+    block_spsc_t *spsc = p_fifo->spsc;
+    block_t *b = block_spsc_Pop( spsc );
+
+    while( b == NULL && atomic_load( &spsc->overflow ) > 0 )
+    {
+        vlc_mutex_lock( &p_fifo->lock );
+        if( atomic_load( &spsc->head ) == atomic_load( &spsc->tail ) )
+        {
+            b = block_spsc_PopOverflow( p_fifo );
+            vlc_mutex_unlock( &p_fifo->lock );
+            break;
+        }
+        vlc_mutex_unlock( &p_fifo->lock );
+        b = block_spsc_Pop( spsc );
+    }
+    return b;
+}
+
+/**
+ * Waits for a block on the consumer side.
+ * @param peek true to leave the block in the queue
+ * @param deadline time limit (or VLC_TS_INVALID to wait indefinitely)
+ * @return a block, or NULL if woken up with block_FifoWake() or timed out
+ */
+static block_t *block_spsc_Get( block_fifo_t *p_fifo, bool peek,
+                                mtime_t deadline )
+{
+    block_spsc_t *spsc = p_fifo->spsc;
+    block_t *b;
+
+    for( ;; )
+    {
+        if( peek )
+        {
+            size_t head = atomic_load( &spsc->head );
+            b = NULL;
+            if( head != atomic_load( &spsc->tail ) )
+                b = (block_t *)atomic_load_explicit(
+                    &spsc->slots[head % BLOCK_FIFO_SPSC_SLOTS],
+                    memory_order_relaxed );
+        }
+        else
+            b = block_spsc_Pop( spsc );
+        if( b != NULL )
+            break;
+
+        vlc_mutex_lock( &p_fifo->lock );
+        if( atomic_load( &spsc->overflow ) > 0 )
+        {
+            /* The ring may have been refilled before the overflow lock was
+             * taken, but only with blocks older than the overflown ones. */
+            if( atomic_load( &spsc->head ) == atomic_load( &spsc->tail ) )
+            {
+                b = peek ? p_fifo->p_first : block_spsc_PopOverflow( p_fifo );
+                vlc_mutex_unlock( &p_fifo->lock );
+                if( b != NULL )
+                    break;
+            }
+            else
+                vlc_mutex_unlock( &p_fifo->lock );
+            continue;
+        }
+
+        if( !peek && p_fifo->b_force_wake )
+        {
+            p_fifo->b_force_wake = false;
+            vlc_mutex_unlock( &p_fifo->lock );
+            return NULL;
+        }
+
+        atomic_store( &spsc->waiting, true );
+        if( atomic_load( &spsc->head ) == atomic_load( &spsc->tail ) )
+        {
+            int val = 0;
+            mtime_t trace = vlc_trace_Begin();
+
+            vlc_cleanup_push( block_spsc_Cleanup, p_fifo );
+            if( deadline > VLC_TS_INVALID )
+                val = vlc_cond_timedwait( &p_fifo->wait, &p_fifo->lock,
+                                          deadline );
+            else
+                vlc_cond_wait( &p_fifo->wait, &p_fifo->lock );
+            vlc_cleanup_pop();
+            vlc_trace_End( trace, "fifo", "wait", NULL );
+            if( val )
+            {
+                block_spsc_Cleanup( p_fifo );
+                return NULL;
+            }
+        }
+        block_spsc_Cleanup( p_fifo );
+    }
+
+    if( !peek )
+        block_spsc_Dequeued( p_fifo, 1, b->i_buffer );
+    return b;
+}
+
+static void block_spsc_Empty( block_fifo_t *p_fifo )
+{
+    block_spsc_t *spsc = p_fifo->spsc;
+    block_t *chain = NULL, **pp = &chain;
+    size_t depth = 0, size = 0;
+
+    /* Claim all blocks in the ring at once */
+    size_t head = atomic_load( &spsc->head );
+    size_t tail = atomic_load_explicit( &spsc->tail, memory_order_relaxed );
+
+    while( head != tail )
+    {
+        block_t *b = (block_t *)atomic_load_explicit(
+            &spsc->slots[head % BLOCK_FIFO_SPSC_SLOTS], memory_order_relaxed );
+        if( atomic_compare_exchange_weak( &spsc->head, &head, head + 1 ) )
+        {
+            *pp = b;
+            pp = &b->p_next;
+            head++;
+        }
+    }
+
+    vlc_mutex_lock( &p_fifo->lock );
+    *pp = p_fifo->p_first;
+    p_fifo->p_first = NULL;
+    p_fifo->pp_last = &p_fifo->p_first;
+    atomic_store( &spsc->overflow, 0 );
+    vlc_mutex_unlock( &p_fifo->lock );
+
+    for( block_t *b = chain; b != NULL; b = b->p_next )
+    {
+        depth++;
+        size += b->i_buffer;
+    }
+    block_ChainRelease( chain );
+    block_spsc_Dequeued( p_fifo, depth, size );
+
+    vlc_mutex_lock( &p_fifo->lock );
+    vlc_cond_broadcast( &p_fifo->wait_room );
+    vlc_mutex_unlock( &p_fifo->lock );
+}
+
+static void block_spsc_PaceCleanup( void *data )
+{
+    block_fifo_t *p_fifo = data;
+
+    atomic_store( &p_fifo->spsc->room_waiting, false );
+    vlc_mutex_unlock( &p_fifo->lock );
+}
+
+static void block_spsc_Pace( block_fifo_t *p_fifo, size_t max_depth,
+                             size_t max_size )
+{
+    block_spsc_t *spsc = p_fifo->spsc;
+
+    vlc_testcancel ();
+
+    if( atomic_load( &spsc->depth ) <= max_depth
+     && atomic_load( &spsc->size ) <= max_size )
+        return;
+
+    vlc_mutex_lock( &p_fifo->lock );
+    atomic_store( &spsc->room_waiting, true );
+    while( atomic_load( &spsc->depth ) > max_depth
+        || atomic_load( &spsc->size ) > max_size )
+    {
+        vlc_cleanup_push( block_spsc_PaceCleanup, p_fifo );
+        vlc_cond_wait( &p_fifo->wait_room, &p_fifo->lock );
+        vlc_cleanup_pop();
+    }
+    block_spsc_PaceCleanup( p_fifo );
+}
+
 void block_FifoEmpty( block_fifo_t *p_fifo )
 {
     block_t *block;
 
+    if( p_fifo->spsc != NULL )
+    {
+        block_spsc_Empty( p_fifo );
+        return;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     block = p_fifo->p_first;
     if (block != NULL)
@@ -594,6 +1293,12 @@ void block_FifoEmpty( block_fifo_t *p_fifo )
  */
 void block_FifoPace (block_fifo_t *fifo, size_t max_depth, size_t max_size)
 {
+    if (fifo->spsc != NULL)
+    {
+        block_spsc_Pace (fifo, max_depth, max_size);
+        return;
+    }
+
     vlc_testcancel ();
 
     vlc_mutex_lock (&fifo->lock);
@@ -627,6 +1332,12 @@ size_t block_FifoPut( block_fifo_t *p_fifo, block_t *p_block )
             break;
     }
 
+    if (p_fifo->spsc != NULL)
+    {
+        block_spsc_Put (p_fifo, p_block, i_depth, i_size);
+        return i_size;
+    }
+
     vlc_mutex_lock (&p_fifo->lock);
     *p_fifo->pp_last = p_block;
     p_fifo->pp_last = &p_last->p_next;
@@ -642,6 +1353,12 @@ size_t block_FifoPut( block_fifo_t *p_fifo, block_t *p_block )
 void block_FifoWake( block_fifo_t *p_fifo )
 {
     vlc_mutex_lock( &p_fifo->lock );
+    if( p_fifo->spsc != NULL )
+    {
+        if( atomic_load( &p_fifo->spsc->depth ) == 0 )
+            p_fifo->b_force_wake = true;
+    }
+    else
     if( p_fifo->p_first == NULL )
         p_fifo->b_force_wake = true;
     vlc_cond_broadcast( &p_fifo->wait );
@@ -660,13 +1377,22 @@ block_t *block_FifoGet( block_fifo_t *p_fifo )
 
     vlc_testcancel( );
 
+    if( p_fifo->spsc != NULL )
+        return block_spsc_Get( p_fifo, false, VLC_TS_INVALID );
+
     vlc_mutex_lock( &p_fifo->lock );
     mutex_cleanup_push( &p_fifo->lock );
 
     /* Remember vlc_cond_wait() may cause spurious wakeups
      * (on both Win32 and POSIX) */
-    while( ( p_fifo->p_first == NULL ) && !p_fifo->b_force_wake )
-        vlc_cond_wait( &p_fifo->wait, &p_fifo->lock );
+    if( ( p_fifo->p_first == NULL ) && !p_fifo->b_force_wake )
+    {
+        mtime_t trace = vlc_trace_Begin();
+
+        while( ( p_fifo->p_first == NULL ) && !p_fifo->b_force_wake )
+            vlc_cond_wait( &p_fifo->wait, &p_fifo->lock );
+        vlc_trace_End( trace, "fifo", "wait", NULL );
+    }
 
     vlc_cleanup_pop();
     b = p_fifo->p_first;
@@ -696,6 +1422,98 @@ block_t *block_FifoGet( block_fifo_t *p_fifo )
     return b;
 }
 
+/**
+ * Dequeues a chain of blocks from the FIFO at once. If necessary, waits until
+ * there is at least one block in the queue, or until the deadline.
+ * This function is (always) a cancellation point.
+ *
+ * This amortizes the synchronization cost for consumers that can process
+ * several queued blocks in a row.
+ *
+ * @param max_size stop dequeuing once that many bytes are dequeued
+ * (at least one block is always dequeued, use SIZE_MAX to drain the queue)
+ * @param deadline time limit to wait for a first block
+ * (or VLC_TS_INVALID to wait indefinitely)
+ * @return a chain of blocks, or NULL if block_FifoWake() was called or
+ * the deadline expired.
+ */
+block_t *block_FifoGetBatch( block_fifo_t *p_fifo, size_t max_size,
+                             mtime_t deadline )
+{
+    block_t *first, **pp;
+    size_t i_depth = 0, i_size = 0;
+
+    vlc_testcancel( );
+
+    if( p_fifo->spsc != NULL )
+    {
+        first = block_spsc_Get( p_fifo, false, deadline );
+        if( first == NULL )
+            return NULL;
+
+        size_t n = first->i_buffer;
+        block_t *b;
+
+        pp = &first->p_next;
+        while( n < max_size && (b = block_spsc_TryPop( p_fifo )) != NULL )
+        {
+            n += b->i_buffer;
+            i_size += b->i_buffer;
+            i_depth++;
+            *pp = b;
+            pp = &b->p_next;
+        }
+        if( i_depth > 0 )
+            block_spsc_Dequeued( p_fifo, i_depth, i_size );
+        return first;
+    }
+
+    vlc_mutex_lock( &p_fifo->lock );
+    mutex_cleanup_push( &p_fifo->lock );
+
+    while( ( p_fifo->p_first == NULL ) && !p_fifo->b_force_wake )
+    {
+        if( deadline <= VLC_TS_INVALID )
+            vlc_cond_wait( &p_fifo->wait, &p_fifo->lock );
+        else
+        if( vlc_cond_timedwait( &p_fifo->wait, &p_fifo->lock, deadline ) )
+            break;
+    }
+
+    vlc_cleanup_pop();
+    first = p_fifo->p_first;
+
+    p_fifo->b_force_wake = false;
+    if( first == NULL )
+    {
+        /* Forced wakeup or time out */
+        vlc_mutex_unlock( &p_fifo->lock );
+        return NULL;
+    }
+
+    pp = &p_fifo->p_first;
+    do
+    {
+        i_size += (*pp)->i_buffer;
+        i_depth++;
+        pp = &(*pp)->p_next;
+    }
+    while( *pp != NULL && i_size < max_size );
+
+    p_fifo->p_first = *pp;
+    *pp = NULL;
+    p_fifo->i_depth -= i_depth;
+    p_fifo->i_size -= i_size;
+
+    if( p_fifo->p_first == NULL )
+        p_fifo->pp_last = &p_fifo->p_first;
+
+    vlc_cond_broadcast( &p_fifo->wait_room );
+    vlc_mutex_unlock( &p_fifo->lock );
+
+    return first;
+}
+
 /**
  * Peeks the first block in the FIFO.
  * If necessary, wait until there is one block.
@@ -713,6 +1531,9 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 
     vlc_testcancel( );
 
+    if( p_fifo->spsc != NULL )
+        return block_spsc_Get( p_fifo, true, VLC_TS_INVALID );
+
     vlc_mutex_lock( &p_fifo->lock );
     mutex_cleanup_push( &p_fifo->lock );
 
@@ -728,11 +1549,15 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 /* FIXME: not thread-safe */
 size_t block_FifoSize( const block_fifo_t *p_fifo )
 {
+    if( p_fifo->spsc != NULL )
+        return atomic_load( &p_fifo->spsc->size );
     return p_fifo->i_size;
 }
 
 /* FIXME: not thread-safe */
 size_t block_FifoCount( const block_fifo_t *p_fifo )
 {
+    if( p_fifo->spsc != NULL )
+        return atomic_load( &p_fifo->spsc->depth );
     return p_fifo->i_depth;
 }
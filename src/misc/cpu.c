@@ -35,6 +35,7 @@
 #include "libvlc.h"
 
 #include <assert.h>
+#include <string.h>
 
 #ifndef __linux__
 #include <sys/types.h>
@@ -261,7 +262,7 @@ out:
 
 #endif
 
-    cpu_flags = i_capabilities;
+    cpu_flags = vlc_CPU_mask (i_capabilities);
 }
 
 /**
@@ -279,6 +280,85 @@ unsigned vlc_CPU (void)
 }
 #endif
 
+/**
+ * Restricts the detected CPU capabilities to the VLC_CPU_MASK environment
+ * variable if it is set, so that the code paths for older CPUs can be tested
+ * and benchmarked on newer ones.
+ */
+uint32_t vlc_CPU_mask (uint32_t flags)
+{
+    const char *mask = getenv ("VLC_CPU_MASK");
+
+    if (mask != NULL)
+        flags &= strtoul (mask, NULL, 0);
+    return flags;
+}
+
+/* Routines picked by vlc_CPU_Fastest() */
+#define CPU_BENCH_MAX    32
+#define CPU_BENCH_ROUNDS 5
+
+static struct
+{
+    char     name[32];
+    unsigned index;
+} cpu_bench[CPU_BENCH_MAX];
+static unsigned cpu_bench_count = 0;
+static vlc_mutex_t cpu_bench_lock = VLC_STATIC_MUTEX;
+
+#undef vlc_CPU_Fastest
+unsigned vlc_CPU_Fastest (vlc_object_t *obj, const char *name, unsigned count,
+                          void (*run) (void *, unsigned), void *opaque)
+{
+    if (count <= 1 || !var_InheritBool (obj, "cpu-bench"))
+        return 0;
+
+    /* The lock is held while timing, so that the candidates are not timed
+     * twice nor against one another's load. */
+    vlc_mutex_lock (&cpu_bench_lock);
+    for (unsigned i = 0; i < cpu_bench_count; i++)
+        if (!strncmp (cpu_bench[i].name, name, sizeof (cpu_bench[i].name) - 1))
+        {
+            unsigned index = cpu_bench[i].index;
+            vlc_mutex_unlock (&cpu_bench_lock);
+            return (index < count) ? index : 0;
+        }
+
+    /* Keep the best of a few interleaved rounds, the first ones warming up
+     * the caches */
+    mtime_t best[count];
+    for (unsigned i = 0; i < count; i++)
+        best[i] = INT64_MAX;
+
+    for (unsigned round = 0; round < CPU_BENCH_ROUNDS; round++)
+        for (unsigned i = 0; i < count; i++)
+        {
+            mtime_t start = mdate ();
+            run (opaque, i);
+            best[i] = __MIN(best[i], mdate () - start);
+        }
+
+    /* Only move away from the preferred candidate for a clear gain */
+    unsigned index = 0;
+    for (unsigned i = 1; i < count; i++)
+        if (best[i] * 20 < best[index] * 19)
+            index = i;
+
+    msg_Dbg (obj, "%s: using candidate %u of %u (%"PRId64" us, "
+             "%"PRId64" us for the first)", name, index, count,
+             best[index], best[0]);
+
+    if (cpu_bench_count < CPU_BENCH_MAX)
+    {
+        strlcpy (cpu_bench[cpu_bench_count].name, name,
+                 sizeof (cpu_bench[cpu_bench_count].name));
+        cpu_bench[cpu_bench_count].index = index;
+        cpu_bench_count++;
+    }
+    vlc_mutex_unlock (&cpu_bench_lock);
+    return index;
+}
+
 void vlc_CPU_dump (vlc_object_t *obj)
 {
     char buf[200], *p = buf;
@@ -29,9 +29,93 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_epg.h>
 
+static void vlc_epg_event_Clean( vlc_epg_event_t *p_evt )
+{
+    free( p_evt->psz_name );
+    free( p_evt->psz_short_description );
+    free( p_evt->psz_description );
+}
+
+static void vlc_epg_event_Set( vlc_epg_event_t *p_evt, int64_t i_start, int i_duration,
+                               const char *psz_name, const char *psz_short_description,
+                               const char *psz_description )
+{
+    p_evt->i_start = i_start;
+    p_evt->i_duration = i_duration;
+    p_evt->psz_name = psz_name ? strdup( psz_name ) : NULL;
+    p_evt->psz_short_description = psz_short_description ? strdup( psz_short_description ) : NULL;
+    p_evt->psz_description = psz_description ? strdup( psz_description ) : NULL;
+}
+
+static bool vlc_epg_string_Equals( const char *a, const char *b )
+{
+    if( a == NULL || b == NULL )
+        return a == b;
+    return !strcmp( a, b );
+}
+
+static bool vlc_epg_event_Equals( const vlc_epg_event_t *a, const vlc_epg_event_t *b )
+{
+    return a->i_start == b->i_start && a->i_duration == b->i_duration &&
+           vlc_epg_string_Equals( a->psz_name, b->psz_name ) &&
+           vlc_epg_string_Equals( a->psz_short_description, b->psz_short_description ) &&
+           vlc_epg_string_Equals( a->psz_description, b->psz_description );
+}
+
+/* The events are sorted by start time, and there is at most one event per
+ * start time. This returns the index of the first event starting at or
+ * after i_start. */
+static int vlc_epg_Search( const vlc_epg_t *p_epg, int64_t i_start, bool *pb_found )
+{
+    int i_low = 0, i_high = p_epg->i_event;
+
+    while( i_low < i_high )
+    {
+        const int i_mid = i_low + (i_high - i_low) / 2;
+
+        if( p_epg->pp_event[i_mid]->i_start < i_start )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    *pb_found = i_low < p_epg->i_event &&
+                p_epg->pp_event[i_low]->i_start == i_start;
+    return i_low;
+}
+
+/* Adds or replaces the event starting at i_start.
+ * Returns true if the EPG has been modified. */
+static bool vlc_epg_Update( vlc_epg_t *p_epg, const vlc_epg_event_t *p_src )
+{
+    bool b_found;
+    int i_pos = vlc_epg_Search( p_epg, p_src->i_start, &b_found );
+
+    if( b_found )
+    {
+        /* The event is modified in place, so that p_current stays valid */
+        vlc_epg_event_t *p_evt = p_epg->pp_event[i_pos];
+        if( vlc_epg_event_Equals( p_evt, p_src ) )
+            return false;
+        vlc_epg_event_Clean( p_evt );
+        vlc_epg_event_Set( p_evt, p_src->i_start, p_src->i_duration, p_src->psz_name,
+                           p_src->psz_short_description, p_src->psz_description );
+        return true;
+    }
+
+    vlc_epg_event_t *p_evt = malloc( sizeof(*p_evt) );
+    if( !p_evt )
+        return false;
+    vlc_epg_event_Set( p_evt, p_src->i_start, p_src->i_duration, p_src->psz_name,
+                       p_src->psz_short_description, p_src->psz_description );
+    TAB_INSERT( p_epg->i_event, p_epg->pp_event, p_evt, i_pos );
+    return true;
+}
+
 void vlc_epg_Init( vlc_epg_t *p_epg, const char *psz_name )
 {
     p_epg->psz_name = psz_name ? strdup( psz_name ) : NULL;
@@ -45,9 +129,7 @@ void vlc_epg_Clean( vlc_epg_t *p_epg )
     for( i = 0; i < p_epg->i_event; i++ )
     {
         vlc_epg_event_t *p_evt = p_epg->pp_event[i];
-        free( p_evt->psz_name );
-        free( p_evt->psz_short_description );
-        free( p_evt->psz_description );
+        vlc_epg_event_Clean( p_evt );
         free( p_evt );
     }
     TAB_CLEAN( p_epg->i_event, p_epg->pp_event );
@@ -57,15 +139,14 @@ void vlc_epg_Clean( vlc_epg_t *p_epg )
 void vlc_epg_AddEvent( vlc_epg_t *p_epg, int64_t i_start, int i_duration,
                        const char *psz_name, const char *psz_short_description, const char *psz_description )
 {
-    vlc_epg_event_t *p_evt = malloc( sizeof(*p_evt) );
-    if( !p_evt )
-        return;
-    p_evt->i_start = i_start;
-    p_evt->i_duration = i_duration;
-    p_evt->psz_name = psz_name ? strdup( psz_name ) : NULL;
-    p_evt->psz_short_description = psz_short_description ? strdup( psz_short_description ) : NULL;
-    p_evt->psz_description = psz_description ? strdup( psz_description ) : NULL;
-    TAB_APPEND( p_epg->i_event, p_epg->pp_event, p_evt );
+    const vlc_epg_event_t evt = {
+        .i_start = i_start,
+        .i_duration = i_duration,
+        .psz_name = (char *)psz_name,
+        .psz_short_description = (char *)psz_short_description,
+        .psz_description = (char *)psz_description,
+    };
+    vlc_epg_Update( p_epg, &evt );
 }
 
 vlc_epg_t *vlc_epg_New( const char *psz_name )
@@ -84,64 +165,52 @@ void vlc_epg_Delete( vlc_epg_t *p_epg )
 
 void vlc_epg_SetCurrent( vlc_epg_t *p_epg, int64_t i_start )
 {
-    int i;
+    bool b_found;
     p_epg->p_current = NULL;
     if( i_start < 0 )
         return;
 
-    for( i = 0; i < p_epg->i_event; i++ )
-    {
-        if( p_epg->pp_event[i]->i_start == i_start )
-        {
-            p_epg->p_current = p_epg->pp_event[i];
-            break;
-        }
-    }
+    int i_pos = vlc_epg_Search( p_epg, i_start, &b_found );
+    if( b_found )
+        p_epg->p_current = p_epg->pp_event[i_pos];
 }
 
-void vlc_epg_Merge( vlc_epg_t *p_dst, const vlc_epg_t *p_src )
+bool vlc_epg_Merge( vlc_epg_t *p_dst, const vlc_epg_t *p_src )
 {
-    int i;
+    bool b_changed = false;
 
-    /* Add new event */
-    for( i = 0; i < p_src->i_event; i++ )
-    {
-        vlc_epg_event_t *p_evt = p_src->pp_event[i];
-        bool b_add = true;
-        int j;
+    /* Add new and modified events */
+    for( int i = 0; i < p_src->i_event; i++ )
+        b_changed |= vlc_epg_Update( p_dst, p_src->pp_event[i] );
 
-        for( j = 0; j < p_dst->i_event; j++ )
-        {
-            if( p_dst->pp_event[j]->i_start == p_evt->i_start && p_dst->pp_event[j]->i_duration == p_evt->i_duration )
-            {
-                b_add = false;
-                break;
-            }
-            if( p_dst->pp_event[j]->i_start > p_evt->i_start )
-                break;
-        }
-        if( b_add )
-        {
-            vlc_epg_event_t *p_copy = calloc( 1, sizeof(vlc_epg_event_t) );
-            if( !p_copy )
-                break;
-            p_copy->i_start = p_evt->i_start;
-            p_copy->i_duration = p_evt->i_duration;
-            p_copy->psz_name = p_evt->psz_name ? strdup( p_evt->psz_name ) : NULL;
-            p_copy->psz_short_description = p_evt->psz_short_description ? strdup( p_evt->psz_short_description ) : NULL;
-            p_copy->psz_description = p_evt->psz_description ? strdup( p_evt->psz_description ) : NULL;
-            TAB_INSERT( p_dst->i_event, p_dst->pp_event, p_copy, j );
-        }
-    }
     /* Update current */
     if( p_src->p_current )
+    {
+        const vlc_epg_event_t *p_previous = p_dst->p_current;
+
         vlc_epg_SetCurrent( p_dst, p_src->p_current->i_start );
+        b_changed |= p_dst->p_current != p_previous;
+    }
 
     /* Keep only 1 old event  */
     if( p_dst->p_current )
     {
-        while( p_dst->i_event > 1 && p_dst->pp_event[0] != p_dst->p_current && p_dst->pp_event[1] != p_dst->p_current )
-            TAB_REMOVE( p_dst->i_event, p_dst->pp_event, p_dst->pp_event[0] );
+        bool b_found;
+        int i_old = vlc_epg_Search( p_dst, p_dst->p_current->i_start, &b_found ) - 1;
+
+        assert( b_found );
+        if( i_old > 0 )
+        {
+            for( int i = 0; i < i_old; i++ )
+            {
+                vlc_epg_event_Clean( p_dst->pp_event[i] );
+                free( p_dst->pp_event[i] );
+            }
+            p_dst->i_event -= i_old;
+            memmove( &p_dst->pp_event[0], &p_dst->pp_event[i_old],
+                     p_dst->i_event * sizeof(*p_dst->pp_event) );
+            b_changed = true;
+        }
     }
+    return b_changed;
 }
-
@@ -25,10 +25,13 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <libvlc.h>
 #include <vlc_filter.h>
 #include <vlc_modules.h>
+#include <vlc_cpu.h>
 
 filter_t *filter_NewBlend( vlc_object_t *p_this,
                            const video_format_t *p_dst_chroma )
@@ -111,6 +114,165 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_release( p_blend );
 }
 
+/*****************************************************************************
+ * Slices
+ *****************************************************************************
+ * Video filters setting b_slices split each picture into stripes of rows,
+ * which are run by a process-wide set of worker threads and by the thread
+ * calling the filter. The workers are started by the first filter chain
+ * holding a slice filter and exit with the last one.
+ *****************************************************************************/
+#define FILTER_SLICES_MIN_ROWS    (16) /* Smallest stripe worth a thread */
+#define FILTER_SLICES_MAX_THREADS (32)
+
+typedef struct filter_slices_job_t filter_slices_job_t;
+struct filter_slices_job_t
+{
+    filter_t *p_filter;
+    void     (*pf_slice)( filter_t *, void *, int, int );
+    void     *p_data;
+    int      i_rows;
+    unsigned i_slices; /* Number of stripes */
+    unsigned i_next;   /* Next stripe to run */
+    unsigned i_done;   /* Completed stripes */
+    filter_slices_job_t *p_next;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;      /* A job was queued, or no more users */
+    vlc_cond_t  wait_done; /* A stripe was completed, or a worker exited */
+    filter_slices_job_t *p_first; /* Jobs with stripes left to run */
+    filter_slices_job_t **pp_last;
+    unsigned    i_threads; /* Live workers */
+    unsigned    i_users;   /* Filters using the workers */
+} filter_slices = {
+    VLC_STATIC_MUTEX, VLC_STATIC_COND, VLC_STATIC_COND,
+    NULL, &filter_slices.p_first, 0, 0,
+};
+
+/* Runs the next stripe of a job, returns false if none is left */
+static bool SlicesRunLocked( filter_slices_job_t *p_job )
+{
+    vlc_assert_locked( &filter_slices.lock );
+
+    if( p_job->i_next >= p_job->i_slices )
+        return false;
+
+    const unsigned i_slice = p_job->i_next++;
+    if( p_job->i_next == p_job->i_slices )
+    {
+        /* Nothing left to give to the workers */
+        filter_slices_job_t **pp = &filter_slices.p_first;
+
+        while( *pp != p_job )
+            pp = &(*pp)->p_next;
+        *pp = p_job->p_next;
+        if( filter_slices.pp_last == &p_job->p_next )
+            filter_slices.pp_last = pp;
+    }
+    vlc_mutex_unlock( &filter_slices.lock );
+
+    const int i_start = (int64_t)p_job->i_rows * i_slice / p_job->i_slices;
+    const int i_end = (int64_t)p_job->i_rows * (i_slice + 1) / p_job->i_slices;
+    p_job->pf_slice( p_job->p_filter, p_job->p_data, i_start, i_end );
+
+    vlc_mutex_lock( &filter_slices.lock );
+    if( ++p_job->i_done == p_job->i_slices )
+        vlc_cond_broadcast( &filter_slices.wait_done );
+    return true;
+}
+
+static void *SlicesThread( void *p_data )
+{
+    (void)p_data;
+
+    vlc_mutex_lock( &filter_slices.lock );
+    for( ;; )
+    {
+        filter_slices_job_t *p_job = filter_slices.p_first;
+
+        if( p_job == NULL )
+        {
+            if( filter_slices.i_users == 0 )
+                break;
+            vlc_cond_wait( &filter_slices.wait, &filter_slices.lock );
+            continue;
+        }
+        SlicesRunLocked( p_job );
+    }
+    filter_slices.i_threads--;
+    vlc_cond_broadcast( &filter_slices.wait_done );
+    vlc_mutex_unlock( &filter_slices.lock );
+    return NULL;
+}
+
+void filter_SlicesHold( vlc_object_t *p_obj )
+{
+    int i_threads = var_InheritInteger( p_obj, "filter-threads" );
+    if( i_threads <= 0 )
+        i_threads = vlc_GetCPUCount();
+    i_threads = __MIN( i_threads, FILTER_SLICES_MAX_THREADS );
+
+    /* The thread calling the filter runs a stripe too */
+    vlc_mutex_lock( &filter_slices.lock );
+    filter_slices.i_users++;
+    while( filter_slices.i_threads + 1 < (unsigned)i_threads )
+    {
+        if( vlc_clone_detach( NULL, SlicesThread, NULL,
+                              VLC_THREAD_PRIORITY_VIDEO ) )
+            break;
+        filter_slices.i_threads++;
+    }
+    const unsigned i_running = filter_slices.i_threads + 1;
+    vlc_mutex_unlock( &filter_slices.lock );
+    msg_Dbg( p_obj, "running filter slices on %u thread(s)", i_running );
+}
+
+void filter_SlicesRelease( void )
+{
+    vlc_mutex_lock( &filter_slices.lock );
+    assert( filter_slices.i_users > 0 );
+    if( --filter_slices.i_users == 0 )
+        vlc_cond_broadcast( &filter_slices.wait );
+    while( filter_slices.i_users == 0 && filter_slices.i_threads > 0 )
+        vlc_cond_wait( &filter_slices.wait_done, &filter_slices.lock );
+    vlc_mutex_unlock( &filter_slices.lock );
+}
+
+void filter_RunSlices( filter_t *p_filter,
+                       void (*pf_slice)( filter_t *, void *, int, int ),
+                       void *p_data, int i_rows )
+{
+    unsigned i_slices = 1;
+
+    vlc_mutex_lock( &filter_slices.lock );
+    if( p_filter->b_slices && filter_slices.i_users > 0 )
+        i_slices = __MIN( filter_slices.i_threads + 1,
+                          (unsigned)__MAX( i_rows, 0 ) / FILTER_SLICES_MIN_ROWS );
+    if( i_slices <= 1 )
+    {
+        vlc_mutex_unlock( &filter_slices.lock );
+        pf_slice( p_filter, p_data, 0, i_rows );
+        return;
+    }
+
+    filter_slices_job_t job = {
+        .p_filter = p_filter, .pf_slice = pf_slice, .p_data = p_data,
+        .i_rows = i_rows, .i_slices = i_slices, .i_next = 0, .i_done = 0,
+        .p_next = NULL,
+    };
+    *filter_slices.pp_last = &job;
+    filter_slices.pp_last = &job.p_next;
+    vlc_cond_broadcast( &filter_slices.wait );
+
+    while( SlicesRunLocked( &job ) );
+    while( job.i_done < job.i_slices )
+        vlc_cond_wait( &filter_slices.wait_done, &filter_slices.lock );
+    vlc_mutex_unlock( &filter_slices.lock );
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
@@ -101,6 +101,96 @@ static int UpdateBufferFunctions( filter_chain_t * );
 
 static void FilterDeletePictures( filter_t *, picture_t * );
 
+/**
+ * Recent conversions that no module could do.
+ *
+ * Building a chain, filter by filter or through intermediate formats, probes
+ * every candidate module for each conversion, and the same impossible
+ * conversions are tried each time a chain is rebuilt. Only automatic
+ * selections are remembered. Entries expire, since the outcome may depend on
+ * run-time conditions (configuration, hardware...).
+ */
+#define FAILED_CONVERSIONS 32
+#define FAILED_CONVERSION_EXPIRY (5 * CLOCK_FREQ)
+
+typedef struct
+{
+    char capability[32];
+    int cat;
+    bool allow_fmt_out_change;
+    union
+    {
+        audio_format_t audio;
+        video_format_t video;
+    } in, out;
+} conversion_t;
+
+static struct
+{
+    vlc_mutex_t lock;
+    unsigned next;
+    struct
+    {
+        conversion_t conv;
+        mtime_t date;
+    } entries[FAILED_CONVERSIONS];
+} failed_conversions = { VLC_STATIC_MUTEX, 0, { { .date = VLC_TS_INVALID } } };
+
+static bool ConversionInit( conversion_t *conv, const filter_chain_t *chain,
+                            const es_format_t *in, const es_format_t *out )
+{
+    /* Padding bytes are compared too */
+    memset( conv, 0, sizeof (*conv) );
+
+    if( strlen( chain->psz_capability ) >= sizeof (conv->capability)
+     || in->i_cat != out->i_cat )
+        return false;
+    strcpy( conv->capability, chain->psz_capability );
+    conv->cat = in->i_cat;
+    conv->allow_fmt_out_change = chain->b_allow_fmt_out_change;
+
+    switch( in->i_cat )
+    {
+        case AUDIO_ES:
+            conv->in.audio = in->audio;
+            conv->out.audio = out->audio;
+            break;
+        case VIDEO_ES:
+            if( in->video.p_palette != NULL || out->video.p_palette != NULL )
+                return false;
+            conv->in.video = in->video;
+            conv->out.video = out->video;
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+static bool ConversionFailed( const conversion_t *conv )
+{
+    const mtime_t now = mdate();
+    bool failed = false;
+
+    vlc_mutex_lock( &failed_conversions.lock );
+    for( unsigned i = 0; i < FAILED_CONVERSIONS && !failed; i++ )
+        failed = failed_conversions.entries[i].date != VLC_TS_INVALID
+            && failed_conversions.entries[i].date > now - FAILED_CONVERSION_EXPIRY
+            && !memcmp( &failed_conversions.entries[i].conv, conv, sizeof (*conv) );
+    vlc_mutex_unlock( &failed_conversions.lock );
+    return failed;
+}
+
+static void ConversionReportFailure( const conversion_t *conv )
+{
+    vlc_mutex_lock( &failed_conversions.lock );
+    unsigned i = failed_conversions.next;
+    failed_conversions.entries[i].conv = *conv;
+    failed_conversions.entries[i].date = mdate();
+    failed_conversions.next = (i + 1) % FAILED_CONVERSIONS;
+    vlc_mutex_unlock( &failed_conversions.lock );
+}
+
 #undef filter_chain_New
 /**
  * Filter chain initialisation
@@ -229,7 +319,10 @@ static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic
     for( ; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
+        mtime_t i_trace = vlc_trace_Begin();
         p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+        vlc_trace_End( i_trace, "filter", "video filter",
+                       module_get_object( p_filter->p_module ) );
         if( !p_pic )
             break;
         if( f->pending )
@@ -285,8 +378,11 @@ block_t *filter_chain_AudioFilter( filter_chain_t *p_chain, block_t *p_block )
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
+        mtime_t i_trace = vlc_trace_Begin();
 
         p_block = p_filter->pf_audio_filter( p_filter, p_block );
+        vlc_trace_End( i_trace, "filter", "audio filter",
+                       module_get_object( p_filter->p_module ) );
         if( !p_block )
             break;
     }
@@ -396,11 +492,26 @@ static filter_t *filter_chain_AppendFilterInternal( filter_chain_t *p_chain,
     p_filter->p_cfg = p_cfg;
     p_filter->b_allow_fmt_out_change = p_chain->b_allow_fmt_out_change;
 
+    conversion_t conv;
+    const bool automatic = psz_name == NULL && p_cfg == NULL
+                        && ConversionInit( &conv, p_chain, p_fmt_in, p_fmt_out );
+
+    if( automatic && ConversionFailed( &conv ) )
+    {
+        msg_Dbg( p_chain->p_this, "no %s for this conversion (cached)",
+                 p_chain->psz_capability );
+        goto error;
+    }
+
     p_filter->p_module = module_need( p_filter, p_chain->psz_capability,
                                       psz_name, psz_name != NULL );
 
     if( !p_filter->p_module )
+    {
+        if( automatic )
+            ConversionReportFailure( &conv );
         goto error;
+    }
 
     if( p_filter->b_allow_fmt_out_change )
     {
@@ -411,6 +522,9 @@ static filter_t *filter_chain_AppendFilterInternal( filter_chain_t *p_chain,
     if( AllocatorInit( &p_chain->allocator, p_chained ) )
         goto error;
 
+    if( p_filter->b_slices )
+        filter_SlicesHold( VLC_OBJECT(p_filter) );
+
     if( p_chain->last == NULL )
     {
         assert( p_chain->first == NULL );
@@ -521,6 +635,8 @@ static int filter_chain_DeleteFilterInternal( filter_chain_t *p_chain,
 
     if( p_filter->p_module )
         module_unneed( p_filter, p_filter->p_module );
+    if( p_filter->b_slices )
+        filter_SlicesRelease();
     free( p_chained->mouse );
     vlc_object_release( p_filter );
 
@@ -31,6 +31,7 @@
 #include <vlc_common.h>
 #include <vlc_fourcc.h>
 #include <vlc_es.h>
+#include <vlc_atomic.h>
 #include <assert.h>
 
 
@@ -800,6 +801,11 @@ static const staticentry_t p_list_video[] = {
         A("cyuv"),
         A("CYUV"),
 
+    B(VLC_CODEC_VAAPI_OPAQUE, "VA API video surface"),
+        A("VAOP"),
+    B(VLC_CODEC_D3D9_OPAQUE, "Direct3D9 video surface"),
+        A("DXA9"),
+
     B(VLC_CODEC_V210, "10-bit 4:2:2 Component YCbCr"),
         A("v210"),
 
@@ -1417,37 +1423,95 @@ static inline vlc_fourcc_t CreateFourcc( const char *psz_fourcc )
                        psz_fourcc[2], psz_fourcc[3] );
 }
 
-/* */
-static entry_t Lookup( const staticentry_t p_list[], vlc_fourcc_t i_fourcc )
+/* The lists are indexed by fourcc, in fourcc order, at the first lookup */
+typedef struct
 {
-    const char *p_class = NULL;
-    const char *psz_description = NULL;
+    vlc_fourcc_t i_fourcc;
+    uint16_t     i_entry; /* Index of the entry in the list */
+    uint16_t     i_class; /* Index of the entry beginning its class */
+} index_entry_t;
 
-    entry_t e = B(0, "");
+static index_entry_t p_index_video[ARRAY_SIZE(p_list_video)];
+static index_entry_t p_index_audio[ARRAY_SIZE(p_list_audio)];
+static index_entry_t p_index_spu[ARRAY_SIZE(p_list_spu)];
+static size_t i_index_video, i_index_audio, i_index_spu;
+
+static int IndexCmp( const void *a, const void *b )
+{
+    const index_entry_t *ea = a, *eb = b;
+
+    if( ea->i_fourcc != eb->i_fourcc )
+        return ea->i_fourcc < eb->i_fourcc ? -1 : 1;
+    /* Keep the list order for duplicates, the first one wins */
+    return (int)ea->i_entry - (int)eb->i_entry;
+}
+
+static size_t IndexBuild( const staticentry_t p_list[], index_entry_t *p_index )
+{
+    size_t i_count = 0;
+    uint16_t i_class = 0;
 
-    for( int i = 0; ; i++ )
+    for( uint16_t i = 0; CreateFourcc( p_list[i].p_fourcc ) != 0; i++ )
     {
-        const staticentry_t *p = &p_list[i];
-        const vlc_fourcc_t i_entry_fourcc = CreateFourcc( p->p_fourcc );
-        const vlc_fourcc_t i_entry_class = CreateFourcc( p->p_class );
+        if( CreateFourcc( p_list[i].p_class ) != 0 )
+            i_class = i;
+        p_index[i_count].i_fourcc = CreateFourcc( p_list[i].p_fourcc );
+        p_index[i_count].i_entry = i;
+        p_index[i_count].i_class = i_class;
+        i_count++;
+    }
+    qsort( p_index, i_count, sizeof( *p_index ), IndexCmp );
+
+    /* Only the first occurrence of each fourcc can be found */
+    size_t i_unique = 0;
+    for( size_t i = 0; i < i_count; i++ )
+        if( i_unique == 0 ||
+            p_index[i_unique - 1].i_fourcc != p_index[i].i_fourcc )
+            p_index[i_unique++] = p_index[i];
+    return i_unique;
+}
 
-        if( i_entry_fourcc == 0 )
-            break;
+static void IndexInit( void )
+{
+    static atomic_bool b_ready = ATOMIC_VAR_INIT( false );
+    static vlc_mutex_t lock = VLC_STATIC_MUTEX;
 
-        if( i_entry_class != 0 )
-        {
-            p_class = p->p_class;
-            psz_description = p->psz_description;
-        }
+    if( atomic_load_explicit( &b_ready, memory_order_acquire ) )
+        return;
 
-        if( i_entry_fourcc == i_fourcc )
-        {
-            assert( p_class != NULL );
+    vlc_mutex_lock( &lock );
+    if( !atomic_load_explicit( &b_ready, memory_order_relaxed ) )
+    {
+        i_index_video = IndexBuild( p_list_video, p_index_video );
+        i_index_audio = IndexBuild( p_list_audio, p_index_audio );
+        i_index_spu = IndexBuild( p_list_spu, p_index_spu );
+        atomic_store_explicit( &b_ready, true, memory_order_release );
+    }
+    vlc_mutex_unlock( &lock );
+}
+
+/* */
+static entry_t Lookup( const staticentry_t p_list[],
+                       const index_entry_t *p_index, size_t i_count,
+                       vlc_fourcc_t i_fourcc )
+{
+    entry_t e = B(0, "");
 
-            memcpy( e.p_class, p_class, 4 );
-            memcpy( e.p_fourcc, p->p_fourcc, 4 );
-            e.psz_description = p->psz_description ?
-                                p->psz_description : psz_description;
+    size_t i_low = 0, i_high = i_count;
+    while( i_low < i_high )
+    {
+        const size_t i_mid = (i_low + i_high) / 2;
+        const index_entry_t *p = &p_index[i_mid];
+
+        if( p->i_fourcc < i_fourcc )
+            i_low = i_mid + 1;
+        else if( p->i_fourcc > i_fourcc )
+            i_high = i_mid;
+        else
+        {
+            memcpy( e.p_class, p_list[p->i_class].p_class, 4 );
+            memcpy( e.p_fourcc, p_list[p->i_entry].p_fourcc, 4 );
+            e.psz_description = p_list[p->i_entry].psz_description;
             break;
         }
     }
@@ -1459,14 +1523,16 @@ static entry_t Find( int i_cat, vlc_fourcc_t i_fourcc )
 {
     entry_t e;
 
+    IndexInit();
+
     switch( i_cat )
     {
     case VIDEO_ES:
-        return Lookup( p_list_video, i_fourcc );
+        return Lookup( p_list_video, p_index_video, i_index_video, i_fourcc );
     case AUDIO_ES:
-        return Lookup( p_list_audio, i_fourcc );
+        return Lookup( p_list_audio, p_index_audio, i_index_audio, i_fourcc );
     case SPU_ES:
-        return Lookup( p_list_spu, i_fourcc );
+        return Lookup( p_list_spu, p_index_spu, i_index_spu, i_fourcc );
 
     default:
         e = Find( VIDEO_ES, i_fourcc );
@@ -1956,6 +2022,10 @@ static const struct
     { { VLC_CODEC_Y211, 0 },                   { 1, { {{1,4}, {1,1}} }, 4, 32 } },
     { { VLC_CODEC_XYZ12,  0 },                 PACKED_FMT(6, 48) },
 
+    /* The pixels are not in system memory */
+    { { VLC_CODEC_VAAPI_OPAQUE, VLC_CODEC_D3D9_OPAQUE, 0 },
+                                               { 0, {}, 0, 0 } },
+
     { {0}, { 0, {}, 0, 0 } }
 };
 
@@ -310,8 +310,8 @@ ml_ftree_t* ml_OpConnectChilds( ml_op_e op, ml_ftree_t* left,
 /**
  * @brief Attaches a special node to a tree
  * @param tree Tree to attach special node to
- * @param crit Criteria may be SORT_ASC, SORT_DESC, LIMIT or DISTINCT
- * @param limit Limit used if LIMIT criteria used
+ * @param crit Criteria may be SORT_ASC, SORT_DESC, LIMIT, OFFSET or DISTINCT
+ * @param limit Limit (or offset) used if LIMIT (or OFFSET) criteria used
  * @param Sort string used if SORT criteria is used
  * @return Pointer to new tree
  * @note Use the helpers
@@ -322,10 +322,10 @@ ml_ftree_t* ml_FtreeSpec( ml_ftree_t* tree,
                                           char* sort )
 {
     assert( crit == ML_SORT_ASC || crit == ML_LIMIT || crit == ML_SORT_DESC ||
-            crit == ML_DISTINCT );
+            crit == ML_DISTINCT || crit == ML_OFFSET );
     ml_ftree_t* right = ( ml_ftree_t* ) calloc( 1, sizeof( ml_ftree_t ) );
     right->criteria = crit;
-    if( crit == ML_LIMIT )
+    if( crit == ML_LIMIT || crit == ML_OFFSET )
         right->value.i = limit;
     else if( crit == ML_SORT_ASC || crit == ML_SORT_DESC )
         right->value.str = strdup( sort );
@@ -0,0 +1,161 @@
+/*****************************************************************************
+ * memstat.c: memory accounting
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_memstat.h>
+#include "../libvlc.h"
+
+/*
+ * Accounts are never deleted, so that an allocation can always be credited
+ * back to its account. Account 0 is charged by the threads that did not
+ * select any account, and by all threads once the table is full.
+ */
+typedef struct
+{
+    char                  name[VLC_MEM_ACCOUNT_NAME];
+    atomic_uint_least64_t live;
+    atomic_uint_least64_t peak;
+    atomic_uint_least64_t allocs;
+} mem_account_t;
+
+static mem_account_t mem_accounts[VLC_MEM_ACCOUNTS] = {
+    { .name = "other" },
+};
+static atomic_uint mem_count = ATOMIC_VAR_INIT(1);
+static vlc_mutex_t mem_lock = VLC_STATIC_MUTEX;
+
+static vlc_threadvar_t mem_key;
+static atomic_bool mem_ready = ATOMIC_VAR_INIT(false);
+
+static bool vlc_mem_Ready (void)
+{
+    if (likely(atomic_load_explicit (&mem_ready, memory_order_acquire)))
+        return true;
+
+    vlc_mutex_lock (&mem_lock);
+    if (!atomic_load_explicit (&mem_ready, memory_order_relaxed)
+     && vlc_threadvar_create (&mem_key, NULL) == 0)
+        atomic_store_explicit (&mem_ready, true, memory_order_release);
+    vlc_mutex_unlock (&mem_lock);
+    return atomic_load_explicit (&mem_ready, memory_order_relaxed);
+}
+
+static unsigned vlc_mem_Lookup (const char *name)
+{
+    unsigned count = atomic_load_explicit (&mem_count, memory_order_acquire);
+
+    for (unsigned i = 0; i < count; i++)
+        if (!strncmp (mem_accounts[i].name, name, VLC_MEM_ACCOUNT_NAME - 1))
+            return i;
+
+    vlc_mutex_lock (&mem_lock);
+    /* Another thread may have added it in the mean time */
+    for (unsigned i = count; i < atomic_load (&mem_count); i++)
+        if (!strncmp (mem_accounts[i].name, name, VLC_MEM_ACCOUNT_NAME - 1))
+        {
+            count = i;
+            goto out;
+        }
+
+    count = atomic_load (&mem_count);
+    if (count < VLC_MEM_ACCOUNTS)
+    {
+        strlcpy (mem_accounts[count].name, name, VLC_MEM_ACCOUNT_NAME);
+        atomic_store_explicit (&mem_count, count + 1, memory_order_release);
+    }
+    else
+        count = 0;
+out:
+    vlc_mutex_unlock (&mem_lock);
+    return count;
+}
+
+void vlc_mem_SetAccount (const char *name)
+{
+    if (!vlc_mem_Ready ())
+        return;
+
+    uintptr_t id = (name != NULL) ? vlc_mem_Lookup (name) : 0;
+    vlc_threadvar_set (mem_key, (void *)id);
+}
+
+/**
+ * Charges an allocation to the account of the calling thread.
+ * \return the account to pass to vlc_mem_Credit() on release
+ */
+unsigned vlc_mem_Charge (size_t size)
+{
+    uintptr_t id = 0;
+
+    if (likely(atomic_load_explicit (&mem_ready, memory_order_acquire)))
+    {
+        void *data = vlc_threadvar_get (mem_key);
+        id = (uintptr_t)data;
+    }
+
+    mem_account_t *acc = &mem_accounts[id];
+    uint_least64_t live = atomic_fetch_add_explicit (&acc->live, size,
+                                                     memory_order_relaxed)
+                        + size;
+    uint_least64_t peak = atomic_load_explicit (&acc->peak,
+                                                memory_order_relaxed);
+
+    while (live > peak
+        && !atomic_compare_exchange_weak (&acc->peak, &peak, live));
+    atomic_fetch_add_explicit (&acc->allocs, 1, memory_order_relaxed);
+    return id;
+}
+
+/**
+ * Credits a released allocation back to the account it was charged to.
+ */
+void vlc_mem_Credit (unsigned id, size_t size)
+{
+    assert (id < VLC_MEM_ACCOUNTS);
+    atomic_fetch_sub_explicit (&mem_accounts[id].live, size,
+                               memory_order_relaxed);
+}
+
+unsigned vlc_mem_GetStats (vlc_mem_stats_t *tab)
+{
+    unsigned count = atomic_load_explicit (&mem_count, memory_order_acquire);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        const mem_account_t *acc = &mem_accounts[i];
+
+        memcpy (tab[i].psz_name, acc->name, VLC_MEM_ACCOUNT_NAME);
+        tab[i].i_live = atomic_load_explicit (&acc->live,
+                                              memory_order_relaxed);
+        tab[i].i_peak = atomic_load_explicit (&acc->peak,
+                                              memory_order_relaxed);
+        tab[i].i_allocs = atomic_load_explicit (&acc->allocs,
+                                                memory_order_relaxed);
+    }
+    return count;
+}
@@ -43,6 +43,7 @@
 
 #include <vlc_common.h>
 #include <vlc_interface.h>
+#include <vlc_atomic.h>
 #ifdef WIN32
 #   include <vlc_network.h>          /* 'net_strerror' and 'WSAGetLastError' */
 #endif
@@ -72,6 +73,190 @@ static void Win32DebugOutputMsg (void *, int , const vlc_log_t *,
                                  const char *, va_list);
 #endif
 
+/*
+ * Asynchronous delivery.
+ *
+ * Emitting threads format their messages and store them into a ring without
+ * taking any lock: the slot is reserved by incrementing the write index, and
+ * published by storing the message pointer. A single thread delivers the
+ * messages in order to the callback.
+ */
+#define LOG_QUEUE_SIZE 1024
+
+/* Formatted message, with copies of the strings that may not outlive the
+ * emitting object or module */
+typedef struct
+{
+    int type;
+    vlc_log_t msg;
+    char text[];
+} vlc_log_entry_t;
+
+struct vlc_log_queue
+{
+    atomic_uintptr_t ring[LOG_QUEUE_SIZE]; /**< vlc_log_entry_t pointers */
+    atomic_uint write; /**< Next slot to reserve */
+    atomic_uint used; /**< Reserved and not yet delivered slots */
+    unsigned read; /**< Next slot to deliver (owned by the thread) */
+    atomic_uint dropped;
+    atomic_bool filter; /**< Apply the verbosity before queueing */
+    bool drop;
+    bool dead;
+
+    vlc_sem_t ready; /**< Posted once per published message */
+    vlc_mutex_t lock; /**< Only for waiting for room in the ring */
+    vlc_cond_t room;
+    atomic_uint waiters;
+    vlc_thread_t thread;
+};
+
+static vlc_log_entry_t *vlc_LogFormat (int type, const vlc_log_t *msg,
+                                       const char *format, va_list args)
+{
+    const char *header = (msg->psz_header != NULL) ? msg->psz_header : "";
+    size_t modlen = strlen (msg->psz_module) + 1;
+    size_t typelen = strlen (msg->psz_object_type) + 1;
+    size_t hdrlen = strlen (header) + 1;
+    va_list ap;
+
+    va_copy (ap, args);
+    int len = vsnprintf (NULL, 0, format, ap);
+    va_end (ap);
+    if (len < 0)
+        return NULL;
+
+    vlc_log_entry_t *e = malloc (sizeof (*e) + len + 1 + modlen + typelen
+                                 + hdrlen);
+    if (unlikely(e == NULL))
+        return NULL;
+
+    vsnprintf (e->text, len + 1, format, args);
+
+    char *p = e->text + len + 1;
+    e->type = type;
+    e->msg.i_object_id = msg->i_object_id;
+    e->msg.psz_module = memcpy (p, msg->psz_module, modlen);
+    p += modlen;
+    e->msg.psz_object_type = memcpy (p, msg->psz_object_type, typelen);
+    p += typelen;
+    e->msg.psz_header = (msg->psz_header != NULL)
+                      ? memcpy (p, header, hdrlen) : NULL;
+    return e;
+}
+
+static void vlc_LogQueue (libvlc_priv_t *priv, int type, const vlc_log_t *msg,
+                          const char *format, va_list args)
+{
+    struct vlc_log_queue *q = priv->log.queue;
+
+    if (atomic_load (&q->filter)
+     && (priv->i_verbose < 0 || priv->i_verbose < (type - VLC_MSG_ERR)))
+        return;
+
+    vlc_log_entry_t *e = vlc_LogFormat (type, msg, format, args);
+    if (unlikely(e == NULL))
+        return;
+
+    if (atomic_fetch_add (&q->used, 1) >= LOG_QUEUE_SIZE)
+    {   /* The ring is full */
+        if (q->drop)
+        {
+            atomic_fetch_sub (&q->used, 1);
+            atomic_fetch_add (&q->dropped, 1);
+            free (e);
+            return;
+        }
+
+        atomic_fetch_sub (&q->used, 1);
+        vlc_mutex_lock (&q->lock);
+        atomic_fetch_add (&q->waiters, 1);
+        mutex_cleanup_push (&q->lock);
+        while (atomic_fetch_add (&q->used, 1) >= LOG_QUEUE_SIZE)
+        {
+            atomic_fetch_sub (&q->used, 1);
+            vlc_cond_wait (&q->room, &q->lock);
+        }
+        vlc_cleanup_pop ();
+        atomic_fetch_sub (&q->waiters, 1);
+        vlc_mutex_unlock (&q->lock);
+    }
+
+    /* The slot is free: at most LOG_QUEUE_SIZE slots are in use */
+    unsigned idx = atomic_fetch_add (&q->write, 1) % LOG_QUEUE_SIZE;
+    atomic_store (&q->ring[idx], (uintptr_t)e);
+    vlc_sem_post (&q->ready);
+}
+
+static void vlc_LogDeliver (libvlc_priv_t *priv, int type,
+                            const vlc_log_t *msg, const char *format, ...)
+{
+    va_list ap;
+
+    va_start (ap, format);
+    vlc_rwlock_rdlock (&priv->log.lock);
+    priv->log.cb (priv->log.opaque, type, msg, format, ap);
+    vlc_rwlock_unlock (&priv->log.lock);
+    va_end (ap);
+}
+
+static void *vlc_LogThread (void *data)
+{
+    libvlc_priv_t *priv = data;
+    struct vlc_log_queue *q = priv->log.queue;
+    unsigned posted = 0;
+
+    for (;;)
+    {
+        vlc_sem_wait (&q->ready);
+        posted++;
+
+        int canc = vlc_savecancel ();
+        unsigned dropped = atomic_exchange (&q->dropped, 0);
+        if (dropped > 0)
+        {
+            const vlc_log_t msg = {
+                .i_object_id = 0, .psz_object_type = "generic",
+                .psz_module = "core", .psz_header = NULL,
+            };
+            vlc_LogDeliver (priv, VLC_MSG_WARN, &msg,
+                            "%u message(s) dropped", dropped);
+        }
+
+        while (posted > 0)
+        {
+            atomic_uintptr_t *slot = &q->ring[q->read % LOG_QUEUE_SIZE];
+            vlc_log_entry_t *e = (vlc_log_entry_t *)atomic_load (slot);
+
+            if (e == NULL)
+            {
+                if (atomic_load (&q->used) == 0)
+                {   /* Nothing in flight: termination request */
+                    assert (q->dead);
+                    vlc_restorecancel (canc);
+                    return NULL;
+                }
+                /* A later slot was published first: wait for this one */
+                break;
+            }
+            atomic_store (slot, (uintptr_t)NULL);
+            q->read++;
+            posted--;
+
+            vlc_LogDeliver (priv, e->type, &e->msg, "%s", e->text);
+            free (e);
+
+            atomic_fetch_sub (&q->used, 1);
+            if (atomic_load (&q->waiters) > 0)
+            {
+                vlc_mutex_lock (&q->lock);
+                vlc_cond_signal (&q->room);
+                vlc_mutex_unlock (&q->lock);
+            }
+        }
+        vlc_restorecancel (canc);
+    }
+}
+
 /**
  * Emit a log message. This function is the variable argument list equivalent
  * to vlc_Log().
@@ -168,9 +353,14 @@ void vlc_vaLog (vlc_object_t *obj, int type, const char *module,
     va_end (ap);
 #endif
 
-    vlc_rwlock_rdlock (&priv->log.lock);
-    priv->log.cb (priv->log.opaque, type, &msg, format, args);
-    vlc_rwlock_unlock (&priv->log.lock);
+    if (priv->log.queue != NULL)
+        vlc_LogQueue (priv, type, &msg, format, args);
+    else
+    {
+        vlc_rwlock_rdlock (&priv->log.lock);
+        priv->log.cb (priv->log.opaque, type, &msg, format, args);
+        vlc_rwlock_unlock (&priv->log.lock);
+    }
 
     uselocale (locale);
     freelocale (c);
@@ -286,6 +476,7 @@ static void Win32DebugOutputMsg (void* d, int type, const vlc_log_t *p_item,
 void vlc_LogSet (libvlc_int_t *vlc, vlc_log_cb cb, void *opaque)
 {
     libvlc_priv_t *priv = libvlc_priv (vlc);
+    const bool printer = cb == NULL;
 
     if (cb == NULL)
     {
@@ -297,6 +488,44 @@ void vlc_LogSet (libvlc_int_t *vlc, vlc_log_cb cb, void *opaque)
     priv->log.cb = cb;
     priv->log.opaque = opaque;
     vlc_rwlock_unlock (&priv->log.lock);
+
+    /* The console printers would discard the filtered messages anyway:
+     * do not format them in the emitting threads. */
+    if (priv->log.queue != NULL)
+        atomic_store (&priv->log.queue->filter, printer);
+}
+
+static struct vlc_log_queue *vlc_LogQueueNew (libvlc_priv_t *priv)
+{
+    struct vlc_log_queue *q = malloc (sizeof (*q));
+    if (unlikely(q == NULL))
+        return NULL;
+
+    for (unsigned i = 0; i < LOG_QUEUE_SIZE; i++)
+        atomic_init (&q->ring[i], (uintptr_t)NULL);
+    atomic_init (&q->write, 0);
+    atomic_init (&q->used, 0);
+    q->read = 0;
+    atomic_init (&q->dropped, 0);
+    atomic_init (&q->filter, false);
+    q->drop = var_InheritBool (&priv->public_data, "log-drop");
+    q->dead = false;
+    vlc_sem_init (&q->ready, 0);
+    vlc_mutex_init (&q->lock);
+    vlc_cond_init (&q->room);
+    atomic_init (&q->waiters, 0);
+
+    priv->log.queue = q;
+    if (vlc_clone (&q->thread, vlc_LogThread, priv, VLC_THREAD_PRIORITY_LOW))
+    {
+        priv->log.queue = NULL;
+        vlc_cond_destroy (&q->room);
+        vlc_mutex_destroy (&q->lock);
+        vlc_sem_destroy (&q->ready);
+        free (q);
+        return NULL;
+    }
+    return q;
 }
 
 void vlc_LogInit (libvlc_int_t *vlc)
@@ -304,12 +533,28 @@ void vlc_LogInit (libvlc_int_t *vlc)
     libvlc_priv_t *priv = libvlc_priv (vlc);
 
     vlc_rwlock_init (&priv->log.lock);
+    priv->log.queue = NULL;
+    if (var_InheritBool (vlc, "log-async"))
+        vlc_LogQueueNew (priv);
     vlc_LogSet (vlc, NULL, NULL);
 }
 
 void vlc_LogDeinit (libvlc_int_t *vlc)
 {
     libvlc_priv_t *priv = libvlc_priv (vlc);
-
+    struct vlc_log_queue *q = priv->log.queue;
+
+    if (q != NULL)
+    {   /* Flush the pending messages */
+        q->dead = true;
+        vlc_sem_post (&q->ready);
+        vlc_join (q->thread, NULL);
+        priv->log.queue = NULL;
+
+        vlc_cond_destroy (&q->room);
+        vlc_mutex_destroy (&q->lock);
+        vlc_sem_destroy (&q->ready);
+        free (q);
+    }
     vlc_rwlock_destroy (&priv->log.lock);
 }
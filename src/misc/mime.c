@@ -80,6 +80,8 @@ static const struct
     { ".wma",   "audio/x-ms-wma" },
     { ".wmv",   "video/x-ms-wmv" },
     { ".webm",  "video/webm" },
+    { ".ts",    "video/MP2T" },
+    { ".m3u8",  "application/vnd.apple.mpegurl" },
 
     /* end */
     { "",       "" }
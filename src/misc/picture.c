@@ -38,6 +38,17 @@
 #include <vlc_image.h>
 #include <vlc_block.h>
 #include <vlc_atomic.h>
+#include "../libvlc.h"
+
+/* Header of the heap allocated pixels, for the memory accounting */
+typedef struct
+{
+    size_t   size;
+    unsigned account;
+} picture_heap_t;
+
+/* The pixels follow the header, with their own alignment */
+#define PICTURE_HEAP_HEADER 16
 
 /**
  * Allocate a new picture in the heap.
@@ -71,13 +82,30 @@ static int AllocatePicture( picture_t *p_pic,
         i_bytes += p->i_pitch * p->i_lines;
     }
 
-    uint8_t *p_data = vlc_memalign( 16, i_bytes );
-    if( !p_data )
+    /* Opaque chromas have no pixels in system memory */
+    if( i_bytes == 0 )
+        return VLC_SUCCESS;
+
+    static_assert( sizeof(picture_heap_t) <= PICTURE_HEAP_HEADER,
+                   "picture heap header too big" );
+    if( i_bytes > SIZE_MAX - PICTURE_HEAP_HEADER )
+    {
+        p_pic->i_planes = 0;
+        return VLC_ENOMEM;
+    }
+    i_bytes += PICTURE_HEAP_HEADER;
+
+    picture_heap_t *p_heap = vlc_memalign( 16, i_bytes );
+    if( !p_heap )
     {
         p_pic->i_planes = 0;
         return VLC_EGENERIC;
     }
-    p_pic->gc.p_sys = (void *)p_data;
+    p_heap->size = i_bytes;
+    p_heap->account = vlc_mem_Charge( i_bytes );
+    p_pic->gc.p_sys = (void *)p_heap;
+
+    uint8_t *p_data = (uint8_t *)p_heap + PICTURE_HEAP_HEADER;
 
     /* Fill the p_pixels field for each plane */
     p_pic->p[0].p_pixels = p_data;
@@ -98,7 +126,12 @@ static void PictureDestroy( picture_t *p_picture )
     assert( p_picture &&
             vlc_atomic_get( &p_picture->gc.refcount ) == 0 );
 
-    vlc_free( p_picture->gc.p_sys );
+    picture_heap_t *p_heap = (picture_heap_t *)p_picture->gc.p_sys;
+    if( p_heap != NULL )
+    {
+        vlc_mem_Credit( p_heap->account, p_heap->size );
+        vlc_free( p_heap );
+    }
     free( p_picture->p_sys );
     free( p_picture );
 }
@@ -139,6 +172,7 @@ int picture_Setup( picture_t *p_picture, vlc_fourcc_t i_chroma,
     vlc_atomic_set( &p_picture->gc.refcount, 0 );
     p_picture->gc.pf_destroy = NULL;
     p_picture->gc.p_sys = NULL;
+    p_picture->context = NULL;
 
     p_picture->i_nb_fields = 2;
 
@@ -237,7 +271,7 @@ picture_t *picture_NewFromResource( const video_format_t *p_fmt, const picture_r
             free( p_picture );
             return NULL;
         }
-        assert( p_picture->gc.p_sys != NULL );
+        assert( p_picture->gc.p_sys != NULL || p_picture->i_planes == 0 );
     }
     /* */
     p_picture->format = fmt;
@@ -274,8 +308,15 @@ picture_t *picture_Hold( picture_t *p_picture )
 
 void picture_Release( picture_t *p_picture )
 {
-    if( vlc_atomic_dec( &p_picture->gc.refcount ) == 0 &&
-        p_picture->gc.pf_destroy )
+    if( vlc_atomic_dec( &p_picture->gc.refcount ) != 0 )
+        return;
+
+    if( p_picture->context )
+    {
+        p_picture->context->destroy( p_picture->context );
+        p_picture->context = NULL;
+    }
+    if( p_picture->gc.pf_destroy )
         p_picture->gc.pf_destroy( p_picture );
 }
 
@@ -346,6 +387,11 @@ void picture_Copy( picture_t *p_dst, const picture_t *p_src )
 {
     picture_CopyPixels( p_dst, p_src );
     picture_CopyProperties( p_dst, p_src );
+
+    if( p_dst->context )
+        p_dst->context->destroy( p_dst->context );
+    p_dst->context = p_src->context ? p_src->context->copy( p_src->context )
+                                    : NULL;
 }
 
 
@@ -47,6 +47,11 @@ struct picture_gc_sys_t {
     int  (*lock)(picture_t *);
     void (*unlock)(picture_t *);
 
+    /* Pool owning the picture, the master or the pool reserving it */
+    picture_pool_t *pool;
+    int            index;  /* in picture_pool_t::picture of pool */
+    bool           free;   /* in the free stack of pool */
+
     /* */
     int64_t tick;
 };
@@ -59,11 +64,21 @@ struct picture_pool_t {
     int            picture_count;
     picture_t      **picture;
     bool           *picture_reserved;
+
+    /* Stack of the indexes of the free pictures, so that picture_pool_Get
+     * does not scan the pool. It is locked as the pictures are released
+     * from any thread. */
+    vlc_mutex_t    lock;
+    int            *free;
+    int            free_count;
+    int            free_min; /* low-water mark */
+    int            used_max; /* high-water mark */
 };
 
 static void Destroy(picture_t *);
 static int  Lock(picture_t *);
 static void Unlock(picture_t *);
+static bool Reclaim(picture_t *);
 
 static picture_pool_t *Create(picture_pool_t *master, int picture_count)
 {
@@ -76,15 +91,62 @@ static picture_pool_t *Create(picture_pool_t *master, int picture_count)
     pool->picture_count = picture_count;
     pool->picture = calloc(pool->picture_count, sizeof(*pool->picture));
     pool->picture_reserved = calloc(pool->picture_count, sizeof(*pool->picture_reserved));
-    if (!pool->picture || !pool->picture_reserved) {
+    pool->free = calloc(pool->picture_count, sizeof(*pool->free));
+    if (!pool->picture || !pool->picture_reserved || !pool->free) {
         free(pool->picture);
         free(pool->picture_reserved);
+        free(pool->free);
         free(pool);
         return NULL;
     }
+    vlc_mutex_init(&pool->lock);
+    pool->free_count = 0;
+    pool->free_min   = picture_count;
+    pool->used_max   = 0;
     return pool;
 }
 
+/* Gives the picture to the pool as a free picture, the pool must be locked */
+static void Push(picture_pool_t *pool, picture_t *picture, int index)
+{
+    picture_gc_sys_t *gc_sys = picture->gc.p_sys;
+
+    gc_sys->pool  = pool;
+    gc_sys->index = index;
+    if (gc_sys->free)
+        return;
+    assert(pool->free_count < pool->picture_count);
+    gc_sys->free = true;
+    pool->free[pool->free_count++] = index;
+}
+
+/* Takes a free picture from the pool, the pool must be locked */
+static picture_t *Pop(picture_pool_t *pool)
+{
+    if (pool->free_count <= 0)
+        return NULL;
+
+    picture_t *picture = pool->picture[pool->free[--pool->free_count]];
+    picture->gc.p_sys->free = false;
+    return picture;
+}
+
+/* Removes a given picture from the free stack, the pool must be locked */
+static void Remove(picture_pool_t *pool, picture_t *picture)
+{
+    picture_gc_sys_t *gc_sys = picture->gc.p_sys;
+
+    if (!gc_sys->free)
+        return;
+    for (int i = 0; i < pool->free_count; i++) {
+        if (pool->free[i] == gc_sys->index) {
+            pool->free[i] = pool->free[--pool->free_count];
+            break;
+        }
+    }
+    gc_sys->free = false;
+}
+
 picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg)
 {
     picture_pool_t *pool = Create(NULL, cfg->picture_count);
@@ -105,6 +167,7 @@ picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg
         gc_sys->destroy_sys = picture->gc.p_sys;
         gc_sys->lock        = cfg->lock;
         gc_sys->unlock      = cfg->unlock;
+        gc_sys->free        = false;
         gc_sys->tick        = 0;
 
         /* */
@@ -116,6 +179,10 @@ picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg
         pool->picture[i] = picture;
         pool->picture_reserved[i] = false;
     }
+    /* The first pictures are given out first */
+    for (int i = cfg->picture_count - 1; i >= 0; i--)
+        Push(pool, pool->picture[i], i);
+    pool->free_min = pool->free_count;
     return pool;
 
 }
@@ -161,18 +228,30 @@ picture_pool_t *picture_pool_Reserve(picture_pool_t *master, int count)
     if (!pool)
         return NULL;
 
+    vlc_mutex_lock(&master->lock);
     int found = 0;
     for (int i = 0; i < master->picture_count && found < count; i++) {
         if (master->picture_reserved[i])
             continue;
 
-        assert(vlc_atomic_get(&master->picture[i]->gc.refcount) == 0);
+        picture_t *picture = master->picture[i];
+        assert(vlc_atomic_get(&picture->gc.refcount) == 0);
         master->picture_reserved[i] = true;
+        Remove(master, picture);
 
-        pool->picture[found]          = master->picture[i];
+        pool->picture[found]          = picture;
         pool->picture_reserved[found] = false;
         found++;
     }
+    vlc_mutex_unlock(&master->lock);
+
+    /* The first pictures are given out first */
+    vlc_mutex_lock(&pool->lock);
+    for (int i = found - 1; i >= 0; i--)
+        Push(pool, pool->picture[i], i);
+    pool->free_min = pool->free_count;
+    vlc_mutex_unlock(&pool->lock);
+
     if (found < count) {
         picture_pool_Delete(pool);
         return NULL;
@@ -182,12 +261,28 @@ picture_pool_t *picture_pool_Reserve(picture_pool_t *master, int count)
 
 void picture_pool_Delete(picture_pool_t *pool)
 {
+    picture_pool_t *master = pool->master;
+
+    if (master)
+        vlc_mutex_lock(&master->lock);
     for (int i = 0; i < pool->picture_count; i++) {
         picture_t *picture = pool->picture[i];
-        if (pool->master) {
-            for (int j = 0; j < pool->master->picture_count; j++) {
-                if (pool->master->picture[j] == picture)
-                    pool->master->picture_reserved[j] = false;
+        if (master) {
+            if (!picture)
+                continue;
+            picture_gc_sys_t *gc_sys = picture->gc.p_sys;
+
+            for (int j = 0; j < master->picture_count; j++) {
+                if (master->picture[j] != picture)
+                    continue;
+                master->picture_reserved[j] = false;
+
+                /* A picture still in use goes back when it is released */
+                gc_sys->pool  = master;
+                gc_sys->index = j;
+                gc_sys->free  = false;
+                if (vlc_atomic_get(&picture->gc.refcount) == 0)
+                    Push(master, picture, j);
             }
         } else {
             picture_gc_sys_t *gc_sys = picture->gc.p_sys;
@@ -205,6 +300,10 @@ void picture_pool_Delete(picture_pool_t *pool)
             free(gc_sys);
         }
     }
+    if (master)
+        vlc_mutex_unlock(&master->lock);
+    vlc_mutex_destroy(&pool->lock);
+    free(pool->free);
     free(pool->picture_reserved);
     free(pool->picture);
     free(pool);
@@ -212,59 +311,100 @@ void picture_pool_Delete(picture_pool_t *pool)
 
 picture_t *picture_pool_Get(picture_pool_t *pool)
 {
-    for (int i = 0; i < pool->picture_count; i++) {
-        if (pool->picture_reserved[i])
-            continue;
-
-        picture_t *picture = pool->picture[i];
-        if (vlc_atomic_get(&picture->gc.refcount) > 0)
-            continue;
+    picture_t *picture;
+    picture_t *locked = NULL; /* pictures that could not be locked */
+
+    for (;;) {
+        vlc_mutex_lock(&pool->lock);
+        picture = Pop(pool);
+        if (picture) {
+            if (pool->free_count < pool->free_min)
+                pool->free_min = pool->free_count;
+            const int used = pool->picture_count - pool->free_count;
+            if (used > pool->used_max)
+                pool->used_max = used;
+            picture->gc.p_sys->tick = pool->tick++;
+        }
+        vlc_mutex_unlock(&pool->lock);
 
-        if (Lock(picture))
-            continue;
+        if (!picture || !Lock(picture))
+            break;
+        picture->p_next = locked;
+        locked = picture;
+    }
 
-        /* */
-        picture->p_next = NULL;
-        picture->gc.p_sys->tick = pool->tick++;
-        picture_Hold(picture);
-        return picture;
+    /* The pictures skipped are still free */
+    if (locked) {
+        vlc_mutex_lock(&pool->lock);
+        while (locked) {
+            picture_t *next = locked->p_next;
+            Push(pool, locked, locked->gc.p_sys->index);
+            locked = next;
+        }
+        vlc_mutex_unlock(&pool->lock);
     }
-    return NULL;
+    if (!picture)
+        return NULL;
+
+    /* */
+    assert(vlc_atomic_get(&picture->gc.refcount) == 0);
+    picture->p_next = NULL;
+    picture_Hold(picture);
+    return picture;
 }
 
 void picture_pool_NonEmpty(picture_pool_t *pool, bool reset)
 {
     picture_t *old = NULL;
 
+    vlc_mutex_lock(&pool->lock);
     for (int i = 0; i < pool->picture_count; i++) {
         if (pool->picture_reserved[i])
             continue;
 
         picture_t *picture = pool->picture[i];
         if (reset) {
-            if (vlc_atomic_get(&picture->gc.refcount) > 0)
-                Unlock(picture);
-            vlc_atomic_set(&picture->gc.refcount, 0);
+            if (Reclaim(picture))
+                Push(pool, picture, i);
         } else if (vlc_atomic_get(&picture->gc.refcount) == 0) {
+            vlc_mutex_unlock(&pool->lock);
             return;
         } else if (!old || picture->gc.p_sys->tick < old->gc.p_sys->tick) {
             old = picture;
         }
     }
-    if (!reset && old) {
-        if (vlc_atomic_get(&old->gc.refcount) > 0)
-            Unlock(old);
-        vlc_atomic_set(&old->gc.refcount, 0);
-    }
+    if (!reset && old && Reclaim(old))
+        Push(pool, old, old->gc.p_sys->index);
+    vlc_mutex_unlock(&pool->lock);
 }
 int picture_pool_GetSize(picture_pool_t *pool)
 {
     return pool->picture_count;
 }
 
+void picture_pool_GetStats(picture_pool_t *pool, int *used, int *used_max,
+                           int *free_min)
+{
+    vlc_mutex_lock(&pool->lock);
+    if (used)
+        *used = pool->picture_count - pool->free_count;
+    if (used_max)
+        *used_max = pool->used_max;
+    if (free_min)
+        *free_min = pool->free_min;
+    vlc_mutex_unlock(&pool->lock);
+}
+
 static void Destroy(picture_t *picture)
 {
     Unlock(picture);
+
+    picture_gc_sys_t *gc_sys = picture->gc.p_sys;
+    picture_pool_t *pool = gc_sys->pool;
+
+    vlc_mutex_lock(&pool->lock);
+    Push(pool, picture, gc_sys->index);
+    vlc_mutex_unlock(&pool->lock);
 }
 
 static int Lock(picture_t *picture)
@@ -281,3 +421,19 @@ static void Unlock(picture_t *picture)
         gc_sys->unlock(picture);
 }
 
+/* Takes a picture back from its users without them releasing it,
+ * returns true if it was in use */
+static bool Reclaim(picture_t *picture)
+{
+    bool used = vlc_atomic_get(&picture->gc.refcount) > 0;
+    if (used) {
+        if (picture->context) {
+            picture->context->destroy(picture->context);
+            picture->context = NULL;
+        }
+        Unlock(picture);
+    }
+    vlc_atomic_set(&picture->gc.refcount, 0);
+    return used;
+}
+
@@ -0,0 +1,226 @@
+/*****************************************************************************
+ * trace.c: pipeline events tracing
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#if defined (__linux__)
+# include <sys/syscall.h>
+#elif defined (WIN32)
+# include <windows.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_fs.h>
+#include "../libvlc.h"
+
+/*
+ * The spans are buffered in memory, and written in the Chrome trace event
+ * format (as complete "X" events) whenever the buffer is full. The file can
+ * be loaded in chrome://tracing or in the Perfetto UI.
+ */
+
+#define TRACE_EVENTS 4096
+
+typedef struct
+{
+    const char   *cat;
+    const char   *name;
+    mtime_t       ts;
+    mtime_t       dur;
+    unsigned long tid;
+    char          arg[16];
+} trace_event_t;
+
+static struct
+{
+    vlc_mutex_t   lock;
+    FILE         *file;
+    libvlc_int_t *owner;
+    bool          first;
+    unsigned      count;
+    trace_event_t events[TRACE_EVENTS];
+} trace = { .lock = VLC_STATIC_MUTEX };
+
+static atomic_bool trace_enabled = ATOMIC_VAR_INIT(false);
+
+#if !defined (__linux__) && !defined (WIN32)
+static vlc_threadvar_t trace_tid;
+static bool trace_tid_created = false;
+static atomic_uint trace_tids = ATOMIC_VAR_INIT(0);
+#endif
+
+static unsigned long TraceThreadId (void)
+{
+#if defined (__linux__)
+    return syscall (SYS_gettid);
+#elif defined (WIN32)
+    return GetCurrentThreadId ();
+#else
+    /* Threads are numbered in the order of their first event */
+    uintptr_t id = (uintptr_t)vlc_threadvar_get (trace_tid);
+    if (id == 0)
+    {
+        id = atomic_fetch_add (&trace_tids, 1) + 1;
+        vlc_threadvar_set (trace_tid, (void *)id);
+    }
+    return id;
+#endif
+}
+
+static void TraceFlushLocked (void)
+{
+    const int pid = getpid ();
+
+    for (unsigned i = 0; i < trace.count; i++)
+    {
+        const trace_event_t *ev = &trace.events[i];
+
+        fprintf (trace.file, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                 "\"ts\":%"PRId64",\"dur\":%"PRId64",\"pid\":%d,\"tid\":%lu",
+                 trace.first ? "" : ",", ev->name, ev->cat, ev->ts, ev->dur,
+                 pid, ev->tid);
+        if (ev->arg[0])
+            fprintf (trace.file, ",\"args\":{\"object\":\"%s\"}", ev->arg);
+        fputc ('}', trace.file);
+        trace.first = false;
+    }
+    trace.count = 0;
+}
+
+/**
+ * Opens the trace file if the "trace-file" option is set.
+ * Only one instance of LibVLC can trace at a time.
+ */
+void vlc_trace_Init (libvlc_int_t *libvlc)
+{
+    char *path = var_InheritString (libvlc, "trace-file");
+    if (path == NULL)
+        return;
+
+    vlc_mutex_lock (&trace.lock);
+    if (trace.file == NULL)
+    {
+        trace.file = vlc_fopen (path, "wt");
+        if (trace.file != NULL)
+        {
+#if !defined (__linux__) && !defined (WIN32)
+            if (!trace_tid_created)
+            {
+                if (vlc_threadvar_create (&trace_tid, NULL))
+                {
+                    fclose (trace.file);
+                    trace.file = NULL;
+                    goto out;
+                }
+                trace_tid_created = true;
+            }
+#endif
+            fputs ("{\"traceEvents\":[", trace.file);
+            trace.owner = libvlc;
+            trace.first = true;
+            trace.count = 0;
+            atomic_store (&trace_enabled, true);
+            msg_Dbg (libvlc, "tracing pipeline events to %s", path);
+        }
+        else
+            msg_Err (libvlc, "cannot create trace file %s: %m", path);
+    }
+    else
+        msg_Warn (libvlc, "pipeline events already traced");
+#if !defined (__linux__) && !defined (WIN32)
+out:
+#endif
+    vlc_mutex_unlock (&trace.lock);
+    free (path);
+}
+
+/**
+ * Writes the remaining events and closes the trace file.
+ */
+void vlc_trace_Deinit (libvlc_int_t *libvlc)
+{
+    vlc_mutex_lock (&trace.lock);
+    if (trace.file != NULL && trace.owner == libvlc)
+    {
+        atomic_store (&trace_enabled, false);
+        TraceFlushLocked ();
+        fputs ("\n]}\n", trace.file);
+        fclose (trace.file);
+        trace.file = NULL;
+    }
+    vlc_mutex_unlock (&trace.lock);
+}
+
+/**
+ * Starts a span.
+ * \return the start date to pass to vlc_trace_End(), 0 if tracing is off
+ */
+mtime_t vlc_trace_Begin (void)
+{
+    if (!atomic_load_explicit (&trace_enabled, memory_order_relaxed))
+        return 0;
+    return mdate ();
+}
+
+/**
+ * Records a span started by vlc_trace_Begin().
+ * \param cat category of the span (a static string)
+ * \param name name of the span (a static string)
+ * \param arg object concerned by the span (copied), or NULL
+ */
+void vlc_trace_End (mtime_t begin, const char *cat, const char *name,
+                    const char *arg)
+{
+    if (begin == 0
+     || !atomic_load_explicit (&trace_enabled, memory_order_relaxed))
+        return;
+
+    const mtime_t now = mdate ();
+    const unsigned long tid = TraceThreadId ();
+
+    vlc_mutex_lock (&trace.lock);
+    if (trace.file != NULL)
+    {
+        trace_event_t *ev = &trace.events[trace.count++];
+
+        ev->cat = cat;
+        ev->name = name;
+        ev->ts = begin;
+        ev->dur = now - begin;
+        ev->tid = tid;
+        if (arg != NULL)
+            strlcpy (ev->arg, arg, sizeof (ev->arg));
+        else
+            ev->arg[0] = '\0';
+
+        if (trace.count == TRACE_EVENTS)
+            TraceFlushLocked ();
+    }
+    vlc_mutex_unlock (&trace.lock);
+}
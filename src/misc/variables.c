@@ -136,25 +136,52 @@ static void     CheckValue  ( variable_t *, vlc_value_t * );
 static int      TriggerCallback( vlc_object_t *, variable_t *, const char *,
                                  vlc_value_t );
 
+/* Lookup key, laid out as the beginning of variable_t */
+typedef struct
+{
+    const char *psz_name;
+    uint32_t    i_hash;
+} variable_key_t;
+
+/* FNV-1a */
+static uint32_t VarHash( const char *psz_name )
+{
+    uint32_t h = 2166136261u;
+
+    while( *psz_name )
+        h = (h ^ (unsigned char)*(psz_name++)) * 16777619u;
+    return h;
+}
+
+/* Variables are sorted by name hash first: most comparisons in the tree
+ * are then a single integer comparison, instead of a string comparison
+ * over the common prefix of the names ("video-", "sout-"...). */
 static int varcmp( const void *a, const void *b )
 {
-    const variable_t *va = a, *vb = b;
+    const variable_key_t *va = a, *vb = b;
 
-    /* psz_name must be first */
-    assert( va == (const void *)&va->psz_name );
+    if( va->i_hash != vb->i_hash )
+        return (va->i_hash < vb->i_hash) ? -1 : 1;
     return strcmp( va->psz_name, vb->psz_name );
 }
 
-static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
+static variable_t *LookupKey( vlc_object_t *obj, const variable_key_t *key )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
     variable_t **pp_var;
 
     vlc_assert_locked( &priv->var_lock );
-    pp_var = tfind( &psz_name, &priv->var_root, varcmp );
+    pp_var = tfind( key, &priv->var_root, varcmp );
     return (pp_var != NULL) ? *pp_var : NULL;
 }
 
+static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
+{
+    variable_key_t key = { psz_name, VarHash( psz_name ) };
+
+    return LookupKey( obj, &key );
+}
+
 static void Destroy( variable_t *p_var )
 {
     p_var->ops->pf_free( &p_var->val );
@@ -215,6 +242,7 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
         return VLC_ENOMEM;
 
     p_var->psz_name = strdup( psz_name );
+    p_var->i_hash = VarHash( psz_name );
     p_var->psz_text = NULL;
 
     p_var->i_type = i_type & ~VLC_VAR_DOINHERIT;
@@ -1208,10 +1236,29 @@ static void CheckValue ( variable_t *p_var, vlc_value_t *p_val )
 int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
                  vlc_value_t *p_val )
 {
+    /* The name is hashed once for the whole walk up the tree: most objects
+     * on the way do not hold the variable, and only cost a lookup. */
+    variable_key_t key = { psz_name, VarHash( psz_name ) };
+
     i_type &= VLC_VAR_CLASS;
     for( vlc_object_t *obj = p_this; obj != NULL; obj = obj->p_parent )
     {
-        if( var_GetChecked( obj, psz_name, i_type, p_val ) == VLC_SUCCESS )
+        vlc_object_internals_t *p_priv = vlc_internals( obj );
+        variable_t *p_var;
+
+        vlc_mutex_lock( &p_priv->var_lock );
+        p_var = LookupKey( obj, &key );
+        if( p_var != NULL )
+        {
+            assert( i_type == 0 ||
+                    (p_var->i_type & VLC_VAR_CLASS) == i_type );
+            assert( (p_var->i_type & VLC_VAR_CLASS) != VLC_VAR_VOID );
+            *p_val = p_var->val;
+            p_var->ops->pf_dup( p_val );
+        }
+        vlc_mutex_unlock( &p_priv->var_lock );
+
+        if( p_var != NULL )
             return VLC_SUCCESS;
     }
 
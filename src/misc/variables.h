@@ -73,6 +73,7 @@ typedef struct variable_ops_t
 struct variable_t
 {
     char *       psz_name; /**< The variable unique name (must be first) */
+    uint32_t     i_hash; /**< Hash of the name (must be second) */
 
     /** The variable's exported value */
     vlc_value_t  val;
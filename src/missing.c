@@ -50,6 +50,21 @@ void httpd_ClientModeStream (httpd_client_t *cl)
     assert (0);
 }
 
+void httpd_DirDelete (httpd_dir_t *dir)
+{
+    (void) dir;
+    assert (0);
+}
+
+httpd_dir_t *httpd_DirNew (httpd_host_t *host, const char *url,
+                           const char *path, const char *login,
+                           const char *password)
+{
+    (void) host; (void) url; (void) path;
+    (void) login; (void) password;
+    assert (0);
+}
+
 httpd_file_sys_t *httpd_FileDelete (httpd_file_t *file)
 {
     (void) file;
@@ -167,6 +182,12 @@ int httpd_StreamSend (httpd_stream_t *stream, uint8_t *data, int count)
     assert (0);
 }
 
+int httpd_StreamSendBlock (httpd_stream_t *stream, block_t *block)
+{
+    (void) stream; (void) block;
+    assert (0);
+}
+
 int httpd_UrlCatch (httpd_url_t *url, int request, httpd_callback_t cb,
                     httpd_callback_sys_t *data)
 {
@@ -47,12 +47,21 @@
 #include "config/configuration.h"
 #include "modules/modules.h"
 
+typedef struct
+{
+    const char *name;
+    module_t **list; /**< Sorted by decreasing score */
+    size_t count;
+} module_cap_t;
+
 static struct
 {
     vlc_mutex_t lock;
     module_t *head;
     unsigned usage;
-} modules = { VLC_STATIC_MUTEX, NULL, 0 };
+    module_cap_t *caps; /**< Capabilities index, sorted by name */
+    size_t capc;
+} modules = { VLC_STATIC_MUTEX, NULL, 0, NULL, 0 };
 
 /*****************************************************************************
  * Local prototypes
@@ -61,6 +70,8 @@ static struct
 static void AllocateAllPlugins (vlc_object_t *);
 #endif
 static module_t *module_InitStatic (vlc_plugin_cb);
+static void module_IndexCaps (void);
+static void module_UnindexCaps (void);
 
 static void module_StoreBank (module_t *module)
 {
@@ -145,6 +156,7 @@ void module_EndBank (bool b_plugins)
     if (--modules.usage == 0)
     {
         config_UnsortConfig ();
+        module_UnindexCaps ();
         head = modules.head;
         modules.head = NULL;
     }
@@ -187,6 +199,7 @@ size_t module_LoadPlugins (vlc_object_t *obj)
 #endif
         config_UnsortConfig ();
         config_SortConfig ();
+        module_IndexCaps ();
     }
     vlc_mutex_unlock (&modules.lock);
 
@@ -249,6 +262,91 @@ static int modulecmp (const void *a, const void *b)
     return (*mb)->i_score - (*ma)->i_score;
 }
 
+static int capcmp (const void *key, const void *elem)
+{
+    const module_cap_t *c = elem;
+
+    return strcmp (key, c->name);
+}
+
+/**
+ * Indexes the modules by capability, once the bank is complete.
+ * Each list keeps the order module_list_cap() would give by scanning.
+ */
+static void module_IndexCaps (void)
+{
+    size_t count;
+    module_t **list = module_list_get (&count);
+    module_cap_t *caps = NULL;
+    size_t capc = 0;
+
+    if (unlikely(list == NULL))
+        return;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const char *name = module_get_capability (list[i]);
+        size_t lo = 0, hi = capc;
+
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            int val = strcmp (name, caps[mid].name);
+
+            if (val == 0)
+                lo = hi = mid;
+            else if (val < 0)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+
+        if (lo == capc || strcmp (name, caps[lo].name))
+        {   /* New capability */
+            module_cap_t *nc = realloc (caps, (capc + 1) * sizeof (*caps));
+            if (unlikely(nc == NULL))
+                goto error;
+            caps = nc;
+            memmove (caps + lo + 1, caps + lo, (capc - lo) * sizeof (*caps));
+            caps[lo].name = name;
+            caps[lo].list = NULL;
+            caps[lo].count = 0;
+            capc++;
+        }
+
+        module_cap_t *c = caps + lo;
+        module_t **nl = realloc (c->list, (c->count + 1) * sizeof (*nl));
+        if (unlikely(nl == NULL))
+            goto error;
+        c->list = nl;
+        c->list[c->count++] = list[i];
+    }
+    module_list_free (list);
+
+    for (size_t i = 0; i < capc; i++)
+        qsort (caps[i].list, caps[i].count, sizeof (module_t *), modulecmp);
+
+    modules.caps = caps;
+    modules.capc = capc;
+    return;
+
+error:
+    /* Not fatal: module_list_cap() will scan the bank */
+    module_list_free (list);
+    modules.caps = caps;
+    modules.capc = capc;
+    module_UnindexCaps ();
+}
+
+static void module_UnindexCaps (void)
+{
+    for (size_t i = 0; i < modules.capc; i++)
+        free (modules.caps[i].list);
+    free (modules.caps);
+    modules.caps = NULL;
+    modules.capc = 0;
+}
+
 /**
  * Builds a sorted list of all VLC modules with a given capability.
  * The list is sorted from the highest module score to the lowest.
@@ -259,11 +357,26 @@ static int modulecmp (const void *a, const void *b)
  */
 ssize_t module_list_cap (module_t ***restrict list, const char *cap)
 {
-    /* TODO: This is quite inefficient. List should be sorted by capability. */
     ssize_t n = 0;
 
     assert (list != NULL);
 
+    if (modules.caps != NULL)
+    {   /* The bank is ready */
+        const module_cap_t *c = bsearch (cap, modules.caps, modules.capc,
+                                         sizeof (*c), capcmp);
+        if (c != NULL)
+            n = c->count;
+
+        module_t **tab = malloc (sizeof (*tab) * n);
+        *list = tab;
+        if (unlikely(tab == NULL))
+            return -1;
+        if (n > 0)
+            memcpy (tab, c->list, sizeof (*tab) * n);
+        return n;
+    }
+
     for (module_t *mod = modules.head; mod != NULL; mod = mod->next)
     {
          if (module_provides (mod, cap))
@@ -42,6 +42,7 @@
 #include "libvlc.h"
 
 #include <vlc_plugin.h>
+#include <vlc_block.h>
 #include <errno.h>
 
 #include "config/configuration.h"
@@ -78,8 +79,25 @@ void CacheDelete( vlc_object_t *obj, const char *dir )
     free( path );
 }
 
+/* The cache file is mapped in memory, and decoded in place */
+typedef struct
+{
+    const uint8_t *p;
+    size_t left;
+} cache_reader_t;
+
+static int CacheRead (cache_reader_t *in, void *buf, size_t len)
+{
+    if (in->left < len)
+        return -1;
+    memcpy (buf, in->p, len);
+    in->p += len;
+    in->left -= len;
+    return 0;
+}
+
 #define LOAD_IMMEDIATE(a) \
-    if (fread (&(a), sizeof (char), sizeof (a), file) != sizeof (a)) \
+    if (CacheRead (in, &(a), sizeof (a))) \
         goto error
 #define LOAD_FLAG(a) \
     do { \
@@ -90,13 +108,13 @@ void CacheDelete( vlc_object_t *obj, const char *dir )
         (a) = b; \
     } while (0)
 
-static int CacheLoadString (char **p, FILE *file)
+static int CacheLoadString (char **p, cache_reader_t *in)
 {
     char *psz = NULL;
     uint16_t size;
 
     LOAD_IMMEDIATE (size);
-    if (size > 16384)
+    if (size > 16384 || size > in->left)
     {
 error:
         return -1;
@@ -107,21 +125,19 @@ error:
         psz = malloc (size+1);
         if (unlikely(psz == NULL))
             goto error;
-        if (fread (psz, 1, size, file) != size)
-        {
-            free (psz);
-            goto error;
-        }
+        memcpy (psz, in->p, size);
         psz[size] = '\0';
+        in->p += size;
+        in->left -= size;
     }
     *p = psz;
     return 0;
 }
 
 #define LOAD_STRING(a) \
-    if (CacheLoadString (&(a), file)) goto error
+    if (CacheLoadString (&(a), in)) goto error
 
-static int CacheLoadConfig (module_config_t *cfg, FILE *file)
+static int CacheLoadConfig (module_config_t *cfg, cache_reader_t *in)
 {
     LOAD_IMMEDIATE (cfg->i_type);
     LOAD_IMMEDIATE (cfg->i_short);
@@ -184,7 +200,7 @@ error:
     return -1; /* FIXME: leaks */
 }
 
-static int CacheLoadModuleConfig (module_t *module, FILE *file)
+static int CacheLoadModuleConfig (module_t *module, cache_reader_t *in)
 {
     uint16_t lines;
 
@@ -209,7 +225,7 @@ static int CacheLoadModuleConfig (module_t *module, FILE *file)
 
     /* Do the duplication job */
     for (size_t i = 0; i < lines; i++)
-        if (CacheLoadConfig (module->p_config + i, file))
+        if (CacheLoadConfig (module->p_config + i, in))
             return -1;
     return 0;
 error:
@@ -217,6 +233,13 @@ error:
 }
 
 
+static int CacheCompare (const void *a, const void *b)
+{
+    const module_cache_t *ca = a, *cb = b;
+
+    return strcmp (ca->path, cb->path);
+}
+
 /**
  * Loads a plugins cache file.
  *
@@ -228,9 +251,8 @@ error:
 size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
 {
     char *psz_filename;
-    FILE *file;
-    int i_size, i_read;
-    char p_cachestring[sizeof(CACHE_STRING)];
+    block_t *block;
+    cache_reader_t reader, *in = &reader;
     size_t i_cache;
     int32_t i_marker;
 
@@ -242,8 +264,9 @@ size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
 
     msg_Dbg( p_this, "loading plugins cache file %s", psz_filename );
 
-    file = vlc_fopen( psz_filename, "rb" );
-    if( !file )
+    /* One mapping instead of one read per field */
+    block = block_FilePath( psz_filename );
+    if( block == NULL )
     {
         msg_Warn( p_this, "cannot read %s (%m)",
                   psz_filename );
@@ -251,58 +274,58 @@ size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
         return 0;
     }
     free( psz_filename );
+    reader.p = block->p_buffer;
+    reader.left = block->i_buffer;
 
     /* Check the file is a plugins cache */
-    i_size = sizeof(CACHE_STRING) - 1;
-    i_read = fread( p_cachestring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_cachestring, CACHE_STRING, i_size ) )
+    if( reader.left < sizeof(CACHE_STRING) - 1 ||
+        memcmp( reader.p, CACHE_STRING, sizeof(CACHE_STRING) - 1 ) )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
+        block_Release( block );
         return 0;
     }
+    reader.p += sizeof(CACHE_STRING) - 1;
+    reader.left -= sizeof(CACHE_STRING) - 1;
 
 #ifdef DISTRO_VERSION
     /* Check for distribution specific version */
-    char p_distrostring[sizeof( DISTRO_VERSION )];
-    i_size = sizeof( DISTRO_VERSION ) - 1;
-    i_read = fread( p_distrostring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_distrostring, DISTRO_VERSION, i_size ) )
+    if( reader.left < sizeof( DISTRO_VERSION ) - 1 ||
+        memcmp( reader.p, DISTRO_VERSION, sizeof( DISTRO_VERSION ) - 1 ) )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
+        block_Release( block );
         return 0;
     }
+    reader.p += sizeof( DISTRO_VERSION ) - 1;
+    reader.left -= sizeof( DISTRO_VERSION ) - 1;
 #endif
 
     /* Check Sub-version number */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) || i_marker != CACHE_SUBVERSION_NUM )
+    if( CacheRead( in, &i_marker, sizeof(i_marker) )
+     || i_marker != CACHE_SUBVERSION_NUM )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(corrupted header)" );
-        fclose( file );
+        block_Release( block );
         return 0;
     }
 
     /* Check header marker */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) ||
-        i_marker != ftell( file ) - (int)sizeof(i_marker) )
+    if( CacheRead( in, &i_marker, sizeof(i_marker) ) ||
+        i_marker != reader.p - block->p_buffer - (int)sizeof(i_marker) )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(corrupted header)" );
-        fclose( file );
+        block_Release( block );
         return 0;
     }
 
-    if (fread( &i_cache, 1, sizeof(i_cache), file ) != sizeof(i_cache) )
+    if( CacheRead( in, &i_cache, sizeof(i_cache) ) )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(file too short)" );
-        fclose( file );
+        block_Release( block );
         return 0;
     }
 
@@ -336,7 +359,7 @@ size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
         LOAD_IMMEDIATE(module->b_unloadable);
 
         /* Config stuff */
-        if (CacheLoadModuleConfig (module, file) != VLC_SUCCESS)
+        if (CacheLoadModuleConfig (module, in) != VLC_SUCCESS)
             goto error;
 
         LOAD_STRING(module->domain);
@@ -381,8 +404,10 @@ size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
         free (path);
         /* TODO: deal with errors */
     }
-    fclose( file );
+    block_Release( block );
 
+    /* Sort by path for CacheFind() */
+    qsort( cache, i_cache, sizeof (*cache), CacheCompare );
     *r = cache;
     return i_cache;
 
@@ -390,7 +415,7 @@ error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
 
     /* TODO: cleanup */
-    fclose( file );
+    block_Release( block );
     return 0;
 }
 
@@ -651,23 +676,21 @@ void CacheMerge( vlc_object_t *p_this, module_t *p_cache, module_t *p_module )
 
 /**
  * Looks up a plugin file in a table of cached plugins.
+ * The table must be sorted by path, as returned by CacheLoad().
  */
 module_t *CacheFind (module_cache_t *cache, size_t count,
                      const char *path, const struct stat *st)
 {
-    while (count > 0)
+    const module_cache_t key = { .path = (char *)path };
+
+    cache = bsearch (&key, cache, count, sizeof (*cache), CacheCompare);
+    if (cache != NULL
+     && cache->mtime == st->st_mtime
+     && cache->size == st->st_size)
     {
-        if (cache->path != NULL
-         && !strcmp (cache->path, path)
-         && cache->mtime == st->st_mtime
-         && cache->size == st->st_size)
-       {
-            module_t *module = cache->p_module;
-            cache->p_module = NULL;
-            return module;
-       }
-       cache++;
-       count--;
+        module_t *module = cache->p_module;
+        cache->p_module = NULL;
+        return module;
     }
 
     return NULL;
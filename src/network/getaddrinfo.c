@@ -35,7 +35,11 @@
 #include <assert.h>
 
 #include <sys/types.h>
+#ifdef HAVE_POLL
+# include <poll.h>
+#endif
 #include <vlc_network.h>
+#include "libvlc.h" /* vlc_clone_detach, vlc_object_waitpipe */
 
 #ifndef AF_UNSPEC
 #   define AF_UNSPEC   0
@@ -123,3 +127,257 @@ int vlc_getaddrinfo (const char *node, unsigned port,
 
     return getaddrinfo (node, servname, hints, res);
 }
+
+/*** Resolver cache ***/
+
+/* getaddrinfo() does not tell the DNS TTL: keep the results for a short
+ * while, enough for the successive connections of one playback */
+#define DNS_CACHE_MAX    32
+#define DNS_TTL          (30 * CLOCK_FREQ)
+#define DNS_NEGATIVE_TTL (5 * CLOCK_FREQ)
+
+typedef struct vlc_dns_entry vlc_dns_entry_t;
+struct vlc_dns_entry
+{
+    vlc_dns_entry_t *next;
+    char            *node;
+    unsigned         port;
+    struct addrinfo  hints; /* only flags, family, socktype and protocol */
+    struct addrinfo *res;
+    int              error;
+    bool             done;
+    mtime_t          expiry;
+    unsigned         refs;  /* resolver thread and users of res */
+};
+
+static vlc_mutex_t dns_lock = VLC_STATIC_MUTEX;
+static vlc_cond_t dns_wait = VLC_STATIC_COND;
+static vlc_dns_entry_t *dns_cache = NULL; /* most recent first */
+
+/* Removes the unused expired entries, and the oldest unused ones beyond
+ * DNS_CACHE_MAX. Must be called with dns_lock held. */
+static void vlc_dns_Purge (mtime_t now)
+{
+    unsigned count = 0;
+
+    for (vlc_dns_entry_t **pp = &dns_cache; *pp != NULL;)
+    {
+        vlc_dns_entry_t *e = *pp;
+
+        if (e->done && e->refs == 0
+         && (e->expiry <= now || count >= DNS_CACHE_MAX))
+        {
+            *pp = e->next;
+            if (e->res != NULL)
+                freeaddrinfo (e->res);
+            free (e->node);
+            free (e);
+            continue;
+        }
+        count++;
+        pp = &e->next;
+    }
+}
+
+/* Must be called with dns_lock held */
+static vlc_dns_entry_t *vlc_dns_Find (const char *node, unsigned port,
+                                      const struct addrinfo *hints,
+                                      mtime_t now)
+{
+    for (vlc_dns_entry_t *e = dns_cache; e != NULL; e = e->next)
+        if ((!e->done || e->expiry > now)
+         && e->port == port && !strcasecmp (e->node, node)
+         && e->hints.ai_flags == hints->ai_flags
+         && e->hints.ai_family == hints->ai_family
+         && e->hints.ai_socktype == hints->ai_socktype
+         && e->hints.ai_protocol == hints->ai_protocol)
+            return e;
+    return NULL;
+}
+
+static void *vlc_dns_Thread (void *data)
+{
+    vlc_dns_entry_t *e = data;
+    struct addrinfo *res;
+
+    int val = vlc_getaddrinfo (e->node, e->port, &e->hints, &res);
+    mtime_t now = mdate ();
+
+    vlc_mutex_lock (&dns_lock);
+    e->res = val ? NULL : res;
+    e->error = val;
+    e->done = true;
+    if (val == 0)
+        e->expiry = now + DNS_TTL;
+    else if (val == EAI_NONAME)
+        e->expiry = now + DNS_NEGATIVE_TTL;
+    else /* temporary failure: try again next time */
+        e->expiry = now;
+    e->refs--;
+    vlc_cond_broadcast (&dns_wait);
+    vlc_dns_Purge (now);
+    vlc_mutex_unlock (&dns_lock);
+    return NULL;
+}
+
+/* Returns the entry for the name with a reference, and starts its resolution
+ * if needed. Returns NULL if the name should not go through the cache. */
+static vlc_dns_entry_t *vlc_dns_Get (const char *node, unsigned port,
+                                     const struct addrinfo *hints)
+{
+    static const struct addrinfo nohints = { .ai_family = AF_UNSPEC };
+
+    if (hints == NULL)
+        hints = &nohints;
+    /* Nothing to gain for local and numeric addresses */
+    if (node == NULL || node[0] == '\0' || node[0] == '['
+     || (hints->ai_flags & (AI_PASSIVE|AI_NUMERICHOST)))
+        return NULL;
+
+    struct addrinfo numhints = *hints, *res;
+    numhints.ai_flags |= AI_NUMERICHOST;
+    if (vlc_getaddrinfo (node, port, &numhints, &res) == 0)
+    {
+        freeaddrinfo (res);
+        return NULL;
+    }
+
+    mtime_t now = mdate ();
+
+    vlc_mutex_lock (&dns_lock);
+    vlc_dns_entry_t *e = vlc_dns_Find (node, port, hints, now);
+    if (e != NULL)
+    {
+        e->refs++;
+        vlc_mutex_unlock (&dns_lock);
+        return e;
+    }
+
+    vlc_dns_Purge (now);
+    e = malloc (sizeof (*e));
+    if (unlikely(e == NULL))
+        goto error;
+    e->node = strdup (node);
+    if (unlikely(e->node == NULL))
+    {
+        free (e);
+        goto error;
+    }
+    e->port = port;
+    memset (&e->hints, 0, sizeof (e->hints));
+    e->hints.ai_flags = hints->ai_flags;
+    e->hints.ai_family = hints->ai_family;
+    e->hints.ai_socktype = hints->ai_socktype;
+    e->hints.ai_protocol = hints->ai_protocol;
+    e->res = NULL;
+    e->error = 0;
+    e->done = false;
+    e->expiry = 0;
+    e->refs = 2;
+
+    if (vlc_clone_detach (NULL, vlc_dns_Thread, e, VLC_THREAD_PRIORITY_LOW))
+    {
+        free (e->node);
+        free (e);
+        goto error;
+    }
+    e->next = dns_cache;
+    dns_cache = e;
+    vlc_mutex_unlock (&dns_lock);
+    return e;
+
+error:
+    vlc_mutex_unlock (&dns_lock);
+    return NULL;
+}
+
+static bool vlc_dns_Killed (vlc_object_t *obj)
+{
+    struct pollfd ufd = { .fd = vlc_object_waitpipe (obj), .events = POLLIN };
+
+    return ufd.fd != -1 && poll (&ufd, 1, 0) > 0;
+}
+
+static void vlc_dns_Release (void *data)
+{
+    vlc_dns_entry_t *e = data;
+
+    assert (e->refs > 0);
+    e->refs--;
+    vlc_mutex_unlock (&dns_lock);
+}
+
+/**
+ * Resolves a host name and service like vlc_getaddrinfo(), through a
+ * process-wide cache.
+ *
+ * The results of a name are kept for a short while, and concurrent
+ * resolutions of the same name are merged. The resolution runs in the
+ * background: this function is a cancellation point, and it returns
+ * EAI_SYSTEM with errno set to EINTR as soon as obj is killed.
+ *
+ * @note The results are shared: they must not be modified, and must be
+ * released with vlc_freeaddrinfo_cached() instead of freeaddrinfo().
+ */
+int vlc_getaddrinfo_cached (vlc_object_t *obj, const char *node,
+                            unsigned port, const struct addrinfo *hints,
+                            struct addrinfo **res)
+{
+    vlc_dns_entry_t *e = vlc_dns_Get (node, port, hints);
+    if (e == NULL)
+        return vlc_getaddrinfo (node, port, hints, res);
+
+    int val;
+
+    vlc_mutex_lock (&dns_lock);
+    vlc_cleanup_push (vlc_dns_Release, e);
+    while (!e->done && !vlc_dns_Killed (obj))
+        vlc_cond_timedwait (&dns_wait, &dns_lock,
+                            mdate () + CLOCK_FREQ / 20);
+    vlc_cleanup_pop ();
+
+    bool killed = !e->done;
+    val = killed ? EAI_SYSTEM : e->error;
+    if (val == 0)
+        *res = e->res; /* the reference is now held through res */
+    else
+        e->refs--;
+    vlc_mutex_unlock (&dns_lock);
+
+    if (killed)
+        errno = EINTR;
+    return val;
+}
+
+/**
+ * Releases results from vlc_getaddrinfo_cached().
+ */
+void vlc_freeaddrinfo_cached (struct addrinfo *res)
+{
+    vlc_mutex_lock (&dns_lock);
+    for (vlc_dns_entry_t *e = dns_cache; e != NULL; e = e->next)
+        if (e->res == res)
+        {
+            vlc_dns_Release (e); /* unlocks */
+            return;
+        }
+    vlc_mutex_unlock (&dns_lock);
+
+    /* Not from the cache */
+    freeaddrinfo (res);
+}
+
+/**
+ * Starts resolving a host name in the background, so that a later
+ * vlc_getaddrinfo_cached() call with the same parameters does not wait.
+ */
+void vlc_getaddrinfo_prefetch (const char *node, unsigned port,
+                               const struct addrinfo *hints)
+{
+    vlc_dns_entry_t *e = vlc_dns_Get (node, port, hints);
+    if (e == NULL)
+        return;
+
+    vlc_mutex_lock (&dns_lock);
+    vlc_dns_Release (e); /* unlocks */
+}
@@ -29,6 +29,7 @@
 
 #include <vlc_common.h>
 #include <vlc_httpd.h>
+#include <vlc_block.h>
 
 #include <assert.h>
 
@@ -39,23 +40,36 @@
 #include <vlc_charset.h>
 #include <vlc_url.h>
 #include <vlc_mime.h>
+#include <vlc_fs.h>
 #include "../libvlc.h"
 
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 
 #ifdef HAVE_UNISTD_H
 #   include <unistd.h>
 #endif
+#ifdef HAVE_SENDFILE
+# include <sys/sendfile.h>
+#endif
 
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_EPOLL_CREATE1
+# include <sys/epoll.h>
+/* Socket events handled per wake up of the host thread at most */
+# define HTTPD_MAX_EVENTS 64
+#endif
 
 #if defined( WIN32 )
 #   include <winsock2.h>
 #else
 #   include <sys/socket.h>
+#   include <sys/uio.h>
 #endif
 
 #if defined( WIN32 )
@@ -65,7 +79,11 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* Stream chunks handed to a client at once at most */
+#define HTTPD_CL_CHUNKS 16
+
 static void httpd_ClientClean( httpd_client_t *cl );
+static void httpd_HostRemoveClient( httpd_host_t *, httpd_client_t * );
 
 /* each host run in his own thread */
 struct httpd_host_t
@@ -94,6 +112,14 @@ struct httpd_host_t
     int            i_client;
     httpd_client_t **client;
 
+#ifdef HAVE_EPOLL_CREATE1
+    /* The sockets stay in the epoll set from one wake up to the next, the
+     * events are mapped back to the clients by socket */
+    int            epfd;
+    httpd_client_t **fd_client;
+    int            i_fd_client;
+#endif
+
     /* TLS data */
     vlc_tls_creds_t *p_tls;
 };
@@ -108,6 +134,7 @@ struct httpd_url_t
     char      *psz_url;
     char      *psz_user;
     char      *psz_password;
+    bool      b_prefix; /* matches all the URLs starting with psz_url */
 
     struct
     {
@@ -154,11 +181,23 @@ struct httpd_client_t
     mtime_t i_activity_date;
     mtime_t i_activity_timeout;
 
+#ifdef HAVE_EPOLL_CREATE1
+    uint32_t i_events; /* registered in the epoll set */
+#endif
+
     /* buffer for reading header */
     int     i_buffer_size;
     int     i_buffer;
     uint8_t *p_buffer;
 
+    /* stream data to send after p_buffer, shared with the other clients */
+    block_t *p_chain;
+
+    /* local file to send after p_buffer, from i_file_pos to i_file_end */
+    int     i_file_fd;
+    off_t   i_file_pos;
+    off_t   i_file_end;
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
@@ -186,15 +225,15 @@ static const http_status_info http_reason[] =
     { 202, "Accepted" },
     { 203, "Non-authoritative information" },
     { 204, "No content" },
-    { 205, "Reset content" },
+    { 205, "Reset content" },*/
     { 206, "Partial content" },
-    { 250, "Low on storage space" },
+  /*{ 250, "Low on storage space" },
     { 300, "Multiple choices" },*/
     { 301, "Moved permanently" },
   /*{ 302, "Moved temporarily" },
-    { 303, "See other" },
+    { 303, "See other" },*/
     { 304, "Not modified" },
-    { 305, "Use proxy" },
+  /*{ 305, "Use proxy" },
     { 307, "Temporary redirect" },
     { 400, "Bad request" },*/
     { 401, "Unauthorized" },
@@ -211,9 +250,9 @@ static const http_status_info http_reason[] =
     { 412, "Precondition failed" },
     { 413, "Request entity too large" },
     { 414, "Request-URI too large" },
-    { 415, "Unsupported media Type" },
+    { 415, "Unsupported media Type" },*/
     { 416, "Requested range not satisfiable" },
-    { 417, "Expectation failed" },
+  /*{ 417, "Expectation failed" },
     { 451, "Parameter not understood" },
     { 452, "Conference not found" },
     { 453, "Not enough bandwidth" },*/
@@ -413,6 +452,262 @@ httpd_file_sys_t *httpd_FileDelete( httpd_file_t *file )
     return p_sys;
 }
 
+/*****************************************************************************
+ * High Level Functions: httpd_dir_t
+ *****************************************************************************/
+struct httpd_dir_t
+{
+    httpd_url_t *url;
+
+    char   *psz_path;   /* local directory */
+    size_t i_url;       /* length of the URL prefix */
+};
+
+/* Formats a date as in HTTP headers, independently of the locale */
+static void httpd_FormatDate( char psz_date[40], time_t t )
+{
+    static const char day[7][4] = {
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char mon[12][4] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    struct tm tm;
+
+    gmtime_r( &t, &tm );
+    snprintf( psz_date, 40, "%s, %02d %s %04d %02d:%02d:%02d GMT",
+              day[tm.tm_wday], tm.tm_mday, mon[tm.tm_mon], 1900 + tm.tm_year,
+              tm.tm_hour, tm.tm_min, tm.tm_sec );
+}
+
+/* Only the files of the directory tree are served, neither the hidden
+ * ones nor the ones out of the tree */
+static bool httpd_DirValidName( const char *psz_name )
+{
+    if( *psz_name == '\0' )
+        return false;
+    for( const char *p = psz_name; *p; p++ )
+    {
+        if( *p == '\\' || ( *p == '.' && ( p == psz_name || p[-1] == '/' ) )
+         || ( *p == '/' && ( p == psz_name || p[-1] == '/' || !p[1] ) ) )
+            return false;
+    }
+    return true;
+}
+
+/* Parses a single byte range of a file of a given size.
+ * Returns 1 for a valid range, 0 if the whole file should be sent, and -1
+ * if the range cannot be satisfied. Several ranges are answered with the
+ * whole file. */
+static int httpd_ParseRange( const char *psz_range, uint64_t i_size,
+                             uint64_t *pi_start, uint64_t *pi_end )
+{
+    char *end;
+
+    if( strncasecmp( psz_range, "bytes=", 6 ) || strchr( psz_range, ',' ) )
+        return 0;
+    psz_range += 6;
+
+    if( *psz_range == '-' )
+    {
+        /* last bytes */
+        uint64_t i_suffix = strtoull( psz_range + 1, &end, 10 );
+
+        if( end == psz_range + 1 || *end )
+            return 0;
+        if( i_suffix == 0 || i_size == 0 )
+            return -1;
+        *pi_start = i_size > i_suffix ? i_size - i_suffix : 0;
+        *pi_end = i_size - 1;
+        return 1;
+    }
+
+    if( *psz_range < '0' || *psz_range > '9' )
+        return 0;
+    *pi_start = strtoull( psz_range, &end, 10 );
+    if( *end != '-' )
+        return 0;
+    psz_range = end + 1;
+    if( *psz_range == '\0' )
+        *pi_end = i_size - 1;
+    else
+    {
+        if( *psz_range < '0' || *psz_range > '9' )
+            return 0;
+        *pi_end = strtoull( psz_range, &end, 10 );
+        if( *end || *pi_end < *pi_start )
+            return 0;
+        if( *pi_end >= i_size )
+            *pi_end = i_size - 1;
+    }
+    if( *pi_start >= i_size )
+        return -1;
+    return 1;
+}
+
+static int httpd_DirCallBack( httpd_callback_sys_t *p_sys, httpd_client_t *cl,
+                              httpd_message_t *answer,
+                              const httpd_message_t *query )
+{
+    httpd_dir_t *dir = (httpd_dir_t *)p_sys;
+    char *psz_name, *psz_file;
+
+    if( answer == NULL || query == NULL || cl == NULL )
+    {
+        return VLC_SUCCESS;
+    }
+
+    /* The file is not found if it cannot be served: another URL may
+     * answer instead, or the host will answer 404 */
+    psz_name = decode_URI_duplicate( query->psz_url + dir->i_url );
+    if( psz_name == NULL || !httpd_DirValidName( psz_name )
+     || asprintf( &psz_file, "%s"DIR_SEP"%s", dir->psz_path, psz_name ) == -1 )
+    {
+        free( psz_name );
+        return VLC_EGENERIC;
+    }
+
+    int fd = vlc_open( psz_file, O_RDONLY );
+    free( psz_file );
+
+    struct stat st;
+    if( fd == -1 || fstat( fd, &st ) || !S_ISREG( st.st_mode ) )
+    {
+        if( fd != -1 )
+            close( fd );
+        free( psz_name );
+        return VLC_EGENERIC;
+    }
+
+    uint64_t i_size = st.st_size, i_start = 0, i_end = i_size - 1;
+    char psz_date[40], psz_etag[40];
+
+    httpd_FormatDate( psz_date, st.st_mtime );
+    snprintf( psz_etag, sizeof( psz_etag ), "\"%"PRIx64"-%"PRIx64"\"",
+              (uint64_t)st.st_mtime, i_size );
+
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 1;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+    answer->i_status = 200;
+
+    /* Conditional requests: dates are compared as strings as they can only
+     * come from a previous answer */
+    const char *psz_match = httpd_MsgGet( query, "If-None-Match" );
+    const char *psz_since = httpd_MsgGet( query, "If-Modified-Since" );
+    if( psz_match != NULL )
+    {
+        if( !strcmp( psz_match, "*" ) || strstr( psz_match, psz_etag ) )
+            answer->i_status = 304;
+    }
+    else if( psz_since != NULL && !strcmp( psz_since, psz_date ) )
+        answer->i_status = 304;
+
+    /* Range requests, only for the current version of the file */
+    const char *psz_range = httpd_MsgGet( query, "Range" );
+    const char *psz_if_range = httpd_MsgGet( query, "If-Range" );
+    if( answer->i_status == 200 && psz_range != NULL
+     && ( psz_if_range == NULL || !strcmp( psz_if_range, psz_etag )
+       || !strcmp( psz_if_range, psz_date ) ) )
+    {
+        switch( httpd_ParseRange( psz_range, i_size, &i_start, &i_end ) )
+        {
+            case 1:
+                answer->i_status = 206;
+                httpd_MsgAdd( answer, "Content-Range",
+                              "bytes %"PRIu64"-%"PRIu64"/%"PRIu64,
+                              i_start, i_end, i_size );
+                break;
+            case -1:
+                answer->i_status = 416;
+                httpd_MsgAdd( answer, "Content-Range", "bytes */%"PRIu64,
+                              i_size );
+                break;
+        }
+    }
+
+    if( answer->i_status == 200 || answer->i_status == 206 )
+        httpd_MsgAdd( answer, "Content-type", "%s",
+                      vlc_mime_Ext2Mime( psz_name ) );
+    free( psz_name );
+    httpd_MsgAdd( answer, "Cache-Control", "%s", "no-cache" );
+    httpd_MsgAdd( answer, "Last-Modified", "%s", psz_date );
+    httpd_MsgAdd( answer, "ETag", "%s", psz_etag );
+    httpd_MsgAdd( answer, "Accept-Ranges", "%s", "bytes" );
+
+    /* We respect client request */
+    const char *psz_connection = httpd_MsgGet( &cl->query, "Connection" );
+    if( psz_connection != NULL )
+        httpd_MsgAdd( answer, "Connection", "%s", psz_connection );
+
+    if( answer->i_status != 200 && answer->i_status != 206 )
+    {
+        httpd_MsgAdd( answer, "Content-Length", "%d", 0 );
+        close( fd );
+        return VLC_SUCCESS;
+    }
+    httpd_MsgAdd( answer, "Content-Length", "%"PRIu64,
+                  i_size ? i_end - i_start + 1 : 0 );
+
+    /* The file is sent after the answer by httpd_ClientSend */
+    if( query->i_type != HTTPD_MSG_HEAD && i_size > 0
+     && lseek( fd, i_start, SEEK_SET ) != -1 )
+    {
+        assert( cl->i_file_fd == -1 );
+        cl->i_file_fd  = fd;
+        cl->i_file_pos = i_start;
+        cl->i_file_end = i_end + 1;
+    }
+    else
+        close( fd );
+
+    return VLC_SUCCESS;
+}
+
+httpd_dir_t *httpd_DirNew( httpd_host_t *host, const char *psz_url,
+                           const char *psz_path, const char *psz_user,
+                           const char *psz_password )
+{
+    httpd_dir_t *dir = xmalloc( sizeof( httpd_dir_t ) );
+    char *psz_prefix;
+
+    /* The URL prefix always ends with a slash */
+    if( asprintf( &psz_prefix, "%s%s", psz_url,
+                  psz_url[0] && psz_url[strlen( psz_url ) - 1] == '/'
+                  ? "" : "/" ) == -1 )
+    {
+        free( dir );
+        return NULL;
+    }
+
+    dir->url = httpd_UrlNew( host, psz_prefix, psz_user, psz_password );
+    dir->i_url = strlen( psz_prefix );
+    free( psz_prefix );
+    if( dir->url == NULL )
+    {
+        free( dir );
+        return NULL;
+    }
+    dir->psz_path = strdup( psz_path );
+
+    vlc_mutex_lock( &host->lock );
+    dir->url->b_prefix = true;
+    vlc_mutex_unlock( &host->lock );
+
+    httpd_UrlCatch( dir->url, HTTPD_MSG_HEAD, httpd_DirCallBack,
+                    (httpd_callback_sys_t*)dir );
+    httpd_UrlCatch( dir->url, HTTPD_MSG_GET,  httpd_DirCallBack,
+                    (httpd_callback_sys_t*)dir );
+
+    return dir;
+}
+
+void httpd_DirDelete( httpd_dir_t *dir )
+{
+    httpd_UrlDelete( dir->url );
+    free( dir->psz_path );
+    free( dir );
+}
+
 /*****************************************************************************
  * High Level Functions: httpd_handler_t (for CGIs)
  *****************************************************************************/
@@ -615,6 +910,12 @@ void httpd_RedirectDelete( httpd_redirect_t *rdir )
 /*****************************************************************************
  * High Level Funtions: httpd_stream_t
  *****************************************************************************/
+typedef struct
+{
+    block_t *p_block;   /* shared payload */
+    int64_t i_pos;      /* absolute position of its first byte */
+} httpd_stream_chunk_t;
+
 struct httpd_stream_t
 {
     vlc_mutex_t lock;
@@ -626,13 +927,37 @@ struct httpd_stream_t
     uint8_t *p_header;
     int     i_header;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* circular buffer of the last chunks sent, the clients reference them
+     * instead of copying their data */
+    int         i_buffer_size;      /* maximum size of the chunks */
+    int         i_buffer;           /* size of the chunks */
+    httpd_stream_chunk_t *p_chunk;
+    int         i_chunk_max;
+    int         i_chunk_first;
+    int         i_chunk;
     int64_t     i_buffer_pos;       /* absolute position from begining */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 };
 
+/* Returns the index in the circular buffer of the last chunk that starts
+ * at or before i_pos, the stream lock must be held */
+static int httpd_StreamFindChunk( const httpd_stream_t *stream, int64_t i_pos )
+{
+    int i_low = 0, i_high = stream->i_chunk - 1;
+
+    while( i_low < i_high )
+    {
+        int i_mid = ( i_low + i_high + 1 ) / 2;
+        int i_idx = ( stream->i_chunk_first + i_mid ) % stream->i_chunk_max;
+
+        if( stream->p_chunk[i_idx].i_pos <= i_pos )
+            i_low = i_mid;
+        else
+            i_high = i_mid - 1;
+    }
+    return ( stream->i_chunk_first + i_low ) % stream->i_chunk_max;
+}
+
 static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query )
@@ -646,52 +971,61 @@ static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
 
     if( answer->i_body_offset > 0 )
     {
-        int64_t i_write;
-        int     i_pos;
-
-#if 0
-        fprintf( stderr, "httpd_StreamCallBack i_body_offset=%lld\n",
-                 answer->i_body_offset );
-#endif
+        block_t *p_chain = NULL, **pp_last = &p_chain;
+        int64_t i_write = 0;
 
+        vlc_mutex_lock( &stream->lock );
         if( answer->i_body_offset >= stream->i_buffer_pos )
         {
-            /* fprintf( stderr, "httpd_StreamCallBack: no data\n" ); */
+            vlc_mutex_unlock( &stream->lock );
             return VLC_EGENERIC;    /* wait, no data available */
         }
-        if( answer->i_body_offset + stream->i_buffer_size <
-            stream->i_buffer_pos )
+        if( answer->i_body_offset <
+            stream->p_chunk[stream->i_chunk_first].i_pos )
         {
             /* this client isn't fast enough */
-#if 0
-            fprintf( stderr, "fixing i_body_offset (old=%lld new=%lld)\n",
-                     answer->i_body_offset, stream->i_buffer_last_pos );
-#endif
             answer->i_body_offset = stream->i_buffer_last_pos;
         }
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        i_write = stream->i_buffer_pos - answer->i_body_offset;
-        if( i_write > HTTPD_CL_BUFSIZE )
+        /* Reference the chunks from the client position on, the first one
+         * may have been partially sent already */
+        int i_first = httpd_StreamFindChunk( stream, answer->i_body_offset );
+        int i_last = ( stream->i_chunk_first + stream->i_chunk )
+                     % stream->i_chunk_max;
+        for( int i = i_first, n = 0; n < HTTPD_CL_CHUNKS && i_write <
+             HTTPD_CL_BUFSIZE; i = ( i + 1 ) % stream->i_chunk_max, n++ )
         {
-            i_write = HTTPD_CL_BUFSIZE;
-        }
-        else if( i_write <= 0 )
-        {
-            return VLC_EGENERIC;    /* wait, no data available */
+            const httpd_stream_chunk_t *chunk = &stream->p_chunk[i];
+            block_t *p_block = block_Share( chunk->p_block );
+
+            if( unlikely(p_block == NULL) )
+                break;
+            if( i == i_first )
+            {
+                size_t i_skip = answer->i_body_offset - chunk->i_pos;
+
+                p_block->p_buffer += i_skip;
+                p_block->i_buffer -= i_skip;
+            }
+            i_write += p_block->i_buffer;
+            block_ChainLastAppend( &pp_last, p_block );
+
+            if( ( i + 1 ) % stream->i_chunk_max == i_last )
+                break;
         }
+        vlc_mutex_unlock( &stream->lock );
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN( i_write, stream->i_buffer_size - i_pos );
+        if( p_chain == NULL )
+            return VLC_EGENERIC;
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc( i_write );
-        memcpy( answer->p_body, &stream->p_buffer[i_pos], i_write );
+        /* The chunks are sent as is instead of the body */
+        assert( cl->p_chain == NULL );
+        cl->p_chain = p_chain;
 
         answer->i_body_offset += i_write;
 
@@ -786,7 +1120,12 @@ httpd_stream_t *httpd_StreamNew( httpd_host_t *host,
     stream->i_header = 0;
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc( stream->i_buffer_size );
+    stream->i_buffer = 0;
+    stream->i_chunk_max = 256;
+    stream->p_chunk = xmalloc( stream->i_chunk_max *
+                               sizeof( *stream->p_chunk ) );
+    stream->i_chunk_first = 0;
+    stream->i_chunk = 0;
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
@@ -819,49 +1158,91 @@ int httpd_StreamHeader( httpd_stream_t *stream, uint8_t *p_data, int i_data )
     return VLC_SUCCESS;
 }
 
-int httpd_StreamSend( httpd_stream_t *stream, uint8_t *p_data, int i_data )
+int httpd_StreamSendBlock( httpd_stream_t *stream, block_t *p_block )
 {
-    int i_count;
-    int i_pos;
-
-    if( i_data < 0 || p_data == NULL )
+    if( p_block->i_buffer == 0 )
     {
+        block_Release( p_block );
         return VLC_SUCCESS;
     }
+    p_block->p_next = NULL;
+    /* The clients get references to the payload */
+    p_block = block_MakeShared( p_block );
+
     vlc_mutex_lock( &stream->lock );
 
     /* save this pointer (to be used by new connection) */
     stream->i_buffer_last_pos = stream->i_buffer_pos;
 
-    i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    i_count = i_data;
-    while( i_count > 0)
+    /* Drop the oldest chunks, the clients still sending them keep their
+     * own references */
+    while( stream->i_chunk > 0 &&
+           stream->i_buffer + p_block->i_buffer > (size_t)stream->i_buffer_size )
     {
-        int i_copy;
-
-        i_copy = __MIN( i_count, stream->i_buffer_size - i_pos );
+        httpd_stream_chunk_t *chunk = &stream->p_chunk[stream->i_chunk_first];
 
-        /* Ok, we can't go past the end of our buffer */
-        memcpy( &stream->p_buffer[i_pos], p_data, i_copy );
+        stream->i_buffer -= chunk->p_block->i_buffer;
+        block_Release( chunk->p_block );
+        stream->i_chunk_first = ( stream->i_chunk_first + 1 )
+                                % stream->i_chunk_max;
+        stream->i_chunk--;
+    }
 
-        i_pos = ( i_pos + i_copy ) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+    if( stream->i_chunk == stream->i_chunk_max )
+    {
+        httpd_stream_chunk_t *p_chunk =
+            xmalloc( 2 * stream->i_chunk_max * sizeof( *p_chunk ) );
+
+        for( int i = 0; i < stream->i_chunk; i++ )
+            p_chunk[i] = stream->p_chunk[( stream->i_chunk_first + i )
+                                         % stream->i_chunk_max];
+        free( stream->p_chunk );
+        stream->p_chunk = p_chunk;
+        stream->i_chunk_max *= 2;
+        stream->i_chunk_first = 0;
     }
 
-    stream->i_buffer_pos += i_data;
+    httpd_stream_chunk_t *chunk =
+        &stream->p_chunk[( stream->i_chunk_first + stream->i_chunk )
+                         % stream->i_chunk_max];
+    chunk->p_block = p_block;
+    chunk->i_pos = stream->i_buffer_pos;
+    stream->i_chunk++;
+    stream->i_buffer += p_block->i_buffer;
+
+    stream->i_buffer_pos += p_block->i_buffer;
 
     vlc_mutex_unlock( &stream->lock );
     return VLC_SUCCESS;
 }
 
+int httpd_StreamSend( httpd_stream_t *stream, uint8_t *p_data, int i_data )
+{
+    block_t *p_block;
+
+    if( i_data < 0 || p_data == NULL )
+    {
+        return VLC_SUCCESS;
+    }
+
+    p_block = block_Alloc( i_data );
+    if( unlikely(p_block == NULL) )
+        return VLC_ENOMEM;
+    memcpy( p_block->p_buffer, p_data, i_data );
+
+    return httpd_StreamSendBlock( stream, p_block );
+}
+
 void httpd_StreamDelete( httpd_stream_t *stream )
 {
     httpd_UrlDelete( stream->url );
     vlc_mutex_destroy( &stream->lock );
     free( stream->psz_mime );
     free( stream->p_header );
-    free( stream->p_buffer );
+    for( int i = 0; i < stream->i_chunk; i++ )
+        block_Release( stream->p_chunk[( stream->i_chunk_first + i )
+                                       % stream->i_chunk_max].p_block );
+    free( stream->p_chunk );
     free( stream );
 }
 
@@ -1009,6 +1390,28 @@ static httpd_host_t *httpd_HostCreate( vlc_object_t *p_this,
     }
     for (host->nfd = 0; host->fds[host->nfd] != -1; host->nfd++);
 
+#ifdef HAVE_EPOLL_CREATE1
+    host->fd_client   = NULL;
+    host->i_fd_client = 0;
+    host->epfd = epoll_create1( EPOLL_CLOEXEC );
+    if( host->epfd == -1 )
+    {
+        msg_Err( p_this, "cannot create epoll set: %m" );
+        goto error;
+    }
+    for( unsigned i = 0; i < host->nfd; i++ )
+    {
+        struct epoll_event ev = { .events = EPOLLIN };
+
+        ev.data.fd = host->fds[i];
+        if( epoll_ctl( host->epfd, EPOLL_CTL_ADD, host->fds[i], &ev ) )
+        {
+            msg_Err( p_this, "cannot poll HTTP host socket: %m" );
+            goto error;
+        }
+    }
+#endif
+
     if( vlc_object_waitpipe( VLC_OBJECT( host ) ) == -1 )
     {
         msg_Err( host, "signaling pipe error: %m" );
@@ -1043,6 +1446,10 @@ error:
 
     if( host != NULL )
     {
+#ifdef HAVE_EPOLL_CREATE1
+        if( host->fds != NULL && host->epfd != -1 )
+            close( host->epfd );
+#endif
         net_ListenClose( host->fds );
         vlc_cond_destroy( &host->wait );
         vlc_mutex_destroy( &host->lock );
@@ -1089,14 +1496,16 @@ void httpd_HostDelete( httpd_host_t *host )
     {
         httpd_client_t *cl = host->client[i];
         msg_Warn( host, "client still connected" );
-        httpd_ClientClean( cl );
-        TAB_REMOVE( host->i_client, host->client, cl );
-        free( cl );
+        httpd_HostRemoveClient( host, cl );
         i--;
         /* TODO */
     }
 
     vlc_tls_Delete( host->p_tls );
+#ifdef HAVE_EPOLL_CREATE1
+    close( host->epfd );
+    free( host->fd_client );
+#endif
     net_ListenClose( host->fds );
     vlc_cond_destroy( &host->wait );
     vlc_mutex_destroy( &host->lock );
@@ -1131,6 +1540,7 @@ httpd_url_t *httpd_UrlNew( httpd_host_t *host, const char *psz_url,
     url->psz_url = strdup( psz_url );
     url->psz_user = strdup( psz_user ? psz_user : "" );
     url->psz_password = strdup( psz_password ? psz_password : "" );
+    url->b_prefix = false;
     for( int i = 0; i < HTTPD_MSG_MAX; i++ )
     {
         url->catch[i].cb = NULL;
@@ -1178,9 +1588,7 @@ void httpd_UrlDelete( httpd_url_t *url )
         {
             /* TODO complete it */
             msg_Warn( host, "force closing connections" );
-            httpd_ClientClean( client );
-            TAB_REMOVE( host->i_client, host->client, client );
-            free( client );
+            httpd_HostRemoveClient( host, client );
             i--;
         }
     }
@@ -1273,6 +1681,8 @@ static void httpd_ClientInit( httpd_client_t *cl, mtime_t now )
     cl->i_buffer_size = HTTPD_CL_BUFSIZE;
     cl->i_buffer = 0;
     cl->p_buffer = xmalloc( cl->i_buffer_size );
+    cl->p_chain = NULL;
+    cl->i_file_fd = -1;
     cl->b_stream_mode = false;
 
     httpd_MsgInit( &cl->query );
@@ -1304,6 +1714,11 @@ static void httpd_ClientClean( httpd_client_t *cl )
 
     free( cl->p_buffer );
     cl->p_buffer = NULL;
+    block_ChainRelease( cl->p_chain );
+    cl->p_chain = NULL;
+    if( cl->i_file_fd != -1 )
+        close( cl->i_file_fd );
+    cl->i_file_fd = -1;
 }
 
 static httpd_client_t *httpd_ClientNew( int fd, vlc_tls_t *p_tls, mtime_t now )
@@ -1316,6 +1731,9 @@ static httpd_client_t *httpd_ClientNew( int fd, vlc_tls_t *p_tls, mtime_t now )
     cl->fd      = fd;
     cl->url     = NULL;
     cl->p_tls = p_tls;
+#ifdef HAVE_EPOLL_CREATE1
+    cl->i_events = 0;
+#endif
 
     httpd_ClientInit( cl, now );
     if( p_tls != NULL )
@@ -1352,6 +1770,95 @@ ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
     return val;
 }
 
+/* Sends the shared stream chunks of a client, and releases what was sent */
+static
+ssize_t httpd_NetSendChain (httpd_client_t *cl)
+{
+    ssize_t val;
+
+#ifndef WIN32
+    if (cl->p_tls == NULL)
+    {
+        struct iovec iov[HTTPD_CL_CHUNKS];
+        int i_iov = 0;
+
+        for (block_t *b = cl->p_chain; b != NULL && i_iov < HTTPD_CL_CHUNKS;
+             b = b->p_next, i_iov++)
+        {
+            iov[i_iov].iov_base = b->p_buffer;
+            iov[i_iov].iov_len = b->i_buffer;
+        }
+        do
+            val = writev (cl->fd, iov, i_iov);
+        while (val == -1 && errno == EINTR);
+    }
+    else
+#endif
+        val = httpd_NetSend (cl, cl->p_chain->p_buffer,
+                             cl->p_chain->i_buffer);
+
+    for (size_t i_sent = (val > 0) ? val : 0; i_sent > 0;)
+    {
+        block_t *b = cl->p_chain;
+
+        if (i_sent < b->i_buffer)
+        {
+            b->p_buffer += i_sent;
+            b->i_buffer -= i_sent;
+            break;
+        }
+        i_sent -= b->i_buffer;
+        cl->p_chain = b->p_next;
+        block_Release (b);
+    }
+    return val;
+}
+
+/* Sends the next part of the local file of a client, and closes it once it
+ * is all sent. Without sendfile(), the part is read in the client buffer
+ * and sent from there. */
+static
+ssize_t httpd_NetSendFile (httpd_client_t *cl)
+{
+    size_t i_len = __MIN (cl->i_file_end - cl->i_file_pos, 1 << 20);
+    ssize_t val;
+
+#ifdef HAVE_SENDFILE
+    if (cl->p_tls == NULL)
+    {
+        do
+            val = sendfile (cl->fd, cl->i_file_fd, &cl->i_file_pos, i_len);
+        while (val == -1 && errno == EINTR);
+    }
+    else
+#endif
+    {
+        i_len = __MIN (i_len, HTTPD_CL_BUFSIZE);
+        cl->p_buffer = xrealloc (cl->p_buffer, HTTPD_CL_BUFSIZE);
+        do
+            val = read (cl->i_file_fd, cl->p_buffer, i_len);
+        while (val == -1 && errno == EINTR);
+        if (val > 0)
+        {
+            cl->i_buffer = 0;
+            cl->i_buffer_size = val;
+            cl->i_file_pos += val;
+        }
+    }
+
+    if (val == 0)
+    {   /* The file was truncated, the announced length cannot be sent */
+        errno = EIO;
+        val = -1;
+    }
+    if (val > 0 && cl->i_file_pos >= cl->i_file_end)
+    {
+        close (cl->i_file_fd);
+        cl->i_file_fd = -1;
+    }
+    return val;
+}
+
 
 static const struct
 {
@@ -1825,13 +2332,24 @@ static void httpd_ClientSend( httpd_client_t *cl )
         fprintf( stderr, "%s",  cl->p_buffer );*/
     }
 
-    i_len = httpd_NetSend( cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer );
+    if( cl->p_chain != NULL )
+    {
+        i_len = httpd_NetSendChain( cl );
+    }
+    else if( cl->i_file_fd != -1 && cl->i_buffer >= cl->i_buffer_size )
+    {
+        i_len = httpd_NetSendFile( cl );
+    }
+    else
+    {
+        i_len = httpd_NetSend( cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer );
+        if( i_len > 0 )
+            cl->i_buffer += i_len;
+    }
     if( i_len >= 0 )
     {
-        cl->i_buffer += i_len;
-
-        if( cl->i_buffer >= cl->i_buffer_size )
+        if( cl->p_chain == NULL && cl->i_buffer >= cl->i_buffer_size )
         {
             if( cl->answer.i_body == 0  && cl->answer.i_body_offset > 0 )
             {
@@ -1857,7 +2375,7 @@ static void httpd_ClientSend( httpd_client_t *cl )
                 cl->answer.i_body = 0;
                 cl->answer.p_body = NULL;
             }
-            else
+            else if( cl->p_chain == NULL && cl->i_file_fd == -1 )
             {
                 /* send finished */
                 cl->i_state = HTTPD_CLIENT_SEND_DONE;
@@ -1900,6 +2418,141 @@ static void httpd_ClientTlsHandshake( httpd_client_t *cl )
     }
 }
 
+/* Removes a client from the host and destroys it */
+static void httpd_HostRemoveClient( httpd_host_t *host, httpd_client_t *cl )
+{
+#ifdef HAVE_EPOLL_CREATE1
+    /* Closing the socket removes it from the epoll set */
+    if( cl->fd >= 0 && cl->fd < host->i_fd_client )
+        host->fd_client[cl->fd] = NULL;
+#endif
+    httpd_ClientClean( cl );
+    TAB_REMOVE( host->i_client, host->client, cl );
+    free( cl );
+}
+
+static void httpd_HostAddClient( httpd_host_t *host, httpd_client_t *cl )
+{
+#ifdef HAVE_EPOLL_CREATE1
+    if( cl->fd >= host->i_fd_client )
+    {
+        int i_size = __MAX( 2 * host->i_fd_client, cl->fd + 1 );
+        httpd_client_t **tab = realloc( host->fd_client,
+                                        i_size * sizeof( *tab ) );
+        if( unlikely(tab == NULL) )
+        {
+            httpd_ClientClean( cl );
+            free( cl );
+            return;
+        }
+        for( int i = host->i_fd_client; i < i_size; i++ )
+            tab[i] = NULL;
+        host->fd_client = tab;
+        host->i_fd_client = i_size;
+    }
+    host->fd_client[cl->fd] = cl;
+#endif
+    TAB_APPEND( host->i_client, host->client, cl );
+}
+
+/* Handles the socket of a client that is ready */
+static void httpd_ClientEvent( httpd_client_t *cl, mtime_t now )
+{
+    cl->i_activity_date = now;
+
+    if( cl->i_state == HTTPD_CLIENT_RECEIVING )
+    {
+        httpd_ClientRecv( cl );
+    }
+    else if( cl->i_state == HTTPD_CLIENT_SENDING )
+    {
+        httpd_ClientSend( cl );
+    }
+    else if( cl->i_state == HTTPD_CLIENT_TLS_HS_IN
+          || cl->i_state == HTTPD_CLIENT_TLS_HS_OUT )
+    {
+        httpd_ClientTlsHandshake( cl );
+    }
+}
+
+/* Accepts a new connection on a listening socket */
+static void httpd_HostAccept( httpd_host_t *host, int fd, mtime_t now )
+{
+    httpd_client_t *cl;
+
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+                &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *p_tls;
+
+    if( host->p_tls != NULL )
+        p_tls = vlc_tls_SessionCreate( host->p_tls, fd, NULL );
+    else
+        p_tls = NULL;
+
+    cl = httpd_ClientNew( fd, p_tls, now );
+    if( cl == NULL )
+    {
+        if( p_tls != NULL )
+            vlc_tls_SessionDelete( p_tls );
+        net_Close( fd );
+        return;
+    }
+
+    httpd_HostAddClient( host, cl );
+}
+
+#ifdef HAVE_EPOLL_CREATE1
+/* Updates the events of a client socket in the epoll set, only when they
+ * change: sockets without events are removed, as errors and hang ups
+ * would be reported anyway */
+static void httpd_ClientWatch( httpd_host_t *host, httpd_client_t *cl,
+                               uint32_t i_events )
+{
+    struct epoll_event ev = { .events = i_events };
+    int op;
+
+    if( cl->i_events == i_events )
+        return;
+    if( i_events == 0 )
+        op = EPOLL_CTL_DEL;
+    else
+        op = cl->i_events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+
+    ev.data.fd = cl->fd;
+    if( epoll_ctl( host->epfd, op, cl->fd, &ev ) )
+        msg_Err( host, "cannot poll client socket: %m" );
+    else
+        cl->i_events = i_events;
+}
+
+static void httpd_HostEvents( httpd_host_t *host,
+                              const struct epoll_event *ev, int i_ev )
+{
+    const mtime_t now = mdate();
+
+    /* Handle client sockets, a client removed meanwhile is not found */
+    for( int i = 0; i < i_ev; i++ )
+    {
+        httpd_client_t *cl = NULL;
+
+        if( ev[i].data.fd < host->i_fd_client )
+            cl = host->fd_client[ev[i].data.fd];
+        if( cl != NULL && cl->i_events != 0 )
+            httpd_ClientEvent( cl, now );
+    }
+
+    /* Handle server sockets (accept new connections) */
+    for( int i = 0; i < i_ev; i++ )
+        for( unsigned j = 0; j < host->nfd; j++ )
+            if( ev[i].data.fd == host->fds[j] )
+                httpd_HostAccept( host, host->fds[j], now );
+}
+#endif
+
 static void* httpd_HostThread( void *data )
 {
     httpd_host_t *host = data;
@@ -1908,6 +2561,7 @@ static void* httpd_HostThread( void *data )
     vlc_mutex_lock( &host->lock );
     while( host->i_ref > 0 )
     {
+#ifndef HAVE_EPOLL_CREATE1
         struct pollfd ufd[host->nfd + host->i_client];
         unsigned nfd;
         for( nfd = 0; nfd < host->nfd; nfd++ )
@@ -1916,6 +2570,7 @@ static void* httpd_HostThread( void *data )
             ufd[nfd].events = POLLIN;
             ufd[nfd].revents = 0;
         }
+#endif
 
         /* add all socket that should be read/write and close dead connection */
         while( host->i_url <= 0 )
@@ -1938,28 +2593,22 @@ static void* httpd_HostThread( void *data )
                   ( cl->i_activity_timeout > 0 &&
                     cl->i_activity_date+cl->i_activity_timeout < now) ) ) )
             {
-                httpd_ClientClean( cl );
-                TAB_REMOVE( host->i_client, host->client, cl );
-                free( cl );
+                httpd_HostRemoveClient( host, cl );
                 i_client--;
                 continue;
             }
 
-            struct pollfd *pufd = ufd + nfd;
-            assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
-
-            pufd->fd = cl->fd;
-            pufd->events = pufd->revents = 0;
+            short i_events = 0;
 
             if( ( cl->i_state == HTTPD_CLIENT_RECEIVING )
                   || ( cl->i_state == HTTPD_CLIENT_TLS_HS_IN ) )
             {
-                pufd->events = POLLIN;
+                i_events = POLLIN;
             }
             else if( ( cl->i_state == HTTPD_CLIENT_SENDING )
                   || ( cl->i_state == HTTPD_CLIENT_TLS_HS_OUT ) )
             {
-                pufd->events = POLLOUT;
+                i_events = POLLOUT;
             }
             else if( cl->i_state == HTTPD_CLIENT_RECEIVE_DONE )
             {
@@ -2058,7 +2707,10 @@ static void* httpd_HostThread( void *data )
                     {
                         httpd_url_t *url = host->url[i];
 
-                        if( !strcmp( url->psz_url, query->psz_url ) )
+                        if( url->b_prefix
+                          ? !strncmp( url->psz_url, query->psz_url,
+                                      strlen( url->psz_url ) )
+                          : !strcmp( url->psz_url, query->psz_url ) )
                         {
                             if( url->catch[i_msg].cb )
                             {
@@ -2231,16 +2883,35 @@ static void* httpd_HostThread( void *data )
                 }
             }
 
-            if (pufd->events != 0)
-                nfd++;
-            else
+            if( i_events == 0 )
                 b_low_delay = true;
+#ifdef HAVE_EPOLL_CREATE1
+            httpd_ClientWatch( host, cl, i_events == POLLIN ? EPOLLIN :
+                                         i_events == POLLOUT ? EPOLLOUT : 0 );
+#else
+            if( i_events != 0 )
+            {
+                struct pollfd *pufd = ufd + nfd;
+                assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+
+                pufd->fd = cl->fd;
+                pufd->events = i_events;
+                pufd->revents = 0;
+                nfd++;
+            }
+#endif
         }
         vlc_mutex_unlock( &host->lock );
         vlc_restorecancel( canc );
 
         /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+#ifdef HAVE_EPOLL_CREATE1
+        struct epoll_event ev[HTTPD_MAX_EVENTS];
+        int ret = epoll_wait( host->epfd, ev, HTTPD_MAX_EVENTS,
+                              b_low_delay ? 20 : -1 );
+#else
         int ret = poll( ufd, nfd, b_low_delay ? 20 : -1 );
+#endif
 
         canc = vlc_savecancel();
         vlc_mutex_lock( &host->lock );
@@ -2257,6 +2928,9 @@ static void* httpd_HostThread( void *data )
                 continue;
         }
 
+#ifdef HAVE_EPOLL_CREATE1
+        httpd_HostEvents( host, ev, ret );
+#else
         /* Handle client sockets */
         now = mdate();
         nfd = host->nfd;
@@ -2274,52 +2948,20 @@ static void* httpd_HostThread( void *data )
             if( pufd->revents == 0 )
                 continue; // no event received
 
-            cl->i_activity_date = now;
-
-            if( cl->i_state == HTTPD_CLIENT_RECEIVING )
-            {
-                httpd_ClientRecv( cl );
-            }
-            else if( cl->i_state == HTTPD_CLIENT_SENDING )
-            {
-                httpd_ClientSend( cl );
-            }
-            else if( cl->i_state == HTTPD_CLIENT_TLS_HS_IN
-                  || cl->i_state == HTTPD_CLIENT_TLS_HS_OUT )
-            {
-                httpd_ClientTlsHandshake( cl );
-            }
+            httpd_ClientEvent( cl, now );
         }
 
         /* Handle server sockets (accept new connections) */
         for( nfd = 0; nfd < host->nfd; nfd++ )
         {
-            httpd_client_t *cl;
-            int fd = ufd[nfd].fd;
-
-            assert (fd == host->fds[nfd]);
+            assert (ufd[nfd].fd == host->fds[nfd]);
 
             if( ufd[nfd].revents == 0 )
                 continue;
 
-            /* */
-            fd = vlc_accept (fd, NULL, NULL, true);
-            if (fd == -1)
-                continue;
-            setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                        &(int){ 1 }, sizeof(int));
-
-            vlc_tls_t *p_tls;
-
-            if( host->p_tls != NULL )
-                p_tls = vlc_tls_SessionCreate( host->p_tls, fd, NULL );
-            else
-                p_tls = NULL;
-
-            cl = httpd_ClientNew( fd, p_tls, now );
-
-            TAB_APPEND( host->i_client, host->client, cl );
+            httpd_HostAccept( host, ufd[nfd].fd, now );
         }
+#endif
     }
     vlc_mutex_unlock( &host->lock );
     return NULL;
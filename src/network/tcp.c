@@ -137,7 +137,8 @@ int net_Connect( vlc_object_t *p_this, const char *psz_host, int i_port,
         .ai_flags = AI_NUMERICSERV | AI_IDN,
     }, *res;
 
-    int val = vlc_getaddrinfo (psz_realhost, i_realport, &hints, &res);
+    int val = vlc_getaddrinfo_cached (p_this, psz_realhost, i_realport,
+                                      &hints, &res);
     free( psz_socks );
 
     if (val)
@@ -216,7 +217,7 @@ next_ai: /* failure */
         continue;
     }
 
-    freeaddrinfo( res );
+    vlc_freeaddrinfo_cached( res );
 
     if( i_handle == -1 )
         return -1;
@@ -242,6 +243,22 @@ next_ai: /* failure */
     return i_handle;
 }
 
+/**
+ * Starts resolving psz_host in the background, with the same parameters as
+ * net_ConnectTCP(), so that connecting to it later does not wait for the DNS.
+ */
+void net_PrefetchTCP( const char *psz_host, int i_port )
+{
+    const struct addrinfo hints = {
+        .ai_socktype = SOCK_STREAM,
+        .ai_protocol = IPPROTO_TCP,
+        .ai_flags = AI_NUMERICSERV | AI_IDN,
+    };
+
+    if( i_port > 0 )
+        vlc_getaddrinfo_prefetch( psz_host, i_port, &hints );
+}
+
 
 int net_AcceptSingle (vlc_object_t *obj, int lfd)
 {
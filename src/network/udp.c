@@ -510,7 +510,7 @@ int net_ConnectDgram( vlc_object_t *p_this, const char *psz_host, int i_port,
 
     msg_Dbg( p_this, "net: connecting to [%s]:%d", psz_host, i_port );
 
-    int val = vlc_getaddrinfo (psz_host, i_port, &hints, &res);
+    int val = vlc_getaddrinfo_cached (p_this, psz_host, i_port, &hints, &res);
     if (val)
     {
         msg_Err (p_this, "cannot resolve [%s]:%d : %s", psz_host, i_port,
@@ -567,7 +567,7 @@ int net_ConnectDgram( vlc_object_t *p_this, const char *psz_host, int i_port,
         }
     }
 
-    freeaddrinfo( res );
+    vlc_freeaddrinfo_cached( res );
 
     if( i_handle == -1 )
     {
@@ -601,7 +601,7 @@ int net_OpenDgram( vlc_object_t *obj, const char *psz_bind, int i_bind,
         .ai_flags = AI_NUMERICSERV | AI_IDN,
     }, *loc, *rem;
 
-    int val = vlc_getaddrinfo (psz_server, i_server, &hints, &rem);
+    int val = vlc_getaddrinfo_cached (obj, psz_server, i_server, &hints, &rem);
     if (val)
     {
         msg_Err (obj, "cannot resolve %s port %d : %s", psz_bind, i_bind,
@@ -615,7 +615,7 @@ int net_OpenDgram( vlc_object_t *obj, const char *psz_bind, int i_bind,
     {
         msg_Err (obj, "cannot resolve %s port %d : %s", psz_bind, i_bind,
                  gai_strerror (val));
-        freeaddrinfo (rem);
+        vlc_freeaddrinfo_cached (rem);
         return -1;
     }
 
@@ -658,7 +658,7 @@ int net_OpenDgram( vlc_object_t *obj, const char *psz_bind, int i_bind,
         net_Close (fd);
     }
 
-    freeaddrinfo (rem);
+    vlc_freeaddrinfo_cached (rem);
     freeaddrinfo (loc);
     return val;
 }
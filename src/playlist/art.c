@@ -28,6 +28,7 @@
 
 #include <assert.h>
 #include <sys/stat.h>
+#include <time.h>
 
 #include <vlc_common.h>
 #include <vlc_playlist.h>
@@ -265,6 +266,90 @@ int playlist_FindArtInCacheUsingItemUID( input_item_t *p_item )
     return VLC_EGENERIC;
 }
 
+static char *GetDirByItemURI( input_item_t *p_item )
+{
+    char *psz_uri = input_item_GetURI( p_item );
+    if( !psz_uri )
+        return NULL;
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_uri, strlen( psz_uri ) );
+    EndMD5( &md5 );
+    free( psz_uri );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_cachedir = config_GetUserDir(VLC_CACHE_DIR);
+    char *psz_dir;
+    if( psz_hash == NULL
+     || asprintf( &psz_dir, "%s" DIR_SEP "art" DIR_SEP "uri" DIR_SEP "%s",
+                  psz_cachedir, psz_hash ) == -1 )
+        psz_dir = NULL;
+    free( psz_cachedir );
+    free( psz_hash );
+    return psz_dir;
+}
+
+/* Name of the file marking that no art was found for an item. It is stored
+ * in the cache directory of the art, or else of the item uid, or else of
+ * the item URI. */
+static char *ArtNotFoundName( input_item_t *p_item )
+{
+    char *psz_dir = ArtCachePath( p_item );
+    if( !psz_dir )
+    {
+        char *uid = input_item_GetInfo( p_item, "uid", "md5" );
+        if( *uid )
+            psz_dir = GetDirByItemUIDs( uid );
+        free( uid );
+    }
+    if( !psz_dir )
+        psz_dir = GetDirByItemURI( p_item );
+    if( !psz_dir )
+        return NULL;
+
+    char *psz_file = GetFileByItemUID( psz_dir, "noart" );
+    free( psz_dir );
+    return psz_file;
+}
+
+void playlist_SaveArtNotFound( input_item_t *p_item )
+{
+    char *psz_file = ArtNotFoundName( p_item );
+    if( !psz_file )
+        return;
+
+    char *psz_dir = strdup( psz_file );
+    if( psz_dir )
+    {
+        *strrchr( psz_dir, DIR_SEP_CHAR ) = '\0';
+        ArtCacheCreateDir( psz_dir );
+        free( psz_dir );
+    }
+
+    /* The modification time of the (empty) file is the date of the search */
+    FILE *f = vlc_fopen( psz_file, "wb" );
+    if( f )
+        fclose( f );
+    free( psz_file );
+}
+
+bool playlist_IsArtNotFound( input_item_t *p_item, time_t i_delay )
+{
+    if( i_delay <= 0 )
+        return false;
+
+    char *psz_file = ArtNotFoundName( p_item );
+    if( !psz_file )
+        return false;
+
+    struct stat st;
+    bool b_not_found = !vlc_stat( psz_file, &st )
+                    && st.st_mtime + i_delay > time( NULL );
+    free( psz_file );
+    return b_not_found;
+}
+
 /* */
 int playlist_SaveArt( vlc_object_t *obj, input_item_t *p_item,
                       const void *data, size_t length, const char *psz_type )
@@ -303,6 +388,13 @@ int playlist_SaveArt( vlc_object_t *obj, input_item_t *p_item,
         {
             msg_Dbg( obj, "album art saved to %s", psz_filename );
             input_item_SetArtURL( p_item, psz_uri );
+
+            char *psz_noart = ArtNotFoundName( p_item );
+            if( psz_noart )
+            {
+                vlc_unlink( psz_noart );
+                free( psz_noart );
+            }
         }
         fclose( f );
     }
@@ -40,5 +40,9 @@ int playlist_FindArtInCacheUsingItemUID( input_item_t * );
 int playlist_SaveArt( vlc_object_t *, input_item_t *,
                       const void *, size_t, const char *psz_type );
 
+/* Negative cache, for the items where no art was found */
+void playlist_SaveArtNotFound( input_item_t * );
+bool playlist_IsArtNotFound( input_item_t *, time_t i_delay );
+
 #endif
 
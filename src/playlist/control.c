@@ -171,7 +171,7 @@ int playlist_PreparseEnqueue( playlist_t *p_playlist, input_item_t *p_item )
 
     if( unlikely(p_sys->p_preparser == NULL) )
         return VLC_ENOMEM;
-    playlist_preparser_Push( p_sys->p_preparser, p_item );
+    playlist_preparser_Push( p_sys->p_preparser, p_item, true );
     return VLC_SUCCESS;
 }
 
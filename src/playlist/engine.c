@@ -221,6 +221,12 @@ static playlist_t *playlist_Create( vlc_object_t *p_parent )
     ARRAY_INIT( p_playlist->items );
     ARRAY_INIT( p_playlist->all_items );
     ARRAY_INIT( pl_priv(p_playlist)->items_to_delete );
+    pl_priv(p_playlist)->input_map.pp_items = NULL;
+    pl_priv(p_playlist)->input_map.i_size = 0;
+    pl_priv(p_playlist)->input_map.i_count = 0;
+    pl_priv(p_playlist)->input_map.b_broken = false;
+    pl_priv(p_playlist)->live_search.psz_string = NULL;
+    atomic_init( &pl_priv(p_playlist)->live_search.changes, 0 );
     ARRAY_INIT( p_playlist->current );
 
     p_playlist->i_current_index = 0;
@@ -368,6 +374,8 @@ void playlist_Destroy( playlist_t *p_playlist )
         free( p_del );
     FOREACH_END();
     ARRAY_RESET( p_playlist->all_items );
+    playlist_InputMapClean( p_playlist );
+    free( p_sys->live_search.psz_string );
     FOREACH_ARRAY( playlist_item_t *p_del, p_sys->items_to_delete )
         free( p_del->pp_children );
         vlc_gc_decref( p_del->p_input );
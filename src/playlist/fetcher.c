@@ -48,14 +48,18 @@ struct playlist_fetcher_t
     vlc_object_t   *object;
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    bool            b_live;
+    unsigned        i_live; /* Number of running threads */
     int             i_art_policy;
     int             i_waiting;
     input_item_t    **pp_waiting;
 
-    DECL_ARRAY(playlist_album_t) albums;
+    DECL_ARRAY(playlist_album_t) albums; /* Protected by lock */
 };
 
+/* Maximum number of items fetched at the same time. The fetchers query
+ * online services, this is kept low not to flood them. */
+#define FETCHER_THREADS 3
+
 static void *Thread( void * );
 
 
@@ -71,7 +75,7 @@ playlist_fetcher_t *playlist_fetcher_New( vlc_object_t *parent )
     p_fetcher->object = parent;
     vlc_mutex_init( &p_fetcher->lock );
     vlc_cond_init( &p_fetcher->wait );
-    p_fetcher->b_live = false;
+    p_fetcher->i_live = 0;
     p_fetcher->i_waiting = 0;
     p_fetcher->pp_waiting = NULL;
     p_fetcher->i_art_policy = var_GetInteger( parent, "album-art" );
@@ -88,14 +92,16 @@ void playlist_fetcher_Push( playlist_fetcher_t *p_fetcher,
     vlc_mutex_lock( &p_fetcher->lock );
     INSERT_ELEM( p_fetcher->pp_waiting, p_fetcher->i_waiting,
                  p_fetcher->i_waiting, p_item );
-    if( !p_fetcher->b_live )
+    /* Start another thread if all of them are busy */
+    if( p_fetcher->i_live < FETCHER_THREADS
+     && p_fetcher->i_live < (unsigned)p_fetcher->i_waiting )
     {
         if( vlc_clone_detach( NULL, Thread, p_fetcher,
                               VLC_THREAD_PRIORITY_LOW ) )
             msg_Err( p_fetcher->object,
                      "cannot spawn secondary preparse thread" );
         else
-            p_fetcher->b_live = true;
+            p_fetcher->i_live++;
     }
     vlc_mutex_unlock( &p_fetcher->lock );
 }
@@ -110,7 +116,7 @@ void playlist_fetcher_Delete( playlist_fetcher_t *p_fetcher )
         REMOVE_ELEM( p_fetcher->pp_waiting, p_fetcher->i_waiting, 0 );
     }
 
-    while( p_fetcher->b_live )
+    while( p_fetcher->i_live > 0 )
         vlc_cond_wait( &p_fetcher->wait, &p_fetcher->lock );
     vlc_mutex_unlock( &p_fetcher->lock );
 
@@ -148,30 +154,45 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
     /* If we already checked this album in this session, skip */
     if( psz_artist && psz_album )
     {
+        bool b_searched = false, b_found = false;
+        char *psz_local = NULL;
+
+        vlc_mutex_lock( &p_fetcher->lock );
         FOREACH_ARRAY( playlist_album_t album, p_fetcher->albums )
             if( !strcmp( album.psz_artist, psz_artist ) &&
                 !strcmp( album.psz_album, psz_album ) )
             {
-                msg_Dbg( p_fetcher->object,
-                         " %s - %s has already been searched",
-                         psz_artist, psz_album );
-                /* TODO-fenrir if we cache art filename too, we can go faster */
-                free( psz_artist );
-                free( psz_album );
-                if( album.b_found )
-                {
-                    if( !strncmp( album.psz_arturl, "file://", 7 ) )
-                        input_item_SetArtURL( p_item, album.psz_arturl );
-                    else /* Actually get URL from cache */
-                        playlist_FindArtInCache( p_item );
-                    return 0;
-                }
-                else
-                {
-                    return VLC_EGENERIC;
-                }
+                b_searched = true;
+                b_found = album.b_found;
+                if( b_found && !strncmp( album.psz_arturl, "file://", 7 ) )
+                    psz_local = strdup( album.psz_arturl );
+                break;
             }
         FOREACH_END();
+        vlc_mutex_unlock( &p_fetcher->lock );
+
+        if( b_searched )
+        {
+            msg_Dbg( p_fetcher->object,
+                     " %s - %s has already been searched",
+                     psz_artist, psz_album );
+            /* TODO-fenrir if we cache art filename too, we can go faster */
+            free( psz_artist );
+            free( psz_album );
+            if( b_found )
+            {
+                if( psz_local )
+                    input_item_SetArtURL( p_item, psz_local );
+                else /* Actually get URL from cache */
+                    playlist_FindArtInCache( p_item );
+                free( psz_local );
+                return 0;
+            }
+            else
+            {
+                return VLC_EGENERIC;
+            }
+        }
     }
     free( psz_artist );
     free( psz_album );
@@ -248,7 +269,9 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
         a.psz_album = psz_album;
         a.psz_arturl = input_item_GetArtURL( p_item );
         a.b_found = (i_ret == VLC_EGENERIC ? false : true );
+        vlc_mutex_lock( &p_fetcher->lock );
         ARRAY_APPEND( p_fetcher->albums, a );
+        vlc_mutex_unlock( &p_fetcher->lock );
     }
     else
     {
@@ -365,7 +388,7 @@ static void *Thread( void *p_data )
         }
         else
         {
-            p_fetcher->b_live = false;
+            p_fetcher->i_live--;
             vlc_cond_signal( &p_fetcher->wait );
         }
         vlc_mutex_unlock( &p_fetcher->lock );
@@ -381,7 +404,11 @@ static void *Thread( void *p_data )
 
         /* Find art, and download it if needed */
         int i_ret = FindArt( p_fetcher, p_item );
-        if( i_ret == 1 )
+        if( i_ret < 0 )
+            /* Remember it, not to search again soon (download errors are
+             * not recorded, they may be temporary) */
+            playlist_SaveArtNotFound( p_item );
+        else if( i_ret == 1 )
             i_ret = DownloadArt( p_fetcher, p_item );
 
         /* */
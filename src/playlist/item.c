@@ -183,6 +183,15 @@ static void input_item_changed( const vlc_event_t * p_event,
     var_SetAddress( p_item->p_playlist, "item-change", p_item->p_input );
 }
 
+static void input_item_meta_changed( const vlc_event_t * p_event,
+                                     void * user_data )
+{
+    playlist_item_t *p_item = user_data;
+    /* Invalidates the live search results */
+    atomic_fetch_add( &pl_priv(p_item->p_playlist)->live_search.changes, 1 );
+    input_item_changed( p_event, user_data );
+}
+
 /*****************************************************************************
  * Listen to vlc_InputItemAddSubItem event
  *****************************************************************************/
@@ -194,9 +203,9 @@ static void install_input_item_observer( playlist_item_t * p_item )
     vlc_event_attach( p_em, vlc_InputItemDurationChanged,
                       input_item_changed, p_item );
     vlc_event_attach( p_em, vlc_InputItemMetaChanged,
-                      input_item_changed, p_item );
+                      input_item_meta_changed, p_item );
     vlc_event_attach( p_em, vlc_InputItemNameChanged,
-                      input_item_changed, p_item );
+                      input_item_meta_changed, p_item );
     vlc_event_attach( p_em, vlc_InputItemInfoChanged,
                       input_item_changed, p_item );
     vlc_event_attach( p_em, vlc_InputItemErrorWhenReadingChanged,
@@ -209,11 +218,11 @@ static void uninstall_input_item_observer( playlist_item_t * p_item )
     vlc_event_detach( p_em, vlc_InputItemSubItemTreeAdded,
                       input_item_add_subitem_tree, p_item );
     vlc_event_detach( p_em, vlc_InputItemMetaChanged,
-                      input_item_changed, p_item );
+                      input_item_meta_changed, p_item );
     vlc_event_detach( p_em, vlc_InputItemDurationChanged,
                       input_item_changed, p_item );
     vlc_event_detach( p_em, vlc_InputItemNameChanged,
-                      input_item_changed, p_item );
+                      input_item_meta_changed, p_item );
     vlc_event_detach( p_em, vlc_InputItemInfoChanged,
                       input_item_changed, p_item );
     vlc_event_detach( p_em, vlc_InputItemErrorWhenReadingChanged,
@@ -762,10 +771,13 @@ static void GoAndPreparse( playlist_t *p_playlist, int i_mode,
     char *psz_artist = input_item_GetArtist( p_item->p_input );
     char *psz_album = input_item_GetAlbum( p_item->p_input );
     if( pl_priv(p_playlist)->b_auto_preparse &&
+        pl_priv(p_playlist)->p_preparser != NULL &&
         input_item_IsPreparsed( p_item->p_input ) == false &&
             ( EMPTY_STR( psz_artist ) || ( EMPTY_STR( psz_album ) ) )
           )
-        playlist_PreparseEnqueue( p_playlist, p_item->p_input );
+        /* Background preparsing, after the explicit requests */
+        playlist_preparser_Push( pl_priv(p_playlist)->p_preparser,
+                                 p_item->p_input, false );
     free( psz_artist );
     free( psz_album );
 }
@@ -777,6 +789,7 @@ static void AddItem( playlist_t *p_playlist, playlist_item_t *p_item,
     PL_ASSERT_LOCKED;
     ARRAY_APPEND(p_playlist->items, p_item);
     ARRAY_APPEND(p_playlist->all_items, p_item);
+    playlist_InputMapAdd( p_playlist, p_item );
 
     if( i_pos == PLAYLIST_END )
         playlist_NodeAppend( p_playlist, p_item, p_node );
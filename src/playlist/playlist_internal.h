@@ -36,6 +36,7 @@
 
 #include "input/input_interface.h"
 #include <assert.h>
+#include <vlc_atomic.h>
 
 #include "art.h"
 #include "fetcher.h"
@@ -52,6 +53,22 @@ typedef struct playlist_private_t
     playlist_item_array_t items_to_delete; /**< Array of items and nodes to
             delete... At the very end. This sucks. */
 
+    struct {
+        playlist_item_t **pp_items; /**< Open addressing table of all_items,
+                                      keyed by input item */
+        size_t          i_size; /**< Table size (power of two) */
+        size_t          i_count; /**< Number of items in the table */
+        bool            b_broken; /**< Out of memory, use all_items */
+    } input_map;
+
+    struct {
+        char            *psz_string; /**< Last search string */
+        int             i_root_id; /**< Root of the last search */
+        bool            b_recursive; /**< Whether the last search was */
+        unsigned        i_changes; /**< Value of changes at the last search */
+        atomic_uint     changes; /**< Counter of name and meta changes */
+    } live_search;
+
     vlc_sd_internal_t   **pp_sds;
     int                   i_sds;   /**< Number of service discovery modules */
     input_thread_t *      p_input;  /**< the input thread associated
@@ -129,6 +146,11 @@ playlist_item_t * playlist_NodeAddInput( playlist_t *, input_item_t *,
 int playlist_InsertInputItemTree ( playlist_t *,
         playlist_item_t *, input_item_node_t *, int, bool );
 
+/* Search */
+void playlist_InputMapAdd( playlist_t *, playlist_item_t * );
+void playlist_InputMapRemove( playlist_t *, playlist_item_t * );
+void playlist_InputMapClean( playlist_t * );
+
 /* Tree walking */
 playlist_item_t *playlist_ItemFindFromInputAndRoot( playlist_t *p_playlist,
                                 input_item_t *p_input, playlist_item_t *p_root,
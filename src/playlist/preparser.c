@@ -25,6 +25,12 @@
 # include "config.h"
 #endif
 
+#ifdef HAVE_SEARCH_H
+# include <search.h>
+#endif
+
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_playlist.h>
 
@@ -37,6 +43,16 @@
 /*****************************************************************************
  * Structures/definitions
  *****************************************************************************/
+typedef struct preparser_entry_t preparser_entry_t;
+
+struct preparser_entry_t
+{
+    input_item_t      *p_item; /* must be first */
+    bool               b_priority;
+    preparser_entry_t *p_prev;
+    preparser_entry_t *p_next;
+};
+
 struct playlist_preparser_t
 {
     vlc_object_t        *object;
@@ -44,15 +60,88 @@ struct playlist_preparser_t
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    bool            b_live;
-    input_item_t  **pp_waiting;
-    int             i_waiting;
+    unsigned        i_live; /* Number of running threads */
+    unsigned        i_max_live;
+
+    /* Waiting items, priority ones first */
+    preparser_entry_t *p_first;
+    preparser_entry_t *p_last;
+    preparser_entry_t *p_last_priority;
+    void              *p_waiting; /* Tree of the entries, by input item */
+    unsigned           i_waiting;
 
     int             i_art_policy;
+    time_t          i_art_retry; /* Seconds before searching missing art */
 };
 
 static void *Thread( void * );
 
+static int EntryCompare( const void *a, const void *b )
+{
+    const preparser_entry_t *ea = a, *eb = b;
+
+    /* p_item must be first */
+    assert( ea == (const void *)&ea->p_item );
+    if( ea->p_item == eb->p_item )
+        return 0;
+    return ((uintptr_t)ea->p_item < (uintptr_t)eb->p_item) ? -1 : 1;
+}
+
+static preparser_entry_t *EntryFind( playlist_preparser_t *p_preparser,
+                                     input_item_t *p_item )
+{
+    preparser_entry_t **pp_entry = tfind( &p_item, &p_preparser->p_waiting,
+                                          EntryCompare );
+    return (pp_entry != NULL) ? *pp_entry : NULL;
+}
+
+/* Links an entry at the end of its part of the queue */
+static void EntryLink( playlist_preparser_t *p_preparser,
+                       preparser_entry_t *p_entry )
+{
+    preparser_entry_t *p_prev = p_entry->b_priority ?
+        p_preparser->p_last_priority : p_preparser->p_last;
+    preparser_entry_t *p_next = p_prev ? p_prev->p_next : p_preparser->p_first;
+
+    p_entry->p_prev = p_prev;
+    p_entry->p_next = p_next;
+    if( p_prev )
+        p_prev->p_next = p_entry;
+    else
+        p_preparser->p_first = p_entry;
+    if( p_next )
+        p_next->p_prev = p_entry;
+    else
+        p_preparser->p_last = p_entry;
+    if( p_entry->b_priority )
+        p_preparser->p_last_priority = p_entry;
+}
+
+static void EntryUnlink( playlist_preparser_t *p_preparser,
+                         preparser_entry_t *p_entry )
+{
+    if( p_preparser->p_last_priority == p_entry )
+        p_preparser->p_last_priority = p_entry->p_prev;
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_preparser->p_first = p_entry->p_next;
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_preparser->p_last = p_entry->p_prev;
+}
+
+/* Removes an entry from the queue, the caller gets its item reference */
+static void EntryRemove( playlist_preparser_t *p_preparser,
+                         preparser_entry_t *p_entry )
+{
+    EntryUnlink( p_preparser, p_entry );
+    tdelete( p_entry, &p_preparser->p_waiting, EntryCompare );
+    p_preparser->i_waiting--;
+    free( p_entry );
+}
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -67,28 +156,82 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent,
     p_preparser->p_fetcher = p_fetcher;
     vlc_mutex_init( &p_preparser->lock );
     vlc_cond_init( &p_preparser->wait );
-    p_preparser->b_live = false;
+    p_preparser->i_live = 0;
     p_preparser->i_art_policy = var_InheritInteger( parent, "album-art" );
+    p_preparser->i_art_retry =
+        var_InheritInteger( parent, "album-art-retry" ) * 24 * 3600;
+    p_preparser->p_first = NULL;
+    p_preparser->p_last = NULL;
+    p_preparser->p_last_priority = NULL;
+    p_preparser->p_waiting = NULL;
     p_preparser->i_waiting = 0;
-    p_preparser->pp_waiting = NULL;
+
+    int i_threads = var_InheritInteger( parent, "preparse-threads" );
+    if( i_threads <= 0 )
+        i_threads = vlc_GetCPUCount();
+    p_preparser->i_max_live = VLC_CLIP( i_threads, 1, 16 );
 
     return p_preparser;
 }
 
-void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p_item )
+void playlist_preparser_Push( playlist_preparser_t *p_preparser,
+                              input_item_t *p_item, bool b_priority )
 {
-    vlc_gc_incref( p_item );
+    preparser_entry_t *p_entry = malloc( sizeof(*p_entry) );
+    if( unlikely(p_entry == NULL) )
+        return;
+    p_entry->p_item = p_item;
+    p_entry->b_priority = b_priority;
 
     vlc_mutex_lock( &p_preparser->lock );
-    INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
-                 p_preparser->i_waiting, p_item );
-    if( !p_preparser->b_live )
+    preparser_entry_t *p_queued = EntryFind( p_preparser, p_item );
+    if( p_queued != NULL )
+    {
+        /* Already waiting: move it forward if it is now requested */
+        if( b_priority && !p_queued->b_priority )
+        {
+            EntryUnlink( p_preparser, p_queued );
+            p_queued->b_priority = true;
+            EntryLink( p_preparser, p_queued );
+        }
+        vlc_mutex_unlock( &p_preparser->lock );
+        free( p_entry );
+        return;
+    }
+
+    if( unlikely(tsearch( p_entry, &p_preparser->p_waiting,
+                          EntryCompare ) == NULL) )
+    {
+        vlc_mutex_unlock( &p_preparser->lock );
+        free( p_entry );
+        return;
+    }
+    vlc_gc_incref( p_item );
+    EntryLink( p_preparser, p_entry );
+    p_preparser->i_waiting++;
+
+    /* Start another thread if all of them are busy */
+    if( p_preparser->i_live < p_preparser->i_max_live
+     && p_preparser->i_live < p_preparser->i_waiting )
     {
         if( vlc_clone_detach( NULL, Thread, p_preparser,
                               VLC_THREAD_PRIORITY_LOW ) )
             msg_Warn( p_preparser->object, "cannot spawn pre-parser thread" );
         else
-            p_preparser->b_live = true;
+            p_preparser->i_live++;
+    }
+    vlc_mutex_unlock( &p_preparser->lock );
+}
+
+void playlist_preparser_Cancel( playlist_preparser_t *p_preparser,
+                                input_item_t *p_item )
+{
+    vlc_mutex_lock( &p_preparser->lock );
+    preparser_entry_t *p_entry = EntryFind( p_preparser, p_item );
+    if( p_entry != NULL && !p_entry->b_priority )
+    {
+        EntryRemove( p_preparser, p_entry );
+        vlc_gc_decref( p_item );
     }
     vlc_mutex_unlock( &p_preparser->lock );
 }
@@ -97,13 +240,15 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 {
     vlc_mutex_lock( &p_preparser->lock );
     /* Remove pending item to speed up preparser thread exit */
-    while( p_preparser->i_waiting > 0 )
+    while( p_preparser->p_first != NULL )
     {
-        vlc_gc_decref( p_preparser->pp_waiting[0] );
-        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+        input_item_t *p_item = p_preparser->p_first->p_item;
+
+        EntryRemove( p_preparser, p_preparser->p_first );
+        vlc_gc_decref( p_item );
     }
 
-    while( p_preparser->b_live )
+    while( p_preparser->i_live > 0 )
         vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
 
@@ -180,6 +325,12 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
     }
     vlc_mutex_unlock( &p_item->lock );
 
+    if( b_fetch && playlist_IsArtNotFound( p_item, p_preparser->i_art_retry ) )
+    {
+        msg_Dbg( obj, "art was not found recently, not searching again" );
+        b_fetch = false;
+    }
+
     if( b_fetch && p_fetcher )
         playlist_fetcher_Push( p_fetcher, p_item );
 }
@@ -198,15 +349,15 @@ static void *Thread( void *data )
 
         /* */
         vlc_mutex_lock( &p_preparser->lock );
-        if( p_preparser->i_waiting > 0 )
+        if( p_preparser->p_first != NULL )
         {
-            p_current = p_preparser->pp_waiting[0];
-            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+            p_current = p_preparser->p_first->p_item;
+            EntryRemove( p_preparser, p_preparser->p_first );
         }
         else
         {
             p_current = NULL;
-            p_preparser->b_live = false;
+            p_preparser->i_live--;
             vlc_cond_signal( &p_preparser->wait );
         }
         vlc_mutex_unlock( &p_preparser->lock );
@@ -35,7 +35,8 @@
 typedef struct playlist_preparser_t playlist_preparser_t;
 
 /**
- * This function creates the preparser object and thread.
+ * This function creates the preparser object. Its threads (up to
+ * --preparse-threads) are started on demand.
  */
 playlist_preparser_t *playlist_preparser_New( vlc_object_t *,
                                               playlist_fetcher_t * );
@@ -44,12 +45,21 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *,
  * This function enqueues the provided item to be preparsed.
  *
  * The input item is retained until the preparsing is done or until the
- * preparser object is deleted.
+ * preparser object is deleted. An item already waiting is not queued twice.
+ * Priority items are preparsed before the other ones: use it for items
+ * explicitly requested rather than for background preparsing.
  */
-void playlist_preparser_Push( playlist_preparser_t *, input_item_t * );
+void playlist_preparser_Push( playlist_preparser_t *, input_item_t *,
+                              bool b_priority );
 
 /**
- * This function destroys the preparser object and thread.
+ * This function removes the provided item from the waiting queue, unless
+ * it was pushed with priority. It does nothing if it is not waiting.
+ */
+void playlist_preparser_Cancel( playlist_preparser_t *, input_item_t * );
+
+/**
+ * This function destroys the preparser object and waits for its threads.
  *
  * All pending input items will be released.
  */
@@ -52,6 +52,133 @@ playlist_item_t* playlist_ItemGetById( playlist_t * p_playlist , int i_id )
         return NULL;
 }
 
+/***************************************************************************
+ * Input item map
+ ***************************************************************************/
+
+/* The map is an open addressing table (linear probing) of the items of
+ * all_items, keyed by their input item. Several items may share the same
+ * input item (copies); lookups then return the one with the lowest id,
+ * i.e. the first one of all_items, as the linear search used to. */
+
+static size_t InputMapSlot( const playlist_private_t *p_sys,
+                            const input_item_t *p_input )
+{
+    uintptr_t i_key = (uintptr_t)p_input / sizeof (void *);
+
+    /* Fibonacci hashing */
+    return (size_t)(i_key * UINT64_C(11400714819323198485) >> 32)
+           & (p_sys->input_map.i_size - 1);
+}
+
+static void InputMapInsert( playlist_private_t *p_sys, playlist_item_t *p_item )
+{
+    size_t i_mask = p_sys->input_map.i_size - 1;
+    size_t i = InputMapSlot( p_sys, p_item->p_input );
+
+    while( p_sys->input_map.pp_items[i] != NULL )
+        i = (i + 1) & i_mask;
+    p_sys->input_map.pp_items[i] = p_item;
+    p_sys->input_map.i_count++;
+}
+
+static void InputMapBreak( playlist_private_t *p_sys )
+{
+    free( p_sys->input_map.pp_items );
+    p_sys->input_map.pp_items = NULL;
+    p_sys->input_map.i_size = 0;
+    p_sys->input_map.i_count = 0;
+    p_sys->input_map.b_broken = true;
+}
+
+/**
+ * Adds an item of all_items to the input item map.
+ * The playlist have to be locked
+ */
+void playlist_InputMapAdd( playlist_t *p_playlist, playlist_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    PL_ASSERT_LOCKED;
+    if( p_sys->input_map.b_broken )
+        return;
+
+    /* Keep the load factor below one half */
+    if( 2 * (p_sys->input_map.i_count + 1) > p_sys->input_map.i_size )
+    {
+        playlist_item_t **pp_old = p_sys->input_map.pp_items;
+        size_t i_old = p_sys->input_map.i_size;
+        size_t i_size = i_old ? 2 * i_old : 64;
+        playlist_item_t **pp_new = calloc( i_size, sizeof (*pp_new) );
+
+        if( unlikely(pp_new == NULL) )
+        {
+            InputMapBreak( p_sys );
+            return;
+        }
+        p_sys->input_map.pp_items = pp_new;
+        p_sys->input_map.i_size = i_size;
+        p_sys->input_map.i_count = 0;
+        for( size_t i = 0; i < i_old; i++ )
+            if( pp_old[i] != NULL )
+                InputMapInsert( p_sys, pp_old[i] );
+        free( pp_old );
+    }
+    InputMapInsert( p_sys, p_item );
+}
+
+/**
+ * Removes an item from the input item map.
+ * The playlist have to be locked
+ */
+void playlist_InputMapRemove( playlist_t *p_playlist, playlist_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    PL_ASSERT_LOCKED;
+    if( p_sys->input_map.i_size == 0 )
+        return;
+
+    size_t i_mask = p_sys->input_map.i_size - 1;
+    size_t i = InputMapSlot( p_sys, p_item->p_input );
+
+    while( p_sys->input_map.pp_items[i] != p_item )
+    {
+        if( p_sys->input_map.pp_items[i] == NULL )
+            return;
+        i = (i + 1) & i_mask;
+    }
+
+    /* Backward shift deletion: move up the following entries that would
+     * not be reachable anymore through the freed slot */
+    for( size_t j = (i + 1) & i_mask;
+         p_sys->input_map.pp_items[j] != NULL; j = (j + 1) & i_mask )
+    {
+        size_t k = InputMapSlot( p_sys, p_sys->input_map.pp_items[j]->p_input );
+
+        if( ((j - k) & i_mask) >= ((j - i) & i_mask) )
+        {
+            p_sys->input_map.pp_items[i] = p_sys->input_map.pp_items[j];
+            i = j;
+        }
+    }
+    p_sys->input_map.pp_items[i] = NULL;
+    p_sys->input_map.i_count--;
+}
+
+/**
+ * Releases the input item map.
+ */
+void playlist_InputMapClean( playlist_t *p_playlist )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    free( p_sys->input_map.pp_items );
+    p_sys->input_map.pp_items = NULL;
+    p_sys->input_map.i_size = 0;
+    p_sys->input_map.i_count = 0;
+}
+
 /**
  * Search an item by its input_item_t
  * The playlist have to be locked
@@ -62,22 +189,37 @@ playlist_item_t* playlist_ItemGetById( playlist_t * p_playlist , int i_id )
 playlist_item_t* playlist_ItemGetByInput( playlist_t * p_playlist,
                                           input_item_t *p_item )
 {
-    int i;
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+    playlist_item_t *p_found = NULL;
+
     PL_ASSERT_LOCKED;
     if( get_current_status_item( p_playlist ) &&
         get_current_status_item( p_playlist )->p_input == p_item )
     {
         return get_current_status_item( p_playlist );
     }
-    /** \todo Check if this is always incremental and whether we can bsearch */
-    for( i =  0 ; i < p_playlist->all_items.i_size; i++ )
+
+    if( unlikely(p_sys->input_map.b_broken) )
     {
-        if( ARRAY_VAL(p_playlist->all_items, i)->p_input == p_item )
-        {
-            return ARRAY_VAL(p_playlist->all_items, i);
-        }
+        for( int i = 0; i < p_playlist->all_items.i_size; i++ )
+            if( ARRAY_VAL(p_playlist->all_items, i)->p_input == p_item )
+                return ARRAY_VAL(p_playlist->all_items, i);
+        return NULL;
     }
-    return NULL;
+    if( p_sys->input_map.i_size == 0 )
+        return NULL;
+
+    size_t i_mask = p_sys->input_map.i_size - 1;
+    for( size_t i = InputMapSlot( p_sys, p_item );
+         p_sys->input_map.pp_items[i] != NULL; i = (i + 1) & i_mask )
+    {
+        playlist_item_t *p_cur = p_sys->input_map.pp_items[i];
+
+        if( p_cur->p_input == p_item
+         && (p_found == NULL || p_cur->i_id < p_found->i_id) )
+            p_found = p_cur;
+    }
+    return p_found;
 }
 
 
@@ -108,7 +250,8 @@ static void playlist_LiveSearchClean( playlist_item_t *p_root )
  * @return true if an item match
  */
 static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
-                                               const char *psz_string, bool b_recursive )
+                                               const char *psz_string, bool b_recursive,
+                                               bool b_narrow )
 {
     int i;
     bool b_match = false;
@@ -116,9 +259,14 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
     {
         bool b_enable = false;
         playlist_item_t *p_item = p_root->pp_children[i];
+        // The search string only got longer: an item (or node) that did not
+        // match before cannot match now
+        if( b_narrow && p_item->i_flags & PLAYLIST_DBL_FLAG )
+            continue;
         // Go recurssively if their is some children
         if( b_recursive && p_item->i_children >= 0 &&
-            playlist_LiveSearchUpdateInternal( p_item, psz_string, true ) )
+            playlist_LiveSearchUpdateInternal( p_item, psz_string, true,
+                                               b_narrow ) )
         {
             b_enable = true;
         }
@@ -166,10 +314,32 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
 int playlist_LiveSearchUpdate( playlist_t *p_playlist, playlist_item_t *p_root,
                                const char *psz_string, bool b_recursive )
 {
+    playlist_private_t *p_sys = pl_priv(p_playlist);
     PL_ASSERT_LOCKED;
-    pl_priv(p_playlist)->b_reset_currently_playing = true;
+    p_sys->b_reset_currently_playing = true;
+
+    /* While the user types, each search string contains the previous one:
+     * only the items that still match need to be checked again, as long
+     * as no name or meta data changed in between. */
+    unsigned i_changes = atomic_load( &p_sys->live_search.changes );
+    bool b_narrow = p_sys->live_search.psz_string != NULL
+                 && p_sys->live_search.i_root_id == p_root->i_id
+                 && p_sys->live_search.b_recursive == b_recursive
+                 && p_sys->live_search.i_changes == i_changes
+                 && vlc_strcasestr( psz_string, p_sys->live_search.psz_string );
+
+    free( p_sys->live_search.psz_string );
+    p_sys->live_search.psz_string = NULL;
+
     if( *psz_string )
-        playlist_LiveSearchUpdateInternal( p_root, psz_string, b_recursive );
+    {
+        playlist_LiveSearchUpdateInternal( p_root, psz_string, b_recursive,
+                                           b_narrow );
+        p_sys->live_search.psz_string = strdup( psz_string );
+        p_sys->live_search.i_root_id = p_root->i_id;
+        p_sys->live_search.b_recursive = b_recursive;
+        p_sys->live_search.i_changes = i_changes;
+    }
     else
         playlist_LiveSearchClean( p_root );
     vlc_cond_signal( &pl_priv(p_playlist)->signal );
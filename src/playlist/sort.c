@@ -33,77 +33,171 @@
 #include "playlist_internal.h"
 
 
+/* Sort keys: the fields used by the comparison functions are copied once
+ * per sort, instead of locking and duplicating them in every comparison. */
+enum
+{
+    KEY_ALBUM,
+    KEY_ARTIST,
+    KEY_DESCRIPTION,
+    KEY_GENRE,
+    KEY_RATING,
+    KEY_TRACK_NUMBER,
+    KEY_META_COUNT,
+    KEY_TITLE = KEY_META_COUNT,
+    KEY_URI,
+    KEY_DURATION,
+};
+
+static const vlc_meta_type_t key_metas[KEY_META_COUNT] =
+{
+    [KEY_ALBUM] = vlc_meta_Album,
+    [KEY_ARTIST] = vlc_meta_Artist,
+    [KEY_DESCRIPTION] = vlc_meta_Description,
+    [KEY_GENRE] = vlc_meta_Genre,
+    [KEY_RATING] = vlc_meta_Rating,
+    [KEY_TRACK_NUMBER] = vlc_meta_TrackNumber,
+};
+
+#define KEY(k) (1 << KEY_##k)
+
+/* Keys needed by each sort mode */
+static const unsigned sort_keys[NUM_SORT_FNS] =
+{
+    [SORT_ID] = 0,
+    [SORT_TITLE] = KEY(TITLE),
+    [SORT_TITLE_NODES_FIRST] = KEY(TITLE),
+    [SORT_ARTIST] = KEY(ARTIST) | KEY(ALBUM) | KEY(TRACK_NUMBER) | KEY(TITLE),
+    [SORT_GENRE] = KEY(GENRE) | KEY(TITLE),
+    [SORT_DURATION] = KEY(DURATION),
+    [SORT_TITLE_NUMERIC] = KEY(TITLE),
+    [SORT_ALBUM] = KEY(ALBUM) | KEY(TRACK_NUMBER) | KEY(TITLE),
+    [SORT_TRACK_NUMBER] = KEY(TRACK_NUMBER) | KEY(TITLE),
+    [SORT_DESCRIPTION] = KEY(DESCRIPTION) | KEY(TITLE),
+    [SORT_RATING] = KEY(RATING) | KEY(TITLE),
+    [SORT_URI] = KEY(URI),
+};
+
+typedef struct
+{
+    playlist_item_t *p_item;
+    char            *psz_meta[KEY_META_COUNT];
+    char            *psz_title; /**< Title, or name if there is no title */
+    char            *psz_uri;
+    mtime_t          i_duration;
+} sort_key_t;
+
+static char *strdup_null( const char *psz )
+{
+    return psz ? strdup( psz ) : NULL;
+}
+
+/**
+ * Fill the sort key of an item, as the input_item_Get* accessors would
+ * @param p_key: the key to fill
+ * @param p_item: the item
+ * @param i_keys: a KEY() bitmask of the fields to fill
+ */
+static void sort_key_Init( sort_key_t *p_key, playlist_item_t *p_item,
+                           unsigned i_keys )
+{
+    input_item_t *p_input = p_item->p_input;
+
+    memset( p_key, 0, sizeof( *p_key ) );
+    p_key->p_item = p_item;
+
+    vlc_mutex_lock( &p_input->lock );
+    if( p_input->p_meta )
+        for( unsigned i = 0; i < KEY_META_COUNT; i++ )
+            if( i_keys & (1 << i) )
+                p_key->psz_meta[i] =
+                    strdup_null( vlc_meta_Get( p_input->p_meta, key_metas[i] ) );
+    if( i_keys & KEY(TITLE) )
+    {
+        const char *psz_title = p_input->p_meta ?
+            vlc_meta_Get( p_input->p_meta, vlc_meta_Title ) : NULL;
+        p_key->psz_title = strdup_null( !EMPTY_STR( psz_title ) ? psz_title
+                                                           : p_input->psz_name );
+    }
+    if( i_keys & KEY(URI) )
+        p_key->psz_uri = strdup_null( p_input->psz_uri );
+    p_key->i_duration = p_input->i_duration;
+    vlc_mutex_unlock( &p_input->lock );
+}
+
+static void sort_key_Clean( sort_key_t *p_key )
+{
+    for( unsigned i = 0; i < KEY_META_COUNT; i++ )
+        free( p_key->psz_meta[i] );
+    free( p_key->psz_title );
+    free( p_key->psz_uri );
+}
+
 /* General comparison functions */
 /**
- * Compare two items using their title or name
- * @param first: the first item
- * @param second: the second item
+ * Compare two strings, missing strings last
+ * @param psz_first: the first string
+ * @param psz_second: the second string
+ * @param b_integer: true if the strings are integers
  * @return -1, 0 or 1 like strcmp
  */
-static inline int meta_strcasecmp_title( const playlist_item_t *first,
-                              const playlist_item_t *second )
+static inline int strcasecmp_null( const char *psz_first,
+                                   const char *psz_second, bool b_integer )
 {
-    int i_ret;
-    char *psz_first = input_item_GetTitleFbName( first->p_input );
-    char *psz_second = input_item_GetTitleFbName( second->p_input );
-
     if( psz_first && psz_second )
-        i_ret = strcasecmp( psz_first, psz_second );
+        return b_integer ? atoi( psz_first ) - atoi( psz_second )
+                         : strcasecmp( psz_first, psz_second );
     else if( !psz_first && psz_second )
-        i_ret = 1;
+        return 1;
     else if( psz_first && !psz_second )
-        i_ret = -1;
+        return -1;
     else
-        i_ret = 0;
-    free( psz_first );
-    free( psz_second );
+        return 0;
+}
 
-    return i_ret;
+/**
+ * Compare two items using their title or name
+ * @param first: the first item
+ * @param second: the second item
+ * @return -1, 0 or 1 like strcmp
+ */
+static inline int meta_strcasecmp_title( const sort_key_t *first,
+                                         const sort_key_t *second )
+{
+    return strcasecmp_null( first->psz_title, second->psz_title, false );
 }
 
 /**
  * Compare two intems accoring to the given meta type
  * @param first: the first item
  * @param second: the second item
- * @param meta: the meta type to use to sort the items
+ * @param meta: the KEY_* meta type to use to sort the items
  * @param b_integer: true if the meta are integers
  * @return -1, 0 or 1 like strcmp
  */
-static inline int meta_sort( const playlist_item_t *first,
-                             const playlist_item_t *second,
-                             vlc_meta_type_t meta, bool b_integer )
+static inline int meta_sort( const sort_key_t *first,
+                             const sort_key_t *second,
+                             unsigned meta, bool b_integer )
 {
-    int i_ret;
-    char *psz_first = input_item_GetMeta( first->p_input, meta );
-    char *psz_second = input_item_GetMeta( second->p_input, meta );
+    const char *psz_first = first->psz_meta[meta];
+    const char *psz_second = second->psz_meta[meta];
+    const int i_first_children = first->p_item->i_children;
+    const int i_second_children = second->p_item->i_children;
 
     /* Nodes go first */
-    if( first->i_children == -1 && second->i_children >= 0 )
-        i_ret = 1;
-    else if( first->i_children >= 0 && second->i_children == -1 )
-       i_ret = -1;
+    if( i_first_children == -1 && i_second_children >= 0 )
+        return 1;
+    else if( i_first_children >= 0 && i_second_children == -1 )
+        return -1;
     /* Both are nodes, sort by name */
-    else if( first->i_children >= 0 && second->i_children >= 0 )
-        i_ret = meta_strcasecmp_title( first, second );
+    else if( i_first_children >= 0 && i_second_children >= 0 )
+        return meta_strcasecmp_title( first, second );
     /* Both are items */
-    else if( !psz_first && psz_second )
-        i_ret = 1;
-    else if( psz_first && !psz_second )
-        i_ret = -1;
     /* No meta, sort by name */
     else if( !psz_first && !psz_second )
-        i_ret = meta_strcasecmp_title( first, second );
+        return meta_strcasecmp_title( first, second );
     else
-    {
-        if( b_integer )
-            i_ret = atoi( psz_first ) - atoi( psz_second );
-        else
-            i_ret = strcasecmp( psz_first, psz_second );
-    }
-
-    free( psz_first );
-    free( psz_second );
-    return i_ret;
+        return strcasecmp_null( psz_first, psz_second, b_integer );
 }
 
 /* Comparison functions */
@@ -128,16 +222,32 @@ static inline sortfn_t find_sorting_fn( unsigned i_mode, unsigned i_type )
  * Sort an array of items recursively
  * @param i_items: number of items
  * @param pp_items: the array of items
- * @param p_sortfn: the sorting function
- * @return nothing
+ * @param p_sortfn: the sorting function, comparing sort_key_t
+ * @param i_keys: the KEY() bitmask of the fields used by p_sortfn
+ * @return VLC_SUCCESS or VLC_ENOMEM
  */
 static inline
-void playlist_ItemArraySort( unsigned i_items, playlist_item_t **pp_items,
-                             sortfn_t p_sortfn )
+int playlist_ItemArraySort( unsigned i_items, playlist_item_t **pp_items,
+                            sortfn_t p_sortfn, unsigned i_keys )
 {
     if( p_sortfn )
     {
-        qsort( pp_items, i_items, sizeof( pp_items[0] ), p_sortfn );
+        if( i_items < 2 )
+            return VLC_SUCCESS;
+
+        /* Decorate, sort and undecorate */
+        sort_key_t *p_keys = malloc( i_items * sizeof( *p_keys ) );
+        if( unlikely(p_keys == NULL) )
+            return VLC_ENOMEM;
+        for( unsigned i = 0; i < i_items; i++ )
+            sort_key_Init( &p_keys[i], pp_items[i], i_keys );
+        qsort( p_keys, i_items, sizeof( p_keys[0] ), p_sortfn );
+        for( unsigned i = 0; i < i_items; i++ )
+        {
+            pp_items[i] = p_keys[i].p_item;
+            sort_key_Clean( &p_keys[i] );
+        }
+        free( p_keys );
     }
     else /* Randomise */
     {
@@ -153,6 +263,7 @@ void playlist_ItemArraySort( unsigned i_items, playlist_item_t **pp_items,
             pp_items[i_new] = p_temp;
         }
     }
+    return VLC_SUCCESS;
 }
 
 
@@ -162,21 +273,25 @@ void playlist_ItemArraySort( unsigned i_items, playlist_item_t **pp_items,
  * @param p_playlist the playlist
  * @param p_node the node to sort
  * @param p_sortfn the sorting function
+ * @param i_keys the KEY() bitmask of the fields used by p_sortfn
  * @return VLC_SUCCESS on success
  */
 static int recursiveNodeSort( playlist_t *p_playlist, playlist_item_t *p_node,
-                              sortfn_t p_sortfn )
+                              sortfn_t p_sortfn, unsigned i_keys )
 {
     int i;
-    playlist_ItemArraySort(p_node->i_children,p_node->pp_children,p_sortfn);
+    int i_ret = playlist_ItemArraySort( p_node->i_children, p_node->pp_children,
+                                        p_sortfn, i_keys );
     for( i = 0 ; i< p_node->i_children; i++ )
     {
         if( p_node->pp_children[i]->i_children != -1 )
         {
-            recursiveNodeSort( p_playlist, p_node->pp_children[i], p_sortfn );
+            if( recursiveNodeSort( p_playlist, p_node->pp_children[i],
+                                   p_sortfn, i_keys ) != VLC_SUCCESS )
+                i_ret = VLC_ENOMEM;
         }
     }
-    return VLC_SUCCESS;
+    return i_ret;
 }
 
 /**
@@ -197,36 +312,39 @@ int playlist_RecursiveNodeSort( playlist_t *p_playlist, playlist_item_t *p_node,
     pl_priv(p_playlist)->b_reset_currently_playing = true;
 
     /* Do the real job recursively */
-    return recursiveNodeSort(p_playlist,p_node,find_sorting_fn(i_mode,i_type));
+    sortfn_t p_sortfn = find_sorting_fn( i_mode, i_type );
+    return recursiveNodeSort( p_playlist, p_node, p_sortfn,
+                              p_sortfn ? sort_keys[i_mode] : 0 );
 }
 
 
 /* This is the stuff the sorting functions are made of. The proto_##
  * functions are wrapped in cmp_a_## and cmp_d_## functions that do
- * void * to const playlist_item_t * casting and dereferencing and
- * cmp_d_## inverts the result, too. proto_## are static inline,
- * cmp_[ad]_## are merely static as they're the target of pointers.
+ * void * to const sort_key_t * casting and cmp_d_## inverts the result,
+ * too. proto_## are static inline, cmp_[ad]_## are merely static as
+ * they're the target of pointers.
  *
  * In any case, each SORT_## constant (except SORT_RANDOM) must have
- * a matching SORTFN( )-declared function here.
+ * a matching SORTFN( )-declared function here, and its keys must be
+ * listed in sort_keys.
  */
 
 #define SORTFN( SORT, first, second ) static inline int proto_##SORT \
-	( const playlist_item_t *first, const playlist_item_t *second )
+	( const sort_key_t *first, const sort_key_t *second )
 
 SORTFN( SORT_ALBUM, first, second )
 {
-    int i_ret = meta_sort( first, second, vlc_meta_Album, false );
+    int i_ret = meta_sort( first, second, KEY_ALBUM, false );
     /* Items came from the same album: compare the track numbers */
     if( i_ret == 0 )
-        i_ret = meta_sort( first, second, vlc_meta_TrackNumber, true );
+        i_ret = meta_sort( first, second, KEY_TRACK_NUMBER, true );
 
     return i_ret;
 }
 
 SORTFN( SORT_ARTIST, first, second )
 {
-    int i_ret = meta_sort( first, second, vlc_meta_Artist, false );
+    int i_ret = meta_sort( first, second, KEY_ARTIST, false );
     /* Items came from the same artist: compare the albums */
     if( i_ret == 0 )
         i_ret = proto_SORT_ALBUM( first, second );
@@ -236,13 +354,13 @@ SORTFN( SORT_ARTIST, first, second )
 
 SORTFN( SORT_DESCRIPTION, first, second )
 {
-    return meta_sort( first, second, vlc_meta_Description, false );
+    return meta_sort( first, second, KEY_DESCRIPTION, false );
 }
 
 SORTFN( SORT_DURATION, first, second )
 {
-    mtime_t time1 = input_item_GetDuration( first->p_input );
-    mtime_t time2 = input_item_GetDuration( second->p_input );
+    mtime_t time1 = first->i_duration;
+    mtime_t time2 = second->i_duration;
     int i_ret = time1 > time2 ? 1 :
                     ( time1 == time2 ? 0 : -1 );
     return i_ret;
@@ -250,17 +368,17 @@ SORTFN( SORT_DURATION, first, second )
 
 SORTFN( SORT_GENRE, first, second )
 {
-    return meta_sort( first, second, vlc_meta_Genre, false );
+    return meta_sort( first, second, KEY_GENRE, false );
 }
 
 SORTFN( SORT_ID, first, second )
 {
-    return first->i_id - second->i_id;
+    return first->p_item->i_id - second->p_item->i_id;
 }
 
 SORTFN( SORT_RATING, first, second )
 {
-    return meta_sort( first, second, vlc_meta_Rating, true );
+    return meta_sort( first, second, KEY_RATING, true );
 }
 
 SORTFN( SORT_TITLE, first, second )
@@ -271,10 +389,10 @@ SORTFN( SORT_TITLE, first, second )
 SORTFN( SORT_TITLE_NODES_FIRST, first, second )
 {
     /* If first is a node but not second */
-    if( first->i_children == -1 && second->i_children >= 0 )
+    if( first->p_item->i_children == -1 && second->p_item->i_children >= 0 )
         return -1;
     /* If second is a node but not first */
-    else if( first->i_children >= 0 && second->i_children == -1 )
+    else if( first->p_item->i_children >= 0 && second->p_item->i_children == -1 )
         return 1;
     /* Both are nodes or both are not nodes */
     else
@@ -283,47 +401,17 @@ SORTFN( SORT_TITLE_NODES_FIRST, first, second )
 
 SORTFN( SORT_TITLE_NUMERIC, first, second )
 {
-    int i_ret;
-    char *psz_first = input_item_GetTitleFbName( first->p_input );
-    char *psz_second = input_item_GetTitleFbName( second->p_input );
-
-    if( psz_first && psz_second )
-        i_ret = atoi( psz_first ) - atoi( psz_second );
-    else if( !psz_first && psz_second )
-        i_ret = 1;
-    else if( psz_first && !psz_second )
-        i_ret = -1;
-    else
-        i_ret = 0;
-
-    free( psz_first );
-    free( psz_second );
-    return i_ret;
+    return strcasecmp_null( first->psz_title, second->psz_title, true );
 }
 
 SORTFN( SORT_TRACK_NUMBER, first, second )
 {
-    return meta_sort( first, second, vlc_meta_TrackNumber, true );
+    return meta_sort( first, second, KEY_TRACK_NUMBER, true );
 }
 
 SORTFN( SORT_URI, first, second )
 {
-    int i_ret;
-    char *psz_first = input_item_GetURI( first->p_input );
-    char *psz_second = input_item_GetURI( second->p_input );
-
-    if( psz_first && psz_second )
-        i_ret = strcasecmp( psz_first, psz_second );
-    else if( !psz_first && psz_second )
-        i_ret = 1;
-    else if( psz_first && !psz_second )
-        i_ret = -1;
-    else
-        i_ret = 0;
-
-    free( psz_first );
-    free( psz_second );
-    return i_ret;
+    return strcasecmp_null( first->psz_uri, second->psz_uri, false );
 }
 
 #undef  SORTFN
@@ -338,11 +426,11 @@ SORTFN( SORT_URI, first, second )
 
 #define DEF( s ) \
 	static int cmp_a_##s(const void *l,const void *r) \
-	{ return proto_##s(*(const playlist_item_t *const *)l, \
-                           *(const playlist_item_t *const *)r); } \
+	{ return proto_##s((const sort_key_t *)l, \
+                           (const sort_key_t *)r); } \
 	static int cmp_d_##s(const void *l,const void *r) \
-	{ return -1*proto_##s(*(const playlist_item_t * const *)l, \
-                              *(const playlist_item_t * const *)r); }
+	{ return -1*proto_##s((const sort_key_t *)l, \
+                              (const sort_key_t *)r); }
 
 	VLC_DEFINE_SORT_FUNCTIONS
 
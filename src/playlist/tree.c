@@ -78,6 +78,7 @@ playlist_item_t * playlist_NodeCreate( playlist_t *p_playlist,
     p_item->i_children = 0;
 
     ARRAY_APPEND(p_playlist->all_items, p_item);
+    playlist_InputMapAdd( p_playlist, p_item );
 
     if( p_parent != NULL )
         playlist_NodeInsert( p_playlist, p_item, p_parent,
@@ -158,7 +159,10 @@ int playlist_NodeDelete( playlist_t *p_playlist, playlist_item_t *p_root,
     var_SetInteger( p_playlist, "playlist-item-deleted", p_root->i_id );
     ARRAY_BSEARCH( p_playlist->all_items, ->i_id, int, p_root->i_id, i );
     if( i != -1 )
+    {
         ARRAY_REMOVE( p_playlist->all_items, i );
+        playlist_InputMapRemove( p_playlist, p_root );
+    }
 
     if( p_root->i_children == -1 ) {
         ARRAY_BSEARCH( p_playlist->items,->i_id, int, p_root->i_id, i );
@@ -186,6 +190,12 @@ int playlist_NodeDelete( playlist_t *p_playlist, playlist_item_t *p_root,
     if( p_root->p_parent )
         playlist_NodeRemoveItem( p_playlist, p_root, p_root->p_parent );
 
+    /* Do not preparse an input item that is not in the playlist anymore */
+    if( pl_priv(p_playlist)->p_preparser != NULL &&
+        playlist_ItemGetByInput( p_playlist, p_root->p_input ) == NULL )
+        playlist_preparser_Cancel( pl_priv(p_playlist)->p_preparser,
+                                   p_root->p_input );
+
     playlist_ItemRelease( p_root );
     return VLC_SUCCESS;
 }
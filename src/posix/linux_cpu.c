@@ -26,6 +26,7 @@
 #include <string.h>
 #include <vlc_common.h>
 #include <vlc_cpu.h>
+#include "libvlc.h"
 
 #undef CPU_FLAGS
 #if defined (__arm__)
@@ -42,7 +43,7 @@
 #ifdef CPU_FLAGS
 static uint32_t cpu_flags = 0;
 
-static void vlc_CPU_init (void)
+static void vlc_CPU_init_linux (void)
 {
     FILE *info = fopen ("/proc/cpuinfo", "rt");
     if (info == NULL)
@@ -116,14 +117,14 @@ static void vlc_CPU_init (void)
     if (all_caps == 0xFFFFFFFF) /* Error parsing of cpuinfo? */
         all_caps = 0; /* Do not assume any capability! */
 
-    cpu_flags = all_caps;
+    cpu_flags = vlc_CPU_mask (all_caps);
 }
 
 unsigned vlc_CPU (void)
 {
     static pthread_once_t once = PTHREAD_ONCE_INIT;
 
-    pthread_once (&once, vlc_CPU_init);
+    pthread_once (&once, vlc_CPU_init_linux);
     return cpu_flags;
 }
 #else /* CPU_FLAGS */
@@ -23,6 +23,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <assert.h>
 
@@ -35,67 +36,196 @@
  * they typically require one thread per timer plus one thread per iteration,
  * which is inefficient and overkill (unless you need multiple iteration
  * of the same timer concurrently).
- * Thus, this is a generic manual implementation of timers using a thread.
+ * Thus, this is a generic manual implementation of timers. All the timers of
+ * the process share a few threads, which wait for the earliest deadline of a
+ * binary heap of armed timers. A thread is added whenever a callback starts
+ * while no other thread is left waiting, so that a slow callback does not
+ * delay the other timers (up to VLC_TIMER_THREADS_MAX threads).
  */
 
+#define VLC_TIMER_THREADS_MAX 8
+
 struct vlc_timer
 {
-    vlc_thread_t thread;
-    vlc_cond_t   reschedule;
-    vlc_mutex_t  lock;
     void       (*func) (void *);
     void        *data;
     mtime_t      value, interval;
+    size_t       index; /**< Position in the heap (SIZE_MAX if not armed) */
+    bool         running;
+    bool         rescheduled; /**< Scheduled while running */
     atomic_uint  overruns;
 };
 
-VLC_NORETURN
-static void *vlc_timer_thread (void *data)
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait; /**< The earliest deadline changed, or exit */
+    vlc_cond_t  done; /**< A callback returned */
+    bool        initialized;
+
+    struct vlc_timer **heap; /**< Armed timers, earliest deadline first */
+    size_t      count;
+    size_t      size;
+    unsigned    timers; /**< Created timers */
+
+    unsigned    generation; /**< Incremented to stop the threads */
+    unsigned    threads;
+    unsigned    idle; /**< Threads not running a callback */
+    vlc_thread_t thread[VLC_TIMER_THREADS_MAX];
+} vlc_timers = { .lock = VLC_STATIC_MUTEX };
+
+static void vlc_timer_heap_swap (size_t a, size_t b)
+{
+    struct vlc_timer *timer = vlc_timers.heap[a];
+
+    vlc_timers.heap[a] = vlc_timers.heap[b];
+    vlc_timers.heap[a]->index = a;
+    vlc_timers.heap[b] = timer;
+    timer->index = b;
+}
+
+static void vlc_timer_heap_up (size_t i)
 {
-    struct vlc_timer *timer = data;
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
 
-    vlc_mutex_lock (&timer->lock);
-    mutex_cleanup_push (&timer->lock);
+        if (vlc_timers.heap[parent]->value <= vlc_timers.heap[i]->value)
+            break;
+        vlc_timer_heap_swap (i, parent);
+        i = parent;
+    }
+}
 
+static void vlc_timer_heap_down (size_t i)
+{
     for (;;)
     {
-        while (timer->value == 0)
-            vlc_cond_wait (&timer->reschedule, &timer->lock);
+        size_t min = i, child = 2 * i + 1;
+
+        if (child < vlc_timers.count
+         && vlc_timers.heap[child]->value < vlc_timers.heap[min]->value)
+            min = child;
+        child++;
+        if (child < vlc_timers.count
+         && vlc_timers.heap[child]->value < vlc_timers.heap[min]->value)
+            min = child;
+        if (min == i)
+            break;
+        vlc_timer_heap_swap (i, min);
+        i = min;
+    }
+}
+
+static void vlc_timer_heap_insert (struct vlc_timer *timer)
+{
+    /* vlc_timer_create() reserved a slot for every timer */
+    assert (vlc_timers.count < vlc_timers.size);
+    timer->index = vlc_timers.count++;
+    vlc_timers.heap[timer->index] = timer;
+    vlc_timer_heap_up (timer->index);
+    if (timer->index == 0)
+        vlc_cond_broadcast (&vlc_timers.wait);
+}
+
+static void vlc_timer_heap_remove (struct vlc_timer *timer)
+{
+    size_t i = timer->index;
+
+    assert (i < vlc_timers.count && vlc_timers.heap[i] == timer);
+    timer->index = SIZE_MAX;
+    if (i == --vlc_timers.count)
+        return;
+
+    vlc_timers.heap[i] = vlc_timers.heap[vlc_timers.count];
+    vlc_timers.heap[i]->index = i;
+    vlc_timer_heap_up (i);
+    vlc_timer_heap_down (vlc_timers.heap[i]->index);
+}
+
+static void *vlc_timer_thread (void *data);
+
+static int vlc_timer_spawn (void)
+{
+    unsigned n = vlc_timers.threads;
 
-        if (vlc_cond_timedwait (&timer->reschedule, &timer->lock,
-                                timer->value) == 0)
+    if (n >= VLC_TIMER_THREADS_MAX)
+        return 0;
+    if (vlc_clone (&vlc_timers.thread[n], vlc_timer_thread,
+                   (void *)(uintptr_t)vlc_timers.generation,
+                   VLC_THREAD_PRIORITY_INPUT))
+        return ENOMEM;
+    vlc_timers.threads++;
+    vlc_timers.idle++;
+    return 0;
+}
+
+static void *vlc_timer_thread (void *data)
+{
+    const unsigned generation = (uintptr_t)data;
+
+    vlc_mutex_lock (&vlc_timers.lock);
+    while (generation == vlc_timers.generation)
+    {
+        if (vlc_timers.count == 0)
+        {
+            vlc_cond_wait (&vlc_timers.wait, &vlc_timers.lock);
+            continue;
+        }
+
+        struct vlc_timer *timer = vlc_timers.heap[0];
+        if (timer->value > mdate ())
+        {
+            vlc_cond_timedwait (&vlc_timers.wait, &vlc_timers.lock,
+                                timer->value);
             continue;
+        }
+
+        vlc_timer_heap_remove (timer);
+        const mtime_t value = timer->value;
         if (timer->interval == 0)
             timer->value = 0; /* disarm */
-        vlc_mutex_unlock (&timer->lock);
+        timer->running = true;
+        timer->rescheduled = false;
+
+        /* Leave a thread waiting for the other timers */
+        vlc_timers.idle--;
+        if (vlc_timers.idle == 0 && vlc_timers.count > 0)
+            vlc_timer_spawn ();
+        vlc_mutex_unlock (&vlc_timers.lock);
 
         int canc = vlc_savecancel ();
         timer->func (timer->data);
         vlc_restorecancel (canc);
 
         mtime_t now = mdate ();
-        unsigned misses;
-
-        vlc_mutex_lock (&timer->lock);
-        if (timer->interval == 0)
-            continue;
 
-        misses = (now - timer->value) / timer->interval;
-        timer->value += timer->interval;
-        /* Try to compensate for one miss (mwait() will return immediately)
-         * but no more. Otherwise, we might busy loop, after extended periods
-         * without scheduling (suspend, SIGSTOP, RT preemption, ...). */
-        if (misses > 1)
+        vlc_mutex_lock (&vlc_timers.lock);
+        vlc_timers.idle++;
+        timer->running = false;
+        if (!timer->rescheduled && timer->interval != 0)
         {
-            misses--;
-            timer->value += misses * timer->interval;
-            atomic_fetch_add_explicit (&timer->overruns, misses,
-                                       memory_order_relaxed);
+            unsigned misses = (now - value) / timer->interval;
+
+            timer->value = value + timer->interval;
+            /* Try to compensate for one miss (the deadline will have passed
+             * already) but no more. Otherwise, we might busy loop, after
+             * extended periods without scheduling (suspend, SIGSTOP, RT
+             * preemption, ...). */
+            if (misses > 1)
+            {
+                misses--;
+                timer->value += misses * timer->interval;
+                atomic_fetch_add_explicit (&timer->overruns, misses,
+                                           memory_order_relaxed);
+            }
         }
+        if (timer->value != 0)
+            vlc_timer_heap_insert (timer);
+        vlc_cond_broadcast (&vlc_timers.done);
     }
-
-    vlc_cleanup_pop ();
-    assert (0);
+    vlc_mutex_unlock (&vlc_timers.lock);
+    return NULL;
 }
 
 /**
@@ -115,26 +245,47 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
 
     if (unlikely(timer == NULL))
         return ENOMEM;
-    vlc_mutex_init (&timer->lock);
-    vlc_cond_init (&timer->reschedule);
     assert (func);
     timer->func = func;
     timer->data = data;
     timer->value = 0;
     timer->interval = 0;
+    timer->index = SIZE_MAX;
+    timer->running = false;
+    timer->rescheduled = false;
     atomic_init(&timer->overruns, 0);
 
-    if (vlc_clone (&timer->thread, vlc_timer_thread, timer,
-                   VLC_THREAD_PRIORITY_INPUT))
+    vlc_mutex_lock (&vlc_timers.lock);
+    if (!vlc_timers.initialized)
+    {   /* Not statically initialized, to wait on the monotonic clock */
+        vlc_cond_init (&vlc_timers.wait);
+        vlc_cond_init (&vlc_timers.done);
+        vlc_timers.initialized = true;
+    }
+
+    if (vlc_timers.timers >= vlc_timers.size)
     {
-        vlc_cond_destroy (&timer->reschedule);
-        vlc_mutex_destroy (&timer->lock);
-        free (timer);
-        return ENOMEM;
+        size_t size = vlc_timers.size ? (2 * vlc_timers.size) : 16;
+        struct vlc_timer **heap = realloc (vlc_timers.heap,
+                                           size * sizeof (*heap));
+        if (unlikely(heap == NULL))
+            goto error;
+        vlc_timers.heap = heap;
+        vlc_timers.size = size;
     }
 
+    if (vlc_timers.threads == 0 && vlc_timer_spawn ())
+        goto error;
+    vlc_timers.timers++;
+    vlc_mutex_unlock (&vlc_timers.lock);
+
     *id = timer;
     return 0;
+
+error:
+    vlc_mutex_unlock (&vlc_timers.lock);
+    free (timer);
+    return ENOMEM;
 }
 
 /**
@@ -148,10 +299,36 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
  */
 void vlc_timer_destroy (vlc_timer_t timer)
 {
-    vlc_cancel (timer->thread);
-    vlc_join (timer->thread, NULL);
-    vlc_cond_destroy (&timer->reschedule);
-    vlc_mutex_destroy (&timer->lock);
+    vlc_thread_t threads[VLC_TIMER_THREADS_MAX];
+    unsigned n = 0;
+
+    vlc_mutex_lock (&vlc_timers.lock);
+    /* Disarm, so that an ongoing callback does not re-arm the timer */
+    if (timer->index != SIZE_MAX)
+        vlc_timer_heap_remove (timer);
+    timer->value = 0;
+    timer->interval = 0;
+    timer->rescheduled = true;
+    while (timer->running)
+        vlc_cond_wait (&vlc_timers.done, &vlc_timers.lock);
+
+    if (--vlc_timers.timers == 0)
+    {   /* Last timer: stop the threads (they are all waiting) */
+        assert (vlc_timers.count == 0);
+        n = vlc_timers.threads;
+        memcpy (threads, vlc_timers.thread, n * sizeof (*threads));
+        vlc_timers.generation++;
+        vlc_timers.threads = 0;
+        vlc_timers.idle = 0;
+        vlc_cond_broadcast (&vlc_timers.wait);
+        free (vlc_timers.heap);
+        vlc_timers.heap = NULL;
+        vlc_timers.size = 0;
+    }
+    vlc_mutex_unlock (&vlc_timers.lock);
+
+    for (unsigned i = 0; i < n; i++)
+        vlc_join (threads[i], NULL);
     free (timer);
 }
 
@@ -178,11 +355,16 @@ void vlc_timer_schedule (vlc_timer_t timer, bool absolute,
     if (!absolute && value != 0)
         value += mdate();
 
-    vlc_mutex_lock (&timer->lock);
+    vlc_mutex_lock (&vlc_timers.lock);
+    if (timer->index != SIZE_MAX)
+        vlc_timer_heap_remove (timer);
     timer->value = value;
     timer->interval = interval;
-    vlc_cond_signal (&timer->reschedule);
-    vlc_mutex_unlock (&timer->lock);
+    if (timer->running)
+        timer->rescheduled = true; /* re-armed once the callback returns */
+    else if (value != 0)
+        vlc_timer_heap_insert (timer);
+    vlc_mutex_unlock (&vlc_timers.lock);
 }
 
 /**
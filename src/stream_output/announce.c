@@ -68,12 +68,12 @@ sout_AnnounceRegisterSDP( vlc_object_t *obj, const char *psz_sdp,
 
     /* GRUIK. We should not convert back-and-forth from string to numbers */
     struct addrinfo *res;
-    if (vlc_getaddrinfo (psz_dst, 0, NULL, &res) == 0)
+    if (vlc_getaddrinfo_cached (obj, psz_dst, 0, NULL, &res) == 0)
     {
         if (res->ai_addrlen <= sizeof (p_session->addr))
             memcpy (&p_session->addr, res->ai_addr,
                     p_session->addrlen = res->ai_addrlen);
-        freeaddrinfo (res);
+        vlc_freeaddrinfo_cached (res);
     }
 
     vlc_mutex_lock (&sap_mutex);
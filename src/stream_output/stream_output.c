@@ -48,6 +48,7 @@
 #include <vlc_codec.h>
 #include <vlc_modules.h>
 
+#include "../libvlc.h"
 #include "input/input_interface.h"
 
 #define VLC_CODEC_NULL VLC_FOURCC( 'n', 'u', 'l', 'l' )
@@ -115,6 +116,8 @@ sout_instance_t *sout_NewInstance( vlc_object_t *p_parent, const char *psz_dest
     p_sout->p_stream = NULL;
 
     var_Create( p_sout, "sout-mux-caching", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
+    /* Largest delay of the encoders, in microseconds (set by transcode) */
+    var_Create( p_sout, "sout-encoder-delay", VLC_VAR_INTEGER );
 
     p_sout->p_stream = sout_StreamChainNew( p_sout, psz_chain, NULL, NULL );
     if( p_sout->p_stream )
@@ -314,7 +317,11 @@ ssize_t sout_AccessOutRead( sout_access_out_t *p_access, block_t *p_buffer )
  *****************************************************************************/
 ssize_t sout_AccessOutWrite( sout_access_out_t *p_access, block_t *p_buffer )
 {
-    return p_access->pf_write( p_access, p_buffer );
+    mtime_t i_trace = vlc_trace_Begin();
+    ssize_t i_ret = p_access->pf_write( p_access, p_buffer );
+    vlc_trace_End( i_trace, "io", "write",
+                   module_get_object( p_access->p_module ) );
+    return i_ret;
 }
 
 /**
@@ -526,7 +533,9 @@ void sout_MuxSendBuffer( sout_mux_t *p_mux, sout_input_t *p_input,
 
     if( p_mux->b_waiting_stream )
     {
-        const int64_t i_caching = var_GetInteger( p_mux->p_sout, "sout-mux-caching" ) * INT64_C(1000);
+        /* Streams behind a delaying encoder start late */
+        const int64_t i_caching = var_GetInteger( p_mux->p_sout, "sout-mux-caching" ) * INT64_C(1000)
+                                + var_GetInteger( p_mux->p_sout, "sout-encoder-delay" );
 
         if( p_mux->i_add_stream_start < 0 )
             p_mux->i_add_stream_start = p_buffer->i_dts;
@@ -537,7 +546,9 @@ void sout_MuxSendBuffer( sout_mux_t *p_mux, sout_input_t *p_input,
             return;
         p_mux->b_waiting_stream = false;
     }
+    mtime_t i_trace = vlc_trace_Begin();
     p_mux->pf_mux( p_mux );
+    vlc_trace_End( i_trace, "sout", "mux", module_get_object( p_mux->p_module ) );
 }
 
 
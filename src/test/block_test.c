@@ -84,10 +84,180 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void *test_block_PoolThread (void *data)
+{
+    block_t *chain = data;
+
+    block_ChainRelease (chain);
+    return NULL;
+}
+
+static void test_block_Pool (void)
+{
+    static const size_t sizes[] = { 0, 188, 1316, 4000, 16000, 100000 };
+    block_t *chain = NULL, **pp = &chain;
+
+    /* Blocks of all classes, released from another thread */
+    for (unsigned i = 0; i < 100; i++)
+    {
+        size_t size = sizes[i % (sizeof (sizes) / sizeof (sizes[0]))];
+        block_t *block = block_Alloc (size);
+        assert (block != NULL);
+        assert (block->i_buffer == size);
+        memset (block->p_buffer, i, size);
+        block_ChainLastAppend (&pp, block);
+    }
+
+    vlc_thread_t th;
+    int val = vlc_clone (&th, test_block_PoolThread, chain,
+                         VLC_THREAD_PRIORITY_LOW);
+    assert (val == 0);
+    vlc_join (th, NULL);
+
+    /* Recycled blocks, grown across classes */
+    for (unsigned i = 0; i < 100; i++)
+    {
+        block_t *block = block_Alloc (sizeof (text));
+        assert (block != NULL);
+        memcpy (block->p_buffer, text, sizeof (text));
+        block = block_Realloc (block, 3000, sizeof (text) + 20000);
+        assert (block != NULL);
+        assert (block->i_buffer == 3000 + sizeof (text) + 20000);
+        assert (!memcmp (block->p_buffer + 3000, text, sizeof (text)));
+        block_Release (block);
+    }
+}
+
+static void test_block_Shared (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = 1;
+
+    block = block_MakeShared (block);
+    block_t *ref = block_Share (block);
+    assert (ref != NULL);
+    assert (ref->p_buffer == block->p_buffer);
+    assert (ref->i_pts == 1);
+
+    /* Growing a shared payload copies it */
+    ref = block_Realloc (ref, 4, sizeof (text));
+    assert (ref != NULL);
+    assert (ref->p_buffer + 4 != block->p_buffer);
+    memset (ref->p_buffer, 0, 4);
+    assert (!memcmp (ref->p_buffer + 4, text, sizeof (text)));
+    block_Release (ref);
+
+    ref = block_Share (block);
+    assert (ref != NULL);
+    ref->i_buffer = 4;
+    ref = block_Unshare (ref);
+    assert (ref != NULL);
+    assert (ref->p_buffer != block->p_buffer);
+    assert (ref->i_buffer == 4 && ref->i_pts == 1);
+    memset (ref->p_buffer, 0, 4);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (ref);
+
+    /* The last reference can be written to */
+    ref = block_Share (block);
+    assert (ref != NULL);
+    block_Release (block);
+    block = block_Unshare (ref);
+    assert (block == ref);
+    block_Release (block);
+}
+
+#define FIFO_BLOCKS 5000
+
+static void *test_block_FifoThread (void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        block_t *block = block_Alloc (sizeof (i));
+        assert (block != NULL);
+        memcpy (block->p_buffer, &i, sizeof (i));
+        /* Pace only half of the time, so that the ring overflows */
+        if ((i / 2000) & 1)
+            block_FifoPace (fifo, 10, SIZE_MAX);
+        block_FifoPut (fifo, block);
+    }
+    return NULL;
+}
+
+static void test_block_FifoSPSC (void)
+{
+    block_fifo_t *fifo = block_FifoNewSPSC ();
+    assert (fifo != NULL);
+
+    vlc_thread_t th;
+    int val = vlc_clone (&th, test_block_FifoThread, fifo,
+                         VLC_THREAD_PRIORITY_LOW);
+    assert (val == 0);
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        block_t *block = block_FifoShow (fifo);
+        assert (block != NULL);
+        assert (block == block_FifoGet (fifo));
+
+        unsigned n;
+        assert (block->i_buffer == sizeof (n));
+        memcpy (&n, block->p_buffer, sizeof (n));
+        assert (n == i);
+        block_Release (block);
+    }
+    vlc_join (th, NULL);
+    assert (block_FifoCount (fifo) == 0);
+
+    /* Overflow, then discard everything */
+    for (unsigned i = 0; i < 3000; i++)
+        block_FifoPut (fifo, block_Alloc (16));
+    assert (block_FifoCount (fifo) == 3000);
+    block_FifoEmpty (fifo);
+    assert (block_FifoCount (fifo) == 0);
+
+    block_FifoPut (fifo, block_Alloc (16));
+    block_Release (block_FifoGet (fifo));
+    block_FifoRelease (fifo);
+}
+
+static void test_block_FifoBatch (block_fifo_t *fifo)
+{
+    for (unsigned i = 0; i < 10; i++)
+        block_FifoPut (fifo, block_Alloc (100));
+
+    block_t *chain = block_FifoGetBatch (fifo, 250, VLC_TS_INVALID);
+    int count;
+    size_t size;
+
+    block_ChainProperties (chain, &count, &size, NULL);
+    assert (count == 3 && size == 300);
+    assert (block_FifoCount (fifo) == 7);
+    block_ChainRelease (chain);
+
+    chain = block_FifoGetBatch (fifo, SIZE_MAX, VLC_TS_INVALID);
+    block_ChainProperties (chain, &count, NULL, NULL);
+    assert (count == 7);
+    assert (block_FifoCount (fifo) == 0);
+    block_ChainRelease (chain);
+
+    assert (block_FifoGetBatch (fifo, SIZE_MAX, mdate () + 10000) == NULL);
+    block_FifoRelease (fifo);
+}
+
 int main (void)
 {
     test_block_File ();
     test_block ();
+    test_block_Pool ();
+    test_block_Shared ();
+    test_block_FifoSPSC ();
+    test_block_FifoBatch (block_FifoNew ());
+    test_block_FifoBatch (block_FifoNewSPSC ());
     return 0;
 }
 
@@ -0,0 +1,208 @@
+/*****************************************************************************
+ * picture_pool.c: Test for picture_pool_t
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_picture_pool.h>
+
+#define PICTURES 8
+
+static video_format_t fmt;
+
+static void test_pool_GetRelease(void)
+{
+    picture_pool_t *pool = picture_pool_NewFromFormat(&fmt, PICTURES);
+    picture_t *pics[PICTURES];
+    int used, used_max, free_min;
+
+    assert(pool != NULL);
+    assert(picture_pool_GetSize(pool) == PICTURES);
+
+    for (int i = 0; i < PICTURES; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+        for (int j = 0; j < i; j++)
+            assert(pics[j] != pics[i]);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+
+    /* A released picture is given out again */
+    picture_Release(pics[3]);
+    picture_t *pic = picture_pool_Get(pool);
+    assert(pic == pics[3]);
+    assert(picture_pool_Get(pool) == NULL);
+
+    /* It needs all its references to be released */
+    picture_Hold(pic);
+    picture_Release(pic);
+    assert(picture_pool_Get(pool) == NULL);
+
+    for (int i = 0; i < PICTURES; i++)
+        picture_Release(pics[i]);
+
+    picture_pool_GetStats(pool, &used, &used_max, &free_min);
+    assert(used == 0);
+    assert(used_max == PICTURES);
+    assert(free_min == 0);
+
+    pic = picture_pool_Get(pool);
+    assert(pic != NULL);
+    picture_pool_GetStats(pool, &used, NULL, NULL);
+    assert(used == 1);
+    picture_Release(pic);
+
+    picture_pool_Delete(pool);
+}
+
+static void test_pool_NonEmpty(void)
+{
+    picture_pool_t *pool = picture_pool_NewFromFormat(&fmt, PICTURES);
+    picture_t *pics[PICTURES];
+
+    assert(pool != NULL);
+    for (int i = 0; i < PICTURES; i++)
+        pics[i] = picture_pool_Get(pool);
+
+    /* The oldest picture is taken back */
+    picture_pool_NonEmpty(pool, false);
+    assert(picture_pool_Get(pool) == pics[0]);
+    assert(picture_pool_Get(pool) == NULL);
+
+    /* Every picture is taken back */
+    picture_pool_NonEmpty(pool, true);
+    for (int i = 0; i < PICTURES; i++)
+        assert(picture_pool_Get(pool) != NULL);
+    assert(picture_pool_Get(pool) == NULL);
+
+    picture_pool_NonEmpty(pool, true);
+    picture_pool_Delete(pool);
+}
+
+static void test_pool_Reserve(void)
+{
+    picture_pool_t *master = picture_pool_NewFromFormat(&fmt, PICTURES);
+    assert(master != NULL);
+
+    assert(picture_pool_Reserve(master, PICTURES + 1) == NULL);
+
+    picture_pool_t *pool = picture_pool_Reserve(master, 3);
+    assert(pool != NULL);
+    assert(picture_pool_GetSize(pool) == 3);
+
+    /* The reserved pictures are not given out by the master */
+    picture_t *pics[PICTURES];
+    for (int i = 0; i < PICTURES - 3; i++)
+        assert((pics[i] = picture_pool_Get(master)) != NULL);
+    assert(picture_pool_Get(master) == NULL);
+
+    /* They go back to the pool which reserved them */
+    picture_t *pic = picture_pool_Get(pool);
+    assert(pic != NULL);
+    picture_Release(pic);
+    assert(picture_pool_Get(master) == NULL);
+    assert(picture_pool_Get(pool) == pic);
+
+    /* and to the master once the pool is deleted, or when they are
+     * released if they are still in use */
+    picture_pool_Delete(pool);
+    for (int i = 0; i < 2; i++)
+        assert(picture_pool_Get(master) != NULL);
+    assert(picture_pool_Get(master) == NULL);
+    picture_Release(pic);
+    assert(picture_pool_Get(master) == pic);
+    assert(picture_pool_Get(master) == NULL);
+
+    picture_pool_NonEmpty(master, true);
+    picture_pool_Delete(master);
+}
+
+typedef struct {
+    vlc_sem_t filled;   /* a picture is in the slot */
+    vlc_sem_t emptied;  /* the slot is empty */
+    vlc_sem_t released; /* a picture went back to the pool */
+    picture_t *slot;
+} test_handoff_t;
+
+static void *test_pool_Releaser(void *data)
+{
+    test_handoff_t *h = data;
+
+    for (int i = 0; i < 10000; i++) {
+        vlc_sem_wait(&h->filled);
+        picture_t *pic = h->slot;
+        vlc_sem_post(&h->emptied);
+
+        picture_Release(pic);
+        vlc_sem_post(&h->released);
+    }
+    return NULL;
+}
+
+/* Pictures are released by another thread, as done by the video output */
+static void test_pool_Threads(void)
+{
+    picture_pool_t *pool = picture_pool_NewFromFormat(&fmt, 2);
+    test_handoff_t h;
+    vlc_thread_t th;
+
+    assert(pool != NULL);
+    vlc_sem_init(&h.filled, 0);
+    vlc_sem_init(&h.emptied, 1);
+    vlc_sem_init(&h.released, 0);
+    assert(!vlc_clone(&th, test_pool_Releaser, &h, VLC_THREAD_PRIORITY_LOW));
+    for (int i = 0; i < 10000; i++) {
+        picture_t *pic;
+        while ((pic = picture_pool_Get(pool)) == NULL)
+            vlc_sem_wait(&h.released);
+
+        vlc_sem_wait(&h.emptied);
+        h.slot = pic;
+        vlc_sem_post(&h.filled);
+    }
+    vlc_join(th, NULL);
+    vlc_sem_destroy(&h.released);
+    vlc_sem_destroy(&h.emptied);
+    vlc_sem_destroy(&h.filled);
+
+    int used, used_max;
+    picture_pool_GetStats(pool, &used, &used_max, NULL);
+    assert(used == 0);
+    assert(used_max == 2);
+    picture_pool_Delete(pool);
+}
+
+int main(void)
+{
+    video_format_Init(&fmt, VLC_CODEC_I420);
+    fmt.i_width = fmt.i_visible_width = 64;
+    fmt.i_height = fmt.i_visible_height = 48;
+
+    test_pool_GetRelease();
+    test_pool_NonEmpty();
+    test_pool_Reserve();
+    test_pool_Threads();
+    return 0;
+}
@@ -1365,6 +1365,18 @@ vout_display_t *vout_NewDisplay(vout_thread_t *vout,
 /*****************************************************************************
  *
  *****************************************************************************/
+enum {
+    SPLITTER_PREPARE,
+    SPLITTER_DISPLAY,
+    SPLITTER_QUIT,
+};
+
+typedef struct {
+    vout_display_sys_t *sys;
+    int                index;
+    vlc_thread_t       thread;
+} splitter_worker_t;
+
 struct vout_display_sys_t {
     picture_pool_t   *pool;
     video_splitter_t *splitter;
@@ -1373,11 +1385,136 @@ struct vout_display_sys_t {
     int            count;
     picture_t      **picture;
     vout_display_t **display;
+
+    /* The outputs but the first one, which the vout thread handles, have
+     * their own thread. All the outputs are prepared before any of them
+     * is displayed, so the screens flip together. */
+    int               worker_count;
+    splitter_worker_t *worker;
+    vlc_mutex_t       lock;
+    vlc_cond_t        wait_work;
+    vlc_cond_t        wait_done;
+    unsigned          generation;
+    int               command;
+    int               pending;
 };
 struct video_splitter_owner_t {
     vout_display_t *wrapper;
 };
 
+static void SplitterRun(vout_display_sys_t *sys, int i, int command)
+{
+    switch (command) {
+    case SPLITTER_PREPARE:
+        if (vout_IsDisplayFiltered(sys->display[i]))
+            sys->picture[i] = vout_FilterDisplay(sys->display[i], sys->picture[i]);
+        if (sys->picture[i])
+            vout_display_Prepare(sys->display[i], sys->picture[i], NULL);
+        break;
+    case SPLITTER_DISPLAY:
+        if (sys->picture[i])
+            vout_display_Display(sys->display[i], sys->picture[i], NULL);
+        break;
+    }
+}
+
+static void *SplitterThread(void *data)
+{
+    splitter_worker_t *worker = data;
+    vout_display_sys_t *sys = worker->sys;
+    unsigned generation = 0;
+
+    vlc_mutex_lock(&sys->lock);
+    for (;;) {
+        while (sys->generation == generation)
+            vlc_cond_wait(&sys->wait_work, &sys->lock);
+        generation = sys->generation;
+        if (sys->command == SPLITTER_QUIT)
+            break;
+
+        const int command = sys->command;
+        vlc_mutex_unlock(&sys->lock);
+        SplitterRun(sys, worker->index, command);
+        vlc_mutex_lock(&sys->lock);
+        if (--sys->pending == 0)
+            vlc_cond_signal(&sys->wait_done);
+    }
+    vlc_mutex_unlock(&sys->lock);
+    return NULL;
+}
+
+/* Runs the command on all the outputs, and returns once they are done */
+static void SplitterDispatch(vout_display_sys_t *sys, int command)
+{
+    if (sys->worker_count == 0) {
+        for (int i = 0; i < sys->count; i++)
+            SplitterRun(sys, i, command);
+        return;
+    }
+
+    vlc_mutex_lock(&sys->lock);
+    sys->command = command;
+    sys->pending = sys->worker_count;
+    sys->generation++;
+    vlc_cond_broadcast(&sys->wait_work);
+    vlc_mutex_unlock(&sys->lock);
+
+    SplitterRun(sys, 0, command);
+
+    vlc_mutex_lock(&sys->lock);
+    while (sys->pending > 0)
+        vlc_cond_wait(&sys->wait_done, &sys->lock);
+    vlc_mutex_unlock(&sys->lock);
+}
+
+static void SplitterStopWorkers(vout_display_sys_t *sys)
+{
+    if (sys->worker_count > 0) {
+        vlc_mutex_lock(&sys->lock);
+        sys->command = SPLITTER_QUIT;
+        sys->generation++;
+        vlc_cond_broadcast(&sys->wait_work);
+        vlc_mutex_unlock(&sys->lock);
+
+        for (int i = 0; i < sys->worker_count; i++)
+            vlc_join(sys->worker[i].thread, NULL);
+    }
+    free(sys->worker);
+    sys->worker_count = 0;
+    sys->worker = NULL;
+}
+
+static void SplitterStartWorkers(vlc_object_t *obj, vout_display_sys_t *sys)
+{
+    sys->worker_count = 0;
+    sys->worker = NULL;
+    if (sys->count < 2 || !var_InheritBool(obj, "video-splitter-threads"))
+        return;
+
+    sys->worker = malloc((sys->count - 1) * sizeof(*sys->worker));
+    if (!sys->worker)
+        return;
+
+    sys->generation = 0;
+    for (int i = 1; i < sys->count; i++) {
+        splitter_worker_t *worker = &sys->worker[sys->worker_count];
+
+        worker->sys = sys;
+        worker->index = i;
+        if (vlc_clone(&worker->thread, SplitterThread, worker,
+                      VLC_THREAD_PRIORITY_OUTPUT))
+            break;
+        sys->worker_count++;
+    }
+
+    if (sys->worker_count != sys->count - 1) {
+        /* The outputs are all handled by one thread, or none */
+        msg_Warn(obj, "cannot run the splitter outputs in parallel");
+        SplitterStopWorkers(sys);
+    } else
+        msg_Dbg(obj, "running %d splitter outputs in parallel", sys->count);
+}
+
 static vout_window_t *SplitterNewWindow(vout_display_t *vd, const vout_window_cfg_t *cfg_ptr)
 {
     vout_display_owner_sys_t *osys = vd->owner.sys;
@@ -1446,12 +1583,7 @@ static void SplitterPrepare(vout_display_t *vd,
         return;
     }
 
-    for (int i = 0; i < sys->count; i++) {
-        if (vout_IsDisplayFiltered(sys->display[i]))
-            sys->picture[i] = vout_FilterDisplay(sys->display[i], sys->picture[i]);
-        if (sys->picture[i])
-            vout_display_Prepare(sys->display[i], sys->picture[i], NULL);
-    }
+    SplitterDispatch(sys, SPLITTER_PREPARE);
 }
 static void SplitterDisplay(vout_display_t *vd,
                             picture_t *picture,
@@ -1460,10 +1592,7 @@ static void SplitterDisplay(vout_display_t *vd,
     vout_display_sys_t *sys = vd->sys;
 
     assert(!subpicture);
-    for (int i = 0; i < sys->count; i++) {
-        if (sys->picture[i])
-            vout_display_Display(sys->display[i], sys->picture[i], NULL);
-    }
+    SplitterDispatch(sys, SPLITTER_DISPLAY);
     picture_Release(picture);
 }
 static int SplitterControl(vout_display_t *vd, int query, va_list args)
@@ -1519,6 +1648,10 @@ static void SplitterClose(vout_display_t *vd)
         picture_pool_Delete(sys->pool);
 
     /* */
+    SplitterStopWorkers(sys);
+    vlc_cond_destroy(&sys->wait_done);
+    vlc_cond_destroy(&sys->wait_work);
+    vlc_mutex_destroy(&sys->lock);
     for (int i = 0; i < sys->count; i++)
         vout_DeleteDisplay(sys->display[i], NULL);
     TAB_CLEAN(sys->count, sys->display);
@@ -1556,6 +1689,11 @@ vout_display_t *vout_NewSplitter(vout_thread_t *vout,
         abort();
     sys->splitter = splitter;
     sys->pool     = NULL;
+    sys->worker_count = 0;
+    sys->worker   = NULL;
+    vlc_mutex_init(&sys->lock);
+    vlc_cond_init(&sys->wait_work);
+    vlc_cond_init(&sys->wait_done);
 
     wrapper->pool    = SplitterPool;
     wrapper->prepare = SplitterPrepare;
@@ -1604,6 +1742,7 @@ vout_display_t *vout_NewSplitter(vout_thread_t *vout,
         }
         TAB_APPEND(sys->count, sys->display, vd);
     }
+    SplitterStartWorkers(VLC_OBJECT(vout), sys);
 
     return wrapper;
 }
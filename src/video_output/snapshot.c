@@ -30,12 +30,14 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <time.h>
+#include <assert.h>
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_block.h>
 
+#include <libvlc.h>
 #include "snapshot.h"
 
 /* */
@@ -47,6 +49,7 @@ void vout_snapshot_Init(vout_snapshot_t *snap)
     snap->is_available = true;
     snap->request_count = 0;
     snap->picture = NULL;
+    snap->job_count = 0;
 }
 void vout_snapshot_Clean(vout_snapshot_t *snap)
 {
@@ -57,6 +60,7 @@ void vout_snapshot_Clean(vout_snapshot_t *snap)
         picture = next;
     }
 
+    assert(snap->job_count == 0);
     vlc_cond_destroy(&snap->wait);
     vlc_mutex_destroy(&snap->lock);
 }
@@ -68,6 +72,8 @@ void vout_snapshot_End(vout_snapshot_t *snap)
     snap->is_available = false;
 
     vlc_cond_broadcast(&snap->wait);
+    while (snap->job_count > 0)
+        vlc_cond_wait(&snap->wait, &snap->lock);
     vlc_mutex_unlock(&snap->lock);
 }
 
@@ -128,6 +134,101 @@ void vout_snapshot_Set(vout_snapshot_t *snap,
     vlc_cond_broadcast(&snap->wait);
     vlc_mutex_unlock(&snap->lock);
 }
+/* Snapshot jobs of all the vouts, run by detached threads. The threads
+ * exit as soon as there is nothing left to do. */
+typedef struct snapshot_job_t snapshot_job_t;
+struct snapshot_job_t {
+    snapshot_job_t   *next;
+    vout_snapshot_t  *snap;
+    void             (*run)(void *);
+    void             *opaque;
+};
+
+static struct {
+    vlc_mutex_t    lock;
+    snapshot_job_t *first;
+    snapshot_job_t **last;
+    unsigned       threads;
+} snapshot_pool = {
+    VLC_STATIC_MUTEX, NULL, &snapshot_pool.first, 0,
+};
+
+static void *SnapshotThread(void *data)
+{
+    VLC_UNUSED(data);
+
+    vlc_mutex_lock(&snapshot_pool.lock);
+    for (;;) {
+        snapshot_job_t *job = snapshot_pool.first;
+        if (!job)
+            break;
+        snapshot_pool.first = job->next;
+        if (!snapshot_pool.first)
+            snapshot_pool.last = &snapshot_pool.first;
+        vlc_mutex_unlock(&snapshot_pool.lock);
+
+        vout_snapshot_t *snap = job->snap;
+        job->run(job->opaque);
+        free(job);
+
+        vlc_mutex_lock(&snap->lock);
+        assert(snap->job_count > 0);
+        snap->job_count--;
+        vlc_cond_broadcast(&snap->wait);
+        vlc_mutex_unlock(&snap->lock);
+
+        vlc_mutex_lock(&snapshot_pool.lock);
+    }
+    snapshot_pool.threads--;
+    vlc_mutex_unlock(&snapshot_pool.lock);
+    return NULL;
+}
+
+int vout_snapshot_Schedule(vout_snapshot_t *snap, unsigned threads,
+                           void (*run)(void *), void *opaque)
+{
+    assert(threads > 0);
+
+    snapshot_job_t *job = malloc(sizeof(*job));
+    if (!job)
+        return VLC_ENOMEM;
+    job->next   = NULL;
+    job->snap   = snap;
+    job->run    = run;
+    job->opaque = opaque;
+
+    vlc_mutex_lock(&snap->lock);
+    const bool is_available = snap->is_available;
+    if (is_available)
+        snap->job_count++;
+    vlc_mutex_unlock(&snap->lock);
+    if (!is_available) {
+        free(job);
+        return VLC_EGENERIC;
+    }
+
+    bool run_here = false;
+
+    vlc_mutex_lock(&snapshot_pool.lock);
+    *snapshot_pool.last = job;
+    snapshot_pool.last = &job->next;
+    if (snapshot_pool.threads < threads) {
+        if (!vlc_clone_detach(NULL, SnapshotThread, NULL,
+                              VLC_THREAD_PRIORITY_LOW))
+            snapshot_pool.threads++;
+        else if (snapshot_pool.threads == 0) {
+            /* No thread at all: the caller becomes one */
+            snapshot_pool.threads++;
+            run_here = true;
+        }
+    }
+    vlc_mutex_unlock(&snapshot_pool.lock);
+
+    if (run_here)
+        SnapshotThread(NULL);
+    return VLC_SUCCESS;
+}
+
 /* */
 char *vout_snapshot_GetDirectory(void)
 {
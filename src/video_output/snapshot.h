@@ -34,12 +34,17 @@ typedef struct {
 	int         request_count;
 	picture_t   *picture;
 
+    unsigned    job_count; /* Scheduled jobs not finished yet */
 } vout_snapshot_t;
 
 /* */
 void vout_snapshot_Init(vout_snapshot_t *);
 void vout_snapshot_Clean(vout_snapshot_t *);
 
+/**
+ * It wakes up the pending snapshot requests, and waits for the jobs
+ * scheduled with vout_snapshot_Schedule() to finish.
+ */
 void vout_snapshot_End(vout_snapshot_t *);
 
 /* */
@@ -59,6 +64,17 @@ bool vout_snapshot_IsRequested(vout_snapshot_t *);
  */
 void vout_snapshot_Set(vout_snapshot_t *, const video_format_t *, const picture_t *);
 
+/**
+ * It runs the given job on one of the snapshot threads, at most threads
+ * being run at the same time for the whole process.
+ *
+ * The job must not outlive the snapshot: it is waited for by
+ * vout_snapshot_End(). It fails if vout_snapshot_End() was already called,
+ * in which case the job is not run.
+ */
+int vout_snapshot_Schedule(vout_snapshot_t *, unsigned threads,
+                           void (*job)(void *), void *opaque);
+
 /**
  * This function will return the directory used for snapshots
  */
@@ -45,6 +45,8 @@
 #include <vlc_filter.h>
 #include <vlc_vout_osd.h>
 #include <vlc_image.h>
+#include <vlc_modules.h>
+#include <vlc_memstat.h>
 
 #include <libvlc.h>
 #include "vout_internal.h"
@@ -140,6 +142,7 @@ static vout_thread_t *VoutCreate(vlc_object_t *object,
 
     /* Initialize locks */
     vlc_mutex_init(&vout->p->picture_lock);
+    vlc_cond_init(&vout->p->picture_wait);
     vlc_mutex_init(&vout->p->filter.lock);
     vlc_mutex_init(&vout->p->spu_lock);
 
@@ -257,9 +260,11 @@ static void VoutDestructor(vlc_object_t *object)
     //assert(!vout->p_module);
 
     free(vout->p->splitter_name);
+    vout_OSDWidgetsClean(vout);
 
     /* Destroy the locks */
     vlc_mutex_destroy(&vout->p->spu_lock);
+    vlc_cond_destroy(&vout->p->picture_wait);
     vlc_mutex_destroy(&vout->p->picture_lock);
     vlc_mutex_destroy(&vout->p->filter.lock);
     vout_control_Clean(&vout->p->control);
@@ -405,6 +410,32 @@ picture_t *vout_GetPicture(vout_thread_t *vout)
     return picture;
 }
 
+/**
+ * It retreives a picture from the vout, waiting until one is released if
+ * none is available yet. It returns NULL if the deadline is reached first.
+ *
+ * The same rules as for vout_GetPicture apply to the returned picture.
+ */
+picture_t *vout_WaitPicture(vout_thread_t *vout, mtime_t deadline)
+{
+    picture_t *picture;
+
+    vlc_mutex_lock(&vout->p->picture_lock);
+    mutex_cleanup_push(&vout->p->picture_lock);
+    while ((picture = picture_pool_Get(vout->p->decoder_pool)) == NULL)
+        if (vlc_cond_timedwait(&vout->p->picture_wait,
+                               &vout->p->picture_lock, deadline))
+            break;
+    vlc_cleanup_pop();
+    if (picture) {
+        picture_Reset(picture);
+        VideoFormatCopyCropAr(&picture->format, &vout->p->original);
+    }
+    vlc_mutex_unlock(&vout->p->picture_lock);
+
+    return picture;
+}
+
 /**
  * It gives to the vout a picture to be displayed.
  *
@@ -433,6 +464,7 @@ void vout_ReleasePicture(vout_thread_t *vout, picture_t *picture)
     vlc_mutex_lock(&vout->p->picture_lock);
 
     picture_Release(picture);
+    vlc_cond_signal(&vout->p->picture_wait);
 
     vlc_mutex_unlock(&vout->p->picture_lock);
 
@@ -453,10 +485,11 @@ void vout_HoldPicture(vout_thread_t *vout, picture_t *picture)
 }
 
 /* */
-int vout_GetSnapshot(vout_thread_t *vout,
-                     block_t **image_dst, picture_t **picture_dst,
-                     video_format_t *fmt,
-                     const char *type, mtime_t timeout)
+int vout_ExportSnapshot(vout_thread_t *vout,
+                        block_t **image_dst, picture_t **picture_dst,
+                        video_format_t *fmt, const char *type,
+                        int override_width, int override_height,
+                        mtime_t timeout)
 {
     picture_t *picture = vout_snapshot_Get(&vout->p->snapshot, timeout);
     if (!picture) {
@@ -469,9 +502,6 @@ int vout_GetSnapshot(vout_thread_t *vout,
         if (type && image_Type2Fourcc(type))
             codec = image_Type2Fourcc(type);
 
-        const int override_width  = var_InheritInteger(vout, "snapshot-width");
-        const int override_height = var_InheritInteger(vout, "snapshot-height");
-
         if (picture_Export(VLC_OBJECT(vout), image_dst, fmt,
                            picture, codec, override_width, override_height)) {
             msg_Err(vout, "Failed to convert image for snapshot");
@@ -486,6 +516,17 @@ int vout_GetSnapshot(vout_thread_t *vout,
     return VLC_SUCCESS;
 }
 
+int vout_GetSnapshot(vout_thread_t *vout,
+                     block_t **image_dst, picture_t **picture_dst,
+                     video_format_t *fmt,
+                     const char *type, mtime_t timeout)
+{
+    return vout_ExportSnapshot(vout, image_dst, picture_dst, fmt, type,
+                               var_InheritInteger(vout, "snapshot-width"),
+                               var_InheritInteger(vout, "snapshot-height"),
+                               timeout);
+}
+
 /* vout_Control* are usable by anyone at anytime */
 void vout_ControlChangeFullscreen(vout_thread_t *vout, bool fullscreen)
 {
@@ -829,7 +870,9 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool is_
         } else {
             decoded = picture_fifo_Pop(vout->p->decoder_fifo);
             if (is_late_dropped && decoded && !decoded->b_force) {
-                const mtime_t predicted = mdate() + 0; /* TODO improve */
+                /* Dropped before being filtered and rendered if it would
+                 * be too late even with the fastest rendering */
+                const mtime_t predicted = mdate() + vout_chrono_GetLow(&vout->p->render);
                 const mtime_t late = predicted - decoded->date;
                 if (late > VOUT_DISPLAY_LATE_THRESHOLD) {
                     msg_Warn(vout, "picture is too late to be displayed (missing %d ms)", (int)(late/1000));
@@ -872,6 +915,52 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool is_
     return VLC_SUCCESS;
 }
 
+/**
+ * It returns the date at which a picture should be sent to the display.
+ *
+ * When the refresh period of the display is known, the picture is sent
+ * half a period before the refresh nearest to its date, the refreshes being
+ * aligned on the end of the last display. It keeps a regular cadence (like
+ * 3:2 for 24 fps on 60 Hz) instead of jittering around the refreshes.
+ */
+static mtime_t ThreadDisplayPacedDate(vout_thread_t *vout, mtime_t date)
+{
+    const mtime_t period = vout->p->pacing.period;
+    const mtime_t vsync  = vout->p->pacing.vsync;
+
+    if (period <= 0 || vsync <= VLC_TS_INVALID || date <= vsync)
+        return date;
+
+    const mtime_t count = (date - vsync + period / 2) / period;
+    return vsync + count * period - period / 2;
+}
+
+static void ThreadDisplayPacingUpdate(vout_thread_t *vout, mtime_t date,
+                                      bool is_forced)
+{
+    const mtime_t period = vout->p->pacing.period;
+
+    if (is_forced) {
+        vout->p->pacing.last_date = VLC_TS_INVALID;
+        return;
+    }
+
+    /* Rendered but displayed late anyway */
+    if (vout->p->pacing.vsync - date > VOUT_DISPLAY_LATE_THRESHOLD + period)
+        vout->p->pacing.late++;
+
+    /* Displayed more than a refresh away from the expected interval */
+    if (vout->p->pacing.last_date > VLC_TS_INVALID &&
+        date > vout->p->pacing.last_date) {
+        const mtime_t error = (vout->p->displayed.date - vout->p->pacing.last_displayed) -
+                              (date - vout->p->pacing.last_date);
+        if (llabs(error) > __MAX(period, VOUT_MWAIT_TOLERANCE))
+            vout->p->pacing.judder++;
+    }
+    vout->p->pacing.last_date      = date;
+    vout->p->pacing.last_displayed = vout->p->displayed.date;
+}
+
 static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 {
     vout_thread_sys_t *sys = vout->p;
@@ -1043,17 +1132,26 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     if (delay < 1000)
         msg_Warn(vout, "picture is late (%lld ms)", delay / 1000);
 #endif
+    const mtime_t date = direct->date;
     if (!is_forced)
-        mwait(direct->date);
+        mwait(ThreadDisplayPacedDate(vout, date));
 
     /* Display the direct buffer returned by vout_RenderPicture */
     vout->p->displayed.date = mdate();
+    const mtime_t trace = vlc_trace_Begin();
     vout_display_Display(vd,
                          sys->display.filtered ? sys->display.filtered
                                                 : direct,
                          subpic);
+    /* The display of a splitter is a wrapper, without any module */
+    vlc_trace_End(trace, "vout", "display",
+                  vd->module ? module_get_object(vd->module) : NULL);
     sys->display.filtered = NULL;
 
+    /* The display may block until the refresh */
+    vout->p->pacing.vsync = mdate();
+    ThreadDisplayPacingUpdate(vout, date, is_forced);
+
     vout_statistic_AddDisplayed(&vout->p->statistic, 1);
 
     return VLC_SUCCESS;
@@ -1138,6 +1236,8 @@ static void ThreadManage(vout_thread_t *vout,
 
     const bool picture_interlaced = vout->p->displayed.is_interlaced;
 
+    /* Displayed, dropped and flushed pictures went back to the pool */
+    vlc_cond_broadcast(&vout->p->picture_wait);
     vlc_mutex_unlock(&vout->p->picture_lock);
 
     /* Deinterlacing */
@@ -1346,12 +1446,27 @@ static int ThreadStart(vout_thread_t *vout, const vout_display_state_t *state)
         state = &state_default;
     }
 
+    vout->p->pacing.period         = 0;
+    vout->p->pacing.vsync          = VLC_TS_INVALID;
+    vout->p->pacing.last_date      = VLC_TS_INVALID;
+    vout->p->pacing.last_displayed = VLC_TS_INVALID;
+    vout->p->pacing.judder         = 0;
+    vout->p->pacing.late           = 0;
+
     if (vout_OpenWrapper(vout, vout->p->splitter_name, state))
         return VLC_EGENERIC;
     if (vout_InitWrapper(vout))
         return VLC_EGENERIC;
     assert(vout->p->decoder_pool);
 
+    vout->p->pacing.period = vout->p->display.vd->info.refresh_period;
+    if (vout->p->pacing.period <= 0) {
+        const float rate = var_InheritFloat(vout, "display-refresh-rate");
+        vout->p->pacing.period = rate > 0 ? CLOCK_FREQ / rate : 0;
+    }
+    if (vout->p->pacing.period > 0)
+        msg_Dbg(vout, "display refresh period: %"PRId64" us", vout->p->pacing.period);
+
     vout->p->displayed.current       = NULL;
     vout->p->displayed.next          = NULL;
     vout->p->displayed.decoded       = NULL;
@@ -1376,6 +1491,8 @@ static void ThreadStop(vout_thread_t *vout, vout_display_state_t *state)
 
     /* Destroy translation tables */
     if (vout->p->display.vd) {
+        msg_Dbg(vout, "pacing: %u judder events, %u pictures displayed late",
+                vout->p->pacing.judder, vout->p->pacing.late);
         if (vout->p->decoder_pool) {
             ThreadFlush(vout, true, INT64_MAX);
             vout_EndWrapper(vout);
@@ -1468,6 +1585,9 @@ static void *Thread(void *object)
 {
     vout_thread_t *vout = object;
 
+    /* The filters and the display share the account of the video output */
+    vlc_mem_SetAccount("video output");
+
     vout_interlacing_support_t interlacing = {
         .is_interlaced = false,
         .date = mdate(),
@@ -36,6 +36,8 @@
 
 #include <vlc_filter.h>
 
+#include "vout_internal.h"
+
 #define STYLE_EMPTY 0
 #define STYLE_FILLED 1
 
@@ -117,28 +119,36 @@ static void DrawTriangle(subpicture_region_t *r, int fill,
     }
 }
 
+static const video_palette_t osd_palette = {
+    .i_entries = 2,
+    .palette = {
+        [0] = { 0xff, 0x80, 0x80, 0x00 },
+        [1] = { 0xff, 0x80, 0x80, 0xff },
+    },
+};
+
+static void OSDFormat(video_format_t *fmt, vlc_fourcc_t chroma,
+                      int width, int height)
+{
+    video_format_Init(fmt, chroma);
+    fmt->i_width          =
+    fmt->i_visible_width  = width;
+    fmt->i_height         =
+    fmt->i_visible_height = height;
+    fmt->i_sar_num        = 1;
+    fmt->i_sar_den        = 1;
+}
+
 /**
  * Create a region with a white transparent picture.
  */
 static subpicture_region_t *OSDRegion(int x, int y, int width, int height)
 {
-    video_palette_t palette = {
-        .i_entries = 2,
-        .palette = {
-            [0] = { 0xff, 0x80, 0x80, 0x00 },
-            [1] = { 0xff, 0x80, 0x80, 0xff },
-        },
-    };
-
+    video_palette_t palette = osd_palette;
     video_format_t fmt;
-    video_format_Init(&fmt, VLC_CODEC_YUVP);
-    fmt.i_width          =
-    fmt.i_visible_width  = width;
-    fmt.i_height         =
-    fmt.i_visible_height = height;
-    fmt.i_sar_num        = 1;
-    fmt.i_sar_den        = 1;
-    fmt.p_palette        = &palette;
+
+    OSDFormat(&fmt, VLC_CODEC_YUVP, width, height);
+    fmt.p_palette = &palette;
 
     subpicture_region_t *r = subpicture_region_New(&fmt);
     if (!r)
@@ -241,11 +251,95 @@ static subpicture_region_t *OSDIcon(int type, const video_format_t *fmt)
     return r;
 }
 
+/**
+ * Create a region sharing an already drawn picture.
+ */
+static subpicture_region_t *OSDRegionShared(int x, int y, picture_t *picture)
+{
+    video_format_t fmt;
+
+    /* A text region comes without any picture */
+    OSDFormat(&fmt, VLC_CODEC_TEXT, picture->format.i_width,
+              picture->format.i_height);
+    subpicture_region_t *r = subpicture_region_New(&fmt);
+    if (!r)
+        return NULL;
+
+    r->fmt.p_palette = malloc(sizeof(*r->fmt.p_palette));
+    if (!r->fmt.p_palette) {
+        subpicture_region_Delete(r);
+        return NULL;
+    }
+    *r->fmt.p_palette = osd_palette;
+    r->fmt.i_chroma   = VLC_CODEC_YUVP;
+    r->p_picture      = picture_Hold(picture);
+    r->i_x = x;
+    r->i_y = y;
+    return r;
+}
+
 struct subpicture_updater_sys_t {
+    vout_thread_t *vout;
     int type;
     int position;
 };
 
+/* The widgets are redrawn for each update, while the sliders are dragged
+ * back and forth over the same values: the last ones are kept. */
+static bool OSDWidgetMatch(const vout_osd_widget_t *w,
+                           const subpicture_updater_sys_t *sys,
+                           const video_format_t *fmt)
+{
+    return w->picture && w->type == sys->type && w->position == sys->position
+        && w->fmt.i_width == fmt->i_width && w->fmt.i_height == fmt->i_height
+        && w->fmt.i_visible_width == fmt->i_visible_width
+        && w->fmt.i_visible_height == fmt->i_visible_height
+        && w->fmt.i_x_offset == fmt->i_x_offset
+        && w->fmt.i_y_offset == fmt->i_y_offset;
+}
+
+static subpicture_region_t *OSDWidgetCacheGet(subpicture_updater_sys_t *sys,
+                                              const video_format_t *fmt)
+{
+    vout_thread_sys_t *vsys = sys->vout->p;
+
+    for (unsigned i = 0; i < VOUT_OSD_CACHE; i++) {
+        const vout_osd_widget_t *w = &vsys->osd_cache[i];
+
+        if (OSDWidgetMatch(w, sys, fmt))
+            return OSDRegionShared(w->x, w->y, w->picture);
+    }
+    return NULL;
+}
+
+static void OSDWidgetCachePut(subpicture_updater_sys_t *sys,
+                              const video_format_t *fmt,
+                              const subpicture_region_t *r)
+{
+    vout_thread_sys_t *vsys = sys->vout->p;
+    vout_osd_widget_t *w = &vsys->osd_cache[vsys->osd_cache_next];
+
+    vsys->osd_cache_next = (vsys->osd_cache_next + 1) % VOUT_OSD_CACHE;
+    if (w->picture)
+        picture_Release(w->picture);
+    w->type     = sys->type;
+    w->position = sys->position;
+    w->fmt      = *fmt;
+    w->fmt.p_palette = NULL;
+    w->x        = r->i_x;
+    w->y        = r->i_y;
+    w->picture  = picture_Hold(r->p_picture);
+}
+
+void vout_OSDWidgetsClean(vout_thread_t *vout)
+{
+    for (unsigned i = 0; i < VOUT_OSD_CACHE; i++) {
+        if (vout->p->osd_cache[i].picture)
+            picture_Release(vout->p->osd_cache[i].picture);
+        vout->p->osd_cache[i].picture = NULL;
+    }
+}
+
 static int OSDWidgetValidate(subpicture_t *subpic,
                            bool has_src_changed, const video_format_t *fmt_src,
                            bool has_dst_changed, const video_format_t *fmt_dst,
@@ -277,10 +371,16 @@ static void OSDWidgetUpdate(subpicture_t *subpic,
 
     subpic->i_original_picture_width  = fmt.i_width;
     subpic->i_original_picture_height = fmt.i_height;
+    subpic->p_region = OSDWidgetCacheGet(sys, &fmt);
+    if (subpic->p_region)
+        return;
+
     if (sys->type == OSD_HOR_SLIDER || sys->type == OSD_VERT_SLIDER)
         subpic->p_region = OSDSlider(sys->type, sys->position, &fmt);
     else
         subpic->p_region = OSDIcon(sys->type, &fmt);
+    if (subpic->p_region)
+        OSDWidgetCachePut(sys, &fmt, subpic->p_region);
 }
 
 static void OSDWidgetDestroy(subpicture_t *subpic)
@@ -298,6 +398,7 @@ static void OSDWidget(vout_thread_t *vout, int channel, int type, int position)
     subpicture_updater_sys_t *sys = malloc(sizeof(*sys));
     if (!sys)
         return;
+    sys->vout     = vout;
     sys->type     = type;
     sys->position = position;
 
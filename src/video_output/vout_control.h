@@ -55,6 +55,12 @@ void vout_Flush( vout_thread_t *p_vout, mtime_t i_date );
  */
 void vout_FixLeaks( vout_thread_t *p_vout );
 
+/**
+ * This function will wait until a picture is available, like
+ * vout_GetPicture, or until the given deadline is reached (returning NULL).
+ */
+picture_t *vout_WaitPicture( vout_thread_t *p_vout, mtime_t i_deadline );
+
 /*
  * Reset the states of the vout.
  */
@@ -43,6 +43,20 @@
  */
 #define VOUT_MAX_PICTURES (20)
 
+/* Number of OSD widget pictures kept for reuse */
+#define VOUT_OSD_CACHE (16)
+
+/* OSD widget already drawn (see video_widgets.c) */
+typedef struct {
+    int         type;
+    int         position;
+    video_format_t fmt;     /* of the video, the geometry of the widget
+                               only depends on it */
+    int         x;          /* Position of the widget */
+    int         y;
+    picture_t   *picture;
+} vout_osd_widget_t;
+
 /* */
 struct vout_thread_sys_t
 {
@@ -97,6 +111,16 @@ struct vout_thread_sys_t
         picture_t   *next;
     } displayed;
 
+    /* Pacing of the display on its refreshes */
+    struct {
+        mtime_t     period;         /* 0 if unknown */
+        mtime_t     vsync;          /* End of the last display */
+        mtime_t     last_date;      /* Date of the last paced picture */
+        mtime_t     last_displayed; /* and when it was displayed */
+        unsigned    judder;
+        unsigned    late;
+    } pacing;
+
     struct {
         mtime_t     last;
         mtime_t     timestamp;
@@ -107,6 +131,10 @@ struct vout_thread_sys_t
         mtime_t     date;
     } pause;
 
+    /* OSD widgets already drawn, only used by the vout thread */
+    vout_osd_widget_t osd_cache[VOUT_OSD_CACHE];
+    unsigned          osd_cache_next;
+
     /* OSD title configuration */
     struct {
         bool        show;
@@ -131,6 +159,7 @@ struct vout_thread_sys_t
 
     /* */
     vlc_mutex_t     picture_lock;                 /**< picture heap lock */
+    vlc_cond_t      picture_wait;      /**< signaled when pictures are freed */
     picture_pool_t  *private_pool;
     picture_pool_t  *display_pool;
     picture_pool_t  *decoder_pool;
@@ -155,6 +184,12 @@ void vout_ControlChangeSubMargin(vout_thread_t *, int);
 /* */
 void vout_IntfInit( vout_thread_t * );
 
+/* Same as vout_GetSnapshot() with the snapshot size given explicitly */
+int vout_ExportSnapshot(vout_thread_t *, block_t **, picture_t **,
+                        video_format_t *, const char *type,
+                        int width, int height, mtime_t timeout);
+void vout_OSDWidgetsClean(vout_thread_t *);
+
 /* */
 int  vout_OpenWrapper (vout_thread_t *, const char *, const vout_display_state_t *);
 void vout_CloseWrapper(vout_thread_t *, vout_display_state_t *);
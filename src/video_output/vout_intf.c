@@ -377,14 +377,51 @@ static void VoutOsdSnapshot( vout_thread_t *p_vout, picture_t *p_pic, const char
     }
 }
 
+/* Parameters of a snapshot, as set when it was requested */
+typedef struct
+{
+    vout_thread_t *p_vout;
+    char *psz_path;
+    char *psz_format;
+    char *psz_prefix;
+    int   i_width;
+    int   i_height;
+} vout_snapshot_request_t;
+
+static vout_snapshot_request_t *VoutSnapshotRequestNew( vout_thread_t *p_vout )
+{
+    vout_snapshot_request_t *p_req = malloc( sizeof(*p_req) );
+    if( !p_req )
+        return NULL;
+
+    p_req->p_vout = p_vout;
+    p_req->psz_path = var_InheritString( p_vout, "snapshot-path" );
+    p_req->psz_format = var_InheritString( p_vout, "snapshot-format" );
+    p_req->psz_prefix = var_InheritString( p_vout, "snapshot-prefix" );
+    p_req->i_width = var_InheritInteger( p_vout, "snapshot-width" );
+    p_req->i_height = var_InheritInteger( p_vout, "snapshot-height" );
+    return p_req;
+}
+
+static void VoutSnapshotRequestDelete( vout_snapshot_request_t *p_req )
+{
+    free( p_req->psz_prefix );
+    free( p_req->psz_format );
+    free( p_req->psz_path );
+    free( p_req );
+}
+
+/* Serializes the choice of the file names, and the snapshot-num updates */
+static vlc_mutex_t snapshot_save_lock = VLC_STATIC_MUTEX;
+
 /**
  * This function will handle a snapshot request
  */
-static void VoutSaveSnapshot( vout_thread_t *p_vout )
+static void VoutSaveSnapshot( void *p_data )
 {
-    char *psz_path = var_InheritString( p_vout, "snapshot-path" );
-    char *psz_format = var_InheritString( p_vout, "snapshot-format" );
-    char *psz_prefix = var_InheritString( p_vout, "snapshot-prefix" );
+    vout_snapshot_request_t *p_req = p_data;
+    vout_thread_t *p_vout = p_req->p_vout;
+    char *psz_path = p_req->psz_path;
 
     /* */
     picture_t *p_picture;
@@ -393,7 +430,9 @@ static void VoutSaveSnapshot( vout_thread_t *p_vout )
 
     /* 500ms timeout
      * XXX it will cause trouble with low fps video (< 2fps) */
-    if( vout_GetSnapshot( p_vout, &p_image, &p_picture, &fmt, psz_format, 500*1000 ) )
+    if( vout_ExportSnapshot( p_vout, &p_image, &p_picture, &fmt,
+                             p_req->psz_format, p_req->i_width,
+                             p_req->i_height, 500*1000 ) )
     {
         p_picture = NULL;
         p_image = NULL;
@@ -402,7 +441,7 @@ static void VoutSaveSnapshot( vout_thread_t *p_vout )
 
     if( !psz_path )
     {
-        psz_path = vout_snapshot_GetDirectory();
+        psz_path = p_req->psz_path = vout_snapshot_GetDirectory();
         if( !psz_path )
         {
             msg_Err( p_vout, "no path specified for snapshots" );
@@ -413,18 +452,24 @@ static void VoutSaveSnapshot( vout_thread_t *p_vout )
     vout_snapshot_save_cfg_t cfg;
     memset( &cfg, 0, sizeof(cfg) );
     cfg.is_sequential = var_InheritBool( p_vout, "snapshot-sequential" );
-    cfg.sequence = var_GetInteger( p_vout, "snapshot-num" );
     cfg.path = psz_path;
-    cfg.format = psz_format;
-    cfg.prefix_fmt = psz_prefix;
+    cfg.format = p_req->psz_format;
+    cfg.prefix_fmt = p_req->psz_prefix;
 
     char *psz_filename;
     int  i_sequence;
+
+    vlc_mutex_lock( &snapshot_save_lock );
+    cfg.sequence = var_GetInteger( p_vout, "snapshot-num" );
     if (vout_snapshot_SaveImage( &psz_filename, &i_sequence,
                                  p_image, VLC_OBJECT(p_vout), &cfg ) )
+    {
+        vlc_mutex_unlock( &snapshot_save_lock );
         goto exit;
+    }
     if( cfg.is_sequential )
         var_SetInteger( p_vout, "snapshot-num", i_sequence + 1 );
+    vlc_mutex_unlock( &snapshot_save_lock );
 
     VoutOsdSnapshot( p_vout, p_picture, psz_filename );
 
@@ -438,9 +483,7 @@ exit:
         block_Release( p_image );
     if( p_picture )
         picture_Release( p_picture );
-    free( psz_prefix );
-    free( psz_format );
-    free( psz_path );
+    VoutSnapshotRequestDelete( p_req );
 }
 
 /*****************************************************************************
@@ -640,7 +683,16 @@ static int SnapshotCallback( vlc_object_t *p_this, char const *psz_cmd,
     VLC_UNUSED(psz_cmd); VLC_UNUSED(oldval);
     VLC_UNUSED(newval); VLC_UNUSED(p_data);
 
-    VoutSaveSnapshot( p_vout );
+    vout_snapshot_request_t *p_req = VoutSnapshotRequestNew( p_vout );
+    if( !p_req )
+        return VLC_ENOMEM;
+
+    /* Encode and save the snapshot in the background if possible */
+    const int i_threads = var_InheritInteger( p_vout, "snapshot-threads" );
+    if( i_threads <= 0
+     || vout_snapshot_Schedule( &p_vout->p->snapshot, i_threads,
+                                VoutSaveSnapshot, p_req ) )
+        VoutSaveSnapshot( p_req );
     return VLC_SUCCESS;
 }
 
@@ -93,6 +93,14 @@ struct spu_private_t {
 
     /* */
     mtime_t last_sort_date;
+
+    /* Region cache statistics */
+    struct {
+        unsigned rendered;        /**< regions output */
+        unsigned text_rendered;   /**< text renderer invocations */
+        unsigned scaled;          /**< scaled pictures created */
+        unsigned scale_reused;    /**< scaled pictures reused */
+    } stats;
 };
 
 /*****************************************************************************
@@ -692,6 +700,7 @@ static void SpuRenderRegion(spu_t *spu,
         SpuRenderText(spu, &restore_text, region,
                       chroma_list,
                       render_date - subpic->i_start);
+        sys->stats.text_rendered++;
 
         /* Check if the rendering has failed ... */
         if (region->fmt.i_chroma == VLC_CODEC_TEXT)
@@ -809,7 +818,9 @@ static void SpuRenderRegion(spu_t *spu,
         }
 
         /* Scale if needed into cache */
-        if (!region->p_private && dst_width > 0 && dst_height > 0) {
+        if (region->p_private)
+            sys->stats.scale_reused++;
+        else if (dst_width > 0 && dst_height > 0) {
             filter_t *scale = sys->scale;
 
             picture_t *picture = region->p_picture;
@@ -860,6 +871,7 @@ static void SpuRenderRegion(spu_t *spu,
 
             /* */
             if (picture) {
+                sys->stats.scaled++;
                 region->p_private = subpicture_region_private_New(&picture->format);
                 if (region->p_private) {
                     region->p_private->p_picture = picture;
@@ -931,6 +943,7 @@ static void SpuRenderRegion(spu_t *spu,
                                    (subpic->i_stop - fade_start);
         }
         dst->i_alpha   = fade_alpha * subpic->i_alpha * region->i_alpha / 65025;
+        sys->stats.rendered++;
     }
 
 exit:
@@ -1257,6 +1270,11 @@ spu_t *spu_Create(vlc_object_t *object)
     /* */
     sys->last_sort_date = -1;
 
+    sys->stats.rendered      = 0;
+    sys->stats.text_rendered = 0;
+    sys->stats.scaled        = 0;
+    sys->stats.scale_reused  = 0;
+
     return spu;
 }
 
@@ -1269,6 +1287,11 @@ void spu_Destroy(spu_t *spu)
 {
     spu_private_t *sys = spu->p;
 
+    msg_Dbg(spu, "%u regions output, %u text renderings, "
+            "%u scalings, %u scaled pictures reused",
+            sys->stats.rendered, sys->stats.text_rendered,
+            sys->stats.scaled, sys->stats.scale_reused);
+
     if (sys->text)
         FilterRelease(sys->text);
 
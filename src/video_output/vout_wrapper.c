@@ -177,6 +177,11 @@ void vout_EndWrapper(vout_thread_t *vout)
         picture_pool_Delete(sys->private_pool);
 
     if (sys->decoder_pool != sys->display_pool) {
+        int used_max;
+        picture_pool_GetStats(sys->decoder_pool, NULL, &used_max, NULL);
+        msg_Dbg(vout, "decoder pool: %d pictures, at most %d used",
+                picture_pool_GetSize(sys->decoder_pool), used_max);
+
         NoDrClean(vout);
         picture_pool_Delete(sys->decoder_pool);
     }
@@ -121,11 +121,104 @@ static void test_media_list (const char ** argv, int argc)
     libvlc_release (vlc);
 }
 
+static void count_event (const libvlc_event_t *event, void *data)
+{
+    int *counts = data;
+
+    switch (event->type)
+    {
+        case libvlc_MediaListItemAdded:
+            counts[0]++;
+            break;
+        case libvlc_MediaListItemsAdded:
+            counts[1] += event->u.media_list_items_added.count;
+            break;
+        case libvlc_MediaListItemsDeleted:
+            counts[2] += event->u.media_list_items_deleted.count;
+            break;
+    }
+}
+
+static void test_media_list_bulk (const char ** argv, int argc)
+{
+    libvlc_instance_t *vlc;
+    libvlc_media_list_t *ml;
+    libvlc_media_t *mds[1000], *md;
+    libvlc_event_manager_t *em;
+    int counts[3] = { 0, 0, 0 };
+    int ret;
+
+    log ("Testing media_list bulk operations\n");
+
+    vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    ml = libvlc_media_list_new (vlc);
+    assert (ml != NULL);
+
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        mds[i] = libvlc_media_new_path (vlc, "/dev/null");
+        assert (mds[i] != NULL);
+    }
+
+    em = libvlc_media_list_event_manager (ml);
+    libvlc_event_attach (em, libvlc_MediaListItemsAdded, count_event, counts);
+    libvlc_event_attach (em, libvlc_MediaListItemsDeleted, count_event, counts);
+
+    /* Items are only announced as a range if nobody listens to each */
+    ret = libvlc_media_list_add_medias (ml, mds, 500);
+    assert (!ret);
+    assert (libvlc_media_list_count (ml) == 500);
+    assert (counts[0] == 0 && counts[1] == 500);
+    for (int i = 0; i < 500; i++)
+        assert (libvlc_media_list_index_of_item (ml, mds[i]) == i);
+
+    libvlc_event_attach (em, libvlc_MediaListItemAdded, count_event, counts);
+    ret = libvlc_media_list_insert_medias (ml, mds + 500, 500, 100);
+    assert (!ret);
+    assert (libvlc_media_list_count (ml) == 1000);
+    assert (counts[0] == 500 && counts[1] == 1000);
+    assert (libvlc_media_list_index_of_item (ml, mds[99]) == 99);
+    assert (libvlc_media_list_index_of_item (ml, mds[500]) == 100);
+    assert (libvlc_media_list_index_of_item (ml, mds[100]) == 600);
+
+    /* The first position of a duplicate is returned */
+    ret = libvlc_media_list_add_media (ml, mds[0]);
+    assert (!ret);
+    assert (libvlc_media_list_index_of_item (ml, mds[0]) == 0);
+
+    ret = libvlc_media_list_remove_range (ml, 0, 101);
+    assert (!ret);
+    assert (counts[2] == 101);
+    assert (libvlc_media_list_count (ml) == 900);
+    assert (libvlc_media_list_index_of_item (ml, mds[501]) == 0);
+    assert (libvlc_media_list_index_of_item (ml, mds[0]) == 899);
+    assert (libvlc_media_list_index_of_item (ml, mds[500]) == -1);
+
+    md = libvlc_media_list_item_at_index (ml, 499);
+    assert (md == mds[100]);
+    libvlc_media_release (md);
+
+    ret = libvlc_media_list_remove_range (ml, 800, 101);
+    assert (ret == -1);
+    ret = libvlc_media_list_insert_medias (ml, mds, 1, 901);
+    assert (ret == -1);
+
+    for (unsigned i = 0; i < 1000; i++)
+        libvlc_media_release (mds[i]);
+
+    libvlc_media_list_release (ml);
+
+    libvlc_release (vlc);
+}
+
 int main (void)
 {
     test_init();
 
     test_media_list (test_defaults_args, test_defaults_nargs);
+    test_media_list_bulk (test_defaults_args, test_defaults_nargs);
 
     return 0;
 }
@@ -0,0 +1,1377 @@
+/*****************************************************************************
+ * bench.c: benchmark runner for filter, packetizer and pipeline modules
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * This runs one module on synthetic input for a number of iterations and
+ * prints one JSON object per line with its throughput and the percentiles
+ * of the duration of each call, for instance:
+ *
+ *   vlc_bench -n 200 -x c,sse2,avx2 video "adjust{hue=20}"
+ *   vlc_bench -c I420 -o RV32 chroma any
+ *   vlc_bench -r 48000 -R 44100 resampler ugly
+ *   vlc_bench -f h264 -i sample.264 packetizer any
+ *   vlc_bench -n 100000 -V "deinterlace{mode=yadif}" pipeline a.mkv b.ts
+ *
+ * Each CPU variant is run in its own process, with the capabilities detected
+ * by the core restricted through the VLC_CPU_MASK environment variable.
+ *
+ * The pipeline kind runs the demuxer, packetizers, decoders and video
+ * filters of each input file, without any clock: the pictures, audio blocks
+ * and subpictures are dropped as soon as they are out. Besides the frame
+ * rate, it reports the time and the allocations of each stage.
+ */
+
+#define MODULE_STRING "bench"
+
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_cpu.h>
+#include <vlc_filter.h>
+#include <vlc_picture_pool.h>
+#include <vlc_aout.h>
+#include <vlc_block.h>
+#include <vlc_codec.h>
+#include <vlc_modules.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+#include <vlc_subpicture.h>
+#include <vlc_url.h>
+#include <vlc_memstat.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+typedef struct
+{
+    const char *kind;
+    const char *module;     /* with its configuration, "any" for none */
+    const char *cpu;
+    unsigned    iterations;
+
+    /* Video */
+    vlc_fourcc_t chroma_in;
+    vlc_fourcc_t chroma_out;
+    unsigned     width;
+    unsigned     height;
+
+    /* Audio */
+    vlc_fourcc_t format_in;
+    vlc_fourcc_t format_out;
+    unsigned     rate_in;
+    unsigned     rate_out;
+    unsigned     channels;
+    unsigned     samples;
+
+    /* Packetizer */
+    const char  *codec;
+    const char  *input;
+    size_t       block_size;
+
+    /* Pipeline */
+    const char  *filters;   /* video filter chain, or NULL */
+
+    int          argc;
+    const char *const *argv;
+} bench_t;
+
+typedef struct
+{
+    double   *durations; /* us */
+    unsigned count;
+    double   units;      /* pixels, samples, bytes or frames processed */
+    char     extra[1024]; /* more JSON members, if any */
+} bench_result_t;
+
+static double Now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void Record( bench_result_t *p_res, double start, double units )
+{
+    p_res->durations[p_res->count++] = Now() - start;
+    p_res->units += units;
+}
+
+static void FillRandom( uint8_t *p, size_t size, unsigned *seed )
+{
+    for( size_t i = 0; i < size; i++ )
+        p[i] = (*seed = *seed * 1103515245 + 12345) >> 16;
+}
+
+static void Randomize( picture_t *p_pic, unsigned *seed )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        FillRandom( p_pic->p[i].p_pixels,
+                    p_pic->p[i].i_lines * p_pic->p[i].i_pitch, seed );
+}
+
+/* NULL lets the core pick the module */
+static const char *ModuleName( const bench_t *p_bench )
+{
+    return strcmp( p_bench->module, "any" ) ? p_bench->module : NULL;
+}
+
+/*****************************************************************************
+ * Video filters and chroma converters
+ *****************************************************************************/
+static picture_t *VideoBufferNew( filter_t *p_filter )
+{
+    return picture_pool_Get( (picture_pool_t *)p_filter->p_owner );
+}
+
+static void VideoBufferDel( filter_t *p_filter, picture_t *p_pic )
+{
+    VLC_UNUSED(p_filter);
+    picture_Release( p_pic );
+}
+
+static int VideoAllocatorInit( filter_t *p_filter, void *p_data )
+{
+    p_filter->p_owner = p_data;
+    p_filter->pf_video_buffer_new = VideoBufferNew;
+    p_filter->pf_video_buffer_del = VideoBufferDel;
+    return VLC_SUCCESS;
+}
+
+#define BENCH_PICTURES 8 /* More than any filter history */
+
+static int BenchVideo( vlc_object_t *p_obj, const bench_t *p_bench,
+                       bool b_convert, bench_result_t *p_res )
+{
+    es_format_t fmt_in, fmt_out;
+    const vlc_fourcc_t i_out = b_convert ? p_bench->chroma_out
+                                         : p_bench->chroma_in;
+
+    es_format_Init( &fmt_in, VIDEO_ES, p_bench->chroma_in );
+    video_format_Setup( &fmt_in.video, p_bench->chroma_in,
+                        p_bench->width, p_bench->height, 1, 1 );
+    es_format_Init( &fmt_out, VIDEO_ES, i_out );
+    video_format_Setup( &fmt_out.video, i_out,
+                        p_bench->width, p_bench->height, 1, 1 );
+
+    picture_pool_t *p_pool = picture_pool_NewFromFormat( &fmt_out.video,
+                                                         BENCH_PICTURES );
+    picture_t *pp_in[BENCH_PICTURES];
+    unsigned seed = 1;
+
+    for( unsigned i = 0; i < BENCH_PICTURES; i++ )
+    {
+        pp_in[i] = picture_NewFromFormat( &fmt_in.video );
+        assert( pp_in[i] != NULL );
+        Randomize( pp_in[i], &seed );
+    }
+    assert( p_pool != NULL );
+
+    filter_chain_t *p_chain = filter_chain_New( p_obj, "video filter2", false,
+                                                VideoAllocatorInit, NULL,
+                                                p_pool );
+    filter_chain_Reset( p_chain, &fmt_in, &fmt_out );
+
+    int i_ret = VLC_EGENERIC;
+    if( b_convert )
+    {
+        if( filter_chain_AppendFilter( p_chain, ModuleName( p_bench ), NULL,
+                                       &fmt_in, &fmt_out ) != NULL )
+            i_ret = VLC_SUCCESS;
+    }
+    else if( ModuleName( p_bench ) != NULL
+          && filter_chain_AppendFromString( p_chain, p_bench->module ) >= 0 )
+        i_ret = VLC_SUCCESS;
+
+    const double i_pixels = p_bench->width * p_bench->height;
+    for( unsigned i = 0; i_ret == VLC_SUCCESS && i < p_bench->iterations; i++ )
+    {
+        picture_t *p_pic = picture_Hold( pp_in[i % BENCH_PICTURES] );
+
+        p_pic->date = VLC_TS_0 + i * 40000;
+        p_pic->b_progressive = false;
+        p_pic->b_top_field_first = true;
+        p_pic->i_nb_fields = 2;
+
+        const double start = Now();
+        picture_t *p_out = filter_chain_VideoFilter( p_chain, p_pic );
+        Record( p_res, start, i_pixels );
+
+        while( p_out != NULL )
+        {
+            picture_t *p_next = p_out->p_next;
+            p_out->p_next = NULL;
+            picture_Release( p_out );
+            p_out = p_next;
+        }
+    }
+
+    filter_chain_Delete( p_chain );
+    for( unsigned i = 0; i < BENCH_PICTURES; i++ )
+        picture_Release( pp_in[i] );
+    picture_pool_Delete( p_pool );
+    es_format_Clean( &fmt_in );
+    es_format_Clean( &fmt_out );
+    return i_ret;
+}
+
+/*****************************************************************************
+ * Video blending
+ *****************************************************************************/
+static int BenchBlend( vlc_object_t *p_obj, const bench_t *p_bench,
+                       bench_result_t *p_res )
+{
+    filter_t *p_blend = vlc_object_create( p_obj, sizeof(*p_blend) );
+    if( p_blend == NULL )
+        return VLC_ENOMEM;
+
+    es_format_Init( &p_blend->fmt_in, VIDEO_ES, p_bench->chroma_in );
+    video_format_Setup( &p_blend->fmt_in.video, p_bench->chroma_in,
+                        p_bench->width, p_bench->height, 1, 1 );
+    es_format_Init( &p_blend->fmt_out, VIDEO_ES, p_bench->chroma_out );
+    video_format_Setup( &p_blend->fmt_out.video, p_bench->chroma_out,
+                        p_bench->width, p_bench->height, 1, 1 );
+
+    p_blend->p_module = module_need( p_blend, "video blending",
+                                     ModuleName( p_bench ),
+                                     ModuleName( p_bench ) != NULL );
+    if( p_blend->p_module == NULL )
+    {
+        vlc_object_release( p_blend );
+        return VLC_EGENERIC;
+    }
+
+    unsigned seed = 1;
+    picture_t *p_src = picture_NewFromFormat( &p_blend->fmt_in.video );
+    picture_t *p_dst = picture_NewFromFormat( &p_blend->fmt_out.video );
+    assert( p_src != NULL && p_dst != NULL );
+    Randomize( p_src, &seed );
+    Randomize( p_dst, &seed );
+
+    const double i_pixels = p_bench->width * p_bench->height;
+    for( unsigned i = 0; i < p_bench->iterations; i++ )
+    {
+        const double start = Now();
+        p_blend->pf_video_blend( p_blend, p_dst, p_src, 0, 0, 128 );
+        Record( p_res, start, i_pixels );
+    }
+
+    picture_Release( p_src );
+    picture_Release( p_dst );
+    module_unneed( p_blend, p_blend->p_module );
+    es_format_Clean( &p_blend->fmt_in );
+    es_format_Clean( &p_blend->fmt_out );
+    vlc_object_release( p_blend );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Audio filters, converters and resamplers
+ *****************************************************************************/
+static void AudioFormat( es_format_t *p_fmt, vlc_fourcc_t i_format,
+                         unsigned i_rate, unsigned i_channels )
+{
+    static const uint32_t pi_channels[] = {
+        0, AOUT_CHAN_CENTER, AOUT_CHANS_2_0, AOUT_CHANS_3_0, AOUT_CHANS_4_0,
+        AOUT_CHANS_5_0, AOUT_CHANS_5_1, AOUT_CHANS_7_0, AOUT_CHANS_7_1,
+    };
+
+    es_format_Init( p_fmt, AUDIO_ES, i_format );
+    p_fmt->audio.i_format = i_format;
+    p_fmt->audio.i_rate = i_rate;
+    p_fmt->audio.i_physical_channels =
+    p_fmt->audio.i_original_channels =
+        pi_channels[__MIN( i_channels, ARRAY_SIZE(pi_channels) - 1 )];
+    aout_FormatPrepare( &p_fmt->audio );
+}
+
+static int BenchAudio( vlc_object_t *p_obj, const bench_t *p_bench,
+                       const char *psz_capability, bench_result_t *p_res )
+{
+    es_format_t fmt_in, fmt_out;
+    vlc_fourcc_t i_format_out = p_bench->format_in;
+    unsigned i_rate_out = p_bench->rate_in;
+
+    if( !strcmp( psz_capability, "audio converter" ) )
+        i_format_out = p_bench->format_out;
+    else if( !strcmp( psz_capability, "audio resampler" ) )
+        i_rate_out = p_bench->rate_out;
+
+    AudioFormat( &fmt_in, p_bench->format_in, p_bench->rate_in,
+                 p_bench->channels );
+    AudioFormat( &fmt_out, i_format_out, i_rate_out, p_bench->channels );
+
+    filter_chain_t *p_chain = filter_chain_New( p_obj, psz_capability, false,
+                                                NULL, NULL, NULL );
+    filter_chain_Reset( p_chain, &fmt_in, &fmt_out );
+
+    int i_ret = VLC_EGENERIC;
+    if( !strcmp( psz_capability, "audio filter" ) )
+    {
+        if( ModuleName( p_bench ) != NULL
+         && filter_chain_AppendFromString( p_chain, p_bench->module ) >= 0 )
+            i_ret = VLC_SUCCESS;
+    }
+    else if( filter_chain_AppendFilter( p_chain, ModuleName( p_bench ), NULL,
+                                        &fmt_in, &fmt_out ) != NULL )
+        i_ret = VLC_SUCCESS;
+
+    const size_t i_size = p_bench->samples * fmt_in.audio.i_bytes_per_frame;
+    uint8_t *p_samples = malloc( i_size );
+    unsigned seed = 1;
+
+    assert( p_samples != NULL );
+    FillRandom( p_samples, i_size, &seed );
+    if( fmt_in.audio.i_format == VLC_CODEC_FL32 )
+    {
+        /* Keep the samples in [-1, 1] */
+        float *p_float = (float *)p_samples;
+        for( size_t i = 0; i < i_size / sizeof(float); i++ )
+            p_float[i] = (float)((seed = seed * 1103515245 + 12345) >> 16)
+                       / 32768.f - 1.f;
+    }
+
+    const mtime_t i_length = CLOCK_FREQ * p_bench->samples / p_bench->rate_in;
+    for( unsigned i = 0; i_ret == VLC_SUCCESS && i < p_bench->iterations; i++ )
+    {
+        block_t *p_block = block_Alloc( i_size );
+        assert( p_block != NULL );
+        memcpy( p_block->p_buffer, p_samples, i_size );
+        p_block->i_nb_samples = p_bench->samples;
+        p_block->i_pts = p_block->i_dts = VLC_TS_0 + i * i_length;
+        p_block->i_length = i_length;
+
+        const double start = Now();
+        p_block = filter_chain_AudioFilter( p_chain, p_block );
+        Record( p_res, start, (double)p_bench->samples * p_bench->channels );
+
+        if( p_block != NULL )
+            block_ChainRelease( p_block );
+    }
+
+    free( p_samples );
+    filter_chain_Delete( p_chain );
+    es_format_Clean( &fmt_in );
+    es_format_Clean( &fmt_out );
+    return i_ret;
+}
+
+/*****************************************************************************
+ * Packetizers
+ *****************************************************************************/
+static block_t *LoadInput( const bench_t *p_bench )
+{
+    if( p_bench->input == NULL )
+    {
+        /* Random data with a start code every block, so that the
+         * synchronization and the parsing paths both run */
+        const size_t i_size = 64 * p_bench->block_size;
+        block_t *p_data = block_Alloc( i_size );
+        unsigned seed = 1;
+
+        assert( p_data != NULL );
+        FillRandom( p_data->p_buffer, i_size, &seed );
+        for( size_t i = 0; i + 4 <= i_size; i += p_bench->block_size )
+            memcpy( &p_data->p_buffer[i], "\x00\x00\x01\xb3", 4 );
+        return p_data;
+    }
+
+    FILE *file = fopen( p_bench->input, "rb" );
+    if( file == NULL )
+    {
+        perror( p_bench->input );
+        return NULL;
+    }
+
+    block_t *p_data = NULL;
+    if( fseek( file, 0, SEEK_END ) == 0 )
+    {
+        const long i_size = ftell( file );
+
+        rewind( file );
+        if( i_size > 0 && (p_data = block_Alloc( i_size )) != NULL
+         && fread( p_data->p_buffer, 1, i_size, file ) != (size_t)i_size )
+        {
+            block_Release( p_data );
+            p_data = NULL;
+        }
+    }
+    fclose( file );
+    return p_data;
+}
+
+static int BenchPacketizer( vlc_object_t *p_obj, const bench_t *p_bench,
+                            bench_result_t *p_res )
+{
+    static const int pi_cats[] = { VIDEO_ES, AUDIO_ES, SPU_ES };
+    vlc_fourcc_t i_codec = 0;
+    int i_cat = UNKNOWN_ES;
+
+    for( unsigned i = 0; i < ARRAY_SIZE(pi_cats) && i_codec == 0; i++ )
+    {
+        i_codec = vlc_fourcc_GetCodecFromString( pi_cats[i], p_bench->codec );
+        i_cat = pi_cats[i];
+    }
+    if( i_codec == 0 )
+    {
+        fprintf( stderr, "unknown codec %s\n", p_bench->codec );
+        return VLC_EGENERIC;
+    }
+
+    block_t *p_data = LoadInput( p_bench );
+    if( p_data == NULL )
+        return VLC_EGENERIC;
+
+    decoder_t *p_pack = vlc_object_create( p_obj, sizeof(*p_pack) );
+    if( p_pack == NULL )
+    {
+        block_Release( p_data );
+        return VLC_ENOMEM;
+    }
+    es_format_Init( &p_pack->fmt_in, i_cat, i_codec );
+    es_format_Init( &p_pack->fmt_out, i_cat, 0 );
+
+    p_pack->p_module = module_need( p_pack, "packetizer",
+                                    ModuleName( p_bench ),
+                                    ModuleName( p_bench ) != NULL );
+    if( p_pack->p_module == NULL )
+    {
+        es_format_Clean( &p_pack->fmt_in );
+        vlc_object_release( p_pack );
+        block_Release( p_data );
+        return VLC_EGENERIC;
+    }
+
+    size_t i_offset = 0;
+    for( unsigned i = 0; i < p_bench->iterations; i++ )
+    {
+        const size_t i_size = __MIN( p_bench->block_size,
+                                     p_data->i_buffer - i_offset );
+        block_t *p_block = block_Alloc( i_size );
+
+        assert( p_block != NULL );
+        memcpy( p_block->p_buffer, &p_data->p_buffer[i_offset], i_size );
+        p_block->i_pts = p_block->i_dts = i == 0 ? VLC_TS_0 : VLC_TS_INVALID;
+        i_offset = (i_offset + i_size) % p_data->i_buffer;
+
+        const double start = Now();
+        block_t *p_out;
+        while( (p_out = p_pack->pf_packetize( p_pack, &p_block )) != NULL )
+            block_ChainRelease( p_out );
+        Record( p_res, start, i_size );
+    }
+
+    module_unneed( p_pack, p_pack->p_module );
+    es_format_Clean( &p_pack->fmt_in );
+    es_format_Clean( &p_pack->fmt_out );
+    vlc_object_release( p_pack );
+    block_Release( p_data );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Pipeline
+ *****************************************************************************/
+enum
+{
+    STAGE_DEMUX,
+    STAGE_PACKETIZER,
+    STAGE_DECODER,
+    STAGE_FILTER,
+    STAGE_NONE, /* outside of the measured loop */
+};
+
+static const char *const ppsz_stages[] = {
+    "demux", "packetizer", "decoder", "filter",
+};
+
+/* The allocations of each stage are charged to its own account */
+static const char *const ppsz_accounts[] = {
+    "bench demux", "bench packetizer", "bench decoder", "bench filter",
+};
+
+struct es_out_sys_t
+{
+    vlc_object_t  *p_obj;
+    const bench_t *p_bench;
+
+    /* The stages call each other: the time is charged to the innermost */
+    int      i_stage;
+    double   wall, cpu;  /* us, at the last stage change */
+    double   pi_wall[STAGE_NONE + 1];
+    double   pi_cpu[STAGE_NONE + 1];
+
+    unsigned i_pictures;  /* Decoded video pictures */
+    unsigned i_audio;     /* Decoded audio blocks */
+
+    /* Not all demuxers delete their elementary streams */
+    int          i_es;
+    es_out_id_t  **pp_es;
+};
+
+struct es_out_id_t
+{
+    es_out_sys_t   *p_sys;
+    decoder_t      *p_packetizer;
+    decoder_t      *p_dec;
+    picture_pool_t *p_pool;     /* decoder pictures */
+    video_format_t pool_fmt;
+    filter_chain_t *p_chain;
+    bool           b_chain;     /* the filter chain was tried */
+};
+
+static double CPUNow( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Returns the previous stage, to switch back to when done */
+static int StageEnter( es_out_sys_t *p_sys, int i_stage )
+{
+    const double wall = Now(), cpu = CPUNow();
+    const int i_prev = p_sys->i_stage;
+
+    p_sys->pi_wall[i_prev] += wall - p_sys->wall;
+    p_sys->pi_cpu[i_prev] += cpu - p_sys->cpu;
+    p_sys->wall = wall;
+    p_sys->cpu = cpu;
+    p_sys->i_stage = i_stage;
+    vlc_mem_SetAccount( i_stage != STAGE_NONE ? ppsz_accounts[i_stage]
+                                              : NULL );
+    return i_prev;
+}
+
+static picture_t *PipelinePictureNew( decoder_t *p_dec )
+{
+    es_out_id_t *id = (es_out_id_t *)p_dec->p_owner;
+    video_format_t fmt = p_dec->fmt_out.video;
+
+    fmt.i_chroma = p_dec->fmt_out.i_codec;
+    if( fmt.i_width == 0 || fmt.i_height == 0 )
+        return NULL;
+
+    /* A pool, as the video output would have */
+    if( id->p_pool == NULL || fmt.i_chroma != id->pool_fmt.i_chroma
+     || fmt.i_width != id->pool_fmt.i_width
+     || fmt.i_height != id->pool_fmt.i_height )
+    {
+        if( id->p_pool != NULL )
+            picture_pool_Delete( id->p_pool );
+        id->p_pool = picture_pool_NewFromFormat( &fmt, BENCH_PICTURES
+                        + __MAX( p_dec->i_dpb_size, 16 )
+                        + p_dec->i_extra_picture_buffers );
+        id->pool_fmt = fmt;
+        if( id->p_pool == NULL )
+            return NULL;
+    }
+
+    picture_t *p_pic = picture_pool_Get( id->p_pool );
+    return p_pic != NULL ? p_pic : picture_NewFromFormat( &fmt );
+}
+
+static void PipelinePictureDel( decoder_t *p_dec, picture_t *p_pic )
+{
+    VLC_UNUSED(p_dec);
+    picture_Release( p_pic );
+}
+
+static void PipelinePictureLink( decoder_t *p_dec, picture_t *p_pic )
+{
+    VLC_UNUSED(p_dec);
+    picture_Hold( p_pic );
+}
+
+static block_t *PipelineAudioNew( decoder_t *p_dec, int i_samples )
+{
+    audio_format_t fmt = p_dec->fmt_out.audio;
+
+    fmt.i_format = p_dec->fmt_out.i_codec;
+    aout_FormatPrepare( &fmt );
+    if( fmt.i_bytes_per_frame == 0 || fmt.i_frame_length == 0 )
+        return NULL;
+
+    block_t *p_block = block_Alloc( i_samples * fmt.i_bytes_per_frame
+                                    / fmt.i_frame_length );
+    if( p_block != NULL )
+        p_block->i_nb_samples = i_samples;
+    return p_block;
+}
+
+static subpicture_t *PipelineSubNew( decoder_t *p_dec,
+                                     const subpicture_updater_t *p_updater )
+{
+    VLC_UNUSED(p_dec);
+    return subpicture_New( p_updater );
+}
+
+static void PipelineSubDel( decoder_t *p_dec, subpicture_t *p_subpic )
+{
+    VLC_UNUSED(p_dec);
+    subpicture_Delete( p_subpic );
+}
+
+static void PipelineCodecDelete( decoder_t *p_dec )
+{
+    if( p_dec->p_module != NULL )
+        module_unneed( p_dec, p_dec->p_module );
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+    vlc_object_release( p_dec );
+}
+
+static decoder_t *PipelineCodecNew( es_out_id_t *id, const es_format_t *p_fmt,
+                                    bool b_packetizer )
+{
+    decoder_t *p_dec = vlc_object_create( id->p_sys->p_obj, sizeof(*p_dec) );
+    if( p_dec == NULL )
+        return NULL;
+
+    es_format_Copy( &p_dec->fmt_in, p_fmt );
+    es_format_Init( &p_dec->fmt_out, UNKNOWN_ES, 0 );
+    p_dec->b_pace_control = true;
+    p_dec->pf_vout_buffer_new = PipelinePictureNew;
+    p_dec->pf_vout_buffer_del = PipelinePictureDel;
+    p_dec->pf_picture_link    = PipelinePictureLink;
+    p_dec->pf_picture_unlink  = PipelinePictureDel;
+    p_dec->pf_aout_buffer_new = PipelineAudioNew;
+    p_dec->pf_spu_buffer_new  = PipelineSubNew;
+    p_dec->pf_spu_buffer_del  = PipelineSubDel;
+    p_dec->p_owner = (decoder_owner_sys_t *)id;
+
+    if( b_packetizer )
+        p_dec->p_module = module_need( p_dec, "packetizer", "$packetizer",
+                                       false );
+    else
+        p_dec->p_module = module_need( p_dec, "decoder", "$codec", false );
+    if( p_dec->p_module == NULL )
+    {
+        fprintf( stderr, "no %s for %4.4s, skipped\n",
+                 b_packetizer ? "packetizer" : "decoder",
+                 (const char *)&p_fmt->i_codec );
+        PipelineCodecDelete( p_dec );
+        return NULL;
+    }
+    return p_dec;
+}
+
+static picture_t *PipelineFilterNew( filter_t *p_filter )
+{
+    return picture_NewFromFormat( &p_filter->fmt_out.video );
+}
+
+static int PipelineAllocatorInit( filter_t *p_filter, void *p_data )
+{
+    VLC_UNUSED(p_data);
+    p_filter->pf_video_buffer_new = PipelineFilterNew;
+    p_filter->pf_video_buffer_del = VideoBufferDel;
+    return VLC_SUCCESS;
+}
+
+/* The null video output */
+static void PipelineDisplay( es_out_id_t *id, picture_t *p_pic )
+{
+    es_out_sys_t *p_sys = id->p_sys;
+
+    p_sys->i_pictures++;
+    if( p_sys->p_bench->filters == NULL )
+    {
+        picture_Release( p_pic );
+        return;
+    }
+
+    const int i_prev = StageEnter( p_sys, STAGE_FILTER );
+    if( !id->b_chain )
+    {
+        es_format_t fmt;
+
+        id->b_chain = true;
+        es_format_Copy( &fmt, &id->p_dec->fmt_out );
+        fmt.video.i_chroma = fmt.i_codec;
+        id->p_chain = filter_chain_New( p_sys->p_obj, "video filter2", false,
+                                        PipelineAllocatorInit, NULL, NULL );
+        if( id->p_chain != NULL )
+        {
+            filter_chain_Reset( id->p_chain, &fmt, &fmt );
+            if( filter_chain_AppendFromString( id->p_chain,
+                                               p_sys->p_bench->filters ) < 0 )
+                fprintf( stderr, "cannot use filters %s, skipped\n",
+                         p_sys->p_bench->filters );
+        }
+        es_format_Clean( &fmt );
+    }
+
+    picture_t *p_out = p_pic;
+    if( id->p_chain != NULL )
+        p_out = filter_chain_VideoFilter( id->p_chain, p_pic );
+    while( p_out != NULL )
+    {
+        picture_t *p_next = p_out->p_next;
+        p_out->p_next = NULL;
+        picture_Release( p_out );
+        p_out = p_next;
+    }
+    StageEnter( p_sys, i_prev );
+}
+
+static void PipelineDecode( es_out_id_t *id, block_t *p_block )
+{
+    es_out_sys_t *p_sys = id->p_sys;
+    decoder_t *p_dec = id->p_dec;
+    const int i_prev = StageEnter( p_sys, STAGE_DECODER );
+
+    switch( p_dec->fmt_in.i_cat )
+    {
+        case VIDEO_ES:
+        {
+            picture_t *p_pic;
+            while( (p_pic = p_dec->pf_decode_video( p_dec, &p_block )) )
+                PipelineDisplay( id, p_pic );
+            break;
+        }
+        case AUDIO_ES:
+        {
+            block_t *p_audio;
+            while( (p_audio = p_dec->pf_decode_audio( p_dec, &p_block )) )
+            {
+                p_sys->i_audio++;
+                block_Release( p_audio );
+            }
+            break;
+        }
+        case SPU_ES:
+        {
+            subpicture_t *p_subpic;
+            while( (p_subpic = p_dec->pf_decode_sub( p_dec, &p_block )) )
+                subpicture_Delete( p_subpic );
+            break;
+        }
+        default:
+            if( p_block != NULL )
+                block_Release( p_block );
+            break;
+    }
+    StageEnter( p_sys, i_prev );
+}
+
+static void PipelineEsCreate( es_out_id_t *id, const es_format_t *p_fmt )
+{
+    if( p_fmt->i_cat != VIDEO_ES && p_fmt->i_cat != AUDIO_ES
+     && p_fmt->i_cat != SPU_ES )
+        return;
+
+    const es_format_t *p_dec_fmt = p_fmt;
+    if( !p_fmt->b_packetized )
+    {
+        id->p_packetizer = PipelineCodecNew( id, p_fmt, true );
+        if( id->p_packetizer == NULL )
+            return;
+        p_dec_fmt = &id->p_packetizer->fmt_out;
+    }
+    id->p_dec = PipelineCodecNew( id, p_dec_fmt, false );
+    if( id->p_dec == NULL && id->p_packetizer != NULL )
+    {
+        PipelineCodecDelete( id->p_packetizer );
+        id->p_packetizer = NULL;
+    }
+}
+
+static es_out_id_t *PipelineEsAdd( es_out_t *out, const es_format_t *p_fmt )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    es_out_id_t *id = calloc( 1, sizeof(*id) );
+    if( id == NULL )
+        return NULL;
+
+    id->p_sys = p_sys;
+    TAB_APPEND( p_sys->i_es, p_sys->pp_es, id );
+
+    /* Opening the modules is not charged to any stage */
+    const int i_prev = StageEnter( p_sys, STAGE_NONE );
+    PipelineEsCreate( id, p_fmt );
+    StageEnter( p_sys, i_prev );
+    return id;
+}
+
+static int PipelineEsSend( es_out_t *out, es_out_id_t *id, block_t *p_block )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( id->p_dec == NULL )
+    {
+        block_ChainRelease( p_block );
+        return VLC_SUCCESS;
+    }
+
+    if( id->p_packetizer == NULL )
+    {
+        PipelineDecode( id, p_block );
+        return VLC_SUCCESS;
+    }
+
+    const int i_prev = StageEnter( p_sys, STAGE_PACKETIZER );
+    block_t *p_packets;
+    while( (p_packets = id->p_packetizer->pf_packetize( id->p_packetizer,
+                                                        &p_block )) )
+    {
+        while( p_packets != NULL )
+        {
+            block_t *p_next = p_packets->p_next;
+            p_packets->p_next = NULL;
+            PipelineDecode( id, p_packets );
+            p_packets = p_next;
+        }
+    }
+    StageEnter( p_sys, i_prev );
+    return VLC_SUCCESS;
+}
+
+static void PipelineEsDel( es_out_t *out, es_out_id_t *id )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    TAB_REMOVE( p_sys->i_es, p_sys->pp_es, id );
+    if( id->p_chain != NULL )
+        filter_chain_Delete( id->p_chain );
+    if( id->p_dec != NULL )
+        PipelineCodecDelete( id->p_dec );
+    if( id->p_packetizer != NULL )
+        PipelineCodecDelete( id->p_packetizer );
+    /* The pool goes last, the modules may still hold its pictures */
+    if( id->p_pool != NULL )
+        picture_pool_Delete( id->p_pool );
+    free( id );
+}
+
+static int PipelineEsControl( es_out_t *out, int i_query, va_list args )
+{
+    VLC_UNUSED(out);
+    switch( i_query )
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            es_out_id_t *id = va_arg( args, es_out_id_t * );
+            bool *pb = va_arg( args, bool * );
+            *pb = id->p_dec != NULL;
+            return VLC_SUCCESS;
+        }
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_RESET_PCR:
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static void PipelineEsDestroy( es_out_t *out )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    while( p_sys->i_es > 0 )
+        PipelineEsDel( out, p_sys->pp_es[0] );
+    TAB_CLEAN( p_sys->i_es, p_sys->pp_es );
+}
+
+static void PipelineDemuxDelete( demux_t *p_demux )
+{
+    if( p_demux->p_module != NULL )
+        module_unneed( p_demux, p_demux->p_module );
+    free( p_demux->psz_access );
+    free( p_demux->psz_demux );
+    free( p_demux->psz_location );
+    free( p_demux->psz_file );
+    vlc_object_release( p_demux );
+}
+
+/* Like the input does, less the access_demux modules */
+static demux_t *PipelineDemuxNew( vlc_object_t *p_obj, const char *psz_mrl,
+                                  stream_t *s, es_out_t *out )
+{
+    demux_t *p_demux = vlc_object_create( p_obj, sizeof(*p_demux) );
+    if( p_demux == NULL )
+        return NULL;
+
+    const char *psz_sep = strstr( psz_mrl, "://" );
+    char *psz_demux = var_InheritString( p_obj, "demux" );
+
+    p_demux->psz_access = strndup( psz_mrl, psz_sep - psz_mrl );
+    p_demux->psz_demux = psz_demux != NULL ? psz_demux : strdup( "" );
+    p_demux->psz_location = strdup( psz_sep + 3 );
+    p_demux->psz_file = make_path( psz_mrl );
+    p_demux->s = s;
+    p_demux->out = out;
+    p_demux->pf_demux = NULL;
+    p_demux->pf_control = NULL;
+    p_demux->p_sys = NULL;
+    p_demux->p_input = NULL;
+    p_demux->info.i_update = 0;
+    p_demux->info.i_title = 0;
+    p_demux->info.i_seekpoint = 0;
+    p_demux->p_module = NULL;
+
+    if( p_demux->psz_access != NULL && p_demux->psz_demux != NULL
+     && p_demux->psz_location != NULL )
+        p_demux->p_module = module_need( p_demux, "demux",
+                                         p_demux->psz_demux,
+                                         p_demux->psz_demux[0] != '\0' );
+    if( p_demux->p_module == NULL )
+    {
+        PipelineDemuxDelete( p_demux );
+        return NULL;
+    }
+    return p_demux;
+}
+
+static void PipelineAllocs( uint64_t *pi_allocs )
+{
+    vlc_mem_stats_t stats[VLC_MEM_ACCOUNTS];
+    const unsigned i_count = vlc_mem_GetStats( stats );
+
+    for( unsigned i = 0; i < ARRAY_SIZE(ppsz_accounts); i++ )
+    {
+        pi_allocs[i] = 0;
+        for( unsigned j = 0; j < i_count; j++ )
+            if( !strcmp( stats[j].psz_name, ppsz_accounts[i] ) )
+                pi_allocs[i] = stats[j].i_allocs;
+    }
+}
+
+static int BenchPipeline( vlc_object_t *p_obj, const bench_t *p_bench,
+                          bench_result_t *p_res )
+{
+    char *psz_mrl = strstr( p_bench->module, "://" ) != NULL
+                  ? strdup( p_bench->module )
+                  : vlc_path2uri( p_bench->module, NULL );
+    if( psz_mrl == NULL )
+        return VLC_ENOMEM;
+
+    es_out_sys_t sys = {
+        .p_obj = p_obj, .p_bench = p_bench, .i_stage = STAGE_NONE,
+    };
+    TAB_INIT( sys.i_es, sys.pp_es );
+    es_out_t out = {
+        .pf_add = PipelineEsAdd, .pf_send = PipelineEsSend,
+        .pf_del = PipelineEsDel, .pf_control = PipelineEsControl,
+        .pf_destroy = PipelineEsDestroy, .p_sys = &sys,
+    };
+
+    stream_t *s = stream_UrlNew( p_obj, psz_mrl );
+    demux_t *p_demux = s != NULL ? PipelineDemuxNew( p_obj, psz_mrl, s, &out )
+                                 : NULL;
+    free( psz_mrl );
+    if( p_demux == NULL )
+    {
+        if( s != NULL )
+            stream_Delete( s );
+        es_out_Delete( &out );
+        return VLC_EGENERIC;
+    }
+
+    /* Only the loop is measured, not the opening of the modules */
+    uint64_t pi_start[ARRAY_SIZE(ppsz_accounts)];
+    uint64_t pi_end[ARRAY_SIZE(ppsz_accounts)];
+
+    PipelineAllocs( pi_start );
+    sys.wall = Now();
+    sys.cpu = CPUNow();
+    for( unsigned i = 0; i < p_bench->iterations; i++ )
+    {
+        const double start = Now();
+
+        StageEnter( &sys, STAGE_DEMUX );
+        const int i_ret = p_demux->pf_demux( p_demux );
+        StageEnter( &sys, STAGE_NONE );
+        Record( p_res, start, 0. );
+        if( i_ret <= 0 )
+            break;
+    }
+    PipelineAllocs( pi_end );
+
+    PipelineDemuxDelete( p_demux );
+    stream_Delete( s );
+    es_out_Delete( &out );
+
+    /* Per picture, or per audio block for audio only inputs */
+    const unsigned i_frames = sys.i_pictures ? sys.i_pictures : sys.i_audio;
+    size_t i_len = snprintf( p_res->extra, sizeof(p_res->extra),
+                             ",\"pictures\":%u,\"audio_blocks\":%u",
+                             sys.i_pictures, sys.i_audio );
+    for( unsigned i = 0; i < ARRAY_SIZE(ppsz_stages); i++ )
+        if( i_len < sizeof(p_res->extra) )
+            i_len += snprintf( p_res->extra + i_len,
+                               sizeof(p_res->extra) - i_len,
+                               ",\"%s_us\":%.0f,\"%s_cpu_us\":%.0f,"
+                               "\"%s_allocs_per_frame\":%.3g",
+                               ppsz_stages[i], sys.pi_wall[i],
+                               ppsz_stages[i], sys.pi_cpu[i], ppsz_stages[i],
+                               i_frames ? (double)(pi_end[i] - pi_start[i])
+                                          / i_frames : 0. );
+    p_res->units = i_frames;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Runner
+ *****************************************************************************/
+static const struct
+{
+    const char *psz_name;
+    const char *psz_units;
+} kinds[] = {
+    { "video",      "pixels" },
+    { "chroma",     "pixels" },
+    { "blend",      "pixels" },
+    { "audio",      "samples" },
+    { "converter",  "samples" },
+    { "resampler",  "samples" },
+    { "packetizer", "bytes" },
+    { "pipeline",   "frames" },
+};
+
+/* Each variant keeps the capabilities up to its own, in this order */
+static const struct
+{
+    const char *psz_name;
+    uint32_t    i_flag;
+} cpus[] = {
+    { "c",      0 },
+#if defined (__i386__) || defined (__x86_64__)
+    { "mmx",    VLC_CPU_MMX },
+    { "mmxext", VLC_CPU_MMXEXT },
+    { "sse",    VLC_CPU_SSE },
+    { "sse2",   VLC_CPU_SSE2 },
+    { "sse3",   VLC_CPU_SSE3 },
+    { "ssse3",  VLC_CPU_SSSE3 },
+    { "sse4.1", VLC_CPU_SSE4_1 },
+    { "sse4.2", VLC_CPU_SSE4_2 },
+    { "avx",    VLC_CPU_AVX },
+    { "avx2",   VLC_CPU_AVX2 },
+#elif defined (__arm__)
+    { "armv6",  VLC_CPU_ARMv6 },
+    { "neon",   VLC_CPU_ARM_NEON },
+#elif defined (__powerpc__) || defined (__ppc__) || defined (__ppc64__)
+    { "altivec", VLC_CPU_ALTIVEC },
+#endif
+};
+
+static int CPUMask( const char *psz_cpu, uint32_t *pi_mask )
+{
+    uint32_t i_mask = 0;
+
+    for( unsigned i = 0; i < ARRAY_SIZE(cpus); i++ )
+    {
+        i_mask |= cpus[i].i_flag;
+        if( !strcmp( cpus[i].psz_name, psz_cpu ) )
+        {
+            *pi_mask = i_mask;
+            return VLC_SUCCESS;
+        }
+    }
+    return VLC_EGENERIC;
+}
+
+static int CompareDurations( const void *a, const void *b )
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double Percentile( const bench_result_t *p_res, unsigned i_percent )
+{
+    return p_res->durations[(p_res->count - 1) * i_percent / 100];
+}
+
+static void PrintString( const char *psz )
+{
+    putchar( '"' );
+    for( ; *psz; psz++ )
+    {
+        if( *psz == '"' || *psz == '\\' )
+            putchar( '\\' );
+        putchar( *psz );
+    }
+    putchar( '"' );
+}
+
+/* Runs in the process of the variant */
+static int Run( const bench_t *p_bench )
+{
+    libvlc_instance_t *p_vlc = libvlc_new( p_bench->argc, p_bench->argv );
+    if( p_vlc == NULL )
+        return VLC_EGENERIC;
+
+    vlc_object_t *p_obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+    bench_result_t res = {
+        .durations = calloc( p_bench->iterations, sizeof(double) ),
+    };
+    int i_ret = VLC_ENOMEM;
+    const char *psz_units = NULL;
+
+    for( unsigned i = 0; i < ARRAY_SIZE(kinds); i++ )
+        if( !strcmp( kinds[i].psz_name, p_bench->kind ) )
+            psz_units = kinds[i].psz_units;
+    assert( psz_units != NULL );
+
+    if( res.durations == NULL )
+        ;
+    else if( !strcmp( p_bench->kind, "video" ) )
+        i_ret = BenchVideo( p_obj, p_bench, false, &res );
+    else if( !strcmp( p_bench->kind, "chroma" ) )
+        i_ret = BenchVideo( p_obj, p_bench, true, &res );
+    else if( !strcmp( p_bench->kind, "blend" ) )
+        i_ret = BenchBlend( p_obj, p_bench, &res );
+    else if( !strcmp( p_bench->kind, "audio" ) )
+        i_ret = BenchAudio( p_obj, p_bench, "audio filter", &res );
+    else if( !strcmp( p_bench->kind, "converter" ) )
+        i_ret = BenchAudio( p_obj, p_bench, "audio converter", &res );
+    else if( !strcmp( p_bench->kind, "resampler" ) )
+        i_ret = BenchAudio( p_obj, p_bench, "audio resampler", &res );
+    else if( !strcmp( p_bench->kind, "packetizer" ) )
+        i_ret = BenchPacketizer( p_obj, p_bench, &res );
+    else if( !strcmp( p_bench->kind, "pipeline" ) )
+        i_ret = BenchPipeline( p_obj, p_bench, &res );
+
+    if( i_ret == VLC_SUCCESS && res.count > 0 )
+    {
+        double total = 0.;
+        for( unsigned i = 0; i < res.count; i++ )
+            total += res.durations[i];
+        qsort( res.durations, res.count, sizeof(double), CompareDurations );
+
+        printf( "{\"kind\":" );
+        PrintString( p_bench->kind );
+        printf( ",\"module\":" );
+        PrintString( p_bench->module );
+        printf( ",\"cpu\":" );
+        PrintString( p_bench->cpu );
+        printf( ",\"cpu_flags\":\"0x%08x\",\"iterations\":%u,"
+                "\"units\":\"%s\",\"throughput\":%.6g,"
+                "\"mean_us\":%.3f,\"p50_us\":%.3f,\"p90_us\":%.3f,"
+                "\"p99_us\":%.3f,\"max_us\":%.3f%s}\n",
+                vlc_CPU(), res.count, psz_units,
+                total > 0. ? res.units * 1e6 / total : 0.,
+                total / res.count, Percentile( &res, 50 ),
+                Percentile( &res, 90 ), Percentile( &res, 99 ),
+                res.durations[res.count - 1], res.extra );
+        fflush( stdout );
+    }
+    else if( i_ret != VLC_SUCCESS )
+        fprintf( stderr, "cannot run %s module %s\n", p_bench->kind,
+                 p_bench->module );
+
+    free( res.durations );
+    libvlc_release( p_vlc );
+    return i_ret;
+}
+
+static void Usage( const char *psz_name )
+{
+    printf( "Usage: %s [options] <kind> <module> [-- <VLC options>]\n"
+            "       %s [options] pipeline <file>... [-- <VLC options>]\n"
+            "\n"
+            "Kinds: video, chroma, blend, audio, converter, resampler, "
+            "packetizer, pipeline\n"
+            "The module is given as in the VLC options, or \"any\" to let "
+            "the core choose.\n"
+            "\n"
+            "  -n <count>     number of iterations, demux calls for the "
+            "pipeline (100)\n"
+            "  -x <cpus>      comma separated CPU variants (native)\n"
+            "  -w <W>x<H>     picture size (1920x1080)\n"
+            "  -c <fourcc>    input chroma (I420) or sample format (fl32)\n"
+            "  -o <fourcc>    output chroma (RV32) or sample format (s16l)\n"
+            "  -r <rate>      input sample rate (48000)\n"
+            "  -R <rate>      output sample rate (44100)\n"
+            "  -C <channels>  number of channels (2)\n"
+            "  -s <samples>   samples per block (1024)\n"
+            "  -f <codec>     packetized codec\n"
+            "  -i <file>      packetizer input (random data)\n"
+            "  -b <bytes>     packetizer block size (4096)\n"
+            "  -V <filters>   pipeline video filters (none)\n"
+            "\n"
+            "CPU variants:", psz_name, psz_name );
+    printf( " native" );
+    for( unsigned i = 0; i < ARRAY_SIZE(cpus); i++ )
+        printf( " %s", cpus[i].psz_name );
+    printf( "\n" );
+}
+
+static vlc_fourcc_t FourCC( const char *psz )
+{
+    char buf[4] = { ' ', ' ', ' ', ' ' };
+
+    memcpy( buf, psz, __MIN( strlen( psz ), sizeof(buf) ) );
+    return VLC_FOURCC( buf[0], buf[1], buf[2], buf[3] );
+}
+
+int main( int argc, char **argv )
+{
+    static const char *const default_args[] = {
+        "--ignore-config", "-I", "dummy", "--no-media-library", "-q",
+    };
+    bench_t bench = {
+        .iterations = 100,
+        .chroma_in = VLC_CODEC_I420, .chroma_out = VLC_CODEC_RGB32,
+        .width = 1920, .height = 1080,
+        .format_in = VLC_CODEC_FL32, .format_out = VLC_CODEC_S16N,
+        .rate_in = 48000, .rate_out = 44100, .channels = 2, .samples = 1024,
+        .block_size = 4096,
+    };
+    const char *psz_cpus = "native";
+    int c;
+
+    while( (c = getopt( argc, argv, "hn:x:w:c:o:r:R:C:s:f:i:b:V:" )) != -1 )
+    {
+        switch( c )
+        {
+            case 'n': bench.iterations = strtoul( optarg, NULL, 0 ); break;
+            case 'x': psz_cpus = optarg; break;
+            case 'w':
+                if( sscanf( optarg, "%ux%u", &bench.width,
+                            &bench.height ) != 2 )
+                    return 1;
+                break;
+            case 'c':
+                bench.chroma_in = bench.format_in = FourCC( optarg );
+                break;
+            case 'o':
+                bench.chroma_out = bench.format_out = FourCC( optarg );
+                break;
+            case 'r': bench.rate_in = strtoul( optarg, NULL, 0 ); break;
+            case 'R': bench.rate_out = strtoul( optarg, NULL, 0 ); break;
+            case 'C': bench.channels = strtoul( optarg, NULL, 0 ); break;
+            case 's': bench.samples = strtoul( optarg, NULL, 0 ); break;
+            case 'f': bench.codec = optarg; break;
+            case 'i': bench.input = optarg; break;
+            case 'b': bench.block_size = strtoul( optarg, NULL, 0 ); break;
+            case 'V': bench.filters = optarg; break;
+            case 'h':
+                Usage( argv[0] );
+                return 0;
+            default:
+                Usage( argv[0] );
+                return 1;
+        }
+    }
+
+    if( argc - optind < 2 || bench.iterations == 0 || bench.block_size == 0
+     || bench.rate_in == 0 || bench.samples == 0 )
+    {
+        Usage( argv[0] );
+        return 1;
+    }
+    bench.kind = argv[optind++];
+
+    /* The pipeline runs each of its input files in turn */
+    const int i_first = optind++;
+    if( !strcmp( bench.kind, "pipeline" ) )
+        while( optind < argc && strcmp( argv[optind], "--" ) )
+            optind++;
+    const int i_modules = optind - i_first;
+    if( !strcmp( bench.kind, "packetizer" ) && bench.codec == NULL )
+    {
+        fprintf( stderr, "the packetizer needs a codec (-f)\n" );
+        return 1;
+    }
+
+    bool b_kind = false;
+    for( unsigned i = 0; i < ARRAY_SIZE(kinds); i++ )
+        b_kind |= !strcmp( kinds[i].psz_name, bench.kind );
+    if( !b_kind )
+    {
+        Usage( argv[0] );
+        return 1;
+    }
+
+    /* The remaining arguments, after "--", are given to LibVLC */
+    if( optind < argc && !strcmp( argv[optind], "--" ) )
+        optind++;
+    const int i_extra = argc - optind;
+    const char **pp_args = malloc( (ARRAY_SIZE(default_args) + i_extra)
+                                   * sizeof(*pp_args) );
+    if( pp_args == NULL )
+        return 1;
+    memcpy( pp_args, default_args, sizeof(default_args) );
+    for( int i = 0; i < i_extra; i++ )
+        pp_args[ARRAY_SIZE(default_args) + i] = argv[optind + i];
+    bench.argc = ARRAY_SIZE(default_args) + i_extra;
+    bench.argv = pp_args;
+
+    if( getenv( "VLC_PLUGIN_PATH" ) == NULL )
+        setenv( "VLC_PLUGIN_PATH", "../modules", 1 );
+
+    /* Measure each variant in its own process, as the capabilities are
+     * detected once */
+    char *psz_list = strdup( psz_cpus ), *psz_save;
+    int i_status = psz_list != NULL ? 0 : 1;
+
+    for( char *psz_cpu = strtok_r( psz_list, ",", &psz_save );
+         psz_cpu != NULL; psz_cpu = strtok_r( NULL, ",", &psz_save ) )
+    {
+        uint32_t i_mask = 0;
+        const bool b_native = !strcmp( psz_cpu, "native" );
+
+        if( !b_native && CPUMask( psz_cpu, &i_mask ) )
+        {
+            fprintf( stderr, "unknown CPU variant %s\n", psz_cpu );
+            i_status = 1;
+            continue;
+        }
+
+        for( int i = 0; i < i_modules; i++ )
+        {
+            pid_t pid = fork();
+            if( pid == 0 )
+            {
+                char value[16];
+
+                if( !b_native )
+                {
+                    snprintf( value, sizeof(value), "0x%"PRIx32, i_mask );
+                    setenv( "VLC_CPU_MASK", value, 1 );
+                }
+                bench.cpu = psz_cpu;
+                bench.module = argv[i_first + i];
+                _exit( Run( &bench ) == VLC_SUCCESS ? 0 : 1 );
+            }
+
+            int status;
+            if( pid == -1 || waitpid( pid, &status, 0 ) == -1
+             || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 )
+                i_status = 1;
+        }
+    }
+
+    free( psz_list );
+    free( pp_args );
+    return i_status;
+}